@@ -289,9 +289,11 @@ getent passwd knot >/dev/null || \
 %files dnssecutils
 %{_bindir}/knsec3hash
 %{_bindir}/kzonecheck
+%{_bindir}/kzonegen
 %{_bindir}/kzonesign
 %{_mandir}/man1/knsec3hash.*
 %{_mandir}/man1/kzonecheck.*
+%{_mandir}/man1/kzonegen.*
 %{_mandir}/man1/kzonesign.*
 
 %files module-dnstap
@@ -232,9 +232,14 @@ class KnotProbe(object):
     FREE = None
     CONSUME = None
     SET_CONSUMER = None
+    SET_CONSUMER_SHM = None
 
-    def __init__(self, path: str = "/run/knot", idx: int = 1) -> None:
-        """Initializes a probe channel at a specified path with a channel index."""
+    def __init__(self, path: str = "/run/knot", idx: int = 1,
+                 shm_capacity: int = 0) -> None:
+        """Initializes a probe channel at a specified path with a channel index.
+           If shm_capacity is non-zero, a shared memory ring of this capacity
+           is used instead of a socket.
+        """
 
         if not KnotProbe.ALLOC:
             libknot.Knot()
@@ -255,9 +260,17 @@ class KnotProbe(object):
             KnotProbe.SET_CONSUMER.argtypes = [ctypes.c_void_p, ctypes.c_char_p, \
                                                ctypes.c_ushort]
 
+            KnotProbe.SET_CONSUMER_SHM = libknot.Knot.LIBKNOT.knot_probe_set_consumer_shm
+            KnotProbe.SET_CONSUMER_SHM.restype = ctypes.c_int
+            KnotProbe.SET_CONSUMER_SHM.argtypes = [ctypes.c_void_p, ctypes.c_char_p, \
+                                                   ctypes.c_ushort, ctypes.c_uint]
+
         self.obj = KnotProbe.ALLOC()
 
-        ret = KnotProbe.SET_CONSUMER(self.obj, path.encode(), idx)
+        if shm_capacity > 0:
+            ret = KnotProbe.SET_CONSUMER_SHM(self.obj, path.encode(), idx, shm_capacity)
+        else:
+            ret = KnotProbe.SET_CONSUMER(self.obj, path.encode(), idx)
         if ret != 0:
             err = libknot.Knot.STRERROR(ret)
             raise RuntimeError(err.decode())
@@ -0,0 +1,228 @@
+/*  Copyright (C) 2024 CZ.NIC, z.s.p.o. <knot-dns@labs.nic.cz>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "contrib/addr_set.h"
+#include "contrib/macros.h"
+#include "contrib/sockaddr.h"
+#include "libknot/errcode.h"
+
+// IPv4 addresses occupy the first 4 bytes, the rest is zero.
+typedef struct {
+	uint8_t min[16];
+	uint8_t max[16];
+} interval_t;
+
+typedef struct {
+	interval_t *items;
+	size_t count;
+	size_t avail;
+} intervals_t;
+
+struct addr_set {
+	intervals_t ipv4;
+	intervals_t ipv6;
+};
+
+static intervals_t *family_intervals(addr_set_t *set, int family)
+{
+	switch (family) {
+	case AF_INET:  return &set->ipv4;
+	case AF_INET6: return &set->ipv6;
+	default:       return NULL;
+	}
+}
+
+addr_set_t *addr_set_new(void)
+{
+	return calloc(1, sizeof(addr_set_t));
+}
+
+void addr_set_free(addr_set_t *set)
+{
+	if (set == NULL) {
+		return;
+	}
+
+	free(set->ipv4.items);
+	free(set->ipv6.items);
+	free(set);
+}
+
+static interval_t *interval_add(intervals_t *intervals)
+{
+	if (intervals->count == intervals->avail) {
+		size_t avail = (intervals->avail == 0) ? 8 : 2 * intervals->avail;
+		interval_t *items = realloc(intervals->items, avail * sizeof(*items));
+		if (items == NULL) {
+			return NULL;
+		}
+		intervals->items = items;
+		intervals->avail = avail;
+	}
+
+	interval_t *item = &intervals->items[intervals->count++];
+	memset(item, 0, sizeof(*item));
+
+	return item;
+}
+
+int addr_set_add_net(addr_set_t *set, const struct sockaddr_storage *addr,
+                     unsigned prefix)
+{
+	if (set == NULL || addr == NULL) {
+		return KNOT_EINVAL;
+	}
+
+	intervals_t *intervals = family_intervals(set, addr->ss_family);
+	if (intervals == NULL) {
+		return KNOT_ENOTSUP;
+	}
+
+	size_t len = 0;
+	const uint8_t *raw = sockaddr_raw(addr, &len);
+
+	interval_t *item = interval_add(intervals);
+	if (item == NULL) {
+		return KNOT_ENOMEM;
+	}
+
+	prefix = MIN(prefix, len * 8);
+	for (size_t i = 0; i < len; i++) {
+		unsigned bits = (prefix > i * 8) ? MIN(prefix - i * 8, 8) : 0;
+		uint8_t mask = (bits == 0) ? 0 : (0xff << (8 - bits));
+		item->min[i] = raw[i] & mask;
+		item->max[i] = raw[i] | (uint8_t)~mask;
+	}
+
+	return KNOT_EOK;
+}
+
+int addr_set_add_range(addr_set_t *set, const struct sockaddr_storage *addr_min,
+                       const struct sockaddr_storage *addr_max)
+{
+	if (set == NULL || addr_min == NULL || addr_max == NULL ||
+	    addr_min->ss_family != addr_max->ss_family) {
+		return KNOT_EINVAL;
+	}
+
+	intervals_t *intervals = family_intervals(set, addr_min->ss_family);
+	if (intervals == NULL) {
+		return KNOT_ENOTSUP;
+	}
+
+	size_t len = 0;
+	const uint8_t *raw_min = sockaddr_raw(addr_min, &len);
+	const uint8_t *raw_max = sockaddr_raw(addr_max, &len);
+	if (memcmp(raw_min, raw_max, len) > 0) {
+		return KNOT_EOK; // Empty range matches nothing.
+	}
+
+	interval_t *item = interval_add(intervals);
+	if (item == NULL) {
+		return KNOT_ENOMEM;
+	}
+
+	memcpy(item->min, raw_min, len);
+	memcpy(item->max, raw_max, len);
+
+	return KNOT_EOK;
+}
+
+static int interval_cmp(const void *a, const void *b)
+{
+	const interval_t *ia = a, *ib = b;
+	return memcmp(ia->min, ib->min, sizeof(ia->min));
+}
+
+static void intervals_build(intervals_t *intervals)
+{
+	if (intervals->count == 0) {
+		return;
+	}
+
+	qsort(intervals->items, intervals->count, sizeof(interval_t), interval_cmp);
+
+	// Merge overlapping intervals.
+	size_t last = 0;
+	for (size_t i = 1; i < intervals->count; i++) {
+		interval_t *prev = &intervals->items[last];
+		interval_t *cur = &intervals->items[i];
+		if (memcmp(cur->min, prev->max, sizeof(cur->min)) <= 0) {
+			if (memcmp(cur->max, prev->max, sizeof(cur->max)) > 0) {
+				memcpy(prev->max, cur->max, sizeof(prev->max));
+			}
+		} else {
+			intervals->items[++last] = *cur;
+		}
+	}
+	intervals->count = last + 1;
+}
+
+void addr_set_build(addr_set_t *set)
+{
+	if (set == NULL) {
+		return;
+	}
+
+	intervals_build(&set->ipv4);
+	intervals_build(&set->ipv6);
+}
+
+bool addr_set_match(const addr_set_t *set, const struct sockaddr_storage *addr)
+{
+	if (set == NULL || addr == NULL) {
+		return false;
+	}
+
+	const intervals_t *intervals = family_intervals((addr_set_t *)set, addr->ss_family);
+	if (intervals == NULL || intervals->count == 0) {
+		return false;
+	}
+
+	size_t len = 0;
+	const uint8_t *raw = sockaddr_raw(addr, &len);
+	uint8_t key[16] = { 0 };
+	memcpy(key, raw, len);
+
+	// Find the last interval starting at or below the address.
+	size_t l = 0, r = intervals->count;
+	while (l < r) {
+		size_t m = (l + r) / 2;
+		if (memcmp(intervals->items[m].min, key, sizeof(key)) <= 0) {
+			l = m + 1;
+		} else {
+			r = m;
+		}
+	}
+	if (l == 0) {
+		return false;
+	}
+
+	return memcmp(key, intervals->items[l - 1].max, sizeof(key)) <= 0;
+}
+
+size_t addr_set_size(const addr_set_t *set)
+{
+	if (set == NULL) {
+		return 0;
+	}
+
+	return set->ipv4.count + set->ipv6.count;
+}
@@ -0,0 +1,81 @@
+/*  Copyright (C) 2024 CZ.NIC, z.s.p.o. <knot-dns@labs.nic.cz>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+/*!
+ * \brief Set of IP address ranges with logarithmic lookup.
+ *
+ * Networks and address ranges are converted into intervals, which are sorted
+ * and merged per address family, so matching is a binary search.
+ */
+
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <sys/socket.h>
+
+typedef struct addr_set addr_set_t;
+
+/*!
+ * \brief Create an empty address set.
+ *
+ * \return Address set or NULL if out of memory.
+ */
+addr_set_t *addr_set_new(void);
+
+/*!
+ * \brief Free the address set.
+ */
+void addr_set_free(addr_set_t *set);
+
+/*!
+ * \brief Add a network to the set.
+ *
+ * \param set     Address set.
+ * \param addr    Network address.
+ * \param prefix  Network prefix length (bigger value means the full address).
+ *
+ * \return KNOT_E*
+ */
+int addr_set_add_net(addr_set_t *set, const struct sockaddr_storage *addr,
+                     unsigned prefix);
+
+/*!
+ * \brief Add an address range to the set.
+ *
+ * \param set      Address set.
+ * \param addr_min Lower bound of the range (inclusive).
+ * \param addr_max Upper bound of the range (inclusive).
+ *
+ * \return KNOT_E*
+ */
+int addr_set_add_range(addr_set_t *set, const struct sockaddr_storage *addr_min,
+                       const struct sockaddr_storage *addr_max);
+
+/*!
+ * \brief Sort and merge the added intervals, must be called before matching.
+ */
+void addr_set_build(addr_set_t *set);
+
+/*!
+ * \brief Check if the address is within the set.
+ */
+bool addr_set_match(const addr_set_t *set, const struct sockaddr_storage *addr);
+
+/*!
+ * \brief Return the number of disjoint intervals in the set.
+ */
+size_t addr_set_size(const addr_set_t *set);
@@ -0,0 +1,151 @@
+/*  Copyright (C) 2024 CZ.NIC, z.s.p.o. <knot-dns@labs.nic.cz>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include <pthread.h>
+#include <stdbool.h>
+#include <stdlib.h>
+
+#include "contrib/atomic.h"
+#include "contrib/bufpool.h"
+
+#define CLASS_MIN_SHIFT	6	// log2(BUFPOOL_MIN_SIZE)
+#define CLASS_COUNT	12	// 64 B .. 128 KiB
+#define CLASS_BYTES	(256 * 1024) // Cached bytes limit per class.
+#define CLASS_DEPTH	64	// Cached buffers limit per class.
+
+/*! \brief Released buffer, linked through its own memory. */
+typedef struct free_buf {
+	struct free_buf *next;
+} free_buf_t;
+
+/*! \brief Per-thread cache of released buffers. */
+typedef struct {
+	free_buf_t *head[CLASS_COUNT];
+	unsigned count[CLASS_COUNT];
+	bool registered;
+} cache_t;
+
+static __thread cache_t thread_cache;
+
+// Heap allocations and releases, updated outside of the cache fast path only.
+static knot_atomic_uint64_t heap_allocs;
+static knot_atomic_uint64_t heap_frees;
+
+static pthread_key_t cache_key;
+static pthread_once_t cache_key_once = PTHREAD_ONCE_INIT;
+
+/*! \brief Index of the smallest class not lower than size. */
+static int size_class(size_t size)
+{
+	if (size > BUFPOOL_MAX_SIZE) {
+		return -1;
+	}
+
+	int cls = 0;
+	while (((size_t)BUFPOOL_MIN_SIZE << cls) < size) {
+		cls++;
+	}
+	return cls;
+}
+
+static unsigned class_depth(int cls)
+{
+	unsigned depth = CLASS_BYTES >> (CLASS_MIN_SHIFT + cls);
+	return (depth < CLASS_DEPTH) ? depth : CLASS_DEPTH;
+}
+
+static void cache_destroy(void *unused)
+{
+	(void)unused;
+	bufpool_flush();
+}
+
+static void cache_key_init(void)
+{
+	(void)pthread_key_create(&cache_key, cache_destroy);
+}
+
+void *bufpool_alloc(size_t size)
+{
+	int cls = size_class(size);
+	if (cls < 0) {
+		ATOMIC_ADD(heap_allocs, 1);
+		return malloc(size);
+	}
+
+	cache_t *cache = &thread_cache;
+	free_buf_t *buf = cache->head[cls];
+	if (buf != NULL) {
+		cache->head[cls] = buf->next;
+		cache->count[cls]--;
+		return buf;
+	}
+
+	ATOMIC_ADD(heap_allocs, 1);
+	return malloc((size_t)BUFPOOL_MIN_SIZE << cls);
+}
+
+void bufpool_free(void *buf, size_t size)
+{
+	if (buf == NULL) {
+		return;
+	}
+
+	// All buffers of the class have at least the class size.
+	int cls = size_class(size);
+	cache_t *cache = &thread_cache;
+	if (cls < 0 || cache->count[cls] >= class_depth(cls)) {
+		ATOMIC_ADD(heap_frees, 1);
+		free(buf);
+		return;
+	}
+
+	// Register the thread for cleanup of the cache on exit.
+	if (!cache->registered) {
+		(void)pthread_once(&cache_key_once, cache_key_init);
+		if (pthread_setspecific(cache_key, cache) != 0) {
+			ATOMIC_ADD(heap_frees, 1);
+			free(buf);
+			return;
+		}
+		cache->registered = true;
+	}
+
+	free_buf_t *fb = buf;
+	fb->next = cache->head[cls];
+	cache->head[cls] = fb;
+	cache->count[cls]++;
+}
+
+void bufpool_flush(void)
+{
+	cache_t *cache = &thread_cache;
+	for (int cls = 0; cls < CLASS_COUNT; cls++) {
+		while (cache->head[cls] != NULL) {
+			free_buf_t *next = cache->head[cls]->next;
+			free(cache->head[cls]);
+			cache->head[cls] = next;
+		}
+		ATOMIC_ADD(heap_frees, cache->count[cls]);
+		cache->count[cls] = 0;
+	}
+}
+
+void bufpool_stats(uint64_t *allocs, uint64_t *frees)
+{
+	*allocs = ATOMIC_GET(heap_allocs);
+	*frees = ATOMIC_GET(heap_frees);
+}
@@ -0,0 +1,65 @@
+/*  Copyright (C) 2024 CZ.NIC, z.s.p.o. <knot-dns@labs.nic.cz>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+/*!
+ * \brief Size-classed pool of heap buffers with per-thread recycling.
+ *
+ * Buffers are plain malloc() allocations rounded up to a power-of-two size
+ * class (BUFPOOL_MIN_SIZE to BUFPOOL_MAX_SIZE). Released buffers are kept in
+ * a bounded cache of the calling thread and reused by later allocations of
+ * the same class, without any locking. As the buffers are ordinary heap
+ * allocations, a pooled buffer may also be released by free().
+ */
+
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#define BUFPOOL_MIN_SIZE	64
+#define BUFPOOL_MAX_SIZE	(128 * 1024)
+
+/*!
+ * \brief Allocate a buffer of at least the given size.
+ *
+ * \param size  Requested size.
+ *
+ * \return Buffer or NULL if out of memory.
+ */
+void *bufpool_alloc(size_t size);
+
+/*!
+ * \brief Return a buffer to the pool of the calling thread.
+ *
+ * \param buf   Buffer allocated by bufpool_alloc() or NULL.
+ * \param size  Requested size of the buffer (may be lower, never higher).
+ */
+void bufpool_free(void *buf, size_t size);
+
+/*!
+ * \brief Release all buffers cached by the calling thread.
+ *
+ * \note This is done automatically when the thread exits.
+ */
+void bufpool_flush(void);
+
+/*!
+ * \brief Get the numbers of buffers allocated from and returned to the heap.
+ *
+ * The difference is the number of buffers either in use or cached, except for
+ * pooled buffers released directly by free().
+ */
+void bufpool_stats(uint64_t *allocs, uint64_t *frees);
@@ -48,6 +48,7 @@ typedef struct {
 
 extern conn_pool_t *global_conn_pool;
 extern conn_pool_t *global_sessticket_pool; // pool for outgoing QUIC connection session tickets
+extern conn_pool_t *global_tls_conn_pool; // pool for established outgoing TLS connections
 
 /*!
  * \brief Allocate connection pool.
@@ -22,6 +22,10 @@
 #include <string.h>
 #include <sys/stat.h>
 #include <unistd.h>
+#ifdef __linux__
+#include <linux/fs.h>
+#include <sys/ioctl.h>
+#endif
 
 #include "contrib/files.h"
 #include "contrib/string.h"
@@ -235,6 +239,13 @@ int copy_file(const char *dest, const char *src)
 		goto done;
 	}
 
+#ifdef FICLONE
+	// Share the data blocks if supported by the filesystem (reflink).
+	if (ioctl(fileno(file), FICLONE, fileno(from)) == 0) {
+		goto copied;
+	}
+#endif
+
 	ssize_t cnt;
 	while ((cnt = fread(buf, sizeof(*buf), BUFSIZE, from)) != 0 &&
 	       (ret = (fwrite(buf, sizeof(*buf), cnt, file) == cnt))) {
@@ -247,6 +258,9 @@ int copy_file(const char *dest, const char *src)
 		goto done;
 	}
 
+#ifdef FICLONE
+copied:
+#endif
 	ret = rename(tmp_name, dest);
 	if (ret != 0) {
 		ret = knot_map_errno();
@@ -82,6 +82,11 @@ static void wrap(jsonw_t *w)
 		return;
 	}
 
+	// Single-line output, terminated with a newline in jsonw_free().
+	if (w->indent[0] == '\0') {
+		return;
+	}
+
 	fputc('\n', w->out);
 	int level = MAX_DEPTH - w->top;
 	for (int i = 0; i < level; i++) {
@@ -153,7 +158,11 @@ void jsonw_free(jsonw_t **w)
 		return;
 	}
 
-	wrap(*w);
+	if ((*w)->indent[0] == '\0' && (*w)->wrap) {
+		fputc('\n', (*w)->out);
+	} else {
+		wrap(*w);
+	}
 
 	free(*w);
 	*w = NULL;
@@ -30,7 +30,7 @@ typedef struct jsonw jsonw_t;
  * Create new JSON writer.
  *
  * @param out     Output file stream.
- * @param indent  Indentation string.
+ * @param indent  Indentation string, empty string for single-line output.
  *
  * @return JSON writer or NULL for allocation error.
  */
@@ -20,11 +20,17 @@
 #include <sys/types.h>   // OpenBSD
 #include <netinet/tcp.h> // TCP_FASTOPEN
 #include <netinet/in.h>
+#include <netinet/udp.h> // UDP_GRO
 #include <poll.h>
 #include <stdbool.h>
 #include <sys/socket.h>
 #include <sys/uio.h>
 #include <unistd.h>
+#ifdef __linux__
+#include <linux/errqueue.h> // SO_EE_ORIGIN_ZEROCOPY
+#include <linux/net_tstamp.h> // struct sock_txtime
+#endif
+#include <time.h>
 
 #include "libknot/errcode.h"
 #include "contrib/macros.h"
@@ -32,6 +38,10 @@
 #include "contrib/sockaddr.h"
 #include "contrib/time.h"
 
+#if defined(SO_ZEROCOPY) && defined(MSG_ZEROCOPY) && defined(SO_EE_ORIGIN_ZEROCOPY)
+#define NET_ZEROCOPY
+#endif
+
 /*!
  * \brief Enable socket option.
  */
@@ -324,6 +334,18 @@ int net_bound_tfo(int sock, int backlog)
 	return KNOT_ENOTSUP;
 }
 
+int net_bound_defer_accept(int sock, int timeout)
+{
+#if defined(TCP_DEFER_ACCEPT)
+	if (setsockopt(sock, IPPROTO_TCP, TCP_DEFER_ACCEPT, &timeout, sizeof(timeout)) != 0) {
+		return knot_map_errno();
+	}
+
+	return KNOT_EOK;
+#endif
+	return KNOT_ENOTSUP;
+}
+
 int net_cmsg_ecn_enable(int sock, int family)
 {
 	switch (family) {
@@ -402,6 +424,81 @@ int net_ecn_set(int sock, int family, uint8_t ecn)
 	return KNOT_EOK;
 }
 
+int net_udp_gro_enable(int sock, bool enable)
+{
+#ifdef UDP_GRO
+	int val = enable ? 1 : 0;
+	if (setsockopt(sock, SOL_UDP, UDP_GRO, &val, sizeof(val)) != 0) {
+		return knot_map_errno();
+	}
+	return KNOT_EOK;
+#else
+	return KNOT_ENOTSUP;
+#endif
+}
+
+int net_rxq_ovfl_enable(int sock)
+{
+#ifdef SO_RXQ_OVFL
+	int val = 1;
+	if (setsockopt(sock, SOL_SOCKET, SO_RXQ_OVFL, &val, sizeof(val)) != 0) {
+		return knot_map_errno();
+	}
+	return KNOT_EOK;
+#else
+	return KNOT_ENOTSUP;
+#endif
+}
+
+int net_txtime_enable(int sock)
+{
+#if defined(SO_TXTIME) && defined(__linux__)
+	struct sock_txtime val = { .clockid = CLOCK_MONOTONIC };
+	if (setsockopt(sock, SOL_SOCKET, SO_TXTIME, &val, sizeof(val)) != 0) {
+		return knot_map_errno();
+	}
+	return KNOT_EOK;
+#else
+	return KNOT_ENOTSUP;
+#endif
+}
+
+int net_busypoll_enable(int sock, unsigned timeout_us, unsigned budget)
+{
+#if defined(SO_PREFER_BUSY_POLL) && defined(SO_BUSY_POLL_BUDGET)
+	int opt_val = 1;
+	if (setsockopt(sock, SOL_SOCKET, SO_PREFER_BUSY_POLL,
+	               &opt_val, sizeof(opt_val)) != 0) {
+		return knot_map_errno();
+	}
+
+	opt_val = timeout_us;
+	if (setsockopt(sock, SOL_SOCKET, SO_BUSY_POLL,
+	               &opt_val, sizeof(opt_val)) != 0) {
+		return knot_map_errno();
+	}
+
+	opt_val = budget;
+	if (setsockopt(sock, SOL_SOCKET, SO_BUSY_POLL_BUDGET,
+	               &opt_val, sizeof(opt_val)) != 0) {
+		return knot_map_errno();
+	}
+
+	return KNOT_EOK;
+#else
+	return KNOT_ENOTSUP;
+#endif
+}
+
+int net_zerocopy_enable(int sock)
+{
+#ifdef NET_ZEROCOPY
+	return sockopt_enable(sock, SOL_SOCKET, SO_ZEROCOPY);
+#else
+	return KNOT_ENOTSUP;
+#endif
+}
+
 bool net_is_connected(int sock)
 {
 	struct sockaddr_storage addr;
@@ -780,6 +877,132 @@ ssize_t net_stream_recv(int sock, uint8_t *buffer, size_t size, int timeout_ms)
 	return net_base_recv(sock, buffer, size, NULL, timeout_ms);
 }
 
+/* -- zero-copy stream I/O ------------------------------------------------- */
+
+ssize_t net_zerocopy_send(int sock, const uint8_t *buffer, size_t size,
+                          int timeout_ms, uint32_t *zc_count)
+{
+	if (sock < 0 || buffer == NULL || zc_count == NULL) {
+		return KNOT_EINVAL;
+	}
+
+#ifdef NET_ZEROCOPY
+	struct iovec iov = {
+		.iov_base = (void *)buffer,
+		.iov_len = size
+	};
+	struct msghdr msg = {
+		.msg_iov = &iov,
+		.msg_iovlen = 1
+	};
+
+	int *timeout_ptr = &timeout_ms;
+	int flags = MSG_ZEROCOPY | MSG_NOSIGNAL;
+	size_t done = 0;
+	while (done < size) {
+		ssize_t ret = sendmsg(sock, &msg, flags);
+		if (ret > 0) {
+			if (flags & MSG_ZEROCOPY) {
+				*zc_count += 1;
+			}
+			done += ret;
+			msg_iov_shift(&msg, ret);
+			continue;
+		} else if (ret == -1 && errno == EINTR) {
+			continue;
+		} else if (ret == -1 && errno == ENOBUFS && (flags & MSG_ZEROCOPY)) {
+			/* Locked memory limit reached, copy the rest. */
+			flags &= ~MSG_ZEROCOPY;
+			continue;
+		} else if (ret == -1 && io_should_wait(errno)) {
+			TIMEOUT_CTX_INIT
+
+			ret = poll_one(sock, POLLOUT, *timeout_ptr);
+			if (ret == 0) {
+				return KNOT_ETIMEOUT;
+			} else if (ret == -1 && !wait_should_retry(errno)) {
+				return KNOT_ECONN;
+			}
+
+			TIMEOUT_CTX_UPDATE
+			continue;
+		}
+
+		return KNOT_ECONN;
+	}
+
+	return done;
+#else
+	return net_stream_send(sock, buffer, size, timeout_ms);
+#endif
+}
+
+int net_zerocopy_wait(int sock, uint32_t *zc_done, uint32_t zc_count, int timeout_ms)
+{
+	if (sock < 0 || zc_done == NULL) {
+		return KNOT_EINVAL;
+	}
+
+#ifdef NET_ZEROCOPY
+	int *timeout_ptr = &timeout_ms;
+	bool polled = false;
+	while ((int32_t)(zc_count - *zc_done) > 0) {
+		uint8_t control[CMSG_SPACE(sizeof(struct sock_extended_err) +
+		                           sizeof(struct sockaddr_storage))];
+		struct msghdr msg = {
+			.msg_control = control,
+			.msg_controllen = sizeof(control)
+		};
+
+		int ret = recvmsg(sock, &msg, MSG_ERRQUEUE | MSG_DONTWAIT);
+		if (ret == -1 && errno == EINTR) {
+			continue;
+		} else if (ret == -1 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+			if (polled) {
+				/* Socket error without pending notifications. */
+				return KNOT_ECONN;
+			}
+
+			TIMEOUT_CTX_INIT
+
+			/* Error queue readiness is signalled as POLLERR. */
+			ret = poll_one(sock, 0, *timeout_ptr);
+			if (ret == 0) {
+				return KNOT_ETIMEOUT;
+			} else if (ret == -1 && !wait_should_retry(errno)) {
+				return KNOT_ECONN;
+			}
+			polled = (ret == 1);
+
+			TIMEOUT_CTX_UPDATE
+			continue;
+		} else if (ret == -1) {
+			return knot_map_errno();
+		}
+		polled = false;
+
+		for (struct cmsghdr *cmsg = CMSG_FIRSTHDR(&msg); cmsg != NULL;
+		     cmsg = CMSG_NXTHDR(&msg, cmsg)) {
+			if ((cmsg->cmsg_level != SOL_IP || cmsg->cmsg_type != IP_RECVERR) &&
+			    (cmsg->cmsg_level != SOL_IPV6 || cmsg->cmsg_type != IPV6_RECVERR)) {
+				continue;
+			}
+			struct sock_extended_err *err = (struct sock_extended_err *)CMSG_DATA(cmsg);
+			if (err->ee_origin != SO_EE_ORIGIN_ZEROCOPY) {
+				return KNOT_ECONN;
+			}
+			/* Notifications cover ranges [ee_info, ee_data] of operations. */
+			*zc_done += err->ee_data - err->ee_info + 1;
+		}
+	}
+
+	return KNOT_EOK;
+#else
+	*zc_done = zc_count;
+	return KNOT_EOK;
+#endif
+}
+
 /* -- DNS specific I/O ----------------------------------------------------- */
 
 ssize_t net_dns_tcp_send(int sock, const uint8_t *buffer, size_t size, int timeout_ms,
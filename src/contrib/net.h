@@ -83,6 +83,16 @@ int net_connected_socket(int type, const struct sockaddr_storage *dst_addr,
  */
 int net_bound_tfo(int sock, int backlog);
 
+/*!
+ * \brief Don't accept connections until the first data arrive (TCP_DEFER_ACCEPT).
+ *
+ * \param sock     Listening socket.
+ * \param timeout  Maximum time to wait for the data in seconds.
+ *
+ * \return KNOT_EOK, KNOT_ENOTSUP, or error code
+ */
+int net_bound_defer_accept(int sock, int timeout);
+
 /*!
  * \brief Tell kernel to send ECN bits thru CMSG on packet receival.
  *
@@ -124,6 +134,63 @@ uint8_t net_cmsg_ecn(struct msghdr *msg);
  */
 int net_ecn_set(int sock, int family, uint8_t ecn);
 
+/*!
+ * \brief Enable or disable UDP generic receive offload (GRO) on the socket.
+ *
+ * \note Received datagrams can be coalesced, the segment size is passed
+ *       in UDP_GRO control message.
+ *
+ * \param sock    UDP socket.
+ * \param enable  Enable or disable the offload.
+ *
+ * \return KNOT_E*
+ */
+int net_udp_gro_enable(int sock, bool enable);
+
+/*!
+ * \brief Enable reporting of the socket receive queue drops (SO_RXQ_OVFL).
+ *
+ * \note The cumulative number of datagrams dropped by the socket is passed
+ *       in SO_RXQ_OVFL control message, if non-zero.
+ *
+ * \param sock  UDP socket.
+ *
+ * \return KNOT_E*
+ */
+int net_rxq_ovfl_enable(int sock);
+
+/*!
+ * \brief Enable setting of transmit time (SO_TXTIME) of sent datagrams.
+ *
+ * \note The time is passed in SCM_TXTIME control message as CLOCK_MONOTONIC
+ *       nanoseconds. It's respected by the fq qdisc, otherwise ignored.
+ *
+ * \param sock  UDP socket.
+ *
+ * \return KNOT_E*, KNOT_ENOTSUP if not supported on the system.
+ */
+int net_txtime_enable(int sock);
+
+/*!
+ * \brief Enable preferred busy polling (SO_BUSY_POLL) on the socket.
+ *
+ * \param sock        Socket.
+ * \param timeout_us  Busy polling timeout in microseconds.
+ * \param budget      Maximum number of packets processed by one busy poll.
+ *
+ * \return KNOT_E*, KNOT_ENOTSUP if not supported on the system.
+ */
+int net_busypoll_enable(int sock, unsigned timeout_us, unsigned budget);
+
+/*!
+ * \brief Enable zero-copy sending (SO_ZEROCOPY) on the socket.
+ *
+ * \param sock  TCP socket.
+ *
+ * \return KNOT_E*, KNOT_ENOTSUP if not supported on the system.
+ */
+int net_zerocopy_enable(int sock);
+
 /*!
  * \brief Return true if the socket is fully connected.
  *
@@ -238,6 +305,34 @@ ssize_t net_stream_send(int sock, const uint8_t *buffer, size_t size, int timeou
  */
 ssize_t net_stream_recv(int sock, uint8_t *buffer, size_t size, int timeout_ms);
 
+/*!
+ * \brief Send data on a SOCK_STREAM socket with MSG_ZEROCOPY.
+ *
+ * The buffer must not be modified until the kernel releases it, see
+ * \a net_zerocopy_wait(). If the kernel runs out of resources for pinning
+ * the buffer, the rest of the data is copied as usual.
+ *
+ * \param[out] zc_count  Incremented for each zero-copy send operation.
+ *
+ * \see net_base_send
+ */
+ssize_t net_zerocopy_send(int sock, const uint8_t *buffer, size_t size,
+                          int timeout_ms, uint32_t *zc_count);
+
+/*!
+ * \brief Wait for completion of zero-copy send operations.
+ *
+ * Reads completion notifications from the socket error queue.
+ *
+ * \param sock        TCP socket.
+ * \param zc_done     Number of completed operations (updated).
+ * \param zc_count    Number of operations to wait for.
+ * \param timeout_ms  Timeout in milliseconds.
+ *
+ * \return KNOT_EOK, KNOT_ETIMEOUT, KNOT_ECONN, or another KNOT_E*.
+ */
+int net_zerocopy_wait(int sock, uint32_t *zc_done, uint32_t zc_count, int timeout_ms);
+
 /*!
  * \brief Send a DNS message on a TCP socket.
  *
@@ -20,6 +20,7 @@
 
 #include <assert.h>
 #include <limits.h>
+#include <pthread.h>
 #include <stdlib.h>
 #include <string.h>
 
@@ -426,6 +427,93 @@ trie_t* trie_dup(const trie_t *orig, trie_dup_cb dup_cb, knot_mm_t *mm)
 	return copy;
 }
 
+/*! \brief Count nodes in all the twig arrays below the node. */
+static size_t count_twigs(node_t *t)
+{
+	if (!isbranch(t))
+		return 0;
+	uint n = branch_weight(t);
+	size_t count = n;
+	for (uint i = 0; i < n; ++i)
+		count += count_twigs(twig(t, i));
+	return count;
+}
+
+/*! \brief Replace the leaf key with its copy. */
+static bool pack_leaf(node_t *t, knot_mm_t *mm)
+{
+	const tkey_t *lkey = tkey(t);
+	trie_val_t val = *tvalp(t);
+	if (mkleaf(t, lkey->chars, lkey->len, mm) != KNOT_EOK)
+		return false;
+	*tvalp(t) = val;
+	return true;
+}
+
+trie_t* trie_pack(const trie_t *orig, knot_mm_t *mm)
+{
+	if (orig == NULL) {
+		return NULL;
+	}
+	trie_t *copy = mm_alloc(mm, sizeof(*copy));
+	if (copy == NULL) {
+		return NULL;
+	}
+	copy->weight = orig->weight;
+	if (mm != NULL) {
+		copy->mm = *mm;
+	} else {
+		mm_ctx_init(&copy->mm);
+	}
+	copy->root = orig->root;
+	if (!copy->weight) {
+		return copy;
+	}
+	copy->root.i &= ~TFLAG_COW;
+	if (!isbranch(&copy->root)) {
+		if (!pack_leaf(&copy->root, mm)) {
+			mm_free(mm, copy);
+			return NULL;
+		}
+		return copy;
+	}
+
+	size_t total = count_twigs(&copy->root);
+	node_t *block = mm_alloc(mm, total * sizeof(node_t));
+	if (block == NULL) {
+		mm_free(mm, copy);
+		return NULL;
+	}
+
+	// The block itself is the queue of the breadth-first traversal: each
+	// branch taken from it gets its twigs appended to the end.
+	size_t end = branch_weight(&copy->root);
+	memcpy(block, twigs(&copy->root), end * sizeof(node_t));
+	copy->root.p = block;
+	for (size_t pos = 0; pos < total; ++pos) {
+		node_t *t = &block[pos];
+		t->i &= ~TFLAG_COW;
+		if (isbranch(t)) {
+			uint n = branch_weight(t);
+			memcpy(block + end, twigs(t), n * sizeof(node_t));
+			t->p = block + end;
+			end += n;
+		} else if (!pack_leaf(t, mm)) {
+			// Free the keys copied so far, the rest still points to the original.
+			for (size_t i = 0; i < pos; ++i) {
+				if (!isbranch(&block[i]))
+					mm_free(mm, tkey(&block[i]));
+			}
+			mm_free(mm, block);
+			mm_free(mm, copy);
+			return NULL;
+		}
+	}
+	assert(end == total);
+
+	return copy;
+}
+
 size_t trie_weight(const trie_t *tbl)
 {
 	assert(tbl);
@@ -451,6 +539,53 @@ trie_val_t* trie_get_try(trie_t *tbl, const trie_key_t *key, uint32_t len)
 	return tvalp(t);
 }
 
+/*! \brief Number of lookups interleaved by trie_get_try_many(). */
+#define TRIE_BATCH 8
+
+void trie_get_try_many(trie_t *tbl, const trie_key_t *keys[], const uint32_t lens[],
+                       trie_val_t *vals[], size_t count)
+{
+	assert(tbl);
+	for (size_t base = 0; base < count; base += TRIE_BATCH) {
+		const size_t n = MIN(count - base, TRIE_BATCH);
+		node_t *cur[TRIE_BATCH];
+		for (size_t j = 0; j < n; ++j) {
+			vals[base + j] = NULL;
+			cur[j] = tbl->weight ? &tbl->root : NULL;
+		}
+
+		// Advance each lookup by one level in turn, so that the memory
+		// prefetched for one of them arrives while the others are served.
+		bool active = tbl->weight > 0;
+		while (active) {
+			active = false;
+			for (size_t j = 0; j < n; ++j) {
+				node_t *t = cur[j];
+				if (t == NULL)
+					continue;
+				const trie_key_t *key = keys[base + j];
+				uint32_t len = lens[base + j];
+				if (isbranch(t)) {
+					bitmap_t b = twigbit(t, key, len);
+					if (!hastwig(t, b)) {
+						cur[j] = NULL;
+						continue;
+					}
+					t = twig(t, twigoff(t, b));
+					__builtin_prefetch(isbranch(t) ? (void *)twigs(t) : (void *)tkey(t));
+					cur[j] = t;
+					active = true;
+				} else {
+					tkey_t *lkey = tkey(t);
+					if (key_cmp(key, len, lkey->chars, lkey->len) == 0)
+						vals[base + j] = tvalp(t);
+					cur[j] = NULL;
+				}
+			}
+		}
+	}
+}
+
 /* Optimization: the approach isn't ideal, as e.g. walking through the prefix
  * is duplicated and we explicitly construct the wildcard key.  Still, it's close
  * to optimum which would be significantly more complicated and error-prone to write. */
@@ -490,6 +625,40 @@ trie_val_t* trie_get_try_wildcard(trie_t *tbl, const trie_key_t *key, uint32_t l
 	return trie_get_try(tbl, wild_key, wild_len);
 }
 
+trie_val_t* trie_get_prefix(trie_t *tbl, const trie_key_t *key, uint32_t len)
+{
+	assert(tbl);
+	if (!tbl->weight)
+		return NULL;
+	trie_val_t *best = NULL;
+	uint32_t checked = 0; // Length of the key prefix verified so far.
+	node_t *t = &tbl->root;
+	while (isbranch(t)) {
+		__builtin_prefetch(twigs(t));
+		// A key terminating at this branch is a prefix candidate.  All keys
+		// in this subtree share its bytes, so if it doesn't match, no deeper
+		// candidate can match either.
+		if (hastwig(t, BMP_NOBYTE)) {
+			const tkey_t *ckey = tkey(twig(t, 0));
+			assert(ckey->len >= checked);
+			if (ckey->len > len || memcmp(key + checked, ckey->chars + checked,
+			                              ckey->len - checked) != 0)
+				return best;
+			best = tvalp(twig(t, 0));
+			checked = ckey->len;
+		}
+		bitmap_t b = twigbit(t, key, len);
+		if (!hastwig(t, b))
+			return best;
+		t = twig(t, twigoff(t, b));
+	}
+	const tkey_t *lkey = tkey(t);
+	if (lkey->len < checked || lkey->len > len ||
+	    memcmp(key + checked, lkey->chars + checked, lkey->len - checked) != 0)
+		return best;
+	return tvalp(t);
+}
+
 /*! \brief Delete leaf t with parent p; b is the bit for t under p.
  * Optionally return the deleted value via val.  The function can't fail. */
 static void del_found(trie_t *tbl, node_t *t, node_t *p, bitmap_t b, trie_val_t *val)
@@ -1033,6 +1202,176 @@ trie_it_t* trie_it_begin(trie_t *tbl)
 	return it;
 }
 
+/*! \brief Number of subtries per range to expand the trie to when splitting. */
+#define SPLIT_FACTOR 8
+
+/*! \brief Minimal number of leaves per thread for parallel freeing. */
+#define TRIE_FREE_MIN_PER_THREAD 65536
+
+/*!
+ * \brief Expand the trie level by level until there are enough subtries.
+ *
+ * Leaves above the final level are carried down, so the subtries in the
+ * output cover the whole (non-empty) trie in order.
+ *
+ * \param tbl     Trie.
+ * \param want    Minimal number of subtries wanted.
+ * \param level   Out: allocated array of the subtries.
+ * \param n       Out: number of the subtries.
+ * \param depth   Out: number of expanded levels.
+ *
+ * \return KNOT_EOK or KNOT_ENOMEM.
+ */
+static int expand_levels(trie_t *tbl, size_t want, node_t ***level, size_t *n, uint *depth)
+{
+	*n = 1;
+	*depth = 0;
+	*level = malloc(sizeof(node_t *));
+	if (!*level)
+		return KNOT_ENOMEM;
+	(*level)[0] = &tbl->root;
+	bool expandable = isbranch(&tbl->root);
+	while (expandable && *n < want) {
+		size_t next_n = 0;
+		for (size_t i = 0; i < *n; ++i)
+			next_n += isbranch((*level)[i]) ? branch_weight((*level)[i]) : 1;
+		node_t **next = malloc(next_n * sizeof(node_t *));
+		if (!next) {
+			free(*level);
+			*level = NULL;
+			return KNOT_ENOMEM;
+		}
+		expandable = false;
+		size_t pos = 0;
+		for (size_t i = 0; i < *n; ++i) {
+			if (!isbranch((*level)[i])) {
+				next[pos++] = (*level)[i];
+				continue;
+			}
+			uint cc = branch_weight((*level)[i]);
+			for (uint j = 0; j < cc; ++j) {
+				next[pos] = twig((*level)[i], j);
+				expandable |= isbranch(next[pos++]);
+			}
+		}
+		free(*level);
+		*level = next;
+		*n = next_n;
+		(*depth)++;
+	}
+	return KNOT_EOK;
+}
+
+typedef struct {
+	pthread_t thread;
+	int thread_init_errcode;
+	node_t **subtries;
+	size_t count;
+	knot_mm_t *mm;
+} clear_args_t;
+
+static void *clear_thread(void *arg)
+{
+	clear_args_t *args = arg;
+	for (size_t i = 0; i < args->count; ++i)
+		clear_trie(args->subtries[i], args->mm);
+	return NULL;
+}
+
+/*! \brief Free the twigs above the given depth, the deeper ones are already freed. */
+static void clear_top(node_t *trie, uint depth, knot_mm_t *mm)
+{
+	if (depth == 0 || !isbranch(trie))
+		return;
+	uint n = branch_weight(trie);
+	for (uint i = 0; i < n; ++i)
+		clear_top(twig(trie, i), depth - 1, mm);
+	mm_free(mm, twigs(trie));
+}
+
+void trie_free_parallel(trie_t *tbl, unsigned threads)
+{
+	if (tbl == NULL)
+		return;
+
+	// Only the default (thread-safe) allocator and big enough tries.
+	node_t **level = NULL;
+	size_t n = 0;
+	uint depth = 0;
+	if (threads <= 1 || tbl->mm.ctx != NULL || tbl->mm.free != free ||
+	    tbl->weight < threads * TRIE_FREE_MIN_PER_THREAD ||
+	    expand_levels(tbl, threads * SPLIT_FACTOR, &level, &n, &depth) != KNOT_EOK) {
+		trie_free(tbl);
+		return;
+	}
+
+	threads = MIN(threads, n);
+	clear_args_t args[threads];
+	for (size_t i = 0; i < threads; ++i) {
+		args[i].subtries = level + i * n / threads;
+		args[i].count = (i + 1) * n / threads - i * n / threads;
+		args[i].mm = &tbl->mm;
+		args[i].thread_init_errcode =
+			pthread_create(&args[i].thread, NULL, clear_thread, &args[i]);
+	}
+	for (size_t i = 0; i < threads; ++i) {
+		if (args[i].thread_init_errcode == 0) {
+			(void)pthread_join(args[i].thread, NULL);
+		} else {
+			clear_thread(&args[i]);
+		}
+	}
+	free(level);
+
+	clear_top(&tbl->root, depth, &tbl->mm);
+	mm_free(&tbl->mm, tbl);
+}
+
+int trie_it_split(trie_t *tbl, trie_it_t **its, size_t *count)
+{
+	assert(tbl && its && count);
+	size_t want = *count;
+	*count = 0;
+	if (tbl->weight == 0 || want == 0)
+		return KNOT_EOK;
+
+	size_t n;
+	uint depth;
+	node_t **level;
+	if (expand_levels(tbl, want * SPLIT_FACTOR, &level, &n, &depth) != KNOT_EOK)
+		return KNOT_ENOMEM;
+
+	// Position the iterators to the first leaves of the range subtries.
+	size_t parts = MIN(want, n);
+	int ret = KNOT_EOK;
+	for (size_t i = 0; i < parts; ++i) {
+		node_t *t = level[i * n / parts];
+		while (isbranch(t))
+			t = twig(t, 0);
+		tkey_t *key = tkey(t);
+
+		its[i] = malloc(sizeof(nstack_t));
+		if (!its[i]) {
+			ret = KNOT_ENOMEM;
+			break;
+		}
+		ns_init(its[i], tbl);
+		*count = i + 1;
+		if (trie_it_get_leq(its[i], key->chars, key->len) != KNOT_EOK) {
+			ret = KNOT_ENOMEM;
+			break;
+		}
+	}
+	free(level);
+
+	if (ret != KNOT_EOK) {
+		for (size_t i = 0; i < *count; ++i)
+			trie_it_free(its[i]);
+		*count = 0;
+	}
+	return ret;
+}
+
 bool trie_it_finished(trie_it_t *it)
 {
 	assert(it);
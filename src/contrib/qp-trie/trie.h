@@ -65,18 +65,45 @@ trie_t* trie_create(knot_mm_t *mm);
 /*! \brief Free a trie instance. */
 void trie_free(trie_t *tbl);
 
+/*!
+ * \brief Free a trie instance, freeing its subtries by multiple threads.
+ *
+ * Falls back to trie_free() for small tries and custom memory contexts.
+ */
+void trie_free_parallel(trie_t *tbl, unsigned threads);
+
 /*! \brief Clear a trie instance (make it empty). */
 void trie_clear(trie_t *tbl);
 
 /*! \brief Create a clone of existing trie. */
 trie_t* trie_dup(const trie_t *orig, trie_dup_cb dup_cb, knot_mm_t *mm);
 
+/*!
+ * \brief Create a copy of existing trie with all branch nodes in one block.
+ *
+ * The twig arrays are laid out breadth-first, so the top levels visited by
+ * every lookup share a few cache lines. The values are copied as they are.
+ *
+ * \note The twigs can't be freed individually, so the copy may be modified
+ *       only if the memory context doesn't free (e.g. a mempool).
+ */
+trie_t* trie_pack(const trie_t *orig, knot_mm_t *mm);
+
 /*! \brief Return the number of keys in the trie. */
 size_t trie_weight(const trie_t *tbl);
 
 /*! \brief Search the trie, returning NULL on failure. */
 trie_val_t* trie_get_try(trie_t *tbl, const trie_key_t *key, uint32_t len);
 
+/*!
+ * \brief Search the trie for several keys at once, storing NULL on failure.
+ *
+ * The lookups are interleaved level by level, with the next node of each
+ * being prefetched, so that the cache misses of the lookups overlap.
+ */
+void trie_get_try_many(trie_t *tbl, const trie_key_t *keys[], const uint32_t lens[],
+                       trie_val_t *vals[], size_t count);
+
 /*! \brief Search the trie including DNS wildcard semantics, returning NULL on failure.
  *
  * \note We assume the key is in knot_dname_lf() format, i.e. labels are ordered
@@ -85,6 +112,16 @@ trie_val_t* trie_get_try(trie_t *tbl, const trie_key_t *key, uint32_t len);
  */
 trie_val_t* trie_get_try_wildcard(trie_t *tbl, const trie_key_t *key, uint32_t len);
 
+/*!
+ * \brief Search the trie for the longest key which is a prefix of the given key.
+ *
+ * The lookup is done in a single descent, comparing each key byte at most once.
+ *
+ * \note For keys in knot_dname_lf() format, this finds the closest enclosing
+ *   name, as each label is terminated by a zero byte.
+ */
+trie_val_t* trie_get_prefix(trie_t *tbl, const trie_key_t *key, uint32_t len);
+
 /*! \brief Search the trie, inserting NULL trie_val_t on failure. */
 trie_val_t* trie_get_ins(trie_t *tbl, const trie_key_t *key, uint32_t len);
 
@@ -181,6 +218,22 @@ void trie_it_parent(trie_it_t *it);
 /*! \brief trie_get_leq() but with an iterator. */
 int trie_it_get_leq(trie_it_t *it, const trie_key_t *key, uint32_t len);
 
+/*!
+ * \brief Split the trie into contiguous ranges of roughly equal size.
+ *
+ * The trie is expanded from the root until there are enough subtries, which
+ * are distributed evenly into the ranges. Only the upper levels of the trie
+ * are visited, so the range sizes are just estimated.
+ *
+ * \param tbl    Trie.
+ * \param its    Out: iterators pointing to the first element of each range,
+ *               a range ends before the first element of the following one.
+ * \param count  In: maximal number of ranges, out: number of ranges created.
+ *
+ * \return KNOT_EOK or KNOT_ENOMEM.
+ */
+int trie_it_split(trie_t *tbl, trie_it_t **its, size_t *count);
+
 /*! \brief Remove the current element.  The iterator will get trie_it_finished() */
 void trie_it_del(trie_it_t *it);
 
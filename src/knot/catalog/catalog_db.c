@@ -20,11 +20,28 @@
 #include <urcu.h>
 
 #include "contrib/files.h"
+#include "contrib/macros.h"
+#include "contrib/ucw/lists.h"
 #include "knot/catalog/catalog_db.h"
 #include "knot/common/log.h"
 
 static const MDB_val catalog_iter_prefix = { 1, "" };
 
+// Member record in the in-memory index, keyed by the member name.
+typedef struct {
+	bool fresh;     // Inserted by the pending index update.
+	bool dead;      // Fresh, but removed again by the same update.
+	size_t size;
+	uint8_t data[]; // Record value as stored in LMDB.
+} catalog_member_t;
+
+// Copy-on-write update of the members index alongside the RW txn.
+struct catalog_members_upd {
+	trie_cow_t *cow;
+	list_t added;    // Fresh members, not reachable from the published index.
+	list_t replaced; // Members removed from the published index.
+};
+
 size_t catalog_dname_append(knot_dname_storage_t storage, const knot_dname_t *name)
 {
 	size_t old_len = knot_dname_size(storage);
@@ -54,6 +71,192 @@ void catalog_init(catalog_t *cat, const char *path, size_t mapsize)
 	knot_lmdb_init(&cat->db, path, mapsize, MDB_NOTLS, NULL);
 }
 
+static catalog_member_t *member_new(const MDB_val *val)
+{
+	catalog_member_t *member = malloc(sizeof(*member) + val->mv_size);
+	if (member != NULL) {
+		member->fresh = false;
+		member->dead = false;
+		member->size = val->mv_size;
+		memcpy(member->data, val->mv_data, val->mv_size);
+	}
+	return member;
+}
+
+static int member_free_cb(trie_val_t *val, _unused_ void *ctx)
+{
+	free(*val);
+	return KNOT_EOK;
+}
+
+static void members_free(trie_t *members)
+{
+	if (members != NULL) {
+		(void)trie_apply(members, member_free_cb, NULL);
+		trie_free(members);
+	}
+}
+
+static int members_load_cb(MDB_val *key, MDB_val *val, void *ctx)
+{
+	trie_t *members = ctx;
+	catalog_member_t *member = member_new(val);
+	if (member == NULL) {
+		return KNOT_ENOMEM;
+	}
+	trie_val_t *tval = trie_get_ins(members, (uint8_t *)key->mv_data + 1,
+	                                key->mv_size - 1);
+	if (tval == NULL) {
+		free(member);
+		return KNOT_ENOMEM;
+	}
+	*tval = member;
+	return KNOT_EOK;
+}
+
+static trie_t *members_load(knot_lmdb_txn_t *txn)
+{
+	trie_t *members = trie_create(NULL);
+	if (members == NULL) {
+		return NULL;
+	}
+	int ret = knot_lmdb_apply_threadsafe(txn, &catalog_iter_prefix, true,
+	                                     members_load_cb, members);
+	if (ret != KNOT_EOK) {
+		members_free(members);
+		return NULL;
+	}
+	return members;
+}
+
+static catalog_member_t *members_find(trie_t *members, const knot_dname_t *member)
+{
+	trie_val_t *val = trie_get_try(members, member, knot_dname_size(member));
+	return (val == NULL) ? NULL : *val;
+}
+
+static struct catalog_members_upd *members_upd_begin(trie_t *members)
+{
+	struct catalog_members_upd *upd = calloc(1, sizeof(*upd));
+	if (upd == NULL) {
+		return NULL;
+	}
+	upd->cow = trie_cow(members, NULL, NULL);
+	if (upd->cow == NULL) {
+		free(upd);
+		return NULL;
+	}
+	init_list(&upd->added);
+	init_list(&upd->replaced);
+	return upd;
+}
+
+static void members_upd_rollback(struct catalog_members_upd *upd)
+{
+	if (upd != NULL) {
+		(void)trie_cow_rollback(upd->cow, NULL, NULL);
+		ptrlist_deep_free(&upd->added, NULL);
+		ptrlist_free(&upd->replaced, NULL);
+		free(upd);
+	}
+}
+
+// Returns the updated index to be published.
+static trie_t *members_upd_finish(struct catalog_members_upd *upd)
+{
+	ptrnode_t *n;
+	WALK_LIST(n, upd->added) {
+		catalog_member_t *member = n->d;
+		if (member->dead) {
+			free(member);
+		} else {
+			member->fresh = false;
+		}
+	}
+	ptrlist_free(&upd->added, NULL);
+	return trie_cow_new(upd->cow);
+}
+
+// Must be called after the grace period following the publication.
+static void members_upd_cleanup(struct catalog_members_upd *upd)
+{
+	if (upd != NULL) {
+		(void)trie_cow_commit(upd->cow, NULL, NULL);
+		ptrlist_deep_free(&upd->replaced, NULL);
+		free(upd);
+	}
+}
+
+static int members_upd_remove(struct catalog_members_upd *upd, catalog_member_t *old)
+{
+	if (old->fresh) {
+		old->dead = true;
+		return KNOT_EOK;
+	}
+	return ptrlist_add(&upd->replaced, old, NULL) != NULL ? KNOT_EOK : KNOT_ENOMEM;
+}
+
+static int members_upd_add(struct catalog_members_upd *upd, const knot_dname_t *member,
+                           const MDB_val *val)
+{
+	catalog_member_t *new = member_new(val);
+	if (new == NULL) {
+		return KNOT_ENOMEM;
+	}
+	new->fresh = true;
+	if (ptrlist_add(&upd->added, new, NULL) == NULL) {
+		free(new);
+		return KNOT_ENOMEM;
+	}
+
+	trie_val_t *tval = trie_get_cow(upd->cow, member, knot_dname_size(member));
+	if (tval == NULL) {
+		return KNOT_ENOMEM;
+	}
+	catalog_member_t *old = *tval;
+	*tval = new;
+	return (old == NULL) ? KNOT_EOK : members_upd_remove(upd, old);
+}
+
+static int members_upd_del(struct catalog_members_upd *upd, const knot_dname_t *member)
+{
+	trie_val_t old = NULL;
+	if (trie_del_cow(upd->cow, member, knot_dname_size(member), &old) != KNOT_EOK) {
+		return KNOT_EOK;
+	}
+	return members_upd_remove(upd, old);
+}
+
+static bool last_txnid(catalog_t *cat, size_t *txnid)
+{
+	MDB_envinfo info;
+	if (mdb_env_info(cat->db.env, &info) != MDB_SUCCESS) {
+		return false;
+	}
+	*txnid = info.me_last_txnid;
+	return true;
+}
+
+/*!
+ * \brief Start a new RO txn, optionally loading the members index from it.
+ *
+ * The txn ID is obtained before the RO txn starts, so if another commit
+ * happens meanwhile, the index is considered outdated by the next RW txn.
+ */
+static knot_lmdb_txn_t *ro_txn_begin(catalog_t *cat, trie_t **members)
+{
+	knot_lmdb_txn_t *ro_txn = calloc(1, sizeof(*ro_txn));
+	if (ro_txn == NULL) {
+		return NULL;
+	}
+	bool txnid_ok = last_txnid(cat, &cat->members_txnid);
+	knot_lmdb_begin(&cat->db, ro_txn, false);
+	if (members != NULL) {
+		*members = (txnid_ok && ro_txn->ret == KNOT_EOK) ? members_load(ro_txn) : NULL;
+	}
+	return ro_txn;
+}
+
 static void ensure_cat_version(knot_lmdb_txn_t *ro_txn, knot_lmdb_txn_t *rw_txn)
 {
 	MDB_val key = { 8, "\x01version" };
@@ -85,11 +288,13 @@ int catalog_open(catalog_t *cat)
 		}
 	}
 	if (cat->ro_txn == NULL) {
-		knot_lmdb_txn_t *ro_txn = calloc(1, sizeof(*ro_txn));
+		trie_t *members = NULL;
+		knot_lmdb_txn_t *ro_txn = ro_txn_begin(cat, &members);
 		if (ro_txn == NULL) {
 			return KNOT_ENOMEM;
 		}
-		knot_lmdb_begin(&cat->db, ro_txn, false);
+		assert(cat->members == NULL);
+		rcu_assign_pointer(cat->members, members);
 		cat->ro_txn = ro_txn;
 	}
 	check_cat_version(cat);
@@ -102,6 +307,11 @@ int catalog_begin(catalog_t *cat)
 	if (ret != KNOT_EOK) {
 		return ret;
 	}
+	if (cat->old_ro_txn != NULL || cat->old_members != NULL || cat->old_members_upd != NULL) {
+		// The index can't be updated before the previous commit is cleaned up.
+		synchronize_rcu();
+		catalog_commit_cleanup(cat);
+	}
 	knot_lmdb_txn_t *rw_txn = calloc(1, sizeof(*rw_txn));
 	if (rw_txn == NULL) {
 		return KNOT_ENOMEM;
@@ -115,6 +325,15 @@ int catalog_begin(catalog_t *cat)
 	assert(cat->rw_txn == NULL); // LMDB prevents two existing RW txns at a time
 	cat->rw_txn = rw_txn;
 	check_cat_version(cat);
+
+	// Update the index incrementally only if it reflects the last DB state,
+	// otherwise (e.g. after a restore from backup) it's reloaded on commit.
+	size_t txnid;
+	if (cat->rw_txn->ret == KNOT_EOK && cat->members != NULL &&
+	    last_txnid(cat, &txnid) && txnid == cat->members_txnid) {
+		cat->members_upd = members_upd_begin(cat->members);
+	}
+
 	return cat->rw_txn->ret;
 }
 
@@ -124,16 +343,28 @@ int catalog_commit(catalog_t *cat)
 	knot_lmdb_commit(rw_txn);
 	int ret = rw_txn->ret;
 	free(rw_txn);
+	struct catalog_members_upd *upd = cat->members_upd;
+	cat->members_upd = NULL;
 	if (ret != KNOT_EOK) {
+		members_upd_rollback(upd);
 		return ret;
 	}
 
-	// now refresh RO txn
-	knot_lmdb_txn_t *ro_txn = calloc(1, sizeof(*ro_txn));
+	// now refresh RO txn and the members index, reload it if not updated
+	trie_t *members = NULL;
+	knot_lmdb_txn_t *ro_txn = ro_txn_begin(cat, (upd == NULL) ? &members : NULL);
 	if (ro_txn == NULL) {
+		members_upd_rollback(upd);
 		return KNOT_ENOMEM;
 	}
-	knot_lmdb_begin(&cat->db, ro_txn, false);
+	if (upd != NULL) {
+		members = members_upd_finish(upd);
+		cat->old_members_upd = upd;
+		(void)rcu_xchg_pointer(&cat->members, members);
+	} else {
+		assert(cat->old_members == NULL);
+		cat->old_members = rcu_xchg_pointer(&cat->members, members);
+	}
 	cat->old_ro_txn = rcu_xchg_pointer(&cat->ro_txn, ro_txn);
 
 	return KNOT_EOK;
@@ -146,6 +377,8 @@ void catalog_abort(catalog_t *cat)
 		knot_lmdb_abort(rw_txn);
 		free(rw_txn);
 	}
+	members_upd_rollback(cat->members_upd);
+	cat->members_upd = NULL;
 }
 
 void catalog_commit_cleanup(catalog_t *cat)
@@ -155,6 +388,9 @@ void catalog_commit_cleanup(catalog_t *cat)
 		knot_lmdb_abort(old_ro_txn);
 		free(old_ro_txn);
 	}
+
+	members_free(rcu_xchg_pointer(&cat->old_members, NULL));
+	members_upd_cleanup(rcu_xchg_pointer(&cat->old_members_upd, NULL));
 }
 
 void catalog_deinit(catalog_t *cat)
@@ -168,6 +404,9 @@ void catalog_deinit(catalog_t *cat)
 		knot_lmdb_abort(cat->old_ro_txn);
 		free(cat->old_ro_txn);
 	}
+	members_free(cat->old_members);
+	members_upd_cleanup(cat->old_members_upd);
+	members_free(cat->members);
 	knot_lmdb_deinit(&cat->db);
 }
 
@@ -187,6 +426,11 @@ int catalog_add(catalog_t *cat, const knot_dname_t *member,
 	MDB_val val = knot_lmdb_make_key("BBNS", 0, bail, owner, group);
 
 	knot_lmdb_insert(cat->rw_txn, &key, &val);
+	if (cat->rw_txn->ret == KNOT_EOK && cat->members_upd != NULL &&
+	    members_upd_add(cat->members_upd, member, &val) != KNOT_EOK) {
+		members_upd_rollback(cat->members_upd); // reload on commit
+		cat->members_upd = NULL;
+	}
 	free(key.mv_data);
 	free(val.mv_data);
 	return cat->rw_txn->ret;
@@ -199,6 +443,11 @@ int catalog_del(catalog_t *cat, const knot_dname_t *member)
 	}
 	MDB_val key = knot_lmdb_make_key("BN", 0, member);
 	knot_lmdb_del_prefix(cat->rw_txn, &key); // deletes one record
+	if (cat->rw_txn->ret == KNOT_EOK && cat->members_upd != NULL &&
+	    members_upd_del(cat->members_upd, member) != KNOT_EOK) {
+		members_upd_rollback(cat->members_upd); // reload on commit
+		cat->members_upd = NULL;
+	}
 	free(key.mv_data);
 	return cat->rw_txn->ret;
 }
@@ -218,6 +467,22 @@ static int find_threadsafe(catalog_t *cat, const knot_dname_t *member,
                            const char **group, void **tofree)
 {
 	*tofree = NULL;
+	trie_t *members = rcu_dereference(cat->members);
+	if (members != NULL) {
+		catalog_member_t *found = members_find(members, member);
+		if (found == NULL) {
+			return KNOT_ENOENT;
+		}
+		MDB_val val = { found->size, malloc(found->size) };
+		if (val.mv_data == NULL) {
+			return KNOT_ENOMEM;
+		}
+		memcpy(val.mv_data, found->data, found->size);
+		unmake_val(&val, owner, catz, group);
+		*tofree = val.mv_data;
+		return KNOT_EOK;
+	}
+
 	if (cat->ro_txn == NULL) {
 		return KNOT_ENOENT;
 	}
@@ -242,6 +507,11 @@ int catalog_get_catz(catalog_t *cat, const knot_dname_t *member,
 
 bool catalog_has_member(catalog_t *cat, const knot_dname_t *member)
 {
+	trie_t *members = rcu_dereference(cat->members);
+	if (members != NULL) {
+		return members_find(members, member) != NULL;
+	}
+
 	const knot_dname_t *catz;
 	const char *group;
 	void *tofree = NULL;
@@ -284,9 +554,50 @@ static int catalog_apply_cb(MDB_val *key, MDB_val *val, void *ctx)
 	return iter_ctx->cb(mem, ow, cz, gr, iter_ctx->ctx);
 }
 
+static int members_apply_one(const knot_dname_t *member, catalog_member_t *found,
+                             catalog_apply_cb_t cb, void *ctx)
+{
+	MDB_val val = { found->size, found->data };
+	const knot_dname_t *ow = NULL, *cz = NULL;
+	const char *gr = NULL;
+	unmake_val(&val, &ow, &cz, &gr);
+	if (ow == NULL || cz == NULL) {
+		return KNOT_EMALF;
+	}
+	return cb(member, ow, cz, gr, ctx);
+}
+
+static int members_apply(trie_t *members, const knot_dname_t *for_member,
+                         catalog_apply_cb_t cb, void *ctx)
+{
+	if (for_member != NULL) {
+		catalog_member_t *found = members_find(members, for_member);
+		return (found == NULL) ? KNOT_EOK : members_apply_one(for_member, found, cb, ctx);
+	}
+
+	trie_it_t *it = trie_it_begin(members);
+	if (it == NULL) {
+		return KNOT_ENOMEM;
+	}
+	int ret = KNOT_EOK;
+	while (!trie_it_finished(it) && ret == KNOT_EOK) {
+		size_t len;
+		const knot_dname_t *member = trie_it_key(it, &len);
+		ret = members_apply_one(member, *trie_it_val(it), cb, ctx);
+		trie_it_next(it);
+	}
+	trie_it_free(it);
+	return ret;
+}
+
 int catalog_apply(catalog_t *cat, const knot_dname_t *for_member,
                   catalog_apply_cb_t cb, void *ctx, bool rw)
 {
+	trie_t *members = rcu_dereference(cat->members);
+	if (!rw && members != NULL) {
+		return members_apply(members, for_member, cb, ctx);
+	}
+
 	MDB_val prefix = knot_lmdb_make_key(for_member == NULL ? "B" : "BN", 0, for_member);
 	catalog_apply_ctx_t iter_ctx = { cb, ctx };
 	knot_lmdb_txn_t *use_txn = rw ? cat->rw_txn : cat->ro_txn;
@@ -16,6 +16,7 @@
 
 #pragma once
 
+#include "contrib/qp-trie/trie.h"
 #include "knot/journal/knot_lmdb.h"
 #include "libknot/libknot.h"
 
@@ -29,9 +30,14 @@ typedef struct catalog {
 	knot_lmdb_db_t db;
 	knot_lmdb_txn_t *ro_txn; // persistent RO transaction
 	knot_lmdb_txn_t *rw_txn; // temporary RW transaction
+	trie_t *members;         // in-memory index of members in RO txn, NULL if unavailable
 
 	// private
 	knot_lmdb_txn_t *old_ro_txn;
+	trie_t *old_members;
+	struct catalog_members_upd *members_upd;     // index update by the RW txn
+	struct catalog_members_upd *old_members_upd; // committed index update
+	size_t members_txnid;    // LMDB txn ID the index corresponds to
 } catalog_t;
 
 /*!
@@ -93,6 +99,7 @@ void catalog_abort(catalog_t *cat);
  * \brief Free up old txns.
  *
  * \note This must be called after catalog_commit() with a delay of synchronize_rcu().
+ *       Also the replaced members index is freed here.
  *
  * \param cat   Catalog.
  */
@@ -134,6 +141,7 @@ int catalog_del(catalog_t *cat, const knot_dname_t *member);
  * \brief Find catz name of the catalog owning this member.
  *
  * \note This function may be called in multithreaded operation.
+ * \note The in-memory members index is used, no LMDB transaction is opened.
  *
  * \param cat       Catalog database.
  * \param member    Member to search for.
@@ -166,7 +174,7 @@ typedef int (*catalog_apply_cb_t)(const knot_dname_t *member, const knot_dname_t
  * \param for_member   (Optional) Iterate only on records for this member name.
  * \param cb           Callback to be called.
  * \param ctx          Context for this callback.
- * \param rw           Use read-write transaction.
+ * \param rw           Use read-write transaction, otherwise the in-memory index.
  *
  * \return KNOT_E*
  */
@@ -73,6 +73,65 @@ static bool same_group(zone_t *old_z, zone_t *new_z)
 	}
 }
 
+static void generate_rem(zone_t *zone, struct knot_zonedb *db_new)
+{
+	knot_dname_t *cg = zone->catalog_gen;
+	zone_t *catz = knot_zonedb_find(db_new, cg);
+	if (catz == NULL || catz->contents == NULL) {
+		return;
+	}
+	assert(catz->cat_members != NULL); // if this failed to allocate, catz wasn't added to zonedb
+
+	knot_dname_t *owner = catalog_member_owner(zone->name, cg, zone->timers.catalog_member);
+	if (owner == NULL) {
+		catz->cat_members->error = KNOT_ENOENT;
+		return;
+	}
+	int ret = catalog_update_add(catz->cat_members, zone->name, owner,
+	                             cg, CAT_UPD_REM, NULL, 0, NULL);
+	free(owner);
+	if (ret != KNOT_EOK) {
+		catz->cat_members->error = ret;
+	} else {
+		zone_events_schedule_now(catz, ZONE_EVENT_LOAD);
+	}
+}
+
+static void generate_add(zone_t *zone, zone_t *old, struct knot_zonedb *db_new)
+{
+	knot_dname_t *cg = zone->catalog_gen;
+	zone_t *catz = knot_zonedb_find(db_new, cg);
+	if (catz == NULL) {
+		log_zone_warning(zone->name, "member zone belongs to non-existing catalog zone");
+		return;
+	}
+
+	catalog_upd_type_t type;
+	if (catz->contents == NULL || old == NULL) {
+		type = CAT_UPD_ADD;
+	} else if (!same_group(zone, old)) {
+		type = CAT_UPD_PROP;
+	} else {
+		return; // Unchanged member, skip computing its owner.
+	}
+
+	assert(catz->cat_members != NULL);
+	knot_dname_t *owner = catalog_member_owner(zone->name, cg, zone->timers.catalog_member);
+	if (owner == NULL) {
+		catz->cat_members->error = KNOT_ENOENT;
+		return;
+	}
+	size_t cgroup_size = zone->catalog_group == NULL ? 0 : strlen(zone->catalog_group);
+	int ret = catalog_update_add(catz->cat_members, zone->name, owner,
+	                             cg, type, zone->catalog_group, cgroup_size, NULL);
+	free(owner);
+	if (ret != KNOT_EOK) {
+		catz->cat_members->error = ret;
+	} else {
+		zone_events_schedule_now(catz, ZONE_EVENT_LOAD);
+	}
+}
+
 void catalogs_generate(struct knot_zonedb *db_new, struct knot_zonedb *db_old)
 {
 	// general comment: catz->contents!=NULL means incremental update of catalog
@@ -81,26 +140,8 @@ void catalogs_generate(struct knot_zonedb *db_new, struct knot_zonedb *db_old)
 		knot_zonedb_iter_t *it = knot_zonedb_iter_begin(db_old);
 		while (!knot_zonedb_iter_finished(it)) {
 			zone_t *zone = knot_zonedb_iter_val(it);
-			knot_dname_t *cg = zone->catalog_gen;
-			if (cg != NULL && knot_zonedb_find(db_new, zone->name) == NULL) {
-				zone_t *catz = knot_zonedb_find(db_new, cg);
-				if (catz != NULL && catz->contents != NULL) {
-					assert(catz->cat_members != NULL); // if this failed to allocate, catz wasn't added to zonedb
-					knot_dname_t *owner = catalog_member_owner(zone->name, cg, zone->timers.catalog_member);
-					if (owner == NULL) {
-						catz->cat_members->error = KNOT_ENOENT;
-						knot_zonedb_iter_next(it);
-						continue;
-					}
-					int ret = catalog_update_add(catz->cat_members, zone->name, owner,
-					                             cg, CAT_UPD_REM, NULL, 0, NULL);
-					free(owner);
-					if (ret != KNOT_EOK) {
-						catz->cat_members->error = ret;
-					} else {
-						zone_events_schedule_now(catz, ZONE_EVENT_LOAD);
-					}
-				}
+			if (zone->catalog_gen != NULL && knot_zonedb_find(db_new, zone->name) == NULL) {
+				generate_rem(zone, db_new);
 			}
 			knot_zonedb_iter_next(it);
 		}
@@ -110,48 +151,35 @@ void catalogs_generate(struct knot_zonedb *db_new, struct knot_zonedb *db_old)
 	knot_zonedb_iter_t *it = knot_zonedb_iter_begin(db_new);
 	while (!knot_zonedb_iter_finished(it)) {
 		zone_t *zone = knot_zonedb_iter_val(it);
-		knot_dname_t *cg = zone->catalog_gen;
-		if (cg == NULL) {
-			knot_zonedb_iter_next(it);
-			continue;
+		if (zone->catalog_gen != NULL) {
+			generate_add(zone, knot_zonedb_find(db_old, zone->name), db_new);
 		}
-		zone_t *catz = knot_zonedb_find(db_new, cg);
-		zone_t *old = knot_zonedb_find(db_old, zone->name);
-		knot_dname_t *owner = catalog_member_owner(zone->name, cg, zone->timers.catalog_member);
-		size_t cgroup_size = zone->catalog_group == NULL ? 0 : strlen(zone->catalog_group);
-		if (catz == NULL) {
-			log_zone_warning(zone->name, "member zone belongs to non-existing catalog zone");
-		} else if (catz->contents == NULL || old == NULL) {
-			assert(catz->cat_members != NULL);
-			if (owner == NULL) {
-				catz->cat_members->error = KNOT_ENOENT;
-				knot_zonedb_iter_next(it);
-				continue;
-			}
-			int ret = catalog_update_add(catz->cat_members, zone->name, owner,
-			                             cg, CAT_UPD_ADD, zone->catalog_group,
-			                             cgroup_size, NULL);
-			if (ret != KNOT_EOK) {
-				catz->cat_members->error = ret;
-			} else {
-				zone_events_schedule_now(catz, ZONE_EVENT_LOAD);
-			}
-		} else if (!same_group(zone, old)) {
-			int ret = catalog_update_add(catz->cat_members, zone->name, owner,
-			                             cg, CAT_UPD_PROP, zone->catalog_group,
-			                             cgroup_size, NULL);
-			if (ret != KNOT_EOK) {
-				catz->cat_members->error = ret;
-			} else {
-				zone_events_schedule_now(catz, ZONE_EVENT_LOAD);
-			}
-		}
-		free(owner);
 		knot_zonedb_iter_next(it);
 	}
 	knot_zonedb_iter_free(it);
 }
 
+bool catalogs_generate_needs_full(struct knot_zonedb *db_new, const knot_dname_t *name)
+{
+	zone_t *zone = knot_zonedb_find(db_new, name);
+	return zone != NULL && zone->cat_members != NULL && zone->contents == NULL;
+}
+
+void catalogs_generate_zone(struct knot_zonedb *db_new, struct knot_zonedb *db_old,
+                            const knot_dname_t *name)
+{
+	zone_t *zone = knot_zonedb_find(db_new, name);
+	zone_t *old = knot_zonedb_find(db_old, name);
+
+	if (zone == NULL) {
+		if (old != NULL && old->catalog_gen != NULL) {
+			generate_rem(old, db_new);
+		}
+	} else if (zone->catalog_gen != NULL) {
+		generate_add(zone, old, db_new);
+	}
+}
+
 static void set_rdata(knot_rrset_t *rrset, uint8_t *data, uint16_t len)
 {
 	knot_rdata_init(rrset->rrs.rdata, len, data);
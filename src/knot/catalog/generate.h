@@ -29,6 +29,23 @@ struct knot_zonedb;
  */
 void catalogs_generate(struct knot_zonedb *db_new, struct knot_zonedb *db_old);
 
+/*!
+ * \brief Check if the changed zone is a catalog zone to be generated from scratch.
+ *
+ * Such a zone needs all its members, so catalogs_generate() must be used
+ * instead of catalogs_generate_zone().
+ */
+bool catalogs_generate_needs_full(struct knot_zonedb *db_new, const knot_dname_t *name);
+
+/*!
+ * \brief Like catalogs_generate(), but only for one added, removed or changed zone.
+ *
+ * \note Used with delta reloads, so that the cost is given by the number
+ *       of changed zones instead of all zones.
+ */
+void catalogs_generate_zone(struct knot_zonedb *db_new, struct knot_zonedb *db_old,
+                            const knot_dname_t *name);
+
 struct zone_contents;
 
 /*!
@@ -232,6 +232,13 @@ static int rr_count(const zone_node_t *node, uint16_t type)
 
 static int member_verify(zone_node_t *node, cat_upd_ctx_t *ctx)
 {
+	if (ctx->zone_diff) {
+		// Changed node, check its resulting state.
+		node = (zone_node_t *)zone_contents_find_node(ctx->complete_conts, node->owner);
+		if (node == NULL) {
+			return KNOT_EOK;
+		}
+	}
 	return rr_count(node, KNOT_RRTYPE_PTR) > 1 ? KNOT_EISRECORD : KNOT_EOK;
 }
 
@@ -240,17 +247,21 @@ static int prop_verify(zone_node_t *node, cat_upd_ctx_t *ctx)
 	return KNOT_EOK;
 }
 
-int catalog_zone_verify(const struct zone_contents *zone)
+int catalog_zone_verify(const struct zone_contents *zone, const zone_diff_t *changes)
 {
 	cat_upd_ctx_t ctx = { NULL, zone, knot_dname_labels(zone->apex->owner, NULL),
-	                      false, false, NULL, member_verify, prop_verify };
+	                      false, changes != NULL, NULL, member_verify, prop_verify };
 
 	if (!check_zone_version(zone)) {
 		return KNOT_EZONEINVAL;
 	}
 
 	zone_diff_t zdiff;
-	zone_diff_from_zone(&zdiff, zone);
+	if (changes != NULL) {
+		zdiff = *changes;
+	} else {
+		zone_diff_from_zone(&zdiff, zone);
+	}
 
 	return interpret_zone(&zdiff, &ctx);
 }
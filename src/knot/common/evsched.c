@@ -23,40 +23,168 @@
 #include "libknot/libknot.h"
 #include "knot/server/dthreads.h"
 #include "knot/common/evsched.h"
+#include "contrib/macros.h"
+
+#define SLOT_BITS 6
+#define SLOT_MASK (EVSCHED_SLOTS - 1)
+#define WHEEL_BITS (EVSCHED_LEVELS * SLOT_BITS)
+
+/*! \brief Pending events of the current thread's batch. */
+static __thread struct {
+	evsched_t *sched;
+	struct {
+		event_t *ev;
+		uint64_t when;
+	} *items;
+	size_t count;
+	size_t size;
+} batch;
+
+static uint64_t time_now(void)
+{
+	struct timeval tv = { 0 };
+	gettimeofday(&tv, NULL);
+	return (uint64_t)tv.tv_sec * 1000 + tv.tv_usec / 1000;
+}
 
-/*! \brief Some implementations of timercmp >= are broken, this is for compat.*/
-static inline int timercmp_ge(struct timeval *a, struct timeval *b) {
-	return !timercmp(a, b, <);
+static bool is_scheduled(const event_t *ev)
+{
+	return ev->node.prev != NULL;
 }
 
-static int compare_event_heap_nodes(void *e1, void *e2)
+static void set_time(event_t *ev, uint64_t when)
 {
-	if (timercmp(&((event_t *)e1)->tv, &((event_t *)e2)->tv, <)) return -1;
-	if (timercmp(&((event_t *)e1)->tv, &((event_t *)e2)->tv, >)) return 1;
-	return 0;
+	ev->when = when;
+	ev->tv.tv_sec = when / 1000;
+	ev->tv.tv_usec = (when % 1000) * 1000;
 }
 
 /*!
- * \brief Get time T (now) + dt milliseconds.
+ * \brief Put the event into the slot of the highest bit group differing from
+ *        the wheel time, i.e. level 0 if due within the current 64 ms.
  */
-static struct timeval timeval_in(uint32_t dt)
+static void wheel_insert(evsched_t *sched, event_t *ev)
 {
-	struct timeval tv = { 0 };
-	gettimeofday(&tv, NULL);
+	uint64_t when = MAX(ev->when, sched->current);
+	uint64_t diff = when ^ sched->current;
+	unsigned level = (diff == 0) ? 0 : (63 - __builtin_clzll(diff)) / SLOT_BITS;
+
+	if (level >= EVSCHED_LEVELS) {
+		ev->level = EVSCHED_LEVELS;
+		add_tail(&sched->overflow, &ev->node);
+		return;
+	}
+
+	ev->level = level;
+	ev->slot = (when >> (level * SLOT_BITS)) & SLOT_MASK;
+	add_tail(&sched->wheel[level][ev->slot], &ev->node);
+	sched->occupied[level] |= (uint64_t)1 << ev->slot;
+}
+
+static void wheel_remove(evsched_t *sched, event_t *ev)
+{
+	rem_node(&ev->node);
+	if (ev->level < EVSCHED_LEVELS &&
+	    EMPTY_LIST(sched->wheel[ev->level][ev->slot])) {
+		sched->occupied[ev->level] &= ~((uint64_t)1 << ev->slot);
+	}
+}
+
+static void wheel_cascade(evsched_t *sched, list_t *list)
+{
+	event_t *ev;
+	WALK_LIST_FIRST(ev, *list) {
+		wheel_remove(sched, ev);
+		wheel_insert(sched, ev);
+	}
+}
 
-	/* Add number of seconds. */
-	tv.tv_sec += dt / 1000;
+/*!
+ * \brief Get the wheel time when a slot is due or has to be cascaded.
+ *
+ * \return Time in milliseconds, UINT64_MAX if no event is scheduled.
+ */
+static uint64_t wheel_next(evsched_t *sched)
+{
+	uint64_t cur = sched->current;
+	for (unsigned level = 0; level < EVSCHED_LEVELS; level++) {
+		unsigned shift = level * SLOT_BITS;
+		unsigned idx = (cur >> shift) & SLOT_MASK;
+		// Events of higher levels are always in later slots than the current one.
+		unsigned from = (level == 0) ? idx : idx + 1;
+		if (from >= EVSCHED_SLOTS) {
+			continue;
+		}
+		uint64_t ahead = sched->occupied[level] >> from;
+		if (ahead != 0) {
+			uint64_t slot = from + __builtin_ctzll(ahead);
+			return ((cur >> (shift + SLOT_BITS)) << (shift + SLOT_BITS)) | (slot << shift);
+		}
+	}
+
+	if (!EMPTY_LIST(sched->overflow)) {
+		return ((cur >> WHEEL_BITS) + 1) << WHEEL_BITS;
+	}
+
+	return UINT64_MAX;
+}
 
-	/* Add the number of microseconds. */
-	tv.tv_usec += (dt % 1000) * 1000;
+/*!
+ * \brief Move the wheel time forward to the time returned by wheel_next().
+ *
+ * Slots reached on higher levels are redistributed to the lower ones.
+ */
+static void wheel_advance(evsched_t *sched, uint64_t to)
+{
+	uint64_t from = sched->current;
+	sched->current = to;
 
-	/* Check for overflow. */
-	while (tv.tv_usec > 999999) {
-		tv.tv_sec += 1;
-		tv.tv_usec -= 1 * 1000 * 1000;
+	if ((from >> WHEEL_BITS) != (to >> WHEEL_BITS)) {
+		wheel_cascade(sched, &sched->overflow);
 	}
 
-	return tv;
+	for (int level = EVSCHED_LEVELS - 1; level > 0; level--) {
+		unsigned shift = level * SLOT_BITS;
+		if ((from >> shift) != (to >> shift)) {
+			wheel_cascade(sched, &sched->wheel[level][(to >> shift) & SLOT_MASK]);
+		}
+	}
+}
+
+static bool batch_add(evsched_t *sched, event_t *ev, uint64_t when)
+{
+	if (batch.sched != sched) {
+		return false;
+	}
+
+	if (batch.count == batch.size) {
+		size_t size = MAX(2 * batch.size, 256);
+		void *items = realloc(batch.items, size * sizeof(*batch.items));
+		if (items == NULL) {
+			return false;
+		}
+		batch.items = items;
+		batch.size = size;
+	}
+
+	batch.items[batch.count].ev = ev;
+	batch.items[batch.count].when = when;
+	batch.count++;
+
+	return true;
+}
+
+static void batch_drop(evsched_t *sched, event_t *ev)
+{
+	if (batch.sched != sched) {
+		return;
+	}
+
+	for (size_t i = 0; i < batch.count; i++) {
+		if (batch.items[i].ev == ev) {
+			batch.items[i].ev = NULL;
+		}
+	}
 }
 
 /*! \brief Event scheduler loop. */
@@ -70,28 +198,28 @@ static int evsched_run(dthread_t *thread)
 	/* Run event loop. */
 	pthread_mutex_lock(&sched->heap_lock);
 	while (!dt_is_cancelled(thread)) {
-		if (!!EMPTY_HEAP(&sched->heap) || sched->paused) {
+		uint64_t next = wheel_next(sched);
+		if (next == UINT64_MAX || sched->paused) {
 			pthread_cond_wait(&sched->notify, &sched->heap_lock);
 			continue;
 		}
 
-		/* Get current time. */
-		struct timeval dt;
-		gettimeofday(&dt, 0);
-
-		/* Get next event. */
-		event_t *ev = *((event_t**)HHEAD(&sched->heap));
-		assert(ev != NULL);
-
-		if (timercmp_ge(&dt, &ev->tv)) {
-			heap_delmin(&sched->heap);
-			ev->cb(ev);
-		} else {
+		if (next > time_now()) {
 			/* Wait for next event or interrupt. Unlock calendar. */
 			struct timespec ts;
-			ts.tv_sec = ev->tv.tv_sec;
-			ts.tv_nsec = ev->tv.tv_usec * 1000L;
+			ts.tv_sec = next / 1000;
+			ts.tv_nsec = (next % 1000) * 1000000L;
 			pthread_cond_timedwait(&sched->notify, &sched->heap_lock, &ts);
+			continue;
+		}
+
+		wheel_advance(sched, next);
+
+		list_t *due = &sched->wheel[0][next & SLOT_MASK];
+		if (!EMPTY_LIST(*due)) {
+			event_t *ev = HEAD(*due);
+			wheel_remove(sched, ev);
+			ev->cb(ev);
 		}
 	}
 	pthread_mutex_unlock(&sched->heap_lock);
@@ -107,7 +235,13 @@ int evsched_init(evsched_t *sched, void *ctx)
 	/* Initialize event calendar. */
 	pthread_mutex_init(&sched->heap_lock, 0);
 	pthread_cond_init(&sched->notify, 0);
-	heap_init(&sched->heap, compare_event_heap_nodes, 0);
+	for (int level = 0; level < EVSCHED_LEVELS; level++) {
+		for (int slot = 0; slot < EVSCHED_SLOTS; slot++) {
+			init_list(&sched->wheel[level][slot]);
+		}
+	}
+	init_list(&sched->overflow);
+	sched->current = time_now();
 
 	sched->thread = dt_create(1, evsched_run, NULL, sched);
 
@@ -129,14 +263,20 @@ void evsched_deinit(evsched_t *sched)
 	pthread_mutex_destroy(&sched->heap_lock);
 	pthread_cond_destroy(&sched->notify);
 
-	while (!EMPTY_HEAP(&sched->heap)) {
-		event_t *e = (event_t *)*HHEAD(&sched->heap);
-		heap_delmin(&sched->heap);
+	event_t *e;
+	for (int level = 0; level < EVSCHED_LEVELS; level++) {
+		for (int slot = 0; slot < EVSCHED_SLOTS; slot++) {
+			WALK_LIST_FIRST(e, sched->wheel[level][slot]) {
+				rem_node(&e->node);
+				evsched_event_free(e);
+			}
+		}
+	}
+	WALK_LIST_FIRST(e, sched->overflow) {
+		rem_node(&e->node);
 		evsched_event_free(e);
 	}
 
-	heap_deinit(&sched->heap);
-
 	if (sched->thread != NULL) {
 		dt_delete(&sched->thread);
 	}
@@ -163,7 +303,6 @@ event_t *evsched_event_create(evsched_t *sched, event_cb_t cb, void *data)
 	e->sched = sched;
 	e->cb = cb;
 	e->data = data;
-	e->hpos.pos = 0;
 
 	return e;
 }
@@ -183,23 +322,24 @@ int evsched_schedule(event_t *ev, uint32_t dt)
 		return KNOT_EINVAL;
 	}
 
-	struct timeval new_time = timeval_in(dt);
+	uint64_t new_time = time_now() + dt;
 
 	evsched_t *sched = ev->sched;
 
+	if (batch_add(sched, ev, new_time)) {
+		return KNOT_EOK;
+	}
+
 	/* Lock calendar. */
 	pthread_mutex_lock(&sched->heap_lock);
 
-	ev->tv = new_time;
+	set_time(ev, new_time);
 
 	/* Make sure it's not already enqueued. */
-	int found = heap_find(&sched->heap, (heap_val_t *)ev);
-	if (found > 0) {
-		/* "Replacing" with itself -- just repositioning it. */
-		heap_replace(&sched->heap, found, (heap_val_t *)ev);
-	} else {
-		heap_insert(&sched->heap, (heap_val_t *)ev);
+	if (is_scheduled(ev)) {
+		wheel_remove(sched, ev);
 	}
+	wheel_insert(sched, ev);
 
 	/* Unlock calendar. */
 	pthread_cond_signal(&sched->notify);
@@ -208,6 +348,41 @@ int evsched_schedule(event_t *ev, uint32_t dt)
 	return KNOT_EOK;
 }
 
+void evsched_batch_begin(evsched_t *sched)
+{
+	assert(batch.sched == NULL);
+	batch.sched = sched;
+	batch.count = 0;
+}
+
+void evsched_batch_commit(evsched_t *sched)
+{
+	assert(batch.sched == sched);
+	batch.sched = NULL;
+
+	if (batch.count > 0) {
+		pthread_mutex_lock(&sched->heap_lock);
+		for (size_t i = 0; i < batch.count; i++) {
+			event_t *ev = batch.items[i].ev;
+			if (ev == NULL) {
+				continue;
+			}
+			set_time(ev, batch.items[i].when);
+			if (is_scheduled(ev)) {
+				wheel_remove(sched, ev);
+			}
+			wheel_insert(sched, ev);
+		}
+		pthread_cond_signal(&sched->notify);
+		pthread_mutex_unlock(&sched->heap_lock);
+	}
+
+	free(batch.items);
+	batch.items = NULL;
+	batch.count = 0;
+	batch.size = 0;
+}
+
 int evsched_cancel(event_t *ev)
 {
 	if (ev == NULL || ev->sched == NULL) {
@@ -216,12 +391,13 @@ int evsched_cancel(event_t *ev)
 
 	evsched_t *sched = ev->sched;
 
+	batch_drop(sched, ev);
+
 	/* Lock calendar. */
 	pthread_mutex_lock(&sched->heap_lock);
 
-	int found = heap_find(&sched->heap, (heap_val_t *)ev);
-	if (found > 0) {
-		heap_delete(&sched->heap, found);
+	if (is_scheduled(ev)) {
+		wheel_remove(sched, ev);
 		pthread_cond_signal(&sched->notify);
 	}
 
@@ -230,6 +406,7 @@ int evsched_cancel(event_t *ev)
 
 	/* Reset event timer. */
 	memset(&ev->tv, 0, sizeof(struct timeval));
+	ev->when = 0;
 
 	return KNOT_EOK;
 }
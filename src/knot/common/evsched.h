@@ -16,6 +16,10 @@
 
 /*!
  * \brief Event scheduler.
+ *
+ * Events are kept in a hierarchical timing wheel with millisecond ticks,
+ * so that scheduling and cancelling are O(1) regardless of the number of
+ * scheduled events.
  */
 
 #pragma once
@@ -26,7 +30,11 @@
 #include <sys/time.h>
 
 #include "knot/server/dthreads.h"
-#include "contrib/ucw/heap.h"
+#include "contrib/ucw/lists.h"
+
+/*! \brief Number of wheel levels, each with 64 slots (covers 2^36 ms). */
+#define EVSCHED_LEVELS 6
+#define EVSCHED_SLOTS  64
 
 /* Forward decls. */
 struct evsched;
@@ -51,7 +59,10 @@ typedef void (*event_cb_t)(struct event *);
  * \brief Event structure.
  */
 typedef struct event {
-	struct heap_val hpos;
+	node_t node;       /*!< Wheel slot membership. */
+	uint64_t when;     /*!< Event scheduled time in milliseconds. */
+	uint8_t level;     /*!< Wheel level of the slot. */
+	uint8_t slot;      /*!< Slot within the level. */
 	struct timeval tv; /*!< Event scheduled time. */
 	void *data;        /*!< Usable data ptr. */
 	event_cb_t cb;     /*!< Event callback. */
@@ -63,9 +74,12 @@ typedef struct event {
  */
 typedef struct evsched {
 	volatile bool paused;      /*!< Temporarily stop processing events. */
-	pthread_mutex_t heap_lock; /*!< Event heap locking. */
-	pthread_cond_t notify;     /*!< Event heap notification. */
-	struct heap heap;          /*!< Event heap. */
+	pthread_mutex_t heap_lock; /*!< Event wheel locking. */
+	pthread_cond_t notify;     /*!< Event wheel notification. */
+	uint64_t current;          /*!< Wheel time in milliseconds, earlier passed. */
+	uint64_t occupied[EVSCHED_LEVELS];             /*!< Non-empty slots. */
+	list_t wheel[EVSCHED_LEVELS][EVSCHED_SLOTS];   /*!< Event slots. */
+	list_t overflow;           /*!< Events beyond the wheel range. */
 	void *ctx;                 /*!< Scheduler context. */
 	dt_unit_t *thread;
 } evsched_t;
@@ -122,6 +136,25 @@ void evsched_event_free(event_t *ev);
  */
 int evsched_schedule(event_t *ev, uint32_t dt);
 
+/*!
+ * \brief Start collecting events scheduled by the calling thread.
+ *
+ * Events scheduled by the thread until evsched_batch_commit() are inserted
+ * at once, under one lock acquisition. Intended for mass replanning.
+ *
+ * \note The batched events shouldn't be cancelled by other threads meanwhile.
+ *
+ * \param sched Pointer to event scheduler instance.
+ */
+void evsched_batch_begin(evsched_t *sched);
+
+/*!
+ * \brief Insert the events collected since evsched_batch_begin().
+ *
+ * \param sched Pointer to event scheduler instance.
+ */
+void evsched_batch_commit(evsched_t *sched);
+
 /*!
  * \brief Cancel a scheduled event.
  *
@@ -14,14 +14,29 @@
     along with this program.  If not, see <https://www.gnu.org/licenses/>.
  */
 
+#include <errno.h>
 #include <stdlib.h>
 #include <string.h>
 #include <unistd.h>
+#ifdef HAVE_EPOLL
+#include <sys/ioctl.h>
+#endif
 
 #include "knot/common/fdset.h"
 #include "contrib/time.h"
 #include "contrib/macros.h"
 
+#if defined(HAVE_EPOLL) && defined(__linux__) && !defined(EPIOCSPARAMS)
+/* Since Linux 6.9, missing in older headers. */
+struct epoll_params {
+	uint32_t busy_poll_usecs;
+	uint16_t busy_poll_budget;
+	uint8_t prefer_busy_poll;
+	uint8_t __pad;
+};
+#define EPIOCSPARAMS _IOW(0x8A, 0x01, struct epoll_params)
+#endif
+
 #define MEM_RESIZE(p, n) { \
 	void *tmp = NULL; \
 	if ((tmp = realloc((p), (n) * sizeof(*p))) == NULL) { \
@@ -268,6 +283,50 @@ int fdset_poll(fdset_t *set, fdset_it_t *it, const unsigned offset, const int ti
 #endif
 }
 
+int fdset_poll_spin(fdset_t *set, fdset_it_t *it, const unsigned offset,
+                    const int timeout_ms, const unsigned spin_us, uint64_t *spin_time)
+{
+	if (spin_us == 0) {
+		return fdset_poll(set, it, offset, timeout_ms);
+	}
+
+	struct timespec begin = time_now(), now;
+	double elapsed_us;
+	int ret;
+	do {
+		ret = fdset_poll(set, it, offset, 0);
+		now = time_now();
+		elapsed_us = 1000 * time_diff_ms(&begin, &now);
+	} while (ret == 0 && elapsed_us < spin_us);
+
+	if (spin_time != NULL) {
+		*spin_time += elapsed_us;
+	}
+
+	return (ret == 0) ? fdset_poll(set, it, offset, timeout_ms) : ret;
+}
+
+int fdset_busypoll(fdset_t *set, const unsigned timeout_us, const unsigned budget)
+{
+	if (set == NULL) {
+		return KNOT_EINVAL;
+	}
+
+#if defined(HAVE_EPOLL) && defined(__linux__)
+	struct epoll_params params = {
+		.busy_poll_usecs = timeout_us,
+		.busy_poll_budget = budget,
+		.prefer_busy_poll = 1,
+	};
+	if (ioctl(set->pfd, EPIOCSPARAMS, &params) != 0) {
+		return (errno == ENOTTY || errno == EINVAL) ? KNOT_ENOTSUP : knot_map_errno();
+	}
+	return KNOT_EOK;
+#else
+	return KNOT_ENOTSUP;
+#endif
+}
+
 void fdset_it_commit(fdset_it_t *it)
 {
 	if (it == NULL) {
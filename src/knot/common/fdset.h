@@ -23,6 +23,7 @@
 #include <assert.h>
 #include <stdbool.h>
 #include <stddef.h>
+#include <stdint.h>
 #include <time.h>
 
 #ifdef HAVE_EPOLL
@@ -154,6 +155,35 @@ int fdset_remove(fdset_t *set, const unsigned idx);
  */
 int fdset_poll(fdset_t *set, fdset_it_t *it, const unsigned offset, const int timeout_ms);
 
+/*!
+ * \brief Poll set for new events, spin with non-blocking polls first.
+ *
+ * \param set         Target set.
+ * \param it          Event iterator storage.
+ * \param offset      Index of first socket to be polled.
+ * \param timeout_ms  Timeout of the blocking poll after spinning.
+ * \param spin_us     Maximum spinning time in microseconds (0 for none).
+ * \param spin_time   Output: spinning time in microseconds is added to it.
+ *
+ * \retval ret >= 0 represents number of events received.
+ * \retval ret < 0 on error.
+ */
+int fdset_poll_spin(fdset_t *set, fdset_it_t *it, const unsigned offset,
+                    const int timeout_ms, const unsigned spin_us, uint64_t *spin_time);
+
+/*!
+ * \brief Enable busy polling of the sockets in the set by the epoll itself.
+ *
+ * \note Requires Linux 6.9 or newer.
+ *
+ * \param set         Target set.
+ * \param timeout_us  Busy polling timeout in microseconds.
+ * \param budget      Maximum number of packets processed by one busy poll.
+ *
+ * \return Error code, KNOT_EOK if success, KNOT_ENOTSUP if not supported.
+ */
+int fdset_busypoll(fdset_t *set, const unsigned timeout_us, const unsigned budget);
+
 /*!
  * \brief Set file descriptor watchdog interval.
  *
@@ -14,6 +14,8 @@
     along with this program.  If not, see <https://www.gnu.org/licenses/>.
  */
 
+#include <pthread.h>
+#include <inttypes.h>
 #include <stdarg.h>
 #include <stdio.h>
 #include <string.h>
@@ -31,12 +33,18 @@
 
 #include "knot/common/log.h"
 #include "libknot/libknot.h"
+#include "contrib/openbsd/strlcpy.h"
 #include "contrib/ucw/lists.h"
 
 /*! Single log message buffer length (one line). */
 #define LOG_BUFLEN	512
 #define NULL_ZONE_STR	"?"
 
+/*! Asynchronous logging parameters. */
+#define RING_SIZE	128	// Queued messages per thread (power of two).
+#define FILE_BUFLEN	65536	// Output buffer of asynchronous log files.
+#define DROP_REPORT_SEC	10	// Minimal interval of dropped messages reports.
+
 #ifdef ENABLE_SYSTEMD
 int use_journal = 0;
 #endif
@@ -47,6 +55,8 @@ typedef struct {
 	int *target;         /*!< Log targets. */
 	size_t file_count;   /*!< Open files count. */
 	FILE **file;         /*!< Open files. */
+	bool *async;         /*!< Asynchronous targets. */
+	bool any_async;      /*!< Indication if any target is asynchronous. */
 	log_flag_t flags;    /*!< Formatting flags. */
 	struct {
 		bool debug;       /*!< Indication if any target uses DEBUG. */
@@ -57,6 +67,50 @@ typedef struct {
 /*! Log singleton. */
 log_t *s_log = NULL;
 
+/*! Message queued for the asynchronous writer. */
+typedef struct {
+	struct timeval tv;
+	int level;
+	log_source_t src;
+	bool zone;         /*!< Zone name is part of the message. */
+	uint16_t zone_off; /*!< Zone name offset in the message. */
+	uint16_t zone_len;
+	char msg[LOG_BUFLEN];
+} log_entry_t;
+
+/*! Single-producer single-consumer message queue of one logging thread. */
+typedef struct log_ring {
+	struct log_ring *next;
+	uint64_t head;     /*!< Written by the producer. */
+	uint64_t tail;     /*!< Written by the writer. */
+	uint64_t dropped;  /*!< Messages dropped due to full queue. */
+	bool orphan;       /*!< The producer thread has exited. */
+	log_entry_t entries[RING_SIZE];
+} log_ring_t;
+
+/*! Asynchronous writer state. */
+static struct {
+	pthread_mutex_t mx;   /*!< Protects the ring list and the thread state. */
+	pthread_cond_t cond;
+	pthread_t thread;
+	log_ring_t *rings;
+	bool running;
+	bool stop;
+	bool sleeping;
+	uint64_t dropped;     /*!< Dropped messages not reported yet. */
+	time_t reported;      /*!< Time of the last drops report. */
+} s_async = {
+	.mx = PTHREAD_MUTEX_INITIALIZER,
+	.cond = PTHREAD_COND_INITIALIZER,
+};
+
+static __thread log_ring_t *thread_ring;
+
+static pthread_key_t ring_key;
+static pthread_once_t ring_key_once = PTHREAD_ONCE_INIT;
+
+static void async_stop(void);
+
 static bool log_isopen(void)
 {
 	return s_log != NULL;
@@ -74,6 +128,7 @@ static void sink_free(log_t *log)
 	}
 	free(log->target);
 	free(log->file);
+	free(log->async);
 	free(log);
 }
 
@@ -110,6 +165,14 @@ static log_t *sink_setup(size_t file_count)
 		memset(log->file, 0, sizeof(FILE *) * file_count);
 	}
 
+	log->async = calloc(log->target_count, sizeof(bool));
+	if (log->async == NULL) {
+		free(log->file);
+		free(log->target);
+		free(log);
+		return NULL;
+	}
+
 	return log;
 }
 
@@ -203,6 +266,7 @@ void log_init(void)
 
 void log_close(void)
 {
+	async_stop();
 	sink_publish(NULL);
 
 	fflush(stdout);
@@ -232,13 +296,29 @@ void log_levels_add(log_target_t target, log_source_t src, int levels)
 	}
 }
 
-static void emit_log_msg(int level, log_source_t src, const char *zone,
-                         size_t zone_len, const char *msg, const char *param)
+static FILE *target_stream(log_t *log, int target)
 {
-	log_t *log = s_log;
+	switch (target) {
+	case LOG_TARGET_STDERR: return stderr;
+	case LOG_TARGET_STDOUT: return stdout;
+	default:                return log->file[target - LOG_TARGET_FILE];
+	}
+}
 
+/*!
+ * \brief Write the message to the targets.
+ *
+ * \param async     The message is also queued for the asynchronous writer.
+ * \param deferred  Write to the asynchronous targets only (by the writer),
+ *                  otherwise to the other ones (or all if not \a async).
+ */
+static void emit_log_msg(log_t *log, const struct timeval *tv, int level,
+                         log_source_t src, const char *zone, size_t zone_len,
+                         const char *msg, const char *param, bool async, bool deferred)
+{
 	// Syslog target.
-	if (*src_levels(log, LOG_TARGET_SYSLOG, src) & LOG_MASK(level)) {
+	if ((*src_levels(log, LOG_TARGET_SYSLOG, src) & LOG_MASK(level)) &&
+	    (async && log->async[LOG_TARGET_SYSLOG]) == deferred) {
 #ifdef ENABLE_SYSTEMD
 		if (use_journal) {
 			char *zone_fmt = zone ? "ZONE=%.*s." : NULL;
@@ -255,11 +335,9 @@ static void emit_log_msg(int level, log_source_t src, const char *zone,
 
 	// Prefix date and time.
 	char tstr[LOG_BUFLEN] = { 0 };
-	if (!(s_log->flags & LOG_FLAG_NOTIMESTAMP)) {
+	if (!(log->flags & LOG_FLAG_NOTIMESTAMP)) {
 		struct tm lt;
-		struct timeval tv;
-		gettimeofday(&tv, NULL);
-		time_t sec = tv.tv_sec;
+		time_t sec = tv->tv_sec;
 		if (localtime_r(&sec, &lt) != NULL) {
 			strftime(tstr, sizeof(tstr), KNOT_LOG_TIME_FORMAT " ", &lt);
 		}
@@ -267,23 +345,255 @@ static void emit_log_msg(int level, log_source_t src, const char *zone,
 
 	// Other log targets.
 	for (int i = LOG_TARGET_STDERR; i < LOG_TARGET_FILE + log->file_count; ++i) {
-		if (*src_levels(log, i, src) & LOG_MASK(level)) {
-			FILE *stream;
-			switch (i) {
-			case LOG_TARGET_STDERR: stream = stderr; break;
-			case LOG_TARGET_STDOUT: stream = stdout; break;
-			default: stream = log->file[i - LOG_TARGET_FILE]; break;
+		if ((*src_levels(log, i, src) & LOG_MASK(level)) &&
+		    (async && log->async[i]) == deferred) {
+			FILE *stream = target_stream(log, i);
+
+			// Keep the order with possibly buffered standard output.
+			if (stream == stderr) {
+				fflush(stdout);
 			}
 
-			// Print the message.
+			// Print the message, the writer flushes after each batch.
 			fprintf(stream, "%s%s\n", tstr, msg);
-			if (stream == stdout) {
+			if (stream == stdout && !deferred) {
 				fflush(stream);
 			}
 		}
 	}
 }
 
+static bool async_wanted(log_t *log, int level, log_source_t src)
+{
+	for (int i = LOG_TARGET_SYSLOG; i < LOG_TARGET_FILE + log->file_count; ++i) {
+		if (log->async[i] && (*src_levels(log, i, src) & LOG_MASK(level))) {
+			return true;
+		}
+	}
+	return false;
+}
+
+static void ring_orphan(void *ring)
+{
+	__atomic_store_n(&((log_ring_t *)ring)->orphan, true, __ATOMIC_RELEASE);
+}
+
+static void ring_key_init(void)
+{
+	(void)pthread_key_create(&ring_key, ring_orphan);
+}
+
+static log_ring_t *get_ring(void)
+{
+	if (thread_ring != NULL) {
+		return thread_ring;
+	}
+
+	log_ring_t *ring = calloc(1, sizeof(*ring));
+	if (ring == NULL) {
+		return NULL;
+	}
+
+	// Register the thread for releasing the ring on exit.
+	(void)pthread_once(&ring_key_once, ring_key_init);
+	if (pthread_setspecific(ring_key, ring) != 0) {
+		free(ring);
+		return NULL;
+	}
+
+	pthread_mutex_lock(&s_async.mx);
+	ring->next = s_async.rings;
+	s_async.rings = ring;
+	pthread_mutex_unlock(&s_async.mx);
+
+	thread_ring = ring;
+	return ring;
+}
+
+/*!
+ * \brief Queue the message for the writer, or drop it if the queue is full.
+ *
+ * \return False if the message can't be queued at all.
+ */
+static bool async_enqueue(const struct timeval *tv, int level, log_source_t src,
+                          const char *msg, const char *zone, size_t zone_len)
+{
+	log_ring_t *ring = get_ring();
+	if (ring == NULL) {
+		return false;
+	}
+
+	uint64_t head = ring->head;
+	if (head - __atomic_load_n(&ring->tail, __ATOMIC_ACQUIRE) == RING_SIZE) {
+		__atomic_add_fetch(&ring->dropped, 1, __ATOMIC_RELAXED);
+		return true;
+	}
+
+	log_entry_t *entry = &ring->entries[head % RING_SIZE];
+	entry->tv = *tv;
+	entry->level = level;
+	entry->src = src;
+	entry->zone = (zone != NULL);
+	entry->zone_off = (zone != NULL) ? zone - msg : 0;
+	entry->zone_len = zone_len;
+	strlcpy(entry->msg, msg, sizeof(entry->msg));
+
+	__atomic_store_n(&ring->head, head + 1, __ATOMIC_SEQ_CST);
+
+	// Wake up the writer only if it waits for messages.
+	if (__atomic_load_n(&s_async.sleeping, __ATOMIC_SEQ_CST)) {
+		pthread_mutex_lock(&s_async.mx);
+		pthread_cond_signal(&s_async.cond);
+		pthread_mutex_unlock(&s_async.mx);
+	}
+
+	return true;
+}
+
+static void async_flush(log_t *log)
+{
+	for (int i = LOG_TARGET_STDERR; i < LOG_TARGET_FILE + log->file_count; ++i) {
+		if (log->async[i]) {
+			fflush(target_stream(log, i));
+		}
+	}
+}
+
+/*! \brief Write out the queued messages, return true if there were any. */
+static bool async_drain(void)
+{
+	pthread_mutex_lock(&s_async.mx);
+	log_ring_t *rings = s_async.rings;
+	pthread_mutex_unlock(&s_async.mx);
+
+	bool drained = false;
+
+	rcu_read_lock();
+	log_t *log = s_log;
+	for (log_ring_t *ring = rings; ring != NULL; ring = ring->next) {
+		uint64_t head = __atomic_load_n(&ring->head, __ATOMIC_ACQUIRE);
+		for (uint64_t tail = ring->tail; tail != head; tail++) {
+			log_entry_t *entry = &ring->entries[tail % RING_SIZE];
+			if (log != NULL) {
+				const char *zone = entry->zone ? entry->msg + entry->zone_off : NULL;
+				emit_log_msg(log, &entry->tv, entry->level, entry->src, zone,
+				             entry->zone_len, entry->msg, NULL, true, true);
+			}
+			__atomic_store_n(&ring->tail, tail + 1, __ATOMIC_RELEASE);
+			drained = true;
+		}
+		s_async.dropped += __atomic_exchange_n(&ring->dropped, 0, __ATOMIC_RELAXED);
+	}
+	if (drained && log != NULL) {
+		async_flush(log);
+	}
+	rcu_read_unlock();
+
+	// Release the drained rings of exited threads.
+	pthread_mutex_lock(&s_async.mx);
+	log_ring_t **pos = &s_async.rings;
+	while (*pos != NULL) {
+		log_ring_t *ring = *pos;
+		if (__atomic_load_n(&ring->orphan, __ATOMIC_ACQUIRE) &&
+		    ring->tail == __atomic_load_n(&ring->head, __ATOMIC_ACQUIRE)) {
+			*pos = ring->next;
+			free(ring);
+		} else {
+			pos = &ring->next;
+		}
+	}
+	pthread_mutex_unlock(&s_async.mx);
+
+	return drained;
+}
+
+static bool async_pending(void)
+{
+	for (log_ring_t *ring = s_async.rings; ring != NULL; ring = ring->next) {
+		if (ring->tail != __atomic_load_n(&ring->head, __ATOMIC_SEQ_CST)) {
+			return true;
+		}
+	}
+	return false;
+}
+
+static void async_report_drops(void)
+{
+	time_t now = time(NULL);
+	if (s_async.dropped > 0 && now - s_async.reported >= DROP_REPORT_SEC) {
+		log_warning("logging, dropped %"PRIu64" messages", s_async.dropped);
+		s_async.dropped = 0;
+		s_async.reported = now;
+	}
+}
+
+static void *async_thread(void *arg)
+{
+	(void)arg;
+
+	rcu_register_thread();
+
+	while (true) {
+		bool drained = async_drain();
+
+		pthread_mutex_lock(&s_async.mx);
+		if (s_async.stop && !drained) {
+			pthread_mutex_unlock(&s_async.mx);
+			break;
+		}
+		if (!drained) {
+			__atomic_store_n(&s_async.sleeping, true, __ATOMIC_SEQ_CST);
+			if (!async_pending()) {
+				struct timespec ts;
+				clock_gettime(CLOCK_REALTIME, &ts);
+				ts.tv_sec += 1;
+				pthread_cond_timedwait(&s_async.cond, &s_async.mx, &ts);
+			}
+			__atomic_store_n(&s_async.sleeping, false, __ATOMIC_SEQ_CST);
+		}
+		pthread_mutex_unlock(&s_async.mx);
+
+		async_report_drops();
+	}
+
+	rcu_unregister_thread();
+
+	return NULL;
+}
+
+static void async_start(void)
+{
+	pthread_mutex_lock(&s_async.mx);
+	if (!s_async.running) {
+		s_async.stop = false;
+		if (pthread_create(&s_async.thread, NULL, async_thread, NULL) == 0) {
+			__atomic_store_n(&s_async.running, true, __ATOMIC_RELEASE);
+		}
+	}
+	pthread_mutex_unlock(&s_async.mx);
+}
+
+static void async_stop(void)
+{
+	pthread_mutex_lock(&s_async.mx);
+	if (!s_async.running) {
+		pthread_mutex_unlock(&s_async.mx);
+		return;
+	}
+	__atomic_store_n(&s_async.running, false, __ATOMIC_RELEASE);
+	pthread_mutex_unlock(&s_async.mx);
+
+	// Wait for the messages being queued, the writer drains them all.
+	synchronize_rcu();
+
+	pthread_mutex_lock(&s_async.mx);
+	s_async.stop = true;
+	pthread_cond_signal(&s_async.cond);
+	pthread_mutex_unlock(&s_async.mx);
+
+	pthread_join(s_async.thread, NULL);
+}
+
 static const char *level_prefix(int level)
 {
 	switch (level) {
@@ -326,6 +636,9 @@ static void log_msg_text(int level, log_source_t src, const char *zone,
 	char *write = buff;
 	size_t capacity = sizeof(buff);
 
+	struct timeval tv;
+	gettimeofday(&tv, NULL);
+
 	rcu_read_lock();
 
 	// Prefix error level.
@@ -340,12 +653,14 @@ static void log_msg_text(int level, log_source_t src, const char *zone,
 
 	// Prefix zone name.
 	size_t zone_len = 0;
+	const char *zone_copy = NULL;
 	if (zone != NULL) {
 		zone_len = strlen(zone);
 		if (zone_len > 0 && zone[zone_len - 1] == '.') {
 			zone_len--;
 		}
 
+		zone_copy = write + 1;
 		int ret = log_msg_add(&write, &capacity, "[%.*s.] ", (int)zone_len, zone);
 		if (ret != KNOT_EOK) {
 			rcu_read_unlock();
@@ -356,8 +671,16 @@ static void log_msg_text(int level, log_source_t src, const char *zone,
 	// Compile log message.
 	int ret = vsnprintf(write, capacity, fmt, args);
 	if (ret >= 0) {
-		// Send to logging targets.
-		emit_log_msg(level, src, zone, zone_len, buff, param);
+		log_t *log = s_log;
+		bool async = log->any_async && param == NULL &&
+		             __atomic_load_n(&s_async.running, __ATOMIC_ACQUIRE) &&
+		             async_wanted(log, level, src);
+
+		// Send to logging targets, possibly queue for the asynchronous ones.
+		emit_log_msg(log, &tv, level, src, zone, zone_len, buff, param, async, false);
+		if (async && !async_enqueue(&tv, level, src, buff, zone_copy, zone_len)) {
+			emit_log_msg(log, &tv, level, src, zone, zone_len, buff, param, true, true);
+		}
 	}
 
 	rcu_read_unlock();
@@ -429,7 +752,7 @@ static log_target_t get_logtype(const char *logname)
 	}
 }
 
-static int log_open_file(log_t *log, const char *filename)
+static int log_open_file(log_t *log, const char *filename, bool async)
 {
 	assert(LOG_TARGET_FILE + log->file_count < log->target_count);
 
@@ -439,8 +762,12 @@ static int log_open_file(log_t *log, const char *filename)
 		return knot_map_errno();
 	}
 
-	// Disable buffering.
-	setvbuf(log->file[log->file_count], NULL, _IONBF, 0);
+	// Disable buffering, unless flushed by the asynchronous writer.
+	if (async) {
+		setvbuf(log->file[log->file_count], NULL, _IOFBF, FILE_BUFLEN);
+	} else {
+		setvbuf(log->file[log->file_count], NULL, _IONBF, 0);
+	}
 
 	return LOG_TARGET_FILE + log->file_count++;
 }
@@ -477,16 +804,23 @@ void log_reconfigure(conf_t *conf)
 		conf_val_t id = conf_iter_id(conf, &iter);
 		const char *logname = conf_str(&id);
 
+		conf_val_t async_val = conf_id_get(conf, C_LOG, C_ASYNC, &id);
+		bool async = conf_bool(&async_val);
+
 		// Get target.
 		int target = get_logtype(logname);
 		if (target == LOG_TARGET_FILE) {
-			target = log_open_file(log, logname);
+			target = log_open_file(log, logname, async);
 			if (target < 0) {
 				log_error("failed to open log, file '%s' (%s)",
 				          logname, knot_strerror(target));
 				continue;
 			}
 		}
+		if (async) {
+			log->async[target] = true;
+			log->any_async = true;
+		}
 
 		conf_val_t levels_val;
 		unsigned levels;
@@ -517,7 +851,13 @@ void log_reconfigure(conf_t *conf)
 		sink_levels_add(log, target, LOG_SOURCE_ANY, levels);
 	}
 
+	if (!log->any_async) {
+		async_stop();
+	}
 	sink_publish(log);
+	if (log->any_async) {
+		async_start();
+	}
 }
 
 bool log_enabled_debug(void)
@@ -0,0 +1,45 @@
+/*  Copyright (C) 2024 CZ.NIC, z.s.p.o. <knot-dns@labs.nic.cz>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+/*!
+ * \brief Static tracing probes (USDT).
+ *
+ * The probes are compiled as no-op instructions with their locations stored
+ * in an ELF note, so they cost nothing until a tracer (bpftrace, SystemTap,
+ * perf) attaches to them, e.g.:
+ *
+ *   bpftrace -e 'usdt:/usr/sbin/knotd:knotd:query__done { @[arg1] = count(); }'
+ *
+ * Without USDT support (see --enable-usdt), the probes are left out.
+ */
+
+#pragma once
+
+#ifdef ENABLE_USDT
+#include <sys/sdt.h>
+
+#define KNOTD_PROBE(name)                DTRACE_PROBE(knotd, name)
+#define KNOTD_PROBE1(name, a)            DTRACE_PROBE1(knotd, name, a)
+#define KNOTD_PROBE2(name, a, b)         DTRACE_PROBE2(knotd, name, a, b)
+#define KNOTD_PROBE3(name, a, b, c)      DTRACE_PROBE3(knotd, name, a, b, c)
+#define KNOTD_PROBE4(name, a, b, c, d)   DTRACE_PROBE4(knotd, name, a, b, c, d)
+#else
+#define KNOTD_PROBE(name)
+#define KNOTD_PROBE1(name, a)
+#define KNOTD_PROBE2(name, a, b)
+#define KNOTD_PROBE3(name, a, b, c)
+#define KNOTD_PROBE4(name, a, b, c, d)
+#endif
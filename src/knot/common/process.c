@@ -90,7 +90,7 @@ static int pid_write(const char *filename, pid_t pid)
 
 	/* Create file. */
 	int ret = KNOT_EOK;
-	int fd = open(filename, O_RDWR | O_CREAT, S_IRUSR | S_IWUSR | S_IRGRP);
+	int fd = open(filename, O_RDWR | O_CREAT | O_TRUNC, S_IRUSR | S_IWUSR | S_IRGRP);
 	if (fd >= 0) {
 		if (write(fd, buf, len) != len) {
 			ret = knot_map_errno();
@@ -103,14 +103,18 @@ static int pid_write(const char *filename, pid_t pid)
 	return ret;
 }
 
-unsigned long pid_check_and_create(void)
+unsigned long pid_check_and_create(bool takeover)
 {
 	struct stat st;
 	char *pidfile = pid_filename();
 	pid_t pid = pid_read(pidfile);
 
 	/* Check PID for existence and liveness. */
-	if (pid > 0 && pid_running(pid)) {
+	if (takeover) {
+		if (pid > 0) {
+			log_info("taking over PID file '%s' from PID %d", pidfile, (int)pid);
+		}
+	} else if (pid > 0 && pid_running(pid)) {
 		log_fatal("server PID found, already running");
 		free(pidfile);
 		return 0;
@@ -26,10 +26,12 @@
 /*!
  * \brief Check if PID file exists and create it if possible.
  *
+ * \param takeover  Overwrite the PID file of a running server being replaced.
+ *
  * \retval 0 if failed.
  * \retval Current PID.
  */
-unsigned long pid_check_and_create(void);
+unsigned long pid_check_and_create(bool takeover);
 
 /*!
  * \brief Remove PID file.
@@ -0,0 +1,186 @@
+/*  Copyright (C) 2024 CZ.NIC, z.s.p.o. <knot-dns@labs.nic.cz>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include <pthread.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <urcu.h>
+
+#include "knot/common/reclaim.h"
+#include "contrib/atomic.h"
+#include "contrib/time.h"
+
+typedef struct reclaim_item {
+	struct rcu_head rcuhead;
+	struct reclaim_item *next;
+	knot_reclaim_t *rcl;
+	knot_reclaim_cb_t cb;
+	void *ptr;
+	struct timespec deferred;
+} reclaim_item_t;
+
+struct knot_reclaim {
+	pthread_t thread;
+	pthread_mutex_t mx;
+	pthread_cond_t cond;
+	reclaim_item_t *head;
+	reclaim_item_t *tail;
+	bool stop;
+	knot_atomic_uint64_t backlog;
+	knot_atomic_uint64_t gp_last; // Microseconds.
+	knot_atomic_uint64_t gp_max;
+};
+
+knot_reclaim_t *global_reclaim = NULL;
+
+static void *reclaim_thread(void *arg)
+{
+	knot_reclaim_t *rcl = arg;
+
+	pthread_mutex_lock(&rcl->mx);
+	while (true) {
+		while (rcl->head == NULL && !rcl->stop) {
+			pthread_cond_wait(&rcl->cond, &rcl->mx);
+		}
+		reclaim_item_t *item = rcl->head;
+		if (item == NULL) {
+			break; // Stopped and drained.
+		}
+		rcl->head = item->next;
+		if (rcl->head == NULL) {
+			rcl->tail = NULL;
+		}
+		pthread_mutex_unlock(&rcl->mx);
+
+		item->cb(item->ptr);
+		free(item);
+		ATOMIC_SUB(rcl->backlog, 1);
+
+		pthread_mutex_lock(&rcl->mx);
+	}
+	pthread_mutex_unlock(&rcl->mx);
+
+	return NULL;
+}
+
+static void reclaim_enqueue(struct rcu_head *param)
+{
+	reclaim_item_t *item = (reclaim_item_t *)param;
+	knot_reclaim_t *rcl = item->rcl;
+
+	if (rcl == NULL) {
+		item->cb(item->ptr);
+		free(item);
+		return;
+	}
+
+	struct timespec now = time_now();
+	uint64_t gp = time_diff_ms(&item->deferred, &now) * 1000;
+	ATOMIC_SET(rcl->gp_last, gp);
+	if (gp > ATOMIC_GET(rcl->gp_max)) {
+		ATOMIC_SET(rcl->gp_max, gp); // Only the call_rcu thread writes.
+	}
+
+	pthread_mutex_lock(&rcl->mx);
+	if (rcl->tail != NULL) {
+		rcl->tail->next = item;
+	} else {
+		rcl->head = item;
+	}
+	rcl->tail = item;
+	pthread_cond_signal(&rcl->cond);
+	pthread_mutex_unlock(&rcl->mx);
+}
+
+knot_reclaim_t *knot_reclaim_init(void)
+{
+	knot_reclaim_t *rcl = calloc(1, sizeof(*rcl));
+	if (rcl == NULL) {
+		return NULL;
+	}
+
+	pthread_mutex_init(&rcl->mx, NULL);
+	pthread_cond_init(&rcl->cond, NULL);
+	ATOMIC_INIT(rcl->backlog, 0);
+	ATOMIC_INIT(rcl->gp_last, 0);
+	ATOMIC_INIT(rcl->gp_max, 0);
+
+	if (pthread_create(&rcl->thread, NULL, reclaim_thread, rcl) != 0) {
+		pthread_cond_destroy(&rcl->cond);
+		pthread_mutex_destroy(&rcl->mx);
+		free(rcl);
+		return NULL;
+	}
+
+	return rcl;
+}
+
+void knot_reclaim_deinit(knot_reclaim_t **rcl)
+{
+	if (rcl == NULL || *rcl == NULL) {
+		return;
+	}
+
+	knot_reclaim_t *r = *rcl;
+	*rcl = NULL;
+
+	/* Let all the deferred objects reach the queue. */
+	rcu_barrier();
+
+	pthread_mutex_lock(&r->mx);
+	r->stop = true;
+	pthread_cond_signal(&r->cond);
+	pthread_mutex_unlock(&r->mx);
+
+	pthread_join(r->thread, NULL);
+
+	ATOMIC_DEINIT(r->backlog);
+	ATOMIC_DEINIT(r->gp_last);
+	ATOMIC_DEINIT(r->gp_max);
+	pthread_cond_destroy(&r->cond);
+	pthread_mutex_destroy(&r->mx);
+	free(r);
+}
+
+void knot_reclaim_defer(knot_reclaim_t *rcl, knot_reclaim_cb_t cb, void *ptr)
+{
+	reclaim_item_t *item = calloc(1, sizeof(*item));
+	if (item == NULL) {
+		synchronize_rcu();
+		cb(ptr);
+		return;
+	}
+	item->rcl = rcl;
+	item->cb = cb;
+	item->ptr = ptr;
+
+	if (rcl != NULL) {
+		item->deferred = time_now();
+		ATOMIC_ADD(rcl->backlog, 1);
+	}
+	call_rcu(&item->rcuhead, reclaim_enqueue);
+}
+
+uint64_t knot_reclaim_backlog(knot_reclaim_t *rcl)
+{
+	return (rcl == NULL) ? 0 : ATOMIC_GET(rcl->backlog);
+}
+
+void knot_reclaim_grace_period(knot_reclaim_t *rcl, uint64_t *last, uint64_t *max)
+{
+	*last = (rcl == NULL) ? 0 : ATOMIC_GET(rcl->gp_last);
+	*max = (rcl == NULL) ? 0 : ATOMIC_GET(rcl->gp_max);
+}
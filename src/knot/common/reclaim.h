@@ -0,0 +1,72 @@
+/*  Copyright (C) 2024 CZ.NIC, z.s.p.o. <knot-dns@labs.nic.cz>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <stdint.h>
+
+/*!
+ * \brief Callback freeing a deferred object.
+ */
+typedef void (*knot_reclaim_cb_t)(void *ptr);
+
+/*!
+ * \brief Background reclaimer of RCU-protected data.
+ *
+ * Objects are handed over after an RCU grace period to a dedicated thread,
+ * which frees them one by one, so that neither the caller nor the shared
+ * call_rcu thread is blocked by freeing large zone contents.
+ */
+typedef struct knot_reclaim knot_reclaim_t;
+
+extern knot_reclaim_t *global_reclaim;
+
+/*!
+ * \brief Start the reclaimer thread.
+ *
+ * \return Allocated reclaimer, or NULL.
+ */
+knot_reclaim_t *knot_reclaim_init(void);
+
+/*!
+ * \brief Free all pending objects and stop the reclaimer thread.
+ */
+void knot_reclaim_deinit(knot_reclaim_t **rcl);
+
+/*!
+ * \brief Free an object in the background once RCU readers release it.
+ *
+ * \note Without a reclaimer, the callback is called from the call_rcu thread.
+ *
+ * \param rcl   Reclaimer (can be NULL).
+ * \param cb    Callback freeing the object.
+ * \param ptr   Object to be freed.
+ */
+void knot_reclaim_defer(knot_reclaim_t *rcl, knot_reclaim_cb_t cb, void *ptr);
+
+/*!
+ * \brief Get the number of deferred objects not freed yet.
+ */
+uint64_t knot_reclaim_backlog(knot_reclaim_t *rcl);
+
+/*!
+ * \brief Get the RCU grace period latency of the deferred objects.
+ *
+ * \param rcl   Reclaimer (can be NULL).
+ * \param last  Output: latency of the last object in microseconds.
+ * \param max   Output: maximal observed latency in microseconds.
+ */
+void knot_reclaim_grace_period(knot_reclaim_t *rcl, uint64_t *last, uint64_t *max);
@@ -14,18 +14,32 @@
     along with this program.  If not, see <https://www.gnu.org/licenses/>.
  */
 
+#include <ctype.h>
 #include <inttypes.h>
+#include <poll.h>
+#include <sys/socket.h>
 #include <sys/stat.h>
 #include <time.h>
 #include <unistd.h>
 #include <urcu.h>
 
+#include "contrib/bufpool.h"
 #include "contrib/files.h"
+#include "contrib/net.h"
 #include "contrib/openbsd/strlcpy.h"
+#include "contrib/sockaddr.h"
 #include "contrib/threads.h"
 #include "knot/common/stats.h"
 #include "knot/common/log.h"
+#include "knot/common/reclaim.h"
+#include "knot/events/event_stats.h"
+#include "knot/journal/journal_stats.h"
 #include "knot/nameserver/query_module.h"
+#include "knot/nameserver/query_phases.h"
+#include "knot/nameserver/query_stats.h"
+#include "knot/nameserver/xfr_perf.h"
+#include "knot/zone/measure.h"
+#include "libknot/db/db_lmdb.h"
 #include "libknot/xdp.h"
 
 static uint64_t stats_get_counter(knot_atomic_uint64_t **stats_vals, uint32_t offset,
@@ -129,6 +143,21 @@ int stats_xdp(stats_dump_ctr_f fcn, stats_dump_ctx_t *ctx)
 	} \
 }
 
+/*! \brief Sum the busy-poll spinning time (microseconds) of the handler threads. */
+static uint64_t spin_time(const server_t *server, int type)
+{
+	const iohandler_t *handler = &server->handlers[type].handler;
+	if (handler->thread_spin == NULL) {
+		return 0;
+	}
+
+	uint64_t sum = 0;
+	for (unsigned i = 0; i < server->handlers[type].size; i++) {
+		sum += ATOMIC_GET(handler->thread_spin[i]);
+	}
+	return sum;
+}
+
 int stats_server(stats_dump_ctr_f fcn, stats_dump_ctx_t *ctx)
 {
 	stats_dump_params_t params = { .section = "server" };
@@ -138,6 +167,217 @@ int stats_server(stats_dump_ctr_f fcn, stats_dump_ctx_t *ctx)
 	}
 
 	DUMP_VAL(params, "zone-count", knot_zonedb_size(ctx->server->zone_db));
+	DUMP_VAL(params, "tcp-rejected", ATOMIC_GET(ctx->server->tcp_clients.rejected));
+	DUMP_VAL(params, "tcp-evicted", ATOMIC_GET(ctx->server->tcp_clients.evicted));
+	DUMP_VAL(params, "reclaim-backlog", knot_reclaim_backlog(global_reclaim));
+
+	/* Total busy-poll spinning time of the UDP and TCP workers. */
+	if (conf()->cache.srv_busypoll_spin > 0) {
+		DUMP_VAL(params, "udp-spin-time", spin_time(ctx->server, IO_UDP));
+		DUMP_VAL(params, "tcp-spin-time", spin_time(ctx->server, IO_TCP));
+	}
+
+	char id[SOCKADDR_STRLEN + 16];
+	params.id = id;
+
+	/* Current recvmmsg batch sizes of the UDP workers. */
+	const iohandler_t *udp = &ctx->server->handlers[IO_UDP].handler;
+	if (udp->thread_batch != NULL) {
+		params.item_begin = true;
+		for (unsigned i = 0; i < ctx->server->handlers[IO_UDP].size; i++) {
+			uint64_t batch = ATOMIC_GET(udp->thread_batch[i]);
+			if (batch == 0) {
+				continue; // Not a recvmmsg worker.
+			}
+			(void)snprintf(id, sizeof(id), "%u", i);
+			DUMP_VAL(params, "udp-batch", batch);
+		}
+	}
+
+	/* Datagrams dropped by the UDP sockets, accounted by the UDP workers. */
+	if (udp->thread_drops != NULL) {
+		params.item_begin = true;
+		for (unsigned i = 0; i < ctx->server->handlers[IO_UDP].size; i++) {
+			(void)snprintf(id, sizeof(id), "%u", i);
+			DUMP_VAL(params, "udp-drops", ATOMIC_GET(udp->thread_drops[i]));
+		}
+	}
+
+	/* Last drop counters reported by the kernel for each UDP socket. */
+	params.item_begin = true;
+	for (size_t i = 0; i < ctx->server->n_ifaces; i++) {
+		const iface_t *iface = &ctx->server->ifaces[i];
+		if (iface->drops_udp == NULL) {
+			continue;
+		}
+		char addr[SOCKADDR_STRLEN];
+		(void)sockaddr_tostr(addr, sizeof(addr), &iface->addr);
+		for (unsigned j = 0; j < iface->fd_udp_count; j++) {
+			(void)snprintf(id, sizeof(id), "%s#%u", addr, j);
+			DUMP_VAL(params, "udp-socket-drops", ATOMIC_GET(iface->drops_udp[j]));
+		}
+	}
+
+	return KNOT_EOK;
+}
+
+static const char *io_names[] = {
+	[IO_UDP] = "udp",
+	[IO_TCP] = "tcp",
+	[IO_XDP] = "xdp",
+};
+
+typedef enum {
+	THREAD_CPU_TIME,
+	THREAD_MEMORY,
+	THREAD_CONNS,
+	THREAD_QUEUED,
+} thread_stat_t;
+
+/*! \brief Get a per-thread value of the I/O worker. */
+static uint64_t io_thread_value(const iohandler_t *handler, unsigned i, thread_stat_t stat)
+{
+	switch (stat) {
+	case THREAD_CPU_TIME: return dt_cpu_time(handler->unit->threads[i]);
+	case THREAD_MEMORY:   return ATOMIC_GET(handler->thread_mem[i]);
+	case THREAD_CONNS:    return ATOMIC_GET(handler->thread_conns[i]);
+	default:              return 0;
+	}
+}
+
+/*! \brief Dump a per-thread value of the I/O and background workers. */
+static int dump_threads(stats_dump_ctr_f fcn, stats_dump_ctx_t *ctx,
+                        stats_dump_params_t *params, const char *item,
+                        thread_stat_t stat)
+{
+	char id[32];
+	params->id = id;
+	params->item_begin = true;
+
+	if (stat != THREAD_QUEUED) {
+		for (int type = IO_UDP; type <= IO_XDP; type++) {
+			const iohandler_t *handler = &ctx->server->handlers[type].handler;
+			for (unsigned i = 0; i < ctx->server->handlers[type].size; i++) {
+				(void)snprintf(id, sizeof(id), "%s-%u", io_names[type], i);
+				DUMP_VAL(*params, item, io_thread_value(handler, i, stat));
+			}
+		}
+	}
+
+	if (stat == THREAD_CPU_TIME || stat == THREAD_QUEUED) {
+		worker_pool_t *pool = ctx->server->workers;
+		for (unsigned i = 0; i < worker_pool_size(pool); i++) {
+			unsigned queued;
+			uint64_t cpu_time;
+			worker_pool_thread_status(pool, i, &queued, &cpu_time);
+			(void)snprintf(id, sizeof(id), "background-%u", i);
+			DUMP_VAL(*params, item, (stat == THREAD_CPU_TIME) ? cpu_time : queued);
+		}
+	}
+
+	params->id = NULL;
+
+	return KNOT_EOK;
+}
+
+/*! \brief Dump the usage or the map size of all shards of the LMDB databases. */
+static int dump_lmdb(stats_dump_ctr_f fcn, stats_dump_ctx_t *ctx,
+                     stats_dump_params_t *params, const char *item, bool usage)
+{
+	struct {
+		const char *name;
+		knot_lmdb_db_t *dbs;
+		unsigned count;
+	} lmdbs[] = {
+		{ "journal", ctx->server->journaldb, ctx->server->journaldb_shards },
+		{ "timer",   ctx->server->timerdb,   ctx->server->timerdb_shards },
+		{ "kasp",    &ctx->server->kaspdb,   1 },
+		{ "catalog", &ctx->server->catalog.db, 1 },
+	};
+
+	char id[32];
+	params->id = id;
+	params->item_begin = true;
+
+	for (unsigned i = 0; i < sizeof(lmdbs) / sizeof(lmdbs[0]); i++) {
+		for (unsigned j = 0; j < lmdbs[i].count; j++) {
+			knot_lmdb_db_t *db = &lmdbs[i].dbs[j];
+			if (!knot_lmdb_is_open(db)) {
+				continue;
+			}
+
+			uint64_t val = db->mapsize;
+			if (usage) {
+				knot_lmdb_txn_t txn = { 0 };
+				knot_lmdb_begin(db, &txn, false);
+				val = knot_lmdb_usage(&txn);
+				knot_lmdb_abort(&txn);
+			}
+
+			if (lmdbs[i].count > 1) {
+				(void)snprintf(id, sizeof(id), "%s-%u", lmdbs[i].name, j);
+			} else {
+				(void)snprintf(id, sizeof(id), "%s", lmdbs[i].name);
+			}
+			DUMP_VAL(*params, item, val);
+		}
+	}
+
+	// The configuration database isn't a knot_lmdb one.
+	conf_t *pconf = conf();
+	if (pconf->api == knot_db_lmdb_api()) {
+		params->id = "conf";
+		DUMP_VAL(*params, item, usage ? knot_db_lmdb_get_usage(pconf->db) :
+		                                knot_db_lmdb_get_mapsize(pconf->db));
+	}
+
+	params->id = NULL;
+
+	return KNOT_EOK;
+}
+
+int stats_runtime(stats_dump_ctr_f fcn, stats_dump_ctx_t *ctx)
+{
+	stats_dump_params_t params = { .section = "runtime" };
+
+	if (ctx->section != NULL && strcasecmp(ctx->section, params.section) != 0) {
+		return KNOT_EOK;
+	}
+
+#define DUMP_CALL(call) { \
+	int ret = (call); \
+	if (ret != KNOT_EOK) { \
+		return ret; \
+	} \
+}
+
+	/* Workers: CPU time, query memory high-water marks, connections, own queues. */
+	DUMP_CALL(dump_threads(fcn, ctx, &params, "cpu-time", THREAD_CPU_TIME));
+	DUMP_CALL(dump_threads(fcn, ctx, &params, "memory", THREAD_MEMORY));
+	DUMP_CALL(dump_threads(fcn, ctx, &params, "connections", THREAD_CONNS));
+	DUMP_CALL(dump_threads(fcn, ctx, &params, "queued", THREAD_QUEUED));
+
+	int running, queued;
+	worker_pool_status(ctx->server->workers, false, &running, &queued);
+	DUMP_VAL(params, "background-running", running);
+	DUMP_VAL(params, "background-queued", queued);
+
+	/* RCU grace period latency of the deferred frees (e.g. zone contents). */
+	uint64_t gp_last, gp_max;
+	knot_reclaim_grace_period(global_reclaim, &gp_last, &gp_max);
+	DUMP_VAL(params, "rcu-grace-period", gp_last);
+	DUMP_VAL(params, "rcu-grace-period-max", gp_max);
+
+	/* Databases. */
+	DUMP_CALL(dump_lmdb(fcn, ctx, &params, "db-usage", true));
+	DUMP_CALL(dump_lmdb(fcn, ctx, &params, "db-mapsize", false));
+
+	/* Buffer pool heap traffic. */
+	uint64_t allocs, frees;
+	bufpool_stats(&allocs, &frees);
+	DUMP_VAL(params, "bufpool-allocs", allocs);
+	DUMP_VAL(params, "bufpool-frees", frees);
+#undef DUMP_CALL
 
 	return KNOT_EOK;
 }
@@ -161,6 +401,122 @@ int stats_zone(stats_dump_ctr_f fcn, stats_dump_ctx_t *ctx)
 	DUMP_VAL(params, "size", contents != NULL ? contents->size : 0);
 	DUMP_VAL(params, "max-ttl", contents != NULL ? contents->max_ttl : 0);
 
+	measure_memory_t mem;
+	rcu_read_lock();
+	knot_measure_memory(rcu_dereference(ctx->zone->contents), &mem);
+	rcu_read_unlock();
+
+	DUMP_VAL(params, "memory", knot_measure_memory_total(&mem));
+	DUMP_VAL(params, "memory-nodes", mem.nodes);
+	DUMP_VAL(params, "memory-rdata", mem.rdata);
+	DUMP_VAL(params, "memory-additionals", mem.additionals);
+	DUMP_VAL(params, "memory-nsec3", mem.nsec3);
+	DUMP_VAL(params, "memory-binodes", mem.binodes);
+
+	return KNOT_EOK;
+}
+
+int stats_journal(stats_dump_ctr_f fcn, stats_dump_ctx_t *ctx)
+{
+	knot_dname_txt_storage_t zone;
+	stats_dump_params_t params = { .section = "journal" };
+
+	if (ctx->section != NULL && strcasecmp(ctx->section, params.section) != 0) {
+		return KNOT_EOK;
+	}
+
+	journal_stats_t *stats = &journal_stats;
+	if (ctx->zone != NULL) {
+		if (knot_dname_to_str(zone, ctx->zone->name, sizeof(zone)) == NULL) {
+			return KNOT_EINVAL;
+		}
+		params.zone = zone;
+		stats = &ctx->zone->journal_stats;
+	}
+
+	for (journal_stat_t i = 0; i < JOURNAL_STAT_COUNT; i++) {
+		DUMP_VAL(params, journal_stats_name(i), ATOMIC_GET(stats->ctr[i]));
+	}
+
+	for (journal_hist_t i = 0; i < JOURNAL_HIST_COUNT; i++) {
+		params.item_begin = true;
+		params.value_pos = 0;
+		for (unsigned j = 0; j < JOURNAL_HIST_BUCKETS; j++) {
+			params.id = journal_stats_bucket_name(j);
+			DUMP_VAL(params, journal_stats_hist_name(i), ATOMIC_GET(stats->hist[i][j]));
+			params.value_pos++;
+		}
+	}
+
+	return KNOT_EOK;
+}
+
+int stats_xfr(stats_dump_ctr_f fcn, stats_dump_ctx_t *ctx)
+{
+	knot_dname_txt_storage_t zone;
+	stats_dump_params_t params = { .section = "xfr" };
+
+	if (ctx->section != NULL && strcasecmp(ctx->section, params.section) != 0) {
+		return KNOT_EOK;
+	}
+
+	xfr_perf_t *perf = &xfr_perf;
+	if (ctx->zone != NULL) {
+		if (knot_dname_to_str(zone, ctx->zone->name, sizeof(zone)) == NULL) {
+			return KNOT_EINVAL;
+		}
+		params.zone = zone;
+		perf = &ctx->zone->xfr_perf;
+	}
+
+	for (xfr_perf_ctr_t i = 0; i < XFR_PERF_COUNT; i++) {
+		DUMP_VAL(params, xfr_perf_name(i), ATOMIC_GET(perf->ctr[i]));
+	}
+
+	return KNOT_EOK;
+}
+
+int stats_events(stats_dump_ctr_f fcn, stats_dump_ctx_t *ctx)
+{
+	knot_dname_txt_storage_t zone;
+	stats_dump_params_t params = { .section = "events" };
+
+	if (ctx->section != NULL && strcasecmp(ctx->section, params.section) != 0) {
+		return KNOT_EOK;
+	}
+
+	event_stats_t *stats = &event_stats;
+	if (ctx->zone != NULL) {
+		if (knot_dname_to_str(zone, ctx->zone->name, sizeof(zone)) == NULL) {
+			return KNOT_EINVAL;
+		}
+		params.zone = zone;
+		stats = &ctx->zone->event_stats;
+	}
+
+	for (zone_event_type_t i = 0; i < ZONE_EVENT_COUNT; i++) {
+		params.item_begin = true;
+		params.value_pos = 0;
+
+		params.id = "runs";
+		DUMP_VAL(params, zone_events_get_name(i), ATOMIC_GET(stats->runs[i]));
+		params.value_pos++;
+
+		for (event_hist_t j = 0; j < EVENT_HIST_COUNT; j++) {
+			params.id = event_stats_time_name(j);
+			DUMP_VAL(params, zone_events_get_name(i), ATOMIC_GET(stats->time[i][j]));
+			params.value_pos++;
+		}
+
+		for (event_hist_t j = 0; j < EVENT_HIST_COUNT; j++) {
+			for (unsigned k = 0; k < EVENT_HIST_BUCKETS; k++) {
+				params.id = event_stats_bucket_name(j, k);
+				DUMP_VAL(params, zone_events_get_name(i), ATOMIC_GET(stats->hist[i][j][k]));
+				params.value_pos++;
+			}
+		}
+	}
+
 	return KNOT_EOK;
 }
 
@@ -209,6 +565,40 @@ static int stats_counters(stats_dump_ctr_f fcn, stats_dump_ctx_t *ctx,
 	return KNOT_EOK;
 }
 
+typedef struct {
+	stats_dump_ctr_f fcn;
+	stats_dump_ctx_t *ctx;
+	stats_dump_params_t *params;
+} dynamic_ctx_t;
+
+static int stats_dynamic_item(const char *idx_name, uint64_t val, void *data)
+{
+	dynamic_ctx_t *dyn = data;
+	stats_dump_ctr_f fcn = dyn->fcn;
+	stats_dump_ctx_t *ctx = dyn->ctx;
+
+	dyn->params->id = idx_name;
+	DUMP_VAL(*dyn->params, dyn->params->item, val);
+	dyn->params->value_pos++;
+
+	return KNOT_EOK;
+}
+
+static int stats_dynamic(stats_dump_ctr_f fcn, stats_dump_ctx_t *ctx,
+                         stats_dump_params_t *params, knotd_mod_t *mod, mod_ctr_t *ctr)
+{
+	params->item = ctr->name;
+	params->value_pos = 0;
+	params->item_begin = true;
+
+	dynamic_ctx_t dyn = { fcn, ctx, params };
+	int ret = ctr->dump(mod, ctr - mod->stats_info, stats_dynamic_item, &dyn);
+
+	params->id = NULL;
+
+	return ret;
+}
+
 int stats_modules(stats_dump_ctr_f fcn, stats_dump_ctx_t *ctx)
 {
 	if (ctx->section != NULL && strncasecmp(ctx->section, "mod-", strlen("mod-")) != 0) {
@@ -246,7 +636,9 @@ int stats_modules(stats_dump_ctr_f fcn, stats_dump_ctx_t *ctx)
 				// Empty counter.
 				continue;
 			}
-			int ret = (ctr->count == 1) ?
+			int ret = (ctr->dump != NULL) ?
+			          stats_dynamic(fcn, ctx, &params, mod, ctr) :
+			          (ctr->count == 1) ?
 			          stats_counter(fcn, ctx, &params, mod, ctr) :
 			          stats_counters(fcn, ctx, &params, mod, ctr);
 			if (ret != KNOT_EOK) {
@@ -258,11 +650,33 @@ int stats_modules(stats_dump_ctr_f fcn, stats_dump_ctx_t *ctx)
 	return KNOT_EOK;
 }
 
+int stats_shared_modules(stats_dump_ctr_f fcn, stats_dump_ctx_t *ctx)
+{
+	server_t *server = ctx->server;
+	const list_t *query_modules = ctx->query_modules;
+
+	pthread_mutex_lock(&server->shared_mods.lock);
+	ctx->query_modules = &server->shared_mods.list;
+	int ret = stats_modules(fcn, ctx);
+	pthread_mutex_unlock(&server->shared_mods.lock);
+
+	ctx->query_modules = query_modules;
+
+	return ret;
+}
+
+#define HTTP_TIMEOUT	5	// Seconds.
+#define HTTP_BUFFER	65536	// Output stream buffer size.
+
 struct {
 	bool active_dumper;
 	pthread_t dumper;
 	uint32_t timer;
 	server_t *server;
+	bool active_http;
+	pthread_t http;
+	int http_sock;
+	struct sockaddr_storage http_addr;
 } stats = { 0 };
 
 typedef struct {
@@ -370,14 +784,34 @@ static void dump_to_file(conf_t *conf, FILE *fd, server_t *server)
 	// Dump server counters.
 	(void)stats_server(dump_ctr, &dump_ctx);
 
+	// Dump runtime counters.
+	ctx = (dump_ctx_t){ .fd = fd };
+	(void)stats_runtime(dump_ctr, &dump_ctx);
+
 	// Dump XDP counters.
 	ctx = (dump_ctx_t){ .fd = fd };
 	(void)stats_xdp(dump_ctr, &dump_ctx);
 
+	// Dump journal counters.
+	ctx = (dump_ctx_t){ .fd = fd };
+	(void)stats_journal(dump_ctr, &dump_ctx);
+
+	// Dump zone transfer counters.
+	ctx = (dump_ctx_t){ .fd = fd };
+	(void)stats_xfr(dump_ctr, &dump_ctx);
+
+	// Dump zone event counters.
+	ctx = (dump_ctx_t){ .fd = fd };
+	(void)stats_events(dump_ctr, &dump_ctx);
+
 	// Dump global module counters.
 	ctx = (dump_ctx_t){ .fd = fd };
 	(void)stats_modules(dump_ctr, &dump_ctx);
 
+	// Dump shared zone module counters.
+	ctx = (dump_ctx_t){ .fd = fd };
+	(void)stats_shared_modules(dump_ctr, &dump_ctx);
+
 	// Dump per zone module counters (fixed zone counters not included).
 	ctx = (dump_ctx_t){ .fd = fd };
 	knot_zonedb_foreach(server->zone_db, zone_stats_dump, &dump_ctx);
@@ -456,6 +890,269 @@ static void *dumper(void *data)
 	return NULL;
 }
 
+static void http_print_name(FILE *out, const char *section, const char *item)
+{
+	fputs("knot_", out);
+	for (const char *c = section; *c != '\0'; c++) {
+		fputc(isalnum((unsigned char)*c) ? *c : '_', out);
+	}
+	fputc('_', out);
+	for (const char *c = item; *c != '\0'; c++) {
+		fputc(isalnum((unsigned char)*c) ? *c : '_', out);
+	}
+}
+
+static void http_print_label(FILE *out, bool first, const char *name, const char *value)
+{
+	fprintf(out, "%s%s=\"", first ? "{" : ",", name);
+	for (const char *c = value; *c != '\0'; c++) {
+		switch (*c) {
+		case '\\': fputs("\\\\", out); break;
+		case '"':  fputs("\\\"", out); break;
+		case '\n': fputs("\\n", out); break;
+		default:   fputc(*c, out); break;
+		}
+	}
+	fputc('"', out);
+}
+
+static int http_dump_ctr(stats_dump_params_t *params, stats_dump_ctx_t *dump_ctx)
+{
+	FILE *out = dump_ctx->ctx;
+
+	if (params->value == 0) {
+		return KNOT_EOK;
+	}
+
+	http_print_name(out, params->section, params->item);
+	if (params->zone != NULL) {
+		http_print_label(out, true, "zone", params->zone);
+	}
+	if (params->id != NULL) {
+		http_print_label(out, params->zone == NULL, "id", params->id);
+	}
+	fprintf(out, "%s %"PRIu64"\n",
+	        (params->zone != NULL || params->id != NULL) ? "}" : "", params->value);
+
+	return ferror(out) ? KNOT_ECONN : KNOT_EOK;
+}
+
+static void http_dump_histograms(FILE *out, conf_t *conf)
+{
+	static const char *names[QUERY_HIST_COUNT] = {
+		[QUERY_HIST_LATENCY] = "knot_query_latency_microseconds",
+		[QUERY_HIST_SIZE]    = "knot_response_size_bytes",
+	};
+
+	const char *groups[QUERY_STATS_GROUPS];
+	query_stats_group_names(conf, groups);
+
+	for (query_hist_t hist = 0; hist < QUERY_HIST_COUNT; hist++) {
+		fprintf(out, "# TYPE %s histogram\n", names[hist]);
+		for (knotd_query_proto_t proto = 0; proto < QUERY_STATS_PROTOS; proto++) {
+			for (unsigned group = 0; group < QUERY_STATS_GROUPS; group++) {
+				if (groups[group] == NULL ||
+				    query_stats_sum(proto, group, QUERY_HIST_LATENCY) == 0) {
+					continue;
+				}
+
+				uint64_t count = 0;
+				for (unsigned i = 0; i < QUERY_STATS_BUCKETS; i++) {
+					count += query_stats_bucket(proto, group, hist, i);
+					fprintf(out, "%s_bucket", names[hist]);
+					http_print_label(out, true, "protocol", query_stats_proto_name(proto));
+					http_print_label(out, false, "group", groups[group]);
+					uint64_t limit = query_stats_bucket_limit(hist, i);
+					if (limit == UINT64_MAX) {
+						fprintf(out, ",le=\"+Inf\"} %"PRIu64"\n", count);
+					} else {
+						fprintf(out, ",le=\"%"PRIu64"\"} %"PRIu64"\n", limit, count);
+					}
+				}
+
+				fprintf(out, "%s_sum", names[hist]);
+				http_print_label(out, true, "protocol", query_stats_proto_name(proto));
+				http_print_label(out, false, "group", groups[group]);
+				fprintf(out, "} %"PRIu64"\n", query_stats_sum(proto, group, hist));
+
+				fprintf(out, "%s_count", names[hist]);
+				http_print_label(out, true, "protocol", query_stats_proto_name(proto));
+				http_print_label(out, false, "group", groups[group]);
+				fprintf(out, "} %"PRIu64"\n", count);
+			}
+		}
+	}
+}
+
+static void http_zone_dump(zone_t *zone, stats_dump_ctx_t *dump_ctx)
+{
+	if (EMPTY_LIST(zone->query_modules) || ferror((FILE *)dump_ctx->ctx)) {
+		return;
+	}
+
+	dump_ctx->zone = zone;
+	dump_ctx->query_modules = &zone->query_modules;
+
+	(void)stats_modules(http_dump_ctr, dump_ctx);
+}
+
+static void http_dump(conf_t *conf, FILE *out, server_t *server)
+{
+	stats_dump_ctx_t dump_ctx = {
+		.server = server,
+		.query_modules = conf->query_modules,
+		.ctx = out,
+	};
+
+	// Stream the metrics as they are collected, no snapshot is made.
+	if (stats_server(http_dump_ctr, &dump_ctx) != KNOT_EOK ||
+	    stats_runtime(http_dump_ctr, &dump_ctx) != KNOT_EOK ||
+	    stats_xdp(http_dump_ctr, &dump_ctx) != KNOT_EOK ||
+	    stats_journal(http_dump_ctr, &dump_ctx) != KNOT_EOK ||
+	    stats_xfr(http_dump_ctr, &dump_ctx) != KNOT_EOK ||
+	    stats_events(http_dump_ctr, &dump_ctx) != KNOT_EOK ||
+	    stats_modules(http_dump_ctr, &dump_ctx) != KNOT_EOK ||
+	    stats_shared_modules(http_dump_ctr, &dump_ctx) != KNOT_EOK) {
+		return;
+	}
+
+	if (query_stats_active()) {
+		http_dump_histograms(out, conf);
+	}
+
+	// Per zone module counters (fixed zone counters not included).
+	knot_zonedb_foreach(server->zone_db, http_zone_dump, &dump_ctx);
+}
+
+static void http_serve(int fd, server_t *server)
+{
+	struct timeval tv = { .tv_sec = HTTP_TIMEOUT };
+	(void)setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+	(void)setsockopt(fd, SOL_SOCKET, SO_SNDTIMEO, &tv, sizeof(tv));
+
+	// Only the request line is needed, the rest of the header is ignored.
+	char req[1024];
+	size_t len = 0;
+	while (len < sizeof(req) - 1) {
+		ssize_t ret = recv(fd, req + len, sizeof(req) - 1 - len, 0);
+		if (ret <= 0) {
+			close(fd);
+			return;
+		}
+		len += ret;
+		req[len] = '\0';
+		if (strstr(req, "\r\n\r\n") != NULL || strstr(req, "\n\n") != NULL) {
+			break;
+		}
+	}
+	req[len] = '\0';
+
+	FILE *out = fdopen(fd, "w");
+	if (out == NULL) {
+		close(fd);
+		return;
+	}
+	(void)setvbuf(out, NULL, _IOFBF, HTTP_BUFFER);
+
+	const char *path = req + strlen("GET ");
+	if (strncmp(req, "GET ", strlen("GET ")) != 0) {
+		fputs("HTTP/1.0 405 Method Not Allowed\r\n"
+		      "Allow: GET\r\n"
+		      "Connection: close\r\n\r\n", out);
+	} else if (strncmp(path, "/metrics", strlen("/metrics")) != 0 ||
+	           strchr(" ?", path[strlen("/metrics")]) == NULL) {
+		fputs("HTTP/1.0 404 Not Found\r\n"
+		      "Connection: close\r\n\r\n", out);
+	} else {
+		// No content length, the body is terminated by the connection close.
+		fputs("HTTP/1.0 200 OK\r\n"
+		      "Content-Type: text/plain; version=0.0.4; charset=utf-8\r\n"
+		      "Connection: close\r\n\r\n", out);
+
+		rcu_read_lock();
+		http_dump(conf(), out, server);
+		rcu_read_unlock();
+	}
+
+	fclose(out);
+}
+
+static void *http_server(void *data)
+{
+	rcu_register_thread();
+	while (true) {
+		struct pollfd pfd = { .fd = stats.http_sock, .events = POLLIN };
+		if (poll(&pfd, 1, -1) <= 0) {
+			continue;
+		}
+
+		int fd = accept(stats.http_sock, NULL, NULL);
+		if (fd < 0) {
+			continue;
+		}
+
+		pthread_setcancelstate(PTHREAD_CANCEL_DISABLE, NULL);
+		http_serve(fd, stats.server);
+		pthread_setcancelstate(PTHREAD_CANCEL_ENABLE, NULL);
+	}
+	rcu_unregister_thread();
+	return NULL;
+}
+
+static void http_stop(void)
+{
+	if (stats.active_http) {
+		pthread_cancel(stats.http);
+		pthread_join(stats.http, NULL);
+		close(stats.http_sock);
+		stats.active_http = false;
+	}
+}
+
+static void http_reconfigure(conf_t *conf)
+{
+	conf_val_t val = conf_get(conf, C_STATS, C_LISTEN);
+	if (val.code != KNOT_EOK) {
+		http_stop();
+		return;
+	}
+
+	struct sockaddr_storage addr = conf_addr(&val, NULL);
+	if (stats.active_http && sockaddr_cmp(&addr, &stats.http_addr, false) == 0) {
+		return;
+	}
+	http_stop();
+
+	char addr_str[SOCKADDR_STRLEN] = { 0 };
+	sockaddr_tostr(addr_str, sizeof(addr_str), &addr);
+
+	int sock = net_bound_socket(SOCK_STREAM, &addr, NET_BIND_NONLOCAL, 0);
+	if (sock < 0) {
+		log_error("stats, failed to bind metrics endpoint %s (%s)",
+		          addr_str, knot_strerror(sock));
+		return;
+	}
+	if (listen(sock, 16) != 0) {
+		log_error("stats, failed to listen on metrics endpoint %s (%s)",
+		          addr_str, knot_strerror(knot_map_errno()));
+		close(sock);
+		return;
+	}
+
+	stats.http_sock = sock;
+	int ret = thread_create_nosignal(&stats.http, http_server, NULL);
+	if (ret != 0) {
+		log_error("stats, failed to launch metrics endpoint (%s)",
+		          knot_strerror(knot_map_errno_code(ret)));
+		close(sock);
+		return;
+	}
+	stats.http_addr = addr;
+	stats.active_http = true;
+
+	log_info("stats, metrics endpoint listening on %s", addr_str);
+}
+
 void stats_reconfigure(conf_t *conf, server_t *server)
 {
 	if (conf == NULL || server == NULL) {
@@ -464,7 +1161,22 @@ void stats_reconfigure(conf_t *conf, server_t *server)
 
 	stats.server = server;
 
-	conf_val_t val = conf_get(conf, C_STATS, C_TIMER);
+	conf_val_t val = conf_get(conf, C_STATS, C_HISTOGRAMS);
+	if (conf_bool(&val)) {
+		unsigned threads = conf->cache.srv_udp_threads + conf->cache.srv_tcp_threads +
+		                   conf->cache.srv_xdp_threads;
+		int ret = query_stats_enable(threads);
+		if (ret != KNOT_EOK) {
+			log_error("stats, failed to enable query histograms (%s)",
+			          knot_strerror(ret));
+		}
+	} else {
+		query_stats_disable();
+	}
+
+	http_reconfigure(conf);
+
+	val = conf_get(conf, C_STATS, C_TIMER);
 	stats.timer = conf_int(&val);
 	if (stats.timer > 0) {
 		// Check if dumping is already running.
@@ -494,5 +1206,9 @@ void stats_deinit(void)
 		pthread_join(stats.dumper, NULL);
 	}
 
+	http_stop();
+	query_stats_deinit();
+	query_phases_deinit();
+
 	memset(&stats, 0, sizeof(stats));
 }
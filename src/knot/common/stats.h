@@ -70,16 +70,41 @@ int stats_xdp(stats_dump_ctr_f fcn, stats_dump_ctx_t *ctx);
  */
 int stats_server(stats_dump_ctr_f fcn, stats_dump_ctx_t *ctx);
 
+/*!
+ * \brief Runtime metrics (workers, memory, RCU, databases).
+ */
+int stats_runtime(stats_dump_ctr_f fcn, stats_dump_ctx_t *ctx);
+
 /*!
  * \brief Zone metrics.
  */
 int stats_zone(stats_dump_ctr_f fcn, stats_dump_ctx_t *ctx);
 
+/*!
+ * \brief Journal metrics, global or of the zone if specified.
+ */
+int stats_journal(stats_dump_ctr_f fcn, stats_dump_ctx_t *ctx);
+
+/*!
+ * \brief Zone transfer metrics, global or of the zone if specified.
+ */
+int stats_xfr(stats_dump_ctr_f fcn, stats_dump_ctx_t *ctx);
+
+/*!
+ * \brief Zone event latency metrics, global or of the zone if specified.
+ */
+int stats_events(stats_dump_ctr_f fcn, stats_dump_ctx_t *ctx);
+
 /*!
  * \brief Modules metrics.
  */
 int stats_modules(stats_dump_ctr_f fcn, stats_dump_ctx_t *ctx);
 
+/*!
+ * \brief Metrics of zone modules shared among zones.
+ */
+int stats_shared_modules(stats_dump_ctr_f fcn, stats_dump_ctx_t *ctx);
+
 /*!
  * \brief Reconfigures the statistics facility.
  */
@@ -22,7 +22,9 @@
 #include "knot/conf/module.h"
 #include "knot/conf/tools.h"
 #include "knot/common/log.h"
+#include "knot/nameserver/answer_cache.h"
 #include "knot/nameserver/query_module.h"
+#include "knot/updates/acl.h"
 #include "libknot/libknot.h"
 #include "libknot/yparser/ypformat.h"
 #include "libknot/yparser/yptrafo.h"
@@ -87,9 +89,18 @@ int conf_refresh_txn(
 	}
 
 	// Close previously opened transaction.
+	conf_db_snapshot_free(conf);
 	conf->api->txn_abort(&conf->read_txn);
 
-	return conf->api->txn_begin(conf->db, &conf->read_txn, KNOT_DB_RDONLY);
+	int ret = conf->api->txn_begin(conf->db, &conf->read_txn, KNOT_DB_RDONLY);
+	if (ret != KNOT_EOK) {
+		return ret;
+	}
+
+	// Without the snapshot, lookups just fall back to the DB.
+	(void)conf_db_snapshot(conf);
+
+	return KNOT_EOK;
 }
 
 static void refresh_hostname(
@@ -125,7 +136,12 @@ static void init_cache(
 
 	static bool   first_init = true;
 	static bool   running_tcp_reuseport;
+	static bool   running_tcp_defer_accept;
 	static bool   running_socket_affinity;
+	static bool   running_numa_affinity;
+	static bool   running_udp_offload;
+	static bool   running_udp_adaptive_batch;
+	static size_t running_udp_rcvbuf_max;
 	static bool   running_xdp_udp;
 	static bool   running_xdp_tcp;
 	static uint16_t running_xdp_quic;
@@ -133,6 +149,14 @@ static void init_cache(
 	static uint16_t running_ring_size;
 	static uint16_t running_busypoll_budget;
 	static uint16_t running_busypoll_timeout;
+	static uint16_t running_srv_busypoll_budget;
+	static uint16_t running_srv_busypoll_timeout;
+	static uint16_t running_srv_busypoll_spin;
+	static uint32_t running_srv_answer_cache;
+	static bool   running_multi_buffer;
+	static bool   running_shared_umem;
+	static uint32_t running_rrl_instant_limit;
+	static uint32_t running_rrl_rate_limit;
 	static size_t running_udp_threads;
 	static size_t running_tcp_threads;
 	static size_t running_xdp_threads;
@@ -143,7 +167,12 @@ static void init_cache(
 
 	if (first_init || reinit_cache) {
 		running_tcp_reuseport = conf_get_bool(conf, C_SRV, C_TCP_REUSEPORT);
+		running_tcp_defer_accept = conf_get_bool(conf, C_SRV, C_TCP_DEFER_ACCEPT);
 		running_socket_affinity = conf_get_bool(conf, C_SRV, C_SOCKET_AFFINITY);
+		running_numa_affinity = conf_get_bool(conf, C_SRV, C_NUMA_AFFINITY);
+		running_udp_offload = conf_get_bool(conf, C_SRV, C_UDP_OFFLOAD);
+		running_udp_adaptive_batch = conf_get_bool(conf, C_SRV, C_UDP_ADAPTIVE_BATCH);
+		running_udp_rcvbuf_max = conf_get_int(conf, C_SRV, C_UDP_RCVBUF_MAX);
 		running_xdp_udp = conf_get_bool(conf, C_XDP, C_UDP);
 		running_xdp_tcp = conf_get_bool(conf, C_XDP, C_TCP);
 		running_xdp_quic = 0;
@@ -154,6 +183,14 @@ static void init_cache(
 		running_ring_size = conf_get_int(conf, C_XDP, C_RING_SIZE);
 		running_busypoll_budget = conf_get_int(conf, C_XDP, C_BUSYPOLL_BUDGET);
 		running_busypoll_timeout = conf_get_int(conf, C_XDP, C_BUSYPOLL_TIMEOUT);
+		running_srv_busypoll_budget = conf_get_int(conf, C_SRV, C_BUSYPOLL_BUDGET);
+		running_srv_busypoll_timeout = conf_get_int(conf, C_SRV, C_BUSYPOLL_TIMEOUT);
+		running_srv_busypoll_spin = conf_get_int(conf, C_SRV, C_BUSYPOLL_SPIN);
+		running_srv_answer_cache = conf_get_int(conf, C_SRV, C_ANS_CACHE);
+		running_multi_buffer = conf_get_bool(conf, C_XDP, C_MULTI_BUFFER);
+		running_shared_umem = conf_get_bool(conf, C_XDP, C_SHARED_UMEM);
+		running_rrl_instant_limit = conf_get_int(conf, C_XDP, C_RRL_INST_LIMIT);
+		running_rrl_rate_limit = conf_get_int(conf, C_XDP, C_RRL_RATE_LIMIT);
 		running_udp_threads = conf_udp_threads(conf);
 		running_tcp_threads = conf_tcp_threads(conf);
 		running_xdp_threads = conf_xdp_threads(conf);
@@ -189,6 +226,15 @@ static void init_cache(
 	val = conf_get(conf, C_SRV, C_TCP_FASTOPEN);
 	conf->cache.srv_tcp_fastopen = conf_bool(&val);
 
+	val = conf_get(conf, C_SRV, C_TCP_ZEROCOPY);
+	conf->cache.srv_tcp_zerocopy = conf_bool(&val);
+
+	val = conf_get(conf, C_SRV, C_TCP_OUT_OF_ORDER);
+	conf->cache.srv_tcp_out_of_order = conf_bool(&val);
+
+	val = conf_get(conf, C_SRV, C_KTLS);
+	conf->cache.srv_ktls = conf_bool(&val);
+
 	conf->cache.srv_quic_max_clients = running_quic_clients;
 
 	conf->cache.srv_quic_idle_close = running_quic_idle;
@@ -197,8 +243,26 @@ static void init_cache(
 
 	conf->cache.srv_tcp_reuseport = running_tcp_reuseport;
 
+	conf->cache.srv_tcp_defer_accept = running_tcp_defer_accept;
+
 	conf->cache.srv_socket_affinity = running_socket_affinity;
 
+	conf->cache.srv_numa_affinity = running_numa_affinity;
+
+	conf->cache.srv_udp_offload = running_udp_offload;
+
+	conf->cache.srv_udp_adaptive_batch = running_udp_adaptive_batch;
+
+	conf->cache.srv_udp_rcvbuf_max = running_udp_rcvbuf_max;
+
+	conf->cache.srv_busypoll_budget = running_srv_busypoll_budget;
+
+	conf->cache.srv_busypoll_timeout = running_srv_busypoll_timeout;
+
+	conf->cache.srv_busypoll_spin = running_srv_busypoll_spin;
+
+	conf->cache.srv_answer_cache = running_srv_answer_cache;
+
 	val = conf_get(conf, C_SRV, C_DBUS_EVENT);
 	while (val.code == KNOT_EOK) {
 		conf->cache.srv_dbus_event |= conf_opt(&val);
@@ -215,6 +279,9 @@ static void init_cache(
 
 	conf->cache.srv_tcp_max_clients = conf_tcp_max_clients(conf);
 
+	val = conf_get(conf, C_SRV, C_TCP_PREFIX_MAX_CLIENTS);
+	conf->cache.srv_tcp_prefix_max_clients = conf_int(&val);
+
 	val = conf_get(conf, C_XDP, C_TCP_MAX_CLIENTS);
 	conf->cache.xdp_tcp_max_clients = conf_int(&val);
 
@@ -247,6 +314,14 @@ static void init_cache(
 
 	conf->cache.xdp_busypoll_timeout = running_busypoll_timeout;
 
+	conf->cache.xdp_multi_buffer = running_multi_buffer;
+
+	conf->cache.xdp_shared_umem = running_shared_umem;
+
+	conf->cache.xdp_rrl_instant_limit = running_rrl_instant_limit;
+
+	conf->cache.xdp_rrl_rate_limit = running_rrl_rate_limit;
+
 	val = conf_get(conf, C_CTL, C_TIMEOUT);
 	conf->cache.ctl_timeout = conf_int(&val) * 1000;
 	/* infinite_adjust() call isn't needed, 0 is adjusted later anyway. */
@@ -264,12 +339,31 @@ static void init_cache(
 		conf->cache.srv_nsid_data = conf_bin(&val, &conf->cache.srv_nsid_len);
 	}
 
+	free(conf->cache.srv_nsid_opt);
+	conf->cache.srv_nsid_opt = NULL;
+	conf->cache.srv_nsid_opt_len = 0;
+	size_t nsid_opt_len = KNOT_EDNS_OPTION_HDRLEN + conf->cache.srv_nsid_len;
+	if (conf->cache.srv_nsid_len > 0 && nsid_opt_len <= UINT16_MAX) {
+		conf->cache.srv_nsid_opt = malloc(nsid_opt_len);
+		if (conf->cache.srv_nsid_opt != NULL) {
+			uint8_t *opt = conf->cache.srv_nsid_opt;
+			knot_wire_write_u16(opt, KNOT_EDNS_OPTION_NSID);
+			knot_wire_write_u16(opt + sizeof(uint16_t), conf->cache.srv_nsid_len);
+			memcpy(opt + KNOT_EDNS_OPTION_HDRLEN, conf->cache.srv_nsid_data,
+			       conf->cache.srv_nsid_len);
+			conf->cache.srv_nsid_opt_len = nsid_opt_len;
+		}
+	}
+
 	val = conf_get(conf, C_SRV, C_ECS);
 	conf->cache.srv_ecs = conf_bool(&val);
 
 	val = conf_get(conf, C_SRV, C_ANS_ROTATION);
 	conf->cache.srv_ans_rotate = conf_bool(&val);
 
+	val = conf_get(conf, C_SRV, C_UDP_TRUNC_LEARN);
+	conf->cache.srv_udp_trunc_learn = conf_bool(&val);
+
 	val = conf_get(conf, C_SRV, C_AUTO_ACL);
 	conf->cache.srv_auto_acl = conf_bool(&val);
 
@@ -291,6 +385,9 @@ static void init_cache(
 		conf->cache.srv_has_version = false;
 		conf->cache.srv_version = "Knot DNS " PACKAGE_VERSION;
 	}
+
+	acl_rules_free(conf->acl_rules);
+	conf->acl_rules = acl_rules_compile(conf);
 }
 
 int conf_new(
@@ -506,6 +603,7 @@ conf_t *conf_update(
 
 	conf_t **current_conf = &s_conf;
 	conf_t *old_conf = rcu_xchg_pointer(current_conf, conf);
+	answer_cache_invalidate();
 
 	synchronize_rcu();
 
@@ -540,6 +638,9 @@ void conf_free(
 	yp_schema_free(conf->schema);
 	free(conf->filename);
 	free(conf->hostname);
+	free(conf->cache.srv_nsid_opt);
+	acl_rules_free(conf->acl_rules);
+	conf_db_snapshot_free(conf);
 	if (conf->api != NULL) {
 		conf->api->txn_abort(&conf->read_txn);
 	}
@@ -823,18 +924,28 @@ int conf_import(
 		goto import_error;
 	}
 
-	// Initialize the DB.
-	ret = conf_db_init(conf, &txn, !(flags & IMPORT_NO_PURGE));
-	if (ret != KNOT_EOK) {
-		conf->api->txn_abort(&txn);
-		goto import_error;
-	}
+	// Binary snapshot is loaded as is, without parsing.
+	bool binary = (flags & IMPORT_FILE) && conf_db_is_bin(input);
+	if (binary) {
+		ret = conf_db_import_bin(conf, &txn, input, !(flags & IMPORT_NO_PURGE));
+		if (ret != KNOT_EOK) {
+			conf->api->txn_abort(&txn);
+			goto import_error;
+		}
+	} else {
+		// Initialize the DB.
+		ret = conf_db_init(conf, &txn, !(flags & IMPORT_NO_PURGE));
+		if (ret != KNOT_EOK) {
+			conf->api->txn_abort(&txn);
+			goto import_error;
+		}
 
-	// Parse and import given file.
-	ret = conf_parse(conf, &txn, input, flags & IMPORT_FILE);
-	if (ret != KNOT_EOK) {
-		conf->api->txn_abort(&txn);
-		goto import_error;
+		// Parse and import given file.
+		ret = conf_parse(conf, &txn, input, flags & IMPORT_FILE);
+		if (ret != KNOT_EOK) {
+			conf->api->txn_abort(&txn);
+			goto import_error;
+		}
 	}
 	// Load purge must be here as conf_parse may be called recursively!
 	conf_mod_load_purge(conf, false);
@@ -851,6 +962,22 @@ int conf_import(
 		goto import_error;
 	}
 
+	// Load explicit modules, normally loaded during parsing.
+	if (binary) {
+		for (conf_iter_t iter = conf_iter(conf, C_MODULE);
+		     iter.code == KNOT_EOK; conf_iter_next(conf, &iter)) {
+			conf_val_t id = conf_iter_id(conf, &iter);
+			conf_val_t file = conf_id_get(conf, C_MODULE, C_FILE, &id);
+			ret = conf_mod_load_extra(conf, conf_str(&id), conf_str(&file),
+			                          MOD_EXPLICIT);
+			if (ret != KNOT_EOK) {
+				conf_iter_finish(conf, &iter);
+				goto import_error;
+			}
+		}
+		conf_mod_load_purge(conf, false);
+	}
+
 	// Update cached values.
 	init_cache(conf, flags & IMPORT_REINIT_CACHE);
 
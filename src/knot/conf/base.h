@@ -104,6 +104,7 @@ knot_dynarray_declare(mod, module_t *, DYNARRAY_VISIBILITY_NORMAL, 16)
 knot_dynarray_declare(old_schema, yp_item_t *, DYNARRAY_VISIBILITY_NORMAL, 16)
 
 struct knot_catalog;
+struct acl_rules;
 
 /*! Configuration context. */
 typedef struct {
@@ -120,6 +121,11 @@ typedef struct {
 
 	/*! Read-only transaction for config access. */
 	knot_db_txn_t read_txn;
+	/*! Immutable copy of the read-only transaction content. */
+	struct {
+		knot_mm_t mm;
+		trie_t *values;
+	} snapshot;
 
 	struct {
 		/*! The current writing transaction. */
@@ -150,6 +156,8 @@ typedef struct {
 		size_t srv_xdp_threads;
 		size_t srv_bg_threads;
 		size_t srv_tcp_max_clients;
+		size_t srv_udp_rcvbuf_max;
+		unsigned srv_tcp_prefix_max_clients;
 		size_t xdp_tcp_max_clients;
 		size_t xdp_tcp_inbuf_max_size;
 		size_t xdp_tcp_outbuf_max_size;
@@ -161,6 +169,8 @@ typedef struct {
 		size_t srv_quic_obuf_max_size;
 		const uint8_t *srv_nsid_data;
 		size_t srv_nsid_len;
+		uint8_t *srv_nsid_opt;     /*!< Encoded NSID EDNS option, NULL if empty. */
+		uint16_t srv_nsid_opt_len;
 		const char *srv_ident;
 		const char *srv_version;
 		uint32_t srv_quic_idle_close;
@@ -168,13 +178,29 @@ typedef struct {
 		uint16_t xdp_ring_size;
 		uint16_t xdp_busypoll_budget;
 		uint16_t xdp_busypoll_timeout;
+		uint32_t xdp_rrl_instant_limit;
+		uint32_t xdp_rrl_rate_limit;
+		uint16_t srv_busypoll_budget;
+		uint16_t srv_busypoll_timeout;
+		uint16_t srv_busypoll_spin;
+		uint32_t srv_answer_cache;
 		int ctl_timeout;
 		bool xdp_udp;
 		bool xdp_tcp;
 		bool xdp_route_check;
+		bool xdp_multi_buffer;
+		bool xdp_shared_umem;
 		bool srv_tcp_reuseport;
+		bool srv_tcp_defer_accept;
 		bool srv_tcp_fastopen;
+		bool srv_tcp_zerocopy;
+		bool srv_tcp_out_of_order;
+		bool srv_ktls;
 		bool srv_socket_affinity;
+		bool srv_numa_affinity;
+		bool srv_udp_offload;
+		bool srv_udp_adaptive_batch;
+		bool srv_udp_trunc_learn;
 		bool srv_ecs;
 		bool srv_ans_rotate;
 		bool srv_auto_acl;
@@ -182,6 +208,9 @@ typedef struct {
 		bool srv_has_version;
 	} cache;
 
+	/*! Compiled update rules of ACLs. */
+	struct acl_rules *acl_rules;
+
 	/*! List of dynamically loaded modules. */
 	mod_dynarray_t modules;
 	/*! List of old schemas (lazy freed). */
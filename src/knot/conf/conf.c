@@ -272,6 +272,39 @@ got_template:
 	return val;
 }
 
+uint64_t conf_zone_hash_txn(
+	conf_t *conf,
+	knot_db_txn_t *txn,
+	const knot_dname_t *dname,
+	uint64_t shared)
+{
+	const yp_item_t *section = yp_schema_find(C_ZONE, NULL, conf->schema);
+	if (section == NULL || dname == NULL) {
+		return 0;
+	}
+
+	size_t dname_size = knot_dname_size(dname);
+
+	// FNV-1a over the explicit zone values, templates are in the shared hash.
+	uint64_t hash = shared;
+	for (const yp_item_t *item = section->sub_items; item->name != NULL; item++) {
+		conf_val_t val;
+		conf_db_get(conf, txn, C_ZONE, item->name, dname, dname_size, &val);
+		if (val.code != KNOT_EOK) {
+			continue;
+		}
+		const uint8_t *name = (const uint8_t *)item->name;
+		for (size_t i = 0; i <= name[0]; i++) {
+			hash = (hash ^ name[i]) * 1099511628211LLU;
+		}
+		for (size_t i = 0; i < val.blob_len; i++) {
+			hash = (hash ^ val.blob[i]) * 1099511628211LLU;
+		}
+	}
+
+	return (hash != 0) ? hash : 1;
+}
+
 conf_val_t conf_default_get_txn(
 	conf_t *conf,
 	knot_db_txn_t *txn,
@@ -1297,6 +1330,19 @@ size_t conf_bg_threads_txn(
 	return workers;
 }
 
+size_t conf_signing_threads_txn(
+	conf_t *conf,
+	knot_db_txn_t *txn)
+{
+	conf_val_t val = conf_get_txn(conf, txn, C_SRV, C_SIGNING_WORKERS);
+	int64_t workers = conf_int(&val);
+	if (workers == YP_NIL) {
+		return dt_optimal_size();
+	}
+
+	return workers;
+}
+
 size_t conf_tcp_max_clients_txn(
 	conf_t *conf,
 	knot_db_txn_t *txn)
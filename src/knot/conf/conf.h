@@ -239,6 +239,30 @@ static inline conf_val_t conf_zone_get(
 	return conf_zone_get_txn(conf, &conf->read_txn, key1_name, dname);
 }
 
+/*!
+ * Computes a hash of the effective zone configuration.
+ *
+ * \param[in] conf     Configuration.
+ * \param[in] txn      Configuration DB transaction.
+ * \param[in] dname    Zone name.
+ * \param[in] shared   Hash of the configuration without the zone section.
+ *
+ * \return Non-zero hash, zero if not available.
+ */
+uint64_t conf_zone_hash_txn(
+	conf_t *conf,
+	knot_db_txn_t *txn,
+	const knot_dname_t *dname,
+	uint64_t shared
+);
+static inline uint64_t conf_zone_hash(
+	conf_t *conf,
+	const knot_dname_t *dname,
+	uint64_t shared)
+{
+	return conf_zone_hash_txn(conf, &conf->read_txn, dname, shared);
+}
+
 /*!
  * Gets the configuration item value of the default template.
  *
@@ -847,6 +871,24 @@ static inline size_t conf_xdp_threads(
 	return conf_xdp_threads_txn(conf, &conf->read_txn);
 }
 
+/*!
+ * Gets the configured number of threads shared for zone signing.
+ *
+ * \param[in] conf  Configuration.
+ * \param[in] txn   Configuration DB transaction.
+ *
+ * \return Number of threads, 0 if zones use their own threads.
+ */
+size_t conf_signing_threads_txn(
+	conf_t *conf,
+	knot_db_txn_t *txn
+);
+static inline size_t conf_signing_threads(
+	conf_t *conf)
+{
+	return conf_signing_threads_txn(conf, &conf->read_txn);
+}
+
 /*!
  * Gets the configured number of worker threads.
  *
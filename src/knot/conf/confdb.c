@@ -27,8 +27,11 @@
 
 #include "knot/conf/confdb.h"
 #include "libknot/errcode.h"
+#include "libknot/wire.h"
 #include "libknot/yparser/yptrafo.h"
+#include "contrib/mempattern.h"
 #include "contrib/openbsd/strlcpy.h"
+#include "contrib/ucw/mempool.h"
 #include "contrib/wire_ctx.h"
 
 /*
@@ -86,6 +89,36 @@ typedef enum {
 	DB_DEL
 } db_action_t;
 
+typedef struct {
+	size_t len;
+	uint8_t data[];
+} snapshot_val_t;
+
+#define BIN_MAGIC	"KNOT-CONFDB\x01"
+#define BIN_MAGIC_LEN	(sizeof(BIN_MAGIC) - 1)
+#define BIN_HDR_LEN	(sizeof(uint16_t) + sizeof(uint32_t))
+
+static int db_find(
+	conf_t *conf,
+	knot_db_txn_t *txn,
+	knot_db_val_t *key,
+	knot_db_val_t *data)
+{
+	// The read transaction content is served from its snapshot.
+	if (txn == &conf->read_txn && conf->snapshot.values != NULL) {
+		trie_val_t *val = trie_get_try(conf->snapshot.values, key->data, key->len);
+		if (val == NULL) {
+			return KNOT_ENOENT;
+		}
+		snapshot_val_t *snap = *val;
+		data->data = snap->data;
+		data->len = snap->len;
+		return KNOT_EOK;
+	}
+
+	return conf->api->find(txn, key, data, 0);
+}
+
 static int db_check_version(
 	conf_t *conf,
 	knot_db_txn_t *txn)
@@ -185,7 +218,7 @@ static int db_code(
 
 	// Check if the item is already registered.
 	knot_db_val_t data;
-	int ret = conf->api->find(txn, &key, &data, 0);
+	int ret = db_find(conf, txn, &key, &data);
 	switch (ret) {
 	case KNOT_EOK:
 		if (action == DB_DEL) {
@@ -685,7 +718,7 @@ int conf_db_get(
 		k[KEY1_POS] = KEY1_ID;
 
 		// Check for existing id.
-		out.code = conf->api->find(txn, &key, &val, 0);
+		out.code = db_find(conf, txn, &key, &val);
 		if (out.code != KNOT_EOK) {
 			out.code = KNOT_YP_EINVAL_ID;
 			goto get_error;
@@ -701,7 +734,7 @@ int conf_db_get(
 	}
 
 	// Get the data.
-	out.code = conf->api->find(txn, &key, &val, 0);
+	out.code = db_find(conf, txn, &key, &val);
 	if (out.code == KNOT_EOK) {
 		out.blob = val.data;
 		out.blob_len = val.len;
@@ -871,6 +904,68 @@ void conf_db_iter_finish(
 	}
 }
 
+int conf_db_hash(
+	conf_t *conf,
+	knot_db_txn_t *txn,
+	const yp_name_t *skip,
+	uint64_t *hash)
+{
+	if (conf == NULL || hash == NULL) {
+		return KNOT_EINVAL;
+	}
+
+	// Use the current config read transaction if not specified.
+	if (txn == NULL) {
+		txn = &conf->read_txn;
+	}
+
+	uint8_t skip_code = KEY0_ROOT;
+	if (skip != NULL) {
+		int ret = db_code(conf, txn, KEY0_ROOT, skip, DB_GET, &skip_code);
+		if (ret != KNOT_EOK && ret != KNOT_ENOENT) {
+			return ret;
+		}
+	}
+
+	// FNV-1a over the keys and values.
+	uint64_t h = 14695981039346656037LLU;
+	int ret = KNOT_EOK;
+
+	knot_db_iter_t *it = conf->api->iter_begin(txn, KNOT_DB_FIRST);
+	while (it != NULL) {
+		knot_db_val_t key, data;
+		ret = conf->api->iter_key(it, &key);
+		if (ret != KNOT_EOK || (ret = conf->api->iter_val(it, &data)) != KNOT_EOK) {
+			break;
+		}
+
+		// Identifiers and values of the skipped section, item codes are kept.
+		uint8_t *k = (uint8_t *)key.data;
+		if (skip_code != KEY0_ROOT && k[KEY0_POS] == skip_code &&
+		    k[KEY1_POS] != KEY1_ITEMS) {
+			it = conf->api->iter_next(it);
+			continue;
+		}
+
+		for (size_t i = 0; i < key.len; i++) {
+			h = (h ^ k[i]) * 1099511628211LLU;
+		}
+		const uint8_t *d = data.data;
+		for (size_t i = 0; i < data.len; i++) {
+			h = (h ^ d[i]) * 1099511628211LLU;
+		}
+
+		it = conf->api->iter_next(it);
+	}
+	conf->api->iter_finish(it);
+
+	if (ret == KNOT_EOK) {
+		*hash = h;
+	}
+
+	return ret;
+}
+
 int conf_db_raw_dump(
 	conf_t *conf,
 	knot_db_txn_t *txn,
@@ -949,3 +1044,237 @@ int conf_db_raw_dump(
 
 	return ret;
 }
+
+int conf_db_snapshot(
+	conf_t *conf)
+{
+	if (conf == NULL) {
+		return KNOT_EINVAL;
+	}
+
+	conf_db_snapshot_free(conf);
+
+	knot_mm_t mm;
+	mm_ctx_mempool(&mm, MM_DEFAULT_BLKSIZE);
+	// Built on the heap, then packed into the pool for faster lookups.
+	trie_t *values = trie_create(NULL);
+	if (values == NULL) {
+		mp_delete(mm.ctx);
+		return KNOT_ENOMEM;
+	}
+
+	int ret = KNOT_EOK;
+
+	knot_db_iter_t *it = conf->api->iter_begin(&conf->read_txn, KNOT_DB_FIRST);
+	while (it != NULL) {
+		knot_db_val_t key;
+		ret = conf->api->iter_key(it, &key);
+		if (ret != KNOT_EOK) {
+			break;
+		}
+
+		knot_db_val_t data;
+		ret = conf->api->iter_val(it, &data);
+		if (ret != KNOT_EOK) {
+			break;
+		}
+
+		snapshot_val_t *snap = mm_alloc(&mm, sizeof(*snap) + data.len);
+		trie_val_t *val = trie_get_ins(values, key.data, key.len);
+		if (snap == NULL || val == NULL) {
+			ret = KNOT_ENOMEM;
+			break;
+		}
+		snap->len = data.len;
+		if (data.len > 0) {
+			memcpy(snap->data, data.data, data.len);
+		}
+		*val = snap;
+
+		it = conf->api->iter_next(it);
+	}
+	conf->api->iter_finish(it);
+
+	trie_t *packed = NULL;
+	if (ret == KNOT_EOK) {
+		packed = trie_pack(values, &mm);
+		if (packed == NULL) {
+			ret = KNOT_ENOMEM;
+		}
+	}
+	trie_free(values);
+
+	if (ret != KNOT_EOK) {
+		mp_delete(mm.ctx);
+		return ret;
+	}
+
+	conf->snapshot.mm = mm;
+	conf->snapshot.values = packed;
+
+	return KNOT_EOK;
+}
+
+void conf_db_snapshot_free(
+	conf_t *conf)
+{
+	if (conf == NULL || conf->snapshot.values == NULL) {
+		return;
+	}
+
+	// The trie is allocated from the pool too.
+	mp_delete(conf->snapshot.mm.ctx);
+	conf->snapshot.values = NULL;
+}
+
+bool conf_db_is_bin(
+	const char *file_name)
+{
+	if (file_name == NULL) {
+		return false;
+	}
+
+	FILE *fp = fopen(file_name, "r");
+	if (fp == NULL) {
+		return false;
+	}
+
+	char magic[BIN_MAGIC_LEN];
+	bool is_bin = fread(magic, 1, sizeof(magic), fp) == sizeof(magic) &&
+	              memcmp(magic, BIN_MAGIC, sizeof(magic)) == 0;
+	fclose(fp);
+
+	return is_bin;
+}
+
+int conf_db_export_bin(
+	conf_t *conf,
+	knot_db_txn_t *txn,
+	const char *file_name)
+{
+	if (conf == NULL || file_name == NULL) {
+		return KNOT_EINVAL;
+	}
+
+	// Use the current config read transaction if not specified.
+	if (txn == NULL) {
+		txn = &conf->read_txn;
+	}
+
+	FILE *fp = fopen(file_name, "w");
+	if (fp == NULL) {
+		return knot_map_errno();
+	}
+
+	int ret = KNOT_EOK;
+	if (fwrite(BIN_MAGIC, 1, BIN_MAGIC_LEN, fp) != BIN_MAGIC_LEN) {
+		ret = KNOT_EFILE;
+	}
+
+	// The records are stored in the DB order.
+	knot_db_iter_t *it = conf->api->iter_begin(txn, KNOT_DB_FIRST);
+	while (it != NULL && ret == KNOT_EOK) {
+		knot_db_val_t key;
+		ret = conf->api->iter_key(it, &key);
+		if (ret != KNOT_EOK) {
+			break;
+		}
+
+		knot_db_val_t data;
+		ret = conf->api->iter_val(it, &data);
+		if (ret != KNOT_EOK) {
+			break;
+		}
+
+		uint8_t hdr[BIN_HDR_LEN];
+		knot_wire_write_u16(hdr, key.len);
+		knot_wire_write_u32(hdr + sizeof(uint16_t), data.len);
+		if (fwrite(hdr, 1, sizeof(hdr), fp) != sizeof(hdr) ||
+		    fwrite(key.data, 1, key.len, fp) != key.len ||
+		    fwrite(data.data, 1, data.len, fp) != data.len) {
+			ret = KNOT_EFILE;
+			break;
+		}
+
+		it = conf->api->iter_next(it);
+	}
+	conf->api->iter_finish(it);
+
+	if (fclose(fp) != 0 && ret == KNOT_EOK) {
+		ret = KNOT_EFILE;
+	}
+
+	return ret;
+}
+
+int conf_db_import_bin(
+	conf_t *conf,
+	knot_db_txn_t *txn,
+	const char *file_name,
+	bool purge)
+{
+	if (conf == NULL || txn == NULL || file_name == NULL) {
+		return KNOT_EINVAL;
+	}
+
+	FILE *fp = fopen(file_name, "r");
+	if (fp == NULL) {
+		return knot_map_errno();
+	}
+
+	int ret = KNOT_EOK;
+
+	char magic[BIN_MAGIC_LEN];
+	if (fread(magic, 1, sizeof(magic), fp) != sizeof(magic) ||
+	    memcmp(magic, BIN_MAGIC, sizeof(magic)) != 0) {
+		ret = KNOT_EMALF;
+		goto import_error;
+	}
+
+	// The sorted records can be appended to an empty DB.
+	unsigned flags = 0;
+	if (purge) {
+		ret = conf->api->clear(txn);
+		if (ret != KNOT_EOK) {
+			goto import_error;
+		}
+		flags = KNOT_DB_APPEND;
+	}
+
+	uint8_t hdr[BIN_HDR_LEN];
+	while (fread(hdr, 1, sizeof(hdr), fp) == sizeof(hdr)) {
+		uint8_t k[CONF_MAX_KEY_LEN];
+		knot_db_val_t key = { k, knot_wire_read_u16(hdr) };
+		knot_db_val_t data = { NULL, knot_wire_read_u32(hdr + sizeof(uint16_t)) };
+		if (key.len < CONF_MIN_KEY_LEN || key.len > sizeof(k) ||
+		    data.len > CONF_MAX_DATA_LEN ||
+		    fread(k, 1, key.len, fp) != key.len) {
+			ret = KNOT_EMALF;
+			goto import_error;
+		}
+
+		// Read the value directly into the reserved DB space.
+		uint8_t empty = 0;
+		if (data.len == 0) {
+			data.data = &empty;
+		}
+		ret = conf->api->insert(txn, &key, &data, flags);
+		if (ret != KNOT_EOK) {
+			goto import_error;
+		}
+		if (fread(data.data, 1, data.len, fp) != data.len) {
+			ret = KNOT_EMALF;
+			goto import_error;
+		}
+	}
+	if (ferror(fp) || !feof(fp)) {
+		ret = KNOT_EFILE;
+		goto import_error;
+	}
+
+	ret = db_check_version(conf, txn);
+import_error:
+	fclose(fp);
+
+	return ret;
+}
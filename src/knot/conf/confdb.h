@@ -212,6 +212,23 @@ void conf_db_iter_finish(
 	conf_iter_t *iter
 );
 
+/*!
+ * Computes a hash of the configuration DB contents.
+ *
+ * \param[in] conf   Configuration.
+ * \param[in] txn    Configuration DB transaction (NULL for the read one).
+ * \param[in] skip   Section whose identifiers and values are left out (can be NULL).
+ * \param[out] hash  Resulting hash.
+ *
+ * \return Error code, KNOT_EOK if success.
+ */
+int conf_db_hash(
+	conf_t *conf,
+	knot_db_txn_t *txn,
+	const yp_name_t *skip,
+	uint64_t *hash
+);
+
 /*!
  * Dumps the configuration DB in the textual form.
  *
@@ -228,3 +245,70 @@ int conf_db_raw_dump(
 	knot_db_txn_t *txn,
 	const char *file_name
 );
+
+/*!
+ * Copies the whole read transaction content into an immutable snapshot,
+ * which serves all subsequent lookups using the read transaction.
+ *
+ * \param[in] conf  Configuration.
+ *
+ * \return Error code, KNOT_EOK if success.
+ */
+int conf_db_snapshot(
+	conf_t *conf
+);
+
+/*!
+ * Drops the read transaction snapshot.
+ *
+ * \param[in] conf  Configuration.
+ */
+void conf_db_snapshot_free(
+	conf_t *conf
+);
+
+/*!
+ * Checks if the file is a binary configuration DB snapshot.
+ *
+ * \param[in] file_name  Input filename.
+ *
+ * \return True if the file starts with the snapshot signature.
+ */
+bool conf_db_is_bin(
+	const char *file_name
+);
+
+/*!
+ * Stores the raw configuration DB content into a binary snapshot file.
+ *
+ * \param[in] conf       Configuration.
+ * \param[in] txn        Configuration DB transaction (NULL for the read one).
+ * \param[in] file_name  Output filename.
+ *
+ * \return Error code, KNOT_EOK if success.
+ */
+int conf_db_export_bin(
+	conf_t *conf,
+	knot_db_txn_t *txn,
+	const char *file_name
+);
+
+/*!
+ * Loads a binary snapshot file into the configuration DB.
+ *
+ * The content isn't parsed nor checked against the schema, the stored records
+ * are directly appended to the purged DB.
+ *
+ * \param[in] conf       Configuration.
+ * \param[in] txn        Configuration DB write transaction.
+ * \param[in] file_name  Input filename.
+ * \param[in] purge      Purge the DB before loading.
+ *
+ * \return Error code, KNOT_EOK if success.
+ */
+int conf_db_import_bin(
+	conf_t *conf,
+	knot_db_txn_t *txn,
+	const char *file_name,
+	bool purge
+);
@@ -390,6 +390,12 @@ void conf_activate_modules(
 	// Initialize query modules list.
 	init_list(query_modules);
 
+	bool sharing = false;
+	if (zone_name != NULL) {
+		conf_val_t sharing_val = conf_zone_get(conf, C_MODULE_SHARING, zone_name);
+		sharing = conf_bool(&sharing_val);
+	}
+
 	// Open the modules.
 	while (val.code == KNOT_EOK) {
 		conf_mod_id_t *mod_id = conf_mod_id(&val);
@@ -422,8 +428,12 @@ void conf_activate_modules(
 			goto skip_module;
 		}
 
-		// Load the module.
-		ret = mod->api->load(mod);
+		// Load the module, possibly as a reference to a shared instance.
+		if (sharing && (mod->api->flags & KNOTD_MOD_FLAG_SHARED)) {
+			ret = query_module_share(conf, mod);
+		} else {
+			ret = mod->api->load(mod);
+		}
 		if (ret != KNOT_EOK) {
 			MOD_ID_LOG(zone_name, error, mod_id, "failed to load (%s)",
 			        knot_strerror(ret));
@@ -457,10 +467,10 @@ void conf_deactivate_modules(
 	// Free query modules list.
 	knotd_mod_t *mod, *next;
 	WALK_LIST_DELSAFE(mod, next, *query_modules) {
-		if (mod->api->unload != NULL) {
+		if (mod->shared == NULL && mod->api->unload != NULL) {
 			mod->api->unload(mod);
 		}
-		query_module_close(mod);
+		query_module_close(mod); // Also releases the shared instance.
 	}
 	init_list(query_modules);
 }
@@ -486,7 +496,7 @@ void conf_reset_modules(
 
 	knotd_mod_t *mod;
 	WALK_LIST(mod, *query_modules) {
-		if (mod->api->unload != NULL) {
+		if (mod->shared == NULL && mod->api->unload != NULL) {
 			mod->api->unload(mod);
 		}
 		query_module_reset(conf, mod, new_plan);
@@ -494,7 +504,9 @@ void conf_reset_modules(
 
 	knotd_mod_t *next;
 	WALK_LIST_DELSAFE(mod, next, *query_modules) {
-		int ret = mod->api->load(mod);
+		// The shared instance is kept, only its hooks are planned again.
+		int ret = (mod->shared != NULL) ? query_plan_merge(new_plan, mod->shared->plan) :
+		                                  mod->api->load(mod);
 		if (ret != KNOT_EOK) {
 			MOD_ID_LOG(mod->zone, error, mod->id, "failed to load (%s)",
 			           knot_strerror(ret));
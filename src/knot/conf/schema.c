@@ -28,6 +28,7 @@
 #include "libknot/rrtype/opt.h"
 #include "libdnssec/tsig.h"
 #include "libdnssec/key.h"
+#include "libzscanner/scanner.h"
 
 #define HOURS(x)	((x) * 3600)
 #define DAYS(x)		((x) * HOURS(24))
@@ -171,6 +172,26 @@ static const knot_lookup_t zonefile_load[] = {
 	{ 0, NULL }
 };
 
+static const knot_lookup_t load_hugepages[] = {
+	{ ZONE_ARENA_PAGES_DEFAULT,     "off" },
+	{ ZONE_ARENA_PAGES_TRANSPARENT, "transparent" },
+	{ ZONE_ARENA_PAGES_EXPLICIT,    "explicit" },
+	{ 0, NULL }
+};
+
+static const knot_lookup_t load_input[] = {
+	{ ZS_INPUT_MMAP,   "mmap" },
+	{ ZS_INPUT_STREAM, "stream" },
+	{ ZS_INPUT_READ,   "read" },
+	{ 0, NULL }
+};
+
+static const knot_lookup_t zonefile_format[] = {
+	{ ZONEFILE_FORMAT_TEXT,   "text" },
+	{ ZONEFILE_FORMAT_BINARY, "binary" },
+	{ 0, NULL }
+};
+
 static const knot_lookup_t log_severities[] = {
 	{ LOG_UPTO(LOG_CRIT),    "critical" },
 	{ LOG_UPTO(LOG_ERR),     "error" },
@@ -219,23 +240,33 @@ static const yp_item_t desc_server[] = {
 	{ C_RUNDIR,               YP_TSTR,  YP_VSTR = { RUN_DIR } },
 	{ C_USER,                 YP_TSTR,  YP_VNONE },
 	{ C_PIDFILE,              YP_TSTR,  YP_VSTR = { "knot.pid" } },
+	{ C_HANDOFF_LISTEN,       YP_TSTR,  YP_VNONE },
 	{ C_UDP_WORKERS,          YP_TINT,  YP_VINT = { 1, CONF_MAX_UDP_WORKERS, YP_NIL } },
 	{ C_TCP_WORKERS,          YP_TINT,  YP_VINT = { 1, CONF_MAX_TCP_WORKERS, YP_NIL } },
 	{ C_BG_WORKERS,           YP_TINT,  YP_VINT = { 1, CONF_MAX_BG_WORKERS, YP_NIL } },
+	{ C_BG_HEAVY_WORKERS,     YP_TINT,  YP_VINT = { 0, CONF_MAX_BG_WORKERS, 0 } },
+	{ C_SIGNING_WORKERS,      YP_TINT,  YP_VINT = { 0, UINT16_MAX, YP_NIL } },
 	{ C_ASYNC_START,          YP_TBOOL, YP_VNONE },
 	{ C_TCP_IDLE_TIMEOUT,     YP_TINT,  YP_VINT = { 1, INT32_MAX, 10, YP_STIME } },
 	{ C_TCP_IO_TIMEOUT,       YP_TINT,  YP_VINT = { 0, INT32_MAX, 500 } },
 	{ C_TCP_RMT_IO_TIMEOUT,   YP_TINT,  YP_VINT = { 0, INT32_MAX, 5000 } },
 	{ C_TCP_MAX_CLIENTS,      YP_TINT,  YP_VINT = { 0, INT32_MAX, YP_NIL } },
+	{ C_TCP_PREFIX_MAX_CLIENTS, YP_TINT, YP_VINT = { 0, UINT16_MAX, 0 } },
 	{ C_TCP_REUSEPORT,        YP_TBOOL, YP_VNONE },
 	{ C_TCP_FASTOPEN,         YP_TBOOL, YP_VNONE },
+	{ C_TCP_DEFER_ACCEPT,     YP_TBOOL, YP_VNONE },
+	{ C_TCP_ZEROCOPY,         YP_TBOOL, YP_VNONE },
+	{ C_TCP_OUT_OF_ORDER,     YP_TBOOL, YP_VNONE },
+	{ C_KTLS,                 YP_TBOOL, YP_VNONE },
 	{ C_QUIC_MAX_CLIENTS,     YP_TINT,  YP_VINT = { 128, INT32_MAX, 10000 } },
 	{ C_QUIC_OUTBUF_MAX_SIZE, YP_TINT,  YP_VINT = { MEGA(1), SSIZE_MAX, MEGA(100), YP_SSIZE } },
 	{ C_QUIC_IDLE_CLOSE,      YP_TINT,  YP_VINT = { 1, INT32_MAX, 4, YP_STIME } },
 	{ C_RMT_POOL_LIMIT,       YP_TINT,  YP_VINT = { 0, INT32_MAX, 0 } },
 	{ C_RMT_POOL_TIMEOUT,     YP_TINT,  YP_VINT = { 1, INT32_MAX, 5, YP_STIME } },
 	{ C_RMT_RETRY_DELAY,      YP_TINT,  YP_VINT = { 0, INT32_MAX, 0 } },
+	{ C_NOTIFY_RATE,          YP_TINT,  YP_VINT = { 0, INT32_MAX, 0 } },
 	{ C_SOCKET_AFFINITY,      YP_TBOOL, YP_VNONE },
+	{ C_NUMA_AFFINITY,        YP_TBOOL, YP_VNONE },
 	{ C_UDP_MAX_PAYLOAD,      YP_TINT,  YP_VINT = { KNOT_EDNS_MIN_DNSSEC_PAYLOAD,
 	                                                KNOT_EDNS_MAX_UDP_PAYLOAD,
 	                                                1232, YP_SSIZE } },
@@ -245,10 +276,20 @@ static const yp_item_t desc_server[] = {
 	{ C_UDP_MAX_PAYLOAD_IPV6, YP_TINT,  YP_VINT = { KNOT_EDNS_MIN_DNSSEC_PAYLOAD,
 	                                                KNOT_EDNS_MAX_UDP_PAYLOAD,
 	                                                1232, YP_SSIZE } },
+	{ C_UDP_OFFLOAD,          YP_TBOOL, YP_VNONE },
+	{ C_UDP_ADAPTIVE_BATCH,   YP_TBOOL, YP_VNONE },
+	{ C_UDP_RCVBUF_MAX,       YP_TINT,  YP_VINT = { 0, INT32_MAX, 0, YP_SSIZE } },
+	{ C_UDP_TRUNC_LEARN,      YP_TBOOL, YP_VNONE },
+	{ C_BUSYPOLL_BUDGET,      YP_TINT,  YP_VINT = { 0, UINT16_MAX, 0 } },
+	{ C_BUSYPOLL_TIMEOUT,     YP_TINT,  YP_VINT = { 1, UINT16_MAX, 50 } },
+	{ C_BUSYPOLL_SPIN,        YP_TINT,  YP_VINT = { 0, UINT16_MAX, 0 } },
 	{ C_CERT_FILE,            YP_TSTR,  YP_VNONE, YP_FNONE },
 	{ C_KEY_FILE,             YP_TSTR,  YP_VNONE, YP_FNONE },
+	{ C_TICKET_KEY_FILE,      YP_TSTR,  YP_VNONE, YP_FNONE },
 	{ C_ECS,                  YP_TBOOL, YP_VNONE },
 	{ C_ANS_ROTATION,         YP_TBOOL, YP_VNONE },
+	{ C_ANS_CACHE,            YP_TINT,  YP_VINT = { 0, 1048576, 0 } },
+	{ C_LAZY_MAX_SIZE,        YP_TINT,  YP_VINT = { 0, SSIZE_MAX, 0, YP_SSIZE } },
 	{ C_AUTO_ACL,             YP_TBOOL, YP_VNONE },
 	{ C_PROXY_ALLOWLIST,      YP_TNET,  YP_VNONE, YP_FMULTI},
 	{ C_DBUS_EVENT,           YP_TOPT,  YP_VOPT = { dbus_events, DBUS_EVENT_NONE }, YP_FMULTI },
@@ -276,6 +317,10 @@ static const yp_item_t desc_xdp[] = {
 	{ C_RING_SIZE,            YP_TINT,  YP_VINT = { 4, 32768, 2048 } },
 	{ C_BUSYPOLL_BUDGET,      YP_TINT,  YP_VINT = { 0, UINT16_MAX, 0 } },
 	{ C_BUSYPOLL_TIMEOUT,     YP_TINT,  YP_VINT = { 1, UINT16_MAX, 20 } },
+	{ C_MULTI_BUFFER,         YP_TBOOL, YP_VNONE },
+	{ C_SHARED_UMEM,          YP_TBOOL, YP_VNONE },
+	{ C_RRL_INST_LIMIT,       YP_TINT,  YP_VINT = { 1, (1ll << 32) / 768 - 1, 1000 } },
+	{ C_RRL_RATE_LIMIT,       YP_TINT,  YP_VINT = { 0, ((1ll << 32) / 768 - 1) * 1000, 0 } },
 	{ C_COMMENT,              YP_TSTR,  YP_VNONE },
 	{ NULL }
 };
@@ -295,6 +340,7 @@ static const yp_item_t desc_log[] = {
 	{ C_ZONE,    YP_TOPT, YP_VOPT = { log_severities, 0 } },
 	{ C_QUIC,    YP_TOPT, YP_VOPT = { log_severities, 0 } },
 	{ C_ANY,     YP_TOPT, YP_VOPT = { log_severities, 0 } },
+	{ C_ASYNC,   YP_TBOOL, YP_VNONE },
 	{ C_COMMENT, YP_TSTR, YP_VNONE },
 	{ NULL }
 };
@@ -303,6 +349,8 @@ static const yp_item_t desc_stats[] = {
 	{ C_TIMER,   YP_TINT,  YP_VINT = { 1, UINT32_MAX, 0, YP_STIME } },
 	{ C_FILE,    YP_TSTR,  YP_VSTR = { "stats.yaml" } },
 	{ C_APPEND,  YP_TBOOL, YP_VNONE },
+	{ C_LISTEN,  YP_TADDR, YP_VADDR = { 9433 } },
+	{ C_HISTOGRAMS, YP_TBOOL, YP_VNONE },
 	{ C_COMMENT, YP_TSTR,  YP_VNONE },
 	{ NULL }
 };
@@ -313,12 +361,16 @@ static const yp_item_t desc_database[] = {
 	{ C_JOURNAL_DB_MODE,     YP_TOPT,  YP_VOPT = { journal_modes, JOURNAL_MODE_ROBUST } },
 	{ C_JOURNAL_DB_MAX_SIZE, YP_TINT,  YP_VINT = { MEGA(1), VIRT_MEM_LIMIT(TERA(100)),
 	                                               VIRT_MEM_LIMIT(GIGA(20)), YP_SSIZE } },
+	{ C_JOURNAL_DB_GROUP,    YP_TINT,  YP_VINT = { 1, 1024, 1 } },
+	{ C_JOURNAL_DB_SHARDS,   YP_TINT,  YP_VINT = { 1, 64, 1 } },
 	{ C_KASP_DB,             YP_TSTR,  YP_VSTR = { "keys" } },
 	{ C_KASP_DB_MAX_SIZE,    YP_TINT,  YP_VINT = { MEGA(5), VIRT_MEM_LIMIT(GIGA(100)),
 	                                               MEGA(500), YP_SSIZE } },
 	{ C_TIMER_DB,            YP_TSTR,  YP_VSTR = { "timers" } },
 	{ C_TIMER_DB_MAX_SIZE,   YP_TINT,  YP_VINT = { MEGA(1), VIRT_MEM_LIMIT(GIGA(100)),
 	                                               MEGA(100), YP_SSIZE } },
+	{ C_TIMER_DB_SHARDS,     YP_TINT,  YP_VINT = { 1, 64, 1 } },
+	{ C_TIMER_DB_SYNC,       YP_TINT,  YP_VINT = { 0, UINT32_MAX, 0, YP_STIME } },
 	{ C_CATALOG_DB,          YP_TSTR,  YP_VSTR = { "catalog" } },
 	{ C_CATALOG_DB_MAX_SIZE, YP_TINT,  YP_VINT = { MEGA(5), VIRT_MEM_LIMIT(GIGA(100)),
 	                                               VIRT_MEM_LIMIT(GIGA(20)), YP_SSIZE } },
@@ -435,6 +487,8 @@ static const yp_item_t desc_policy[] = {
 	                                   CONF_IO_FRLD_ZONES },
 	{ C_RRSIG_PREREFRESH,    YP_TINT,  YP_VINT = { 0, INT32_MAX, HOURS(1), YP_STIME, DAYS(1) },
 	                                   CONF_IO_FRLD_ZONES },
+	{ C_RRSIG_INDEX,         YP_TBOOL, YP_VNONE },
+	{ C_RRSIG_STORE,         YP_TBOOL, YP_VNONE },
 	{ C_REPRO_SIGNING,       YP_TBOOL, YP_VNONE, CONF_IO_FRLD_ZONES },
 	{ C_NSEC3,               YP_TBOOL, YP_VNONE, CONF_IO_FRLD_ZONES },
 	{ C_NSEC3_ITER,          YP_TINT,  YP_VINT = { 0, UINT16_MAX, 0 }, CONF_IO_FRLD_ZONES },
@@ -467,23 +521,40 @@ static const yp_item_t desc_policy[] = {
 	{ C_MASTER,              YP_TREF,  YP_VREF = { C_RMT, C_RMTS }, YP_FMULTI | CONF_REF_EMPTY, \
 	                                   { check_ref } }, \
 	{ C_DDNS_MASTER,         YP_TREF,  YP_VREF = { C_RMT }, YP_FNONE, { check_ref_empty } }, \
+	{ C_DDNS_BATCH_DELAY,    YP_TINT,  YP_VINT = { 0, 1000, 0 } }, \
+	{ C_DDNS_BATCH_SIZE,     YP_TINT,  YP_VINT = { 0, INT32_MAX, 0 } }, \
 	{ C_NOTIFY,              YP_TREF,  YP_VREF = { C_RMT, C_RMTS }, YP_FMULTI | CONF_REF_EMPTY, \
 	                                   { check_ref } }, \
 	{ C_ACL,                 YP_TREF,  YP_VREF = { C_ACL }, YP_FMULTI, { check_ref } }, \
 	{ C_MASTER_PIN_TOL,      YP_TINT,  YP_VINT = { 0, UINT32_MAX, 0, YP_STIME } }, \
 	{ C_PROVIDE_IXFR,        YP_TBOOL, YP_VBOOL = { true } }, \
+	{ C_IXFR_CONDENSE,       YP_TINT,  YP_VINT = { 0, UINT16_MAX, 0 } }, \
+	{ C_AXFR_CACHE,          YP_TBOOL, YP_VNONE }, \
 	{ C_SEM_CHECKS,          YP_TOPT,  YP_VOPT = { semantic_checks, SEMCHECKS_OFF }, FLAGS }, \
 	{ C_DEFAULT_TTL,         YP_TINT,  YP_VINT = { 1, INT32_MAX, DEFAULT_TTL, YP_STIME }, FLAGS }, \
 	{ C_ZONEFILE_SYNC,       YP_TINT,  YP_VINT = { -1, INT32_MAX, 0, YP_STIME } }, \
+	{ C_ZONEFILE_SYNC_BG,    YP_TBOOL, YP_VNONE }, \
 	{ C_ZONEFILE_LOAD,       YP_TOPT,  YP_VOPT = { zonefile_load, ZONEFILE_LOAD_WHOLE } }, \
+	{ C_ZONEFILE_FMT,        YP_TOPT,  YP_VOPT = { zonefile_format, ZONEFILE_FORMAT_TEXT } }, \
 	{ C_JOURNAL_CONTENT,     YP_TOPT,  YP_VOPT = { journal_content, JOURNAL_CONTENT_CHANGES }, FLAGS }, \
 	{ C_JOURNAL_MAX_USAGE,   YP_TINT,  YP_VINT = { KILO(40), SSIZE_MAX, MEGA(100), YP_SSIZE } }, \
 	{ C_JOURNAL_MAX_DEPTH,   YP_TINT,  YP_VINT = { 2, SSIZE_MAX, 20 } }, \
+	{ C_JOURNAL_COMPRESSION, YP_TBOOL, YP_VNONE }, \
 	{ C_IXFR_BENEVOLENT,     YP_TBOOL, YP_VNONE }, \
 	{ C_IXFR_BY_ONE,         YP_TBOOL, YP_VNONE }, \
 	{ C_IXFR_FROM_AXFR,      YP_TBOOL, YP_VNONE }, \
 	{ C_ZONE_MAX_SIZE,       YP_TINT,  YP_VINT = { 0, SSIZE_MAX, SSIZE_MAX, YP_SSIZE }, FLAGS }, \
+	{ C_ZONE_MAX_MEMORY,     YP_TINT,  YP_VINT = { 0, SSIZE_MAX, SSIZE_MAX, YP_SSIZE } }, \
 	{ C_ADJUST_THR,          YP_TINT,  YP_VINT = { 1, UINT16_MAX, 1 } }, \
+	{ C_ANS_PRERENDER,       YP_TBOOL, YP_VNONE }, \
+	{ C_ANS_LAZY_GLUE,       YP_TBOOL, YP_VNONE }, \
+	{ C_LOAD_THR,            YP_TINT,  YP_VINT = { 1, UINT16_MAX, 1 } }, \
+	{ C_LOAD_ARENA,          YP_TBOOL, YP_VNONE }, \
+	{ C_LOAD_HUGEPAGES,      YP_TOPT,  YP_VOPT = { load_hugepages, ZONE_ARENA_PAGES_DEFAULT } }, \
+	{ C_LOAD_INPUT,          YP_TOPT,  YP_VOPT = { load_input, ZS_INPUT_MMAP } }, \
+	{ C_LAZY_LOAD,           YP_TBOOL, YP_VNONE, FLAGS }, \
+	{ C_LAZY_IDLE_TIMEOUT,   YP_TINT,  YP_VINT = { 0, UINT32_MAX, HOURS(1), YP_STIME } }, \
+	{ C_NSEC3_HASH_CACHE,    YP_TBOOL, YP_VNONE }, \
 	{ C_DNSSEC_SIGNING,      YP_TBOOL, YP_VNONE, FLAGS }, \
 	{ C_DNSSEC_VALIDATION,   YP_TBOOL, YP_VNONE, FLAGS }, \
 	{ C_DNSSEC_POLICY,       YP_TREF,  YP_VREF = { C_POLICY }, FLAGS, { check_ref_dflt } }, \
@@ -494,18 +565,21 @@ static const yp_item_t desc_policy[] = {
 	{ C_SERIAL_MODULO,       YP_TSTR,  YP_VSTR = { "0/1" }, YP_FNONE, { check_modulo_shift } }, \
 	{ C_ZONEMD_GENERATE,     YP_TOPT,  YP_VOPT = { zone_digest, ZONE_DIGEST_NONE }, FLAGS }, \
 	{ C_ZONEMD_VERIFY,       YP_TBOOL, YP_VNONE, FLAGS }, \
+	{ C_REFRESH_BATCH,       YP_TBOOL, YP_VNONE }, \
 	{ C_REFRESH_MIN_INTERVAL,YP_TINT,  YP_VINT = { 2, UINT32_MAX, 2, YP_STIME } }, \
 	{ C_REFRESH_MAX_INTERVAL,YP_TINT,  YP_VINT = { 2, UINT32_MAX, UINT32_MAX, YP_STIME } }, \
 	{ C_RETRY_MIN_INTERVAL,  YP_TINT,  YP_VINT = { 1, UINT32_MAX, 1, YP_STIME } }, \
 	{ C_RETRY_MAX_INTERVAL,  YP_TINT,  YP_VINT = { 1, UINT32_MAX, UINT32_MAX, YP_STIME } }, \
 	{ C_EXPIRE_MIN_INTERVAL, YP_TINT,  YP_VINT = { 3, UINT32_MAX, 3, YP_STIME } }, \
 	{ C_EXPIRE_MAX_INTERVAL, YP_TINT,  YP_VINT = { 3, UINT32_MAX, UINT32_MAX, YP_STIME } }, \
+	{ C_TIMER_JITTER,        YP_TINT,  YP_VINT = { 0, 50, 0 } }, \
 	{ C_CATALOG_ROLE,        YP_TOPT,  YP_VOPT = { catalog_roles, CATALOG_ROLE_NONE }, FLAGS }, \
 	{ C_CATALOG_TPL,         YP_TREF,  YP_VREF = { C_TPL }, YP_FMULTI | FLAGS, { check_ref } }, \
 	{ C_CATALOG_ZONE,        YP_TDNAME,YP_VNONE, FLAGS | CONF_IO_FRLD_ZONES }, \
 	{ C_CATALOG_GROUP,       YP_TSTR,  YP_VNONE, FLAGS | CONF_IO_FRLD_ZONES, { check_catalog_group } }, \
 	{ C_MODULE,              YP_TDATA, YP_VDATA = { 0, NULL, mod_id_to_bin, mod_id_to_txt }, \
 	                                   YP_FMULTI | FLAGS, { check_modref } }, \
+	{ C_MODULE_SHARING,      YP_TBOOL, YP_VNONE, FLAGS }, \
 	{ C_COMMENT,             YP_TSTR,  YP_VNONE }, \
 
 static const yp_item_t desc_template[] = {
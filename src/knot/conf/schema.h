@@ -24,16 +24,23 @@
 #define C_ADDR			"\x07""address"
 #define C_ADJUST_THR		"\x0E""adjust-threads"
 #define C_ALG			"\x09""algorithm"
+#define C_ANS_CACHE		"\x0C""answer-cache"
+#define C_ANS_LAZY_GLUE		"\x10""answer-lazy-glue"
+#define C_ANS_PRERENDER		"\x10""answer-prerender"
 #define C_ANS_ROTATION		"\x0F""answer-rotation"
 #define C_ANY			"\x03""any"
 #define C_APPEND		"\x06""append"
+#define C_ASYNC		"\x05""async"
 #define C_ASYNC_START		"\x0B""async-start"
 #define C_AUTO_ACL		"\x0D""automatic-acl"
+#define C_AXFR_CACHE		"\x0A""axfr-cache"
 #define C_BACKEND		"\x07""backend"
 #define C_BACKLOG		"\x07""backlog"
+#define C_BG_HEAVY_WORKERS	"\x18""background-heavy-workers"
 #define C_BG_WORKERS		"\x12""background-workers"
 #define C_BLOCK_NOTIFY_XFR	"\x1B""block-notify-after-transfer"
 #define C_BUSYPOLL_BUDGET	"\x0F""busypoll-budget"
+#define C_BUSYPOLL_SPIN		"\x0D""busypoll-spin"
 #define C_BUSYPOLL_TIMEOUT	"\x10""busypoll-timeout"
 #define C_CATALOG_DB		"\x0A""catalog-db"
 #define C_CATALOG_DB_MAX_SIZE	"\x13""catalog-db-max-size"
@@ -53,6 +60,8 @@
 #define C_DB			"\x08""database"
 #define C_DBUS_EVENT		"\x0A""dbus-event"
 #define C_DBUS_INIT_DELAY	"\x0F""dbus-init-delay"
+#define C_DDNS_BATCH_DELAY	"\x10""ddns-batch-delay"
+#define C_DDNS_BATCH_SIZE	"\x0F""ddns-batch-size"
 #define C_DDNS_MASTER		"\x0B""ddns-master"
 #define C_DEFAULT_TTL		"\x0B""default-ttl"
 #define C_DENY			"\x04""deny"
@@ -69,16 +78,22 @@
 #define C_EXPIRE_MIN_INTERVAL	"\x13""expire-min-interval"
 #define C_FILE			"\x04""file"
 #define C_GLOBAL_MODULE		"\x0D""global-module"
+#define C_HANDOFF_LISTEN	"\x0E""handoff-listen"
+#define C_HISTOGRAMS		"\x0A""histograms"
 #define C_ID			"\x02""id"
 #define C_IDENT			"\x08""identity"
 #define C_INCL			"\x07""include"
 #define C_IXFR_BENEVOLENT	"\x0F""ixfr-benevolent"
 #define C_IXFR_BY_ONE		"\x0B""ixfr-by-one"
+#define C_IXFR_CONDENSE		"\x0D""ixfr-condense"
 #define C_IXFR_FROM_AXFR	"\x0E""ixfr-from-axfr"
+#define C_JOURNAL_COMPRESSION	"\x13""journal-compression"
 #define C_JOURNAL_CONTENT	"\x0F""journal-content"
 #define C_JOURNAL_DB		"\x0A""journal-db"
 #define C_JOURNAL_DB_MAX_SIZE	"\x13""journal-db-max-size"
+#define C_JOURNAL_DB_GROUP	"\x17""journal-db-group-commit"
 #define C_JOURNAL_DB_MODE	"\x0F""journal-db-mode"
+#define C_JOURNAL_DB_SHARDS	"\x11""journal-db-shards"
 #define C_JOURNAL_MAX_DEPTH	"\x11""journal-max-depth"
 #define C_JOURNAL_MAX_USAGE	"\x11""journal-max-usage"
 #define C_KASP_DB		"\x07""kasp-db"
@@ -93,22 +108,34 @@
 #define C_KSK_SBM		"\x0E""ksk-submission"
 #define C_KSK_SHARED		"\x0a""ksk-shared"
 #define C_KSK_SIZE		"\x08""ksk-size"
+#define C_KTLS			"\x04""ktls"
+#define C_LAZY_IDLE_TIMEOUT	"\x11""lazy-idle-timeout"
+#define C_LAZY_LOAD		"\x09""lazy-load"
+#define C_LAZY_MAX_SIZE		"\x0D""lazy-max-size"
 #define C_LISTEN		"\x06""listen"
 #define C_LISTEN_QUIC		"\x0B""listen-quic"
 #define C_LISTEN_TLS		"\x0A""listen-tls"
+#define C_LOAD_ARENA		"\x0A""load-arena"
+#define C_LOAD_HUGEPAGES	"\x0E""load-hugepages"
+#define C_LOAD_INPUT		"\x0A""load-input"
+#define C_LOAD_THR		"\x0C""load-threads"
 #define C_LOG			"\x03""log"
 #define C_MANUAL		"\x06""manual"
 #define C_MASTER		"\x06""master"
 #define C_MASTER_PIN_TOL	"\x14""master-pin-tolerance"
 #define C_MODULE		"\x06""module"
+#define C_MODULE_SHARING	"\x0E""module-sharing"
+#define C_MULTI_BUFFER		"\x0C""multi-buffer"
 #define C_NO_EDNS		"\x07""no-edns"
 #define C_NOTIFY		"\x06""notify"
 #define C_NSEC3			"\x05""nsec3"
+#define C_NSEC3_HASH_CACHE	"\x10""nsec3-hash-cache"
 #define C_NSEC3_ITER		"\x10""nsec3-iterations"
 #define C_NSEC3_OPT_OUT		"\x0D""nsec3-opt-out"
 #define C_NSEC3_SALT_LEN	"\x11""nsec3-salt-length"
 #define C_NSEC3_SALT_LIFETIME	"\x13""nsec3-salt-lifetime"
 #define C_NSID			"\x04""nsid"
+#define C_NUMA_AFFINITY		"\x0D""numa-affinity"
 #define C_OFFLINE_KSK		"\x0B""offline-ksk"
 #define C_PARENT		"\x06""parent"
 #define C_PARENT_DELAY		"\x0C""parent-delay"
@@ -123,6 +150,7 @@
 #define C_QUIC_MAX_CLIENTS	"\x10""quic-max-clients"
 #define C_QUIC_OUTBUF_MAX_SIZE	"\x14""quic-outbuf-max-size"
 #define C_QUIC_PORT		"\x09""quic-port"
+#define C_REFRESH_BATCH		"\x0D""refresh-batch"
 #define C_REFRESH_MAX_INTERVAL	"\x14""refresh-max-interval"
 #define C_REFRESH_MIN_INTERVAL	"\x14""refresh-min-interval"
 #define C_REPRO_SIGNING		"\x14""reproducible-signing"
@@ -135,7 +163,12 @@
 #define C_RMT_POOL_LIMIT	"\x11""remote-pool-limit"
 #define C_RMT_POOL_TIMEOUT	"\x13""remote-pool-timeout"
 #define C_RMT_RETRY_DELAY	"\x12""remote-retry-delay"
+#define C_NOTIFY_RATE		"\x0B""notify-rate"
 #define C_ROUTE_CHECK		"\x0B""route-check"
+#define C_RRL_INST_LIMIT	"\x11""rrl-instant-limit"
+#define C_RRL_RATE_LIMIT	"\x0E""rrl-rate-limit"
+#define C_RRSIG_INDEX		"\x0B""rrsig-index"
+#define C_RRSIG_STORE		"\x0B""rrsig-store"
 #define C_RRSIG_LIFETIME	"\x0E""rrsig-lifetime"
 #define C_RRSIG_PREREFRESH	"\x11""rrsig-pre-refresh"
 #define C_RRSIG_REFRESH		"\x0D""rrsig-refresh"
@@ -146,7 +179,9 @@
 #define C_SERIAL_MODULO		"\x0D""serial-modulo"
 #define C_SERIAL_POLICY		"\x0D""serial-policy"
 #define C_SERVER		"\x06""server"
+#define C_SHARED_UMEM		"\x0B""shared-umem"
 #define C_SIGNING_THREADS	"\x0F""signing-threads"
+#define C_SIGNING_WORKERS	"\x0F""signing-workers"
 #define C_SINGLE_TYPE_SIGNING	"\x13""single-type-signing"
 #define C_SOCKET_AFFINITY	"\x0F""socket-affinity"
 #define C_SRV			"\x06""server"
@@ -154,6 +189,7 @@
 #define C_STORAGE		"\x07""storage"
 #define C_TARGET		"\x06""target"
 #define C_TCP			"\x03""tcp"
+#define C_TCP_DEFER_ACCEPT	"\x10""tcp-defer-accept"
 #define C_TCP_FASTOPEN		"\x0C""tcp-fastopen"
 #define C_TCP_IDLE_CLOSE	"\x16""tcp-idle-close-timeout"
 #define C_TCP_IDLE_RESET	"\x16""tcp-idle-reset-timeout"
@@ -162,20 +198,31 @@
 #define C_TCP_IO_TIMEOUT	"\x0E""tcp-io-timeout"
 #define C_TCP_MAX_CLIENTS	"\x0F""tcp-max-clients"
 #define C_TCP_OUTBUF_MAX_SIZE	"\x13""tcp-outbuf-max-size"
+#define C_TCP_OUT_OF_ORDER	"\x10""tcp-out-of-order"
+#define C_TCP_PREFIX_MAX_CLIENTS "\x16""tcp-prefix-max-clients"
 #define C_TCP_RESEND		"\x12""tcp-resend-timeout"
+#define C_TCP_ZEROCOPY		"\x0C""tcp-zerocopy"
 #define C_TCP_REUSEPORT		"\x0D""tcp-reuseport"
 #define C_TCP_RMT_IO_TIMEOUT	"\x15""tcp-remote-io-timeout"
 #define C_TCP_WORKERS		"\x0B""tcp-workers"
+#define C_TICKET_KEY_FILE	"\x0F""ticket-key-file"
 #define C_TIMEOUT		"\x07""timeout"
 #define C_TIMER			"\x05""timer"
 #define C_TIMER_DB		"\x08""timer-db"
 #define C_TIMER_DB_MAX_SIZE	"\x11""timer-db-max-size"
+#define C_TIMER_DB_SHARDS	"\x0F""timer-db-shards"
+#define C_TIMER_DB_SYNC		"\x0D""timer-db-sync"
+#define C_TIMER_JITTER		"\x0C""timer-jitter"
 #define C_TLS			"\x03""tls"
 #define C_TPL			"\x08""template"
 #define C_UDP			"\x03""udp"
+#define C_UDP_ADAPTIVE_BATCH	"\x12""udp-adaptive-batch"
 #define C_UDP_MAX_PAYLOAD	"\x0F""udp-max-payload"
 #define C_UDP_MAX_PAYLOAD_IPV4	"\x14""udp-max-payload-ipv4"
 #define C_UDP_MAX_PAYLOAD_IPV6	"\x14""udp-max-payload-ipv6"
+#define C_UDP_OFFLOAD		"\x0B""udp-offload"
+#define C_UDP_RCVBUF_MAX	"\x0E""udp-rcvbuf-max"
+#define C_UDP_TRUNC_LEARN	"\x17""udp-truncation-learning"
 #define C_UDP_WORKERS		"\x0B""udp-workers"
 #define C_UNSAFE_OPERATION	"\x10""unsafe-operation"
 #define C_UPDATE_OWNER		"\x0C""update-owner"
@@ -187,10 +234,13 @@
 #define C_VIA			"\x03""via"
 #define C_XDP			"\x03""xdp"
 #define C_ZONE			"\x04""zone"
+#define C_ZONEFILE_FMT		"\x0F""zonefile-format"
 #define C_ZONEFILE_LOAD		"\x0D""zonefile-load"
 #define C_ZONEFILE_SYNC		"\x0D""zonefile-sync"
+#define C_ZONEFILE_SYNC_BG	"\x18""zonefile-sync-background"
 #define C_ZONEMD_GENERATE	"\x0F""zonemd-generate"
 #define C_ZONEMD_VERIFY		"\x0D""zonemd-verify"
+#define C_ZONE_MAX_MEMORY	"\x0F""zone-max-memory"
 #define C_ZONE_MAX_SIZE		"\x0D""zone-max-size"
 #define C_ZONE_MAX_TTL		"\x0C""zone-max-ttl"
 #define C_ZSK_LIFETIME		"\x0C""zsk-lifetime"
@@ -260,6 +310,11 @@ enum {
 	ZONEFILE_LOAD_DIFSE = 3,
 };
 
+enum {
+	ZONEFILE_FORMAT_TEXT   = 0,
+	ZONEFILE_FORMAT_BINARY = 1,
+};
+
 enum {
 	CATALOG_ROLE_NONE      = 0,
 	CATALOG_ROLE_INTERPRET = 1,
@@ -667,6 +667,15 @@ int check_xdp(
 		check_mtu(args, &xdp_listen);
 	}
 
+	conf_val_t rrl_rate = conf_get_txn(args->extra->conf, args->extra->txn, C_XDP,
+	                                   C_RRL_RATE_LIMIT);
+	conf_val_t rrl_inst = conf_get_txn(args->extra->conf, args->extra->txn, C_XDP,
+	                                   C_RRL_INST_LIMIT);
+	if (conf_int(&rrl_rate) > 1000ll * conf_int(&rrl_inst)) {
+		args->err_str = "RRL rate limit is higher than 1000 times instant limit";
+		return KNOT_EINVAL;
+	}
+
 	if (conf_bool(&quic)) {
 #ifdef ENABLE_QUIC
 		conf_val_t port = conf_get_txn(args->extra->conf, args->extra->txn, C_XDP,
@@ -1145,6 +1154,25 @@ int check_zone(
 		}
 	}
 
+	conf_val_t lazy = conf_zone_get_txn(args->extra->conf, args->extra->txn,
+	                                    C_LAZY_LOAD, yp_dname(args->id));
+	if (conf_bool(&lazy)) {
+		conf_val_t master = conf_zone_get_txn(args->extra->conf, args->extra->txn,
+		                                      C_MASTER, yp_dname(args->id));
+		conf_val_t reverse = conf_zone_get_txn(args->extra->conf, args->extra->txn,
+		                                       C_REVERSE_GEN, yp_dname(args->id));
+		if (conf_bool(&signing) || master.code == KNOT_EOK) {
+			args->err_str = "'lazy-load' is only possible for primary zones "
+			                "without 'dnssec-signing'";
+			return KNOT_EINVAL;
+		} else if (role == CATALOG_ROLE_GENERATE || role == CATALOG_ROLE_INTERPRET ||
+		           reverse.code == KNOT_EOK) {
+			args->err_str = "'lazy-load' is not compatible with catalog zones "
+			                "and 'reverse-generate'";
+			return KNOT_EINVAL;
+		}
+	}
+
 	return KNOT_EOK;
 }
 
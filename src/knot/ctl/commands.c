@@ -26,7 +26,9 @@
 #include "knot/conf/confio.h"
 #include "knot/ctl/commands.h"
 #include "knot/ctl/process.h"
+#include "knot/dnssec/key-cache.h"
 #include "knot/dnssec/key-events.h"
+#include "knot/events/event_stats.h"
 #include "knot/events/events.h"
 #include "knot/events/handlers.h"
 #include "knot/journal/journal_metadata.h"
@@ -425,6 +427,17 @@ static int zone_status(zone_t *zone, ctl_args_t *args)
 	}
 
 	if (MATCH_OR_FILTER(args, CTL_FILTER_STATUS_EVENTS)) {
+		// Take all the event times under one lock.
+		time_t ev_times[ZONE_EVENT_COUNT];
+		zone_events_get_times(zone, ev_times);
+		time_t now = time(NULL);
+
+		knot_time_print_t format = TIME_PRINT_HUMAN_MIXED;
+		if (ctl_has_flag(args->data[KNOT_CTL_IDX_FLAGS],
+				 CTL_FILTER_STATUS_UNIXTIME)) {
+			format = TIME_PRINT_UNIX;
+		}
+
 		for (zone_event_type_t i = 0; i < ZONE_EVENT_COUNT; i++) {
 			// Events not worth showing or used elsewhere.
 			if (i == ZONE_EVENT_UFREEZE || i == ZONE_EVENT_UTHAW) {
@@ -432,15 +445,9 @@ static int zone_status(zone_t *zone, ctl_args_t *args)
 			}
 
 			data[KNOT_CTL_IDX_TYPE] = zone_events_get_name(i);
-			time_t ev_time = zone_events_get_time(zone, i);
+			time_t ev_time = ev_times[i];
 			time_t running = zone->events.running;
 
-			knot_time_print_t format = TIME_PRINT_HUMAN_MIXED;
-			if (ctl_has_flag(args->data[KNOT_CTL_IDX_FLAGS],
-					 CTL_FILTER_STATUS_UNIXTIME)) {
-				format = TIME_PRINT_UNIX;
-			}
-
 			if (running && zone->events.type == i) {
 				char val_str[16];
 				ret = knot_time_print(format, running, val_str, sizeof(val_str));
@@ -449,7 +456,7 @@ static int zone_status(zone_t *zone, ctl_args_t *args)
 				}
 			} else if (ev_time <= 0) {
 				ret = snprintf(buff, sizeof(buff), STATUS_EMPTY);
-			} else if (ev_time <= time(NULL)) {
+			} else if (ev_time <= now) {
 				bool frozen = ufrozen && ufreeze_applies(i);
 				char val_str[16];
 				ret = knot_time_print(format, ev_time, val_str, sizeof(val_str));
@@ -474,6 +481,37 @@ static int zone_status(zone_t *zone, ctl_args_t *args)
 		}
 	}
 
+	// Event latencies are shown only upon an explicit request.
+	if (MATCH_AND_FILTER(args, CTL_FILTER_STATUS_LATENCY)) {
+		event_stats_t *stats = &zone->event_stats;
+		for (zone_event_type_t i = 0; i < ZONE_EVENT_COUNT; i++) {
+			uint64_t runs = ATOMIC_GET(stats->runs[i]);
+			if (runs == 0) {
+				continue;
+			}
+
+			char item[32];
+			(void)snprintf(item, sizeof(item), "%s-latency", zone_events_get_name(i));
+			data[KNOT_CTL_IDX_TYPE] = item;
+
+			ret = snprintf(buff, sizeof(buff),
+			               "runs %"PRIu64", avg-wait %"PRIu64" us, avg-run %"PRIu64" us",
+			               runs, ATOMIC_GET(stats->time[i][EVENT_HIST_WAIT]) / runs,
+			               ATOMIC_GET(stats->time[i][EVENT_HIST_RUN]) / runs);
+			if (ret < 0 || ret >= sizeof(buff)) {
+				return KNOT_ESPACE;
+			}
+			data[KNOT_CTL_IDX_DATA] = buff;
+
+			ret = knot_ctl_send(args->ctl, type, &data);
+			if (ret != KNOT_EOK) {
+				return ret;
+			} else {
+				type = KNOT_CTL_TYPE_EXTRA;
+			}
+		}
+	}
+
 	return KNOT_EOK;
 }
 
@@ -654,15 +692,26 @@ static int init_backup(ctl_args_t *args, bool restore_mode)
 
 	bool forced = ctl_has_flag(args->data[KNOT_CTL_IDX_FLAGS], CTL_FLAG_FORCE);
 
+	bool incremental = MATCH_AND_FILTER(args, CTL_FILTER_BACKUP_INCREMENTAL);
+	if (incremental && restore_mode) {
+		return KNOT_EXPARAM;
+	}
+
 	zone_backup_ctx_t *ctx;
 
 	// The present timer db size is not up-to-date, use the maximum one.
 	conf_val_t timer_db_size = conf_db_param(conf(), C_TIMER_DB_MAX_SIZE);
 
-	int ret = zone_backup_init(restore_mode, filters, forced, backup_dir,
+	// The journal shards are backed up into a single database.
+	size_t journal_db_size = 0;
+	for (unsigned i = 0; i < args->server->journaldb_shards; i++) {
+		journal_db_size += knot_lmdb_copy_size(&args->server->journaldb[i]);
+	}
+
+	int ret = zone_backup_init(restore_mode, filters, forced, incremental, backup_dir,
 	                           knot_lmdb_copy_size(&args->server->kaspdb),
 	                           conf_int(&timer_db_size),
-	                           knot_lmdb_copy_size(&args->server->journaldb),
+	                           journal_db_size,
 	                           knot_lmdb_copy_size(&args->server->catalog.db),
 	                           &ctx);
 
@@ -1439,6 +1488,64 @@ parser_failed:
 	return ret;
 }
 
+typedef struct {
+	zone_update_t *update;
+	int ret;
+} bulk_set_ctx_t;
+
+static void bulk_set_record(zs_scanner_t *scanner)
+{
+	bulk_set_ctx_t *ctx = scanner->process.data;
+
+	knot_dname_to_lower(scanner->r_owner);
+
+	knot_rrset_t rrset;
+	knot_rrset_init(&rrset, scanner->r_owner, scanner->r_type,
+	                scanner->r_class, scanner->r_ttl);
+	ctx->ret = knot_rrset_add_rdata(&rrset, scanner->r_data,
+	                                scanner->r_data_length, NULL);
+	if (ctx->ret == KNOT_EOK) {
+		ctx->ret = zone_update_add(ctx->update, &rrset);
+	}
+	knot_rdataset_clear(&rrset.rrs, NULL);
+
+	if (ctx->ret != KNOT_EOK) {
+		scanner->state = ZS_STATE_STOP;
+	}
+}
+
+/*! Adds all records from a zone file formatted text in the data item. */
+static int zone_txn_set_bulk(zone_t *zone, ctl_args_t *args)
+{
+	const char *data = args->data[KNOT_CTL_IDX_DATA];
+	if (data == NULL) {
+		return KNOT_EINVAL;
+	}
+
+	knot_dname_txt_storage_t origin_buff;
+	char *origin = knot_dname_to_str(origin_buff, zone->name, sizeof(origin_buff));
+	if (origin == NULL) {
+		return KNOT_EINVAL;
+	}
+
+	conf_val_t val = conf_zone_get(conf(), C_DEFAULT_TTL, zone->name);
+	uint32_t default_ttl = conf_int(&val);
+
+	bulk_set_ctx_t ctx = { .update = zone->control_update, .ret = KNOT_EOK };
+
+	int ret = KNOT_EOK;
+	zs_scanner_t *scanner = &ctl_globals[args->thread_idx].scanner;
+	if (zs_init(scanner, origin, KNOT_CLASS_IN, default_ttl) != 0 ||
+	    zs_set_input_string(scanner, data, strlen(data)) != 0 ||
+	    zs_set_processing(scanner, bulk_set_record, NULL, &ctx) != 0 ||
+	    zs_parse_all(scanner) != 0) {
+		ret = KNOT_EPARSEFAIL;
+	}
+	zs_deinit(scanner);
+
+	return (ctx.ret != KNOT_EOK) ? ctx.ret : ret;
+}
+
 static int zone_txn_set_l(zone_t *zone, ctl_args_t *args)
 {
 	if (zone->control_update == NULL) {
@@ -1446,6 +1553,10 @@ static int zone_txn_set_l(zone_t *zone, ctl_args_t *args)
 		return KNOT_TXN_ENOTEXISTS;
 	}
 
+	if (ctl_has_flag(args->data[KNOT_CTL_IDX_FILTERS], CTL_FILTER_SET_BULK)) {
+		return zone_txn_set_bulk(zone, args);
+	}
+
 	if (args->data[KNOT_CTL_IDX_OWNER] == NULL ||
 	    args->data[KNOT_CTL_IDX_TYPE]  == NULL) {
 		return KNOT_EINVAL;
@@ -1552,7 +1663,7 @@ static bool zone_names_distinct(const knot_dname_t *zone, void *data)
 static int drop_journal_if_orphan(const knot_dname_t *for_zone, void *ctx)
 {
 	server_t *server = ctx;
-	zone_journal_t j = { &server->journaldb, for_zone };
+	zone_journal_t j = { server_journaldb(server, for_zone), for_zone };
 	if (!zone_exists(for_zone, server->zone_db)) {
 		return journal_scrape_with_md(j, false);
 	}
@@ -1686,16 +1797,20 @@ static int orphans_purge(ctl_args_t *args)
 
 		// Purge zone journals of unconfigured zones.
 		if (only_orphan || MATCH_AND_FILTER(args, CTL_FILTER_PURGE_JOURNAL)) {
-			ret = journals_walk(&args->server->journaldb,
-			                    drop_journal_if_orphan, args->server);
-			log_if_orphans_error(NULL, ret, "journal", &failed);
+			for (unsigned i = 0; i < args->server->journaldb_shards; i++) {
+				ret = journals_walk(&args->server->journaldb[i],
+				                    drop_journal_if_orphan, args->server);
+				log_if_orphans_error(NULL, ret, "journal", &failed);
+			}
 		}
 
 		// Purge timers of unconfigured zones.
 		if (only_orphan || MATCH_AND_FILTER(args, CTL_FILTER_PURGE_TIMERS)) {
-			ret = zone_timers_sweep(&args->server->timerdb,
-			                        zone_exists, args->server->zone_db);
-			log_if_orphans_error(NULL, ret, "timer", &failed);
+			for (unsigned i = 0; i < args->server->timerdb_shards; i++) {
+				ret = zone_timers_sweep(&args->server->timerdb[i],
+				                        zone_exists, args->server->zone_db);
+				log_if_orphans_error(NULL, ret, "timer", &failed);
+			}
 		}
 
 		// Purge and remove orphan members of non-existing/non-catalog zones.
@@ -1727,20 +1842,21 @@ static int orphans_purge(ctl_args_t *args)
 				if (only_orphan || MATCH_AND_FILTER(args, CTL_FILTER_PURGE_KASPDB)) {
 					if (knot_lmdb_open(&args->server->kaspdb) == KNOT_EOK) {
 						ret = kasp_db_delete_all(&args->server->kaspdb, zone_name);
+						key_cache_drop(zone_name);
 						log_if_orphans_error(zone_name, ret, "KASP", &failed);
 					}
 				}
 
 				// Purge zone journal.
 				if (only_orphan || MATCH_AND_FILTER(args, CTL_FILTER_PURGE_JOURNAL)) {
-					zone_journal_t j = { &args->server->journaldb, zone_name };
+					zone_journal_t j = { server_journaldb(args->server, zone_name), zone_name };
 					ret = journal_scrape_with_md(j, true);
 					log_if_orphans_error(zone_name, ret, "journal", &failed);
 				}
 
 				// Purge zone timers.
 				if (only_orphan || MATCH_AND_FILTER(args, CTL_FILTER_PURGE_TIMERS)) {
-					ret = zone_timers_sweep(&args->server->timerdb,
+					ret = zone_timers_sweep(server_timerdb(args->server, zone_name),
 					                        zone_names_distinct, zone_name);
 					log_if_orphans_error(zone_name, ret, "timer", &failed);
 				}
@@ -1860,16 +1976,40 @@ static int common_stats(ctl_args_t *args, zone_t *zone)
 		int ret = stats_server(ctl_dump_ctr, &dump_ctx);
 		STATS_CHECK(ret, true);
 
+		ret = stats_runtime(ctl_dump_ctr, &dump_ctx);
+		STATS_CHECK(ret, true);
+
 		ret = stats_xdp(ctl_dump_ctr, &dump_ctx);
 		STATS_CHECK(ret, true);
 
+		ret = stats_journal(ctl_dump_ctr, &dump_ctx);
+		STATS_CHECK(ret, true);
+
+		ret = stats_xfr(ctl_dump_ctr, &dump_ctx);
+		STATS_CHECK(ret, true);
+
+		ret = stats_events(ctl_dump_ctr, &dump_ctx);
+		STATS_CHECK(ret, true);
+
 		dump_ctx.query_modules = conf()->query_modules;
 		ret = stats_modules(ctl_dump_ctr, &dump_ctx);
 		STATS_CHECK(ret, true);
+
+		ret = stats_shared_modules(ctl_dump_ctr, &dump_ctx);
+		STATS_CHECK(ret, true);
 	} else {
 		int ret = stats_zone(ctl_dump_ctr, &dump_ctx);
 		STATS_CHECK(ret, false);
 
+		ret = stats_journal(ctl_dump_ctr, &dump_ctx);
+		STATS_CHECK(ret, false);
+
+		ret = stats_xfr(ctl_dump_ctr, &dump_ctx);
+		STATS_CHECK(ret, false);
+
+		ret = stats_events(ctl_dump_ctr, &dump_ctx);
+		STATS_CHECK(ret, false);
+
 		dump_ctx.query_modules = &zone->query_modules;
 		ret = stats_modules(ctl_dump_ctr, &dump_ctx);
 		STATS_CHECK(ret, false);
@@ -2055,6 +2195,37 @@ static int ctl_stats(ctl_args_t *args, _unused_ ctl_cmd_t cmd)
 	return common_stats(args, NULL);
 }
 
+static int compact_db(ctl_args_t *args, knot_lmdb_db_t *db, const char *db_type)
+{
+	size_t before = 0, after = 0;
+	int ret = knot_lmdb_compact(db, &before, &after);
+	if (ret != KNOT_EOK) {
+		log_ctl_error("control, failed to compact %s database (%s)",
+		              db_type, knot_strerror(ret));
+		ctl_send_error(args, knot_strerror(ret));
+	} else if (before > 0) {
+		log_ctl_info("control, %s database compacted, size %zu -> %zu bytes",
+		             db_type, before, after);
+	}
+	return ret;
+}
+
+static int ctl_compact(ctl_args_t *args, _unused_ ctl_cmd_t cmd)
+{
+	int ret = KNOT_EOK;
+	for (unsigned i = 0; i < args->server->journaldb_shards; i++) {
+		int ret2 = compact_db(args, &args->server->journaldb[i], "journal");
+		ret = (ret == KNOT_EOK) ? ret2 : ret;
+	}
+	for (unsigned i = 0; i < args->server->timerdb_shards; i++) {
+		int ret2 = compact_db(args, &args->server->timerdb[i], "timer");
+		ret = (ret == KNOT_EOK) ? ret2 : ret;
+	}
+	int ret2 = compact_db(args, &args->server->kaspdb, "KASP");
+
+	return (ret == KNOT_EOK) ? ret2 : ret;
+}
+
 static int send_block_data(conf_io_t *io, knot_ctl_data_t *data)
 {
 	knot_ctl_t *ctl = (knot_ctl_t *)io->misc;
@@ -2378,6 +2549,7 @@ typedef enum {
 	CTL_LOCK_NONE   = 0x00,
 	CTL_LOCK_SRV_R  = 0x01, // Can run in parallel with other R commands.
 	CTL_LOCK_SRV_W  = 0x02, // Cannot run in parallel with other commands.
+	CTL_LOCK_RCU    = 0x04, // Read-only monitoring, runs in parallel with any command.
 } ctl_lock_flag_t;
 
 typedef struct {
@@ -2392,7 +2564,8 @@ static const desc_t cmd_table[] = {
 	[CTL_STATUS]          = { "status",             ctl_server,       CTL_LOCK_SRV_R },
 	[CTL_STOP]            = { "stop",               ctl_server,       CTL_LOCK_SRV_R },
 	[CTL_RELOAD]          = { "reload",             ctl_server,       CTL_LOCK_SRV_W },
-	[CTL_STATS]           = { "stats",              ctl_stats,        CTL_LOCK_SRV_R },
+	[CTL_STATS]           = { "stats",              ctl_stats,        CTL_LOCK_RCU },
+	[CTL_COMPACT]         = { "compact",            ctl_compact,      CTL_LOCK_SRV_R },
 
 	[CTL_ZONE_STATUS]     = { "zone-status",        ctl_zone,         CTL_LOCK_SRV_R },
 	[CTL_ZONE_RELOAD]     = { "zone-reload",        ctl_zone,         CTL_LOCK_SRV_R },
@@ -2421,7 +2594,7 @@ static const desc_t cmd_table[] = {
 	[CTL_ZONE_SET]        = { "zone-set",           ctl_zone,         CTL_LOCK_SRV_R },
 	[CTL_ZONE_UNSET]      = { "zone-unset",         ctl_zone,         CTL_LOCK_SRV_R },
 	[CTL_ZONE_PURGE]      = { "zone-purge",         ctl_zone,         CTL_LOCK_SRV_W },
-	[CTL_ZONE_STATS]      = { "zone-stats",	        ctl_zone,         CTL_LOCK_SRV_R },
+	[CTL_ZONE_STATS]      = { "zone-stats",	        ctl_zone,         CTL_LOCK_RCU },
 
 	[CTL_CONF_LIST]       = { "conf-list",          ctl_conf_list,    CTL_LOCK_SRV_R }, // Can either read live conf or conf txn. The latter would deserve CTL_LOCK_SRV_W, but when conf txn exists, all cmds are done by single thread anyway.
 	[CTL_CONF_READ]       = { "conf-read",          ctl_conf_read,    CTL_LOCK_SRV_R },
@@ -2499,6 +2672,14 @@ int ctl_exec(ctl_cmd_t cmd, ctl_args_t *args)
 		return KNOT_EINVAL;
 	}
 
+	// Counters are consistent enough without waiting for a reload or so.
+	if (cmd_table[cmd].locks & CTL_LOCK_RCU) {
+		rcu_read_lock();
+		int ret = cmd_table[cmd].fcn(args, cmd);
+		rcu_read_unlock();
+		return ret;
+	}
+
 	int ret = ctl_lock(args->server, cmd_table[cmd].locks, conf()->cache.ctl_timeout);
 	if (ret == KNOT_EOK) {
 		ret = cmd_table[cmd].fcn(args, cmd);
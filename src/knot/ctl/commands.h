@@ -37,6 +37,7 @@
 #define CTL_FILTER_STATUS_FREEZE	"f"
 #define CTL_FILTER_STATUS_CATALOG	"c"
 #define CTL_FILTER_STATUS_EVENTS	"e"
+#define CTL_FILTER_STATUS_LATENCY	"l"
 #define CTL_FILTER_STATUS_UNIXTIME	"u"
 #define CTL_FILTER_STATUS_EMPTY_R	"e"
 #define CTL_FILTER_STATUS_SLAVE_R	"s"
@@ -65,9 +66,12 @@
 #define CTL_FILTER_BACKUP_NOCATALOG	"C"
 #define CTL_FILTER_BACKUP_QUIC		"q"
 #define CTL_FILTER_BACKUP_NOQUIC	"Q"
+#define CTL_FILTER_BACKUP_INCREMENTAL	"i"
 
 #define CTL_FILTER_BEGIN_BENEVOLENT	"b"
 
+#define CTL_FILTER_SET_BULK		"b"
+
 #define STATUS_EMPTY			"-"
 
 /*! Optional 'status' command parameters. */
@@ -88,6 +92,7 @@ typedef enum {
 	CTL_STOP,
 	CTL_RELOAD,
 	CTL_STATS,
+	CTL_COMPACT,
 
 	CTL_ZONE_STATUS,
 	CTL_ZONE_RELOAD,
@@ -93,6 +93,12 @@ static void policy_load(knot_kasp_policy_t *policy, conf_t *conf, conf_val_t *id
 	val = conf_id_get(conf, C_POLICY, C_RRSIG_PREREFRESH, id);
 	policy->rrsig_prerefresh = conf_int(&val);
 
+	val = conf_id_get(conf, C_POLICY, C_RRSIG_INDEX, id);
+	policy->rrsig_index = conf_bool(&val);
+
+	val = conf_id_get(conf, C_POLICY, C_RRSIG_STORE, id);
+	policy->rrsig_store = conf_bool(&val);
+
 	val = conf_id_get(conf, C_POLICY, C_REPRO_SIGNING, id);
 	policy->reproducible_sign = conf_bool(&val);
 
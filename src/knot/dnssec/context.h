@@ -25,6 +25,7 @@
 
 typedef struct {
 	size_t rrsig_count;
+	size_t rrsig_reused;
 	knot_time_t expire;
 
 	knot_spin_t lock;
@@ -26,10 +26,13 @@
 #include "knot/query/requestor.h"
 #include "knot/server/server.h"
 
-#define DS_CHECK_LOG(priority, zone, remote, flags, fmt, ...) \
+#define DS_CHECK_PROTO_LOG(priority, zone, remote, proto, reused, fmt, ...) \
 	ns_log(priority, zone, LOG_OPERATION_DS_CHECK, LOG_DIRECTION_OUT, &(remote)->addr, \
-	       flags2proto(flags), ((flags) & KNOT_REQUESTOR_REUSED), (remote)->key.name, \
-	       fmt, ## __VA_ARGS__)
+	       proto, reused, (remote)->key.name, fmt, ## __VA_ARGS__)
+
+#define DS_CHECK_LOG(priority, zone, remote, flags, fmt, ...) \
+	DS_CHECK_PROTO_LOG(priority, zone, remote, flags2proto(flags), \
+	                   ((flags) & KNOT_REQUESTOR_REUSED), fmt, ## __VA_ARGS__)
 
 static bool match_key_ds(knot_kasp_key_t *key, knot_rdata_t *ds)
 {
@@ -108,16 +111,16 @@ static int ds_query_produce(knot_layer_t *layer, knot_pkt_t *pkt)
 	return KNOT_STATE_CONSUME;
 }
 
-static int ds_query_consume(knot_layer_t *layer, knot_pkt_t *pkt)
+static int ds_answer_check(struct ds_query_data *data, const knot_pkt_t *pkt,
+                           knotd_query_proto_t proto, bool reused)
 {
-	struct ds_query_data *data = layer->data;
 	data->result_logged = true;
 
 	uint16_t rcode = knot_pkt_ext_rcode(pkt);
 	if (rcode != KNOT_RCODE_NOERROR) {
-		DS_CHECK_LOG((rcode == KNOT_RCODE_NXDOMAIN ? LOG_NOTICE : LOG_WARNING),
-		             data->zone_name, data->remote, layer->flags,
-		             "failed (%s)", knot_pkt_ext_rcode_name(pkt));
+		DS_CHECK_PROTO_LOG((rcode == KNOT_RCODE_NXDOMAIN ? LOG_NOTICE : LOG_WARNING),
+		                   data->zone_name, data->remote, proto, reused,
+		                   "failed (%s)", knot_pkt_ext_rcode_name(pkt));
 		return KNOT_STATE_FAIL;
 	}
 
@@ -151,8 +154,8 @@ static int ds_query_consume(knot_layer_t *layer, knot_pkt_t *pkt)
 		match = false;
 	}
 
-	DS_CHECK_LOG(LOG_INFO, data->zone_name, data->remote, layer->flags,
-	             "KSK submission check: %s", (match ? "positive" : "negative"));
+	DS_CHECK_PROTO_LOG(LOG_INFO, data->zone_name, data->remote, proto, reused,
+	                   "KSK submission check: %s", (match ? "positive" : "negative"));
 
 	if (match) {
 		data->ds_ok = true;
@@ -160,6 +163,12 @@ static int ds_query_consume(knot_layer_t *layer, knot_pkt_t *pkt)
 	return KNOT_STATE_DONE;
 }
 
+static int ds_query_consume(knot_layer_t *layer, knot_pkt_t *pkt)
+{
+	return ds_answer_check(layer->data, pkt, flags2proto(layer->flags),
+	                       layer->flags & KNOT_REQUESTOR_REUSED);
+}
+
 static const knot_layer_api_t ds_query_api = {
 	.begin = ds_query_begin,
 	.produce = ds_query_produce,
@@ -233,13 +242,85 @@ static knot_kasp_key_t *get_not_key(kdnssec_ctx_t *kctx, knot_kasp_key_t *key)
 	return not_key;
 }
 
+static int batch_ds(conf_t *conf, const knot_dname_t *zone_name, const conf_remote_t *parent,
+                    server_t *server, size_t timeout, knot_pkt_t **resp)
+{
+	query_edns_data_t edns = query_edns_data_init(conf, parent, QUERY_EDNS_OPT_DO);
+
+	return soa_batch_query(server->soa_batch, zone_name, KNOT_RRTYPE_DS,
+	                       ZONE_EVENT_DS_CHECK, parent, &edns, timeout, resp);
+}
+
+/*!
+ * Queues the DS queries to the first address of each parent, so that the zones
+ * sharing the parent are queried together. Fails unless all are finished.
+ */
+static int parents_batch_ready(conf_t *conf, kdnssec_ctx_t *kctx, server_t *server,
+                               size_t timeout)
+{
+	int ret = KNOT_EOK;
+	knot_dynarray_foreach(parent, knot_kasp_parent_t, i, kctx->policy->parents) {
+		if (i->addrs > 0 && batch_ds(conf, kctx->zone->dname, &i->addr[0],
+		                             server, timeout, NULL) == KNOT_EAGAIN) {
+			ret = KNOT_EAGAIN;
+		}
+	}
+	return ret;
+}
+
+static int try_batched_ds(conf_t *conf, const knot_dname_t *zone_name,
+                          const conf_remote_t *parent, knot_kasp_key_t *key,
+                          knot_kasp_key_t *not_key, server_t *server,
+                          size_t timeout, uint32_t *ds_ttl)
+{
+	knot_pkt_t *resp = NULL;
+	int ret = batch_ds(conf, zone_name, parent, server, timeout, &resp);
+	if (ret != KNOT_EOK || resp == NULL) {
+		return KNOT_ENOENT; // Not available, e.g. truncated.
+	}
+
+	struct ds_query_data data = {
+		.zone_name = zone_name,
+		.remote = parent,
+		.key = key,
+		.not_key = not_key,
+	};
+
+	ret = ds_answer_check(&data, resp, KNOTD_QUERY_PROTO_UDP, false);
+	knot_pkt_free(resp);
+
+	*ds_ttl = data.ttl;
+
+	if (ret == KNOT_STATE_DONE) {
+		return data.ds_ok ? KNOT_EOK : KNOT_ENORECORD;
+	}
+	return KNOT_ERROR;
+}
+
 static bool parents_have_ds(conf_t *conf, kdnssec_ctx_t *kctx, knot_kasp_key_t *key,
-                            server_t *server, size_t timeout, uint32_t *max_ds_ttl)
+                            server_t *server, size_t timeout, bool batched,
+                            uint32_t *max_ds_ttl)
 {
 	bool success = false;
 	knot_dynarray_foreach(parent, knot_kasp_parent_t, i, kctx->policy->parents) {
 		success = false;
-		for (size_t j = 0; j < i->addrs; j++) {
+		size_t first = 0;
+		if (batched && i->addrs > 0) {
+			uint32_t ds_ttl = 0;
+			int ret = try_batched_ds(conf, kctx->zone->dname, &i->addr[0], key,
+			                         get_not_key(kctx, key), server, timeout, &ds_ttl);
+			if (ret == KNOT_EOK) {
+				*max_ds_ttl = MAX(*max_ds_ttl, ds_ttl);
+				success = true;
+				continue;
+			} else if (ret == KNOT_ENORECORD) {
+				return false;
+			} else if (ret == KNOT_ERROR) {
+				first = 1; // Responded with an error, already logged.
+			}
+			// Otherwise query the parent addresses one by one.
+		}
+		for (size_t j = first; j < i->addrs; j++) {
 			uint32_t ds_ttl = 0;
 			int ret = try_ds(conf, kctx->zone->dname, &i->addr[j], key,
 			                 get_not_key(kctx, key), server, timeout, &ds_ttl);
@@ -261,17 +342,25 @@ static bool parents_have_ds(conf_t *conf, kdnssec_ctx_t *kctx, knot_kasp_key_t *
 }
 
 int knot_parent_ds_query(conf_t *conf, kdnssec_ctx_t *kctx, struct server *server,
-                         size_t timeout)
+                         size_t timeout, bool batched)
 {
 	uint32_t max_ds_ttl = 0;
 
+	batched = batched && server->soa_batch != NULL;
+
 	for (size_t i = 0; i < kctx->zone->num_keys; i++) {
 		knot_kasp_key_t *key = &kctx->zone->keys[i];
 		if (!key->is_pub_only &&
 		    knot_time_cmp(key->timing.ready, kctx->now) <= 0 &&
 		    knot_time_cmp(key->timing.active, kctx->now) > 0) {
 			assert(key->is_ksk);
-			if (parents_have_ds(conf, kctx, key, server, timeout, &max_ds_ttl)) {
+			if (batched) {
+				int ret = parents_batch_ready(conf, kctx, server, timeout);
+				if (ret != KNOT_EOK) {
+					return ret;
+				}
+			}
+			if (parents_have_ds(conf, kctx, key, server, timeout, batched, &max_ds_ttl)) {
 				return knot_dnssec_ksk_sbm_confirm(kctx, max_ds_ttl + kctx->policy->ksk_sbm_delay);
 			} else {
 				return KNOT_ENOENT;
@@ -21,5 +21,20 @@
 
 struct server;
 
+/*!
+ * \brief Check if the ready KSK has its DS published at all the parents.
+ *
+ * \param conf      Configuration.
+ * \param kctx      DNSSEC context of the zone.
+ * \param server    Server instance.
+ * \param timeout   Query timeout in milliseconds.
+ * \param batched   Query via the server's batched checker, which schedules
+ *                  the zone DS check event again once the responses arrive.
+ *
+ * \retval KNOT_EOK            Submission confirmed.
+ * \retval KNOT_EAGAIN         Batched queries in progress.
+ * \retval KNOT_NO_READY_KEY   No KSK waiting for submission.
+ * \return KNOT_E*             DS not found or the check failed.
+ */
 int knot_parent_ds_query(conf_t *conf, kdnssec_ctx_t *kctx, struct server *server,
-                         size_t timeout);
+                         size_t timeout, bool batched);
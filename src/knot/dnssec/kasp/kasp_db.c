@@ -22,6 +22,9 @@
 #include "contrib/strtonum.h"
 #include "contrib/wire_ctx.h"
 #include "knot/dnssec/key_records.h"
+#include "knot/dnssec/rrset-sign.h"
+#include "knot/dnssec/zone-nsec.h"
+#include "libknot/wire.h"
 
 typedef enum {
 	KASPDBKEY_PARAMS = 0x1,
@@ -32,6 +35,8 @@ typedef enum {
 	KASPDBKEY_LASTSIGNEDSERIAL = 0x6,
 	KASPDBKEY_OFFLINE_RECORDS = 0x7,
 	KASPDBKEY_SAVED_TTLS = 0x8,
+	KASPDBKEY_NSEC3HASHES = 0x9,
+	KASPDBKEY_RRSIGSTORE = 0xa,
 } keyclass_t;
 
 static const keyclass_t zone_related_classes[] = {
@@ -42,6 +47,8 @@ static const keyclass_t zone_related_classes[] = {
 	KASPDBKEY_LASTSIGNEDSERIAL,
 	KASPDBKEY_OFFLINE_RECORDS,
 	KASPDBKEY_SAVED_TTLS,
+	KASPDBKEY_NSEC3HASHES,
+	KASPDBKEY_RRSIGSTORE,
 };
 static const size_t zone_related_classes_size = sizeof(zone_related_classes) / sizeof(*zone_related_classes);
 
@@ -76,6 +83,8 @@ static MDB_val make_key_str(keyclass_t kclass, const knot_dname_t *dname, const
 	case KASPDBKEY_LASTSIGNEDSERIAL:
 	case KASPDBKEY_MASTERSERIAL:
 	case KASPDBKEY_SAVED_TTLS:
+	case KASPDBKEY_NSEC3HASHES:
+	case KASPDBKEY_RRSIGSTORE:
 		assert(dname != NULL && str == NULL);
 		return knot_lmdb_make_key("BN", (int)kclass, dname);
 	case KASPDBKEY_PARAMS:
@@ -586,6 +595,343 @@ int kasp_db_set_saved_ttls(knot_lmdb_db_t *db, const knot_dname_t *zone,
 	return knot_lmdb_quick_insert(db, key, val);
 }
 
+// NSEC3 hash cache: <class> <zone> 0x00 -> <algorithm> <iterations> <salt>
+//                   <class> <zone> 0x01 <owner in lookup format> -> <hash label>
+#define NSEC3HASH_KEY_MAX (1 + 2 * KNOT_DNAME_MAXLEN + 1)
+
+static size_t nsec3hash_key(uint8_t *key, const knot_dname_t *zone, const knot_dname_t *owner)
+{
+	size_t zone_size = knot_dname_size(zone);
+	key[0] = KASPDBKEY_NSEC3HASHES;
+	memcpy(key + 1, zone, zone_size);
+	size_t len = 1 + zone_size;
+	key[len++] = (owner != NULL);
+	if (owner != NULL) {
+		knot_dname_storage_t lf_storage;
+		uint8_t *lf = knot_dname_lf(owner, lf_storage);
+		memcpy(key + len, lf + 1, lf[0]);
+		len += lf[0];
+	}
+	return len;
+}
+
+static MDB_val nsec3hash_params(const dnssec_nsec3_params_t *params)
+{
+	return knot_lmdb_make_key("BHD", (int)params->algorithm, (int)params->iterations,
+	                          params->salt.data, (size_t)params->salt.size);
+}
+
+int kasp_db_load_nsec3_hashes(knot_lmdb_db_t *db, zone_contents_t *contents,
+                              size_t *missing)
+{
+	*missing = 0;
+	if (!knot_is_nsec3_enabled(contents)) {
+		return KNOT_EOK;
+	}
+
+	int ret = knot_lmdb_open(db);
+	if (ret != KNOT_EOK) {
+		return ret;
+	}
+
+	uint8_t key_data[NSEC3HASH_KEY_MAX];
+	MDB_val key = { nsec3hash_key(key_data, contents->apex->owner, NULL), key_data };
+	MDB_val params = nsec3hash_params(&contents->nsec3_params);
+	size_t apex_size = knot_dname_size(contents->apex->owner);
+	size_t hash_size = zone_nsec3_name_len(contents);
+
+	knot_lmdb_txn_t txn = { 0 };
+	knot_lmdb_begin(db, &txn, false);
+	bool valid = knot_lmdb_find(&txn, &key, KNOT_LMDB_EXACT) &&
+	             txn.cur_val.mv_size == params.mv_size &&
+	             memcmp(txn.cur_val.mv_data, params.mv_data, params.mv_size) == 0;
+
+	zone_tree_it_t it = { 0 };
+	ret = zone_tree_it_begin(contents->nodes, &it);
+	while (ret == KNOT_EOK && txn.ret == KNOT_EOK && !zone_tree_it_finished(&it)) {
+		zone_node_t *node = zone_tree_it_val(&it);
+		zone_tree_it_next(&it);
+		if (node->nsec3_hash != NULL || (node->flags & NODE_FLAGS_NSEC3_NODE)) {
+			continue;
+		}
+		key.mv_size = nsec3hash_key(key_data, contents->apex->owner, node->owner);
+		if (!valid || !knot_lmdb_find(&txn, &key, KNOT_LMDB_EXACT) ||
+		    txn.cur_val.mv_size + apex_size != hash_size) {
+			(*missing)++;
+			continue;
+		}
+		node->nsec3_hash = malloc(hash_size);
+		if (node->nsec3_hash == NULL) {
+			ret = KNOT_ENOMEM;
+			break;
+		}
+		memcpy(node->nsec3_hash, txn.cur_val.mv_data, txn.cur_val.mv_size);
+		memcpy(node->nsec3_hash + txn.cur_val.mv_size, contents->apex->owner, apex_size);
+	}
+	zone_tree_it_free(&it);
+	knot_lmdb_abort(&txn);
+	free(params.mv_data);
+
+	return ret == KNOT_EOK ? txn.ret : ret;
+}
+
+int kasp_db_store_nsec3_hashes(knot_lmdb_db_t *db, const zone_contents_t *contents)
+{
+	if (!knot_is_nsec3_enabled(contents)) {
+		return KNOT_EOK;
+	}
+
+	int ret = knot_lmdb_open(db);
+	if (ret != KNOT_EOK) {
+		return ret;
+	}
+
+	uint8_t key_data[NSEC3HASH_KEY_MAX];
+	MDB_val prefix = make_key_str(KASPDBKEY_NSEC3HASHES, contents->apex->owner, NULL);
+	MDB_val key = { nsec3hash_key(key_data, contents->apex->owner, NULL), key_data };
+	MDB_val params = nsec3hash_params(&contents->nsec3_params);
+
+	knot_lmdb_txn_t txn = { 0 };
+	knot_lmdb_begin(db, &txn, true);
+	knot_lmdb_del_prefix(&txn, &prefix);
+	knot_lmdb_insert(&txn, &key, &params);
+
+	zone_tree_it_t it = { 0 };
+	ret = zone_tree_it_begin(contents->nodes, &it);
+	while (ret == KNOT_EOK && txn.ret == KNOT_EOK && !zone_tree_it_finished(&it)) {
+		zone_node_t *node = zone_tree_it_val(&it);
+		zone_tree_it_next(&it);
+		const knot_dname_t *hash = node_nsec3_hash(node, contents);
+		if (hash == NULL) {
+			continue;
+		}
+		key.mv_size = nsec3hash_key(key_data, contents->apex->owner, node->owner);
+		MDB_val val = { 1 + hash[0], (void *)hash };
+		knot_lmdb_insert(&txn, &key, &val);
+	}
+	zone_tree_it_free(&it);
+	if (ret == KNOT_EOK) {
+		knot_lmdb_commit(&txn);
+	} else {
+		knot_lmdb_abort(&txn);
+	}
+	free(prefix.mv_data);
+	free(params.mv_data);
+
+	return ret == KNOT_EOK ? txn.ret : ret;
+}
+
+// RRSIG store: <class> <zone> 0x00 -> { <DNSKEY rdata length> <DNSKEY rdata> }*
+//              <class> <zone> 0x01 <owner size> <owner in lookup format relative to zone> <type>
+//                  -> <TTL> <covered rdataset> <RRSIG rdataset>
+#define RRSIGSTORE_KEY_MAX (1 + KNOT_DNAME_MAXLEN + 1 + 1 + KNOT_DNAME_MAXLEN + sizeof(uint16_t))
+
+static size_t rrsigstore_key(uint8_t *key, const knot_dname_t *zone,
+                             const knot_dname_t *owner, uint16_t type)
+{
+	size_t zone_size = knot_dname_size(zone);
+	key[0] = KASPDBKEY_RRSIGSTORE;
+	memcpy(key + 1, zone, zone_size);
+	size_t len = 1 + zone_size;
+	key[len++] = (owner != NULL);
+	if (owner != NULL) {
+		knot_dname_storage_t lf_storage;
+		uint8_t zone_lf_size = knot_dname_lf(zone, lf_storage)[0];
+		uint8_t *lf = knot_dname_lf(owner, lf_storage);
+		assert(lf[0] >= zone_lf_size);
+		key[len++] = lf[0] - zone_lf_size;
+		memcpy(key + len, lf + 1 + zone_lf_size, lf[0] - zone_lf_size);
+		len += lf[0] - zone_lf_size;
+		if (type != 0) { // Otherwise prefix of all owner's records.
+			knot_wire_write_u16(key + len, type);
+			len += sizeof(uint16_t);
+		}
+	}
+	return len;
+}
+
+static void rrsigstore_write_rrs(wire_ctx_t *wire, const knot_rdataset_t *rrs)
+{
+	wire_ctx_write_u16(wire, rrs->count);
+	wire_ctx_write_u32(wire, rrs->size);
+	wire_ctx_write(wire, rrs->rdata, rrs->size);
+}
+
+static void rrsigstore_read_rrs(wire_ctx_t *wire, knot_rdataset_t *rrs)
+{
+	rrs->count = wire_ctx_read_u16(wire);
+	rrs->size = wire_ctx_read_u32(wire);
+	rrs->rdata = (knot_rdata_t *)wire->position;
+	wire_ctx_skip(wire, rrs->size);
+}
+
+static bool rrsigstore_has_key(const MDB_val *keys, const uint8_t *key, size_t key_size)
+{
+	wire_ctx_t wire = wire_ctx_init_const(keys->mv_data, keys->mv_size);
+	while (wire_ctx_available(&wire) > 0 && wire.error == KNOT_EOK) {
+		const uint8_t *pos = wire.position;
+		wire_ctx_skip(&wire, wire_ctx_read_u16(&wire));
+		if (wire.error == KNOT_EOK && wire.position - pos == key_size &&
+		    memcmp(pos, key, key_size) == 0) {
+			return true;
+		}
+	}
+	return false;
+}
+
+static void rrsigstore_insert_keys(knot_lmdb_txn_t *txn, MDB_val *key,
+                                   const dnssec_binary_t *keys, bool replace)
+{
+	MDB_val old = { 0 };
+	if (!replace && knot_lmdb_find(txn, key, KNOT_LMDB_EXACT)) {
+		old = txn->cur_val;
+	}
+
+	MDB_val val = { 0, malloc(old.mv_size + keys->size) };
+	if (val.mv_data == NULL) {
+		txn->ret = KNOT_ENOMEM;
+		return;
+	}
+	memcpy(val.mv_data, old.mv_data, old.mv_size);
+	val.mv_size = old.mv_size;
+
+	// Keep the keys of RRSIGs stored before, they may still be there.
+	wire_ctx_t wire = wire_ctx_init_const(keys->data, keys->size);
+	while (wire_ctx_available(&wire) > 0 && wire.error == KNOT_EOK) {
+		const uint8_t *pos = wire.position;
+		wire_ctx_skip(&wire, wire_ctx_read_u16(&wire));
+		size_t size = wire.position - pos;
+		if (wire.error == KNOT_EOK && !rrsigstore_has_key(&old, pos, size)) {
+			memcpy(val.mv_data + val.mv_size, pos, size);
+			val.mv_size += size;
+		}
+	}
+
+	knot_lmdb_insert(txn, key, &val);
+	free(val.mv_data);
+}
+
+static void rrsigstore_insert_node(knot_lmdb_txn_t *txn, const knot_dname_t *zone,
+                                   const zone_node_t *node)
+{
+	knot_rdataset_t *rrsigs = node_rdataset(node, KNOT_RRTYPE_RRSIG);
+	if (rrsigs == NULL) {
+		return;
+	}
+
+	uint8_t key_data[RRSIGSTORE_KEY_MAX];
+	for (uint16_t i = 0; i < node->rrset_count && txn->ret == KNOT_EOK; i++) {
+		knot_rrset_t rrset = node_rrset_at(node, i);
+		if (rrset.type == KNOT_RRTYPE_RRSIG ||
+		    !knot_synth_rrsig_exists(rrset.type, rrsigs)) {
+			continue;
+		}
+
+		knot_rdataset_t sigs = { 0 };
+		txn->ret = knot_synth_rrsig(rrset.type, rrsigs, &sigs, NULL);
+		if (txn->ret != KNOT_EOK) {
+			break;
+		}
+
+		MDB_val key = { rrsigstore_key(key_data, zone, node->owner, rrset.type), key_data };
+		MDB_val val = { sizeof(uint32_t) + 2 * (sizeof(uint16_t) + sizeof(uint32_t)) +
+		                rrset.rrs.size + sigs.size, NULL };
+		if (knot_lmdb_insert(txn, &key, &val)) {
+			wire_ctx_t wire = wire_ctx_init(val.mv_data, val.mv_size);
+			wire_ctx_write_u32(&wire, rrset.ttl);
+			rrsigstore_write_rrs(&wire, &rrset.rrs);
+			rrsigstore_write_rrs(&wire, &sigs);
+			assert(wire.error == KNOT_EOK && wire_ctx_available(&wire) == 0);
+		}
+		knot_rdataset_clear(&sigs, NULL);
+	}
+}
+
+int kasp_db_store_rrsigs(knot_lmdb_db_t *db, const knot_dname_t *zone,
+                         const dnssec_binary_t *keys, zone_tree_t *nodes,
+                         zone_tree_t *nsec3_nodes, bool replace)
+{
+	uint8_t key_data[RRSIGSTORE_KEY_MAX];
+	MDB_val key = { rrsigstore_key(key_data, zone, NULL, 0), key_data };
+
+	knot_lmdb_txn_t txn = { 0 };
+	knot_lmdb_begin(db, &txn, true);
+	if (replace) {
+		MDB_val prefix = make_key_str(KASPDBKEY_RRSIGSTORE, zone, NULL);
+		knot_lmdb_del_prefix(&txn, &prefix);
+		free(prefix.mv_data);
+	}
+	rrsigstore_insert_keys(&txn, &key, keys, replace);
+
+	zone_tree_t *trees[] = { nodes, nsec3_nodes };
+	for (int i = 0; i < 2 && txn.ret == KNOT_EOK; i++) {
+		zone_tree_it_t it = { 0 };
+		int ret = zone_tree_it_begin(trees[i], &it);
+		if (ret != KNOT_EOK) {
+			txn.ret = ret;
+			break;
+		}
+		while (!zone_tree_it_finished(&it) && txn.ret == KNOT_EOK) {
+			zone_node_t *node = zone_tree_it_val(&it);
+			if (!replace) {
+				key.mv_size = rrsigstore_key(key_data, zone, node->owner, 0);
+				knot_lmdb_del_prefix(&txn, &key);
+			}
+			rrsigstore_insert_node(&txn, zone, node);
+			zone_tree_it_next(&it);
+		}
+		zone_tree_it_free(&it);
+	}
+
+	knot_lmdb_commit(&txn);
+	return txn.ret;
+}
+
+int kasp_db_load_rrsig_keys(knot_lmdb_db_t *db, const knot_dname_t *zone,
+                            dnssec_binary_t *keys)
+{
+	uint8_t key_data[RRSIGSTORE_KEY_MAX];
+	MDB_val key = { rrsigstore_key(key_data, zone, NULL, 0), key_data };
+
+	knot_lmdb_txn_t txn = { 0 };
+	knot_lmdb_begin(db, &txn, false);
+	if (knot_lmdb_find(&txn, &key, KNOT_LMDB_EXACT | KNOT_LMDB_FORCE)) {
+		dnssec_binary_t found = { .size = txn.cur_val.mv_size, .data = txn.cur_val.mv_data };
+		txn.ret = knot_error_from_libdnssec(dnssec_binary_dup(&found, keys));
+	}
+	knot_lmdb_abort(&txn);
+	return txn.ret;
+}
+
+int kasp_db_load_rrsigs(knot_lmdb_db_t *db, const knot_dname_t *zone,
+                        const knot_rrset_t *covered, knot_rdataset_t *rrsigs)
+{
+	uint8_t key_data[RRSIGSTORE_KEY_MAX];
+	MDB_val key = { rrsigstore_key(key_data, zone, covered->owner, covered->type), key_data };
+
+	knot_lmdb_txn_t txn = { 0 };
+	knot_lmdb_begin(db, &txn, false);
+	if (knot_lmdb_find(&txn, &key, KNOT_LMDB_EXACT | KNOT_LMDB_FORCE)) {
+		knot_rdataset_t stored_covered, stored_sigs;
+		wire_ctx_t wire = wire_ctx_init_const(txn.cur_val.mv_data, txn.cur_val.mv_size);
+		uint32_t ttl = wire_ctx_read_u32(&wire);
+		rrsigstore_read_rrs(&wire, &stored_covered);
+		rrsigstore_read_rrs(&wire, &stored_sigs);
+		if (wire.error != KNOT_EOK) {
+			txn.ret = KNOT_EMALF;
+		} else if (ttl != covered->ttl ||
+		           stored_covered.count != covered->rrs.count ||
+		           stored_covered.size != covered->rrs.size ||
+		           memcmp(stored_covered.rdata, covered->rrs.rdata, covered->rrs.size) != 0) {
+			txn.ret = KNOT_ENOENT; // RRSIGs of different records.
+		} else {
+			txn.ret = knot_rdataset_copy(rrsigs, &stored_sigs, NULL);
+		}
+	}
+	knot_lmdb_abort(&txn);
+	return txn.ret;
+}
+
 void kasp_db_ensure_init(knot_lmdb_db_t *db, conf_t *conf)
 {
 	if (db->path == NULL) {
@@ -598,15 +944,21 @@ void kasp_db_ensure_init(knot_lmdb_db_t *db, conf_t *conf)
 }
 
 static int kasp_db_backup_generic(const knot_dname_t *zone, knot_lmdb_db_t *db, knot_lmdb_db_t *backup_db,
-                                  const keyclass_t *classes, const size_t classes_size)
+                                  const keyclass_t *classes, const size_t classes_size,
+                                  bool changed_only)
 {
 	size_t n_prefs = classes_size;
 
 	// NOTE: for full KASP db backup, this must match number of record types
 	MDB_val prefixes[n_prefs + 1]; // last one reserved for KASPDBKEY_POLICYLAST
 
-	for (size_t i = 0; i < n_prefs; i++) {
-		prefixes[i] = make_key_str(classes[i], zone, NULL);
+	n_prefs = 0;
+	for (size_t i = 0; i < classes_size; i++) {
+		if (classes[i] == KASPDBKEY_NSEC3HASHES ||
+		    classes[i] == KASPDBKEY_RRSIGSTORE) {
+			continue; // Just a cache, possibly huge.
+		}
+		prefixes[n_prefs++] = make_key_str(classes[i], zone, NULL);
 	}
 
 	if (classes == zone_related_classes) {
@@ -614,7 +966,8 @@ static int kasp_db_backup_generic(const knot_dname_t *zone, knot_lmdb_db_t *db,
 		prefixes[n_prefs++] = knot_lmdb_make_key("B", KASPDBKEY_POLICYLAST);
 	}
 
-	int ret = knot_lmdb_copy_prefixes(db, backup_db, prefixes, n_prefs);
+	int ret = changed_only ? knot_lmdb_sync_prefixes(db, backup_db, prefixes, n_prefs) :
+	                         knot_lmdb_copy_prefixes(db, backup_db, prefixes, n_prefs);
 
 	for (int i = 0; i < n_prefs; i++) {
 		free(prefixes[i].mv_data);
@@ -625,11 +978,17 @@ static int kasp_db_backup_generic(const knot_dname_t *zone, knot_lmdb_db_t *db,
 int kasp_db_backup(const knot_dname_t *zone, knot_lmdb_db_t *db, knot_lmdb_db_t *backup_db)
 {
 	return kasp_db_backup_generic(zone, db, backup_db,
-	                              zone_related_classes, zone_related_classes_size);
+	                              zone_related_classes, zone_related_classes_size, false);
+}
+
+int kasp_db_backup_changed(const knot_dname_t *zone, knot_lmdb_db_t *db, knot_lmdb_db_t *backup_db)
+{
+	return kasp_db_backup_generic(zone, db, backup_db,
+	                              zone_related_classes, zone_related_classes_size, true);
 }
 
 int kasp_db_backup_keys(const knot_dname_t *zone, knot_lmdb_db_t *db, knot_lmdb_db_t *backup_db)
 {
 	return kasp_db_backup_generic(zone, db, backup_db,
-	                              key_related_classes, key_related_classes_size);
+	                              key_related_classes, key_related_classes_size, false);
 }
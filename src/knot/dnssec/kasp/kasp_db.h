@@ -24,6 +24,7 @@
 #include "libknot/dname.h"
 #include "knot/dnssec/kasp/policy.h"
 #include "knot/journal/knot_lmdb.h"
+#include "knot/zone/contents.h"
 
 typedef struct kasp_db kasp_db_t;
 
@@ -276,6 +277,70 @@ int kasp_db_get_saved_ttls(knot_lmdb_db_t *db, const knot_dname_t *zone,
 int kasp_db_set_saved_ttls(knot_lmdb_db_t *db, const knot_dname_t *zone,
                            uint32_t max_ttl, uint32_t key_ttl);
 
+/*!
+ * \brief Fill in missing NSEC3 owner hashes of zone nodes from the cache.
+ *
+ * \param db        KASP db.
+ * \param contents  Zone contents with NSEC3 parameters loaded.
+ * \param missing   Output: number of nodes without cached hash.
+ *
+ * \return KNOT_E*
+ */
+int kasp_db_load_nsec3_hashes(knot_lmdb_db_t *db, zone_contents_t *contents,
+                              size_t *missing);
+
+/*!
+ * \brief Replace cached NSEC3 owner hashes of the zone with the current ones.
+ *
+ * \param db        KASP db.
+ * \param contents  Adjusted zone contents.
+ *
+ * \return KNOT_E*
+ */
+int kasp_db_store_nsec3_hashes(knot_lmdb_db_t *db, const zone_contents_t *contents);
+
+/*!
+ * \brief Store RRSIGs of zone nodes for later reuse.
+ *
+ * \param db           KASP db.
+ * \param zone         Zone name.
+ * \param keys         DNSKEY rdata of the signing keys, each prefixed with 2-byte length.
+ * \param nodes        Zone nodes to store RRSIGs of.
+ * \param nsec3_nodes  Zone NSEC3 nodes to store RRSIGs of.
+ * \param replace      Drop all the zone's stored RRSIGs first, otherwise just
+ *                     replace those of the given nodes.
+ *
+ * \return KNOT_E*
+ */
+int kasp_db_store_rrsigs(knot_lmdb_db_t *db, const knot_dname_t *zone,
+                         const dnssec_binary_t *keys, zone_tree_t *nodes,
+                         zone_tree_t *nsec3_nodes, bool replace);
+
+/*!
+ * \brief Load DNSKEYs the stored RRSIGs of the zone may have been made with.
+ *
+ * \param db     KASP db.
+ * \param zone   Zone name.
+ * \param keys   Output: DNSKEY rdata, each prefixed with 2-byte length.
+ *
+ * \return KNOT_E*, KNOT_ENOENT if no RRSIGs are stored.
+ */
+int kasp_db_load_rrsig_keys(knot_lmdb_db_t *db, const knot_dname_t *zone,
+                            dnssec_binary_t *keys);
+
+/*!
+ * \brief Load stored RRSIGs covering given RRSet.
+ *
+ * \param db       KASP db.
+ * \param zone     Zone name.
+ * \param covered  Covered RRSet, must be the same as when its RRSIGs were stored.
+ * \param rrsigs   Output: stored RRSIGs.
+ *
+ * \return KNOT_E*, KNOT_ENOENT if no RRSIGs are stored for the RRSet.
+ */
+int kasp_db_load_rrsigs(knot_lmdb_db_t *db, const knot_dname_t *zone,
+                        const knot_rrset_t *covered, knot_rdataset_t *rrsigs);
+
 /*!
  * \brief Initialize KASP database according to conf, if not already.
  *
@@ -295,6 +360,17 @@ void kasp_db_ensure_init(knot_lmdb_db_t *db, conf_t *conf);
  */
 int kasp_db_backup(const knot_dname_t *zone, knot_lmdb_db_t *db, knot_lmdb_db_t *backup_db);
 
+/*!
+ * \brief Update a previous KASP DB backup of one zone, copying only changed data.
+ *
+ * \param zone         Name of the zone to be backed up.
+ * \param db           DB to backup from.
+ * \param backup_db    DB with the previous backup.
+ *
+ * \return KNOT_E*
+ */
+int kasp_db_backup_changed(const knot_dname_t *zone, knot_lmdb_db_t *db, knot_lmdb_db_t *backup_db);
+
 /*!
  * \brief Backup basic KASP DB key metadata for one zone to a backup location.
  *
@@ -0,0 +1,180 @@
+/*  Copyright (C) 2024 CZ.NIC, z.s.p.o. <knot-dns@labs.nic.cz>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "knot/dnssec/key-cache.h"
+#include "contrib/qp-trie/trie.h"
+#include "libdnssec/error.h"
+#include "libknot/dname.h"
+#include "libknot/errcode.h"
+
+typedef struct {
+	char *id;
+	dnssec_key_t *key;
+} cached_key_t;
+
+typedef struct {
+	size_t count;
+	cached_key_t keys[];
+} cached_zone_t;
+
+static pthread_mutex_t cache_lock = PTHREAD_MUTEX_INITIALIZER;
+static trie_t *cache = NULL;
+
+static bool key_match(const cached_key_t *cached, const knot_kasp_key_t *kasp_key)
+{
+	if (cached->key == NULL || strcmp(cached->id, kasp_key->id) != 0) {
+		return false;
+	}
+
+	dnssec_binary_t cached_rdata = { 0 }, kasp_rdata = { 0 };
+	if (dnssec_key_get_rdata(cached->key, &cached_rdata) != DNSSEC_EOK ||
+	    dnssec_key_get_rdata(kasp_key->key, &kasp_rdata) != DNSSEC_EOK) {
+		return false;
+	}
+
+	return dnssec_binary_cmp(&cached_rdata, &kasp_rdata) == 0;
+}
+
+static void cached_zone_free(cached_zone_t *cz)
+{
+	if (cz == NULL) {
+		return;
+	}
+
+	for (size_t i = 0; i < cz->count; i++) {
+		free(cz->keys[i].id);
+		dnssec_key_free(cz->keys[i].key);
+	}
+	free(cz);
+}
+
+static int cached_zone_free_cb(trie_val_t *val, void *ctx)
+{
+	cached_zone_free(*val);
+	return KNOT_EOK;
+}
+
+dnssec_key_t *key_cache_get(const knot_dname_t *zone, const knot_kasp_key_t *kasp_key)
+{
+	if (zone == NULL || kasp_key == NULL || kasp_key->id == NULL) {
+		return NULL;
+	}
+
+	dnssec_key_t *res = NULL;
+
+	pthread_mutex_lock(&cache_lock);
+	trie_val_t *val = (cache == NULL) ? NULL :
+	                  trie_get_try(cache, zone, knot_dname_size(zone));
+	if (val != NULL) {
+		cached_zone_t *cz = *val;
+		for (size_t i = 0; i < cz->count; i++) {
+			if (key_match(&cz->keys[i], kasp_key)) {
+				res = dnssec_key_dup(cz->keys[i].key);
+				break;
+			}
+		}
+	}
+	pthread_mutex_unlock(&cache_lock);
+
+	return res;
+}
+
+void key_cache_update(const knot_kasp_zone_t *zone)
+{
+	if (zone == NULL || zone->dname == NULL) {
+		return;
+	}
+
+	cached_zone_t *cz = calloc(1, sizeof(*cz) + zone->num_keys * sizeof(cz->keys[0]));
+	if (cz == NULL) {
+		key_cache_drop(zone->dname);
+		return;
+	}
+
+	pthread_mutex_lock(&cache_lock);
+
+	cached_zone_t *old = NULL;
+	if (cache != NULL) {
+		trie_del(cache, zone->dname, knot_dname_size(zone->dname), (trie_val_t *)&old);
+	}
+
+	for (size_t i = 0; i < zone->num_keys; i++) {
+		const knot_kasp_key_t *kasp_key = &zone->keys[i];
+		if (kasp_key->id == NULL || !dnssec_key_can_sign(kasp_key->key)) {
+			continue;
+		}
+
+		cached_key_t *ck = &cz->keys[cz->count];
+
+		// Reuse the already cached key to avoid a needless copy.
+		for (size_t j = 0; old != NULL && j < old->count; j++) {
+			if (key_match(&old->keys[j], kasp_key)) {
+				*ck = old->keys[j];
+				memset(&old->keys[j], 0, sizeof(old->keys[j]));
+				break;
+			}
+		}
+		if (ck->key == NULL) {
+			ck->id = strdup(kasp_key->id);
+			ck->key = dnssec_key_dup(kasp_key->key);
+			if (ck->id == NULL || ck->key == NULL) {
+				free(ck->id);
+				dnssec_key_free(ck->key);
+				memset(ck, 0, sizeof(*ck));
+				continue;
+			}
+		}
+		cz->count++;
+	}
+
+	cached_zone_free(old);
+
+	if (cache == NULL) {
+		cache = trie_create(NULL);
+	}
+	trie_val_t *val = NULL;
+	if (cz->count > 0 && cache != NULL &&
+	    (val = trie_get_ins(cache, zone->dname, knot_dname_size(zone->dname))) != NULL) {
+		*val = cz;
+		cz = NULL;
+	}
+
+	pthread_mutex_unlock(&cache_lock);
+
+	cached_zone_free(cz);
+}
+
+void key_cache_drop(const knot_dname_t *zone)
+{
+	pthread_mutex_lock(&cache_lock);
+	if (cache != NULL) {
+		if (zone == NULL) {
+			trie_apply(cache, cached_zone_free_cb, NULL);
+			trie_free(cache);
+			cache = NULL;
+		} else {
+			cached_zone_t *old = NULL;
+			trie_del(cache, zone, knot_dname_size(zone), (trie_val_t *)&old);
+			cached_zone_free(old);
+		}
+	}
+	pthread_mutex_unlock(&cache_lock);
+}
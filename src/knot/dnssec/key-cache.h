@@ -0,0 +1,54 @@
+/*  Copyright (C) 2024 CZ.NIC, z.s.p.o. <knot-dns@labs.nic.cz>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+
+#pragma once
+
+#include "knot/dnssec/kasp/kasp_zone.h"
+
+/*!
+ * \brief Process-wide cache of the private keys loaded from a keystore.
+ *
+ * Each zone keeps the private keys which were in use during the last
+ * loading of its keyset. An entry is served only if both the key ID and
+ * the public key match the KASP DB record, so keys changed or removed
+ * in the KASP DB are never used.
+ */
+
+/*!
+ * \brief Get a copy of a cached private key.
+ *
+ * \param zone      Zone name.
+ * \param kasp_key  KASP key to look the private key for.
+ *
+ * \return A new key including the private key, or NULL if not cached.
+ */
+dnssec_key_t *key_cache_get(const knot_dname_t *zone, const knot_kasp_key_t *kasp_key);
+
+/*!
+ * \brief Replace the cached keys of the zone with the loaded private keys.
+ *
+ * Keys without the private key loaded are not stored. If no such key is
+ * present, the zone is removed from the cache.
+ *
+ * \param zone  KASP zone with loaded keys.
+ */
+void key_cache_update(const knot_kasp_zone_t *zone);
+
+/*!
+ * \brief Drop the cached keys of the zone, or the whole cache if NULL.
+ */
+void key_cache_drop(const knot_dname_t *zone);
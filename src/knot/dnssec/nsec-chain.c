@@ -15,8 +15,14 @@
  */
 
 #include <assert.h>
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
 
 #include "contrib/base32hex.h"
+#include "contrib/macros.h"
+#include "contrib/mempattern.h"
+#include "contrib/ucw/mempool.h"
 #include "knot/dnssec/nsec-chain.h"
 #include "knot/dnssec/rrset-sign.h"
 #include "knot/dnssec/zone-nsec.h"
@@ -718,18 +724,238 @@ bool knot_nsec_empty_nsec_and_rrsigs_in_node(const zone_node_t *n)
 
 /* - API - Chain creation --------------------------------------------------- */
 
+// Maximal NSEC type bitmap: 256 windows, each with number, length and 32 bytes.
+#define NSEC_BITMAP_MAXLEN (256 * 34)
+
+typedef struct {
+	zone_node_t *node;
+	knot_rdata_t *nsec; // New NSEC rdata, NULL if the current one is valid.
+} nsec_link_t;
+
+typedef struct {
+	pthread_t thread;
+	int thread_init_errcode;
+	nsec_link_t *links;
+	size_t from;
+	size_t to;
+	size_t count;
+	uint32_t ttl;
+	knot_mm_t mm;
+	int errcode;
+} nsec_build_args_t;
+
+/*!
+ * \brief Compare the current NSEC with the new rdata, the next name case-insensitively.
+ */
+static bool nsec_up_to_date(const zone_node_t *node, uint32_t ttl,
+                            const uint8_t *rdata, uint16_t len)
+{
+	knot_rrset_t old = node_rrset(node, KNOT_RRTYPE_NSEC);
+	if (old.rrs.count != 1 || old.ttl != ttl || old.rrs.rdata->len != len) {
+		return false;
+	}
+
+	knot_dname_storage_t next;
+	size_t next_size = knot_dname_store(next, knot_nsec_next(old.rrs.rdata));
+	if (next_size == 0 || next_size > len) {
+		return false;
+	}
+	knot_dname_to_lower(next);
+
+	return memcmp(next, rdata, next_size) == 0 &&
+	       memcmp(old.rrs.rdata->data + next_size, rdata + next_size,
+	              len - next_size) == 0;
+}
+
+/*!
+ * \brief Compute NSEC rdata for a range of the ordered links.
+ *
+ * The next name is taken from the following link, the last link points
+ * to the first one. Only the rdata differing from the current NSEC records
+ * are stored (into the thread's memory pool).
+ */
+static void *nsec_build_thread(void *_arg)
+{
+	nsec_build_args_t *arg = _arg;
+
+	dnssec_nsec_bitmap_t *rr_types = dnssec_nsec_bitmap_new();
+	if (rr_types == NULL) {
+		arg->errcode = KNOT_ENOMEM;
+		return NULL;
+	}
+
+	uint8_t rdata[KNOT_DNAME_MAXLEN + NSEC_BITMAP_MAXLEN];
+	for (size_t i = arg->from; i < arg->to; i++) {
+		nsec_link_t *link = &arg->links[i];
+		const knot_dname_t *next = arg->links[(i + 1) % arg->count].node->owner;
+
+		dnssec_nsec_bitmap_clear(rr_types);
+		bitmap_add_node_rrsets(rr_types, link->node, false);
+		dnssec_nsec_bitmap_add(rr_types, KNOT_RRTYPE_NSEC);
+		dnssec_nsec_bitmap_add(rr_types, KNOT_RRTYPE_RRSIG);
+
+		size_t next_size = knot_dname_size(next);
+		uint16_t len = next_size + dnssec_nsec_bitmap_size(rr_types);
+		memcpy(rdata, next, next_size);
+		dnssec_nsec_bitmap_write(rr_types, rdata + next_size);
+
+		if (nsec_up_to_date(link->node, arg->ttl, rdata, len)) {
+			continue;
+		}
+
+		link->nsec = mm_alloc(&arg->mm, knot_rdata_size(len));
+		if (link->nsec == NULL) {
+			arg->errcode = KNOT_ENOMEM;
+			break;
+		}
+		knot_rdata_init(link->nsec, len, rdata);
+	}
+
+	dnssec_nsec_bitmap_free(rr_types);
+
+	return NULL;
+}
+
+/*!
+ * \brief Collect the nodes to be chained, removing NSEC from the others.
+ */
+static int nsec_collect_links(zone_update_t *update, nsec_link_t *links, size_t *count)
+{
+	zone_tree_delsafe_it_t it = { 0 };
+	int ret = zone_tree_delsafe_it_begin(update->new_cont->nodes, &it, false);
+	if (ret != KNOT_EOK) {
+		return ret;
+	}
+	if (zone_tree_delsafe_it_finished(&it)) {
+		zone_tree_delsafe_it_free(&it);
+		return KNOT_EINVAL;
+	}
+
+	// The first node is the zone apex, always chained.
+	links[0].node = zone_tree_delsafe_it_val(&it);
+	*count = 1;
+	zone_tree_delsafe_it_next(&it);
+
+	while (!zone_tree_delsafe_it_finished(&it) && ret == KNOT_EOK) {
+		zone_node_t *node = zone_tree_delsafe_it_val(&it);
+		if (node_rrtype_exists(node, KNOT_RRTYPE_NSEC) &&
+		    (node->flags & NODE_FLAGS_NONAUTH || knot_nsec_empty_nsec_and_rrsigs_in_node(node))) {
+			ret = knot_nsec_changeset_remove(node, update);
+		} else if (node->rrset_count > 0 && !(node->flags & NODE_FLAGS_NONAUTH)) {
+			links[(*count)++].node = node;
+		}
+		zone_tree_delsafe_it_next(&it);
+	}
+	zone_tree_delsafe_it_free(&it);
+
+	return ret;
+}
+
+/*!
+ * \brief Replace the outdated NSEC records by the computed ones, in order.
+ */
+static int nsec_apply_links(zone_update_t *update, nsec_link_t *links, size_t count,
+                            uint32_t ttl)
+{
+	for (size_t i = 0; i < count; i++) {
+		if (links[i].nsec == NULL) {
+			continue;
+		}
+
+		int ret = KNOT_EOK;
+		if (node_rrtype_exists(links[i].node, KNOT_RRTYPE_NSEC)) {
+			ret = knot_nsec_changeset_remove(links[i].node, update);
+		}
+		if (ret == KNOT_EOK) {
+			knot_rrset_t nsec;
+			knot_rrset_init(&nsec, links[i].node->owner, KNOT_RRTYPE_NSEC,
+			                KNOT_CLASS_IN, ttl);
+			nsec.rrs.count = 1;
+			nsec.rrs.size = knot_rdata_size(links[i].nsec->len);
+			nsec.rrs.rdata = links[i].nsec;
+			ret = zone_update_add(update, &nsec);
+		}
+		if (ret != KNOT_EOK) {
+			return ret;
+		}
+	}
+
+	return KNOT_EOK;
+}
+
 /*!
  * \brief Create new NSEC chain, add differences from current into a changeset.
+ *
+ * The chained nodes are collected in one ordered pass, then the NSEC rdata
+ * are computed for contiguous ranges of them in parallel (the range boundary
+ * is just the link to the first node of the following range) and finally
+ * the changed NSEC records are put into the update in order.
  */
-int knot_nsec_create_chain(zone_update_t *update, uint32_t ttl)
+int knot_nsec_create_chain(zone_update_t *update, uint32_t ttl, size_t num_threads)
 {
 	assert(update);
 	assert(update->new_cont->nodes);
 
-	nsec_chain_iterate_data_t data = { ttl, update, KNOT_RRTYPE_NSEC };
+	nsec_link_t *links = calloc(zone_tree_count(update->new_cont->nodes) + 1,
+	                            sizeof(*links));
+	if (links == NULL) {
+		return KNOT_ENOMEM;
+	}
 
-	return knot_nsec_chain_iterate_create(update->new_cont->nodes,
-	                                      connect_nsec_nodes, &data);
+	size_t count = 0;
+	int ret = nsec_collect_links(update, links, &count);
+	if (ret != KNOT_EOK) {
+		free(links);
+		return ret;
+	}
+
+	// Thread startup isn't worth it for small zones.
+	size_t max_threads = MIN(num_threads, count / 1024);
+	num_threads = MAX(max_threads, 1);
+
+	nsec_build_args_t args[num_threads];
+	memset(args, 0, sizeof(args));
+	for (size_t i = 0; i < num_threads; i++) {
+		args[i].links = links;
+		args[i].from = count * i / num_threads;
+		args[i].to = count * (i + 1) / num_threads;
+		args[i].count = count;
+		args[i].ttl = ttl;
+		mm_ctx_mempool(&args[i].mm, MM_DEFAULT_BLKSIZE);
+	}
+
+	if (num_threads == 1) {
+		nsec_build_thread(&args[0]);
+	} else {
+		for (size_t i = 0; i < num_threads; i++) {
+			args[i].thread_init_errcode =
+				pthread_create(&args[i].thread, NULL, nsec_build_thread, &args[i]);
+		}
+		for (size_t i = 0; i < num_threads; i++) {
+			if (args[i].thread_init_errcode == 0) {
+				args[i].thread_init_errcode = pthread_join(args[i].thread, NULL);
+			}
+		}
+	}
+
+	for (size_t i = 0; i < num_threads && ret == KNOT_EOK; i++) {
+		if (args[i].thread_init_errcode != 0) {
+			ret = knot_map_errno_code(args[i].thread_init_errcode);
+		} else {
+			ret = args[i].errcode;
+		}
+	}
+
+	if (ret == KNOT_EOK) {
+		ret = nsec_apply_links(update, links, count, ttl);
+	}
+
+	for (size_t i = 0; i < num_threads; i++) {
+		mp_delete(args[i].mm.ctx);
+	}
+	free(links);
+
+	return ret;
 }
 
 int knot_nsec_fix_chain(zone_update_t *update, uint32_t ttl)
@@ -143,12 +143,13 @@ bool knot_nsec_empty_nsec_and_rrsigs_in_node(const zone_node_t *n);
 /*!
  * \brief Create new NSEC chain.
  *
- * \param update     Zone update to create NSEC chain for.
- * \param ttl        TTL for created NSEC records.
+ * \param update       Zone update to create NSEC chain for.
+ * \param ttl          TTL for created NSEC records.
+ * \param num_threads  Number of threads computing the NSEC records.
  *
  * \return Error code, KNOT_EOK if successful.
  */
-int knot_nsec_create_chain(zone_update_t *update, uint32_t ttl);
+int knot_nsec_create_chain(zone_update_t *update, uint32_t ttl, size_t num_threads);
 
 /*!
  * \brief Fix existing NSEC chain to cover the changes in zone contents.
@@ -15,6 +15,9 @@
  */
 
 #include <assert.h>
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
 
 #include "libknot/dname.h"
 #include "knot/dnssec/nsec-chain.h"
@@ -398,15 +401,106 @@ static int reconnect_nsec3_nodes2(zone_node_t *a, zone_node_t *b,
 	return ret;
 }
 
+typedef struct {
+	pthread_t thread;
+	int thread_init_errcode;
+	zone_node_t **nodes;
+	size_t count;
+	size_t stride;
+	zone_node_t *apex;
+	const dnssec_nsec3_params_t *params;
+	uint32_t ttl;
+	int errcode;
+} nsec3_hash_args_t;
+
+/*!
+ * \brief Replace every stride-th zone node in the array by its new NSEC3 node.
+ */
+static void *nsec3_hash_thread(void *_arg)
+{
+	nsec3_hash_args_t *arg = _arg;
+
+	for (size_t i = 0; i < arg->count; i += arg->stride) {
+		arg->nodes[i] = create_nsec3_node_for_node(arg->nodes[i], arg->apex,
+		                                           arg->params, arg->ttl);
+		if (arg->nodes[i] == NULL) {
+			arg->errcode = KNOT_ENOMEM;
+			// Don't leave unprocessed zone nodes in place of the NSEC3 ones.
+			for (; i < arg->count; i += arg->stride) {
+				arg->nodes[i] = NULL;
+			}
+			break;
+		}
+	}
+
+	return NULL;
+}
+
+/*!
+ * \brief Create NSEC3 nodes for the array of zone nodes, in place.
+ *
+ * \note Nodes left unprocessed upon failure are set to NULL.
+ */
+static int nsec3_hash_nodes(zone_node_t **nodes, size_t count, zone_node_t *apex,
+                            const dnssec_nsec3_params_t *params, uint32_t ttl,
+                            size_t num_threads)
+{
+	// Thread startup isn't worth it for small zones.
+	size_t max_threads = MIN(num_threads, count / 1024);
+	num_threads = MAX(max_threads, 1);
+
+	nsec3_hash_args_t args[num_threads];
+	memset(args, 0, sizeof(args));
+	for (size_t i = 0; i < num_threads; i++) {
+		args[i].nodes = nodes + i;
+		args[i].count = count - MIN(i, count);
+		args[i].stride = num_threads;
+		args[i].apex = apex;
+		args[i].params = params;
+		args[i].ttl = ttl;
+	}
+
+	if (num_threads == 1) {
+		nsec3_hash_thread(&args[0]);
+	} else {
+		for (size_t i = 0; i < num_threads; i++) {
+			args[i].thread_init_errcode =
+				pthread_create(&args[i].thread, NULL, nsec3_hash_thread, &args[i]);
+		}
+		for (size_t i = 0; i < num_threads; i++) {
+			if (args[i].thread_init_errcode == 0) {
+				args[i].thread_init_errcode = pthread_join(args[i].thread, NULL);
+			}
+		}
+	}
+
+	int ret = KNOT_EOK;
+	for (size_t i = 0; i < num_threads; i++) {
+		if (args[i].thread_init_errcode != 0) {
+			ret = knot_map_errno_code(args[i].thread_init_errcode);
+			for (size_t j = i; j < count; j += num_threads) {
+				nodes[j] = NULL;
+			}
+		} else if (args[i].errcode != KNOT_EOK) {
+			ret = args[i].errcode;
+		}
+	}
+
+	return ret;
+}
+
 /*!
  * \brief Create NSEC3 node for each regular node in the zone.
  *
+ * The owner hashing is spread over multiple threads, the NSEC3 tree itself
+ * keeps the nodes ordered.
+ *
  * \param zone         Zone.
  * \param params       NSEC3 params.
  * \param ttl          TTL for the created NSEC records.
- * \param cds_in_apex  Hint to guess apex node type bitmap: false=just DNSKEY, true=DNSKEY,CDS,CDNSKEY.
  * \param nsec3_nodes  Tree whereto new NSEC3 nodes will be added.
  * \param update       Zone update for possible NSEC removals
+ * \param num_threads  Number of hashing threads.
  *
  * \return Error code, KNOT_EOK if successful.
  */
@@ -414,12 +508,19 @@ static int create_nsec3_nodes(const zone_contents_t *zone,
                               const dnssec_nsec3_params_t *params,
                               uint32_t ttl,
                               zone_tree_t *nsec3_nodes,
-                              zone_update_t *update)
+                              zone_update_t *update,
+                              size_t num_threads)
 {
 	assert(zone);
 	assert(nsec3_nodes);
 	assert(update);
 
+	zone_node_t **nodes = malloc(zone_tree_count(zone->nodes) * sizeof(*nodes) + 1);
+	if (nodes == NULL) {
+		return KNOT_ENOMEM;
+	}
+	size_t count = 0;
+
 	zone_tree_delsafe_it_t it = { 0 };
 	int result = zone_tree_delsafe_it_begin(zone->nodes, &it, false); // delsafe - removing nodes that contain only NSEC+RRSIG
 
@@ -434,22 +535,8 @@ static int create_nsec3_nodes(const zone_contents_t *zone,
 		if (result != KNOT_EOK) {
 			break;
 		}
-		if (node->flags & NODE_FLAGS_NONAUTH || nsec3_empty(node, params) || node->flags & NODE_FLAGS_DELETED) {
-			zone_tree_delsafe_it_next(&it);
-			continue;
-		}
-
-		zone_node_t *nsec3_node;
-		nsec3_node = create_nsec3_node_for_node(node, zone->apex,
-							params, ttl);
-		if (!nsec3_node) {
-			result = KNOT_ENOMEM;
-			break;
-		}
-
-		result = zone_tree_insert(nsec3_nodes, &nsec3_node);
-		if (result != KNOT_EOK) {
-			break;
+		if (!(node->flags & NODE_FLAGS_NONAUTH || nsec3_empty(node, params) || node->flags & NODE_FLAGS_DELETED)) {
+			nodes[count++] = node;
 		}
 
 		zone_tree_delsafe_it_next(&it);
@@ -457,6 +544,29 @@ static int create_nsec3_nodes(const zone_contents_t *zone,
 
 	zone_tree_delsafe_it_free(&it);
 
+	if (result != KNOT_EOK) {
+		free(nodes);
+		return result;
+	}
+
+	result = nsec3_hash_nodes(nodes, count, zone->apex, params, ttl, num_threads);
+
+	for (size_t i = 0; i < count; i++) {
+		if (nodes[i] == NULL) {
+			continue;
+		}
+		if (result == KNOT_EOK) {
+			result = zone_tree_insert(nsec3_nodes, &nodes[i]);
+			if (result == KNOT_EOK) {
+				continue;
+			}
+		}
+		// NSEC3 node not inserted due to failure.
+		knot_rdataset_clear(node_rdataset(nodes[i], KNOT_RRTYPE_NSEC3), NULL);
+		node_free(nodes[i], NULL);
+	}
+	free(nodes);
+
 	return result;
 }
 
@@ -625,7 +735,8 @@ int delete_nsec3_chain(zone_update_t *up)
 int knot_nsec3_create_chain(const zone_contents_t *zone,
                             const dnssec_nsec3_params_t *params,
                             uint32_t ttl,
-                            zone_update_t *update)
+                            zone_update_t *update,
+                            size_t num_threads)
 {
 	assert(zone);
 	assert(params);
@@ -635,7 +746,7 @@ int knot_nsec3_create_chain(const zone_contents_t *zone,
 		return KNOT_ENOMEM;
 	}
 
-	int result = create_nsec3_nodes(zone, params, ttl, nsec3_nodes, update);
+	int result = create_nsec3_nodes(zone, params, ttl, nsec3_nodes, update, num_threads);
 	if (result != KNOT_EOK) {
 		free_nsec3_tree(nsec3_nodes);
 		return result;
@@ -657,7 +768,8 @@ int knot_nsec3_create_chain(const zone_contents_t *zone,
 
 int knot_nsec3_fix_chain(zone_update_t *update,
                          const dnssec_nsec3_params_t *params,
-                         uint32_t ttl)
+                         uint32_t ttl,
+                         size_t num_threads)
 {
 	assert(update);
 	assert(params);
@@ -668,7 +780,7 @@ int knot_nsec3_fix_chain(zone_update_t *update,
 		if (ret != KNOT_EOK) {
 			return ret;
 		}
-		return knot_nsec3_create_chain(update->new_cont, params, ttl, update);
+		return knot_nsec3_create_chain(update->new_cont, params, ttl, update, num_threads);
 	}
 
 	int ret = fix_nsec3_nodes(update, params, ttl);
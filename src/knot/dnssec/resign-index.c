@@ -0,0 +1,231 @@
+/*  Copyright (C) 2024 CZ.NIC, z.s.p.o. <knot-dns@labs.nic.cz>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "knot/dnssec/resign-index.h"
+#include "libknot/errcode.h"
+#include "libknot/wire.h"
+
+// Owner key: <NSEC3 tree flag> <owner in wire format>
+#define OWNER_KEY_MAX (1 + KNOT_DNAME_MAXLEN)
+// Queue key: <expiration, big endian> <owner key>
+#define QUEUE_KEY_MAX (sizeof(uint64_t) + OWNER_KEY_MAX)
+
+static size_t owner_key(uint8_t *key, const knot_dname_t *owner, bool nsec3)
+{
+	size_t size = knot_dname_size(owner);
+	key[0] = nsec3;
+	memcpy(key + 1, owner, size);
+	return 1 + size;
+}
+
+static size_t queue_key(uint8_t *key, knot_time_t expire,
+                        const uint8_t *okey, size_t okey_len)
+{
+	knot_wire_write_u64(key, expire);
+	memcpy(key + sizeof(uint64_t), okey, okey_len);
+	return sizeof(uint64_t) + okey_len;
+}
+
+resign_index_t *resign_index_new(uint64_t fingerprint, bool complete)
+{
+	resign_index_t *idx = calloc(1, sizeof(*idx));
+	if (idx == NULL) {
+		return NULL;
+	}
+
+	idx->owners = trie_create(NULL);
+	idx->queue = trie_create(NULL);
+	if (idx->owners == NULL || idx->queue == NULL) {
+		resign_index_free(idx);
+		return NULL;
+	}
+	idx->fingerprint = fingerprint;
+	idx->complete = complete;
+
+	return idx;
+}
+
+void resign_index_free(resign_index_t *idx)
+{
+	if (idx == NULL) {
+		return;
+	}
+
+	trie_free(idx->owners);
+	trie_free(idx->queue);
+	free(idx);
+}
+
+static int set_key(resign_index_t *idx, const uint8_t *okey, size_t okey_len,
+                   knot_time_t expire)
+{
+	uint8_t qkey[QUEUE_KEY_MAX];
+
+	trie_val_t *val = trie_get_try(idx->owners, okey, okey_len);
+	if (val != NULL) {
+		knot_time_t old = (uintptr_t)*val;
+		if (old == expire) {
+			return KNOT_EOK;
+		}
+		if (old != 0) {
+			size_t len = queue_key(qkey, old, okey, okey_len);
+			trie_del(idx->queue, qkey, len, NULL);
+		}
+	}
+
+	// Unlike a delta, the complete index doesn't need to remember removals.
+	if (expire == 0 && idx->complete) {
+		if (val != NULL) {
+			trie_del(idx->owners, okey, okey_len, NULL);
+		}
+		return KNOT_EOK;
+	}
+
+	val = trie_get_ins(idx->owners, okey, okey_len);
+	if (val == NULL) {
+		return KNOT_ENOMEM;
+	}
+	// Expiration in UNIX seconds fits into the trie value.
+	*val = (trie_val_t)(uintptr_t)expire;
+
+	if (expire != 0) {
+		size_t len = queue_key(qkey, expire, okey, okey_len);
+		if (trie_get_ins(idx->queue, qkey, len) == NULL) {
+			return KNOT_ENOMEM;
+		}
+	}
+
+	return KNOT_EOK;
+}
+
+int resign_index_set(resign_index_t *idx, const knot_dname_t *owner, bool nsec3,
+                     knot_time_t expire)
+{
+	if (idx == NULL || owner == NULL) {
+		return KNOT_EINVAL;
+	}
+
+	uint8_t okey[OWNER_KEY_MAX];
+	size_t okey_len = owner_key(okey, owner, nsec3);
+
+	return set_key(idx, okey, okey_len, expire);
+}
+
+int resign_index_merge(resign_index_t *idx, resign_index_t *delta)
+{
+	if (idx == NULL || delta == NULL) {
+		return KNOT_EINVAL;
+	}
+
+	trie_it_t *it = trie_it_begin(delta->owners);
+	if (it == NULL) {
+		return KNOT_ENOMEM;
+	}
+
+	int ret = KNOT_EOK;
+	while (!trie_it_finished(it) && ret == KNOT_EOK) {
+		size_t okey_len;
+		const uint8_t *okey = trie_it_key(it, &okey_len);
+		knot_time_t expire = (uintptr_t)*trie_it_val(it);
+		ret = set_key(idx, okey, okey_len, expire);
+		trie_it_next(it);
+	}
+	trie_it_free(it);
+
+	return ret;
+}
+
+knot_time_t resign_index_earliest(resign_index_t *idx, resign_index_t *override)
+{
+	knot_time_t earliest = 0;
+	if (override != NULL) {
+		earliest = resign_index_earliest(override, NULL);
+	}
+	if (idx == NULL) {
+		return earliest;
+	}
+
+	trie_it_t *it = trie_it_begin(idx->queue);
+	while (it != NULL && !trie_it_finished(it)) {
+		size_t len;
+		const uint8_t *qkey = trie_it_key(it, &len);
+		const uint8_t *okey = qkey + sizeof(uint64_t);
+		size_t okey_len = len - sizeof(uint64_t);
+		if (override == NULL ||
+		    trie_get_try(override->owners, okey, okey_len) == NULL) {
+			earliest = knot_time_min(earliest, knot_wire_read_u64(qkey));
+			break;
+		}
+		trie_it_next(it);
+	}
+	trie_it_free(it);
+
+	return earliest;
+}
+
+int resign_index_due(resign_index_t *idx, knot_time_t until,
+                     resign_index_cb_t cb, void *ctx)
+{
+	if (idx == NULL || cb == NULL) {
+		return KNOT_EINVAL;
+	}
+
+	trie_it_t *it = trie_it_begin(idx->queue);
+	if (it == NULL) {
+		return KNOT_ENOMEM;
+	}
+
+	int ret = KNOT_EOK;
+	while (!trie_it_finished(it) && ret == KNOT_EOK) {
+		size_t len;
+		const uint8_t *qkey = trie_it_key(it, &len);
+		if (knot_wire_read_u64(qkey) > until) {
+			break;
+		}
+		const uint8_t *okey = qkey + sizeof(uint64_t);
+		ret = cb(okey + 1, okey[0], ctx);
+		trie_it_next(it);
+	}
+	trie_it_free(it);
+
+	return ret;
+}
+
+void resign_index_commit(resign_index_t **index, resign_index_t **delta)
+{
+	resign_index_t *d = *delta;
+	*delta = NULL;
+
+	if (d != NULL && d->fingerprint != 0) {
+		if (d->complete) {
+			resign_index_free(*index);
+			*index = d;
+			return;
+		}
+		if (*index != NULL && (*index)->fingerprint == d->fingerprint &&
+		    resign_index_merge(*index, d) == KNOT_EOK) {
+			resign_index_free(d);
+			return;
+		}
+	}
+
+	resign_index_free(*index);
+	*index = NULL;
+	resign_index_free(d);
+}
@@ -0,0 +1,107 @@
+/*  Copyright (C) 2024 CZ.NIC, z.s.p.o. <knot-dns@labs.nic.cz>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "contrib/qp-trie/trie.h"
+#include "contrib/time.h"
+#include "libknot/dname.h"
+
+/*!
+ * \brief Index of earliest RRSIG expirations of zone nodes.
+ *
+ * The zone index is attached to the zone and lets the re-sign event process
+ * only the nodes with signatures due for refresh. Signing routines record
+ * the nodes they have fully processed into a delta index of the zone update,
+ * which is merged into the zone index upon commit.
+ */
+typedef struct resign_index {
+	trie_t *owners;       /*!< Owner -> earliest expiration (0 for removed owners in delta). */
+	trie_t *queue;        /*!< Expiration + owner, ordered by expiration. */
+	uint64_t fingerprint; /*!< Keys and parameters the signatures were made with (0 = invalid). */
+	bool complete;        /*!< Covers all the signed nodes in the zone. */
+} resign_index_t;
+
+typedef int (*resign_index_cb_t)(const knot_dname_t *owner, bool nsec3, void *ctx);
+
+/*!
+ * \brief Create empty index.
+ *
+ * \param fingerprint  Signing keys and parameters fingerprint.
+ * \param complete     The index will contain all signed nodes of the zone.
+ *
+ * \return Allocated index or NULL.
+ */
+resign_index_t *resign_index_new(uint64_t fingerprint, bool complete);
+
+/*!
+ * \brief Free the index.
+ */
+void resign_index_free(resign_index_t *idx);
+
+/*!
+ * \brief Set the earliest RRSIG expiration of a node.
+ *
+ * \param idx     Index to be updated.
+ * \param owner   Node owner.
+ * \param nsec3   The node is in NSEC3 tree.
+ * \param expire  Earliest RRSIG expiration, 0 if the node has no RRSIGs.
+ *
+ * \return KNOT_E*
+ */
+int resign_index_set(resign_index_t *idx, const knot_dname_t *owner, bool nsec3,
+                     knot_time_t expire);
+
+/*!
+ * \brief Apply all the records from a delta index.
+ *
+ * \return KNOT_E*, the target index is inconsistent in case of failure.
+ */
+int resign_index_merge(resign_index_t *idx, resign_index_t *delta);
+
+/*!
+ * \brief Get the earliest expiration in the index.
+ *
+ * \param idx       Index.
+ * \param override  Optional delta index overriding the records in 'idx'.
+ *
+ * \return Earliest expiration as if 'override' was merged, 0 if none.
+ */
+knot_time_t resign_index_earliest(resign_index_t *idx, resign_index_t *override);
+
+/*!
+ * \brief Call the callback for all owners expiring until given time.
+ *
+ * \note The index must not be modified from the callback.
+ *
+ * \return KNOT_E*, first error returned from the callback.
+ */
+int resign_index_due(resign_index_t *idx, knot_time_t until,
+                     resign_index_cb_t cb, void *ctx);
+
+/*!
+ * \brief Update zone index upon update commit with the update delta index.
+ *
+ * The zone index is dropped if the delta is missing or incompatible, i.e.
+ * the next re-sign walks the whole zone.
+ *
+ * \param index  Zone index to be updated.
+ * \param delta  Update delta index, consumed.
+ */
+void resign_index_commit(resign_index_t **index, resign_index_t **delta);
@@ -23,6 +23,8 @@
 #include "knot/zone/serial.h" // DNS uint32 arithmetics
 #include "libknot/libknot.h"
 
+#define RRSET_WIRE_STACK_SIZE 1024
+
 #define RRSIG_RDATA_SIGNER_OFFSET 18
 
 #define RRSIG_INCEPT_IN_PAST (90 * 60)
@@ -119,30 +121,15 @@ static int sign_ctx_add_self(dnssec_sign_ctx_t *ctx, const uint8_t *rdata)
 	assert(ctx);
 	assert(rdata);
 
-	int result;
-
-	// static header
-
-	dnssec_binary_t header = { 0 };
-	header.data = (uint8_t *)rdata;
-	header.size = RRSIG_RDATA_SIGNER_OFFSET;
-
-	result = dnssec_sign_add(ctx, &header);
-	if (result != DNSSEC_EOK) {
-		return result;
-	}
-
-	// signer name
+	// static header and signer name are contiguous in the RDATA
 
 	const uint8_t *rdata_signer = rdata + RRSIG_RDATA_SIGNER_OFFSET;
-	dnssec_binary_t signer = { 0 };
-	signer.data = knot_dname_copy(rdata_signer, NULL);
-	signer.size = knot_dname_size(signer.data);
-
-	result = dnssec_sign_add(ctx, &signer);
-	free(signer.data);
+	dnssec_binary_t self = {
+		.data = (uint8_t *)rdata,
+		.size = RRSIG_RDATA_SIGNER_OFFSET + knot_dname_size(rdata_signer)
+	};
 
-	return result;
+	return dnssec_sign_add(ctx, &self);
 }
 
 /*!
@@ -157,23 +144,30 @@ static int sign_ctx_add_self(dnssec_sign_ctx_t *ctx, const uint8_t *rdata)
  */
 static int sign_ctx_add_records(dnssec_sign_ctx_t *ctx, const knot_rrset_t *covered)
 {
+	// Most RRSets fit into the stack buffer, avoid allocation for them.
+	uint8_t stack_buf[RRSET_WIRE_STACK_SIZE];
+	uint8_t *rrwf = stack_buf;
+
 	size_t rrwl = knot_rrset_size_estimate(covered);
-	uint8_t *rrwf = malloc(rrwl);
-	if (!rrwf) {
-		return KNOT_ENOMEM;
+	if (rrwl > sizeof(stack_buf)) {
+		rrwf = malloc(rrwl);
+		if (!rrwf) {
+			return KNOT_ENOMEM;
+		}
 	}
 
-	int written = knot_rrset_to_wire_extra(covered, rrwf, rrwl, 0, NULL, 0);
-	if (written < 0) {
-		free(rrwf);
-		return written;
+	int result = knot_rrset_to_wire_extra(covered, rrwf, rrwl, 0, NULL, 0);
+	if (result >= 0) {
+		dnssec_binary_t rrset_wire = {
+			.data = rrwf,
+			.size = result
+		};
+		result = dnssec_sign_add(ctx, &rrset_wire);
 	}
 
-	dnssec_binary_t rrset_wire = { 0 };
-	rrset_wire.size = written;
-	rrset_wire.data = rrwf;
-	int result = dnssec_sign_add(ctx, &rrset_wire);
-	free(rrwf);
+	if (rrwf != stack_buf) {
+		free(rrwf);
+	}
 
 	return result;
 }
@@ -0,0 +1,186 @@
+/*  Copyright (C) 2024 CZ.NIC, z.s.p.o. <knot-dns@labs.nic.cz>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include <pthread.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+
+#include "knot/dnssec/sign-pool.h"
+
+typedef struct sign_job {
+	struct sign_job *next;
+	sign_pool_cb_t cb;
+	uint8_t *args;
+	size_t arg_size;
+	size_t count;
+	size_t started;
+	size_t running;
+	size_t finished;
+	knot_time_t deadline;
+	pthread_cond_t done;
+} sign_job_t;
+
+struct sign_pool {
+	pthread_mutex_t mx;
+	pthread_cond_t wake;
+	sign_job_t *jobs;   // Jobs with items not started yet, in submission order.
+	bool stop;
+	size_t threads_count;
+	pthread_t threads[];
+};
+
+/*! Fair share first, then the most urgent, then the oldest. */
+static bool job_precedes(const sign_job_t *a, const sign_job_t *b)
+{
+	if (a->running != b->running) {
+		return a->running < b->running;
+	}
+	return knot_time_lt(a->deadline, b->deadline);
+}
+
+static sign_job_t *pick_job(sign_pool_t *pool, sign_job_t ***pos)
+{
+	sign_job_t *best = NULL;
+	for (sign_job_t **it = &pool->jobs; *it != NULL; it = &(*it)->next) {
+		if (best == NULL || job_precedes(*it, best)) {
+			best = *it;
+			*pos = it;
+		}
+	}
+	return best;
+}
+
+static void *sign_pool_thread(void *arg)
+{
+	sign_pool_t *pool = arg;
+
+	pthread_mutex_lock(&pool->mx);
+	while (true) {
+		while (pool->jobs == NULL && !pool->stop) {
+			pthread_cond_wait(&pool->wake, &pool->mx);
+		}
+		if (pool->jobs == NULL) {
+			break;
+		}
+
+		sign_job_t **pos = NULL;
+		sign_job_t *job = pick_job(pool, &pos);
+		size_t item = job->started++;
+		job->running++;
+		if (job->started == job->count) {
+			*pos = job->next; // All items taken.
+		}
+		pthread_mutex_unlock(&pool->mx);
+
+		job->cb(job->args + item * job->arg_size);
+
+		pthread_mutex_lock(&pool->mx);
+		job->running--;
+		if (++job->finished == job->count) {
+			pthread_cond_signal(&job->done); // The job is gone afterwards.
+		}
+	}
+	pthread_mutex_unlock(&pool->mx);
+
+	return NULL;
+}
+
+sign_pool_t *sign_pool_init(size_t threads)
+{
+	if (threads == 0) {
+		return NULL;
+	}
+
+	sign_pool_t *pool = calloc(1, sizeof(*pool) + threads * sizeof(pthread_t));
+	if (pool == NULL) {
+		return NULL;
+	}
+
+	pthread_mutex_init(&pool->mx, NULL);
+	pthread_cond_init(&pool->wake, NULL);
+
+	for (; pool->threads_count < threads; pool->threads_count++) {
+		if (pthread_create(&pool->threads[pool->threads_count], NULL,
+		                   sign_pool_thread, pool) != 0) {
+			break;
+		}
+	}
+	if (pool->threads_count == 0) {
+		sign_pool_deinit(&pool);
+	}
+
+	return pool;
+}
+
+void sign_pool_deinit(sign_pool_t **pool)
+{
+	if (pool == NULL || *pool == NULL) {
+		return;
+	}
+
+	sign_pool_t *p = *pool;
+	*pool = NULL;
+
+	pthread_mutex_lock(&p->mx);
+	p->stop = true;
+	pthread_cond_broadcast(&p->wake);
+	pthread_mutex_unlock(&p->mx);
+
+	for (size_t i = 0; i < p->threads_count; i++) {
+		pthread_join(p->threads[i], NULL);
+	}
+
+	pthread_cond_destroy(&p->wake);
+	pthread_mutex_destroy(&p->mx);
+	free(p);
+}
+
+void sign_pool_run(sign_pool_t *pool, knot_time_t deadline, sign_pool_cb_t cb,
+                   void *args, size_t arg_size, size_t count)
+{
+	if (count == 0) {
+		return;
+	}
+
+	sign_job_t job = {
+		.cb = cb,
+		.args = args,
+		.arg_size = arg_size,
+		.count = count,
+		.deadline = deadline,
+	};
+	pthread_cond_init(&job.done, NULL);
+
+	pthread_mutex_lock(&pool->mx);
+	sign_job_t **tail = &pool->jobs;
+	while (*tail != NULL) {
+		tail = &(*tail)->next;
+	}
+	*tail = &job;
+	if (count == 1) {
+		pthread_cond_signal(&pool->wake);
+	} else {
+		pthread_cond_broadcast(&pool->wake);
+	}
+
+	while (job.finished < job.count) {
+		pthread_cond_wait(&job.done, &pool->mx);
+	}
+	pthread_mutex_unlock(&pool->mx);
+
+	pthread_cond_destroy(&job.done);
+}
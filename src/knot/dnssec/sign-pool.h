@@ -0,0 +1,62 @@
+/*  Copyright (C) 2024 CZ.NIC, z.s.p.o. <knot-dns@labs.nic.cz>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <stddef.h>
+
+#include "contrib/time.h"
+
+/*!
+ * \brief Signing threads shared by all zones.
+ *
+ * Each zone signing is split into several work items (usually one per
+ * configured signing thread), which are executed by a fixed number of threads
+ * of the pool. So the total number of signing threads doesn't grow with the
+ * number of zones signed at once. Free threads pick an item of the zone
+ * with the fewest items running, preferring the earliest signature expiration
+ * and then the submission order.
+ */
+typedef struct sign_pool sign_pool_t;
+
+typedef void *(*sign_pool_cb_t)(void *arg);
+
+/*!
+ * \brief Start the signing threads.
+ *
+ * \param threads   Number of threads.
+ *
+ * \return Allocated pool, or NULL if no threads or failed.
+ */
+sign_pool_t *sign_pool_init(size_t threads);
+
+/*!
+ * \brief Stop the signing threads, no work may be in progress.
+ */
+void sign_pool_deinit(sign_pool_t **pool);
+
+/*!
+ * \brief Execute work items in the pool, wait for their completion.
+ *
+ * \param pool       Signing pool.
+ * \param deadline   Earliest signature expiration of the zone (0 if unknown).
+ * \param cb         Callback called for each item.
+ * \param args       Array of callback arguments, one for each item.
+ * \param arg_size   Size of one argument.
+ * \param count      Number of items.
+ */
+void sign_pool_run(sign_pool_t *pool, knot_time_t deadline, sign_pool_cb_t cb,
+                   void *args, size_t arg_size, size_t count);
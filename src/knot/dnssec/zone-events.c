@@ -144,6 +144,23 @@ static int check_offline_records(kdnssec_ctx_t *ctx)
 	return KNOT_EOK;
 }
 
+static void store_rrsigs(zone_update_t *update, const zone_keyset_t *keyset,
+                         const kdnssec_ctx_t *ctx, bool whole)
+{
+	const knot_dname_t *zone_name = update->new_cont->apex->owner;
+
+	if (ctx->stats->rrsig_reused > 0) {
+		log_zone_info(zone_name, "DNSSEC, reused RRSIGs %zu", ctx->stats->rrsig_reused);
+	}
+
+	// Failure isn't fatal, the signatures will just have to be made again.
+	int ret = knot_zone_sign_store(update, keyset, ctx, whole);
+	if (ret != KNOT_EOK) {
+		log_zone_warning(zone_name, "DNSSEC, failed to store RRSIGs (%s)",
+		                 knot_strerror(ret));
+	}
+}
+
 int knot_dnssec_zone_sign(zone_update_t *update,
                           conf_t *conf,
                           zone_sign_flags_t flags,
@@ -248,26 +265,35 @@ int knot_dnssec_zone_sign(zone_update_t *update,
 		return result;
 	}
 
-	result = knot_zone_create_nsec_chain(update, &ctx);
-	if (result != KNOT_EOK) {
-		log_zone_error(zone_name, "DNSSEC, failed to create NSEC%s chain (%s)",
-		               ctx.policy->nsec3_enabled ? "3" : "",
-		               knot_strerror(result));
-		goto done;
+	result = KNOT_ENOENT;
+	if (flags & ZONE_SIGN_DUE_ONLY) {
+		result = knot_zone_sign_due(update, &keyset, &ctx);
 	}
+	bool whole = (result == KNOT_ENOENT);
+	if (whole) {
+		result = knot_zone_create_nsec_chain(update, &ctx);
+		if (result != KNOT_EOK) {
+			log_zone_error(zone_name, "DNSSEC, failed to create NSEC%s chain (%s)",
+			               ctx.policy->nsec3_enabled ? "3" : "",
+			               knot_strerror(result));
+			goto done;
+		}
 
-	result = check_offline_records(&ctx);
-	if (result != KNOT_EOK) {
-		goto done;
-	}
+		result = check_offline_records(&ctx);
+		if (result != KNOT_EOK) {
+			goto done;
+		}
 
-	result = knot_zone_sign(update, &keyset, &ctx);
+		result = knot_zone_sign(update, &keyset, &ctx);
+	}
 	if (result != KNOT_EOK) {
 		log_zone_error(zone_name, "DNSSEC, failed to sign zone content (%s)",
 		               knot_strerror(result));
 		goto done;
 	}
 
+	store_rrsigs(update, &keyset, &ctx, whole);
+
 	// SOA finishing
 
 	if (zone_update_no_change(update)) {
@@ -405,6 +431,8 @@ int knot_dnssec_sign_update(zone_update_t *update, conf_t *conf)
 		goto done;
 	}
 
+	store_rrsigs(update, &keyset, &ctx, false);
+
 	bool soa_changed = (knot_soa_serial(node_rdataset(update->zone->contents->apex, KNOT_RRTYPE_SOA)->rdata) !=
 			    knot_soa_serial(node_rdataset(update->new_cont->apex, KNOT_RRTYPE_SOA)->rdata));
 
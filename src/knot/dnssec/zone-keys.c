@@ -20,6 +20,7 @@
 
 #include "libdnssec/error.h"
 #include "knot/common/log.h"
+#include "knot/dnssec/key-cache.h"
 #include "knot/dnssec/zone-keys.h"
 #include "libknot/libknot.h"
 #include "contrib/openbsd/strlcat.h"
@@ -242,6 +243,7 @@ int kdnssec_delete_key(kdnssec_ctx_t *ctx, knot_kasp_key_t *key_ptr)
 	}
 
 	if (!key_still_used_in_keystore && !key_ptr->is_pub_only) {
+		key_cache_drop(ctx->zone->dname);
 		ret = dnssec_keystore_remove(ctx->keystore, key_ptr->id);
 		if (ret != KNOT_EOK) {
 			return ret;
@@ -471,6 +473,18 @@ static int load_private_keys(kdnssec_ctx_t *ctx, zone_keyset_t *keyset)
 		if (!key->is_active && !key->is_ksk_active_plus && !key->is_zsk_active_plus) {
 			continue;
 		}
+
+		// Avoid repeated keystore access if the private key is cached.
+		knot_kasp_key_t *kasp_key = &ctx->zone->keys[i];
+		assert(kasp_key->key == key->key);
+		dnssec_key_t *cached = key_cache_get(ctx->zone->dname, kasp_key);
+		if (cached != NULL) {
+			dnssec_key_free(kasp_key->key);
+			kasp_key->key = cached;
+			key->key = cached;
+			continue;
+		}
+
 		int ret = dnssec_keystore_get_private(ctx->keystore, key->id, key->key);
 		switch (ret) {
 		case DNSSEC_EOK:
@@ -485,6 +499,8 @@ static int load_private_keys(kdnssec_ctx_t *ctx, zone_keyset_t *keyset)
 		}
 	}
 
+	key_cache_update(ctx->zone);
+
 	return KNOT_EOK;
 }
 
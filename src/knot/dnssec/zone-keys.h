@@ -61,6 +61,8 @@ typedef struct {
 	zone_key_t *keys;                 // keys in keyset
 	dnssec_sign_ctx_t **sign_ctxs;    // signing buffers for keys in keyset
 	const kdnssec_ctx_t *dnssec_ctx;  // dnssec context
+	knot_time_t expire;               // earliest RRSIG expiration noted since reset
+	const bool *stored_keys;          // keys whose RRSIGs may be reused from RRSIG store (optional)
 } zone_sign_ctx_t;
 
 /*!
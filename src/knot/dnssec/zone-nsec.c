@@ -347,9 +347,10 @@ int knot_zone_create_nsec_chain(zone_update_t *update, const kdnssec_ctx_t *ctx)
 
 	if (ctx->policy->nsec3_enabled) {
 		ret = knot_nsec3_create_chain(update->new_cont, &params, nsec_ttl,
-		                              update);
+		                              update, ctx->policy->signing_threads);
 	} else {
-		ret = knot_nsec_create_chain(update, nsec_ttl);
+		ret = knot_nsec_create_chain(update, nsec_ttl,
+		                             ctx->policy->signing_threads);
 		if (ret == KNOT_EOK) {
 			ret = delete_nsec3_chain(update);
 		}
@@ -381,7 +382,8 @@ int knot_zone_fix_nsec_chain(zone_update_t *update,
 	if (nsec_ttl_old != nsec_ttl_new || (update->flags & UPDATE_CHANGED_NSEC)) {
 		ret = KNOT_ENORECORD;
 	} else if (ctx->policy->nsec3_enabled) {
-		ret = knot_nsec3_fix_chain(update, &params, nsec_ttl_new);
+		ret = knot_nsec3_fix_chain(update, &params, nsec_ttl_new,
+		                           ctx->policy->signing_threads);
 	} else {
 		ret = knot_nsec_fix_chain(update, nsec_ttl_new);
 	}
@@ -390,9 +392,11 @@ int knot_zone_fix_nsec_chain(zone_update_t *update,
 		              (ctx->policy->nsec3_enabled ? "3" : ""));
 		if (ctx->policy->nsec3_enabled) {
 			ret = knot_nsec3_create_chain(update->new_cont, &params,
-			                              nsec_ttl_new, update);
+			                              nsec_ttl_new, update,
+			                              ctx->policy->signing_threads);
 		} else {
-			ret = knot_nsec_create_chain(update, nsec_ttl_new);
+			ret = knot_nsec_create_chain(update, nsec_ttl_new,
+			                             ctx->policy->signing_threads);
 		}
 	}
 	if (ret == KNOT_EOK) {
@@ -23,12 +23,18 @@
 #include "libdnssec/keytag.h"
 #include "libdnssec/sign.h"
 #include "knot/common/log.h"
+#include "knot/dnssec/kasp/kasp_db.h"
 #include "knot/dnssec/key-events.h"
 #include "knot/dnssec/key_records.h"
+#include "knot/dnssec/resign-index.h"
 #include "knot/dnssec/rrset-sign.h"
+#include "knot/dnssec/sign-pool.h"
+#include "knot/dnssec/zone-nsec.h"
 #include "knot/dnssec/zone-sign.h"
+#include "knot/server/server.h"
 #include "libknot/libknot.h"
 #include "libknot/dynarray.h"
+#include "contrib/openbsd/siphash.h"
 #include "contrib/wire_ctx.h"
 
 typedef struct {
@@ -198,6 +204,64 @@ bool rrsig_covers_type(const knot_rrset_t *rrsig, uint16_t type)
 	return false;
 }
 
+/*!
+ * \brief Try to take a valid RRSIG made by given key from the RRSIG store.
+ *
+ * \param covered   RR set with covered records.
+ * \param rrsigs    RR set with RRSIGs in the zone.
+ * \param stored    RR set with stored RRSIGs, loaded upon first use.
+ * \param loaded    The stored RRSIGs have been loaded.
+ * \param sign_ctx  Local zone signing context.
+ * \param key_idx   Index of the signing key.
+ * \param refresh   Consider RRSIG expired when gonna expire this soon.
+ * \param to_add    RR set with RRSIGs to be added.
+ *
+ * \return The stored RRSIG has been added to 'to_add'.
+ */
+static bool reuse_stored_rrsig(const knot_rrset_t *covered,
+                               const knot_rrset_t *rrsigs,
+                               knot_rrset_t *stored,
+                               bool *loaded,
+                               zone_sign_ctx_t *sign_ctx,
+                               size_t key_idx,
+                               knot_timediff_t refresh,
+                               knot_rrset_t *to_add)
+{
+	if (sign_ctx->stored_keys == NULL || !sign_ctx->stored_keys[key_idx]) {
+		return false;
+	}
+
+	const kdnssec_ctx_t *dnssec_ctx = sign_ctx->dnssec_ctx;
+	if (!*loaded) {
+		*loaded = true;
+		(void)kasp_db_load_rrsigs(dnssec_ctx->kasp_db, dnssec_ctx->zone->dname,
+		                          covered, &stored->rrs);
+	}
+
+	// The store is written only with RRSIGs verified or made by us.
+	uint16_t at;
+	if (!valid_signature_exists(covered, stored, sign_ctx->keys[key_idx].key,
+	                            sign_ctx->sign_ctxs[key_idx], dnssec_ctx, refresh,
+	                            true, NULL, &at)) {
+		return false;
+	}
+	knot_rdata_t *rrsig = knot_rdataset_at(&stored->rrs, at);
+	if (!knot_rrset_empty(rrsigs) && knot_rdataset_member(&rrsigs->rrs, rrsig)) {
+		return false; // Present in the zone, but didn't pass validation.
+	}
+	if (knot_rdataset_add(&to_add->rrs, rrsig, NULL) != KNOT_EOK) {
+		return false;
+	}
+
+	knot_spin_lock(&dnssec_ctx->stats->lock);
+	dnssec_ctx->stats->rrsig_reused++;
+	note_earliest_expiration(rrsig, dnssec_ctx->now, &dnssec_ctx->stats->expire);
+	knot_spin_unlock(&dnssec_ctx->stats->lock);
+	note_earliest_expiration(rrsig, dnssec_ctx->now, &sign_ctx->expire);
+
+	return true;
+}
+
 /*!
  * \brief Add missing RRSIGs into the changeset for adding.
  *
@@ -225,6 +289,8 @@ static int add_missing_rrsigs(const knot_rrset_t *covered,
 
 	knot_rrset_t to_add = create_empty_rrsigs_for(covered);
 	knot_rrset_t to_remove = create_empty_rrsigs_for(covered);
+	knot_rrset_t stored = create_empty_rrsigs_for(covered);
+	bool stored_loaded = false;
 	int result = (!rrsig_covers_type(rrsigs, covered->type) ? KNOT_EOK :
 	             knot_synth_rrsig(covered->type, &rrsigs->rrs, &to_remove.rrs, NULL));
 
@@ -260,10 +326,21 @@ static int add_missing_rrsigs(const knot_rrset_t *covered,
 			note_earliest_expiration(valid_rr, sign_ctx->dnssec_ctx->now,
 			                         &sign_ctx->dnssec_ctx->stats->expire);
 			knot_spin_unlock(&sign_ctx->dnssec_ctx->stats->lock);
+			note_earliest_expiration(valid_rr, sign_ctx->dnssec_ctx->now,
+			                         &sign_ctx->expire);
+			continue;
+		}
+		if (reuse_stored_rrsig(covered, rrsigs, &stored, &stored_loaded,
+		                       sign_ctx, i, refresh, &to_add)) {
 			continue;
 		}
 		result = knot_sign_rrset(&to_add, covered, key->key, sign_ctx->sign_ctxs[i],
 		                         sign_ctx->dnssec_ctx, NULL);
+		if (result == KNOT_EOK) {
+			knot_time_t sig_expire = sign_ctx->dnssec_ctx->now +
+			                         sign_ctx->dnssec_ctx->policy->rrsig_lifetime;
+			sign_ctx->expire = knot_time_min(sign_ctx->expire, sig_expire);
+		}
 	}
 
 	if (!knot_rrset_empty(&to_remove) && result == KNOT_EOK) {
@@ -284,6 +361,7 @@ static int add_missing_rrsigs(const knot_rrset_t *covered,
 
 	knot_rdataset_clear(&to_add.rrs, NULL);
 	knot_rdataset_clear(&to_remove.rrs, NULL);
+	knot_rdataset_clear(&stored.rrs, NULL);
 
 	return result;
 }
@@ -464,18 +542,50 @@ static int remove_standalone_rrsigs(const zone_node_t *node,
 	return KNOT_EOK;
 }
 
+/*!
+ * \brief Check if an RRSet and its RRSIGs are the same as in the previous,
+ *        already verified, version of the node.
+ */
+static bool rrset_sigs_unchanged(zone_node_t *node, const knot_rrset_t *rrsigs,
+                                 uint16_t type)
+{
+	zone_node_t *prev = binode_counterpart(node);
+	if (prev == NULL || !(prev->flags & NODE_FLAGS_RRSIGS_VALID) ||
+	    !binode_rdata_shared(node, type)) {
+		return false;
+	}
+	if (binode_rdata_shared(node, KNOT_RRTYPE_RRSIG)) {
+		return true;
+	}
+
+	// Re-signing of other RRSets in the node doesn't matter.
+	knot_rrset_t prev_rrsigs = node_rrset(prev, KNOT_RRTYPE_RRSIG);
+	knot_rdataset_t sigs = { 0 }, prev_sigs = { 0 };
+	bool unchanged =
+		knot_synth_rrsig(type, &rrsigs->rrs, &sigs, NULL) == KNOT_EOK &&
+		knot_synth_rrsig(type, &prev_rrsigs.rrs, &prev_sigs, NULL) == KNOT_EOK &&
+		knot_rdataset_eq(&sigs, &prev_sigs);
+	knot_rdataset_clear(&sigs, NULL);
+	knot_rdataset_clear(&prev_sigs, NULL);
+
+	return unchanged;
+}
+
 /*!
  * \brief Update RRSIGs in a given node by updating changeset.
  *
  * \param node        Node to be signed.
  * \param sign_ctx    Local zone signing context.
+ * \param incremental Skip verification of RRSets not changed since the previous
+ *                    version of the bi-node.
  * \param changeset   Changeset to be updated.
  * \param hint        Out: if DNSSEC validation failed, hint why and where.
  *
  * \return Error code, KNOT_EOK if successful.
  */
-static int sign_node_rrsets(const zone_node_t *node,
+static int sign_node_rrsets(zone_node_t *node,
                             zone_sign_ctx_t *sign_ctx,
+                            bool incremental,
                             changeset_t *changeset,
                             dnssec_validation_hint_t *hint)
 {
@@ -486,6 +596,7 @@ static int sign_node_rrsets(const zone_node_t *node,
 	knot_rrset_t rrsigs = node_rrset(node, KNOT_RRTYPE_RRSIG);
 	bool skip_crypto = (node->flags & NODE_FLAGS_RRSIGS_VALID) &&
 	                   !sign_ctx->dnssec_ctx->keytag_conflict;
+	incremental = incremental && !sign_ctx->dnssec_ctx->keytag_conflict;
 
 	for (int i = 0; result == KNOT_EOK && i < node->rrset_count; i++) {
 		knot_rrset_t rrset = node_rrset_at(node, i);
@@ -506,7 +617,9 @@ static int sign_node_rrsets(const zone_node_t *node,
 
 		if (sign_ctx->dnssec_ctx->validation_mode) {
 			knot_time_t until = 0;
-			result = knot_validate_rrsigs(&rrset, &rrsigs, sign_ctx, skip_crypto, &until);
+			bool skip = skip_crypto ||
+			            (incremental && rrset_sigs_unchanged(node, &rrsigs, rrset.type));
+			result = knot_validate_rrsigs(&rrset, &rrsigs, sign_ctx, skip, &until);
 			knot_time_t diff = knot_time_diff(until, sign_ctx->dnssec_ctx->now);
 			if (result != KNOT_EOK) {
 				hint->node = node->owner;
@@ -533,50 +646,78 @@ static int sign_node_rrsets(const zone_node_t *node,
 	return result;
 }
 
+/*! \brief Number of nodes taken from the shared iterator at once. */
+#define SIGN_BATCH 32
+
+typedef struct {
+	zone_tree_it_t it;
+	pthread_mutex_t mx;
+} sign_shared_it_t;
+
 /*!
  * \brief Struct to carry data for 'sign_data' callback function.
  */
 typedef struct {
-	zone_tree_t *tree;
+	sign_shared_it_t *shared;
 	zone_sign_ctx_t *sign_ctx;
 	changeset_t changeset;
+	resign_index_t *resign_delta;
+	bool nsec3;
+	bool incremental;
 	dnssec_validation_hint_t *hint;
-	size_t num_threads;
-	size_t thread_index;
-	size_t rrset_index;
 	int errcode;
 	int thread_init_errcode;
 	pthread_t thread;
 } node_sign_args_t;
 
 /*!
- * \brief Sign node (callback function).
+ * \brief Sign node.
  *
  * \param node  Node to be signed.
- * \param data  Callback data, node_sign_args_t.
+ * \param args  Signing thread context.
  */
-static int sign_node(zone_node_t *node, void *data)
+static int sign_node(zone_node_t *node, node_sign_args_t *args)
 {
 	assert(node);
-	assert(data);
-
-	node_sign_args_t *args = (node_sign_args_t *)data;
+	assert(args);
 
 	if (node->rrset_count == 0) {
 		return KNOT_EOK;
 	}
 
-	if (args->rrset_index++ % args->num_threads != args->thread_index) {
-		return KNOT_EOK;
-	}
-
-	return sign_node_rrsets(node, args->sign_ctx, &args->changeset, args->hint);
+	return sign_node_rrsets(node, args->sign_ctx, args->incremental,
+	                        &args->changeset, args->hint);
 }
 
 static void *tree_sign_thread(void *_arg)
 {
 	node_sign_args_t *arg = _arg;
-	arg->errcode = zone_tree_apply(arg->tree, sign_node, _arg);
+	sign_shared_it_t *shared = arg->shared;
+
+	// Threads take batches of nodes until the whole tree is processed.
+	zone_node_t *batch[SIGN_BATCH];
+	while (arg->errcode == KNOT_EOK) {
+		size_t count = 0;
+		pthread_mutex_lock(&shared->mx);
+		while (count < SIGN_BATCH && !zone_tree_it_finished(&shared->it)) {
+			batch[count++] = zone_tree_it_val(&shared->it);
+			zone_tree_it_next(&shared->it);
+		}
+		pthread_mutex_unlock(&shared->mx);
+
+		if (count == 0) {
+			break;
+		}
+		for (size_t i = 0; i < count && arg->errcode == KNOT_EOK; i++) {
+			arg->sign_ctx->expire = 0;
+			arg->errcode = sign_node(batch[i], arg);
+			if (arg->errcode == KNOT_EOK && arg->resign_delta != NULL) {
+				arg->errcode = resign_index_set(arg->resign_delta, batch[i]->owner,
+				                                arg->nsec3, arg->sign_ctx->expire);
+			}
+		}
+	}
+
 	return NULL;
 }
 
@@ -586,34 +727,124 @@ static int set_signed(zone_node_t *node, _unused_ void *data)
 	return KNOT_EOK;
 }
 
+/*- RRSIG store --------------------------------------------------------------*/
+
+static bool rrsig_store_enabled(const kdnssec_ctx_t *dnssec_ctx)
+{
+	return dnssec_ctx->policy->rrsig_store && dnssec_ctx->kasp_db != NULL &&
+	       !dnssec_ctx->policy->offline_ksk && !dnssec_ctx->validation_mode &&
+	       !dnssec_ctx->keytag_conflict;
+}
+
 /*!
- * \brief Update RRSIGs in a given zone tree by updating changeset.
+ * \brief Find out which keys' RRSIGs may be reused from the RRSIG store.
+ *
+ * Stored RRSIGs are matched to keys just by key tag and algorithm, so a key
+ * qualifies only if no other key the stored RRSIGs may have been made with
+ * has the same ones.
  *
- * \param tree        Zone tree to be signed.
- * \param num_threads Number of threads to use for parallel signing.
  * \param zone_keys   Zone keys.
- * \param policy      DNSSEC policy.
- * \param update      Zone update structure to be updated.
+ * \param dnssec_ctx  DNSSEC context.
+ * \param usable      Output: key qualification, indexed as zone keys.
+ *
+ * \return Some key qualifies.
+ */
+static bool rrsig_store_keys(const zone_keyset_t *zone_keys,
+                             const kdnssec_ctx_t *dnssec_ctx, bool *usable)
+{
+	if (!rrsig_store_enabled(dnssec_ctx) || dnssec_ctx->rrsig_drop_existing) {
+		return false;
+	}
+
+	dnssec_binary_t stored = { 0 };
+	if (kasp_db_load_rrsig_keys(dnssec_ctx->kasp_db, dnssec_ctx->zone->dname,
+	                            &stored) != KNOT_EOK) {
+		return false;
+	}
+
+	bool any = false;
+	for (size_t i = 0; i < zone_keys->count; i++) {
+		const dnssec_key_t *key = zone_keys->keys[i].key;
+		uint16_t keytag = dnssec_key_get_keytag(key);
+		uint8_t algorithm = dnssec_key_get_algorithm(key);
+		dnssec_binary_t rdata = { 0 };
+		(void)dnssec_key_get_rdata(key, &rdata);
+
+		size_t same_tag = 0;
+		bool same_key = false;
+		wire_ctx_t wire = wire_ctx_init_const(stored.data, stored.size);
+		while (wire_ctx_available(&wire) > 0 && wire.error == KNOT_EOK) {
+			dnssec_binary_t stored_rdata = { .size = wire_ctx_read_u16(&wire) };
+			stored_rdata.data = wire.position;
+			wire_ctx_skip(&wire, stored_rdata.size);
+			uint16_t stored_keytag;
+			if (wire.error != KNOT_EOK ||
+			    dnssec_keytag(&stored_rdata, &stored_keytag) != DNSSEC_EOK) {
+				wire.error = KNOT_EMALF;
+				break;
+			}
+			// DNSKEY rdata: flags (2), protocol (1), algorithm (1), ...
+			if (stored_keytag == keytag && stored_rdata.data[3] == algorithm) {
+				same_tag++;
+				same_key = same_key || dnssec_binary_cmp(&stored_rdata, &rdata) == 0;
+			}
+		}
+		usable[i] = (wire.error == KNOT_EOK && same_tag == 1 && same_key);
+		any = any || usable[i];
+	}
+	dnssec_binary_free(&stored);
+
+	return any;
+}
+
+/*!
+ * \brief Update RRSIGs in a given zone tree by updating changeset.
+ *
+ * \param tree         Zone tree to be signed.
+ * \param nsec3        The tree contains NSEC3 nodes.
+ * \param incremental  The tree contains changed nodes of an incremental update.
+ * \param num_threads  Number of threads to use for parallel signing.
+ * \param zone_keys    Zone keys.
+ * \param policy       DNSSEC policy.
+ * \param update       Zone update structure to be updated.
+ * \param resign_delta Optional index to note RRSIG expirations of signed nodes.
  *
  * \return Error code, KNOT_EOK if successful.
  */
 static int zone_tree_sign(zone_tree_t *tree,
+                          bool nsec3,
+                          bool incremental,
                           size_t num_threads,
                           zone_keyset_t *zone_keys,
                           const kdnssec_ctx_t *dnssec_ctx,
-                          zone_update_t *update)
+                          zone_update_t *update,
+                          resign_index_t *resign_delta)
 {
 	assert(zone_keys || dnssec_ctx->validation_mode);
 	assert(dnssec_ctx);
 	assert(update || dnssec_ctx->validation_mode);
 
-	int ret = KNOT_EOK;
+	if (zone_tree_is_empty(tree)) {
+		return KNOT_EOK;
+	}
+
+	sign_shared_it_t shared = { { 0 } };
+	int ret = zone_tree_it_begin(tree, &shared.it);
+	if (ret != KNOT_EOK) {
+		return ret;
+	}
+	pthread_mutex_init(&shared.mx, NULL);
+
 	node_sign_args_t args[num_threads];
 	memset(args, 0, sizeof(args));
 
+	bool stored_keys[zone_keys != NULL ? zone_keys->count + 1 : 1];
+	bool use_store = zone_keys != NULL && !dnssec_ctx->validation_mode &&
+	                 rrsig_store_keys(zone_keys, dnssec_ctx, stored_keys);
+
 	// init context structures
 	for (size_t i = 0; i < num_threads; i++) {
-		args[i].tree = tree;
+		args[i].shared = &shared;
 		args[i].sign_ctx = dnssec_ctx->validation_mode
 		                 ? zone_validation_ctx(dnssec_ctx)
 		                 : zone_sign_ctx(zone_keys, dnssec_ctx);
@@ -621,14 +852,23 @@ static int zone_tree_sign(zone_tree_t *tree,
 			ret = KNOT_ENOMEM;
 			break;
 		}
+		if (use_store) {
+			args[i].sign_ctx->stored_keys = stored_keys;
+		}
 		ret = changeset_init(&args[i].changeset, dnssec_ctx->zone->dname);
 		if (ret != KNOT_EOK) {
 			break;
 		}
+		if (resign_delta != NULL) {
+			args[i].resign_delta = resign_index_new(0, false);
+			if (args[i].resign_delta == NULL) {
+				ret = KNOT_ENOMEM;
+				break;
+			}
+		}
+		args[i].nsec3 = nsec3;
+		args[i].incremental = incremental;
 		args[i].hint = &update->validation_hint;
-		args[i].num_threads = num_threads;
-		args[i].thread_index = i;
-		args[i].rrset_index = 0;
 		args[i].errcode = KNOT_EOK;
 		args[i].thread_init_errcode = -1;
 	}
@@ -636,11 +876,21 @@ static int zone_tree_sign(zone_tree_t *tree,
 		for (size_t i = 0; i < num_threads; i++) {
 			changeset_clear(&args[i].changeset);
 			zone_sign_ctx_free(args[i].sign_ctx);
+			resign_index_free(args[i].resign_delta);
 		}
-		return ret;
+		goto cleanup;
 	}
 
-	if (num_threads == 1) {
+	sign_pool_t *pool = (update != NULL && update->zone->server != NULL) ?
+	                    update->zone->server->sign_pool : NULL;
+	if (pool != NULL) {
+		knot_time_t deadline = (update->zone->contents != NULL) ?
+		                       ATOMIC_GET(update->zone->contents->dnssec_expire) : 0;
+		for (size_t i = 0; i < num_threads; i++) {
+			args[i].thread_init_errcode = 0;
+		}
+		sign_pool_run(pool, deadline, tree_sign_thread, args, sizeof(args[0]), num_threads);
+	} else if (num_threads == 1) {
 		args[0].thread_init_errcode = 0;
 		tree_sign_thread(&args[0]);
 	} else {
@@ -668,11 +918,217 @@ static int zone_tree_sign(zone_tree_t *tree,
 				if (ret == KNOT_EOK && !dnssec_ctx->validation_mode) {
 					ret = zone_update_apply_changeset(update, &args[i].changeset); // _fix not needed
 				}
+				if (ret == KNOT_EOK && resign_delta != NULL) {
+					ret = resign_index_merge(resign_delta, args[i].resign_delta);
+				}
 			}
 		}
 		assert(!dnssec_ctx->validation_mode || changeset_empty(&args[i].changeset));
 		changeset_clear(&args[i].changeset);
 		zone_sign_ctx_free(args[i].sign_ctx);
+		resign_index_free(args[i].resign_delta);
+	}
+
+cleanup:
+	pthread_mutex_destroy(&shared.mx);
+	zone_tree_it_free(&shared.it);
+
+	return ret;
+}
+
+/*- RRSIG expiration index ---------------------------------------------------*/
+
+static bool resign_index_enabled(const kdnssec_ctx_t *dnssec_ctx)
+{
+	return dnssec_ctx->policy->rrsig_index && !dnssec_ctx->policy->offline_ksk &&
+	       !dnssec_ctx->validation_mode;
+}
+
+/*!
+ * \brief Fingerprint of what determines the set of RRSIGs in the zone.
+ *
+ * Only the keys signing the records outside of the apex are considered, as
+ * the apex is always re-signed. So KSK events like submission or CDS
+ * publication don't invalidate the index.
+ */
+static uint64_t resign_fingerprint(const zone_keyset_t *zone_keys,
+                                   const kdnssec_ctx_t *dnssec_ctx)
+{
+	SIPHASH_KEY key = { 0 };
+	SIPHASH_CTX hash;
+	SipHash24_Init(&hash, &key);
+
+	for (size_t i = 0; i < zone_keys->count; i++) {
+		const zone_key_t *k = &zone_keys->keys[i];
+		if (!k->is_zsk || !(k->is_active || k->is_zsk_active_plus)) {
+			continue; // See knot_zone_sign_use_key().
+		}
+		dnssec_binary_t rdata = { 0 };
+		(void)dnssec_key_get_rdata(k->key, &rdata);
+		SipHash24_Update(&hash, rdata.data, rdata.size);
+	}
+
+	const knot_kasp_policy_t *policy = dnssec_ctx->policy;
+	bool nsec3[] = { policy->nsec3_enabled, policy->nsec3_opt_out };
+	SipHash24_Update(&hash, nsec3, sizeof(nsec3));
+	SipHash24_Update(&hash, &policy->nsec3_iterations, sizeof(policy->nsec3_iterations));
+	SipHash24_Update(&hash, dnssec_ctx->zone->nsec3_salt.data,
+	                 dnssec_ctx->zone->nsec3_salt.size);
+
+	return SipHash24_End(&hash) | 1; // 0 is reserved for invalid
+}
+
+/*!
+ * \brief Get the index to note RRSIG expirations of signed nodes into.
+ *
+ * \param update     Zone update.
+ * \param zone_keys  Zone keys.
+ * \param dnssec_ctx DNSSEC context.
+ * \param complete   All signed nodes of the zone will be noted.
+ *
+ * \return Delta index of the update, or NULL if not to be noted.
+ */
+static resign_index_t *resign_delta(zone_update_t *update,
+                                    const zone_keyset_t *zone_keys,
+                                    const kdnssec_ctx_t *dnssec_ctx,
+                                    bool complete)
+{
+	if (!resign_index_enabled(dnssec_ctx)) {
+		return NULL;
+	}
+
+	uint64_t fingerprint = resign_fingerprint(zone_keys, dnssec_ctx);
+	if (complete) {
+		resign_index_free(update->resign_delta);
+		update->resign_delta = resign_index_new(fingerprint, true);
+	} else if (update->resign_delta == NULL) {
+		update->resign_delta = resign_index_new(fingerprint, false);
+	} else if (update->resign_delta->fingerprint != fingerprint) {
+		update->resign_delta->fingerprint = 0; // Drop the zone index on commit.
+	}
+
+	return update->resign_delta;
+}
+
+/*!
+ * \brief Check if the apex type bitmap changed, thus the NSEC(3) chain has to be updated.
+ */
+static bool apex_types_changed(zone_update_t *update)
+{
+	if (update->zone->contents == NULL) {
+		return true;
+	}
+
+	const zone_node_t *old_apex = update->zone->contents->apex;
+	const zone_node_t *new_apex = update->new_cont->apex;
+	if (old_apex->rrset_count != new_apex->rrset_count) {
+		return true;
+	}
+	for (int i = 0; i < new_apex->rrset_count; i++) {
+		if (!node_rrtype_exists(old_apex, new_apex->rrs[i].type)) {
+			return true;
+		}
+	}
+
+	return false;
+}
+
+typedef struct {
+	zone_contents_t *contents;
+	zone_tree_t *nodes;
+	zone_tree_t *nsec3_nodes;
+	resign_index_t *delta;
+} due_nodes_ctx_t;
+
+static int add_due_node(const knot_dname_t *owner, bool nsec3, void *data)
+{
+	due_nodes_ctx_t *ctx = data;
+
+	zone_tree_t *tree = nsec3 ? ctx->contents->nsec3_nodes : ctx->contents->nodes;
+	zone_node_t *node = zone_tree_get(tree, owner);
+	if (node == NULL || (node->flags & NODE_FLAGS_DELETED)) {
+		return resign_index_set(ctx->delta, owner, nsec3, 0);
+	}
+
+	return zone_tree_insert(nsec3 ? ctx->nsec3_nodes : ctx->nodes, &node);
+}
+
+int knot_zone_sign_due(zone_update_t *update,
+                       zone_keyset_t *zone_keys,
+                       const kdnssec_ctx_t *dnssec_ctx)
+{
+	if (update == NULL || zone_keys == NULL || dnssec_ctx == NULL ||
+	    dnssec_ctx->policy->signing_threads < 1) {
+		return KNOT_EINVAL;
+	}
+
+	resign_index_t *index = update->zone->resign_idx;
+	if (!resign_index_enabled(dnssec_ctx) || dnssec_ctx->rrsig_drop_existing ||
+	    index == NULL || index->fingerprint != resign_fingerprint(zone_keys, dnssec_ctx) ||
+	    update->zone->contents == NULL) {
+		return KNOT_ENOENT;
+	}
+
+	resign_index_t *delta = resign_delta(update, zone_keys, dnssec_ctx, false);
+	if (delta == NULL) {
+		return KNOT_ENOMEM;
+	}
+
+	zone_contents_t *contents = update->new_cont;
+	due_nodes_ctx_t due = {
+		.contents = contents,
+		.nodes = zone_tree_create(true),
+		.nsec3_nodes = zone_tree_create(true),
+		.delta = delta,
+	};
+	if (due.nodes == NULL || due.nsec3_nodes == NULL) {
+		zone_tree_free(&due.nodes);
+		zone_tree_free(&due.nsec3_nodes);
+		return KNOT_ENOMEM;
+	}
+	due.nodes->flags = contents->nodes->flags;
+	due.nsec3_nodes->flags = contents->nodes->flags;
+
+	// The apex is always re-checked as DNSKEY and similar records might have changed.
+	zone_node_t *apex = contents->apex;
+	int ret = zone_tree_insert(due.nodes, &apex);
+	if (ret == KNOT_EOK) {
+		knot_time_t until = dnssec_ctx->now + dnssec_ctx->policy->rrsig_refresh_before +
+		                    dnssec_ctx->policy->rrsig_prerefresh;
+		ret = resign_index_due(index, until, add_due_node, &due);
+	}
+
+	if (ret == KNOT_EOK) {
+		log_zone_info(contents->apex->owner, "DNSSEC, refreshing signatures "
+		              "in %zu nodes", zone_tree_count(due.nodes) +
+		              zone_tree_count(due.nsec3_nodes));
+		ret = zone_tree_sign(due.nodes, false, false, dnssec_ctx->policy->signing_threads,
+		                     zone_keys, dnssec_ctx, update, delta);
+	}
+	if (ret == KNOT_EOK) {
+		ret = zone_tree_sign(due.nsec3_nodes, true, false, dnssec_ctx->policy->signing_threads,
+		                     zone_keys, dnssec_ctx, update, delta);
+	}
+	if (ret == KNOT_EOK) {
+		ret = zone_tree_apply(due.nodes, set_signed, NULL);
+	}
+	if (ret == KNOT_EOK) {
+		ret = zone_tree_apply(due.nsec3_nodes, set_signed, NULL);
+	}
+	zone_tree_free(&due.nodes);
+	zone_tree_free(&due.nsec3_nodes);
+
+	// E.g. CDS published or withdrawn, just the apex NSEC(3) is updated.
+	if (ret == KNOT_EOK && apex_types_changed(update)) {
+		ret = knot_zone_fix_nsec_chain(update, zone_keys, dnssec_ctx);
+	}
+
+	if (ret == KNOT_EOK) {
+		// Signatures not due haven't been noted during signing.
+		knot_time_t rest = resign_index_earliest(index, delta);
+		knot_spin_lock(&dnssec_ctx->stats->lock);
+		dnssec_ctx->stats->expire = knot_time_min(dnssec_ctx->stats->expire, rest);
+		knot_spin_unlock(&dnssec_ctx->stats->lock);
 	}
 
 	return ret;
@@ -715,14 +1171,19 @@ int knot_zone_sign(zone_update_t *update,
 
 	int result;
 
-	result = zone_tree_sign(update->new_cont->nodes, dnssec_ctx->policy->signing_threads,
-	                        zone_keys, dnssec_ctx, update);
+	resign_index_t *delta = NULL;
+	if (!dnssec_ctx->validation_mode) {
+		delta = resign_delta(update, zone_keys, dnssec_ctx, true);
+	}
+
+	result = zone_tree_sign(update->new_cont->nodes, false, false, dnssec_ctx->policy->signing_threads,
+	                        zone_keys, dnssec_ctx, update, delta);
 	if (result != KNOT_EOK) {
 		return result;
 	}
 
-	result = zone_tree_sign(update->new_cont->nsec3_nodes, dnssec_ctx->policy->signing_threads,
-	                        zone_keys, dnssec_ctx, update);
+	result = zone_tree_sign(update->new_cont->nsec3_nodes, true, false, dnssec_ctx->policy->signing_threads,
+	                        zone_keys, dnssec_ctx, update, delta);
 	if (result != KNOT_EOK) {
 		return result;
 	}
@@ -975,13 +1436,18 @@ int knot_zone_sign_nsecs_in_changeset(const zone_keyset_t *zone_keys,
 		return KNOT_ENOMEM;
 	}
 
+	// Only NSEC3 nodes are processed whole, other nodes were noted earlier.
+	resign_index_t *delta = resign_delta(update, zone_keys, dnssec_ctx, false);
+
 	zone_tree_it_t it = { 0 };
 	int ret = zone_tree_it_double_begin(update->a_ctx->node_ptrs, update->a_ctx->nsec3_ptrs, &it);
 
 	while (!zone_tree_it_finished(&it) && ret == KNOT_EOK) {
 		zone_node_t *n = zone_tree_it_val(&it);
 		bool skip_crypto = (n->flags & NODE_FLAGS_RRSIGS_VALID) && !dnssec_ctx->keytag_conflict;
+		bool nsec3 = node_rrtype_exists(n, KNOT_RRTYPE_NSEC3);
 
+		sign_ctx->expire = 0;
 		ret = sign_in_changeset(n, KNOT_RRTYPE_NSEC, sign_ctx, ret, skip_crypto, update);
 		ret = sign_in_changeset(n, KNOT_RRTYPE_NSEC3, sign_ctx, ret, skip_crypto, update);
 		ret = sign_in_changeset(n, KNOT_RRTYPE_NSEC3PARAM, sign_ctx, ret, skip_crypto, update);
@@ -989,6 +1455,9 @@ int knot_zone_sign_nsecs_in_changeset(const zone_keyset_t *zone_keys,
 		if (ret == KNOT_EOK) {
 			n->flags |= NODE_FLAGS_RRSIGS_VALID; // non-NSEC RRSIGs had been validated in knot_dnssec_sign_update()
 		}
+		if (ret == KNOT_EOK && delta != NULL && nsec3) {
+			ret = resign_index_set(delta, n->owner, true, sign_ctx->expire);
+		}
 
 		zone_tree_it_next(&it);
 	}
@@ -1038,14 +1507,18 @@ int knot_zone_sign_update(zone_update_t *update,
 	if (full_sign) {
 		ret = knot_zone_sign(update, zone_keys, dnssec_ctx);
 	} else {
-		ret = zone_tree_sign(update->a_ctx->node_ptrs, dnssec_ctx->policy->signing_threads,
-				     zone_keys, dnssec_ctx, update);
+		resign_index_t *delta = NULL;
+		if (!dnssec_ctx->validation_mode) {
+			delta = resign_delta(update, zone_keys, dnssec_ctx, false);
+		}
+		ret = zone_tree_sign(update->a_ctx->node_ptrs, false, true, dnssec_ctx->policy->signing_threads,
+				     zone_keys, dnssec_ctx, update, delta);
 		if (ret == KNOT_EOK) {
 			ret = zone_tree_apply(update->a_ctx->node_ptrs, set_signed, NULL);
 		}
 		if (ret == KNOT_EOK && dnssec_ctx->validation_mode) {
-			ret = zone_tree_sign(update->a_ctx->nsec3_ptrs, dnssec_ctx->policy->signing_threads,
-			                     zone_keys, dnssec_ctx, update);
+			ret = zone_tree_sign(update->a_ctx->nsec3_ptrs, true, true, dnssec_ctx->policy->signing_threads,
+			                     zone_keys, dnssec_ctx, update, NULL);
 		}
 		if (ret == KNOT_EOK && dnssec_ctx->validation_mode) {
 			ret = zone_tree_apply(update->a_ctx->nsec3_ptrs, set_signed, NULL);
@@ -1055,6 +1528,58 @@ int knot_zone_sign_update(zone_update_t *update,
 	return ret;
 }
 
+int knot_zone_sign_store(zone_update_t *update,
+                         const zone_keyset_t *zone_keys,
+                         const kdnssec_ctx_t *dnssec_ctx,
+                         bool whole)
+{
+	if (update == NULL || zone_keys == NULL || dnssec_ctx == NULL) {
+		return KNOT_EINVAL;
+	}
+	if (!rrsig_store_enabled(dnssec_ctx)) {
+		return KNOT_EOK;
+	}
+
+	// Replace the zone's stored RRSIGs if whole zone signed from scratch or if
+	// not stored yet, otherwise just update those in changed nodes.
+	dnssec_binary_t keys = { 0 };
+	int ret = kasp_db_load_rrsig_keys(dnssec_ctx->kasp_db, dnssec_ctx->zone->dname, &keys);
+	dnssec_binary_free(&keys);
+	bool replace = whole && (ret == KNOT_ENOENT || !(update->flags & UPDATE_INCREMENTAL));
+	if (!replace && ret != KNOT_EOK) {
+		return ret == KNOT_ENOENT ? KNOT_EOK : ret;
+	}
+
+	for (size_t i = 0; i < zone_keys->count; i++) {
+		dnssec_binary_t rdata = { 0 };
+		(void)dnssec_key_get_rdata(zone_keys->keys[i].key, &rdata);
+		keys.size += sizeof(uint16_t) + rdata.size;
+	}
+	keys.data = malloc(keys.size);
+	if (keys.data == NULL) {
+		return KNOT_ENOMEM;
+	}
+	wire_ctx_t wire = wire_ctx_init(keys.data, keys.size);
+	for (size_t i = 0; i < zone_keys->count; i++) {
+		dnssec_binary_t rdata = { 0 };
+		(void)dnssec_key_get_rdata(zone_keys->keys[i].key, &rdata);
+		wire_ctx_write_u16(&wire, rdata.size);
+		wire_ctx_write(&wire, rdata.data, rdata.size);
+	}
+	assert(wire.error == KNOT_EOK);
+
+	if (replace) {
+		ret = kasp_db_store_rrsigs(dnssec_ctx->kasp_db, dnssec_ctx->zone->dname, &keys,
+		                           update->new_cont->nodes, update->new_cont->nsec3_nodes, true);
+	} else {
+		ret = kasp_db_store_rrsigs(dnssec_ctx->kasp_db, dnssec_ctx->zone->dname, &keys,
+		                           update->a_ctx->node_ptrs, update->a_ctx->nsec3_ptrs, false);
+	}
+	dnssec_binary_free(&keys);
+
+	return ret;
+}
+
 int knot_zone_sign_apex_rr(zone_update_t *update, uint16_t rrtype,
                            const zone_keyset_t *zone_keys,
                            const kdnssec_ctx_t *dnssec_ctx)
@@ -106,6 +106,23 @@ int knot_zone_sign(zone_update_t *update,
                    zone_keyset_t *zone_keys,
                    const kdnssec_ctx_t *dnssec_ctx);
 
+/*!
+ * \brief Update RRSIGs only in nodes with signatures due for refresh.
+ *
+ * The nodes are looked up in the RRSIG expiration index of the zone,
+ * the zone apex is always updated. A change of the apex types (e.g. CDS)
+ * is reflected by an incremental NSEC(3) chain fix.
+ *
+ * \param update     Zone Update structure with current zone contents to be updated by signing.
+ * \param zone_keys  Zone keys.
+ * \param dnssec_ctx DNSSEC context.
+ *
+ * \return KNOT_ENOENT if the index isn't usable and the whole zone must be signed.
+ */
+int knot_zone_sign_due(zone_update_t *update,
+                       zone_keyset_t *zone_keys,
+                       const kdnssec_ctx_t *dnssec_ctx);
+
 /*!
  * \brief Sign NSEC/NSEC3 nodes in changeset and update the changeset.
  *
@@ -145,6 +162,21 @@ int knot_zone_sign_update(zone_update_t *update,
                           zone_keyset_t *zone_keys,
                           const kdnssec_ctx_t *dnssec_ctx);
 
+/*!
+ * \brief Keep RRSIGs of the zone in the RRSIG store for later reuse, if enabled.
+ *
+ * \param update      Signed zone update.
+ * \param zone_keys   Zone keys.
+ * \param dnssec_ctx  DNSSEC context.
+ * \param whole       The whole zone has been signed.
+ *
+ * \return Error code, KNOT_EOK if successful.
+ */
+int knot_zone_sign_store(zone_update_t *update,
+                         const zone_keyset_t *zone_keys,
+                         const kdnssec_ctx_t *dnssec_ctx,
+                         bool whole);
+
 /*!
  * \brief Force re-sign of a RRSet in zone apex.
  *
@@ -0,0 +1,74 @@
+/*  Copyright (C) 2024 CZ.NIC, z.s.p.o. <knot-dns@labs.nic.cz>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+
+#include "knot/events/event_stats.h"
+#include "contrib/time.h"
+
+event_stats_t event_stats;
+
+static const char *time_names[EVENT_HIST_COUNT] = {
+	[EVENT_HIST_WAIT] = "wait-time",
+	[EVENT_HIST_RUN]  = "run-time",
+};
+
+static const char *bucket_names[EVENT_HIST_COUNT][EVENT_HIST_BUCKETS] = {
+	[EVENT_HIST_WAIT] = { "wait-1ms", "wait-10ms", "wait-100ms", "wait-1s", "wait-10s", "wait-more" },
+	[EVENT_HIST_RUN]  = { "run-1ms",  "run-10ms",  "run-100ms",  "run-1s",  "run-10s",  "run-more" },
+};
+
+static void record(event_stats_t *zone_stats, zone_event_type_t type, event_hist_t hist,
+                   const struct timespec *begin, const struct timespec *end)
+{
+	double diff = time_diff_ms(begin, end);
+	uint64_t usec = diff > 0 ? diff * 1000 : 0;
+
+	unsigned bucket = 0;
+	for (uint64_t limit = 1000; bucket < EVENT_HIST_BUCKETS - 1 && usec > limit;
+	     limit *= 10) {
+		bucket++;
+	}
+
+	ATOMIC_ADD(event_stats.time[type][hist], usec);
+	ATOMIC_ADD(event_stats.hist[type][hist][bucket], 1);
+	if (zone_stats != NULL) {
+		ATOMIC_ADD(zone_stats->time[type][hist], usec);
+		ATOMIC_ADD(zone_stats->hist[type][hist][bucket], 1);
+	}
+}
+
+void event_stats_record(event_stats_t *zone_stats, zone_event_type_t type,
+                        const struct timespec *queued, const struct timespec *begin,
+                        const struct timespec *end)
+{
+	ATOMIC_ADD(event_stats.runs[type], 1);
+	if (zone_stats != NULL) {
+		ATOMIC_ADD(zone_stats->runs[type], 1);
+	}
+
+	record(zone_stats, type, EVENT_HIST_WAIT, queued, begin);
+	record(zone_stats, type, EVENT_HIST_RUN, begin, end);
+}
+
+const char *event_stats_time_name(event_hist_t hist)
+{
+	return time_names[hist];
+}
+
+const char *event_stats_bucket_name(event_hist_t hist, unsigned bucket)
+{
+	return bucket_names[hist][bucket];
+}
@@ -0,0 +1,64 @@
+/*  Copyright (C) 2024 CZ.NIC, z.s.p.o. <knot-dns@labs.nic.cz>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+
+#pragma once
+
+#include <stdint.h>
+#include <time.h>
+
+#include "contrib/atomic.h"
+#include "knot/events/events.h"
+
+/*!
+ * \brief Zone event latencies.
+ */
+typedef enum {
+	EVENT_HIST_WAIT, /*!< Time in the worker pool queue. */
+	EVENT_HIST_RUN,  /*!< Time of the event handler execution. */
+	EVENT_HIST_COUNT
+} event_hist_t;
+
+/*! \brief Latency buckets: up to 1 ms, 10 ms, 100 ms, 1 s, 10 s, and more. */
+#define EVENT_HIST_BUCKETS 6
+
+typedef struct {
+	knot_atomic_uint64_t runs[ZONE_EVENT_COUNT];
+	knot_atomic_uint64_t time[ZONE_EVENT_COUNT][EVENT_HIST_COUNT]; /*!< Total microseconds. */
+	knot_atomic_uint64_t hist[ZONE_EVENT_COUNT][EVENT_HIST_COUNT][EVENT_HIST_BUCKETS];
+} event_stats_t;
+
+/*! \brief Statistics of all the zone events. */
+extern event_stats_t event_stats;
+
+/*!
+ * \brief Account an executed event, both globally and to the zone.
+ *
+ * \param zone_stats   Per-zone statistics (can be NULL).
+ * \param type         Event type.
+ * \param queued       Time of handing the event over to the worker pool.
+ * \param begin        Start of the event execution.
+ * \param end          End of the event execution.
+ */
+void event_stats_record(event_stats_t *zone_stats, zone_event_type_t type,
+                        const struct timespec *queued, const struct timespec *begin,
+                        const struct timespec *end);
+
+/*! \brief Get the total time counter name. */
+const char *event_stats_time_name(event_hist_t hist);
+
+/*! \brief Get the histogram bucket name. */
+const char *event_stats_bucket_name(event_hist_t hist, unsigned bucket);
@@ -16,15 +16,20 @@
 
 #include <assert.h>
 #include <stdarg.h>
+#include <string.h>
 #include <time.h>
 #include <unistd.h>
 #include <urcu.h>
 
+#include "contrib/time.h"
 #include "libknot/libknot.h"
 #include "knot/common/log.h"
+#include "knot/common/probes.h"
+#include "knot/events/event_stats.h"
 #include "knot/events/events.h"
 #include "knot/events/handlers.h"
 #include "knot/events/replan.h"
+#include "knot/server/dthreads.h"
 #include "knot/zone/zone.h"
 
 #define ZONE_EVENT_IMMEDIATE 1 /* Fast-track to worker queue. */
@@ -52,6 +57,7 @@ static const event_info_t EVENT_INFO[] = {
 	{ ZONE_EVENT_DS_CHECK,     event_ds_check,    "DS-check" },
 	{ ZONE_EVENT_DS_PUSH,      event_ds_push,     "DS-push" },
 	{ ZONE_EVENT_DNSKEY_SYNC,  event_dnskey_sync, "DNSKEY-sync" },
+	{ ZONE_EVENT_UNLOAD,       event_unload,      "unload" },
 	{ 0 }
 };
 
@@ -82,12 +88,37 @@ bool ufreeze_applies(zone_event_type_t type)
 	case ZONE_EVENT_FLUSH:
 	case ZONE_EVENT_DNSSEC:
 	case ZONE_EVENT_DS_CHECK:
+	case ZONE_EVENT_UNLOAD:
 		return true;
 	default:
 		return false;
 	}
 }
 
+/*!
+ * \brief Worker priority class of the event.
+ *
+ * \note The class is determined when the zone is enqueued, the event actually
+ *       executed may differ if another one is planned earlier meanwhile.
+ */
+static worker_class_t event_class(zone_event_type_t type)
+{
+	switch (type) {
+	case ZONE_EVENT_LOAD:
+	case ZONE_EVENT_BACKUP:
+	case ZONE_EVENT_DNSSEC:
+	case ZONE_EVENT_VALIDATE:
+		return WORKER_CLASS_HEAVY;
+	case ZONE_EVENT_FLUSH:
+	case ZONE_EVENT_DS_CHECK:
+	case ZONE_EVENT_DNSKEY_SYNC:
+	case ZONE_EVENT_UNLOAD:
+		return WORKER_CLASS_NORMAL;
+	default:
+		return WORKER_CLASS_URGENT;
+	}
+}
+
 /*! \brief Return remaining time to planned event (seconds). */
 static time_t time_until(time_t planned)
 {
@@ -222,9 +253,11 @@ static void event_wrap(worker_task_t *task)
 	events->type = type;
 	event_set_time(events, type, 0);
 	events->forced[type] = false;
+	struct timespec queued = events->queued;
 	pthread_mutex_unlock(&events->mx);
 
 	const event_info_t *info = get_event_info(type);
+	struct timespec begin = time_now();
 
 	/* Create a configuration copy just for this event. */
 	conf_t *conf;
@@ -232,11 +265,21 @@ static void event_wrap(worker_task_t *task)
 	int ret = conf_clone(&conf);
 	rcu_read_unlock();
 	if (ret == KNOT_EOK) {
+		/* Spread the zone contents evenly over the NUMA nodes. */
+		if (conf->cache.srv_numa_affinity) {
+			(void)dt_set_mempolicy(DT_MEMPOLICY_INTERLEAVE, 0);
+		}
+
 		/* Execute the event callback. */
+		KNOTD_PROBE2(event__begin, zone->name, type);
 		ret = info->callback(conf, zone);
+		KNOTD_PROBE3(event__end, zone->name, type, ret);
 		conf_free(conf);
 	}
 
+	struct timespec end = time_now();
+	event_stats_record(&zone->event_stats, type, &queued, &begin, &end);
+
 	if (ret != KNOT_EOK) {
 		log_zone_error(zone->name, "zone event '%s' failed (%s)",
 		               info->name, knot_strerror(ret));
@@ -273,6 +316,8 @@ static void event_dispatch(event_t *event)
 	pthread_mutex_lock(&events->mx);
 	if (!events->running && !events->frozen) {
 		events->running = time(NULL);
+		events->queued = time_now();
+		events->task.cls = event_class(get_next_event(events));
 		worker_pool_assign(events->pool, &events->task);
 	}
 	pthread_mutex_unlock(&events->mx);
@@ -440,6 +485,7 @@ void zone_events_enqueue(zone_t *zone, zone_event_type_t type)
 		events->running = time(NULL);
 		events->type = type;
 		event_set_time(events, type, ZONE_EVENT_IMMEDIATE);
+		events->task.cls = event_class(type);
 		worker_pool_assign(events->pool, &events->task);
 		pthread_mutex_unlock(&events->mx);
 		return;
@@ -530,6 +576,15 @@ time_t zone_events_get_time(const struct zone *zone, zone_event_type_t type)
 	return event_time;
 }
 
+void zone_events_get_times(const struct zone *zone, time_t times[ZONE_EVENT_COUNT])
+{
+	zone_events_t *events = (zone_events_t *)&zone->events;
+
+	pthread_mutex_lock(&events->mx);
+	memcpy(times, events->time, ZONE_EVENT_COUNT * sizeof(*times));
+	pthread_mutex_unlock(&events->mx);
+}
+
 const char *zone_events_get_name(zone_event_type_t type)
 {
 	/* Get information about the event and time. */
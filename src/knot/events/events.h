@@ -44,6 +44,7 @@ typedef enum zone_event_type {
 	ZONE_EVENT_DS_CHECK,
 	ZONE_EVENT_DS_PUSH,
 	ZONE_EVENT_DNSKEY_SYNC,
+	ZONE_EVENT_UNLOAD,
 	// terminator
 	ZONE_EVENT_COUNT,
 } zone_event_type_t;
@@ -63,6 +64,7 @@ typedef struct zone_events {
 	worker_pool_t *pool;		//!< Server worker pool.
 
 	worker_task_t task;		//!< Event execution context.
+	struct timespec queued;		//!< Time the task was handed over to the workers.
 	time_t time[ZONE_EVENT_COUNT];	//!< Event execution times.
 	bool forced[ZONE_EVENT_COUNT];  //!< Flag that the event was invoked by user ctl.
 	pthread_cond_t *blocking[ZONE_EVENT_COUNT];       //!< For blocking events: dispatching cond.
@@ -195,6 +197,14 @@ void zone_events_start(struct zone *zone);
  */
 time_t zone_events_get_time(const struct zone *zone, zone_event_type_t type);
 
+/*!
+ * \brief Return times of all the events at once.
+ *
+ * \param zone   Zone to get event times from.
+ * \param times  Output: event times (0 if not planned) indexed by event type.
+ */
+void zone_events_get_times(const struct zone *zone, time_t times[ZONE_EVENT_COUNT]);
+
 /*!
  * \brief Return text name of the event.
  *
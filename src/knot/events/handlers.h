@@ -34,6 +34,10 @@ int event_flush(conf_t *conf, zone_t *zone);
 int event_backup(conf_t *conf, zone_t *zone);
 /*! \brief Sends notify to slaves. */
 int event_notify(conf_t *conf, zone_t *zone);
+/*! \brief NOT A HANDLER, processes the result of a NOTIFY sent by the server NOTIFY scheduler. */
+void event_notify_result(conf_t *conf, zone_t *zone, const conf_remote_t *remote,
+                         notifailed_rmt_hash hash, const knot_rrset_t *soa,
+                         bool retry, int ret, int rcode);
 /*! \brief Signs the zone using its DNSSEC keys, perform key rollovers. */
 int event_dnssec(conf_t *conf, zone_t *zone);
 /*! \brief NOT A HANDLER, just a helper function to reschedule based on reschedule_t */
@@ -51,3 +55,5 @@ int event_ds_check(conf_t *conf, zone_t *zone);
 int event_ds_push(conf_t *conf, zone_t *zone);
 /*! \brief After DNSSEC sign, synchronize DNSKEY+CDNSKEY+CDS using DDNS. */
 int event_dnskey_sync(conf_t *conf, zone_t *zone);
+/*! \brief Drops contents of an idle lazily loaded zone. */
+int event_unload(conf_t *conf, zone_t *zone);
@@ -78,7 +78,7 @@ int event_dnssec(conf_t *conf, zone_t *zone)
 		sign_flags = ZONE_SIGN_DROP_SIGNATURES;
 	} else {
 		log_zone_info(zone->name, "DNSSEC, signing zone");
-		sign_flags = 0;
+		sign_flags = ZONE_SIGN_DUE_ONLY;
 	}
 
 	if (zone_get_flag(zone, ZONE_FORCE_KSK_ROLL, true)) {
@@ -27,7 +27,11 @@ int event_ds_check(conf_t *conf, zone_t *zone)
 	}
 
 	ret = knot_parent_ds_query(conf, &ctx, zone->server,
-	                           conf->cache.srv_tcp_remote_io_timeout);
+	                           conf->cache.srv_tcp_remote_io_timeout, true);
+	if (ret == KNOT_EAGAIN) {
+		kdnssec_ctx_deinit(&ctx);
+		return KNOT_EOK; // Scheduled again once the parents respond.
+	}
 
 	zone->timers.next_ds_check = 0;
 	switch (ret) {
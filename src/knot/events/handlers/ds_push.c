@@ -15,6 +15,7 @@
  */
 
 #include <assert.h>
+#include <urcu.h>
 
 #include "knot/common/log.h"
 #include "knot/conf/conf.h"
@@ -22,8 +23,19 @@
 #include "knot/query/requestor.h"
 #include "knot/server/server.h"
 #include "knot/zone/zone.h"
+#include "knot/zone/zonedb.h"
 #include "libknot/errcode.h"
 
+/*! \brief Sibling zone whose DS push is merged into the UPDATE of another zone. */
+typedef struct {
+	knot_dname_t *zone;
+	knot_rrset_t *new_ds;
+	time_t due;      // Time of the DS push event being replaced.
+	bool included;   // Included in the last sent UPDATE.
+	bool sent;       // Successfully pushed to the current remote.
+	bool ok;         // Successfully pushed to all the remotes.
+} ds_push_sibling_t;
+
 struct ds_push_data {
 	const knot_dname_t *zone;
 	const knot_dname_t *parent_query;
@@ -32,9 +44,12 @@ struct ds_push_data {
 	knot_rrset_t new_ds;
 	const conf_remote_t *remote;
 	query_edns_data_t edns;
+	ds_push_sibling_t *siblings;
+	size_t sibling_count;
 };
 
 #define DS_PUSH_RETRY	600
+#define DS_PUSH_MERGE_MAX	64 // Maximal number of sibling zones merged into one UPDATE.
 
 #define DS_PUSH_LOG(priority, zone, remote, flags, fmt, ...) \
 	ns_log(priority, zone, LOG_OPERATION_DS_PUSH, LOG_DIRECTION_OUT, &(remote)->addr, \
@@ -65,6 +80,25 @@ static int parent_soa_produce(struct ds_push_data *data, knot_pkt_t *pkt)
 	return KNOT_STATE_CONSUME;
 }
 
+static int put_ds_change(knot_pkt_t *pkt, const knot_rrset_t *del_old_ds,
+                         const knot_rrset_t *new_ds)
+{
+	assert(del_old_ds->type == KNOT_RRTYPE_DS);
+	int ret = knot_pkt_put(pkt, KNOT_COMPR_HINT_NONE, del_old_ds, 0);
+	if (ret != KNOT_EOK) {
+		return ret;
+	}
+
+	assert(new_ds->type == KNOT_RRTYPE_DS);
+	assert(!knot_rrset_empty(new_ds));
+	if (knot_rdata_cmp(new_ds->rrs.rdata, &remove_cds) != 0) {
+		// Otherwise only remove DS - it was a special "remove CDS".
+		ret = knot_pkt_put(pkt, KNOT_COMPR_HINT_NONE, new_ds, 0);
+	}
+
+	return ret;
+}
+
 static int ds_push_produce(knot_layer_t *layer, knot_pkt_t *pkt)
 {
 	struct ds_push_data *data = layer->data;
@@ -83,20 +117,27 @@ static int ds_push_produce(knot_layer_t *layer, knot_pkt_t *pkt)
 
 	knot_pkt_begin(pkt, KNOT_AUTHORITY);
 
-	assert(data->del_old_ds.type == KNOT_RRTYPE_DS);
-	ret = knot_pkt_put(pkt, KNOT_COMPR_HINT_NONE, &data->del_old_ds, 0);
+	ret = put_ds_change(pkt, &data->del_old_ds, &data->new_ds);
 	if (ret != KNOT_EOK) {
 		return KNOT_STATE_FAIL;
 	}
 
-	assert(data->new_ds.type == KNOT_RRTYPE_DS);
-	assert(!knot_rrset_empty(&data->new_ds));
-	if (knot_rdata_cmp(data->new_ds.rrs.rdata, &remove_cds) != 0) {
-		// Otherwise only remove DS - it was a special "remove CDS".
-		ret = knot_pkt_put(pkt, KNOT_COMPR_HINT_NONE, &data->new_ds, 0);
+	// The siblings can be merged only if they are in the same parent zone.
+	bool merge = knot_dname_is_equal(knot_dname_next_label(data->zone), data->parent_soa);
+	for (size_t i = 0; i < data->sibling_count; i++) {
+		ds_push_sibling_t *sib = &data->siblings[i];
+		sib->included = false;
+		if (!merge) {
+			continue;
+		}
+
+		knot_rrset_t del_old_ds = data->del_old_ds;
+		del_old_ds.owner = sib->zone;
+		ret = put_ds_change(pkt, &del_old_ds, sib->new_ds);
 		if (ret != KNOT_EOK) {
 			return KNOT_STATE_FAIL;
 		}
+		sib->included = true;
 	}
 
 	return KNOT_STATE_CONSUME;
@@ -160,8 +201,8 @@ static const knot_layer_api_t DS_PUSH_API = {
 	.finish = ds_push_finish,
 };
 
-static int send_ds_push(conf_t *conf, zone_t *zone,
-                        const conf_remote_t *parent, int timeout)
+static int send_ds_push(conf_t *conf, zone_t *zone, const conf_remote_t *parent,
+                        ds_push_sibling_t *siblings, size_t sibling_count, int timeout)
 {
 	knot_rrset_t zone_cds = node_rrset(zone->contents->apex, KNOT_RRTYPE_CDS);
 	if (knot_rrset_empty(&zone_cds)) {
@@ -175,7 +216,9 @@ static int send_ds_push(conf_t *conf, zone_t *zone,
 		.parent_query = zone->name,
 		.new_ds = zone_cds,
 		.remote = parent,
-		.edns = query_edns_data_init(conf, parent, 0)
+		.edns = query_edns_data_init(conf, parent, 0),
+		.siblings = siblings,
+		.sibling_count = sibling_count,
 	};
 
 	knot_rrset_init(&data.del_old_ds, zone->name, KNOT_RRTYPE_DS, KNOT_CLASS_ANY, 0);
@@ -207,6 +250,13 @@ static int send_ds_push(conf_t *conf, zone_t *zone,
 	if (ret == KNOT_EOK && knot_pkt_ext_rcode(req->resp) == 0) {
 		DS_PUSH_LOG(LOG_INFO, zone->name, parent, requestor.layer.flags,
 		            "success");
+		for (size_t i = 0; i < sibling_count; i++) {
+			if (siblings[i].included) {
+				DS_PUSH_LOG(LOG_INFO, siblings[i].zone, parent,
+				            requestor.layer.flags, "success, merged");
+				siblings[i].sent = true;
+			}
+		}
 	} else if (knot_pkt_ext_rcode(req->resp) == 0) {
 		DS_PUSH_LOG(LOG_WARNING, zone->name, parent, requestor.layer.flags,
 		            "failed (%s)", knot_strerror(ret));
@@ -216,6 +266,13 @@ static int send_ds_push(conf_t *conf, zone_t *zone,
 		            knot_pkt_ext_rcode_name(req->resp));
 	}
 
+	for (size_t i = 0; i < sibling_count; i++) {
+		if (siblings[i].included && ret == KNOT_EOK && knot_pkt_ext_rcode(req->resp) != 0) {
+			ret = KNOT_EDENIED; // Let the zone be retried alone.
+			break;
+		}
+	}
+
 	knot_rdataset_clear(&data.del_old_ds.rrs, NULL);
 	knot_request_free(req, NULL);
 	knot_requestor_clear(&requestor);
@@ -223,6 +280,130 @@ static int send_ds_push(conf_t *conf, zone_t *zone,
 	return ret;
 }
 
+static conf_val_t ds_push_conf(conf_t *conf, const knot_dname_t *zone)
+{
+	conf_val_t ds_push = conf_zone_get(conf, C_DS_PUSH, zone);
+	if (ds_push.code != KNOT_EOK) {
+		conf_val_t policy_id = conf_zone_get(conf, C_DNSSEC_POLICY, zone);
+		conf_id_fix_default(&policy_id);
+		ds_push = conf_id_get(conf, C_POLICY, C_DS_PUSH, &policy_id);
+	}
+	return ds_push;
+}
+
+static knot_rrset_t *zone_new_ds(const zone_contents_t *contents)
+{
+	knot_rrset_t cds = node_rrset(contents->apex, KNOT_RRTYPE_CDS);
+	if (knot_rrset_empty(&cds)) {
+		return NULL;
+	}
+	cds.type = KNOT_RRTYPE_DS;
+	cds.ttl = node_rrset(contents->apex, KNOT_RRTYPE_DNSKEY).ttl;
+
+	return knot_rrset_copy(&cds, NULL);
+}
+
+static void siblings_free(ds_push_sibling_t *siblings, size_t count)
+{
+	for (size_t i = 0; i < count; i++) {
+		knot_dname_free(siblings[i].zone, NULL);
+		knot_rrset_free(siblings[i].new_ds, NULL);
+	}
+	free(siblings);
+}
+
+/*!
+ * Collects the zones under the same parent which are due for DS push to the same
+ * remotes, so that their DS changes are sent within one UPDATE message.
+ */
+static size_t collect_siblings(conf_t *conf, zone_t *zone, conf_val_t *ds_push,
+                               ds_push_sibling_t **siblings)
+{
+	*siblings = NULL;
+	if (zone->name[0] == '\0') {
+		return 0;
+	}
+	const knot_dname_t *parent = knot_dname_next_label(zone->name);
+
+	ds_push_sibling_t *sibs = calloc(DS_PUSH_MERGE_MAX, sizeof(*sibs));
+	if (sibs == NULL) {
+		return 0;
+	}
+
+	time_t now = time(NULL);
+	size_t count = 0;
+
+	rcu_read_lock();
+	knot_zonedb_iter_t *it = knot_zonedb_iter_begin(zone->server->zone_db);
+	while (!knot_zonedb_iter_finished(it) && count < DS_PUSH_MERGE_MAX) {
+		zone_t *sib = (zone_t *)knot_zonedb_iter_val(it);
+		knot_zonedb_iter_next(it);
+
+		time_t due = zone_events_get_time(sib, ZONE_EVENT_DS_PUSH);
+		if (sib == zone || due <= 0 || due > now || sib->name[0] == '\0' ||
+		    !knot_dname_is_equal(knot_dname_next_label(sib->name), parent)) {
+			continue;
+		}
+
+		conf_val_t sib_ds_push = ds_push_conf(conf, sib->name);
+		zone_contents_t *contents = sib->contents;
+		if (!conf_val_equal(ds_push, &sib_ds_push) ||
+		    zone_contents_is_empty(contents)) {
+			continue;
+		}
+
+		knot_rrset_t *new_ds = zone_new_ds(contents);
+		knot_dname_t *name = knot_dname_copy(sib->name, NULL);
+		if (new_ds == NULL || name == NULL) {
+			knot_rrset_free(new_ds, NULL);
+			knot_dname_free(name, NULL);
+			continue;
+		}
+
+		sibs[count++] = (ds_push_sibling_t) {
+			.zone = name,
+			.new_ds = new_ds,
+			.due = due,
+			.ok = true,
+		};
+	}
+	knot_zonedb_iter_free(it);
+	rcu_read_unlock();
+
+	if (count == 0) {
+		free(sibs);
+	} else {
+		*siblings = sibs;
+	}
+	return count;
+}
+
+/*!
+ * Cancels the DS push of the siblings pushed to all the remotes, unless their
+ * CDS has changed meanwhile.
+ */
+static void finish_siblings(zone_t *zone, ds_push_sibling_t *siblings, size_t count)
+{
+	rcu_read_lock();
+	for (size_t i = 0; i < count; i++) {
+		ds_push_sibling_t *sib = &siblings[i];
+		zone_t *sib_zone = knot_zonedb_find(zone->server->zone_db, sib->zone);
+		if (!sib->ok || sib_zone == NULL ||
+		    zone_events_get_time(sib_zone, ZONE_EVENT_DS_PUSH) != sib->due) {
+			continue;
+		}
+
+		zone_contents_t *contents = sib_zone->contents;
+		knot_rrset_t *new_ds = zone_contents_is_empty(contents) ? NULL : zone_new_ds(contents);
+		if (new_ds != NULL && knot_rrset_equal(new_ds, sib->new_ds, true)) {
+			zone_events_schedule_at(sib_zone, ZONE_EVENT_DS_PUSH, (time_t)0);
+			sib_zone->timers.next_ds_push = 0;
+		}
+		knot_rrset_free(new_ds, NULL);
+	}
+	rcu_read_unlock();
+}
+
 int event_ds_push(conf_t *conf, zone_t *zone)
 {
 	assert(zone);
@@ -233,12 +414,11 @@ int event_ds_push(conf_t *conf, zone_t *zone)
 
 	int timeout = conf->cache.srv_tcp_remote_io_timeout;
 
-	conf_val_t ds_push = conf_zone_get(conf, C_DS_PUSH, zone->name);
-	if (ds_push.code != KNOT_EOK) {
-		conf_val_t policy_id = conf_zone_get(conf, C_DNSSEC_POLICY, zone->name);
-		conf_id_fix_default(&policy_id);
-		ds_push = conf_id_get(conf, C_POLICY, C_DS_PUSH, &policy_id);
-	}
+	conf_val_t ds_push = ds_push_conf(conf, zone->name);
+
+	ds_push_sibling_t *siblings = NULL;
+	size_t sibling_count = collect_siblings(conf, zone, &ds_push, &siblings);
+
 	conf_mix_iter_t iter;
 	conf_mix_iter_init(conf, &ds_push, &iter);
 	while (iter.id->code == KNOT_EOK) {
@@ -248,13 +428,22 @@ int event_ds_push(conf_t *conf, zone_t *zone)
 		int ret = KNOT_EOK;
 		for (int i = 0; i < addr_count; i++) {
 			conf_remote_t parent = conf_remote(conf, iter.id, i);
-			ret = send_ds_push(conf, zone, &parent, timeout);
+			ret = send_ds_push(conf, zone, &parent, siblings, sibling_count, timeout);
+			if (ret != KNOT_EOK && sibling_count > 0) {
+				// The parent may refuse the merged UPDATE, try the zone alone.
+				ret = send_ds_push(conf, zone, &parent, NULL, 0, timeout);
+			}
 			if (ret == KNOT_EOK) {
 				zone->timers.next_ds_push = 0;
 				break;
 			}
 		}
 
+		for (size_t i = 0; i < sibling_count; i++) {
+			siblings[i].ok = siblings[i].ok && siblings[i].sent;
+			siblings[i].sent = false;
+		}
+
 		if (ret != KNOT_EOK) {
 			time_t next_push = time(NULL) + DS_PUSH_RETRY;
 			zone_events_schedule_at(zone, ZONE_EVENT_DS_PUSH, next_push);
@@ -264,5 +453,8 @@ int event_ds_push(conf_t *conf, zone_t *zone)
 		conf_mix_iter_next(&iter);
 	}
 
+	finish_siblings(zone, siblings, sibling_count);
+	siblings_free(siblings, sibling_count);
+
 	return KNOT_EOK;
 }
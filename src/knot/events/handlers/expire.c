@@ -18,12 +18,19 @@
 #include <urcu.h>
 
 #include "knot/common/log.h"
+#include "knot/common/reclaim.h"
 #include "knot/conf/conf.h"
 #include "knot/events/handlers.h"
 #include "knot/events/replan.h"
 #include "knot/zone/contents.h"
 #include "knot/zone/zone.h"
 
+// UBSAN type punning workaround
+static void zone_contents_deep_free_wrap(void *contents)
+{
+	zone_contents_deep_free((zone_contents_t *)contents);
+}
+
 int event_expire(conf_t *conf, zone_t *zone)
 {
 	assert(zone);
@@ -31,14 +38,13 @@ int event_expire(conf_t *conf, zone_t *zone)
 	zone_contents_t *expired = zone_switch_contents(zone, NULL);
 	log_zone_info(zone->name, "zone expired");
 
-	synchronize_rcu();
-
 	pthread_mutex_lock(&zone->cu_lock);
 	zone_control_clear(zone);
 	pthread_mutex_unlock(&zone->cu_lock);
 
+	/* Free the contents in the background once no update uses them. */
 	knot_sem_wait(&zone->cow_lock);
-	zone_contents_deep_free(expired);
+	knot_reclaim_defer(global_reclaim, zone_contents_deep_free_wrap, expired);
 	knot_sem_post(&zone->cow_lock);
 
 	zone->zonefile.exists = false;
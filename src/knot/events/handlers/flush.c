@@ -29,5 +29,5 @@ int event_flush(conf_t *conf, zone_t *zone)
 		return KNOT_EOK;
 	}
 
-	return zone_flush_journal(conf, zone, true);
+	return zone_flush_journal_bg(conf, zone);
 }
@@ -118,7 +118,8 @@ int event_load(conf_t *conf, zone_t *zone)
 				}
 			}
 
-			ret = zone_load_contents(conf, zone->name, &zf_conts, mode, false);
+			ret = zone_load_contents(conf, zone->name, &zf_conts, mode, false,
+			                         zone_kaspdb(zone));
 		}
 		if (ret != KNOT_EOK) {
 			assert(!zf_conts);
@@ -425,12 +426,17 @@ load_end:
 		zone_schedule_notify(zone, 0);
 	}
 
+	ATOMIC_SET(zone->lazy.pending, false);
+
 	return KNOT_EOK;
 
 cleanup:
 	// Try to bootstrap the zone if local error.
 	replan_from_timers(conf, zone);
 
+	// Lazily loaded zone is retried upon another query.
+	ATOMIC_SET(zone->lazy.pending, false);
+
 	zone_update_clear(&up);
 	zone_contents_deep_free(zf_conts);
 	zone_contents_deep_free(journal_conts);
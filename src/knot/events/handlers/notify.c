@@ -15,11 +15,15 @@
  */
 
 #include <assert.h>
+#include <pthread.h>
+#include <stdlib.h>
 #include <urcu.h>
 
 #include "contrib/openbsd/siphash.h"
 #include "knot/common/log.h"
 #include "knot/conf/conf.h"
+#include "knot/events/handlers.h"
+#include "knot/query/async-requestor.h"
 #include "knot/query/query.h"
 #include "knot/query/requestor.h"
 #include "knot/server/server.h"
@@ -87,57 +91,174 @@ static const knot_layer_api_t NOTIFY_API = {
 	       flags2proto(flags), ((flags) & KNOT_REQUESTOR_REUSED), (remote)->key.name, \
 	       fmt, ## __VA_ARGS__)
 
-static int send_notify(conf_t *conf, zone_t *zone, const knot_rrset_t *soa,
-                       const conf_remote_t *slave, int timeout, bool retry)
+/*! \brief One NOTIFY to one remote address. */
+typedef struct {
+	struct notify_data data;
+	conf_remote_t slave;
+	knot_requestor_t requestor;
+	knot_request_t *req;
+	struct notify_wait *wait;
+	int ret;
+} notify_job_t;
+
+/*! \brief Completion counter of concurrently sent NOTIFYs. */
+typedef struct notify_wait {
+	pthread_mutex_t mx;
+	pthread_cond_t cond;
+	size_t pending;
+} notify_wait_t;
+
+/*! \brief Remote to be notified, on any of its addresses. */
+typedef struct {
+	conf_val_t id;
+	notifailed_rmt_hash hash;
+	size_t addr_count;
+	int ret;
+} notify_rmt_t;
+
+static int notify_job_init(conf_t *conf, zone_t *zone, const knot_rrset_t *soa,
+                           conf_val_t *id, size_t addr_idx, notify_job_t *job)
 {
-	struct notify_data data = {
+	job->slave = conf_remote(conf, id, addr_idx);
+	job->data = (struct notify_data) {
 		.zone = zone->name,
 		.soa = soa,
-		.remote = slave,
-		.edns = query_edns_data_init(conf, slave, 0)
+		.remote = &job->slave,
+		.edns = query_edns_data_init(conf, &job->slave, 0)
 	};
 
-	knot_requestor_t requestor;
-	knot_requestor_init(&requestor, &NOTIFY_API, &data, NULL);
+	knot_requestor_init(&job->requestor, &NOTIFY_API, &job->data, NULL);
 
 	knot_pkt_t *pkt = knot_pkt_new(NULL, KNOT_WIRE_MAX_PKTSIZE, NULL);
 	if (pkt == NULL) {
-		knot_requestor_clear(&requestor);
+		knot_requestor_clear(&job->requestor);
 		return KNOT_ENOMEM;
 	}
 
 	knot_request_flag_t flags = conf->cache.srv_tcp_fastopen ? KNOT_REQUEST_TFO : 0;
-	knot_request_t *req = knot_request_make(NULL, slave, pkt,
-	                                        zone->server->quic_creds, &data.edns, flags);
-	if (req == NULL) {
-		knot_requestor_clear(&requestor);
+	job->req = knot_request_make(NULL, &job->slave, pkt,
+	                             zone->server->quic_creds, &job->data.edns, flags);
+	if (job->req == NULL) {
+		knot_requestor_clear(&job->requestor);
 		return KNOT_ENOMEM;
 	}
 
-	int ret = knot_requestor_exec(&requestor, req, timeout);
+	return KNOT_EOK;
+}
+
+static void notify_job_finish(zone_t *zone, const knot_rrset_t *soa,
+                              notify_job_t *job, bool retry)
+{
+	const conf_remote_t *slave = &job->slave;
+	knot_request_t *req = job->req;
+	int ret = job->ret;
 
 	const char *log_retry = retry ? "retry, " : "";
 
 	if (ret == KNOT_EOK && knot_pkt_ext_rcode(req->resp) == 0) {
 		NOTIFY_OUT_LOG(LOG_INFO, zone->name, slave,
-		               requestor.layer.flags,
+		               job->requestor.layer.flags,
 		               "%sserial %u", log_retry, knot_soa_serial(soa->rrs.rdata));
 		zone->timers.last_notified_serial = (knot_soa_serial(soa->rrs.rdata) | LAST_NOTIFIED_SERIAL_VALID);
 	} else if (knot_pkt_ext_rcode(req->resp) == 0) {
 		NOTIFY_OUT_LOG(LOG_WARNING, zone->name, slave,
-		               requestor.layer.flags,
+		               job->requestor.layer.flags,
 		               "%sfailed (%s)", log_retry, knot_strerror(ret));
 	} else {
 		NOTIFY_OUT_LOG(LOG_WARNING, zone->name, slave,
-		               requestor.layer.flags,
+		               job->requestor.layer.flags,
 		               "%sserver responded with error '%s'",
 		               log_retry, knot_pkt_ext_rcode_name(req->resp));
 	}
 
 	knot_request_free(req, NULL);
-	knot_requestor_clear(&requestor);
+	knot_requestor_clear(&job->requestor);
+}
+
+static void notify_job_done(knot_requestor_t *requestor, knot_request_t *req,
+                            int ret, void *ctx)
+{
+	notify_job_t *job = ctx;
+	job->ret = ret;
+
+	pthread_mutex_lock(&job->wait->mx);
+	job->wait->pending--;
+	pthread_cond_signal(&job->wait->cond);
+	pthread_mutex_unlock(&job->wait->mx);
+}
+
+/*!
+ * \brief Send NOTIFY to the i-th address of each not yet notified remote.
+ *
+ * The messages are processed concurrently by the server requests loop if
+ * possible, so that an unresponsive remote doesn't delay the others.
+ */
+static void notify_round(conf_t *conf, zone_t *zone, const knot_rrset_t *soa,
+                         notify_rmt_t *rmts, size_t count, size_t addr_idx,
+                         int timeout, bool retry)
+{
+	notify_job_t *jobs = calloc(count, sizeof(*jobs));
+	if (jobs == NULL) {
+		return; // Keeps the previous results.
+	}
+
+	notify_wait_t wait = { .pending = 0 };
+	pthread_mutex_init(&wait.mx, NULL);
+	pthread_cond_init(&wait.cond, NULL);
+
+	for (size_t i = 0; i < count; i++) {
+		notify_job_t *job = &jobs[i];
+		if (rmts[i].ret == KNOT_EOK || addr_idx >= rmts[i].addr_count) {
+			continue;
+		}
+		rmts[i].ret = notify_job_init(conf, zone, soa, &rmts[i].id, addr_idx, job);
+		if (rmts[i].ret != KNOT_EOK) {
+			continue;
+		}
+		job->wait = &wait;
+
+		pthread_mutex_lock(&wait.mx);
+		wait.pending++;
+		pthread_mutex_unlock(&wait.mx);
+
+		int ret = knot_areq_exec(zone->server->areq_loop, &job->requestor,
+		                         job->req, timeout, notify_job_done, job);
+		if (ret != KNOT_EOK) { // Unsupported protocol or no loop.
+			ret = knot_requestor_exec(&job->requestor, job->req, timeout);
+			notify_job_done(&job->requestor, job->req, ret, job);
+		}
+	}
+
+	pthread_mutex_lock(&wait.mx);
+	while (wait.pending > 0) {
+		pthread_cond_wait(&wait.cond, &wait.mx);
+	}
+	pthread_mutex_unlock(&wait.mx);
+
+	for (size_t i = 0; i < count; i++) {
+		if (jobs[i].req != NULL) {
+			notify_job_finish(zone, soa, &jobs[i], retry);
+			rmts[i].ret = jobs[i].ret;
+		}
+	}
+
+	pthread_cond_destroy(&wait.cond);
+	pthread_mutex_destroy(&wait.mx);
+	free(jobs);
+}
 
-	return ret;
+/*! \brief Schedule NOTIFY to the failed remotes, preferred_lock must be held. */
+static void schedule_retry(conf_t *conf, zone_t *zone, const knot_rrset_t *soa)
+{
+	notifailed_rmt_dynarray_sort_dedup(&zone->notifailed);
+
+	uint32_t retry_in = knot_soa_retry(soa->rrs.rdata);
+	conf_val_t val = conf_zone_get(conf, C_RETRY_MIN_INTERVAL, zone->name);
+	retry_in = MAX(retry_in, conf_int(&val));
+	val = conf_zone_get(conf, C_RETRY_MAX_INTERVAL, zone->name);
+	retry_in = MIN(retry_in, conf_int(&val));
+
+	zone_events_schedule_at(zone, ZONE_EVENT_NOTIFY, time(NULL) + retry_in);
 }
 
 int event_notify(conf_t *conf, zone_t *zone)
@@ -164,7 +285,9 @@ int event_notify(conf_t *conf, zone_t *zone)
 	pthread_mutex_lock(&zone->preferred_lock);
 	bool retry = (zone->notifailed.size > 0);
 
-	// send NOTIFY to each remote, use working address
+	notify_rmt_t *rmts = NULL;
+	size_t count = 0, max_addrs = 0;
+
 	conf_val_t notify = conf_zone_get(conf, C_NOTIFY, zone->name);
 	conf_mix_iter_t iter;
 	conf_mix_iter_init(conf, &notify, &iter);
@@ -174,45 +297,91 @@ int event_notify(conf_t *conf, zone_t *zone)
 			conf_mix_iter_next(&iter);
 			continue;
 		}
-		pthread_mutex_unlock(&zone->preferred_lock);
+
+		notify_rmt_t *tmp = realloc(rmts, (count + 1) * sizeof(*rmts));
+		if (tmp == NULL) {
+			pthread_mutex_unlock(&zone->preferred_lock);
+			free(rmts);
+			knot_rrset_free(soa_cpy, NULL);
+			return KNOT_ENOMEM;
+		}
+		rmts = tmp;
 
 		conf_val_t addr = conf_id_get(conf, C_RMT, C_ADDR, iter.id);
-		size_t addr_count = conf_val_count(&addr);
+		if (conf_val_count(&addr) > 0 &&
+		    notify_batch_send(zone->server->notify_batch, conf, soa_cpy, iter.id,
+		                      rmt_hash, timeout, retry) == KNOT_EOK) {
+			conf_mix_iter_next(&iter); // Result processed by event_notify_result().
+			continue;
+		}
 
-		int ret = KNOT_EOK;
+		rmts[count] = (notify_rmt_t) {
+			.id = *iter.id,
+			.hash = rmt_hash,
+			.addr_count = conf_val_count(&addr),
+		};
+		rmts[count].ret = (rmts[count].addr_count > 0) ? KNOT_ERROR : KNOT_EOK;
+		max_addrs = MAX(max_addrs, rmts[count].addr_count);
+		count++;
 
-		for (int i = 0; i < addr_count; i++) {
-			conf_remote_t slave = conf_remote(conf, iter.id, i);
-			ret = send_notify(conf, zone, soa_cpy, &slave, timeout, retry);
-			if (ret == KNOT_EOK) {
-				break;
-			}
-		}
+		conf_mix_iter_next(&iter);
+	}
+	pthread_mutex_unlock(&zone->preferred_lock);
 
-		pthread_mutex_lock(&zone->preferred_lock);
-		if (ret != KNOT_EOK) {
+	// send NOTIFY to each remote at once, next address only if failed
+	for (size_t i = 0; i < max_addrs; i++) {
+		notify_round(conf, zone, soa_cpy, rmts, count, i, timeout, retry);
+	}
+
+	pthread_mutex_lock(&zone->preferred_lock);
+	for (size_t i = 0; i < count; i++) {
+		if (rmts[i].ret != KNOT_EOK) {
 			failed = true;
-			notifailed_rmt_dynarray_add(&zone->notifailed, &rmt_hash);
+			notifailed_rmt_dynarray_add(&zone->notifailed, &rmts[i].hash);
 		} else {
-			notifailed_rmt_dynarray_remove(&zone->notifailed, &rmt_hash);
+			notifailed_rmt_dynarray_remove(&zone->notifailed, &rmts[i].hash);
 		}
-
-		conf_mix_iter_next(&iter);
 	}
+	free(rmts);
 
 	if (failed) {
-		notifailed_rmt_dynarray_sort_dedup(&zone->notifailed);
-
-		uint32_t retry_in = knot_soa_retry(soa_cpy->rrs.rdata);
-		conf_val_t val = conf_zone_get(conf, C_RETRY_MIN_INTERVAL, zone->name);
-		retry_in = MAX(retry_in, conf_int(&val));
-		val = conf_zone_get(conf, C_RETRY_MAX_INTERVAL, zone->name);
-		retry_in = MIN(retry_in, conf_int(&val));
-
-		zone_events_schedule_at(zone, ZONE_EVENT_NOTIFY, time(NULL) + retry_in);
+		schedule_retry(conf, zone, soa_cpy);
 	}
 	pthread_mutex_unlock(&zone->preferred_lock);
 	knot_rrset_free(soa_cpy, NULL);
 
 	return failed ? KNOT_ERROR : KNOT_EOK;
 }
+
+void event_notify_result(conf_t *conf, zone_t *zone, const conf_remote_t *remote,
+                         notifailed_rmt_hash hash, const knot_rrset_t *soa,
+                         bool retry, int ret, int rcode)
+{
+	const char *log_retry = retry ? "retry, " : "";
+
+	if (ret == KNOT_EOK) {
+		ns_log(LOG_INFO, zone->name, LOG_OPERATION_NOTIFY, LOG_DIRECTION_OUT,
+		       &remote->addr, KNOTD_QUERY_PROTO_UDP, false, remote->key.name,
+		       "%sserial %u", log_retry, knot_soa_serial(soa->rrs.rdata));
+		zone->timers.last_notified_serial = (knot_soa_serial(soa->rrs.rdata) | LAST_NOTIFIED_SERIAL_VALID);
+	} else if (rcode == KNOT_RCODE_NOERROR) {
+		ns_log(LOG_WARNING, zone->name, LOG_OPERATION_NOTIFY, LOG_DIRECTION_OUT,
+		       &remote->addr, KNOTD_QUERY_PROTO_UDP, false, remote->key.name,
+		       "%sfailed (%s)", log_retry, knot_strerror(ret));
+	} else {
+		const knot_lookup_t *item = knot_lookup_by_id(knot_rcode_names, rcode);
+		ns_log(LOG_WARNING, zone->name, LOG_OPERATION_NOTIFY, LOG_DIRECTION_OUT,
+		       &remote->addr, KNOTD_QUERY_PROTO_UDP, false, remote->key.name,
+		       "%sserver responded with error '%s'", log_retry,
+		       item != NULL ? item->name : "unknown RCODE");
+	}
+
+	pthread_mutex_lock(&zone->preferred_lock);
+	if (ret != KNOT_EOK) {
+		notifailed_rmt_dynarray_add(&zone->notifailed, &hash);
+		schedule_retry(conf, zone, soa);
+	} else {
+		notifailed_rmt_dynarray_remove(&zone->notifailed, &hash);
+	}
+	pthread_mutex_unlock(&zone->preferred_lock);
+}
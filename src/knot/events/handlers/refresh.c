@@ -15,7 +15,10 @@
  */
 
 #include <assert.h>
+#include <pthread.h>
 #include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
 #include <urcu.h>
 
 #include "contrib/mempattern.h"
@@ -35,6 +38,7 @@
 #include "knot/zone/digest.h"
 #include "knot/zone/serial.h"
 #include "knot/zone/zone.h"
+#include "knot/zone/zone-diff.h"
 #include "knot/zone/zonefile.h"
 #include "libknot/errcode.h"
 
@@ -132,6 +136,11 @@ struct refresh_data {
 
 	struct {
 		zone_contents_t *zone;    //!< AXFR result, new zone.
+		zcreator_t creator;       //!< Insertion of records into the new zone.
+		zone_diff_stream_t *diff; //!< Or comparison with the current zone.
+		changeset_t *changes;     //!< Result of the comparison.
+		struct axfr_pipe *pipe;   //!< Background insertion of received records.
+		bool soa_seen;            //!< Initial SOA already received.
 	} axfr;
 
 	struct {
@@ -226,6 +235,8 @@ static void finalize_timers_base(struct refresh_data *data, bool also_expire)
 	uint32_t soa_refresh = knot_soa_refresh(soa->rdata);
 	limit_timer(conf, zone->name, &soa_refresh, "refresh",
 	            C_REFRESH_MIN_INTERVAL, C_REFRESH_MAX_INTERVAL);
+	conf_val_t val = conf_zone_get(conf, C_REFRESH_MIN_INTERVAL, zone->name);
+	soa_refresh = replan_jitter(conf, zone->name, soa_refresh, conf_int(&val));
 	zone->timers.next_refresh = now + soa_refresh;
 	zone->timers.last_refresh_ok = true;
 
@@ -295,31 +306,252 @@ static void xfr_log_read_ms(const knot_dname_t *zone, int ret)
 	log_zone_error(zone, "failed reading master serial from KASP DB (%s)", knot_strerror(ret));
 }
 
+/*! \brief Maximal number of received packets waiting for insertion. */
+#define AXFR_PIPE_MAX_QUEUED 256
+
+/*! \brief Received AXFR packet waiting for insertion. */
+typedef struct axfr_chunk {
+	struct axfr_chunk *next;
+	uint16_t count;           //!< Number of answer records to be inserted.
+	size_t size;
+	uint8_t wire[];
+} axfr_chunk_t;
+
+/*!
+ * \brief Background insertion of received records into the new zone.
+ *
+ * The requestor loop only checks the received packets and queues copies
+ * of them, the records are parsed and inserted by a dedicated thread.
+ */
+typedef struct axfr_pipe {
+	pthread_t thread;
+	pthread_mutex_t mx;
+	pthread_cond_t cond;      //!< Signalled upon any queue change.
+	axfr_chunk_t *head;
+	axfr_chunk_t *tail;
+	size_t queued;
+	bool finished;            //!< No more packets will be queued.
+	int ret;                  //!< Insertion error.
+	struct refresh_data *data;
+} axfr_pipe_t;
+
+static int axfr_insert_rr(struct refresh_data *data, const knot_rrset_t *rr)
+{
+	if (data->axfr.diff != NULL) {
+		return zone_diff_stream_add(data->axfr.diff, rr);
+	}
+
+	return zcreator_step(&data->axfr.creator, rr);
+}
+
+static int axfr_insert_chunk(struct refresh_data *data, axfr_chunk_t *chunk)
+{
+	knot_pkt_t *pkt = knot_pkt_new(chunk->wire, chunk->size, NULL);
+	if (pkt == NULL) {
+		return KNOT_ENOMEM;
+	}
+
+	int ret = knot_pkt_parse(pkt, 0);
+	const knot_pktsection_t *answer = knot_pkt_section(pkt, KNOT_ANSWER);
+	for (uint16_t i = 0; i < chunk->count && ret == KNOT_EOK; ++i) {
+		ret = axfr_insert_rr(data, knot_pkt_rr(answer, i));
+	}
+
+	knot_pkt_free(pkt);
+
+	return ret;
+}
+
+static void *axfr_pipe_thread(void *arg)
+{
+	axfr_pipe_t *pipe = arg;
+
+	pthread_mutex_lock(&pipe->mx);
+	while (true) {
+		while (pipe->head == NULL && !pipe->finished) {
+			pthread_cond_wait(&pipe->cond, &pipe->mx);
+		}
+		axfr_chunk_t *chunk = pipe->head;
+		if (chunk == NULL) {
+			break; // Finished and drained.
+		}
+		pipe->head = chunk->next;
+		if (pipe->head == NULL) {
+			pipe->tail = NULL;
+		}
+		pipe->queued--;
+		pthread_cond_signal(&pipe->cond);
+
+		int ret = pipe->ret;
+		pthread_mutex_unlock(&pipe->mx);
+
+		if (ret == KNOT_EOK) {
+			ret = axfr_insert_chunk(pipe->data, chunk);
+		}
+		free(chunk);
+
+		pthread_mutex_lock(&pipe->mx);
+		if (pipe->ret == KNOT_EOK) {
+			pipe->ret = ret;
+		}
+	}
+	pthread_mutex_unlock(&pipe->mx);
+
+	return NULL;
+}
+
+static axfr_pipe_t *axfr_pipe_start(struct refresh_data *data)
+{
+	axfr_pipe_t *pipe = calloc(1, sizeof(*pipe));
+	if (pipe == NULL) {
+		return NULL;
+	}
+
+	pthread_mutex_init(&pipe->mx, NULL);
+	pthread_cond_init(&pipe->cond, NULL);
+	pipe->data = data;
+
+	if (pthread_create(&pipe->thread, NULL, axfr_pipe_thread, pipe) != 0) {
+		pthread_cond_destroy(&pipe->cond);
+		pthread_mutex_destroy(&pipe->mx);
+		free(pipe);
+		return NULL;
+	}
+
+	return pipe;
+}
+
+static int axfr_pipe_push(axfr_pipe_t *pipe, const knot_pkt_t *pkt, uint16_t count)
+{
+	axfr_chunk_t *chunk = malloc(sizeof(*chunk) + pkt->size);
+	if (chunk == NULL) {
+		return KNOT_ENOMEM;
+	}
+	chunk->next = NULL;
+	chunk->count = count;
+	chunk->size = pkt->size;
+	memcpy(chunk->wire, pkt->wire, pkt->size);
+
+	pthread_mutex_lock(&pipe->mx);
+	while (pipe->queued >= AXFR_PIPE_MAX_QUEUED && pipe->ret == KNOT_EOK) {
+		pthread_cond_wait(&pipe->cond, &pipe->mx);
+	}
+	int ret = pipe->ret;
+	if (ret == KNOT_EOK) {
+		if (pipe->tail != NULL) {
+			pipe->tail->next = chunk;
+		} else {
+			pipe->head = chunk;
+		}
+		pipe->tail = chunk;
+		pipe->queued++;
+		pthread_cond_signal(&pipe->cond);
+	} else {
+		free(chunk);
+	}
+	pthread_mutex_unlock(&pipe->mx);
+
+	return ret;
+}
+
+/*! \brief Wait for all the queued records to be inserted and stop the thread. */
+static int axfr_pipe_finish(axfr_pipe_t **pipe_ptr)
+{
+	axfr_pipe_t *pipe = *pipe_ptr;
+	if (pipe == NULL) {
+		return KNOT_EOK;
+	}
+	*pipe_ptr = NULL;
+
+	pthread_mutex_lock(&pipe->mx);
+	pipe->finished = true;
+	pthread_cond_signal(&pipe->cond);
+	pthread_mutex_unlock(&pipe->mx);
+
+	pthread_join(pipe->thread, NULL);
+
+	int ret = pipe->ret;
+
+	pthread_cond_destroy(&pipe->cond);
+	pthread_mutex_destroy(&pipe->mx);
+	free(pipe);
+
+	return ret;
+}
+
+static bool axfr_signed(struct refresh_data *data)
+{
+	conf_val_t val = conf_zone_get(data->conf, C_DNSSEC_SIGNING, data->zone->name);
+	return conf_bool(&val);
+}
+
 static int axfr_init(struct refresh_data *data)
 {
+	data->axfr.soa_seen = false;
+
+	// The differences are computed on the fly, without a second zone copy.
+	if (data->ixfr_from_axfr && data->axfr_style_ixfr && data->zone->contents != NULL) {
+		data->axfr.changes = changeset_new(data->zone->name);
+		if (data->axfr.changes == NULL) {
+			return KNOT_ENOMEM;
+		}
+		data->axfr.diff = zone_diff_stream_new(data->zone->contents, data->axfr.changes,
+		                                       axfr_signed(data), false);
+		if (data->axfr.diff == NULL) {
+			changeset_free(data->axfr.changes);
+			data->axfr.changes = NULL;
+			return KNOT_ENOMEM;
+		}
+		return KNOT_EOK;
+	}
+
 	zone_contents_t *new_zone = zone_contents_new(data->zone->name, true);
 	if (new_zone == NULL) {
 		return KNOT_ENOMEM;
 	}
 
+	conf_val_t val = conf_zone_get(data->conf, C_LOAD_ARENA, data->zone->name);
+	if (conf_bool(&val)) {
+		val = conf_zone_get(data->conf, C_LOAD_HUGEPAGES, data->zone->name);
+		if (zone_contents_use_arena(new_zone, conf_opt(&val)) != KNOT_EOK) {
+			zone_contents_deep_free(new_zone);
+			return KNOT_ENOMEM;
+		}
+	}
+
 	data->axfr.zone = new_zone;
+	data->axfr.creator = (zcreator_t) {
+		.z = new_zone,
+		.master = false,
+		.ret = KNOT_EOK
+	};
 	return KNOT_EOK;
 }
 
 static void axfr_cleanup(struct refresh_data *data)
 {
+	if (data->axfr.pipe != NULL) {
+		// Make the thread drop the remaining packets.
+		pthread_mutex_lock(&data->axfr.pipe->mx);
+		data->axfr.pipe->ret = KNOT_ECONNABORTED;
+		pthread_mutex_unlock(&data->axfr.pipe->mx);
+		(void)axfr_pipe_finish(&data->axfr.pipe);
+	}
+
+	zcreator_clear(&data->axfr.creator);
 	zone_contents_deep_free(data->axfr.zone);
 	data->axfr.zone = NULL;
+	zone_diff_stream_free(data->axfr.diff);
+	data->axfr.diff = NULL;
+	changeset_free(data->axfr.changes);
+	data->axfr.changes = NULL;
 }
 
-static void axfr_slave_sign_serial(zone_contents_t *new_contents, zone_t *zone,
-                                   conf_t *conf, uint32_t *master_serial)
+static uint32_t axfr_slave_sign_serial(zone_t *zone, conf_t *conf, uint32_t master_serial)
 {
 	// Update slave's serial to ensure it's growing and consistent with
 	// its serial policy.
 
-	*master_serial = zone_contents_serial(new_contents);
-
 	uint32_t new_serial, lastsigned_serial;
 	if (zone->contents != NULL) {
 		// Retransfer or AXFR-fallback - increment current serial.
@@ -330,28 +562,63 @@ static void axfr_slave_sign_serial(zone_contents_t *new_contents, zone_t *zone,
 		new_serial = serial_next(lastsigned_serial, conf, zone->name, SERIAL_POLICY_AUTO, 1);
 	} else {
 		// Bootstrap - try to reuse master serial, considering policy.
-		new_serial = serial_next(*master_serial, conf, zone->name, SERIAL_POLICY_AUTO, 0);
+		new_serial = serial_next(master_serial, conf, zone->name, SERIAL_POLICY_AUTO, 0);
+	}
+	return new_serial;
+}
+
+/*! \brief Complete the streamed comparison and start the update with it. */
+static int axfr_diff_update(struct refresh_data *data, zone_update_t *up,
+                            bool dnssec_enable, uint32_t *master_serial)
+{
+	knot_rrset_t *soa = zone_diff_stream_soa(data->axfr.diff);
+	if (soa == NULL) {
+		return KNOT_ESEMCHECK;
 	}
-	zone_contents_set_soa_serial(new_contents, new_serial);
+	if (dnssec_enable) {
+		*master_serial = knot_soa_serial(soa->rrs.rdata);
+		knot_soa_serial_set(soa->rrs.rdata,
+			axfr_slave_sign_serial(data->zone, data->conf, *master_serial));
+	}
+
+	int ret = zone_diff_stream_finish(data->axfr.diff);
+	if (ret != KNOT_EOK && ret != KNOT_ENODIFF) {
+		return ret;
+	}
+
+	ret = zone_update_init(up, data->zone, UPDATE_INCREMENTAL);
+	if (ret != KNOT_EOK) {
+		return ret;
+	}
+	ret = zone_update_apply_changeset(up, data->axfr.changes);
+	if (ret != KNOT_EOK) {
+		zone_update_clear(up);
+	}
+
+	return ret;
 }
 
 static int axfr_finalize(struct refresh_data *data)
 {
 	zone_contents_t *new_zone = data->axfr.zone;
 
-	conf_val_t val = conf_zone_get(data->conf, C_DNSSEC_SIGNING, data->zone->name);
-	bool dnssec_enable = conf_bool(&val);
+	bool dnssec_enable = axfr_signed(data);
 	uint32_t old_serial = zone_contents_serial(data->zone->contents), master_serial = 0;
 	bool bootstrap = (data->zone->contents == NULL);
 
-	if (dnssec_enable) {
-		axfr_slave_sign_serial(new_zone, data->zone, data->conf, &master_serial);
+	if (dnssec_enable && new_zone != NULL) {
+		master_serial = zone_contents_serial(new_zone);
+		zone_contents_set_soa_serial(new_zone,
+			axfr_slave_sign_serial(data->zone, data->conf, master_serial));
 	}
 
 	zone_update_t up = { 0 };
 	int ret;
 
-	if (data->ixfr_from_axfr && data->axfr_style_ixfr) {
+	struct timespec t_apply = time_now();
+	if (data->axfr.diff != NULL) {
+		ret = axfr_diff_update(data, &up, dnssec_enable, &master_serial);
+	} else if (data->ixfr_from_axfr && data->axfr_style_ixfr) {
 		ret = zone_update_from_differences(&up, data->zone, NULL, new_zone, UPDATE_INCREMENTAL, dnssec_enable, false);
 	} else {
 		ret = zone_update_from_contents(&up, data->zone, new_zone, UPDATE_FULL);
@@ -363,16 +630,16 @@ static int axfr_finalize(struct refresh_data *data)
 	// Seized by zone_update. Don't free the contents again in axfr_cleanup.
 	data->axfr.zone = NULL;
 
-	ret = zone_update_semcheck(data->conf, &up);
-	if (ret == KNOT_EOK) {
-		ret = zone_update_verify_digest(data->conf, &up);
-	}
+	up.xfr_perf = &data->zone->xfr_perf;
+	xfr_perf_time(up.xfr_perf, XFR_PERF_IN_APPLY_TIME, &t_apply);
+
+	ret = zone_update_semcheck_verify(data->conf, &up);
 	if (ret != KNOT_EOK) {
 		zone_update_clear(&up);
 		return ret;
 	}
 
-	val = conf_zone_get(data->conf, C_ZONEMD_GENERATE, data->zone->name);
+	conf_val_t val = conf_zone_get(data->conf, C_ZONEMD_GENERATE, data->zone->name);
 	unsigned digest_alg = conf_opt(&val);
 
 	if (dnssec_enable) {
@@ -416,28 +683,23 @@ static int axfr_finalize(struct refresh_data *data)
 	return KNOT_EOK;
 }
 
-static int axfr_consume_rr(const knot_rrset_t *rr, struct refresh_data *data)
+/*!
+ * \brief Check a received record, which is to be inserted into the new zone.
+ *
+ * The terminating SOA is recognized without looking into the zone, which
+ * may still be being filled in the background.
+ */
+static int axfr_check_rr(const knot_rrset_t *rr, struct refresh_data *data)
 {
 	assert(rr);
 	assert(data);
-	assert(data->axfr.zone);
+	assert(data->axfr.zone || data->axfr.diff);
 
-	// zc is stateless structure which can be initialized for each rr
-	// the changes are stored only in data->axfr.zone (aka zc.z)
-	zcreator_t zc = {
-		.z = data->axfr.zone,
-		.master = false,
-		.ret = KNOT_EOK
-	};
-
-	if (rr->type == KNOT_RRTYPE_SOA &&
-	    node_rrtype_exists(zc.z->apex, KNOT_RRTYPE_SOA)) {
-		return KNOT_STATE_DONE;
-	}
-
-	data->ret = zcreator_step(&zc, rr);
-	if (data->ret != KNOT_EOK) {
-		return KNOT_STATE_FAIL;
+	if (rr->type == KNOT_RRTYPE_SOA) {
+		if (data->axfr.soa_seen) {
+			return KNOT_STATE_DONE;
+		}
+		data->axfr.soa_seen = knot_dname_is_equal(rr->owner, data->zone->name);
 	}
 
 	data->change_size += knot_rrset_size(rr);
@@ -451,17 +713,62 @@ static int axfr_consume_rr(const knot_rrset_t *rr, struct refresh_data *data)
 	return KNOT_STATE_CONSUME;
 }
 
+static int axfr_consume_rr(const knot_rrset_t *rr, struct refresh_data *data)
+{
+	int next = axfr_check_rr(rr, data);
+	if (next != KNOT_STATE_CONSUME) {
+		return next;
+	}
+
+	data->ret = axfr_insert_rr(data, rr);
+	if (data->ret != KNOT_EOK) {
+		return KNOT_STATE_FAIL;
+	}
+
+	return KNOT_STATE_CONSUME;
+}
+
 static int axfr_consume_packet(knot_pkt_t *pkt, struct refresh_data *data)
 {
 	assert(pkt);
 	assert(data);
 
 	const knot_pktsection_t *answer = knot_pkt_section(pkt, KNOT_ANSWER);
-	int ret = KNOT_STATE_CONSUME;
-	for (uint16_t i = 0; i < answer->count && ret == KNOT_STATE_CONSUME; ++i) {
-		ret = axfr_consume_rr(knot_pkt_rr(answer, i), data);
+	int next = KNOT_STATE_CONSUME;
+	uint16_t count = 0;
+	while (count < answer->count &&
+	       (next = axfr_check_rr(knot_pkt_rr(answer, count), data)) == KNOT_STATE_CONSUME) {
+		count++;
 	}
-	return ret;
+	if (next == KNOT_STATE_FAIL) {
+		return next;
+	}
+
+	// A transfer completed within the first packet isn't worth a thread.
+	if (data->axfr.pipe == NULL && next == KNOT_STATE_DONE) {
+		for (uint16_t i = 0; i < count; ++i) {
+			data->ret = axfr_insert_rr(data, knot_pkt_rr(answer, i));
+			if (data->ret != KNOT_EOK) {
+				return KNOT_STATE_FAIL;
+			}
+		}
+		return next;
+	}
+
+	if (data->axfr.pipe == NULL) {
+		data->axfr.pipe = axfr_pipe_start(data);
+		if (data->axfr.pipe == NULL) {
+			data->ret = KNOT_ENOMEM;
+			return KNOT_STATE_FAIL;
+		}
+	}
+
+	data->ret = (count > 0) ? axfr_pipe_push(data->axfr.pipe, pkt, count) : KNOT_EOK;
+	if (data->ret == KNOT_EOK && next == KNOT_STATE_DONE) {
+		data->ret = axfr_pipe_finish(&data->axfr.pipe);
+	}
+
+	return (data->ret == KNOT_EOK) ? next : KNOT_STATE_FAIL;
 }
 
 static int axfr_consume(knot_pkt_t *pkt, struct refresh_data *data, bool reuse_soa)
@@ -479,7 +786,7 @@ static int axfr_consume(knot_pkt_t *pkt, struct refresh_data *data, bool reuse_s
 	}
 
 	// Initialize with first packet
-	if (data->axfr.zone == NULL) {
+	if (data->axfr.zone == NULL && data->axfr.diff == NULL) {
 		data->ret = axfr_init(data);
 		if (data->ret != KNOT_EOK) {
 			AXFRIN_LOG(LOG_WARNING, data,
@@ -513,6 +820,12 @@ static int axfr_consume(knot_pkt_t *pkt, struct refresh_data *data, bool reuse_s
 	// Finalize
 	if (next == KNOT_STATE_DONE) {
 		xfr_stats_end(&data->stats);
+		if (data->axfr.zone != NULL) {
+			data->ret = zcreator_finish(&data->axfr.creator);
+			if (data->ret != KNOT_EOK) {
+				return KNOT_STATE_FAIL;
+			}
+		}
 	}
 
 	return next;
@@ -598,6 +911,31 @@ static int ixfr_slave_sign_serial(list_t *changesets, zone_t *zone,
 	return KNOT_EOK;
 }
 
+/*!
+ * \brief Merges all the received changesets into the first one.
+ *
+ * Records added and later removed (or vice versa) cancel out, so the zone
+ * update processes the net changes only once.
+ */
+static int ixfr_squash(list_t *changesets)
+{
+	changeset_t *first = HEAD(*changesets);
+	changeset_t *set, *nxt;
+	WALK_LIST_DELSAFE(set, nxt, *changesets) {
+		if (set == first) {
+			continue;
+		}
+		int ret = changeset_merge(first, set, 0);
+		if (ret != KNOT_EOK) {
+			return ret;
+		}
+		rem_node(&set->n);
+		changeset_free(set);
+	}
+
+	return KNOT_EOK;
+}
+
 static int ixfr_finalize(struct refresh_data *data)
 {
 	conf_val_t val = conf_zone_get(data->conf, C_DNSSEC_SIGNING, data->zone->name);
@@ -619,6 +957,19 @@ static int ixfr_finalize(struct refresh_data *data)
 	val = conf_zone_get(data->conf, C_IXFR_BENEVOLENT, data->zone->name);
 	zone_update_flags_t strict = conf_bool(&val) ? 0 : UPDATE_STRICT;
 
+	struct timespec t_apply = time_now();
+
+	if (list_size(&data->ixfr.changesets) > 1) {
+		int ret = ixfr_squash(&data->ixfr.changesets);
+		if (ret != KNOT_EOK) {
+			IXFRIN_LOG(LOG_WARNING, data,
+			           "failed to merge changesets (%s)", knot_strerror(ret));
+			data->fallback_axfr = false;
+			data->fallback->remote = false;
+			return ret;
+		}
+	}
+
 	zone_update_t up = { 0 };
 	int ret = zone_update_init(&up, data->zone, UPDATE_INCREMENTAL | UPDATE_NO_CHSET | strict);
 	if (ret != KNOT_EOK) {
@@ -641,6 +992,9 @@ static int ixfr_finalize(struct refresh_data *data)
 		}
 	}
 
+	up.xfr_perf = &data->zone->xfr_perf;
+	xfr_perf_time(up.xfr_perf, XFR_PERF_IN_APPLY_TIME, &t_apply);
+
 	ret = zone_update_semcheck(data->conf, &up);
 	if (ret == KNOT_EOK) {
 		ret = zone_update_verify_digest(data->conf, &up);
@@ -1203,7 +1557,9 @@ static int transfer_consume(knot_layer_t *layer, knot_pkt_t *pkt)
 		uint32_t serial;
 		switch (data->xfr_type) {
 		case XFR_TYPE_AXFR:
-			serial = zone_contents_serial(data->axfr.zone);
+			serial = (data->axfr.diff != NULL) ?
+			         knot_soa_serial(zone_diff_stream_soa(data->axfr.diff)->rrs.rdata) :
+			         zone_contents_serial(data->axfr.zone);
 			break;
 		case XFR_TYPE_IXFR:
 			serial = knot_soa_serial(data->ixfr.final_soa->rrs.rdata);
@@ -1227,6 +1583,8 @@ static int transfer_consume(knot_layer_t *layer, knot_pkt_t *pkt)
 		                 flags2proto(layer->flags),
 		                 data->remote->key.name,
 		                 serial_log, &data->stats);
+		xfr_perf_transfer(&data->zone->xfr_perf, true, data->stats.messages,
+		                  data->stats.bytes, &data->stats.begin, &data->stats.end);
 
 		/*
 		 * TODO: Move finialization into finish
@@ -1345,8 +1703,31 @@ typedef struct {
 	bool ixfr_by_one;
 	bool ixfr_from_axfr;
 	bool more_xfr;
+	knot_pkt_t *soa_resp;                  // Response of the batched SOA check.
+	struct sockaddr_storage soa_remote;    // Primary of the batched SOA check.
 } try_refresh_ctx_t;
 
+/*! \brief Consumes the batched SOA check response, true if no query is needed. */
+static bool soa_prefetched(knot_requestor_t *requestor, knot_request_t *req,
+                           const conf_remote_t *master, try_refresh_ctx_t *trctx)
+{
+	if (trctx->soa_resp == NULL ||
+	    sockaddr_cmp(&master->addr, &trctx->soa_remote, false) != 0) {
+		return false;
+	}
+
+	knot_layer_produce(&requestor->layer, req->query);
+	if (requestor->layer.state == KNOT_STATE_CONSUME) {
+		knot_layer_consume(&requestor->layer, trctx->soa_resp);
+	}
+	knot_pkt_free(trctx->soa_resp);
+	trctx->soa_resp = NULL;
+
+	// Outdated zone continues with the transfer (KNOT_STATE_RESET).
+	return requestor->layer.state == KNOT_STATE_DONE ||
+	       requestor->layer.state == KNOT_STATE_FAIL;
+}
+
 static int try_refresh(conf_t *conf, zone_t *zone, const conf_remote_t *master,
                        void *ctx, zone_master_fallback_t *fallback)
 {
@@ -1407,19 +1788,24 @@ static int try_refresh(conf_t *conf, zone_t *zone, const conf_remote_t *master,
 
 	int ret;
 
-	// while loop runs 0x or 1x; IXFR to AXFR failover
-	while (ret = knot_requestor_exec(&requestor, req, timeout),
-	       ret = (data.ret == KNOT_EOK ? ret : data.ret),
-	       !(requestor.layer.flags & KNOT_REQUESTOR_IOFAIL) &&
-	       data.fallback_axfr && ret != KNOT_EOK) {
-		REFRESH_LOG(LOG_WARNING, &data,
-		            "fallback to AXFR (%s)", knot_strerror(ret));
-		ixfr_cleanup(&data);
-		data.ret = KNOT_EOK;
-		data.xfr_type = XFR_TYPE_AXFR;
-		data.fallback_axfr = false,
-		requestor.layer.state = KNOT_STATE_RESET;
-		requestor.layer.flags |= KNOT_REQUESTOR_CLOSE;
+	if (data.soa != NULL && soa_prefetched(&requestor, req, master, trctx)) {
+		ret = (requestor.layer.state == KNOT_STATE_DONE) ? KNOT_EOK : KNOT_EPROCESSING;
+		ret = (data.ret == KNOT_EOK ? ret : data.ret);
+	} else {
+		// while loop runs 0x or 1x; IXFR to AXFR failover
+		while (ret = knot_requestor_exec(&requestor, req, timeout),
+		       ret = (data.ret == KNOT_EOK ? ret : data.ret),
+		       !(requestor.layer.flags & KNOT_REQUESTOR_IOFAIL) &&
+		       data.fallback_axfr && ret != KNOT_EOK) {
+			REFRESH_LOG(LOG_WARNING, &data,
+			            "fallback to AXFR (%s)", knot_strerror(ret));
+			ixfr_cleanup(&data);
+			data.ret = KNOT_EOK;
+			data.xfr_type = XFR_TYPE_AXFR;
+			data.fallback_axfr = false,
+			requestor.layer.state = KNOT_STATE_RESET;
+			requestor.layer.flags |= KNOT_REQUESTOR_CLOSE;
+		}
 	}
 	knot_request_free(req, NULL);
 	knot_requestor_clear(&requestor);
@@ -1434,6 +1820,43 @@ static int try_refresh(conf_t *conf, zone_t *zone, const conf_remote_t *master,
 	return ret;
 }
 
+/*! \brief Hands over the SOA check to the batched checking if configured. */
+static bool refresh_batched(conf_t *conf, zone_t *zone, try_refresh_ctx_t *trctx)
+{
+	conf_val_t val = conf_zone_get(conf, C_REFRESH_BATCH, zone->name);
+	if (!conf_bool(&val) || trctx->force_axfr || zone->contents == NULL) {
+		return false;
+	}
+
+	val = conf_zone_get(conf, C_MASTER_PIN_TOL, zone->name);
+	if (conf_int(&val) > 0) {
+		return false;
+	}
+
+	pthread_mutex_lock(&zone->preferred_lock);
+	bool preferred = (zone->preferred_master != NULL);
+	pthread_mutex_unlock(&zone->preferred_lock);
+	if (preferred) {
+		return false;
+	}
+
+	conf_val_t masters = conf_zone_get(conf, C_MASTER, zone->name);
+	conf_mix_iter_t iter;
+	conf_mix_iter_init(conf, &masters, &iter);
+	if (iter.id->code != KNOT_EOK) {
+		return false;
+	}
+	conf_remote_t master = conf_remote(conf, iter.id, 0);
+
+	int ret = soa_batch_check(zone->server->soa_batch, zone->name, &master,
+	                          conf->cache.srv_tcp_remote_io_timeout, &trctx->soa_resp);
+	if (ret == KNOT_EOK) {
+		trctx->soa_remote = master.addr;
+	}
+
+	return ret == KNOT_EAGAIN; // Refresh scheduled again once checked.
+}
+
 int event_refresh(conf_t *conf, zone_t *zone)
 {
 	assert(zone);
@@ -1455,8 +1878,13 @@ int event_refresh(conf_t *conf, zone_t *zone)
 	val = conf_zone_get(conf, C_IXFR_FROM_AXFR, zone->name);
 	trctx.ixfr_from_axfr = conf_bool(&val);
 
+	if (refresh_batched(conf, zone, &trctx)) {
+		return KNOT_EOK;
+	}
+
 	int ret = zone_master_try(conf, zone, try_refresh, &trctx, "refresh");
 	zone_clear_preferred_master(zone);
+	knot_pkt_free(trctx.soa_resp);
 	if (ret != KNOT_EOK) {
 		const knot_rdataset_t *soa = zone_soa(zone);
 		uint32_t next;
@@ -1469,6 +1897,8 @@ int event_refresh(conf_t *conf, zone_t *zone)
 
 		limit_timer(conf, zone->name, &next, "retry",
 		            C_RETRY_MIN_INTERVAL, C_RETRY_MAX_INTERVAL);
+		val = conf_zone_get(conf, C_RETRY_MIN_INTERVAL, zone->name);
+		next = replan_jitter(conf, zone->name, next, conf_int(&val));
 		zone->timers.next_refresh = time(NULL) + next;
 		zone->timers.last_refresh_ok = false;
 
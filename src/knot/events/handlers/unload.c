@@ -0,0 +1,77 @@
+/*  Copyright (C) 2024 CZ.NIC, z.s.p.o. <knot-dns@labs.nic.cz>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+
+#include <assert.h>
+#include <inttypes.h>
+#include <time.h>
+
+#include "knot/common/log.h"
+#include "knot/common/reclaim.h"
+#include "knot/conf/conf.h"
+#include "knot/events/handlers.h"
+#include "knot/zone/contents.h"
+#include "knot/zone/zone.h"
+
+// UBSAN type punning workaround
+static void zone_contents_deep_free_wrap(void *contents)
+{
+	zone_contents_deep_free((zone_contents_t *)contents);
+}
+
+int event_unload(conf_t *conf, zone_t *zone)
+{
+	assert(conf);
+	assert(zone);
+
+	if (!zone->lazy.enabled || zone->contents == NULL ||
+	    zone->control_update != NULL) {
+		return KNOT_EOK;
+	}
+
+	// Store the updates so that the next load restores the same contents.
+	int ret = zone_flush_journal(conf, zone, false);
+	if (ret != KNOT_EOK) {
+		log_zone_warning(zone->name, "zone not unloaded, failed to flush (%s)",
+		                 knot_strerror(ret));
+		return ret;
+	}
+
+	conf_val_t val = conf_zone_get(conf, C_JOURNAL_CONTENT, zone->name);
+	if (conf_opt(&val) == JOURNAL_CONTENT_NONE &&
+	    (!zone->zonefile.exists ||
+	     zone->zonefile.serial != zone_contents_serial(zone->contents))) {
+		log_zone_notice(zone->name, "zone not unloaded, zone file not synchronized");
+		return KNOT_EOK;
+	}
+
+	size_t size = zone->contents->size;
+	zone_contents_t *unloaded = zone_switch_contents(zone, NULL);
+	ATOMIC_SET(zone->lazy.pending, false);
+
+	/* Free the contents in the background once no update uses them. */
+	knot_sem_wait(&zone->cow_lock);
+	knot_reclaim_defer(global_reclaim, zone_contents_deep_free_wrap, unloaded);
+	knot_sem_post(&zone->cow_lock);
+
+	// Planned again by the next load.
+	zone_events_schedule_at(zone, ZONE_EVENT_FLUSH, (time_t)0);
+
+	log_zone_info(zone->name, "unloaded, %zu bytes, idle for %"PRIu64" seconds",
+	              size, (uint64_t)time(NULL) - ATOMIC_GET(zone->lazy.last));
+
+	return KNOT_EOK;
+}
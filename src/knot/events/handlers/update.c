@@ -15,6 +15,8 @@
  */
 
 #include <assert.h>
+#include <errno.h>
+#include <time.h>
 
 #include "knot/conf/tools.h"
 #include "knot/events/handlers.h"
@@ -463,7 +465,33 @@ static int init_update_responses(list_t *updates)
 	return KNOT_EOK;
 }
 
-static size_t update_dequeue(zone_t *zone, list_t *updates)
+static void update_wait_batch(zone_t *zone, unsigned delay_ms, size_t batch_size)
+{
+	if (delay_ms == 0) {
+		return;
+	}
+
+	struct timespec deadline;
+	clock_gettime(CLOCK_REALTIME, &deadline);
+	deadline.tv_sec += delay_ms / 1000;
+	deadline.tv_nsec += (delay_ms % 1000) * 1000000L;
+	if (deadline.tv_nsec >= 1000000000L) {
+		deadline.tv_sec++;
+		deadline.tv_nsec -= 1000000000L;
+	}
+
+	/* Let more updates gather to be committed at once. */
+	pthread_mutex_lock(&zone->ddns_lock);
+	while (batch_size == 0 || zone->ddns_queue_size < batch_size) {
+		if (pthread_cond_timedwait(&zone->ddns_cond, &zone->ddns_lock,
+		                           &deadline) == ETIMEDOUT) {
+			break;
+		}
+	}
+	pthread_mutex_unlock(&zone->ddns_lock);
+}
+
+static size_t update_dequeue(zone_t *zone, list_t *updates, size_t batch_size)
 {
 	assert(zone);
 	assert(updates);
@@ -476,13 +504,30 @@ static size_t update_dequeue(zone_t *zone, list_t *updates)
 		return 0;
 	}
 
-	*updates = zone->ddns_queue;
 	size_t update_count = zone->ddns_queue_size;
-	init_list(&zone->ddns_queue);
-	zone->ddns_queue_size = 0;
+	bool remaining = (batch_size > 0 && update_count > batch_size);
+	if (remaining) {
+		/* Take just one batch, leave the rest for the next run. */
+		init_list(updates);
+		for (size_t i = 0; i < batch_size; i++) {
+			node_t *node = HEAD(zone->ddns_queue);
+			rem_node(node);
+			add_tail(updates, node);
+		}
+		update_count = batch_size;
+		zone->ddns_queue_size -= batch_size;
+	} else {
+		*updates = zone->ddns_queue;
+		init_list(&zone->ddns_queue);
+		zone->ddns_queue_size = 0;
+	}
 
 	pthread_mutex_unlock(&zone->ddns_lock);
 
+	if (remaining) {
+		zone_events_schedule_now(zone, ZONE_EVENT_UPDATE);
+	}
+
 	return update_count;
 }
 
@@ -490,9 +535,15 @@ int event_update(conf_t *conf, zone_t *zone)
 {
 	assert(zone);
 
+	conf_val_t val = conf_zone_get(conf, C_DDNS_BATCH_DELAY, zone->name);
+	unsigned batch_delay = conf_int(&val);
+	val = conf_zone_get(conf, C_DDNS_BATCH_SIZE, zone->name);
+	size_t batch_size = conf_int(&val);
+
 	/* Get list of pending updates. */
+	update_wait_batch(zone, batch_delay, batch_size);
 	list_t updates;
-	size_t update_count = update_dequeue(zone, &updates);
+	size_t update_count = update_dequeue(zone, &updates, batch_size);
 	if (update_count == 0) {
 		return KNOT_EOK;
 	}
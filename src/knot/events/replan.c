@@ -17,12 +17,50 @@
 #include <assert.h>
 #include <time.h>
 
+#include "contrib/macros.h"
 #include "knot/dnssec/kasp/kasp_db.h"
 #include "knot/events/replan.h"
+#include "libknot/rrtype/soa.h"
 
 #define TIME_CANCEL 0
 #define TIME_IGNORE (-1)
 
+uint32_t replan_jitter(conf_t *conf, const knot_dname_t *zone, uint32_t interval,
+                       uint32_t low)
+{
+	conf_val_t val = conf_zone_get(conf, C_TIMER_JITTER, zone);
+	uint64_t max_jitter = (uint64_t)interval * conf_int(&val) / 100;
+	if (max_jitter == 0 || interval <= low) {
+		return interval;
+	}
+
+	// FNV-1a of the zone name.
+	uint32_t hash = 2166136261U;
+	for (size_t i = 0; i < knot_dname_size(zone); i++) {
+		hash = (hash ^ zone[i]) * 16777619U;
+	}
+
+	uint32_t jitter = (max_jitter * hash) >> 32;
+
+	return MAX(interval - jitter, low);
+}
+
+/*!
+ * \brief Postpone an overdue timer by the zone's jitter of its interval.
+ *
+ * Spreads the timers which passed meanwhile (e.g. during a restart) instead
+ * of firing all of them at once.
+ */
+static time_t spread_overdue(conf_t *conf, zone_t *zone, time_t when, time_t now,
+                             uint32_t interval)
+{
+	if (when <= 0 || when > now) {
+		return when;
+	}
+
+	return now + interval - replan_jitter(conf, zone->name, interval, 0);
+}
+
 /*!
  * \brief Move DDNS queue from old zone to new zone and replan if necessary.
  *
@@ -111,6 +149,10 @@ void replan_from_timers(conf_t *conf, zone_t *zone)
 		if (refresh == 0) { // sanitize in case of concurrent purge event
 			refresh = now;
 		}
+		if (zone->contents != NULL) {
+			uint32_t soa_refresh = knot_soa_refresh(zone_soa(zone)->rdata);
+			refresh = spread_overdue(conf, zone, refresh, now, soa_refresh);
+		}
 		assert(refresh > 0);
 	}
 
@@ -126,7 +168,9 @@ void replan_from_timers(conf_t *conf, zone_t *zone)
 		conf_val_t val = conf_zone_get(conf, C_ZONEFILE_SYNC, zone->name);
 		int64_t sync_timeout = conf_int(&val);
 		if (sync_timeout > 0) {
-			flush = zone->timers.last_flush + sync_timeout;
+			flush = zone->timers.last_flush +
+			        replan_jitter(conf, zone->name, sync_timeout, 1);
+			flush = spread_overdue(conf, zone, flush, now, sync_timeout);
 		}
 	}
 
@@ -198,7 +242,7 @@ void replan_load_current(conf_t *conf, zone_t *zone, zone_t *old_zone)
 	if (zone->contents != NULL || zone_expired(zone)) {
 		replan_from_timers(conf, zone);
 		replan_dnssec(conf, zone);
-	} else {
+	} else if (!zone->lazy.enabled) {
 		zone_events_schedule_now(zone, ZONE_EVENT_LOAD);
 	}
 }
@@ -209,5 +253,7 @@ void replan_load_updated(zone_t *zone, zone_t *old_zone)
 	replan_from_zone(zone, old_zone);
 
 	// other events will cascade from load
-	zone_events_schedule_now(zone, ZONE_EVENT_LOAD);
+	if (zone->contents != NULL || !zone->lazy.enabled) {
+		zone_events_schedule_now(zone, ZONE_EVENT_LOAD);
+	}
 }
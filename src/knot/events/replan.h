@@ -19,6 +19,23 @@
 #include "knot/conf/conf.h"
 #include "knot/zone/zone.h"
 
+/*!
+ * \brief Shorten a timer interval by a deterministic per-zone portion.
+ *
+ * The portion is up to 'timer-jitter' percent of the interval, derived from
+ * the zone name, so that zones with equal timers drift apart instead of
+ * firing together again and again.
+ *
+ * \param conf      Configuration.
+ * \param zone      Zone name.
+ * \param interval  Timer interval in seconds.
+ * \param low       Lower bound of the result (unless the interval is lower).
+ *
+ * \return Shortened interval.
+ */
+uint32_t replan_jitter(conf_t *conf, const knot_dname_t *zone, uint32_t interval,
+                       uint32_t low);
+
 /*!
  * \brief Replan timer dependent refresh, expire, and flush.
  */
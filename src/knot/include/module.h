@@ -101,6 +101,8 @@ typedef enum {
 	KNOTD_MOD_FLAG_SCOPE_ZONE   = 1 << 2, /*!< Can be specified as zone module. */
 	KNOTD_MOD_FLAG_SCOPE_ANY    = KNOTD_MOD_FLAG_SCOPE_GLOBAL |
 	                              KNOTD_MOD_FLAG_SCOPE_ZONE,
+	KNOTD_MOD_FLAG_SHARED       = 1 << 3, /*!< Zone module instance can be shared
+	                                           among zones (zone name is the root). */
 } knotd_mod_flag_t;
 
 /*! Module API. */
@@ -216,11 +218,51 @@ typedef char* (*knotd_mod_idx_to_str_f)(uint32_t idx, uint32_t idx_count);
 int knotd_mod_stats_add(knotd_mod_t *mod, const char *ctr_name, uint32_t idx_count,
                         knotd_mod_idx_to_str_f idx_to_str);
 
+/*!
+ * Statistics dynamic counter item callback.
+ *
+ * \param[in] idx_name  Item name.
+ * \param[in] val       Item value.
+ * \param[in] data      Callback context.
+ *
+ * \return Error code, KNOT_EOK if success.
+ */
+typedef int (*knotd_mod_stats_item_f)(const char *idx_name, uint64_t val, void *data);
+
+/*!
+ * Statistics dynamic counter dump callback.
+ *
+ * \param[in] mod     Module context.
+ * \param[in] ctr_id  Counter id.
+ * \param[in] item    Callback to be called for each item of the counter.
+ * \param[in] data    Item callback context.
+ *
+ * \return Error code, KNOT_EOK if success.
+ */
+typedef int (*knotd_mod_stats_dump_f)(knotd_mod_t *mod, uint32_t ctr_id,
+                                      knotd_mod_stats_item_f item, void *data);
+
+/*!
+ * Registers a statistics counter with items provided by the module at dump time.
+ *
+ * \note The counter id is allocated as for a regular counter, but the counter
+ *       cannot be modified by knotd_mod_stats_incr() or knotd_mod_stats_decr().
+ *
+ * \param[in] mod       Module context.
+ * \param[in] ctr_name  Counter name (set NULL for an empty counter).
+ * \param[in] dump      Counter items dump callback.
+ *
+ * \return Error code, KNOT_EOK if success.
+ */
+int knotd_mod_stats_add_dynamic(knotd_mod_t *mod, const char *ctr_name,
+                                knotd_mod_stats_dump_f dump);
+
 /*!
  * Increments a statistics counter.
  *
  * \param[in] mod     Module context.
- * \param[in] thr_id  Index of worker thread.
+ * \param[in] thr_id  Index of the calling worker thread (counters of other threads
+ *                    mustn't be modified).
  * \param[in] ctr_id  Counter id (counted in the order the counters were registered).
  * \param[in] idx     Subcounter index (set 0 for single-counter).
  * \param[in] val     Value increment.
@@ -232,7 +274,8 @@ void knotd_mod_stats_incr(knotd_mod_t *mod, unsigned thr_id, uint32_t ctr_id,
  * Decrements a statistics counter.
  *
  * \param[in] mod     Module context.
- * \param[in] thr_id  Index of worker thread.
+ * \param[in] thr_id  Index of the calling worker thread (counters of other threads
+ *                    mustn't be modified).
  * \param[in] ctr_id  Counter id (counted in the order the counters were registered).
  * \param[in] idx     Subcounter index (set 0 for single-counter).
  * \param[in] val     Value decrement.
@@ -244,7 +287,8 @@ void knotd_mod_stats_decr(knotd_mod_t *mod, unsigned thr_id, uint32_t ctr_id,
  * Sets a statistics counter value.
  *
  * \param[in] mod     Module context.
- * \param[in] thr_id  Index of worker thread.
+ * \param[in] thr_id  Index of the calling worker thread (counters of other threads
+ *                    mustn't be modified).
  * \param[in] ctr_id  Counter id (counted in the order the counters were registered).
  * \param[in] idx     Subcounter index (set 0 for single-counter).
  * \param[in] val     Value.
@@ -252,6 +296,36 @@ void knotd_mod_stats_decr(knotd_mod_t *mod, unsigned thr_id, uint32_t ctr_id,
 void knotd_mod_stats_store(knotd_mod_t *mod, unsigned thr_id, uint32_t ctr_id,
                            uint32_t idx, uint64_t val);
 
+/*!
+ * Starts the sampled CPU cost accounting of the query processing phases.
+ *
+ * \note The accounting is shared by all the modules enabling it.
+ *
+ * \param[in] mod     Module context.
+ * \param[in] sample  Measure one of 'sample' queries of each worker thread.
+ *
+ * \return Error code, KNOT_EOK if success.
+ */
+int knotd_mod_query_phases_enable(knotd_mod_t *mod, unsigned sample);
+
+/*!
+ * Stops the query phases accounting unless enabled by another module.
+ *
+ * \param[in] mod  Module context.
+ */
+void knotd_mod_query_phases_disable(knotd_mod_t *mod);
+
+/*!
+ * Dumps the number of measured queries, the mean, and the 50th, 90th, and 99th
+ * percentile of the cycles spent in each query processing phase and module.
+ *
+ * \param[in] item  Callback to be called for each value.
+ * \param[in] data  Item callback context.
+ *
+ * \return Error code, KNOT_EOK if success.
+ */
+int knotd_mod_query_phases_dump(knotd_mod_stats_item_f item, void *data);
+
 /*! Configuration single-value abstraction. */
 typedef union {
 	int64_t integer;
@@ -364,6 +438,38 @@ knotd_conf_t knotd_conf_check_item(knotd_conf_check_args_t *args,
 bool knotd_conf_addr_range_match(const knotd_conf_t *range,
                                  const struct sockaddr_storage *addr);
 
+/*! Precompiled set of address ranges. */
+typedef struct knotd_addr_set knotd_addr_set_t;
+
+/*!
+ * Compiles address ranges into a set with logarithmic matching complexity.
+ *
+ * \note Suitable for long address lists matched on each query.
+ *
+ * \param[in] range  Configuration value of type YP_TNET or YP_TADDR.
+ *
+ * \return Address set or NULL if failed.
+ */
+knotd_addr_set_t *knotd_conf_addr_set(const knotd_conf_t *range);
+
+/*!
+ * Checks if address is in the set.
+ *
+ * \param[in] set
+ * \param[in] addr
+ *
+ * \return true if addr is in at least one range of the set, false otherwise.
+ */
+bool knotd_addr_set_match(const knotd_addr_set_t *set,
+                          const struct sockaddr_storage *addr);
+
+/*!
+ * Deallocates the address set.
+ *
+ * \param[in] set  Address set.
+ */
+void knotd_addr_set_free(knotd_addr_set_t *set);
+
 /*!
  * Deallocates multi-valued configuration values.
  *
@@ -400,6 +506,8 @@ typedef enum {
 typedef enum {
 	KNOTD_QUERY_FLAG_COOKIE     = 1 << 0, /*!< Valid DNS Cookie indication. */
 	KNOTD_QUERY_FLAG_AUTHORIZED = 1 << 1, /*!< Successfully authorized operation. */
+	KNOTD_QUERY_FLAG_PROXIED    = 1 << 2, /*!< Remote address from a PROXY v2 header. */
+	KNOTD_QUERY_FLAG_EARLY_DATA = 1 << 3, /*!< Query received before the handshake completion (0-RTT). */
 } knotd_query_flag_t;
 
 /*! Query processing data context parameters. */
@@ -416,6 +524,7 @@ typedef struct {
 	struct knot_tls_conn *tls_conn;        /*!< TLS connection context. */
 	int64_t quic_stream;                   /*!< QUIC stream ID inside quic_conn. */
 	uint32_t measured_rtt;                 /*!< Measured RTT in usecs: QUIC or TCP-XDP. */
+	void *suspend;                         /*!< Suspended queries queue (NULL if unsupported). */
 } knotd_qdata_params_t;
 
 /*! Query processing data context. */
@@ -517,8 +626,49 @@ typedef enum {
 	KNOTD_STATE_DONE  = 4, /*!< Finished. */
 	KNOTD_STATE_FAIL  = 5, /*!< Error. */
 	KNOTD_STATE_FINAL = 6, /*!< Finished and finalized (QNAME, EDNS, TSIG). */
+	KNOTD_STATE_YIELD = 8, /*!< Suspended, see knotd_qdata_yield(). */
 } knotd_state_t;
 
+/*! Suspended query processing handle. */
+typedef struct knotd_suspended knotd_suspended_t;
+
+/*!
+ * Suspends the query processing so that the answer can be finished later.
+ *
+ * The query is detached from the current network event, the server thread
+ * continues with other queries meanwhile. If successful, the calling hook must
+ * return KNOTD_STATE_YIELD. Only KNOTD_STAGE_BEGIN hooks may suspend.
+ *
+ * \note Not supported for XDP and PROXY v2 queries, then the module is expected
+ *       to finish the processing synchronously.
+ *
+ * \param[in] qdata  Query data.
+ *
+ * \return Suspended query handle, NULL if not supported or on error.
+ */
+knotd_suspended_t *knotd_qdata_yield(knotd_qdata_t *qdata);
+
+/*!
+ * Gets the query data of a suspended query.
+ *
+ * The query data can be modified (e.g. rcode) before resuming.
+ *
+ * \param[in] handle  Suspended query handle.
+ *
+ * \return Query data.
+ */
+knotd_qdata_t *knotd_suspended_qdata(knotd_suspended_t *handle);
+
+/*!
+ * Resumes the suspended query processing in the server thread which received it.
+ *
+ * Can be called from any thread, but exactly once per handle.
+ *
+ * \param[in] handle  Suspended query handle (invalid afterwards).
+ * \param[in] state   Result of the suspended hook.
+ */
+void knotd_qdata_resume(knotd_suspended_t *handle, knotd_state_t state);
+
 /*! Internet query processing states. */
 typedef enum {
 	KNOTD_IN_STATE_BEGIN,  /*!< Begin name resolution. */
@@ -555,6 +705,27 @@ typedef enum {
 typedef knotd_proto_state_t (*knotd_mod_proto_hook_f)
 	(knotd_proto_state_t state, knotd_qdata_params_t *params, knotd_mod_t *mod);
 
+/*! Received query in a batch. */
+typedef struct {
+	knotd_qdata_params_t *params; /*!< Low-level processing parameters. */
+	const uint8_t *wire;          /*!< Query wire (not parsed yet). */
+	size_t wire_len;              /*!< Query wire length. */
+	knotd_proto_state_t state;    /*!< Processing state, BLOCK drops the query. */
+} knotd_batch_item_t;
+
+/*!
+ * Batch processing hook.
+ *
+ * Called once for a batch of received UDP queries before the per-query
+ * processing, so that the module can amortize its lookups over the whole batch.
+ *
+ * \param[in,out] items  Received queries.
+ * \param[in] count      Number of queries.
+ * \param[in] mod        Module context.
+ */
+typedef void (*knotd_mod_batch_hook_f)
+	(knotd_batch_item_t *items, unsigned count, knotd_mod_t *mod);
+
 /*!
  * General processing hook.
  *
@@ -614,6 +785,19 @@ int knotd_mod_hook(knotd_mod_t *mod, knotd_stage_t stage, knotd_mod_hook_f hook)
  */
 int knotd_mod_in_hook(knotd_mod_t *mod, knotd_stage_t stage, knotd_mod_in_hook_f hook);
 
+/*!
+ * Registers batch processing module hook.
+ *
+ * The hook is called before KNOTD_STAGE_PROTO_BEGIN of each query in the batch.
+ * Just like the transport protocol hooks, it's applicable to global modules only.
+ *
+ * \param[in] mod   Module context.
+ * \param[in] hook  Module hook.
+ *
+ * \return Error code, KNOT_EOK if success.
+ */
+int knotd_mod_batch_hook(knotd_mod_t *mod, knotd_mod_batch_hook_f hook);
+
 /*** DNSSEC API. ***/
 
 /*!
@@ -54,11 +54,16 @@ void journal_del_zone(knot_lmdb_txn_t *txn, const knot_dname_t *zone)
 	free(prefix.mv_data);
 }
 
-void journal_make_header(void *chunk, uint32_t ch_serial_to, uint64_t now)
+void journal_make_header(void *chunk, uint32_t ch_serial_to, uint64_t now, uint32_t flags)
 {
+	// The second field used to be # of chunks, always zero since long ago.
 	knot_lmdb_make_key_part(chunk, JOURNAL_HEADER_SIZE, "IILLL", ch_serial_to,
-	                        (uint32_t)0 /* we no longer care for # of chunks */,
-	                        (uint64_t)0, now, (uint64_t)0);
+	                        flags, (uint64_t)0, now, (uint64_t)0);
+}
+
+uint32_t journal_chunk_flags(const MDB_val *chunk)
+{
+	return knot_wire_read_u32(chunk->mv_data + sizeof(uint32_t));
 }
 
 uint32_t journal_next_serial(const MDB_val *chunk)
@@ -100,3 +105,9 @@ size_t journal_conf_max_changesets(zone_journal_t j)
 	conf_val_t val = conf_zone_get(j.conf, C_JOURNAL_MAX_DEPTH, j.zone);
 	return conf_int(&val);
 }
+
+bool journal_conf_compress(zone_journal_t j)
+{
+	conf_val_t val = conf_zone_get(j.conf, C_JOURNAL_COMPRESSION, j.zone);
+	return conf_bool(&val);
+}
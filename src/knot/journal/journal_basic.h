@@ -17,6 +17,7 @@
 #pragma once
 
 #include "knot/conf/conf.h"
+#include "knot/journal/journal_stats.h"
 #include "knot/journal/knot_lmdb.h"
 #include "knot/updates/changesets.h"
 #include "libknot/dname.h"
@@ -25,12 +26,15 @@ typedef struct {
 	knot_lmdb_db_t *db;
 	const knot_dname_t *zone;
 	void *conf; // needed only for journal write operations
+	journal_stats_t *stats; // optional per-zone statistics
 } zone_journal_t;
 
 #define JOURNAL_CHUNK_MAX (70 * 1024) // must be at least 64k + 6B
 #define JOURNAL_CHUNK_THRESH (15 * 1024)
 #define JOURNAL_HEADER_SIZE (32)
 
+#define JOURNAL_CHUNK_COMPRESSED (1 << 0) // chunk payload is a Zstandard frame
+
 /*! \brief Convert journal_mode to LMDB environment flags. */
 inline static unsigned journal_env_flags(int journal_mode, bool readonly)
 {
@@ -87,8 +91,18 @@ void journal_del_zone(knot_lmdb_txn_t *txn, const knot_dname_t *zone);
  * \param chunk   Pointer to the changeset chunk. It must be at least JOURNAL_HEADER_SIZE, perhaps more.
  * \param ch      Serial-to of the changeset being serialized.
  * \param now     Current timestamp.
+ * \param flags   Chunk flags (JOURNAL_CHUNK_*).
+ */
+void journal_make_header(void *chunk, uint32_t ch_serial_to, uint64_t now, uint32_t flags);
+
+/*!
+ * \brief Obtain flags of the changeset chunk.
+ *
+ * \param chunk   Any chunk of a serialized changeset.
+ *
+ * \return Chunk flags (JOURNAL_CHUNK_*).
  */
-void journal_make_header(void *chunk, uint32_t ch_serial_to, uint64_t now);
+uint32_t journal_chunk_flags(const MDB_val *chunk);
 
 /*!
  * \brief Obtain serial-to of the serialized changeset.
@@ -136,3 +150,6 @@ size_t journal_conf_max_usage(zone_journal_t j);
 
 /*! \brief Return configured maximal depth of journal. */
 size_t journal_conf_max_changesets(zone_journal_t j);
+
+/*! \brief Return true if newly written changesets shall be compressed. */
+bool journal_conf_compress(zone_journal_t j);
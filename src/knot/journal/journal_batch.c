@@ -0,0 +1,229 @@
+/*  Copyright (C) 2024 CZ.NIC, z.s.p.o. <knot-dns@labs.nic.cz>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include <pthread.h>
+#include <stdbool.h>
+#include <stdlib.h>
+
+#include "knot/journal/journal_batch.h"
+#include "contrib/macros.h"
+#include "libknot/dname.h"
+#include "libknot/error.h"
+
+typedef struct batch_job {
+	struct batch_job *next;
+	zone_journal_t j;
+	const changeset_t *ch;
+	const changeset_t *extra;
+	const zone_diff_t *zdiff;
+	int ret;
+	bool done;
+} batch_job_t;
+
+struct journal_batch {
+	pthread_t thread;
+	pthread_mutex_t mx;
+	pthread_cond_t cond;
+	pthread_cond_t done;
+	batch_job_t *head;
+	batch_job_t *tail;
+	knot_lmdb_db_t *db;
+	size_t max_count;
+	bool stop;
+};
+
+static bool batch_has_zone(batch_job_t *jobs, batch_job_t *until, const knot_dname_t *zone)
+{
+	for (batch_job_t *job = jobs; job != until; job = job->next) {
+		if (knot_dname_is_equal(job->j.zone, zone)) {
+			return true;
+		}
+	}
+	return false;
+}
+
+/*!
+ * Detaches the queued jobs to be committed together. The batch ends before
+ * a second changeset of the same zone, as journal reading during the insert
+ * (e.g. merging) wouldn't see the uncommitted data of the same transaction.
+ */
+static batch_job_t *batch_take(journal_batch_t *batch)
+{
+	batch_job_t *jobs = batch->head, *last = jobs;
+	size_t count = 1;
+	while (last->next != NULL && count < batch->max_count &&
+	       !batch_has_zone(jobs, last->next, last->next->j.zone)) {
+		last = last->next;
+		count++;
+	}
+
+	batch->head = last->next;
+	if (batch->head == NULL) {
+		batch->tail = NULL;
+	}
+	last->next = NULL;
+
+	return jobs;
+}
+
+static void batch_run(journal_batch_t *batch, batch_job_t *jobs)
+{
+	if (jobs->next == NULL) {
+		jobs->ret = journal_insert(jobs->j, jobs->ch, jobs->extra, jobs->zdiff);
+		return;
+	}
+
+	int ret = knot_lmdb_open(batch->db);
+	if (ret == KNOT_EOK) {
+		knot_lmdb_txn_t txn = { 0 };
+		knot_lmdb_begin(batch->db, &txn, true);
+		for (batch_job_t *job = jobs; job != NULL && txn.ret == KNOT_EOK; job = job->next) {
+			// A changeset rejected by initial checks leaves the transaction intact.
+			job->ret = journal_insert_txn(job->j, &txn, job->ch, job->extra, job->zdiff);
+		}
+		journal_commit(&txn, NULL);
+		ret = txn.ret;
+	}
+
+	// Any failure spoils the whole transaction, retry one by one.
+	if (ret != KNOT_EOK) {
+		for (batch_job_t *job = jobs; job != NULL; job = job->next) {
+			job->ret = journal_insert(job->j, job->ch, job->extra, job->zdiff);
+		}
+	}
+}
+
+static void *batch_thread(void *arg)
+{
+	journal_batch_t *batch = arg;
+
+	pthread_mutex_lock(&batch->mx);
+	while (true) {
+		while (batch->head == NULL && !batch->stop) {
+			pthread_cond_wait(&batch->cond, &batch->mx);
+		}
+		if (batch->head == NULL) {
+			break; // Stopped and drained.
+		}
+		batch_job_t *jobs = batch_take(batch);
+		pthread_mutex_unlock(&batch->mx);
+
+		batch_run(batch, jobs);
+
+		pthread_mutex_lock(&batch->mx);
+		while (jobs != NULL) {
+			batch_job_t *next = jobs->next; // The job is gone once done.
+			jobs->done = true;
+			jobs = next;
+		}
+		pthread_cond_broadcast(&batch->done);
+	}
+	pthread_mutex_unlock(&batch->mx);
+
+	return NULL;
+}
+
+journal_batch_t *journal_batch_init(knot_lmdb_db_t *db)
+{
+	journal_batch_t *batch = calloc(1, sizeof(*batch));
+	if (batch == NULL) {
+		return NULL;
+	}
+
+	pthread_mutex_init(&batch->mx, NULL);
+	pthread_cond_init(&batch->cond, NULL);
+	pthread_cond_init(&batch->done, NULL);
+	batch->db = db;
+	batch->max_count = 1;
+
+	if (pthread_create(&batch->thread, NULL, batch_thread, batch) != 0) {
+		pthread_cond_destroy(&batch->done);
+		pthread_cond_destroy(&batch->cond);
+		pthread_mutex_destroy(&batch->mx);
+		free(batch);
+		return NULL;
+	}
+
+	return batch;
+}
+
+void journal_batch_deinit(journal_batch_t **batch)
+{
+	if (batch == NULL || *batch == NULL) {
+		return;
+	}
+
+	journal_batch_t *b = *batch;
+	*batch = NULL;
+
+	pthread_mutex_lock(&b->mx);
+	b->stop = true;
+	pthread_cond_signal(&b->cond);
+	pthread_mutex_unlock(&b->mx);
+
+	pthread_join(b->thread, NULL);
+
+	pthread_cond_destroy(&b->done);
+	pthread_cond_destroy(&b->cond);
+	pthread_mutex_destroy(&b->mx);
+	free(b);
+}
+
+void journal_batch_set_limit(journal_batch_t *batch, size_t max_count)
+{
+	if (batch == NULL) {
+		return;
+	}
+
+	pthread_mutex_lock(&batch->mx);
+	batch->max_count = MAX(max_count, 1);
+	pthread_mutex_unlock(&batch->mx);
+}
+
+int journal_batch_insert(journal_batch_t *batch, zone_journal_t j, const changeset_t *ch,
+                         const changeset_t *extra, const zone_diff_t *zdiff)
+{
+	if (batch == NULL || j.db != batch->db) {
+		return journal_insert(j, ch, extra, zdiff);
+	}
+
+	pthread_mutex_lock(&batch->mx);
+	if (batch->max_count <= 1 || batch->stop) {
+		pthread_mutex_unlock(&batch->mx);
+		return journal_insert(j, ch, extra, zdiff);
+	}
+
+	batch_job_t job = {
+		.j = j,
+		.ch = ch,
+		.extra = extra,
+		.zdiff = zdiff,
+	};
+	if (batch->tail != NULL) {
+		batch->tail->next = &job;
+	} else {
+		batch->head = &job;
+	}
+	batch->tail = &job;
+	pthread_cond_signal(&batch->cond);
+
+	while (!job.done) {
+		pthread_cond_wait(&batch->done, &batch->mx);
+	}
+	pthread_mutex_unlock(&batch->mx);
+
+	return job.ret;
+}
@@ -0,0 +1,68 @@
+/*  Copyright (C) 2024 CZ.NIC, z.s.p.o. <knot-dns@labs.nic.cz>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include "knot/journal/journal_write.h"
+
+/*!
+ * \brief Group commit of journal inserts.
+ *
+ * Changesets of different zones are handed over to a dedicated writer thread,
+ * which stores all the changesets queued meanwhile in one shared LMDB write
+ * transaction, so that they share one writer lock acquisition and one disk
+ * synchronization. The callers are woken up once the transaction is committed.
+ */
+typedef struct journal_batch journal_batch_t;
+
+/*!
+ * \brief Start the journal writer thread.
+ *
+ * \param db   Journal DB.
+ *
+ * \return Allocated writer, or NULL.
+ */
+journal_batch_t *journal_batch_init(knot_lmdb_db_t *db);
+
+/*!
+ * \brief Store pending changesets and stop the writer thread.
+ */
+void journal_batch_deinit(journal_batch_t **batch);
+
+/*!
+ * \brief Set the maximal number of changesets committed together.
+ *
+ * \param batch       Journal writer.
+ * \param max_count   Changesets limit, 1 disables the group commit.
+ */
+void journal_batch_set_limit(journal_batch_t *batch, size_t max_count);
+
+/*!
+ * \brief Store changeset into journal, possibly together with other zones.
+ *
+ * Same as journal_insert(), to which it falls back if the writer is missing
+ * or group commit is disabled. Blocks until the changeset is committed.
+ *
+ * \param batch   Journal writer (can be NULL).
+ * \param j       Zone journal, its DB must be the writer's one.
+ * \param ch      Changeset to be stored.
+ * \param extra   Extra changeset to be stored in the role of merged changeset.
+ * \param zdiff   Zone diff to be stored instead of changeset.
+ *
+ * \return KNOT_E*
+ */
+int journal_batch_insert(journal_batch_t *batch, zone_journal_t j, const changeset_t *ch,
+                         const changeset_t *extra, const zone_diff_t *zdiff);
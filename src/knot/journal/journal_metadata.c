@@ -16,6 +16,7 @@
 
 #include "knot/journal/journal_metadata.h"
 
+#include "knot/zone/serial.h"
 #include "libknot/endian.h"
 #include "libknot/error.h"
 
@@ -343,6 +344,25 @@ int journal_set_flushed(zone_journal_t j)
 	return txn.ret;
 }
 
+int journal_set_flushed_upto(zone_journal_t j, uint32_t serial)
+{
+	knot_lmdb_txn_t txn = { 0 };
+	journal_metadata_t md = { 0 };
+	knot_lmdb_begin(j.db, &txn, true);
+	journal_load_metadata(&txn, j.zone, &md);
+
+	// The journal may have been appended or replaced with a zone-in-journal meanwhile.
+	if (serial == md.serial_to ||
+	    (journal_contains(&txn, false, serial, j.zone) &&
+	     serial_compare(md.flushed_upto, serial) == SERIAL_LOWER)) {
+		md.flushed_upto = serial;
+		journal_store_metadata(&txn, j.zone, &md);
+	}
+
+	knot_lmdb_commit(&txn);
+	return txn.ret;
+}
+
 int journal_info(zone_journal_t j, bool *exists, uint32_t *first_serial, bool *has_zij,
                  uint32_t *serial_to, bool *has_merged, uint32_t *merged_serial,
                  uint64_t *occupied, uint64_t *occupied_total)
@@ -391,6 +411,65 @@ int journal_info(zone_journal_t j, bool *exists, uint32_t *first_serial, bool *h
 	return txn.ret;
 }
 
+int journal_chain_length(zone_journal_t j, uint32_t from, uint32_t to,
+                         size_t max, size_t *count)
+{
+	*count = 0;
+	if (knot_lmdb_exists(j.db) == KNOT_ENODB) {
+		return KNOT_ENOENT;
+	}
+	int ret = knot_lmdb_open(j.db);
+	if (ret != KNOT_EOK) {
+		return ret;
+	}
+	knot_lmdb_txn_t txn = { 0 };
+	knot_lmdb_begin(j.db, &txn, false);
+	while (from != to && *count < max && txn.ret == KNOT_EOK) {
+		if (!journal_serial_to(&txn, false, from, j.zone, &from)) {
+			if (txn.ret == KNOT_EOK) {
+				txn.ret = KNOT_ENOENT;
+			}
+			break;
+		}
+		(*count)++;
+	}
+	knot_lmdb_abort(&txn);
+	return txn.ret;
+}
+
+int journal_chain_serials(zone_journal_t j, uint32_t from, uint32_t *serials,
+                          size_t max, size_t *count)
+{
+	*count = 0;
+	if (knot_lmdb_exists(j.db) == KNOT_ENODB) {
+		return KNOT_EOK;
+	}
+	int ret = knot_lmdb_open(j.db);
+	if (ret != KNOT_EOK) {
+		return ret;
+	}
+	knot_lmdb_txn_t txn = { 0 };
+	journal_metadata_t md = { 0 };
+	knot_lmdb_begin(j.db, &txn, false);
+	journal_load_metadata(&txn, j.zone, &md);
+	size_t limit = md.changeset_count + 1; // Possibly including the merged one.
+	uint32_t next;
+	while (*count < max && txn.ret == KNOT_EOK &&
+	       journal_serial_to(&txn, false, from, j.zone, &next)) {
+		if (*count >= limit) {
+			txn.ret = KNOT_ELOOP;
+			break;
+		}
+		if (serials != NULL) {
+			serials[*count] = from;
+		}
+		(*count)++;
+		from = next;
+	}
+	knot_lmdb_abort(&txn);
+	return txn.ret;
+}
+
 int journals_walk(knot_lmdb_db_t *db, journals_walk_cb_t cb, void *ctx)
 {
 	int ret = knot_lmdb_exists(db);
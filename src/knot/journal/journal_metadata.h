@@ -149,6 +149,18 @@ int journal_copy_with_md(knot_lmdb_db_t *from, knot_lmdb_db_t *to, const knot_dn
  */
 int journal_set_flushed(zone_journal_t j);
 
+/*!
+ * \brief Update the metadata stored in journal DB after a zone flush of an older zone version.
+ *
+ * The flushed serial is only advanced if it's still part of the journal.
+ *
+ * \param j        Journal to be notified about flush.
+ * \param serial   Serial of the flushed zone version.
+ *
+ * \return KNOT_E*
+ */
+int journal_set_flushed_upto(zone_journal_t j, uint32_t serial);
+
 /*!
  * \brief Obtain information about the zone's journal from the DB (mostly metadata).
  *
@@ -168,6 +180,34 @@ int journal_info(zone_journal_t j, bool *exists, uint32_t *first_serial, bool *h
                  uint32_t *serial_to, bool *has_merged, uint32_t *merged_serial,
                  uint64_t *occupied, uint64_t *occupied_total);
 
+/*!
+ * \brief Count the changesets linking two serials, reading chunk headers only.
+ *
+ * \param j        Zone journal.
+ * \param from     Serial-from of the first changeset.
+ * \param to       Serial-to of the last changeset.
+ * \param max      Stop counting at this number of changesets.
+ * \param count    Output: number of changesets, 'max' if reached.
+ *
+ * \return KNOT_ENOENT if the chain breaks, KNOT_E*
+ */
+int journal_chain_length(zone_journal_t j, uint32_t from, uint32_t to,
+                         size_t max, size_t *count);
+
+/*!
+ * \brief List the changesets following a serial, reading chunk headers only.
+ *
+ * \param j         Zone journal.
+ * \param from      Serial-from of the first changeset.
+ * \param serials   Optional output: serial-from of each changeset.
+ * \param max       Size of 'serials', stop at this number of changesets.
+ * \param count     Output: number of changesets (up to 'max').
+ *
+ * \return KNOT_E*
+ */
+int journal_chain_serials(zone_journal_t j, uint32_t from, uint32_t *serials,
+                          size_t max, size_t *count);
+
 /*! \brief Return true if this zone exists in journal DB. */
 inline static bool journal_is_existing(zone_journal_t j) {
 	bool ex = false;
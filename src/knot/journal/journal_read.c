@@ -25,6 +25,9 @@
 #include "libknot/error.h"
 
 #include <stdlib.h>
+#ifdef ENABLE_ZSTD
+#include <zstd.h>
+#endif
 
 struct journal_read {
 	knot_lmdb_txn_t txn;
@@ -35,6 +38,14 @@ struct journal_read {
 	uint32_t next;
 	uint32_t changesets_read;
 	uint32_t changesets_total;
+	bool unpacked_wire;  // The wire is a decompressed chunk, not the LMDB data.
+	knot_dname_storage_t owner; // Owner storage for journal_read_rrset_nocopy().
+	uint8_t *rdata;      // Reusable rdata buffer for journal_read_rrset_nocopy().
+	size_t rdata_max;
+#ifdef ENABLE_ZSTD
+	ZSTD_DCtx *dctx;
+	uint8_t *unpacked;
+#endif
 };
 
 int journal_read_get_error(const journal_read_t *ctx, int another_error)
@@ -42,10 +53,47 @@ int journal_read_get_error(const journal_read_t *ctx, int another_error)
 	return (ctx == NULL || ctx->txn.ret == KNOT_EOK ? another_error : ctx->txn.ret);
 }
 
-static void update_ctx_wire(journal_read_t *ctx)
+static int unpack_chunk(journal_read_t *ctx)
+{
+#ifdef ENABLE_ZSTD
+	if (ctx->dctx == NULL) {
+		ctx->dctx = ZSTD_createDCtx();
+	}
+	if (ctx->unpacked == NULL) {
+		ctx->unpacked = malloc(JOURNAL_CHUNK_MAX - JOURNAL_HEADER_SIZE);
+	}
+	if (ctx->dctx == NULL || ctx->unpacked == NULL) {
+		return KNOT_ENOMEM;
+	}
+	size_t ret = ZSTD_decompressDCtx(ctx->dctx, ctx->unpacked,
+	                                 JOURNAL_CHUNK_MAX - JOURNAL_HEADER_SIZE,
+	                                 ctx->wire.position, wire_ctx_available(&ctx->wire));
+	if (ZSTD_isError(ret) || ret == 0) {
+		return KNOT_EMALF;
+	}
+	ctx->wire = wire_ctx_init_const(ctx->unpacked, ret);
+	return KNOT_EOK;
+#else
+	return KNOT_ENOTSUP;
+#endif
+}
+
+static bool update_ctx_wire(journal_read_t *ctx)
 {
 	ctx->wire = wire_ctx_init_const(ctx->txn.cur_val.mv_data, ctx->txn.cur_val.mv_size);
 	wire_ctx_skip(&ctx->wire, JOURNAL_HEADER_SIZE);
+	ctx->unpacked_wire = false;
+	if (ctx->wire.error == KNOT_EOK &&
+	    (journal_chunk_flags(&ctx->txn.cur_val) & JOURNAL_CHUNK_COMPRESSED)) {
+		ctx->unpacked_wire = true;
+		int ret = unpack_chunk(ctx);
+		if (ret != KNOT_EOK) {
+			ctx->wire = wire_ctx_init_const(NULL, 0);
+			ctx->txn.ret = ret;
+			return false;
+		}
+	}
+	return true;
 }
 
 static bool go_correct_prefix(journal_read_t *ctx)
@@ -78,8 +126,7 @@ static bool go_next_changeset(journal_read_t *ctx, bool go_zone, const knot_dnam
 	}
 	ctx->next = journal_next_serial(&ctx->txn.cur_val);
 	ctx->timestamp = journal_ch_timestamp(&ctx->txn.cur_val);
-	update_ctx_wire(ctx);
-	return true;
+	return update_ctx_wire(ctx);
 }
 
 int journal_read_begin(zone_journal_t j, bool read_zone, uint32_t serial_from, journal_read_t **ctx)
@@ -120,6 +167,11 @@ void journal_read_end(journal_read_t *ctx)
 	if (ctx != NULL) {
 		free(ctx->key_prefix.mv_data);
 		knot_lmdb_abort(&ctx->txn);
+		free(ctx->rdata);
+#ifdef ENABLE_ZSTD
+		ZSTD_freeDCtx(ctx->dctx);
+		free(ctx->unpacked);
+#endif
 		free(ctx);
 	}
 }
@@ -138,7 +190,7 @@ static bool make_data_available(journal_read_t *ctx)
 			ctx->txn.ret = KNOT_EMALF;
 			return false;
 		}
-		update_ctx_wire(ctx);
+		return update_ctx_wire(ctx);
 	}
 	return true;
 }
@@ -148,20 +200,52 @@ static bool make_data_available(journal_read_t *ctx)
 // - endian
 // - optionally storing whole rdataset at once?
 
-bool journal_read_rrset(journal_read_t *ctx, knot_rrset_t *rrset, bool allow_next_changeset)
+static int rdata_append(journal_read_t *ctx, knot_rdataset_t *rrs,
+                        const uint8_t *data, uint16_t len)
+{
+	size_t size = rrs->size + knot_rdata_size(len);
+	if (size > ctx->rdata_max) {
+		size_t new_max = MAX(size, 2 * ctx->rdata_max);
+		uint8_t *new_rdata = realloc(ctx->rdata, new_max);
+		if (new_rdata == NULL) {
+			return KNOT_ENOMEM;
+		}
+		ctx->rdata = new_rdata;
+		ctx->rdata_max = new_max;
+	}
+
+	knot_rdata_init((knot_rdata_t *)(ctx->rdata + rrs->size), len, data);
+	rrs->rdata = (knot_rdata_t *)ctx->rdata;
+	rrs->size = size;
+	rrs->count++;
+
+	return KNOT_EOK;
+}
+
+static bool read_rrset(journal_read_t *ctx, knot_rrset_t *rrset,
+                       bool allow_next_changeset, bool copy)
 {
-	//knot_rdataset_clear(&rrset->rrs, NULL);
-	//memset(rrset, 0, sizeof(*rrset));
 	if (!make_data_available(ctx)) {
 		if (!allow_next_changeset || !go_next_changeset(ctx, false, ctx->zone)) {
 			return false;
 		}
 	}
-	rrset->owner = knot_dname_copy(ctx->wire.position, NULL);
+	if (copy) {
+		rrset->owner = knot_dname_copy(ctx->wire.position, NULL);
+	} else {
+		knot_rrset_init_empty(rrset);
+		rrset->owner = (knot_dname_t *)ctx->wire.position;
+		// Decompressed chunk is overwritten once the RRSet continues in next one.
+		if (ctx->unpacked_wire && knot_dname_size(rrset->owner) <= sizeof(ctx->owner)) {
+			rrset->owner = memcpy(ctx->owner, rrset->owner, knot_dname_size(rrset->owner));
+		}
+	}
 	wire_ctx_skip(&ctx->wire, knot_dname_size(rrset->owner));
 	rrset->type = wire_ctx_read_u16(&ctx->wire);
 	rrset->rclass = wire_ctx_read_u16(&ctx->wire);
 	uint16_t rrs_count = wire_ctx_read_u16(&ctx->wire);
+	knot_rdataset_builder_t builder;
+	knot_rdataset_builder_init(&builder, NULL);
 	for (int i = 0; i < rrs_count && ctx->wire.error == KNOT_EOK; i++) {
 		if (!make_data_available(ctx)) {
 			ctx->wire.error = KNOT_EFEWDATA;
@@ -173,22 +257,56 @@ bool journal_read_rrset(journal_read_t *ctx, knot_rrset_t *rrset, bool allow_nex
 			rrset->ttl = ttl;
 		}
 		uint16_t len = wire_ctx_read_u16(&ctx->wire);
+		if (ctx->wire.error == KNOT_EOK && wire_ctx_available(&ctx->wire) < len) {
+			ctx->wire.error = KNOT_ERANGE;
+		}
 		if (ctx->wire.error == KNOT_EOK) {
-			ctx->wire.error = knot_rrset_add_rdata(rrset, ctx->wire.position, len, NULL);
+			ctx->wire.error = copy ?
+				knot_rdataset_builder_add(&builder, ctx->wire.position, len) :
+				rdata_append(ctx, &rrset->rrs, ctx->wire.position, len);
 		}
 		wire_ctx_skip(&ctx->wire, len);
 	}
+	if (copy && ctx->wire.error == KNOT_EOK) {
+		ctx->wire.error = knot_rdataset_builder_finish(&builder, &rrset->rrs);
+	}
+	knot_rdataset_builder_clear(&builder);
 	if (ctx->txn.ret == KNOT_EOK) {
 		ctx->txn.ret = ctx->wire.error == KNOT_ERANGE ? KNOT_EMALF : ctx->wire.error;
 	}
 	if (ctx->txn.ret == KNOT_EOK) {
 		return true;
 	} else {
-		journal_read_clear_rrset(rrset);
+		if (copy) {
+			journal_read_clear_rrset(rrset);
+		} else {
+			knot_rrset_init_empty(rrset);
+		}
 		return false;
 	}
 }
 
+bool journal_read_rrset(journal_read_t *ctx, knot_rrset_t *rrset, bool allow_next_changeset)
+{
+	return read_rrset(ctx, rrset, allow_next_changeset, true);
+}
+
+bool journal_read_rrset_nocopy(journal_read_t *ctx, knot_rrset_t *rrset, bool allow_next_changeset)
+{
+	return read_rrset(ctx, rrset, allow_next_changeset, false);
+}
+
+void journal_read_changeset_info(const journal_read_t *ctx, uint32_t *serial_to,
+                                 uint64_t *timestamp)
+{
+	if (serial_to != NULL) {
+		*serial_to = ctx->next;
+	}
+	if (timestamp != NULL) {
+		*timestamp = ctx->timestamp;
+	}
+}
+
 void journal_read_clear_rrset(knot_rrset_t *rr)
 {
 	knot_rrset_clear(rr, NULL);
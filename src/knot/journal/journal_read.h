@@ -47,6 +47,34 @@ int journal_read_begin(zone_journal_t j, bool read_zone, uint32_t serial_from, j
  */
 bool journal_read_rrset(journal_read_t *ctx, knot_rrset_t *rr, bool allow_next_changeset);
 
+/*!
+ * \brief Read a single RRSet from a journal changeset without copying it.
+ *
+ * The owner points directly into the (read-only) journal data and the rdata
+ * are repacked into a buffer owned by the reading context. Suitable for data
+ * only being streamed out, e.g. outgoing IXFR.
+ *
+ * \note The RRSet is valid until next reading or journal_read_end(), it must
+ *       not be modified nor freed by journal_read_clear_rrset().
+ *
+ * \param ctx                    Journal reading context.
+ * \param rr                     Output: RRSet pointing to the journal data.
+ * \param allow_next_changeset   True to allow jumping to next changeset.
+ *
+ * \return False if no more RRSet in this changeset/journal, or failure.
+ */
+bool journal_read_rrset_nocopy(journal_read_t *ctx, knot_rrset_t *rr, bool allow_next_changeset);
+
+/*!
+ * \brief Get the properties of the changeset currently being read.
+ *
+ * \param ctx         Journal reading context.
+ * \param serial_to   Optional output: serial-to of the changeset.
+ * \param timestamp   Optional output: timestamp of the changeset.
+ */
+void journal_read_changeset_info(const journal_read_t *ctx, uint32_t *serial_to,
+                                 uint64_t *timestamp);
+
 /*!
  * \brief Free up heap allocations by journal_read_rrset().
  *
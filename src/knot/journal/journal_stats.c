@@ -0,0 +1,91 @@
+/*  Copyright (C) 2024 CZ.NIC, z.s.p.o. <knot-dns@labs.nic.cz>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+
+#include "knot/journal/journal_stats.h"
+#include "contrib/time.h"
+
+journal_stats_t journal_stats;
+
+static const char *stat_names[JOURNAL_STAT_COUNT] = {
+	[JOURNAL_STAT_CHANGESETS]     = "changesets",
+	[JOURNAL_STAT_CHANGESET_SIZE] = "changeset-bytes",
+	[JOURNAL_STAT_RRS]            = "changeset-records",
+	[JOURNAL_STAT_WRITTEN]        = "written-bytes",
+	[JOURNAL_STAT_CHUNKS]         = "written-chunks",
+	[JOURNAL_STAT_MERGES]         = "merges",
+	[JOURNAL_STAT_FLUSHES]        = "flush-requests",
+	[JOURNAL_STAT_INSERT_TIME]    = "insert-time",
+	[JOURNAL_STAT_COMMITS]        = "commits",
+	[JOURNAL_STAT_COMMIT_TIME]    = "commit-time",
+};
+
+static const char *hist_names[JOURNAL_HIST_COUNT] = {
+	[JOURNAL_HIST_INSERT] = "insert-latency",
+	[JOURNAL_HIST_COMMIT] = "commit-latency",
+};
+
+static const char *bucket_names[JOURNAL_HIST_BUCKETS] = {
+	"1ms", "10ms", "100ms", "1s", "more"
+};
+
+// Total time counter belonging to each histogram.
+static const journal_stat_t hist_time[JOURNAL_HIST_COUNT] = {
+	[JOURNAL_HIST_INSERT] = JOURNAL_STAT_INSERT_TIME,
+	[JOURNAL_HIST_COMMIT] = JOURNAL_STAT_COMMIT_TIME,
+};
+
+void journal_stats_add(journal_stats_t *zone_stats, journal_stat_t ctr, uint64_t val)
+{
+	ATOMIC_ADD(journal_stats.ctr[ctr], val);
+	if (zone_stats != NULL) {
+		ATOMIC_ADD(zone_stats->ctr[ctr], val);
+	}
+}
+
+void journal_stats_latency(journal_stats_t *zone_stats, journal_hist_t hist,
+                           const struct timespec *begin)
+{
+	struct timespec end = time_now();
+	uint64_t usec = time_diff_ms(begin, &end) * 1000;
+
+	unsigned bucket = 0;
+	for (uint64_t limit = 1000; bucket < JOURNAL_HIST_BUCKETS - 1 && usec > limit;
+	     limit *= 10) {
+		bucket++;
+	}
+
+	journal_stats_add(zone_stats, hist_time[hist], usec);
+	ATOMIC_ADD(journal_stats.hist[hist][bucket], 1);
+	if (zone_stats != NULL) {
+		ATOMIC_ADD(zone_stats->hist[hist][bucket], 1);
+	}
+}
+
+const char *journal_stats_name(journal_stat_t ctr)
+{
+	return stat_names[ctr];
+}
+
+const char *journal_stats_hist_name(journal_hist_t hist)
+{
+	return hist_names[hist];
+}
+
+const char *journal_stats_bucket_name(unsigned bucket)
+{
+	return bucket_names[bucket];
+}
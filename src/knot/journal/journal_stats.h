@@ -0,0 +1,88 @@
+/*  Copyright (C) 2024 CZ.NIC, z.s.p.o. <knot-dns@labs.nic.cz>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+
+#pragma once
+
+#include <stdint.h>
+#include <time.h>
+
+#include "contrib/atomic.h"
+
+/*!
+ * \brief Journal counters.
+ */
+typedef enum {
+	JOURNAL_STAT_CHANGESETS,     /*!< Inserted changesets. */
+	JOURNAL_STAT_CHANGESET_SIZE, /*!< Serialized size of the inserted changesets. */
+	JOURNAL_STAT_RRS,            /*!< Records in the inserted changesets. */
+	JOURNAL_STAT_WRITTEN,        /*!< Bytes written into chunks, including merges. */
+	JOURNAL_STAT_CHUNKS,         /*!< Chunks written, including merges. */
+	JOURNAL_STAT_MERGES,         /*!< Changeset merges. */
+	JOURNAL_STAT_FLUSHES,        /*!< Zone flushes requested due to occupation. */
+	JOURNAL_STAT_INSERT_TIME,    /*!< Total insert time in microseconds. */
+	JOURNAL_STAT_COMMITS,        /*!< Committed write transactions. */
+	JOURNAL_STAT_COMMIT_TIME,    /*!< Total commit time in microseconds. */
+	JOURNAL_STAT_COUNT
+} journal_stat_t;
+
+/*!
+ * \brief Journal latency histograms.
+ */
+typedef enum {
+	JOURNAL_HIST_INSERT,
+	JOURNAL_HIST_COMMIT,
+	JOURNAL_HIST_COUNT
+} journal_hist_t;
+
+/*! \brief Latency buckets: up to 1 ms, 10 ms, 100 ms, 1 s, and more. */
+#define JOURNAL_HIST_BUCKETS 5
+
+typedef struct {
+	knot_atomic_uint64_t ctr[JOURNAL_STAT_COUNT];
+	knot_atomic_uint64_t hist[JOURNAL_HIST_COUNT][JOURNAL_HIST_BUCKETS];
+} journal_stats_t;
+
+/*! \brief Statistics of all the journal operations. */
+extern journal_stats_t journal_stats;
+
+/*!
+ * \brief Increment a counter, both the global and the zone one.
+ *
+ * \param zone_stats   Per-zone statistics (can be NULL).
+ * \param ctr          Counter.
+ * \param val          Value to be added.
+ */
+void journal_stats_add(journal_stats_t *zone_stats, journal_stat_t ctr, uint64_t val);
+
+/*!
+ * \brief Account an operation duration into the total time and the histogram.
+ *
+ * \param zone_stats   Per-zone statistics (can be NULL).
+ * \param hist         Operation histogram.
+ * \param begin        Operation start time.
+ */
+void journal_stats_latency(journal_stats_t *zone_stats, journal_hist_t hist,
+                           const struct timespec *begin);
+
+/*! \brief Get the counter name. */
+const char *journal_stats_name(journal_stat_t ctr);
+
+/*! \brief Get the histogram name. */
+const char *journal_stats_hist_name(journal_hist_t hist);
+
+/*! \brief Get the histogram bucket name. */
+const char *journal_stats_bucket_name(unsigned bucket);
@@ -14,45 +14,292 @@
     along with this program.  If not, see <https://www.gnu.org/licenses/>.
  */
 
+#include <pthread.h>
+#include <string.h>
+#include <unistd.h>
+#ifdef ENABLE_ZSTD
+#include <zstd.h>
+#endif
+
 #include "knot/journal/journal_write.h"
 
 #include "contrib/macros.h"
 #include "contrib/time.h"
+#include "knot/common/probes.h"
 #include "knot/journal/journal_metadata.h"
 #include "knot/journal/journal_read.h"
 #include "knot/journal/serialization.h"
 #include "knot/zone/serial.h"
 #include "libknot/error.h"
 
+#ifdef ENABLE_ZSTD
+#define JOURNAL_ZSTD_LEVEL 3
+
+typedef struct {
+	ZSTD_CCtx *cctx;
+	uint8_t *raw;
+	uint8_t *packed;
+	size_t packed_max;
+} compress_ctx_t;
+
+static bool compress_init(compress_ctx_t *cc)
+{
+	cc->cctx = ZSTD_createCCtx();
+	cc->raw = malloc(JOURNAL_CHUNK_MAX - JOURNAL_HEADER_SIZE);
+	cc->packed_max = ZSTD_compressBound(JOURNAL_CHUNK_MAX - JOURNAL_HEADER_SIZE);
+	cc->packed = malloc(cc->packed_max);
+	return cc->cctx != NULL && cc->raw != NULL && cc->packed != NULL;
+}
+
+static void compress_deinit(compress_ctx_t *cc)
+{
+	ZSTD_freeCCtx(cc->cctx);
+	free(cc->raw);
+	free(cc->packed);
+}
+
+/*!
+ * Serializes the next chunk into the raw buffer and compresses it. Returns
+ * the payload to be stored, which is the raw one if compression doesn't pay off.
+ */
+static const uint8_t *compress_chunk(compress_ctx_t *cc, serialize_ctx_t *ser,
+                                     size_t *size, uint32_t *flags)
+{
+	serialize_chunk(ser, cc->raw, *size);
+	size_t ret = ZSTD_compressCCtx(cc->cctx, cc->packed, cc->packed_max,
+	                               cc->raw, *size, JOURNAL_ZSTD_LEVEL);
+	if (ZSTD_isError(ret) || ret >= *size) {
+		return cc->raw;
+	}
+	*size = ret;
+	*flags |= JOURNAL_CHUNK_COMPRESSED;
+	return cc->packed;
+}
+#endif
+
 static void journal_write_serialize(knot_lmdb_txn_t *txn, serialize_ctx_t *ser,
-                                    const knot_dname_t *apex, bool zij, uint32_t ch_from, uint32_t ch_to)
+                                    const knot_dname_t *apex, bool zij, uint32_t ch_from,
+                                    uint32_t ch_to, bool compress, journal_stats_t *stats)
 {
+#ifdef ENABLE_ZSTD
+	compress_ctx_t cc = { 0 };
+	if (compress && !compress_init(&cc)) {
+		compress = false; // fall back to uncompressed chunks
+	}
+#else
+	compress = false;
+#endif
 	MDB_val chunk;
 	uint32_t i = 0;
 	uint64_t now = knot_time();
 	while (serialize_unfinished(ser) && txn->ret == KNOT_EOK) {
+		size_t size;
 		serialize_prepare(ser, JOURNAL_CHUNK_THRESH - JOURNAL_HEADER_SIZE,
-		                  JOURNAL_CHUNK_MAX - JOURNAL_HEADER_SIZE, &chunk.mv_size);
-		if (chunk.mv_size == 0) {
+		                  JOURNAL_CHUNK_MAX - JOURNAL_HEADER_SIZE, &size);
+		if (size == 0) {
 			break; // beware! If this is omitted, it creates empty chunk => EMALF when reading.
 		}
-		chunk.mv_size += JOURNAL_HEADER_SIZE;
+		const uint8_t *payload = NULL;
+		uint32_t flags = 0;
+#ifdef ENABLE_ZSTD
+		if (compress) {
+			payload = compress_chunk(&cc, ser, &size, &flags);
+		}
+#endif
+		chunk.mv_size = JOURNAL_HEADER_SIZE + size;
 		chunk.mv_data = NULL;
 		MDB_val key = journal_make_chunk_key(apex, ch_from, zij, i);
 		if (knot_lmdb_insert(txn, &key, &chunk)) {
-			journal_make_header(chunk.mv_data, ch_to, now);
-			serialize_chunk(ser, chunk.mv_data + JOURNAL_HEADER_SIZE, chunk.mv_size - JOURNAL_HEADER_SIZE);
+			journal_make_header(chunk.mv_data, ch_to, now, flags);
+			if (payload != NULL) {
+				memcpy(chunk.mv_data + JOURNAL_HEADER_SIZE, payload, size);
+			} else {
+				serialize_chunk(ser, chunk.mv_data + JOURNAL_HEADER_SIZE, size);
+			}
 		}
 		free(key.mv_data);
+		journal_stats_add(stats, JOURNAL_STAT_WRITTEN, chunk.mv_size);
 		i++;
 	}
+	journal_stats_add(stats, JOURNAL_STAT_CHUNKS, i);
+#ifdef ENABLE_ZSTD
+	if (compress) {
+		compress_deinit(&cc);
+	}
+#endif
 	int ret = serialize_deinit(ser);
 	if (txn->ret == KNOT_EOK) {
 		txn->ret = ret;
 	}
 }
 
-void journal_write_changeset(knot_lmdb_txn_t *txn, const changeset_t *ch)
+/*!
+ * Zone serialized into chunk payloads ahead of the write transaction, so that
+ * the DB writer lock is held only for copying the chunks into the DB.
+ */
+typedef struct {
+	uint8_t *data;
+	size_t size;
+	uint32_t flags;
+} prepared_chunk_t;
+
+typedef struct {
+	prepared_chunk_t *chunks;
+	size_t count;
+} prepared_zone_t;
+
+#define PREPARED_COMPRESS_THREADS 4
+
+static void prepared_zone_free(prepared_zone_t *prep)
+{
+	for (size_t i = 0; i < prep->count; i++) {
+		free(prep->chunks[i].data);
+	}
+	free(prep->chunks);
+	memset(prep, 0, sizeof(*prep));
+}
+
+#ifdef ENABLE_ZSTD
+typedef struct {
+	prepared_zone_t *prep;
+	size_t first;
+	size_t step;
+	pthread_t thread;
+} compress_job_t;
+
+static void *compress_job(void *arg)
+{
+	compress_job_t *job = arg;
+	ZSTD_CCtx *cctx = ZSTD_createCCtx();
+	size_t packed_max = ZSTD_compressBound(JOURNAL_CHUNK_MAX - JOURNAL_HEADER_SIZE);
+	uint8_t *packed = malloc(packed_max);
+
+	for (size_t i = job->first; cctx != NULL && packed != NULL &&
+	     i < job->prep->count; i += job->step) {
+		prepared_chunk_t *chunk = &job->prep->chunks[i];
+		size_t ret = ZSTD_compressCCtx(cctx, packed, packed_max, chunk->data,
+		                               chunk->size, JOURNAL_ZSTD_LEVEL);
+		if (ZSTD_isError(ret) || ret >= chunk->size) {
+			continue; // Keep the raw chunk if compression doesn't pay off.
+		}
+		memcpy(chunk->data, packed, ret);
+		chunk->size = ret;
+		chunk->flags |= JOURNAL_CHUNK_COMPRESSED;
+	}
+
+	ZSTD_freeCCtx(cctx);
+	free(packed);
+	return NULL;
+}
+
+static void compress_prepared(prepared_zone_t *prep)
+{
+	long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+	cpus = MAX(cpus, 1);
+	size_t threads = MIN(cpus, PREPARED_COMPRESS_THREADS);
+	threads = MIN(threads, prep->count);
+
+	compress_job_t jobs[PREPARED_COMPRESS_THREADS] = { 0 };
+	for (size_t i = 0; i < threads; i++) {
+		jobs[i] = (compress_job_t){ .prep = prep, .first = i, .step = threads };
+	}
+
+	// The first job runs in the calling thread, as do the jobs failed to start.
+	bool started[PREPARED_COMPRESS_THREADS] = { false };
+	for (size_t i = 1; i < threads; i++) {
+		started[i] = (pthread_create(&jobs[i].thread, NULL, compress_job, &jobs[i]) == 0);
+	}
+	for (size_t i = 0; i < threads; i++) {
+		if (i == 0 || !started[i]) {
+			(void)compress_job(&jobs[i]);
+		}
+	}
+	for (size_t i = 1; i < threads; i++) {
+		if (started[i]) {
+			(void)pthread_join(jobs[i].thread, NULL);
+		}
+	}
+}
+#endif
+
+static int prepare_zone(const zone_contents_t *z, bool compress, prepared_zone_t *prep)
+{
+	memset(prep, 0, sizeof(*prep));
+
+	serialize_ctx_t *ser = serialize_zone_init(z);
+	if (ser == NULL) {
+		return KNOT_ENOMEM;
+	}
+
+	int ret = KNOT_EOK;
+	size_t alloc = 0;
+	while (serialize_unfinished(ser)) {
+		size_t size;
+		serialize_prepare(ser, JOURNAL_CHUNK_THRESH - JOURNAL_HEADER_SIZE,
+		                  JOURNAL_CHUNK_MAX - JOURNAL_HEADER_SIZE, &size);
+		if (size == 0) {
+			break; // Avoid creating an empty chunk, see journal_write_serialize().
+		}
+		if (prep->count == alloc) {
+			size_t new_alloc = MAX(2 * alloc, 16);
+			void *tmp = realloc(prep->chunks, new_alloc * sizeof(*prep->chunks));
+			if (tmp == NULL) {
+				ret = KNOT_ENOMEM;
+				break;
+			}
+			prep->chunks = tmp;
+			alloc = new_alloc;
+		}
+		uint8_t *data = malloc(size);
+		if (data == NULL) {
+			ret = KNOT_ENOMEM;
+			break;
+		}
+		serialize_chunk(ser, data, size);
+		prep->chunks[prep->count].data = data;
+		prep->chunks[prep->count].size = size;
+		prep->chunks[prep->count].flags = 0;
+		prep->count++;
+	}
+
+	int ser_ret = serialize_deinit(ser);
+	if (ret == KNOT_EOK) {
+		ret = ser_ret;
+	}
+	if (ret != KNOT_EOK) {
+		prepared_zone_free(prep);
+		return ret;
+	}
+
+#ifdef ENABLE_ZSTD
+	if (compress) {
+		compress_prepared(prep);
+	}
+#endif
+	return KNOT_EOK;
+}
+
+static void write_prepared_zone(knot_lmdb_txn_t *txn, const prepared_zone_t *prep,
+                                const knot_dname_t *apex, uint32_t serial,
+                                journal_stats_t *stats)
+{
+	uint64_t now = knot_time();
+	for (uint32_t i = 0; i < prep->count && txn->ret == KNOT_EOK; i++) {
+		MDB_val chunk = { JOURNAL_HEADER_SIZE + prep->chunks[i].size, NULL };
+		MDB_val key = journal_make_chunk_key(apex, 0, true, i);
+		if (knot_lmdb_insert(txn, &key, &chunk)) {
+			journal_make_header(chunk.mv_data, serial, now, prep->chunks[i].flags);
+			memcpy(chunk.mv_data + JOURNAL_HEADER_SIZE, prep->chunks[i].data,
+			       prep->chunks[i].size);
+		}
+		free(key.mv_data);
+		journal_stats_add(stats, JOURNAL_STAT_WRITTEN, chunk.mv_size);
+	}
+	journal_stats_add(stats, JOURNAL_STAT_CHUNKS, prep->count);
+}
+
+void journal_write_changeset(knot_lmdb_txn_t *txn, const changeset_t *ch, bool compress,
+                             journal_stats_t *stats)
 {
 	serialize_ctx_t *ser = serialize_init(ch);
 	if (ser == NULL) {
@@ -60,30 +307,38 @@ void journal_write_changeset(knot_lmdb_txn_t *txn, const changeset_t *ch)
 		return;
 	}
 	if (ch->remove == NULL) {
-		journal_write_serialize(txn, ser, ch->soa_to->owner, true, 0, changeset_to(ch));
+		journal_write_serialize(txn, ser, ch->soa_to->owner, true, 0,
+		                        changeset_to(ch), compress, stats);
 	} else {
-		journal_write_serialize(txn, ser, ch->soa_to->owner, false, changeset_from(ch), changeset_to(ch));
+		journal_write_serialize(txn, ser, ch->soa_to->owner, false, changeset_from(ch),
+		                        changeset_to(ch), compress, stats);
 	}
 }
 
-void journal_write_zone(knot_lmdb_txn_t *txn, const zone_contents_t *z)
+void journal_write_zone(knot_lmdb_txn_t *txn, const zone_contents_t *z, bool compress,
+                        journal_stats_t *stats)
 {
-	serialize_ctx_t *ser = serialize_zone_init(z);
-	if (ser == NULL) {
-		txn->ret = KNOT_ENOMEM;
+	if (txn->ret != KNOT_EOK) {
 		return;
 	}
-	journal_write_serialize(txn, ser, z->apex->owner, true, 0, zone_contents_serial(z));
+	prepared_zone_t prep;
+	txn->ret = prepare_zone(z, compress, &prep);
+	if (txn->ret == KNOT_EOK) {
+		write_prepared_zone(txn, &prep, z->apex->owner, zone_contents_serial(z), stats);
+		prepared_zone_free(&prep);
+	}
 }
 
-void journal_write_zone_diff(knot_lmdb_txn_t *txn, const zone_diff_t *z)
+void journal_write_zone_diff(knot_lmdb_txn_t *txn, const zone_diff_t *z, bool compress,
+                             journal_stats_t *stats)
 {
 	serialize_ctx_t *ser = serialize_zone_diff_init(z);
 	if (ser == NULL) {
 		txn->ret = KNOT_ENOMEM;
 		return;
 	}
-	journal_write_serialize(txn, ser, z->apex->owner, false, zone_diff_from(z), zone_diff_to(z));
+	journal_write_serialize(txn, ser, z->apex->owner, false, zone_diff_from(z),
+	                        zone_diff_to(z), compress, stats);
 }
 
 static bool delete_one(knot_lmdb_txn_t *txn, bool del_zij, uint32_t del_serial,
@@ -136,8 +391,9 @@ void journal_merge(zone_journal_t j, knot_lmdb_txn_t *txn, bool merge_zij,
 		assert(del_next_serial == *original_serial_to);
 	}
 
-	journal_write_changeset(txn, &merge);
+	journal_write_changeset(txn, &merge, journal_conf_compress(j), j.stats);
 	journal_read_clear_changeset(&merge);
+	journal_stats_add(j.stats, JOURNAL_STAT_MERGES, 1);
 }
 
 static void delete_merged(knot_lmdb_txn_t *txn, const knot_dname_t *zone,
@@ -169,6 +425,16 @@ bool journal_delete(knot_lmdb_txn_t *txn, uint32_t from, const knot_dname_t *zon
 	return (*freed_count > 0);
 }
 
+void journal_commit(knot_lmdb_txn_t *txn, journal_stats_t *stats)
+{
+	struct timespec begin = time_now();
+	KNOTD_PROBE(journal__commit__begin);
+	knot_lmdb_commit(txn);
+	KNOTD_PROBE1(journal__commit__end, txn->ret);
+	journal_stats_add(stats, JOURNAL_STAT_COMMITS, 1);
+	journal_stats_latency(stats, JOURNAL_HIST_COMMIT, &begin);
+}
+
 void journal_try_flush(zone_journal_t j, knot_lmdb_txn_t *txn, journal_metadata_t *md)
 {
 	bool flush = journal_allow_flush(j);
@@ -195,7 +461,8 @@ void journal_try_flush(zone_journal_t j, knot_lmdb_txn_t *txn, journal_metadata_
 
 		// commit partial job and ask zone to flush itself
 		journal_store_metadata(txn, j.zone, md);
-		knot_lmdb_commit(txn);
+		journal_commit(txn, j.stats);
+		journal_stats_add(j.stats, JOURNAL_STAT_FLUSHES, 1);
 		if (txn->ret == KNOT_EOK) {
 			txn->ret = KNOT_EBUSY;
 		}
@@ -247,13 +514,25 @@ int journal_insert_zone(zone_journal_t j, const zone_contents_t *z)
 	if (ret != KNOT_EOK) {
 		return ret;
 	}
+	struct timespec begin = time_now();
+
+	// Serialize before the write transaction not to block other writers meanwhile.
+	prepared_zone_t prep;
+	ret = prepare_zone(z, journal_conf_compress(j), &prep);
+	if (ret != KNOT_EOK) {
+		return ret;
+	}
+
 	knot_lmdb_txn_t txn = { 0 };
 	knot_lmdb_begin(j.db, &txn, true);
 
 	update_last_inserter(&txn, j.zone);
 	journal_del_zone_txn(&txn, j.zone);
 
-	journal_write_zone(&txn, z);
+	if (txn.ret == KNOT_EOK) {
+		write_prepared_zone(&txn, &prep, z->apex->owner, zone_contents_serial(z), j.stats);
+	}
+	prepared_zone_free(&prep);
 
 	journal_metadata_t md = { 0 };
 	md.flags = JOURNAL_SERIAL_TO_VALID;
@@ -261,15 +540,18 @@ int journal_insert_zone(zone_journal_t j, const zone_contents_t *z)
 	md.first_serial = md.serial_to;
 	journal_store_metadata(&txn, j.zone, &md);
 
-	knot_lmdb_commit(&txn);
+	journal_commit(&txn, j.stats);
+	journal_stats_latency(j.stats, JOURNAL_HIST_INSERT, &begin);
 	return txn.ret;
 }
 
-int journal_insert(zone_journal_t j, const changeset_t *ch, const changeset_t *extra,
-                   const zone_diff_t *zdiff)
+int journal_insert_txn(zone_journal_t j, knot_lmdb_txn_t *txn, const changeset_t *ch,
+                       const changeset_t *extra, const zone_diff_t *zdiff)
 {
 	assert(zdiff == NULL || (ch == NULL && extra == NULL));
 
+	struct timespec begin = time_now();
+
 	size_t ch_size = zdiff == NULL ? changeset_serialized_size(ch) :
 	                                 zone_diff_serialized_size(*zdiff);
 	size_t max_usage = journal_conf_max_usage(j);
@@ -288,23 +570,17 @@ int journal_insert(zone_journal_t j, const changeset_t *ch, const changeset_t *e
 	    (extra != NULL && serial_compare(extra_from, extra_to) != SERIAL_LOWER)) {
 		return KNOT_ESEMCHECK;
 	}
-	int ret = knot_lmdb_open(j.db);
-	if (ret != KNOT_EOK) {
-		return ret;
-	}
-	knot_lmdb_txn_t txn = { 0 };
 	journal_metadata_t md = { 0 };
-	knot_lmdb_begin(j.db, &txn, true);
-	journal_load_metadata(&txn, j.zone, &md);
+	journal_load_metadata(txn, j.zone, &md);
 
-	update_last_inserter(&txn, j.zone);
+	update_last_inserter(txn, j.zone);
 
 	if (extra != NULL) {
-		if (journal_contains(&txn, true, 0, j.zone)) {
-			txn.ret = KNOT_ESEMCHECK;
+		if (journal_contains(txn, true, 0, j.zone)) {
+			txn->ret = KNOT_ESEMCHECK;
 		}
 		uint64_t merged_freed = 0;
-		delete_merged(&txn, j.zone, &md, &merged_freed);
+		delete_merged(txn, j.zone, &md, &merged_freed);
 		ch_size += changeset_serialized_size(extra);
 		ch_size -= merged_freed;
 		md.flushed_upto = md.serial_to; // set temporarily
@@ -312,36 +588,61 @@ int journal_insert(zone_journal_t j, const changeset_t *ch, const changeset_t *e
 	}
 
 	size_t chs_limit = journal_conf_max_changesets(j);
-	journal_fix_occupation(j, &txn, &md, max_usage - ch_size, chs_limit - 1);
+	journal_fix_occupation(j, txn, &md, max_usage - ch_size, chs_limit - 1);
 
 	// avoid discontinuity
 	if ((md.flags & JOURNAL_SERIAL_TO_VALID) && md.serial_to != ch_from) {
-		if (journal_contains(&txn, true, 0, j.zone)) {
-			txn.ret = KNOT_ESEMCHECK;
+		if (journal_contains(txn, true, 0, j.zone)) {
+			txn->ret = KNOT_ESEMCHECK;
 		} else {
-			journal_del_zone_txn(&txn, j.zone);
+			journal_del_zone_txn(txn, j.zone);
 			memset(&md, 0, sizeof(md));
 		}
 	}
 
 	// avoid cycle
-	if (journal_contains(&txn, false, ch_to, j.zone)) {
-		journal_fix_occupation(j, &txn, &md, INT64_MAX, 1);
+	if (journal_contains(txn, false, ch_to, j.zone)) {
+		journal_fix_occupation(j, txn, &md, INT64_MAX, 1);
 	}
 
+	bool compress = journal_conf_compress(j);
 	if (zdiff == NULL) {
-		journal_write_changeset(&txn, ch);
+		journal_write_changeset(txn, ch, compress, j.stats);
+		journal_stats_add(j.stats, JOURNAL_STAT_RRS, changeset_size(ch));
 	} else {
-		journal_write_zone_diff(&txn, zdiff);
+		journal_write_zone_diff(txn, zdiff, compress, j.stats);
 	}
 	journal_metadata_after_insert(&md, ch_from, ch_to);
 
 	if (extra != NULL) {
-		journal_write_changeset(&txn, extra);
+		journal_write_changeset(txn, extra, compress, j.stats);
 		journal_metadata_after_extra(&md, extra_from, extra_to);
 	}
 
-	journal_store_metadata(&txn, j.zone, &md);
-	knot_lmdb_commit(&txn);
+	journal_store_metadata(txn, j.zone, &md);
+
+	if (txn->ret == KNOT_EOK) {
+		journal_stats_add(j.stats, JOURNAL_STAT_CHANGESETS, 1);
+		journal_stats_add(j.stats, JOURNAL_STAT_CHANGESET_SIZE, ch_size);
+		journal_stats_latency(j.stats, JOURNAL_HIST_INSERT, &begin);
+	}
+	return txn->ret;
+}
+
+int journal_insert(zone_journal_t j, const changeset_t *ch, const changeset_t *extra,
+                   const zone_diff_t *zdiff)
+{
+	int ret = knot_lmdb_open(j.db);
+	if (ret != KNOT_EOK) {
+		return ret;
+	}
+	knot_lmdb_txn_t txn = { 0 };
+	knot_lmdb_begin(j.db, &txn, true);
+	ret = journal_insert_txn(j, &txn, ch, extra, zdiff);
+	if (ret != KNOT_EOK) {
+		knot_lmdb_abort(&txn);
+		return ret;
+	}
+	journal_commit(&txn, j.stats);
 	return txn.ret;
 }
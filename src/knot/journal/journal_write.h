@@ -23,18 +23,24 @@
 /*!
  * \brief Serialize a changeset into chunks and write it into DB with no checks and metadata update.
  *
- * \param txn   Journal DB transaction.
- * \param ch    Changeset to be written.
+ * \param txn        Journal DB transaction.
+ * \param ch         Changeset to be written.
+ * \param compress   Compress the chunks if supported.
+ * \param stats      Per-zone statistics (can be NULL).
  */
-void journal_write_changeset(knot_lmdb_txn_t *txn, const changeset_t *ch);
+void journal_write_changeset(knot_lmdb_txn_t *txn, const changeset_t *ch, bool compress,
+                             journal_stats_t *stats);
 
 /*!
  * \brief Serialize zone contents aka "bootstrap" changeset into journal, no checks.
  *
- * \param txn   Journal DB transaction.
- * \param z     Zone contents to be written.
+ * \param txn        Journal DB transaction.
+ * \param z          Zone contents to be written.
+ * \param compress   Compress the chunks if supported.
+ * \param stats      Per-zone statistics (can be NULL).
  */
-void journal_write_zone(knot_lmdb_txn_t *txn, const zone_contents_t *z);
+void journal_write_zone(knot_lmdb_txn_t *txn, const zone_contents_t *z, bool compress,
+                        journal_stats_t *stats);
 
 /*!
  * \brief Merge all following changeset into one of journal changeset.
@@ -69,6 +75,14 @@ bool journal_delete(knot_lmdb_txn_t *txn, uint32_t from, const knot_dname_t *zon
                     uint64_t tofree_size, size_t tofree_count, uint32_t stop_at_serial,
                     uint64_t *freed_size, size_t *freed_count, uint32_t *stopped_at);
 
+/*!
+ * \brief Commit journal DB transaction and account it into statistics.
+ *
+ * \param txn     Journal DB transaction.
+ * \param stats   Per-zone statistics (can be NULL).
+ */
+void journal_commit(knot_lmdb_txn_t *txn, journal_stats_t *stats);
+
 /*!
  * \brief Perform a merge or zone flush in order to enable deleting more changesets.
  *
@@ -119,3 +133,23 @@ int journal_insert_zone(zone_journal_t j, const zone_contents_t *z);
  */
 int journal_insert(zone_journal_t j, const changeset_t *ch, const changeset_t *extra,
                    const zone_diff_t *zdiff);
+
+/*!
+ * \brief Store changeset into journal within an open read-write transaction.
+ *
+ * Same as journal_insert(), but the transaction is neither begun nor committed,
+ * so that several zones' changesets can be stored in one transaction.
+ *
+ * \param j       Zone journal.
+ * \param txn     Journal DB read-write transaction.
+ * \param ch      Changeset to be stored.
+ * \param extra   Extra changeset to be stored in the role of merged changeset.
+ * \param zdiff   Zone diff to be stored instead of changeset.
+ *
+ * \note The transaction is left untouched if the changeset is rejected by
+ *       the initial checks, otherwise any error is also in txn->ret.
+ *
+ * \return KNOT_E*
+ */
+int journal_insert_txn(zone_journal_t j, knot_lmdb_txn_t *txn, const changeset_t *ch,
+                       const changeset_t *extra, const zone_diff_t *zdiff);
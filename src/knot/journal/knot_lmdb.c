@@ -24,7 +24,9 @@
 
 #include "knot/conf/conf.h"
 #include "contrib/files.h"
+#include "contrib/string.h"
 #include "contrib/time.h"
+#include "contrib/tolower.h"
 #include "contrib/wire_ctx.h"
 #include "libknot/dname.h"
 #include "libknot/endian.h"
@@ -74,11 +76,13 @@ void knot_lmdb_init(knot_lmdb_db_t *db, const char *path, size_t mapsize, unsign
 	env_flags |= MDB_WRITEMAP;
 #endif
 	db->env = NULL;
-	db->path = strdup(path);
+	db->path = (path != NULL) ? strdup(path) : NULL;
 	db->mapsize = mapsize;
 	db->env_flags = env_flags;
 	db->dbname = dbname;
 	pthread_mutex_init(&db->opening_mutex, NULL);
+	pthread_mutex_init(&db->write_mutex, NULL);
+	pthread_rwlock_init(&db->swap_lock, NULL);
 	db->maxdbs = 2;
 	db->maxreaders = conf_lmdb_readers(conf());
 	db->last_readlock_clean = 0;
@@ -97,6 +101,30 @@ static int lmdb_stat(const char *lmdb_path, struct stat *st)
 	}
 }
 
+unsigned knot_lmdb_shard(const uint8_t *zone, unsigned count)
+{
+	if (count <= 1) {
+		return 0;
+	}
+
+	// FNV-1a, stable across restarts as the zones must stay in their shards.
+	uint32_t hash = 2166136261u;
+	for (size_t i = 0; i < knot_dname_size(zone); i++) {
+		hash = (hash ^ knot_tolower(zone[i])) * 16777619u;
+	}
+
+	return hash % count;
+}
+
+char *knot_lmdb_shard_path(const char *path, unsigned shard, unsigned count)
+{
+	if (count <= 1) {
+		return strdup(path);
+	}
+
+	return sprintf_alloc("%s/shard%u", path, shard);
+}
+
 int knot_lmdb_exists(knot_lmdb_db_t *db)
 {
 	if (db->env != NULL) {
@@ -274,12 +302,93 @@ int knot_lmdb_reconfigure(knot_lmdb_db_t *db, const char *path, size_t mapsize,
 void knot_lmdb_deinit(knot_lmdb_db_t *db)
 {
 	knot_lmdb_close(db);
+	pthread_rwlock_destroy(&db->swap_lock);
+	pthread_mutex_destroy(&db->write_mutex);
 	pthread_mutex_destroy(&db->opening_mutex);
 	free(db->path);
 }
 
+#define COMPACT_DIR        "compact"
+#define COMPACT_SWAP_WAIT  5000 // Maximal wait for running transactions in milliseconds.
+
+static int compact_swap(knot_lmdb_db_t *db, const char *copy_dir)
+{
+	char from[strlen(copy_dir) + 10], to[strlen(db->path) + 10];
+	(void)snprintf(from, sizeof(from), "%s/data.mdb", copy_dir);
+	(void)snprintf(to, sizeof(to), "%s/data.mdb", db->path);
+
+	// New transactions are blocked, wait for the running ones to finish.
+	int wait = 0;
+	while (pthread_rwlock_trywrlock(&db->swap_lock) != 0) {
+		if (wait++ >= COMPACT_SWAP_WAIT) {
+			return KNOT_ETIMEOUT;
+		}
+		usleep(1000);
+	}
+
+	pthread_mutex_lock(&db->opening_mutex);
+	lmdb_close(db);
+	int ret = (rename(from, to) == 0) ? KNOT_EOK : knot_map_errno();
+	int ret2 = lmdb_open(db);
+	pthread_mutex_unlock(&db->opening_mutex);
+
+	pthread_rwlock_unlock(&db->swap_lock);
+
+	return ret == KNOT_EOK ? ret2 : ret;
+}
+
+int knot_lmdb_compact(knot_lmdb_db_t *db, size_t *size_before, size_t *size_after)
+{
+	struct stat st;
+	int ret = lmdb_stat(db->path, &st);
+	if (ret != KNOT_EOK) {
+		return (ret == KNOT_ENODB) ? KNOT_EOK : ret; // Nothing to compact.
+	}
+	if (size_before != NULL) {
+		*size_before = st.st_size;
+	}
+
+	ret = knot_lmdb_open(db);
+	if (ret != KNOT_EOK) {
+		return ret;
+	}
+
+	char *copy_dir = sprintf_alloc("%s/%s", db->path, COMPACT_DIR);
+	if (copy_dir == NULL) {
+		return KNOT_ENOMEM;
+	}
+
+	// No writers during the copy, so that nothing is lost by the swap.
+	pthread_mutex_lock(&db->write_mutex);
+	(void)remove_path(copy_dir, false);
+	ret = make_dir(copy_dir, LMDB_DIR_MODE, true);
+	if (ret == KNOT_EOK) {
+		ret = mdb_env_copy2(db->env, copy_dir, MDB_CP_COMPACT);
+		err_to_knot(&ret);
+	}
+	if (ret == KNOT_EOK) {
+		ret = compact_swap(db, copy_dir);
+	}
+	(void)remove_path(copy_dir, false);
+	pthread_mutex_unlock(&db->write_mutex);
+
+	free(copy_dir);
+
+	if (ret == KNOT_EOK && size_after != NULL) {
+		ret = lmdb_stat(db->path, &st);
+		*size_after = st.st_size;
+	}
+
+	return ret;
+}
+
 void knot_lmdb_begin(knot_lmdb_db_t *db, knot_lmdb_txn_t *txn, bool rw)
 {
+	if (rw) {
+		pthread_mutex_lock(&db->write_mutex);
+	}
+	pthread_rwlock_rdlock(&db->swap_lock);
+
 	uint64_t next_readlock_clean = db->last_readlock_clean + READER_LOCK_CLEAN_MAX_FREQ, now = knot_time();
 	if (rw && next_readlock_clean < now) { // Cleaning up reader lock table can be done occasionally. Opening a RW txn seems a good occasion.
 		int cleared = 0, _unused_ ret = mdb_reader_check(db->env, &cleared);
@@ -292,6 +401,19 @@ void knot_lmdb_begin(knot_lmdb_db_t *db, knot_lmdb_txn_t *txn, bool rw)
 		txn->opened = true;
 		txn->db = db;
 		txn->is_rw = rw;
+	} else {
+		pthread_rwlock_unlock(&db->swap_lock);
+		if (rw) {
+			pthread_mutex_unlock(&db->write_mutex);
+		}
+	}
+}
+
+static void txn_unlock(knot_lmdb_txn_t *txn)
+{
+	pthread_rwlock_unlock(&txn->db->swap_lock);
+	if (txn->is_rw) {
+		pthread_mutex_unlock(&txn->db->write_mutex);
 	}
 }
 
@@ -304,6 +426,7 @@ void knot_lmdb_abort(knot_lmdb_txn_t *txn)
 		}
 		mdb_txn_abort(txn->txn);
 		txn->opened = false;
+		txn_unlock(txn);
 	}
 }
 
@@ -331,6 +454,7 @@ void knot_lmdb_commit(knot_lmdb_txn_t *txn)
 	txn->ret = mdb_txn_commit(txn->txn);
 	err_to_knot(&txn->ret);
 	txn->opened = false;
+	txn_unlock(txn);
 }
 
 // save the programmer's frequent checking for ENOMEM when creating search keys
@@ -578,6 +702,72 @@ int knot_lmdb_copy_prefixes(knot_lmdb_db_t *from, knot_lmdb_db_t *to,
 	return ret == KNOT_EOK ? tw.ret : ret;
 }
 
+/*! \brief Check if both DBs contain the same records matching the prefix. */
+static bool prefix_equal(knot_lmdb_txn_t *a, knot_lmdb_txn_t *b, MDB_val *prefix)
+{
+	bool in_a = knot_lmdb_find(a, prefix, KNOT_LMDB_GEQ) &&
+	            knot_lmdb_is_prefix_of(prefix, &a->cur_key);
+	bool in_b = knot_lmdb_find(b, prefix, KNOT_LMDB_GEQ) &&
+	            knot_lmdb_is_prefix_of(prefix, &b->cur_key);
+	while (in_a && in_b) {
+		if (a->cur_key.mv_size != b->cur_key.mv_size ||
+		    a->cur_val.mv_size != b->cur_val.mv_size ||
+		    memcmp(a->cur_key.mv_data, b->cur_key.mv_data, a->cur_key.mv_size) != 0 ||
+		    memcmp(a->cur_val.mv_data, b->cur_val.mv_data, a->cur_val.mv_size) != 0) {
+			return false;
+		}
+		in_a = knot_lmdb_next(a) && knot_lmdb_is_prefix_of(prefix, &a->cur_key);
+		in_b = knot_lmdb_next(b) && knot_lmdb_is_prefix_of(prefix, &b->cur_key);
+	}
+	return !in_a && !in_b && a->ret == KNOT_EOK && b->ret == KNOT_EOK;
+}
+
+int knot_lmdb_sync_prefixes(knot_lmdb_db_t *from, knot_lmdb_db_t *to,
+                            MDB_val *prefixes, size_t n_prefixes)
+{
+	if (n_prefixes < 1) {
+		return KNOT_EOK;
+	}
+	if (from == NULL || to == NULL || prefixes == NULL) {
+		return KNOT_EINVAL;
+	}
+	int ret = knot_lmdb_open(from);
+	if (ret == KNOT_EOK) {
+		ret = knot_lmdb_open(to);
+	}
+	if (ret != KNOT_EOK) {
+		return ret;
+	}
+
+	bool changed[n_prefixes];
+	size_t n_changed = 0;
+
+	knot_lmdb_txn_t tr = { 0 }, tc = { 0 };
+	knot_lmdb_begin(from, &tr, false);
+	knot_lmdb_begin(to, &tc, false);
+	for (size_t i = 0; i < n_prefixes; i++) {
+		changed[i] = !prefix_equal(&tr, &tc, &prefixes[i]);
+		n_changed += changed[i];
+	}
+	knot_lmdb_abort(&tc);
+
+	if (n_changed == 0 || tr.ret != KNOT_EOK) {
+		knot_lmdb_commit(&tr);
+		return tr.ret;
+	}
+
+	knot_lmdb_txn_t tw = { 0 };
+	knot_lmdb_begin(to, &tw, true);
+	for (size_t i = 0; i < n_prefixes && ret == KNOT_EOK; i++) {
+		if (changed[i]) {
+			ret = knot_lmdb_copy_prefix(&tr, &tw, &prefixes[i]);
+		}
+	}
+	knot_lmdb_commit(&tw);
+	knot_lmdb_commit(&tr);
+	return ret == KNOT_EOK ? tw.ret : ret;
+}
+
 size_t knot_lmdb_usage(knot_lmdb_txn_t *txn)
 {
 	if (!txn_semcheck(txn)) {
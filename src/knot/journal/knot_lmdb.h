@@ -27,6 +27,8 @@ typedef struct knot_lmdb_db {
 	MDB_dbi dbi;
 	MDB_env *env;
 	pthread_mutex_t opening_mutex;
+	pthread_mutex_t write_mutex;  // held by RW transactions and by compaction
+	pthread_rwlock_t swap_lock;   // held by all transactions, exclusively by compaction
 
 	// those are static options. Set them after knot_lmdb_init().
 	unsigned maxdbs;
@@ -86,6 +88,35 @@ typedef bool (*knot_lmdb_copy_cb)(MDB_val *cur_key, MDB_val *cur_val);
  */
 void knot_lmdb_init(knot_lmdb_db_t *db, const char *path, size_t mapsize, unsigned env_flags, const char *dbname);
 
+/*!
+ * \brief Maximal number of LMDB environments a database can be sharded into.
+ */
+#define KNOT_LMDB_SHARDS_MAX 64
+
+/*!
+ * \brief Get the shard of a zone in a database sharded by zone name hash.
+ *
+ * \param zone    Zone name (the leading part of the keys).
+ * \param count   Number of shards.
+ *
+ * \return Shard index lower than count.
+ */
+unsigned knot_lmdb_shard(const uint8_t *zone, unsigned count);
+
+/*!
+ * \brief Get the path of a shard environment.
+ *
+ * The shards are subdirectories of the database path, a single shard
+ * is the database path itself.
+ *
+ * \param path    Database path.
+ * \param shard   Shard index.
+ * \param count   Number of shards.
+ *
+ * \return Allocated path, or NULL.
+ */
+char *knot_lmdb_shard_path(const char *path, unsigned shard, unsigned count);
+
 /*!
  * \brief Check if the database exists on the filesystem.
  *
@@ -157,6 +188,22 @@ int knot_lmdb_reconfigure(knot_lmdb_db_t *db, const char *path, size_t mapsize,
  */
 void knot_lmdb_deinit(knot_lmdb_db_t *db);
 
+/*!
+ * \brief Replace the DB with its compacted copy.
+ *
+ * The writers are blocked while the copy is being written, the readers
+ * are served from the original DB. Then all the transactions are awaited
+ * and the copy is swapped in.
+ *
+ * \param db            DB to be compacted.
+ * \param size_before   Optional output: DB file size before compaction.
+ * \param size_after    Optional output: DB file size after compaction.
+ *
+ * \retval KNOT_ETIMEOUT if some transaction prevented the swap too long.
+ * \return KNOT_E*
+ */
+int knot_lmdb_compact(knot_lmdb_db_t *db, size_t *size_before, size_t *size_after);
+
 /*!
  * \brief Return true if DB is open.
  */
@@ -382,6 +429,22 @@ int knot_lmdb_copy_prefix(knot_lmdb_txn_t *from, knot_lmdb_txn_t *to, MDB_val *p
 int knot_lmdb_copy_prefixes(knot_lmdb_db_t *from, knot_lmdb_db_t *to,
                             MDB_val *prefixes, size_t n_prefixes);
 
+/*!
+ * \brief Copy records matching the prefixes, skipping the prefixes with equal records.
+ *
+ * Same as knot_lmdb_copy_prefixes(), but no write transaction is made if
+ * the target DB already contains the same data.
+ *
+ * \param from        DB to copy from.
+ * \param to          DB to copy to.
+ * \param prefixes    List of prefixes to match.
+ * \param n_prefixes  Number of prefixes in the list.
+ *
+ * \return KNOT_E*
+ */
+int knot_lmdb_sync_prefixes(knot_lmdb_db_t *from, knot_lmdb_db_t *to,
+                            MDB_val *prefixes, size_t n_prefixes);
+
 /*!
  * \brief Amount of bytes used by the DB storage.
  *
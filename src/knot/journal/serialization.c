@@ -462,6 +462,8 @@ int deserialize_rrset(wire_ctx_t *wire, knot_rrset_t *rrset)
 	}
 	knot_rrset_init(rrset, owner, type, rclass, 0);
 
+	knot_rdataset_builder_t builder;
+	knot_rdataset_builder_init(&builder, NULL);
 	for (size_t phase = 0; phase < rrcount && wire_ctx_available(wire) > 0; phase++) {
 		uint32_t ttl = wire_ctx_read_u32(wire);
 		uint32_t rdata_size = wire_ctx_read_u16(wire);
@@ -470,8 +472,9 @@ int deserialize_rrset(wire_ctx_t *wire, knot_rrset_t *rrset)
 		}
 		if (wire->error != KNOT_EOK ||
 		    wire_ctx_available(wire) < rdata_size ||
-		    knot_rrset_add_rdata(rrset, wire->position, rdata_size,
-					 NULL) != KNOT_EOK) {
+		    knot_rdataset_builder_add(&builder, wire->position,
+		                              rdata_size) != KNOT_EOK) {
+			knot_rdataset_builder_clear(&builder);
 			knot_rrset_clear(rrset, NULL);
 			return KNOT_EMALF;
 		}
@@ -479,6 +482,12 @@ int deserialize_rrset(wire_ctx_t *wire, knot_rrset_t *rrset)
 		assert(wire->error == KNOT_EOK);
 	}
 
+	if (knot_rdataset_builder_finish(&builder, &rrset->rrs) != KNOT_EOK) {
+		knot_rdataset_builder_clear(&builder);
+		knot_rrset_clear(rrset, NULL);
+		return KNOT_ENOMEM;
+	}
+
 	return KNOT_EOK;
 }
 
@@ -21,11 +21,15 @@
 #include "knot/include/module.h"
 #include "libknot/libknot.h"
 #include "contrib/atomic.h"
+#include "contrib/macros.h"
+#include "contrib/sockaddr.h"
 #include "contrib/threads.h"
 #include "contrib/string.h"
 #include "libdnssec/random.h"
 
 #define BADCOOKIE_CTR_INIT	1
+#define VALID_CACHE_SIZE	1024 // Per thread.
+#define CACHED_SRVR_SIZE	16   // Server cookie version 1 length.
 
 #define MOD_SECRET_LIFETIME "\x0F""secret-lifetime"
 #define MOD_BADCOOKIE_SLIP  "\x0E""badcookie-slip"
@@ -59,16 +63,30 @@ int cookies_conf_check(knotd_conf_check_args_t *args)
 	return KNOT_EOK;
 }
 
+/*!
+ * Recently validated cookie of a client. A query with the same client
+ * address, client cookie, and server cookie is valid without the server
+ * cookie recomputation as long as the validating secret is in use.
+ */
+typedef struct {
+	uint8_t addr[16];
+	uint8_t addr_len;  // 0 if empty.
+	uint8_t cc[KNOT_EDNS_COOKIE_CLNT_SIZE];
+	uint8_t sc[CACHED_SRVR_SIZE];
+	uint64_t secret;   // Variable part of the validating secret.
+} valid_cookie_t;
+
 typedef struct {
 	struct {
 		knot_atomic_uint64_t variable;
 		uint64_t constant;
-	} secret[2];
+	} secret[2]; // Current and previous one.
 	pthread_t update_secret;
 	uint32_t secret_lifetime;
 	uint32_t badcookie_slip;
 	knot_atomic_uint16_t badcookie_ctr; // Counter for BADCOOKIE answers.
 	uint8_t secret_cnt;
+	valid_cookie_t *valid_cache; // Per-thread caches of validated cookies.
 } cookies_ctx_t;
 
 static void update_ctr(cookies_ctx_t *ctx)
@@ -93,6 +111,8 @@ static int generate_secret(cookies_ctx_t *ctx)
 		return ret;
 	}
 
+	// Keep the previous secret valid, the constant part is shared.
+	ATOMIC_SET(ctx->secret[1].variable, ATOMIC_GET(ctx->secret[0].variable));
 	ATOMIC_SET(ctx->secret[0].variable, new_secret);
 
 	return KNOT_EOK;
@@ -145,6 +165,95 @@ static int put_cookie(knotd_qdata_t *qdata, knot_pkt_t *pkt,
 	return KNOT_EOK;
 }
 
+static void set_secret(knot_edns_cookie_params_t *params, cookies_ctx_t *ctx,
+                       int idx, uint64_t variable)
+{
+	memcpy(params->secret, &variable, sizeof(variable));
+	memcpy(params->secret + sizeof(variable), &ctx->secret[idx].constant,
+	       sizeof(ctx->secret[idx].constant));
+}
+
+static valid_cookie_t *valid_cache_slot(cookies_ctx_t *ctx, unsigned thread_id,
+                                        const uint8_t *addr, size_t addr_len)
+{
+	uint64_t key = 0;
+	memcpy(&key, addr, MIN(addr_len, sizeof(key))); // IPv6 /64 prefix.
+	key = (key * 0x9E3779B97F4A7C15ULL) >> 32;
+
+	return &ctx->valid_cache[thread_id * VALID_CACHE_SIZE + key % VALID_CACHE_SIZE];
+}
+
+static bool valid_cache_hit(const valid_cookie_t *slot, const uint8_t *addr,
+                            size_t addr_len, const knot_edns_cookie_t *cc,
+                            const knot_edns_cookie_t *sc, uint64_t secret)
+{
+	return slot->addr_len == addr_len &&
+	       memcmp(slot->addr, addr, addr_len) == 0 &&
+	       slot->secret == secret &&
+	       const_time_memcmp(slot->cc, cc->data, sizeof(slot->cc)) == 0 &&
+	       const_time_memcmp(slot->sc, sc->data, sizeof(slot->sc)) == 0;
+}
+
+static bool cookie_time_valid(const knot_edns_cookie_t *sc,
+                              const knot_edns_cookie_params_t *params)
+{
+	uint32_t cookie_time = knot_wire_read_u32(&sc->data[4]);
+	uint32_t min_time = params->timestamp - params->lifetime_before;
+	uint32_t max_time = params->timestamp + params->lifetime_after;
+
+	return cookie_time >= min_time && cookie_time <= max_time;
+}
+
+/*!
+ * Server cookie validation with a shortcut for a cookie validated recently.
+ * The timestamp check isn't cached.
+ */
+static int check_cookie(cookies_ctx_t *ctx, knotd_qdata_t *qdata,
+                        knot_edns_cookie_params_t *params,
+                        const knot_edns_cookie_t *cc, const knot_edns_cookie_t *sc)
+{
+	valid_cookie_t *slot = NULL;
+	size_t addr_len = 0;
+	const uint8_t *addr = sockaddr_raw(params->client_addr, &addr_len);
+	if (ctx->valid_cache != NULL && addr != NULL && addr_len <= sizeof(slot->addr) &&
+	    cc->len == KNOT_EDNS_COOKIE_CLNT_SIZE && sc->len == CACHED_SRVR_SIZE) {
+		slot = valid_cache_slot(ctx, qdata->params->thread_id, addr, addr_len);
+	}
+
+	uint64_t secrets[2] = { 0 };
+	for (int i = 0; i < ctx->secret_cnt; i++) {
+		secrets[i] = ATOMIC_GET(ctx->secret[i].variable);
+		if (slot != NULL && valid_cache_hit(slot, addr, addr_len, cc, sc, secrets[i])) {
+			return cookie_time_valid(sc, params) ? KNOT_EOK : KNOT_ERANGE;
+		}
+	}
+
+	// The current secret first, the previous one if rotated.
+	int ret = KNOT_EINVAL;
+	for (int i = 0; i < ctx->secret_cnt; i++) {
+		if (i > 0 && secrets[i] == secrets[0]) {
+			break; // Not rotated yet.
+		}
+		set_secret(params, ctx, i, secrets[i]);
+		ret = knot_edns_cookie_server_check(sc, cc, params);
+		if (ret == KNOT_EOK) {
+			if (slot != NULL) {
+				memcpy(slot->addr, addr, addr_len);
+				slot->addr_len = addr_len;
+				memcpy(slot->cc, cc->data, sizeof(slot->cc));
+				memcpy(slot->sc, sc->data, sizeof(slot->sc));
+				slot->secret = secrets[i];
+			}
+			return KNOT_EOK;
+		}
+	}
+
+	// Keep the current secret for a new server cookie.
+	set_secret(params, ctx, 0, secrets[0]);
+
+	return ret;
+}
+
 static knotd_state_t cookies_process(knotd_state_t state, knot_pkt_t *pkt,
                                      knotd_qdata_t *qdata, knotd_mod_t *mod)
 {
@@ -183,19 +292,8 @@ static knotd_state_t cookies_process(knotd_state_t state, knot_pkt_t *pkt,
 		.client_addr = knotd_qdata_remote_addr(qdata)
 	};
 
-	// Try the old secret first to ensure the new secret stays in the params.
-	for (int i = ctx->secret_cnt - 1; i >= 0; --i) {
-		uint64_t current_secret = ATOMIC_GET(ctx->secret[i].variable);
-		memcpy(params.secret, &current_secret, sizeof(current_secret));
-		memcpy(params.secret + sizeof(current_secret), &ctx->secret[i].constant,
-		       sizeof(ctx->secret[i].constant));
-
-		// Compare server cookie.
-		ret = knot_edns_cookie_server_check(&sc, &cc, &params);
-		if (ret == KNOT_EOK) {
-			break;
-		}
-	}
+	// Compare server cookie.
+	ret = check_cookie(ctx, qdata, &params, &cc, &sc);
 	if (ret != KNOT_EOK) {
 		// Established connection (TCP or QUIC) is taken into account,
 		// so a normal response is provided.
@@ -271,6 +369,14 @@ int cookies_load(knotd_mod_t *mod)
 		return ret;
 	}
 
+	// Initialize the validated cookies cache.
+	ctx->valid_cache = calloc(knotd_mod_threads(mod) * VALID_CACHE_SIZE,
+	                          sizeof(*ctx->valid_cache));
+	if (ctx->valid_cache == NULL) {
+		free(ctx);
+		return KNOT_ENOMEM;
+	}
+
 	// Store module context before rollover thread is created.
 	knotd_mod_ctx_set(mod, ctx);
 
@@ -290,12 +396,16 @@ int cookies_load(knotd_mod_t *mod)
 		uint64_t gen_secret[2];
 		ret = dnssec_random_buffer((uint8_t *)gen_secret, sizeof(gen_secret));
 		if (ret != KNOT_EOK) {
+			free(ctx->valid_cache);
 			free(ctx);
 			return ret;
 		}
-		ATOMIC_SET(ctx->secret[0].variable, gen_secret[0]);
-		ctx->secret[0].constant = gen_secret[1];
-		ctx->secret_cnt = 1;
+		// The previous secret is the same until the first rollover.
+		for (int i = 0; i < 2; ++i) {
+			ATOMIC_SET(ctx->secret[i].variable, gen_secret[0]);
+			ctx->secret[i].constant = gen_secret[1];
+		}
+		ctx->secret_cnt = 2;
 
 		conf = knotd_conf_mod(mod, MOD_SECRET_LIFETIME);
 		ctx->secret_lifetime = conf.single.integer;
@@ -303,6 +413,7 @@ int cookies_load(knotd_mod_t *mod)
 		// Start the secret rollover thread.
 		if (thread_create_nosignal(&ctx->update_secret, update_secret, (void *)mod)) {
 			knotd_mod_log(mod, LOG_ERR, "failed to create the secret rollover thread");
+			free(ctx->valid_cache);
 			free(ctx);
 			return KNOT_ERROR;
 		}
@@ -323,8 +434,10 @@ void cookies_unload(knotd_mod_t *mod)
 		ATOMIC_DEINIT(ctx->secret[i].variable);
 	}
 	memzero(&ctx->secret, sizeof(ctx->secret));
+	free(ctx->valid_cache);
 	free(ctx);
 }
 
-KNOTD_MOD_API(cookies, KNOTD_MOD_FLAG_SCOPE_ANY | KNOTD_MOD_FLAG_OPT_CONF,
+KNOTD_MOD_API(cookies, KNOTD_MOD_FLAG_SCOPE_ANY | KNOTD_MOD_FLAG_OPT_CONF |
+              KNOTD_MOD_FLAG_SHARED,
               cookies_load, cookies_unload, cookies_conf, cookies_conf_check);
@@ -14,9 +14,19 @@
     along with this program.  If not, see <https://www.gnu.org/licenses/>.
  */
 
+#ifdef __APPLE__
+#define __APPLE_USE_RFC_3542 // IPV6_PKTINFO
+#endif
+
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
 #include "contrib/net.h"
+#include "contrib/sockaddr.h"
 #include "knot/include/module.h"
 #include "knot/conf/schema.h"
+#include "knot/query/async-requestor.h" // Forces static module!
 #include "knot/query/capture.h" // Forces static module!
 #include "knot/query/requestor.h" // Forces static module!
 #include "libknot/xdp.h"
@@ -27,6 +37,7 @@
 #define MOD_TIMEOUT		"\x07""timeout"
 #define MOD_FALLBACK		"\x08""fallback"
 #define MOD_CATCH_NXDOMAIN	"\x0E""catch-nxdomain"
+#define MOD_ASYNC		"\x05""async"
 
 const yp_item_t dnsproxy_conf[] = {
 	{ MOD_REMOTE,         YP_TREF,  YP_VREF = { C_RMT }, YP_FNONE,
@@ -36,6 +47,7 @@ const yp_item_t dnsproxy_conf[] = {
 	{ MOD_FALLBACK,       YP_TBOOL, YP_VBOOL = { true } },
 	{ MOD_TCP_FASTOPEN,   YP_TBOOL, YP_VNONE },
 	{ MOD_CATCH_NXDOMAIN, YP_TBOOL, YP_VNONE },
+	{ MOD_ASYNC,          YP_TBOOL, YP_VNONE },
 	{ NULL }
 };
 
@@ -58,18 +70,41 @@ typedef struct {
 	bool tfo;
 	bool catch_nxdomain;
 	int timeout;
+	knot_areq_loop_t *loop;
 } dnsproxy_t;
 
-static int fwd(dnsproxy_t *proxy, knot_pkt_t *pkt, knotd_qdata_t *qdata, int addr_pos)
+static int fwd_request(dnsproxy_t *proxy, const knot_pkt_t *orig, int addr_pos,
+                       knot_request_flag_t flags, knot_mm_t *mm, knot_request_t **req)
 {
 	/* Copy the query as the requestor modifies and frees it. */
 	knot_pkt_t *query = knot_pkt_new(NULL, KNOT_WIRE_MAX_PKTSIZE, NULL);
-	int ret = knot_pkt_copy(query, qdata->query);
+	int ret = knot_pkt_copy(query, orig);
 	if (ret != KNOT_EOK) {
 		knot_pkt_free(query);
 		return ret;
 	}
 
+	if (query->tsig_rr != NULL) {
+		knot_tsig_append(query->wire, &query->size, query->max_size, query->tsig_rr);
+	}
+
+	const struct sockaddr_storage *dst = &proxy->remote.multi[addr_pos].addr;
+	const struct sockaddr_storage *src = NULL;
+	if (addr_pos < proxy->via.count) { // Simplified via address selection!
+		src = &proxy->via.multi[addr_pos].addr;
+	}
+	*req = knot_request_make_generic(mm, dst, src, query, NULL, NULL, NULL,
+	                                 NULL, 0, flags);
+	if (*req == NULL) {
+		knot_pkt_free(query);
+		return KNOT_ENOMEM;
+	}
+
+	return KNOT_EOK;
+}
+
+static int fwd(dnsproxy_t *proxy, knot_pkt_t *pkt, knotd_qdata_t *qdata, int addr_pos)
+{
 	/* Capture layer context. */
 	const knot_layer_api_t *capture = query_capture_api();
 	struct capture_param capture_param = {
@@ -78,9 +113,8 @@ static int fwd(dnsproxy_t *proxy, knot_pkt_t *pkt, knotd_qdata_t *qdata, int add
 
 	/* Create a forwarding request. */
 	knot_requestor_t re;
-	ret = knot_requestor_init(&re, capture, &capture_param, qdata->mm);
+	int ret = knot_requestor_init(&re, capture, &capture_param, qdata->mm);
 	if (ret != KNOT_EOK) {
-		knot_pkt_free(query);
 		return ret;
 	}
 
@@ -105,21 +139,11 @@ static int fwd(dnsproxy_t *proxy, knot_pkt_t *pkt, knotd_qdata_t *qdata, int add
 		flags = KNOT_REQUEST_TFO;
 	}
 
-	if (query->tsig_rr != NULL) {
-		knot_tsig_append(query->wire, &query->size, query->max_size, query->tsig_rr);
-	}
-
-	const struct sockaddr_storage *dst = &proxy->remote.multi[addr_pos].addr;
-	const struct sockaddr_storage *src = NULL;
-	if (addr_pos < proxy->via.count) { // Simplified via address selection!
-		src = &proxy->via.multi[addr_pos].addr;
-	}
-	knot_request_t *req = knot_request_make_generic(re.mm, dst, src, query,
-	                                                NULL, NULL, NULL, NULL, 0, flags);
-	if (req == NULL) {
+	knot_request_t *req = NULL;
+	ret = fwd_request(proxy, qdata->query, addr_pos, flags, re.mm, &req);
+	if (ret != KNOT_EOK) {
 		knot_requestor_clear(&re);
-		knot_pkt_free(query);
-		return KNOT_ENOMEM;
+		return ret;
 	}
 
 	/* Forward request. */
@@ -135,6 +159,209 @@ static int fwd(dnsproxy_t *proxy, knot_pkt_t *pkt, knotd_qdata_t *qdata, int add
 	return ret;
 }
 
+/*!
+ * \brief Query forwarded in the asynchronous mode.
+ *
+ * The worker returns immediately without a response and the response is sent
+ * from the module requests loop once the remote answers.
+ */
+typedef struct {
+	dnsproxy_t *proxy;
+	knot_requestor_t re;
+	knot_request_t *req;
+	struct capture_param capture;
+	knot_pkt_t *query;    /*!< Original query, for other remote addresses. */
+	knot_pkt_t *resp;     /*!< Captured remote response. */
+	struct sockaddr_storage remote;
+	struct sockaddr_storage local;
+	int fd;               /*!< Duplicate of the query socket. */
+	int addr_pos;
+} fwd_job_t;
+
+static void fwd_job_free(fwd_job_t *job)
+{
+	if (job->fd >= 0) {
+		close(job->fd);
+	}
+	knot_pkt_free(job->resp);
+	knot_pkt_free(job->query);
+	free(job);
+}
+
+/*! \brief Sends the response from the local address the query was received on. */
+static void fwd_job_reply(fwd_job_t *job, uint8_t *wire, size_t len)
+{
+	struct iovec iov = { .iov_base = wire, .iov_len = len };
+	struct msghdr msg = {
+		.msg_name = &job->remote,
+		.msg_namelen = sockaddr_len(&job->remote),
+		.msg_iov = &iov,
+		.msg_iovlen = 1,
+	};
+
+	union {
+		struct cmsghdr cmsg;
+		uint8_t buf[CMSG_SPACE(sizeof(struct in6_pktinfo))];
+	} cmsg = { 0 };
+
+#if defined(IP_PKTINFO)
+	if (job->local.ss_family == AF_INET && job->remote.ss_family == AF_INET) {
+		struct in_pktinfo info = {
+			.ipi_spec_dst = ((struct sockaddr_in *)&job->local)->sin_addr
+		};
+		msg.msg_control = &cmsg;
+		msg.msg_controllen = CMSG_SPACE(sizeof(info));
+		cmsg.cmsg.cmsg_level = IPPROTO_IP;
+		cmsg.cmsg.cmsg_type = IP_PKTINFO;
+		cmsg.cmsg.cmsg_len = CMSG_LEN(sizeof(info));
+		memcpy(CMSG_DATA(&cmsg.cmsg), &info, sizeof(info));
+	}
+#endif
+#if defined(IPV6_PKTINFO)
+	if (job->local.ss_family == AF_INET6 && job->remote.ss_family == AF_INET6) {
+		struct in6_pktinfo info = {
+			.ipi6_addr = ((struct sockaddr_in6 *)&job->local)->sin6_addr
+		};
+		msg.msg_control = &cmsg;
+		msg.msg_controllen = CMSG_SPACE(sizeof(info));
+		cmsg.cmsg.cmsg_level = IPPROTO_IPV6;
+		cmsg.cmsg.cmsg_type = IPV6_PKTINFO;
+		cmsg.cmsg.cmsg_len = CMSG_LEN(sizeof(info));
+		memcpy(CMSG_DATA(&cmsg.cmsg), &info, sizeof(info));
+	}
+#endif
+
+	(void)sendmsg(job->fd, &msg, MSG_DONTWAIT | MSG_NOSIGNAL);
+}
+
+/*! \brief Answers SERVFAIL if no remote address responded. */
+static void fwd_job_fail(fwd_job_t *job)
+{
+	uint8_t wire[KNOT_WIRE_HEADER_SIZE + KNOT_DNAME_MAXLEN + 2 * sizeof(uint16_t)];
+	size_t len = KNOT_WIRE_HEADER_SIZE + knot_pkt_question_size(job->query);
+	assert(len <= sizeof(wire) && len <= job->query->size);
+
+	memcpy(wire, job->query->wire, len);
+	knot_wire_set_qr(wire);
+	knot_wire_clear_aa(wire);
+	knot_wire_clear_tc(wire);
+	knot_wire_clear_ad(wire);
+	knot_wire_set_rcode(wire, KNOT_RCODE_SERVFAIL);
+	knot_wire_set_ancount(wire, 0);
+	knot_wire_set_nscount(wire, 0);
+	knot_wire_set_arcount(wire, 0);
+
+	fwd_job_reply(job, wire, len);
+}
+
+static void fwd_job_done(knot_requestor_t *requestor, knot_request_t *req,
+                         int ret, void *ctx);
+
+static int fwd_job_exec(fwd_job_t *job)
+{
+	knot_pkt_clear(job->resp);
+
+	int ret = knot_requestor_init(&job->re, query_capture_api(), &job->capture, NULL);
+	if (ret != KNOT_EOK) {
+		return ret;
+	}
+
+	ret = fwd_request(job->proxy, job->query, job->addr_pos, KNOT_REQUEST_UDP,
+	                  NULL, &job->req);
+	if (ret != KNOT_EOK) {
+		knot_requestor_clear(&job->re);
+		return ret;
+	}
+
+	ret = knot_areq_exec(job->proxy->loop, &job->re, job->req, job->proxy->timeout,
+	                     fwd_job_done, job);
+	if (ret != KNOT_EOK) {
+		knot_request_free(job->req, NULL);
+		knot_requestor_clear(&job->re);
+	}
+
+	return ret;
+}
+
+static void fwd_job_done(knot_requestor_t *requestor, knot_request_t *req,
+                         int ret, void *ctx)
+{
+	fwd_job_t *job = ctx;
+
+	knot_request_free(job->req, NULL);
+	knot_requestor_clear(&job->re);
+
+	if (ret == KNOT_EOK && job->resp->size > 0) {
+		if (job->resp->tsig_rr != NULL) {
+			knot_tsig_append(job->resp->wire, &job->resp->size,
+			                 job->resp->max_size, job->resp->tsig_rr);
+		}
+		fwd_job_reply(job, job->resp->wire, job->resp->size);
+		fwd_job_free(job);
+		return;
+	}
+
+	/* Try the next remote address, unless the module is being unloaded. */
+	while (ret != KNOT_ECONNABORTED && ++job->addr_pos < job->proxy->remote.count) {
+		ret = fwd_job_exec(job);
+		if (ret == KNOT_EOK) {
+			return;
+		}
+	}
+
+	fwd_job_fail(job);
+	fwd_job_free(job);
+}
+
+static int fwd_async(dnsproxy_t *proxy, knot_pkt_t *pkt, knotd_qdata_t *qdata)
+{
+	fwd_job_t *job = calloc(1, sizeof(*job));
+	if (job == NULL) {
+		return KNOT_ENOMEM;
+	}
+	job->proxy = proxy;
+	job->fd = -1;
+
+	/* The response buffer is limited the same way as the local answer. */
+	job->query = knot_pkt_new(NULL, KNOT_WIRE_MAX_PKTSIZE, NULL);
+	job->resp = knot_pkt_new(NULL, pkt->max_size, NULL);
+	if (job->query == NULL || job->resp == NULL ||
+	    knot_pkt_copy(job->query, qdata->query) != KNOT_EOK) {
+		fwd_job_free(job);
+		return KNOT_ENOMEM;
+	}
+	job->capture.sink = job->resp;
+
+	memcpy(&job->remote, knotd_qdata_remote_addr(qdata), sizeof(job->remote));
+	const struct sockaddr_storage *local = knotd_qdata_local_addr(qdata);
+	if (local != NULL) {
+		memcpy(&job->local, local, sizeof(job->local));
+	}
+
+	/* The socket may be closed by a reconfiguration meanwhile. */
+	job->fd = dup(qdata->params->socket);
+	if (job->fd < 0) {
+		fwd_job_free(job);
+		return knot_map_errno();
+	}
+
+	int ret = fwd_job_exec(job);
+	if (ret != KNOT_EOK) {
+		fwd_job_free(job);
+	}
+
+	return ret;
+}
+
+/*! \brief Only plain UDP responses can be sent by the module itself. */
+static bool fwd_async_possible(dnsproxy_t *proxy, knotd_qdata_t *qdata)
+{
+	return proxy->loop != NULL &&
+	       qdata->params->proto == KNOTD_QUERY_PROTO_UDP &&
+	       qdata->params->xdp_msg == NULL &&
+	       !(qdata->params->flags & KNOTD_QUERY_FLAG_PROXIED);
+}
+
 static knotd_state_t dnsproxy_fwd(knotd_state_t state, knot_pkt_t *pkt,
                                   knotd_qdata_t *qdata, knotd_mod_t *mod)
 {
@@ -158,6 +385,14 @@ static knotd_state_t dnsproxy_fwd(knotd_state_t state, knot_pkt_t *pkt,
 
 	int ret = KNOT_EOK;
 
+	/* Hand the query over, the response is sent once the remote answers. */
+	if (fwd_async_possible(proxy, qdata)) {
+		ret = fwd_async(proxy, pkt, qdata);
+		if (ret == KNOT_EOK) {
+			return KNOTD_STATE_NOOP;
+		}
+	}
+
 	/* Try to forward the packet. */
 	assert(proxy->remote.count > 0);
 	for (int i = 0; i < proxy->remote.count; i++) {
@@ -204,6 +439,18 @@ int dnsproxy_load(knotd_mod_t *mod)
 	conf = knotd_conf_mod(mod, MOD_CATCH_NXDOMAIN);
 	proxy->catch_nxdomain = conf.single.boolean;
 
+	conf = knotd_conf_mod(mod, MOD_ASYNC);
+	if (conf.single.boolean) {
+		proxy->loop = knot_areq_loop_new();
+		if (proxy->loop == NULL) {
+			knotd_conf_free(&proxy->remote);
+			knotd_conf_free(&proxy->via);
+			knotd_conf_free(&proxy->addr);
+			free(proxy);
+			return KNOT_ENOMEM;
+		}
+	}
+
 	knotd_mod_ctx_set(mod, proxy);
 
 	if (proxy->fallback) {
@@ -217,6 +464,7 @@ void dnsproxy_unload(knotd_mod_t *mod)
 {
 	dnsproxy_t *ctx = knotd_mod_ctx(mod);
 	if (ctx != NULL) {
+		knot_areq_loop_free(ctx->loop); // Aborts the pending queries.
 		knotd_conf_free(&ctx->remote);
 		knotd_conf_free(&ctx->via);
 		knotd_conf_free(&ctx->addr);
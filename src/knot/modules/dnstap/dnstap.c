@@ -21,6 +21,7 @@
 #include "contrib/dnstap/dnstap.pb-c.h"
 #include "contrib/dnstap/message.h"
 #include "contrib/dnstap/writer.h"
+#include "contrib/macros.h"
 #include "contrib/time.h"
 #include "knot/include/module.h"
 
@@ -30,6 +31,22 @@
 #define MOD_QUERIES		"\x0B""log-queries"
 #define MOD_RESPONSES		"\x0D""log-responses"
 #define MOD_WITH_QUERIES	"\x16""responses-with-queries"
+#define MOD_QUEUE_SIZE		"\x0A""queue-size"
+#define MOD_SAMPLE_RATE		"\x0B""sample-rate"
+#define MOD_SAMPLE_QTYPE	"\x13""sample-exempt-qtype"
+#define MOD_SAMPLE_ERROR	"\x13""sample-exempt-error"
+
+static int qtype_check(knotd_conf_check_args_t *args)
+{
+	uint16_t num;
+	int ret = knot_rrtype_from_string((const char *)args->data, &num);
+	if (ret != 0) {
+		args->err_str = "invalid RR type";
+		return KNOT_EINVAL;
+	}
+
+	return KNOT_EOK;
+}
 
 const yp_item_t dnstap_conf[] = {
 	{ MOD_SINK,         YP_TSTR,  YP_VNONE },
@@ -38,6 +55,10 @@ const yp_item_t dnstap_conf[] = {
 	{ MOD_QUERIES,      YP_TBOOL, YP_VBOOL = { true } },
 	{ MOD_RESPONSES,    YP_TBOOL, YP_VBOOL = { true } },
 	{ MOD_WITH_QUERIES, YP_TBOOL, YP_VBOOL = { false } },
+	{ MOD_QUEUE_SIZE,   YP_TINT,  YP_VINT = { 2, 1 << 20, 512 } },
+	{ MOD_SAMPLE_RATE,  YP_TINT,  YP_VINT = { 1, UINT32_MAX, 1 } },
+	{ MOD_SAMPLE_QTYPE, YP_TSTR,  YP_VNONE, YP_FMULTI, { qtype_check } },
+	{ MOD_SAMPLE_ERROR, YP_TBOOL, YP_VNONE },
 	{ NULL }
 };
 
@@ -49,9 +70,21 @@ int dnstap_conf_check(knotd_conf_check_args_t *args)
 		return KNOT_EINVAL;
 	}
 
+	knotd_conf_t queue = knotd_conf_check_item(args, MOD_QUEUE_SIZE);
+	if (queue.count == 1 && (queue.single.integer & (queue.single.integer - 1)) != 0) {
+		args->err_str = "queue size must be a power of 2";
+		return KNOT_EINVAL;
+	}
+
 	return KNOT_EOK;
 }
 
+typedef struct {
+	_Alignas(64) // Ensures that one thread context occupies one cache line.
+	uint32_t counter; // Queries since the last sampled one.
+	bool sampled;     // The current query is logged.
+} thrd_ctx_t;
+
 typedef struct {
 	struct fstrm_iothr *iothread;
 	char *identity;
@@ -59,8 +92,19 @@ typedef struct {
 	char *version;
 	size_t version_len;
 	bool with_queries;
+	bool log_queries;
+
+	thrd_ctx_t *thrd_ctx; // Set if sampling is enabled.
+	uint32_t sample_rate;
+	uint16_t *exempt_qtypes;
+	size_t exempt_qtypes_count;
+	bool exempt_error;
 } dnstap_ctx_t;
 
+enum {
+	CTR_DROPPED,
+};
+
 static knotd_state_t log_message(knotd_state_t state, const knot_pkt_t *pkt,
                                  knotd_qdata_t *qdata, knotd_mod_t *mod)
 {
@@ -138,6 +182,8 @@ static knotd_state_t log_message(knotd_state_t state, const knot_pkt_t *pkt,
 	fstrm_res res = fstrm_iothr_submit(ctx->iothread, ioq, frame, size,
 	                                   fstrm_free_wrapper, NULL);
 	if (res != fstrm_res_success) {
+		// The queue is full, the I/O thread doesn't keep up.
+		knotd_mod_stats_incr(mod, qdata->params->thread_id, CTR_DROPPED, 0, 1);
 		free(frame);
 		return state;
 	}
@@ -145,12 +191,57 @@ static knotd_state_t log_message(knotd_state_t state, const knot_pkt_t *pkt,
 	return state;
 }
 
+static bool sample_query(dnstap_ctx_t *ctx, knotd_qdata_t *qdata)
+{
+	thrd_ctx_t *thrd = &ctx->thrd_ctx[qdata->params->thread_id];
+
+	if (++thrd->counter >= ctx->sample_rate) {
+		thrd->counter = 0;
+		thrd->sampled = true;
+		return true;
+	}
+
+	uint16_t qtype = knot_pkt_qtype(qdata->query);
+	for (size_t i = 0; i < ctx->exempt_qtypes_count; i++) {
+		if (ctx->exempt_qtypes[i] == qtype) {
+			thrd->sampled = true;
+			return true;
+		}
+	}
+
+	thrd->sampled = false;
+	return false;
+}
+
+static bool sample_response(dnstap_ctx_t *ctx, const knot_pkt_t *pkt,
+                            knotd_qdata_t *qdata)
+{
+	if (ctx->thrd_ctx[qdata->params->thread_id].sampled) {
+		return true;
+	}
+
+	if (ctx->exempt_error) {
+		uint8_t rcode = knot_wire_get_rcode(pkt->wire);
+		return rcode != KNOT_RCODE_NOERROR && rcode != KNOT_RCODE_NXDOMAIN;
+	}
+
+	return false;
+}
+
 /*! \brief Submit message - query. */
 static knotd_state_t dnstap_message_log_query(knotd_state_t state, knot_pkt_t *pkt,
                                               knotd_qdata_t *qdata, knotd_mod_t *mod)
 {
 	assert(qdata);
 
+	dnstap_ctx_t *ctx = knotd_mod_ctx(mod);
+	if (ctx->thrd_ctx != NULL && !sample_query(ctx, qdata)) {
+		return state;
+	}
+	if (!ctx->log_queries) {
+		return state;
+	}
+
 	return log_message(state, qdata->query, qdata, mod);
 }
 
@@ -158,6 +249,11 @@ static knotd_state_t dnstap_message_log_query(knotd_state_t state, knot_pkt_t *p
 static knotd_state_t dnstap_message_log_response(knotd_state_t state, knot_pkt_t *pkt,
                                                  knotd_qdata_t *qdata, knotd_mod_t *mod)
 {
+	dnstap_ctx_t *ctx = knotd_mod_ctx(mod);
+	if (ctx->thrd_ctx != NULL && !sample_response(ctx, pkt, qdata)) {
+		return state;
+	}
+
 	return log_message(state, pkt, qdata, mod);
 }
 
@@ -281,6 +377,53 @@ static struct fstrm_writer* dnstap_writer(knotd_mod_t *mod, const char *path)
 	}
 }
 
+static void free_ctx(dnstap_ctx_t *ctx)
+{
+	free(ctx->identity);
+	free(ctx->version);
+	free(ctx->thrd_ctx);
+	free(ctx->exempt_qtypes);
+	free(ctx);
+}
+
+static int init_sampling(knotd_mod_t *mod, dnstap_ctx_t *ctx)
+{
+	knotd_conf_t conf = knotd_conf_mod(mod, MOD_SAMPLE_RATE);
+	ctx->sample_rate = conf.single.integer;
+	if (ctx->sample_rate <= 1) {
+		return KNOT_EOK;
+	}
+
+	size_t size = knotd_mod_threads(mod) * sizeof(*ctx->thrd_ctx);
+	if (posix_memalign((void **)&ctx->thrd_ctx, 64, MAX(size, 64)) != 0) {
+		return KNOT_ENOMEM;
+	}
+	memset(ctx->thrd_ctx, 0, size);
+
+	conf = knotd_conf_mod(mod, MOD_SAMPLE_QTYPE);
+	if (conf.count > 0) {
+		ctx->exempt_qtypes = calloc(conf.count, sizeof(uint16_t));
+		if (ctx->exempt_qtypes == NULL) {
+			knotd_conf_free(&conf);
+			return KNOT_ENOMEM;
+		}
+		for (size_t i = 0; i < conf.count; i++) {
+			if (knot_rrtype_from_string(conf.multi[i].string,
+			                            &ctx->exempt_qtypes[i]) != 0) {
+				knotd_conf_free(&conf);
+				return KNOT_EINVAL;
+			}
+		}
+		ctx->exempt_qtypes_count = conf.count;
+	}
+	knotd_conf_free(&conf);
+
+	conf = knotd_conf_mod(mod, MOD_SAMPLE_ERROR);
+	ctx->exempt_error = conf.single.boolean;
+
+	return KNOT_EOK;
+}
+
 int dnstap_load(knotd_mod_t *mod)
 {
 	/* Create dnstap context. */
@@ -321,12 +464,26 @@ int dnstap_load(knotd_mod_t *mod)
 
 	/* Set log_queries. */
 	conf = knotd_conf_mod(mod, MOD_QUERIES);
-	const bool log_queries = conf.single.boolean;
+	ctx->log_queries = conf.single.boolean;
 
 	/* Set log_responses. */
 	conf = knotd_conf_mod(mod, MOD_RESPONSES);
 	const bool log_responses = conf.single.boolean;
 
+	/* Set sampling. */
+	int ret = init_sampling(mod, ctx);
+	if (ret != KNOT_EOK) {
+		knotd_mod_log(mod, LOG_ERR, "failed to initialize sampling");
+		free_ctx(ctx);
+		return ret;
+	}
+
+	ret = knotd_mod_stats_add(mod, "dropped", 1, NULL);
+	if (ret != KNOT_EOK) {
+		free_ctx(ctx);
+		return ret;
+	}
+
 	/* Initialize the writer and the options. */
 	struct fstrm_writer *writer = dnstap_writer(mod, sink);
 	if (writer == NULL) {
@@ -341,6 +498,8 @@ int dnstap_load(knotd_mod_t *mod)
 
 	/* Initialize queues. */
 	fstrm_iothr_options_set_num_input_queues(opt, knotd_mod_threads(mod));
+	conf = knotd_conf_mod(mod, MOD_QUEUE_SIZE);
+	fstrm_iothr_options_set_input_queue_size(opt, conf.single.integer);
 
 	/* Create the I/O thread. */
 	ctx->iothread = fstrm_iothr_init(opt, &writer);
@@ -353,7 +512,7 @@ int dnstap_load(knotd_mod_t *mod)
 	knotd_mod_ctx_set(mod, ctx);
 
 	/* Hook to the query plan. */
-	if (log_queries) {
+	if (ctx->log_queries || ctx->thrd_ctx != NULL) {
 		knotd_mod_hook(mod, KNOTD_STAGE_BEGIN, dnstap_message_log_query);
 	}
 	if (log_responses) {
@@ -364,9 +523,7 @@ int dnstap_load(knotd_mod_t *mod)
 fail:
 	knotd_mod_log(mod, LOG_ERR, "failed to initialize sink '%s'", sink);
 
-	free(ctx->identity);
-	free(ctx->version);
-	free(ctx);
+	free_ctx(ctx);
 
 	return KNOT_EINVAL;
 }
@@ -376,10 +533,8 @@ void dnstap_unload(knotd_mod_t *mod)
 	dnstap_ctx_t *ctx = knotd_mod_ctx(mod);
 
 	fstrm_iothr_destroy(&ctx->iothread);
-	free(ctx->identity);
-	free(ctx->version);
-	free(ctx);
+	free_ctx(ctx);
 }
 
-KNOTD_MOD_API(dnstap, KNOTD_MOD_FLAG_SCOPE_ANY,
+KNOTD_MOD_API(dnstap, KNOTD_MOD_FLAG_SCOPE_ANY | KNOTD_MOD_FLAG_SHARED,
               dnstap_load, dnstap_unload, dnstap_conf, dnstap_conf_check);
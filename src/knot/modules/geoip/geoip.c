@@ -14,9 +14,13 @@
     along with this program.  If not, see <https://www.gnu.org/licenses/>.
  */
 
+#include <pthread.h>
 #include <stdio.h>
 #include <string.h>
+#include <time.h>
 #include <arpa/inet.h>
+#include <sys/stat.h>
+#include <urcu.h>
 
 #include "knot/conf/schema.h"
 #include "knot/include/module.h"
@@ -28,6 +32,7 @@
 #include "contrib/sockaddr.h"
 #include "contrib/string.h"
 #include "contrib/strtonum.h"
+#include "contrib/threads.h"
 #include "libdnssec/random.h"
 #include "libzscanner/scanner.h"
 
@@ -38,6 +43,8 @@
 #define MOD_POLICY	"\x06""policy"
 #define MOD_GEODB_FILE	"\x0A""geodb-file"
 #define MOD_GEODB_KEY	"\x09""geodb-key"
+#define MOD_GEODB_CACHE	"\x0B""geodb-cache"
+#define MOD_WATCH	"\x0E""watch-interval"
 
 enum operation_mode {
 	MODE_SUBNET,
@@ -66,6 +73,8 @@ const yp_item_t geoip_conf[] = {
 	{ MOD_POLICY,      YP_TREF,  YP_VREF = { C_POLICY }, YP_FNONE, { knotd_conf_check_ref } },
 	{ MOD_GEODB_FILE,  YP_TSTR,  YP_VNONE },
 	{ MOD_GEODB_KEY,   YP_TSTR,  YP_VSTR = { "country/iso_code" }, YP_FMULTI },
+	{ MOD_GEODB_CACHE, YP_TINT,  YP_VINT = { 0, 1 << 20, 1024 } },
+	{ MOD_WATCH,       YP_TINT,  YP_VINT = { 0, UINT32_MAX, 0, YP_STIME } },
 	{ NULL }
 };
 
@@ -122,6 +131,17 @@ int geoip_conf_check(knotd_conf_check_args_t *args)
 	return load_module(&check);
 }
 
+// Cached geodb lookup result, valid for the whole record subnet.
+typedef struct {
+	uint8_t addr[16];
+	uint8_t family;   // AF_UNSPEC if empty.
+	uint8_t geodepth;
+	uint16_t netmask; // Record subnet prefix length.
+	void *geodata[GEODB_MAX_DEPTH];
+	uint32_t geodata_len[GEODB_MAX_DEPTH];
+	uint32_t ids[GEODB_MAX_DEPTH]; // Storage for (id) values.
+} geo_cache_t;
+
 typedef struct {
 	enum operation_mode mode;
 	uint32_t ttl;
@@ -132,8 +152,34 @@ typedef struct {
 	geodb_t *geodb;
 	geodb_path_t paths[GEODB_MAX_DEPTH];
 	uint16_t path_count;
+
+	geo_cache_t *cache; // Per-thread direct-mapped caches of geodb lookups.
+	size_t cache_size;
+	size_t cache_threads;
+
+	char *config_file;
+	char *geodb_file;
 } geoip_ctx_t;
 
+// Identification of a watched file version.
+typedef struct {
+	struct timespec mtime;
+	off_t size;
+	ino_t ino;
+} file_stamp_t;
+
+typedef struct {
+	node_t n;
+	knotd_mod_t *mod;
+	geoip_ctx_t *ctx; // RCU-protected, replaced by the watcher.
+
+	uint32_t interval;      // Watch interval, 0 if disabled.
+	time_t next_check;
+	file_stamp_t config_stamp;
+	file_stamp_t geodb_stamp;
+	bool busy;              // Being rebuilt by the watcher.
+} geoip_mod_t;
+
 typedef struct {
 	struct sockaddr_storage *subnet;
 	uint8_t subnet_prefix;
@@ -588,11 +634,10 @@ static int geo_conf_yparse(check_ctx_t *check, geoip_ctx_t *ctx)
 		goto cleanup;
 	}
 	yp_init(yp);
-	knotd_conf_t conf = geo_conf(check, MOD_CONFIG_FILE);
-	ret = yp_set_input_file(yp, conf.single.string);
+	ret = yp_set_input_file(yp, ctx->config_file);
 	if (ret != KNOT_EOK) {
 		geo_log(check, LOG_ERR, "failed to load module config file '%s' (%s)",
-		        conf.single.string, knot_strerror(ret));
+		        ctx->config_file, knot_strerror(ret));
 		goto cleanup;
 	}
 
@@ -706,15 +751,20 @@ static void clear_geo_trie(trie_t *trie)
 
 static void free_geoip_ctx(geoip_ctx_t *ctx)
 {
+	free(ctx->cache);
 	geodb_close(ctx->geodb);
 	free(ctx->geodb);
-	clear_geo_trie(ctx->geo_trie);
-	trie_free(ctx->geo_trie);
+	if (ctx->geo_trie != NULL) {
+		clear_geo_trie(ctx->geo_trie);
+		trie_free(ctx->geo_trie);
+	}
 	for (int i = 0; i < ctx->path_count; i++) {
 		for (int j = 0; j < GEODB_MAX_PATH_LEN; j++) {
 			free(ctx->paths[i].path[j]);
 		}
 	}
+	free(ctx->config_file);
+	free(ctx->geodb_file);
 	free(ctx);
 }
 
@@ -838,6 +888,82 @@ static void find_rr_in_view(uint16_t qtype, geo_view_t *view,
 	}
 }
 
+static const uint8_t *remote_addr(const struct sockaddr_storage *remote)
+{
+	if (remote->ss_family == AF_INET) {
+		return (const uint8_t *)&((const struct sockaddr_in *)remote)->sin_addr;
+	} else {
+		return (const uint8_t *)&((const struct sockaddr_in6 *)remote)->sin6_addr;
+	}
+}
+
+static bool prefix_match(const uint8_t *a, const uint8_t *b, unsigned bits)
+{
+	unsigned bytes = bits / 8;
+	if (memcmp(a, b, bytes) != 0) {
+		return false;
+	}
+	unsigned rest = bits % 8;
+	if (rest == 0) {
+		return true;
+	}
+	uint8_t mask = 0xff << (8 - rest);
+	return ((a[bytes] ^ b[bytes]) & mask) == 0;
+}
+
+/*!
+ * Returns the cache slot for the remote address. The slot is selected by the
+ * remote /24 or /56 prefix, and it's valid if the remote address is within
+ * the cached geodb record subnet.
+ */
+static geo_cache_t *geo_cache_slot(geoip_ctx_t *ctx, unsigned thr_id,
+                                   const struct sockaddr_storage *remote,
+                                   bool *hit)
+{
+	const uint8_t *addr = remote_addr(remote);
+	uint64_t key = 0;
+	memcpy(&key, addr, (remote->ss_family == AF_INET) ? 3 : 7);
+	key = (key * 0x9E3779B97F4A7C15ULL) >> 32;
+
+	geo_cache_t *slot = &ctx->cache[thr_id * ctx->cache_size + key % ctx->cache_size];
+	*hit = slot->family == remote->ss_family &&
+	       prefix_match(slot->addr, addr, slot->netmask);
+
+	return slot;
+}
+
+static void geo_cache_store(geoip_ctx_t *ctx, geo_cache_t *slot, geo_view_t *dummy,
+                            const struct sockaddr_storage *remote, uint16_t netmask)
+{
+	size_t addr_len = (remote->ss_family == AF_INET) ? 4 : 16;
+	if (netmask > addr_len * 8) {
+		slot->family = AF_UNSPEC;
+		return;
+	}
+
+	memcpy(slot->addr, remote_addr(remote), addr_len);
+	slot->family = remote->ss_family;
+	slot->netmask = netmask;
+	slot->geodepth = dummy->geodepth;
+	for (int i = 0; i < dummy->geodepth; i++) {
+		slot->geodata[i] = dummy->geodata[i];
+		slot->geodata_len[i] = dummy->geodata_len[i];
+		// Numeric values point to the temporary lookup entries.
+		if (dummy->geodata[i] != NULL && ctx->paths[i].type == GEODB_KEY_ID) {
+			memcpy(&slot->ids[i], dummy->geodata[i], sizeof(uint32_t));
+			slot->geodata[i] = &slot->ids[i];
+		}
+	}
+}
+
+static void geo_cache_load(geo_cache_t *slot, geo_view_t *dummy, uint16_t *netmask)
+{
+	*netmask = slot->netmask;
+	dummy->geodepth = slot->geodepth;
+	memcpy(dummy->geodata, slot->geodata, sizeof(slot->geodata));
+	memcpy(dummy->geodata_len, slot->geodata_len, sizeof(slot->geodata_len));
+}
+
 static knotd_in_state_t geoip_process(knotd_in_state_t state, knot_pkt_t *pkt,
                                       knotd_qdata_t *qdata, knotd_mod_t *mod)
 {
@@ -848,7 +974,8 @@ static knotd_in_state_t geoip_process(knotd_in_state_t state, knot_pkt_t *pkt,
 		return state;
 	}
 
-	geoip_ctx_t *ctx = (geoip_ctx_t *)knotd_mod_ctx(mod);
+	geoip_mod_t *geo_mod = knotd_mod_ctx(mod);
+	geoip_ctx_t *ctx = rcu_dereference(geo_mod->ctx);
 
 	// Save the query type.
 	uint16_t qtype = knot_pkt_qtype(qdata->query);
@@ -885,7 +1012,16 @@ static knotd_in_state_t geoip_process(knotd_in_state_t state, knot_pkt_t *pkt,
 		dummy.subnet = (struct sockaddr_storage *)remote;
 		dummy.subnet_prefix = (remote->ss_family == AF_INET) ? 32 : 128;
 		break;
-	case MODE_GEODB:
+	case MODE_GEODB:;
+		bool hit = false;
+		geo_cache_t *slot = NULL;
+		if (ctx->cache != NULL) {
+			slot = geo_cache_slot(ctx, qdata->params->thread_id, remote, &hit);
+			if (hit) {
+				geo_cache_load(slot, &dummy, &netmask);
+				break;
+			}
+		}
 		if (geodb_query(ctx->geodb, entries, (struct sockaddr *)remote,
 		                ctx->paths, ctx->path_count, &netmask) != 0) {
 			return state;
@@ -896,6 +1032,9 @@ static knotd_in_state_t geoip_process(knotd_in_state_t state, knot_pkt_t *pkt,
 		}
 		geodb_fill_geodata(entries, ctx->path_count,
 		                   dummy.geodata, dummy.geodata_len, &dummy.geodepth);
+		if (slot != NULL) {
+			geo_cache_store(ctx, slot, &dummy, remote, netmask);
+		}
 		break;
 	case MODE_WEIGHTED:
 		dummy.weight = dnssec_random_uint16_t() % data->total_weight;
@@ -961,7 +1100,13 @@ static int load_module(check_ctx_t *check)
 		return KNOT_ENOMEM;
 	}
 
-	knotd_conf_t conf = geo_conf(check, MOD_TTL);
+	knotd_conf_t conf = geo_conf(check, MOD_CONFIG_FILE);
+	ctx->config_file = strdup(conf.single.string);
+	if (ctx->config_file == NULL) {
+		free_geoip_ctx(ctx);
+		return KNOT_ENOMEM;
+	}
+	conf = geo_conf(check, MOD_TTL);
 	ctx->ttl = conf.single.integer;
 	conf = geo_conf(check, MOD_MODE);
 	ctx->mode = conf.single.option;
@@ -976,7 +1121,12 @@ static int load_module(check_ctx_t *check)
 	if (ctx->mode == MODE_GEODB) {
 		// Initialize geodb.
 		conf = geo_conf(check, MOD_GEODB_FILE);
-		ctx->geodb = geodb_open(conf.single.string);
+		ctx->geodb_file = strdup(conf.single.string);
+		if (ctx->geodb_file == NULL) {
+			free_geoip_ctx(ctx);
+			return KNOT_ENOMEM;
+		}
+		ctx->geodb = geodb_open(ctx->geodb_file);
 		if (ctx->geodb == NULL) {
 			geo_log(check, LOG_ERR, "failed to open geo DB");
 			free_geoip_ctx(ctx);
@@ -991,6 +1141,18 @@ static int load_module(check_ctx_t *check)
 			(void)parse_geodb_path(&ctx->paths[i], (char *)conf.multi[i].string);
 		}
 		knotd_conf_free(&conf);
+
+		conf = geo_conf(check, MOD_GEODB_CACHE);
+		if (mod != NULL && conf.single.integer > 0) {
+			ctx->cache_size = conf.single.integer;
+			ctx->cache_threads = knotd_mod_threads(mod);
+			ctx->cache = calloc(ctx->cache_threads * ctx->cache_size,
+			                    sizeof(*ctx->cache));
+			if (ctx->cache == NULL) {
+				free_geoip_ctx(ctx);
+				return KNOT_ENOMEM;
+			}
+		}
 	}
 
 	if (mod != NULL) {
@@ -1038,22 +1200,281 @@ static int load_module(check_ctx_t *check)
 	return ret;
 }
 
+/*!
+ * Rebuilds the module context from the current content of the files, keeping
+ * the settings of the previous context. Doesn't access the configuration, so
+ * it's safe to call outside of the configuration reload.
+ */
+static geoip_ctx_t *geo_ctx_rebuild(knotd_mod_t *mod, const geoip_ctx_t *old)
+{
+	geoip_ctx_t *ctx = calloc(1, sizeof(geoip_ctx_t));
+	if (ctx == NULL) {
+		return NULL;
+	}
+
+	ctx->mode = old->mode;
+	ctx->ttl = old->ttl;
+	ctx->dnssec = old->dnssec;
+	ctx->rotate = old->rotate;
+
+	ctx->config_file = strdup(old->config_file);
+	ctx->geo_trie = trie_create(NULL);
+	if (ctx->config_file == NULL || ctx->geo_trie == NULL) {
+		goto failed;
+	}
+
+	if (ctx->mode == MODE_GEODB) {
+		ctx->geodb_file = strdup(old->geodb_file);
+		if (ctx->geodb_file == NULL) {
+			goto failed;
+		}
+		ctx->geodb = geodb_open(ctx->geodb_file);
+		if (ctx->geodb == NULL) {
+			knotd_mod_log(mod, LOG_ERR, "failed to open geo DB");
+			goto failed;
+		}
+
+		ctx->path_count = old->path_count;
+		for (int i = 0; i < old->path_count; i++) {
+			ctx->paths[i].type = old->paths[i].type;
+			for (int j = 0; j < GEODB_MAX_PATH_LEN; j++) {
+				if (old->paths[i].path[j] == NULL) {
+					break;
+				}
+				ctx->paths[i].path[j] = strdup(old->paths[i].path[j]);
+				if (ctx->paths[i].path[j] == NULL) {
+					goto failed;
+				}
+			}
+		}
+
+		if (old->cache_size > 0) {
+			ctx->cache_size = old->cache_size;
+			ctx->cache_threads = old->cache_threads;
+			ctx->cache = calloc(ctx->cache_threads * ctx->cache_size,
+			                    sizeof(*ctx->cache));
+			if (ctx->cache == NULL) {
+				goto failed;
+			}
+		}
+	}
+
+	check_ctx_t check = { .mod = mod };
+	if (geo_conf_yparse(&check, ctx) != KNOT_EOK) {
+		goto failed;
+	}
+	geo_sort_and_link(ctx);
+
+	return ctx;
+failed:
+	free_geoip_ctx(ctx);
+	return NULL;
+}
+
+static void file_stamp(const char *path, file_stamp_t *stamp)
+{
+	struct stat st;
+	if (path == NULL || stat(path, &st) != 0) {
+		memset(stamp, 0, sizeof(*stamp));
+		return;
+	}
+
+	stamp->mtime = st.st_mtim;
+	stamp->size = st.st_size;
+	stamp->ino = st.st_ino;
+}
+
+static bool file_stamp_eq(const file_stamp_t *a, const file_stamp_t *b)
+{
+	return a->mtime.tv_sec == b->mtime.tv_sec &&
+	       a->mtime.tv_nsec == b->mtime.tv_nsec &&
+	       a->size == b->size && a->ino == b->ino;
+}
+
+static time_t monotonic_sec(void)
+{
+	struct timespec now;
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return now.tv_sec;
+}
+
+/*!
+ * Rebuilds the context if some of the watched files changed. The new context
+ * is published via RCU so the queries are answered without interruption,
+ * the old one is released after the grace period.
+ */
+static void geo_watch_check(geoip_mod_t *geo_mod)
+{
+	geoip_ctx_t *old = geo_mod->ctx; // Only the watcher replaces it.
+
+	file_stamp_t config_stamp, geodb_stamp;
+	file_stamp(old->config_file, &config_stamp);
+	file_stamp(old->geodb_file, &geodb_stamp);
+	if (file_stamp_eq(&config_stamp, &geo_mod->config_stamp) &&
+	    file_stamp_eq(&geodb_stamp, &geo_mod->geodb_stamp)) {
+		return;
+	}
+	// Don't retry a failed rebuild until the files change again.
+	geo_mod->config_stamp = config_stamp;
+	geo_mod->geodb_stamp = geodb_stamp;
+
+	geoip_ctx_t *ctx = geo_ctx_rebuild(geo_mod->mod, old);
+	if (ctx == NULL) {
+		knotd_mod_log(geo_mod->mod, LOG_ERR,
+		              "failed to reload changed data, keeping the previous ones");
+		return;
+	}
+
+	rcu_assign_pointer(geo_mod->ctx, ctx);
+	synchronize_rcu();
+	free_geoip_ctx(old);
+
+	knotd_mod_log(geo_mod->mod, LOG_INFO, "reloaded changed data");
+}
+
+// Single watcher thread shared by all module instances.
+static struct {
+	pthread_mutex_t lock;
+	pthread_cond_t cond;
+	list_t mods;
+	pthread_t thread;
+	unsigned generation; // Incremented to stop the running thread.
+	bool running;
+} watcher = {
+	.lock = PTHREAD_MUTEX_INITIALIZER,
+	.cond = PTHREAD_COND_INITIALIZER,
+};
+
+static void *watcher_run(void *arg)
+{
+	unsigned generation = (uintptr_t)arg;
+
+	pthread_mutex_lock(&watcher.lock);
+	while (watcher.generation == generation) {
+		struct timespec timeout;
+		clock_gettime(CLOCK_REALTIME, &timeout);
+		timeout.tv_sec += 1;
+		(void)pthread_cond_timedwait(&watcher.cond, &watcher.lock, &timeout);
+
+		time_t now = monotonic_sec();
+		geoip_mod_t *geo_mod;
+		WALK_LIST(geo_mod, watcher.mods) {
+			if (watcher.generation != generation) {
+				break;
+			}
+			if (now < geo_mod->next_check) {
+				continue;
+			}
+			geo_mod->next_check = now + geo_mod->interval;
+
+			// The busy instance cannot be removed from the list meanwhile.
+			geo_mod->busy = true;
+			pthread_mutex_unlock(&watcher.lock);
+			geo_watch_check(geo_mod);
+			pthread_mutex_lock(&watcher.lock);
+			geo_mod->busy = false;
+			pthread_cond_broadcast(&watcher.cond);
+		}
+	}
+	pthread_mutex_unlock(&watcher.lock);
+
+	return NULL;
+}
+
+static int watcher_add(geoip_mod_t *geo_mod)
+{
+	int ret = KNOT_EOK;
+
+	pthread_mutex_lock(&watcher.lock);
+	if (!watcher.running) {
+		init_list(&watcher.mods);
+		uintptr_t generation = ++watcher.generation;
+		if (thread_create_nosignal(&watcher.thread, watcher_run,
+		                           (void *)generation) != 0) {
+			ret = KNOT_ERROR;
+			goto done;
+		}
+		watcher.running = true;
+	}
+	geo_mod->next_check = monotonic_sec() + geo_mod->interval;
+	add_tail(&watcher.mods, &geo_mod->n);
+done:
+	pthread_mutex_unlock(&watcher.lock);
+
+	return ret;
+}
+
+static void watcher_remove(geoip_mod_t *geo_mod)
+{
+	pthread_t thread;
+	bool stop = false;
+
+	pthread_mutex_lock(&watcher.lock);
+	while (geo_mod->busy) {
+		pthread_cond_wait(&watcher.cond, &watcher.lock);
+	}
+	rem_node(&geo_mod->n);
+	if (EMPTY_LIST(watcher.mods)) {
+		watcher.generation++;
+		watcher.running = false;
+		thread = watcher.thread;
+		stop = true;
+		pthread_cond_broadcast(&watcher.cond);
+	}
+	pthread_mutex_unlock(&watcher.lock);
+
+	if (stop) {
+		(void)pthread_join(thread, NULL);
+	}
+}
+
 int geoip_load(knotd_mod_t *mod)
 {
+	geoip_mod_t *geo_mod = calloc(1, sizeof(*geo_mod));
+	if (geo_mod == NULL) {
+		return KNOT_ENOMEM;
+	}
+
 	check_ctx_t check = { .mod = mod };
 	int ret = load_module(&check);
 	if (ret != KNOT_EOK) {
+		free(geo_mod);
 		return ret;
 	}
+	geo_mod->mod = mod;
+	geo_mod->ctx = knotd_mod_ctx(mod);
+	knotd_mod_ctx_set(mod, geo_mod);
 
-	return knotd_mod_in_hook(mod, KNOTD_STAGE_PREANSWER, geoip_process);
+	ret = knotd_mod_in_hook(mod, KNOTD_STAGE_PREANSWER, geoip_process);
+	if (ret != KNOT_EOK) {
+		return ret;
+	}
+
+	knotd_conf_t conf = knotd_conf_mod(mod, MOD_WATCH);
+	geo_mod->interval = conf.single.integer;
+	if (geo_mod->interval > 0) {
+		file_stamp(geo_mod->ctx->config_file, &geo_mod->config_stamp);
+		file_stamp(geo_mod->ctx->geodb_file, &geo_mod->geodb_stamp);
+
+		ret = watcher_add(geo_mod);
+		if (ret != KNOT_EOK) {
+			knotd_mod_log(mod, LOG_ERR, "failed to start files watcher");
+			geo_mod->interval = 0;
+		}
+	}
+
+	return KNOT_EOK;
 }
 
 void geoip_unload(knotd_mod_t *mod)
 {
-	geoip_ctx_t *ctx = knotd_mod_ctx(mod);
-	if (ctx != NULL) {
-		free_geoip_ctx(ctx);
+	geoip_mod_t *geo_mod = knotd_mod_ctx(mod);
+	if (geo_mod != NULL) {
+		if (geo_mod->interval > 0) {
+			watcher_remove(geo_mod);
+		}
+		free_geoip_ctx(geo_mod->ctx);
+		free(geo_mod);
 	}
 }
 
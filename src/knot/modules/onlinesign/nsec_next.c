@@ -75,7 +75,8 @@ static void strip_label(uint8_t **name_ptr)
 	*name_ptr += 1 + len;
 }
 
-knot_dname_t *online_nsec_next(const knot_dname_t *dname, const knot_dname_t *apex)
+knot_dname_t *online_nsec_next(const knot_dname_t *dname, const knot_dname_t *apex,
+                               knot_mm_t *mm)
 {
 	assert(dname);
 	assert(apex);
@@ -91,7 +92,7 @@ knot_dname_t *online_nsec_next(const knot_dname_t *dname, const knot_dname_t *ap
 		uint8_t *pos = copy + empty_len - 2;
 		pos[0] = 0x01;
 		pos[1] = 0x00;
-		return knot_dname_copy(pos, NULL);
+		return knot_dname_copy(pos, mm);
 	}
 
 	// find apex position in the buffer
@@ -103,11 +104,11 @@ knot_dname_t *online_nsec_next(const knot_dname_t *dname, const knot_dname_t *ap
 	uint8_t *pos = copy + empty_len;
 	while (pos != apex_pos) {
 		if (inc_label(copy, &pos)) {
-			return knot_dname_copy(pos, NULL);
+			return knot_dname_copy(pos, mm);
 		}
 		strip_label(&pos);
 	}
 
 	// apex completes the chain
-	return knot_dname_copy(pos, NULL);
+	return knot_dname_copy(pos, mm);
 }
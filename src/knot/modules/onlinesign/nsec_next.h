@@ -23,7 +23,9 @@
  *
  * \param dname  Current dname in the NSEC chain.
  * \param apex   Zone apex name, used when we reach the end of the chain.
+ * \param mm     Memory context for the result.
  *
  * \return Successor of dname in the NSEC chain.
  */
-knot_dname_t *online_nsec_next(const knot_dname_t *dname, const knot_dname_t *apex);
+knot_dname_t *online_nsec_next(const knot_dname_t *dname, const knot_dname_t *apex,
+                               knot_mm_t *mm);
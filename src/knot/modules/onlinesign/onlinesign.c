@@ -22,6 +22,7 @@
 #include "libdnssec/error.h"
 #include "knot/include/module.h"
 #include "knot/modules/onlinesign/nsec_next.h"
+#include "knot/modules/onlinesign/sig_cache.h"
 // Next dependencies force static module!
 #include "knot/dnssec/ds_query.h"
 #include "knot/dnssec/key-events.h"
@@ -34,6 +35,9 @@
 
 #define MOD_POLICY	"\x06""policy"
 #define MOD_NSEC_BITMAP	"\x0B""nsec-bitmap"
+#define MOD_CACHE_SIZE	"\x0A""cache-size"
+
+#define SIGN_CTX_POOL_MAX	64
 
 int policy_check(knotd_conf_check_args_t *args)
 {
@@ -60,6 +64,7 @@ int bitmap_check(knotd_conf_check_args_t *args)
 const yp_item_t online_sign_conf[] = {
 	{ MOD_POLICY,      YP_TREF, YP_VREF = { C_POLICY }, YP_FNONE, { policy_check } },
 	{ MOD_NSEC_BITMAP, YP_TSTR, YP_VNONE, YP_FMULTI, { bitmap_check } },
+	{ MOD_CACHE_SIZE,  YP_TINT, YP_VINT = { 0, INT32_MAX, 0 } },
 	{ NULL }
 };
 
@@ -87,9 +92,65 @@ typedef struct {
 
 	uint16_t *nsec_force_types;
 
+	online_sig_cache_t *sig_cache;
+
+	pthread_mutex_t pool_mutex;
+	zone_sign_ctx_t *sign_ctx_pool[SIGN_CTX_POOL_MAX];
+	size_t sign_ctx_pool_count;
+
 	bool zone_doomed;
 } online_sign_ctx_t;
 
+/*!
+ * \brief Get a signing context for the current keyset, reused if possible.
+ *
+ * \note Must be called with signing_mutex held.
+ */
+static zone_sign_ctx_t *sign_ctx_get(online_sign_ctx_t *ctx, knotd_mod_t *mod)
+{
+	zone_sign_ctx_t *sign_ctx = NULL;
+
+	pthread_mutex_lock(&ctx->pool_mutex);
+	if (ctx->sign_ctx_pool_count > 0) {
+		sign_ctx = ctx->sign_ctx_pool[--ctx->sign_ctx_pool_count];
+	}
+	pthread_mutex_unlock(&ctx->pool_mutex);
+
+	if (sign_ctx == NULL) {
+		sign_ctx = zone_sign_ctx(mod->keyset, mod->dnssec);
+	}
+
+	return sign_ctx;
+}
+
+static void sign_ctx_put(online_sign_ctx_t *ctx, zone_sign_ctx_t *sign_ctx)
+{
+	if (sign_ctx == NULL) {
+		return;
+	}
+
+	pthread_mutex_lock(&ctx->pool_mutex);
+	if (ctx->sign_ctx_pool_count < SIGN_CTX_POOL_MAX) {
+		ctx->sign_ctx_pool[ctx->sign_ctx_pool_count++] = sign_ctx;
+		sign_ctx = NULL;
+	}
+	pthread_mutex_unlock(&ctx->pool_mutex);
+
+	zone_sign_ctx_free(sign_ctx);
+}
+
+/*!
+ * \brief Drop pooled signing contexts, e.g. before keyset change.
+ */
+static void sign_ctx_pool_flush(online_sign_ctx_t *ctx)
+{
+	pthread_mutex_lock(&ctx->pool_mutex);
+	while (ctx->sign_ctx_pool_count > 0) {
+		zone_sign_ctx_free(ctx->sign_ctx_pool[--ctx->sign_ctx_pool_count]);
+	}
+	pthread_mutex_unlock(&ctx->pool_mutex);
+}
+
 static bool want_dnssec(knotd_qdata_t *qdata)
 {
 	return knot_pkt_has_dnssec(qdata->query);
@@ -193,7 +254,7 @@ static knot_rrset_t *synth_nsec(knot_pkt_t *pkt, knotd_qdata_t *qdata, knotd_mod
 		return NULL;
 	}
 
-	knot_dname_t *next = online_nsec_next(nsec_owner, knotd_qdata_zone_name(qdata));
+	knot_dname_t *next = online_nsec_next(nsec_owner, knotd_qdata_zone_name(qdata), mm);
 	if (!next) {
 		knot_rrset_free(nsec, mm);
 		return NULL;
@@ -208,7 +269,7 @@ static knot_rrset_t *synth_nsec(knot_pkt_t *pkt, knotd_qdata_t *qdata, knotd_mod
 
 	dnssec_nsec_bitmap_t *bitmap = synth_bitmap(qdata, force_types);
 	if (!bitmap) {
-		free(next);
+		knot_dname_free(next, mm);
 		knot_rrset_free(nsec, mm);
 		return NULL;
 	}
@@ -219,7 +280,7 @@ static knot_rrset_t *synth_nsec(knot_pkt_t *pkt, knotd_qdata_t *qdata, knotd_mod
 	int written = knot_dname_to_wire(rdata, next, size);
 	dnssec_nsec_bitmap_write(bitmap, rdata + written);
 
-	knot_dname_free(next, NULL);
+	knot_dname_free(next, mm);
 	dnssec_nsec_bitmap_free(bitmap);
 
 	if (knot_rrset_add_rdata(nsec, rdata, size, mm) != KNOT_EOK) {
@@ -230,50 +291,61 @@ static knot_rrset_t *synth_nsec(knot_pkt_t *pkt, knotd_qdata_t *qdata, knotd_mod
 	return nsec;
 }
 
+/*!
+ * \brief Sign the RRSet, or take its signatures from the cache.
+ *
+ * \note The signing context is created on the first cache miss.
+ */
 static knot_rrset_t *sign_rrset(const knot_dname_t *owner,
                                 const knot_rrset_t *cover,
                                 knotd_mod_t *mod,
-                                zone_sign_ctx_t *sign_ctx,
+                                zone_sign_ctx_t **sign_ctx,
                                 knot_mm_t *mm)
 {
-	// copy of RR set with replaced owner name
+	// RR set with replaced owner name
 
-	knot_rrset_t *copy = knot_rrset_new(owner, cover->type, cover->rclass,
-	                                    cover->ttl, NULL);
-	if (!copy) {
-		return NULL;
-	}
-
-	if (knot_rdataset_copy(&copy->rrs, &cover->rrs, NULL) != KNOT_EOK) {
-		knot_rrset_free(copy, NULL);
-		return NULL;
-	}
+	knot_rrset_t copy;
+	knot_rrset_init(&copy, (knot_dname_t *)owner, cover->type, cover->rclass, cover->ttl);
+	copy.rrs = cover->rrs;
 
 	// resulting RRSIG
 
-	knot_rrset_t *rrsig = knot_rrset_new(owner, KNOT_RRTYPE_RRSIG, copy->rclass,
-	                                     copy->ttl, mm);
+	knot_rrset_t *rrsig = knot_rrset_new(owner, KNOT_RRTYPE_RRSIG, copy.rclass,
+	                                     copy.ttl, mm);
 	if (!rrsig) {
-		knot_rrset_free(copy, NULL);
 		return NULL;
 	}
 
 	online_sign_ctx_t *ctx = knotd_mod_ctx(mod);
-	pthread_rwlock_rdlock(&ctx->signing_mutex);
-	int ret = knot_sign_rrset2(rrsig, copy, sign_ctx, mm);
-	pthread_rwlock_unlock(&ctx->signing_mutex);
+	knot_time_t now = mod->dnssec->now;
+	int ret = KNOT_ENOENT;
+	if (ctx->sig_cache != NULL) {
+		ret = online_sig_cache_get(ctx->sig_cache, &copy, now, &rrsig->rrs, mm);
+	}
+	if (ret == KNOT_EOK) {
+		return rrsig;
+	}
+
+	if (*sign_ctx == NULL) {
+		*sign_ctx = sign_ctx_get(ctx, mod);
+	}
+	ret = (*sign_ctx != NULL) ? knot_sign_rrset2(rrsig, &copy, *sign_ctx, mm) : KNOT_ENOMEM;
 	if (ret != KNOT_EOK) {
-		knot_rrset_free(copy, NULL);
 		knot_rrset_free(rrsig, mm);
 		return NULL;
 	}
 
-	knot_rrset_free(copy, NULL);
+	// Reuse the signatures for half of their lifetime, but not beyond TTL before expiration.
+	uint32_t reuse = mod->dnssec->policy->rrsig_lifetime / 2;
+	if (ctx->sig_cache != NULL && copy.ttl <= reuse) {
+		(void)online_sig_cache_put(ctx->sig_cache, &copy, &rrsig->rrs, now + reuse);
+	}
 
 	return rrsig;
 }
 
-static glue_t *find_glue_for(const knot_rrset_t *rr, const knot_pkt_t *pkt)
+static const zone_node_t *find_glue_for(const knot_rrset_t *rr, const knot_pkt_t *pkt,
+                                        knotd_qdata_t *qdata)
 {
 	for (int i = KNOT_ANSWER; i <= KNOT_AUTHORITY; i++) {
 		const knot_pktsection_t *section = knot_pkt_section(pkt, i);
@@ -281,9 +353,14 @@ static glue_t *find_glue_for(const knot_rrset_t *rr, const knot_pkt_t *pkt)
 			const knot_rrset_t *attempt = knot_pkt_rr(section, j);
 			const additional_t *a = attempt->additional;
 			for (int k = 0; a != NULL && k < a->count; k++) {
+				bool optional;
+				const zone_node_t *gn = zone_contents_glue_node(qdata->extra->contents,
+				                                                &a->glues[k], attempt,
+				                                                qdata->extra->node,
+				                                                &optional);
 				// no need for knot_dname_cmp because the pointers are assigned
-				if (a->glues[k].node->owner == rr->owner) {
-					return &a->glues[k];
+				if (gn != NULL && gn->owner == rr->owner) {
+					return gn;
 				}
 			}
 		}
@@ -294,9 +371,8 @@ static glue_t *find_glue_for(const knot_rrset_t *rr, const knot_pkt_t *pkt)
 static bool shall_sign_rr(const knot_rrset_t *rr, const knot_pkt_t *pkt, knotd_qdata_t *qdata)
 {
 	if (pkt->current == KNOT_ADDITIONAL) {
-		glue_t *g = find_glue_for(rr, pkt);
-		assert(g); // finds actually the node which is rr in
-		const zone_node_t *gn = glue_node(g, qdata->extra->node);
+		const zone_node_t *gn = find_glue_for(rr, pkt, qdata);
+		assert(gn); // finds actually the node which is rr in
 		return !(gn->flags & NODE_FLAGS_NONAUTH);
 	} else {
 		return !is_deleg(pkt) || rr->type == KNOT_RRTYPE_NSEC;
@@ -313,10 +389,10 @@ static knotd_in_state_t sign_section(knotd_in_state_t state, knot_pkt_t *pkt,
 	const knot_pktsection_t *section = knot_pkt_section(pkt, pkt->current);
 	assert(section);
 
-	zone_sign_ctx_t *sign_ctx = zone_sign_ctx(mod->keyset, mod->dnssec);
-	if (sign_ctx == NULL) {
-		return KNOTD_IN_STATE_ERROR;
-	}
+	online_sign_ctx_t *ctx = knotd_mod_ctx(mod);
+	zone_sign_ctx_t *sign_ctx = NULL;
+
+	pthread_rwlock_rdlock(&ctx->signing_mutex);
 
 	uint16_t count_unsigned = section->count;
 	for (int i = 0; i < count_unsigned; i++) {
@@ -331,7 +407,7 @@ static knotd_in_state_t sign_section(knotd_in_state_t state, knot_pkt_t *pkt,
 		knot_dname_unpack(owner, pkt->wire + rr_pos, sizeof(owner), pkt->wire);
 		knot_dname_to_lower(owner);
 
-		knot_rrset_t *rrsig = sign_rrset(owner, rr, mod, sign_ctx, &pkt->mm);
+		knot_rrset_t *rrsig = sign_rrset(owner, rr, mod, &sign_ctx, &pkt->mm);
 		if (!rrsig) {
 			state = KNOTD_IN_STATE_ERROR;
 			break;
@@ -345,7 +421,8 @@ static knotd_in_state_t sign_section(knotd_in_state_t state, knot_pkt_t *pkt,
 		}
 	}
 
-	zone_sign_ctx_free(sign_ctx);
+	sign_ctx_put(ctx, sign_ctx);
+	pthread_rwlock_unlock(&ctx->signing_mutex);
 
 	return state;
 }
@@ -488,7 +565,7 @@ static knotd_in_state_t pre_routine(knotd_in_state_t state, knot_pkt_t *pkt,
 	int ret = KNOT_ESEMCHECK;
 	if (knot_time_cmp(ctx->event_parent_ds_q, mod->dnssec->now) <= 0) {
 		pthread_rwlock_rdlock(&ctx->signing_mutex);
-		ret = knot_parent_ds_query(conf(), mod->dnssec, qdata->params->server, 1000);
+		ret = knot_parent_ds_query(conf(), mod->dnssec, qdata->params->server, 1000, false);
 		pthread_rwlock_unlock(&ctx->signing_mutex);
 		if (ret != KNOT_EOK && ret != KNOT_NO_READY_KEY && mod->dnssec->policy->ksk_sbm_check_interval > 0) {
 			ctx->event_parent_ds_q = mod->dnssec->now + mod->dnssec->policy->ksk_sbm_check_interval;
@@ -513,6 +590,8 @@ static knotd_in_state_t pre_routine(knotd_in_state_t state, knot_pkt_t *pkt,
 		ctx->event_rollover = resch.next_rollover;
 
 		pthread_rwlock_wrlock(&ctx->signing_mutex);
+		sign_ctx_pool_flush(ctx);
+		online_sig_cache_clear(ctx->sig_cache);
 		knotd_mod_dnssec_unload_keyset(mod);
 		ret = knotd_mod_dnssec_load_keyset(mod, true);
 		if (ret != KNOT_EOK) {
@@ -602,8 +681,12 @@ static knotd_in_state_t synth_answer(knotd_in_state_t state, knot_pkt_t *pkt,
 
 static void online_sign_ctx_free(online_sign_ctx_t *ctx)
 {
+	sign_ctx_pool_flush(ctx);
+	online_sig_cache_free(ctx->sig_cache);
+
 	pthread_mutex_destroy(&ctx->event_mutex);
 	pthread_rwlock_destroy(&ctx->signing_mutex);
+	pthread_mutex_destroy(&ctx->pool_mutex);
 
 	free(ctx->nsec_force_types);
 	free(ctx);
@@ -649,6 +732,7 @@ static int online_sign_ctx_new(online_sign_ctx_t **ctx_ptr, knotd_mod_t *mod)
 
 	pthread_mutex_init(&ctx->event_mutex, NULL);
 	pthread_rwlock_init(&ctx->signing_mutex, NULL);
+	pthread_mutex_init(&ctx->pool_mutex, NULL);
 
 	*ctx_ptr = ctx;
 
@@ -712,6 +796,15 @@ int online_sign_load(knotd_mod_t *mod)
 		return ret;
 	}
 
+	conf = knotd_conf_mod(mod, MOD_CACHE_SIZE);
+	if (conf.single.integer > 0) {
+		ctx->sig_cache = online_sig_cache_new(conf.single.integer);
+		if (ctx->sig_cache == NULL) {
+			online_sign_ctx_free(ctx);
+			return KNOT_ENOMEM;
+		}
+	}
+
 	knotd_mod_ctx_set(mod, ctx);
 
 	knotd_mod_in_hook(mod, KNOTD_STAGE_ANSWER, pre_routine);
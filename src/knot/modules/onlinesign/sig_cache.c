@@ -0,0 +1,243 @@
+/*  Copyright (C) 2024 CZ.NIC, z.s.p.o. <knot-dns@labs.nic.cz>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "contrib/macros.h"
+#include "contrib/openbsd/siphash.h"
+#include "contrib/qp-trie/trie.h"
+#include "contrib/ucw/lists.h"
+#include "contrib/wire_ctx.h"
+#include "knot/modules/onlinesign/sig_cache.h"
+#include "libdnssec/random.h"
+#include "libknot/errcode.h"
+
+#define SHARDS		16
+// Larger RRSets are rare in synthesized answers and not worth caching.
+#define KEY_MAX		1024
+
+typedef struct {
+	node_t n;                 // Node in the LRU list.
+	knot_time_t valid_until;
+	knot_rdataset_t rrsigs;
+	uint16_t key_len;
+	uint8_t key[];
+} sig_cache_entry_t;
+
+typedef struct {
+	pthread_mutex_t mx;
+	trie_t *entries;          // Key -> entry.
+	list_t lru;               // Most recently used first.
+	size_t count;
+} sig_cache_shard_t;
+
+struct online_sig_cache {
+	size_t shard_capacity;
+	SIPHASH_KEY hash_key;
+	sig_cache_shard_t shards[SHARDS];
+};
+
+static size_t make_key(uint8_t *key, const knot_rrset_t *covered)
+{
+	wire_ctx_t wire = wire_ctx_init(key, KEY_MAX);
+	wire_ctx_write(&wire, covered->owner, knot_dname_size(covered->owner));
+	wire_ctx_write_u16(&wire, covered->type);
+	wire_ctx_write_u16(&wire, covered->rclass);
+	wire_ctx_write_u32(&wire, covered->ttl);
+	wire_ctx_write_u16(&wire, covered->rrs.count);
+	wire_ctx_write(&wire, covered->rrs.rdata, covered->rrs.size);
+
+	return (wire.error == KNOT_EOK) ? wire_ctx_offset(&wire) : 0;
+}
+
+static sig_cache_shard_t *get_shard(online_sig_cache_t *cache, const uint8_t *key,
+                                    size_t key_len)
+{
+	SIPHASH_CTX ctx;
+	SipHash24_Init(&ctx, &cache->hash_key);
+	SipHash24_Update(&ctx, key, key_len);
+	return &cache->shards[SipHash24_End(&ctx) % SHARDS];
+}
+
+static void entry_free(sig_cache_entry_t *entry)
+{
+	knot_rdataset_clear(&entry->rrsigs, NULL);
+	free(entry);
+}
+
+static void entry_remove(sig_cache_shard_t *shard, sig_cache_entry_t *entry)
+{
+	trie_del(shard->entries, entry->key, entry->key_len, NULL);
+	rem_node(&entry->n);
+	shard->count--;
+	entry_free(entry);
+}
+
+static void shard_clear(sig_cache_shard_t *shard)
+{
+	sig_cache_entry_t *entry, *next;
+	WALK_LIST_DELSAFE(entry, next, shard->lru) {
+		entry_free(entry);
+	}
+	init_list(&shard->lru);
+	trie_clear(shard->entries);
+	shard->count = 0;
+}
+
+online_sig_cache_t *online_sig_cache_new(size_t capacity)
+{
+	online_sig_cache_t *cache = calloc(1, sizeof(*cache));
+	if (cache == NULL) {
+		return NULL;
+	}
+
+	cache->shard_capacity = MAX(1, capacity / SHARDS);
+	dnssec_random_buffer((uint8_t *)&cache->hash_key, sizeof(cache->hash_key));
+
+	for (size_t i = 0; i < SHARDS; i++) {
+		sig_cache_shard_t *shard = &cache->shards[i];
+		shard->entries = trie_create(NULL);
+		if (shard->entries == NULL) {
+			online_sig_cache_free(cache);
+			return NULL;
+		}
+		pthread_mutex_init(&shard->mx, NULL);
+		init_list(&shard->lru);
+	}
+
+	return cache;
+}
+
+void online_sig_cache_free(online_sig_cache_t *cache)
+{
+	if (cache == NULL) {
+		return;
+	}
+
+	for (size_t i = 0; i < SHARDS; i++) {
+		sig_cache_shard_t *shard = &cache->shards[i];
+		if (shard->entries == NULL) {
+			break;
+		}
+		shard_clear(shard);
+		trie_free(shard->entries);
+		pthread_mutex_destroy(&shard->mx);
+	}
+	free(cache);
+}
+
+void online_sig_cache_clear(online_sig_cache_t *cache)
+{
+	if (cache == NULL) {
+		return;
+	}
+
+	for (size_t i = 0; i < SHARDS; i++) {
+		sig_cache_shard_t *shard = &cache->shards[i];
+		pthread_mutex_lock(&shard->mx);
+		shard_clear(shard);
+		pthread_mutex_unlock(&shard->mx);
+	}
+}
+
+int online_sig_cache_get(online_sig_cache_t *cache, const knot_rrset_t *covered,
+                         knot_time_t now, knot_rdataset_t *out, knot_mm_t *mm)
+{
+	if (cache == NULL || covered == NULL || out == NULL) {
+		return KNOT_EINVAL;
+	}
+
+	uint8_t key[KEY_MAX];
+	size_t key_len = make_key(key, covered);
+	if (key_len == 0) {
+		return KNOT_ENOENT;
+	}
+
+	sig_cache_shard_t *shard = get_shard(cache, key, key_len);
+	int ret = KNOT_ENOENT;
+
+	pthread_mutex_lock(&shard->mx);
+	trie_val_t *val = trie_get_try(shard->entries, key, key_len);
+	if (val != NULL) {
+		sig_cache_entry_t *entry = *val;
+		if (knot_time_cmp(now, entry->valid_until) >= 0) {
+			entry_remove(shard, entry);
+		} else {
+			rem_node(&entry->n);
+			add_head(&shard->lru, &entry->n);
+			ret = knot_rdataset_copy(out, &entry->rrsigs, mm);
+		}
+	}
+	pthread_mutex_unlock(&shard->mx);
+
+	return ret;
+}
+
+int online_sig_cache_put(online_sig_cache_t *cache, const knot_rrset_t *covered,
+                         const knot_rdataset_t *rrsigs, knot_time_t valid_until)
+{
+	if (cache == NULL || covered == NULL || rrsigs == NULL) {
+		return KNOT_EINVAL;
+	}
+
+	uint8_t key[KEY_MAX];
+	size_t key_len = make_key(key, covered);
+	if (key_len == 0) {
+		return KNOT_ESPACE;
+	}
+
+	sig_cache_entry_t *entry = calloc(1, sizeof(*entry) + key_len);
+	if (entry == NULL) {
+		return KNOT_ENOMEM;
+	}
+	entry->valid_until = valid_until;
+	entry->key_len = key_len;
+	memcpy(entry->key, key, key_len);
+	int ret = knot_rdataset_copy(&entry->rrsigs, rrsigs, NULL);
+	if (ret != KNOT_EOK) {
+		free(entry);
+		return ret;
+	}
+
+	sig_cache_shard_t *shard = get_shard(cache, key, key_len);
+
+	pthread_mutex_lock(&shard->mx);
+	trie_val_t *val = trie_get_ins(shard->entries, key, key_len);
+	if (val == NULL) {
+		pthread_mutex_unlock(&shard->mx);
+		entry_free(entry);
+		return KNOT_ENOMEM;
+	}
+	if (*val != NULL) { // Concurrently signed by another thread.
+		sig_cache_entry_t *old = *val;
+		rem_node(&old->n);
+		shard->count--;
+		entry_free(old);
+	}
+	*val = entry;
+	add_head(&shard->lru, &entry->n);
+	shard->count++;
+
+	if (shard->count > cache->shard_capacity) {
+		entry_remove(shard, TAIL(shard->lru));
+	}
+	pthread_mutex_unlock(&shard->mx);
+
+	return KNOT_EOK;
+}
@@ -0,0 +1,77 @@
+/*  Copyright (C) 2024 CZ.NIC, z.s.p.o. <knot-dns@labs.nic.cz>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+
+#pragma once
+
+#include "contrib/time.h"
+#include "libknot/mm_ctx.h"
+#include "libknot/rrset.h"
+
+/*!
+ * \brief Bounded cache of RRSIGs of synthesized and signed answer records.
+ *
+ * The cache is split into independently locked shards, each evicting
+ * the least recently used entry when full.
+ */
+typedef struct online_sig_cache online_sig_cache_t;
+
+/*!
+ * \brief Create the cache.
+ *
+ * \param capacity  Maximum number of cached RRSIG sets.
+ *
+ * \return Allocated cache or NULL.
+ */
+online_sig_cache_t *online_sig_cache_new(size_t capacity);
+
+/*!
+ * \brief Free the cache.
+ */
+void online_sig_cache_free(online_sig_cache_t *cache);
+
+/*!
+ * \brief Drop all cached entries, e.g. upon signing keys change.
+ */
+void online_sig_cache_clear(online_sig_cache_t *cache);
+
+/*!
+ * \brief Look up RRSIGs covering given RRSet.
+ *
+ * \param cache    Signature cache.
+ * \param covered  Signed RRSet with the final owner name.
+ * \param now      Current time.
+ * \param out      Output: copy of the cached RRSIGs.
+ * \param mm       Memory context for the output.
+ *
+ * \retval KNOT_ENOENT if not cached or no longer valid.
+ * \return KNOT_E*
+ */
+int online_sig_cache_get(online_sig_cache_t *cache, const knot_rrset_t *covered,
+                         knot_time_t now, knot_rdataset_t *out, knot_mm_t *mm);
+
+/*!
+ * \brief Store RRSIGs covering given RRSet.
+ *
+ * \param cache        Signature cache.
+ * \param covered      Signed RRSet with the final owner name.
+ * \param rrsigs       RRSIGs to be cached.
+ * \param valid_until  Time until the RRSIGs may be reused.
+ *
+ * \return KNOT_E*
+ */
+int online_sig_cache_put(online_sig_cache_t *cache, const knot_rrset_t *covered,
+                         const knot_rdataset_t *rrsigs, knot_time_t valid_until);
@@ -27,11 +27,24 @@
 #define MOD_PATH       "\x04""path"
 #define MOD_CHANNELS   "\x08""channels"
 #define MOD_MAX_RATE   "\x08""max-rate"
+#define MOD_TRANSPORT  "\x09""transport"
+
+enum {
+	TRANSPORT_SOCKET,
+	TRANSPORT_SHM,
+};
+
+static const knot_lookup_t transports[] = {
+	{ TRANSPORT_SOCKET, "socket" },
+	{ TRANSPORT_SHM,    "shared-memory" },
+	{ 0, NULL }
+};
 
 const yp_item_t probe_conf[] = {
 	{ MOD_PATH,     YP_TSTR, YP_VNONE },
 	{ MOD_CHANNELS, YP_TINT, YP_VINT = { 1, UINT16_MAX, 1 } },
 	{ MOD_MAX_RATE, YP_TINT, YP_VINT = { 0, UINT32_MAX, 100000 } },
+	{ MOD_TRANSPORT, YP_TOPT, YP_VOPT = { transports, TRANSPORT_SOCKET } },
 	{ NULL }
 };
 
@@ -148,6 +161,9 @@ int probe_load(knotd_mod_t *mod)
 		ctx->min_diff_ns = ctx->probe_count * 1000000000 / conf.single.integer;
 	}
 
+	conf = knotd_conf_mod(mod, MOD_TRANSPORT);
+	bool shm = (conf.single.option == TRANSPORT_SHM);
+
 	for (int i = 0; i < ctx->probe_count; i++) {
 		knot_probe_t *probe = knot_probe_alloc();
 		if (probe == NULL) {
@@ -155,13 +171,15 @@ int probe_load(knotd_mod_t *mod)
 			return KNOT_ENOMEM;
 		}
 
-		int ret = knot_probe_set_producer(probe, ctx->path, i + 1);
+		int ret = shm ? knot_probe_set_producer_shm(probe, ctx->path, i + 1) :
+		                knot_probe_set_producer(probe, ctx->path, i + 1);
 		switch (ret) {
 		case KNOT_ECONN:
 			knotd_mod_log(mod, LOG_NOTICE, "channel %i not connected", i + 1);
 		case KNOT_EOK:
 			break;
 		default:
+			knot_probe_free(probe);
 			free_probe_ctx(ctx);
 			return ret;
 		}
@@ -42,9 +42,16 @@
 
 #define RRL_LIMIT_KOEF 1/2 // Avoid probabilistic rounding wherever possible.
 
+// Zone related keys, charged by one multi-key KRU query.
+#define RRL_ZONE_KEYS (uint8_t[]) { RRL_KEY_ZONE, RRL_KEY_PREFIX_ZONE, RRL_KEY_NXDOMAIN }
+#define RRL_ZONE_KEYS_CNT (sizeof(RRL_ZONE_KEYS) / sizeof(*RRL_ZONE_KEYS))
+
 struct rrl_table {
 	kru_price_t v4_prices[RRL_V4_PREFIXES_CNT];
 	kru_price_t v6_prices[RRL_V6_PREFIXES_CNT];
+	kru_price_t zone_prices[RRL_ZONE_KEYS_CNT]; // Zero if disabled.
+	kru_price_t base_price;
+	uint32_t rate_limit;
 	uint32_t log_period;
 	bool rw_mode;
 	_Atomic uint32_t log_time;
@@ -69,7 +76,7 @@ static void addr_tostr(char *dst, size_t maxlen, const struct sockaddr_storage *
 }
 
 static void rrl_log_limited(rrl_log_params_t *params, const struct sockaddr_storage *ss,
-                            const uint8_t prefix, bool rate)
+                            const uint8_t prefix, rrl_key_t key, bool rate)
 {
 	if (params == NULL) {
 		return;
@@ -93,10 +100,25 @@ static void rrl_log_limited(rrl_log_params_t *params, const struct sockaddr_stor
 		}
 	}
 
-	knotd_mod_log(params->mod, LOG_NOTICE, "address %s %s limited on /%d by %s%s%s",
-	              addr_str, proto_str, prefix, rate ? "rate" : "time",
-	              (qname_str != NULL ? ", qname " : ""),
-	              (qname_str != NULL ? qname_str : ""));
+	const char *key_str;
+	switch (key) {
+	case RRL_KEY_ZONE:        key_str = "zone "; break;
+	case RRL_KEY_PREFIX_ZONE: key_str = "prefix and zone "; break;
+	case RRL_KEY_NXDOMAIN:    key_str = "NXDOMAIN "; break;
+	default:                  key_str = NULL; break;
+	}
+
+	if (key_str == NULL) {
+		knotd_mod_log(params->mod, LOG_NOTICE, "address %s %s limited on /%d by %s%s%s",
+		              addr_str, proto_str, prefix, rate ? "rate" : "time",
+		              (qname_str != NULL ? ", qname " : ""),
+		              (qname_str != NULL ? qname_str : ""));
+	} else {
+		knotd_mod_log(params->mod, LOG_NOTICE, "address %s %s limited by %srate%s%s",
+		              addr_str, proto_str, key_str,
+		              (qname_str != NULL ? ", qname " : ""),
+		              (qname_str != NULL ? qname_str : ""));
+	}
 }
 
 rrl_table_t *rrl_create(size_t size, uint32_t instant_limit, uint32_t rate_limit,
@@ -137,6 +159,8 @@ rrl_table_t *rrl_create(size_t size, uint32_t instant_limit, uint32_t rate_limit
 		rrl->v6_prices[i] = base_price / RRL_V6_RATE_MULT[i];
 	}
 
+	rrl->base_price = base_price;
+	rrl->rate_limit = rate_limit;
 	rrl->rw_mode = rw_mode;
 	rrl->log_period = log_period;
 
@@ -148,7 +172,80 @@ rrl_table_t *rrl_create(size_t size, uint32_t instant_limit, uint32_t rate_limit
 	return rrl;
 }
 
-int rrl_query(rrl_table_t *rrl, const struct sockaddr_storage *remote, rrl_log_params_t *log)
+void rrl_set_limit(rrl_table_t *rrl, rrl_key_t key, uint32_t rate_limit)
+{
+	assert(rrl);
+	assert(rrl->rw_mode);
+
+	for (size_t i = 0; i < RRL_ZONE_KEYS_CNT; i++) {
+		if (RRL_ZONE_KEYS[i] != key) {
+			continue;
+		}
+		if (rate_limit == 0) {
+			rrl->zone_prices[i] = 0;
+		} else {
+			// All keys share the table decay, so the price determines the rate.
+			assert(rate_limit >= rrl->rate_limit); // Ensured by config check.
+			uint64_t price = (uint64_t)rrl->base_price * rrl->rate_limit / rate_limit;
+			rrl->zone_prices[i] = MAX(price, 1);
+		}
+	}
+}
+
+static void zone_key(uint8_t key[16], const struct sockaddr_storage *remote,
+                     rrl_key_t kind, const knot_dname_t *zone)
+{
+	// FNV-1a of the (canonical) zone name.
+	uint64_t hash = 14695981039346656037LLU;
+	for (const uint8_t *c = zone; c < zone + knot_dname_size(zone); c++) {
+		hash = (hash ^ *c) * 1099511628211LLU;
+	}
+
+	memset(key, 0, 16);
+	memcpy(key, &hash, sizeof(hash));
+	if (kind == RRL_KEY_PREFIX_ZONE) {
+		if (remote->ss_family == AF_INET6) {
+			struct sockaddr_in6 *ipv6 = (struct sockaddr_in6 *)remote;
+			memcpy(key + 8, &ipv6->sin6_addr, 7); // /56
+		} else {
+			struct sockaddr_in *ipv4 = (struct sockaddr_in *)remote;
+			memcpy(key + 8, &ipv4->sin_addr, 3); // /24
+		}
+	}
+	key[15] = kind;
+}
+
+static rrl_key_t zone_limited(rrl_table_t *rrl, uint32_t now, const struct sockaddr_storage *remote,
+                              unsigned keys, const knot_dname_t *zone)
+{
+	_Alignas(16) uint8_t key_data[RRL_ZONE_KEYS_CNT][16];
+	uint8_t *key_ptrs[RRL_ZONE_KEYS_CNT];
+	kru_price_t prices[RRL_ZONE_KEYS_CNT];
+	rrl_key_t kind = 0;
+	size_t cnt = 0;
+
+	for (size_t i = 0; i < RRL_ZONE_KEYS_CNT; i++) {
+		if (!(keys & RRL_ZONE_KEYS[i]) || rrl->zone_prices[i] == 0) {
+			continue;
+		}
+		zone_key(key_data[cnt], remote, RRL_ZONE_KEYS[i], zone);
+		key_ptrs[cnt] = key_data[cnt];
+		prices[cnt] = rrl->zone_prices[i];
+		kind = RRL_ZONE_KEYS[i];
+		cnt++;
+	}
+
+	if (cnt == 0 || !KRU.limited_multi_or((struct kru *)rrl->kru, now,
+	                                      key_ptrs, prices, cnt)) {
+		return 0;
+	}
+
+	// The blocking key isn't known if more of them were queried.
+	return (cnt == 1) ? kind : RRL_KEY_ZONE;
+}
+
+int rrl_query(rrl_table_t *rrl, const struct sockaddr_storage *remote, unsigned keys,
+              const knot_dname_t *zone, rrl_log_params_t *log)
 {
 	assert(rrl);
 	assert(remote);
@@ -157,10 +254,13 @@ int rrl_query(rrl_table_t *rrl, const struct sockaddr_storage *remote, rrl_log_p
 	clock_gettime(CLOCK_MONOTONIC_COARSE, &now_ts);
 	uint32_t now = now_ts.tv_sec * 1000 + now_ts.tv_nsec / 1000000;
 
+	rrl_key_t limited_key = RRL_KEY_PREFIX;
 	uint16_t load = 0;
 	uint8_t prefix = 0;
 	_Alignas(16) uint8_t key[16] = { 0 };
-	if (remote->ss_family == AF_INET6) {
+	if (!(keys & RRL_KEY_PREFIX)) {
+		// Only zone related keys are charged.
+	} else if (remote->ss_family == AF_INET6) {
 		struct sockaddr_in6 *ipv6 = (struct sockaddr_in6 *)remote;
 		memcpy(key, &ipv6->sin6_addr, 16);
 
@@ -190,7 +290,13 @@ int rrl_query(rrl_table_t *rrl, const struct sockaddr_storage *remote, rrl_log_p
 
 	if (rrl->rw_mode) {
 		if (prefix == 0) {
-			return KNOT_EOK;
+			if (zone == NULL) {
+				return KNOT_EOK;
+			}
+			limited_key = zone_limited(rrl, now, remote, keys, zone);
+			if (limited_key == 0) {
+				return KNOT_EOK;
+			}
 		}
 	} else {
 		if (load <= (1 << 16) * RRL_LIMIT_KOEF) {
@@ -203,7 +309,7 @@ int rrl_query(rrl_table_t *rrl, const struct sockaddr_storage *remote, rrl_log_p
 		do {
 			if (atomic_compare_exchange_weak_explicit(&rrl->log_time, &log_time_orig, now,
 			                                          memory_order_relaxed, memory_order_relaxed)) {
-				rrl_log_limited(log, remote, prefix, rrl->rw_mode);
+				rrl_log_limited(log, remote, prefix, limited_key, rrl->rw_mode);
 				break;
 			}
 		} while (now - log_time_orig + 1024 >= rrl->log_period + 1024);
@@ -216,7 +322,6 @@ void rrl_update(rrl_table_t *rrl, const struct sockaddr_storage *remote, size_t
 {
 	assert(rrl);
 	assert(remote);
-	assert(!rrl->rw_mode);
 
 	struct timespec now_ts;
 	clock_gettime(CLOCK_MONOTONIC_COARSE, &now_ts);
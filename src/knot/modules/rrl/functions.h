@@ -23,6 +23,14 @@
 
 typedef struct rrl_table rrl_table_t;
 
+/*! \brief Kinds of keys charged by one query. */
+typedef enum {
+	RRL_KEY_PREFIX      = 1 << 0, /*!< Source address prefixes. */
+	RRL_KEY_ZONE        = 1 << 1, /*!< Queried zone. */
+	RRL_KEY_PREFIX_ZONE = 1 << 2, /*!< Source address prefix (/24 or /56) and queried zone. */
+	RRL_KEY_NXDOMAIN    = 1 << 3, /*!< NXDOMAIN responses from the queried zone. */
+} rrl_key_t;
+
 /*!
  * \brief Create a RRL table.
  *
@@ -37,6 +45,19 @@ typedef struct rrl_table rrl_table_t;
 rrl_table_t *rrl_create(size_t size, uint32_t instant_limit, uint32_t rate_limit,
                         bool rw_mode, uint32_t log_period);
 
+/*!
+ * \brief Set the rate limit of a zone related key kind.
+ *
+ * The instant limit is proportional to the table one.
+ *
+ * \note This function is only for the RW mode!
+ *
+ * \param rrl RRL table.
+ * \param key Key kind (other than RRL_KEY_PREFIX).
+ * \param rate_limit Rate limit, not lower than the table one (0 disables the key).
+ */
+void rrl_set_limit(rrl_table_t *rrl, rrl_key_t key, uint32_t rate_limit);
+
 typedef struct {
 	knotd_mod_t *mod;
 	knotd_qdata_t *qdata;      // For rate limiting.
@@ -48,19 +69,26 @@ typedef struct {
  *
  * \note This function is common to both RW and non-RW modes!
  *
+ * In the RW mode, the enabled zone related keys are checked and charged
+ * together by one KRU query after the address prefixes pass.
+ *
  * \param rrl RRL table.
  * \param remote Source address.
+ * \param keys Kinds of keys to be charged (rrl_key_t flags).
+ * \param zone Queried zone name for the zone related keys (can be NULL).
  * \param log Logging parameters (can be NULL).
  *
  * \retval KNOT_EOK if passed.
  * \retval KNOT_ELIMIT when the limit is reached.
  */
-int rrl_query(rrl_table_t *rrl, const struct sockaddr_storage *remote, rrl_log_params_t *log);
+int rrl_query(rrl_table_t *rrl, const struct sockaddr_storage *remote, unsigned keys,
+              const knot_dname_t *zone, rrl_log_params_t *log);
 
 /*!
  * \brief Update the RRL table.
  *
- * \note This function is only for the non-RW mode!
+ * In the RW mode, the value is charged as an additional cost of an already
+ * passed query, without any limit check.
  *
  * \param rrl RRL table.
  * \param remote Source address.
@@ -28,6 +28,10 @@
 #define MOD_WHITELIST		"\x09""whitelist"
 #define MOD_LOG_PERIOD		"\x0A""log-period"
 #define MOD_DRY_RUN		"\x07""dry-run"
+#define MOD_ZONE_RATE_LIMIT	"\x0F""zone-rate-limit"
+#define MOD_PZONE_RATE_LIMIT	"\x16""prefix-zone-rate-limit"
+#define MOD_NXD_RATE_LIMIT	"\x13""nxdomain-rate-limit"
+#define MOD_COST_UNIT		"\x0E""rate-cost-unit"
 
 const yp_item_t rrl_conf[] = {
 	{ MOD_INST_LIMIT,    YP_TINT, YP_VINT = { 1,  (1ll << 32) / 768 - 1, 125 } },
@@ -39,6 +43,10 @@ const yp_item_t rrl_conf[] = {
 	{ MOD_WHITELIST,     YP_TNET, YP_VNONE, YP_FMULTI },
 	{ MOD_LOG_PERIOD,    YP_TINT, YP_VINT = { 0, INT32_MAX, 30000 } },
 	{ MOD_DRY_RUN,       YP_TBOOL, YP_VNONE },
+	{ MOD_ZONE_RATE_LIMIT,  YP_TINT, YP_VINT = { 0, UINT32_MAX, 0 } },
+	{ MOD_PZONE_RATE_LIMIT, YP_TINT, YP_VINT = { 0, UINT32_MAX, 0 } },
+	{ MOD_NXD_RATE_LIMIT,   YP_TINT, YP_VINT = { 0, UINT32_MAX, 0 } },
+	{ MOD_COST_UNIT,        YP_TINT, YP_VINT = { 0, 1000000, 0 } },
 	{ NULL }
 };
 
@@ -51,6 +59,17 @@ int rrl_conf_check(knotd_conf_check_args_t *args)
 		return KNOT_EINVAL;
 	}
 
+	const yp_name_t *zone_limits[] = {
+		MOD_ZONE_RATE_LIMIT, MOD_PZONE_RATE_LIMIT, MOD_NXD_RATE_LIMIT
+	};
+	for (size_t i = 0; i < sizeof(zone_limits) / sizeof(*zone_limits); i++) {
+		knotd_conf_t limit = knotd_conf_check_item(args, zone_limits[i]);
+		if (limit.single.integer > 0 && limit.single.integer < rate_limit.single.integer) {
+			args->err_str = "zone rate limit is lower than rate limit";
+			return KNOT_EINVAL;
+		}
+	}
+
 	knotd_conf_t t_rate_limit = knotd_conf_check_item(args, MOD_T_RATE_LIMIT);
 	knotd_conf_t t_inst_limit = knotd_conf_check_item(args, MOD_T_INST_LIMIT);
 	if (t_rate_limit.single.integer > 1000ll * t_inst_limit.single.integer) {
@@ -65,6 +84,8 @@ typedef struct {
 	ALIGNED_CPU_CACHE // Ensures that one thread context occupies one cache line.
 	struct timespec start_time; // Start time of the measurement.
 	bool skip; // Skip the time table update.
+	struct timespec rate_start; // Start time of the query processing.
+	bool rate_measure; // Charge the query cost to the rate table.
 } thrd_ctx_t;
 
 typedef struct {
@@ -73,7 +94,10 @@ typedef struct {
 	thrd_ctx_t *thrd_ctx;
 	int slip;
 	bool dry_run;
-	knotd_conf_t whitelist;
+	knotd_addr_set_t *whitelist;
+	unsigned zone_keys; // Zone related keys charged at the query beginning.
+	uint32_t cost_unit; // Processing time (in microseconds) of one query, 0 if disabled.
+	uint32_t nxdomain_limit;
 } rrl_ctx_t;
 
 static uint32_t time_diff_us(const struct timespec *begin, const struct timespec *end)
@@ -98,14 +122,14 @@ static knotd_proto_state_t protolimit_start(knotd_proto_state_t state,
 	}
 
 	// Check if a whitelisted client.
-	if (knotd_conf_addr_range_match(&ctx->whitelist, params->remote)) {
+	if (knotd_addr_set_match(ctx->whitelist, params->remote)) {
 		thrd->skip = true;
 		return state;
 	}
 
 	// Check if the packet is limited.
 	rrl_log_params_t log = { .mod = mod, .proto = params->proto };
-	if (rrl_query(ctx->time_table, params->remote, &log) != KNOT_EOK) {
+	if (rrl_query(ctx->time_table, params->remote, RRL_KEY_PREFIX, NULL, &log) != KNOT_EOK) {
 		thrd->skip = true;
 		knotd_mod_stats_incr(mod, params->thread_id, 2, 0, 1);
 		return ctx->dry_run ? state : KNOTD_PROTO_STATE_BLOCK;
@@ -145,36 +169,31 @@ static knotd_proto_state_t protolimit_end(knotd_proto_state_t state,
 	return state;
 }
 
-static knotd_state_t ratelimit_apply(knotd_state_t state, knot_pkt_t *pkt,
-                                     knotd_qdata_t *qdata, knotd_mod_t *mod)
+static bool ratelimit_skip(rrl_ctx_t *ctx, knotd_qdata_t *qdata)
 {
-	assert(pkt && qdata && mod);
-
-	rrl_ctx_t *ctx = knotd_mod_ctx(mod);
-
 	// Rate limiting is applied only to UDP.
 	if (qdata->params->proto != KNOTD_QUERY_PROTO_UDP) {
-		return state;
+		return true;
 	}
 
 	// NOTE: (qdata->params->flags & KNOTD_QUERY_FLAG_AUTHORIZED) can't be true here.
 
 	// Check for whitelisted client.
-	if (knotd_conf_addr_range_match(&ctx->whitelist, qdata->params->remote)) {
-		return state;
+	if (knotd_addr_set_match(ctx->whitelist, qdata->params->remote)) {
+		return true;
 	}
 
 	// Rate limiting is not applied to responses with a valid cookie.
 	if (qdata->params->flags & KNOTD_QUERY_FLAG_COOKIE) {
-		return state;
+		return true;
 	}
 
-	rrl_log_params_t log = { .mod = mod, .qdata = qdata };
-	if (rrl_query(ctx->rate_table, knotd_qdata_remote_addr(qdata), &log) == KNOT_EOK) {
-		// Rate limiting not applied.
-		return state;
-	}
+	return false;
+}
 
+static knotd_state_t ratelimit_limited(knotd_state_t state, rrl_ctx_t *ctx,
+                                       knotd_qdata_t *qdata, knotd_mod_t *mod)
+{
 	if (rrl_slip_roll(ctx->slip)) {
 		// Slip the answer.
 		knotd_mod_stats_incr(mod, qdata->params->thread_id, 0, 0, 1);
@@ -187,6 +206,75 @@ static knotd_state_t ratelimit_apply(knotd_state_t state, knot_pkt_t *pkt,
 	}
 }
 
+static knotd_state_t ratelimit_apply(knotd_state_t state, knot_pkt_t *pkt,
+                                     knotd_qdata_t *qdata, knotd_mod_t *mod)
+{
+	assert(pkt && qdata && mod);
+
+	rrl_ctx_t *ctx = knotd_mod_ctx(mod);
+	thrd_ctx_t *thrd = &ctx->thrd_ctx[qdata->params->thread_id];
+	thrd->rate_measure = false;
+
+	if (ratelimit_skip(ctx, qdata)) {
+		return state;
+	}
+
+	rrl_log_params_t log = { .mod = mod, .qdata = qdata };
+	if (rrl_query(ctx->rate_table, knotd_qdata_remote_addr(qdata),
+	              RRL_KEY_PREFIX | ctx->zone_keys, knotd_qdata_zone_name(qdata),
+	              &log) == KNOT_EOK) {
+		// Rate limiting not applied.
+		if (ctx->cost_unit > 0) {
+			clock_gettime(CLOCK_MONOTONIC, &thrd->rate_start);
+			thrd->rate_measure = true;
+		}
+		return state;
+	}
+
+	return ratelimit_limited(state, ctx, qdata, mod);
+}
+
+static knotd_state_t ratelimit_end(knotd_state_t state, knot_pkt_t *pkt,
+                                   knotd_qdata_t *qdata, knotd_mod_t *mod)
+{
+	assert(pkt && qdata && mod);
+
+	rrl_ctx_t *ctx = knotd_mod_ctx(mod);
+	thrd_ctx_t *thrd = &ctx->thrd_ctx[qdata->params->thread_id];
+
+	// Charge the processing time exceeding the cost of one query.
+	if (thrd->rate_measure) {
+		thrd->rate_measure = false;
+
+		struct timespec end_time;
+		clock_gettime(CLOCK_MONOTONIC, &end_time);
+		uint64_t cost = time_diff_us(&thrd->rate_start, &end_time) / ctx->cost_unit;
+		if (cost > 0) { // Zero KRU update is NOOP.
+			rrl_update(ctx->rate_table, knotd_qdata_remote_addr(qdata), cost);
+		}
+	}
+
+	// Only complete NXDOMAIN answers, not those already limited.
+	if (ctx->nxdomain_limit == 0 || state != KNOTD_STATE_DONE ||
+	    qdata->rcode != KNOT_RCODE_NXDOMAIN || qdata->err_truncated ||
+	    ratelimit_skip(ctx, qdata)) {
+		return state;
+	}
+
+	const knot_dname_t *zone = knotd_qdata_zone_name(qdata);
+	if (zone == NULL) {
+		return state;
+	}
+
+	rrl_log_params_t log = { .mod = mod, .qdata = qdata };
+	if (rrl_query(ctx->rate_table, knotd_qdata_remote_addr(qdata),
+	              RRL_KEY_NXDOMAIN, zone, &log) == KNOT_EOK) {
+		return state;
+	}
+
+	return ratelimit_limited(state, ctx, qdata, mod);
+}
+
 static void ctx_free(rrl_ctx_t *ctx)
 {
 	assert(ctx);
@@ -194,7 +282,7 @@ static void ctx_free(rrl_ctx_t *ctx)
 	free(ctx->thrd_ctx);
 	rrl_destroy(ctx->rate_table);
 	rrl_destroy(ctx->time_table);
-	knotd_conf_free(&ctx->whitelist);
+	knotd_addr_set_free(ctx->whitelist);
 	free(ctx);
 }
 
@@ -206,7 +294,13 @@ int rrl_load(knotd_mod_t *mod)
 	}
 
 	ctx->dry_run = knotd_conf_mod(mod, MOD_DRY_RUN).single.boolean;
-	ctx->whitelist = knotd_conf_mod(mod, MOD_WHITELIST);
+	knotd_conf_t whitelist = knotd_conf_mod(mod, MOD_WHITELIST);
+	ctx->whitelist = knotd_conf_addr_set(&whitelist);
+	knotd_conf_free(&whitelist);
+	if (ctx->whitelist == NULL) {
+		ctx_free(ctx);
+		return KNOT_ENOMEM;
+	}
 
 	ctx->thrd_ctx = calloc(knotd_mod_threads(mod), sizeof(*ctx->thrd_ctx));
 	if (ctx->thrd_ctx == NULL) {
@@ -226,6 +320,24 @@ int rrl_load(knotd_mod_t *mod)
 			return KNOT_ENOMEM;
 		}
 		ctx->slip = knotd_conf_mod(mod, MOD_SLIP).single.integer;
+
+		const struct {
+			const yp_name_t *name;
+			rrl_key_t key;
+		} zone_limits[] = {
+			{ MOD_ZONE_RATE_LIMIT,  RRL_KEY_ZONE },
+			{ MOD_PZONE_RATE_LIMIT, RRL_KEY_PREFIX_ZONE },
+			{ MOD_NXD_RATE_LIMIT,   RRL_KEY_NXDOMAIN },
+		};
+		for (size_t i = 0; i < sizeof(zone_limits) / sizeof(*zone_limits); i++) {
+			uint32_t limit = knotd_conf_mod(mod, zone_limits[i].name).single.integer;
+			rrl_set_limit(ctx->rate_table, zone_limits[i].key, limit);
+			if (limit > 0 && zone_limits[i].key != RRL_KEY_NXDOMAIN) {
+				ctx->zone_keys |= zone_limits[i].key;
+			}
+		}
+		ctx->nxdomain_limit = knotd_conf_mod(mod, MOD_NXD_RATE_LIMIT).single.integer;
+		ctx->cost_unit = knotd_conf_mod(mod, MOD_COST_UNIT).single.integer;
 	}
 
 	uint32_t time_limit = knotd_conf_mod(mod, MOD_T_RATE_LIMIT).single.integer;
@@ -268,6 +380,10 @@ int rrl_load(knotd_mod_t *mod)
 		knotd_mod_hook(mod, KNOTD_STAGE_BEGIN, ratelimit_apply);
 	}
 
+	if (ctx->nxdomain_limit > 0 || ctx->cost_unit > 0) {
+		knotd_mod_hook(mod, KNOTD_STAGE_END, ratelimit_end);
+	}
+
 	if (time_limit > 0) {
 		// Note that these two callbacks aren't executed IF PER-ZONE module!
 		knotd_mod_proto_hook(mod, KNOTD_STAGE_PROTO_BEGIN, protolimit_start);
@@ -282,5 +398,6 @@ void rrl_unload(knotd_mod_t *mod)
 	ctx_free(knotd_mod_ctx(mod));
 }
 
-KNOTD_MOD_API(rrl, KNOTD_MOD_FLAG_SCOPE_ANY | KNOTD_MOD_FLAG_OPT_CONF,
+KNOTD_MOD_API(rrl, KNOTD_MOD_FLAG_SCOPE_ANY | KNOTD_MOD_FLAG_OPT_CONF |
+              KNOTD_MOD_FLAG_SHARED,
               rrl_load, rrl_unload, rrl_conf, rrl_conf_check);
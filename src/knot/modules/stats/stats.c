@@ -14,9 +14,12 @@
     along with this program.  If not, see <https://www.gnu.org/licenses/>.
  */
 
+#include <arpa/inet.h>
+
 #include "contrib/macros.h"
 #include "contrib/wire_ctx.h"
 #include "knot/include/module.h"
+#include "knot/modules/stats/topk.h"
 #include "knot/nameserver/xfr.h" // Dependency on qdata->extra!
 
 #define MOD_PROTOCOL	"\x10""request-protocol"
@@ -32,6 +35,14 @@
 #define MOD_QTYPE	"\x0A""query-type"
 #define MOD_QSIZE	"\x0A""query-size"
 #define MOD_RSIZE	"\x0A""reply-size"
+#define MOD_LATENCY	"\x0D""query-latency"
+#define MOD_TOP_QNAME	"\x09""top-qname"
+#define MOD_TOP_QNAME_RCODE "\x0F""top-qname-rcode"
+#define MOD_TOP_ZONE	"\x08""top-zone"
+#define MOD_TOP_CLIENT	"\x0A""top-client"
+#define MOD_TOP_SIZE	"\x08""top-size"
+#define MOD_PHASES	"\x0C""query-phases"
+#define MOD_PHASES_SAMPLE "\x13""query-phases-sample"
 
 #define OTHER		"other"
 
@@ -49,6 +60,14 @@ const yp_item_t stats_conf[] = {
 	{ MOD_QTYPE,      YP_TBOOL, YP_VNONE },
 	{ MOD_QSIZE,      YP_TBOOL, YP_VNONE },
 	{ MOD_RSIZE,      YP_TBOOL, YP_VNONE },
+	{ MOD_LATENCY,    YP_TBOOL, YP_VNONE },
+	{ MOD_TOP_QNAME,  YP_TBOOL, YP_VNONE },
+	{ MOD_TOP_QNAME_RCODE, YP_TBOOL, YP_VNONE },
+	{ MOD_TOP_ZONE,   YP_TBOOL, YP_VNONE },
+	{ MOD_TOP_CLIENT, YP_TBOOL, YP_VNONE },
+	{ MOD_TOP_SIZE,   YP_TINT, YP_VINT = { 1, 10000, 20 } },
+	{ MOD_PHASES,     YP_TBOOL, YP_VNONE },
+	{ MOD_PHASES_SAMPLE, YP_TINT, YP_VINT = { 1, UINT32_MAX, 1000 } },
 	{ NULL }
 };
 
@@ -66,8 +85,20 @@ enum {
 	CTR_QTYPE,
 	CTR_QSIZE,
 	CTR_RSIZE,
+	CTR_LATENCY,
+	CTR_TOP_QNAME,
+	CTR_TOP_QNAME_RCODE,
+	CTR_TOP_ZONE,
+	CTR_TOP_CLIENT,
+	CTR_PHASES,
+	CTR_TOP__COUNT = CTR_TOP_CLIENT - CTR_TOP_QNAME + 1
 };
 
+typedef struct {
+	_Alignas(64) // Ensures that one thread context occupies one cache line.
+	struct timespec start; // Start of the request processing.
+} thrd_ctx_t;
+
 typedef struct {
 	bool protocol;
 	bool operation;
@@ -82,6 +113,11 @@ typedef struct {
 	bool qtype;
 	bool qsize;
 	bool rsize;
+	bool latency;
+	thrd_ctx_t *thrd_ctx;
+	topk_t *top[CTR_TOP__COUNT]; // Heavy-hitter trackers, indexed from CTR_TOP_QNAME.
+	size_t top_size;
+	bool phases;
 } stats_t;
 
 typedef struct {
@@ -350,6 +386,71 @@ static char *rsize_to_str(uint32_t idx, uint32_t count)
 	return size_to_str(idx, count);
 }
 
+/*
+ * Log-linear latency buckets in microseconds: exact values below 4, then each
+ * power of two is split into 4 equal ranges, up to 2^24 us (about 16 s).
+ */
+#define LATENCY_LINEAR	4
+#define LATENCY_MAX_EXP	24
+#define LATENCY_BUCKETS	(LATENCY_LINEAR + (LATENCY_MAX_EXP - 2) * 4 + 1)
+
+enum {
+	LATENCY_UDP = 0,
+	LATENCY_TCP,
+	LATENCY_QUIC,
+	LATENCY_TLS,
+	LATENCY__PROTOS,
+	LATENCY__COUNT = LATENCY__PROTOS * LATENCY_BUCKETS
+};
+
+static uint32_t latency_bucket(uint64_t usec)
+{
+	if (usec < LATENCY_LINEAR) {
+		return usec;
+	}
+
+	unsigned exp = 63 - __builtin_clzll(usec);
+	if (exp >= LATENCY_MAX_EXP) {
+		return LATENCY_BUCKETS - 1;
+	}
+
+	unsigned sub = (usec >> (exp - 2)) & 3;
+	return LATENCY_LINEAR + (exp - 2) * 4 + sub;
+}
+
+static char *latency_to_str(uint32_t idx, uint32_t count)
+{
+	const char *proto;
+	switch (idx / LATENCY_BUCKETS) {
+	case LATENCY_UDP:  proto = "udp"; break;
+	case LATENCY_TCP:  proto = "tcp"; break;
+	case LATENCY_QUIC: proto = "quic"; break;
+	case LATENCY_TLS:  proto = "tls"; break;
+	default:           assert(0); return NULL;
+	}
+
+	uint32_t bucket = idx % LATENCY_BUCKETS;
+
+	char str[48];
+	int ret;
+	if (bucket < LATENCY_LINEAR) {
+		ret = snprintf(str, sizeof(str), "%s-%u-%u", proto, bucket, bucket);
+	} else if (bucket < LATENCY_BUCKETS - 1) {
+		unsigned exp = (bucket - LATENCY_LINEAR) / 4 + 2;
+		unsigned sub = (bucket - LATENCY_LINEAR) % 4;
+		ret = snprintf(str, sizeof(str), "%s-%u-%u", proto,
+		               (4 + sub) << (exp - 2), ((5 + sub) << (exp - 2)) - 1);
+	} else {
+		ret = snprintf(str, sizeof(str), "%s-%u-max", proto, 1U << LATENCY_MAX_EXP);
+	}
+
+	if (ret <= 0 || (size_t)ret >= sizeof(str)) {
+		return NULL;
+	} else {
+		return strdup(str);
+	}
+}
+
 static const ctr_desc_t ctr_descs[] = {
 	#define item(macro, name, count) \
 		[CTR_##macro] = { MOD_##macro, offsetof(stats_t, name), (count), name##_to_str }
@@ -366,9 +467,117 @@ static const ctr_desc_t ctr_descs[] = {
 	item(QTYPE,      qtype,      QTYPE__COUNT),
 	item(QSIZE,      qsize,      QSIZE_MAX_IDX + 1),
 	item(RSIZE,      rsize,      RSIZE_MAX_IDX + 1),
+	item(LATENCY,    latency,    LATENCY__COUNT),
 	{ NULL }
 };
 
+/*
+ * Heavy-hitter keys: the query name, the query name followed by the response
+ * code index, the zone name, or the IP version followed by the client address
+ * prefix. The prefix lengths are multiples of 8 so no masking is needed.
+ */
+#define TOP_PREFIX_V4	24
+#define TOP_PREFIX_V6	56
+
+static const yp_name_t *top_conf_names[] = {
+	[CTR_TOP_QNAME - CTR_TOP_QNAME]       = MOD_TOP_QNAME,
+	[CTR_TOP_QNAME_RCODE - CTR_TOP_QNAME] = MOD_TOP_QNAME_RCODE,
+	[CTR_TOP_ZONE - CTR_TOP_QNAME]        = MOD_TOP_ZONE,
+	[CTR_TOP_CLIENT - CTR_TOP_QNAME]      = MOD_TOP_CLIENT,
+};
+
+static topk_t *top_tracker(stats_t *stats, unsigned ctr_id)
+{
+	return stats->top[ctr_id - CTR_TOP_QNAME];
+}
+
+static size_t client_key(uint8_t *key, const struct sockaddr_storage *addr)
+{
+	if (addr->ss_family == AF_INET) {
+		const struct sockaddr_in *ipv4 = (const struct sockaddr_in *)addr;
+		key[0] = 4;
+		memcpy(key + 1, &ipv4->sin_addr, TOP_PREFIX_V4 / 8);
+		return 1 + TOP_PREFIX_V4 / 8;
+	} else if (addr->ss_family == AF_INET6) {
+		const struct sockaddr_in6 *ipv6 = (const struct sockaddr_in6 *)addr;
+		key[0] = 6;
+		memcpy(key + 1, &ipv6->sin6_addr, TOP_PREFIX_V6 / 8);
+		return 1 + TOP_PREFIX_V6 / 8;
+	} else {
+		return 0;
+	}
+}
+
+typedef struct {
+	uint32_t ctr_id;
+	knotd_mod_stats_item_f cb;
+	void *data;
+} top_dump_ctx_t;
+
+static int top_item(const uint8_t *key, size_t len, uint64_t count, void *data)
+{
+	top_dump_ctx_t *ctx = data;
+
+	char str[KNOT_DNAME_TXT_MAXLEN + 32];
+	size_t used;
+
+	switch (ctx->ctr_id) {
+	case CTR_TOP_QNAME:
+	case CTR_TOP_ZONE:
+		if (knot_dname_to_str(str, key, sizeof(str)) == NULL) {
+			return KNOT_EOK;
+		}
+		break;
+	case CTR_TOP_QNAME_RCODE:;
+		uint16_t idx;
+		if (len < sizeof(idx) || knot_dname_to_str(str, key, sizeof(str)) == NULL) {
+			return KNOT_EOK;
+		}
+		memcpy(&idx, key + len - sizeof(idx), sizeof(idx));
+		char *rcode = rcode_to_str(idx, RCODE_OTHER + 1);
+		if (rcode == NULL) {
+			return KNOT_EOK;
+		}
+		used = strlen(str);
+		(void)snprintf(str + used, sizeof(str) - used, "/%s", rcode);
+		free(rcode);
+		break;
+	case CTR_TOP_CLIENT:;
+		uint8_t addr[16] = { 0 };
+		if (len < 1 || len - 1 > sizeof(addr)) {
+			return KNOT_EOK;
+		}
+		memcpy(addr, key + 1, len - 1);
+		int family = (key[0] == 4) ? AF_INET : AF_INET6;
+		if (inet_ntop(family, addr, str, sizeof(str)) == NULL) {
+			return KNOT_EOK;
+		}
+		used = strlen(str);
+		(void)snprintf(str + used, sizeof(str) - used, "/%u",
+		               (family == AF_INET) ? TOP_PREFIX_V4 : TOP_PREFIX_V6);
+		break;
+	default:
+		assert(0);
+		return KNOT_EINVAL;
+	}
+
+	return ctx->cb(str, count, ctx->data);
+}
+
+static int top_dump(knotd_mod_t *mod, uint32_t ctr_id, knotd_mod_stats_item_f item,
+                    void *data)
+{
+	stats_t *stats = knotd_mod_ctx(mod);
+
+	top_dump_ctx_t ctx = {
+		.ctr_id = ctr_id,
+		.cb = item,
+		.data = data
+	};
+
+	return topk_dump(top_tracker(stats, ctr_id), stats->top_size, top_item, &ctx);
+}
+
 static void incr_edns_option(knotd_mod_t *mod, unsigned thr_id, const knot_pkt_t *pkt, unsigned ctr_name)
 {
 	if (!knot_pkt_has_edns(pkt)) {
@@ -649,9 +858,127 @@ static knotd_state_t update_counters(knotd_state_t state, knot_pkt_t *pkt,
 		knotd_mod_stats_incr(mod, tid, CTR_RSIZE, MIN(idx, RSIZE_MAX_IDX), 1);
 	}
 
+	// Track the heavy hitters.
+	uint8_t key[TOPK_KEY_MAXLEN];
+	const knot_dname_t *qname = knot_pkt_qname(qdata->query);
+	size_t qname_size = qdata->query->qname_size;
+	if (qname != NULL) {
+		topk_t *top = top_tracker(stats, CTR_TOP_QNAME);
+		if (top != NULL) {
+			topk_add(top, tid, qname, qname_size);
+		}
+
+		top = top_tracker(stats, CTR_TOP_QNAME_RCODE);
+		if (top != NULL && state != KNOTD_STATE_NOOP) {
+			uint16_t idx = (qdata->rcode_tsig == KNOT_RCODE_BADSIG) ?
+			               RCODE_BADSIG : MIN(rcode, RCODE_OTHER);
+			memcpy(key, qname, qname_size);
+			memcpy(key + qname_size, &idx, sizeof(idx));
+			topk_add(top, tid, key, qname_size + sizeof(idx));
+		}
+	}
+
+	topk_t *top = top_tracker(stats, CTR_TOP_ZONE);
+	const knot_dname_t *zone = knotd_qdata_zone_name(qdata);
+	if (top != NULL && zone != NULL) {
+		topk_add(top, tid, zone, knot_dname_size(zone));
+	}
+
+	top = top_tracker(stats, CTR_TOP_CLIENT);
+	if (top != NULL) {
+		size_t len = client_key(key, knotd_qdata_remote_addr(qdata));
+		if (len > 0) {
+			topk_add(top, tid, key, len);
+		}
+	}
+
+	return state;
+}
+
+static void latency_start(stats_t *stats, unsigned thr_id)
+{
+	clock_gettime(CLOCK_MONOTONIC, &stats->thrd_ctx[thr_id].start);
+}
+
+static void latency_end(knotd_mod_t *mod, stats_t *stats, unsigned thr_id,
+                        knotd_query_proto_t proto)
+{
+	struct timespec end;
+	clock_gettime(CLOCK_MONOTONIC, &end);
+
+	const struct timespec *start = &stats->thrd_ctx[thr_id].start;
+	if (start->tv_sec == 0 && start->tv_nsec == 0) {
+		return; // Not started (e.g. blocked at the beginning).
+	}
+	int64_t usec = (end.tv_sec - start->tv_sec) * 1000000 +
+	               (end.tv_nsec - start->tv_nsec) / 1000;
+	stats->thrd_ctx[thr_id].start = (struct timespec){ 0 };
+
+	uint32_t idx;
+	switch (proto) {
+	case KNOTD_QUERY_PROTO_UDP:  idx = LATENCY_UDP; break;
+	case KNOTD_QUERY_PROTO_TCP:  idx = LATENCY_TCP; break;
+	case KNOTD_QUERY_PROTO_QUIC: idx = LATENCY_QUIC; break;
+	case KNOTD_QUERY_PROTO_TLS:  idx = LATENCY_TLS; break;
+	default:                     return;
+	}
+	idx = idx * LATENCY_BUCKETS + latency_bucket(MAX(usec, 0));
+
+	knotd_mod_stats_incr(mod, thr_id, CTR_LATENCY, idx, 1);
+}
+
+// Global module: from the request reception to the response sending.
+static knotd_proto_state_t latency_proto_begin(knotd_proto_state_t state,
+                                               knotd_qdata_params_t *params,
+                                               knotd_mod_t *mod)
+{
+	latency_start(knotd_mod_ctx(mod), params->thread_id);
+	return state;
+}
+
+static knotd_proto_state_t latency_proto_end(knotd_proto_state_t state,
+                                             knotd_qdata_params_t *params,
+                                             knotd_mod_t *mod)
+{
+	latency_end(mod, knotd_mod_ctx(mod), params->thread_id, params->proto);
+	return state;
+}
+
+static int phases_dump(knotd_mod_t *mod, uint32_t ctr_id,
+                       knotd_mod_stats_item_f item, void *data)
+{
+	return knotd_mod_query_phases_dump(item, data);
+}
+
+// Per-zone module: the zone query processing only.
+static knotd_state_t latency_begin(knotd_state_t state, knot_pkt_t *pkt,
+                                   knotd_qdata_t *qdata, knotd_mod_t *mod)
+{
+	latency_start(knotd_mod_ctx(mod), qdata->params->thread_id);
+	return state;
+}
+
+static knotd_state_t latency_zone_end(knotd_state_t state, knot_pkt_t *pkt,
+                                      knotd_qdata_t *qdata, knotd_mod_t *mod)
+{
+	latency_end(mod, knotd_mod_ctx(mod), qdata->params->thread_id,
+	            qdata->params->proto);
 	return state;
 }
 
+static void stats_unload_ctx(stats_t *stats)
+{
+	if (stats == NULL) {
+		return;
+	}
+
+	for (unsigned i = 0; i < CTR_TOP__COUNT; i++) {
+		topk_free(stats->top[i]);
+	}
+	free(stats->thrd_ctx);
+	free(stats);
+}
+
 int stats_load(knotd_mod_t *mod)
 {
 	stats_t *stats = calloc(1, sizeof(*stats));
@@ -674,15 +1001,81 @@ int stats_load(knotd_mod_t *mod)
 		}
 	}
 
+	knotd_conf_t conf = knotd_conf_mod(mod, MOD_TOP_SIZE);
+	stats->top_size = conf.single.integer;
+
+	for (unsigned i = 0; i < CTR_TOP__COUNT; i++) {
+		conf = knotd_conf_mod(mod, top_conf_names[i]);
+		bool enabled = conf.single.boolean;
+		if (enabled) {
+			// Track more keys than reported to make the results more accurate.
+			stats->top[i] = topk_create(knotd_mod_threads(mod), 4 * stats->top_size);
+			if (stats->top[i] == NULL) {
+				stats_unload_ctx(stats);
+				return KNOT_ENOMEM;
+			}
+		}
+
+		int ret = knotd_mod_stats_add_dynamic(mod, enabled ? top_conf_names[i] + 1 : NULL,
+		                                      top_dump);
+		if (ret != KNOT_EOK) {
+			stats_unload_ctx(stats);
+			return ret;
+		}
+	}
+
+	conf = knotd_conf_mod(mod, MOD_PHASES);
+	stats->phases = conf.single.boolean;
+	int ret = knotd_mod_stats_add_dynamic(mod, stats->phases ? MOD_PHASES + 1 : NULL,
+	                                      phases_dump);
+	if (ret != KNOT_EOK) {
+		stats_unload_ctx(stats);
+		return ret;
+	}
+
+	if (stats->latency) {
+		size_t size = knotd_mod_threads(mod) * sizeof(*stats->thrd_ctx);
+		if (posix_memalign((void **)&stats->thrd_ctx, 64, MAX(size, 64)) != 0) {
+			stats_unload_ctx(stats);
+			return KNOT_ENOMEM;
+		}
+		memset(stats->thrd_ctx, 0, size);
+	}
+
+	if (stats->phases) {
+		conf = knotd_conf_mod(mod, MOD_PHASES_SAMPLE);
+		ret = knotd_mod_query_phases_enable(mod, conf.single.integer);
+		if (ret != KNOT_EOK) {
+			stats_unload_ctx(stats);
+			return ret;
+		}
+	}
+
 	knotd_mod_ctx_set(mod, stats);
 
+	if (stats->latency) {
+		// Note that the protocol hooks aren't executed if per-zone module.
+		if (knotd_mod_zone(mod) == NULL) {
+			knotd_mod_proto_hook(mod, KNOTD_STAGE_PROTO_BEGIN, latency_proto_begin);
+			knotd_mod_proto_hook(mod, KNOTD_STAGE_PROTO_END, latency_proto_end);
+		} else {
+			knotd_mod_hook(mod, KNOTD_STAGE_BEGIN, latency_begin);
+			knotd_mod_hook(mod, KNOTD_STAGE_END, latency_zone_end);
+		}
+	}
+
 	return knotd_mod_hook(mod, KNOTD_STAGE_END, update_counters);
 }
 
 void stats_unload(knotd_mod_t *mod)
 {
-	free(knotd_mod_ctx(mod));
+	stats_t *stats = knotd_mod_ctx(mod);
+	if (stats != NULL && stats->phases) {
+		knotd_mod_query_phases_disable(mod);
+	}
+	stats_unload_ctx(stats);
 }
 
-KNOTD_MOD_API(stats, KNOTD_MOD_FLAG_SCOPE_ANY | KNOTD_MOD_FLAG_OPT_CONF,
+KNOTD_MOD_API(stats, KNOTD_MOD_FLAG_SCOPE_ANY | KNOTD_MOD_FLAG_OPT_CONF |
+              KNOTD_MOD_FLAG_SHARED,
               stats_load, stats_unload, stats_conf, NULL);
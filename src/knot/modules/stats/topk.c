@@ -0,0 +1,233 @@
+/*  Copyright (C) 2024 CZ.NIC, z.s.p.o. <knot-dns@labs.nic.cz>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "contrib/atomic.h"
+#include "contrib/openbsd/siphash.h"
+#include "knot/modules/stats/topk.h"
+#include "libdnssec/error.h"
+#include "libdnssec/random.h"
+#include "libknot/errcode.h"
+
+#define TOPK_WAYS	4
+
+enum {
+	SIPHASH_RC = 1,
+	SIPHASH_RF = 3,
+};
+
+typedef struct {
+	knot_atomic_uint64_t hash;  // Zero if empty or being replaced.
+	knot_atomic_uint64_t count;
+	uint16_t len;
+	uint8_t key[TOPK_KEY_MAXLEN];
+} topk_entry_t;
+
+typedef struct {
+	topk_entry_t ways[TOPK_WAYS];
+} topk_bucket_t;
+
+struct topk {
+	SIPHASH_KEY hash_key;
+	unsigned threads;
+	size_t buckets;             // Number of buckets per thread, power of two.
+	topk_bucket_t *tables[];    // Per-thread tables.
+};
+
+typedef struct {
+	uint64_t hash;
+	uint64_t count;
+	const topk_entry_t *entry;  // One of the entries holding the key.
+} topk_item_t;
+
+static uint64_t key_hash(const topk_t *topk, const uint8_t *key, size_t len)
+{
+	uint64_t hash = SipHash(&topk->hash_key, SIPHASH_RC, SIPHASH_RF, key, len);
+	return (hash != 0) ? hash : 1;
+}
+
+topk_t *topk_create(unsigned threads, size_t size)
+{
+	if (threads == 0 || size == 0) {
+		return NULL;
+	}
+
+	topk_t *topk = calloc(1, sizeof(*topk) + threads * sizeof(topk->tables[0]));
+	if (topk == NULL) {
+		return NULL;
+	}
+
+	if (dnssec_random_buffer((uint8_t *)&topk->hash_key,
+	                         sizeof(topk->hash_key)) != DNSSEC_EOK) {
+		free(topk);
+		return NULL;
+	}
+
+	topk->threads = threads;
+	topk->buckets = 1;
+	while (topk->buckets * TOPK_WAYS < size) {
+		topk->buckets <<= 1;
+	}
+
+	for (unsigned i = 0; i < threads; i++) {
+		topk->tables[i] = calloc(topk->buckets, sizeof(topk_bucket_t));
+		if (topk->tables[i] == NULL) {
+			topk_free(topk);
+			return NULL;
+		}
+	}
+
+	return topk;
+}
+
+void topk_free(topk_t *topk)
+{
+	if (topk == NULL) {
+		return;
+	}
+
+	for (unsigned i = 0; i < topk->threads; i++) {
+		free(topk->tables[i]);
+	}
+	free(topk);
+}
+
+void topk_add(topk_t *topk, unsigned thr_id, const uint8_t *key, size_t len)
+{
+	if (len > TOPK_KEY_MAXLEN) {
+		return;
+	}
+
+	uint64_t hash = key_hash(topk, key, len);
+	topk_bucket_t *bucket = &topk->tables[thr_id][hash & (topk->buckets - 1)];
+
+	topk_entry_t *min = &bucket->ways[0];
+	uint64_t min_count = UINT64_MAX;
+	for (unsigned i = 0; i < TOPK_WAYS; i++) {
+		topk_entry_t *entry = &bucket->ways[i];
+		uint64_t count = ATOMIC_GET(entry->count);
+		// The table is written by the owning thread only, no RMW needed.
+		if (ATOMIC_GET(entry->hash) == hash) {
+			ATOMIC_SET(entry->count, count + 1);
+			return;
+		}
+		if (count < min_count) {
+			min = entry;
+			min_count = count;
+		}
+	}
+
+	// Replace the least counted entry, the new key inherits its count.
+	ATOMIC_SET(min->hash, 0);
+	memcpy(min->key, key, len);
+	min->len = len;
+	ATOMIC_SET(min->count, min_count + 1);
+	ATOMIC_SET(min->hash, hash);
+}
+
+static int cmp_hash(const void *a, const void *b)
+{
+	const topk_item_t *ia = a, *ib = b;
+	return (ia->hash > ib->hash) - (ia->hash < ib->hash);
+}
+
+static int cmp_count(const void *a, const void *b)
+{
+	const topk_item_t *ia = a, *ib = b;
+	if (ia->count != ib->count) {
+		return (ia->count < ib->count) - (ia->count > ib->count);
+	}
+	return cmp_hash(a, b);
+}
+
+static bool entry_read(const topk_t *topk, const topk_entry_t *entry,
+                       uint64_t hash, uint8_t *key, size_t *len)
+{
+	size_t key_len = entry->len;
+	if (key_len > TOPK_KEY_MAXLEN) {
+		return false;
+	}
+	memcpy(key, entry->key, key_len);
+
+	// The entry might have been replaced by its thread meanwhile.
+	if (ATOMIC_GET(entry->hash) != hash || key_hash(topk, key, key_len) != hash) {
+		return false;
+	}
+
+	*len = key_len;
+	return true;
+}
+
+int topk_dump(topk_t *topk, size_t limit, topk_dump_cb cb, void *data)
+{
+	if (topk == NULL || cb == NULL) {
+		return KNOT_EINVAL;
+	}
+
+	size_t max = topk->threads * topk->buckets * TOPK_WAYS;
+	topk_item_t *items = malloc(max * sizeof(*items));
+	if (items == NULL) {
+		return KNOT_ENOMEM;
+	}
+
+	// Take a snapshot of all non-empty entries.
+	size_t count = 0;
+	for (unsigned i = 0; i < topk->threads; i++) {
+		const topk_entry_t *entries = topk->tables[i]->ways;
+		for (size_t j = 0; j < topk->buckets * TOPK_WAYS; j++) {
+			uint64_t hash = ATOMIC_GET(entries[j].hash);
+			if (hash != 0) {
+				items[count++] = (topk_item_t){
+					.hash = hash,
+					.count = ATOMIC_GET(entries[j].count),
+					.entry = &entries[j]
+				};
+			}
+		}
+	}
+
+	// Merge the counts of the same key from all threads.
+	qsort(items, count, sizeof(*items), cmp_hash);
+	size_t merged = 0;
+	for (size_t i = 0; i < count; i++) {
+		if (merged > 0 && items[merged - 1].hash == items[i].hash) {
+			items[merged - 1].count += items[i].count;
+		} else {
+			items[merged++] = items[i];
+		}
+	}
+
+	qsort(items, merged, sizeof(*items), cmp_count);
+
+	int ret = KNOT_EOK;
+	uint8_t key[TOPK_KEY_MAXLEN];
+	for (size_t i = 0; i < merged && limit > 0 && ret == KNOT_EOK; i++) {
+		size_t len;
+		if (!entry_read(topk, items[i].entry, items[i].hash, key, &len)) {
+			continue;
+		}
+		ret = cb(key, len, items[i].count, data);
+		limit--;
+	}
+
+	free(items);
+
+	return ret;
+}
@@ -0,0 +1,83 @@
+/*  Copyright (C) 2024 CZ.NIC, z.s.p.o. <knot-dns@labs.nic.cz>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+/*!
+ * \brief Bounded-memory tracker of the most frequent keys (heavy hitters).
+ *
+ * Each worker thread updates its own set-associative table of counters,
+ * in which the least counted entry of a full bucket is replaced by a new
+ * key (Space-Saving). The per-thread tables are merged upon dump only.
+ */
+typedef struct topk topk_t;
+
+#define TOPK_KEY_MAXLEN	264
+
+/*!
+ * \brief Callback for one dumped key.
+ *
+ * \param key    Key.
+ * \param len    Key length.
+ * \param count  Estimated number of key occurrences (may be overestimated).
+ * \param data   Callback context.
+ *
+ * \return KNOT_E*
+ */
+typedef int (*topk_dump_cb)(const uint8_t *key, size_t len, uint64_t count, void *data);
+
+/*!
+ * \brief Create the tracker.
+ *
+ * \param threads  Number of worker threads.
+ * \param size     Number of tracked keys per thread (rounded up).
+ *
+ * \return Allocated tracker or NULL.
+ */
+topk_t *topk_create(unsigned threads, size_t size);
+
+/*!
+ * \brief Free the tracker.
+ */
+void topk_free(topk_t *topk);
+
+/*!
+ * \brief Count one occurrence of a key.
+ *
+ * \param topk    Tracker.
+ * \param thr_id  Index of the calling worker thread.
+ * \param key     Key.
+ * \param len     Key length (longer keys are ignored).
+ */
+void topk_add(topk_t *topk, unsigned thr_id, const uint8_t *key, size_t len);
+
+/*!
+ * \brief Dump the most frequent keys over all threads, the most frequent first.
+ *
+ * \note Can be called concurrently with topk_add().
+ *
+ * \param topk   Tracker.
+ * \param limit  Maximum number of dumped keys.
+ * \param cb     Callback for each dumped key.
+ * \param data   Callback context.
+ *
+ * \return KNOT_E*
+ */
+int topk_dump(topk_t *topk, size_t limit, topk_dump_cb cb, void *data);
@@ -120,8 +120,10 @@ typedef struct {
 	enum synth_template_type type;
 	char *prefix;
 	size_t prefix_len;
-	char *zone;
-	size_t zone_len;
+	uint8_t ptr_prefix[KNOT_DNAME_MAXLABELLEN]; // Prefix label content.
+	size_t ptr_prefix_len;
+	knot_dname_t *zone;
+	size_t zone_size;
 	uint32_t ttl;
 	size_t addr_count;
 	synth_templ_addr_t *addr;
@@ -375,26 +377,25 @@ static int addr_parse(knotd_qdata_t *qdata, const synth_template_t *tpl, char *a
 static knot_dname_t *synth_ptrname(uint8_t *out, const char *addr_str,
                                    const synth_template_t *tpl, int addr_family)
 {
-	knot_dname_txt_storage_t ptrname;
-	int addr_len = strlen(addr_str);
+	size_t addr_len = strlen(addr_str);
+	size_t label_len = tpl->ptr_prefix_len + addr_len;
 	const char sep = str_separator(addr_family);
 
-	// PTR right-hand value is [prefix][address][zone]
-	wire_ctx_t ctx = wire_ctx_init((uint8_t *)ptrname, sizeof(ptrname));
-	wire_ctx_write(&ctx, tpl->prefix, tpl->prefix_len);
+	// PTR right-hand value is [prefix][address].[zone], written directly in wire.
+	wire_ctx_t ctx = wire_ctx_init(out, KNOT_DNAME_MAXLEN);
+	wire_ctx_write_u8(&ctx, label_len);
+	wire_ctx_write(&ctx, tpl->ptr_prefix, tpl->ptr_prefix_len);
+	char *addr_pos = (char *)ctx.position;
 	wire_ctx_write(&ctx, addr_str, addr_len);
-	wire_ctx_write_u8(&ctx, '.');
-	wire_ctx_write(&ctx, tpl->zone, tpl->zone_len);
-	wire_ctx_write_u8(&ctx, '\0');
-	if (ctx.error != KNOT_EOK) {
+	wire_ctx_write(&ctx, tpl->zone, tpl->zone_size);
+	if (ctx.error != KNOT_EOK || label_len > KNOT_DNAME_MAXLABELLEN) {
 		return NULL;
 	}
 
 	// Substitute address separator by '-'.
-	str_subst(ptrname + tpl->prefix_len, addr_len, sep, '-');
+	str_subst(addr_pos, addr_len, sep, '-');
 
-	// Convert to domain name.
-	return knot_dname_from_str(out, ptrname, KNOT_DNAME_MAXLEN);
+	return out;
 }
 
 static int reverse_rr(char *addr_str, const synth_template_t *tpl, knot_pkt_t *pkt,
@@ -412,21 +413,18 @@ static int reverse_rr(char *addr_str, const synth_template_t *tpl, knot_pkt_t *p
 	return KNOT_EOK;
 }
 
-static int forward_rr(char *addr_str, const synth_template_t *tpl, knot_pkt_t *pkt,
+static int forward_rr(const struct sockaddr_storage *query_addr, knot_pkt_t *pkt,
                       knot_rrset_t *rr, int addr_family)
 {
-	struct sockaddr_storage query_addr;
-	sockaddr_set(&query_addr, addr_family, addr_str, 0);
-
 	// Specify address type and data.
 	if (addr_family == AF_INET6) {
 		rr->type = KNOT_RRTYPE_AAAA;
-		const struct sockaddr_in6* ip = (const struct sockaddr_in6*)&query_addr;
+		const struct sockaddr_in6* ip = (const struct sockaddr_in6*)query_addr;
 		knot_rrset_add_rdata(rr, (const uint8_t *)&ip->sin6_addr,
 		                     sizeof(struct in6_addr), &pkt->mm);
 	} else if (addr_family == AF_INET) {
 		rr->type = KNOT_RRTYPE_A;
-		const struct sockaddr_in* ip = (const struct sockaddr_in*)&query_addr;
+		const struct sockaddr_in* ip = (const struct sockaddr_in*)query_addr;
 		knot_rrset_add_rdata(rr, (const uint8_t *)&ip->sin_addr,
 		                     sizeof(struct in_addr), &pkt->mm);
 	} else {
@@ -436,7 +434,8 @@ static int forward_rr(char *addr_str, const synth_template_t *tpl, knot_pkt_t *p
 	return KNOT_EOK;
 }
 
-static knot_rrset_t *synth_rr(char *addr_str, const synth_template_t *tpl, knot_pkt_t *pkt,
+static knot_rrset_t *synth_rr(char *addr_str, const struct sockaddr_storage *query_addr,
+                              const synth_template_t *tpl, knot_pkt_t *pkt,
                               knotd_qdata_t *qdata, int addr_family)
 {
 	knot_rrset_t *rr = knot_rrset_new(qdata->name, 0, KNOT_CLASS_IN, tpl->ttl,
@@ -449,7 +448,7 @@ static knot_rrset_t *synth_rr(char *addr_str, const synth_template_t *tpl, knot_
 	int ret = KNOT_ERROR;
 	switch (tpl->type) {
 	case SYNTH_REVERSE: ret = reverse_rr(addr_str, tpl, pkt, rr, addr_family); break;
-	case SYNTH_FORWARD: ret = forward_rr(addr_str, tpl, pkt, rr, addr_family); break;
+	case SYNTH_FORWARD: ret = forward_rr(query_addr, pkt, rr, addr_family); break;
 	default: break;
 	}
 
@@ -517,7 +516,7 @@ static knotd_in_state_t template_match(knotd_in_state_t state, const synth_templ
 	}
 
 	// Synthesize record from template.
-	knot_rrset_t *rr = synth_rr(addr_str, tpl, pkt, qdata, provided_af);
+	knot_rrset_t *rr = synth_rr(addr_str, &query_addr, tpl, pkt, qdata, provided_af);
 	if (rr == NULL) {
 		qdata->rcode = KNOT_RCODE_SERVFAIL;
 		return KNOTD_IN_STATE_ERROR;
@@ -565,16 +564,23 @@ int synth_record_load(knotd_mod_t *mod)
 	tpl->prefix = strdup(conf.single.string);
 	tpl->prefix_len = strlen(tpl->prefix);
 
-	// Set origin if generating reverse record.
+	// Set origin and PTR prefix label if generating reverse record.
 	if (tpl->type == SYNTH_REVERSE) {
+		knot_dname_storage_t prefix;
+		if (tpl->prefix_len > 0 &&
+		    knot_dname_from_str(prefix, tpl->prefix, sizeof(prefix)) != NULL) {
+			tpl->ptr_prefix_len = prefix[0];
+			memcpy(tpl->ptr_prefix, prefix + 1, prefix[0]);
+		}
+
 		conf = knotd_conf_mod(mod, MOD_ORIGIN);
-		tpl->zone = knot_dname_to_str_alloc(conf.single.dname);
+		tpl->zone = knot_dname_copy(conf.single.dname, NULL);
 		if (tpl->zone == NULL) {
 			free(tpl->prefix);
 			free(tpl);
 			return KNOT_ENOMEM;
 		}
-		tpl->zone_len = strlen(tpl->zone);
+		tpl->zone_size = knot_dname_size(tpl->zone);
 	}
 
 	// Set ttl.
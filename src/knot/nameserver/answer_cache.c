@@ -0,0 +1,205 @@
+/*  Copyright (C) 2024 CZ.NIC, z.s.p.o. <knot-dns@labs.nic.cz>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "knot/nameserver/answer_cache.h"
+#include "knot/nameserver/process_query.h"
+#include "libdnssec/error.h"
+#include "libdnssec/random.h"
+#include "libknot/libknot.h"
+#include "contrib/openbsd/siphash.h"
+
+#define KEY_MAX		(1 + KNOT_WIRE_HEADER_SIZE + KNOT_DNAME_MAXLEN + 4 + KNOT_EDNS_MIN_SIZE)
+#define ANSWER_MAX	4096	/*!< Larger responses aren't cached. */
+
+/*! \brief Global generation of the answered data. */
+static uint64_t cache_gen = 1;
+
+typedef struct {
+	uint64_t gen;       /*!< Data generation, 0 for empty entry. */
+	uint16_t key_len;
+	uint16_t answer_len;
+	uint8_t *data;      /*!< Key followed by the response (ANSWER_MAX + KEY_MAX). */
+} entry_t;
+
+struct answer_cache {
+	unsigned mask;      /*!< Number of entries - 1. */
+	SIPHASH_KEY hash_key;
+
+	/* The last looked up cacheable query. */
+	bool pending;
+	uint64_t pending_gen;
+	entry_t *pending_entry;
+	uint8_t pending_key[KEY_MAX];
+	uint16_t pending_key_len;
+
+	entry_t entries[];
+};
+
+answer_cache_t *answer_cache_new(unsigned size)
+{
+	unsigned count = 1;
+	while (count < size) {
+		count <<= 1;
+	}
+
+	answer_cache_t *cache = calloc(1, sizeof(*cache) + count * sizeof(entry_t));
+	if (cache == NULL) {
+		return NULL;
+	}
+	cache->mask = count - 1;
+
+	if (dnssec_random_buffer((uint8_t *)&cache->hash_key,
+	                         sizeof(cache->hash_key)) != DNSSEC_EOK) {
+		free(cache);
+		return NULL;
+	}
+
+	return cache;
+}
+
+void answer_cache_free(answer_cache_t *cache)
+{
+	if (cache == NULL) {
+		return;
+	}
+
+	for (unsigned i = 0; i <= cache->mask; i++) {
+		free(cache->entries[i].data);
+	}
+	free(cache);
+}
+
+void answer_cache_invalidate(void)
+{
+	(void)__atomic_add_fetch(&cache_gen, 1, __ATOMIC_RELEASE);
+}
+
+/*! \brief Get the length of the query wire after the question or 0 if not plain. */
+static size_t plain_query_len(const uint8_t *wire, size_t len)
+{
+	if (len < KNOT_WIRE_HEADER_SIZE ||
+	    knot_wire_get_qr(wire) || knot_wire_get_opcode(wire) != KNOT_OPCODE_QUERY ||
+	    knot_wire_get_qdcount(wire) != 1 || knot_wire_get_ancount(wire) != 0 ||
+	    knot_wire_get_nscount(wire) != 0 || knot_wire_get_arcount(wire) > 1) {
+		return 0;
+	}
+
+	// Uncompressed QNAME, QTYPE, and QCLASS.
+	size_t pos = KNOT_WIRE_HEADER_SIZE;
+	while (pos < len && wire[pos] != 0) {
+		if (wire[pos] > KNOT_DNAME_MAXLABELLEN) {
+			return 0;
+		}
+		pos += 1 + wire[pos];
+	}
+	pos += 1 + 2 * sizeof(uint16_t);
+	if (pos > len || pos - KNOT_WIRE_HEADER_SIZE - 4 > KNOT_DNAME_MAXLEN) {
+		return 0;
+	}
+
+	// Optional OPT RR without any option.
+	if (knot_wire_get_arcount(wire) == 1) {
+		if (len - pos != KNOT_EDNS_MIN_SIZE || wire[pos] != 0 ||
+		    knot_wire_read_u16(wire + pos + 1) != KNOT_RRTYPE_OPT ||
+		    knot_wire_read_u16(wire + pos + 9) != 0) {
+			return 0;
+		}
+		pos += KNOT_EDNS_MIN_SIZE;
+	}
+
+	return (pos == len) ? pos : 0;
+}
+
+bool answer_cache_get(answer_cache_t *cache, const struct iovec *query,
+                      int family, struct iovec *answer)
+{
+	cache->pending = false;
+
+	size_t len = plain_query_len(query->iov_base, query->iov_len);
+	if (len == 0) {
+		return false;
+	}
+
+	// Key: address family and the query without ID.
+	uint8_t *key = cache->pending_key;
+	key[0] = (family == AF_INET6);
+	memcpy(key + 1, query->iov_base + sizeof(uint16_t), len - sizeof(uint16_t));
+	cache->pending_key_len = 1 + len - sizeof(uint16_t);
+
+	// Read the generation before the data is accessed.
+	uint64_t gen = __atomic_load_n(&cache_gen, __ATOMIC_ACQUIRE);
+
+	uint64_t hash = SipHash24(&cache->hash_key, key, cache->pending_key_len);
+	entry_t *entry = &cache->entries[hash & cache->mask];
+
+	if (entry->gen == gen && entry->key_len == cache->pending_key_len &&
+	    memcmp(entry->data, key, entry->key_len) == 0 &&
+	    entry->answer_len <= answer->iov_len) {
+		memcpy(answer->iov_base, entry->data + entry->key_len, entry->answer_len);
+		knot_wire_set_id(answer->iov_base, knot_wire_get_id(query->iov_base));
+		answer->iov_len = entry->answer_len;
+		return true;
+	}
+
+	cache->pending = true;
+	cache->pending_gen = gen;
+	cache->pending_entry = entry;
+
+	return false;
+}
+
+bool answer_cache_cacheable(answer_cache_t *cache, const knotd_qdata_t *qdata,
+                            const struct iovec *answer)
+{
+	if (!cache->pending || answer->iov_len > ANSWER_MAX ||
+	    qdata->type != KNOTD_QUERY_TYPE_NORMAL || qdata->ecs != NULL ||
+	    (qdata->params->flags & KNOTD_QUERY_FLAG_COOKIE)) {
+		return false;
+	}
+
+	uint8_t rcode = knot_wire_get_rcode(answer->iov_base);
+	if (rcode != KNOT_RCODE_NOERROR && rcode != KNOT_RCODE_NXDOMAIN) {
+		return false;
+	}
+
+	// Decided during the processing, the configuration and zone may be freed now.
+	return !qdata->extra->volatile_answer;
+}
+
+void answer_cache_put(answer_cache_t *cache, const struct iovec *answer)
+{
+	if (!cache->pending || answer->iov_len > ANSWER_MAX) {
+		return;
+	}
+	cache->pending = false;
+
+	entry_t *entry = cache->pending_entry;
+	if (entry->data == NULL) {
+		entry->data = malloc(KEY_MAX + ANSWER_MAX);
+		if (entry->data == NULL) {
+			return;
+		}
+	}
+
+	entry->gen = cache->pending_gen;
+	entry->key_len = cache->pending_key_len;
+	entry->answer_len = answer->iov_len;
+	memcpy(entry->data, cache->pending_key, entry->key_len);
+	memcpy(entry->data + entry->key_len, answer->iov_base, answer->iov_len);
+}
@@ -0,0 +1,92 @@
+/*  Copyright (C) 2024 CZ.NIC, z.s.p.o. <knot-dns@labs.nic.cz>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+/*!
+ * \brief Per-worker cache of finished UDP responses.
+ *
+ * Only plain queries (one question, possibly an OPT RR without options) are
+ * cached. The whole query wire except the message ID, together with the
+ * address family, forms the key, so the response never depends on anything
+ * else. On a cache hit, the stored response is copied and the ID patched.
+ *
+ * Any zone contents, zone database, or configuration switch invalidates all
+ * caches via a global generation counter.
+ */
+
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <sys/uio.h>
+
+#include "knot/include/module.h"
+
+typedef struct answer_cache answer_cache_t;
+
+/*!
+ * \brief Create a response cache.
+ *
+ * \param size  Number of entries (rounded up to a power of two).
+ *
+ * \return Cache or NULL if out of memory.
+ */
+answer_cache_t *answer_cache_new(unsigned size);
+
+/*!
+ * \brief Free the response cache.
+ */
+void answer_cache_free(answer_cache_t *cache);
+
+/*!
+ * \brief Invalidate the contents of all caches.
+ *
+ * \note Must be called after the new data has been published.
+ */
+void answer_cache_invalidate(void);
+
+/*!
+ * \brief Look up a response to the query.
+ *
+ * If the query is cacheable but not found, it's remembered for a subsequent
+ * answer_cache_put().
+ *
+ * \param cache   Response cache.
+ * \param query   Query wire.
+ * \param family  Address family of the remote.
+ * \param answer  In: answer buffer, out: cached response if found.
+ *
+ * \retval true if the response was found and copied.
+ */
+bool answer_cache_get(answer_cache_t *cache, const struct iovec *query,
+                      int family, struct iovec *answer);
+
+/*!
+ * \brief Check if the finished response to the last looked up query can be cached.
+ *
+ * \param cache  Response cache.
+ * \param qdata  Query processing data.
+ * \param answer Response wire.
+ */
+bool answer_cache_cacheable(answer_cache_t *cache, const knotd_qdata_t *qdata,
+                            const struct iovec *answer);
+
+/*!
+ * \brief Store the response to the last looked up query.
+ *
+ * \param cache   Response cache.
+ * \param answer  Response wire.
+ */
+void answer_cache_put(answer_cache_t *cache, const struct iovec *answer);
@@ -19,6 +19,7 @@
 #include "contrib/mempattern.h"
 #include "contrib/sockaddr.h"
 #include "knot/nameserver/axfr.h"
+#include "knot/nameserver/axfr_cache.h"
 #include "knot/nameserver/internet.h"
 #include "knot/nameserver/log.h"
 #include "knot/nameserver/xfr.h"
@@ -39,6 +40,10 @@ struct axfr_proc {
 	trie_it_t *i;
 	zone_tree_it_t it;
 	unsigned cur_rrset;
+	axfr_msgs_t *cached;   /* Replayed messages. */
+	axfr_msgs_t *record;   /* Messages being recorded. */
+	size_t cached_idx;
+	uint8_t *buf;
 };
 
 static int axfr_put_rrsets(knot_pkt_t *pkt, zone_node_t *node,
@@ -46,6 +51,9 @@ static int axfr_put_rrsets(knot_pkt_t *pkt, zone_node_t *node,
 {
 	assert(node != NULL);
 
+	/* Owner written by the first RRSet of the node in this message. */
+	uint16_t owner_hint = KNOT_COMPR_HINT_NONE;
+
 	/* Append all RRs. */
 	for (unsigned i = state->cur_rrset; i < node->rrset_count; ++i) {
 		knot_rrset_t rrset = node_rrset_at(node, i);
@@ -53,12 +61,21 @@ static int axfr_put_rrsets(knot_pkt_t *pkt, zone_node_t *node,
 			continue;
 		}
 
-		int ret = knot_pkt_put(pkt, 0, &rrset, KNOT_PF_NOTRUNC | KNOT_PF_ORIGTTL);
+		/* Nodes are in canonical order, compress just against the previous owner. */
+		const uint16_t flags = KNOT_PF_NOTRUNC | KNOT_PF_ORIGTTL | KNOT_PF_ORDERED;
+		const uint8_t *prerendered = additional_wire(&rrset);
+		int ret = (prerendered != NULL) ?
+		          knot_pkt_put_prerendered(pkt, owner_hint, &rrset, prerendered, 0, flags) :
+		          knot_pkt_put(pkt, owner_hint, &rrset, flags);
 		if (ret != KNOT_EOK) {
 			/* If something failed, remember the current RR for later. */
 			state->cur_rrset = i;
 			return ret;
 		}
+		if (owner_hint == KNOT_COMPR_HINT_NONE && pkt->rrset_count > 0) {
+			owner_hint = knot_compr_hint(&pkt->rr_info[pkt->rrset_count - 1],
+			                             KNOT_COMPR_HINT_OWNER);
+		}
 		if (pkt->size > KNOT_WIRE_PTR_MAX) {
 			// optimization: once the XFR DNS message is > 16 KiB, compression
 			// is limited. Better wrap to next message.
@@ -103,6 +120,9 @@ static void axfr_query_cleanup(knotd_qdata_t *qdata)
 
 	zone_tree_it_free(&axfr->it);
 	ptrlist_free(&axfr->proc.nodes, qdata->mm);
+	axfr_cache_release(qdata->extra->zone->axfr_cache, axfr->cached);
+	axfr_cache_recorded(qdata->extra->zone->axfr_cache, axfr->record, false);
+	mm_free(qdata->mm, axfr->buf);
 	mm_free(qdata->mm, axfr);
 
 	/* Allow zone changes (finished). */
@@ -111,7 +131,8 @@ static void axfr_query_cleanup(knotd_qdata_t *qdata)
 
 static void axfr_answer_finished(knotd_qdata_t *qdata, knot_pkt_t *pkt, int state)
 {
-	struct xfr_proc *xfr = qdata->extra->ext;
+	struct axfr_proc *axfr = qdata->extra->ext;
+	struct xfr_proc *xfr = &axfr->proc;
 
 	switch (state) {
 	case KNOT_STATE_PRODUCE:
@@ -120,8 +141,12 @@ static void axfr_answer_finished(knotd_qdata_t *qdata, knot_pkt_t *pkt, int stat
 	case KNOT_STATE_DONE:
 		xfr_stats_add(&xfr->stats, pkt->size);
 		xfr_stats_end(&xfr->stats);
+		axfr_cache_recorded(qdata->extra->zone->axfr_cache, axfr->record, true);
+		axfr->record = NULL;
 		xfr_log_finished(ZONE_NAME(qdata), LOG_OPERATION_AXFR, LOG_DIRECTION_OUT,
 				 REMOTE(qdata), PROTO(qdata), KEY(qdata), "", &xfr->stats);
+		xfr_perf_transfer(&qdata->extra->zone->xfr_perf, false, xfr->stats.messages,
+		                  xfr->stats.bytes, &xfr->stats.begin, &xfr->stats.end);
 		break;
 	default:
 		break;
@@ -176,6 +201,16 @@ static int axfr_query_init(knotd_qdata_t *qdata)
 		ptrlist_add(&axfr->proc.nodes, contents->nsec3_nodes, mm);
 	}
 
+	/* Replay or record the encoded messages if configured. */
+	zone_t *zone = qdata->extra->zone;
+	conf_val_t val = conf_zone_get(conf(), C_AXFR_CACHE, zone->name);
+	if (conf_bool(&val)) {
+		axfr->cached = axfr_cache_get(zone->axfr_cache, contents);
+		if (axfr->cached == NULL) {
+			axfr->record = axfr_cache_record(zone->axfr_cache, contents);
+		}
+	}
+
 	/* Set up cleanup callback. */
 	qdata->extra->ext = axfr;
 	qdata->extra->ext_cleanup = &axfr_query_cleanup;
@@ -187,6 +222,59 @@ static int axfr_query_init(knotd_qdata_t *qdata)
 	return KNOT_EOK;
 }
 
+/*! \brief Checks if the cached messages fit into this transfer's messages. */
+static void axfr_replay_init(knot_pkt_t *pkt, knotd_qdata_t *qdata,
+                             struct axfr_proc *axfr)
+{
+	size_t max_len = axfr_msgs_max_len(axfr->cached);
+	if (max_len <= pkt->max_size - pkt->size - pkt->reserved) {
+		axfr->buf = mm_alloc(qdata->mm, max_len);
+		if (axfr->buf != NULL) {
+			return;
+		}
+	}
+
+	axfr_cache_release(qdata->extra->zone->axfr_cache, axfr->cached);
+	axfr->cached = NULL;
+}
+
+static int axfr_replay(knot_pkt_t *pkt, knotd_qdata_t *qdata, struct axfr_proc *axfr)
+{
+	/* Check if the zone wasn't expired during multi-message transfer. */
+	if (qdata->extra->contents == NULL) {
+		return KNOT_ENOZONE;
+	}
+
+	uint16_t offset, rr_count;
+	size_t len;
+	int ret = axfr_msgs_read(axfr->cached, axfr->cached_idx, &offset,
+	                         axfr->buf, &len, &rr_count);
+	if (ret != KNOT_EOK) {
+		return ret;
+	} else if (offset != pkt->size) {
+		return KNOT_EMALF; // Compression pointers wouldn't match.
+	}
+
+	ret = knot_pkt_put_wire(pkt, axfr->buf, len, rr_count);
+	if (ret != KNOT_EOK) {
+		return ret;
+	}
+
+	return (++axfr->cached_idx < axfr_msgs_count(axfr->cached)) ?
+	       KNOT_ESPACE : KNOT_EOK;
+}
+
+static void axfr_record(knot_pkt_t *pkt, knotd_qdata_t *qdata,
+                        struct axfr_proc *axfr, size_t offset)
+{
+	int ret = axfr_msgs_add(axfr->record, offset, pkt->wire + offset,
+	                        pkt->size - offset, knot_wire_get_ancount(pkt->wire));
+	if (ret != KNOT_EOK) {
+		axfr_cache_recorded(qdata->extra->zone->axfr_cache, axfr->record, false);
+		axfr->record = NULL;
+	}
+}
+
 knot_layer_state_t axfr_process_query(knot_pkt_t *pkt, knotd_qdata_t *qdata)
 {
 	if (pkt == NULL || qdata == NULL) {
@@ -221,6 +309,7 @@ knot_layer_state_t axfr_process_query(knot_pkt_t *pkt, knotd_qdata_t *qdata)
 			            knot_strerror(ret));
 			return KNOT_STATE_FAIL;
 		}
+		axfr = qdata->extra->ext;
 	}
 
 	/* Reserve space for TSIG. */
@@ -229,8 +318,21 @@ knot_layer_state_t axfr_process_query(knot_pkt_t *pkt, knotd_qdata_t *qdata)
 		return KNOT_STATE_FAIL;
 	}
 
+	/* Replay the cached messages if possible. */
+	if (axfr->cached != NULL && axfr->proc.stats.messages == 0) {
+		axfr_replay_init(pkt, qdata, axfr);
+	}
+
 	/* Answer current packet (or continue). */
-	ret = xfr_process_list(pkt, &axfr_process_node_tree, qdata);
+	size_t offset = pkt->size;
+	if (axfr->cached != NULL) {
+		ret = axfr_replay(pkt, qdata, axfr);
+	} else {
+		ret = xfr_process_list(pkt, &axfr_process_node_tree, qdata);
+		if (axfr->record != NULL && (ret == KNOT_EOK || ret == KNOT_ESPACE)) {
+			axfr_record(pkt, qdata, axfr, offset);
+		}
+	}
 	switch (ret) {
 	case KNOT_ESPACE: /* Couldn't write more, send packet and continue. */
 		return KNOT_STATE_PRODUCE; /* Check for more. */
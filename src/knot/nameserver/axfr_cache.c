@@ -0,0 +1,267 @@
+/*  Copyright (C) 2024 CZ.NIC, z.s.p.o. <knot-dns@labs.nic.cz>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+
+#include <assert.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+#include "knot/nameserver/axfr_cache.h"
+#include "contrib/macros.h"
+#include "libknot/error.h"
+
+typedef struct {
+	uint64_t pos;       // Position in the file.
+	uint32_t len;
+	uint16_t offset;
+	uint16_t rr_count;
+} axfr_msg_t;
+
+struct axfr_msgs {
+	const zone_contents_t *contents;
+	uint32_t serial;
+	FILE *file;
+	uint64_t size;
+	axfr_msg_t *msgs;
+	size_t count;
+	size_t capacity;
+	size_t max_len;
+	unsigned refs;      // Protected by the cache lock.
+};
+
+struct axfr_cache {
+	pthread_mutex_t lock;
+	axfr_msgs_t *msgs;      // Complete messages.
+	axfr_msgs_t *recording; // Messages being recorded.
+};
+
+static void msgs_free(axfr_msgs_t *msgs)
+{
+	if (msgs->file != NULL) {
+		fclose(msgs->file);
+	}
+	free(msgs->msgs);
+	free(msgs);
+}
+
+static void msgs_unref(axfr_msgs_t *msgs)
+{
+	assert(msgs->refs > 0);
+	if (--msgs->refs == 0) {
+		msgs_free(msgs);
+	}
+}
+
+static bool msgs_match(const axfr_msgs_t *msgs, const zone_contents_t *contents)
+{
+	return msgs != NULL && msgs->contents == contents &&
+	       msgs->serial == zone_contents_serial(contents);
+}
+
+axfr_cache_t *axfr_cache_new(void)
+{
+	axfr_cache_t *cache = calloc(1, sizeof(*cache));
+	if (cache == NULL) {
+		return NULL;
+	}
+
+	pthread_mutex_init(&cache->lock, NULL);
+
+	return cache;
+}
+
+void axfr_cache_free(axfr_cache_t *cache)
+{
+	if (cache == NULL) {
+		return;
+	}
+
+	axfr_cache_flush(cache);
+	pthread_mutex_destroy(&cache->lock);
+	free(cache);
+}
+
+void axfr_cache_flush(axfr_cache_t *cache)
+{
+	if (cache == NULL) {
+		return;
+	}
+
+	pthread_mutex_lock(&cache->lock);
+	if (cache->msgs != NULL) {
+		msgs_unref(cache->msgs);
+		cache->msgs = NULL;
+	}
+	cache->recording = NULL; // Not to be stored once finished.
+	pthread_mutex_unlock(&cache->lock);
+}
+
+axfr_msgs_t *axfr_cache_get(axfr_cache_t *cache, const zone_contents_t *contents)
+{
+	if (cache == NULL) {
+		return NULL;
+	}
+
+	axfr_msgs_t *found = NULL;
+
+	pthread_mutex_lock(&cache->lock);
+	if (msgs_match(cache->msgs, contents)) {
+		found = cache->msgs;
+		found->refs++;
+	}
+	pthread_mutex_unlock(&cache->lock);
+
+	return found;
+}
+
+axfr_msgs_t *axfr_cache_record(axfr_cache_t *cache, const zone_contents_t *contents)
+{
+	if (cache == NULL) {
+		return NULL;
+	}
+
+	pthread_mutex_lock(&cache->lock);
+	bool busy = msgs_match(cache->recording, contents) || msgs_match(cache->msgs, contents);
+	pthread_mutex_unlock(&cache->lock);
+	if (busy) {
+		return NULL;
+	}
+
+	axfr_msgs_t *msgs = calloc(1, sizeof(*msgs));
+	if (msgs == NULL) {
+		return NULL;
+	}
+	msgs->contents = contents;
+	msgs->serial = zone_contents_serial(contents);
+	msgs->refs = 1; // The recorder's reference.
+	msgs->file = tmpfile();
+	if (msgs->file == NULL) {
+		free(msgs);
+		return NULL;
+	}
+
+	pthread_mutex_lock(&cache->lock);
+	if (msgs_match(cache->recording, contents)) {
+		busy = true; // Someone else was faster.
+	} else {
+		cache->recording = msgs;
+	}
+	pthread_mutex_unlock(&cache->lock);
+	if (busy) {
+		msgs_free(msgs);
+		return NULL;
+	}
+
+	return msgs;
+}
+
+void axfr_cache_recorded(axfr_cache_t *cache, axfr_msgs_t *msgs, bool complete)
+{
+	if (msgs == NULL) {
+		return;
+	}
+
+	pthread_mutex_lock(&cache->lock);
+	if (cache->recording == msgs) {
+		cache->recording = NULL;
+		if (complete && msgs->count > 0 && fflush(msgs->file) == 0) {
+			if (cache->msgs != NULL) {
+				msgs_unref(cache->msgs);
+			}
+			cache->msgs = msgs;
+			msgs->refs++;
+		}
+	}
+	msgs_unref(msgs);
+	pthread_mutex_unlock(&cache->lock);
+}
+
+void axfr_cache_release(axfr_cache_t *cache, axfr_msgs_t *msgs)
+{
+	if (msgs == NULL) {
+		return;
+	}
+
+	pthread_mutex_lock(&cache->lock);
+	msgs_unref(msgs);
+	pthread_mutex_unlock(&cache->lock);
+}
+
+int axfr_msgs_add(axfr_msgs_t *msgs, uint16_t offset, const uint8_t *wire,
+                  size_t len, uint16_t rr_count)
+{
+	if (msgs->count == msgs->capacity) {
+		size_t capacity = MAX(2 * msgs->capacity, 64);
+		axfr_msg_t *resized = realloc(msgs->msgs, capacity * sizeof(*resized));
+		if (resized == NULL) {
+			return KNOT_ENOMEM;
+		}
+		msgs->msgs = resized;
+		msgs->capacity = capacity;
+	}
+
+	ssize_t written = pwrite(fileno(msgs->file), wire, len, msgs->size);
+	if (written < 0) {
+		return knot_map_errno();
+	} else if (written != len) {
+		return KNOT_ESPACE;
+	}
+
+	msgs->msgs[msgs->count++] = (axfr_msg_t) {
+		.pos = msgs->size,
+		.len = len,
+		.offset = offset,
+		.rr_count = rr_count,
+	};
+	msgs->size += len;
+	msgs->max_len = MAX(msgs->max_len, len);
+
+	return KNOT_EOK;
+}
+
+size_t axfr_msgs_count(const axfr_msgs_t *msgs)
+{
+	return msgs->count;
+}
+
+size_t axfr_msgs_max_len(const axfr_msgs_t *msgs)
+{
+	return msgs->max_len;
+}
+
+int axfr_msgs_read(const axfr_msgs_t *msgs, size_t idx, uint16_t *offset, uint8_t *wire,
+                   size_t *len, uint16_t *rr_count)
+{
+	if (idx >= msgs->count) {
+		return KNOT_EINVAL;
+	}
+
+	const axfr_msg_t *msg = &msgs->msgs[idx];
+	ssize_t read = pread(fileno(msgs->file), wire, msg->len, msg->pos);
+	if (read < 0) {
+		return knot_map_errno();
+	} else if (read != msg->len) {
+		return KNOT_EMALF;
+	}
+
+	*offset = msg->offset;
+	*len = msg->len;
+	*rr_count = msg->rr_count;
+
+	return KNOT_EOK;
+}
@@ -0,0 +1,131 @@
+/*  Copyright (C) 2024 CZ.NIC, z.s.p.o. <knot-dns@labs.nic.cz>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+
+/*!
+ * \brief Per-zone cache of encoded outgoing AXFR messages.
+ *
+ * The answer sections of the messages of one complete outgoing AXFR are
+ * recorded and replayed to other secondaries transferring the same zone
+ * version. Only the answer records are kept, the header, question, EDNS,
+ * and TSIG are created for each message as usual. The messages are stored
+ * in an unlinked temporary file, so they stay in the page cache if memory
+ * allows and are spilled to disk otherwise. Any zone contents switch
+ * flushes the cache.
+ */
+
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "knot/zone/contents.h"
+
+typedef struct axfr_cache axfr_cache_t;
+
+/*! \brief Encoded messages of one zone version. */
+typedef struct axfr_msgs axfr_msgs_t;
+
+/*!
+ * \brief Create an empty cache.
+ *
+ * \return Cache or NULL if out of memory.
+ */
+axfr_cache_t *axfr_cache_new(void);
+
+/*!
+ * \brief Free the cache.
+ *
+ * \note No messages may be in use.
+ */
+void axfr_cache_free(axfr_cache_t *cache);
+
+/*!
+ * \brief Drop the cached messages, those in use are freed once released.
+ */
+void axfr_cache_flush(axfr_cache_t *cache);
+
+/*!
+ * \brief Get the cached messages of the given zone version.
+ *
+ * \param cache      Cache.
+ * \param contents   Transferred zone contents.
+ *
+ * \return Referenced messages or NULL if not cached.
+ */
+axfr_msgs_t *axfr_cache_get(axfr_cache_t *cache, const zone_contents_t *contents);
+
+/*!
+ * \brief Start recording messages of the given zone version.
+ *
+ * Only one recording may be in progress.
+ *
+ * \param cache      Cache.
+ * \param contents   Transferred zone contents.
+ *
+ * \return Messages to be filled or NULL if not possible or already in progress.
+ */
+axfr_msgs_t *axfr_cache_record(axfr_cache_t *cache, const zone_contents_t *contents);
+
+/*!
+ * \brief Finish recording, store the messages if complete, and release them.
+ *
+ * \param cache      Cache.
+ * \param msgs       Recorded messages.
+ * \param complete   All the messages of the transfer were recorded.
+ */
+void axfr_cache_recorded(axfr_cache_t *cache, axfr_msgs_t *msgs, bool complete);
+
+/*!
+ * \brief Release referenced messages.
+ */
+void axfr_cache_release(axfr_cache_t *cache, axfr_msgs_t *msgs);
+
+/*!
+ * \brief Append answer records of a message.
+ *
+ * \param msgs       Messages being recorded.
+ * \param offset     Position of the answer section in the message.
+ * \param wire       Encoded answer records.
+ * \param len        Length of the records.
+ * \param rr_count   Number of the records.
+ *
+ * \return KNOT_E*
+ */
+int axfr_msgs_add(axfr_msgs_t *msgs, uint16_t offset, const uint8_t *wire,
+                  size_t len, uint16_t rr_count);
+
+/*! \brief Get the number of messages. */
+size_t axfr_msgs_count(const axfr_msgs_t *msgs);
+
+/*! \brief Get the largest answer records length among the messages. */
+size_t axfr_msgs_max_len(const axfr_msgs_t *msgs);
+
+/*!
+ * \brief Read answer records of a message.
+ *
+ * \param msgs       Cached messages.
+ * \param idx        Message index.
+ * \param offset     Output: position of the answer section in the message.
+ * \param wire       Output buffer of axfr_msgs_max_len() size at least.
+ * \param len        Output: length of the records.
+ * \param rr_count   Output: number of the records.
+ *
+ * \return KNOT_E*
+ */
+int axfr_msgs_read(const axfr_msgs_t *msgs, size_t idx, uint16_t *offset, uint8_t *wire,
+                   size_t *len, uint16_t *rr_count);
@@ -20,15 +20,15 @@
 #include "knot/nameserver/internet.h"
 #include "knot/nameserver/nsec_proofs.h"
 #include "knot/nameserver/query_module.h"
+#include "knot/nameserver/query_phases.h"
 #include "knot/zone/serial.h"
 #include "contrib/mempattern.h"
 
 /*! \brief Check if given node was already visited. */
 static int wildcard_has_visited(knotd_qdata_t *qdata, const zone_node_t *node)
 {
-	struct wildcard_hit *item;
-	WALK_LIST(item, qdata->extra->wildcards) {
-		if (item->node == node) {
+	for (unsigned i = 0; i < qdata->extra->wildcard_count; i++) {
+		if (qdata->extra->wildcards[i].node == node) {
 			return true;
 		}
 	}
@@ -46,12 +46,14 @@ static int wildcard_visit(knotd_qdata_t *qdata, const zone_node_t *node,
 		return KNOT_EOK;
 	}
 
-	knot_mm_t *mm = qdata->mm;
-	struct wildcard_hit *item = mm_alloc(mm, sizeof(struct wildcard_hit));
+	if (qdata->extra->wildcard_count >= WILDCARD_HITS_MAX) {
+		return KNOT_ESPACE;
+	}
+
+	struct wildcard_hit *item = &qdata->extra->wildcards[qdata->extra->wildcard_count++];
 	item->node = node;
 	item->prev = prev;
 	item->sname = sname;
-	add_tail(&qdata->extra->wildcards, (node_t *)item);
 	return KNOT_EOK;
 }
 
@@ -71,29 +73,39 @@ static int dname_cname_synth(const knot_rrset_t *dname_rr,
 	knot_rrset_init(cname_rrset, owner_copy, KNOT_RRTYPE_CNAME, dname_rr->rclass,
 	                dname_rr->ttl);
 
-	/* Replace last labels of qname with DNAME. */
-	const knot_dname_t *dname_wire = dname_rr->owner;
+	/* Replace last labels of qname with DNAME, directly in the RDATA.
+	 * Both names are uncompressed, the qname is below the DNAME owner. */
 	const knot_dname_t *dname_tgt = knot_dname_target(dname_rr->rrs.rdata);
-	size_t labels = knot_dname_labels(dname_wire, NULL);
-	knot_dname_t *cname = knot_dname_replace_suffix(qname, labels, dname_tgt, mm);
-	if (cname == NULL) {
+	size_t prefix_size = knot_dname_size(qname) - knot_dname_size(dname_rr->owner);
+	size_t tgt_size = knot_dname_size(dname_tgt);
+	size_t cname_size = prefix_size + tgt_size;
+
+	knot_rdata_t *rdata = mm_alloc(mm, knot_rdata_size(cname_size));
+	if (rdata == NULL) {
 		knot_dname_free(owner_copy, mm);
 		return KNOT_ENOMEM;
 	}
+	knot_rdata_init(rdata, cname_size, NULL);
+	memcpy(rdata->data, qname, prefix_size);
+	memcpy(rdata->data + prefix_size, dname_tgt, tgt_size);
 
-	/* Store DNAME into RDATA. */
-	size_t cname_size = knot_dname_size(cname);
-	uint8_t cname_rdata[cname_size];
-	memcpy(cname_rdata, cname, cname_size);
-	knot_dname_free(cname, mm);
+	cname_rrset->rrs.count = 1;
+	cname_rrset->rrs.size = knot_rdata_size(cname_size);
+	cname_rrset->rrs.rdata = rdata;
 
-	int ret = knot_rrset_add_rdata(cname_rrset, cname_rdata, cname_size, mm);
-	if (ret != KNOT_EOK) {
-		knot_dname_free(owner_copy, mm);
-		return ret;
+	return KNOT_EOK;
+}
+
+/*! \brief Returns the precomputed in-zone node of the CNAME target, if any. */
+static const zone_node_t *cname_target_node(const knot_rrset_t *cname_rr,
+                                            const zone_node_t *cname_node)
+{
+	const additional_t *additional = cname_rr->additional;
+	if (additional == NULL || additional->count == 0) {
+		return NULL;
 	}
 
-	return KNOT_EOK;
+	return glue_node(&additional->glues[0], cname_node); // NULL if lazy.
 }
 
 /*!
@@ -179,10 +191,46 @@ static int put_authority_soa(knot_pkt_t *pkt, knotd_qdata_t *qdata,
 	                            KNOT_PF_NOTRUNC | KNOT_PF_SOAMINTTL);
 }
 
+/*!
+ * \brief Puts the optional SOA RRSet with its RRSIGs after the denial proofs.
+ *
+ * The signed SOA is put only if it fits whole, so that it never causes truncation.
+ */
+static int put_authority_soa_signed(knot_pkt_t *pkt, knotd_qdata_t *qdata,
+                                    const zone_contents_t *zone)
+{
+	knot_rrset_t soa = node_rrset(zone->apex, KNOT_RRTYPE_SOA);
+	knot_rrset_t rrsigs = node_rrset(zone->apex, KNOT_RRTYPE_RRSIG);
+
+	size_t size = knot_rrset_size(&soa);
+	knot_rdata_t *rr = rrsigs.rrs.rdata;
+	for (uint16_t i = 0; i < rrsigs.rrs.count; i++) {
+		if (knot_rrsig_type_covered(rr) == KNOT_RRTYPE_SOA) {
+			size += knot_dname_size(rrsigs.owner) + 10 + rr->len;
+		}
+		rr = knot_rdataset_next(rr);
+	}
+	if (pkt->size + pkt->reserved + size > pkt->max_size) {
+		return KNOT_EOK;
+	}
+
+	int ret = put_authority_soa(pkt, qdata, zone);
+	if (ret == KNOT_EOK) {
+		ret = nsec_append_rrsigs(pkt, qdata, false);
+	}
+	return ret;
+}
+
 /*! \brief Put the delegation NS RRSet to the Authority section. */
 static int put_delegation(knot_pkt_t *pkt, knotd_qdata_t *qdata)
 {
 	/* Find closest delegation point. */
+	if (!(qdata->extra->node->flags & NODE_FLAGS_DELEG)) {
+		const zone_node_t *zone_cut = node_zone_cut(qdata->extra->node);
+		if (zone_cut != NULL) {
+			qdata->extra->node = zone_cut;
+		}
+	}
 	while (!(qdata->extra->node->flags & NODE_FLAGS_DELEG)) {
 		qdata->extra->node = node_parent(qdata->extra->node);
 	}
@@ -214,7 +262,8 @@ static int put_nsec3_bitmap(const zone_node_t *for_node, knot_pkt_t *pkt,
 
 /*! \brief Put additional records for given RR. */
 static int put_additional(knot_pkt_t *pkt, const knot_rrset_t *rr,
-                          knotd_qdata_t *qdata, knot_rrinfo_t *info, int state)
+                          knotd_qdata_t *qdata, knot_rrinfo_t *info, int state,
+                          bool with_dnssec)
 {
 	if (rr->additional == NULL) {
 		return KNOT_EOK;
@@ -234,8 +283,19 @@ static int put_additional(knot_pkt_t *pkt, const knot_rrset_t *rr,
 		glue_t *glue = &additional->glues[i];
 		uint32_t flags = KNOT_PF_NULL;
 
+		bool optional;
+		const zone_node_t *gluenode = zone_contents_glue_node(qdata->extra->contents,
+		                                                      glue, rr, qdata->extra->node,
+		                                                      &optional);
+		if (gluenode == NULL) {
+			continue;
+		}
+
 		/* Optional glue doesn't cause truncation. (RFC 1034/4.3.2 step 3b). */
-		if (state != KNOTD_IN_STATE_DELEG || glue->optional) {
+		if (state != KNOTD_IN_STATE_DELEG || optional) {
+			if (qdata->extra->minimal) {
+				continue;
+			}
 			flags |= KNOT_PF_NOTRUNC;
 		}
 
@@ -246,7 +306,6 @@ static int put_additional(knot_pkt_t *pkt, const knot_rrset_t *rr,
 
 		uint16_t hint = knot_compr_hint(info, KNOT_COMPR_HINT_RDATA +
 		                                glue->ns_pos);
-		const zone_node_t *gluenode = glue_node(glue, qdata->extra->node);
 		knot_rrset_t rrsigs = node_rrset(gluenode, KNOT_RRTYPE_RRSIG);
 		for (int k = 0; k < ar_type_count; ++k) {
 			knot_rrset_t rrset = node_rrset(gluenode, ar_type_list[k]);
@@ -262,7 +321,7 @@ static int put_additional(knot_pkt_t *pkt, const knot_rrset_t *rr,
 		}
 
 		if ((rr->type == KNOT_RRTYPE_SVCB || rr->type == KNOT_RRTYPE_HTTPS) &&
-		    ar_present < ar_type_count && have_dnssec(qdata)) {
+		    ar_present < ar_type_count && with_dnssec) {
 			// it would be nicer to have this in solve_additional_dnssec, but
 			// it seems infeasible to transfer all the context there
 
@@ -365,6 +424,9 @@ static knotd_in_state_t follow_cname(knot_pkt_t *pkt, uint16_t rrtype, knotd_qda
 
 	/* Now follow the next CNAME TARGET. */
 	qdata->name = knot_cname_name(cname_rr.rrs.rdata);
+	if (rrtype == KNOT_RRTYPE_CNAME) {
+		qdata->extra->follow_node = cname_target_node(&cname_rr, cname_node);
+	}
 
 	return KNOTD_IN_STATE_FOLLOW;
 }
@@ -442,6 +504,12 @@ static knotd_in_state_t name_not_found(knot_pkt_t *pkt, knotd_qdata_t *qdata)
 
 	/* Look up an authoritative encloser or its parent. */
 	const zone_node_t *node = qdata->extra->encloser;
+	if (node->flags & NODE_FLAGS_NONAUTH) {
+		const zone_node_t *zone_cut = node_zone_cut(node);
+		if (zone_cut != NULL) {
+			node = zone_cut;
+		}
+	}
 	while (node->rrset_count == 0 || node->flags & NODE_FLAGS_NONAUTH) {
 		node = node_parent(node);
 		assert(node);
@@ -459,6 +527,17 @@ static knotd_in_state_t name_not_found(knot_pkt_t *pkt, knotd_qdata_t *qdata)
 static knotd_in_state_t solve_name(knotd_in_state_t state, knot_pkt_t *pkt,
                                    knotd_qdata_t *qdata)
 {
+	/* The in-zone CNAME target is known from the zone adjustment. */
+	const zone_node_t *follow_node = qdata->extra->follow_node;
+	qdata->extra->follow_node = NULL;
+	if (follow_node != NULL && !(qdata->query->flags & KNOT_PF_NULLBYTE)) {
+		assert(state == KNOTD_IN_STATE_FOLLOW);
+		qdata->extra->node = follow_node;
+		qdata->extra->encloser = follow_node;
+		qdata->extra->previous = node_prev(follow_node);
+		return name_found(pkt, qdata);
+	}
+
 	int ret = zone_contents_find_dname(qdata->extra->contents, qdata->name,
 	                                   &qdata->extra->node, &qdata->extra->encloser,
 	                                   &qdata->extra->previous, qdata->query->flags & KNOT_PF_NULLBYTE);
@@ -521,7 +600,7 @@ static knotd_in_state_t solve_answer_dnssec(knotd_in_state_t state, knot_pkt_t *
 }
 
 static knotd_in_state_t solve_authority(knotd_in_state_t state, knot_pkt_t *pkt,
-                                        knotd_qdata_t *qdata, void *ctx)
+                                        knotd_qdata_t *qdata, bool with_dnssec)
 {
 	int ret = KNOT_ERROR;
 	const zone_contents_t *zone_contents = qdata->extra->contents;
@@ -532,10 +611,14 @@ static knotd_in_state_t solve_authority(knotd_in_state_t state, knot_pkt_t *pkt,
 		break;
 	case KNOTD_IN_STATE_MISS:   /* MISS, set NXDOMAIN RCODE. */
 		qdata->rcode = KNOT_RCODE_NXDOMAIN;
-		ret = put_authority_soa(pkt, qdata, zone_contents);
-		break;
+		// FALLTHROUGH
 	case KNOTD_IN_STATE_NODATA: /* NODATA append AUTHORITY SOA. */
-		ret = put_authority_soa(pkt, qdata, zone_contents);
+		/* Minimal signed response gets the SOA after the denial proofs. */
+		if (with_dnssec && qdata->extra->minimal) {
+			ret = KNOT_EOK;
+		} else {
+			ret = put_authority_soa(pkt, qdata, zone_contents);
+		}
 		break;
 	case KNOTD_IN_STATE_DELEG:  /* Referral response. */
 		ret = put_delegation(pkt, qdata);
@@ -588,6 +671,11 @@ static knotd_in_state_t solve_authority_dnssec(knotd_in_state_t state, knot_pkt_
 		ret = nsec_append_rrsigs(pkt, qdata, false);
 	}
 
+	if (ret == KNOT_EOK && qdata->extra->minimal &&
+	    (state == KNOTD_IN_STATE_MISS || state == KNOTD_IN_STATE_NODATA)) {
+		ret = put_authority_soa_signed(pkt, qdata, qdata->extra->contents);
+	}
+
 	/* Evaluate final state. */
 	switch (ret) {
 	case KNOT_EOK:    return state; /* Keep current state. */
@@ -597,7 +685,7 @@ static knotd_in_state_t solve_authority_dnssec(knotd_in_state_t state, knot_pkt_
 }
 
 static knotd_in_state_t solve_additional(knotd_in_state_t state, knot_pkt_t *pkt,
-                                         knotd_qdata_t *qdata, void *ctx)
+                                         knotd_qdata_t *qdata, bool with_dnssec)
 {
 	int ret = KNOT_EOK, rrset_count = pkt->rrset_count;
 
@@ -612,7 +700,7 @@ static knotd_in_state_t solve_additional(knotd_in_state_t state, knot_pkt_t *pkt
 		}
 
 		/* Put additional records for given type. */
-		ret = put_additional(pkt, rr, qdata, info, state);
+		ret = put_additional(pkt, rr, qdata, info, state, with_dnssec);
 		if (ret != KNOT_EOK) {
 			break;
 		}
@@ -647,67 +735,86 @@ static knotd_in_state_t solve_additional_dnssec(knotd_in_state_t state, knot_pkt
 		return KNOT_STATE_FAIL; \
 	}
 
-static knot_layer_state_t answer_query(knot_pkt_t *pkt, knotd_qdata_t *qdata)
-{
-	knotd_in_state_t state = KNOTD_IN_STATE_BEGIN;
-	struct query_plan *plan = qdata->extra->zone->query_plan;
-	struct query_step *step;
-
-	bool with_dnssec = have_dnssec(qdata);
-
-	/* Resolve PREANSWER. */
-	if (plan != NULL) {
-		WALK_LIST(step, plan->stage[KNOTD_STAGE_PREANSWER]) {
-			assert(step->type == QUERY_HOOK_TYPE_IN);
-			SOLVE_STEP(step->in_hook, state, step->ctx);
-		}
-	}
-
-	/* Resolve ANSWER. */
-	knot_pkt_begin(pkt, KNOT_ANSWER);
-	SOLVE_STEP(solve_answer, state, NULL);
-	if (with_dnssec) {
-		SOLVE_STEP(solve_answer_dnssec, state, NULL);
-	}
-	if (plan != NULL) {
-		WALK_LIST(step, plan->stage[KNOTD_STAGE_ANSWER]) {
-			assert(step->type == QUERY_HOOK_TYPE_IN);
-			SOLVE_STEP(step->in_hook, state, step->ctx);
-		}
-	}
-
-	/* Resolve AUTHORITY. */
-	knot_pkt_begin(pkt, KNOT_AUTHORITY);
-	SOLVE_STEP(solve_authority, state, NULL);
-	if (with_dnssec) {
-		SOLVE_STEP(solve_authority_dnssec, state, NULL);
-	}
-	if (plan != NULL) {
-		WALK_LIST(step, plan->stage[KNOTD_STAGE_AUTHORITY]) {
-			assert(step->type == QUERY_HOOK_TYPE_IN);
-			SOLVE_STEP(step->in_hook, state, step->ctx);
-		}
-	}
-
-	/* Resolve ADDITIONAL. */
-	knot_pkt_begin(pkt, KNOT_ADDITIONAL);
-	SOLVE_STEP(solve_additional, state, NULL);
-	if (with_dnssec) {
-		SOLVE_STEP(solve_additional_dnssec, state, NULL);
-	}
-	if (plan != NULL) {
-		WALK_LIST(step, plan->stage[KNOTD_STAGE_ADDITIONAL]) {
-			assert(step->type == QUERY_HOOK_TYPE_IN);
-			SOLVE_STEP(step->in_hook, state, step->ctx);
-		}
+/*! \brief Helper for the module hooks, accounted if the query is measured. */
+#define SOLVE_MOD_STEP(step, state) \
+	uint64_t hook_begin = query_phases_begin(); \
+	state = (step)->in_hook(state, pkt, qdata, (step)->ctx); \
+	query_phases_end_module(((knotd_mod_t *)(step)->ctx)->phase_slot, hook_begin); \
+	if (state == KNOTD_IN_STATE_TRUNC) { \
+		return KNOT_STATE_DONE; \
+	} else if (state == KNOTD_IN_STATE_ERROR) { \
+		return KNOT_STATE_FAIL; \
 	}
 
-	/* Write resulting RCODE. */
-	knot_wire_set_rcode(pkt->wire, qdata->rcode);
-
-	return KNOT_STATE_DONE;
+/*!
+ * \brief Answer pipeline template.
+ *
+ * Instantiated with a constant DNSSEC flag, so that the variant for unsigned
+ * zones (or queries without DO bit) contains no DNSSEC steps or checks.
+ */
+#define ANSWER_QUERY(name, with_dnssec) \
+static knot_layer_state_t name(knot_pkt_t *pkt, knotd_qdata_t *qdata) \
+{ \
+	knotd_in_state_t state = KNOTD_IN_STATE_BEGIN; \
+	struct query_plan *plan = qdata->extra->zone->query_plan; \
+	struct query_step *step; \
+\
+	/* Resolve PREANSWER. */ \
+	if (plan != NULL) { \
+		QUERY_PLAN_FOREACH(plan, KNOTD_STAGE_PREANSWER, step) { \
+			assert(step->type == QUERY_HOOK_TYPE_IN); \
+			SOLVE_MOD_STEP(step, state); \
+		} \
+	} \
+\
+	/* Resolve ANSWER. */ \
+	knot_pkt_begin(pkt, KNOT_ANSWER); \
+	SOLVE_STEP(solve_answer, state, NULL); \
+	if (with_dnssec) { \
+		SOLVE_STEP(solve_answer_dnssec, state, NULL); \
+	} \
+	if (plan != NULL) { \
+		QUERY_PLAN_FOREACH(plan, KNOTD_STAGE_ANSWER, step) { \
+			assert(step->type == QUERY_HOOK_TYPE_IN); \
+			SOLVE_MOD_STEP(step, state); \
+		} \
+	} \
+\
+	/* Resolve AUTHORITY. */ \
+	knot_pkt_begin(pkt, KNOT_AUTHORITY); \
+	SOLVE_STEP(solve_authority, state, with_dnssec); \
+	if (with_dnssec) { \
+		SOLVE_STEP(solve_authority_dnssec, state, NULL); \
+	} \
+	if (plan != NULL) { \
+		QUERY_PLAN_FOREACH(plan, KNOTD_STAGE_AUTHORITY, step) { \
+			assert(step->type == QUERY_HOOK_TYPE_IN); \
+			SOLVE_MOD_STEP(step, state); \
+		} \
+	} \
+\
+	/* Resolve ADDITIONAL. */ \
+	knot_pkt_begin(pkt, KNOT_ADDITIONAL); \
+	SOLVE_STEP(solve_additional, state, with_dnssec); \
+	if (with_dnssec) { \
+		SOLVE_STEP(solve_additional_dnssec, state, NULL); \
+	} \
+	if (plan != NULL) { \
+		QUERY_PLAN_FOREACH(plan, KNOTD_STAGE_ADDITIONAL, step) { \
+			assert(step->type == QUERY_HOOK_TYPE_IN); \
+			SOLVE_MOD_STEP(step, state); \
+		} \
+	} \
+\
+	/* Write resulting RCODE. */ \
+	knot_wire_set_rcode(pkt->wire, qdata->rcode); \
+\
+	return KNOT_STATE_DONE; \
 }
 
+ANSWER_QUERY(answer_query_unsigned, false)
+ANSWER_QUERY(answer_query_signed, true)
+
 knot_layer_state_t internet_process_query(knot_pkt_t *pkt, knotd_qdata_t *qdata)
 {
 	if (pkt == NULL || qdata == NULL) {
@@ -734,5 +841,10 @@ knot_layer_state_t internet_process_query(knot_pkt_t *pkt, knotd_qdata_t *qdata)
 	/* Get answer to QNAME. */
 	qdata->name = knot_pkt_qname(qdata->query);
 
-	return answer_query(pkt, qdata);
+	/* The zone signedness is determined when adjusting its contents. */
+	if (have_dnssec(qdata)) {
+		return answer_query_signed(pkt, qdata);
+	} else {
+		return answer_query_unsigned(pkt, qdata);
+	}
 }
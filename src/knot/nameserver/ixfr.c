@@ -53,10 +53,10 @@ static int ixfr_put_chg_part(knot_pkt_t *pkt, struct ixfr_proc *ixfr,
 
 	if (!knot_rrset_empty(&ixfr->cur_rr)) {
 		IXFR_SAFE_PUT(pkt, &ixfr->cur_rr);
-		journal_read_clear_rrset(&ixfr->cur_rr);
+		knot_rrset_init_empty(&ixfr->cur_rr);
 	}
 
-	while (journal_read_rrset(read, &ixfr->cur_rr, true)) {
+	while (journal_read_rrset_nocopy(read, &ixfr->cur_rr, true)) {
 		if (ixfr->cur_rr.type == KNOT_RRTYPE_SOA) {
 			ixfr->in_remove_section = !ixfr->in_remove_section;
 
@@ -76,7 +76,7 @@ static int ixfr_put_chg_part(knot_pkt_t *pkt, struct ixfr_proc *ixfr,
 		}
 
 		IXFR_SAFE_PUT(pkt, &ixfr->cur_rr);
-		journal_read_clear_rrset(&ixfr->cur_rr);
+		knot_rrset_init_empty(&ixfr->cur_rr);
 	}
 
 	return journal_read_get_error(read, KNOT_EOK);
@@ -103,10 +103,98 @@ static int ixfr_process_journal(knot_pkt_t *pkt, const void *item,
 
 #undef IXFR_SAFE_PUT
 
-static int ixfr_load_chsets(journal_read_t **journal_read, zone_t *zone,
-                            const zone_contents_t *contents, const knot_rrset_t *their_soa)
+/*! \brief Puts the condensed difference into packets, resumable like the above. */
+static int ixfr_process_diff(knot_pkt_t *pkt, const void *item,
+                             struct xfr_proc *xfer)
+{
+	struct ixfr_proc *ixfr = (struct ixfr_proc *)xfer;
+	const changeset_t *ch = &((const ixfr_diff_t *)item)->ch;
+
+	while (true) {
+		int ret = KNOT_EOK;
+		if (knot_rrset_empty(&ixfr->diff_rr)) {
+			switch (ixfr->state) {
+			case IXFR_SOA_DEL:
+				ret = changeset_iter_rem(&ixfr->diff_it, ch);
+				ixfr->diff_rr = *ch->soa_from;
+				ixfr->state = IXFR_DEL;
+				break;
+			case IXFR_DEL:
+				ixfr->diff_rr = changeset_iter_next(&ixfr->diff_it);
+				if (knot_rrset_empty(&ixfr->diff_rr)) {
+					changeset_iter_clear(&ixfr->diff_it);
+					ret = changeset_iter_add(&ixfr->diff_it, ch);
+					ixfr->diff_rr = *ch->soa_to;
+					ixfr->soa_last = changeset_to(ch);
+					ixfr->state = IXFR_ADD;
+				}
+				break;
+			case IXFR_ADD:
+				ixfr->diff_rr = changeset_iter_next(&ixfr->diff_it);
+				if (knot_rrset_empty(&ixfr->diff_rr)) {
+					changeset_iter_clear(&ixfr->diff_it);
+					ixfr->state = IXFR_DONE;
+					return KNOT_EOK;
+				}
+				break;
+			default:
+				return KNOT_EOK;
+			}
+			if (ret != KNOT_EOK) {
+				ixfr->state = IXFR_DONE; // Iterator not initialized.
+				return ret;
+			}
+		}
+
+		if (pkt->size > KNOT_WIRE_PTR_MAX) {
+			return KNOT_ESPACE; // See ixfr_put_chg_part().
+		}
+
+		ret = knot_pkt_put(pkt, 0, &ixfr->diff_rr, KNOT_PF_NOTRUNC | KNOT_PF_ORIGTTL);
+		if (ret != KNOT_EOK) {
+			return ret;
+		}
+		knot_rrset_init_empty(&ixfr->diff_rr);
+	}
+}
+
+/*! \brief Gets a condensed difference if configured and the history is long enough. */
+static bool ixfr_load_diff(ixfr_diff_t **diff, zone_t *zone,
+                           uint32_t serial_from, uint32_t serial_to)
+{
+	conf_val_t val = conf_zone_get(conf(), C_IXFR_CONDENSE, zone->name);
+	size_t min_count = conf_int(&val);
+	if (min_count == 0) {
+		return false;
+	}
+
+	*diff = ixfr_cache_get(zone->ixfr_cache, serial_from, serial_to);
+	if (*diff != NULL) {
+		return true;
+	}
+
+	zone_journal_t j = zone_journal(zone);
+	size_t count = 0;
+	int ret = journal_chain_length(j, serial_from, serial_to, min_count, &count);
+	if (ret != KNOT_EOK || count < min_count) {
+		return false;
+	}
+
+	ixfr_diff_t *built = NULL;
+	if (ixfr_diff_build(j, serial_from, serial_to, &built) != KNOT_EOK) {
+		return false; // Leave it on the regular processing.
+	}
+	*diff = ixfr_cache_put(zone->ixfr_cache, built);
+
+	return true;
+}
+
+static int ixfr_load_chsets(journal_read_t **journal_read, ixfr_diff_t **diff,
+                            zone_t *zone, const zone_contents_t *contents,
+                            const knot_rrset_t *their_soa)
 {
 	assert(journal_read);
+	assert(diff);
 	assert(zone);
 
 	/* Compare serials. */
@@ -125,6 +213,10 @@ static int ixfr_load_chsets(journal_read_t **journal_read, zone_t *zone,
 		return KNOT_ENOENT;
 	}
 
+	if (ixfr_load_diff(diff, zone, serial_from, serial_to)) {
+		return KNOT_EOK;
+	}
+
 	// please note that the journal serial_to might differ from zone SOA serial
 	// it is because RCU lock is made at different moment than LMDB txn begin
 	return journal_read_begin(zone_journal(zone), false, serial_from, journal_read);
@@ -153,9 +245,12 @@ static void ixfr_answer_cleanup(knotd_qdata_t *qdata)
 {
 	struct ixfr_proc *ixfr = (struct ixfr_proc *)qdata->extra->ext;
 
-	knot_rrset_clear(&ixfr->cur_rr, NULL);
 	ptrlist_free(&ixfr->proc.nodes, qdata->mm);
 	journal_read_end(ixfr->journal_ctx);
+	if (ixfr->state == IXFR_DEL || ixfr->state == IXFR_ADD) {
+		changeset_iter_clear(&ixfr->diff_it);
+	}
+	ixfr_cache_release(qdata->extra->zone->ixfr_cache, ixfr->diff);
 	mm_free(qdata->mm, qdata->extra->ext);
 
 	/* Allow zone changes (finished). */
@@ -175,6 +270,8 @@ static void ixfr_answer_finished(knotd_qdata_t *qdata, knot_pkt_t *pkt, int stat
 		xfr_stats_end(&xfr->stats);
 		xfr_log_finished(ZONE_NAME(qdata), LOG_OPERATION_IXFR, LOG_DIRECTION_OUT,
 				 REMOTE(qdata), PROTO(qdata), KEY(qdata), "", &xfr->stats);
+		xfr_perf_transfer(&qdata->extra->zone->xfr_perf, false, xfr->stats.messages,
+		                  xfr->stats.bytes, &xfr->stats.begin, &xfr->stats.end);
 		break;
 	default:
 		break;
@@ -216,7 +313,7 @@ static int ixfr_answer_init(knotd_qdata_t *qdata, uint32_t *serial_from)
 	}
 	memset(xfer, 0, sizeof(*xfer));
 
-	int ret = ixfr_load_chsets(&xfer->journal_ctx, (zone_t *)qdata->extra->zone,
+	int ret = ixfr_load_chsets(&xfer->journal_ctx, &xfer->diff, (zone_t *)qdata->extra->zone,
 	                           qdata->extra->contents, their_soa);
 	if (ret != KNOT_EOK) {
 		mm_free(mm, xfer);
@@ -227,9 +324,14 @@ static int ixfr_answer_init(knotd_qdata_t *qdata, uint32_t *serial_from)
 	xfer->state = IXFR_SOA_DEL;
 	init_list(&xfer->proc.nodes);
 	knot_rrset_init_empty(&xfer->cur_rr);
+	knot_rrset_init_empty(&xfer->diff_rr);
 	xfer->qdata = qdata;
 
-	ptrlist_add(&xfer->proc.nodes, xfer->journal_ctx, mm);
+	if (xfer->diff != NULL) {
+		ptrlist_add(&xfer->proc.nodes, xfer->diff, mm);
+	} else {
+		ptrlist_add(&xfer->proc.nodes, xfer->journal_ctx, mm);
+	}
 
 	xfer->soa_from = knot_soa_serial(their_soa->rrs.rdata);
 	xfer->soa_to = zone_contents_serial(qdata->extra->contents);
@@ -296,8 +398,9 @@ knot_layer_state_t ixfr_process_query(knot_pkt_t *pkt, knotd_qdata_t *qdata)
 		ixfr = qdata->extra->ext;
 		switch (ret) {
 		case KNOT_EOK:       /* OK */
-			IXFROUT_LOG(LOG_INFO, qdata, "started, serial %u -> %u",
-				    ixfr->soa_from, ixfr->soa_to);
+			IXFROUT_LOG(LOG_INFO, qdata, "started, serial %u -> %u%s",
+				    ixfr->soa_from, ixfr->soa_to,
+				    ixfr->diff != NULL ? ", condensed" : "");
 			break;
 		case KNOT_EUPTODATE: /* Our zone is same age/older, send SOA. */
 			IXFROUT_LOG(LOG_INFO, qdata, "zone is up-to-date, serial %u", soa_from);
@@ -333,7 +436,8 @@ knot_layer_state_t ixfr_process_query(knot_pkt_t *pkt, knotd_qdata_t *qdata)
 	}
 
 	/* Answer current packet (or continue). */
-	ret = xfr_process_list(pkt, &ixfr_process_journal, qdata);
+	ret = xfr_process_list(pkt, ixfr->diff != NULL ? &ixfr_process_diff :
+	                                                 &ixfr_process_journal, qdata);
 	switch (ret) {
 	case KNOT_ESPACE: /* Couldn't write more, send packet and continue. */
 		return KNOT_STATE_PRODUCE; /* Check for more. */
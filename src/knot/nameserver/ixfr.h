@@ -17,6 +17,7 @@
 #pragma once
 
 #include "knot/journal/journal_read.h"
+#include "knot/nameserver/ixfr_cache.h"
 #include "knot/nameserver/process_query.h"
 #include "knot/nameserver/xfr.h"
 #include "libknot/packet/pkt.h"
@@ -42,6 +43,11 @@ struct ixfr_proc {
 	/* Changes to be sent. */
 	journal_read_t *journal_ctx;
 
+	/* Condensed changes to be sent instead of journal ones. */
+	ixfr_diff_t *diff;
+	changeset_iter_t diff_it;
+	knot_rrset_t diff_rr;
+
 	/* Currently processed RRSet. */
 	knot_rrset_t cur_rr;
 
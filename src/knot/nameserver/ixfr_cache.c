@@ -0,0 +1,215 @@
+/*  Copyright (C) 2024 CZ.NIC, z.s.p.o. <knot-dns@labs.nic.cz>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include <assert.h>
+#include <pthread.h>
+#include <stdlib.h>
+
+#include "knot/nameserver/ixfr_cache.h"
+#include "knot/journal/journal_read.h"
+#include "libknot/error.h"
+
+// Maximum number of differences (requested serials) kept per zone.
+#define IXFR_CACHE_MAX 8
+
+struct ixfr_cache {
+	pthread_mutex_t lock;
+	ixfr_diff_t *diffs; // Most recently used first.
+	size_t count;
+};
+
+ixfr_cache_t *ixfr_cache_new(void)
+{
+	ixfr_cache_t *cache = calloc(1, sizeof(*cache));
+	if (cache == NULL) {
+		return NULL;
+	}
+
+	pthread_mutex_init(&cache->lock, NULL);
+
+	return cache;
+}
+
+void ixfr_cache_free(ixfr_cache_t *cache)
+{
+	if (cache == NULL) {
+		return;
+	}
+
+	ixfr_cache_flush(cache);
+	pthread_mutex_destroy(&cache->lock);
+	free(cache);
+}
+
+static void diff_unref(ixfr_diff_t *diff)
+{
+	assert(diff->refs > 0);
+	if (--diff->refs == 0) {
+		ixfr_diff_free(diff);
+	}
+}
+
+void ixfr_cache_flush(ixfr_cache_t *cache)
+{
+	if (cache == NULL) {
+		return;
+	}
+
+	pthread_mutex_lock(&cache->lock);
+	ixfr_diff_t *diff = cache->diffs;
+	while (diff != NULL) {
+		ixfr_diff_t *next = diff->next;
+		diff_unref(diff);
+		diff = next;
+	}
+	cache->diffs = NULL;
+	cache->count = 0;
+	pthread_mutex_unlock(&cache->lock);
+}
+
+ixfr_diff_t *ixfr_cache_get(ixfr_cache_t *cache, uint32_t from, uint32_t to)
+{
+	if (cache == NULL) {
+		return NULL;
+	}
+
+	ixfr_diff_t *found = NULL;
+
+	pthread_mutex_lock(&cache->lock);
+	ixfr_diff_t **pos = &cache->diffs;
+	while (*pos != NULL) {
+		ixfr_diff_t *diff = *pos;
+		if (changeset_to(&diff->ch) != to) {
+			*pos = diff->next;
+			cache->count--;
+			diff_unref(diff);
+			continue;
+		}
+		if (changeset_from(&diff->ch) == from) {
+			*pos = diff->next;
+			found = diff;
+			continue;
+		}
+		pos = &diff->next;
+	}
+	if (found != NULL) {
+		found->next = cache->diffs;
+		cache->diffs = found;
+		found->refs++;
+	}
+	pthread_mutex_unlock(&cache->lock);
+
+	return found;
+}
+
+ixfr_diff_t *ixfr_cache_put(ixfr_cache_t *cache, ixfr_diff_t *diff)
+{
+	assert(diff->refs == 0);
+
+	ixfr_diff_t *found = ixfr_cache_get(cache, changeset_from(&diff->ch),
+	                                    changeset_to(&diff->ch));
+	if (found != NULL) {
+		ixfr_diff_free(diff);
+		return found;
+	}
+
+	diff->refs = 1; // The requester's reference.
+	if (cache == NULL) {
+		return diff;
+	}
+
+	pthread_mutex_lock(&cache->lock);
+	diff->next = cache->diffs;
+	cache->diffs = diff;
+	diff->refs++;
+	if (++cache->count > IXFR_CACHE_MAX) {
+		ixfr_diff_t *last = cache->diffs;
+		while (last->next->next != NULL) {
+			last = last->next;
+		}
+		diff_unref(last->next);
+		last->next = NULL;
+		cache->count--;
+	}
+	pthread_mutex_unlock(&cache->lock);
+
+	return diff;
+}
+
+void ixfr_cache_release(ixfr_cache_t *cache, ixfr_diff_t *diff)
+{
+	if (diff == NULL) {
+		return;
+	}
+
+	if (cache == NULL) {
+		diff_unref(diff);
+		return;
+	}
+
+	pthread_mutex_lock(&cache->lock);
+	diff_unref(diff);
+	pthread_mutex_unlock(&cache->lock);
+}
+
+int ixfr_diff_build(zone_journal_t j, uint32_t from, uint32_t to, ixfr_diff_t **diff)
+{
+	ixfr_diff_t *res = calloc(1, sizeof(*res));
+	if (res == NULL) {
+		return KNOT_ENOMEM;
+	}
+
+	journal_read_t *read = NULL;
+	int ret = journal_read_begin(j, false, from, &read);
+	if (ret != KNOT_EOK) {
+		free(res);
+		return ret;
+	}
+
+	changeset_t ch;
+	while (ret == KNOT_EOK && changeset_to(&res->ch) != to &&
+	       journal_read_changeset(read, &ch)) {
+		if (res->merged++ == 0) {
+			res->ch = ch;
+			continue;
+		}
+		ret = changeset_merge(&res->ch, &ch, 0);
+		journal_read_clear_changeset(&ch);
+	}
+	ret = journal_read_get_error(read, ret);
+	journal_read_end(read);
+
+	if (ret == KNOT_EOK && (res->merged == 0 || changeset_to(&res->ch) != to)) {
+		ret = KNOT_ENOENT; // History doesn't reach the current serial.
+	}
+	if (ret != KNOT_EOK) {
+		ixfr_diff_free(res);
+		return ret;
+	}
+
+	*diff = res;
+	return KNOT_EOK;
+}
+
+void ixfr_diff_free(ixfr_diff_t *diff)
+{
+	if (diff == NULL) {
+		return;
+	}
+
+	changeset_clear(&diff->ch);
+	free(diff);
+}
@@ -0,0 +1,106 @@
+/*  Copyright (C) 2024 CZ.NIC, z.s.p.o. <knot-dns@labs.nic.cz>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+/*!
+ * \brief Per-zone cache of condensed outgoing IXFR differences.
+ *
+ * A chain of journal changesets from a requested serial up to the current
+ * zone serial is merged into one changeset, which is kept for other secondaries
+ * requesting the same serial. Any zone contents switch flushes the cache.
+ */
+
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "knot/journal/journal_basic.h"
+#include "knot/updates/changesets.h"
+
+typedef struct ixfr_cache ixfr_cache_t;
+
+/*! \brief Condensed difference between two zone serials. */
+typedef struct ixfr_diff {
+	struct ixfr_diff *next;
+	changeset_t ch;   /*!< Merged changeset. */
+	size_t merged;    /*!< Number of merged journal changesets. */
+	unsigned refs;    /*!< Reference count, protected by the cache lock. */
+} ixfr_diff_t;
+
+/*!
+ * \brief Create an empty cache.
+ *
+ * \return Cache or NULL if out of memory.
+ */
+ixfr_cache_t *ixfr_cache_new(void);
+
+/*!
+ * \brief Free the cache.
+ *
+ * \note No difference may be in use.
+ */
+void ixfr_cache_free(ixfr_cache_t *cache);
+
+/*!
+ * \brief Drop all the cached differences, those in use are freed once released.
+ */
+void ixfr_cache_flush(ixfr_cache_t *cache);
+
+/*!
+ * \brief Get a cached difference.
+ *
+ * Differences leading to other than the requested serial are dropped.
+ *
+ * \param cache   Cache.
+ * \param from    Serial of the requester.
+ * \param to      Current zone serial.
+ *
+ * \return Referenced difference or NULL if not cached.
+ */
+ixfr_diff_t *ixfr_cache_get(ixfr_cache_t *cache, uint32_t from, uint32_t to);
+
+/*!
+ * \brief Store a difference in the cache.
+ *
+ * \param cache   Cache.
+ * \param diff    Newly built difference, consumed.
+ *
+ * \return Referenced difference to be used, possibly an equivalent one
+ *         inserted by someone else meanwhile.
+ */
+ixfr_diff_t *ixfr_cache_put(ixfr_cache_t *cache, ixfr_diff_t *diff);
+
+/*!
+ * \brief Release a referenced difference.
+ */
+void ixfr_cache_release(ixfr_cache_t *cache, ixfr_diff_t *diff);
+
+/*!
+ * \brief Merge journal changesets into one difference.
+ *
+ * \param j      Zone journal.
+ * \param from   Serial to start from.
+ * \param to     Serial to end at.
+ * \param diff   Output: built difference (not referenced by any cache).
+ *
+ * \return KNOT_E*
+ */
+int ixfr_diff_build(zone_journal_t j, uint32_t from, uint32_t to, ixfr_diff_t **diff);
+
+/*!
+ * \brief Free a difference which isn't in any cache.
+ */
+void ixfr_diff_free(ixfr_diff_t *diff);
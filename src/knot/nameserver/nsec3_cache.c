@@ -0,0 +1,171 @@
+/*  Copyright (C) 2024 CZ.NIC, z.s.p.o. <knot-dns@labs.nic.cz>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "knot/nameserver/nsec3_cache.h"
+#include "knot/dnssec/zone-nsec.h"
+#include "libdnssec/error.h"
+#include "libdnssec/random.h"
+#include "libknot/error.h"
+#include "contrib/openbsd/siphash.h"
+
+#define CACHE_SETS	256
+#define CACHE_WAYS	2
+#define NAME_MAX_LEN	128	// Longer names aren't cached.
+#define SALT_MAX_LEN	16	// Zones with longer salts aren't cached.
+#define DIGEST_MAX_LEN	20	// SHA-1, the only NSEC3 hash algorithm.
+
+typedef struct {
+	uint16_t iterations;
+	uint8_t algorithm;
+	uint8_t salt_len;
+	uint8_t name_len;   // 0 for empty entry.
+	uint8_t digest_len;
+	uint8_t salt[SALT_MAX_LEN];
+	uint8_t digest[DIGEST_MAX_LEN];
+	uint8_t name[NAME_MAX_LEN];
+} entry_t;
+
+typedef struct {
+	SIPHASH_KEY hash_key;
+	uint8_t lru[CACHE_SETS]; // Least recently used way of each set.
+	entry_t entries[CACHE_SETS][CACHE_WAYS];
+} nsec3_cache_t;
+
+static __thread nsec3_cache_t *thread_cache;
+
+static pthread_key_t cache_key;
+static pthread_once_t cache_key_once = PTHREAD_ONCE_INIT;
+
+static void cache_key_init(void)
+{
+	(void)pthread_key_create(&cache_key, free);
+}
+
+static nsec3_cache_t *get_cache(void)
+{
+	if (thread_cache != NULL) {
+		return thread_cache;
+	}
+
+	nsec3_cache_t *cache = calloc(1, sizeof(*cache));
+	if (cache == NULL) {
+		return NULL;
+	}
+	if (dnssec_random_buffer((uint8_t *)&cache->hash_key,
+	                         sizeof(cache->hash_key)) != DNSSEC_EOK) {
+		free(cache);
+		return NULL;
+	}
+
+	// Register the thread for cleanup of the cache on exit.
+	(void)pthread_once(&cache_key_once, cache_key_init);
+	if (pthread_setspecific(cache_key, cache) != 0) {
+		free(cache);
+		return NULL;
+	}
+
+	thread_cache = cache;
+	return cache;
+}
+
+static bool entry_match(const entry_t *entry, const uint8_t *name, size_t name_len,
+                        const dnssec_nsec3_params_t *params)
+{
+	return entry->name_len == name_len &&
+	       entry->algorithm == params->algorithm &&
+	       entry->iterations == params->iterations &&
+	       entry->salt_len == params->salt.size &&
+	       (params->salt.size == 0 ||
+	        memcmp(entry->salt, params->salt.data, params->salt.size) == 0) &&
+	       memcmp(entry->name, name, name_len) == 0;
+}
+
+static int compute_digest(const knot_dname_t *name, size_t name_len,
+                          const dnssec_nsec3_params_t *params,
+                          uint8_t *digest, uint8_t *digest_len)
+{
+	dnssec_binary_t data = {
+		.data = (uint8_t *)name,
+		.size = name_len
+	};
+	dnssec_binary_t hash = { 0 };
+
+	int ret = dnssec_nsec3_hash(&data, params, &hash);
+	if (ret != DNSSEC_EOK) {
+		return knot_error_from_libdnssec(ret);
+	}
+	if (hash.size > DIGEST_MAX_LEN) {
+		dnssec_binary_free(&hash);
+		return KNOT_ESPACE;
+	}
+
+	memcpy(digest, hash.data, hash.size);
+	*digest_len = hash.size;
+	dnssec_binary_free(&hash);
+
+	return KNOT_EOK;
+}
+
+int nsec3_cache_owner(uint8_t *out, size_t out_size, const knot_dname_t *name,
+                      const zone_contents_t *zone)
+{
+	const dnssec_nsec3_params_t *params = &zone->nsec3_params;
+	size_t name_len = knot_dname_size(name);
+
+	nsec3_cache_t *cache = NULL;
+	if (name_len <= NAME_MAX_LEN && params->salt.size <= SALT_MAX_LEN) {
+		cache = get_cache();
+	}
+	if (cache == NULL) {
+		return knot_create_nsec3_owner(out, out_size, name, zone->apex->owner, params);
+	}
+
+	uint64_t hash = SipHash24(&cache->hash_key, name, name_len);
+	unsigned set = hash % CACHE_SETS;
+	entry_t *ways = cache->entries[set];
+
+	for (unsigned i = 0; i < CACHE_WAYS; i++) {
+		if (entry_match(&ways[i], name, name_len, params)) {
+			cache->lru[set] = (i + 1) % CACHE_WAYS;
+			return knot_nsec3_hash_to_dname(out, out_size, ways[i].digest,
+			                                 ways[i].digest_len, zone->apex->owner);
+		}
+	}
+
+	entry_t *entry = &ways[cache->lru[set]];
+	entry->name_len = 0;
+	int ret = compute_digest(name, name_len, params, entry->digest, &entry->digest_len);
+	if (ret != KNOT_EOK) {
+		return ret;
+	}
+	entry->iterations = params->iterations;
+	entry->algorithm = params->algorithm;
+	entry->salt_len = params->salt.size;
+	if (params->salt.size > 0) {
+		memcpy(entry->salt, params->salt.data, params->salt.size);
+	}
+	memcpy(entry->name, name, name_len);
+	entry->name_len = name_len;
+	cache->lru[set] = (cache->lru[set] + 1) % CACHE_WAYS;
+
+	return knot_nsec3_hash_to_dname(out, out_size, entry->digest, entry->digest_len,
+	                                zone->apex->owner);
+}
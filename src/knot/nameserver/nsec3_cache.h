@@ -0,0 +1,47 @@
+/*  Copyright (C) 2024 CZ.NIC, z.s.p.o. <knot-dns@labs.nic.cz>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+
+/*!
+ * \brief Per-thread cache of NSEC3 hashes of the names looked up in queries.
+ *
+ * Denial of existence in an NSEC3 zone requires hashing of the next closer
+ * name, which is (unlike the closest encloser and wildcard hashes precomputed
+ * during zone adjusting) specific to the queried name. Repeated queries for
+ * the same nonexistent name are answered from the cache without hashing.
+ *
+ * The cache is keyed by the name and the NSEC3 parameters only, so it needs
+ * no invalidation upon zone changes.
+ */
+
+#pragma once
+
+#include "knot/zone/contents.h"
+
+/*!
+ * \brief Compute the NSEC3 owner name for a name, using the thread's cache.
+ *
+ * Same as knot_create_nsec3_owner() with the zone NSEC3 parameters.
+ *
+ * \param out       Output buffer.
+ * \param out_size  Size of the output buffer.
+ * \param name      Name to be hashed.
+ * \param zone      Zone contents with NSEC3 enabled.
+ *
+ * \return KNOT_E*
+ */
+int nsec3_cache_owner(uint8_t *out, size_t out_size, const knot_dname_t *name,
+                      const zone_contents_t *zone);
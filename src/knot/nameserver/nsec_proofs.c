@@ -19,6 +19,7 @@
 #include "libknot/libknot.h"
 #include "knot/nameserver/nsec_proofs.h"
 #include "knot/nameserver/internet.h"
+#include "knot/nameserver/nsec3_cache.h"
 #include "knot/dnssec/zone-nsec.h"
 
 /*!
@@ -204,6 +205,30 @@ static int put_covering_nsec(const zone_contents_t *zone,
 	return put_nsec_from_node(proof, qdata, resp);
 }
 
+/*!
+ * \brief Same as zone_contents_find_nsec3_for_name(), with cached hashing.
+ */
+static int find_nsec3_for_name(const zone_contents_t *zone,
+                               const knot_dname_t *name,
+                               const zone_node_t **nsec3_node,
+                               const zone_node_t **nsec3_previous)
+{
+	if (zone_tree_is_empty(zone->nsec3_nodes)) {
+		return KNOT_ENSEC3CHAIN;
+	}
+	if (!knot_is_nsec3_enabled(zone)) {
+		return KNOT_ENSEC3PAR;
+	}
+
+	knot_dname_storage_t nsec3_name;
+	int ret = nsec3_cache_owner(nsec3_name, sizeof(nsec3_name), name, zone);
+	if (ret != KNOT_EOK) {
+		return ret;
+	}
+
+	return zone_contents_find_nsec3(zone, nsec3_name, nsec3_node, nsec3_previous);
+}
+
 /*!
  * \brief Find NSEC3 covering the given name and put it into the response.
  */
@@ -215,7 +240,7 @@ static int put_covering_nsec3(const zone_contents_t *zone,
 	const zone_node_t *prev = NULL;
 	const zone_node_t *node = NULL;
 
-	int match = zone_contents_find_nsec3_for_name(zone, name, &node, &prev);
+	int match = find_nsec3_for_name(zone, name, &node, &prev);
 	if (match < 0) {
 		// ignore if missing
 		return KNOT_EOK;
@@ -575,9 +600,9 @@ int nsec_prove_wildcards(knot_pkt_t *pkt, knotd_qdata_t *qdata)
 	}
 
 	int ret = KNOT_EOK;
-	struct wildcard_hit *item;
 
-	WALK_LIST(item, qdata->extra->wildcards) {
+	for (unsigned i = 0; i < qdata->extra->wildcard_count; i++) {
+		const struct wildcard_hit *item = &qdata->extra->wildcards[i];
 		if (item->node == NULL) {
 			return KNOT_EINVAL;
 		}
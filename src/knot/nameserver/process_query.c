@@ -14,13 +14,17 @@
     along with this program.  If not, see <https://www.gnu.org/licenses/>.
  */
 
+#include <time.h>
 #include <urcu.h>
 
 #include "libdnssec/tsig.h"
 #include "knot/common/log.h"
+#include "knot/common/probes.h"
 #include "knot/dnssec/rrset-sign.h"
 #include "knot/nameserver/process_query.h"
 #include "knot/nameserver/query_module.h"
+#include "knot/nameserver/query_phases.h"
+#include "knot/nameserver/query_stats.h"
 #include "knot/nameserver/chaos.h"
 #include "knot/nameserver/internet.h"
 #include "knot/nameserver/axfr.h"
@@ -29,6 +33,7 @@
 #include "knot/nameserver/nsec_proofs.h"
 #include "knot/nameserver/notify.h"
 #include "knot/server/server.h"
+#include "knot/server/suspend.h"
 #include "libknot/libknot.h"
 #include "libknot/quic/quic_conn.h"
 #include "libknot/quic/tls_common.h"
@@ -70,7 +75,6 @@ static void query_data_init(knot_layer_t *ctx, knotd_qdata_params_t *params,
 
 	/* Initialize lists. */
 	memset(extra, 0, sizeof(*extra));
-	init_list(&extra->wildcards);
 	init_list(&extra->rrsigs);
 }
 
@@ -99,7 +103,6 @@ static int process_query_reset(knot_layer_t *ctx)
 
 	/* Free allocated data. */
 	knot_rrset_clear(&qdata->opt_rr, qdata->mm);
-	ptrlist_free(&extra->wildcards, qdata->mm);
 	nsec_clear_rrsigs(qdata);
 	if (extra->ext_cleanup != NULL) {
 		extra->ext_cleanup(qdata);
@@ -242,56 +245,36 @@ static int answer_edns_init(const knot_pkt_t *query, knot_pkt_t *resp,
 		return KNOT_EOK;
 	}
 
-	/* Initialize OPT record. */
+	const conf_t *pconf = conf();
+
 	uint16_t max_payload;
 	switch (knotd_qdata_remote_addr(qdata)->ss_family) {
 	case AF_INET:
-		max_payload = conf()->cache.srv_udp_max_payload_ipv4;
+		max_payload = pconf->cache.srv_udp_max_payload_ipv4;
 		break;
 	case AF_INET6:
-		max_payload = conf()->cache.srv_udp_max_payload_ipv6;
+		max_payload = pconf->cache.srv_udp_max_payload_ipv6;
 		break;
 	case AF_UNIX:
-		max_payload = MIN(conf()->cache.srv_udp_max_payload_ipv4,
-		                  conf()->cache.srv_udp_max_payload_ipv6);
+		max_payload = MIN(pconf->cache.srv_udp_max_payload_ipv4,
+		                  pconf->cache.srv_udp_max_payload_ipv6);
 		break;
 	default:
 		return KNOT_ERROR;
 	}
-	int ret = knot_edns_init(&qdata->opt_rr, max_payload, 0,
-	                         KNOT_EDNS_VERSION, qdata->mm);
-	if (ret != KNOT_EOK) {
-		return ret;
-	}
-
-	/* Check supported version. */
-	if (knot_edns_get_version(query->opt_rr) != KNOT_EDNS_VERSION) {
-		qdata->rcode = KNOT_RCODE_BADVERS;
-	}
-
-	/* Set DO bit if set (DNSSEC requested). */
-	if (knot_pkt_has_dnssec(query)) {
-		knot_edns_set_do(&qdata->opt_rr);
-	}
 
 	/* Append NSID if requested and available. */
+	const uint8_t *nsid_opt = NULL;
+	uint16_t nsid_opt_len = 0;
 	if (knot_pkt_edns_option(query, KNOT_EDNS_OPTION_NSID) != NULL) {
-		size_t nsid_len = conf()->cache.srv_nsid_len;
-		const uint8_t *nsid_data = conf()->cache.srv_nsid_data;
-
-		if (nsid_len > 0) {
-			ret = knot_edns_add_option(&qdata->opt_rr,
-			                           KNOT_EDNS_OPTION_NSID,
-			                           nsid_len, nsid_data,
-			                           qdata->mm);
-			if (ret != KNOT_EOK) {
-				return ret;
-			}
-		}
+		nsid_opt = pconf->cache.srv_nsid_opt;
+		nsid_opt_len = pconf->cache.srv_nsid_opt_len;
 	}
 
 	/* Initialize EDNS Client Subnet if configured and present in query. */
-	if (conf()->cache.srv_ecs) {
+	uint16_t ecs_len = 0;
+	qdata->ecs = NULL;
+	if (pconf->cache.srv_ecs) {
 		uint8_t *ecs_opt = knot_pkt_edns_option(query, KNOT_EDNS_OPTION_CLIENT_SUBNET);
 		if (ecs_opt != NULL) {
 			qdata->ecs = mm_alloc(qdata->mm, sizeof(knot_edns_client_subnet_t));
@@ -299,23 +282,70 @@ static int answer_edns_init(const knot_pkt_t *query, knot_pkt_t *resp,
 				return KNOT_ENOMEM;
 			}
 			const uint8_t *ecs_data = knot_edns_opt_get_data(ecs_opt);
-			uint16_t ecs_len = knot_edns_opt_get_length(ecs_opt);
-			ret = knot_edns_client_subnet_parse(qdata->ecs, ecs_data, ecs_len);
+			ecs_len = knot_edns_opt_get_length(ecs_opt);
+			int ret = knot_edns_client_subnet_parse(qdata->ecs, ecs_data, ecs_len);
 			if (ret != KNOT_EOK) {
 				qdata->rcode = KNOT_RCODE_FORMERR;
 				return ret;
 			}
 			qdata->ecs->scope_len = 0;
-
-			/* Reserve space for the option in the answer. */
-			ret = knot_edns_reserve_option(&qdata->opt_rr, KNOT_EDNS_OPTION_CLIENT_SUBNET,
-			                               ecs_len, NULL, qdata->mm);
-			if (ret != KNOT_EOK) {
-				return ret;
-			}
 		}
+	}
+
+	/* Compose the initial options at once, ECS is reserved to be written later. */
+	size_t opts_len = nsid_opt_len;
+	if (qdata->ecs != NULL) {
+		opts_len += KNOT_EDNS_OPTION_HDRLEN + ecs_len;
+	}
+	if (opts_len > UINT16_MAX) {
+		return KNOT_ESPACE;
+	}
+
+	/* Initialize OPT record. */
+	knot_dname_t *owner = knot_dname_copy((const uint8_t *)"", qdata->mm);
+	if (owner == NULL) {
+		return KNOT_ENOMEM;
+	}
+	knot_rrset_init(&qdata->opt_rr, owner, KNOT_RRTYPE_OPT, max_payload, 0);
+
+	int ret;
+	if (opts_len == 0) {
+		ret = knot_rrset_add_rdata(&qdata->opt_rr, NULL, 0, qdata->mm);
 	} else {
-		qdata->ecs = NULL;
+		/* Compose the RDATA off the stack, the options may be large. */
+		knot_rdata_t *opts = mm_alloc(qdata->mm, knot_rdata_size(opts_len));
+		if (opts == NULL) {
+			return KNOT_ENOMEM;
+		}
+		opts->len = opts_len;
+		if (opts_len & 1) {
+			opts->data[opts_len] = 0;
+		}
+		if (nsid_opt_len > 0) {
+			memcpy(opts->data, nsid_opt, nsid_opt_len);
+		}
+		if (qdata->ecs != NULL) {
+			uint8_t *ecs_opt = opts->data + nsid_opt_len;
+			knot_wire_write_u16(ecs_opt, KNOT_EDNS_OPTION_CLIENT_SUBNET);
+			knot_wire_write_u16(ecs_opt + sizeof(uint16_t), ecs_len);
+			memset(ecs_opt + KNOT_EDNS_OPTION_HDRLEN, 0, ecs_len);
+		}
+		ret = knot_rdataset_add(&qdata->opt_rr.rrs, opts, qdata->mm);
+		mm_free(qdata->mm, opts);
+	}
+	if (ret != KNOT_EOK) {
+		return ret;
+	}
+	knot_edns_set_version(&qdata->opt_rr, KNOT_EDNS_VERSION);
+
+	/* Check supported version. */
+	if (knot_edns_get_version(query->opt_rr) != KNOT_EDNS_VERSION) {
+		qdata->rcode = KNOT_RCODE_BADVERS;
+	}
+
+	/* Set DO bit if set (DNSSEC requested). */
+	if (knot_pkt_has_dnssec(query)) {
+		knot_edns_set_do(&qdata->opt_rr);
 	}
 
 	return answer_edns_reserve(resp, qdata);
@@ -483,6 +513,11 @@ static int prepare_answer(knot_pkt_t *query, knot_pkt_t *resp, knot_layer_t *ctx
 			uint16_t transfer = MIN(client_size, server_size);
 			resp->max_size = MAX(resp->max_size, transfer);
 		}
+		if (conf()->cache.srv_udp_trunc_learn) {
+			qdata->extra->minimal = tc_memory_prone(server->tc_memory,
+			                                        knotd_qdata_remote_addr(qdata),
+			                                        time(NULL));
+		}
 	} else {
 		resp->max_size = KNOT_WIRE_MAX_PKTSIZE;
 	}
@@ -503,7 +538,12 @@ static int prepare_answer(knot_pkt_t *query, knot_pkt_t *resp, knot_layer_t *ctx
 	}
 
 	/* Find zone for QNAME. */
+	uint64_t zone_begin = query_phases_begin();
 	qdata->extra->zone = answer_zone_find(query, server->zone_db);
+	query_phases_end(QUERY_PHASE_ZONE, zone_begin);
+	if (qdata->extra->zone != NULL && qdata->extra->zone->lazy.enabled) {
+		zone_lazy_touch(qdata->extra->zone);
+	}
 	if (qdata->extra->zone != NULL && qdata->extra->contents == NULL) {
 		qdata->extra->contents = qdata->extra->zone->contents;
 	}
@@ -580,22 +620,95 @@ static knot_layer_state_t process_query_err(knot_layer_t *ctx, knot_pkt_t *pkt)
 	return KNOT_STATE_DONE;
 }
 
-#define PROCESS_BEGIN(plan, step, next_state, qdata) \
-	if (plan != NULL) { \
-		WALK_LIST(step, plan->stage[KNOTD_STAGE_BEGIN]) { \
-			assert(step->type == QUERY_HOOK_TYPE_GENERAL); \
-			next_state = step->general_hook(next_state, pkt, qdata, step->ctx); \
-			if (next_state == KNOT_STATE_FAIL) { \
-				goto finish; \
-			} \
-		} \
+/*!
+ * \brief Process the BEGIN stage of the plan from the given step.
+ *
+ * If a hook suspends the processing, the resume point is stored to the
+ * detached query.
+ */
+static int process_begin(const struct query_plan *plan, unsigned first, int state,
+                         knot_pkt_t *pkt, knotd_qdata_t *qdata)
+{
+	if (plan == NULL) {
+		return state;
+	}
+
+	const struct query_stage *stage = &plan->stage[KNOTD_STAGE_BEGIN];
+	for (unsigned i = first; i < stage->count; i++) {
+		const struct query_step *step = &stage->steps[i];
+		assert(step->type == QUERY_HOOK_TYPE_GENERAL);
+		uint64_t hook_begin = query_phases_begin();
+		state = step->general_hook(state, pkt, qdata, step->ctx);
+		query_phases_end_module(((knotd_mod_t *)step->ctx)->phase_slot, hook_begin);
+		if (state == KNOT_STATE_YIELD) {
+			knotd_suspended_t *suspended = qdata->extra->suspended;
+			if (suspended == NULL) {
+				return KNOT_STATE_FAIL; // Not suspended via knotd_qdata_yield().
+			}
+			qdata->extra->suspended = NULL;
+			suspend_qdata(suspended)->extra->resume = (query_resume_t) {
+				.plan = plan,
+				.step = i,
+				.hook = step->general_hook,
+				.ctx = step->ctx,
+				.set = true,
+			};
+			return state;
+		} else if (state == KNOT_STATE_FAIL) {
+			return state;
+		}
 	}
 
+	return state;
+}
+
+/*! \brief Check if the resume point belongs to the plan. */
+static bool resume_in_plan(const query_resume_t *resume, const struct query_plan *plan)
+{
+	if (plan == NULL || resume->plan != plan) {
+		return false;
+	}
+
+	const struct query_stage *stage = &plan->stage[KNOTD_STAGE_BEGIN];
+	return resume->step < stage->count &&
+	       stage->steps[resume->step].general_hook == resume->hook &&
+	       stage->steps[resume->step].ctx == resume->ctx;
+}
+
+/*! \brief Continue the BEGIN stage after the suspended hook. */
+static int process_resume(const struct query_plan *plan, const struct query_plan *zone_plan,
+                          knot_pkt_t *pkt, knotd_qdata_t *qdata)
+{
+	query_resume_t *resume = &qdata->extra->resume;
+	resume->set = false;
+
+	int state = resume->state;
+	if (state == KNOT_STATE_YIELD) {
+		return KNOT_STATE_FAIL;
+	}
+
+	if (resume_in_plan(resume, plan)) {
+		state = process_begin(plan, resume->step + 1, state, pkt, qdata);
+		if (state == KNOT_STATE_FAIL || state == KNOT_STATE_YIELD) {
+			return state;
+		}
+		return process_begin(zone_plan, 0, state, pkt, qdata);
+	} else if (resume_in_plan(resume, zone_plan)) {
+		return process_begin(zone_plan, resume->step + 1, state, pkt, qdata);
+	}
+
+	/* The modules were reconfigured meanwhile. */
+	qdata->rcode = KNOT_RCODE_SERVFAIL;
+	return KNOT_STATE_FAIL;
+}
+
 #define PROCESS_END(plan, step, next_state, qdata) \
 	if (plan != NULL) { \
-		WALK_LIST(step, plan->stage[KNOTD_STAGE_END]) { \
+		QUERY_PLAN_FOREACH(plan, KNOTD_STAGE_END, step) { \
 			assert(step->type == QUERY_HOOK_TYPE_GENERAL); \
+			uint64_t hook_begin = query_phases_begin(); \
 			next_state = step->general_hook(next_state, pkt, qdata, step->ctx); \
+			query_phases_end_module(((knotd_mod_t *)step->ctx)->phase_slot, hook_begin); \
 			if (next_state == KNOT_STATE_FAIL) { \
 				next_state = process_query_err(ctx, pkt); \
 			} \
@@ -615,6 +728,13 @@ static int process_query_out(knot_layer_t *ctx, knot_pkt_t *pkt)
 
 	int next_state = KNOT_STATE_PRODUCE;
 
+	struct timespec begin;
+	bool measure = query_stats_active();
+	if (measure) {
+		clock_gettime(CLOCK_MONOTONIC, &begin);
+	}
+	uint64_t total_begin = query_phases_begin();
+
 	/* Check parse state. */
 	knot_pkt_t *query = qdata->query;
 	if (query->parsed < query->size) {
@@ -629,16 +749,44 @@ static int process_query_out(knot_layer_t *ctx, knot_pkt_t *pkt)
 		goto finish;
 	}
 
+	/* Early data can be replayed, only idempotent queries are allowed. */
+	if ((qdata->params->flags & KNOTD_QUERY_FLAG_EARLY_DATA) &&
+	    qdata->type != KNOTD_QUERY_TYPE_NORMAL) {
+		qdata->rcode = KNOT_RCODE_REFUSED;
+		next_state = KNOT_STATE_FAIL;
+		goto finish;
+	}
+
 	if (qdata->extra->zone != NULL && qdata->extra->zone->query_plan != NULL) {
 		zone_plan = qdata->extra->zone->query_plan;
 	}
 
+	KNOTD_PROBE2(query__zone, qdata->extra->zone != NULL ? qdata->extra->zone->name : NULL,
+	             knot_pkt_qtype(query));
+
 	/* Before query processing code. */
-	PROCESS_BEGIN(plan, step, next_state, qdata);
-	PROCESS_BEGIN(zone_plan, step, next_state, qdata);
+	KNOTD_PROBE1(module__begin, KNOTD_STAGE_BEGIN);
+	if (qdata->extra->resume.set) {
+		next_state = process_resume(plan, zone_plan, pkt, qdata);
+	} else {
+		next_state = process_begin(plan, 0, next_state, pkt, qdata);
+		if (next_state != KNOT_STATE_FAIL && next_state != KNOT_STATE_YIELD) {
+			next_state = process_begin(zone_plan, 0, next_state, pkt, qdata);
+		}
+	}
+	KNOTD_PROBE2(module__end, KNOTD_STAGE_BEGIN, next_state);
+	if (next_state == KNOT_STATE_YIELD) {
+		/* To be finished once resumed, see suspend_queue_process(). */
+		rcu_read_unlock();
+		return next_state;
+	} else if (next_state == KNOT_STATE_FAIL) {
+		goto finish;
+	}
 
 	/* Answer based on qclass. */
 	if (next_state == KNOT_STATE_PRODUCE) {
+		uint64_t answer_begin = query_phases_begin();
+		uint64_t answer_modules = query_phases_modules();
 		switch (knot_pkt_qclass(pkt)) {
 		case KNOT_CLASS_CH:
 			next_state = query_chaos(pkt, ctx);
@@ -652,6 +800,8 @@ static int process_query_out(knot_layer_t *ctx, knot_pkt_t *pkt)
 			next_state = KNOT_STATE_FAIL;
 			break;
 		}
+		query_phases_end_excl(QUERY_PHASE_ANSWER, answer_begin, answer_modules);
+		KNOTD_PROBE2(query__answer, next_state, qdata->rcode);
 	}
 
 	/* Postprocessing. */
@@ -697,8 +847,32 @@ finish:
 	}
 
 	/* After query processing code. */
+	KNOTD_PROBE1(module__begin, KNOTD_STAGE_END);
 	PROCESS_END(plan, step, next_state, qdata);
 	PROCESS_END(zone_plan, step, next_state, qdata);
+	KNOTD_PROBE2(module__end, KNOTD_STAGE_END, next_state);
+
+	if (qdata->params->proto == KNOTD_QUERY_PROTO_UDP && knot_wire_get_tc(pkt->wire) &&
+	    next_state != KNOT_STATE_NOOP && conf()->cache.srv_udp_trunc_learn) {
+		server_t *server = qdata->params->server;
+		tc_memory_note(server->tc_memory, knotd_qdata_remote_addr(qdata), time(NULL));
+	}
+
+	/* Query modules, answer rotation, and truncation learning may alter each response. */
+	conf_t *pconf = conf();
+	qdata->extra->volatile_answer = plan != NULL || zone_plan != NULL ||
+	                                pconf->cache.srv_ans_rotate ||
+	                                pconf->cache.srv_proxy_enabled ||
+	                                pconf->cache.srv_udp_trunc_learn;
+
+	if (measure && next_state != KNOT_STATE_NOOP) {
+		unsigned group = (qdata->extra->zone != NULL) ? qdata->extra->zone->stats_group : 0;
+		query_stats_record(qdata->params->thread_id, qdata->params->proto, group,
+		                   &begin, pkt->size);
+	}
+	query_phases_end(QUERY_PHASE_TOTAL, total_begin);
+
+	KNOTD_PROBE3(query__done, next_state, qdata->rcode, pkt->size);
 
 	rcu_read_unlock();
 
@@ -826,8 +1000,10 @@ int process_query_verify(knotd_qdata_t *qdata)
 	ctx->tsig_digestlen = knot_tsig_rdata_mac_length(query->tsig_rr);
 
 	/* Checking query. */
+	uint64_t tsig_begin = query_phases_begin();
 	int ret = knot_tsig_server_check(query->tsig_rr, query->wire,
 	                                 query->size, &ctx->tsig_key);
+	query_phases_end(QUERY_PHASE_TSIG, tsig_begin);
 
 	/* Evaluate TSIG check results. */
 	switch(ret) {
@@ -896,6 +1072,7 @@ int process_query_sign_response(knot_pkt_t *pkt, knotd_qdata_t *qdata)
 	if (ctx->tsig_key.name != NULL && knot_tsig_can_sign(qdata->rcode_tsig)) {
 		/* Sign query response. */
 		size_t new_digest_len = dnssec_tsig_algorithm_size(ctx->tsig_key.algorithm);
+		uint64_t tsig_begin = query_phases_begin();
 		if (ctx->pkt_count == 0) {
 			ret = knot_tsig_sign(pkt->wire, &pkt->size, pkt->max_size,
 			                     ctx->tsig_digest, ctx->tsig_digestlen,
@@ -909,6 +1086,7 @@ int process_query_sign_response(knot_pkt_t *pkt, knotd_qdata_t *qdata)
 			                          &ctx->tsig_key,
 			                          pkt->wire, pkt->size);
 		}
+		query_phases_end(QUERY_PHASE_TSIG, tsig_begin);
 		if (ret != KNOT_EOK) {
 			goto fail; /* Failed to sign. */
 		} else {
@@ -997,27 +1175,23 @@ int process_query_put_rr(knot_pkt_t *pkt, knotd_qdata_t *qdata,
 	/* If we already have compressed name on the wire and compression hint,
 	 * we can just insert RRSet and fake synthesis by using compression
 	 * hint. */
-	knot_rrset_t to_add;
-	if (compr_hint == KNOT_COMPR_HINT_NONE && expand) {
-		knot_dname_t *qname_cpy = knot_dname_copy(qdata->name, &pkt->mm);
-		if (qname_cpy == NULL) {
-			return KNOT_ENOMEM;
-		}
-		knot_rrset_init(&to_add, qname_cpy, rr->type, rr->rclass, rr->ttl);
-		ret = knot_rdataset_copy(&to_add.rrs, &rr->rrs, &pkt->mm);
-		if (ret != KNOT_EOK) {
-			knot_dname_free(qname_cpy, &pkt->mm);
-			return ret;
-		}
-		to_add.additional = rr->additional;
-		flags |= KNOT_PF_FREE;
-	} else {
-		to_add = *rr;
+	knot_rrset_t to_add = *rr;
+	if (compr_hint == KNOT_COMPR_HINT_NONE && expand && !(flags & KNOT_PF_FREE)) {
+		/* No copying, the name outlives the response and the RDATA is
+		 * written directly from the zone. A synthesized RRSet to be freed
+		 * already has the expanded owner. */
+		to_add.owner = (knot_dname_t *)qdata->name;
 	}
 
 	uint16_t rotate = conf()->cache.srv_ans_rotate ? knot_wire_get_id(qdata->query->wire) : 0;
 	uint16_t prev_count = pkt->rrset_count;
-	ret = knot_pkt_put_rotate(pkt, compr_hint, &to_add, rotate, flags);
+	const uint8_t *prerendered = additional_wire(&to_add);
+	if (prerendered != NULL) {
+		ret = knot_pkt_put_prerendered(pkt, compr_hint, &to_add, prerendered,
+		                               rotate, flags);
+	} else {
+		ret = knot_pkt_put_rotate(pkt, compr_hint, &to_add, rotate, flags);
+	}
 	if (ret != KNOT_EOK && (flags & KNOT_PF_FREE)) {
 		knot_rrset_clear(&to_add, &pkt->mm);
 		return ret;
@@ -1052,7 +1226,7 @@ knotd_proto_state_t process_query_proto(knotd_qdata_params_t *params,
 	struct query_plan *plan = conf()->query_plan;
 	if (plan != NULL) {
 		struct query_step *step;
-		WALK_LIST(step, plan->stage[stage]) {
+		QUERY_PLAN_FOREACH(plan, stage, step) {
 			assert(step->type == QUERY_HOOK_TYPE_PROTO);
 			state = step->proto_hook(state, params, step->ctx);
 		}
@@ -1063,6 +1237,38 @@ knotd_proto_state_t process_query_proto(knotd_qdata_params_t *params,
 	return state;
 }
 
+bool process_query_batch_enabled(void)
+{
+	rcu_read_lock();
+	struct query_plan *plan = conf()->query_plan;
+	bool enabled = (plan != NULL && plan->batch.count > 0);
+	rcu_read_unlock();
+
+	return enabled;
+}
+
+void process_query_batch(knotd_batch_item_t *items, unsigned count)
+{
+	assert(items || count == 0);
+
+	if (count == 0) {
+		return;
+	}
+
+	rcu_read_lock();
+
+	struct query_plan *plan = conf()->query_plan;
+	if (plan != NULL) {
+		struct query_step *step;
+		QUERY_PLAN_FOREACH_BATCH(plan, step) {
+			assert(step->type == QUERY_HOOK_TYPE_BATCH);
+			step->batch_hook(items, count, step->ctx);
+		}
+	}
+
+	rcu_read_unlock();
+}
+
 /*! \brief Module implementation. */
 const knot_layer_api_t *process_query_layer(void)
 {
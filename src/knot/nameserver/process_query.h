@@ -24,11 +24,32 @@
 /* Query processing module implementation. */
 const knot_layer_api_t *process_query_layer(void);
 
+/*! \brief Point to resume the suspended query processing at. */
+typedef struct {
+	const struct query_plan *plan; /*!< Query plan of the suspended hook. */
+	unsigned step;                 /*!< Index of the suspended BEGIN step. */
+	knotd_mod_hook_f hook;         /*!< Suspended hook (plan change detection). */
+	void *ctx;                     /*!< Suspended hook context. */
+	knotd_state_t state;           /*!< Result of the suspended hook. */
+	bool set;                      /*!< The query is being resumed. */
+} query_resume_t;
+
+/*! \brief Maximum number of visited wildcards, bounded by the CNAME chain limit. */
+#define WILDCARD_HITS_MAX 12
+
+/*! \brief Visited wildcard node. */
+struct wildcard_hit {
+	const zone_node_t *node;   /* Visited node. */
+	const zone_node_t *prev;   /* Previous node from the SNAME. */
+	const knot_dname_t *sname; /* Name leading to this node. */
+};
+
 /*! \brief Query processing intermediate data. */
 typedef struct knotd_qdata_extra {
 	zone_t *zone;        /*!< Zone from which is answered. */
 	const zone_contents_t *contents; /*!< Zone contents from which is answered. */
-	list_t wildcards;    /*!< Visited wildcards. */
+	struct wildcard_hit wildcards[WILDCARD_HITS_MAX]; /*!< Visited wildcards. */
+	unsigned wildcard_count; /*!< Number of visited wildcards. */
 	list_t rrsigs;       /*!< Section RRSIGs. */
 	uint8_t *opt_rr_pos; /*!< Place of the OPT RR in wire. */
 
@@ -36,6 +57,13 @@ typedef struct knotd_qdata_extra {
 	const zone_node_t *node, *encloser, *previous;
 
 	uint8_t cname_chain; /*!< Length of the CNAME chain so far. */
+	const zone_node_t *follow_node; /*!< Precomputed node of the followed CNAME target. */
+	bool minimal;        /*!< Omit optional records, the client is truncation-prone. */
+	bool volatile_answer; /*!< The response may differ for the same query (not cacheable). */
+
+	/* Suspended processing. */
+	knotd_suspended_t *suspended; /*!< Handle of the query being suspended. */
+	query_resume_t resume;        /*!< Resume point if resumed. */
 
 	/* Extensions. */
 	void *ext;
@@ -43,14 +71,6 @@ typedef struct knotd_qdata_extra {
 	void (*ext_finished)(knotd_qdata_t *, knot_pkt_t *, int); /*!< Optional postprocessing callback. */
 } knotd_qdata_extra_t;
 
-/*! \brief Visited wildcard node list. */
-struct wildcard_hit {
-	node_t n;
-	const zone_node_t *node;   /* Visited node. */
-	const zone_node_t *prev;   /* Previous node from the SNAME. */
-	const knot_dname_t *sname; /* Name leading to this node. */
-};
-
 /*! \brief RRSIG info node list. */
 struct rrsig_info {
 	node_t n;
@@ -107,6 +127,19 @@ int process_query_put_rr(knot_pkt_t *pkt, knotd_qdata_t *qdata,
                          const knot_rrset_t *rr, const knot_rrset_t *rrsigs,
                          uint16_t compr_hint, uint32_t flags);
 
+/*!
+ * \brief Checks if any global module has a batch callback.
+ */
+bool process_query_batch_enabled(void);
+
+/*!
+ * \brief Processes all global module batch callbacks.
+ *
+ * \param items   Received queries with initialized parameters and states.
+ * \param count   Number of queries.
+ */
+void process_query_batch(knotd_batch_item_t *items, unsigned count);
+
 /*!
  * \brief Processes all global module protocol callbacks at given stage.
  *
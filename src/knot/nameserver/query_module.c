@@ -20,6 +20,8 @@
 #include <stdlib.h>
 #include <string.h>
 
+#include "contrib/addr_set.h"
+#include "contrib/macros.h"
 #include "contrib/sockaddr.h"
 #include "libknot/attribute.h"
 #include "libknot/probe/data.h"
@@ -31,6 +33,8 @@
 #include "knot/dnssec/zone-sign.h"
 #include "knot/nameserver/query_module.h"
 #include "knot/nameserver/process_query.h"
+#include "knot/nameserver/query_phases.h"
+#include "knot/server/suspend.h"
 
 _public_
 int knotd_conf_check_ref(knotd_conf_check_args_t *args)
@@ -40,16 +44,7 @@ int knotd_conf_check_ref(knotd_conf_check_args_t *args)
 
 struct query_plan *query_plan_create(void)
 {
-	struct query_plan *plan = malloc(sizeof(struct query_plan));
-	if (plan == NULL) {
-		return NULL;
-	}
-
-	for (unsigned i = 0; i < KNOTD_STAGES; ++i) {
-		init_list(&plan->stage[i]);
-	}
-
-	return plan;
+	return calloc(1, sizeof(struct query_plan));
 }
 
 void query_plan_free(struct query_plan *plan)
@@ -59,11 +54,9 @@ void query_plan_free(struct query_plan *plan)
 	}
 
 	for (unsigned i = 0; i < KNOTD_STAGES; ++i) {
-		struct query_step *step, *next;
-		WALK_LIST_DELSAFE(step, next, plan->stage[i]) {
-			free(step);
-		}
+		free(plan->stage[i].steps);
 	}
+	free(plan->batch.steps);
 
 	free(plan);
 }
@@ -71,16 +64,46 @@ void query_plan_free(struct query_plan *plan)
 int query_plan_step(struct query_plan *plan, knotd_stage_t stage,
                     query_hook_type_t type, void *hook, void *ctx)
 {
-	struct query_step *step = calloc(1, sizeof(*step));
-	if (step == NULL) {
+	struct query_stage *st = (type == QUERY_HOOK_TYPE_BATCH) ? &plan->batch :
+	                                                           &plan->stage[stage];
+
+	struct query_step *steps = realloc(st->steps, (st->count + 1) * sizeof(*steps));
+	if (steps == NULL) {
 		return KNOT_ENOMEM;
 	}
 
-	step->type = type;
-	step->general_hook = hook;
-	step->ctx = ctx;
+	steps[st->count] = (struct query_step) {
+		.type = type,
+		.general_hook = hook,
+		.ctx = ctx,
+	};
+	st->steps = steps;
+	st->count++;
 
-	add_tail(&plan->stage[stage], &step->node);
+	return KNOT_EOK;
+}
+
+int query_plan_merge(struct query_plan *plan, const struct query_plan *from)
+{
+	for (unsigned i = 0; i < KNOTD_STAGES; ++i) {
+		const struct query_stage *st = &from->stage[i];
+		for (unsigned j = 0; j < st->count; j++) {
+			int ret = query_plan_step(plan, i, st->steps[j].type,
+			                          st->steps[j].general_hook, st->steps[j].ctx);
+			if (ret != KNOT_EOK) {
+				return ret;
+			}
+		}
+	}
+
+	for (unsigned j = 0; j < from->batch.count; j++) {
+		int ret = query_plan_step(plan, KNOTD_STAGE_PROTO_BEGIN, QUERY_HOOK_TYPE_BATCH,
+		                          from->batch.steps[j].general_hook,
+		                          from->batch.steps[j].ctx);
+		if (ret != KNOT_EOK) {
+			return ret;
+		}
+	}
 
 	return KNOT_EOK;
 }
@@ -116,6 +139,13 @@ int knotd_mod_in_hook(knotd_mod_t *mod, knotd_stage_t stage, knotd_mod_in_hook_f
 	return query_plan_step(mod->plan, stage, QUERY_HOOK_TYPE_IN, hook, mod);
 }
 
+_public_
+int knotd_mod_batch_hook(knotd_mod_t *mod, knotd_mod_batch_hook_f hook)
+{
+	return query_plan_step(mod->plan, KNOTD_STAGE_PROTO_BEGIN,
+	                       QUERY_HOOK_TYPE_BATCH, hook, mod);
+}
+
 knotd_mod_t *query_module_open(conf_t *conf, server_t *server, conf_mod_id_t *mod_id,
                                struct query_plan *plan, const knot_dname_t *zone)
 {
@@ -142,6 +172,7 @@ knotd_mod_t *query_module_open(conf_t *conf, server_t *server, conf_mod_id_t *mo
 	module->zone = zone;
 	module->id = mod_id;
 	module->api = mod->api;
+	module->phase_slot = query_phases_module(mod->api->name);
 
 	return module;
 }
@@ -177,12 +208,20 @@ static void module_reset(conf_t *conf, knotd_mod_t *module, struct query_plan *n
 	// Keep ->ctx
 }
 
+static void shared_release(knotd_mod_t *shared);
+
 void query_module_close(knotd_mod_t *module)
 {
 	if (module == NULL) {
 		return;
 	}
 
+	if (module->shared != NULL) {
+		shared_release(module->shared);
+	} else if (module->shared_instance) {
+		query_plan_free(module->plan);
+	}
+
 	module_reset(NULL, module, NULL);
 	conf_free_mod_id(module->id);
 	free(module);
@@ -197,6 +236,157 @@ void query_module_reset(conf_t *conf, knotd_mod_t *module, struct query_plan *ne
 	module_reset(conf, module, new_plan);
 }
 
+static uint64_t mod_conf_hash(conf_t *conf, const knotd_mod_t *module)
+{
+	// FNV-1a over the explicit module configuration values.
+	uint64_t hash = 14695981039346656037LLU;
+	for (const yp_item_t *item = module->api->config;
+	     item != NULL && item->name != NULL; item++) {
+		conf_val_t val = conf_mod_get(conf, item->name, module->id);
+		if (val.code != KNOT_EOK) {
+			continue;
+		}
+		const uint8_t *name = (const uint8_t *)item->name;
+		for (size_t i = 0; i <= name[0]; i++) {
+			hash = (hash ^ name[i]) * 1099511628211LLU;
+		}
+		for (size_t i = 0; i < val.blob_len; i++) {
+			hash = (hash ^ val.blob[i]) * 1099511628211LLU;
+		}
+	}
+
+	return hash;
+}
+
+static bool mod_id_equal(const conf_mod_id_t *a, const conf_mod_id_t *b)
+{
+	return a->name[0] == b->name[0] && a->len == b->len &&
+	       memcmp(a->name, b->name, 1 + a->name[0]) == 0 &&
+	       memcmp(a->data, b->data, a->len) == 0;
+}
+
+static conf_mod_id_t *mod_id_copy(const conf_mod_id_t *id)
+{
+	conf_mod_id_t *copy = calloc(1, sizeof(*copy));
+	if (copy == NULL) {
+		return NULL;
+	}
+
+	size_t name_len = 1 + id->name[0];
+	copy->name = malloc(name_len + 1);
+	copy->data = malloc(MAX(id->len, 1));
+	if (copy->name == NULL || copy->data == NULL) {
+		conf_free_mod_id(copy);
+		return NULL;
+	}
+	memcpy(copy->name, id->name, name_len + 1);
+	memcpy(copy->data, id->data, id->len);
+	copy->len = id->len;
+
+	return copy;
+}
+
+static knotd_mod_t *shared_load(conf_t *conf, const knotd_mod_t *module,
+                                uint64_t hash, int *ret)
+{
+	struct query_plan *plan = query_plan_create();
+	conf_mod_id_t *id = mod_id_copy(module->id);
+	knotd_mod_t *shared = NULL;
+	if (plan == NULL || id == NULL ||
+	    (shared = query_module_open(conf, module->server, id, plan,
+	                                (const knot_dname_t *)"")) == NULL) {
+		query_plan_free(plan);
+		conf_free_mod_id(id);
+		*ret = KNOT_ENOMEM;
+		return NULL;
+	}
+	shared->shared_instance = true;
+	shared->shared_hash = hash;
+
+	*ret = shared->api->load(shared);
+	if (*ret != KNOT_EOK) {
+		query_module_close(shared);
+		return NULL;
+	}
+	shared->config = NULL; // Invalidate the current config.
+
+	return shared;
+}
+
+static void shared_unload(knotd_mod_t *shared)
+{
+	if (shared->api->unload != NULL) {
+		shared->api->unload(shared);
+	}
+	query_module_close(shared);
+}
+
+static void shared_release(knotd_mod_t *shared)
+{
+	server_t *server = shared->server;
+
+	pthread_mutex_lock(&server->shared_mods.lock);
+	assert(shared->shared_refs > 0);
+	bool last = (--shared->shared_refs == 0);
+	if (last) {
+		rem_node(&shared->node);
+	}
+	pthread_mutex_unlock(&server->shared_mods.lock);
+
+	if (last) {
+		shared_unload(shared);
+	}
+}
+
+int query_module_share(conf_t *conf, knotd_mod_t *module)
+{
+	if (conf == NULL || module == NULL || module->shared != NULL) {
+		return KNOT_EINVAL;
+	}
+
+	server_t *server = module->server;
+	uint64_t hash = mod_conf_hash(conf, module);
+	int ret = KNOT_EOK;
+
+	pthread_mutex_lock(&server->shared_mods.lock);
+
+	knotd_mod_t *shared = NULL, *it;
+	WALK_LIST(it, server->shared_mods.list) {
+		if (it->api == module->api && it->shared_hash == hash &&
+		    mod_id_equal(it->id, module->id)) {
+			shared = it;
+			break;
+		}
+	}
+
+	bool created = false;
+	if (shared == NULL) {
+		shared = shared_load(conf, module, hash, &ret);
+		if (shared == NULL) {
+			pthread_mutex_unlock(&server->shared_mods.lock);
+			return ret;
+		}
+		add_tail(&server->shared_mods.list, &shared->node);
+		created = true;
+	}
+
+	ret = query_plan_merge(module->plan, shared->plan);
+	if (ret == KNOT_EOK) {
+		shared->shared_refs++;
+		module->shared = shared;
+	} else if (created) {
+		rem_node(&shared->node);
+	}
+
+	pthread_mutex_unlock(&server->shared_mods.lock);
+
+	if (ret != KNOT_EOK && created) {
+		shared_unload(shared);
+	}
+
+	return ret;
+}
+
 _public_
 void *knotd_mod_ctx(const knotd_mod_t *mod)
 {
@@ -241,7 +431,7 @@ void knotd_mod_vlog(knotd_mod_t *mod, int priority, const char *fmt, va_list arg
 		mod_id->name + 1, (mod_id->len > 0) ? "/" : "", (int)mod_id->len, \
 		mod_id->data, msg
 
-	if (mod->zone == NULL) {
+	if (mod->zone == NULL || mod->shared_instance) {
 		log_fmt(priority, LOG_SOURCE_SERVER, LOG_ARGS(mod->id, msg));
 	} else {
 		log_fmt_zone(priority, LOG_SOURCE_ZONE, mod->zone, NULL,
@@ -251,6 +441,33 @@ void knotd_mod_vlog(knotd_mod_t *mod, int priority, const char *fmt, va_list arg
 	#undef LOG_ARGS
 }
 
+// Per-thread counter blocks are padded to avoid false sharing among threads.
+#define STATS_ALIGN	64
+
+static knot_atomic_uint64_t *alloc_vals(knot_atomic_uint64_t *old_vals,
+                                        uint32_t old_count, uint32_t new_count)
+{
+	size_t size = new_count * sizeof(knot_atomic_uint64_t);
+	size = (size + STATS_ALIGN - 1) / STATS_ALIGN * STATS_ALIGN;
+
+	knot_atomic_uint64_t *vals;
+	if (posix_memalign((void **)&vals, STATS_ALIGN, size) != 0) {
+		return NULL;
+	}
+	memset(vals, 0, size);
+
+	for (uint32_t i = 0; i < old_count; i++) {
+		ATOMIC_INIT(vals[i], ATOMIC_GET(old_vals[i]));
+		ATOMIC_DEINIT(old_vals[i]);
+	}
+	for (uint32_t i = old_count; i < new_count; i++) {
+		ATOMIC_INIT(vals[i], 0);
+	}
+	free(old_vals);
+
+	return vals;
+}
+
 static void clean_vals(knot_atomic_uint64_t **stats_vals, unsigned dirty_threads,
                        uint32_t offset, uint32_t count)
 {
@@ -292,16 +509,12 @@ int knotd_mod_stats_add(knotd_mod_t *mod, const char *ctr_name, uint32_t idx_cou
 		}
 
 		for (unsigned i = 0; i < threads; i++) {
-			mod->stats_vals[i] = calloc(idx_count, sizeof(**mod->stats_vals));
+			mod->stats_vals[i] = alloc_vals(NULL, 0, idx_count);
 			if (mod->stats_vals[i] == NULL) {
 				clean_vals(mod->stats_vals, i, 0, idx_count);
 				knotd_mod_stats_free(mod);
 				return KNOT_ENOMEM;
 			}
-
-			for (unsigned j = 0; j < idx_count; j++) {
-				ATOMIC_INIT(mod->stats_vals[i][j], 0);
-			}
 		}
 	} else {
 		for (uint32_t i = 0; i < mod->stats_count; i++) {
@@ -322,18 +535,14 @@ int knotd_mod_stats_add(knotd_mod_t *mod, const char *ctr_name, uint32_t idx_cou
 		stats += mod->stats_count;
 
 		for (unsigned i = 0; i < threads; i++) {
-			knot_atomic_uint64_t *new_vals = realloc(mod->stats_vals[i],
-			                                 (offset + idx_count) * sizeof(*new_vals));
+			knot_atomic_uint64_t *new_vals = alloc_vals(mod->stats_vals[i],
+			                                            offset, offset + idx_count);
 			if (new_vals == NULL) {
 				clean_vals(mod->stats_vals, i, offset, idx_count);
 				knotd_mod_stats_free(mod);
 				return KNOT_ENOMEM;
 			}
 			mod->stats_vals[i] = new_vals;
-
-			for (unsigned j = 0; j < idx_count; j++) {
-				ATOMIC_INIT(mod->stats_vals[i][offset + j], 0);
-			}
 		}
 	}
 
@@ -341,12 +550,31 @@ int knotd_mod_stats_add(knotd_mod_t *mod, const char *ctr_name, uint32_t idx_cou
 	stats->count = idx_count;
 	stats->idx_to_str = idx_to_str;
 	stats->offset = offset;
+	stats->dump = NULL;
 
 	mod->stats_count++;
 
 	return KNOT_EOK;
 }
 
+_public_
+int knotd_mod_stats_add_dynamic(knotd_mod_t *mod, const char *ctr_name,
+                                knotd_mod_stats_dump_f dump)
+{
+	if (dump == NULL) {
+		return KNOT_EINVAL;
+	}
+
+	int ret = knotd_mod_stats_add(mod, ctr_name, 1, NULL);
+	if (ret != KNOT_EOK) {
+		return ret;
+	}
+
+	mod->stats_info[mod->stats_count - 1].dump = dump;
+
+	return KNOT_EOK;
+}
+
 _public_
 void knotd_mod_stats_free(knotd_mod_t *mod)
 {
@@ -369,6 +597,13 @@ void knotd_mod_stats_free(knotd_mod_t *mod)
 	free(mod->stats_info);
 }
 
+/*
+ * Counters of a thread are only modified by the thread itself, so plain
+ * (relaxed) stores suffice. Other threads just read them when dumping.
+ */
+#define STATS_ADD(dst, val)	ATOMIC_SET(dst, ATOMIC_GET(dst) + (val))
+#define STATS_SUB(dst, val)	ATOMIC_SET(dst, ATOMIC_GET(dst) - (val))
+
 #define STATS_BODY(OPERATION) { \
 	if (mod == NULL) return; \
 	\
@@ -381,14 +616,14 @@ _public_
 void knotd_mod_stats_incr(knotd_mod_t *mod, unsigned thr_id, uint32_t ctr_id,
                           uint32_t idx, uint64_t val)
 {
-	STATS_BODY(ATOMIC_ADD)
+	STATS_BODY(STATS_ADD)
 }
 
 _public_
 void knotd_mod_stats_decr(knotd_mod_t *mod, unsigned thr_id, uint32_t ctr_id,
                           uint32_t idx, uint64_t val)
 {
-	STATS_BODY(ATOMIC_SUB)
+	STATS_BODY(STATS_SUB)
 }
 
 _public_
@@ -398,6 +633,32 @@ void knotd_mod_stats_store(knotd_mod_t *mod, unsigned thr_id, uint32_t ctr_id,
 	STATS_BODY(ATOMIC_SET)
 }
 
+_public_
+int knotd_mod_query_phases_enable(knotd_mod_t *mod, unsigned sample)
+{
+	if (mod == NULL) {
+		return KNOT_EINVAL;
+	}
+
+	return query_phases_enable(knotd_mod_threads(mod), sample);
+}
+
+_public_
+void knotd_mod_query_phases_disable(knotd_mod_t *mod)
+{
+	if (mod == NULL) {
+		return;
+	}
+
+	query_phases_disable();
+}
+
+_public_
+int knotd_mod_query_phases_dump(knotd_mod_stats_item_f item, void *data)
+{
+	return query_phases_dump(item, data);
+}
+
 _public_
 knotd_conf_t knotd_conf_env(knotd_mod_t *mod, knotd_conf_env_t env)
 {
@@ -618,6 +879,50 @@ bool knotd_conf_addr_range_match(const knotd_conf_t *range,
 	return false;
 }
 
+_public_
+knotd_addr_set_t *knotd_conf_addr_set(const knotd_conf_t *range)
+{
+	if (range == NULL) {
+		return NULL;
+	}
+
+	addr_set_t *set = addr_set_new();
+	if (set == NULL) {
+		return NULL;
+	}
+
+	for (size_t i = 0; i < range->count; i++) {
+		const knotd_conf_val_t *val = (range->count == 1 && range->multi == NULL) ?
+		                              &range->single : &range->multi[i];
+		int ret;
+		if (val->addr_max.ss_family == AF_UNSPEC) {
+			ret = addr_set_add_net(set, &val->addr, val->addr_mask);
+		} else {
+			ret = addr_set_add_range(set, &val->addr, &val->addr_max);
+		}
+		if (ret != KNOT_EOK && ret != KNOT_ENOTSUP) { // Ignore UNIX sockets.
+			addr_set_free(set);
+			return NULL;
+		}
+	}
+	addr_set_build(set);
+
+	return (knotd_addr_set_t *)set;
+}
+
+_public_
+bool knotd_addr_set_match(const knotd_addr_set_t *set,
+                          const struct sockaddr_storage *addr)
+{
+	return addr_set_match((const addr_set_t *)set, addr);
+}
+
+_public_
+void knotd_addr_set_free(knotd_addr_set_t *set)
+{
+	addr_set_free((addr_set_t *)set);
+}
+
 _public_
 void knotd_conf_free(knotd_conf_t *conf)
 {
@@ -715,6 +1020,41 @@ int knotd_qdata_zone_rrset(const knotd_qdata_t *qdata, const knot_dname_t *zone_
 	return KNOT_EOK;
 }
 
+_public_
+knotd_suspended_t *knotd_qdata_yield(knotd_qdata_t *qdata)
+{
+	if (qdata == NULL || qdata->params->suspend == NULL ||
+	    qdata->params->xdp_msg != NULL ||
+	    (qdata->params->flags & KNOTD_QUERY_FLAG_PROXIED) ||
+	    qdata->extra->suspended != NULL) {
+		return NULL;
+	}
+
+	qdata->extra->suspended = suspend_query(qdata->params->suspend, qdata);
+
+	return qdata->extra->suspended;
+}
+
+_public_
+knotd_qdata_t *knotd_suspended_qdata(knotd_suspended_t *handle)
+{
+	if (handle == NULL) {
+		return NULL;
+	}
+
+	return suspend_qdata(handle);
+}
+
+_public_
+void knotd_qdata_resume(knotd_suspended_t *handle, knotd_state_t state)
+{
+	if (handle == NULL) {
+		return;
+	}
+
+	suspend_resume(handle, state);
+}
+
 _public_
 int knotd_mod_dnssec_init(knotd_mod_t *mod)
 {
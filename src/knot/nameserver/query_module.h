@@ -31,28 +31,49 @@ typedef enum {
 	QUERY_HOOK_TYPE_PROTO,
 	QUERY_HOOK_TYPE_GENERAL,
 	QUERY_HOOK_TYPE_IN,
+	QUERY_HOOK_TYPE_BATCH,
 } query_hook_type_t;
 
 /*! \brief Single processing step in query/module processing. */
 struct query_step {
-	node_t node;
 	query_hook_type_t type;
 	union {
 		knotd_mod_proto_hook_f proto_hook;
 		knotd_mod_hook_f general_hook;
 		knotd_mod_in_hook_f in_hook;
+		knotd_mod_batch_hook_f batch_hook;
 	};
 	void *ctx;
 };
 
+/*! \brief Flat array of steps planned for one stage. */
+struct query_stage {
+	struct query_step *steps;
+	unsigned count;
+};
+
 /*! Query plan represents a sequence of steps needed for query processing
  *  divided into several stages, where each stage represents a current response
  *  assembly phase, for example 'before processing', 'answer section' and so on.
+ *
+ *  The steps are stored in contiguous arrays, which are only appended to
+ *  before the plan is published, so the query path just iterates them.
  */
 struct query_plan {
-	list_t stage[KNOTD_STAGES];
+	struct query_stage stage[KNOTD_STAGES];
+	struct query_stage batch; /*!< Batch hooks, preceding KNOTD_STAGE_PROTO_BEGIN. */
 };
 
+/*! \brief Iterate over the steps of the given plan stage. */
+#define QUERY_PLAN_FOREACH(plan, st, step) \
+	for (step = (plan)->stage[st].steps; \
+	     step < (plan)->stage[st].steps + (plan)->stage[st].count; step++)
+
+/*! \brief Iterate over the batch steps of the given plan. */
+#define QUERY_PLAN_FOREACH_BATCH(plan, step) \
+	for (step = (plan)->batch.steps; \
+	     step < (plan)->batch.steps + (plan)->batch.count; step++)
+
 /*! \brief Create an empty query plan. */
 struct query_plan *query_plan_create(void);
 
@@ -63,6 +84,8 @@ void query_plan_free(struct query_plan *plan);
 int query_plan_step(struct query_plan *plan, knotd_stage_t stage,
                     query_hook_type_t type, void *hook, void *ctx);
 
+int query_plan_merge(struct query_plan *plan, const struct query_plan *from);
+
 /*! \brief Open query module identified by name. */
 knotd_mod_t *query_module_open(conf_t *conf, server_t *server, conf_mod_id_t *mod_id,
                                struct query_plan *plan, const knot_dname_t *zone);
@@ -73,6 +96,14 @@ void query_module_close(knotd_mod_t *module);
 /*! \brief Close and open existing query module. */
 void query_module_reset(conf_t *conf, knotd_mod_t *module, struct query_plan *new_plan);
 
+/*!
+ * \brief Loads the zone module by referencing a shared instance of the same
+ *        module configuration, which is created and loaded if not available.
+ *
+ * \note The hooks of the shared instance are added to the module plan.
+ */
+int query_module_share(conf_t *conf, knotd_mod_t *module);
+
 typedef char* (*mod_idx_to_str_f)(uint32_t idx, uint32_t count);
 
 typedef struct {
@@ -80,6 +111,7 @@ typedef struct {
 	mod_idx_to_str_f idx_to_str; // unused if count == 1
 	uint32_t offset; // offset of counters in stats_vals[thread_id]
 	uint32_t count;
+	knotd_mod_stats_dump_f dump; // dynamic counter items if not NULL
 } mod_ctr_t;
 
 struct knotd_mod {
@@ -97,6 +129,11 @@ struct knotd_mod {
 	knot_atomic_uint64_t **stats_vals;
 	uint32_t stats_count;
 	void *ctx;
+	knotd_mod_t *shared;     // Referenced shared instance (zone module only).
+	bool shared_instance;    // The module is a shared instance.
+	unsigned shared_refs;    // Number of zone modules referencing the instance.
+	uint64_t shared_hash;    // Module configuration hash of the instance.
+	unsigned phase_slot;     // Query phases accounting slot.
 };
 
 void knotd_mod_stats_free(knotd_mod_t *mod);
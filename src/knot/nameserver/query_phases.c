@@ -0,0 +1,271 @@
+/*  Copyright (C) 2024 CZ.NIC, z.s.p.o. <knot-dns@labs.nic.cz>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "knot/nameserver/query_phases.h"
+#include "contrib/atomic.h"
+#include "contrib/macros.h"
+#include "libknot/error.h"
+
+/*
+ * Log-linear histogram: exact values below 4, then 4 buckets per power of two
+ * up to 2^40 cycles, the last bucket is unbounded.
+ */
+#define HIST_LINEAR	4
+#define HIST_MAX_EXP	40
+#define HIST_BUCKETS	(HIST_LINEAR + (HIST_MAX_EXP - 2) * 4 + 1)
+
+#define SLOTS		(QUERY_PHASE__COUNT + QUERY_PHASES_MODULES)
+
+typedef struct {
+	_Alignas(64)
+	knot_atomic_uint64_t hist[SLOTS][HIST_BUCKETS];
+	knot_atomic_uint64_t sum[SLOTS];
+} thread_phases_t;
+
+static struct {
+	thread_phases_t *threads;
+	unsigned count;
+	unsigned refs;
+	knot_atomic_uint64_t sample;
+	knot_atomic_bool active;
+	char *modules[QUERY_PHASES_MODULES];
+	unsigned module_count;
+	pthread_mutex_t lock;
+} query_phases = {
+	.lock = PTHREAD_MUTEX_INITIALIZER
+};
+
+static const char *phase_names[QUERY_PHASE__COUNT] = {
+	[QUERY_PHASE_PARSE]  = "parse",
+	[QUERY_PHASE_ZONE]   = "zone",
+	[QUERY_PHASE_ANSWER] = "answer",
+	[QUERY_PHASE_TSIG]   = "tsig",
+	[QUERY_PHASE_TOTAL]  = "total",
+};
+
+__thread bool query_phases_on;
+__thread uint64_t query_phases_mod_cycles;
+
+static __thread thread_phases_t *thr_phases;
+static __thread uint64_t thr_countdown;
+
+int query_phases_enable(unsigned threads, unsigned sample)
+{
+	pthread_mutex_lock(&query_phases.lock);
+
+	if (query_phases.threads == NULL) {
+		// Allocated once, as the number of workers requires restart.
+		thread_phases_t *phases;
+		size_t size = MAX(threads, 1) * sizeof(*phases);
+		if (posix_memalign((void **)&phases, 64, size) != 0) {
+			pthread_mutex_unlock(&query_phases.lock);
+			return KNOT_ENOMEM;
+		}
+		memset(phases, 0, size);
+
+		query_phases.threads = phases;
+		query_phases.count = threads;
+	}
+
+	query_phases.refs++;
+	ATOMIC_SET(query_phases.sample, MAX(sample, 1));
+	ATOMIC_SET(query_phases.active, true);
+
+	pthread_mutex_unlock(&query_phases.lock);
+
+	return KNOT_EOK;
+}
+
+void query_phases_disable(void)
+{
+	pthread_mutex_lock(&query_phases.lock);
+
+	if (query_phases.refs > 0 && --query_phases.refs == 0) {
+		ATOMIC_SET(query_phases.active, false);
+	}
+
+	pthread_mutex_unlock(&query_phases.lock);
+}
+
+void query_phases_deinit(void)
+{
+	free(query_phases.threads);
+	for (unsigned i = 0; i < query_phases.module_count; i++) {
+		free(query_phases.modules[i]);
+	}
+
+	pthread_mutex_t lock = query_phases.lock;
+	memset(&query_phases, 0, sizeof(query_phases));
+	query_phases.lock = lock;
+}
+
+unsigned query_phases_module(const char *name)
+{
+	pthread_mutex_lock(&query_phases.lock);
+
+	unsigned slot;
+	for (slot = 0; slot < query_phases.module_count; slot++) {
+		if (strcmp(query_phases.modules[slot], name) == 0) {
+			goto found;
+		}
+	}
+
+	// The last slot is shared by the rest of the modules.
+	if (slot == QUERY_PHASES_MODULES) {
+		slot--;
+		goto found;
+	} else if (slot == QUERY_PHASES_MODULES - 1) {
+		name = "other";
+	}
+
+	char *copy = strdup(name);
+	if (copy == NULL) {
+		slot = QUERY_PHASES_MODULES - 1;
+		goto found;
+	}
+	query_phases.modules[slot] = copy;
+	query_phases.module_count++;
+found:
+	pthread_mutex_unlock(&query_phases.lock);
+
+	return slot;
+}
+
+void query_phases_query_begin(unsigned thread_id)
+{
+	if (!ATOMIC_GET(query_phases.active) || thread_id >= query_phases.count ||
+	    ++thr_countdown < ATOMIC_GET(query_phases.sample)) {
+		return;
+	}
+
+	thr_countdown = 0;
+	thr_phases = &query_phases.threads[thread_id];
+	query_phases_mod_cycles = 0;
+	query_phases_on = true;
+}
+
+static unsigned bucket_of(uint64_t value)
+{
+	if (value < HIST_LINEAR) {
+		return value;
+	}
+
+	unsigned exp = 63 - __builtin_clzll(value);
+	if (exp >= HIST_MAX_EXP) {
+		return HIST_BUCKETS - 1;
+	}
+	unsigned sub = (value >> (exp - 2)) & 3;
+	return HIST_LINEAR + (exp - 2) * 4 + sub;
+}
+
+static uint64_t bucket_limit(unsigned bucket)
+{
+	if (bucket < HIST_LINEAR) {
+		return bucket;
+	} else if (bucket == HIST_BUCKETS - 1) {
+		return 1ULL << HIST_MAX_EXP;
+	}
+
+	unsigned exp = (bucket - HIST_LINEAR) / 4 + 2;
+	unsigned sub = (bucket - HIST_LINEAR) % 4;
+	return ((uint64_t)(HIST_LINEAR + sub + 1) << (exp - 2)) - 1;
+}
+
+void query_phases_record(unsigned slot, uint64_t cycles)
+{
+	if (thr_phases == NULL || slot >= SLOTS) {
+		return;
+	}
+
+	// Only the owning thread modifies the values.
+	knot_atomic_uint64_t *ctr = &thr_phases->hist[slot][bucket_of(cycles)];
+	ATOMIC_SET(*ctr, ATOMIC_GET(*ctr) + 1);
+	ctr = &thr_phases->sum[slot];
+	ATOMIC_SET(*ctr, ATOMIC_GET(*ctr) + cycles);
+}
+
+static int dump_slot(unsigned slot, const char *name, bool skip_empty,
+                     query_phases_item_f item, void *data)
+{
+	uint64_t hist[HIST_BUCKETS] = { 0 };
+	uint64_t count = 0, sum = 0;
+	for (unsigned i = 0; i < query_phases.count; i++) {
+		thread_phases_t *phases = &query_phases.threads[i];
+		for (unsigned b = 0; b < HIST_BUCKETS; b++) {
+			uint64_t val = ATOMIC_GET(phases->hist[slot][b]);
+			hist[b] += val;
+			count += val;
+		}
+		sum += ATOMIC_GET(phases->sum[slot]);
+	}
+
+	if (count == 0 && skip_empty) {
+		return KNOT_EOK;
+	}
+
+	static const unsigned percentiles[] = { 50, 90, 99 };
+	uint64_t values[1 + sizeof(percentiles) / sizeof(*percentiles)] = {
+		count > 0 ? sum / count : 0
+	};
+	uint64_t cumul = 0;
+	unsigned bucket = 0;
+	for (unsigned i = 0; i < sizeof(percentiles) / sizeof(*percentiles); i++) {
+		uint64_t rank = (count * percentiles[i] + 99) / 100;
+		while (bucket < HIST_BUCKETS - 1 && cumul + hist[bucket] < rank) {
+			cumul += hist[bucket++];
+		}
+		values[1 + i] = (count > 0) ? bucket_limit(bucket) : 0;
+	}
+
+	char str[64];
+	(void)snprintf(str, sizeof(str), "%s-count", name);
+	int ret = item(str, count, data);
+	(void)snprintf(str, sizeof(str), "%s-mean", name);
+	ret = (ret == KNOT_EOK) ? item(str, values[0], data) : ret;
+	for (unsigned i = 0; i < sizeof(percentiles) / sizeof(*percentiles); i++) {
+		(void)snprintf(str, sizeof(str), "%s-p%u", name, percentiles[i]);
+		ret = (ret == KNOT_EOK) ? item(str, values[1 + i], data) : ret;
+	}
+
+	return ret;
+}
+
+int query_phases_dump(query_phases_item_f item, void *data)
+{
+	if (item == NULL) {
+		return KNOT_EINVAL;
+	}
+
+	pthread_mutex_lock(&query_phases.lock);
+
+	int ret = KNOT_EOK;
+	for (unsigned i = 0; i < QUERY_PHASE__COUNT && ret == KNOT_EOK; i++) {
+		ret = dump_slot(i, phase_names[i], false, item, data);
+	}
+	for (unsigned i = 0; i < query_phases.module_count && ret == KNOT_EOK; i++) {
+		ret = dump_slot(QUERY_PHASE__COUNT + i, query_phases.modules[i],
+		                true, item, data);
+	}
+
+	pthread_mutex_unlock(&query_phases.lock);
+
+	return ret;
+}
@@ -0,0 +1,190 @@
+/*  Copyright (C) 2024 CZ.NIC, z.s.p.o. <knot-dns@labs.nic.cz>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+/*!
+ * \brief Sampled CPU cost accounting of the query processing phases.
+ *
+ * Every N-th query of a worker thread is measured using the CPU cycle counter
+ * (the virtual counter on ARM64, nanoseconds elsewhere). Each worker thread
+ * updates its own histograms, which are summed up only when read.
+ */
+
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <time.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+ #include <x86intrin.h>
+#endif
+
+/*! \brief Number of distinguished query modules, the last one for the rest. */
+#define QUERY_PHASES_MODULES	32
+
+typedef enum {
+	QUERY_PHASE_PARSE,  /*!< Query packet parsing. */
+	QUERY_PHASE_ZONE,   /*!< Zone lookup. */
+	QUERY_PHASE_ANSWER, /*!< Answering, without the module in-stage hooks. */
+	QUERY_PHASE_TSIG,   /*!< TSIG verification and response signing. */
+	QUERY_PHASE_TOTAL,  /*!< Whole response processing, including the modules. */
+	QUERY_PHASE__COUNT
+} query_phase_t;
+
+/*! \brief Set if the current query of the thread is being measured. */
+extern __thread bool query_phases_on;
+
+/*! \brief Cycles spent in the module hooks of the measured query so far. */
+extern __thread uint64_t query_phases_mod_cycles;
+
+/*!
+ * \brief Start measuring, the accounting is shared by all the stats modules.
+ *
+ * \param threads   Number of worker threads (fixed while running).
+ * \param sample    Measure one of 'sample' queries.
+ *
+ * \return KNOT_E*
+ */
+int query_phases_enable(unsigned threads, unsigned sample);
+
+/*!
+ * \brief Stop measuring if not used by another module, the values are kept.
+ */
+void query_phases_disable(void);
+
+/*!
+ * \brief Free the histograms, no worker may be running.
+ */
+void query_phases_deinit(void);
+
+/*!
+ * \brief Get the accounting slot of a query module.
+ *
+ * \param name   Module name (e.g. "mod-rrl").
+ */
+unsigned query_phases_module(const char *name);
+
+/*!
+ * \brief Decide if the next query of the thread is to be measured.
+ */
+void query_phases_query_begin(unsigned thread_id);
+
+/*!
+ * \brief Finish measuring the query of the thread.
+ */
+static inline void query_phases_query_end(void)
+{
+	query_phases_on = false;
+}
+
+/*!
+ * \brief Read the cycle counter.
+ */
+static inline uint64_t query_phases_now(void)
+{
+#if defined(__x86_64__) || defined(__i386__)
+	return __rdtsc();
+#elif defined(__aarch64__)
+	uint64_t val;
+	__asm__ volatile("mrs %0, cntvct_el0" : "=r" (val));
+	return val;
+#else
+	struct timespec now;
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return now.tv_sec * 1000000000ULL + now.tv_nsec;
+#endif
+}
+
+/*!
+ * \brief Get the phase start if the query is being measured, zero otherwise.
+ */
+static inline uint64_t query_phases_begin(void)
+{
+	return query_phases_on ? query_phases_now() : 0;
+}
+
+/*!
+ * \brief Account a measured phase or module hook (use the inline wrappers).
+ *
+ * \param slot     Phase or QUERY_PHASE__COUNT + module slot.
+ * \param cycles   Spent cycles.
+ */
+void query_phases_record(unsigned slot, uint64_t cycles);
+
+/*!
+ * \brief Get the cycles spent in the module hooks of the measured query so far.
+ */
+static inline uint64_t query_phases_modules(void)
+{
+	return query_phases_mod_cycles;
+}
+
+/*!
+ * \brief Account a phase of the query.
+ *
+ * \param phase   Query processing phase.
+ * \param begin   Phase start, zero if not measured.
+ */
+static inline void query_phases_end(query_phase_t phase, uint64_t begin)
+{
+	if (begin != 0) {
+		query_phases_record(phase, query_phases_now() - begin);
+	}
+}
+
+/*!
+ * \brief Account a phase of the query without the module hooks run within.
+ *
+ * \param phase     Query processing phase.
+ * \param begin     Phase start, zero if not measured.
+ * \param modules   Module cycles at the phase start.
+ */
+static inline void query_phases_end_excl(query_phase_t phase, uint64_t begin,
+                                         uint64_t modules)
+{
+	if (begin != 0) {
+		uint64_t cycles = query_phases_now() - begin;
+		uint64_t excl = query_phases_modules() - modules;
+		query_phases_record(phase, cycles > excl ? cycles - excl : 0);
+	}
+}
+
+/*!
+ * \brief Account a module hook of the query.
+ *
+ * \param module   Module accounting slot.
+ * \param begin    Hook start, zero if not measured.
+ */
+static inline void query_phases_end_module(unsigned module, uint64_t begin)
+{
+	if (begin != 0) {
+		uint64_t cycles = query_phases_now() - begin;
+		query_phases_mod_cycles += cycles;
+		query_phases_record(QUERY_PHASE__COUNT + module, cycles);
+	}
+}
+
+/*!
+ * \brief Accounted value callback.
+ */
+typedef int (*query_phases_item_f)(const char *name, uint64_t val, void *data);
+
+/*!
+ * \brief Dump the number of measurements, mean, and percentiles of each phase and module.
+ *
+ * \return KNOT_E*
+ */
+int query_phases_dump(query_phases_item_f item, void *data);
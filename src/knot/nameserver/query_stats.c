@@ -0,0 +1,202 @@
+/*  Copyright (C) 2024 CZ.NIC, z.s.p.o. <knot-dns@labs.nic.cz>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "knot/nameserver/query_stats.h"
+#include "contrib/atomic.h"
+#include "contrib/macros.h"
+#include "contrib/time.h"
+#include "libknot/error.h"
+
+typedef struct {
+	_Alignas(64)
+	knot_atomic_uint64_t hist[QUERY_STATS_PROTOS][QUERY_STATS_GROUPS][QUERY_HIST_COUNT][QUERY_STATS_BUCKETS];
+	knot_atomic_uint64_t sum[QUERY_STATS_PROTOS][QUERY_STATS_GROUPS][QUERY_HIST_COUNT];
+} thread_stats_t;
+
+static struct {
+	thread_stats_t *threads;
+	unsigned count;
+	knot_atomic_bool active;
+} query_stats;
+
+static const uint64_t bucket_limits[QUERY_HIST_COUNT][QUERY_STATS_BUCKETS] = {
+	[QUERY_HIST_LATENCY] = { 10, 50, 100, 500, 1000, 10000, 100000, UINT64_MAX },
+	[QUERY_HIST_SIZE]    = { 64, 128, 256, 512, 1232, 4096, 16384, UINT64_MAX },
+};
+
+static const char *proto_names[QUERY_STATS_PROTOS] = {
+	[KNOTD_QUERY_PROTO_UDP]  = "udp",
+	[KNOTD_QUERY_PROTO_TCP]  = "tcp",
+	[KNOTD_QUERY_PROTO_QUIC] = "quic",
+	[KNOTD_QUERY_PROTO_TLS]  = "tls",
+};
+
+int query_stats_enable(unsigned threads)
+{
+	if (query_stats.threads == NULL) {
+		// Allocated once, as the number of workers requires restart.
+		thread_stats_t *stats;
+		size_t size = MAX(threads, 1) * sizeof(*stats);
+		if (posix_memalign((void **)&stats, 64, size) != 0) {
+			return KNOT_ENOMEM;
+		}
+		memset(stats, 0, size);
+
+		query_stats.threads = stats;
+		query_stats.count = threads;
+	}
+
+	ATOMIC_SET(query_stats.active, true);
+
+	return KNOT_EOK;
+}
+
+void query_stats_disable(void)
+{
+	ATOMIC_SET(query_stats.active, false);
+}
+
+void query_stats_deinit(void)
+{
+	free(query_stats.threads);
+	memset(&query_stats, 0, sizeof(query_stats));
+}
+
+bool query_stats_active(void)
+{
+	return ATOMIC_GET(query_stats.active);
+}
+
+static unsigned bucket_of(query_hist_t hist, uint64_t value)
+{
+	unsigned bucket = 0;
+	while (value > bucket_limits[hist][bucket]) {
+		bucket++;
+	}
+	return bucket;
+}
+
+static void add(thread_stats_t *stats, knotd_query_proto_t proto, unsigned group,
+                query_hist_t hist, uint64_t value)
+{
+	// Only the owning thread modifies the values.
+	knot_atomic_uint64_t *ctr = &stats->hist[proto][group][hist][bucket_of(hist, value)];
+	ATOMIC_SET(*ctr, ATOMIC_GET(*ctr) + 1);
+	ctr = &stats->sum[proto][group][hist];
+	ATOMIC_SET(*ctr, ATOMIC_GET(*ctr) + value);
+}
+
+void query_stats_record(unsigned thread_id, knotd_query_proto_t proto, unsigned group,
+                        const struct timespec *begin, size_t size)
+{
+	if (thread_id >= query_stats.count || proto >= QUERY_STATS_PROTOS) {
+		return;
+	}
+
+	struct timespec end;
+	clock_gettime(CLOCK_MONOTONIC, &end);
+	struct timespec diff = time_diff(begin, &end);
+	uint64_t usec = diff.tv_sec * 1000000 + diff.tv_nsec / 1000;
+
+	thread_stats_t *stats = &query_stats.threads[thread_id];
+	group = MIN(group, QUERY_STATS_GROUPS - 1);
+	add(stats, proto, group, QUERY_HIST_LATENCY, usec);
+	add(stats, proto, group, QUERY_HIST_SIZE, size);
+}
+
+uint64_t query_stats_bucket(knotd_query_proto_t proto, unsigned group,
+                            query_hist_t hist, unsigned bucket)
+{
+	uint64_t res = 0;
+	for (unsigned i = 0; i < query_stats.count; i++) {
+		res += ATOMIC_GET(query_stats.threads[i].hist[proto][group][hist][bucket]);
+	}
+	return res;
+}
+
+uint64_t query_stats_sum(knotd_query_proto_t proto, unsigned group, query_hist_t hist)
+{
+	uint64_t res = 0;
+	for (unsigned i = 0; i < query_stats.count; i++) {
+		res += ATOMIC_GET(query_stats.threads[i].sum[proto][group][hist]);
+	}
+	return res;
+}
+
+uint64_t query_stats_bucket_limit(query_hist_t hist, unsigned bucket)
+{
+	return bucket_limits[hist][bucket];
+}
+
+const char *query_stats_proto_name(knotd_query_proto_t proto)
+{
+	return proto_names[proto];
+}
+
+static bool is_default(conf_val_t *id)
+{
+	return id->len == CONF_DEFAULT_ID[0] &&
+	       memcmp(id->data, CONF_DEFAULT_ID + 1, id->len) == 0;
+}
+
+unsigned query_stats_zone_group(conf_t *conf, const knot_dname_t *zone)
+{
+	conf_val_t tpl = conf_rawid_get(conf, C_ZONE, C_TPL, zone, knot_dname_size(zone));
+	if (tpl.code != KNOT_EOK) {
+		return 0;
+	}
+	conf_val(&tpl);
+
+	unsigned group = 1;
+	for (conf_iter_t iter = conf_iter(conf, C_TPL); iter.code == KNOT_EOK;
+	     conf_iter_next(conf, &iter)) {
+		conf_val_t id = conf_iter_id(conf, &iter);
+		if (is_default(&id)) {
+			continue;
+		}
+		if (id.len == tpl.len && memcmp(id.data, tpl.data, id.len) == 0) {
+			conf_iter_finish(conf, &iter);
+			return MIN(group, QUERY_STATS_GROUPS - 1);
+		}
+		group++;
+	}
+
+	return 0;
+}
+
+void query_stats_group_names(conf_t *conf, const char *names[QUERY_STATS_GROUPS])
+{
+	memset(names, 0, QUERY_STATS_GROUPS * sizeof(*names));
+	names[0] = "default";
+
+	unsigned group = 1;
+	for (conf_iter_t iter = conf_iter(conf, C_TPL); iter.code == KNOT_EOK;
+	     conf_iter_next(conf, &iter)) {
+		conf_val_t id = conf_iter_id(conf, &iter);
+		if (is_default(&id)) {
+			continue;
+		}
+		if (group == QUERY_STATS_GROUPS - 1) {
+			names[group] = "other";
+			conf_iter_finish(conf, &iter);
+			break;
+		}
+		names[group++] = conf_str(&id);
+	}
+}
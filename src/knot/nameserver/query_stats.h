@@ -0,0 +1,120 @@
+/*  Copyright (C) 2024 CZ.NIC, z.s.p.o. <knot-dns@labs.nic.cz>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+/*!
+ * \brief Latency and response size histograms of processed queries.
+ *
+ * The histograms are kept per transport protocol and per zone group, which is
+ * the template explicitly assigned to the zone. Each worker thread updates its
+ * own cache-line aligned block, which are summed up only when read.
+ */
+
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <time.h>
+
+#include "knot/conf/conf.h"
+#include "knot/include/module.h"
+
+/*! \brief Number of distinguished protocols: UDP, TCP, QUIC, and TLS. */
+#define QUERY_STATS_PROTOS	4
+
+/*! \brief Number of zone groups, the first is the default one, the last one for the rest. */
+#define QUERY_STATS_GROUPS	16
+
+/*! \brief Number of histogram buckets, the last one is unbounded. */
+#define QUERY_STATS_BUCKETS	8
+
+typedef enum {
+	QUERY_HIST_LATENCY, /*!< Processing time in microseconds. */
+	QUERY_HIST_SIZE,    /*!< Response size in bytes. */
+	QUERY_HIST_COUNT
+} query_hist_t;
+
+/*!
+ * \brief Start collecting the histograms.
+ *
+ * \param threads   Number of worker threads (fixed while running).
+ *
+ * \return KNOT_E*
+ */
+int query_stats_enable(unsigned threads);
+
+/*!
+ * \brief Stop collecting the histograms, the collected values are kept.
+ */
+void query_stats_disable(void);
+
+/*!
+ * \brief Free the histograms, no worker may be running.
+ */
+void query_stats_deinit(void);
+
+/*!
+ * \brief Check if the histograms are being collected.
+ */
+bool query_stats_active(void);
+
+/*!
+ * \brief Account a processed query.
+ *
+ * \param thread_id   Calling worker thread.
+ * \param proto       Transport protocol.
+ * \param group       Zone group of the query.
+ * \param begin       Processing start time (CLOCK_MONOTONIC).
+ * \param size        Response size.
+ */
+void query_stats_record(unsigned thread_id, knotd_query_proto_t proto, unsigned group,
+                        const struct timespec *begin, size_t size);
+
+/*!
+ * \brief Get the (non-cumulative) number of queries in a histogram bucket.
+ */
+uint64_t query_stats_bucket(knotd_query_proto_t proto, unsigned group,
+                            query_hist_t hist, unsigned bucket);
+
+/*!
+ * \brief Get the sum of the accounted values.
+ */
+uint64_t query_stats_sum(knotd_query_proto_t proto, unsigned group, query_hist_t hist);
+
+/*!
+ * \brief Get the inclusive upper bound of a bucket (UINT64_MAX for the last one).
+ */
+uint64_t query_stats_bucket_limit(query_hist_t hist, unsigned bucket);
+
+/*!
+ * \brief Get the protocol name.
+ */
+const char *query_stats_proto_name(knotd_query_proto_t proto);
+
+/*!
+ * \brief Get the zone group (index) of a zone.
+ */
+unsigned query_stats_zone_group(conf_t *conf, const knot_dname_t *zone);
+
+/*!
+ * \brief Get the zone group names.
+ *
+ * \note The names are valid as long as the configuration.
+ *
+ * \param conf    Configuration.
+ * \param names   Output: the group names, NULL if the group is unused.
+ */
+void query_stats_group_names(conf_t *conf, const char *names[QUERY_STATS_GROUPS]);
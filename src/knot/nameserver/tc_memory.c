@@ -0,0 +1,115 @@
+/*  Copyright (C) 2024 CZ.NIC, z.s.p.o. <knot-dns@labs.nic.cz>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+
+#include <netinet/in.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "knot/nameserver/tc_memory.h"
+#include "contrib/atomic.h"
+#include "contrib/macros.h"
+#include "contrib/openbsd/siphash.h"
+#include "libdnssec/error.h"
+#include "libdnssec/random.h"
+
+#define TC_MEMORY_SLOTS  16384 /*!< Number of slots in each of the two rows. */
+#define TC_V4_PREFIX     24    /*!< Client prefix length for IPv4. */
+#define TC_V6_PREFIX     56    /*!< Client prefix length for IPv6. */
+#define TC_PRICE         1024  /*!< Load added by one truncated response. */
+#define TC_LIMIT         256   /*!< Load from which a prefix is TC-prone. */
+#define TC_HALF_LIFE_LOG 4     /*!< The load halves every 2^x seconds. */
+
+struct tc_memory {
+	SIPHASH_KEY key;
+	knot_atomic_uint64_t slots[2][TC_MEMORY_SLOTS]; /*!< Time << 32 | load. */
+};
+
+tc_memory_t *tc_memory_new(void)
+{
+	tc_memory_t *mem = calloc(1, sizeof(*mem));
+	if (mem == NULL) {
+		return NULL;
+	}
+
+	if (dnssec_random_buffer((uint8_t *)&mem->key, sizeof(mem->key)) != DNSSEC_EOK) {
+		free(mem);
+		return NULL;
+	}
+
+	return mem;
+}
+
+void tc_memory_free(tc_memory_t *mem)
+{
+	free(mem);
+}
+
+static bool prefix_hash(const tc_memory_t *mem, const struct sockaddr_storage *ss,
+                        uint32_t idx[2])
+{
+	uint8_t key[8] = { ss->ss_family };
+	if (ss->ss_family == AF_INET6) {
+		const struct sockaddr_in6 *sa6 = (const struct sockaddr_in6 *)ss;
+		memcpy(key + 1, &sa6->sin6_addr, TC_V6_PREFIX / 8);
+	} else if (ss->ss_family == AF_INET) {
+		const struct sockaddr_in *sa = (const struct sockaddr_in *)ss;
+		memcpy(key + 1, &sa->sin_addr, TC_V4_PREFIX / 8);
+	} else {
+		return false;
+	}
+
+	uint64_t hash = SipHash24(&mem->key, key, sizeof(key));
+	idx[0] = (uint32_t)hash % TC_MEMORY_SLOTS;
+	idx[1] = (uint32_t)(hash >> 32) % TC_MEMORY_SLOTS;
+
+	return true;
+}
+
+static uint32_t slot_load(uint64_t slot, uint32_t now)
+{
+	uint32_t elapsed = (now - (uint32_t)(slot >> 32)) >> TC_HALF_LIFE_LOG;
+	return (elapsed < 32) ? (uint32_t)slot >> elapsed : 0;
+}
+
+void tc_memory_note(tc_memory_t *mem, const struct sockaddr_storage *remote,
+                    uint32_t now)
+{
+	uint32_t idx[2];
+	if (mem == NULL || !prefix_hash(mem, remote, idx)) {
+		return;
+	}
+
+	// Not atomic as a whole, a concurrently lost charge doesn't matter.
+	for (int row = 0; row < 2; row++) {
+		knot_atomic_uint64_t *slot = &mem->slots[row][idx[row]];
+		uint32_t load = MIN(slot_load(ATOMIC_GET(*slot), now) + TC_PRICE, UINT16_MAX);
+		ATOMIC_SET(*slot, ((uint64_t)now << 32) | load);
+	}
+}
+
+bool tc_memory_prone(tc_memory_t *mem, const struct sockaddr_storage *remote,
+                     uint32_t now)
+{
+	uint32_t idx[2];
+	if (mem == NULL || !prefix_hash(mem, remote, idx)) {
+		return false;
+	}
+
+	// The smaller load is less affected by colliding prefixes.
+	return slot_load(ATOMIC_GET(mem->slots[0][idx[0]]), now) >= TC_LIMIT &&
+	       slot_load(ATOMIC_GET(mem->slots[1][idx[1]]), now) >= TC_LIMIT;
+}
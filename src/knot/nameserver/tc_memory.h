@@ -0,0 +1,67 @@
+/*  Copyright (C) 2024 CZ.NIC, z.s.p.o. <knot-dns@labs.nic.cz>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+
+/*!
+ * \brief Memory of client prefixes recently receiving truncated UDP responses.
+ *
+ * Each truncated response charges the client prefix in a small count-min
+ * sketch of exponentially decaying loads. Prefixes with a high enough load
+ * are answered with minimal responses, so that more of their answers fit
+ * without truncation and a TCP retry.
+ */
+
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <sys/socket.h>
+
+typedef struct tc_memory tc_memory_t;
+
+/*!
+ * \brief Create an empty memory.
+ *
+ * \return Memory or NULL if out of memory.
+ */
+tc_memory_t *tc_memory_new(void);
+
+/*!
+ * \brief Free the memory.
+ */
+void tc_memory_free(tc_memory_t *mem);
+
+/*!
+ * \brief Note a truncated response sent to the client.
+ *
+ * \param mem     Memory (can be NULL).
+ * \param remote  Client address.
+ * \param now     Current time in seconds.
+ */
+void tc_memory_note(tc_memory_t *mem, const struct sockaddr_storage *remote,
+                    uint32_t now);
+
+/*!
+ * \brief Check if the client prefix has recently received truncated responses.
+ *
+ * \param mem     Memory (can be NULL).
+ * \param remote  Client address.
+ * \param now     Current time in seconds.
+ *
+ * \return True if the client should get minimal responses.
+ */
+bool tc_memory_prone(tc_memory_t *mem, const struct sockaddr_storage *remote,
+                     uint32_t now);
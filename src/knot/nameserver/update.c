@@ -95,6 +95,7 @@ static int update_enqueue(zone_t *zone, knotd_qdata_t *qdata)
 	/* Enqueue created request. */
 	ptrlist_add(&zone->ddns_queue, req, NULL);
 	++zone->ddns_queue_size;
+	pthread_cond_signal(&zone->ddns_cond);
 
 	pthread_mutex_unlock(&zone->ddns_lock);
 
@@ -0,0 +1,90 @@
+/*  Copyright (C) 2024 CZ.NIC, z.s.p.o. <knot-dns@labs.nic.cz>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "knot/nameserver/xfr_perf.h"
+#include "contrib/time.h"
+
+xfr_perf_t xfr_perf;
+
+static const char *ctr_names[XFR_PERF_COUNT] = {
+	[XFR_PERF_IN_TRANSFERS]     = "in-transfers",
+	[XFR_PERF_IN_MESSAGES]      = "in-messages",
+	[XFR_PERF_IN_BYTES]         = "in-bytes",
+	[XFR_PERF_IN_RECEIVE_TIME]  = "in-receive-time",
+	[XFR_PERF_IN_RATE]          = "in-last-rate",
+	[XFR_PERF_IN_APPLY_TIME]    = "in-apply-time",
+	[XFR_PERF_IN_SEMCHECK_TIME] = "in-semcheck-time",
+	[XFR_PERF_IN_DIGEST_TIME]   = "in-digest-time",
+	[XFR_PERF_IN_ADJUST_TIME]   = "in-adjust-time",
+	[XFR_PERF_IN_JOURNAL_TIME]  = "in-journal-time",
+	[XFR_PERF_OUT_TRANSFERS]    = "out-transfers",
+	[XFR_PERF_OUT_MESSAGES]     = "out-messages",
+	[XFR_PERF_OUT_BYTES]        = "out-bytes",
+	[XFR_PERF_OUT_SEND_TIME]    = "out-send-time",
+	[XFR_PERF_OUT_RATE]         = "out-last-rate",
+};
+
+void xfr_perf_add(xfr_perf_t *zone_perf, xfr_perf_ctr_t ctr, uint64_t val)
+{
+	ATOMIC_ADD(xfr_perf.ctr[ctr], val);
+	if (zone_perf != NULL) {
+		ATOMIC_ADD(zone_perf->ctr[ctr], val);
+	}
+}
+
+void xfr_perf_time(xfr_perf_t *zone_perf, xfr_perf_ctr_t ctr, const struct timespec *begin)
+{
+	if (zone_perf == NULL) {
+		return;
+	}
+
+	struct timespec end = time_now();
+	xfr_perf_add(zone_perf, ctr, time_diff_ms(begin, &end) * 1000);
+}
+
+void xfr_perf_transfer(xfr_perf_t *zone_perf, bool incoming, uint64_t messages,
+                       uint64_t bytes, const struct timespec *begin,
+                       const struct timespec *end)
+{
+	uint64_t usec = time_diff_ms(begin, end) * 1000;
+	// Sub-millisecond transfers are rated as if lasting one millisecond.
+	uint64_t rate = bytes * 1000000 / (usec > 1000 ? usec : 1000);
+
+	if (incoming) {
+		xfr_perf_add(zone_perf, XFR_PERF_IN_TRANSFERS, 1);
+		xfr_perf_add(zone_perf, XFR_PERF_IN_MESSAGES, messages);
+		xfr_perf_add(zone_perf, XFR_PERF_IN_BYTES, bytes);
+		xfr_perf_add(zone_perf, XFR_PERF_IN_RECEIVE_TIME, usec);
+		ATOMIC_SET(xfr_perf.ctr[XFR_PERF_IN_RATE], rate);
+		if (zone_perf != NULL) {
+			ATOMIC_SET(zone_perf->ctr[XFR_PERF_IN_RATE], rate);
+		}
+	} else {
+		xfr_perf_add(zone_perf, XFR_PERF_OUT_TRANSFERS, 1);
+		xfr_perf_add(zone_perf, XFR_PERF_OUT_MESSAGES, messages);
+		xfr_perf_add(zone_perf, XFR_PERF_OUT_BYTES, bytes);
+		xfr_perf_add(zone_perf, XFR_PERF_OUT_SEND_TIME, usec);
+		ATOMIC_SET(xfr_perf.ctr[XFR_PERF_OUT_RATE], rate);
+		if (zone_perf != NULL) {
+			ATOMIC_SET(zone_perf->ctr[XFR_PERF_OUT_RATE], rate);
+		}
+	}
+}
+
+const char *xfr_perf_name(xfr_perf_ctr_t ctr)
+{
+	return ctr_names[ctr];
+}
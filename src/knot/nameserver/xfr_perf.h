@@ -0,0 +1,89 @@
+/*  Copyright (C) 2024 CZ.NIC, z.s.p.o. <knot-dns@labs.nic.cz>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <time.h>
+
+#include "contrib/atomic.h"
+
+/*!
+ * \brief Zone transfer performance counters.
+ *
+ * Times are in microseconds, rates in bytes per second of the last transfer.
+ */
+typedef enum {
+	XFR_PERF_IN_TRANSFERS,     /*!< Completed incoming transfers. */
+	XFR_PERF_IN_MESSAGES,      /*!< Received transfer messages. */
+	XFR_PERF_IN_BYTES,         /*!< Received transfer bytes. */
+	XFR_PERF_IN_RECEIVE_TIME,  /*!< Time from the first to the last message. */
+	XFR_PERF_IN_RATE,          /*!< Receive rate of the last incoming transfer. */
+	XFR_PERF_IN_APPLY_TIME,    /*!< Building the zone update from the transfer. */
+	XFR_PERF_IN_SEMCHECK_TIME, /*!< Semantic checks. */
+	XFR_PERF_IN_DIGEST_TIME,   /*!< ZONEMD verification. */
+	XFR_PERF_IN_ADJUST_TIME,   /*!< Adjusting the new zone contents. */
+	XFR_PERF_IN_JOURNAL_TIME,  /*!< Storing the changes into the journal. */
+	XFR_PERF_OUT_TRANSFERS,    /*!< Completed outgoing transfers. */
+	XFR_PERF_OUT_MESSAGES,     /*!< Sent transfer messages. */
+	XFR_PERF_OUT_BYTES,        /*!< Sent transfer bytes. */
+	XFR_PERF_OUT_SEND_TIME,    /*!< Time from the request to the last message. */
+	XFR_PERF_OUT_RATE,         /*!< Send rate of the last outgoing transfer. */
+	XFR_PERF_COUNT
+} xfr_perf_ctr_t;
+
+typedef struct {
+	knot_atomic_uint64_t ctr[XFR_PERF_COUNT];
+} xfr_perf_t;
+
+/*! \brief Statistics of all the zone transfers. */
+extern xfr_perf_t xfr_perf;
+
+/*!
+ * \brief Increment a counter, both the global and the zone one.
+ *
+ * \param zone_perf   Per-zone statistics (can be NULL).
+ * \param ctr         Counter.
+ * \param val         Value to be added.
+ */
+void xfr_perf_add(xfr_perf_t *zone_perf, xfr_perf_ctr_t ctr, uint64_t val);
+
+/*!
+ * \brief Account the time elapsed since the phase start.
+ *
+ * \param zone_perf   Per-zone statistics (can be NULL, then nothing is accounted).
+ * \param ctr         Time counter of the phase.
+ * \param begin       Phase start time.
+ */
+void xfr_perf_time(xfr_perf_t *zone_perf, xfr_perf_ctr_t ctr, const struct timespec *begin);
+
+/*!
+ * \brief Account a completed transfer.
+ *
+ * \param zone_perf   Per-zone statistics (can be NULL).
+ * \param incoming    Incoming (true) or outgoing transfer.
+ * \param messages    Transferred messages.
+ * \param bytes       Transferred bytes.
+ * \param begin       Transfer start time.
+ * \param end         Transfer end time.
+ */
+void xfr_perf_transfer(xfr_perf_t *zone_perf, bool incoming, uint64_t messages,
+                       uint64_t bytes, const struct timespec *begin,
+                       const struct timespec *end);
+
+/*! \brief Get the counter name. */
+const char *xfr_perf_name(xfr_perf_ctr_t ctr);
@@ -0,0 +1,323 @@
+/*  Copyright (C) 2024 CZ.NIC, z.s.p.o. <knot-dns@labs.nic.cz>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+
+#include <fcntl.h>
+#include <pthread.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+#include "knot/query/async-requestor.h"
+#include "knot/common/fdset.h"
+#include "contrib/macros.h"
+#include "libknot/error.h"
+
+#define LOOP_POLL_MS 1000 // Maximal wait between timeout checks.
+
+typedef struct areq {
+	struct areq *next;
+	knot_requestor_t *requestor;
+	knot_request_t *request;
+	int timeout_ms;
+	int fd;       // Watched request socket.
+	bool out;     // Watched for writability, otherwise for readability.
+	knot_areq_cb_t cb;
+	void *ctx;
+} areq_t;
+
+struct knot_areq_loop {
+	pthread_t thread;
+	pthread_mutex_t mx;
+	areq_t *queue;     // Requests to be started, protected by the mutex.
+	areq_t *watch;     // Requests to be added to the set.
+	int notify[2];     // Wake-up pipe.
+	fdset_t set;
+	bool stop;
+};
+
+typedef enum {
+	AREQ_DONE, // Completed.
+	AREQ_KEEP, // Waiting on the current set entry.
+	AREQ_NEW,  // Waiting on a new set entry.
+} areq_state_t;
+
+static void areq_complete(areq_t *areq, int ret)
+{
+	ret = knot_requestor_finish(areq->requestor, areq->request, ret);
+	areq->cb(areq->requestor, areq->request, ret, areq->ctx);
+	free(areq);
+}
+
+static void areq_watch(knot_areq_loop_t *loop, areq_t *areq, bool out)
+{
+	areq->out = out;
+	areq->next = loop->watch;
+	loop->watch = areq;
+}
+
+/*! \brief Adds the requests to the set, not possible while iterating over it. */
+static void watch_flush(knot_areq_loop_t *loop)
+{
+	while (loop->watch != NULL) {
+		areq_t *areq = loop->watch;
+		loop->watch = areq->next;
+
+		// The set closes its descriptors, the request owns the original one.
+		int fd = dup(areq->request->fd);
+		int idx = (fd >= 0) ? fdset_add(&loop->set, fd, areq->out ? FDSET_POLLOUT :
+		                                FDSET_POLLIN, areq) : KNOT_ENOMEM;
+		if (idx < 0) {
+			if (fd >= 0) {
+				close(fd);
+			}
+			areq_complete(areq, idx);
+			continue;
+		}
+		(void)fdset_set_watchdog(&loop->set, idx, MAX(1, (areq->timeout_ms + 999) / 1000));
+		areq->fd = areq->request->fd;
+	}
+}
+
+/*! \brief Runs the processing steps until a response is awaited. */
+static areq_state_t areq_run(knot_areq_loop_t *loop, areq_t *areq, bool watched_in)
+{
+	int ret = KNOT_EOK;
+	while (knot_requestor_active(areq->requestor)) {
+		if (areq->requestor->layer.state == KNOT_STATE_CONSUME) {
+			if (watched_in && areq->fd == areq->request->fd) {
+				return AREQ_KEEP;
+			}
+			areq_watch(loop, areq, false);
+			return AREQ_NEW;
+		}
+		ret = knot_requestor_step(areq->requestor, areq->request, areq->timeout_ms);
+		if (ret != KNOT_EOK) {
+			break;
+		}
+	}
+
+	areq_complete(areq, ret);
+	return AREQ_DONE;
+}
+
+static void areq_start(knot_areq_loop_t *loop, areq_t *areq)
+{
+	knot_request_t *request = areq->request;
+
+	// Wait for the TCP connection establishment in the loop.
+	if (request->fd < 0 && !(request->flags & KNOT_REQUEST_UDP)) {
+		bool reused = false;
+		int ret = knot_requestor_connect(request, &reused, areq->timeout_ms);
+		if (ret != KNOT_EOK) {
+			areq->requestor->layer.flags |= KNOT_REQUESTOR_IOFAIL;
+			areq_complete(areq, ret);
+			return;
+		}
+		if (reused) {
+			areq->requestor->layer.flags |= KNOT_REQUESTOR_REUSED;
+		} else {
+			areq_watch(loop, areq, true);
+			return;
+		}
+	}
+
+	(void)areq_run(loop, areq, false);
+}
+
+static areq_state_t areq_event(knot_areq_loop_t *loop, areq_t *areq)
+{
+	if (areq->out) { // Connected, send the query.
+		return areq_run(loop, areq, false);
+	}
+
+	int ret = knot_requestor_step(areq->requestor, areq->request, areq->timeout_ms);
+	if (ret != KNOT_EOK) {
+		areq_complete(areq, ret);
+		return AREQ_DONE;
+	}
+
+	return areq_run(loop, areq, true);
+}
+
+static fdset_sweep_state_t areq_sweep(fdset_t *set, int idx, void *data)
+{
+	areq_t *areq = set->ctx[idx];
+	if (areq == NULL) {
+		return FDSET_KEEP;
+	}
+
+	areq->requestor->layer.flags |= KNOT_REQUESTOR_IOFAIL;
+	areq_complete(areq, KNOT_ETIMEOUT);
+	return FDSET_SWEEP;
+}
+
+static void loop_process(knot_areq_loop_t *loop)
+{
+	fdset_it_t it;
+	(void)fdset_poll(&loop->set, &it, 0, LOOP_POLL_MS);
+	for (; !fdset_it_is_done(&it); fdset_it_next(&it)) {
+		areq_t *areq = fdset_it_get_ctx(&it);
+		if (areq == NULL) {
+			uint8_t buf[64];
+			while (read(loop->notify[0], buf, sizeof(buf)) > 0);
+			continue;
+		}
+
+		switch (areq_event(loop, areq)) {
+		case AREQ_KEEP:
+			(void)fdset_set_watchdog(&loop->set, fdset_it_get_idx(&it),
+			                         MAX(1, (areq->timeout_ms + 999) / 1000));
+			break;
+		default:
+			fdset_it_remove(&it);
+			break;
+		}
+	}
+	fdset_it_commit(&it);
+
+	watch_flush(loop);
+	fdset_sweep(&loop->set, areq_sweep, loop);
+}
+
+static void *loop_thread(void *arg)
+{
+	knot_areq_loop_t *loop = arg;
+
+	while (true) {
+		pthread_mutex_lock(&loop->mx);
+		bool stop = loop->stop;
+		areq_t *queue = loop->queue;
+		loop->queue = NULL;
+		pthread_mutex_unlock(&loop->mx);
+
+		while (queue != NULL) {
+			areq_t *next = queue->next;
+			if (stop) {
+				areq_complete(queue, KNOT_ECONNABORTED);
+			} else {
+				areq_start(loop, queue);
+			}
+			queue = next;
+		}
+		if (stop) {
+			break;
+		}
+
+		watch_flush(loop);
+		loop_process(loop);
+	}
+
+	// Abort the requests in progress.
+	for (unsigned idx = 0; idx < fdset_get_length(&loop->set); idx++) {
+		areq_t *areq = loop->set.ctx[idx];
+		if (areq != NULL) {
+			areq_complete(areq, KNOT_ECONNABORTED);
+		}
+	}
+
+	return NULL;
+}
+
+knot_areq_loop_t *knot_areq_loop_new(void)
+{
+	knot_areq_loop_t *loop = calloc(1, sizeof(*loop));
+	if (loop == NULL) {
+		return NULL;
+	}
+
+	if (pipe(loop->notify) != 0) {
+		free(loop);
+		return NULL;
+	}
+	(void)fcntl(loop->notify[0], F_SETFL, O_NONBLOCK);
+	(void)fcntl(loop->notify[1], F_SETFL, O_NONBLOCK);
+
+	if (fdset_init(&loop->set, FDSET_RESIZE_STEP) != KNOT_EOK ||
+	    fdset_add(&loop->set, loop->notify[0], FDSET_POLLIN, NULL) < 0) {
+		fdset_clear(&loop->set);
+		close(loop->notify[0]);
+		close(loop->notify[1]);
+		free(loop);
+		return NULL;
+	}
+
+	pthread_mutex_init(&loop->mx, NULL);
+
+	if (pthread_create(&loop->thread, NULL, loop_thread, loop) != 0) {
+		pthread_mutex_destroy(&loop->mx);
+		fdset_clear(&loop->set); // Closes the pipe read end.
+		close(loop->notify[1]);
+		free(loop);
+		return NULL;
+	}
+
+	return loop;
+}
+
+void knot_areq_loop_free(knot_areq_loop_t *loop)
+{
+	if (loop == NULL) {
+		return;
+	}
+
+	pthread_mutex_lock(&loop->mx);
+	loop->stop = true;
+	pthread_mutex_unlock(&loop->mx);
+	(void)write(loop->notify[1], "", 1);
+
+	pthread_join(loop->thread, NULL);
+
+	fdset_clear(&loop->set); // Closes the pipe read end.
+	close(loop->notify[1]);
+	pthread_mutex_destroy(&loop->mx);
+	free(loop);
+}
+
+int knot_areq_exec(knot_areq_loop_t *loop, knot_requestor_t *requestor,
+                   knot_request_t *request, int timeout_ms,
+                   knot_areq_cb_t cb, void *ctx)
+{
+	if (loop == NULL || requestor == NULL || request == NULL || cb == NULL) {
+		return KNOT_EINVAL;
+	} else if (request->flags & (KNOT_REQUEST_QUIC | KNOT_REQUEST_TLS)) {
+		return KNOT_ENOTSUP;
+	}
+
+	areq_t *areq = calloc(1, sizeof(*areq));
+	if (areq == NULL) {
+		return KNOT_ENOMEM;
+	}
+	areq->requestor = requestor;
+	areq->request = request;
+	areq->timeout_ms = timeout_ms;
+	areq->fd = -1;
+	areq->cb = cb;
+	areq->ctx = ctx;
+
+	pthread_mutex_lock(&loop->mx);
+	if (loop->stop) {
+		pthread_mutex_unlock(&loop->mx);
+		free(areq);
+		return KNOT_ECONNABORTED;
+	}
+	areq->next = loop->queue;
+	loop->queue = areq;
+	pthread_mutex_unlock(&loop->mx);
+
+	(void)write(loop->notify[1], "", 1);
+
+	return KNOT_EOK;
+}
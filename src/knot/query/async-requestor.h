@@ -0,0 +1,74 @@
+/*  Copyright (C) 2024 CZ.NIC, z.s.p.o. <knot-dns@labs.nic.cz>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+
+#pragma once
+
+#include "knot/query/requestor.h"
+
+/*!
+ * \brief Event loop driving outgoing requests asynchronously.
+ *
+ * One thread waits for the responses of any number of requests using fdset,
+ * so the requesting threads aren't blocked for the I/O timeouts. The request
+ * processing is the same as with knot_requestor_exec(), a completion callback
+ * is called from the loop thread once finished. Only plain UDP and TCP
+ * requests are supported.
+ */
+typedef struct knot_areq_loop knot_areq_loop_t;
+
+/*!
+ * \brief Request completion callback.
+ *
+ * \param requestor  Requestor instance.
+ * \param request    Request instance.
+ * \param ret        Result as of knot_requestor_exec().
+ * \param ctx        Callback context.
+ */
+typedef void (*knot_areq_cb_t)(knot_requestor_t *requestor, knot_request_t *request,
+                               int ret, void *ctx);
+
+/*!
+ * \brief Start the request event loop thread.
+ *
+ * \return Allocated loop or NULL.
+ */
+knot_areq_loop_t *knot_areq_loop_new(void);
+
+/*!
+ * \brief Stop the loop, pending requests are completed with KNOT_ECONNABORTED.
+ */
+void knot_areq_loop_free(knot_areq_loop_t *loop);
+
+/*!
+ * \brief Execute a request asynchronously.
+ *
+ * \note The requestor and the request must be valid until completed.
+ *
+ * \param loop        Request event loop.
+ * \param requestor   Requestor instance.
+ * \param request     Request instance.
+ * \param timeout_ms  Timeout of each operation in milliseconds.
+ * \param cb          Completion callback.
+ * \param ctx         Completion callback context.
+ *
+ * \retval KNOT_EOK       The request is being processed, the callback will be called.
+ * \retval KNOT_ENOTSUP   TLS or QUIC request, use knot_requestor_exec().
+ * \return KNOT_E*        Other error, the callback won't be called.
+ */
+int knot_areq_exec(knot_areq_loop_t *loop, knot_requestor_t *requestor,
+                   knot_request_t *request, int timeout_ms,
+                   knot_areq_cb_t cb, void *ctx);
@@ -59,7 +59,17 @@ static int request_ensure_connected(knot_request_t *request, bool *reused_fd, in
 
 	int sock_type = use_tcp(request) ? SOCK_STREAM : SOCK_DGRAM;
 
-	if (sock_type == SOCK_STREAM) {
+	if (use_tls(request) && request->tls_req_ctx.conn == NULL &&
+	    knot_tls_req_ctx_reuse(&request->tls_req_ctx, &request->remote,
+	                           &request->source, request->pin, request->pin_len)) {
+		request->fd = request->tls_req_ctx.conn->fd;
+		if (reused_fd != NULL) {
+			*reused_fd = true;
+		}
+		return KNOT_EOK;
+	}
+
+	if (sock_type == SOCK_STREAM && !use_tls(request)) {
 		request->fd = (int)conn_pool_get(global_conn_pool,
 		                                 &request->source,
 		                                 &request->remote);
@@ -301,7 +311,13 @@ void knot_request_free(knot_request_t *request, knot_mm_t *mm)
 		assert(0);
 #endif // ENABLE_QUIC
 	} else if (use_tls(request) && request->tls_req_ctx.conn != NULL) {
-		knot_tls_req_ctx_deinit(&request->tls_req_ctx);
+		if (request->fd >= 0 && (request->flags & KNOT_REQUEST_KEEP) &&
+		    knot_tls_req_ctx_keep(&request->tls_req_ctx, &request->remote,
+		                          &request->source, request->pin, request->pin_len)) {
+			request->fd = -1; // Owned by the pool.
+		} else {
+			knot_tls_req_ctx_deinit(&request->tls_req_ctx);
+		}
 	} else {
 		assert(request->quic_ctx == NULL);
 		assert(request->quic_conn == NULL);
@@ -487,6 +503,24 @@ static int request_io(knot_requestor_t *req, knot_request_t *last,
 	}
 }
 
+bool knot_requestor_active(const knot_requestor_t *requestor)
+{
+	return layer_active(requestor->layer.state);
+}
+
+int knot_requestor_connect(knot_request_t *request, bool *reused_fd, int timeout_ms)
+{
+	return request_ensure_connected(request, reused_fd, timeout_ms);
+}
+
+int knot_requestor_step(knot_requestor_t *requestor, knot_request_t *request,
+                        int timeout_ms)
+{
+	requestor->layer.tsig = &request->tsig;
+
+	return request_io(requestor, request, timeout_ms);
+}
+
 int knot_requestor_exec(knot_requestor_t *requestor, knot_request_t *request,
                         int timeout_ms)
 {
@@ -502,11 +536,20 @@ int knot_requestor_exec(knot_requestor_t *requestor, knot_request_t *request,
 	while (layer_active(requestor->layer.state)) {
 		ret = request_io(requestor, request, timeout_ms);
 		if (ret != KNOT_EOK) {
-			knot_layer_finish(&requestor->layer);
-			return ret;
+			break;
 		}
 	}
 
+	return knot_requestor_finish(requestor, request, ret);
+}
+
+int knot_requestor_finish(knot_requestor_t *requestor, knot_request_t *request, int ret)
+{
+	if (ret != KNOT_EOK) {
+		knot_layer_finish(&requestor->layer);
+		return ret;
+	}
+
 	/* Expect complete request. */
 	switch (requestor->layer.state) {
 	case KNOT_STATE_DONE:
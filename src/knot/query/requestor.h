@@ -171,3 +171,45 @@ void knot_requestor_clear(knot_requestor_t *requestor);
 int knot_requestor_exec(knot_requestor_t *requestor,
                         knot_request_t *request,
                         int timeout_ms);
+
+/*!
+ * \brief Check if the request processing expects more I/O steps.
+ */
+bool knot_requestor_active(const knot_requestor_t *requestor);
+
+/*!
+ * \brief Open the request connection in advance (non-blocking for TCP).
+ *
+ * \param request     Request instance.
+ * \param reused_fd   Output: a pooled connection was taken.
+ * \param timeout_ms  Timeout of TLS or QUIC handshake.
+ *
+ * \return KNOT_EOK or error
+ */
+int knot_requestor_connect(knot_request_t *request, bool *reused_fd, int timeout_ms);
+
+/*!
+ * \brief Execute one I/O step of the request processing.
+ *
+ * Building block of asynchronous processing, see knot_requestor_exec(). If
+ * knot_requestor_active() with the layer state KNOT_STATE_CONSUME, the step
+ * receives a response, so it should be called once the socket is readable.
+ *
+ * \return KNOT_EOK or error
+ */
+int knot_requestor_step(knot_requestor_t *requestor,
+                        knot_request_t *request,
+                        int timeout_ms);
+
+/*!
+ * \brief Finish the request processing, see knot_requestor_exec().
+ *
+ * \param requestor  Requestor instance.
+ * \param request    Request instance.
+ * \param ret        Result of the last step.
+ *
+ * \return KNOT_EOK or error
+ */
+int knot_requestor_finish(knot_requestor_t *requestor,
+                          knot_request_t *request,
+                          int ret);
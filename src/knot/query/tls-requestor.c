@@ -14,7 +14,9 @@
     along with this program.  If not, see <https://www.gnu.org/licenses/>.
  */
 
+#include <stdlib.h>
 #include <string.h>
+#include <unistd.h>
 
 #include "knot/query/tls-requestor.h"
 #include "knot/query/requestor.h"
@@ -22,6 +24,13 @@
 #include "libknot/quic/tls.h"
 #include "contrib/conn_pool.h"
 
+/*! \brief Established TLS connection kept in the connection pool. */
+typedef struct {
+	knot_tls_req_ctx_t ctx;
+	uint8_t pin_len;
+	uint8_t pin[];
+} tls_pooled_t;
+
 int knot_tls_req_ctx_init(knot_tls_req_ctx_t *ctx, int fd,
                           const struct sockaddr_storage *remote,
                           const struct sockaddr_storage *local,
@@ -85,3 +94,77 @@ void knot_tls_req_ctx_deinit(knot_tls_req_ctx_t *ctx)
 		memset(ctx, 0, sizeof(*ctx));
 	}
 }
+
+bool knot_tls_req_ctx_reuse(knot_tls_req_ctx_t *ctx,
+                            const struct sockaddr_storage *remote,
+                            const struct sockaddr_storage *local,
+                            const uint8_t *peer_pin, uint8_t peer_pin_len)
+{
+	intptr_t ptr = conn_pool_get(global_tls_conn_pool, local, remote);
+	if (ptr == CONN_POOL_FD_INVALID) {
+		return false;
+	}
+
+	tls_pooled_t *pooled = (tls_pooled_t *)ptr;
+	if (pooled->pin_len != peer_pin_len ||
+	    memcmp(pooled->pin, peer_pin, peer_pin_len) != 0) {
+		knot_tls_req_pool_close(ptr); // Verified against another pin.
+		return false;
+	}
+
+	*ctx = pooled->ctx;
+	free(pooled);
+
+	return true;
+}
+
+bool knot_tls_req_ctx_keep(knot_tls_req_ctx_t *ctx,
+                           const struct sockaddr_storage *remote,
+                           const struct sockaddr_storage *local,
+                           const uint8_t *peer_pin, uint8_t peer_pin_len)
+{
+	if (global_tls_conn_pool == NULL || ctx->conn == NULL ||
+	    !(ctx->conn->flags & KNOT_TLS_CONN_HANDSHAKE_DONE)) {
+		return false;
+	}
+
+	tls_pooled_t *pooled = malloc(sizeof(*pooled) + peer_pin_len);
+	if (pooled == NULL) {
+		return false;
+	}
+	pooled->ctx = *ctx;
+	pooled->pin_len = peer_pin_len;
+	if (peer_pin_len > 0) {
+		memcpy(pooled->pin, peer_pin, peer_pin_len);
+	}
+
+	intptr_t tofree = conn_pool_put(global_tls_conn_pool, local, remote,
+	                                (intptr_t)pooled);
+	if (tofree == (intptr_t)pooled) {
+		free(pooled);
+		return false;
+	}
+	knot_tls_req_pool_close(tofree);
+	memset(ctx, 0, sizeof(*ctx));
+
+	return true;
+}
+
+void knot_tls_req_pool_close(intptr_t ptr)
+{
+	if (ptr == CONN_POOL_FD_INVALID) {
+		return;
+	}
+
+	tls_pooled_t *pooled = (tls_pooled_t *)ptr;
+	int fd = pooled->ctx.conn->fd;
+	knot_tls_req_ctx_deinit(&pooled->ctx);
+	close(fd);
+	free(pooled);
+}
+
+bool knot_tls_req_pool_invalid(intptr_t ptr)
+{
+	tls_pooled_t *pooled = (tls_pooled_t *)ptr;
+	return conn_pool_invalid_cb_dflt(pooled->ctx.conn->fd);
+}
@@ -62,3 +62,41 @@ void knot_tls_req_ctx_maint(knot_tls_req_ctx_t *ctx, struct knot_request *r);
  * \brief De-initialize TLS requestor context.
  */
 void knot_tls_req_ctx_deinit(knot_tls_req_ctx_t *ctx);
+
+/*!
+ * \brief Take an established TLS connection from the connection pool.
+ *
+ * \param ctx            Context structure to be filled.
+ * \param remote         Remote address.
+ * \param local          Local address.
+ * \param peer_pin       TLS peer pin, must equal the one of the pooled connection.
+ * \param peer_pin_len   TLS peer pin length.
+ *
+ * \return True if a connection was reused.
+ */
+bool knot_tls_req_ctx_reuse(knot_tls_req_ctx_t *ctx,
+                            const struct sockaddr_storage *remote,
+                            const struct sockaddr_storage *local,
+                            const uint8_t *peer_pin, uint8_t peer_pin_len);
+
+/*!
+ * \brief Hand over an established TLS connection to the connection pool.
+ *
+ * \note The context is emptied and the connection is owned by the pool on success.
+ *
+ * \return True if the connection was kept.
+ */
+bool knot_tls_req_ctx_keep(knot_tls_req_ctx_t *ctx,
+                           const struct sockaddr_storage *remote,
+                           const struct sockaddr_storage *local,
+                           const uint8_t *peer_pin, uint8_t peer_pin_len);
+
+/*!
+ * \brief Connection pool close callback for pooled TLS connections.
+ */
+void knot_tls_req_pool_close(intptr_t ptr);
+
+/*!
+ * \brief Connection pool invalidness callback for pooled TLS connections.
+ */
+bool knot_tls_req_pool_invalid(intptr_t ptr);
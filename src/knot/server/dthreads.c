@@ -18,9 +18,15 @@
 #include <stdlib.h>
 #include <string.h>
 #include <stdio.h>
+#include <time.h>
 #include <unistd.h>
 #include <errno.h>
+#include <dirent.h>
 #include <urcu.h>
+#ifdef __linux__
+#include <linux/mempolicy.h>
+#include <sys/syscall.h>
+#endif
 
 #ifdef HAVE_PTHREAD_NP_H
 #include <pthread_np.h>
@@ -643,6 +649,69 @@ int dt_setaffinity(dthread_t *thread, unsigned* cpu_id, size_t cpu_count)
 	return KNOT_EOK;
 }
 
+#if defined(__linux__) && defined(SYS_set_mempolicy)
+/*! \brief Get the NUMA node of the CPU or -1 if unknown. */
+static int cpu_node(unsigned cpu_id)
+{
+	char path[64];
+	(void)snprintf(path, sizeof(path), "/sys/devices/system/cpu/cpu%u", cpu_id);
+
+	DIR *dir = opendir(path);
+	if (dir == NULL) {
+		return -1;
+	}
+
+	int node = -1;
+	struct dirent *entry;
+	while ((entry = readdir(dir)) != NULL) {
+		if (strncmp(entry->d_name, "node", 4) == 0 &&
+		    sscanf(entry->d_name + 4, "%d", &node) == 1) {
+			break;
+		}
+		node = -1;
+	}
+	closedir(dir);
+
+	return node;
+}
+#endif
+
+int dt_set_mempolicy(dt_mempolicy_t policy, unsigned cpu_id)
+{
+#if defined(__linux__) && defined(SYS_set_mempolicy)
+	unsigned long mask = 0;
+	int mode = MPOL_DEFAULT;
+
+	switch (policy) {
+	case DT_MEMPOLICY_LOCAL:;
+		int node = cpu_node(cpu_id);
+		if (node < 0 || node >= 8 * sizeof(mask)) {
+			return KNOT_ENOTSUP;
+		}
+		mask = 1UL << node;
+		mode = MPOL_BIND;
+		break;
+	case DT_MEMPOLICY_INTERLEAVE:
+		// The kernel restricts the mask to the nodes with memory.
+		mask = ~0UL;
+		mode = MPOL_INTERLEAVE;
+		break;
+	default:
+		break;
+	}
+
+	unsigned long maxnode = (mode == MPOL_DEFAULT) ? 0 : 8 * sizeof(mask) + 1;
+	if (syscall(SYS_set_mempolicy, mode, (mode == MPOL_DEFAULT) ? NULL : &mask,
+	            maxnode) != 0) {
+		return (errno == ENOSYS) ? KNOT_ENOTSUP : KNOT_ERROR;
+	}
+
+	return KNOT_EOK;
+#else
+	return KNOT_ENOTSUP;
+#endif
+}
+
 int dt_activate(dthread_t *thread)
 {
 	return dt_update_thread(thread, ThreadActive);
@@ -757,6 +826,27 @@ unsigned dt_get_id(dthread_t *thread)
 	return 0;
 }
 
+uint64_t dt_cpu_time(dthread_t *thread)
+{
+	if (thread == NULL) {
+		return 0;
+	}
+
+	uint64_t usec = 0;
+
+	lock_thread_rw(thread);
+	clockid_t clock;
+	struct timespec ts;
+	if (!(thread->state & ThreadJoined) &&
+	    pthread_getcpuclockid(thread->_thr, &clock) == 0 &&
+	    clock_gettime(clock, &ts) == 0) {
+		usec = ts.tv_sec * 1000000ULL + ts.tv_nsec / 1000;
+	}
+	unlock_thread_rw(thread);
+
+	return usec;
+}
+
 int dt_unit_lock(dt_unit_t *unit)
 {
 	if (unit == 0) {
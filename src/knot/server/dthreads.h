@@ -33,6 +33,7 @@
 #pragma once
 
 #include <pthread.h>
+#include <stdint.h>
 #include "contrib/semaphore.h"
 
 #define DEFAULT_THR_COUNT 2  /*!< Default thread count. */
@@ -185,6 +186,27 @@ int dt_stop(dt_unit_t *unit);
  */
 int dt_setaffinity(dthread_t *thread, unsigned* cpu_id, size_t cpu_count);
 
+/*!
+ * \brief NUMA memory placement policy.
+ */
+typedef enum {
+	DT_MEMPOLICY_DEFAULT = 0, /*!< System default policy. */
+	DT_MEMPOLICY_LOCAL,       /*!< Bind allocations to the node of the CPU. */
+	DT_MEMPOLICY_INTERLEAVE,  /*!< Interleave allocations across all nodes. */
+} dt_mempolicy_t;
+
+/*!
+ * \brief Set NUMA memory policy for new allocations of the calling thread.
+ *
+ * \param policy  Memory placement policy.
+ * \param cpu_id  CPU ID the local node is determined from (DT_MEMPOLICY_LOCAL).
+ *
+ * \retval KNOT_EOK on success.
+ * \retval KNOT_ENOTSUP if NUMA isn't supported (e.g. single-node system).
+ * \retval KNOT_ERROR on other error.
+ */
+int dt_set_mempolicy(dt_mempolicy_t policy, unsigned cpu_id);
+
 /*!
  * \brief Wake up thread from idle state.
  *
@@ -269,6 +291,15 @@ int dt_is_cancelled(dthread_t *thread);
  */
 unsigned dt_get_id(dthread_t *thread);
 
+/*!
+ * \brief Return CPU time consumed by the thread.
+ *
+ * \param thread Target thread instance.
+ *
+ * \return CPU time in microseconds, 0 if not running or not supported.
+ */
+uint64_t dt_cpu_time(dthread_t *thread);
+
 /*!
  * \brief Lock unit to prevent parallel operations which could alter unit
  *        at the same time.
@@ -21,6 +21,8 @@
 #include "contrib/time.h"
 #include "contrib/ucw/mempool.h"
 #include "knot/common/log.h"
+#include "knot/common/probes.h"
+#include "knot/nameserver/query_phases.h"
 #include "knot/server/proxyv2.h"
 
 void handle_query(knotd_qdata_params_t *params, knot_layer_t *layer,
@@ -28,16 +30,25 @@ void handle_query(knotd_qdata_params_t *params, knot_layer_t *layer,
 {
 	knot_layer_begin(layer, params);
 
-	knot_pkt_t *query = knot_pkt_new(payload->iov_base, payload->iov_len, layer->mm);
+	// Strip a PROXY v2 header first to parse the query only once.
+	struct iovec msg = *payload;
+	params->flags &= ~KNOTD_QUERY_FLAG_PROXIED;
+	if (params->proto == KNOTD_QUERY_PROTO_UDP &&
+	    proxyv2_header_strip(&msg, params->remote, proxied_remote) == KNOT_EOK) {
+		assert(proxied_remote);
+		params->remote = proxied_remote;
+		params->flags |= KNOTD_QUERY_FLAG_PROXIED;
+	}
+
+	query_phases_query_begin(params->thread_id);
+
+	knot_pkt_t *query = knot_pkt_new(msg.iov_base, msg.iov_len, layer->mm);
+	uint64_t parse_begin = query_phases_begin();
 	int ret = knot_pkt_parse(query, 0);
+	query_phases_end(QUERY_PHASE_PARSE, parse_begin);
+	KNOTD_PROBE3(query__parse, params->proto, query->size, ret);
 	if (ret != KNOT_EOK && query->parsed > 0) { // parsing failed (e.g. 2x OPT)
-		if (params->proto == KNOTD_QUERY_PROTO_UDP &&
-		    proxyv2_header_strip(&query, params->remote, proxied_remote) == KNOT_EOK) {
-			assert(proxied_remote);
-			params->remote = proxied_remote;
-		} else {
-			query->parsed--; // artificially decreasing "parsed" leads to FORMERR
-		}
+		query->parsed--; // artificially decreasing "parsed" leads to FORMERR
 	}
 
 	knot_layer_consume(layer, query);
@@ -46,15 +57,31 @@ void handle_query(knotd_qdata_params_t *params, knot_layer_t *layer,
 void handle_finish(knot_layer_t *layer)
 {
 	knot_layer_finish(layer);
+	query_phases_query_end();
 
 	// Flush per-query memory (including query and answer packets).
 	mp_flush(layer->mm->ctx);
 }
 
+void handle_mem_usage(knot_layer_t *layer, knot_atomic_uint64_t *high_water)
+{
+	// Flushed chunks are kept for reuse, so the size only grows.
+	uint64_t size = mp_total_size(layer->mm->ctx);
+	if (size > ATOMIC_GET(*high_water)) {
+		ATOMIC_SET(*high_water, size);
+	}
+}
+
 void handle_udp_reply(knotd_qdata_params_t *params, knot_layer_t *layer,
                       struct iovec *rx, struct iovec *tx,
-                      struct sockaddr_storage *proxied_remote)
+                      struct sockaddr_storage *proxied_remote,
+                      answer_cache_t *cache)
 {
+	if (cache != NULL &&
+	    answer_cache_get(cache, rx, params->remote->ss_family, tx)) {
+		return;
+	}
+
 	handle_query(params, layer, rx, proxied_remote);
 
 	knot_pkt_t *ans = knot_pkt_new(tx->iov_base, tx->iov_len, layer->mm);
@@ -66,6 +93,9 @@ void handle_udp_reply(knotd_qdata_params_t *params, knot_layer_t *layer,
 	// Send response only if finished successfully.
 	if (layer->state == KNOT_STATE_DONE) {
 		tx->iov_len = ans->size;
+		if (cache != NULL && answer_cache_cacheable(cache, layer->data, tx)) {
+			answer_cache_put(cache, tx);
+		}
 	} else {
 		tx->iov_len = 0;
 	}
@@ -17,6 +17,7 @@
 #pragma once
 
 #include "knot/include/module.h"
+#include "knot/nameserver/answer_cache.h"
 #include "knot/query/layer.h"
 #include "knot/server/server.h"
 #include "libknot/xdp/tcp_iobuf.h"
@@ -61,6 +62,12 @@ inline static void params_update_quic(knotd_qdata_params_t *params,
 	if (conn->flags & KNOT_QUIC_CONN_AUTHORIZED) {
 		params->flags |= KNOTD_QUERY_FLAG_AUTHORIZED;
 	}
+	// Stream data processed before the handshake completion are 0-RTT data.
+	if (conn->flags & KNOT_QUIC_CONN_HANDSHAKE_DONE) {
+		params->flags &= ~KNOTD_QUERY_FLAG_EARLY_DATA;
+	} else {
+		params->flags |= KNOTD_QUERY_FLAG_EARLY_DATA;
+	}
 }
 
 inline static void params_update_quic_stream(knotd_qdata_params_t *params,
@@ -121,7 +128,8 @@ inline static bool active_state(int state)
 
 inline static bool send_state(int state)
 {
-	return (state != KNOT_STATE_FAIL && state != KNOT_STATE_NOOP);
+	return (state != KNOT_STATE_FAIL && state != KNOT_STATE_NOOP &&
+	        state != KNOT_STATE_YIELD);
 }
 
 void handle_query(knotd_qdata_params_t *params, knot_layer_t *layer,
@@ -129,9 +137,13 @@ void handle_query(knotd_qdata_params_t *params, knot_layer_t *layer,
 
 void handle_finish(knot_layer_t *layer);
 
+/*! \brief Update the high-water mark of the query processing memory. */
+void handle_mem_usage(knot_layer_t *layer, knot_atomic_uint64_t *high_water);
+
 void handle_udp_reply(knotd_qdata_params_t *params, knot_layer_t *layer,
                       struct iovec *rx, struct iovec *tx,
-                      struct sockaddr_storage *proxied_remote);
+                      struct sockaddr_storage *proxied_remote,
+                      answer_cache_t *cache);
 
 #ifdef ENABLE_QUIC
 void handle_quic_streams(knot_quic_conn_t *conn, knotd_qdata_params_t *params,
@@ -0,0 +1,363 @@
+/*  Copyright (C) 2024 CZ.NIC, z.s.p.o. <knot-dns@labs.nic.cz>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <pthread.h>
+#include <signal.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <sys/time.h>
+#include <unistd.h>
+
+#include "knot/server/handoff.h"
+#include "knot/common/log.h"
+#include "knot/server/server.h"
+#include "contrib/net.h"
+#include "contrib/sockaddr.h"
+#include "libknot/errcode.h"
+
+#define HANDOFF_VERSION     1
+#define HANDOFF_TIMEOUT_S  10  // Receiving timeout of the new server.
+#define HANDOFF_CONFIRM    'K'
+
+/*! \brief Description of one passed socket, type 0 terminates the list. */
+typedef struct {
+	uint32_t version;
+	int32_t type;
+	struct sockaddr_storage addr;
+} handoff_msg_t;
+
+struct handoff_listener {
+	pthread_t thread;
+	int sock;
+	int stop[2];
+	struct server *server;
+};
+
+static int send_sock(int conn, int type, const struct sockaddr_storage *addr, int fd)
+{
+	handoff_msg_t msg = { .version = HANDOFF_VERSION, .type = type };
+	if (addr != NULL) {
+		msg.addr = *addr;
+	}
+
+	struct iovec iov = { .iov_base = &msg, .iov_len = sizeof(msg) };
+	union {
+		struct cmsghdr align;
+		uint8_t buf[CMSG_SPACE(sizeof(int))];
+	} control = { 0 };
+	struct msghdr hdr = { .msg_iov = &iov, .msg_iovlen = 1 };
+
+	if (fd >= 0) {
+		hdr.msg_control = control.buf;
+		hdr.msg_controllen = sizeof(control.buf);
+		struct cmsghdr *cmsg = CMSG_FIRSTHDR(&hdr);
+		cmsg->cmsg_level = SOL_SOCKET;
+		cmsg->cmsg_type = SCM_RIGHTS;
+		cmsg->cmsg_len = CMSG_LEN(sizeof(int));
+		memcpy(CMSG_DATA(cmsg), &fd, sizeof(int));
+	}
+
+	ssize_t ret = sendmsg(conn, &hdr, MSG_NOSIGNAL);
+	if (ret != sizeof(msg)) {
+		return (ret < 0) ? knot_map_errno() : KNOT_ECONN;
+	}
+	return KNOT_EOK;
+}
+
+static int recv_sock(int conn, handoff_msg_t *msg, int *fd)
+{
+	struct iovec iov = { .iov_base = msg, .iov_len = sizeof(*msg) };
+	union {
+		struct cmsghdr align;
+		uint8_t buf[CMSG_SPACE(sizeof(int))];
+	} control = { 0 };
+	struct msghdr hdr = {
+		.msg_iov = &iov,
+		.msg_iovlen = 1,
+		.msg_control = control.buf,
+		.msg_controllen = sizeof(control.buf),
+	};
+
+	*fd = -1;
+	ssize_t ret = recvmsg(conn, &hdr, MSG_WAITALL | MSG_CMSG_CLOEXEC);
+	struct cmsghdr *cmsg = CMSG_FIRSTHDR(&hdr);
+	if (cmsg != NULL && cmsg->cmsg_level == SOL_SOCKET &&
+	    cmsg->cmsg_type == SCM_RIGHTS && cmsg->cmsg_len == CMSG_LEN(sizeof(int))) {
+		memcpy(fd, CMSG_DATA(cmsg), sizeof(int));
+	}
+
+	if (ret != sizeof(*msg) || msg->version != HANDOFF_VERSION ||
+	    (msg->type != 0 && *fd < 0)) {
+		if (*fd >= 0) {
+			close(*fd);
+			*fd = -1;
+		}
+		return (ret < 0) ? knot_map_errno() : KNOT_EMALF;
+	}
+	return KNOT_EOK;
+}
+
+int handoff_receive(handoff_t *ho, const char *path)
+{
+	if (ho == NULL || path == NULL) {
+		return KNOT_EINVAL;
+	}
+
+	memset(ho, 0, sizeof(*ho));
+
+	struct sockaddr_storage addr;
+	int ret = sockaddr_set(&addr, AF_UNIX, path, 0);
+	if (ret != KNOT_EOK) {
+		return ret;
+	}
+
+	int conn = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+	if (conn < 0) {
+		return knot_map_errno();
+	}
+	struct timeval tv = { .tv_sec = HANDOFF_TIMEOUT_S };
+	(void)setsockopt(conn, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+	if (connect(conn, (struct sockaddr *)&addr, sockaddr_len(&addr)) != 0) {
+		ret = knot_map_errno();
+		close(conn);
+		return ret;
+	}
+
+	ho->active = true;
+	ho->conn = conn;
+
+	while (true) {
+		handoff_msg_t msg;
+		int fd;
+		ret = recv_sock(conn, &msg, &fd);
+		if (ret != KNOT_EOK || msg.type == 0) {
+			break;
+		}
+
+		handoff_sock_t *socks = realloc(ho->socks, (ho->count + 1) * sizeof(*socks));
+		if (socks == NULL) {
+			close(fd);
+			ret = KNOT_ENOMEM;
+			break;
+		}
+		ho->socks = socks;
+		ho->socks[ho->count++] = (handoff_sock_t) {
+			.addr = msg.addr,
+			.type = msg.type,
+			.fd = fd,
+		};
+	}
+
+	if (ret != KNOT_EOK) {
+		handoff_finish(ho, false);
+	}
+
+	return ret;
+}
+
+int handoff_take(handoff_t *ho, int type, const struct sockaddr_storage *addr)
+{
+	if (ho == NULL || !ho->active) {
+		return KNOT_ENOENT;
+	}
+
+	for (size_t i = 0; i < ho->count; i++) {
+		handoff_sock_t *sock = &ho->socks[i];
+		if (sock->fd >= 0 && sock->type == type &&
+		    sockaddr_cmp(&sock->addr, addr, false) == 0) {
+			int fd = sock->fd;
+			sock->fd = -1;
+			return fd;
+		}
+	}
+
+	return KNOT_ENOENT;
+}
+
+void handoff_finish(handoff_t *ho, bool confirm)
+{
+	if (ho == NULL || !ho->active) {
+		return;
+	}
+
+	if (confirm) {
+		uint8_t byte = HANDOFF_CONFIRM;
+		if (send(ho->conn, &byte, sizeof(byte), MSG_NOSIGNAL) != sizeof(byte)) {
+			log_warning("hand-off, failed to confirm to the old server");
+		}
+	}
+
+	for (size_t i = 0; i < ho->count; i++) {
+		if (ho->socks[i].fd >= 0) {
+			close(ho->socks[i].fd);
+		}
+	}
+	free(ho->socks);
+	close(ho->conn);
+
+	memset(ho, 0, sizeof(*ho));
+}
+
+/*! \brief Wait for an event on the socket, fails if stopped. */
+static int wait_sock(handoff_listener_t *lst, int fd)
+{
+	struct pollfd pfd[] = {
+		{ .fd = fd, .events = POLLIN },
+		{ .fd = lst->stop[0], .events = POLLIN },
+	};
+
+	while (poll(pfd, 2, -1) < 0) {
+		if (errno != EINTR) {
+			return knot_map_errno();
+		}
+	}
+
+	return (pfd[1].revents != 0) ? KNOT_ECONNABORTED : KNOT_EOK;
+}
+
+static int hand_off(handoff_listener_t *lst, int conn, size_t *count)
+{
+	const server_t *server = lst->server;
+
+	int ret = KNOT_EOK;
+	for (size_t i = 0; i < server->n_ifaces && ret == KNOT_EOK; i++) {
+		const iface_t *iface = &server->ifaces[i];
+		for (unsigned j = 0; j < iface->fd_udp_count && ret == KNOT_EOK; j++) {
+			ret = send_sock(conn, SOCK_DGRAM, &iface->addr, iface->fd_udp[j]);
+			(*count)++;
+		}
+		for (unsigned j = 0; j < iface->fd_tcp_count && ret == KNOT_EOK; j++) {
+			ret = send_sock(conn, SOCK_STREAM, &iface->addr, iface->fd_tcp[j]);
+			(*count)++;
+		}
+	}
+	if (ret == KNOT_EOK) {
+		ret = send_sock(conn, 0, NULL, -1);
+	}
+	if (ret != KNOT_EOK) {
+		return ret;
+	}
+
+	log_info("hand-off, passed %zu sockets, waiting for the new server", *count);
+
+	// The new server closes the connection if it fails to start.
+	ret = wait_sock(lst, conn);
+	if (ret != KNOT_EOK) {
+		return ret;
+	}
+	uint8_t byte = 0;
+	if (recv(conn, &byte, sizeof(byte), 0) != sizeof(byte) || byte != HANDOFF_CONFIRM) {
+		return KNOT_ECONNREFUSED;
+	}
+
+	return KNOT_EOK;
+}
+
+static void *listener_thread(void *arg)
+{
+	handoff_listener_t *lst = arg;
+
+	while (wait_sock(lst, lst->sock) == KNOT_EOK) {
+		int conn = accept(lst->sock, NULL, NULL);
+		if (conn < 0) {
+			continue;
+		}
+
+		size_t count = 0;
+		int ret = hand_off(lst, conn, &count);
+		close(conn);
+		if (ret == KNOT_ECONNABORTED) {
+			break;
+		} else if (ret != KNOT_EOK) {
+			log_warning("hand-off, not completed (%s), continuing", knot_strerror(ret));
+			continue;
+		}
+
+		log_info("hand-off, completed, stopping");
+		lst->server->state |= ServerHandedOff;
+		kill(getpid(), SIGTERM);
+		break;
+	}
+
+	return NULL;
+}
+
+handoff_listener_t *handoff_listen(struct server *server, const char *path)
+{
+	if (server == NULL || path == NULL) {
+		return NULL;
+	}
+
+	struct sockaddr_storage addr;
+	if (sockaddr_set(&addr, AF_UNIX, path, 0) != KNOT_EOK) {
+		return NULL;
+	}
+
+	handoff_listener_t *lst = calloc(1, sizeof(*lst));
+	if (lst == NULL) {
+		return NULL;
+	}
+	lst->server = server;
+
+	lst->sock = net_bound_socket(SOCK_STREAM, &addr, 0, S_IWUSR);
+	if (lst->sock < 0) {
+		log_error("hand-off, failed to bind socket '%s' (%s)", path,
+		          knot_strerror(lst->sock));
+		free(lst);
+		return NULL;
+	}
+
+	if (listen(lst->sock, 1) != 0 || pipe(lst->stop) != 0) {
+		log_error("hand-off, failed to listen on socket '%s' (%s)", path,
+		          knot_strerror(knot_map_errno()));
+		close(lst->sock);
+		free(lst);
+		return NULL;
+	}
+
+	if (pthread_create(&lst->thread, NULL, listener_thread, lst) != 0) {
+		close(lst->stop[0]);
+		close(lst->stop[1]);
+		close(lst->sock);
+		free(lst);
+		return NULL;
+	}
+
+	log_info("hand-off, listening on '%s'", path);
+
+	return lst;
+}
+
+void handoff_listener_free(handoff_listener_t *lst)
+{
+	if (lst == NULL) {
+		return;
+	}
+
+	uint8_t byte = 0;
+	(void)write(lst->stop[1], &byte, sizeof(byte));
+	pthread_join(lst->thread, NULL);
+
+	close(lst->stop[0]);
+	close(lst->stop[1]);
+	close(lst->sock);
+	free(lst);
+}
@@ -0,0 +1,101 @@
+/*  Copyright (C) 2024 CZ.NIC, z.s.p.o. <knot-dns@labs.nic.cz>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <sys/socket.h>
+
+struct server;
+
+/*!
+ * \brief Hand-off of the listening sockets between server instances.
+ *
+ * A running server listens on a UNIX socket, where a newly started server
+ * receives duplicates of all the UDP, TCP, QUIC, and TLS listening sockets.
+ * The new server uses them instead of binding its own ones, so that no queued
+ * query is lost. Meanwhile, the old server keeps answering until the new one
+ * has loaded its zones, started, and confirmed the hand-off. The old server
+ * stops then. XDP sockets aren't handed off.
+ */
+
+/*! \brief Listening socket received from the old server. */
+typedef struct {
+	struct sockaddr_storage addr;
+	int type;  /*!< SOCK_DGRAM or SOCK_STREAM. */
+	int fd;    /*!< Socket, -1 if taken. */
+} handoff_sock_t;
+
+/*! \brief Sockets taken over from the old server. */
+typedef struct {
+	bool active;           /*!< Hand-off in progress. */
+	int conn;              /*!< Connection to the old server. */
+	handoff_sock_t *socks;
+	size_t count;
+} handoff_t;
+
+/*!
+ * \brief Receive the listening sockets from the running server.
+ *
+ * \param ho     Hand-off context to be initialized.
+ * \param path   UNIX socket path of the running server.
+ *
+ * \return KNOT_E*
+ */
+int handoff_receive(handoff_t *ho, const char *path);
+
+/*!
+ * \brief Take over a received socket.
+ *
+ * \param ho     Hand-off context.
+ * \param type   Socket type.
+ * \param addr   Bound address.
+ *
+ * \return Socket, or KNOT_ENOENT if no (more) such socket was received.
+ */
+int handoff_take(handoff_t *ho, int type, const struct sockaddr_storage *addr);
+
+/*!
+ * \brief Finish the hand-off, close the sockets not taken over.
+ *
+ * \param ho        Hand-off context.
+ * \param confirm   Let the old server stop, otherwise it continues.
+ */
+void handoff_finish(handoff_t *ho, bool confirm);
+
+typedef struct handoff_listener handoff_listener_t;
+
+/*!
+ * \brief Start listening for a new server to hand the sockets off.
+ *
+ * Once a new server confirms the hand-off, ServerHandedOff is set and the
+ * server is requested to stop via SIGTERM.
+ *
+ * \param server   Running server.
+ * \param path     UNIX socket path.
+ *
+ * \return Listener or NULL if failed.
+ */
+handoff_listener_t *handoff_listen(struct server *server, const char *path);
+
+/*!
+ * \brief Stop listening for a new server.
+ *
+ * \note The socket file isn't removed as it may be the new server's one.
+ */
+void handoff_listener_free(handoff_listener_t *lst);
@@ -0,0 +1,549 @@
+/*  Copyright (C) 2024 CZ.NIC, z.s.p.o. <knot-dns@labs.nic.cz>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+
+#include <errno.h>
+#include <poll.h>
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#include <urcu.h>
+
+#include "knot/server/notify_batch.h"
+#include "knot/events/handlers.h"
+#include "knot/nameserver/tsig_ctx.h"
+#include "knot/query/query.h"
+#include "knot/server/server.h"
+#include "knot/zone/zonedb.h"
+#include "contrib/macros.h"
+#include "contrib/net.h"
+#include "contrib/qp-trie/trie.h"
+#include "contrib/sockaddr.h"
+#include "contrib/time.h"
+#include "contrib/ucw/lists.h"
+#include "libdnssec/random.h"
+#include "libknot/libknot.h"
+
+#define BATCH_MAX       4096 // Maximal number of messages sent together.
+#define BATCH_DELAY_US 10000 // Time to let more messages queue up.
+#define NOTIFY_TRIES       3 // Transmissions to one remote address.
+#define POLL_MAX_MS     1000
+
+typedef struct {
+	struct sockaddr_storage addr;
+	struct sockaddr_storage via;
+	knot_tsig_key_t key;
+} notify_addr_t;
+
+typedef struct {
+	node_t n;
+	knot_rrset_t *soa;     // Owner is the zone name.
+	notifailed_rmt_hash hash;
+	notify_addr_t *addrs;
+	size_t addr_count;
+	size_t addr_idx;       // Currently used remote address.
+	int timeout_ms;
+	bool retry;
+	bool queued;           // Present in the aggregation trie.
+	// Sending state.
+	tsig_ctx_t tsig;
+	unsigned tries;
+	double deadline;       // Milliseconds since the batch start.
+	bool done;
+	int ret;
+	int rcode;
+} notify_msg_t;
+
+struct notify_batch {
+	pthread_t thread;
+	pthread_mutex_t mx;
+	pthread_cond_t cond;
+	trie_t *queued;       // Zone name + remote hash -> notify_msg_t.
+	list_t queue;         // Messages to be sent.
+	notify_msg_t **run;   // Messages being processed.
+	struct server *server;
+	size_t rate;
+	bool stop;
+};
+
+static size_t msg_key(const knot_dname_t *zone, notifailed_rmt_hash hash,
+                      uint8_t key[KNOT_DNAME_MAXLEN + sizeof(hash)])
+{
+	size_t zone_size = knot_dname_size(zone);
+	memcpy(key, zone, zone_size);
+	memcpy(key + zone_size, &hash, sizeof(hash));
+	return zone_size + sizeof(hash);
+}
+
+static void msg_free(notify_msg_t *msg)
+{
+	for (size_t i = 0; i < msg->addr_count; i++) {
+		knot_tsig_key_deinit(&msg->addrs[i].key);
+	}
+	free(msg->addrs);
+	knot_rrset_free(msg->soa, NULL);
+	tsig_cleanup(&msg->tsig);
+	free(msg);
+}
+
+static int msg_cmp(const void *a, const void *b)
+{
+	const notify_msg_t *m1 = *(const notify_msg_t **)a;
+	const notify_msg_t *m2 = *(const notify_msg_t **)b;
+	const notify_addr_t *a1 = &m1->addrs[m1->addr_idx];
+	const notify_addr_t *a2 = &m2->addrs[m2->addr_idx];
+
+	int ret = sockaddr_cmp(&a1->addr, &a2->addr, false);
+	if (ret == 0) {
+		ret = sockaddr_cmp(&a1->via, &a2->via, false);
+	}
+	return ret;
+}
+
+static int msg_send(int fd, notify_msg_t *msg, knot_pkt_t *pkt, uint16_t id)
+{
+	const knot_tsig_key_t *key = &msg->addrs[msg->addr_idx].key;
+
+	knot_pkt_clear(pkt);
+	query_init_pkt(pkt);
+	knot_wire_set_id(pkt->wire, id);
+	knot_wire_set_opcode(pkt->wire, KNOT_OPCODE_NOTIFY);
+	knot_wire_set_aa(pkt->wire);
+
+	int ret = knot_pkt_put_question(pkt, msg->soa->owner, KNOT_CLASS_IN, KNOT_RRTYPE_SOA);
+	if (ret == KNOT_EOK) {
+		ret = knot_pkt_reserve(pkt, knot_tsig_wire_size(key));
+	}
+	if (ret == KNOT_EOK) {
+		knot_pkt_begin(pkt, KNOT_ANSWER);
+		ret = knot_pkt_put(pkt, KNOT_COMPR_HINT_QNAME, msg->soa, 0);
+	}
+	if (ret == KNOT_EOK) {
+		tsig_cleanup(&msg->tsig);
+		tsig_init(&msg->tsig, key->name != NULL ? key : NULL);
+		ret = tsig_sign_packet(&msg->tsig, pkt);
+	}
+	if (ret != KNOT_EOK) {
+		return ret;
+	}
+
+	ssize_t sent = net_dgram_send(fd, pkt->wire, pkt->size, NULL);
+	return (sent == pkt->size) ? KNOT_EOK : KNOT_ECONN;
+}
+
+static bool msg_recv(notify_msg_t *msg, knot_pkt_t *pkt)
+{
+	if (msg->done || knot_pkt_parse(pkt, 0) != KNOT_EOK ||
+	    knot_wire_get_opcode(pkt->wire) != KNOT_OPCODE_NOTIFY ||
+	    !knot_dname_is_equal(knot_pkt_qname(pkt), msg->soa->owner)) {
+		return false;
+	}
+
+	// A response to an earlier transmission doesn't match the last signature.
+	if (tsig_verify_packet(&msg->tsig, pkt) != KNOT_EOK ||
+	    tsig_unsigned_count(&msg->tsig) != 0) {
+		return false;
+	}
+
+	msg->rcode = knot_pkt_ext_rcode(pkt);
+	msg->ret = (msg->rcode == KNOT_RCODE_NOERROR) ? KNOT_EOK : KNOT_EDENIED;
+	msg->done = true;
+	return true;
+}
+
+/*!
+ * Sends the messages grouped by the remote address, each group over its own
+ * UDP socket, with the rate limit (zero for unlimited). Unanswered messages
+ * are retransmitted.
+ */
+static void batch_run(notify_msg_t **msgs, size_t count, size_t rate)
+{
+	qsort(msgs, count, sizeof(*msgs), msg_cmp);
+
+	struct pollfd *fds = calloc(count, sizeof(*fds));
+	size_t *firsts = calloc(count + 1, sizeof(*firsts));
+	size_t *groups_of = calloc(count, sizeof(*groups_of));
+	uint16_t *ids = calloc(count, sizeof(*ids));
+	knot_pkt_t *pkt = knot_pkt_new(NULL, KNOT_WIRE_MAX_PKTSIZE, NULL);
+	if (fds == NULL || firsts == NULL || groups_of == NULL || ids == NULL || pkt == NULL) {
+		for (size_t i = 0; i < count; i++) {
+			msgs[i]->ret = KNOT_ENOMEM;
+		}
+		goto cleanup;
+	}
+
+	size_t groups = 0, pending = count;
+	for (size_t i = 0, next; i < count; i = next) {
+		for (next = i + 1; next < count && msg_cmp(&msgs[i], &msgs[next]) == 0; next++);
+
+		const notify_addr_t *addr = &msgs[i]->addrs[msgs[i]->addr_idx];
+		firsts[groups] = i;
+		ids[groups] = dnssec_random_uint16_t();
+		fds[groups].events = POLLIN;
+		fds[groups].fd = net_connected_socket(SOCK_DGRAM, &addr->addr, &addr->via, false);
+		for (size_t j = i; j < next; j++) {
+			groups_of[j] = groups;
+			if (fds[groups].fd < 0) {
+				msgs[j]->ret = fds[groups].fd;
+				msgs[j]->done = true;
+				pending--;
+			}
+		}
+		groups++;
+	}
+	firsts[groups] = count;
+
+	// Token bucket allowing short bursts of a tenth of the rate.
+	size_t burst = MAX(1, rate / 10), sent = 0;
+	int send_interval = (rate > 0) ? MAX(1, 1000 / rate) : 1;
+
+	struct timespec begin = time_now();
+	while (pending > 0) {
+		struct timespec now_ts = time_now();
+		double now = time_diff_ms(&begin, &now_ts);
+		size_t allowed = (rate > 0) ? burst + rate * now / 1000 : SIZE_MAX;
+
+		int wait = POLL_MAX_MS;
+		for (size_t i = 0; i < count; i++) {
+			notify_msg_t *msg = msgs[i];
+			if (msg->done) {
+				continue;
+			} else if (msg->tries > 0 && msg->deadline > now) {
+				wait = MIN(wait, (int)(msg->deadline - now) + 1);
+				continue;
+			} else if (msg->tries == NOTIFY_TRIES) {
+				msg->ret = KNOT_ETIMEOUT;
+				msg->done = true;
+				pending--;
+				continue;
+			} else if (sent >= allowed) {
+				wait = MIN(wait, send_interval);
+				continue;
+			}
+
+			size_t g = groups_of[i];
+			uint16_t id = ids[g] + (i - firsts[g]);
+			int ret = msg_send(fds[g].fd, msg, pkt, id);
+			if (ret != KNOT_EOK) {
+				msg->ret = ret;
+				msg->done = true;
+				pending--;
+				continue;
+			}
+			msg->tries++;
+			msg->deadline = now + msg->timeout_ms;
+			wait = MIN(wait, msg->timeout_ms);
+			sent++;
+		}
+		if (pending == 0) {
+			break;
+		}
+
+		int ret = poll(fds, groups, wait);
+		if (ret < 0 && errno != EINTR) {
+			break;
+		} else if (ret <= 0) {
+			continue;
+		}
+
+		for (size_t g = 0; g < groups; g++) {
+			if (fds[g].revents == 0) {
+				continue;
+			}
+			ssize_t len;
+			while (knot_pkt_clear(pkt),
+			       (len = recv(fds[g].fd, pkt->wire, pkt->max_size, MSG_DONTWAIT)) > 0) {
+				pkt->size = len;
+				uint16_t idx = knot_wire_get_id(pkt->wire) - ids[g];
+				if (idx < firsts[g + 1] - firsts[g] &&
+				    msg_recv(msgs[firsts[g] + idx], pkt)) {
+					pending--;
+				}
+			}
+			if (len < 0 && errno != EAGAIN && errno != EWOULDBLOCK) {
+				// E.g. ICMP unreachable, give up the remote address.
+				for (size_t i = firsts[g]; i < firsts[g + 1]; i++) {
+					if (!msgs[i]->done) {
+						msgs[i]->ret = knot_map_errno();
+						msgs[i]->done = true;
+						pending--;
+					}
+				}
+				close(fds[g].fd);
+				fds[g].fd = -1;
+			}
+		}
+	}
+
+	for (size_t g = 0; g < groups; g++) {
+		if (fds[g].fd >= 0) {
+			close(fds[g].fd);
+		}
+	}
+cleanup:
+	knot_pkt_free(pkt);
+	free(ids);
+	free(groups_of);
+	free(firsts);
+	free(fds);
+}
+
+static void msg_finish(struct server *server, notify_msg_t *msg)
+{
+	const notify_addr_t *addr = &msg->addrs[msg->addr_idx];
+	conf_remote_t remote = {
+		.addr = addr->addr,
+		.via = addr->via,
+		.key = addr->key,
+	};
+
+	rcu_read_lock();
+	zone_t *zone = knot_zonedb_find(server->zone_db, msg->soa->owner);
+	if (zone != NULL) {
+		event_notify_result(conf(), zone, &remote, msg->hash, msg->soa,
+		                    msg->retry, msg->ret, msg->rcode);
+	}
+	rcu_read_unlock();
+}
+
+static void *batch_thread(void *arg)
+{
+	notify_batch_t *batch = arg;
+
+	rcu_register_thread();
+
+	pthread_mutex_lock(&batch->mx);
+	while (true) {
+		while (EMPTY_LIST(batch->queue) && !batch->stop) {
+			pthread_cond_wait(&batch->cond, &batch->mx);
+		}
+		if (batch->stop) {
+			break;
+		}
+
+		// Let more zones become due.
+		pthread_mutex_unlock(&batch->mx);
+		usleep(BATCH_DELAY_US);
+		pthread_mutex_lock(&batch->mx);
+
+		size_t count = 0;
+		notify_msg_t *msg, *next;
+		WALK_LIST_DELSAFE(msg, next, batch->queue) {
+			if (count == BATCH_MAX) {
+				break;
+			}
+			rem_node(&msg->n);
+			if (msg->queued) {
+				uint8_t key[KNOT_DNAME_MAXLEN + sizeof(msg->hash)];
+				size_t key_len = msg_key(msg->soa->owner, msg->hash, key);
+				trie_del(batch->queued, key, key_len, NULL);
+				msg->queued = false;
+			}
+			batch->run[count++] = msg;
+		}
+		size_t rate = batch->rate;
+		pthread_mutex_unlock(&batch->mx);
+
+		batch_run(batch->run, count, rate); // Disabled meanwhile -> unlimited.
+
+		// Failed messages continue with the next remote address.
+		for (size_t i = 0; i < count; i++) {
+			msg = batch->run[i];
+			if (msg->ret != KNOT_EOK && msg->addr_idx + 1 < msg->addr_count) {
+				msg->addr_idx++;
+				msg->tries = 0;
+				msg->done = false;
+				msg->rcode = 0;
+				pthread_mutex_lock(&batch->mx);
+				add_tail(&batch->queue, &msg->n);
+				pthread_mutex_unlock(&batch->mx);
+				continue;
+			}
+			msg_finish(batch->server, msg);
+			msg_free(msg);
+		}
+
+		pthread_mutex_lock(&batch->mx);
+	}
+
+	notify_msg_t *msg, *next;
+	WALK_LIST_DELSAFE(msg, next, batch->queue) {
+		msg_free(msg);
+	}
+	pthread_mutex_unlock(&batch->mx);
+
+	rcu_unregister_thread();
+
+	return NULL;
+}
+
+notify_batch_t *notify_batch_init(struct server *server)
+{
+	notify_batch_t *batch = calloc(1, sizeof(*batch));
+	if (batch == NULL) {
+		return NULL;
+	}
+
+	batch->queued = trie_create(NULL);
+	batch->run = calloc(BATCH_MAX, sizeof(*batch->run));
+	if (batch->queued == NULL || batch->run == NULL) {
+		trie_free(batch->queued);
+		free(batch->run);
+		free(batch);
+		return NULL;
+	}
+
+	pthread_mutex_init(&batch->mx, NULL);
+	pthread_cond_init(&batch->cond, NULL);
+	init_list(&batch->queue);
+	batch->server = server;
+
+	if (pthread_create(&batch->thread, NULL, batch_thread, batch) != 0) {
+		pthread_cond_destroy(&batch->cond);
+		pthread_mutex_destroy(&batch->mx);
+		trie_free(batch->queued);
+		free(batch->run);
+		free(batch);
+		return NULL;
+	}
+
+	return batch;
+}
+
+void notify_batch_deinit(notify_batch_t **batch)
+{
+	if (batch == NULL || *batch == NULL) {
+		return;
+	}
+
+	notify_batch_t *b = *batch;
+	*batch = NULL;
+
+	pthread_mutex_lock(&b->mx);
+	b->stop = true;
+	pthread_cond_signal(&b->cond);
+	pthread_mutex_unlock(&b->mx);
+
+	pthread_join(b->thread, NULL);
+
+	trie_free(b->queued);
+	free(b->run);
+	pthread_cond_destroy(&b->cond);
+	pthread_mutex_destroy(&b->mx);
+	free(b);
+}
+
+void notify_batch_set_rate(notify_batch_t *batch, size_t rate)
+{
+	if (batch == NULL) {
+		return;
+	}
+
+	pthread_mutex_lock(&batch->mx);
+	batch->rate = rate;
+	pthread_mutex_unlock(&batch->mx);
+}
+
+static notify_msg_t *msg_new(conf_t *conf, const knot_rrset_t *soa, conf_val_t *rmt_id,
+                             notifailed_rmt_hash hash, int timeout_ms, bool retry)
+{
+	conf_val_t val = conf_id_get(conf, C_RMT, C_ADDR, rmt_id);
+	size_t count = conf_val_count(&val);
+	if (count == 0) {
+		return NULL;
+	}
+
+	notify_msg_t *msg = calloc(1, sizeof(*msg));
+	if (msg == NULL) {
+		return NULL;
+	}
+	msg->addrs = calloc(count, sizeof(*msg->addrs));
+	msg->soa = knot_rrset_copy(soa, NULL);
+	if (msg->addrs == NULL || msg->soa == NULL) {
+		msg_free(msg);
+		return NULL;
+	}
+
+	for (size_t i = 0; i < count; i++) {
+		conf_remote_t remote = conf_remote(conf, rmt_id, i);
+		if (remote.quic || remote.tls) {
+			msg_free(msg);
+			return NULL;
+		}
+		msg->addrs[i].addr = remote.addr;
+		msg->addrs[i].via = remote.via;
+		if (remote.key.name != NULL &&
+		    knot_tsig_key_copy(&msg->addrs[i].key, &remote.key) != KNOT_EOK) {
+			msg_free(msg);
+			return NULL;
+		}
+		msg->addr_count++;
+	}
+	msg->hash = hash;
+	msg->timeout_ms = timeout_ms;
+	msg->retry = retry;
+
+	return msg;
+}
+
+int notify_batch_send(notify_batch_t *batch, conf_t *conf, const knot_rrset_t *soa,
+                      conf_val_t *rmt_id, notifailed_rmt_hash hash, int timeout_ms,
+                      bool retry)
+{
+	if (batch == NULL) {
+		return KNOT_ENOTSUP;
+	} else if (conf == NULL || soa == NULL || rmt_id == NULL) {
+		return KNOT_EINVAL;
+	}
+
+	pthread_mutex_lock(&batch->mx);
+	bool enabled = (batch->rate > 0 && !batch->stop);
+	pthread_mutex_unlock(&batch->mx);
+	if (!enabled) {
+		return KNOT_ENOTSUP;
+	}
+
+	notify_msg_t *msg = msg_new(conf, soa, rmt_id, hash, timeout_ms, retry);
+	if (msg == NULL) {
+		return KNOT_ENOTSUP; // Also TLS or QUIC remote.
+	}
+
+	uint8_t key[KNOT_DNAME_MAXLEN + sizeof(hash)];
+	size_t key_len = msg_key(soa->owner, hash, key);
+
+	pthread_mutex_lock(&batch->mx);
+	trie_val_t *val = trie_get_ins(batch->queued, key, key_len);
+	if (val == NULL) {
+		pthread_mutex_unlock(&batch->mx);
+		msg_free(msg);
+		return KNOT_ENOMEM;
+	}
+	if (*val != NULL) { // Replace the queued NOTIFY with the new serial.
+		notify_msg_t *prev = *val;
+		msg->retry = msg->retry && prev->retry;
+		rem_node(&prev->n);
+		msg_free(prev);
+	}
+	*val = msg;
+	msg->queued = true;
+	add_tail(&batch->queue, &msg->n);
+	pthread_cond_signal(&batch->cond);
+	pthread_mutex_unlock(&batch->mx);
+
+	return KNOT_EOK;
+}
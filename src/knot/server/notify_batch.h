@@ -0,0 +1,77 @@
+/*  Copyright (C) 2024 CZ.NIC, z.s.p.o. <knot-dns@labs.nic.cz>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+
+#pragma once
+
+#include "knot/conf/conf.h"
+#include "knot/zone/zone.h"
+
+struct server;
+
+/*!
+ * \brief Scheduled sending of NOTIFY messages over UDP.
+ *
+ * NOTIFYs of all zones are queued for a dedicated thread, which aggregates
+ * repeated NOTIFYs of a zone to the same remote, groups the queued messages
+ * by the remote address, and sends them over one UDP socket per remote with
+ * a limited rate. Unanswered messages are retransmitted and then sent to
+ * the next address of the remote. The results are processed by
+ * event_notify_result().
+ */
+typedef struct notify_batch notify_batch_t;
+
+/*!
+ * \brief Start the NOTIFY sending thread.
+ *
+ * \param server   Server whose zones are notified.
+ *
+ * \return Allocated scheduler, or NULL.
+ */
+notify_batch_t *notify_batch_init(struct server *server);
+
+/*!
+ * \brief Stop the NOTIFY sending thread, drop pending messages.
+ */
+void notify_batch_deinit(notify_batch_t **batch);
+
+/*!
+ * \brief Set the maximal rate of sent messages.
+ *
+ * \param batch   NOTIFY scheduler.
+ * \param rate    Messages per second, 0 disables the scheduler.
+ */
+void notify_batch_set_rate(notify_batch_t *batch, size_t rate);
+
+/*!
+ * \brief Queue a NOTIFY of the zone to the remote.
+ *
+ * \param batch        NOTIFY scheduler.
+ * \param conf         Configuration.
+ * \param soa          Zone SOA to be sent, its owner is the zone name.
+ * \param rmt_id       Remote identifier.
+ * \param hash         Remote identifier hash (see zone notifailed).
+ * \param timeout_ms   Response timeout of one transmission.
+ * \param retry        The NOTIFY is a retry after a failure.
+ *
+ * \retval KNOT_EOK      The NOTIFY is queued or aggregated with a queued one.
+ * \retval KNOT_ENOTSUP  The scheduler is disabled or the remote isn't
+ *                       reachable over plain UDP.
+ * \return KNOT_E*
+ */
+int notify_batch_send(notify_batch_t *batch, conf_t *conf, const knot_rrset_t *soa,
+                      conf_val_t *rmt_id, notifailed_rmt_hash hash, int timeout_ms,
+                      bool retry);
@@ -19,7 +19,7 @@
 #include "contrib/proxyv2/proxyv2.h"
 #include "knot/conf/conf.h"
 
-int proxyv2_header_strip(knot_pkt_t **query,
+int proxyv2_header_strip(struct iovec *payload,
                          const struct sockaddr_storage *remote,
                          struct sockaddr_storage *new_remote)
 {
@@ -28,8 +28,8 @@ int proxyv2_header_strip(knot_pkt_t **query,
 		return KNOT_EDENIED;
 	}
 
-	uint8_t *pkt = (*query)->wire;
-	size_t pkt_len = (*query)->max_size;
+	uint8_t *pkt = payload->iov_base;
+	size_t pkt_len = payload->iov_len;
 
 	int offset = proxyv2_header_offset(pkt, pkt_len);
 	if (offset <= 0) {
@@ -54,16 +54,10 @@ int proxyv2_header_strip(knot_pkt_t **query,
 	}
 
 	/*
-	 * Re-parse the query message using the data in the
-	 * packet following the PROXY v2 payload. And replace the original
-	 * query with the decapsulated one.
+	 * Skip the PROXY v2 payload in place, the query message follows it.
 	 */
-	knot_pkt_t *q = knot_pkt_new(pkt + offset, pkt_len - offset, &(*query)->mm);
-	if (q == NULL) {
-		return KNOT_ENOMEM;
-	}
-	knot_pkt_free(*query);
-	*query = q;
+	payload->iov_base = pkt + offset;
+	payload->iov_len = pkt_len - offset;
 
-	return knot_pkt_parse(q, 0);
+	return KNOT_EOK;
 }
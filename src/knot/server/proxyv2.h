@@ -16,8 +16,18 @@
 
 #pragma once
 
-#include "libknot/packet/pkt.h"
+#include <sys/socket.h>
+#include <sys/uio.h>
 
-int proxyv2_header_strip(knot_pkt_t **query,
+/*!
+ * \brief Skips the PROXY v2 header in the received payload (no copying).
+ *
+ * \param payload     In/out: received payload, advanced to the DNS message.
+ * \param remote      Address of the sender (must be allowed to proxy).
+ * \param new_remote  Output: proxied remote address.
+ *
+ * \return KNOT_EOK if stripped, KNOT_EDENIED or KNOT_EMALF if not applicable.
+ */
+int proxyv2_header_strip(struct iovec *payload,
                          const struct sockaddr_storage *remote,
                          struct sockaddr_storage *new_remote);
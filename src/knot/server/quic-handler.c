@@ -19,7 +19,9 @@
 #endif
 
 #include <netinet/in.h>
+#include <netinet/udp.h>
 #include <string.h>
+#include <time.h>
 
 #include "contrib/macros.h"
 #include "contrib/net.h"
@@ -33,11 +35,36 @@
 
 #define SWEEP_BUF_SIZE 4096
 
+#define GSO_MAX_SEGMENTS	64		/*!< Kernel limit for one GSO send. */
+#define GSO_MAX_LEN		(KNOT_WIRE_MAX_PKTSIZE - 48)
+#define PACING_HORIZON		100000000LU	/*!< [ns] Max delay of a paced send. */
+
 typedef union {
 	struct cmsghdr cmsg;
 	uint8_t buf[CMSG_SPACE(sizeof(struct in6_pktinfo))];
 } cmsg_pktinfo_t;
 
+/*! \brief Received control messages extended with UDP_SEGMENT and SCM_TXTIME. */
+typedef union {
+	struct cmsghdr cmsg;
+	uint8_t buf[CMSG_SPACE(sizeof(struct in6_pktinfo)) + 2 * CMSG_SPACE(sizeof(int)) +
+	            CMSG_SPACE(sizeof(uint16_t)) + CMSG_SPACE(sizeof(uint64_t))];
+} cmsg_offload_t;
+
+/*! \brief Output datagrams of one connection coalesced into one (GSO) send. */
+typedef struct {
+	struct msghdr *msg; /*!< Output message header. */
+	int *p_ecn;         /*!< Outgoing ECN in the control message. */
+	uint8_t *base;      /*!< Start of the output buffer. */
+	size_t len;         /*!< Total length of coalesced datagrams. */
+	uint16_t size;      /*!< Segment size (length of the first datagram). */
+	uint16_t count;     /*!< Number of coalesced datagrams. */
+	uint8_t ecn;        /*!< ECN of the coalesced datagrams. */
+	bool closed;        /*!< A shorter datagram has terminated the chain. */
+	uint64_t rate;      /*!< [B/s] Pacing rate, zero if pacing disabled. */
+	uint64_t txtime;    /*!< [ns] Transmit time of the next send, zero if now. */
+} uq_out_t;
+
 static void quic_log_cb(const char *line)
 {
 	log_fmt(LOG_DEBUG, LOG_SOURCE_QUIC, "QUIC, %s", line);
@@ -73,10 +100,161 @@ static void uq_free_reply(knot_quic_reply_t *r)
 	r->out_payload->iov_len = 0;
 }
 
+static size_t uq_cmsg_append(cmsg_offload_t *buf, size_t offset, int level,
+                             int type, const void *data, size_t data_len)
+{
+	struct cmsghdr *cmsg = (struct cmsghdr *)(buf->buf + offset);
+	memset(cmsg, 0, CMSG_SPACE(data_len));
+	cmsg->cmsg_level = level;
+	cmsg->cmsg_type = type;
+	cmsg->cmsg_len = CMSG_LEN(data_len);
+	memcpy(CMSG_DATA(cmsg), data, data_len);
+
+	return offset + CMSG_SPACE(data_len);
+}
+
+static int uq_send_chain(int fd, uq_out_t *out, bool offload)
+{
+	struct msghdr *msg = out->msg;
+	void *control = msg->msg_control;
+	size_t controllen = msg->msg_controllen;
+
+	cmsg_offload_t buf;
+	size_t extra = CMSG_SPACE(sizeof(uint16_t)) + CMSG_SPACE(sizeof(uint64_t));
+	if (offload && CMSG_ALIGN(controllen) + extra <= sizeof(buf)) {
+		if (controllen > 0) {
+			memcpy(buf.buf, control, controllen);
+		}
+		size_t offset = CMSG_ALIGN(controllen);
+#ifdef UDP_SEGMENT
+		if (out->count > 1) {
+			offset = uq_cmsg_append(&buf, offset, SOL_UDP, UDP_SEGMENT,
+			                        &out->size, sizeof(out->size));
+		}
+#endif
+#ifdef SCM_TXTIME
+		if (out->txtime > 0) {
+			offset = uq_cmsg_append(&buf, offset, SOL_SOCKET, SCM_TXTIME,
+			                        &out->txtime, sizeof(out->txtime));
+		}
+#endif
+		msg->msg_control = offset > 0 ? &buf : NULL;
+		msg->msg_controllen = offset;
+	} else if (out->count > 1) {
+		return KNOT_ERANGE;
+	}
+
+	int ret = sendmsg(fd, msg, 0);
+
+	msg->msg_control = control;
+	msg->msg_controllen = controllen;
+
+	return ret == out->len ? KNOT_EOK : (ret < 0 ? knot_map_errno() : KNOT_EAGAIN);
+}
+
+static int uq_flush(knot_quic_reply_t *r)
+{
+	uq_out_t *out = r->out_ctx;
+	if (out->count == 0) {
+		return KNOT_EOK;
+	}
+
+	int fd = *(int *)r->sock;
+	struct iovec *iov = out->msg->msg_iov;
+	if (out->p_ecn != NULL) {
+		*out->p_ecn = out->ecn; // set ECN for outgoing CMSG
+	}
+
+	iov->iov_base = out->base;
+	iov->iov_len = out->len;
+	int ret = uq_send_chain(fd, out, true);
+	if (ret != KNOT_EOK && (out->count > 1 || out->txtime > 0)) {
+		/* Possibly unsupported offload, retry datagram by datagram. */
+		out->rate = 0;
+		uq_out_t single = *out;
+		single.count = 1;
+		single.txtime = 0;
+		for (size_t off = 0; off < out->len; off += out->size) {
+			iov->iov_base = out->base + off;
+			iov->iov_len = single.len = MIN(out->size, out->len - off);
+			ret = uq_send_chain(fd, &single, false);
+		}
+	}
+
+	if (out->rate > 0) {
+		struct timespec ts;
+		clock_gettime(CLOCK_MONOTONIC, &ts);
+		uint64_t now = (uint64_t)ts.tv_sec * 1000000000LU + ts.tv_nsec;
+		uint64_t next = MAX(out->txtime, now) + out->len * 1000000000LU / out->rate;
+		out->txtime = MIN(next, now + PACING_HORIZON);
+	}
+
+	iov->iov_base = out->base;
+	out->len = 0;
+	out->count = 0;
+	out->closed = false;
+
+	return ret;
+}
+
+static int uq_alloc_gso(knot_quic_reply_t *r)
+{
+	uq_out_t *out = r->out_ctx;
+	r->out_payload->iov_base = out->base + out->len;
+	r->out_payload->iov_len = KNOT_WIRE_MAX_PKTSIZE - out->len;
+
+	return KNOT_EOK;
+}
+
+static int uq_send_gso(knot_quic_reply_t *r)
+{
+	uq_out_t *out = r->out_ctx;
+	size_t len = r->out_payload->iov_len;
+	int ret = KNOT_EOK;
+
+	if (out->count > 0 && (out->closed || len > out->size || r->ecn != out->ecn ||
+	                       out->count >= GSO_MAX_SEGMENTS)) {
+		size_t pos = out->len;
+		ret = uq_flush(r);
+		memmove(out->base, out->base + pos, len);
+	}
+
+	if (out->count == 0) {
+		out->size = len;
+		out->ecn = r->ecn;
+	} else if (len < out->size) {
+		out->closed = true;
+	}
+	out->len += len;
+	out->count++;
+
+	// Ensure space for another full-sized datagram.
+	if (out->len + out->size > GSO_MAX_LEN) {
+		int fret = uq_flush(r);
+		ret = (ret == KNOT_EOK) ? fret : ret;
+	}
+
+	return ret;
+}
+
+static void uq_free_gso(knot_quic_reply_t *r)
+{
+	uq_out_t *out = r->out_ctx;
+	r->out_payload->iov_base = out->base;
+	r->out_payload->iov_len = 0;
+}
+
 void quic_handler(knotd_qdata_params_t *params, knot_layer_t *layer,
                   uint64_t idle_close, knot_quic_table_t *table,
-                  struct iovec *rx, struct msghdr *mh_out, int *p_ecn)
+                  struct iovec *rx, struct msghdr *mh_out, int *p_ecn,
+                  bool offload)
 {
+	uq_out_t out = {
+		.msg = mh_out,
+		.p_ecn = p_ecn,
+		.base = mh_out->msg_iov->iov_base,
+	};
+
 	knot_quic_reply_t rpl = {
 		.ip_rem = params->remote,
 		.ip_loc = params->local,
@@ -90,6 +268,12 @@ void quic_handler(knotd_qdata_params_t *params, knot_layer_t *layer,
 		.send_reply = uq_send_reply,
 		.free_reply = uq_free_reply
 	};
+	if (offload) {
+		rpl.out_ctx = &out;
+		rpl.alloc_reply = uq_alloc_gso;
+		rpl.send_reply = uq_send_gso;
+		rpl.free_reply = uq_free_gso;
+	}
 
 	rpl.out_payload->iov_len = 0; // prevent send attempt if uq_alloc_reply is not called at all
 
@@ -103,15 +287,23 @@ void quic_handler(knotd_qdata_params_t *params, knot_layer_t *layer,
 	if (conn != NULL) {
 		handle_quic_streams(conn, params, layer);
 
+		if (offload) {
+			out.rate = knot_quic_conn_pacing_rate(conn);
+		}
 		(void)knot_quic_send(table, conn, &rpl, QUIC_MAX_SEND_PER_RECV, 0);
 
 		knot_quic_cleanup(&conn, 1);
 	}
 
+	if (offload) {
+		(void)uq_flush(&rpl);
+		uq_free_gso(&rpl);
+	}
+
 	(void)process_query_proto(params, KNOTD_STAGE_PROTO_END);
 }
 
-knot_quic_table_t *quic_make_table(struct server *server)
+knot_quic_table_t *quic_make_table(struct server *server, int worker)
 {
 	conf_t *pconf = conf();
 	size_t udp_pl = MIN(pconf->cache.srv_udp_max_payload_ipv4,
@@ -127,6 +319,10 @@ knot_quic_table_t *quic_make_table(struct server *server)
 	if (table != NULL && log_enabled_quic_debug()) {
 		table->log_cb = quic_log_cb;
 	}
+	if (table != NULL && worker >= 0 && worker <= UINT8_MAX) {
+		table->flags |= KNOT_QUIC_TABLE_CID_WORKER;
+		table->cid_worker = worker;
+	}
 
 	return table;
 }
@@ -35,19 +35,24 @@ struct server;
  * \param rx            Incoming packet payload.
  * \param mh_out        Msghdr for outgoing packets.
  * \param p_ecn         Pointer on in/out ECN in cmsg header.
+ * \param offload       Coalesce outgoing packets (UDP_SEGMENT) and pace them
+ *                      (SCM_TXTIME).
  */
 void quic_handler(knotd_qdata_params_t *params, knot_layer_t *layer,
                   uint64_t idle_close, knot_quic_table_t *table,
-                  struct iovec *rx, struct msghdr *mh_out, int *p_ecn);
+                  struct iovec *rx, struct msghdr *mh_out, int *p_ecn,
+                  bool offload);
 
 /*!
  * \brief Allocate QUIC connection table.
  *
  * \param server    Server.
+ * \param worker    Index of the UDP socket within the reuseport group to be
+ *                  encoded into the local connection IDs, negative if none.
  *
  * \return QUIC connection table, or NULL.
  */
-knot_quic_table_t *quic_make_table(struct server *server);
+knot_quic_table_t *quic_make_table(struct server *server, int worker);
 
 /*!
  * \brief Change QUIC configuration while running.
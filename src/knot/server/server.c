@@ -19,19 +19,25 @@
 #endif
 
 #include <assert.h>
+#include <fcntl.h>
 #include <gnutls/x509.h>
 #include <sys/types.h>   // OpenBSD
 #include <netinet/tcp.h> // TCP_FASTOPEN
 #include <sys/resource.h>
+#include <unistd.h>
+#include <urcu.h>
 
 #include "libknot/libknot.h"
 #include "libknot/yparser/ypschema.h"
 #include "libknot/xdp.h"
 #include "libknot/quic/tls.h"
+#include "libdnssec/error.h"
+#include "libdnssec/random.h"
 #ifdef ENABLE_QUIC
 #include "libknot/quic/quic.h" // knot_quic_session_*
 #endif // ENABLE_QUIC
 #include "knot/common/log.h"
+#include "knot/common/reclaim.h"
 #include "knot/common/stats.h"
 #include "knot/common/systemd.h"
 #include "knot/common/unreachable.h"
@@ -39,7 +45,9 @@
 #include "knot/conf/migration.h"
 #include "knot/conf/module.h"
 #include "knot/dnssec/kasp/kasp_db.h"
+#include "knot/dnssec/key-cache.h"
 #include "knot/journal/journal_basic.h"
+#include "knot/query/tls-requestor.h"
 #include "knot/server/server.h"
 #include "knot/server/udp-handler.h"
 #include "knot/server/tcp-handler.h"
@@ -64,6 +72,11 @@
 #include <linux/filter.h>
 #endif
 
+#ifdef HAVE_REUSEPORT_EBPF
+#include <linux/bpf.h>
+#include <sys/syscall.h>
+#endif
+
 #define SESSION_TICKET_POOL_TIMEOUT (24 * 3600)
 
 #define QUIC_LOG "QUIC/TLS, "
@@ -90,6 +103,7 @@ static void server_deinit_iface(iface_t *iface, bool dealloc)
 		}
 		free(iface->fd_udp);
 	}
+	free(iface->drops_udp);
 
 	for (int i = 0; i < iface->fd_xdp_count; i++) {
 #ifdef ENABLE_XDP
@@ -155,6 +169,205 @@ static bool server_attach_reuseport_bpf(const int sock, const int sock_count)
 #endif
 }
 
+/*! \brief SO_REUSEPORT eBPF program steering packets to the sockets of the local CPU
+ *         or of the QUIC connection owner. */
+typedef struct {
+	int map_fd;  /*!< Socket array indexed by the worker thread. */
+	int prog_fd; /*!< Socket selection program. */
+} reuseport_ebpf_t;
+
+static void reuseport_ebpf_deinit(reuseport_ebpf_t *ebpf)
+{
+	if (ebpf->prog_fd >= 0) {
+		close(ebpf->prog_fd);
+		ebpf->prog_fd = -1;
+	}
+	if (ebpf->map_fd >= 0) {
+		close(ebpf->map_fd);
+		ebpf->map_fd = -1;
+	}
+}
+
+#ifdef HAVE_REUSEPORT_EBPF
+static int sys_bpf(int cmd, union bpf_attr *attr)
+{
+	return syscall(__NR_bpf, cmd, attr, sizeof(*attr));
+}
+#endif
+
+/*!
+ * \brief Prepare SO_REUSEPORT eBPF program for perfect CPU locality and/or
+ *        QUIC connection affinity.
+ *
+ * The i-th socket is served by the UDP worker pinned to CPU (i % ncpu). The
+ * program selects a socket of the worker(s) pinned to the receiving CPU, using
+ * the packet hash if there are more such workers. If the CPU has no worker,
+ * the default hash selection applies.
+ *
+ * If QUIC steering is requested, packets with a connection ID issued by the
+ * server (short header and Handshake packets) are first directed to the socket
+ * whose index is encoded in the first byte of the connection ID, see
+ * quic_make_table(). So the connection survives a client address change.
+ *
+ * \param ebpf        Program context to be initialized.
+ * \param sock_count  Number of sockets.
+ * \param cpu         Steer the packets to the local CPU.
+ * \param quic        Steer QUIC packets to the connection owner.
+ */
+static bool reuseport_ebpf_init(reuseport_ebpf_t *ebpf, const int sock_count,
+                                bool cpu, bool quic)
+{
+	ebpf->map_fd = -1;
+	ebpf->prog_fd = -1;
+
+#ifdef HAVE_REUSEPORT_EBPF
+	union bpf_attr attr = {
+		.map_type = BPF_MAP_TYPE_REUSEPORT_SOCKARRAY,
+		.key_size = sizeof(uint32_t),
+		.value_size = sizeof(uint32_t),
+		.max_entries = sock_count,
+	};
+	ebpf->map_fd = sys_bpf(BPF_MAP_CREATE, &attr);
+	if (ebpf->map_fd < 0) {
+		return false;
+	}
+
+#define QUIC_FALL(i) (28 - (i) - 1)
+	struct bpf_insn code_quic[] = {
+		/* Load the UDP payload prefix, r7 = first byte, r9 = DCID[0] (short header). */
+		{ BPF_ALU64 | BPF_MOV | BPF_X, BPF_REG_1, BPF_REG_6, 0, 0 },
+		{ BPF_ALU64 | BPF_MOV | BPF_K, BPF_REG_2, 0,         0, 8 /* UDP header */ },
+		{ BPF_ALU64 | BPF_MOV | BPF_X, BPF_REG_3, BPF_REG_10, 0, 0 },
+		{ BPF_ALU64 | BPF_ADD | BPF_K, BPF_REG_3, 0,         0, -16 },
+		{ BPF_ALU64 | BPF_MOV | BPF_K, BPF_REG_4, 0,         0, 8 },
+		{ BPF_JMP   | BPF_CALL,        0,         0,         0, BPF_FUNC_skb_load_bytes },
+		{ BPF_JMP   | BPF_JNE | BPF_K, BPF_REG_0, 0, QUIC_FALL(6), 0 },
+		{ BPF_LDX   | BPF_MEM | BPF_B, BPF_REG_7, BPF_REG_10, -16, 0 },
+		{ BPF_LDX   | BPF_MEM | BPF_B, BPF_REG_9, BPF_REG_10, -15, 0 },
+		{ BPF_JMP   | BPF_JSET | BPF_K, BPF_REG_7, 0,        1, 0x80 },
+		{ BPF_JMP   | BPF_JA,          0,         0,         5, 0 },
+		/* Long header: only Handshake packets carry the server-chosen DCID. */
+		{ BPF_ALU64 | BPF_AND | BPF_K, BPF_REG_7, 0,         0, 0x30 },
+		{ BPF_JMP   | BPF_JNE | BPF_K, BPF_REG_7, 0, QUIC_FALL(12), 0x20 },
+		{ BPF_LDX   | BPF_MEM | BPF_B, BPF_REG_8, BPF_REG_10, -11, 0 },
+		{ BPF_JMP   | BPF_JEQ | BPF_K, BPF_REG_8, 0, QUIC_FALL(14), 0 },
+		{ BPF_LDX   | BPF_MEM | BPF_B, BPF_REG_9, BPF_REG_10, -10, 0 },
+		/* key = DCID[0] if valid. */
+		{ BPF_JMP   | BPF_JGE | BPF_K, BPF_REG_9, 0, QUIC_FALL(16), sock_count },
+		{ BPF_STX   | BPF_MEM | BPF_W, BPF_REG_10, BPF_REG_9, -4, 0 },
+		/* bpf_sk_select_reuseport(ctx, map, &key, 0). */
+		{ BPF_ALU64 | BPF_MOV | BPF_X, BPF_REG_1, BPF_REG_6, 0, 0 },
+		{ BPF_LD    | BPF_DW  | BPF_IMM, BPF_REG_2, BPF_PSEUDO_MAP_FD, 0, ebpf->map_fd },
+		{ 0, 0, 0, 0, 0 },
+		{ BPF_ALU64 | BPF_MOV | BPF_X, BPF_REG_3, BPF_REG_10, 0, 0 },
+		{ BPF_ALU64 | BPF_ADD | BPF_K, BPF_REG_3, 0,         0, -4 },
+		{ BPF_ALU64 | BPF_MOV | BPF_K, BPF_REG_4, 0,         0, 0 },
+		{ BPF_JMP   | BPF_CALL,        0,         0,         0, BPF_FUNC_sk_select_reuseport },
+		{ BPF_JMP   | BPF_JNE | BPF_K, BPF_REG_0, 0, QUIC_FALL(25), 0 },
+		{ BPF_ALU64 | BPF_MOV | BPF_K, BPF_REG_0, 0,         0, SK_PASS },
+		{ BPF_JMP   | BPF_EXIT,        0,         0,         0, 0 },
+		/* Otherwise continue with the next selection. */
+	};
+#undef QUIC_FALL
+	static_assert(sizeof(code_quic) / sizeof(*code_quic) == 28, "invalid QUIC steering");
+
+	const int ncpu = MAX(1, dt_online_cpus());
+	struct bpf_insn code_cpu[] = {
+		/* r7 = raw_smp_processor_id(). */
+		{ BPF_JMP   | BPF_CALL,        0,         0,         0, BPF_FUNC_get_smp_processor_id },
+		{ BPF_ALU64 | BPF_MOV | BPF_X, BPF_REG_7, BPF_REG_0, 0, 0 },
+		{ BPF_JMP   | BPF_JGE | BPF_K, BPF_REG_7, 0,        16, ncpu },
+		/* r8 = number of workers pinned to the CPU. */
+		{ BPF_ALU64 | BPF_MOV | BPF_K, BPF_REG_8, 0,         0, sock_count / ncpu },
+		{ BPF_JMP   | BPF_JGE | BPF_K, BPF_REG_7, 0,         1, sock_count % ncpu },
+		{ BPF_ALU64 | BPF_ADD | BPF_K, BPF_REG_8, 0,         0, 1 },
+		{ BPF_JMP   | BPF_JEQ | BPF_K, BPF_REG_8, 0,        12, 0 },
+		/* key = CPU + ncpu * (hash % r8). */
+		{ BPF_LDX   | BPF_MEM | BPF_W, BPF_REG_9, BPF_REG_6, offsetof(struct sk_reuseport_md, hash), 0 },
+		{ BPF_ALU64 | BPF_MOD | BPF_X, BPF_REG_9, BPF_REG_8, 0, 0 },
+		{ BPF_ALU64 | BPF_MUL | BPF_K, BPF_REG_9, 0,         0, ncpu },
+		{ BPF_ALU64 | BPF_ADD | BPF_X, BPF_REG_9, BPF_REG_7, 0, 0 },
+		{ BPF_STX   | BPF_MEM | BPF_W, BPF_REG_10, BPF_REG_9, -4, 0 },
+		/* bpf_sk_select_reuseport(ctx, map, &key, 0). */
+		{ BPF_ALU64 | BPF_MOV | BPF_X, BPF_REG_1, BPF_REG_6, 0, 0 },
+		{ BPF_LD    | BPF_DW  | BPF_IMM, BPF_REG_2, BPF_PSEUDO_MAP_FD, 0, ebpf->map_fd },
+		{ 0, 0, 0, 0, 0 },
+		{ BPF_ALU64 | BPF_MOV | BPF_X, BPF_REG_3, BPF_REG_10, 0, 0 },
+		{ BPF_ALU64 | BPF_ADD | BPF_K, BPF_REG_3, 0,         0, -4 },
+		{ BPF_ALU64 | BPF_MOV | BPF_K, BPF_REG_4, 0,         0, 0 },
+		{ BPF_JMP   | BPF_CALL,        0,         0,         0, BPF_FUNC_sk_select_reuseport },
+	};
+
+	struct bpf_insn code[sizeof(code_quic) / sizeof(*code_quic) +
+	                     sizeof(code_cpu) / sizeof(*code_cpu) + 3] = {
+		/* r6 = ctx. */
+		{ BPF_ALU64 | BPF_MOV | BPF_X, BPF_REG_6, BPF_REG_1, 0, 0 },
+	};
+	size_t code_len = 1;
+	if (quic) {
+		memcpy(code + code_len, code_quic, sizeof(code_quic));
+		code_len += sizeof(code_quic) / sizeof(*code_quic);
+	}
+	if (cpu) {
+		memcpy(code + code_len, code_cpu, sizeof(code_cpu));
+		code_len += sizeof(code_cpu) / sizeof(*code_cpu);
+	}
+	/* Return SK_PASS, the default hash selection applies if nothing selected. */
+	code[code_len++] = (struct bpf_insn){ BPF_ALU64 | BPF_MOV | BPF_K, BPF_REG_0, 0, 0, SK_PASS };
+	code[code_len++] = (struct bpf_insn){ BPF_JMP   | BPF_EXIT,        0,         0, 0, 0 };
+
+	memset(&attr, 0, sizeof(attr));
+	attr.prog_type = BPF_PROG_TYPE_SK_REUSEPORT;
+	attr.insns = (uintptr_t)code;
+	attr.insn_cnt = code_len;
+	attr.license = (uintptr_t)"GPL";
+	ebpf->prog_fd = sys_bpf(BPF_PROG_LOAD, &attr);
+	if (ebpf->prog_fd < 0) {
+		reuseport_ebpf_deinit(ebpf);
+		return false;
+	}
+
+	return true;
+#else
+	return false;
+#endif
+}
+
+/*!
+ * \brief Insert a socket into the SO_REUSEPORT eBPF socket array.
+ *
+ * The program is attached to the reuseport group along with the first socket.
+ *
+ * \param ebpf   Program context.
+ * \param sock   Socket to be inserted.
+ * \param index  Socket index within the reuseport group.
+ */
+static bool reuseport_ebpf_add(reuseport_ebpf_t *ebpf, const int sock,
+                               const uint32_t index)
+{
+#ifdef HAVE_REUSEPORT_EBPF
+	uint32_t value = sock;
+	union bpf_attr attr = {
+		.map_fd = ebpf->map_fd,
+		.key = (uintptr_t)&index,
+		.value = (uintptr_t)&value,
+		.flags = BPF_ANY,
+	};
+	if (sys_bpf(BPF_MAP_UPDATE_ELEM, &attr) != 0) {
+		return false;
+	}
+
+	if (index == 0) {
+		return setsockopt(sock, SOL_SOCKET, SO_ATTACH_REUSEPORT_EBPF,
+		                  &ebpf->prog_fd, sizeof(ebpf->prog_fd)) == 0;
+	}
+
+	return true;
+#else
+	return false;
+#endif
+}
+
 /*! \brief Set lower bound for socket option. */
 static bool setsockopt_min(int sock, int option, int min)
 {
@@ -258,7 +471,7 @@ static size_t quic_rmt_count(conf_t *conf, const yp_name_t *proto)
 #ifdef ENABLE_XDP
 static iface_t *server_init_xdp_iface(struct sockaddr_storage *addr, bool route_check,
                                       bool udp, bool tcp, uint16_t quic, unsigned *thread_id_start,
-                                      const knot_xdp_config_t *xdp_config)
+                                      bool shared_umem, const knot_xdp_config_t *xdp_config)
 {
 	conf_xdp_iface_t iface;
 	int ret = conf_xdp_iface(addr, &iface);
@@ -295,18 +508,30 @@ static iface_t *server_init_xdp_iface(struct sockaddr_storage *addr, bool route_
 	if (route_check) {
 		xdp_flags |= KNOT_XDP_FILTER_ROUTE;
 	}
+	if (udp && xdp_config->rrl_rate_limit > 0) {
+		xdp_flags |= KNOT_XDP_FILTER_RRL;
+	}
+
+	// All the queues share the UMEM of the first one if enabled.
+	knot_xdp_config_t queue_config = *xdp_config;
+	if (shared_umem) {
+		queue_config.shared_umem_count = iface.queues;
+	}
 
 	for (int i = 0; i < iface.queues; i++) {
 		knot_xdp_load_bpf_t mode =
 			(i == 0 ? KNOT_XDP_LOAD_BPF_ALWAYS : KNOT_XDP_LOAD_BPF_NEVER);
+		if (shared_umem && i > 0) {
+			queue_config.shared_umem = new_if->xdp_sockets[0];
+		}
 		ret = knot_xdp_init(new_if->xdp_sockets + i, iface.name, i,
-		                    xdp_flags, iface.port, quic, mode, xdp_config);
+		                    xdp_flags, iface.port, quic, mode, &queue_config);
 		if (ret == -EBUSY && i == 0) {
 			log_notice("XDP interface %s@%u is busy, retrying initialization",
 			           iface.name, iface.port);
 			ret = knot_xdp_init(new_if->xdp_sockets + i, iface.name, i,
 			                    xdp_flags, iface.port, quic,
-			                    KNOT_XDP_LOAD_BPF_ALWAYS_UNLOAD, xdp_config);
+			                    KNOT_XDP_LOAD_BPF_ALWAYS_UNLOAD, &queue_config);
 		}
 		if (ret != KNOT_EOK) {
 			log_warning("failed to initialize XDP interface %s@%u, queue %d (%s)",
@@ -319,6 +544,12 @@ static iface_t *server_init_xdp_iface(struct sockaddr_storage *addr, bool route_
 		new_if->fd_xdp_count++;
 	}
 
+	if (ret == KNOT_EOK && (xdp_flags & KNOT_XDP_FILTER_RRL) &&
+	    !knot_xdp_socket_rrl(new_if->xdp_sockets[0])) {
+		log_warning("XDP interface %s, rate limiting not supported by the loaded "
+		            "program, ignoring", iface.name);
+	}
+
 	if (ret == KNOT_EOK) {
 		char msg[128];
 		(void)snprintf(msg, sizeof(msg), "initialized XDP interface %s", iface.name);
@@ -357,14 +588,22 @@ static iface_t *server_init_xdp_iface(struct sockaddr_storage *addr, bool route_
  * \param udp_thread_count  Number of created UDP workers.
  * \param tcp_thread_count  Number of created TCP workers.
  * \param tcp_reuseport     Indication if reuseport on TCP is enabled.
+ * \param tcp_defer_accept  Indication if TCP deferred accept should be enabled.
  * \param socket_affinity   Indication if CBPF should be attached.
+ * \param udp_offload       Indication if UDP GRO (or QUIC GSO and pacing) should be enabled.
+ * \param busypoll_budget   Busy polling budget, 0 if busy polling is disabled.
+ * \param busypoll_timeout  Busy polling timeout in microseconds.
+ * \param handoff           Sockets received from the previous server instance.
  *
  * \retval Pointer to a new initialized interface.
  * \retval NULL if error.
  */
 static iface_t *server_init_iface(struct sockaddr_storage *addr, bool tls,
                                   int udp_thread_count, int tcp_thread_count,
-                                  bool tcp_reuseport, bool socket_affinity)
+                                  bool tcp_reuseport, bool tcp_defer_accept,
+                                  bool socket_affinity, bool udp_offload,
+                                  uint16_t busypoll_budget,
+                                  uint16_t busypoll_timeout, handoff_t *handoff)
 {
 	iface_t *new_if = calloc(1, sizeof(*new_if));
 	if (new_if == NULL) {
@@ -393,8 +632,9 @@ static iface_t *server_init_iface(struct sockaddr_storage *addr, bool tls,
 #endif
 
 	new_if->fd_udp = calloc(udp_socket_count, sizeof(int));
+	new_if->drops_udp = calloc(udp_socket_count, sizeof(*new_if->drops_udp));
 	new_if->fd_tcp = calloc(tcp_socket_count, sizeof(int));
-	if (new_if->fd_udp == NULL || new_if->fd_tcp == NULL) {
+	if (new_if->fd_udp == NULL || new_if->drops_udp == NULL || new_if->fd_tcp == NULL) {
 		log_error("failed to initialize interface");
 		server_deinit_iface(new_if, true);
 		return NULL;
@@ -407,11 +647,29 @@ static iface_t *server_init_iface(struct sockaddr_storage *addr, bool tls,
 	bool warn_bufsize = true;
 	bool warn_pktinfo = true;
 	bool warn_ecn = true;
+	bool warn_drops = true;
+	bool warn_gro = true;
+	bool warn_txtime = true;
+	bool warn_busypoll = true;
 	bool warn_flag_misc = true;
 
+	/* Prefer the eBPF socket selection, with the CBPF filter as a fallback. */
+	bool steering = (udp_bind_flags & NET_BIND_MULTIPLE) && addr->ss_family != AF_UNIX;
+	bool cpu_steering = steering && socket_affinity;
+	bool quic_steering = steering && tls;
+	reuseport_ebpf_t ebpf = { -1, -1 };
+	if ((cpu_steering || quic_steering) &&
+	    !reuseport_ebpf_init(&ebpf, udp_socket_count, cpu_steering, quic_steering) &&
+	    quic_steering) {
+		log_warning("cannot ensure QUIC connection affinity for %s", addr_str);
+	}
+
 	/* Create bound UDP sockets. */
 	for (int i = 0; i < udp_socket_count; i++) {
-		int sock = net_bound_socket(SOCK_DGRAM, addr, udp_bind_flags, unix_mode);
+		int sock = handoff_take(handoff, SOCK_DGRAM, addr);
+		if (sock < 0) {
+			sock = net_bound_socket(SOCK_DGRAM, addr, udp_bind_flags, unix_mode);
+		}
 		if (sock == KNOT_EADDRNOTAVAIL) {
 			udp_bind_flags |= NET_BIND_NONLOCAL;
 			sock = net_bound_socket(SOCK_DGRAM, addr, udp_bind_flags, unix_mode);
@@ -424,12 +682,20 @@ static iface_t *server_init_iface(struct sockaddr_storage *addr, bool tls,
 		if (sock < 0) {
 			log_error("cannot bind address %s UDP (%s)", addr_str,
 			          knot_strerror(sock));
+			reuseport_ebpf_deinit(&ebpf);
 			server_deinit_iface(new_if, true);
 			return NULL;
 		}
 
-		if ((udp_bind_flags & NET_BIND_MULTIPLE) && socket_affinity &&
-		    addr->ss_family != AF_UNIX) {
+		if (ebpf.prog_fd >= 0 && !reuseport_ebpf_add(&ebpf, sock, i)) {
+			/* Replaces the program for the whole reuseport group. */
+			reuseport_ebpf_deinit(&ebpf);
+			if (cpu_steering && !server_attach_reuseport_bpf(sock, udp_socket_count) &&
+			    warn_cbpf) {
+				log_warning("cannot ensure optimal CPU locality for UDP");
+				warn_cbpf = false;
+			}
+		} else if (ebpf.prog_fd < 0 && cpu_steering) {
 			if (!server_attach_reuseport_bpf(sock, udp_socket_count) &&
 			    warn_cbpf) {
 				log_warning("cannot ensure optimal CPU locality for UDP");
@@ -458,26 +724,69 @@ static iface_t *server_init_iface(struct sockaddr_storage *addr, bool tls,
 			warn_flag_misc = false;
 		}
 
+		ret = net_rxq_ovfl_enable(sock);
+		if (ret != KNOT_EOK && ret != KNOT_ENOTSUP && warn_drops) {
+			log_warning("failed to enable drop reporting for UDP (%s)",
+			            knot_strerror(ret));
+			warn_drops = false;
+		}
+
 		if (tls) {
 			ret = net_cmsg_ecn_enable(sock, addr->ss_family);
 			if (ret != KNOT_EOK && ret != KNOT_ENOTSUP && warn_ecn) {
 				log_warning("failed to enable ECN for QUIC");
 				warn_ecn = false;
 			}
+			if (udp_offload && addr->ss_family != AF_UNIX) {
+				ret = net_txtime_enable(sock);
+				if (ret != KNOT_EOK && ret != KNOT_ENOTSUP && warn_txtime) {
+					log_warning("failed to enable packet pacing for QUIC (%s)",
+					            knot_strerror(ret));
+					warn_txtime = false;
+				}
+			}
+		}
+#ifdef ENABLE_RECVMMSG
+		else if (udp_offload && addr->ss_family != AF_UNIX) {
+			ret = net_udp_gro_enable(sock, true);
+			if (ret != KNOT_EOK && warn_gro) {
+				log_warning("failed to enable UDP GRO (%s)", knot_strerror(ret));
+				warn_gro = false;
+			}
+		}
+#else
+		(void)udp_offload;
+		(void)warn_gro;
+#endif
+
+		if (busypoll_budget > 0 && addr->ss_family != AF_UNIX) {
+			ret = net_busypoll_enable(sock, busypoll_timeout, busypoll_budget);
+			if (ret != KNOT_EOK && warn_busypoll) {
+				log_warning("failed to enable busy polling for UDP (%s)",
+				            knot_strerror(ret));
+				warn_busypoll = false;
+			}
 		}
 
 		new_if->fd_udp[new_if->fd_udp_count] = sock;
 		new_if->fd_udp_count += 1;
 	}
 
+	/* The attached program keeps its own references. */
+	reuseport_ebpf_deinit(&ebpf);
+
 	warn_bind = true;
 	warn_cbpf = true;
 	warn_bufsize = true;
+	warn_busypoll = true;
 	warn_flag_misc = true;
 
 	/* Create bound TCP sockets. */
 	for (int i = 0; i < tcp_socket_count; i++) {
-		int sock = net_bound_socket(SOCK_STREAM, addr, tcp_bind_flags, unix_mode);
+		int sock = handoff_take(handoff, SOCK_STREAM, addr);
+		if (sock < 0) {
+			sock = net_bound_socket(SOCK_STREAM, addr, tcp_bind_flags, unix_mode);
+		}
 		if (sock == KNOT_EADDRNOTAVAIL) {
 			tcp_bind_flags |= NET_BIND_NONLOCAL;
 			sock = net_bound_socket(SOCK_STREAM, addr, tcp_bind_flags, unix_mode);
@@ -500,6 +809,16 @@ static iface_t *server_init_iface(struct sockaddr_storage *addr, bool tls,
 			warn_bufsize = false;
 		}
 
+		/* Accepted connections inherit the setting. */
+		if (busypoll_budget > 0 && addr->ss_family != AF_UNIX) {
+			int ret = net_busypoll_enable(sock, busypoll_timeout, busypoll_budget);
+			if (ret != KNOT_EOK && warn_busypoll) {
+				log_warning("failed to enable busy polling for TCP (%s)",
+				            knot_strerror(ret));
+				warn_busypoll = false;
+			}
+		}
+
 		new_if->fd_tcp[new_if->fd_tcp_count] = sock;
 		new_if->fd_tcp_count += 1;
 
@@ -527,6 +846,16 @@ static iface_t *server_init_iface(struct sockaddr_storage *addr, bool tls,
 			            addr_str, knot_strerror(ret));
 			warn_flag_misc = false;
 		}
+
+		/* Don't wake up workers for connections without any query. */
+		if (tcp_defer_accept && addr->ss_family != AF_UNIX) {
+			ret = net_bound_defer_accept(sock, TCP_DEFER_ACCEPT_TIMEOUT);
+			if (ret != KNOT_EOK && ret != KNOT_ENOTSUP && warn_flag_misc) {
+				log_warning("failed to enable TCP deferred accept on %s (%s)",
+				            addr_str, knot_strerror(ret));
+				warn_flag_misc = false;
+			}
+		}
 	}
 
 	return new_if;
@@ -631,6 +960,19 @@ static int init_creds(conf_t *conf, server_t *server)
 			ret = KNOT_ERROR;
 			goto failed;
 		}
+
+		char *ticket_file = conf_tls(conf, C_TICKET_KEY_FILE);
+		if (ticket_file != NULL) {
+			ret = knot_creds_ticket_key(server->quic_creds, ticket_file, uid, gid);
+			if (ret != KNOT_EOK) {
+				log_error(QUIC_LOG "failed to load session ticket key '%s' (%s)",
+				          ticket_file, knot_strerror(ret));
+				free(ticket_file);
+				goto failed;
+			}
+			log_debug(QUIC_LOG "using session ticket key '%s'", ticket_file);
+			free(ticket_file);
+		}
 	} else {
 		ret = knot_creds_update(server->quic_creds, key_file, cert_file, uid, gid);
 		if (ret != KNOT_EOK) {
@@ -704,7 +1046,11 @@ static int configure_sockets(conf_t *conf, server_t *s)
 	unsigned size_udp = s->handlers[IO_UDP].handler.unit->size;
 	unsigned size_tcp = s->handlers[IO_TCP].handler.unit->size;
 	bool tcp_reuseport = conf->cache.srv_tcp_reuseport;
+	bool tcp_defer_accept = conf->cache.srv_tcp_defer_accept;
 	bool socket_affinity = conf->cache.srv_socket_affinity;
+	bool udp_offload = conf->cache.srv_udp_offload;
+	uint16_t busypoll_budget = conf->cache.srv_busypoll_budget;
+	uint16_t busypoll_timeout = conf->cache.srv_busypoll_timeout;
 	char *rundir = conf_abs_path(&rundir_val, NULL);
 	while (listen_val.code == KNOT_EOK) {
 		struct sockaddr_storage addr = conf_addr(&listen_val, rundir);
@@ -713,7 +1059,10 @@ static int configure_sockets(conf_t *conf, server_t *s)
 		log_info("binding to interface %s", addr_str);
 
 		iface_t *new_if = server_init_iface(&addr, false, size_udp, size_tcp,
-		                                    tcp_reuseport, socket_affinity);
+		                                    tcp_reuseport, tcp_defer_accept,
+		                                    socket_affinity, udp_offload,
+		                                    busypoll_budget, busypoll_timeout,
+		                                    &s->handoff);
 		if (new_if == NULL) {
 			server_deinit_iface_list(newlist, nifs);
 			free(rundir);
@@ -731,7 +1080,9 @@ static int configure_sockets(conf_t *conf, server_t *s)
 		log_info("binding to QUIC interface %s", addr_str);
 
 		iface_t *new_if = server_init_iface(&addr, true, size_udp, 0,
-		                                    false, socket_affinity);
+		                                    false, false, socket_affinity,
+		                                    udp_offload, busypoll_budget,
+		                                    busypoll_timeout, &s->handoff);
 		if (new_if == NULL) {
 			server_deinit_iface_list(newlist, nifs);
 			free(rundir);
@@ -750,7 +1101,10 @@ static int configure_sockets(conf_t *conf, server_t *s)
 		log_info("binding to TLS interface %s", addr_str);
 
 		iface_t *new_if = server_init_iface(&addr, true, 0, size_tcp,
-		                                    tcp_reuseport, socket_affinity);
+		                                    tcp_reuseport, tcp_defer_accept,
+		                                    socket_affinity, udp_offload,
+		                                    busypoll_budget, busypoll_timeout,
+		                                    &s->handoff);
 		if (new_if == NULL) {
 			server_deinit_iface_list(newlist, nifs);
 			free(rundir);
@@ -770,6 +1124,9 @@ static int configure_sockets(conf_t *conf, server_t *s)
 		.ring_size = conf->cache.xdp_ring_size,
 		.busy_poll_budget = conf->cache.xdp_busypoll_budget,
 		.busy_poll_timeout = conf->cache.xdp_busypoll_timeout,
+		.multi_buffer = conf->cache.xdp_multi_buffer,
+		.rrl_instant_limit = conf->cache.xdp_rrl_instant_limit,
+		.rrl_rate_limit = conf->cache.xdp_rrl_rate_limit,
 	};
 	unsigned thread_id = s->handlers[IO_UDP].handler.unit->size +
 	                     s->handlers[IO_TCP].handler.unit->size;
@@ -782,7 +1139,7 @@ static int configure_sockets(conf_t *conf, server_t *s)
 		iface_t *new_if = server_init_xdp_iface(&addr, conf->cache.xdp_route_check,
 		                                        conf->cache.xdp_udp, conf->cache.xdp_tcp,
 		                                        conf->cache.xdp_quic, &thread_id,
-		                                        &xdp_config);
+		                                        conf->cache.xdp_shared_umem, &xdp_config);
 		if (new_if == NULL) {
 			server_deinit_iface_list(newlist, nifs);
 			return KNOT_ERROR;
@@ -823,6 +1180,175 @@ static int configure_sockets(conf_t *conf, server_t *s)
 	return KNOT_EOK;
 }
 
+static int server_init_tcp(server_t *server)
+{
+	server->tcp_clients.conns = calloc(TCP_PREFIX_BUCKETS,
+	                                   sizeof(*server->tcp_clients.conns));
+	if (server->tcp_clients.conns == NULL ||
+	    dnssec_random_buffer((uint8_t *)&server->tcp_clients.key,
+	                         sizeof(server->tcp_clients.key)) != DNSSEC_EOK) {
+		free(server->tcp_clients.conns);
+		return KNOT_ENOMEM;
+	}
+
+	int *notify = server->tcp_jobs.notify;
+	if (pipe(notify) != 0) {
+		free(server->tcp_clients.conns);
+		return knot_map_errno();
+	}
+	if (fcntl(notify[0], F_SETFL, O_NONBLOCK) != 0 ||
+	    fcntl(notify[1], F_SETFL, O_NONBLOCK) != 0) {
+		int ret = knot_map_errno();
+		close(notify[0]);
+		close(notify[1]);
+		free(server->tcp_clients.conns);
+		return ret;
+	}
+
+	pthread_mutex_init(&server->tcp_jobs.lock, NULL);
+	init_list(&server->tcp_jobs.queue);
+
+	ATOMIC_INIT(server->tcp_clients.rejected, 0);
+	ATOMIC_INIT(server->tcp_clients.evicted, 0);
+
+	return KNOT_EOK;
+}
+
+static void server_deinit_tcp(server_t *server)
+{
+	/* The queue is drained by the TCP workers when they close the connections. */
+	assert(EMPTY_LIST(server->tcp_jobs.queue));
+	pthread_mutex_destroy(&server->tcp_jobs.lock);
+	close(server->tcp_jobs.notify[0]);
+	close(server->tcp_jobs.notify[1]);
+
+	free(server->tcp_clients.conns);
+	ATOMIC_DEINIT(server->tcp_clients.rejected);
+	ATOMIC_DEINIT(server->tcp_clients.evicted);
+}
+
+static void timers_sync_run(worker_task_t *task)
+{
+	server_t *server = task->ctx;
+
+	size_t written = 0;
+	rcu_read_lock();
+	int ret = zone_timers_write_changed(server->timerdb, server->timerdb_shards,
+	                                    rcu_dereference(server->zone_db), &written);
+	conf_val_t val = conf_db_param(conf(), C_TIMER_DB_SYNC);
+	int64_t interval = conf_int(&val);
+	rcu_read_unlock();
+
+	if (ret != KNOT_EOK) {
+		log_warning("failed to update persistent timer DB (%s)", knot_strerror(ret));
+	} else if (written > 0) {
+		log_debug("persistent timer DB updated, %zu zones", written);
+	}
+
+	if (interval > 0) {
+		evsched_schedule(server->timers_sync, interval * 1000);
+	}
+}
+
+static void timers_sync_dispatch(event_t *event)
+{
+	server_t *server = event->data;
+	worker_pool_assign(server->workers, &server->timers_sync_task);
+}
+
+/*! \brief Interval of checking lazily loaded zones for unloading (seconds). */
+#define LAZY_SWEEP_INTERVAL 10
+
+typedef struct {
+	zone_t *zone;
+	uint64_t last;
+	size_t size;
+} lazy_zone_t;
+
+knot_dynarray_declare(lazy, lazy_zone_t, DYNARRAY_VISIBILITY_STATIC, 16)
+knot_dynarray_define(lazy, lazy_zone_t, DYNARRAY_VISIBILITY_STATIC)
+
+static int lazy_zone_cmp(const void *a, const void *b)
+{
+	const lazy_zone_t *za = a, *zb = b;
+	return (za->last > zb->last) - (za->last < zb->last);
+}
+
+/*!
+ * Unloads lazily loaded zones idle longer than configured, then the least
+ * recently queried ones while their total size exceeds the configured limit.
+ */
+static void lazy_sweep_run(worker_task_t *task)
+{
+	server_t *server = task->ctx;
+	uint64_t now = time(NULL);
+	lazy_dynarray_t loaded = { 0 };
+	bool lazy_exist = false;
+	size_t total = 0;
+
+	rcu_read_lock();
+	conf_t *pconf = conf();
+	conf_val_t val = conf_get(pconf, C_SRV, C_LAZY_MAX_SIZE);
+	size_t max_size = conf_int(&val);
+
+	knot_zonedb_t *db = rcu_dereference(server->zone_db);
+	knot_zonedb_iter_t *it = (db != NULL) ? knot_zonedb_iter_begin(db) : NULL;
+	for (; it != NULL && !knot_zonedb_iter_finished(it); knot_zonedb_iter_next(it)) {
+		zone_t *zone = (zone_t *)knot_zonedb_iter_val(it);
+		if (!zone->lazy.enabled) {
+			continue;
+		}
+		lazy_exist = true;
+
+		zone_contents_t *contents = rcu_dereference(zone->contents);
+		if (contents == NULL) {
+			continue;
+		}
+
+		uint64_t last = ATOMIC_GET(zone->lazy.last);
+		if (last == 0) { // Loaded before being lazy, start counting now.
+			ATOMIC_SET(zone->lazy.last, now);
+			last = now;
+		}
+
+		val = conf_zone_get(pconf, C_LAZY_IDLE_TIMEOUT, zone->name);
+		int64_t timeout = conf_int(&val);
+		if (timeout > 0 && last + timeout <= now) {
+			zone_events_schedule_now(zone, ZONE_EVENT_UNLOAD);
+			continue;
+		}
+
+		total += contents->size;
+		if (max_size > 0) {
+			lazy_zone_t item = { .zone = zone, .last = last, .size = contents->size };
+			(void)lazy_dynarray_add(&loaded, &item);
+		}
+	}
+	knot_zonedb_iter_free(it);
+
+	if (max_size > 0 && total > max_size && loaded.size > 0) {
+		lazy_zone_t *zones = lazy_dynarray_arr(&loaded);
+		qsort(zones, loaded.size, sizeof(*zones), lazy_zone_cmp);
+		for (lazy_zone_t *z = zones; z < zones + loaded.size && total > max_size; z++) {
+			zone_events_schedule_now(z->zone, ZONE_EVENT_UNLOAD);
+			total -= z->size;
+		}
+	}
+	rcu_read_unlock();
+
+	lazy_dynarray_free(&loaded);
+
+	if (lazy_exist) {
+		evsched_schedule(server->lazy_sweep, LAZY_SWEEP_INTERVAL * 1000);
+	}
+}
+
+static void lazy_sweep_dispatch(event_t *event)
+{
+	server_t *server = event->data;
+	worker_pool_assign(server->workers, &server->lazy_sweep_task);
+}
+
 int server_init(server_t *server, int bg_workers)
 {
 	if (server == NULL) {
@@ -832,27 +1358,80 @@ int server_init(server_t *server, int bg_workers)
 	/* Clear the structure. */
 	memset(server, 0, sizeof(server_t));
 
+	/* Initialize TCP client admission control and shared query queue. */
+	int ret = server_init_tcp(server);
+	if (ret != KNOT_EOK) {
+		return ret;
+	}
+
 	/* Initialize event scheduler. */
 	if (evsched_init(&server->sched, server) != KNOT_EOK) {
+		server_deinit_tcp(server);
 		return KNOT_ENOMEM;
 	}
 
 	server->workers = worker_pool_create(bg_workers);
 	if (server->workers == NULL) {
 		evsched_deinit(&server->sched);
+		server_deinit_tcp(server);
+		return KNOT_ENOMEM;
+	}
+
+	server->timers_sync = evsched_event_create(&server->sched, timers_sync_dispatch, server);
+	if (server->timers_sync == NULL) {
+		worker_pool_destroy(server->workers);
+		evsched_deinit(&server->sched);
+		server_deinit_tcp(server);
+		return KNOT_ENOMEM;
+	}
+	server->timers_sync_task.ctx = server;
+	server->timers_sync_task.run = timers_sync_run;
+	server->timers_sync_task.cls = WORKER_CLASS_NORMAL;
+
+	server->lazy_sweep = evsched_event_create(&server->sched, lazy_sweep_dispatch, server);
+	if (server->lazy_sweep == NULL) {
+		evsched_event_free(server->timers_sync);
+		worker_pool_destroy(server->workers);
+		evsched_deinit(&server->sched);
+		server_deinit_tcp(server);
 		return KNOT_ENOMEM;
 	}
+	server->lazy_sweep_task.ctx = server;
+	server->lazy_sweep_task.run = lazy_sweep_run;
+	server->lazy_sweep_task.cls = WORKER_CLASS_NORMAL;
 
-	int ret = catalog_update_init(&server->catalog_upd);
+	/* Start batched SOA checking, refresh falls back to regular queries without it. */
+	server->soa_batch = soa_batch_init(server);
+
+	/* Start NOTIFY scheduling, enabled by configuration. */
+	server->notify_batch = notify_batch_init(server);
+
+	/* Start the outgoing requests loop, requests are blocking without it. */
+	server->areq_loop = knot_areq_loop_new();
+
+	/* Start freeing of unused zone contents in background. */
+	global_reclaim = knot_reclaim_init();
+
+	ret = catalog_update_init(&server->catalog_upd);
 	if (ret != KNOT_EOK) {
+		knot_reclaim_deinit(&global_reclaim);
+		soa_batch_deinit(&server->soa_batch);
+		notify_batch_deinit(&server->notify_batch);
+		evsched_event_free(server->lazy_sweep);
+		evsched_event_free(server->timers_sync);
 		worker_pool_destroy(server->workers);
+		knot_areq_loop_free(server->areq_loop);
 		evsched_deinit(&server->sched);
+		server_deinit_tcp(server);
 		return ret;
 	}
 	ATOMIC_INIT(server->catalog_upd_signal, false);
 
 	pthread_rwlock_init(&server->ctl_lock, NULL);
 
+	pthread_mutex_init(&server->shared_mods.lock, NULL);
+	init_list(&server->shared_mods.list);
+
 	zone_backups_init(&server->backup_ctxs);
 
 	char *catalog_dir = conf_db(conf(), C_CATALOG_DB);
@@ -861,17 +1440,41 @@ int server_init(server_t *server, int bg_workers)
 	free(catalog_dir);
 	conf()->catalog = &server->catalog;
 
+	/* Start the shared signing threads, zones sign on their own without them. */
+	server->sign_pool = sign_pool_init(conf_signing_threads(conf()));
+
+	/* Truncation learning is inactive without the memory. */
+	server->tc_memory = tc_memory_new();
+
+	/* The numbers of shards are fixed for the server lifetime. */
+	conf_val_t journal_shards = conf_db_param(conf(), C_JOURNAL_DB_SHARDS);
+	server->journaldb_shards = conf_int(&journal_shards);
+	conf_val_t timer_shards = conf_db_param(conf(), C_TIMER_DB_SHARDS);
+	server->timerdb_shards = conf_int(&timer_shards);
+
 	char *journal_dir = conf_db(conf(), C_JOURNAL_DB);
 	conf_val_t journal_size = conf_db_param(conf(), C_JOURNAL_DB_MAX_SIZE);
 	conf_val_t journal_mode = conf_db_param(conf(), C_JOURNAL_DB_MODE);
-	knot_lmdb_init(&server->journaldb, journal_dir, conf_int(&journal_size), journal_env_flags(conf_opt(&journal_mode), false), NULL);
+	for (unsigned i = 0; i < server->journaldb_shards; i++) {
+		char *shard_dir = knot_lmdb_shard_path(journal_dir, i, server->journaldb_shards);
+		knot_lmdb_init(&server->journaldb[i], shard_dir,
+		               conf_int(&journal_size) / server->journaldb_shards,
+		               journal_env_flags(conf_opt(&journal_mode), false), NULL);
+		free(shard_dir);
+		server->journal_batch[i] = journal_batch_init(&server->journaldb[i]);
+	}
 	free(journal_dir);
 
 	kasp_db_ensure_init(&server->kaspdb, conf());
 
 	char *timer_dir = conf_db(conf(), C_TIMER_DB);
 	conf_val_t timer_size = conf_db_param(conf(), C_TIMER_DB_MAX_SIZE);
-	knot_lmdb_init(&server->timerdb, timer_dir, conf_int(&timer_size), 0, NULL);
+	for (unsigned i = 0; i < server->timerdb_shards; i++) {
+		char *shard_dir = knot_lmdb_shard_path(timer_dir, i, server->timerdb_shards);
+		knot_lmdb_init(&server->timerdb[i], shard_dir,
+		               conf_int(&timer_size) / server->timerdb_shards, 0, NULL);
+		free(shard_dir);
+	}
 	free(timer_dir);
 
 	return KNOT_EOK;
@@ -888,18 +1491,33 @@ void server_deinit(server_t *server)
 	/* Save zone timers. */
 	if (server->zone_db != NULL) {
 		log_info("updating persistent timer DB");
-		int ret = zone_timers_write_all(&server->timerdb, server->zone_db);
+		int ret = zone_timers_write_all(server->timerdb, server->timerdb_shards,
+		                                server->zone_db);
 		if (ret != KNOT_EOK) {
 			log_warning("failed to update persistent timer DB (%s)",
 				    knot_strerror(ret));
 		}
 	}
 
+	/* Let the previous server instance continue if not started. */
+	handoff_finish(&server->handoff, false);
+
 	/* Free remaining interfaces. */
 	server_deinit_iface_list(server->ifaces, server->n_ifaces);
 
 	/* Free threads and event handlers. */
+	soa_batch_deinit(&server->soa_batch);
+	notify_batch_deinit(&server->notify_batch);
 	worker_pool_destroy(server->workers);
+	sign_pool_deinit(&server->sign_pool); // After the workers using it.
+	key_cache_drop(NULL);
+	knot_areq_loop_free(server->areq_loop); // After the workers waiting for it.
+	tc_memory_free(server->tc_memory);
+	evsched_event_free(server->timers_sync);
+	evsched_event_free(server->lazy_sweep);
+
+	/* Finish freeing of unused zone contents. */
+	knot_reclaim_deinit(&global_reclaim);
 
 	/* Free zone database. */
 	knot_zonedb_deep_free(&server->zone_db, true);
@@ -910,24 +1528,38 @@ void server_deinit(server_t *server)
 	/* Deinit locks. */
 	pthread_rwlock_destroy(&server->ctl_lock);
 
+	/* The shared modules are released with the last zone referencing them. */
+	assert(EMPTY_LIST(server->shared_mods.list));
+	pthread_mutex_destroy(&server->shared_mods.lock);
+
 	/* Free catalog zone context. */
 	catalog_update_clear(&server->catalog_upd);
 	catalog_update_deinit(&server->catalog_upd);
 	catalog_deinit(&server->catalog);
 	ATOMIC_DEINIT(server->catalog_upd_signal);
 
+	/* Free TCP client admission control. */
+	server_deinit_tcp(server);
+
 	/* Close persistent timers DB. */
-	knot_lmdb_deinit(&server->timerdb);
+	for (unsigned i = 0; i < server->timerdb_shards; i++) {
+		knot_lmdb_deinit(&server->timerdb[i]);
+	}
 
 	/* Close kasp_db. */
 	knot_lmdb_deinit(&server->kaspdb);
 
-	/* Close journal database if open. */
-	knot_lmdb_deinit(&server->journaldb);
+	/* Stop the journal writers and close journal database if open. */
+	for (unsigned i = 0; i < server->journaldb_shards; i++) {
+		journal_batch_deinit(&server->journal_batch[i]);
+		knot_lmdb_deinit(&server->journaldb[i]);
+	}
 
 	/* Close and deinit connection pool. */
 	conn_pool_deinit(global_conn_pool);
 	global_conn_pool = NULL;
+	conn_pool_deinit(global_tls_conn_pool);
+	global_tls_conn_pool = NULL;
 	conn_pool_deinit(global_sessticket_pool);
 	global_sessticket_pool = NULL;
 	knot_unreachables_deinit(&global_unreachables);
@@ -960,6 +1592,25 @@ static int server_init_handler(server_t *server, int index, int thread_count,
 		return KNOT_ENOMEM;
 	}
 
+	h->thread_batch = calloc(thread_count, sizeof(*h->thread_batch));
+	h->thread_spin = calloc(thread_count, sizeof(*h->thread_spin));
+	h->thread_mem = calloc(thread_count, sizeof(*h->thread_mem));
+	h->thread_conns = calloc(thread_count, sizeof(*h->thread_conns));
+	h->thread_drops = calloc(thread_count, sizeof(*h->thread_drops));
+	if (h->thread_batch == NULL || h->thread_spin == NULL ||
+	    h->thread_mem == NULL || h->thread_conns == NULL ||
+	    h->thread_drops == NULL) {
+		free(h->thread_drops);
+		free(h->thread_conns);
+		free(h->thread_mem);
+		free(h->thread_spin);
+		free(h->thread_batch);
+		free(h->thread_id);
+		free(h->thread_state);
+		dt_delete(&h->unit);
+		return KNOT_ENOMEM;
+	}
+
 	return KNOT_EOK;
 }
 
@@ -979,6 +1630,11 @@ static void server_free_handler(iohandler_t *h)
 	dt_delete(&h->unit);
 	free(h->thread_state);
 	free(h->thread_id);
+	free(h->thread_batch);
+	free(h->thread_spin);
+	free(h->thread_mem);
+	free(h->thread_conns);
+	free(h->thread_drops);
 }
 
 static void worker_wait_cb(worker_pool_t *pool)
@@ -1197,7 +1853,15 @@ static void warn_server_reconfigure(conf_t *conf, server_t *server)
 	const char *msg = "changes of %s require restart to take effect";
 
 	static bool warn_tcp_reuseport = true;
+	static bool warn_tcp_defer_accept = true;
 	static bool warn_socket_affinity = true;
+	static bool warn_numa_affinity = true;
+	static bool warn_srv_busypoll_budget = true;
+	static bool warn_srv_busypoll_timeout = true;
+	static bool warn_srv_busypoll_spin = true;
+	static bool warn_answer_cache = true;
+	static bool warn_udp_offload = true;
+	static bool warn_udp_adaptive_batch = true;
 	static bool warn_udp = true;
 	static bool warn_tcp = true;
 	static bool warn_bg = true;
@@ -1209,6 +1873,8 @@ static void warn_server_reconfigure(conf_t *conf, server_t *server)
 	static bool warn_ring_size = true;
 	static bool warn_busypoll_budget = true;
 	static bool warn_busypoll_timeout = true;
+	static bool warn_multi_buffer = true;
+	static bool warn_shared_umem = true;
 	static bool warn_rmt_pool_limit = true;
 
 	if (warn_tcp_reuseport && conf->cache.srv_tcp_reuseport != conf_get_bool(conf, C_SRV, C_TCP_REUSEPORT)) {
@@ -1216,11 +1882,52 @@ static void warn_server_reconfigure(conf_t *conf, server_t *server)
 		warn_tcp_reuseport = false;
 	}
 
+	if (warn_tcp_defer_accept && conf->cache.srv_tcp_defer_accept != conf_get_bool(conf, C_SRV, C_TCP_DEFER_ACCEPT)) {
+		log_warning(msg, &C_TCP_DEFER_ACCEPT[1]);
+		warn_tcp_defer_accept = false;
+	}
+
 	if (warn_socket_affinity && conf->cache.srv_socket_affinity != conf_get_bool(conf, C_SRV, C_SOCKET_AFFINITY)) {
 		log_warning(msg, &C_SOCKET_AFFINITY[1]);
 		warn_socket_affinity = false;
 	}
 
+	if (warn_numa_affinity && conf->cache.srv_numa_affinity != conf_get_bool(conf, C_SRV, C_NUMA_AFFINITY)) {
+		log_warning(msg, &C_NUMA_AFFINITY[1]);
+		warn_numa_affinity = false;
+	}
+
+	if (warn_srv_busypoll_budget && conf->cache.srv_busypoll_budget != conf_get_int(conf, C_SRV, C_BUSYPOLL_BUDGET)) {
+		log_warning(msg, &C_BUSYPOLL_BUDGET[1]);
+		warn_srv_busypoll_budget = false;
+	}
+
+	if (warn_srv_busypoll_timeout && conf->cache.srv_busypoll_timeout != conf_get_int(conf, C_SRV, C_BUSYPOLL_TIMEOUT)) {
+		log_warning(msg, &C_BUSYPOLL_TIMEOUT[1]);
+		warn_srv_busypoll_timeout = false;
+	}
+
+	if (warn_srv_busypoll_spin && conf->cache.srv_busypoll_spin != conf_get_int(conf, C_SRV, C_BUSYPOLL_SPIN)) {
+		log_warning(msg, &C_BUSYPOLL_SPIN[1]);
+		warn_srv_busypoll_spin = false;
+	}
+
+	if (warn_answer_cache && conf->cache.srv_answer_cache != conf_get_int(conf, C_SRV, C_ANS_CACHE)) {
+		log_warning(msg, &C_ANS_CACHE[1]);
+		warn_answer_cache = false;
+	}
+
+	if (warn_udp_offload && conf->cache.srv_udp_offload != conf_get_bool(conf, C_SRV, C_UDP_OFFLOAD)) {
+		log_warning(msg, &C_UDP_OFFLOAD[1]);
+		warn_udp_offload = false;
+	}
+
+	if (warn_udp_adaptive_batch &&
+	    conf->cache.srv_udp_adaptive_batch != conf_get_bool(conf, C_SRV, C_UDP_ADAPTIVE_BATCH)) {
+		log_warning(msg, &C_UDP_ADAPTIVE_BATCH[1]);
+		warn_udp_adaptive_batch = false;
+	}
+
 	if (warn_udp && server->handlers[IO_UDP].size != conf_udp_threads(conf)) {
 		log_warning(msg, &C_UDP_WORKERS[1]);
 		warn_udp = false;
@@ -1282,6 +1989,16 @@ static void warn_server_reconfigure(conf_t *conf, server_t *server)
 		warn_busypoll_timeout = false;
 	}
 
+	if (warn_multi_buffer && conf->cache.xdp_multi_buffer != conf_get_bool(conf, C_XDP, C_MULTI_BUFFER)) {
+		log_warning(msg, &C_MULTI_BUFFER[1]);
+		warn_multi_buffer = false;
+	}
+
+	if (warn_shared_umem && conf->cache.xdp_shared_umem != conf_get_bool(conf, C_XDP, C_SHARED_UMEM)) {
+		log_warning(msg, &C_SHARED_UMEM[1]);
+		warn_shared_umem = false;
+	}
+
 	if (warn_rmt_pool_limit && global_conn_pool != NULL &&
 	    global_conn_pool->capacity != conf_get_int(conf, C_SRV, C_RMT_POOL_LIMIT)) {
 		log_warning(msg, &C_RMT_POOL_LIMIT[1]);
@@ -1421,10 +2138,19 @@ static int reconfigure_journal_db(conf_t *conf, server_t *server)
 	char *journal_dir = conf_db(conf, C_JOURNAL_DB);
 	conf_val_t journal_size = conf_db_param(conf, C_JOURNAL_DB_MAX_SIZE);
 	conf_val_t journal_mode = conf_db_param(conf, C_JOURNAL_DB_MODE);
-	int ret = knot_lmdb_reinit(&server->journaldb, journal_dir, conf_int(&journal_size),
-	                           journal_env_flags(conf_opt(&journal_mode), false));
-	if (ret != KNOT_EOK) {
-		log_warning("ignored reconfiguration of journal DB (%s)", knot_strerror(ret));
+	conf_val_t journal_group = conf_db_param(conf, C_JOURNAL_DB_GROUP);
+	for (unsigned i = 0; i < server->journaldb_shards; i++) {
+		char *shard_dir = knot_lmdb_shard_path(journal_dir, i, server->journaldb_shards);
+		int ret = (shard_dir == NULL) ? KNOT_ENOMEM :
+		          knot_lmdb_reinit(&server->journaldb[i], shard_dir,
+		                           conf_int(&journal_size) / server->journaldb_shards,
+		                           journal_env_flags(conf_opt(&journal_mode), false));
+		if (ret != KNOT_EOK) {
+			log_warning("ignored reconfiguration of journal DB (%s)", knot_strerror(ret));
+		}
+		free(shard_dir);
+
+		journal_batch_set_limit(server->journal_batch[i], conf_int(&journal_group));
 	}
 	free(journal_dir);
 
@@ -1448,7 +2174,21 @@ static int reconfigure_timer_db(conf_t *conf, server_t *server)
 {
 	char *timer_dir = conf_db(conf, C_TIMER_DB);
 	conf_val_t timer_size = conf_db_param(conf, C_TIMER_DB_MAX_SIZE);
-	int ret = knot_lmdb_reconfigure(&server->timerdb, timer_dir, conf_int(&timer_size), 0);
+	conf_val_t timer_sync = conf_db_param(conf, C_TIMER_DB_SYNC);
+	if (conf_int(&timer_sync) > 0) {
+		evsched_schedule(server->timers_sync, conf_int(&timer_sync) * 1000);
+	} else {
+		evsched_cancel(server->timers_sync);
+	}
+
+	int ret = KNOT_EOK;
+	for (unsigned i = 0; i < server->timerdb_shards && ret == KNOT_EOK; i++) {
+		char *shard_dir = knot_lmdb_shard_path(timer_dir, i, server->timerdb_shards);
+		ret = (shard_dir == NULL) ? KNOT_ENOMEM :
+		      knot_lmdb_reconfigure(&server->timerdb[i], shard_dir,
+		                            conf_int(&timer_size) / server->timerdb_shards, 0);
+		free(shard_dir);
+	}
 	free(timer_dir);
 	return ret;
 }
@@ -1478,6 +2218,18 @@ static int reconfigure_remote_pool(conf_t *conf, server_t *server)
 		(void)conn_pool_timeout(global_conn_pool, timeout);
 	}
 
+	if (global_tls_conn_pool == NULL && limit > 0 && server->tls_active) {
+		conn_pool_t *new_pool = conn_pool_init(limit, timeout,
+		                                       knot_tls_req_pool_close,
+		                                       knot_tls_req_pool_invalid);
+		if (new_pool == NULL) {
+			return KNOT_ENOMEM;
+		}
+		global_tls_conn_pool = new_pool;
+	} else {
+		(void)conn_pool_timeout(global_tls_conn_pool, timeout);
+	}
+
 	if (global_sessticket_pool == NULL && (server->quic_active || server->tls_active)) {
 		size_t rmt_count = quic_rmt_count(conf, C_QUIC) + quic_rmt_count(conf, C_TLS);
 		if (rmt_count > 0) {
@@ -1572,6 +2324,14 @@ int server_reconfigure(conf_t *conf, server_t *server)
 		          knot_strerror(ret));
 	}
 
+	/* Reconfigure NOTIFY scheduling. */
+	conf_val_t val = conf_get(conf, C_SRV, C_NOTIFY_RATE);
+	notify_batch_set_rate(server->notify_batch, conf_int(&val));
+
+	/* Reconfigure background workers sharing. */
+	val = conf_get(conf, C_SRV, C_BG_HEAVY_WORKERS);
+	worker_pool_set_limit(server->workers, WORKER_CLASS_HEAVY, conf_int(&val));
+
 	return KNOT_EOK;
 }
 
@@ -1590,17 +2350,25 @@ void server_update_zones(conf_t *conf, server_t *server, reload_t mode)
 	evsched_pause(&server->sched);
 	worker_pool_wait(server->workers);
 
+	/* Keystores or their contents may have changed. */
+	key_cache_drop(NULL);
+
 	/* Reload zone database and free old zones. */
 	zonedb_reload(conf, server, mode);
 
 	/* Trim extra heap. */
 	mem_trim();
 
-	/* Resume processing events on new zones. */
-	evsched_resume(&server->sched);
+	/* Replan events on new zones at once, then resume processing them. */
 	if (server->zone_db) {
+		evsched_batch_begin(&server->sched);
 		knot_zonedb_foreach(server->zone_db, zone_events_start);
+		evsched_batch_commit(&server->sched);
 	}
+	evsched_resume(&server->sched);
+
+	/* Stops by itself if there are no lazily loaded zones. */
+	evsched_schedule(server->lazy_sweep, LAZY_SWEEP_INTERVAL * 1000);
 }
 
 size_t server_cert_pin(server_t *server, uint8_t *out, size_t out_size)
@@ -1620,3 +2388,18 @@ size_t server_cert_pin(server_t *server, uint8_t *out, size_t out_size)
 
 	return (pin_size >= 0) ? pin_size : 0;
 }
+
+knot_lmdb_db_t *server_journaldb(server_t *server, const knot_dname_t *zone)
+{
+	return &server->journaldb[knot_lmdb_shard(zone, server->journaldb_shards)];
+}
+
+journal_batch_t *server_journal_batch(server_t *server, const knot_dname_t *zone)
+{
+	return server->journal_batch[knot_lmdb_shard(zone, server->journaldb_shards)];
+}
+
+knot_lmdb_db_t *server_timerdb(server_t *server, const knot_dname_t *zone)
+{
+	return &server->timerdb[knot_lmdb_shard(zone, server->timerdb_shards)];
+}
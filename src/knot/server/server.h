@@ -21,13 +21,22 @@
 #include "knot/catalog/catalog_update.h"
 #include "knot/common/evsched.h"
 #include "knot/common/fdset.h"
+#include "knot/dnssec/sign-pool.h"
+#include "knot/journal/journal_batch.h"
+#include "knot/server/handoff.h"
+#include "knot/server/notify_batch.h"
+#include "knot/server/soa_batch.h"
 #include "knot/journal/knot_lmdb.h"
+#include "knot/nameserver/tc_memory.h"
+#include "knot/query/async-requestor.h"
 #include "knot/server/dthreads.h"
 #include "knot/worker/pool.h"
 #include "knot/zone/backup.h"
 #include "knot/zone/zonedb.h"
+#include "contrib/openbsd/siphash.h"
 
 #define DFLT_QUIC_KEY_FILE	"quic_key.pem"
+#define TCP_PREFIX_BUCKETS	65536	/*!< Size of TCP client prefix table. */
 
 struct server;
 struct knot_xdp_socket;
@@ -41,6 +50,11 @@ typedef struct {
 	dt_unit_t *unit;        /*!< Threading unit. */
 	unsigned *thread_state; /*!< Thread states. */
 	unsigned *thread_id;    /*!< Thread identifiers per all handlers. */
+	knot_atomic_uint64_t *thread_batch; /*!< Current receive batch sizes (recvmmsg). */
+	knot_atomic_uint64_t *thread_spin;  /*!< Busy-poll spinning time (microseconds). */
+	knot_atomic_uint64_t *thread_mem;   /*!< Query mempool high-water mark (bytes). */
+	knot_atomic_uint64_t *thread_conns; /*!< Open TCP/TLS/QUIC connections. */
+	knot_atomic_uint64_t *thread_drops; /*!< Datagrams dropped by the UDP sockets. */
 } iohandler_t;
 
 /*!
@@ -49,6 +63,7 @@ typedef struct {
 typedef enum {
 	ServerIdle    = 0 << 0, /*!< Server is idle. */
 	ServerRunning = 1 << 0, /*!< Server is running. */
+	ServerHandedOff = 1 << 1, /*!< Sockets taken over by a new server instance. */
 } server_state_t;
 
 /*!
@@ -67,6 +82,7 @@ typedef enum {
  */
 typedef struct {
 	int *fd_udp;
+	knot_atomic_uint64_t *drops_udp; /*!< Last reported drop counters of the UDP sockets. */
 	unsigned fd_udp_count;
 	int *fd_tcp;
 	unsigned fd_tcp_count;
@@ -98,8 +114,11 @@ typedef struct server {
 	volatile unsigned state;
 
 	knot_zonedb_t *zone_db;
-	knot_lmdb_db_t timerdb;
-	knot_lmdb_db_t journaldb;
+	knot_lmdb_db_t timerdb[KNOT_LMDB_SHARDS_MAX];
+	knot_lmdb_db_t journaldb[KNOT_LMDB_SHARDS_MAX];
+	journal_batch_t *journal_batch[KNOT_LMDB_SHARDS_MAX];
+	unsigned timerdb_shards;
+	unsigned journaldb_shards;
 	knot_lmdb_db_t kaspdb;
 	catalog_t catalog;
 
@@ -112,9 +131,32 @@ typedef struct server {
 	/*! \brief Background jobs. */
 	worker_pool_t *workers;
 
+	/*! \brief Signing threads shared by all zones. */
+	sign_pool_t *sign_pool;
+
 	/*! \brief Event scheduler. */
 	evsched_t sched;
 
+	/*! \brief Periodic storing of changed zone timers. */
+	event_t *timers_sync;
+	worker_task_t timers_sync_task;
+
+	/*! \brief Periodic unloading of idle lazily loaded zones. */
+	event_t *lazy_sweep;
+	worker_task_t lazy_sweep_task;
+
+	/*! \brief Batched SOA checking of secondary zones. */
+	soa_batch_t *soa_batch;
+
+	/*! \brief Scheduled sending of NOTIFY messages. */
+	notify_batch_t *notify_batch;
+
+	/*! \brief Event loop of asynchronous outgoing requests. */
+	knot_areq_loop_t *areq_loop;
+
+	/*! \brief Sockets received from the previous server instance. */
+	handoff_t handoff;
+
 	/*! \brief List of interfaces. */
 	iface_t *ifaces;
 	size_t n_ifaces;
@@ -133,6 +175,30 @@ typedef struct server {
 
 	/*! \brief Crendentials context for QUIC. */
 	struct knot_creds *quic_creds;
+
+	/*! \brief TCP connection counts per hashed client prefix, admission stats. */
+	struct {
+		knot_atomic_uint16_t *conns;
+		SIPHASH_KEY key;
+		knot_atomic_uint64_t rejected;
+		knot_atomic_uint64_t evicted;
+	} tcp_clients;
+
+	/*! \brief Client prefixes recently receiving truncated UDP responses. */
+	tc_memory_t *tc_memory;
+
+	/*! \brief Zone module instances shared by zones, see module-sharing. */
+	struct {
+		pthread_mutex_t lock;
+		list_t list;
+	} shared_mods;
+
+	/*! \brief Pipelined TCP queries handed over to any TCP worker. */
+	struct {
+		pthread_mutex_t lock;
+		list_t queue;
+		int notify[2]; /*!< One byte per queued query, non-blocking pipe. */
+	} tcp_jobs;
 } server_t;
 
 /*!
@@ -220,3 +286,18 @@ void server_update_zones(conf_t *conf, server_t *server, reload_t mode);
  * \return Length of the output PIN string.
  */
 size_t server_cert_pin(server_t *server, uint8_t *out, size_t out_size);
+
+/*!
+ * \brief Get the journal DB shard of a zone.
+ */
+knot_lmdb_db_t *server_journaldb(server_t *server, const knot_dname_t *zone);
+
+/*!
+ * \brief Get the journal writer of the journal DB shard of a zone.
+ */
+journal_batch_t *server_journal_batch(server_t *server, const knot_dname_t *zone);
+
+/*!
+ * \brief Get the timer DB shard of a zone.
+ */
+knot_lmdb_db_t *server_timerdb(server_t *server, const knot_dname_t *zone);
@@ -0,0 +1,498 @@
+/*  Copyright (C) 2024 CZ.NIC, z.s.p.o. <knot-dns@labs.nic.cz>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+
+#include <errno.h>
+#include <poll.h>
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <time.h>
+#include <unistd.h>
+#include <urcu.h>
+
+#include "knot/server/soa_batch.h"
+#include "knot/events/events.h"
+#include "knot/nameserver/tsig_ctx.h"
+#include "knot/query/query.h"
+#include "knot/server/server.h"
+#include "knot/zone/zonedb.h"
+#include "contrib/macros.h"
+#include "contrib/net.h"
+#include "contrib/qp-trie/trie.h"
+#include "contrib/sockaddr.h"
+#include "contrib/time.h"
+#include "contrib/ucw/lists.h"
+#include "libdnssec/random.h"
+#include "libknot/libknot.h"
+
+#define BATCH_MAX       4096 // Maximal number of checks sent together.
+#define BATCH_DELAY_US 10000 // Time to let more checks queue up.
+#define RESULT_TTL        60 // Seconds a finished check waits for the zone refresh.
+
+typedef struct {
+	node_t n;
+	uint8_t *id;     // Query type, zone name, and remote address.
+	size_t id_len;
+	knot_dname_t *zone;
+	uint16_t qtype;
+	zone_event_type_t event;
+	query_edns_data_t edns;
+	struct sockaddr_storage remote;
+	struct sockaddr_storage via;
+	knot_tsig_key_t key;
+	tsig_ctx_t tsig;
+	int timeout_ms;
+	bool done;
+	time_t finished;
+	uint8_t *wire;   // Verified response, NULL if failed.
+	size_t wire_len;
+} soa_check_t;
+
+struct soa_batch {
+	pthread_t thread;
+	pthread_mutex_t mx;
+	pthread_cond_t cond;
+	trie_t *checks;       // Check id -> soa_check_t.
+	list_t queue;         // Checks to be sent.
+	list_t done;          // Finished checks, oldest first.
+	soa_check_t **run;    // Checks being processed.
+	struct server *server;
+	bool stop;
+};
+
+static void check_free(soa_check_t *check)
+{
+	free(check->id);
+	knot_dname_free(check->zone, NULL);
+	knot_tsig_key_deinit(&check->key);
+	tsig_cleanup(&check->tsig);
+	free(check->wire);
+	free(check);
+}
+
+static int check_free_cb(trie_val_t *val, void *ctx)
+{
+	check_free(*val);
+	return KNOT_EOK;
+}
+
+static int check_cmp(const void *a, const void *b)
+{
+	const soa_check_t *c1 = *(const soa_check_t **)a;
+	const soa_check_t *c2 = *(const soa_check_t **)b;
+
+	int ret = sockaddr_cmp(&c1->remote, &c2->remote, false);
+	if (ret == 0) {
+		ret = sockaddr_cmp(&c1->via, &c2->via, false);
+	}
+	return ret;
+}
+
+static int check_send(int fd, soa_check_t *check, knot_pkt_t *pkt, uint16_t id)
+{
+	query_init_pkt(pkt);
+	knot_wire_set_id(pkt->wire, id);
+
+	if (check->qtype == KNOT_RRTYPE_DS) {
+		knot_wire_set_rd(pkt->wire); // The parent can be a resolver.
+	}
+
+	int ret = knot_pkt_put_question(pkt, check->zone, KNOT_CLASS_IN, check->qtype);
+	if (ret == KNOT_EOK) {
+		ret = knot_pkt_reserve(pkt, knot_tsig_wire_size(&check->key));
+	}
+	if (ret == KNOT_EOK && !check->edns.no_edns) {
+		ret = query_put_edns(pkt, &check->edns, false);
+	}
+	if (ret == KNOT_EOK) {
+		tsig_init(&check->tsig, check->key.name != NULL ? &check->key : NULL);
+		ret = tsig_sign_packet(&check->tsig, pkt);
+	}
+	if (ret != KNOT_EOK) {
+		return ret;
+	}
+
+	ssize_t sent = net_dgram_send(fd, pkt->wire, pkt->size, NULL);
+	return (sent == pkt->size) ? KNOT_EOK : KNOT_ECONN;
+}
+
+static bool check_recv(soa_check_t *check, knot_pkt_t *pkt)
+{
+	if (check->wire != NULL || knot_pkt_parse(pkt, 0) != KNOT_EOK ||
+	    knot_wire_get_tc(pkt->wire) || knot_pkt_qtype(pkt) != check->qtype ||
+	    !knot_dname_is_equal(knot_pkt_qname(pkt), check->zone)) {
+		return false;
+	}
+
+	uint8_t *wire = malloc(pkt->size);
+	if (wire == NULL) {
+		return false;
+	}
+	memcpy(wire, pkt->wire, pkt->size);
+	size_t wire_len = pkt->size;
+
+	if (tsig_verify_packet(&check->tsig, pkt) != KNOT_EOK ||
+	    tsig_unsigned_count(&check->tsig) != 0) {
+		free(wire);
+		return false;
+	}
+
+	check->wire = wire;
+	check->wire_len = wire_len;
+	return true;
+}
+
+/*!
+ * Sends the queries grouped by the remote, each group over its own
+ * UDP socket, and collects the responses until all arrive or time out.
+ */
+static void batch_run(soa_check_t **checks, size_t count)
+{
+	qsort(checks, count, sizeof(*checks), check_cmp);
+
+	struct pollfd *fds = calloc(count, sizeof(*fds));
+	size_t *firsts = calloc(count + 1, sizeof(*firsts));
+	uint16_t *ids = calloc(count, sizeof(*ids));
+	knot_pkt_t *pkt = knot_pkt_new(NULL, KNOT_WIRE_MAX_PKTSIZE, NULL);
+	if (fds == NULL || firsts == NULL || ids == NULL || pkt == NULL) {
+		goto cleanup;
+	}
+
+	size_t groups = 0, pending = 0;
+	int timeout_ms = 0;
+	for (size_t i = 0, next; i < count; i = next) {
+		for (next = i + 1; next < count && check_cmp(&checks[i], &checks[next]) == 0; next++);
+
+		firsts[groups] = i;
+		ids[groups] = dnssec_random_uint16_t();
+		fds[groups].events = POLLIN;
+		fds[groups].fd = net_connected_socket(SOCK_DGRAM, &checks[i]->remote,
+		                                      &checks[i]->via, false);
+		if (fds[groups].fd >= 0) {
+			for (size_t j = i; j < next; j++) {
+				uint16_t id = ids[groups] + (j - i);
+				if (check_send(fds[groups].fd, checks[j], pkt, id) == KNOT_EOK) {
+					pending++;
+				}
+			}
+		}
+		timeout_ms = MAX(timeout_ms, checks[i]->timeout_ms);
+		groups++;
+	}
+	firsts[groups] = count;
+
+	struct timespec begin = time_now();
+	while (pending > 0) {
+		struct timespec now = time_now();
+		int remains = timeout_ms - (int)time_diff_ms(&begin, &now);
+		if (remains <= 0) {
+			break;
+		}
+		int ret = poll(fds, groups, remains);
+		if (ret < 0 && errno == EINTR) {
+			continue;
+		} else if (ret <= 0) {
+			break;
+		}
+
+		for (size_t g = 0; g < groups; g++) {
+			if (fds[g].revents == 0) {
+				continue;
+			}
+			ssize_t len;
+			while (knot_pkt_clear(pkt),
+			       (len = recv(fds[g].fd, pkt->wire, pkt->max_size, MSG_DONTWAIT)) > 0) {
+				pkt->size = len;
+				uint16_t idx = knot_wire_get_id(pkt->wire) - ids[g];
+				if (idx < firsts[g + 1] - firsts[g] &&
+				    check_recv(checks[firsts[g] + idx], pkt)) {
+					pending--;
+				}
+			}
+			if (len < 0 && errno != EAGAIN && errno != EWOULDBLOCK) {
+				close(fds[g].fd); // E.g. ICMP unreachable, give up the primary.
+				fds[g].fd = -1;
+			}
+		}
+	}
+
+	for (size_t g = 0; g < groups; g++) {
+		if (fds[g].fd >= 0) {
+			close(fds[g].fd);
+		}
+	}
+cleanup:
+	knot_pkt_free(pkt);
+	free(ids);
+	free(firsts);
+	free(fds);
+}
+
+static void schedule_event(struct server *server, const soa_check_t *check)
+{
+	rcu_read_lock();
+	zone_t *zone = knot_zonedb_find(server->zone_db, check->zone);
+	if (zone != NULL) {
+		zone_events_schedule_now(zone, check->event);
+	}
+	rcu_read_unlock();
+}
+
+static void batch_purge(soa_batch_t *batch, time_t now)
+{
+	while (!EMPTY_LIST(batch->done)) {
+		soa_check_t *check = HEAD(batch->done);
+		if (now - check->finished < RESULT_TTL) {
+			break;
+		}
+		rem_node(&check->n);
+		trie_del(batch->checks, check->id, check->id_len, NULL);
+		check_free(check);
+	}
+}
+
+static void *batch_thread(void *arg)
+{
+	soa_batch_t *batch = arg;
+
+	rcu_register_thread();
+
+	pthread_mutex_lock(&batch->mx);
+	while (true) {
+		while (EMPTY_LIST(batch->queue) && !batch->stop) {
+			pthread_cond_wait(&batch->cond, &batch->mx);
+		}
+		if (batch->stop) {
+			break;
+		}
+
+		// Let more zones become due.
+		pthread_mutex_unlock(&batch->mx);
+		usleep(BATCH_DELAY_US);
+		pthread_mutex_lock(&batch->mx);
+
+		size_t count = 0;
+		soa_check_t *check, *next;
+		WALK_LIST_DELSAFE(check, next, batch->queue) {
+			if (count == BATCH_MAX) {
+				break;
+			}
+			rem_node(&check->n);
+			batch->run[count++] = check;
+		}
+		pthread_mutex_unlock(&batch->mx);
+
+		batch_run(batch->run, count);
+
+		pthread_mutex_lock(&batch->mx);
+		time_t now = time(NULL);
+		for (size_t i = 0; i < count; i++) {
+			check = batch->run[i];
+			check->done = true;
+			check->finished = now;
+			add_tail(&batch->done, &check->n);
+			schedule_event(batch->server, check);
+		}
+		batch_purge(batch, now);
+	}
+	pthread_mutex_unlock(&batch->mx);
+
+	rcu_unregister_thread();
+
+	return NULL;
+}
+
+soa_batch_t *soa_batch_init(struct server *server)
+{
+	soa_batch_t *batch = calloc(1, sizeof(*batch));
+	if (batch == NULL) {
+		return NULL;
+	}
+
+	batch->checks = trie_create(NULL);
+	batch->run = calloc(BATCH_MAX, sizeof(*batch->run));
+	if (batch->checks == NULL || batch->run == NULL) {
+		trie_free(batch->checks);
+		free(batch->run);
+		free(batch);
+		return NULL;
+	}
+
+	pthread_mutex_init(&batch->mx, NULL);
+	pthread_cond_init(&batch->cond, NULL);
+	init_list(&batch->queue);
+	init_list(&batch->done);
+	batch->server = server;
+
+	if (pthread_create(&batch->thread, NULL, batch_thread, batch) != 0) {
+		pthread_cond_destroy(&batch->cond);
+		pthread_mutex_destroy(&batch->mx);
+		trie_free(batch->checks);
+		free(batch->run);
+		free(batch);
+		return NULL;
+	}
+
+	return batch;
+}
+
+void soa_batch_deinit(soa_batch_t **batch)
+{
+	if (batch == NULL || *batch == NULL) {
+		return;
+	}
+
+	soa_batch_t *b = *batch;
+	*batch = NULL;
+
+	pthread_mutex_lock(&b->mx);
+	b->stop = true;
+	pthread_cond_signal(&b->cond);
+	pthread_mutex_unlock(&b->mx);
+
+	pthread_join(b->thread, NULL);
+
+	trie_apply(b->checks, check_free_cb, NULL);
+	trie_free(b->checks);
+	free(b->run);
+	pthread_cond_destroy(&b->cond);
+	pthread_mutex_destroy(&b->mx);
+	free(b);
+}
+
+static knot_pkt_t *check_response(const soa_check_t *check)
+{
+	knot_pkt_t *pkt = knot_pkt_new(NULL, check->wire_len, NULL);
+	if (pkt == NULL) {
+		return NULL;
+	}
+
+	memcpy(pkt->wire, check->wire, check->wire_len);
+	pkt->size = check->wire_len;
+	if (knot_pkt_parse(pkt, 0) != KNOT_EOK) {
+		knot_pkt_free(pkt);
+		return NULL;
+	}
+
+	return pkt;
+}
+
+static size_t check_id(uint8_t *id, const knot_dname_t *zone, uint16_t qtype,
+                        const struct sockaddr_storage *remote)
+{
+	size_t zone_size = knot_dname_size(zone);
+	int addr_len = sockaddr_len(remote);
+
+	knot_wire_write_u16(id, qtype);
+	memcpy(id + sizeof(qtype), zone, zone_size);
+	memcpy(id + sizeof(qtype) + zone_size, remote, addr_len);
+
+	return sizeof(qtype) + zone_size + addr_len;
+}
+
+static soa_check_t *check_new(const uint8_t *id, size_t id_len, const knot_dname_t *zone,
+                              uint16_t qtype, zone_event_type_t event,
+                              const conf_remote_t *remote, const query_edns_data_t *edns,
+                              int timeout_ms)
+{
+	soa_check_t *check = calloc(1, sizeof(*check));
+	if (check == NULL) {
+		return NULL;
+	}
+
+	check->id = malloc(id_len);
+	check->zone = knot_dname_copy(zone, NULL);
+	if (check->id == NULL || check->zone == NULL ||
+	    (remote->key.name != NULL &&
+	     knot_tsig_key_copy(&check->key, &remote->key) != KNOT_EOK)) {
+		check_free(check);
+		return NULL;
+	}
+	memcpy(check->id, id, id_len);
+	check->id_len = id_len;
+	check->qtype = qtype;
+	check->event = event;
+	check->edns = (edns != NULL) ? *edns : (query_edns_data_t){ .no_edns = true };
+	check->remote = remote->addr;
+	check->via = remote->via;
+	check->timeout_ms = timeout_ms;
+
+	return check;
+}
+
+int soa_batch_query(soa_batch_t *batch, const knot_dname_t *zone, uint16_t qtype,
+                    zone_event_type_t event, const conf_remote_t *remote,
+                    const query_edns_data_t *edns, int timeout_ms, knot_pkt_t **resp)
+{
+	if (batch == NULL || zone == NULL || remote == NULL) {
+		return KNOT_EINVAL;
+	} else if (remote->quic || remote->tls) {
+		return KNOT_ENOTSUP;
+	}
+
+	uint8_t id[sizeof(qtype) + KNOT_DNAME_MAXLEN + sizeof(struct sockaddr_storage)];
+	size_t id_len = check_id(id, zone, qtype, &remote->addr);
+
+	pthread_mutex_lock(&batch->mx);
+	trie_val_t *val = trie_get_try(batch->checks, id, id_len);
+	if (val != NULL) {
+		soa_check_t *check = *val;
+		if (!check->done) {
+			pthread_mutex_unlock(&batch->mx);
+			return KNOT_EAGAIN;
+		} else if (resp == NULL) {
+			pthread_mutex_unlock(&batch->mx);
+			return KNOT_EOK; // Left for later pick-up.
+		}
+		rem_node(&check->n);
+		trie_del(batch->checks, id, id_len, NULL);
+		pthread_mutex_unlock(&batch->mx);
+
+		*resp = (check->wire != NULL) ? check_response(check) : NULL;
+		check_free(check);
+		return KNOT_EOK;
+	}
+
+	soa_check_t *check = check_new(id, id_len, zone, qtype, event, remote,
+	                               edns, timeout_ms);
+	val = (check != NULL) ? trie_get_ins(batch->checks, id, id_len) : NULL;
+	if (val == NULL) {
+		pthread_mutex_unlock(&batch->mx);
+		if (check != NULL) {
+			check_free(check);
+		}
+		return KNOT_ENOMEM;
+	}
+	*val = check;
+	add_tail(&batch->queue, &check->n);
+	pthread_cond_signal(&batch->cond);
+	pthread_mutex_unlock(&batch->mx);
+
+	return KNOT_EAGAIN;
+}
+
+int soa_batch_check(soa_batch_t *batch, const knot_dname_t *zone,
+                    const conf_remote_t *remote, int timeout_ms, knot_pkt_t **resp)
+{
+	if (resp == NULL) {
+		return KNOT_EINVAL;
+	}
+
+	return soa_batch_query(batch, zone, KNOT_RRTYPE_SOA, ZONE_EVENT_REFRESH,
+	                       remote, NULL, timeout_ms, resp);
+}
@@ -0,0 +1,93 @@
+/*  Copyright (C) 2024 CZ.NIC, z.s.p.o. <knot-dns@labs.nic.cz>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+
+#pragma once
+
+#include "knot/conf/conf.h"
+#include "knot/events/events.h"
+#include "knot/query/query.h"
+#include "libknot/packet/pkt.h"
+
+struct server;
+
+/*!
+ * \brief Batched checking of zone SOA serials and parental DS records.
+ *
+ * Zones due for refresh (or DS check) are queued for a dedicated thread, which
+ * groups the queued checks by the remote, sends all their queries over one UDP
+ * socket per remote in a burst, and collects the responses asynchronously.
+ * Once a check is finished, the zone event is scheduled again and consumes the
+ * obtained response instead of querying the remote itself.
+ */
+typedef struct soa_batch soa_batch_t;
+
+/*!
+ * \brief Start the SOA checking thread.
+ *
+ * \param server   Server whose zones are refreshed.
+ *
+ * \return Allocated checker, or NULL.
+ */
+soa_batch_t *soa_batch_init(struct server *server);
+
+/*!
+ * \brief Stop the SOA checking thread, drop pending checks.
+ */
+void soa_batch_deinit(soa_batch_t **batch);
+
+/*!
+ * \brief Get the result of a zone query or queue the query.
+ *
+ * Checks are distinguished by the zone, query type, and remote address.
+ *
+ * \param batch        SOA checker.
+ * \param zone         Zone name (query name).
+ * \param qtype        Query type.
+ * \param event        Zone event to be scheduled once the query is finished.
+ * \param remote       Remote to be queried.
+ * \param edns         EDNS to be added into the query (NULL if none).
+ * \param timeout_ms   Response timeout.
+ * \param resp         Output: parsed and verified response, NULL if the query
+ *                     failed or was truncated. To be freed by the caller.
+ *                     If NULL, a finished result is only left for later pick-up.
+ *
+ * \retval KNOT_EOK      The query is finished, the result is returned.
+ * \retval KNOT_EAGAIN   The query is queued or in progress, the zone event
+ *                       will be scheduled once finished.
+ * \return KNOT_E*       The query is not possible.
+ */
+int soa_batch_query(soa_batch_t *batch, const knot_dname_t *zone, uint16_t qtype,
+                    zone_event_type_t event, const conf_remote_t *remote,
+                    const query_edns_data_t *edns, int timeout_ms, knot_pkt_t **resp);
+
+/*!
+ * \brief Get the result of the zone SOA check or queue the check.
+ *
+ * \param batch        SOA checker.
+ * \param zone         Zone name.
+ * \param remote       Primary to be checked.
+ * \param timeout_ms   Response timeout.
+ * \param resp         Output: parsed and verified SOA response, NULL if the check
+ *                     failed. To be freed by the caller.
+ *
+ * \retval KNOT_EOK      The check is finished, the result is returned.
+ * \retval KNOT_EAGAIN   The check is queued or in progress, the zone refresh
+ *                       will be scheduled once finished.
+ * \return KNOT_E*       The check is not possible.
+ */
+int soa_batch_check(soa_batch_t *batch, const knot_dname_t *zone,
+                    const conf_remote_t *remote, int timeout_ms, knot_pkt_t **resp);
@@ -0,0 +1,356 @@
+/*  Copyright (C) 2024 CZ.NIC, z.s.p.o. <knot-dns@labs.nic.cz>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include <assert.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <urcu.h>
+
+#include "knot/server/suspend.h"
+#include "knot/conf/conf.h"
+#include "knot/nameserver/process_query.h"
+#include "knot/server/handler.h"
+#include "contrib/mempattern.h"
+#include "contrib/net.h"
+#include "contrib/sockaddr.h"
+#include "contrib/ucw/lists.h"
+#include "contrib/ucw/mempool.h"
+#include "libknot/quic/tls.h"
+#ifdef ENABLE_QUIC
+#include "libknot/quic/quic.h"
+#include "libknot/quic/quic_conn.h"
+#endif // ENABLE_QUIC
+
+struct suspend_queue {
+	pthread_mutex_t lock; /*!< Protects the members below. */
+	list_t ready;         /*!< Resumed queries to be answered. */
+	int notify[2];        /*!< Notification pipe of the owning thread. */
+	unsigned refs;        /*!< Owner + suspended queries. */
+	bool closed;          /*!< The owning thread is gone. */
+};
+
+struct knotd_suspended {
+	node_t n;
+	suspend_queue_t *queue;          /*!< Queue of the owning thread. */
+	knot_mm_t mm;                    /*!< Processing memory context. */
+	knot_layer_t layer;              /*!< Detached processing layer. */
+	knotd_qdata_params_t params;     /*!< Copy of the processing parameters. */
+	struct sockaddr_storage remote;  /*!< Remote address storage. */
+	struct sockaddr_storage local;   /*!< Local address storage. */
+};
+
+suspend_queue_t *suspend_queue_new(void)
+{
+	suspend_queue_t *queue = calloc(1, sizeof(*queue));
+	if (queue == NULL) {
+		return NULL;
+	}
+
+	if (pipe(queue->notify) != 0) {
+		free(queue);
+		return NULL;
+	}
+	if (fcntl(queue->notify[0], F_SETFL, O_NONBLOCK) != 0 ||
+	    fcntl(queue->notify[1], F_SETFL, O_NONBLOCK) != 0) {
+		close(queue->notify[0]);
+		close(queue->notify[1]);
+		free(queue);
+		return NULL;
+	}
+
+	pthread_mutex_init(&queue->lock, NULL);
+	init_list(&queue->ready);
+	queue->refs = 1;
+
+	return queue;
+}
+
+static void queue_unref(suspend_queue_t *queue)
+{
+	pthread_mutex_lock(&queue->lock);
+	bool last = (--queue->refs == 0);
+	pthread_mutex_unlock(&queue->lock);
+
+	if (last) {
+		assert(EMPTY_LIST(queue->ready));
+		pthread_mutex_destroy(&queue->lock);
+		close(queue->notify[0]);
+		close(queue->notify[1]);
+		free(queue);
+	}
+}
+
+/*!
+ * \brief Free the suspended query.
+ *
+ * \param s       Suspended query.
+ * \param owner   Freed by the owning thread, the connection contexts are valid.
+ */
+static void suspended_free(knotd_suspended_t *s, bool owner)
+{
+	suspend_queue_t *queue = s->queue;
+
+	// Without the owner, the connection contexts may be gone already.
+	// Not unblocked if suspended again.
+	bool unblock = owner && s->layer.state != KNOT_STATE_YIELD;
+#ifdef ENABLE_QUIC
+	if (s->params.quic_conn != NULL && unblock) {
+		knot_quic_conn_block(s->params.quic_conn, false);
+	}
+#endif // ENABLE_QUIC
+	if (s->params.tls_conn != NULL && owner) {
+		if (unblock) {
+			knot_tls_conn_block(s->params.tls_conn, false);
+		}
+		knot_tls_conn_del(s->params.tls_conn);
+	}
+
+	knot_layer_finish(&s->layer);
+	close(s->params.socket);
+	mp_delete(s->mm.ctx);
+	free(s);
+
+	queue_unref(queue);
+}
+
+void suspend_queue_free(suspend_queue_t *queue)
+{
+	if (queue == NULL) {
+		return;
+	}
+
+	list_t ready;
+	init_list(&ready);
+
+	pthread_mutex_lock(&queue->lock);
+	queue->closed = true;
+	knotd_suspended_t *s, *nxt;
+	WALK_LIST_DELSAFE(s, nxt, queue->ready) {
+		rem_node(&s->n);
+		add_tail(&ready, &s->n);
+	}
+	pthread_mutex_unlock(&queue->lock);
+
+	WALK_LIST_DELSAFE(s, nxt, ready) {
+		suspended_free(s, false);
+	}
+
+	queue_unref(queue);
+}
+
+int suspend_queue_fd(const suspend_queue_t *queue)
+{
+	return queue->notify[0];
+}
+
+knotd_suspended_t *suspend_query(suspend_queue_t *queue, knotd_qdata_t *qdata)
+{
+	assert(queue && qdata);
+
+	knotd_suspended_t *s = calloc(1, sizeof(*s));
+	if (s == NULL) {
+		return NULL;
+	}
+
+	/* Keep the socket and the addresses. */
+	s->params = *qdata->params;
+	s->params.socket = dup(qdata->params->socket);
+	if (s->params.socket < 0) {
+		free(s);
+		return NULL;
+	}
+	memcpy(&s->remote, qdata->params->remote, sockaddr_len(qdata->params->remote));
+	memcpy(&s->local, qdata->params->local, sockaddr_len(qdata->params->local));
+	s->params.remote = &s->remote;
+	s->params.local = &s->local;
+	s->queue = queue;
+
+	/* Create the detached processing with a copy of the query. */
+	mm_ctx_mempool(&s->mm, MM_DEFAULT_BLKSIZE);
+	knot_layer_init(&s->layer, &s->mm, process_query_layer());
+	knot_layer_begin(&s->layer, &s->params);
+
+	knot_pkt_t *query = knot_pkt_new(NULL, qdata->query->max_size, &s->mm);
+	if (query == NULL || knot_pkt_copy(query, qdata->query) != KNOT_EOK) {
+		knot_layer_finish(&s->layer);
+		close(s->params.socket);
+		mp_delete(s->mm.ctx);
+		free(s);
+		return NULL;
+	}
+	knot_layer_consume(&s->layer, query);
+
+#ifdef ENABLE_QUIC
+	if (s->params.quic_conn != NULL) {
+		knot_quic_conn_block(s->params.quic_conn, true);
+	}
+#endif // ENABLE_QUIC
+	if (s->params.tls_conn != NULL) {
+		s->params.tls_conn->fd_clones_count++;
+		knot_tls_conn_block(s->params.tls_conn, true);
+	}
+
+	pthread_mutex_lock(&queue->lock);
+	queue->refs++;
+	pthread_mutex_unlock(&queue->lock);
+
+	return s;
+}
+
+knotd_qdata_t *suspend_qdata(knotd_suspended_t *handle)
+{
+	return handle->layer.data;
+}
+
+void suspend_resume(knotd_suspended_t *handle, knotd_state_t state)
+{
+	suspend_queue_t *queue = handle->queue;
+
+	knotd_qdata_t *qdata = suspend_qdata(handle);
+	qdata->extra->resume.state = state;
+
+	pthread_mutex_lock(&queue->lock);
+	if (queue->closed) {
+		pthread_mutex_unlock(&queue->lock);
+		suspended_free(handle, false);
+		return;
+	}
+	add_tail(&queue->ready, &handle->n);
+	if (write(queue->notify[1], "", 1) != 1) {
+		// A full pipe means a pending notification.
+	}
+	pthread_mutex_unlock(&queue->lock);
+}
+
+#ifdef ENABLE_QUIC
+static int suspended_alloc_reply(knot_quic_reply_t *r)
+{
+	r->out_payload->iov_len = KNOT_WIRE_MAX_PKTSIZE;
+
+	return KNOT_EOK;
+}
+
+static int suspended_send_reply(knot_quic_reply_t *r)
+{
+	int fd = *(int *)r->sock;
+	int ret = net_dgram_send(fd, r->out_payload->iov_base, r->out_payload->iov_len, r->ip_rem);
+	if (ret < 0) {
+		return knot_map_errno();
+	} else if (ret == r->out_payload->iov_len) {
+		return KNOT_EOK;
+	} else {
+		return KNOT_EAGAIN;
+	}
+}
+
+static void suspended_free_reply(knot_quic_reply_t *r)
+{
+	r->out_payload->iov_len = 0;
+}
+
+static void suspended_quic_flush(knotd_suspended_t *s)
+{
+	uint8_t buf[KNOT_WIRE_MAX_PKTSIZE];
+	struct iovec out_payload = { .iov_base = buf, .iov_len = sizeof(buf) };
+	knot_quic_reply_t rpl = {
+		.ip_rem = s->params.remote,
+		.ip_loc = s->params.local,
+		.out_payload = &out_payload,
+		.sock = &s->params.socket,
+		.alloc_reply = suspended_alloc_reply,
+		.send_reply = suspended_send_reply,
+		.free_reply = suspended_free_reply
+	};
+
+	knot_quic_conn_t *conn = s->params.quic_conn;
+	(void)knot_quic_send(conn->quic_table, conn, &rpl, QUIC_MAX_SEND_PER_RECV,
+	                     KNOT_QUIC_SEND_IGNORE_BLOCKED);
+}
+#endif // ENABLE_QUIC
+
+static int suspended_send(knotd_suspended_t *s, knot_pkt_t *ans)
+{
+	knotd_qdata_params_t *params = &s->params;
+	ssize_t ret;
+
+#ifdef ENABLE_QUIC
+	if (params->quic_conn != NULL) {
+		void *succ = knot_quic_stream_add_data(params->quic_conn, params->quic_stream,
+		                                       ans->wire, ans->size);
+		return (succ != NULL) ? KNOT_EOK : KNOT_ENOMEM;
+	}
+#endif // ENABLE_QUIC
+	if (params->tls_conn != NULL) {
+		ret = knot_tls_send_dns(params->tls_conn, ans->wire, ans->size);
+	} else if (params->proto == KNOTD_QUERY_PROTO_TCP) {
+		rcu_read_lock();
+		int timeout = conf()->cache.srv_tcp_io_timeout;
+		rcu_read_unlock();
+		ret = net_dns_tcp_send(params->socket, ans->wire, ans->size, timeout, NULL);
+	} else {
+		ret = net_dgram_send(params->socket, ans->wire, ans->size, params->remote);
+	}
+
+	return (ret == ans->size) ? KNOT_EOK : KNOT_ECONN;
+}
+
+static void suspended_answer(knotd_suspended_t *s)
+{
+	uint8_t buf[KNOT_WIRE_MAX_PKTSIZE];
+	knot_pkt_t *ans = knot_pkt_new(buf, sizeof(buf), &s->mm);
+
+	while (active_state(s->layer.state)) {
+		knot_layer_produce(&s->layer, ans);
+		if (ans->size > 0 && send_state(s->layer.state) &&
+		    suspended_send(s, ans) != KNOT_EOK) {
+			break;
+		}
+	}
+
+#ifdef ENABLE_QUIC
+	if (s->params.quic_conn != NULL) {
+		suspended_quic_flush(s);
+	}
+#endif // ENABLE_QUIC
+}
+
+void suspend_queue_process(suspend_queue_t *queue)
+{
+	uint8_t tokens[64];
+	while (read(queue->notify[0], tokens, sizeof(tokens)) > 0);
+
+	while (true) {
+		pthread_mutex_lock(&queue->lock);
+		knotd_suspended_t *s = NULL;
+		if (!EMPTY_LIST(queue->ready)) {
+			s = HEAD(queue->ready);
+			rem_node(&s->n);
+		}
+		pthread_mutex_unlock(&queue->lock);
+		if (s == NULL) {
+			break;
+		}
+
+		// The answer is skipped if the hook didn't really yield.
+		if (suspend_qdata(s)->extra->resume.set) {
+			suspended_answer(s);
+		}
+		suspended_free(s, true);
+	}
+}
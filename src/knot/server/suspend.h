@@ -0,0 +1,78 @@
+/*  Copyright (C) 2024 CZ.NIC, z.s.p.o. <knot-dns@labs.nic.cz>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include "knot/include/module.h"
+
+/*!
+ * \brief Queue of suspended queries of one server thread.
+ *
+ * A query suspended by a module keeps its own copy of the query and of the
+ * processing context. Once resumed from any thread, the query is moved to the
+ * ready list and the owning thread is notified via a pipe, which is polled
+ * together with its network sockets. The answer is produced and sent from
+ * the owning thread, so that the connection contexts aren't shared.
+ */
+typedef struct suspend_queue suspend_queue_t;
+
+/*!
+ * \brief Create a queue of suspended queries.
+ *
+ * \return Allocated queue, or NULL.
+ */
+suspend_queue_t *suspend_queue_new(void);
+
+/*!
+ * \brief Close the queue, drop the ready queries.
+ *
+ * Queries resumed after closing are dropped immediately. The queue is freed
+ * once no suspended query refers to it.
+ */
+void suspend_queue_free(suspend_queue_t *queue);
+
+/*!
+ * \brief Get the notification descriptor to be polled for input.
+ */
+int suspend_queue_fd(const suspend_queue_t *queue);
+
+/*!
+ * \brief Answer the resumed queries.
+ */
+void suspend_queue_process(suspend_queue_t *queue);
+
+/*!
+ * \brief Detach the query from the current network event.
+ *
+ * \param queue   Queue of the current thread.
+ * \param qdata   Query data of the query being processed.
+ *
+ * \return Suspended query handle, or NULL.
+ */
+knotd_suspended_t *suspend_query(suspend_queue_t *queue, knotd_qdata_t *qdata);
+
+/*!
+ * \brief Get the query data of the suspended query.
+ */
+knotd_qdata_t *suspend_qdata(knotd_suspended_t *handle);
+
+/*!
+ * \brief Hand the suspended query over to the owning thread.
+ *
+ * \param handle  Suspended query handle.
+ * \param state   Result of the suspended hook.
+ */
+void suspend_resume(knotd_suspended_t *handle, knotd_state_t state);
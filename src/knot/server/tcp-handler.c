@@ -23,7 +23,9 @@
 #include <netinet/tcp.h>
 #include <netinet/in.h>
 #include <stdio.h>
+#include <sys/mman.h>
 #include <stdlib.h>
+#include <pthread.h>
 #include <urcu.h>
 #ifdef HAVE_SYS_UIO_H	// struct iovec (OpenBSD)
 #include <sys/uio.h>
@@ -31,12 +33,15 @@
 
 #include "knot/server/handler.h"
 #include "knot/server/server.h"
+#include "knot/server/suspend.h"
 #include "knot/server/tcp-handler.h"
 #include "knot/common/log.h"
+#include "knot/common/probes.h"
 #include "knot/common/fdset.h"
 #include "knot/nameserver/process_query.h"
 #include "knot/query/layer.h"
 #include "libknot/quic/tls.h"
+#include "contrib/bufpool.h"
 #include "contrib/macros.h"
 #include "contrib/mempattern.h"
 #include "contrib/net.h"
@@ -45,6 +50,29 @@
 #include "contrib/time.h"
 #include "contrib/ucw/mempool.h"
 
+#define TCP_ZC_NBUFS 8 /*!< Number of zero-copy TX buffers per worker. */
+
+/*! \brief Connection state shared with the workers processing its queries. */
+typedef struct {
+	pthread_mutex_t lock;            /*!< Serializes sending, protects 'jobs'. */
+	pthread_cond_t done;             /*!< Signalled when a query is finished. */
+	unsigned jobs;                   /*!< Number of unfinished handed over queries. */
+	int fd;                          /*!< Connection socket. */
+	knot_tls_conn_t *tls_conn;       /*!< DoT connection if any. */
+} tcp_conn_t;
+
+/*! \brief Pipelined query to be processed by any TCP worker. */
+typedef struct {
+	node_t n;
+	tcp_conn_t *conn;                /*!< Originating connection. */
+	knotd_query_proto_t proto;       /*!< Transport protocol. */
+	knotd_query_flag_t flags;        /*!< Query flags of the connection. */
+	struct sockaddr_storage remote;  /*!< Remote address. */
+	struct sockaddr_storage local;   /*!< Local address. */
+	size_t len;                      /*!< Query size. */
+	uint8_t query[];                 /*!< Query wire. */
+} tcp_job_t;
+
 /*! \brief TCP context data. */
 typedef struct tcp_context {
 	knot_layer_t layer;              /*!< Query processing layer. */
@@ -59,9 +87,37 @@ typedef struct tcp_context {
 	int idle_timeout;                /*!< [s] TCP idle timeout configuration. */
 	int io_timeout;                  /*!< [ms] TCP send/recv timeout configuration. */
 	struct knot_tls_ctx *tls_ctx;    /*!< DoT answering context. */
+	bool zerocopy;                   /*!< Zero-copy sending of XFR messages. */
+	uint8_t *zc_bufs[TCP_ZC_NBUFS];  /*!< Zero-copy TX buffers. */
+	unsigned prefix_max_clients;     /*!< Max TCP clients per client prefix configuration. */
+	uint32_t *fd_bucket;             /*!< Counted prefix bucket (+1) per client fd. */
+	unsigned fd_bucket_size;         /*!< Allocated size of fd_bucket. */
+	uint8_t *obuf;                   /*!< Batched responses output buffer. */
+	size_t obuf_len;                 /*!< Length of the batched responses. */
+	bool out_of_order;               /*!< Hand over pipelined queries to other workers. */
+	bool ktls;                       /*!< Kernel TLS offload of DoT connections. */
+	tcp_conn_t **fd_conn;            /*!< Shared connection state per client fd. */
+	unsigned fd_conn_size;           /*!< Allocated size of fd_conn. */
+	tcp_conn_t *conn;                /*!< Shared state of the served connection. */
+	unsigned spin_us;                /*!< [us] Busy-poll spinning before blocking poll. */
+	knot_atomic_uint64_t *spin_stat; /*!< Busy-poll spinning time export. */
+	suspend_queue_t *suspend;        /*!< Suspended queries. */
 } tcp_context_t;
 
 #define TCP_SWEEP_INTERVAL 2 /*!< [secs] granularity of connection sweeping. */
+#define TCP_ZC_BUFSIZE (sizeof(uint16_t) + KNOT_WIRE_MAX_PKTSIZE)
+#define TCP_V4_PREFIX 24 /*!< Client prefix length for IPv4 admission control. */
+#define TCP_V6_PREFIX 56 /*!< Client prefix length for IPv6 admission control. */
+#define TCP_PIPELINE_MAX 16 /*!< Max queries served per connection wakeup. */
+#define TCP_OBUF_SIZE 16384 /*!< Size of the batched responses output buffer. */
+
+/*! \brief Zero-copy sending state of one response. */
+typedef struct {
+	unsigned idx;                  /*!< Next buffer to be used. */
+	uint32_t sent;                 /*!< Number of zero-copy send operations. */
+	uint32_t done;                 /*!< Number of completed operations. */
+	uint32_t last[TCP_ZC_NBUFS];   /*!< Last operation using the buffer. */
+} tcp_zc_t;
 
 static void update_sweep_timer(struct timespec *timer)
 {
@@ -77,10 +133,15 @@ static void update_tcp_conf(tcp_context_t *tcp)
 		MAX(pconf->cache.srv_tcp_max_clients / pconf->cache.srv_tcp_threads, 1);
 	tcp->idle_timeout = pconf->cache.srv_tcp_idle_timeout;
 	tcp->io_timeout = pconf->cache.srv_tcp_io_timeout;
+	tcp->zerocopy = pconf->cache.srv_tcp_zerocopy;
+	tcp->prefix_max_clients = pconf->cache.srv_tcp_prefix_max_clients;
+	tcp->out_of_order = pconf->cache.srv_tcp_out_of_order;
+	tcp->ktls = pconf->cache.srv_ktls;
 	rcu_read_unlock();
 
 	if (tcp->tls_ctx != NULL) {
 		tcp->tls_ctx->io_timeout = tcp->io_timeout;
+		tcp->tls_ctx->ktls = tcp->ktls;
 	}
 }
 
@@ -93,24 +154,66 @@ static void free_tls_ctx(fdset_t *set, int idx)
 	}
 }
 
-/*! \brief Sweep TCP connection. */
-static fdset_sweep_state_t tcp_sweep(fdset_t *set, int idx, _unused_ void *data)
+static uint32_t tcp_client_bucket(const server_t *server, const struct sockaddr_storage *ss)
 {
-	const int fd = fdset_get_fd(set, idx);
-	assert(set && fd >= 0);
+	uint8_t key[8] = { ss->ss_family };
+	if (ss->ss_family == AF_INET6) {
+		const struct sockaddr_in6 *sa6 = (const struct sockaddr_in6 *)ss;
+		memcpy(key + 1, &sa6->sin6_addr, TCP_V6_PREFIX / 8);
+	} else {
+		const struct sockaddr_in *sa = (const struct sockaddr_in *)ss;
+		memcpy(key + 1, &sa->sin_addr, TCP_V4_PREFIX / 8);
+	}
 
-	/* Best-effort, name and shame. */
-	struct sockaddr_storage ss = { 0 };
-	socklen_t len = sizeof(struct sockaddr_storage);
-	if (getpeername(fd, (struct sockaddr *)&ss, &len) == 0) {
-		char addr_str[SOCKADDR_STRLEN];
-		sockaddr_tostr(addr_str, sizeof(addr_str), &ss);
-		log_notice("TCP, terminated inactive client, address %s", addr_str);
+	return SipHash24(&server->tcp_clients.key, key, sizeof(key)) % TCP_PREFIX_BUCKETS;
+}
+
+/*!
+ * \brief Count a new client connection, reject it if its prefix has too many.
+ *
+ * \note The check isn't atomic with the increment, the limit can be slightly
+ *       exceeded with concurrent accepts in more workers.
+ */
+static bool tcp_client_admit(tcp_context_t *tcp, int client,
+                             const struct sockaddr_storage *ss)
+{
+	if (tcp->prefix_max_clients == 0 ||
+	    (ss->ss_family != AF_INET && ss->ss_family != AF_INET6)) {
+		return true;
 	}
 
-	free_tls_ctx(set, idx);
+	if (client >= tcp->fd_bucket_size) {
+		unsigned new_size = client + FDSET_RESIZE_STEP;
+		uint32_t *new_map = realloc(tcp->fd_bucket, new_size * sizeof(*new_map));
+		if (new_map == NULL) {
+			return true; // Don't count the client.
+		}
+		memset(new_map + tcp->fd_bucket_size, 0,
+		       (new_size - tcp->fd_bucket_size) * sizeof(*new_map));
+		tcp->fd_bucket = new_map;
+		tcp->fd_bucket_size = new_size;
+	}
 
-	return FDSET_SWEEP;
+	knot_atomic_uint16_t *conns = tcp->server->tcp_clients.conns;
+	uint32_t bucket = tcp_client_bucket(tcp->server, ss);
+	if (ATOMIC_GET(conns[bucket]) >= tcp->prefix_max_clients) {
+		ATOMIC_ADD(tcp->server->tcp_clients.rejected, 1);
+		return false;
+	}
+	ATOMIC_ADD(conns[bucket], 1);
+	tcp->fd_bucket[client] = bucket + 1;
+
+	return true;
+}
+
+static void tcp_client_release(tcp_context_t *tcp, int fd)
+{
+	if (fd >= tcp->fd_bucket_size || tcp->fd_bucket[fd] == 0) {
+		return;
+	}
+
+	ATOMIC_SUB(tcp->server->tcp_clients.conns[tcp->fd_bucket[fd] - 1], 1);
+	tcp->fd_bucket[fd] = 0;
 }
 
 static void tcp_log_error(const struct sockaddr_storage *ss, const char *operation, int ret)
@@ -158,8 +261,442 @@ static unsigned tcp_set_ifaces(const iface_t *ifaces, size_t n_ifaces,
 	return fdset_get_length(fds);
 }
 
+static void tcp_zc_free(tcp_context_t *tcp)
+{
+	for (unsigned i = 0; i < TCP_ZC_NBUFS; i++) {
+		if (tcp->zc_bufs[i] != NULL) {
+			munmap(tcp->zc_bufs[i], TCP_ZC_BUFSIZE);
+			tcp->zc_bufs[i] = NULL;
+		}
+	}
+}
+
+/*!
+ * \brief Prepare zero-copy sending of a zone transfer response.
+ *
+ * The buffers are mapped separately so that buffers possibly still used
+ * by the kernel can be dropped without any later reuse of their pages.
+ */
+static bool tcp_zc_init(tcp_context_t *tcp, knotd_qdata_params_t *params)
+{
+	knotd_qdata_t *qdata = tcp->layer.data;
+	if (!tcp->zerocopy || params->tls_conn != NULL || tcp->conn != NULL ||
+	    (qdata->type != KNOTD_QUERY_TYPE_AXFR && qdata->type != KNOTD_QUERY_TYPE_IXFR)) {
+		return false;
+	}
+
+	for (unsigned i = 0; i < TCP_ZC_NBUFS; i++) {
+		if (tcp->zc_bufs[i] == NULL) {
+			void *buf = mmap(NULL, TCP_ZC_BUFSIZE, PROT_READ | PROT_WRITE,
+			                 MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+			if (buf == MAP_FAILED) {
+				return false;
+			}
+			tcp->zc_bufs[i] = buf;
+		}
+	}
+
+	return net_zerocopy_enable(params->socket) == KNOT_EOK;
+}
+
+/*! \brief Use the next zero-copy buffer for the response, once it's released. */
+static int tcp_zc_next(tcp_context_t *tcp, tcp_zc_t *zc, int fd, knot_pkt_t *ans)
+{
+	if ((int32_t)(zc->last[zc->idx] - zc->done) > 0) {
+		int ret = net_zerocopy_wait(fd, &zc->done, zc->last[zc->idx],
+		                            tcp->io_timeout);
+		if (ret != KNOT_EOK) {
+			return ret;
+		}
+	}
+
+	ans->wire = tcp->zc_bufs[zc->idx] + sizeof(uint16_t);
+	ans->max_size = KNOT_WIRE_MAX_PKTSIZE;
+
+	return KNOT_EOK;
+}
+
+static int tcp_zc_send(tcp_context_t *tcp, tcp_zc_t *zc, int fd, knot_pkt_t *ans)
+{
+	uint8_t *frame = ans->wire - sizeof(uint16_t);
+	knot_wire_write_u16(frame, ans->size);
+
+	int ret = net_zerocopy_send(fd, frame, sizeof(uint16_t) + ans->size,
+	                            tcp->io_timeout, &zc->sent);
+	zc->last[zc->idx] = zc->sent;
+	zc->idx = (zc->idx + 1) % TCP_ZC_NBUFS;
+
+	return (ret < 0) ? ret : ans->size; /* Do not count the size prefix. */
+}
+
+/*! \brief Wait until the kernel releases all the buffers, drop them if it fails. */
+static void tcp_zc_finish(tcp_context_t *tcp, tcp_zc_t *zc, int fd, bool wait)
+{
+	if (zc->done == zc->sent) {
+		return;
+	}
+
+	if (!wait || net_zerocopy_wait(fd, &zc->done, zc->sent, tcp->io_timeout) != KNOT_EOK) {
+		tcp_zc_free(tcp);
+	}
+}
+
+static void tcp_conn_lock(tcp_context_t *tcp)
+{
+	if (tcp->conn != NULL) {
+		pthread_mutex_lock(&tcp->conn->lock);
+	}
+}
+
+static void tcp_conn_unlock(tcp_context_t *tcp)
+{
+	if (tcp->conn != NULL) {
+		pthread_mutex_unlock(&tcp->conn->lock);
+	}
+}
+
+/*! \brief Send the batched responses at once. */
+static int tcp_flush(tcp_context_t *tcp, knotd_qdata_params_t *params)
+{
+	if (tcp->obuf_len == 0) {
+		return KNOT_EOK;
+	}
+
+	size_t len = tcp->obuf_len;
+	tcp->obuf_len = 0;
+
+	ssize_t sent;
+	tcp_conn_lock(tcp);
+	if (params->tls_conn != NULL) {
+		sent = knot_tls_send(params->tls_conn, tcp->obuf, len);
+	} else {
+		sent = net_stream_send(params->socket, tcp->obuf, len, tcp->io_timeout);
+	}
+	tcp_conn_unlock(tcp);
+	if (sent < 0) {
+		return sent;
+	}
+
+	return (sent == len) ? KNOT_EOK : KNOT_NET_ESEND;
+}
+
+/*! \brief Append the response to the batch, send a too big one directly. */
+static int tcp_send(tcp_context_t *tcp, knotd_qdata_params_t *params, knot_pkt_t *ans)
+{
+	size_t frame_len = sizeof(uint16_t) + ans->size;
+	if (tcp->obuf_len + frame_len > TCP_OBUF_SIZE) {
+		int ret = tcp_flush(tcp, params);
+		if (ret != KNOT_EOK) {
+			return ret;
+		}
+	}
+
+	if (frame_len <= TCP_OBUF_SIZE) {
+		uint8_t *frame = tcp->obuf + tcp->obuf_len;
+		knot_wire_write_u16(frame, ans->size);
+		memcpy(frame + sizeof(uint16_t), ans->wire, ans->size);
+		tcp->obuf_len += frame_len;
+		return KNOT_EOK;
+	}
+
+	int sent;
+	tcp_conn_lock(tcp);
+	if (params->tls_conn != NULL) {
+		sent = knot_tls_send_dns(params->tls_conn, ans->wire, ans->size);
+	} else {
+		sent = net_dns_tcp_send(params->socket, ans->wire, ans->size,
+		                        tcp->io_timeout, NULL);
+	}
+	tcp_conn_unlock(tcp);
+	if (sent < 0) {
+		return sent;
+	}
+
+	return (sent == ans->size) ? KNOT_EOK : KNOT_NET_ESEND;
+}
+
+/*!
+ * \brief Check if the next query has already arrived on the connection.
+ *
+ * For plain TCP, the size prefix must be available so that the following
+ * (blocking) receive doesn't wait for a query which hasn't been sent yet.
+ */
+static bool tcp_pending(knotd_qdata_params_t *params)
+{
+	uint8_t buf[sizeof(uint16_t)];
+
+	if (params->tls_conn != NULL) {
+		knot_tls_conn_t *conn = params->tls_conn;
+		if (!(conn->flags & KNOT_TLS_CONN_HANDSHAKE_DONE) ||
+		    (conn->flags & KNOT_TLS_CONN_BLOCKED)) {
+			return false;
+		}
+		return knot_tls_recv_pending(conn) ||
+		       recv(params->socket, buf, 1, MSG_PEEK | MSG_DONTWAIT) > 0;
+	}
+
+	return recv(params->socket, buf, sizeof(buf), MSG_PEEK | MSG_DONTWAIT) == sizeof(buf);
+}
+
+/*! \brief Process the received query and send the responses. */
+static int tcp_process(tcp_context_t *tcp, knotd_qdata_params_t *params,
+                       struct iovec *rx, struct iovec *tx)
+{
+	KNOTD_PROBE2(tcp__recv, params->thread_id, rx->iov_len);
+
+	handle_query(params, &tcp->layer, rx, NULL);
+
+	/* Send zone transfers without copying, if enabled. */
+	tcp_zc_t zc = { 0 };
+	bool zerocopy = tcp_zc_init(tcp, params);
+	if (zerocopy) {
+		int ret = tcp_flush(tcp, params);
+		if (ret != KNOT_EOK) {
+			handle_finish(&tcp->layer);
+			return ret;
+		}
+	}
+
+	/* Resolve until NOOP or finished. */
+	knot_pkt_t *ans = knot_pkt_new(tx->iov_base, tx->iov_len, tcp->layer.mm);
+	while (active_state(tcp->layer.state)) {
+		if (zerocopy) {
+			int ret = tcp_zc_next(tcp, &zc, params->socket, ans);
+			if (ret != KNOT_EOK) {
+				tcp_zc_finish(tcp, &zc, params->socket, false);
+				handle_finish(&tcp->layer);
+				return ret;
+			}
+		}
+		knot_layer_produce(&tcp->layer, ans);
+		/* Send, if response generation passed and wasn't ignored. */
+		if (ans->size > 0 && send_state(tcp->layer.state)) {
+			int ret;
+			if (zerocopy) {
+				int sent = tcp_zc_send(tcp, &zc, params->socket, ans);
+				ret = (sent == ans->size) ? KNOT_EOK : sent;
+			} else {
+				ret = tcp_send(tcp, params, ans);
+			}
+			KNOTD_PROBE3(tcp__send, params->thread_id, ans->size, ret);
+			if (ret != KNOT_EOK) {
+				tcp_zc_finish(tcp, &zc, params->socket, false);
+				handle_finish(&tcp->layer);
+				return ret;
+			}
+		}
+	}
+
+	tcp_zc_finish(tcp, &zc, params->socket, true);
+	handle_finish(&tcp->layer);
+
+	return KNOT_EOK;
+}
+
+/*! \brief Get the shared state of the served connection, create it if needed. */
+static tcp_conn_t *tcp_conn_get(tcp_context_t *tcp, knotd_qdata_params_t *params)
+{
+	if (tcp->conn != NULL) {
+		return tcp->conn;
+	}
+
+	int fd = params->socket;
+	if (fd >= tcp->fd_conn_size) {
+		unsigned new_size = fd + FDSET_RESIZE_STEP;
+		tcp_conn_t **new_map = realloc(tcp->fd_conn, new_size * sizeof(*new_map));
+		if (new_map == NULL) {
+			return NULL;
+		}
+		memset(new_map + tcp->fd_conn_size, 0,
+		       (new_size - tcp->fd_conn_size) * sizeof(*new_map));
+		tcp->fd_conn = new_map;
+		tcp->fd_conn_size = new_size;
+	}
+
+	tcp_conn_t *conn = bufpool_alloc(sizeof(*conn));
+	if (conn == NULL) {
+		return NULL;
+	}
+	memset(conn, 0, sizeof(*conn));
+	pthread_mutex_init(&conn->lock, NULL);
+	pthread_cond_init(&conn->done, NULL);
+	conn->fd = fd;
+	conn->tls_conn = params->tls_conn;
+
+	tcp->fd_conn[fd] = conn;
+	tcp->conn = conn;
+
+	return conn;
+}
+
+/*! \brief Hand over the received query to any TCP worker. */
+static bool tcp_job_push(tcp_context_t *tcp, knotd_qdata_params_t *params,
+                         struct iovec *rx)
+{
+	/* Keep the order of possibly dependent updates. */
+	if (rx->iov_len < KNOT_WIRE_HEADER_SIZE ||
+	    knot_wire_get_opcode(rx->iov_base) != KNOT_OPCODE_QUERY) {
+		return false;
+	}
+
+	tcp_conn_t *conn = tcp_conn_get(tcp, params);
+	if (conn == NULL) {
+		return false;
+	}
+
+	tcp_job_t *job = bufpool_alloc(sizeof(*job) + rx->iov_len);
+	if (job == NULL) {
+		return false;
+	}
+	job->conn = conn;
+	job->proto = params->proto;
+	job->flags = params->flags;
+	memcpy(&job->remote, params->remote, sockaddr_len(params->remote));
+	memcpy(&job->local, params->local, sockaddr_len(params->local));
+	job->len = rx->iov_len;
+	memcpy(job->query, rx->iov_base, rx->iov_len);
+
+	pthread_mutex_lock(&conn->lock);
+	conn->jobs++;
+	pthread_mutex_unlock(&conn->lock);
+
+	/* Signal one worker, process the query here if the notification pipe is full. */
+	server_t *server = tcp->server;
+	pthread_mutex_lock(&server->tcp_jobs.lock);
+	if (write(server->tcp_jobs.notify[1], "", 1) != 1) {
+		pthread_mutex_unlock(&server->tcp_jobs.lock);
+		pthread_mutex_lock(&conn->lock);
+		conn->jobs--;
+		pthread_mutex_unlock(&conn->lock);
+		bufpool_free(job, sizeof(*job) + job->len);
+		return false;
+	}
+	add_tail(&server->tcp_jobs.queue, &job->n);
+	pthread_mutex_unlock(&server->tcp_jobs.lock);
+
+	return true;
+}
+
+static tcp_job_t *tcp_job_pop(server_t *server)
+{
+	tcp_job_t *job = NULL;
+
+	pthread_mutex_lock(&server->tcp_jobs.lock);
+	if (!EMPTY_LIST(server->tcp_jobs.queue)) {
+		job = HEAD(server->tcp_jobs.queue);
+		rem_node(&job->n);
+	}
+	pthread_mutex_unlock(&server->tcp_jobs.lock);
+
+	return job;
+}
+
+/*! \brief Process a query handed over from a (possibly) other worker. */
+static void tcp_job_run(tcp_context_t *tcp, tcp_job_t *job)
+{
+	tcp_conn_t *conn = job->conn;
+
+	knotd_qdata_params_t params = params_init(job->proto, &job->remote, &job->local,
+	                                          conn->fd, tcp->server, tcp->thread_id);
+	params.tls_conn = conn->tls_conn;
+	params.flags = job->flags;
+	params.suspend = tcp->suspend;
+
+	if (process_query_proto(&params, KNOTD_STAGE_PROTO_BEGIN) != KNOTD_PROTO_STATE_BLOCK) {
+		assert(tcp->obuf_len == 0);
+		tcp_conn_t *served = tcp->conn;
+		tcp->conn = conn;
+
+		struct iovec rx = { .iov_base = tcp->iov[0].iov_base, .iov_len = job->len };
+		struct iovec tx = { .iov_base = tcp->iov[1].iov_base, .iov_len = KNOT_WIRE_MAX_PKTSIZE };
+		memcpy(rx.iov_base, job->query, job->len);
+
+		int ret = tcp_process(tcp, &params, &rx, &tx);
+		if (ret == KNOT_EOK) {
+			ret = tcp_flush(tcp, &params);
+		}
+		if (ret != KNOT_EOK) {
+			tcp_log_error(params.remote, "send", ret);
+			tcp->obuf_len = 0;
+			/* Make the owning worker close the connection. */
+			(void)shutdown(conn->fd, SHUT_RDWR);
+		}
+
+		tcp->conn = served;
+		(void)process_query_proto(&params, KNOTD_STAGE_PROTO_END);
+	}
+
+	pthread_mutex_lock(&conn->lock);
+	conn->jobs--;
+	pthread_cond_broadcast(&conn->done);
+	pthread_mutex_unlock(&conn->lock);
+
+	bufpool_free(job, sizeof(*job) + job->len);
+}
+
+/*! \brief Wait for the handed over queries of the connection before closing it. */
+static void tcp_conn_close(tcp_context_t *tcp, int fd)
+{
+	if (fd >= tcp->fd_conn_size || tcp->fd_conn[fd] == NULL) {
+		return;
+	}
+
+	tcp_conn_t *conn = tcp->fd_conn[fd];
+	pthread_mutex_lock(&conn->lock);
+	while (conn->jobs > 0) {
+		pthread_mutex_unlock(&conn->lock);
+		/* Help with the queue, the awaited queries may be still there. */
+		tcp_job_t *job = tcp_job_pop(tcp->server);
+		if (job != NULL) {
+			tcp_job_run(tcp, job);
+			pthread_mutex_lock(&conn->lock);
+		} else {
+			pthread_mutex_lock(&conn->lock);
+			if (conn->jobs > 0) {
+				pthread_cond_wait(&conn->done, &conn->lock);
+			}
+		}
+	}
+	pthread_mutex_unlock(&conn->lock);
+
+	pthread_cond_destroy(&conn->done);
+	pthread_mutex_destroy(&conn->lock);
+	bufpool_free(conn, sizeof(*conn));
+	tcp->fd_conn[fd] = NULL;
+}
+
+/*! \brief Sweep TCP connection. */
+static fdset_sweep_state_t tcp_sweep(fdset_t *set, int idx, void *data)
+{
+	tcp_context_t *tcp = data;
+	const int fd = fdset_get_fd(set, idx);
+	assert(set && fd >= 0);
+
+	/* Best-effort, name and shame. */
+	struct sockaddr_storage ss = { 0 };
+	socklen_t len = sizeof(struct sockaddr_storage);
+	if (getpeername(fd, (struct sockaddr *)&ss, &len) == 0) {
+		char addr_str[SOCKADDR_STRLEN];
+		sockaddr_tostr(addr_str, sizeof(addr_str), &ss);
+		log_notice("TCP, terminated inactive client, address %s", addr_str);
+	}
+
+	tcp_conn_close(tcp, fd);
+	free_tls_ctx(set, idx);
+	tcp_client_release(tcp, fd);
+	ATOMIC_ADD(tcp->server->tcp_clients.evicted, 1);
+
+	return FDSET_SWEEP;
+}
+
+/*!
+ * \brief Receive and process one query.
+ *
+ * \param more  On input, if another query may follow within this wakeup.
+ *              On output, if another query is pending on the connection.
+ */
 static int tcp_handle(tcp_context_t *tcp, knotd_qdata_params_t *params,
-                      struct iovec *rx, struct iovec *tx)
+                      struct iovec *rx, struct iovec *tx, bool *more)
 {
 	rx->iov_len = KNOT_WIRE_MAX_PKTSIZE;
 	tx->iov_len = KNOT_WIRE_MAX_PKTSIZE;
@@ -170,6 +707,7 @@ static int tcp_handle(tcp_context_t *tcp, knotd_qdata_params_t *params,
 		int ret = knot_tls_handshake(params->tls_conn, true);
 		switch (ret) {
 		case KNOT_EAGAIN: // Unfinished handshake, continue later.
+			*more = false;
 			return KNOT_EOK;
 		case KNOT_EOK: // Finished handshake, continue with receiving message.
 			recv = knot_tls_recv_dns(params->tls_conn, rx->iov_base, rx->iov_len);
@@ -189,30 +727,28 @@ static int tcp_handle(tcp_context_t *tcp, knotd_qdata_params_t *params,
 		return KNOT_EOF;
 	}
 
-	handle_query(params, &tcp->layer, rx, NULL);
+	*more = *more && tcp_pending(params);
 
-	/* Resolve until NOOP or finished. */
-	knot_pkt_t *ans = knot_pkt_new(tx->iov_base, tx->iov_len, tcp->layer.mm);
-	while (active_state(tcp->layer.state)) {
-		knot_layer_produce(&tcp->layer, ans);
-		/* Send, if response generation passed and wasn't ignored. */
-		if (ans->size > 0 && send_state(tcp->layer.state)) {
-			int sent;
-			if (params->tls_conn != NULL) {
-				sent = knot_tls_send_dns(params->tls_conn, ans->wire, ans->size);
-			} else {
-				sent = net_dns_tcp_send(params->socket, ans->wire, ans->size,
-				                        tcp->io_timeout, NULL);
-			}
-			if (sent != ans->size) {
-				tcp_log_error(params->remote, "send", sent);
-				handle_finish(&tcp->layer);
-				return KNOT_EOF;
-			}
+	/* Don't let this query delay the following ones, if allowed. */
+	if (*more && tcp->out_of_order && tcp_job_push(tcp, params, rx)) {
+		return KNOT_EOK;
+	}
+
+	/* A deferred UPDATE response is sent separately, don't hold older ones. */
+	if (recv >= KNOT_WIRE_HEADER_SIZE &&
+	    knot_wire_get_opcode(rx->iov_base) == KNOT_OPCODE_UPDATE) {
+		int ret = tcp_flush(tcp, params);
+		if (ret != KNOT_EOK) {
+			tcp_log_error(params->remote, "send", ret);
+			return KNOT_EOF;
 		}
 	}
 
-	handle_finish(&tcp->layer);
+	int ret = tcp_process(tcp, params, rx, tx);
+	if (ret != KNOT_EOK) {
+		tcp_log_error(params->remote, "send", ret);
+		return KNOT_EOF;
+	}
 
 	if (params->tls_conn != NULL) {
 		// Store the qdata params AUTH flag to the connection.
@@ -230,11 +766,19 @@ static void tcp_event_accept(tcp_context_t *tcp, unsigned i, const iface_t *ifac
 {
 	/* Accept client. */
 	int fd = fdset_get_fd(&tcp->set, i);
-	int client = net_accept(fd, NULL);
+	struct sockaddr_storage ss = { 0 };
+	int client = net_accept(fd, &ss);
 	if (client >= 0) {
+		/* Reject excess connections from the same client prefix. */
+		if (!tcp_client_admit(tcp, client, &ss)) {
+			close(client);
+			return;
+		}
+
 		/* Assign to fdset. */
 		int idx = fdset_add(&tcp->set, client, FDSET_POLLIN, (void *)iface);
 		if (idx < 0) {
+			tcp_client_release(tcp, client);
 			close(client);
 			return;
 		}
@@ -272,6 +816,7 @@ static int tcp_event_serve(tcp_context_t *tcp, unsigned i, const iface_t *iface)
 	                                                     : KNOTD_QUERY_PROTO_TCP,
 	                                          remote, local, fd, tcp->server,
 	                                          tcp->thread_id);
+	params.suspend = tcp->suspend;
 
 	// NOTE there is no way to avoid calling accept() on unwanted connections:
 	// - it's not possible to read out the remote IP beforehand
@@ -296,7 +841,25 @@ static int tcp_event_serve(tcp_context_t *tcp, unsigned i, const iface_t *iface)
 		params_update_tls(&params, tls_conn);
 	}
 
-	int ret = tcp_handle(tcp, &params, &tcp->iov[0], &tcp->iov[1]);
+	/* Serve the already received queries, up to a limit for fairness. */
+	tcp->conn = (fd < tcp->fd_conn_size) ? tcp->fd_conn[fd] : NULL;
+	int ret;
+	bool more;
+	unsigned count = 0;
+	do {
+		knotd_qdata_params_t msg_params = params;
+		more = ++count < TCP_PIPELINE_MAX;
+		ret = tcp_handle(tcp, &msg_params, &tcp->iov[0], &tcp->iov[1], &more);
+	} while (ret == KNOT_EOK && more);
+
+	/* Send the batched responses, also if the client stopped sending. */
+	int flush = tcp_flush(tcp, &params);
+	if (flush != KNOT_EOK && ret == KNOT_EOK) {
+		tcp_log_error(params.remote, "send", flush);
+		ret = KNOT_EOF;
+	}
+	tcp->conn = NULL;
+
 	if (ret == KNOT_EOK) {
 		/* Update socket activity timer. */
 		(void)fdset_set_watchdog(&tcp->set, i, tcp->idle_timeout);
@@ -307,6 +870,18 @@ static int tcp_event_serve(tcp_context_t *tcp, unsigned i, const iface_t *iface)
 	return ret;
 }
 
+/*! \brief Process one of the queries handed over by the workers. */
+static void tcp_event_jobs(tcp_context_t *tcp)
+{
+	uint8_t token;
+	if (read(tcp->server->tcp_jobs.notify[0], &token, sizeof(token)) == sizeof(token)) {
+		tcp_job_t *job = tcp_job_pop(tcp->server);
+		if (job != NULL) {
+			tcp_job_run(tcp, job);
+		}
+	}
+}
+
 static void tcp_wait_for_events(tcp_context_t *tcp)
 {
 	fdset_t *set = &tcp->set;
@@ -320,7 +895,12 @@ static void tcp_wait_for_events(tcp_context_t *tcp)
 
 	/* Wait for events. */
 	fdset_it_t it;
-	(void)fdset_poll(set, &it, offset, TCP_SWEEP_INTERVAL * 1000);
+	uint64_t spin_time = 0;
+	(void)fdset_poll_spin(set, &it, offset, TCP_SWEEP_INTERVAL * 1000,
+	                      tcp->spin_us, &spin_time);
+	if (spin_time > 0) {
+		ATOMIC_ADD(*tcp->spin_stat, spin_time);
+	}
 
 	/* Mark the time of last poll call. */
 	tcp->last_poll_time = time_now();
@@ -333,9 +913,16 @@ static void tcp_wait_for_events(tcp_context_t *tcp)
 			should_close = (idx >= tcp->client_threshold);
 		} else if (fdset_it_is_pollin(&it)) {
 			const iface_t *iface = fdset_it_get_ctx(&it);
-			assert(iface);
+			/* Notification pipe - resumed queries to answer. */
+			if (iface == NULL && fdset_it_get_fd(&it) == suspend_queue_fd(tcp->suspend)) {
+				assert(idx < tcp->client_threshold);
+				suspend_queue_process(tcp->suspend);
+			/* Notification pipe - pipelined query to process. */
+			} else if (iface == NULL) {
+				assert(idx < tcp->client_threshold);
+				tcp_event_jobs(tcp);
 			/* Master sockets - new connection to accept. */
-			if (idx < tcp->client_threshold) {
+			} else if (idx < tcp->client_threshold) {
 				/* Don't accept more clients than configured. */
 				if (fdset_get_length(set) < tcp->max_worker_fds) {
 					tcp_event_accept(tcp, idx, iface);
@@ -349,11 +936,19 @@ static void tcp_wait_for_events(tcp_context_t *tcp)
 
 		/* Evaluate. */
 		if (should_close) {
+			tcp_conn_close(tcp, fdset_it_get_fd(&it));
 			free_tls_ctx(set, idx);
+			tcp_client_release(tcp, fdset_it_get_fd(&it));
 			fdset_it_remove(&it);
 		}
 	}
 	fdset_it_commit(&it);
+
+	/* The notification pipes aren't polled if throttled. */
+	if (tcp->is_throttled) {
+		tcp_event_jobs(tcp);
+		suspend_queue_process(tcp->suspend);
+	}
 }
 
 int tcp_master(dthread_t *thread)
@@ -372,6 +967,10 @@ int tcp_master(dthread_t *thread)
 		if (cpu > 1) {
 			unsigned cpu_mask = (dt_get_id(thread) % cpu);
 			dt_setaffinity(thread, &cpu_mask, 1);
+			/* Allocate buffers and memory pools on the local NUMA node. */
+			if (conf()->cache.srv_numa_affinity) {
+				(void)dt_set_mempolicy(DT_MEMPOLICY_LOCAL, cpu_mask);
+			}
 		}
 	}
 #endif
@@ -400,6 +999,12 @@ int tcp_master(dthread_t *thread)
 		}
 	}
 
+	tcp.obuf = malloc(TCP_OBUF_SIZE);
+	if (tcp.obuf == NULL) {
+		ret = KNOT_ENOMEM;
+		goto finish;
+	}
+
 	/* Prepare initial buffer for listening and bound sockets. */
 	if (fdset_init(&tcp.set, FDSET_RESIZE_STEP) != KNOT_EOK) {
 		ret = KNOT_ENOMEM;
@@ -415,6 +1020,31 @@ int tcp_master(dthread_t *thread)
 		goto finish; /* Terminate on zero interfaces. */
 	}
 
+	/* Watch for the pipelined queries handed over by the workers. */
+	if (fdset_add(&tcp.set, handler->server->tcp_jobs.notify[0], FDSET_POLLIN, NULL) < 0) {
+		ret = KNOT_ENOMEM;
+		goto finish;
+	}
+
+	/* Watch for the resumed queries. */
+	tcp.suspend = suspend_queue_new();
+	if (tcp.suspend == NULL ||
+	    fdset_add(&tcp.set, suspend_queue_fd(tcp.suspend), FDSET_POLLIN, NULL) < 0) {
+		ret = KNOT_ENOMEM;
+		goto finish;
+	}
+	tcp.client_threshold = fdset_get_length(&tcp.set);
+
+	/* Busy polling of the sockets. */
+	tcp.spin_us = conf()->cache.srv_busypoll_spin;
+	tcp.spin_stat = &handler->thread_spin[dt_get_id(thread)];
+	knot_atomic_uint64_t *mem_stat = &handler->thread_mem[dt_get_id(thread)];
+	knot_atomic_uint64_t *conns_stat = &handler->thread_conns[dt_get_id(thread)];
+	if (conf()->cache.srv_busypoll_budget > 0) {
+		(void)fdset_busypoll(&tcp.set, conf()->cache.srv_busypoll_timeout,
+		                     conf()->cache.srv_busypoll_budget);
+	}
+
 	/* Initialize sweep interval and TCP configuration. */
 	struct timespec next_sweep;
 	update_sweep_timer(&next_sweep);
@@ -429,6 +1059,7 @@ int tcp_master(dthread_t *thread)
 			ret = KNOT_ENOMEM;
 			goto finish;
 		}
+		tcp.tls_ctx->ktls = tcp.ktls;
 	}
 
 	for (;;) {
@@ -442,14 +1073,27 @@ int tcp_master(dthread_t *thread)
 
 		/* Sweep inactive clients and refresh TCP configuration. */
 		if (tcp.last_poll_time.tv_sec >= next_sweep.tv_sec) {
-			fdset_sweep(&tcp.set, &tcp_sweep, NULL);
+			fdset_sweep(&tcp.set, &tcp_sweep, &tcp);
 			update_sweep_timer(&next_sweep);
 			update_tcp_conf(&tcp);
+
+			ATOMIC_SET(*conns_stat, tcp.set.n - tcp.client_threshold);
+			handle_mem_usage(&tcp.layer, mem_stat);
 		}
 	}
 
 finish:
+	/* Finish the handed over queries first. */
+	for (int i = tcp.client_threshold; i < tcp.set.n; i++) {
+		tcp_conn_close(&tcp, fdset_get_fd(&tcp.set, i));
+	}
+	free(tcp.fd_conn);
+	suspend_queue_free(tcp.suspend);
+
 	knot_tls_ctx_free(tcp.tls_ctx);
+	tcp_zc_free(&tcp);
+	free(tcp.fd_bucket);
+	free(tcp.obuf);
 	free(tcp.iov[0].iov_base);
 	free(tcp.iov[1].iov_base);
 	mp_delete(mm.ctx);
@@ -27,6 +27,7 @@
 #include "knot/server/dthreads.h"
 
 #define TCP_BACKLOG_SIZE  10 /*!< TCP listen backlog size. */
+#define TCP_DEFER_ACCEPT_TIMEOUT 3 /*!< [secs] Max wait for the first data on accept. */
 
 /*!
  * \brief TCP handler thread runnable.
@@ -25,12 +25,17 @@
 #include <sys/types.h>
 #include <sys/socket.h>
 #include <netinet/in.h>
+#include <netinet/udp.h>
 #include <arpa/inet.h>
 #include <sys/param.h>
+#include <time.h>
 #ifdef HAVE_SYS_UIO_H	// struct iovec (OpenBSD)
 #include <sys/uio.h>
 #endif /* HAVE_SYS_UIO_H */
 #include <unistd.h>
+#ifdef ENABLE_IO_URING
+#include <liburing.h>
+#endif /* ENABLE_IO_URING */
 
 #include "contrib/mempattern.h"
 #include "contrib/net.h"
@@ -38,10 +43,13 @@
 #include "contrib/ucw/mempool.h"
 #include "knot/common/fdset.h"
 #include "knot/common/log.h"
+#include "knot/common/probes.h"
+#include "knot/nameserver/answer_cache.h"
 #include "knot/nameserver/process_query.h"
 #include "knot/query/layer.h"
 #include "knot/server/handler.h"
 #include "knot/server/server.h"
+#include "knot/server/suspend.h"
 #ifdef ENABLE_QUIC
 #include "knot/server/quic-handler.h"
 #endif // ENABLE_QUIC
@@ -62,6 +70,15 @@ typedef struct {
 	server_t *server;   /*!< Name server structure. */
 	unsigned thread_id; /*!< Thread identifier. */
 	sockaddr_t local;   /*!< Storage for local any address for currently processed query. */
+	bool offload;       /*!< UDP GRO/GSO offload enabled. */
+	bool adaptive_batch;              /*!< Adaptive recvmmsg batch size enabled. */
+	knot_atomic_uint64_t *batch_stat; /*!< Current receive batch size export. */
+	knot_atomic_uint64_t *conns_stat; /*!< Open QUIC connections export. */
+	knot_atomic_uint64_t *drops_stat; /*!< Datagrams dropped by the sockets export. */
+	int rcvbuf_max;                   /*!< Receive buffer growth limit, 0 if disabled. */
+	time_t rcvbuf_time;               /*!< Time of the last receive buffer growth. */
+	answer_cache_t *answer_cache;     /*!< Cache of static responses if enabled. */
+	suspend_queue_t *suspend;         /*!< Suspended queries (not with XDP). */
 
 #ifdef ENABLE_QUIC
 	knot_quic_table_t *quic_table;  /*!< QUIC connection table if active. */
@@ -73,19 +90,26 @@ typedef struct {
 static void udp_handler(udp_context_t *udp, knotd_qdata_params_t *params,
                         struct iovec *rx, struct iovec *tx)
 {
+	KNOTD_PROBE2(udp__recv, params->thread_id, rx->iov_len);
+
 	if (process_query_proto(params, KNOTD_STAGE_PROTO_BEGIN) == KNOTD_PROTO_STATE_BLOCK) {
+		tx->iov_len = 0;
 		return;
 	}
 
 	// Prepare a reply.
 	struct sockaddr_storage proxied_remote;
-	handle_udp_reply(params, &udp->layer, rx, tx, &proxied_remote);
+	params->suspend = udp->suspend;
+	handle_udp_reply(params, &udp->layer, rx, tx, &proxied_remote,
+	                 udp->answer_cache);
 
 	(void)process_query_proto(params, KNOTD_STAGE_PROTO_END);
+
+	KNOTD_PROBE2(udp__send, params->thread_id, tx->iov_len);
 }
 
 typedef struct {
-	void* (*udp_init)(udp_context_t *, void *);
+	void* (*udp_init)(udp_context_t *, fdset_t *, void *);
 	void (*udp_deinit)(void *);
 	int (*udp_recv)(int, void *);
 	void (*udp_handle)(udp_context_t *, const iface_t *, void *);
@@ -93,12 +117,49 @@ typedef struct {
 	void (*udp_sweep)(udp_context_t *, void *);
 } udp_api_t;
 
-/*! \brief Control message to fit IP_PKTINFO/IPv6_RECVPKTINFO and/or ECN. */
+/*! \brief Control message to fit IP_PKTINFO/IPv6_RECVPKTINFO, ECN, and/or UDP GRO/GSO,
+ *         and SO_RXQ_OVFL. */
 typedef union {
 	struct cmsghdr cmsg;
-	uint8_t buf[CMSG_SPACE(sizeof(struct in6_pktinfo)) + CMSG_SPACE(sizeof(int))];
+	uint8_t buf[CMSG_SPACE(sizeof(struct in6_pktinfo)) + CMSG_SPACE(sizeof(int)) +
+	            CMSG_SPACE(sizeof(int)) + CMSG_SPACE(sizeof(uint32_t))];
 } cmsg_buf_t;
 
+#ifdef UDP_SEGMENT
+#define GSO_MAX_SEGMENTS	64	/*!< Kernel limit for one GSO send. */
+#define GSO_MAX_SEGMENT_SIZE	1452	/*!< Fits in 1500 MTU with IPv6 and UDP headers. */
+#define GSO_MAX_LEN		(KNOT_WIRE_MAX_PKTSIZE - 48)
+
+/*! \brief Chain of equally sized datagrams to be sent with UDP_SEGMENT. */
+typedef struct {
+	size_t len;      /*!< Total length of chained datagrams. */
+	uint16_t size;   /*!< Segment size (length of the first datagram). */
+	uint16_t count;  /*!< Number of chained datagrams. */
+	bool closed;     /*!< A shorter datagram has terminated the chain. */
+} gso_chain_t;
+
+static bool gso_fits(const gso_chain_t *chain, size_t len)
+{
+	if (chain->count == 0) {
+		return len <= GSO_MAX_SEGMENT_SIZE;
+	}
+
+	return !chain->closed && len <= chain->size &&
+	       chain->count < GSO_MAX_SEGMENTS && chain->len + len <= GSO_MAX_LEN;
+}
+
+static void gso_add(gso_chain_t *chain, size_t len)
+{
+	if (chain->count == 0) {
+		chain->size = len;
+	} else if (len < chain->size) {
+		chain->closed = true;
+	}
+	chain->len += len;
+	chain->count++;
+}
+#endif /* UDP_SEGMENT */
+
 static const sockaddr_t *local_addr(sockaddr_t *local_storage, const iface_t *iface)
 {
 	return local_storage->un.sun_family == AF_UNSPEC
@@ -145,14 +206,87 @@ static void cmsg_handle_pktinfo(sockaddr_t *local, const iface_t *iface,
 	}
 }
 
-void cmsg_handle(const struct msghdr *rx, struct msghdr *tx,
-                 sockaddr_t *local, int **p_ecn, const iface_t *iface)
+/*! \brief Extracts the socket drop counter and removes it from the output control message. */
+static void cmsg_handle_drops(struct msghdr *tx, uint32_t *drops)
+{
+#ifdef SO_RXQ_OVFL
+	for (struct cmsghdr *cmsg = CMSG_FIRSTHDR(tx); cmsg != NULL;
+	     cmsg = CMSG_NXTHDR(tx, cmsg)) {
+		if (cmsg->cmsg_level != SOL_SOCKET || cmsg->cmsg_type != SO_RXQ_OVFL) {
+			continue;
+		}
+		memcpy(drops, CMSG_DATA(cmsg), sizeof(*drops));
+
+		// Not allowed in sendmsg(), shift the following messages over it.
+		uint8_t *pos = (uint8_t *)cmsg;
+		size_t offset = pos - (uint8_t *)tx->msg_control;
+		size_t space = MIN(CMSG_ALIGN(cmsg->cmsg_len), tx->msg_controllen - offset);
+		memmove(pos, pos + space, tx->msg_controllen - offset - space);
+		tx->msg_controllen -= space;
+		if (tx->msg_controllen == 0) {
+			tx->msg_control = NULL;
+		}
+		return;
+	}
+#endif
+}
+
+#ifdef UDP_SEGMENT
+/*! \brief Converts UDP_GRO to UDP_SEGMENT or appends UDP_SEGMENT (zero) if missing. */
+static void cmsg_handle_gso(uint16_t **p_gso, struct msghdr *tx, struct cmsghdr *gro,
+                            cmsg_buf_t *buf)
+{
+	if (gro != NULL) {
+		uint16_t size = *(int *)CMSG_DATA(gro);
+		gro->cmsg_type = UDP_SEGMENT;
+		gro->cmsg_len = CMSG_LEN(sizeof(uint16_t));
+		*p_gso = (uint16_t *)CMSG_DATA(gro);
+		**p_gso = size;
+		return;
+	}
+
+	size_t offset = CMSG_ALIGN(tx->msg_controllen);
+	if (buf == NULL || offset + CMSG_SPACE(sizeof(uint16_t)) > sizeof(*buf)) {
+		*p_gso = NULL;
+		return;
+	}
+
+	struct cmsghdr *cmsg = (struct cmsghdr *)(buf->buf + offset);
+	memset(cmsg, 0, CMSG_SPACE(sizeof(uint16_t)));
+	cmsg->cmsg_level = SOL_UDP;
+	cmsg->cmsg_type = UDP_SEGMENT;
+	cmsg->cmsg_len = CMSG_LEN(sizeof(uint16_t));
+	tx->msg_control = buf;
+	tx->msg_controllen = offset + CMSG_SPACE(sizeof(uint16_t));
+
+	*p_gso = (uint16_t *)CMSG_DATA(cmsg);
+	**p_gso = 0;
+}
+#endif /* UDP_SEGMENT */
+
+/*!
+ * \brief Prepares the output control message and extracts its parameters.
+ *
+ * \param rx     Received message header.
+ * \param tx     Output message header (control buffer shared with rx).
+ * \param local  Output storage for the local address.
+ * \param p_ecn  Output pointer to the ECN value (QUIC only).
+ * \param p_gso  Optional output pointer to the UDP_SEGMENT value. It's initialized
+ *               with the received GRO segment size (or zero) and may be
+ *               rewritten with the outgoing segment size.
+ * \param iface  Interface of the received message.
+ * \param drops  Output for the socket drop counter, untouched if not reported.
+ */
+static void cmsg_handle(const struct msghdr *rx, struct msghdr *tx,
+                        sockaddr_t *local, int **p_ecn, uint16_t **p_gso,
+                        const iface_t *iface, uint32_t *drops)
 {
 	local->un.sun_family = AF_UNSPEC;
 
 	tx->msg_controllen = rx->msg_controllen;
 	if (tx->msg_controllen > 0) {
 		tx->msg_control = rx->msg_control;
+		cmsg_handle_drops(tx, drops);
 	} else {
 		// BSD has problem with zero length and not-null pointer
 		tx->msg_control = NULL;
@@ -166,6 +300,24 @@ void cmsg_handle(const struct msghdr *rx, struct msghdr *tx,
 			cmsg_handle_pktinfo(local, iface, cmsg);
 			cmsg = CMSG_NXTHDR(tx, cmsg);
 		}
+	} else if (p_gso != NULL) {
+#ifdef UDP_SEGMENT
+		struct cmsghdr *gro = NULL;
+		while (cmsg != NULL) {
+			if (cmsg->cmsg_level == SOL_UDP && cmsg->cmsg_type == UDP_GRO) {
+				gro = cmsg;
+			} else {
+				cmsg_handle_pktinfo(local, iface, cmsg);
+			}
+			cmsg = CMSG_NXTHDR(tx, cmsg);
+		}
+		cmsg_handle_gso(p_gso, tx, gro, rx->msg_control);
+#else
+		*p_gso = NULL;
+		if (cmsg != NULL) {
+			cmsg_handle_pktinfo(local, iface, cmsg);
+		}
+#endif /* UDP_SEGMENT */
 	} else {
 		if (cmsg != NULL) {
 			cmsg_handle_pktinfo(local, iface, cmsg);
@@ -173,12 +325,71 @@ void cmsg_handle(const struct msghdr *rx, struct msghdr *tx,
 	}
 }
 
+/*! \brief Doubles the socket receive buffer up to the limit, at most once a second. */
+static void udp_rcvbuf_grow(udp_context_t *udp, int fd)
+{
+	time_t now = time(NULL);
+	if (udp->rcvbuf_max == 0 || now == udp->rcvbuf_time) {
+		return;
+	}
+	udp->rcvbuf_time = now;
+
+	int size = 0;
+	socklen_t len = sizeof(size);
+	if (getsockopt(fd, SOL_SOCKET, SO_RCVBUF, &size, &len) != 0) {
+		return;
+	}
+	size /= 2; // Linux reports the doubled size including the overhead.
+	if (size >= udp->rcvbuf_max) {
+		return;
+	}
+
+	size = MIN(2 * size, udp->rcvbuf_max);
+	if (setsockopt(fd, SOL_SOCKET, SO_RCVBUF, &size, sizeof(size)) == 0) {
+		log_info("UDP, receive buffer enlarged to %d bytes due to drops", size);
+	}
+}
+
+/*!
+ * \brief Accounts the drops reported for the socket, possibly grows its buffer.
+ *
+ * \param udp    UDP context.
+ * \param iface  Interface of the socket.
+ * \param fd     Socket.
+ * \param drops  Cumulative number of datagrams dropped by the socket.
+ */
+static void udp_drops_handle(udp_context_t *udp, const iface_t *iface, int fd,
+                             uint32_t drops)
+{
+	if (iface->drops_udp == NULL) {
+		return;
+	}
+#ifdef ENABLE_REUSEPORT
+	knot_atomic_uint64_t *last = &iface->drops_udp[udp->thread_id];
+#else
+	knot_atomic_uint64_t *last = &iface->drops_udp[0];
+#endif
+
+	// The counter wraps, an older value can come later from another worker.
+	uint32_t diff = drops - (uint32_t)ATOMIC_GET(*last);
+	if (diff == 0 || diff > INT32_MAX) {
+		return;
+	}
+	ATOMIC_SET(*last, drops);
+	ATOMIC_ADD(*udp->drops_stat, diff);
+
+	udp_rcvbuf_grow(udp, fd);
+}
+
 static void udp_sweep(udp_context_t *ctx, void *d)
 {
 #ifdef ENABLE_QUIC
 	int fd = *(int *)d; // NOTE both udp_msg_ctx_t and udp_mmsg_ctx_t have 'fd' as first item
 	quic_sweep_table(ctx->quic_table, &ctx->quic_closed, fd);
 	quic_reconfigure_table(ctx->quic_table);
+	if (ctx->quic_table != NULL) {
+		ATOMIC_SET(*ctx->conns_stat, ctx->quic_table->usage);
+	}
 #endif // ENABLE_QUIC
 }
 
@@ -191,7 +402,8 @@ typedef struct {
 	cmsg_buf_t cmsgs;
 } udp_msg_ctx_t;
 
-static void *udp_msg_init(_unused_ udp_context_t *ctx, _unused_ void *xdp_sock)
+static void *udp_msg_init(_unused_ udp_context_t *ctx, _unused_ fdset_t *fds,
+                          _unused_ void *xdp_sock)
 {
 	udp_msg_ctx_t *rq = calloc(1, sizeof(*rq));
 	if (rq == NULL) {
@@ -247,7 +459,11 @@ static void udp_msg_handle(udp_context_t *ctx, const iface_t *iface, void *d)
 	rq->iov[TX].iov_len = sizeof(rq->iobuf[TX]);
 
 	int *p_ecn;
-	cmsg_handle(&rq->msg[RX], &rq->msg[TX], &ctx->local, &p_ecn, iface);
+	uint32_t drops = 0;
+	cmsg_handle(&rq->msg[RX], &rq->msg[TX], &ctx->local, &p_ecn, NULL, iface, &drops);
+	if (drops > 0) {
+		udp_drops_handle(ctx, iface, rq->fd, drops);
+	}
 	const sockaddr_t *local = local_addr(&ctx->local, iface);
 
 	/* Process received pkt. */
@@ -256,8 +472,10 @@ static void udp_msg_handle(udp_context_t *ctx, const iface_t *iface, void *d)
 		&rq->addr, local, rq->fd, ctx->server, ctx->thread_id);
 	if (iface->tls) {
 #ifdef ENABLE_QUIC
+		params.suspend = ctx->suspend;
 		quic_handler(&params, &ctx->layer, ctx->quic_idle_close,
-		             ctx->quic_table, &rq->iov[RX], &rq->msg[TX], p_ecn);
+		             ctx->quic_table, &rq->iov[RX], &rq->msg[TX], p_ecn,
+		             ctx->offload);
 #else
 		assert(0);
 #endif // ENABLE_QUIC
@@ -289,25 +507,85 @@ static udp_api_t udp_msg_api = {
 };
 
 #ifdef ENABLE_RECVMMSG
+#define BATCH_FILL_INIT		128	/*!< Initial fill ratio (1/256 units). */
+#define BATCH_FILL_GROW		224	/*!< Fill ratio for doubling the batch. */
+#define BATCH_FILL_SHRINK	64	/*!< Fill ratio for halving the batch. */
+
 typedef struct {
 	int fd;
 	unsigned rcvd;
-	struct mmsghdr msgs[NBUFS][RECVMMSG_BATCHLEN];
-	struct iovec iov[NBUFS][RECVMMSG_BATCHLEN];
-	uint8_t iobuf[NBUFS][RECVMMSG_BATCHLEN][KNOT_WIRE_MAX_PKTSIZE];
-	sockaddr_t addrs[RECVMMSG_BATCHLEN];
-	cmsg_buf_t cmsgs[RECVMMSG_BATCHLEN];
+	bool offload;
+	unsigned capacity; /*!< Number of allocated messages per buffer. */
+	unsigned batch;    /*!< Current recvmmsg batch size. */
+	unsigned fill;     /*!< Moving average of the batch fill ratio, 0 if fixed. */
+	knot_atomic_uint64_t *batch_stat;
+	struct mmsghdr *msgs[NBUFS];
+	struct iovec *iov[NBUFS];
+	uint8_t (*iobuf[NBUFS])[KNOT_WIRE_MAX_PKTSIZE];
+	sockaddr_t *addrs;
+	cmsg_buf_t *cmsgs;
+	uint16_t **gso; /*!< UDP_SEGMENT values of TX messages. */
+	sockaddr_t *locals;           /*!< Local addresses for the batch hooks. */
+	knotd_qdata_params_t *params; /*!< Processing parameters for the batch hooks. */
+	knotd_batch_item_t *items;    /*!< Received queries for the batch hooks. */
 } udp_mmsg_ctx_t;
 
-static void *udp_mmsg_init(_unused_ udp_context_t *ctx, _unused_ void *xdp_sock)
+static void udp_mmsg_deinit(void *d)
+{
+	udp_mmsg_ctx_t *rq = d;
+	if (rq == NULL) {
+		return;
+	}
+
+	for (unsigned i = 0; i < NBUFS; ++i) {
+		free(rq->msgs[i]);
+		free(rq->iov[i]);
+		free(rq->iobuf[i]);
+	}
+	free(rq->addrs);
+	free(rq->cmsgs);
+	free(rq->gso);
+	free(rq->locals);
+	free(rq->params);
+	free(rq->items);
+	free(rq);
+}
+
+static void *udp_mmsg_init(udp_context_t *ctx, _unused_ fdset_t *fds,
+                           _unused_ void *xdp_sock)
 {
 	udp_mmsg_ctx_t *rq = calloc(1, sizeof(*rq));
 	if (rq == NULL) {
 		return NULL;
 	}
+	rq->offload = ctx->offload;
+	rq->capacity = ctx->adaptive_batch ? RECVMMSG_BATCHLEN_MAX : RECVMMSG_BATCHLEN;
+	rq->batch = RECVMMSG_BATCHLEN;
+	rq->fill = ctx->adaptive_batch ? BATCH_FILL_INIT : 0;
+	rq->batch_stat = ctx->batch_stat;
+
+	const unsigned cap = rq->capacity;
+	for (unsigned i = 0; i < NBUFS; ++i) {
+		rq->msgs[i] = calloc(cap, sizeof(*rq->msgs[i]));
+		rq->iov[i] = calloc(cap, sizeof(*rq->iov[i]));
+		rq->iobuf[i] = malloc(cap * sizeof(*rq->iobuf[i]));
+	}
+	rq->addrs = calloc(cap, sizeof(*rq->addrs));
+	rq->cmsgs = calloc(cap, sizeof(*rq->cmsgs));
+	rq->gso = calloc(cap, sizeof(*rq->gso));
+	rq->locals = calloc(cap, sizeof(*rq->locals));
+	rq->params = calloc(cap, sizeof(*rq->params));
+	rq->items = calloc(cap, sizeof(*rq->items));
+	if (rq->msgs[RX] == NULL || rq->msgs[TX] == NULL || rq->iov[RX] == NULL ||
+	    rq->iov[TX] == NULL || rq->iobuf[RX] == NULL || rq->iobuf[TX] == NULL ||
+	    rq->addrs == NULL || rq->cmsgs == NULL || rq->gso == NULL ||
+	    rq->locals == NULL || rq->params == NULL || rq->items == NULL) {
+		udp_mmsg_deinit(rq);
+		return NULL;
+	}
 
 	for (unsigned i = 0; i < NBUFS; ++i) {
-		for (unsigned k = 0; k < RECVMMSG_BATCHLEN; ++k) {
+		for (unsigned k = 0; k < cap; ++k) {
 			rq->iov[i][k].iov_base = rq->iobuf[i][k];
 			rq->iov[i][k].iov_len = sizeof(rq->iobuf[i][k]);
 			rq->msgs[i][k].msg_hdr.msg_iov = &rq->iov[i][k];
@@ -319,38 +597,278 @@ static void *udp_mmsg_init(_unused_ udp_context_t *ctx, _unused_ void *xdp_sock)
 		}
 	}
 
+	if (rq->batch_stat != NULL) {
+		ATOMIC_SET(*rq->batch_stat, rq->batch);
+	}
+
 	return rq;
 }
 
-static void udp_mmsg_deinit(void *d)
+/*!
+ * \brief Adjusts the batch size according to the recent batch fill ratios.
+ *
+ * Mostly full batches double the batch size, mostly empty ones halve it.
+ */
+static void udp_mmsg_adapt(udp_mmsg_ctx_t *rq, unsigned rcvd)
 {
-	udp_mmsg_ctx_t *rq = d;
+	unsigned fill = (rcvd << 8) / rq->batch;
+	rq->fill = (7 * rq->fill + fill) >> 3;
 
-	free(rq);
+	if (rq->fill > BATCH_FILL_GROW && rq->batch < rq->capacity) {
+		rq->batch = MIN(2 * rq->batch, rq->capacity);
+	} else if (rq->fill < BATCH_FILL_SHRINK && rq->batch > RECVMMSG_BATCHLEN_MIN) {
+		rq->batch = MAX(rq->batch / 2, RECVMMSG_BATCHLEN_MIN);
+	} else {
+		return;
+	}
+	rq->fill = BATCH_FILL_INIT;
+
+	if (rq->batch_stat != NULL) {
+		ATOMIC_SET(*rq->batch_stat, rq->batch);
+	}
 }
 
 static int udp_mmsg_recv(int fd, void *d)
 {
 	udp_mmsg_ctx_t *rq = d;
 
-	int n = recvmmsg(fd, rq->msgs[RX], RECVMMSG_BATCHLEN, MSG_DONTWAIT, NULL);
+	int n = recvmmsg(fd, rq->msgs[RX], rq->batch, MSG_DONTWAIT, NULL);
 	if (n > 0) {
 		rq->fd = fd;
 		rq->rcvd = n;
+		if (rq->fill > 0) {
+			udp_mmsg_adapt(rq, n);
+		}
 	}
 	return n;
 }
 
+#ifdef UDP_SEGMENT
+static void gso_send(int fd, struct msghdr *tx, uint8_t *buf, size_t len,
+                     uint16_t *p_gso, uint16_t size)
+{
+	struct iovec *orig_iov = tx->msg_iov;
+	struct iovec iov = { .iov_base = buf, .iov_len = len };
+
+	*p_gso = size;
+	tx->msg_iov = &iov;
+	int ret = sendmsg(fd, tx, 0);
+	if (ret == -1 && log_enabled_debug()) {
+		log_debug("UDP, failed to send a packet (%s)", strerror(errno));
+	}
+	tx->msg_iov = orig_iov;
+}
+
+/*! \brief Sends chain of datagrams one by one (fallback if GSO fails). */
+static void gso_send_split(int fd, struct msghdr *tx, uint16_t *p_gso)
+{
+	const uint16_t size = *p_gso;
+	uint8_t *buf = tx->msg_iov->iov_base;
+	size_t left = tx->msg_iov->iov_len;
+
+	while (left > 0) {
+		size_t len = MIN(left, size);
+		gso_send(fd, tx, buf, len, p_gso, 0);
+		buf += len;
+		left -= len;
+	}
+}
+
+/*!
+ * \brief Processes GRO-coalesced datagrams and chains the responses for GSO.
+ *
+ * A response breaking the chain forces sending of the datagrams chained so far.
+ */
+static void udp_gro_handler(udp_context_t *ctx, knotd_qdata_params_t *params,
+                            struct iovec *rx, struct msghdr *tx, uint16_t *p_gso)
+{
+	const size_t seg_size = *p_gso;
+	uint8_t *in = rx->iov_base;
+	size_t in_left = rx->iov_len;
+	uint8_t *out = tx->msg_iov->iov_base;
+	const size_t out_max = MIN(tx->msg_iov->iov_len, GSO_MAX_LEN);
+
+	gso_chain_t chain = { 0 };
+	while (in_left > 0) {
+		struct iovec in_seg = { .iov_base = in, .iov_len = MIN(in_left, seg_size) };
+		in += in_seg.iov_len;
+		in_left -= in_seg.iov_len;
+
+		if (chain.len + KNOT_EDNS_MAX_UDP_PAYLOAD > out_max) {
+			gso_send(params->socket, tx, out, chain.len, p_gso, chain.size);
+			memset(&chain, 0, sizeof(chain));
+		}
+
+		struct iovec out_seg = {
+			.iov_base = out + chain.len,
+			.iov_len = out_max - chain.len
+		};
+		udp_handler(ctx, params, &in_seg, &out_seg);
+		if (out_seg.iov_len == 0) {
+			continue;
+		}
+
+		if (!gso_fits(&chain, out_seg.iov_len)) {
+			if (chain.count > 0) {
+				gso_send(params->socket, tx, out, chain.len, p_gso,
+				         chain.count > 1 ? chain.size : 0);
+				memmove(out, out + chain.len, out_seg.iov_len);
+				memset(&chain, 0, sizeof(chain));
+			}
+			if (!gso_fits(&chain, out_seg.iov_len)) {
+				chain.closed = true; // Too large for a segment, send alone.
+			}
+		}
+		gso_add(&chain, out_seg.iov_len);
+	}
+
+	tx->msg_iov->iov_len = chain.len;
+	*p_gso = (chain.count > 1) ? chain.size : 0;
+}
+
+static bool udp_same_dest(const struct msghdr *a, const struct msghdr *b)
+{
+	if (a->msg_namelen != b->msg_namelen ||
+	    memcmp(a->msg_name, b->msg_name, a->msg_namelen) != 0 ||
+	    a->msg_controllen != b->msg_controllen) {
+		return false;
+	}
+
+	/* Compare local addresses, skip the segment sizes. */
+	struct cmsghdr *ca = CMSG_FIRSTHDR(a), *cb = CMSG_FIRSTHDR(b);
+	while (ca != NULL && cb != NULL) {
+		if (ca->cmsg_len != cb->cmsg_len || ca->cmsg_level != cb->cmsg_level ||
+		    ca->cmsg_type != cb->cmsg_type) {
+			return false;
+		}
+		if (ca->cmsg_level != SOL_UDP &&
+		    memcmp(CMSG_DATA(ca), CMSG_DATA(cb), ca->cmsg_len - CMSG_LEN(0)) != 0) {
+			return false;
+		}
+		ca = CMSG_NXTHDR((struct msghdr *)a, ca);
+		cb = CMSG_NXTHDR((struct msghdr *)b, cb);
+	}
+
+	return ca == NULL && cb == NULL;
+}
+
+/*!
+ * \brief Merges consecutive responses to the same destination into GSO chains.
+ *
+ * \return Number of messages to be sent.
+ */
+static unsigned udp_mmsg_gso_merge(udp_mmsg_ctx_t *rq)
+{
+	unsigned n = 0;
+	gso_chain_t chain = { 0 };
+
+	for (unsigned i = 0; i < rq->rcvd; ++i) {
+		struct msghdr *tx = &rq->msgs[TX][i].msg_hdr;
+		size_t len = rq->msgs[TX][i].msg_len;
+
+		if (n > 0 && rq->gso[n - 1] != NULL && rq->gso[i] != NULL &&
+		    *rq->gso[i] == 0 && gso_fits(&chain, len)) {
+			struct mmsghdr *lead = &rq->msgs[TX][n - 1];
+			if (udp_same_dest(&lead->msg_hdr, tx)) {
+				memcpy((uint8_t *)lead->msg_hdr.msg_iov->iov_base + lead->msg_len,
+				       tx->msg_iov->iov_base, len);
+				gso_add(&chain, len);
+				lead->msg_len = chain.len;
+				lead->msg_hdr.msg_iov->iov_len = chain.len;
+				*rq->gso[n - 1] = chain.size;
+				continue;
+			}
+		}
+
+		/* Start a new chain, keep the merged messages behind. */
+		if (i != n) {
+			struct mmsghdr tmp = rq->msgs[TX][n];
+			rq->msgs[TX][n] = rq->msgs[TX][i];
+			rq->msgs[TX][i] = tmp;
+			uint16_t *tmp_gso = rq->gso[n];
+			rq->gso[n] = rq->gso[i];
+			rq->gso[i] = tmp_gso;
+		}
+		memset(&chain, 0, sizeof(chain));
+		if ((rq->gso[n] != NULL && *rq->gso[n] != 0) || !gso_fits(&chain, len)) {
+			chain.closed = true; // Already a GRO response chain or too large.
+		}
+		gso_add(&chain, len);
+		n++;
+	}
+
+	return n;
+}
+#endif /* UDP_SEGMENT */
+
+static void udp_mmsg_reset_rx(udp_mmsg_ctx_t *rq, unsigned i)
+{
+	struct msghdr *rx = &rq->msgs[RX][i].msg_hdr;
+
+	rx->msg_iov->iov_len = sizeof(rq->iobuf[RX][i]);
+	rx->msg_namelen = sizeof(rq->addrs[i]);
+	rx->msg_controllen = sizeof(rq->cmsgs[i]);
+}
+
+/*!
+ * \brief Passes all the received messages to the module batch hooks.
+ *
+ * Only the first datagram of a GRO-coalesced message is exposed, the resulting
+ * state applies to all of them as they come from the same source.
+ */
+static void udp_mmsg_batch(udp_context_t *ctx, const iface_t *iface, udp_mmsg_ctx_t *rq)
+{
+	for (unsigned i = 0; i < rq->rcvd; ++i) {
+		struct msghdr *rx = &rq->msgs[RX][i].msg_hdr;
+		size_t len = rq->msgs[RX][i].msg_len;
+
+		rq->locals[i].un.sun_family = AF_UNSPEC;
+		for (struct cmsghdr *cmsg = CMSG_FIRSTHDR(rx); cmsg != NULL;
+		     cmsg = CMSG_NXTHDR(rx, cmsg)) {
+#ifdef UDP_SEGMENT
+			if (cmsg->cmsg_level == SOL_UDP && cmsg->cmsg_type == UDP_GRO) {
+				len = MIN(len, *(int *)CMSG_DATA(cmsg));
+				continue;
+			}
+#endif /* UDP_SEGMENT */
+			cmsg_handle_pktinfo(&rq->locals[i], iface, cmsg);
+		}
+
+		rq->params[i] = params_init(KNOTD_QUERY_PROTO_UDP, &rq->addrs[i],
+		                            local_addr(&rq->locals[i], iface),
+		                            rq->fd, ctx->server, ctx->thread_id);
+		rq->items[i] = (knotd_batch_item_t) {
+			.params = &rq->params[i],
+			.wire = rx->msg_iov->iov_base,
+			.wire_len = len,
+			.state = KNOTD_PROTO_STATE_PASS,
+		};
+	}
+
+	process_query_batch(rq->items, rq->rcvd);
+}
+
 static void udp_mmsg_handle(udp_context_t *ctx, const iface_t *iface, void *d)
 {
 	udp_mmsg_ctx_t *rq = d;
 
+	bool batch = !iface->tls && process_query_batch_enabled();
+	if (batch) {
+		udp_mmsg_batch(ctx, iface, rq);
+	}
+
 	/* Handle each received message. */
 	unsigned j = 0;
 	for (unsigned i = 0; i < rq->rcvd; ++i) {
 		struct msghdr *rx = &rq->msgs[RX][i].msg_hdr;
 		struct msghdr *tx = &rq->msgs[TX][j].msg_hdr;
 
+		/* Drop messages blocked by a batch hook. */
+		if (batch && rq->items[i].state == KNOTD_PROTO_STATE_BLOCK) {
+			udp_mmsg_reset_rx(rq, i);
+			continue;
+		}
+
 		/* Set received bytes. */
 		rx->msg_iov->iov_len = rq->msgs[RX][i].msg_len;
 		/* Update mapping of address buffer. */
@@ -359,7 +877,13 @@ static void udp_mmsg_handle(udp_context_t *ctx, const iface_t *iface, void *d)
 
 		/* Update output message control buffer. */
 		int *p_ecn;
-		cmsg_handle(rx, tx, &ctx->local, &p_ecn, iface);
+		uint16_t *p_gso = NULL;
+		uint32_t drops = 0;
+		cmsg_handle(rx, tx, &ctx->local, &p_ecn,
+		            (rq->offload && !iface->tls) ? &p_gso : NULL, iface, &drops);
+		if (drops > 0) {
+			udp_drops_handle(ctx, iface, rq->fd, drops);
+		}
 		const sockaddr_t *local = local_addr(&ctx->local, iface);
 
 		knotd_qdata_params_t params = params_init(
@@ -367,17 +891,24 @@ static void udp_mmsg_handle(udp_context_t *ctx, const iface_t *iface, void *d)
 			&rq->addrs[i], local, rq->fd, ctx->server, ctx->thread_id);
 		if (iface->tls) {
 #ifdef ENABLE_QUIC
+			params.suspend = ctx->suspend;
 			quic_handler(&params, &ctx->layer, ctx->quic_idle_close,
-			             ctx->quic_table, rx->msg_iov, tx, p_ecn);
+			             ctx->quic_table, rx->msg_iov, tx, p_ecn,
+			             rq->offload);
 #else
 		assert(0);
 #endif // ENABLE_QUIC
+#ifdef UDP_SEGMENT
+		} else if (p_gso != NULL && *p_gso > 0) {
+			udp_gro_handler(ctx, &params, rx->msg_iov, tx, p_gso);
+#endif /* UDP_SEGMENT */
 		} else {
 			udp_handler(ctx, &params, rx->msg_iov, tx->msg_iov);
 		}
 
 		if (tx->msg_iov->iov_len > 0) {
 			rq->msgs[TX][j].msg_len = tx->msg_iov->iov_len;
+			rq->gso[j] = p_gso;
 			j++;
 		} else {
 			/* Reset tainted output context. */
@@ -385,9 +916,7 @@ static void udp_mmsg_handle(udp_context_t *ctx, const iface_t *iface, void *d)
 		}
 
 		/* Reset input context. */
-		rx->msg_iov->iov_len = sizeof(rq->iobuf[RX][i]);
-		rx->msg_namelen = sizeof(rq->addrs[i]);
-		rx->msg_controllen = sizeof(rq->cmsgs[i]);
+		udp_mmsg_reset_rx(rq, i);
 	}
 	rq->rcvd = j;
 }
@@ -396,10 +925,32 @@ static void udp_mmsg_send(void *d)
 {
 	udp_mmsg_ctx_t *rq = d;
 
+#ifdef UDP_SEGMENT
+	unsigned count = rq->offload ? udp_mmsg_gso_merge(rq) : rq->rcvd;
+	unsigned sent = 0;
+	while (sent < count) {
+		int ret = sendmmsg(rq->fd, &rq->msgs[TX][sent], count - sent, 0);
+		if (ret > 0) {
+			sent += ret;
+			continue;
+		}
+		if (log_enabled_debug()) {
+			log_debug("UDP, failed to send some packets (%s)", strerror(errno));
+		}
+		/* Possibly too large segments for the path, retry without GSO. */
+		uint16_t *p_gso = rq->gso[sent];
+		if (p_gso == NULL || *p_gso == 0) {
+			break;
+		}
+		gso_send_split(rq->fd, &rq->msgs[TX][sent].msg_hdr, p_gso);
+		sent++;
+	}
+#else
 	int ret = sendmmsg(rq->fd, rq->msgs[TX], rq->rcvd, 0);
 	if (ret == -1 && log_enabled_debug()) {
 		log_debug("UDP, failed to send some packets (%s)", strerror(errno));
 	}
+#endif /* UDP_SEGMENT */
 	for (unsigned i = 0; i < rq->rcvd; ++i) {
 		struct msghdr *tx = &rq->msgs[TX][i].msg_hdr;
 
@@ -418,8 +969,344 @@ static udp_api_t udp_mmsg_api = {
 };
 #endif /* ENABLE_RECVMMSG */
 
+#ifdef ENABLE_IO_URING
+#define URING_BATCHLEN	16	/*!< Maximum number of in-flight responses. */
+#define URING_NBUFS	32	/*!< Number of provided receive buffers (power of two). */
+#define URING_ENTRIES	128	/*!< Submission queue size. */
+#define URING_BGID	0	/*!< Provided buffer group identifier. */
+#define URING_BUFSIZE	(sizeof(struct io_uring_recvmsg_out) + sizeof(sockaddr_t) + \
+			 sizeof(cmsg_buf_t) + KNOT_WIRE_MAX_PKTSIZE)
+
+/* Operation tags stored in the upper half of the SQE/CQE user data. */
+enum {
+	URING_OP_RECV = 1,
+	URING_OP_SEND = 2,
+};
+
+#define URING_DATA(op, idx)	(((uint64_t)(op) << 32) | (uint32_t)(idx))
+#define URING_DATA_OP(data)	((uint32_t)((data) >> 32))
+#define URING_DATA_IDX(data)	((uint32_t)(data))
+
+typedef struct {
+	struct msghdr msg;
+	struct iovec iov;
+	sockaddr_t addr;
+	cmsg_buf_t cmsgs;
+	uint8_t buf[KNOT_WIRE_MAX_PKTSIZE];
+	bool busy;
+} uring_tx_t;
+
+typedef struct {
+	int fd;
+	const iface_t *iface;
+	bool armed;
+} uring_sock_t;
+
+typedef struct {
+	int fd;              /*!< Unused, kept for udp_sweep() compatibility. */
+	unsigned rcvd;       /*!< Number of receive completions to be handled. */
+	unsigned seen;       /*!< Number of completions to be released. */
+	unsigned recycled;   /*!< Number of buffers to be returned to the kernel. */
+	unsigned nsocks;
+	uring_sock_t *socks;
+	struct io_uring ring;
+	struct io_uring_buf_ring *br;
+	struct msghdr rx_hdr; /*!< Multishot receive template (name and control lengths). */
+	struct io_uring_cqe *cqes[URING_BATCHLEN];
+	uring_tx_t tx[URING_BATCHLEN];
+	uint8_t bufs[URING_NBUFS][URING_BUFSIZE];
+} udp_uring_ctx_t;
+
+static bool uring_arm(udp_uring_ctx_t *rq, unsigned idx)
+{
+	struct io_uring_sqe *sqe = io_uring_get_sqe(&rq->ring);
+	if (sqe == NULL) {
+		return false;
+	}
+
+	io_uring_prep_recvmsg_multishot(sqe, rq->socks[idx].fd, &rq->rx_hdr, 0);
+	sqe->flags |= IOSQE_BUFFER_SELECT;
+	sqe->buf_group = URING_BGID;
+	io_uring_sqe_set_data64(sqe, URING_DATA(URING_OP_RECV, idx));
+	rq->socks[idx].armed = true;
+
+	return true;
+}
+
+static void uring_recycle(udp_uring_ctx_t *rq, unsigned bid)
+{
+	io_uring_buf_ring_add(rq->br, rq->bufs[bid], URING_BUFSIZE, bid,
+	                      io_uring_buf_ring_mask(URING_NBUFS), rq->recycled++);
+}
+
+static void udp_uring_deinit(void *d)
+{
+	udp_uring_ctx_t *rq = d;
+	if (rq == NULL) {
+		return;
+	}
+
+	if (rq->br != NULL) {
+		(void)io_uring_free_buf_ring(&rq->ring, rq->br, URING_NBUFS, URING_BGID);
+	}
+	if (rq->ring.ring_fd > 0) {
+		io_uring_queue_exit(&rq->ring);
+	}
+	free(rq->socks);
+	free(rq);
+}
+
+static void *udp_uring_init(_unused_ udp_context_t *ctx, fdset_t *fds,
+                            _unused_ void *xdp_sock)
+{
+	udp_uring_ctx_t *rq = calloc(1, sizeof(*rq));
+	if (rq == NULL) {
+		return NULL;
+	}
+	rq->fd = -1;
+
+	if (io_uring_queue_init(URING_ENTRIES, &rq->ring, 0) != 0) {
+		free(rq);
+		return NULL;
+	}
+
+	int ret;
+	rq->br = io_uring_setup_buf_ring(&rq->ring, URING_NBUFS, URING_BGID, 0, &ret);
+	if (rq->br == NULL) {
+		udp_uring_deinit(rq);
+		return NULL;
+	}
+	for (unsigned i = 0; i < URING_NBUFS; i++) {
+		uring_recycle(rq, i);
+	}
+	io_uring_buf_ring_advance(rq->br, rq->recycled);
+	rq->recycled = 0;
+
+	rq->rx_hdr.msg_namelen = sizeof(sockaddr_t);
+	rq->rx_hdr.msg_controllen = sizeof(cmsg_buf_t);
+
+	for (unsigned i = 0; i < URING_BATCHLEN; i++) {
+		uring_tx_t *tx = &rq->tx[i];
+		tx->iov.iov_base = tx->buf;
+		tx->msg.msg_iov = &tx->iov;
+		tx->msg.msg_iovlen = 1;
+		tx->msg.msg_name = &tx->addr;
+	}
+
+	/* Post multishot receives on all the thread sockets. */
+	rq->nsocks = fdset_get_length(fds);
+	rq->socks = calloc(rq->nsocks, sizeof(*rq->socks));
+	if (rq->socks == NULL) {
+		udp_uring_deinit(rq);
+		return NULL;
+	}
+	for (unsigned i = 0; i < rq->nsocks; i++) {
+		rq->socks[i].fd = fdset_get_fd(fds, i);
+		rq->socks[i].iface = fds->ctx[i];
+		/* GRO-coalesced datagrams aren't split by this API. */
+		(void)net_udp_gro_enable(rq->socks[i].fd, false);
+		if (!uring_arm(rq, i)) {
+			udp_uring_deinit(rq);
+			return NULL;
+		}
+	}
+	if (io_uring_submit(&rq->ring) < 0) {
+		udp_uring_deinit(rq);
+		return NULL;
+	}
+
+	/* The sockets are served by the ring, poll just for its completions.
+	 * The interface is resolved per received message. The caller's set is
+	 * replaced only on success, so that the classic API can use it otherwise. */
+	const iface_t *iface = rq->socks[0].iface;
+	fdset_t ring_fds;
+	if (fdset_init(&ring_fds, 1) != KNOT_EOK) {
+		udp_uring_deinit(rq);
+		return NULL;
+	}
+	if (fdset_add(&ring_fds, rq->ring.ring_fd, FDSET_POLLIN, (void *)iface) < 0) {
+		fdset_clear(&ring_fds);
+		udp_uring_deinit(rq);
+		return NULL;
+	}
+	fdset_clear(fds);
+	*fds = ring_fds;
+
+	return rq;
+}
+
+static void udp_uring_send(void *d)
+{
+	udp_uring_ctx_t *rq = d;
+
+	io_uring_cq_advance(&rq->ring, rq->seen);
+	rq->seen = 0;
+	rq->rcvd = 0;
+
+	if (rq->recycled > 0) {
+		io_uring_buf_ring_advance(rq->br, rq->recycled);
+		rq->recycled = 0;
+	}
+
+	for (unsigned i = 0; i < rq->nsocks; i++) {
+		if (!rq->socks[i].armed && !uring_arm(rq, i)) {
+			break;
+		}
+	}
+
+	int ret = io_uring_submit(&rq->ring);
+	if (ret < 0 && log_enabled_debug()) {
+		log_debug("UDP, failed to submit io_uring requests (%s)", strerror(-ret));
+	}
+}
+
+static int udp_uring_recv(_unused_ int fd, void *d)
+{
+	udp_uring_ctx_t *rq = d;
+
+	unsigned free_tx = 0;
+	for (unsigned i = 0; i < URING_BATCHLEN; i++) {
+		free_tx += !rq->tx[i].busy;
+	}
+
+	struct io_uring_cqe *cqes[URING_BATCHLEN];
+	unsigned n = io_uring_peek_batch_cqe(&rq->ring, cqes, URING_BATCHLEN);
+	for (unsigned i = 0; i < n; i++) {
+		struct io_uring_cqe *cqe = cqes[i];
+		uint64_t data = io_uring_cqe_get_data64(cqe);
+		unsigned idx = URING_DATA_IDX(data);
+
+		if (URING_DATA_OP(data) == URING_OP_SEND) {
+			if (cqe->res < 0 && log_enabled_debug()) {
+				log_debug("UDP, failed to send a packet (%s)", strerror(-cqe->res));
+			}
+			rq->tx[idx].busy = false;
+			free_tx++;
+			rq->seen++;
+			continue;
+		}
+
+		assert(URING_DATA_OP(data) == URING_OP_RECV);
+		if (!(cqe->flags & IORING_CQE_F_MORE)) {
+			rq->socks[idx].armed = false; // Re-armed before the next submit.
+		}
+		if (!(cqe->flags & IORING_CQE_F_BUFFER)) {
+			rq->seen++; // E.g. ENOBUFS, no buffer consumed.
+			continue;
+		}
+		if (free_tx == 0) {
+			break; // Leave it in the queue until some response is sent.
+		}
+		free_tx--;
+		rq->cqes[rq->rcvd++] = cqe;
+		rq->seen++;
+	}
+
+	if (rq->rcvd == 0) {
+		udp_uring_send(rq); // Release completions, re-arm receives.
+	}
+
+	return rq->rcvd;
+}
+
+static uring_tx_t *uring_tx_get(udp_uring_ctx_t *rq, unsigned *idx)
+{
+	for (unsigned i = 0; i < URING_BATCHLEN; i++) {
+		if (!rq->tx[i].busy) {
+			*idx = i;
+			return &rq->tx[i];
+		}
+	}
+
+	return NULL;
+}
+
+static void udp_uring_handle(udp_context_t *ctx, _unused_ const iface_t *iface, void *d)
+{
+	udp_uring_ctx_t *rq = d;
+
+	for (unsigned i = 0; i < rq->rcvd; ++i) {
+		struct io_uring_cqe *cqe = rq->cqes[i];
+		uring_sock_t *sock = &rq->socks[URING_DATA_IDX(io_uring_cqe_get_data64(cqe))];
+		unsigned bid = cqe->flags >> IORING_CQE_BUFFER_SHIFT;
+		uint8_t *buf = rq->bufs[bid];
+
+		struct io_uring_recvmsg_out *out =
+			io_uring_recvmsg_validate(buf, cqe->res, &rq->rx_hdr);
+		if (out == NULL || (out->flags & MSG_TRUNC) ||
+		    out->namelen > sizeof(sockaddr_t)) {
+			uring_recycle(rq, bid);
+			continue;
+		}
+
+		unsigned tx_idx;
+		uring_tx_t *tx = uring_tx_get(rq, &tx_idx);
+		assert(tx != NULL); // Ensured by udp_uring_recv().
+
+		/* Copy the address and control data, the buffer is recycled below. */
+		memcpy(&tx->addr, io_uring_recvmsg_name(out), out->namelen);
+		struct msghdr rx = {
+			.msg_name = &tx->addr,
+			.msg_namelen = out->namelen,
+		};
+		struct cmsghdr *cmsg = io_uring_recvmsg_cmsg_firsthdr(out, &rq->rx_hdr);
+		if (cmsg != NULL) {
+			memcpy(&tx->cmsgs, cmsg, out->controllen);
+			rx.msg_control = &tx->cmsgs.cmsg;
+			rx.msg_controllen = out->controllen;
+		}
+		struct iovec rx_iov = {
+			.iov_base = io_uring_recvmsg_payload(out, &rq->rx_hdr),
+			.iov_len = io_uring_recvmsg_payload_length(out, cqe->res, &rq->rx_hdr)
+		};
+
+		tx->msg.msg_namelen = out->namelen;
+		tx->iov.iov_len = sizeof(tx->buf);
+
+		int *p_ecn;
+		uint32_t drops = 0;
+		cmsg_handle(&rx, &tx->msg, &ctx->local, &p_ecn, NULL, sock->iface, &drops);
+		if (drops > 0) {
+			udp_drops_handle(ctx, sock->iface, sock->fd, drops);
+		}
+		const sockaddr_t *local = local_addr(&ctx->local, sock->iface);
+
+		knotd_qdata_params_t params = params_init(KNOTD_QUERY_PROTO_UDP,
+			&tx->addr, local, sock->fd, ctx->server, ctx->thread_id);
+		udp_handler(ctx, &params, &rx_iov, &tx->iov);
+
+		uring_recycle(rq, bid);
+
+		if (tx->iov.iov_len == 0) {
+			continue;
+		}
+
+		struct io_uring_sqe *sqe = io_uring_get_sqe(&rq->ring);
+		if (sqe == NULL) {
+			(void)io_uring_submit(&rq->ring);
+			sqe = io_uring_get_sqe(&rq->ring);
+			if (sqe == NULL) {
+				continue;
+			}
+		}
+		io_uring_prep_sendmsg(sqe, sock->fd, &tx->msg, 0);
+		io_uring_sqe_set_data64(sqe, URING_DATA(URING_OP_SEND, tx_idx));
+		tx->busy = true;
+	}
+}
+
+static udp_api_t udp_uring_api = {
+	udp_uring_init,
+	udp_uring_deinit,
+	udp_uring_recv,
+	udp_uring_handle,
+	udp_uring_send,
+	udp_sweep,
+};
+#endif /* ENABLE_IO_URING */
+
 #ifdef ENABLE_XDP
-static void *xdp_mmsg_init(udp_context_t *ctx, void *xdp_sock)
+static void *xdp_mmsg_init(udp_context_t *ctx, _unused_ fdset_t *fds, void *xdp_sock)
 {
 	return xdp_handle_init(ctx->server, xdp_sock);
 }
@@ -439,7 +1326,8 @@ static int xdp_mmsg_recv(_unused_ int fd, void *d)
 static void xdp_mmsg_handle(udp_context_t *ctx, _unused_ const iface_t *iface, void *d)
 {
 	assert(!iface->tls);
-	xdp_handle_msgs(d, &ctx->layer, ctx->server, ctx->thread_id);
+	xdp_handle_msgs(d, &ctx->layer, ctx->server, ctx->thread_id,
+	                ctx->answer_cache);
 }
 
 static void xdp_mmsg_send(void *d)
@@ -447,10 +1335,11 @@ static void xdp_mmsg_send(void *d)
 	xdp_handle_send(d);
 }
 
-static void xdp_mmsg_sweep(_unused_ udp_context_t *ctx, void *d)
+static void xdp_mmsg_sweep(udp_context_t *ctx, void *d)
 {
 	xdp_handle_reconfigure(d);
 	xdp_handle_sweep(d);
+	ATOMIC_SET(*ctx->conns_stat, xdp_handle_conns(d));
 }
 
 static udp_api_t xdp_mmsg_api = {
@@ -552,6 +1441,10 @@ int udp_master(dthread_t *thread)
 	if (cpu > 1) {
 		unsigned cpu_mask = (dt_get_id(thread) % cpu);
 		dt_setaffinity(thread, &cpu_mask, 1);
+		/* Allocate buffers and memory pools on the local NUMA node. */
+		if (conf()->cache.srv_numa_affinity) {
+			(void)dt_set_mempolicy(DT_MEMPOLICY_LOCAL, cpu_mask);
+		}
 	}
 
 	/* Choose processing API. */
@@ -569,6 +1462,7 @@ int udp_master(dthread_t *thread)
 		api = &udp_msg_api;
 #endif
 	}
+	udp_api_t *fallback_api = api;
 	void *api_ctx = NULL;
 
 	/* Create big enough memory cushion. */
@@ -579,9 +1473,20 @@ int udp_master(dthread_t *thread)
 	udp_context_t udp = {
 		.server = handler->server,
 		.thread_id = thread_id,
+		.offload = conf()->cache.srv_udp_offload,
+		.adaptive_batch = conf()->cache.srv_udp_adaptive_batch,
+		.batch_stat = &handler->thread_batch[dt_get_id(thread)],
+		.conns_stat = &handler->thread_conns[dt_get_id(thread)],
+		.drops_stat = &handler->thread_drops[dt_get_id(thread)],
+		.rcvbuf_max = conf()->cache.srv_udp_rcvbuf_max,
 	};
 	knot_layer_init(&udp.layer, &mm, process_query_layer());
 
+	/* Create the response cache if enabled. */
+	if (conf()->cache.srv_answer_cache > 0) {
+		udp.answer_cache = answer_cache_new(conf()->cache.srv_answer_cache);
+	}
+
 	/* Allocate descriptors for the configured interfaces. */
 	bool quic = false;
 	void *xdp_socket = NULL;
@@ -599,19 +1504,55 @@ int udp_master(dthread_t *thread)
 #ifdef ENABLE_QUIC
 	if (quic) {
 		udp.quic_idle_close= conf()->cache.srv_quic_idle_close * 1000000000LU;
-		udp.quic_table = quic_make_table(handler->server);
+		udp.quic_table = quic_make_table(handler->server, thread_id);
 		if (udp.quic_table == NULL) {
 			goto finish;
 		}
 	}
 #endif // ENABLE_QUIC
 
+	/* Busy polling of kernel sockets (XDP has its own). */
+	unsigned spin_us = 0;
+	if (!is_xdp_thread(handler->server, thread_id)) {
+		const conf_t *pconf = conf();
+		if (pconf->cache.srv_busypoll_budget > 0) {
+			(void)fdset_busypoll(&fds, pconf->cache.srv_busypoll_timeout,
+			                     pconf->cache.srv_busypoll_budget);
+		}
+		spin_us = pconf->cache.srv_busypoll_spin;
+	}
+	knot_atomic_uint64_t *spin_stat = &handler->thread_spin[dt_get_id(thread)];
+	knot_atomic_uint64_t *mem_stat = &handler->thread_mem[dt_get_id(thread)];
+
+#ifdef ENABLE_IO_URING
+	/* XDP and QUIC sockets are served by the classic API. */
+	if (!is_xdp_thread(handler->server, thread_id) && !quic) {
+		api = &udp_uring_api;
+	}
+#endif // ENABLE_IO_URING
+
 	/* Initialize the networking API. */
-	api_ctx = api->udp_init(&udp, xdp_socket);
+	api_ctx = api->udp_init(&udp, &fds, xdp_socket);
+	if (api_ctx == NULL && api != fallback_api) {
+		if (dt_get_id(thread) == 0) {
+			log_warning("UDP, failed to initialize io_uring, using the classic API");
+		}
+		api = fallback_api;
+		api_ctx = api->udp_init(&udp, &fds, xdp_socket);
+	}
 	if (api_ctx == NULL) {
 		goto finish;
 	}
 
+	/* Watch for the resumed queries (after the API possibly reset the set). */
+	if (!is_xdp_thread(handler->server, thread_id)) {
+		udp.suspend = suspend_queue_new();
+		if (udp.suspend == NULL ||
+		    fdset_add(&fds, suspend_queue_fd(udp.suspend), FDSET_POLLIN, NULL) < 0) {
+			goto finish;
+		}
+	}
+
 	/* Loop until all data is read. */
 	for (;;) {
 		/* Cancellation point. */
@@ -621,16 +1562,23 @@ int udp_master(dthread_t *thread)
 
 		/* Wait for events. */
 		fdset_it_t it;
-		(void)fdset_poll(&fds, &it, 0, 1000);
+		uint64_t spin_time = 0;
+		(void)fdset_poll_spin(&fds, &it, 0, 1000, spin_us, &spin_time);
+		if (spin_time > 0) {
+			ATOMIC_ADD(*spin_stat, spin_time);
+		}
 
 		/* Process the events. */
 		for (; !fdset_it_is_done(&it); fdset_it_next(&it)) {
 			if (!fdset_it_is_pollin(&it)) {
 				continue;
 			}
+			const iface_t *iface = fdset_it_get_ctx(&it);
+			if (iface == NULL) {
+				suspend_queue_process(udp.suspend);
+				continue;
+			}
 			if (api->udp_recv(fdset_it_get_fd(&it), api_ctx) > 0) {
-				const iface_t *iface = fdset_it_get_ctx(&it);
-				assert(iface);
 				api->udp_handle(&udp, iface, api_ctx);
 				api->udp_send(api_ctx);
 			}
@@ -638,13 +1586,16 @@ int udp_master(dthread_t *thread)
 
 		/* Regular maintenance. */
 		api->udp_sweep(&udp, api_ctx);
+		handle_mem_usage(&udp.layer, mem_stat);
 	}
 
 finish:
 	api->udp_deinit(api_ctx);
+	suspend_queue_free(udp.suspend);
 #ifdef ENABLE_QUIC
 	quic_unmake_table(udp.quic_table);
 #endif // ENABLE_QUIC
+	answer_cache_free(udp.answer_cache);
 	mp_delete(mm.ctx);
 	fdset_clear(&fds);
 
@@ -27,6 +27,8 @@
 #include "knot/server/dthreads.h"
 
 #define RECVMMSG_BATCHLEN 10 /*!< Default recvmmsg() batch size. */
+#define RECVMMSG_BATCHLEN_MIN 2  /*!< Minimum adaptive recvmmsg() batch size. */
+#define RECVMMSG_BATCHLEN_MAX 32 /*!< Maximum adaptive recvmmsg() batch size. */
 
 /*!
  * \brief UDP handler thread runnable.
@@ -25,8 +25,10 @@
 #include "knot/server/quic-handler.h"
 #include "knot/server/xdp-handler.h"
 #include "knot/common/log.h"
+#include "knot/common/probes.h"
 #include "knot/server/server.h"
 #include "libknot/error.h"
+#include "libknot/packet/wire.h"
 #ifdef ENABLE_QUIC
 #include "libknot/quic/quic.h"
 #endif // ENABLE_QUIC
@@ -50,6 +52,10 @@ typedef struct xdp_handle_ctx {
 	knot_sweep_stats_t quic_closed;
 #endif // ENABLE_QUIC
 
+	bool multi_buffer;
+	uint16_t udp_max_payload_ipv4;
+	uint16_t udp_max_payload_ipv6;
+
 	bool tcp;
 	size_t tcp_max_conns;
 	size_t tcp_syn_conns;
@@ -69,6 +75,9 @@ void xdp_handle_reconfigure(xdp_handle_ctx_t *ctx)
 {
 	rcu_read_lock();
 	conf_t *pconf = conf();
+	ctx->multi_buffer   = pconf->cache.xdp_multi_buffer;
+	ctx->udp_max_payload_ipv4 = pconf->cache.srv_udp_max_payload_ipv4;
+	ctx->udp_max_payload_ipv6 = pconf->cache.srv_udp_max_payload_ipv6;
 	ctx->tcp            = pconf->cache.xdp_tcp;
 	ctx->quic_port      = htobe16(pconf->cache.xdp_quic);
 	ctx->tcp_max_conns  = pconf->cache.xdp_tcp_max_clients / pconf->cache.srv_xdp_threads;
@@ -152,7 +161,7 @@ xdp_handle_ctx_t *xdp_handle_init(server_t *server, knot_xdp_socket_t *xdp_sock)
 
 	if (ctx->quic_port > 0) {
 #ifdef ENABLE_QUIC
-		ctx->quic_table = quic_make_table(server);
+		ctx->quic_table = quic_make_table(server, -1);
 		if (ctx->quic_table == NULL) {
 			xdp_handle_free(ctx);
 			return NULL;
@@ -179,21 +188,118 @@ int xdp_handle_recv(xdp_handle_ctx_t *ctx)
 	return ret == KNOT_EOK ? ctx->msg_recv_count : ret;
 }
 
+/*! \brief Get the EDNS payload size of a simple query without parsing it fully. */
+static uint16_t query_edns_payload(const struct iovec *query)
+{
+	const uint8_t *wire = query->iov_base;
+	const uint8_t *end = wire + query->iov_len;
+
+	if (query->iov_len < KNOT_WIRE_HEADER_SIZE ||
+	    knot_wire_get_qdcount(wire) != 1 || knot_wire_get_ancount(wire) != 0 ||
+	    knot_wire_get_nscount(wire) != 0 || knot_wire_get_arcount(wire) == 0) {
+		return 0;
+	}
+
+	int qname_size = knot_dname_wire_check(wire + KNOT_WIRE_HEADER_SIZE, end, NULL);
+	if (qname_size <= 0) {
+		return 0;
+	}
+
+	/* The OPT record is expected to be the first additional one. */
+	const uint8_t *opt = wire + KNOT_WIRE_HEADER_SIZE + qname_size + 2 * sizeof(uint16_t);
+	if (opt + 1 + 2 * sizeof(uint16_t) > end || opt[0] != '\0' ||
+	    knot_wire_read_u16(opt + 1) != KNOT_RRTYPE_OPT) {
+		return 0;
+	}
+
+	return knot_wire_read_u16(opt + 1 + sizeof(uint16_t));
+}
+
+/*! \brief Replace the reply buffer with a jumbo one if the client accepts it. */
+static void alloc_udp_jumbo(xdp_handle_ctx_t *ctx, knot_xdp_msg_t *msg_recv,
+                            knot_xdp_msg_t *msg_send)
+{
+	uint16_t max_payload = (msg_recv->flags & KNOT_XDP_MSG_IPV6) ?
+	                       ctx->udp_max_payload_ipv6 : ctx->udp_max_payload_ipv4;
+	uint16_t payload = MIN(query_edns_payload(&msg_recv->payload), max_payload);
+	if (payload <= msg_send->payload.iov_len) {
+		return;
+	}
+
+	knot_xdp_msg_t jumbo;
+	msg_recv->flags |= KNOT_XDP_MSG_MB;
+	int ret = knot_xdp_reply_alloc(ctx->sock, msg_recv, &jumbo);
+	msg_recv->flags &= ~KNOT_XDP_MSG_MB;
+	if (ret != KNOT_EOK) {
+		return;
+	}
+
+	if (jumbo.flags & KNOT_XDP_MSG_MB) {
+		knot_xdp_send_free(ctx->sock, msg_send, 1);
+		*msg_send = jumbo;
+	} else { // No jumbo buffer available.
+		knot_xdp_send_free(ctx->sock, &jumbo, 1);
+	}
+}
+
+static bool udp_msg(xdp_handle_ctx_t *ctx, const knot_xdp_msg_t *msg)
+{
+	// Skip TCP or QUIC or marked (zero length) message.
+	return !(msg->flags & KNOT_XDP_MSG_TCP) &&
+	       msg->ip_to.sin6_port != ctx->quic_port &&
+	       msg->payload.iov_len > 0;
+}
+
+/*! \brief Passes all the UDP messages to the module batch hooks. */
+static void handle_udp_batch(xdp_handle_ctx_t *ctx, const knotd_qdata_params_t *params,
+                             bool *blocked)
+{
+	knotd_qdata_params_t batch_params[XDP_BATCHLEN];
+	knotd_batch_item_t items[XDP_BATCHLEN];
+	uint32_t idx[XDP_BATCHLEN];
+	unsigned count = 0;
+
+	for (uint32_t i = 0; i < ctx->msg_recv_count; i++) {
+		knot_xdp_msg_t *msg_recv = &ctx->msg_recv[i];
+		if (!udp_msg(ctx, msg_recv)) {
+			continue;
+		}
+
+		batch_params[count] = *params;
+		params_xdp_update(&batch_params[count], KNOTD_QUERY_PROTO_UDP, msg_recv);
+		items[count] = (knotd_batch_item_t) {
+			.params = &batch_params[count],
+			.wire = msg_recv->payload.iov_base,
+			.wire_len = msg_recv->payload.iov_len,
+			.state = KNOTD_PROTO_STATE_PASS,
+		};
+		idx[count++] = i;
+	}
+
+	process_query_batch(items, count);
+
+	for (unsigned i = 0; i < count; i++) {
+		blocked[idx[i]] = (items[i].state == KNOTD_PROTO_STATE_BLOCK);
+	}
+}
+
 static void handle_udp(xdp_handle_ctx_t *ctx, knot_layer_t *layer,
-                       knotd_qdata_params_t *params)
+                       knotd_qdata_params_t *params, answer_cache_t *cache)
 {
 	struct sockaddr_storage proxied_remote;
+	bool blocked[XDP_BATCHLEN] = { false };
 
 	ctx->msg_udp_count = 0;
 
+	if (process_query_batch_enabled()) {
+		handle_udp_batch(ctx, params, blocked);
+	}
+
 	for (uint32_t i = 0; i < ctx->msg_recv_count; i++) {
 		knot_xdp_msg_t *msg_recv = &ctx->msg_recv[i];
 		knot_xdp_msg_t *msg_send = &ctx->msg_send_udp[ctx->msg_udp_count];
 
-		// Skip TCP or QUIC or marked (zero length) message.
-		if ((msg_recv->flags & KNOT_XDP_MSG_TCP) ||
-		    msg_recv->ip_to.sin6_port == ctx->quic_port ||
-		    msg_recv->payload.iov_len == 0) {
+		if (!udp_msg(ctx, msg_recv) || blocked[i]) {
 			continue;
 		}
 
@@ -212,9 +318,13 @@ static void handle_udp(xdp_handle_ctx_t *ctx, knot_layer_t *layer,
 		}
 		ctx->msg_udp_count++;
 
+		if (ctx->multi_buffer) {
+			alloc_udp_jumbo(ctx, msg_recv, msg_send);
+		}
+
 		// Prepare a reply.
 		handle_udp_reply(params, layer, &msg_recv->payload, &msg_send->payload,
-		                 &proxied_remote);
+		                 &proxied_remote, cache);
 
 		(void)process_query_proto(params, KNOTD_STAGE_PROTO_END);
 	}
@@ -334,16 +444,18 @@ static void handle_quic(xdp_handle_ctx_t *ctx, knot_layer_t *layer,
 }
 
 void xdp_handle_msgs(xdp_handle_ctx_t *ctx, knot_layer_t *layer,
-                     server_t *server, unsigned thread_id)
+                     server_t *server, unsigned thread_id, answer_cache_t *cache)
 {
 	assert(ctx->msg_recv_count > 0);
 
+	KNOTD_PROBE2(xdp__recv, thread_id, ctx->msg_recv_count);
+
 	knotd_qdata_params_t params = params_xdp_init(
 		knot_xdp_socket_fd(ctx->sock), server, thread_id);
 
 	knot_xdp_send_prepare(ctx->sock);
 
-	handle_udp(ctx, layer, &params);
+	handle_udp(ctx, layer, &params, cache);
 	if (ctx->tcp) {
 		handle_tcp(ctx, layer, &params);
 	}
@@ -354,6 +466,8 @@ void xdp_handle_msgs(xdp_handle_ctx_t *ctx, knot_layer_t *layer,
 
 void xdp_handle_send(xdp_handle_ctx_t *ctx)
 {
+	KNOTD_PROBE2(xdp__send, ctx->msg_recv_count, ctx->msg_udp_count);
+
 	uint32_t unused;
 	int ret = knot_xdp_send(ctx->sock, ctx->msg_send_udp, ctx->msg_udp_count, &unused);
 	if (ret != KNOT_EOK && log_enabled_debug()) {
@@ -434,4 +548,15 @@ void xdp_handle_sweep(xdp_handle_ctx_t *ctx)
 	log_swept(&ctx->tcp_closed, true);
 }
 
+size_t xdp_handle_conns(xdp_handle_ctx_t *ctx)
+{
+	size_t conns = (ctx->tcp_table != NULL) ? ctx->tcp_table->usage : 0;
+#ifdef ENABLE_QUIC
+	if (ctx->quic_table != NULL) {
+		conns += ctx->quic_table->usage;
+	}
+#endif // ENABLE_QUIC
+	return conns;
+}
+
 #endif // ENABLE_XDP
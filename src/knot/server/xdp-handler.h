@@ -18,6 +18,7 @@
 
 #ifdef ENABLE_XDP
 
+#include "knot/nameserver/answer_cache.h"
 #include "knot/query/layer.h"
 #include "libknot/xdp/xdp.h"
 
@@ -47,7 +48,8 @@ int xdp_handle_recv(struct xdp_handle_ctx *ctx);
  * \warning In case of TCP, this also sends some packets, e.g. ACK.
  */
 void xdp_handle_msgs(struct xdp_handle_ctx *ctx, knot_layer_t *layer,
-                     struct server *server, unsigned thread_id);
+                     struct server *server, unsigned thread_id,
+                     answer_cache_t *cache);
 
 /*!
  * \brief Send packets thru XDP socket.
@@ -59,6 +61,11 @@ void xdp_handle_send(struct xdp_handle_ctx *ctx);
  */
 void xdp_handle_sweep(struct xdp_handle_ctx *ctx);
 
+/*!
+ * \brief Get the number of open TCP and QUIC connections.
+ */
+size_t xdp_handle_conns(struct xdp_handle_ctx *ctx);
+
 /*!
  * \brief Update configuration parameters of running ctx.
  */
@@ -16,6 +16,8 @@
 
 #include "knot/updates/acl.h"
 
+#include "contrib/macros.h"
+#include "contrib/qp-trie/trie.h"
 #include "contrib/string.h"
 #include "contrib/wire_ctx.h"
 
@@ -41,21 +43,146 @@ static bool cert_pin_check(const uint8_t *session_pin, size_t session_pin_size,
 	return false;
 }
 
-static bool match_type(uint16_t type, conf_val_t *types)
+/*! \brief Update owner name of a precompiled ACL rule containing a wildcard label. */
+typedef struct {
+	knot_dname_t *name;
+	bool relative;
+} update_pattern_t;
+
+/*! \brief Precompiled update rules of one ACL. */
+typedef struct {
+	uint8_t *types;              /*!< Bitmap of allowed types, NULL if any type. */
+	acl_update_owner_t owner;
+	acl_update_owner_match_t match;
+	trie_t *names;               /*!< Allowed FQDNs in lookup format, NULL if any name. */
+	trie_t *rel_names;           /*!< Allowed names relative to the zone. */
+	update_pattern_t *patterns;  /*!< Allowed names with a wildcard label. */
+	size_t pattern_count;
+} update_rule_t;
+
+struct acl_rules {
+	trie_t *rules;               /*!< ACL identifier -> update_rule_t. */
+};
+
+#define TYPES_SIZE (UINT16_MAX / 8 + 1)
+
+static bool has_wildcard_label(const uint8_t *name, size_t len)
 {
-	if (types == NULL) {
-		return true;
+	const uint8_t *end = name + len;
+	while (name < end && *name != 0) {
+		if (name[0] == 1 && name[1] == '*') {
+			return true;
+		}
+		name += 1 + *name;
 	}
+	return false;
+}
 
-	conf_val_reset(types);
-	while (types->code == KNOT_EOK) {
-		if (type == knot_wire_read_u64(types->data)) {
-			return true;
+static void rule_deinit(update_rule_t *rule)
+{
+	free(rule->types);
+	trie_free(rule->names);
+	trie_free(rule->rel_names);
+	for (size_t i = 0; i < rule->pattern_count; i++) {
+		free(rule->patterns[i].name);
+	}
+	free(rule->patterns);
+	memset(rule, 0, sizeof(*rule));
+}
+
+static int rule_add_name(update_rule_t *rule, const uint8_t *data, size_t len)
+{
+	// Non-FQDN names are relative to the zone, complete them with the root.
+	bool relative = (data[len - 1] != '\0');
+	knot_dname_storage_t name;
+	if (len + relative > sizeof(name)) {
+		return KNOT_EINVAL;
+	}
+	memcpy(name, data, len);
+	name[len] = '\0';
+
+	if (rule->match == ACL_UPDATE_MATCH_PATTERN && has_wildcard_label(name, len + relative)) {
+		update_pattern_t *patterns = realloc(rule->patterns,
+		                                     (rule->pattern_count + 1) * sizeof(*patterns));
+		if (patterns == NULL) {
+			return KNOT_ENOMEM;
+		}
+		rule->patterns = patterns;
+		update_pattern_t *pattern = &patterns[rule->pattern_count];
+		pattern->name = knot_dname_copy(name, NULL);
+		if (pattern->name == NULL) {
+			return KNOT_ENOMEM;
 		}
-		conf_val_next(types);
+		pattern->relative = relative;
+		rule->pattern_count++;
+		return KNOT_EOK;
 	}
 
-	return false;
+	knot_dname_storage_t lf_storage;
+	uint8_t *lf = knot_dname_lf(name, lf_storage);
+	trie_val_t *val = trie_get_ins(relative ? rule->rel_names : rule->names, lf + 1, *lf);
+	if (val == NULL) {
+		return KNOT_ENOMEM;
+	}
+	*val = rule;
+
+	return KNOT_EOK;
+}
+
+static int rule_init(update_rule_t *rule, conf_t *conf, conf_val_t *acl)
+{
+	memset(rule, 0, sizeof(*rule));
+
+	conf_val_t val = conf_id_get(conf, C_ACL, C_UPDATE_TYPE, acl);
+	if (conf_val_count(&val) > 0) {
+		rule->types = calloc(1, TYPES_SIZE);
+		if (rule->types == NULL) {
+			return KNOT_ENOMEM;
+		}
+		while (val.code == KNOT_EOK) {
+			uint16_t type = knot_wire_read_u64(val.data);
+			rule->types[type / 8] |= 1 << (type % 8);
+			conf_val_next(&val);
+		}
+	}
+
+	val = conf_id_get(conf, C_ACL, C_UPDATE_OWNER, acl);
+	rule->owner = conf_opt(&val);
+
+	rule->match = ACL_UPDATE_MATCH_SUBEQ;
+	if (rule->owner != ACL_UPDATE_OWNER_NONE) {
+		val = conf_id_get(conf, C_ACL, C_UPDATE_OWNER_MATCH, acl);
+		rule->match = conf_opt(&val);
+	}
+
+	if (rule->owner == ACL_UPDATE_OWNER_NAME) {
+		val = conf_id_get(conf, C_ACL, C_UPDATE_OWNER_NAME, acl);
+		if (conf_val_count(&val) > 0) {
+			rule->names = trie_create(NULL);
+			rule->rel_names = trie_create(NULL);
+			if (rule->names == NULL || rule->rel_names == NULL) {
+				rule_deinit(rule);
+				return KNOT_ENOMEM;
+			}
+		}
+		while (val.code == KNOT_EOK) {
+			size_t len;
+			const uint8_t *name = conf_data(&val, &len);
+			int ret = rule_add_name(rule, name, len);
+			if (ret == KNOT_ENOMEM) {
+				rule_deinit(rule);
+				return ret;
+			}
+			conf_val_next(&val);
+		}
+	}
+
+	return KNOT_EOK;
+}
+
+static bool match_type(uint16_t type, const uint8_t *types)
+{
+	return types == NULL || (types[type / 8] & (1 << (type % 8)));
 }
 
 static bool match_pattern(const knot_dname_t *rr_owner, const knot_dname_t *name)
@@ -106,70 +233,80 @@ static bool match_name(const knot_dname_t *rr_owner, const knot_dname_t *name,
 	}
 }
 
+/*!
+ * Looks up the name or its closest enclosing name, the key is the name
+ * in the lookup format (possibly relative to the zone).
+ */
+static bool match_trie(trie_t *names, const uint8_t *key, size_t len,
+                       acl_update_owner_match_t match)
+{
+	if (match == ACL_UPDATE_MATCH_EQ || match == ACL_UPDATE_MATCH_PATTERN) {
+		return trie_get_try(names, key, len) != NULL;
+	} else {
+		return trie_get_prefix(names, key, len) != NULL;
+	}
+}
+
 static bool match_names(const knot_dname_t *rr_owner, const knot_dname_t *zone_name,
-                        conf_val_t *names, acl_update_owner_match_t match)
+                        const update_rule_t *rule)
 {
-	if (names == NULL) {
+	if (rule->names == NULL) {
 		return true;
 	}
 
-	conf_val_reset(names);
-	while (names->code == KNOT_EOK) {
+	// Strict subdomains are looked up as the parent name or its ancestors.
+	const knot_dname_t *lookup = rr_owner;
+	if (rule->match == ACL_UPDATE_MATCH_SUB) {
+		if (*rr_owner == '\0') {
+			return false;
+		}
+		lookup = knot_dname_next_label(rr_owner);
+	}
+
+	knot_dname_storage_t lf_storage;
+	uint8_t *lf = knot_dname_lf(lookup, lf_storage);
+	if (match_trie(rule->names, lf + 1, *lf, rule->match)) {
+		return true;
+	}
+
+	// Relative names are looked up without the zone name labels.
+	if (trie_weight(rule->rel_names) > 0 &&
+	    knot_dname_in_bailiwick(lookup, zone_name) >= 0) {
+		size_t zone_len = knot_dname_size(zone_name) - 1;
+		if (match_trie(rule->rel_names, lf + 1 + zone_len, *lf - zone_len, rule->match)) {
+			return true;
+		}
+	}
+
+	for (size_t i = 0; i < rule->pattern_count; i++) {
+		const knot_dname_t *name = rule->patterns[i].name;
 		knot_dname_storage_t full_name;
-		size_t len;
-		const uint8_t *name = conf_data(names, &len);
-		if (name[len - 1] != '\0') {
+		if (rule->patterns[i].relative) {
 			// Append zone name if non-FQDN.
 			wire_ctx_t ctx = wire_ctx_init(full_name, sizeof(full_name));
-			wire_ctx_write(&ctx, name, len);
+			wire_ctx_write(&ctx, name, knot_dname_size(name) - 1);
 			wire_ctx_write(&ctx, zone_name, knot_dname_size(zone_name));
 			if (ctx.error != KNOT_EOK) {
-				return false;
+				continue;
 			}
 			name = full_name;
 		}
-		if (match_name(rr_owner, name, match)) {
+		if (match_pattern(rr_owner, name)) {
 			return true;
 		}
-		conf_val_next(names);
 	}
 
 	return false;
 }
 
-static bool update_match(conf_t *conf, conf_val_t *acl, knot_dname_t *key_name,
-                         const knot_dname_t *zone_name, knot_pkt_t *query)
+static bool rule_match(const update_rule_t *rule, knot_dname_t *key_name,
+                       const knot_dname_t *zone_name, knot_pkt_t *query)
 {
-	if (query == NULL) {
-		return true;
-	}
-
-	conf_val_t val_types = conf_id_get(conf, C_ACL, C_UPDATE_TYPE, acl);
-	conf_val_t *types = (conf_val_count(&val_types) > 0) ? &val_types : NULL;
-
-	conf_val_t val = conf_id_get(conf, C_ACL, C_UPDATE_OWNER, acl);
-	acl_update_owner_t owner = conf_opt(&val);
-
 	/* Return if no specific requirements configured. */
-	if (types == NULL && owner == ACL_UPDATE_OWNER_NONE) {
+	if (rule->types == NULL && rule->owner == ACL_UPDATE_OWNER_NONE) {
 		return true;
 	}
 
-	acl_update_owner_match_t match = ACL_UPDATE_MATCH_SUBEQ;
-	if (owner != ACL_UPDATE_OWNER_NONE) {
-		val = conf_id_get(conf, C_ACL, C_UPDATE_OWNER_MATCH, acl);
-		match = conf_opt(&val);
-	}
-
-	conf_val_t *names = NULL;
-	conf_val_t val_names;
-	if (owner == ACL_UPDATE_OWNER_NAME) {
-		val_names = conf_id_get(conf, C_ACL, C_UPDATE_OWNER_NAME, acl);
-		if (conf_val_count(&val_names) > 0) {
-			names = &val_names;
-		}
-	}
-
 	/* Updated RRs are contained in the Authority section of the query
 	 * (RFC 2136 Section 2.2)
 	 */
@@ -178,23 +315,23 @@ static bool update_match(conf_t *conf, conf_val_t *acl, knot_dname_t *key_name,
 
 	for (int i = pos; i < pos + count; i++) {
 		knot_rrset_t *rr = &query->rr[i];
-		if (!match_type(rr->type, types)) {
+		if (!match_type(rr->type, rule->types)) {
 			return false;
 		}
 
-		switch (owner) {
+		switch (rule->owner) {
 		case ACL_UPDATE_OWNER_NAME:
-			if (!match_names(rr->owner, zone_name, names, match)) {
+			if (!match_names(rr->owner, zone_name, rule)) {
 				return false;
 			}
 			break;
 		case ACL_UPDATE_OWNER_KEY:
-			if (!match_name(rr->owner, key_name, match)) {
+			if (!match_name(rr->owner, key_name, rule->match)) {
 				return false;
 			}
 			break;
 		case ACL_UPDATE_OWNER_ZONE:
-			if (!match_name(rr->owner, zone_name, match)) {
+			if (!match_name(rr->owner, zone_name, rule->match)) {
 				return false;
 			}
 			break;
@@ -206,6 +343,86 @@ static bool update_match(conf_t *conf, conf_val_t *acl, knot_dname_t *key_name,
 	return true;
 }
 
+static bool update_match(conf_t *conf, conf_val_t *acl, knot_dname_t *key_name,
+                         const knot_dname_t *zone_name, knot_pkt_t *query)
+{
+	if (query == NULL) {
+		return true;
+	}
+
+	/* Use the rules compiled with the configuration if available. */
+	if (conf->acl_rules != NULL) {
+		conf_val(acl);
+		trie_val_t *val = trie_get_try(conf->acl_rules->rules, acl->data, acl->len);
+		if (val != NULL) {
+			return rule_match(*val, key_name, zone_name, query);
+		}
+	}
+
+	update_rule_t rule;
+	if (rule_init(&rule, conf, acl) != KNOT_EOK) {
+		return false;
+	}
+	bool match = rule_match(&rule, key_name, zone_name, query);
+	rule_deinit(&rule);
+
+	return match;
+}
+
+static int free_rule(trie_val_t *val, _unused_ void *d)
+{
+	update_rule_t *rule = *val;
+	rule_deinit(rule);
+	free(rule);
+	return KNOT_EOK;
+}
+
+acl_rules_t *acl_rules_compile(conf_t *conf)
+{
+	acl_rules_t *rules = calloc(1, sizeof(*rules));
+	if (rules == NULL) {
+		return NULL;
+	}
+
+	rules->rules = trie_create(NULL);
+	if (rules->rules == NULL) {
+		free(rules);
+		return NULL;
+	}
+
+	for (conf_iter_t iter = conf_iter(conf, C_ACL);
+	     iter.code == KNOT_EOK; conf_iter_next(conf, &iter)) {
+		conf_val_t id = conf_iter_id(conf, &iter);
+		conf_val(&id);
+
+		update_rule_t *rule = malloc(sizeof(*rule));
+		if (rule == NULL || rule_init(rule, conf, &id) != KNOT_EOK) {
+			free(rule);
+			continue; // Compiled on demand then.
+		}
+
+		trie_val_t *val = trie_get_ins(rules->rules, id.data, id.len);
+		if (val == NULL) {
+			free_rule((trie_val_t *)&rule, NULL);
+			continue;
+		}
+		*val = rule;
+	}
+
+	return rules;
+}
+
+void acl_rules_free(acl_rules_t *rules)
+{
+	if (rules == NULL) {
+		return;
+	}
+
+	trie_apply(rules->rules, free_rule, NULL);
+	trie_free(rules->rules);
+	free(rules);
+}
+
 static bool check_proto_rmt(conf_t *conf, knotd_query_proto_t proto, conf_val_t *rmt_id)
 {
 	conf_val_t quic_val = conf_id_get(conf, C_RMT, C_QUIC, rmt_id);
@@ -56,6 +56,26 @@ typedef enum {
 	ACL_PROTOCOL_QUIC = (1 << 3),
 } acl_protocol_t;
 
+/*! \brief Update rules of all ACLs, compiled with the configuration. */
+typedef struct acl_rules acl_rules_t;
+
+/*!
+ * \brief Compiles the update rules (update-type, update-owner) of all ACLs.
+ *
+ * Allowed types are kept in a bitmap and allowed owner names in a trie,
+ * so that checking of an update doesn't read and scan the configuration.
+ *
+ * \param conf  Configuration.
+ *
+ * \return Compiled rules or NULL if out of memory.
+ */
+acl_rules_t *acl_rules_compile(conf_t *conf);
+
+/*!
+ * \brief Frees the compiled update rules.
+ */
+void acl_rules_free(acl_rules_t *rules);
+
 /*!
  * \brief Checks if the address and/or tsig key matches given ACL list.
  *
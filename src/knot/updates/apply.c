@@ -31,13 +31,7 @@ static int replace_rdataset_with_copy(zone_node_t *node, uint16_t type)
 	}
 
 	// Find data to copy.
-	struct rr_data *data = NULL;
-	for (uint16_t i = 0; i < node->rrset_count; ++i) {
-		if (node->rrs[i].type == type) {
-			data = &node->rrs[i];
-			break;
-		}
-	}
+	struct rr_data *data = node_rr_data(node, type);
 	if (data == NULL) {
 		return KNOT_EOK;
 	}
@@ -350,6 +344,7 @@ void apply_rollback(apply_ctx_t *ctx)
 
 	dnssec_nsec3_params_free(&ctx->contents->nsec3_params);
 
+	zone_arena_unref(ctx->contents->arena);
 	free(ctx->contents);
 
 	if (ctx->cow_mutex != NULL) {
@@ -375,5 +370,6 @@ void update_free_zone(zone_contents_t *contents)
 
 	dnssec_nsec3_params_free(&contents->nsec3_params);
 
+	zone_arena_unref(contents->arena);
 	free(contents);
 }
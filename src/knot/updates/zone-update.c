@@ -14,6 +14,8 @@
     along with this program.  If not, see <https://www.gnu.org/licenses/>.
  */
 
+#include <limits.h>
+#include <pthread.h>
 #include <signal.h>
 #include <unistd.h>
 #include <urcu.h>
@@ -21,12 +23,15 @@
 #include "knot/catalog/interpret.h"
 #include "knot/common/dbus.h"
 #include "knot/common/log.h"
+#include "knot/common/reclaim.h"
+#include "knot/dnssec/resign-index.h"
 #include "knot/dnssec/zone-events.h"
 #include "knot/server/server.h"
 #include "knot/updates/zone-update.h"
 #include "knot/zone/adds_tree.h"
 #include "knot/zone/adjust.h"
 #include "knot/zone/digest.h"
+#include "knot/zone/measure.h"
 #include "knot/zone/serial.h"
 #include "knot/zone/zone-diff.h"
 #include "knot/zone/zonefile.h"
@@ -125,6 +130,7 @@ static int init_base(zone_update_t *update, zone_t *zone, zone_contents_t *old_c
 	memset(update, 0, sizeof(*update));
 	update->zone = zone;
 	update->flags = flags;
+	update->started = time_now();
 
 	update->a_ctx = calloc(1, sizeof(*update->a_ctx));
 	if (update->a_ctx == NULL) {
@@ -188,7 +194,9 @@ int zone_update_from_differences(zone_update_t *update, zone_t *zone, zone_conte
 		old_cont = zone->contents;
 	}
 
-	ret = zone_contents_diff(old_cont, new_cont, &diff, ignore_dnssec, ignore_zonemd);
+	conf_val_t thr = conf_zone_get(conf(), C_ADJUST_THR, zone->name);
+	ret = zone_contents_diff(old_cont, new_cont, &diff, ignore_dnssec, ignore_zonemd,
+	                         conf_int(&thr));
 	switch (ret) {
 	case KNOT_ENODIFF:
 	case KNOT_ESEMCHECK:
@@ -228,6 +236,7 @@ int zone_update_from_contents(zone_update_t *update, zone_t *zone_without_conten
 	update->zone = zone_without_contents;
 	update->flags = flags;
 	update->new_cont = new_cont;
+	update->started = time_now();
 
 	update->a_ctx = calloc(1, sizeof(*update->a_ctx));
 	if (update->a_ctx == NULL) {
@@ -290,7 +299,7 @@ int zone_update_start_extra(zone_update_t *update, conf_t *conf)
 		}
 
 		ret = zone_contents_diff(update->init_cont, update->new_cont,
-		                         &update->extra_ch, false, false);
+		                         &update->extra_ch, false, false, 1);
 		if (ret != KNOT_EOK) {
 			return ret;
 		}
@@ -399,6 +408,7 @@ void zone_update_clear(zone_update_t *update)
 	}
 
 	zone_contents_deep_free(update->init_cont);
+	resign_index_free(update->resign_delta);
 
 	if (update->flags & (UPDATE_FULL | UPDATE_HYBRID)) {
 		apply_cleanup(update->a_ctx);
@@ -739,15 +749,24 @@ static int update_catalog(conf_t *conf, zone_update_t *update)
 		return (val.code == KNOT_ENOENT || val.code == KNOT_YP_EINVAL_ID) ? KNOT_EOK : val.code;
 	}
 
-	int ret = catalog_zone_verify(update->new_cont);
+	// Only the changed members need to be verified in incremental updates.
+	zone_diff_t diff;
+	const zone_diff_t *changes = NULL;
+	if ((update->flags & UPDATE_NO_CHSET)) {
+		get_zone_diff(&diff, update);
+		changes = &diff;
+	} else if ((update->flags & UPDATE_INCREMENTAL) && update->change.add != NULL) {
+		zone_diff_from_zone(&diff, update->change.add);
+		changes = &diff;
+	}
+
+	int ret = catalog_zone_verify(update->new_cont, changes);
 	if (ret != KNOT_EOK) {
 		return ret;
 	}
 
 	ssize_t upd_count = 0;
 	if ((update->flags & UPDATE_NO_CHSET)) {
-		zone_diff_t diff;
-		get_zone_diff(&diff, update);
 		ret = catalog_update_from_zone(zone_catalog_upd(update->zone),
 		                               NULL, &diff, update->new_cont,
 		                               false, zone_catalog(update->zone), &upd_count);
@@ -810,8 +829,6 @@ static bool counter_reach(counter_reach_t *counter, size_t increment, size_t lim
  * This can't be zone_update_t structure as this might be already freed at that time.
  */
 typedef struct {
-	struct rcu_head rcuhead;
-
 	zone_contents_t *free_contents;
 	void (*free_method)(zone_contents_t *);
 
@@ -820,7 +837,7 @@ typedef struct {
 	size_t new_cont_size;
 } update_clear_ctx_t;
 
-static void update_clear(struct rcu_head *param)
+static void update_clear(void *param)
 {
 	static counter_reach_t counter = { PTHREAD_MUTEX_INITIALIZER, 0 };
 
@@ -852,9 +869,18 @@ int zone_update_semcheck(conf_t *conf, zone_update_t *update)
 	zone_tree_t *node_ptrs = (update->flags & UPDATE_INCREMENTAL) ?
 	                         update->a_ctx->node_ptrs : NULL;
 
+	// Whole new zones are checked in parallel.
+	unsigned threads = 1;
+	if (node_ptrs == NULL) {
+		conf_val_t val = conf_zone_get(conf, C_ADJUST_THR, update->zone->name);
+		threads = conf_int(&val);
+	}
+
+	struct timespec begin = time_now();
+
 	// adjust_cb_nsec3_pointer not needed as we don't check DNSSEC here
 	int ret = zone_adjust_contents(update->new_cont, adjust_cb_flags, NULL,
-	                               false, false, 1, node_ptrs);
+	                               false, false, threads, node_ptrs);
 	if (ret != KNOT_EOK) {
 		return ret;
 	}
@@ -867,7 +893,10 @@ int zone_update_semcheck(conf_t *conf, zone_update_t *update)
 	semcheck_optional_t mode = (conf_opt(&val) == SEMCHECKS_SOFT) ?
 	                           SEMCHECK_MANDATORY_SOFT : SEMCHECK_MANDATORY_ONLY;
 
-	ret = sem_checks_process(update->new_cont, mode, &handler, time(NULL));
+	// nodes affected by incremental update incl. their parents suffice,
+	// DNSSEC (incl. NSEC chain) is not checked here
+	ret = sem_checks_process(update->new_cont, node_ptrs, mode, &handler, threads, time(NULL));
+	xfr_perf_time(update->xfr_perf, XFR_PERF_IN_SEMCHECK_TIME, &begin);
 	if (ret != KNOT_EOK) {
 		// error is logged by the error handler
 		return ret;
@@ -876,6 +905,16 @@ int zone_update_semcheck(conf_t *conf, zone_update_t *update)
 	return KNOT_EOK;
 }
 
+static void log_digest_verify(zone_update_t *update, int ret)
+{
+	if (ret != KNOT_EOK) {
+		log_zone_error(update->zone->name, "ZONEMD, verification failed (%s)",
+		               knot_strerror(ret));
+	} else {
+		log_zone_info(update->zone->name, "ZONEMD, verification successful");
+	}
+}
+
 int zone_update_verify_digest(conf_t *conf, zone_update_t *update)
 {
 	conf_val_t val = conf_zone_get(conf, C_ZONEMD_VERIFY, update->zone->name);
@@ -883,15 +922,59 @@ int zone_update_verify_digest(conf_t *conf, zone_update_t *update)
 		return KNOT_EOK;
 	}
 
+	struct timespec begin = time_now();
 	int ret = zone_contents_digest_verify(update->new_cont);
-	if (ret != KNOT_EOK) {
-		log_zone_error(update->zone->name, "ZONEMD, verification failed (%s)",
-		               knot_strerror(ret));
+	xfr_perf_time(update->xfr_perf, XFR_PERF_IN_DIGEST_TIME, &begin);
+	log_digest_verify(update, ret);
+
+	return ret;
+}
+
+typedef struct {
+	const zone_contents_t *contents;
+	xfr_perf_t *xfr_perf;
+	int ret;
+} verify_digest_ctx_t;
+
+static void *verify_digest_thread(void *arg)
+{
+	verify_digest_ctx_t *ctx = arg;
+	struct timespec begin = time_now();
+	ctx->ret = zone_contents_digest_verify(ctx->contents);
+	xfr_perf_time(ctx->xfr_perf, XFR_PERF_IN_DIGEST_TIME, &begin);
+	return NULL;
+}
+
+int zone_update_semcheck_verify(conf_t *conf, zone_update_t *update)
+{
+	if (update == NULL) {
+		return KNOT_EINVAL;
+	}
+
+	conf_val_t val = conf_zone_get(conf, C_ZONEMD_VERIFY, update->zone->name);
+	if (!conf_bool(&val)) {
+		return zone_update_semcheck(conf, update);
+	}
+
+	// The digest only reads the records, the checks only touch node flags.
+	pthread_t thread;
+	verify_digest_ctx_t ctx = { .contents = update->new_cont, .xfr_perf = update->xfr_perf };
+	bool parallel = (pthread_create(&thread, NULL, verify_digest_thread, &ctx) == 0);
+
+	int ret = zone_update_semcheck(conf, update);
+
+	if (parallel) {
+		pthread_join(thread, NULL);
 	} else {
-		log_zone_info(update->zone->name, "ZONEMD, verification successful");
+		verify_digest_thread(&ctx);
+	}
+	if (ret != KNOT_EOK) {
+		return ret; // Don't report the digest of a broken zone.
 	}
 
-	return ret;
+	log_digest_verify(update, ctx.ret);
+
+	return ctx.ret;
 }
 
 int zone_update_commit(conf_t *conf, zone_update_t *update)
@@ -909,6 +992,9 @@ int zone_update_commit(conf_t *conf, zone_update_t *update)
 		if (dnssec && (update->flags & UPDATE_SIGNED_FULL)) {
 			zone_set_flag(update->zone, ZONE_LAST_SIGN_OK);
 		}
+		if (update->resign_delta != NULL) {
+			resign_index_commit(&update->zone->resign_idx, &update->resign_delta);
+		}
 		zone_update_clear(update);
 		return KNOT_EOK;
 	}
@@ -922,7 +1008,15 @@ int zone_update_commit(conf_t *conf, zone_update_t *update)
 		return ret;
 	}
 
+	val = conf_zone_get(conf, C_ANS_PRERENDER, update->zone->name);
+	update->new_cont->prerender = conf_bool(&val);
+	val = conf_zone_get(conf, C_ANS_LAZY_GLUE, update->zone->name);
+	update->new_cont->lazy_glue = conf_bool(&val);
+
+	struct timespec t_adjust = time_now();
+
 	conf_val_t thr = conf_zone_get(conf, C_ADJUST_THR, update->zone->name);
+	update->new_cont->free_threads = conf_int(&thr);
 	if ((update->flags & (UPDATE_HYBRID | UPDATE_FULL))) {
 		ret = zone_adjust_full(update->new_cont, conf_int(&thr));
 	} else {
@@ -933,6 +1027,9 @@ int zone_update_commit(conf_t *conf, zone_update_t *update)
 		return ret;
 	}
 
+	struct timespec t_commit = time_now();
+	xfr_perf_time(update->xfr_perf, XFR_PERF_IN_ADJUST_TIME, &t_adjust);
+
 	/* Check the zone size. */
 	val = conf_zone_get(conf, C_ZONE_MAX_SIZE, update->zone->name);
 	size_t size_limit = conf_int(&val);
@@ -942,6 +1039,21 @@ int zone_update_commit(conf_t *conf, zone_update_t *update)
 		return KNOT_EZONESIZE;
 	}
 
+	/* Check the zone memory, which requires a traversal of the whole zone. */
+	val = conf_zone_get(conf, C_ZONE_MAX_MEMORY, update->zone->name);
+	size_t memory_limit = conf_int(&val);
+
+	if (memory_limit < SSIZE_MAX) {
+		measure_memory_t mem;
+		knot_measure_memory(update->new_cont, &mem);
+		if (knot_measure_memory_total(&mem) > memory_limit) {
+			log_zone_warning(update->zone->name, "zone memory %zu bytes exceeds "
+			                 "the limit", knot_measure_memory_total(&mem));
+			discard_adds_tree(update);
+			return KNOT_EZONESIZE;
+		}
+	}
+
 	val = conf_zone_get(conf, C_DNSSEC_VALIDATION, update->zone->name);
 	if (conf_bool(&val)) {
 		bool incr_valid = update->flags & UPDATE_INCREMENTAL;
@@ -959,7 +1071,9 @@ int zone_update_commit(conf_t *conf, zone_update_t *update)
 		return ret;
 	}
 
+	struct timespec t_journal = time_now();
 	ret = commit_journal(conf, update);
+	xfr_perf_time(update->xfr_perf, XFR_PERF_IN_JOURNAL_TIME, &t_journal);
 	if (ret != KNOT_EOK) {
 		log_zone_error(update->zone->name, "journal update failed (%s)", knot_strerror(ret));
 		discard_adds_tree(update);
@@ -983,6 +1097,7 @@ int zone_update_commit(conf_t *conf, zone_update_t *update)
 	/* Switch zone contents. */
 	zone_contents_t *old_contents;
 	old_contents = zone_switch_contents(update->zone, update->new_cont);
+	resign_index_commit(&update->zone->resign_idx, &update->resign_delta);
 
 	if (update->flags & (UPDATE_INCREMENTAL | UPDATE_HYBRID)) {
 		changeset_clear(&update->change);
@@ -1000,13 +1115,22 @@ int zone_update_commit(conf_t *conf, zone_update_t *update)
 		clear_ctx->cleanup_apply = update->a_ctx;
 		clear_ctx->new_cont_size = update->new_cont->size;
 
-		call_rcu((struct rcu_head *)clear_ctx, update_clear);
+		knot_reclaim_defer(global_reclaim, update_clear, clear_ctx);
 	} else {
 		log_zone_error(update->zone->name, "failed to deallocate unused memory");
 	}
 
 	zone_local_notify(update->zone);
 
+	if (update->flags & UPDATE_INCREMENTAL) {
+		struct timespec t_end = time_now();
+		log_zone_debug(update->zone->name, "update committed, changes %.02f ms, "
+		               "adjusting %.02f ms, committing %.02f ms",
+		               time_diff_ms(&update->started, &t_adjust),
+		               time_diff_ms(&t_adjust, &t_commit),
+		               time_diff_ms(&t_commit, &t_end));
+	}
+
 	/* Sync zonefile immediately if configured. */
 	val = conf_zone_get(conf, C_ZONEFILE_SYNC, update->zone->name);
 	if (conf_int(&val) == 0) {
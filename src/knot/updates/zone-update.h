@@ -21,6 +21,7 @@
 #include "knot/updates/changesets.h"
 #include "knot/zone/contents.h"
 #include "knot/zone/zone.h"
+#include "contrib/time.h"
 
 typedef struct {
 	knot_dname_storage_t next;
@@ -40,6 +41,9 @@ typedef struct zone_update {
 	apply_ctx_t *a_ctx;          /*!< Context for applying changesets. */
 	uint32_t flags;              /*!< Zone update flags. */
 	dnssec_validation_hint_t validation_hint;
+	struct timespec started;     /*!< Initialization time, for commit profiling. */
+	struct resign_index *resign_delta; /*!< RRSIG expirations noted by signing. */
+	xfr_perf_t *xfr_perf;        /*!< Incoming transfer statistics of the phases, or NULL. */
 } zone_update_t;
 
 typedef struct {
@@ -279,6 +283,18 @@ int zone_update_semcheck(conf_t *conf, zone_update_t *update);
  */
 int zone_update_verify_digest(conf_t *conf, zone_update_t *update);
 
+/*!
+ * \brief Semantic check with ZONEMD verification running concurrently.
+ *
+ * Same as zone_update_semcheck() followed by zone_update_verify_digest().
+ *
+ * \param conf       Configuration.
+ * \param update     Zone update.
+ *
+ * \return KNOT_E*
+ */
+int zone_update_semcheck_verify(conf_t *conf, zone_update_t *update);
+
 /*!
  * \brief Commits all changes to the zone, signs it, saves changes to journal.
  *
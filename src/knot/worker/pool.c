@@ -21,9 +21,44 @@
 #include <string.h>
 
 #include "libknot/libknot.h"
+#include "contrib/atomic.h"
+#include "contrib/spinlock.h"
 #include "knot/server/dthreads.h"
 #include "knot/worker/pool.h"
 
+/*!
+ * \brief Number of times a ready class may be passed over by more urgent ones.
+ */
+#define WORKER_AGING 8
+
+/*!
+ * \brief Capacity of a worker's own task queue, overflowing tasks go global.
+ */
+#define WORKER_DEQUE_SIZE 256
+
+/*!
+ * \brief Tasks of one priority class.
+ */
+typedef struct {
+	worker_queue_t tasks;
+	unsigned running;	/*!< Number of running tasks of the class. */
+	unsigned limit;		/*!< Maximum running tasks, 0 if unlimited. */
+	unsigned skipped;	/*!< Dequeues from other classes while ready. */
+} worker_class_queue_t;
+
+/*!
+ * \brief Tasks assigned by a worker thread itself.
+ *
+ * The owner pushes and pops at the tail, idle workers steal from the head.
+ */
+typedef struct {
+	knot_spin_t lock;
+	worker_pool_t *pool;
+	unsigned head;
+	unsigned tail;
+	worker_task_t *tasks[WORKER_DEQUE_SIZE];
+} worker_slot_t;
+
 /*!
  * \brief Worker pool state.
  */
@@ -33,17 +68,138 @@ struct worker_pool {
 	pthread_mutex_t lock;
 	pthread_cond_t wake;
 
-	bool terminating;	/*!< Is the pool terminating? .*/
-	bool suspended;		/*!< Is execution temporarily suspended? .*/
+	knot_atomic_bool terminating;	/*!< Is the pool terminating? .*/
+	knot_atomic_bool suspended;	/*!< Is execution temporarily suspended? .*/
 	int running;		/*!< Number of running threads. */
-	worker_queue_t tasks;
+	worker_class_queue_t classes[WORKER_CLASS_COUNT];	/*!< Global queues. */
+	worker_slot_t *slots;	/*!< Per-thread queues. */
+	unsigned nslots;
 };
 
+/*! \brief Queue of the current worker thread, NULL outside of a worker. */
+static __thread worker_slot_t *local_slot = NULL;
+
+static unsigned slot_length(worker_slot_t *slot)
+{
+	knot_spin_lock(&slot->lock);
+	unsigned len = slot->tail - slot->head;
+	knot_spin_unlock(&slot->lock);
+	return len;
+}
+
+static bool slot_push(worker_slot_t *slot, worker_task_t *task)
+{
+	bool pushed = false;
+	knot_spin_lock(&slot->lock);
+	if (slot->tail - slot->head < WORKER_DEQUE_SIZE) {
+		slot->tasks[slot->tail++ % WORKER_DEQUE_SIZE] = task;
+		pushed = true;
+	}
+	knot_spin_unlock(&slot->lock);
+	return pushed;
+}
+
+static worker_task_t *slot_pop(worker_slot_t *slot)
+{
+	worker_task_t *task = NULL;
+	knot_spin_lock(&slot->lock);
+	if (slot->tail != slot->head) {
+		task = slot->tasks[--slot->tail % WORKER_DEQUE_SIZE];
+	}
+	knot_spin_unlock(&slot->lock);
+	return task;
+}
+
+static worker_task_t *slot_steal(worker_slot_t *slot)
+{
+	worker_task_t *task = NULL;
+	knot_spin_lock(&slot->lock);
+	if (slot->tail != slot->head) {
+		task = slot->tasks[slot->head++ % WORKER_DEQUE_SIZE];
+	}
+	knot_spin_unlock(&slot->lock);
+	return task;
+}
+
+/*!
+ * \brief Take the oldest task of any worker's queue, starting with the own one.
+ */
+static worker_task_t *pool_steal(worker_pool_t *pool, unsigned self)
+{
+	for (unsigned i = 0; i < pool->nslots; i++) {
+		worker_task_t *task = slot_steal(&pool->slots[(self + i) % pool->nslots]);
+		if (task != NULL) {
+			return task;
+		}
+	}
+	return NULL;
+}
+
+static bool class_ready(const worker_class_queue_t *cq)
+{
+	return !EMPTY_LIST(cq->tasks.list) && (cq->limit == 0 || cq->running < cq->limit);
+}
+
+static bool pool_empty(worker_pool_t *pool)
+{
+	for (int i = 0; i < WORKER_CLASS_COUNT; i++) {
+		if (!EMPTY_LIST(pool->classes[i].tasks.list)) {
+			return false;
+		}
+	}
+	for (unsigned i = 0; i < pool->nslots; i++) {
+		if (slot_length(&pool->slots[i]) > 0) {
+			return false;
+		}
+	}
+	return true;
+}
+
+/*!
+ * \brief Take a task from the most urgent class below its limit.
+ *
+ * A class passed over WORKER_AGING times takes precedence, so that less
+ * urgent classes don't starve under a constant load.
+ */
+static worker_task_t *pool_dequeue(worker_pool_t *pool, worker_class_t *cls)
+{
+	int pick = -1;
+	for (int i = 0; i < WORKER_CLASS_COUNT; i++) {
+		if (!class_ready(&pool->classes[i])) {
+			continue;
+		}
+		if (pick < 0) {
+			pick = i;
+		} else if (pool->classes[i].skipped >= WORKER_AGING) {
+			pick = i;
+			break;
+		}
+	}
+	if (pick < 0) {
+		return NULL;
+	}
+
+	for (int i = 0; i < WORKER_CLASS_COUNT; i++) {
+		if (i != pick && class_ready(&pool->classes[i])) {
+			pool->classes[i].skipped++;
+		}
+	}
+
+	worker_class_queue_t *cq = &pool->classes[pick];
+	cq->skipped = 0;
+	cq->running++;
+	*cls = pick;
+
+	return worker_queue_dequeue(&cq->tasks);
+}
+
 /*!
  * \brief Worker thread.
  *
- * The thread takes a task from the tasks queue and runs it, while checking
- * if the dispatching of new tasks is allowed by the thread pool.
+ * The thread takes a task from the global queues, or steals one from another
+ * worker, and runs it. Then it runs the tasks it assigned to itself meanwhile,
+ * without touching the pool lock, while checking if the dispatching of new
+ * tasks is allowed by the thread pool.
  *
  * An execution of a running thread cannot be enforced.
  *
@@ -53,17 +209,28 @@ static int worker_main(dthread_t *thread)
 	assert(thread);
 
 	worker_pool_t *pool = thread->data;
+	unsigned self = dt_get_id(thread);
+	assert(self < pool->nslots);
+	worker_slot_t *slot = &pool->slots[self];
+	local_slot = slot;
 
 	pthread_mutex_lock(&pool->lock);
 
 	for (;;) {
-		if (pool->terminating) {
+		if (ATOMIC_GET(pool->terminating)) {
 			break;
 		}
 
 		worker_task_t *task = NULL;
-		if (!pool->suspended) {
-			task = worker_queue_dequeue(&pool->tasks);
+		int cls = -1; // Stolen tasks aren't accounted in classes.
+		if (!ATOMIC_GET(pool->suspended)) {
+			worker_class_t global_cls;
+			task = pool_dequeue(pool, &global_cls);
+			if (task != NULL) {
+				cls = global_cls;
+			} else {
+				task = pool_steal(pool, self);
+			}
 		}
 
 		if (task == NULL) {
@@ -71,19 +238,27 @@ static int worker_main(dthread_t *thread)
 			continue;
 		}
 
-		assert(task->run);
 		pool->running += 1;
-
 		pthread_mutex_unlock(&pool->lock);
-		task->run(task);
-		pthread_mutex_lock(&pool->lock);
 
+		do {
+			assert(task->run);
+			task->run(task);
+		} while (!ATOMIC_GET(pool->suspended) && !ATOMIC_GET(pool->terminating) &&
+		         (task = slot_pop(slot)) != NULL);
+
+		pthread_mutex_lock(&pool->lock);
 		pool->running -= 1;
+		if (cls >= 0) {
+			pool->classes[cls].running -= 1;
+		}
 		pthread_cond_broadcast(&pool->wake);
 	}
 
 	pthread_mutex_unlock(&pool->lock);
 
+	local_slot = NULL;
+
 	return KNOT_EOK;
 }
 
@@ -97,6 +272,18 @@ worker_pool_t *worker_pool_create(unsigned threads)
 	}
 
 	memset(pool, 0, sizeof(worker_pool_t));
+	ATOMIC_INIT(pool->terminating, false);
+	ATOMIC_INIT(pool->suspended, false);
+	pool->slots = calloc(threads, sizeof(*pool->slots));
+	if (pool->slots == NULL) {
+		goto fail;
+	}
+	pool->nslots = threads;
+	for (unsigned i = 0; i < threads; i++) {
+		knot_spin_init(&pool->slots[i].lock);
+		pool->slots[i].pool = pool;
+	}
+
 	pool->threads = dt_create(threads, worker_main, NULL, pool);
 	if (pool->threads == NULL) {
 		goto fail;
@@ -110,12 +297,18 @@ worker_pool_t *worker_pool_create(unsigned threads)
 		goto fail;
 	}
 
-	worker_queue_init(&pool->tasks);
+	for (int i = 0; i < WORKER_CLASS_COUNT; i++) {
+		worker_queue_init(&pool->classes[i].tasks);
+	}
 
 	return pool;
 
 fail:
 	dt_delete(&pool->threads);
+	for (unsigned i = 0; i < pool->nslots; i++) {
+		knot_spin_destroy(&pool->slots[i].lock);
+	}
+	free(pool->slots);
 	free(pool);
 	return NULL;
 }
@@ -131,8 +324,17 @@ void worker_pool_destroy(worker_pool_t *pool)
 	pthread_mutex_destroy(&pool->lock);
 	pthread_cond_destroy(&pool->wake);
 
-	worker_queue_deinit(&pool->tasks);
+	for (int i = 0; i < WORKER_CLASS_COUNT; i++) {
+		worker_queue_deinit(&pool->classes[i].tasks);
+	}
+
+	for (unsigned i = 0; i < pool->nslots; i++) {
+		knot_spin_destroy(&pool->slots[i].lock);
+	}
+	free(pool->slots);
 
+	ATOMIC_DEINIT(pool->terminating);
+	ATOMIC_DEINIT(pool->suspended);
 	free(pool);
 }
 
@@ -152,7 +354,7 @@ void worker_pool_stop(worker_pool_t *pool)
 	}
 
 	pthread_mutex_lock(&pool->lock);
-	pool->terminating = true;
+	ATOMIC_SET(pool->terminating, true);
 	pthread_cond_broadcast(&pool->wake);
 	pthread_mutex_unlock(&pool->lock);
 
@@ -166,7 +368,7 @@ void worker_pool_suspend(worker_pool_t *pool)
 	}
 
 	pthread_mutex_lock(&pool->lock);
-	pool->suspended = true;
+	ATOMIC_SET(pool->suspended, true);
 	pthread_mutex_unlock(&pool->lock);
 }
 
@@ -177,7 +379,7 @@ void worker_pool_resume(worker_pool_t *pool)
 	}
 
 	pthread_mutex_lock(&pool->lock);
-	pool->suspended = false;
+	ATOMIC_SET(pool->suspended, false);
 	pthread_cond_broadcast(&pool->wake);
 	pthread_mutex_unlock(&pool->lock);
 }
@@ -198,7 +400,7 @@ void worker_pool_wait_cb(worker_pool_t *pool, wait_callback_t cb)
 	}
 
 	pthread_mutex_lock(&pool->lock);
-	while (!EMPTY_LIST(pool->tasks.list) || pool->running > 0) {
+	while (!pool_empty(pool) || pool->running > 0) {
 		if (cb != NULL) {
 			cb(pool);
 		}
@@ -218,12 +420,33 @@ void worker_pool_assign(worker_pool_t *pool, struct task *task)
 		return;
 	}
 
+	assert(task->cls < WORKER_CLASS_COUNT);
+
+	// A worker keeps its own urgent follow-ups, idle workers may steal them.
+	if (local_slot != NULL && local_slot->pool == pool &&
+	    task->cls == WORKER_CLASS_URGENT && slot_push(local_slot, task)) {
+		pthread_cond_signal(&pool->wake);
+		return;
+	}
+
 	pthread_mutex_lock(&pool->lock);
-	worker_queue_enqueue(&pool->tasks, task);
+	worker_queue_enqueue(&pool->classes[task->cls].tasks, task);
 	pthread_cond_signal(&pool->wake);
 	pthread_mutex_unlock(&pool->lock);
 }
 
+void worker_pool_set_limit(worker_pool_t *pool, worker_class_t cls, unsigned limit)
+{
+	if (!pool || cls >= WORKER_CLASS_COUNT || cls == WORKER_CLASS_URGENT) {
+		return;
+	}
+
+	pthread_mutex_lock(&pool->lock);
+	pool->classes[cls].limit = limit;
+	pthread_cond_broadcast(&pool->wake);
+	pthread_mutex_unlock(&pool->lock);
+}
+
 void worker_pool_clear(worker_pool_t *pool)
 {
 	if (!pool) {
@@ -231,8 +454,29 @@ void worker_pool_clear(worker_pool_t *pool)
 	}
 
 	pthread_mutex_lock(&pool->lock);
-	worker_queue_deinit(&pool->tasks);
-	worker_queue_init(&pool->tasks);
+	for (int i = 0; i < WORKER_CLASS_COUNT; i++) {
+		worker_queue_deinit(&pool->classes[i].tasks);
+		worker_queue_init(&pool->classes[i].tasks);
+	}
+	for (unsigned i = 0; i < pool->nslots; i++) {
+		worker_slot_t *slot = &pool->slots[i];
+		knot_spin_lock(&slot->lock);
+		slot->head = slot->tail;
+		knot_spin_unlock(&slot->lock);
+	}
+	pthread_mutex_unlock(&pool->lock);
+}
+
+void worker_pool_sort(worker_pool_t *pool, task_weight_cb weight)
+{
+	if (!pool) {
+		return;
+	}
+
+	pthread_mutex_lock(&pool->lock);
+	for (int i = 0; i < WORKER_CLASS_COUNT; i++) {
+		worker_queue_sort(&pool->classes[i].tasks, weight);
+	}
 	pthread_mutex_unlock(&pool->lock);
 }
 
@@ -247,8 +491,32 @@ void worker_pool_status(worker_pool_t *pool, bool locked, int *running, int *que
 		pthread_mutex_lock(&pool->lock);
 	}
 	*running = pool->running;
-	*queued = worker_queue_length(&pool->tasks);
+	*queued = 0;
+	for (int i = 0; i < WORKER_CLASS_COUNT; i++) {
+		*queued += worker_queue_length(&pool->classes[i].tasks);
+	}
+	for (unsigned i = 0; i < pool->nslots; i++) {
+		*queued += slot_length(&pool->slots[i]);
+	}
 	if (!locked) {
 		pthread_mutex_unlock(&pool->lock);
 	}
 }
+
+unsigned worker_pool_size(worker_pool_t *pool)
+{
+	return (pool != NULL) ? pool->nslots : 0;
+}
+
+void worker_pool_thread_status(worker_pool_t *pool, unsigned thread,
+                               unsigned *queued, uint64_t *cpu_time)
+{
+	if (pool == NULL || thread >= pool->nslots) {
+		*queued = 0;
+		*cpu_time = 0;
+		return;
+	}
+
+	*queued = slot_length(&pool->slots[thread]);
+	*cpu_time = dt_cpu_time(pool->threads->threads[thread]);
+}
@@ -17,6 +17,7 @@
 #pragma once
 
 #include <stdbool.h>
+#include <stdint.h>
 
 #include "knot/worker/queue.h"
 
@@ -77,9 +78,29 @@ void worker_pool_wait_cb(worker_pool_t *pool, wait_callback_t cb);
 
 /*!
  * \brief Assign a task to be performed by a worker in the pool.
+ *
+ * Urgent tasks assigned by a worker of the pool are kept in its own queue,
+ * to be run by the same worker unless stolen by an idle one. Other tasks
+ * are queued globally.
  */
 void worker_pool_assign(worker_pool_t *pool, struct task *task);
 
+/*!
+ * \brief Limit the number of workers concurrently running tasks of a class.
+ *
+ * \param pool   Worker pool.
+ * \param cls    Task class.
+ * \param limit  Maximum number of running tasks of the class, 0 for no limit.
+ *
+ * \note The urgent class can't be limited.
+ */
+void worker_pool_set_limit(worker_pool_t *pool, worker_class_t cls, unsigned limit);
+
+/*!
+ * \brief Reorder tasks enqueued in pool processing queue by descending weight.
+ */
+void worker_pool_sort(worker_pool_t *pool, task_weight_cb weight);
+
 /*!
  * \brief Clear all tasks enqueued in pool processing queue.
  */
@@ -91,3 +112,19 @@ void worker_pool_clear(worker_pool_t *pool);
  * \note Locked means if the mutex `pool->lock` is locked.
  */
 void worker_pool_status(worker_pool_t *pool, bool locked, int *running, int *queued);
+
+/*!
+ * \brief Get the number of worker threads.
+ */
+unsigned worker_pool_size(worker_pool_t *pool);
+
+/*!
+ * \brief Obtain the state of one worker thread.
+ *
+ * \param pool      Worker pool.
+ * \param thread    Worker index (below worker_pool_size()).
+ * \param queued    Output: number of tasks in the worker's own queue.
+ * \param cpu_time  Output: CPU time of the worker in microseconds.
+ */
+void worker_pool_thread_status(worker_pool_t *pool, unsigned thread,
+                               unsigned *queued, uint64_t *cpu_time);
@@ -14,6 +14,8 @@
     along with this program.  If not, see <https://www.gnu.org/licenses/>.
  */
 
+#include <stdlib.h>
+
 #include "knot/worker/queue.h"
 #include "contrib/mempattern.h"
 
@@ -61,6 +63,56 @@ worker_task_t *worker_queue_dequeue(worker_queue_t *queue)
 	return task;
 }
 
+typedef struct {
+	uint64_t weight;
+	size_t order;
+	ptrnode_t *node;
+} sort_item_t;
+
+static int sort_cmp(const void *a, const void *b)
+{
+	const sort_item_t *item_a = a, *item_b = b;
+	if (item_a->weight != item_b->weight) {
+		return item_a->weight > item_b->weight ? -1 : 1;
+	}
+	return item_a->order < item_b->order ? -1 : 1;
+}
+
+void worker_queue_sort(worker_queue_t *queue, task_weight_cb weight)
+{
+	if (!queue || !weight) {
+		return;
+	}
+
+	size_t count = list_size(&queue->list);
+	if (count < 2) {
+		return;
+	}
+
+	sort_item_t *items = malloc(count * sizeof(*items));
+	if (items == NULL) {
+		return; // Keep the original order.
+	}
+
+	size_t i = 0;
+	ptrnode_t *node;
+	WALK_LIST(node, queue->list) {
+		items[i].weight = weight((worker_task_t *)node->d);
+		items[i].order = i;
+		items[i].node = node;
+		i++;
+	}
+
+	qsort(items, count, sizeof(*items), sort_cmp);
+
+	init_list(&queue->list);
+	for (i = 0; i < count; i++) {
+		add_tail(&queue->list, &items[i].node->n);
+	}
+
+	free(items);
+}
+
 size_t worker_queue_length(worker_queue_t *queue)
 {
 	return queue ? list_size(&queue->list) : 0;
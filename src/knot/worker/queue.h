@@ -16,19 +16,37 @@
 
 #pragma once
 
+#include <stdint.h>
+
 #include "contrib/ucw/lists.h"
 
 struct task;
 typedef void (*task_cb)(struct task *);
 
+/*!
+ * \brief Task priority classes, in the order of precedence.
+ */
+typedef enum {
+	WORKER_CLASS_URGENT = 0, /*!< Short and latency sensitive tasks. */
+	WORKER_CLASS_NORMAL,     /*!< Housekeeping tasks. */
+	WORKER_CLASS_HEAVY,      /*!< Long running tasks (loads, signing). */
+	WORKER_CLASS_COUNT
+} worker_class_t;
+
 /*!
  * \brief Task executable by a worker.
  */
 typedef struct task {
 	void *ctx;
 	task_cb run;
+	worker_class_t cls; /*!< Priority class, set before each assignment. */
 } worker_task_t;
 
+/*!
+ * \brief Task weight used for ordering of the queue.
+ */
+typedef uint64_t (*task_weight_cb)(worker_task_t *);
+
 /*!
  * \brief Worker queue.
  */
@@ -59,6 +77,13 @@ void worker_queue_enqueue(worker_queue_t *queue, worker_task_t *task);
  */
 worker_task_t *worker_queue_dequeue(worker_queue_t *queue);
 
+/*!
+ * \brief Reorder the queue by descending task weight.
+ *
+ * \note Tasks of equal weight keep their mutual order.
+ */
+void worker_queue_sort(worker_queue_t *queue, task_weight_cb weight);
+
 /*!
  * \brief Return number of tasks in worker queue.
  */
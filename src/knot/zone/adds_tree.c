@@ -29,6 +29,7 @@ knot_dynarray_define(nodeptr, zone_node_t *, DYNARRAY_VISIBILITY_STATIC)
 typedef struct {
 	nodeptr_dynarray_t array;
 	bool deduplicated;
+	bool lazy; // all referring nodes look the name up at answer time
 } a_t_node_t;
 
 static int free_a_t_node(trie_val_t *val, void *null)
@@ -54,7 +55,7 @@ int zone_node_additionals_foreach(const zone_node_t *node, const knot_dname_t *z
 	int ret = KNOT_EOK;
 	for (int i = 0; ret == KNOT_EOK && i < node->rrset_count; i++) {
 		struct rr_data *rr_data = &node->rrs[i];
-		if (!knot_rrtype_additional_needed(rr_data->type)) {
+		if (!node_rrtype_linked(rr_data->type)) {
 			continue;
 		}
 		knot_rdata_t *rdata = knot_rdataset_at(&rr_data->rrs, 0);
@@ -217,16 +218,55 @@ int additionals_tree_update_from_binodes(additionals_tree_t *a_t, const zone_tre
 	return ret;
 }
 
-static int reverse_apply_nodes(a_t_node_t *nodes, node_apply_cb_t cb, void *ctx)
+static void dedup_a_t_node(a_t_node_t *nodes)
 {
-	if (nodes == NULL) {
-		return KNOT_EOK;
-	}
-
 	if (!nodes->deduplicated) {
 		nodeptr_dynarray_sort_dedup(&nodes->array);
 		nodes->deduplicated = true;
 	}
+}
+
+static int mark_lazy_a_t_node(trie_val_t *val, void *ctx)
+{
+	size_t *min_refs = ctx;
+	a_t_node_t *nodes = *(a_t_node_t **)val;
+	if (nodes != NULL) {
+		dedup_a_t_node(nodes);
+		nodes->lazy = (nodes->array.size >= *min_refs);
+	}
+	return 0;
+}
+
+int additionals_tree_mark_lazy(additionals_tree_t *a_t, size_t min_refs)
+{
+	if (a_t == NULL) {
+		return KNOT_EINVAL;
+	}
+
+	return trie_apply(a_t, mark_lazy_a_t_node, &min_refs);
+}
+
+bool additionals_tree_lazy(additionals_tree_t *a_t, const knot_dname_t *name)
+{
+	if (a_t == NULL) {
+		return false;
+	}
+
+	knot_dname_storage_t lf_storage;
+	uint8_t *lf = knot_dname_lf(name, lf_storage);
+
+	trie_val_t *val = trie_get_try(a_t, lf + 1, *lf);
+	return val != NULL && *val != NULL && (*(a_t_node_t **)val)->lazy;
+}
+
+static int reverse_apply_nodes(a_t_node_t *nodes, node_apply_cb_t cb, void *ctx)
+{
+	// Lazily resolved glue doesn't point to the name's node.
+	if (nodes == NULL || nodes->lazy) {
+		return KNOT_EOK;
+	}
+
+	dedup_a_t_node(nodes);
 
 	knot_dynarray_foreach(nodeptr, zone_node_t *, node_in_arr, nodes->array) {
 		int ret = cb(*node_in_arr, ctx);
@@ -301,13 +341,16 @@ static int reverse_apply_subtree(additionals_tree_t *a_t, const knot_dname_t *na
 }
 
 int additionals_reverse_apply_multi(additionals_tree_t *a_t, const zone_tree_t *tree,
-                                    node_apply_cb_t cb, void *ctx)
+                                    bool dirty_only, node_apply_cb_t cb, void *ctx)
 {
 	zone_tree_it_t it = { 0 };
 	int ret = zone_tree_it_begin((zone_tree_t *)tree, &it);
 	while (!zone_tree_it_finished(&it) && ret == KNOT_EOK) {
-		const knot_dname_t *owner = zone_tree_it_val(&it)->owner;
-		if (knot_dname_is_wildcard(owner)) {
+		zone_node_t *node = zone_tree_it_val(&it);
+		const knot_dname_t *owner = node->owner;
+		if (dirty_only && binode_referral_unchanged(node)) {
+			// referring nodes keep pointing to the same bi-node
+		} else if (knot_dname_is_wildcard(owner)) {
 			// this skips the subtree root, but includes the wildcard node itself as it's part of the subtree
 			ret = reverse_apply_subtree(a_t, owner + 2 /* strip wildcard label */, cb, ctx);
 		} else {
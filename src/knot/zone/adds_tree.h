@@ -22,6 +22,9 @@
 
 typedef trie_t additionals_tree_t;
 
+/*! \brief Minimal number of nodes referring to a name for its glue to be resolved lazily. */
+#define ADDITIONALS_LAZY_MIN_REFS 1000
+
 inline static additionals_tree_t *additionals_tree_new(void) { return trie_create(NULL); }
 void additionals_tree_free(additionals_tree_t *a_t);
 
@@ -89,9 +92,33 @@ int additionals_tree_from_zone(additionals_tree_t **a_t, const zone_contents_t *
 int additionals_tree_update_from_binodes(additionals_tree_t *a_t, const zone_tree_t *tree,
                                          const zone_contents_t *zone);
 
+/*!
+ * \brief Mark names referred to by many nodes for lazy glue resolution.
+ *
+ * The glue to marked names is looked up at answer time instead of pointing
+ * to the name's node, so that changes of such names don't need re-adjusting
+ * all the referring nodes. The marks are lost if the name isn't referred
+ * to anymore.
+ *
+ * \note Only to be called before (re-)adjusting additionals of all nodes.
+ *
+ * \param a_t        Additionals tree.
+ * \param min_refs   Minimal number of referring nodes.
+ *
+ * \return KNOT_E*
+ */
+int additionals_tree_mark_lazy(additionals_tree_t *a_t, size_t min_refs);
+
+/*!
+ * \brief Return true if the glue to the name is to be resolved lazily.
+ */
+bool additionals_tree_lazy(additionals_tree_t *a_t, const knot_dname_t *name);
+
 /*!
  * \brief Foreach node that has specified name in its additionals, do sth.
  *
+ * Nodes referring to a name marked for lazy glue resolution are skipped.
+ *
  * \note The node passed to the callback might not be correct part of bi-node!
  *
  * \param a_t    Additionals reverse tree.
@@ -108,13 +135,14 @@ int additionals_reverse_apply(additionals_tree_t *a_t, const knot_dname_t *name,
 /*!
  * \brief Call additionals_reverse_apply() for every name in specified tree.
  *
- * \param a_t    Additionals reverse tree.
- * \param tree   Zone tree with names to be looked up in additionals.
- * \param cb     Callback to be called for each affected node.
- * \param ctx    Arbitrary context for the callback.
+ * \param a_t          Additionals reverse tree.
+ * \param tree         Zone tree with names to be looked up in additionals.
+ * \param dirty_only   Skip bi-nodes whose existence and delegation flags didn't change.
+ * \param cb           Callback to be called for each affected node.
+ * \param ctx          Arbitrary context for the callback.
  *
  * \return KNOT_E*
  */
 int additionals_reverse_apply_multi(additionals_tree_t *a_t, const zone_tree_t *tree,
-                                    node_apply_cb_t cb, void *ctx);
+                                    bool dirty_only, node_apply_cb_t cb, void *ctx);
 
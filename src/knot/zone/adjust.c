@@ -68,7 +68,15 @@ int adjust_cb_flags(zone_node_t *node, adjust_ctx_t *ctx)
 		node_set_flag_hierarch(node, NODE_FLAGS_SUBTREE_DATA);
 	}
 
-	if (node->flags != flags_orig && ctx->changed_nodes != NULL) {
+	zone_node_t *zone_cut_orig = node->zone_cut;
+	if (node->flags & NODE_FLAGS_NONAUTH) {
+		node->zone_cut = (parent->flags & NODE_FLAGS_DELEG) ? parent : node_zone_cut(parent);
+	} else {
+		node->zone_cut = NULL;
+	}
+
+	if ((node->flags != flags_orig || node->zone_cut != zone_cut_orig) &&
+	    ctx->changed_nodes != NULL) {
 		return zone_tree_insert(ctx->changed_nodes, &node);
 	}
 
@@ -186,6 +194,37 @@ int adjust_cb_nsec3_pointer(zone_node_t *node, adjust_ctx_t *ctx)
 	return ret;
 }
 
+/*! \brief Store new additionals of the RRSet if they differ from the current ones. */
+static int store_additional(zone_node_t *adjn, uint16_t rr_at, additional_t *new_addit,
+                            adjust_ctx_t *ctx)
+{
+	struct rr_data *rr_data = &adjn->rrs[rr_at];
+
+	/* If the result differs, shallow copy node and store additionals. */
+	if (!additional_equal(rr_data->additional, new_addit)) {
+		if (ctx->changed_nodes != NULL) {
+			zone_tree_insert(ctx->changed_nodes, &adjn);
+		}
+
+		if (!binode_additional_shared(adjn, adjn->rrs[rr_at].type)) {
+			// this happens when additionals are adjusted twice during one update, e.g. IXFR-from-diff
+			additional_clear(adjn->rrs[rr_at].additional);
+		}
+
+		int ret = binode_prepare_change(adjn, NULL);
+		if (ret != KNOT_EOK) {
+			return ret;
+		}
+		rr_data = &adjn->rrs[rr_at];
+
+		rr_data->additional = new_addit;
+	} else {
+		additional_clear(new_addit);
+	}
+
+	return KNOT_EOK;
+}
+
 /*! \brief Link pointers to additional nodes for this RRSet. */
 static int discover_additionals(zone_node_t *adjn, uint16_t rr_at,
                                 adjust_ctx_t *ctx)
@@ -207,13 +246,23 @@ static int discover_additionals(zone_node_t *adjn, uint16_t rr_at,
 		const knot_dname_t *dname = knot_rdata_name(rdata, rr_data->type);
 		const zone_node_t *node = NULL;
 
-		if (!zone_contents_find_node_or_wildcard(ctx->zone, dname, &node)) {
+		// The lazy glue is kept even for a missing name, which may appear later.
+		bool lazy = additionals_tree_lazy(ctx->zone->adds_tree, dname);
+		bool found;
+		if (rr_data->type == KNOT_RRTYPE_CNAME) {
+			// Wildcard expansion needs the actual name, it's looked up.
+			node = zone_contents_find_node(ctx->zone, dname);
+			found = (node != NULL);
+		} else {
+			found = zone_contents_find_node_or_wildcard(ctx->zone, dname, &node);
+		}
+		if (!found && !lazy) {
 			rdata = knot_rdataset_next(rdata);
 			continue;
 		}
 
 		glue_t *glue;
-		if ((node->flags & (NODE_FLAGS_DELEG | NODE_FLAGS_NONAUTH)) &&
+		if (node != NULL && (node->flags & (NODE_FLAGS_DELEG | NODE_FLAGS_NONAUTH)) &&
 		    rr_data->type == KNOT_RRTYPE_NS &&
 		    knot_dname_in_bailiwick(node->owner, adjn->owner) >= 0) {
 			glue = &mandatory[mandatory_count++];
@@ -222,7 +271,7 @@ static int discover_additionals(zone_node_t *adjn, uint16_t rr_at,
 			glue = &others[others_count++];
 			glue->optional = true;
 		}
-		glue->node = node;
+		glue->node = lazy ? NULL : node;
 		glue->ns_pos = i;
 		rdata = knot_rdataset_next(rdata);
 	}
@@ -231,7 +280,7 @@ static int discover_additionals(zone_node_t *adjn, uint16_t rr_at,
 	size_t total_count = mandatory_count + others_count;
 	additional_t *new_addit = NULL;
 	if (total_count > 0) {
-		new_addit = malloc(sizeof(additional_t));
+		new_addit = calloc(1, sizeof(additional_t));
 		if (new_addit == NULL) {
 			return KNOT_ENOMEM;
 		}
@@ -250,41 +299,58 @@ static int discover_additionals(zone_node_t *adjn, uint16_t rr_at,
 		       size - mandatory_size);
 	}
 
-	/* If the result differs, shallow copy node and store additionals. */
-	if (!additional_equal(rr_data->additional, new_addit)) {
-		if (ctx->changed_nodes != NULL) {
-			zone_tree_insert(ctx->changed_nodes, &adjn);
-		}
+	return store_additional(adjn, rr_at, new_addit, ctx);
+}
 
-		if (!binode_additional_shared(adjn, adjn->rrs[rr_at].type)) {
-			// this happens when additionals are adjusted twice during one update, e.g. IXFR-from-diff
-			additional_clear(adjn->rrs[rr_at].additional);
+/*! \brief Pre-render wire of this RRSet for answering. */
+static int prerender_wire(zone_node_t *adjn, uint16_t rr_at, adjust_ctx_t *ctx)
+{
+	struct rr_data *rr_data = &adjn->rrs[rr_at];
+	additional_t *new_addit = NULL;
+
+	if (ctx->zone->prerender) {
+		knot_rrset_t rrset = node_rrset_at(adjn, rr_at);
+		uint32_t size = rrset.rrs.size + rrset.rrs.count * KNOT_RR_HEADER_SIZE;
+		uint8_t *wire = malloc(size);
+		if (wire == NULL) {
+			return KNOT_ENOMEM;
 		}
 
-		int ret = binode_prepare_change(adjn, NULL);
-		if (ret != KNOT_EOK) {
-			return ret;
+		int ret = knot_rrset_prerender(&rrset, wire, size);
+		if (ret < 0) {
+			free(wire);
+			// Compressible RDATA is written the ordinary way.
+			return (ret == KNOT_ENOTSUP) ? KNOT_EOK : ret;
 		}
-		rr_data = &adjn->rrs[rr_at];
 
-		rr_data->additional = new_addit;
-	} else {
-		additional_clear(new_addit);
+		new_addit = calloc(1, sizeof(additional_t));
+		if (new_addit == NULL) {
+			free(wire);
+			return KNOT_ENOMEM;
+		}
+		new_addit->wire = wire;
+		new_addit->wire_size = ret;
+		new_addit->wire_rdata = rr_data->rrs.rdata;
+	} else if (rr_data->additional == NULL) {
+		return KNOT_EOK;
 	}
 
-	return KNOT_EOK;
+	return store_additional(adjn, rr_at, new_addit, ctx);
 }
 
 int adjust_cb_additionals(zone_node_t *node, adjust_ctx_t *ctx)
 {
-	/* Lookup additional records for specific nodes. */
+	/* Lookup additional records for specific nodes, pre-render the others. */
 	for(uint16_t i = 0; i < node->rrset_count; ++i) {
 		struct rr_data *rr_data = &node->rrs[i];
-		if (knot_rrtype_additional_needed(rr_data->type)) {
-			int ret = discover_additionals(node, i, ctx);
-			if (ret != KNOT_EOK) {
-				return ret;
-			}
+		int ret = KNOT_EOK;
+		if (node_rrtype_linked(rr_data->type)) {
+			ret = discover_additionals(node, i, ctx);
+		} else if (rr_data->type != KNOT_RRTYPE_RRSIG) {
+			ret = prerender_wire(node, i, ctx);
+		}
+		if (ret != KNOT_EOK) {
+			return ret;
 		}
 	}
 	return KNOT_EOK;
@@ -325,6 +391,14 @@ int adjust_cb_void(_unused_ zone_node_t *node, _unused_ adjust_ctx_t *ctx)
 	return KNOT_EOK;
 }
 
+/*! \brief Number of nodes taken from the shared iterator at once. */
+#define ADJUST_BATCH 64
+
+typedef struct {
+	zone_tree_it_t it;
+	pthread_mutex_t mx;
+} adjust_shared_it_t;
+
 typedef struct {
 	zone_node_t *first_node;
 	adjust_ctx_t ctx;
@@ -334,12 +408,10 @@ typedef struct {
 	measure_t *m;
 
 	// just for parallel
-	unsigned threads;
-	unsigned thr_id;
-	size_t i;
+	adjust_shared_it_t *shared;
 	pthread_t thread;
+	int thr_err;
 	int ret;
-	zone_tree_t *tree;
 } zone_adjust_arg_t;
 
 static int adjust_single(zone_node_t *node, void *data)
@@ -349,13 +421,6 @@ static int adjust_single(zone_node_t *node, void *data)
 
 	zone_adjust_arg_t *args = (zone_adjust_arg_t *)data;
 
-	// parallel adjust support
-	if (args->threads > 1) {
-		if (args->i++ % args->threads != args->thr_id) {
-			return KNOT_EOK;
-		}
-	}
-
 	if (args->m != NULL) {
 		knot_measure_node(node, args->m);
 	}
@@ -414,8 +479,26 @@ static int zone_adjust_tree(zone_tree_t *tree, adjust_ctx_t *ctx, adjust_cb_t ad
 static void *adjust_tree_thread(void *ctx)
 {
 	zone_adjust_arg_t *arg = ctx;
+	adjust_shared_it_t *shared = arg->shared;
+
+	// Threads take batches of nodes until the whole tree is processed.
+	zone_node_t *batch[ADJUST_BATCH];
+	while (arg->ret == KNOT_EOK) {
+		size_t count = 0;
+		pthread_mutex_lock(&shared->mx);
+		while (count < ADJUST_BATCH && !zone_tree_it_finished(&shared->it)) {
+			batch[count++] = zone_tree_it_val(&shared->it);
+			zone_tree_it_next(&shared->it);
+		}
+		pthread_mutex_unlock(&shared->mx);
 
-	arg->ret = zone_tree_apply(arg->tree, adjust_single, ctx);
+		if (count == 0) {
+			break;
+		}
+		for (size_t i = 0; i < count && arg->ret == KNOT_EOK; i++) {
+			arg->ret = adjust_single(batch[i], arg);
+		}
+	}
 
 	return NULL;
 }
@@ -427,9 +510,15 @@ static int zone_adjust_tree_parallel(zone_tree_t *tree, adjust_ctx_t *ctx,
 		return KNOT_EOK;
 	}
 
+	adjust_shared_it_t shared = { { 0 } };
+	int ret = zone_tree_it_begin(tree, &shared.it);
+	if (ret != KNOT_EOK) {
+		return ret;
+	}
+	pthread_mutex_init(&shared.mx, NULL);
+
 	zone_adjust_arg_t args[threads];
 	memset(args, 0, sizeof(args));
-	int ret = KNOT_EOK;
 
 	for (unsigned i = 0; i < threads; i++) {
 		args[i].first_node = NULL;
@@ -437,11 +526,8 @@ static int zone_adjust_tree_parallel(zone_tree_t *tree, adjust_ctx_t *ctx,
 		args[i].adjust_cb = adjust_cb;
 		args[i].adjust_prevs = false;
 		args[i].m = NULL;
-		args[i].tree = tree;
-		args[i].threads = threads;
-		args[i].i = 0;
-		args[i].thr_id = i;
-		args[i].ret = -1;
+		args[i].shared = &shared;
+		args[i].ret = KNOT_EOK;
 		if (ctx->changed_nodes != NULL) {
 			args[i].ctx.changed_nodes = zone_tree_create(true);
 			if (args[i].ctx.changed_nodes == NULL) {
@@ -455,19 +541,21 @@ static int zone_adjust_tree_parallel(zone_tree_t *tree, adjust_ctx_t *ctx,
 		for (unsigned i = 0; i < threads; i++) {
 			zone_tree_free(&args[i].ctx.changed_nodes);
 		}
-		return ret;
+		goto cleanup;
 	}
 
 	for (unsigned i = 0; i < threads; i++) {
-		args[i].ret = pthread_create(&args[i].thread, NULL, adjust_tree_thread, &args[i]);
+		args[i].thr_err = pthread_create(&args[i].thread, NULL, adjust_tree_thread, &args[i]);
 	}
 
 	for (unsigned i = 0; i < threads; i++) {
-		if (args[i].ret == 0) {
-			args[i].ret = pthread_join(args[i].thread, NULL);
+		if (args[i].thr_err == 0) {
+			args[i].thr_err = pthread_join(args[i].thread, NULL);
 		}
-		if (args[i].ret != 0) {
-			ret = knot_map_errno_code(args[i].ret);
+		if (args[i].thr_err != 0) {
+			ret = knot_map_errno_code(args[i].thr_err);
+		} else if (args[i].ret != KNOT_EOK) {
+			ret = args[i].ret;
 		}
 		if (ret == KNOT_EOK && ctx->changed_nodes != NULL) {
 			ret = zone_tree_merge(ctx->changed_nodes, args[i].ctx.changed_nodes);
@@ -475,6 +563,10 @@ static int zone_adjust_tree_parallel(zone_tree_t *tree, adjust_ctx_t *ctx,
 		zone_tree_free(&args[i].ctx.changed_nodes);
 	}
 
+cleanup:
+	pthread_mutex_destroy(&shared.mx);
+	zone_tree_it_free(&shared.it);
+
 	return ret;
 }
 
@@ -551,12 +643,23 @@ int zone_adjust_full(zone_contents_t *zone, unsigned threads)
 {
 	int ret = zone_adjust_contents(zone, adjust_cb_flags, adjust_cb_nsec3_flags,
 	                               true, true, 1, NULL);
+	// The lazy glue marks must be known before the additionals are adjusted.
+	if (ret == KNOT_EOK) {
+		additionals_tree_free(zone->adds_tree);
+		zone->adds_tree = NULL;
+		if (zone->lazy_glue) {
+			ret = additionals_tree_from_zone(&zone->adds_tree, zone);
+			if (ret == KNOT_EOK) {
+				ret = additionals_tree_mark_lazy(zone->adds_tree,
+				                                 ADDITIONALS_LAZY_MIN_REFS);
+			}
+		}
+	}
 	if (ret == KNOT_EOK) {
 		ret = zone_adjust_contents(zone, adjust_cb_nsec3_and_additionals, NULL,
 		                           false, false, threads, NULL);
 	}
-	if (ret == KNOT_EOK) {
-		additionals_tree_free(zone->adds_tree);
+	if (ret == KNOT_EOK && zone->adds_tree == NULL) {
 		ret = additionals_tree_from_zone(&zone->adds_tree, zone);
 	}
 	return ret;
@@ -619,6 +722,7 @@ int zone_adjust_incremental_update(zone_update_t *update, unsigned threads)
 		ret = additionals_reverse_apply_multi(
 			update->new_cont->adds_tree,
 			update->a_ctx->node_ptrs,
+			!nsec3change,
 			adjust_additionals_cb,
 			&ctx
 		);
@@ -631,6 +735,7 @@ int zone_adjust_incremental_update(zone_update_t *update, unsigned threads)
 			ret = additionals_reverse_apply_multi(
 				update->new_cont->adds_tree,
 				update->a_ctx->nsec3_ptrs,
+				true,
 				adjust_point_to_nsec3_cb,
 				&ctx
 			);
@@ -0,0 +1,262 @@
+/*  Copyright (C) 2024 CZ.NIC, z.s.p.o. <knot-dns@labs.nic.cz>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+
+#include <pthread.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+
+#include "knot/zone/arena.h"
+
+#define CHUNK_SIZE	(1 << 21) // Equal to the huge page size on common platforms.
+#define MAX_ALLOC	(CHUNK_SIZE / 16) // Larger blocks are malloc'd.
+#define ALIGNMENT	8
+
+typedef struct chunk_hdr {
+	struct chunk_hdr *prev;
+	bool mapped; // Explicit huge page mapping, to be munmap'd.
+} chunk_hdr_t;
+
+#define HDR_SIZE	((sizeof(chunk_hdr_t) + ALIGNMENT - 1) & ~(size_t)(ALIGNMENT - 1))
+
+struct zone_arena {
+	knot_mm_t mm;
+	chunk_hdr_t *chunk;      // Current chunk, starting with the header.
+	size_t used;             // Bytes used in the current chunk.
+	unsigned refs;           // Protected by the registry lock.
+	zone_arena_pages_t pages;
+};
+
+/*! \brief Addresses of all the arena chunks, for ownership lookups. */
+static struct {
+	pthread_rwlock_t lock;
+	uintptr_t *chunks; // Sorted.
+	size_t count;
+	size_t capacity;
+} registry = {
+	.lock = PTHREAD_RWLOCK_INITIALIZER
+};
+
+static int chunk_cmp(const void *a, const void *b)
+{
+	uintptr_t x = *(const uintptr_t *)a, y = *(const uintptr_t *)b;
+	return (x > y) - (x < y);
+}
+
+static size_t registry_pos(uintptr_t chunk)
+{
+	size_t lo = 0, hi = registry.count;
+	while (lo < hi) {
+		size_t mid = lo + (hi - lo) / 2;
+		if (registry.chunks[mid] < chunk) {
+			lo = mid + 1;
+		} else {
+			hi = mid;
+		}
+	}
+	return lo;
+}
+
+static bool registry_add(void *chunk)
+{
+	bool ok = true;
+
+	pthread_rwlock_wrlock(&registry.lock);
+	if (registry.count == registry.capacity) {
+		size_t capacity = registry.capacity == 0 ? 64 : 2 * registry.capacity;
+		uintptr_t *chunks = realloc(registry.chunks, capacity * sizeof(*chunks));
+		if (chunks != NULL) {
+			registry.chunks = chunks;
+			registry.capacity = capacity;
+		} else {
+			ok = false;
+		}
+	}
+	if (ok) {
+		size_t pos = registry_pos((uintptr_t)chunk);
+		memmove(registry.chunks + pos + 1, registry.chunks + pos,
+		        (registry.count - pos) * sizeof(*registry.chunks));
+		registry.chunks[pos] = (uintptr_t)chunk;
+		registry.count++;
+	}
+	pthread_rwlock_unlock(&registry.lock);
+
+	return ok;
+}
+
+static void registry_del_locked(void *chunk)
+{
+	size_t pos = registry_pos((uintptr_t)chunk);
+	if (pos < registry.count && registry.chunks[pos] == (uintptr_t)chunk) {
+		registry.count--;
+		memmove(registry.chunks + pos, registry.chunks + pos + 1,
+		        (registry.count - pos) * sizeof(*registry.chunks));
+	}
+}
+
+static chunk_hdr_t *chunk_new(zone_arena_pages_t pages)
+{
+#if defined(MAP_HUGETLB) && defined(MAP_HUGE_2MB)
+	if (pages == ZONE_ARENA_PAGES_EXPLICIT) {
+		void *chunk = mmap(NULL, CHUNK_SIZE, PROT_READ | PROT_WRITE,
+		                   MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB | MAP_HUGE_2MB,
+		                   -1, 0);
+		if (chunk != MAP_FAILED) {
+			((chunk_hdr_t *)chunk)->mapped = true;
+			return chunk;
+		}
+		// No reserved huge pages available, try the transparent ones.
+	}
+#endif
+
+	void *chunk = NULL;
+	if (posix_memalign(&chunk, CHUNK_SIZE, CHUNK_SIZE) != 0) {
+		return NULL;
+	}
+#ifdef MADV_HUGEPAGE
+	if (pages != ZONE_ARENA_PAGES_DEFAULT) {
+		(void)madvise(chunk, CHUNK_SIZE, MADV_HUGEPAGE);
+	}
+#endif
+	((chunk_hdr_t *)chunk)->mapped = false;
+	return chunk;
+}
+
+static void chunk_free(chunk_hdr_t *chunk)
+{
+	if (chunk->mapped) {
+		munmap(chunk, CHUNK_SIZE);
+	} else {
+		free(chunk);
+	}
+}
+
+static void *arena_alloc(void *ctx, size_t size)
+{
+	zone_arena_t *arena = ctx;
+
+	if (size > MAX_ALLOC) {
+		return malloc(size);
+	}
+	size = size == 0 ? ALIGNMENT : (size + ALIGNMENT - 1) & ~(size_t)(ALIGNMENT - 1);
+
+	if (arena->used + size > CHUNK_SIZE) {
+		chunk_hdr_t *chunk = chunk_new(arena->pages);
+		if (chunk == NULL) {
+			return NULL;
+		}
+		if (!registry_add(chunk)) {
+			chunk_free(chunk);
+			return NULL;
+		}
+		chunk->prev = arena->chunk;
+		arena->chunk = chunk;
+		arena->used = HDR_SIZE;
+	}
+
+	void *ptr = (uint8_t *)arena->chunk + arena->used;
+	arena->used += size;
+	return ptr;
+}
+
+static void arena_free(void *ptr)
+{
+	if (!zone_arena_owns(ptr)) {
+		free(ptr);
+	}
+}
+
+zone_arena_t *zone_arena_new(zone_arena_pages_t pages)
+{
+	zone_arena_t *arena = calloc(1, sizeof(*arena));
+	if (arena == NULL) {
+		return NULL;
+	}
+
+	arena->mm.ctx = arena;
+	arena->mm.alloc = arena_alloc;
+	arena->mm.free = arena_free;
+	arena->used = CHUNK_SIZE;
+	arena->refs = 1;
+	arena->pages = pages;
+
+	return arena;
+}
+
+void zone_arena_ref(zone_arena_t *arena)
+{
+	if (arena == NULL) {
+		return;
+	}
+
+	pthread_rwlock_wrlock(&registry.lock);
+	arena->refs++;
+	pthread_rwlock_unlock(&registry.lock);
+}
+
+void zone_arena_unref(zone_arena_t *arena)
+{
+	if (arena == NULL) {
+		return;
+	}
+
+	pthread_rwlock_wrlock(&registry.lock);
+	if (--arena->refs > 0) {
+		pthread_rwlock_unlock(&registry.lock);
+		return;
+	}
+	for (chunk_hdr_t *chunk = arena->chunk; chunk != NULL; chunk = chunk->prev) {
+		registry_del_locked(chunk);
+	}
+	pthread_rwlock_unlock(&registry.lock);
+
+	chunk_hdr_t *chunk = arena->chunk;
+	while (chunk != NULL) {
+		chunk_hdr_t *prev = chunk->prev;
+		chunk_free(chunk);
+		chunk = prev;
+	}
+	free(arena);
+}
+
+knot_mm_t *zone_arena_mm(zone_arena_t *arena)
+{
+	return &arena->mm;
+}
+
+zone_arena_pages_t zone_arena_pages(const zone_arena_t *arena)
+{
+	return arena == NULL ? ZONE_ARENA_PAGES_DEFAULT : arena->pages;
+}
+
+bool zone_arena_owns(const void *ptr)
+{
+	if (ptr == NULL) {
+		return false;
+	}
+
+	uintptr_t chunk = (uintptr_t)ptr & ~(uintptr_t)(CHUNK_SIZE - 1);
+
+	pthread_rwlock_rdlock(&registry.lock);
+	bool found = registry.count > 0 &&
+	             bsearch(&chunk, registry.chunks, registry.count,
+	                     sizeof(*registry.chunks), chunk_cmp) != NULL;
+	pthread_rwlock_unlock(&registry.lock);
+
+	return found;
+}
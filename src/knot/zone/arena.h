@@ -0,0 +1,80 @@
+/*  Copyright (C) 2024 CZ.NIC, z.s.p.o. <knot-dns@labs.nic.cz>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+
+/*!
+ * \brief Memory arena for zone contents built by a complete load.
+ *
+ * Nodes and RDATA of a loaded zone are carved from large chunks by a bump
+ * allocator. The chunks are released all at once when the last contents
+ * referencing the arena is freed. Individual frees of arena memory are no-ops,
+ * node data replaced by later updates is kept until the arena is dropped.
+ *
+ * The chunks can be backed by huge pages to reduce TLB misses of the lookups
+ * over a big zone, then the zone tree tries are allocated from the arena too.
+ */
+
+#pragma once
+
+#include <stdbool.h>
+
+#include "libknot/mm_ctx.h"
+
+typedef struct zone_arena zone_arena_t;
+
+/*! \brief Kind of memory pages backing the arena chunks. */
+typedef enum {
+	ZONE_ARENA_PAGES_DEFAULT = 0,
+	ZONE_ARENA_PAGES_TRANSPARENT, /*!< Transparent huge pages advised. */
+	ZONE_ARENA_PAGES_EXPLICIT,    /*!< Reserved huge pages, transparent as a fallback. */
+} zone_arena_pages_t;
+
+/*!
+ * \brief Create a new arena with one reference.
+ *
+ * \param pages   Kind of pages backing the arena memory.
+ *
+ * \return Arena or NULL if out of memory.
+ */
+zone_arena_t *zone_arena_new(zone_arena_pages_t pages);
+
+/*!
+ * \brief Take another reference to the arena.
+ */
+void zone_arena_ref(zone_arena_t *arena);
+
+/*!
+ * \brief Drop a reference, the last one frees all the arena memory.
+ */
+void zone_arena_unref(zone_arena_t *arena);
+
+/*!
+ * \brief Get the memory context allocating from the arena.
+ *
+ * \note The allocation isn't thread-safe. Freeing memory not owned by any
+ *       arena through the context falls back to free().
+ */
+knot_mm_t *zone_arena_mm(zone_arena_t *arena);
+
+/*!
+ * \brief Get the kind of pages backing the arena (default if no arena).
+ */
+zone_arena_pages_t zone_arena_pages(const zone_arena_t *arena);
+
+/*!
+ * \brief Check if the memory was allocated from any arena.
+ */
+bool zone_arena_owns(const void *ptr);
@@ -68,7 +68,7 @@ static void _backup_swap(zone_backup_ctx_t *ctx, void **local, void **remote)
 #define MISSING_FROM_BACKUP(request, stored) (((request) ^ (stored)) & (request))
 
 int zone_backup_init(bool restore_mode, knot_backup_params_t filters, bool forced,
-                     const char *backup_dir,
+                     bool incremental, const char *backup_dir,
                      size_t kasp_db_size, size_t timer_db_size, size_t journal_db_size,
                      size_t catalog_db_size, zone_backup_ctx_t **out_ctx)
 {
@@ -87,6 +87,8 @@ int zone_backup_init(bool restore_mode, knot_backup_params_t filters, bool force
 	ctx->in_backup = 0; // Just to be sure.
 	ctx->arch_match = true;
 	ctx->forced = forced;
+	ctx->incremental = incremental;
+	ctx->updating = false;
 	ctx->backup_format = BACKUP_VERSION;
 	ctx->backup_global = false;
 	ctx->readers = 1;
@@ -97,7 +99,7 @@ int zone_backup_init(bool restore_mode, knot_backup_params_t filters, bool force
 	memcpy(ctx->backup_dir, backup_dir, backup_dir_len);
 
 	// Backup directory, lock file, label file.
-	// In restore, set the backup format and available data.
+	// In restore or incremental backup, set the backup format and available data.
 	int ret = backupdir_init(ctx);
 	if (ret != KNOT_EOK) {
 		free(ctx);
@@ -139,6 +141,9 @@ int zone_backup_init(bool restore_mode, knot_backup_params_t filters, bool force
 	(void)snprintf(db_dir, sizeof(db_dir), "%s/catalog", backup_dir);
 	knot_lmdb_init(&ctx->bck_catalog, db_dir, catalog_db_size, 0, NULL);
 
+	(void)snprintf(db_dir, sizeof(db_dir), "%s/state", backup_dir);
+	knot_lmdb_init(&ctx->bck_state, db_dir, timer_db_size, 0, NULL);
+
 	*out_ctx = ctx;
 	return KNOT_EOK;
 }
@@ -157,6 +162,7 @@ int zone_backup_deinit(zone_backup_ctx_t *ctx)
 	pthread_mutex_unlock(&ctx->readers_mutex);
 
 	if (left == 0) {
+		knot_lmdb_deinit(&ctx->bck_state);
 		knot_lmdb_deinit(&ctx->bck_catalog);
 		knot_lmdb_deinit(&ctx->bck_journal);
 		knot_lmdb_deinit(&ctx->bck_timer_db);
@@ -338,7 +344,11 @@ static int backup_zonefile(conf_t *conf, zone_t *zone, zone_backup_ctx_t *ctx)
 		if (ret == KNOT_EOK) {
 			if (can_flush) {
 				if (zone->contents != NULL) {
-					ret = zonefile_write(backup_zf, zone->contents);
+					val = conf_zone_get(conf, C_ZONEFILE_FMT, zone->name);
+					bool binary = (conf_opt(&val) == ZONEFILE_FORMAT_BINARY);
+					val = conf_zone_get(conf, C_ADJUST_THR, zone->name);
+					ret = zonefile_write(backup_zf, zone->contents, binary,
+					                     conf_int(&val));
 				} else {
 					log_zone_notice(zone->name,
 					                "empty zone, skipping a zone file backup");
@@ -442,6 +452,47 @@ static int backup_kaspdb(zone_backup_ctx_t *ctx, conf_t *conf, zone_t *zone,
 	return KNOT_EOK;
 }
 
+static bool backup_state_unchanged(zone_backup_ctx_t *ctx, const knot_dname_t *zone,
+                                   uint32_t serial)
+{
+	if (!ctx->updating || knot_lmdb_open(&ctx->bck_state) != KNOT_EOK) {
+		return false;
+	}
+
+	bool unchanged = false;
+	MDB_val key = knot_lmdb_make_key("N", zone);
+	knot_lmdb_txn_t txn = { 0 };
+	knot_lmdb_begin(&ctx->bck_state, &txn, false);
+	if (knot_lmdb_find(&txn, &key, KNOT_LMDB_EXACT)) {
+		uint32_t stored;
+		unchanged = knot_lmdb_unmake_curval(&txn, "I", &stored) && stored == serial;
+	}
+	knot_lmdb_abort(&txn);
+	free(key.mv_data);
+
+	return unchanged;
+}
+
+static int backup_state_store(zone_backup_ctx_t *ctx, const knot_dname_t *zone,
+                              uint32_t serial)
+{
+	int ret = knot_lmdb_open(&ctx->bck_state);
+	if (ret != KNOT_EOK) {
+		return ret;
+	}
+
+	MDB_val key = knot_lmdb_make_key("N", zone);
+	MDB_val val = knot_lmdb_make_key("I", serial);
+	knot_lmdb_txn_t txn = { 0 };
+	knot_lmdb_begin(&ctx->bck_state, &txn, true);
+	knot_lmdb_insert(&txn, &key, &val);
+	knot_lmdb_commit(&txn);
+	free(key.mv_data);
+	free(val.mv_data);
+
+	return txn.ret;
+}
+
 int zone_backup(conf_t *conf, zone_t *zone)
 {
 	zone_backup_ctx_t *ctx = ATOMIC_GET(zone->backup_ctx);
@@ -451,7 +502,13 @@ int zone_backup(conf_t *conf, zone_t *zone)
 
 	int ret = KNOT_EOK;
 
-	if (ctx->backup_params & BACKUP_PARAM_ZONEFILE) {
+	// In incremental backup, the zone file and journal are kept if the serial
+	// is the same as in the previous backup.
+	bool incremental = ctx->incremental && !ctx->restore_mode && zone->contents != NULL;
+	uint32_t serial = incremental ? zone_contents_serial(zone->contents) : 0;
+	bool unchanged = incremental && backup_state_unchanged(ctx, zone->name, serial);
+
+	if ((ctx->backup_params & BACKUP_PARAM_ZONEFILE) && !unchanged) {
 		ret = backup_zonefile(conf, zone, ctx);
 		if (ret != KNOT_EOK) {
 			LOG_MARK_FAIL("zone file");
@@ -460,14 +517,15 @@ int zone_backup(conf_t *conf, zone_t *zone)
 	}
 
 	if (ctx->backup_params & BACKUP_PARAM_KASPDB) {
-		ret = backup_kaspdb(ctx, conf, zone, kasp_db_backup);
+		ret = backup_kaspdb(ctx, conf, zone, incremental && ctx->updating ?
+		                    kasp_db_backup_changed : kasp_db_backup);
 		if (ret != KNOT_EOK) {
 			// Errors already logged in detail.
 			return ret;
 		}
 	}
 
-	if (ctx->backup_params & BACKUP_PARAM_JOURNAL) {
+	if ((ctx->backup_params & BACKUP_PARAM_JOURNAL) && !unchanged) {
 		knot_lmdb_db_t *j_from = zone_journaldb(zone), *j_to = &ctx->bck_journal;
 		BACKUP_SWAP(ctx, j_from, j_to);
 
@@ -499,6 +557,14 @@ int zone_backup(conf_t *conf, zone_t *zone)
 		}
 	}
 
+	if (incremental && !unchanged) {
+		ret = backup_state_store(ctx, zone->name, serial);
+		if (ret != KNOT_EOK) {
+			LOG_MARK_FAIL("backup state");
+			return ret;
+		}
+	}
+
 	return ret;
 }
 
@@ -73,6 +73,8 @@ typedef struct zone_backup_ctx {
 	node_t n;                           // ability to be put into list_t
 	bool restore_mode;                  // if true, this is not a backup, but restore
 	bool forced;                        // if true, the force flag has been set
+	bool incremental;                   // if true, update a previous backup in place
+	bool updating;                      // a previous backup exists in the directory
 	knot_backup_params_t backup_params; // bit-mapped list of backup components
 	knot_backup_params_t in_backup;     // bit-mapped list of components available in backup
 	bool arch_match;                    // match of the system and the backup architectures
@@ -84,6 +86,7 @@ typedef struct zone_backup_ctx {
 	knot_lmdb_db_t bck_timer_db;        // backup timer DB
 	knot_lmdb_db_t bck_journal;         // backup journal DB
 	knot_lmdb_db_t bck_catalog;         // backup catalog DB
+	knot_lmdb_db_t bck_state;           // backed up zone serials for incremental backup
 	bool failed;                        // true if an error occurred in processing of any zone
 	knot_backup_format_t backup_format; // the backup format version used
 	time_t init_time;                   // time when the current backup operation has started
@@ -98,7 +101,7 @@ typedef struct {
 extern const backup_filter_list_t backup_filters[];
 
 int zone_backup_init(bool restore_mode, knot_backup_params_t filters, bool forced,
-                     const char *backup_dir,
+                     bool incremental, const char *backup_dir,
                      size_t kasp_db_size, size_t timer_db_size, size_t journal_db_size,
                      size_t catalog_db_size, zone_backup_ctx_t **out_ctx);
 
@@ -251,6 +251,22 @@ done:
 	return ret;
 }
 
+static int check_previous_backup(zone_backup_ctx_t *ctx)
+{
+	int ret = get_backup_format(ctx);
+	if (ret != KNOT_EOK) {
+		return ret;
+	}
+	ctx->updating = true;
+
+	// The databases of the previous backup are updated in place.
+	if (!ctx->arch_match && (ctx->backup_params & BACKUP_PARAM_DB)) {
+		return KNOT_ECPUCOMPAT;
+	}
+
+	return KNOT_EOK;
+}
+
 int backupdir_init(zone_backup_ctx_t *ctx)
 {
 	int ret;
@@ -265,7 +281,8 @@ int backupdir_init(zone_backup_ctx_t *ctx)
 			return KNOT_ENOTDIR;
 		}
 	} else {
-		if (ctx->forced) {
+		// Incremental backup never removes the previous backup.
+		if (ctx->forced && !ctx->incremental) {
 			if (stat(ctx->backup_dir, &sb) == 0) {
 				int ret2 = remove_path(ctx->backup_dir, S_ISDIR(sb.st_mode));
 				if (ret2 != KNOT_EOK) {
@@ -299,7 +316,13 @@ int backupdir_init(zone_backup_ctx_t *ctx)
 	} else {
 		get_full_path(ctx, label_file_name, full_path, full_path_size);
 		if (stat(full_path, &sb) == 0) {
-			return KNOT_EEXIST;
+			if (!ctx->incremental) {
+				return KNOT_EEXIST;
+			}
+			ret = check_previous_backup(ctx);
+			if (ret != KNOT_EOK) {
+				return ret;
+			}
 		}
 	}
 
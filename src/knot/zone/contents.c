@@ -23,6 +23,7 @@
 #include "knot/common/log.h"
 #include "knot/dnssec/zone-nsec.h"
 #include "libknot/libknot.h"
+#include "contrib/macros.h"
 #include "contrib/qp-trie/trie.h"
 
 /*!
@@ -86,7 +87,7 @@ static bool find_in_tree(zone_tree_t *tree, const knot_dname_t *name,
 static zone_node_t *node_new_for_contents(const knot_dname_t *owner, const zone_contents_t *contents)
 {
 	assert(contents->nsec3_nodes == NULL || contents->nsec3_nodes->flags == contents->nodes->flags);
-	return node_new_for_tree(owner, contents->nodes, NULL);
+	return node_new_for_tree(owner, contents->nodes, contents->mm);
 }
 
 static zone_node_t *get_node(const zone_contents_t *zone, const knot_dname_t *name)
@@ -126,7 +127,7 @@ static int insert_rr(zone_contents_t *z, const knot_rrset_t *rr, zone_node_t **n
 		}
 	}
 
-	return node_add_rrset(*n, rr, NULL);
+	return node_add_rrset(*n, rr, z->mm);
 }
 
 static int remove_rr(zone_contents_t *z, const knot_rrset_t *rr,
@@ -203,6 +204,34 @@ cleanup:
 	return NULL;
 }
 
+/*! \brief Place the trie on huge pages too, if the arena is backed by them. */
+static int tree_use_arena(zone_contents_t *contents, zone_tree_t *tree)
+{
+	if (zone_arena_pages(contents->arena) == ZONE_ARENA_PAGES_DEFAULT) {
+		return KNOT_EOK;
+	}
+	return zone_tree_use_mm(tree, zone_arena_mm(contents->arena));
+}
+
+int zone_contents_use_arena(zone_contents_t *contents, zone_arena_pages_t pages)
+{
+	if (contents == NULL || contents->arena != NULL) {
+		return KNOT_EINVAL;
+	}
+
+	contents->arena = zone_arena_new(pages);
+	if (contents->arena == NULL) {
+		return KNOT_ENOMEM;
+	}
+	contents->mm = zone_arena_mm(contents->arena);
+
+	int ret = tree_use_arena(contents, contents->nodes);
+	if (ret == KNOT_EOK && contents->nsec3_nodes != NULL) {
+		ret = tree_use_arena(contents, contents->nsec3_nodes);
+	}
+	return ret;
+}
+
 zone_tree_t *zone_contents_tree_for_rr(zone_contents_t *contents, const knot_rrset_t *rr)
 {
 	bool nsec3rel = knot_rrset_is_nsec3rel(rr);
@@ -213,6 +242,10 @@ zone_tree_t *zone_contents_tree_for_rr(zone_contents_t *contents, const knot_rrs
 			return NULL;
 		}
 		contents->nsec3_nodes->flags = contents->nodes->flags;
+		if (tree_use_arena(contents, contents->nsec3_nodes) != KNOT_EOK) {
+			zone_tree_free(&contents->nsec3_nodes);
+			return NULL;
+		}
 	}
 
 	return nsec3rel ? contents->nsec3_nodes : contents->nodes;
@@ -428,6 +461,11 @@ const zone_node_t *zone_contents_find_wildcard_child(const zone_contents_t *cont
 		return NULL;
 	}
 
+	const zone_node_t *child = node_wildcard_child(parent);
+	if (child != NULL) {
+		return child;
+	}
+
 	knot_dname_storage_t wildcard = "\x01""*";
 	knot_dname_to_wire(wildcard + 2, parent->owner, sizeof(wildcard) - 2);
 
@@ -447,6 +485,29 @@ bool zone_contents_find_node_or_wildcard(const zone_contents_t *contents,
 	return (*found != NULL);
 }
 
+const zone_node_t *zone_contents_glue_node(const zone_contents_t *contents,
+                                           const glue_t *glue,
+                                           const knot_rrset_t *rr,
+                                           const zone_node_t *another_zone_node,
+                                           bool *optional)
+{
+	if (glue->node != NULL) {
+		*optional = glue->optional;
+		return glue_node(glue, another_zone_node);
+	}
+
+	const knot_rdata_t *rdata = knot_rdataset_at(&rr->rrs, glue->ns_pos);
+	const zone_node_t *node = NULL;
+	if (!zone_contents_find_node_or_wildcard(contents, knot_rdata_name(rdata, rr->type), &node)) {
+		return NULL;
+	}
+
+	*optional = !((node->flags & (NODE_FLAGS_DELEG | NODE_FLAGS_NONAUTH)) &&
+	              rr->type == KNOT_RRTYPE_NS &&
+	              knot_dname_in_bailiwick(node->owner, rr->owner) >= 0);
+	return node;
+}
+
 int zone_contents_apply(zone_contents_t *contents,
                         zone_tree_apply_cb_t function, void *data)
 {
@@ -505,6 +566,8 @@ int zone_contents_cow(zone_contents_t *from, zone_contents_t **to)
 	from->adds_tree = NULL;
 	contents->size = from->size;
 	contents->max_ttl = from->max_ttl;
+	contents->arena = from->arena;
+	zone_arena_ref(contents->arena);
 
 	*to = contents;
 	return KNOT_EOK;
@@ -525,24 +588,34 @@ void zone_contents_free(zone_contents_t *contents)
 
 	ATOMIC_DEINIT(contents->dnssec_expire);
 
+	zone_arena_unref(contents->arena);
 	free(contents);
 }
 
+/*! \brief Minimal number of nodes per thread for parallel freeing. */
+#define FREE_MIN_PER_THREAD 65536
+
+static void deep_free_tree(zone_tree_t **tree, unsigned threads)
+{
+	// Thread startup isn't worth it for small zones.
+	unsigned max_threads = MIN(threads, zone_tree_count(*tree) / FREE_MIN_PER_THREAD);
+	threads = MAX(max_threads, 1);
+
+	(void)zone_tree_apply_parallel(*tree, destroy_node_rrsets_from_tree, NULL, threads);
+	zone_tree_free_parallel(tree, threads);
+}
+
 void zone_contents_deep_free(zone_contents_t *contents)
 {
 	if (contents == NULL) {
 		return;
 	}
 
-	if (contents != NULL) {
-		// Delete NSEC3 tree.
-		(void)zone_tree_apply(contents->nsec3_nodes,
-		                      destroy_node_rrsets_from_tree, NULL);
+	// Delete NSEC3 tree.
+	deep_free_tree(&contents->nsec3_nodes, contents->free_threads);
 
-		// Delete the normal tree.
-		(void)zone_tree_apply(contents->nodes,
-		                      destroy_node_rrsets_from_tree, NULL);
-	}
+	// Delete the normal tree.
+	deep_free_tree(&contents->nodes, contents->free_threads);
 
 	zone_contents_free(contents);
 }
@@ -19,6 +19,7 @@
 #include "contrib/atomic.h"
 #include "libdnssec/nsec.h"
 #include "libknot/rrtype/nsec3param.h"
+#include "knot/zone/arena.h"
 #include "knot/zone/node.h"
 #include "knot/zone/zone-tree.h"
 
@@ -35,11 +36,17 @@ typedef struct zone_contents {
 
 	trie_t *adds_tree; // "additionals tree" for reverse lookup of nodes affected by additionals
 
+	zone_arena_t *arena; // memory arena of a complete load, shared with COW copies
+	knot_mm_t *mm;       // allocator of nodes and RDATA added directly to these contents
+
 	dnssec_nsec3_params_t nsec3_params;
 	knot_atomic_uint64_t dnssec_expire;
 	size_t size;
 	uint32_t max_ttl;
 	bool dnssec;
+	bool prerender; // pre-render wire of answer RRSets when adjusting
+	bool lazy_glue; // look up glue of popular names at answer time
+	uint16_t free_threads; // threads for freeing huge contents, 0 or 1 for none
 } zone_contents_t;
 
 /*!
@@ -52,6 +59,21 @@ typedef struct zone_contents {
  */
 zone_contents_t *zone_contents_new(const knot_dname_t *apex_name, bool use_binodes);
 
+/*!
+ * \brief Allocate nodes and RDATA subsequently added to the contents from an arena.
+ *
+ * Intended for a complete load into fresh contents. The arena memory is released
+ * at once with the last contents using it, so the data replaced by later updates
+ * of the COW copies is retained until then. With huge pages, the zone tree
+ * tries are allocated from the arena as well.
+ *
+ * \param contents   Newly created contents.
+ * \param pages      Kind of pages backing the arena.
+ *
+ * \return KNOT_E*
+ */
+int zone_contents_use_arena(zone_contents_t *contents, zone_arena_pages_t pages);
+
 /*!
  * \brief Returns zone tree for inserting given RR.
  */
@@ -217,6 +239,23 @@ bool zone_contents_find_node_or_wildcard(const zone_contents_t *contents,
                                          const knot_dname_t *find,
                                          const zone_node_t **found);
 
+/*!
+ * \brief Return node referenced by a glue, looking up the lazily resolved one.
+ *
+ * \param contents           Zone contents being answered from.
+ * \param glue               Glue in question.
+ * \param rr                 RRSet the glue belongs to.
+ * \param another_zone_node  Another node from the same zone.
+ * \param optional           Out: optional glue indicator.
+ *
+ * \return Glue node or NULL if the looked up name doesn't exist.
+ */
+const zone_node_t *zone_contents_glue_node(const zone_contents_t *contents,
+                                           const glue_t *glue,
+                                           const knot_rrset_t *rr,
+                                           const zone_node_t *another_zone_node,
+                                           bool *optional);
+
 /*!
  * \brief Applies the given function to each regular node in the zone.
  *
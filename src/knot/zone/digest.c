@@ -14,24 +14,87 @@
     along with this program.  If not, see <https://www.gnu.org/licenses/>.
  */
 
+#include <pthread.h>
 #include <stdio.h>
 
 #include "knot/zone/digest.h"
 #include "knot/dnssec/rrset-sign.h"
 #include "knot/updates/zone-update.h"
+#include "contrib/macros.h"
 #include "contrib/wire_ctx.h"
 #include "libdnssec/digest.h"
 #include "libknot/libknot.h"
 
 #define DIGEST_BUF_MIN 4096
 
+#define PIPE_BLOCK_SIZE (1024 * 1024)
+#define PIPE_BLOCKS 4
+#define PIPE_MIN_NODES 10000 // smaller zones are digested without the pipeline
+
+/*!
+ * \brief Ring of serialized blocks passed from the serializing thread to the hashing one.
+ *
+ * SIMPLE scheme digest is one ordered hash stream, so it can't be split.
+ * Instead, RRSet serialization (incl. the apex RRSIG handling) runs in
+ * a separate thread while the calling thread hashes already finished blocks.
+ */
+typedef struct {
+	uint8_t *data[PIPE_BLOCKS];
+	size_t len[PIPE_BLOCKS];
+	size_t produced;        // blocks handed over to the hashing thread
+	size_t consumed;        // blocks already hashed
+	size_t fill;            // bytes written to the block being produced
+	bool done;              // producer finished, no more blocks follow
+	bool abort;             // consumer failed, producer shall stop
+	int ret;                // producer result
+	pthread_mutex_t mx;
+	pthread_cond_t cond;
+} digest_pipe_t;
+
 typedef struct {
 	size_t buf_size;
 	uint8_t *buf;
 	struct dnssec_digest_ctx *digest_ctx;
+	digest_pipe_t *pipe;
+	zone_tree_t *tree;
 	const zone_node_t *apex;
 } contents_digest_ctx_t;
 
+static int pipe_push_block(digest_pipe_t *pipe)
+{
+	pthread_mutex_lock(&pipe->mx);
+	pipe->len[pipe->produced % PIPE_BLOCKS] = pipe->fill;
+	pipe->produced++;
+	pipe->fill = 0;
+	pthread_cond_broadcast(&pipe->cond);
+	while (pipe->produced - pipe->consumed == PIPE_BLOCKS && !pipe->abort) {
+		pthread_cond_wait(&pipe->cond, &pipe->mx);
+	}
+	int ret = pipe->abort ? KNOT_ERROR : KNOT_EOK;
+	pthread_mutex_unlock(&pipe->mx);
+	return ret;
+}
+
+static int pipe_write(digest_pipe_t *pipe, const uint8_t *data, size_t len)
+{
+	while (len > 0) {
+		uint8_t *block = pipe->data[pipe->produced % PIPE_BLOCKS];
+		size_t chunk = MIN(len, PIPE_BLOCK_SIZE - pipe->fill);
+		memcpy(block + pipe->fill, data, chunk);
+		pipe->fill += chunk;
+		data += chunk;
+		len -= chunk;
+
+		if (pipe->fill == PIPE_BLOCK_SIZE) {
+			int ret = pipe_push_block(pipe);
+			if (ret != KNOT_EOK) {
+				return ret;
+			}
+		}
+	}
+	return KNOT_EOK;
+}
+
 static int digest_rrset(knot_rrset_t *rrset, const zone_node_t *node, void *vctx)
 {
 	contents_digest_ctx_t *ctx = vctx;
@@ -83,6 +146,9 @@ static int digest_rrset(knot_rrset_t *rrset, const zone_node_t *node, void *vctx
 	}
 
 	// digest serialized RRSet
+	if (ctx->pipe != NULL) {
+		return pipe_write(ctx->pipe, ctx->buf, ret);
+	}
 	dnssec_binary_t bufbin = { ret, ctx->buf };
 	return dnssec_digest(ctx->digest_ctx, &bufbin);
 }
@@ -97,6 +163,90 @@ static int digest_node(zone_node_t *node, void *ctx)
 	return ret;
 }
 
+static void *digest_serialize_thread(void *vctx)
+{
+	contents_digest_ctx_t *ctx = vctx;
+	digest_pipe_t *pipe = ctx->pipe;
+
+	int ret = zone_tree_apply(ctx->tree, digest_node, ctx);
+	if (ret == KNOT_EOK && pipe->fill > 0) {
+		ret = pipe_push_block(pipe);
+	}
+
+	pthread_mutex_lock(&pipe->mx);
+	pipe->ret = ret;
+	pipe->done = true;
+	pthread_cond_broadcast(&pipe->cond);
+	pthread_mutex_unlock(&pipe->mx);
+
+	return NULL;
+}
+
+static int digest_pipelined(contents_digest_ctx_t *ctx)
+{
+	digest_pipe_t pipe = { 0 };
+	for (int i = 0; i < PIPE_BLOCKS; i++) {
+		pipe.data[i] = malloc(PIPE_BLOCK_SIZE);
+		if (pipe.data[i] == NULL) {
+			for (int j = 0; j < i; j++) {
+				free(pipe.data[j]);
+			}
+			return KNOT_ENOMEM;
+		}
+	}
+	pthread_mutex_init(&pipe.mx, NULL);
+	pthread_cond_init(&pipe.cond, NULL);
+	ctx->pipe = &pipe;
+
+	pthread_t thread;
+	int ret = pthread_create(&thread, NULL, digest_serialize_thread, ctx);
+	if (ret != 0) {
+		ret = KNOT_ENOMEM;
+		goto cleanup;
+	}
+
+	pthread_mutex_lock(&pipe.mx);
+	while (true) {
+		while (pipe.consumed == pipe.produced && !pipe.done) {
+			pthread_cond_wait(&pipe.cond, &pipe.mx);
+		}
+		if (pipe.consumed == pipe.produced) {
+			break;
+		}
+		size_t idx = pipe.consumed % PIPE_BLOCKS;
+		pthread_mutex_unlock(&pipe.mx);
+
+		// hash the block outside the lock so that serialization continues
+		dnssec_binary_t bufbin = { pipe.len[idx], pipe.data[idx] };
+		ret = dnssec_digest(ctx->digest_ctx, &bufbin);
+
+		pthread_mutex_lock(&pipe.mx);
+		if (ret != DNSSEC_EOK) {
+			ret = knot_error_from_libdnssec(ret);
+			pipe.abort = true;
+			pthread_cond_broadcast(&pipe.cond);
+			break;
+		}
+		pipe.consumed++;
+		pthread_cond_broadcast(&pipe.cond);
+	}
+	pthread_mutex_unlock(&pipe.mx);
+
+	pthread_join(thread, NULL);
+	if (ret == KNOT_EOK) {
+		ret = pipe.ret;
+	}
+
+cleanup:
+	ctx->pipe = NULL;
+	pthread_cond_destroy(&pipe.cond);
+	pthread_mutex_destroy(&pipe.mx);
+	for (int i = 0; i < PIPE_BLOCKS; i++) {
+		free(pipe.data[i]);
+	}
+	return ret;
+}
+
 int zone_contents_digest(const zone_contents_t *contents, int algorithm,
                          uint8_t **out_digest, size_t *out_size)
 {
@@ -135,7 +285,12 @@ int zone_contents_digest(const zone_contents_t *contents, int algorithm,
 	}
 
 	if (ret == KNOT_EOK) {
-		ret = zone_tree_apply(conts, digest_node, &ctx);
+		ctx.tree = conts;
+		if (zone_tree_count(conts) >= PIPE_MIN_NODES) {
+			ret = digest_pipelined(&ctx);
+		} else {
+			ret = zone_tree_apply(conts, digest_node, &ctx);
+		}
 	}
 
 	if (conts != contents->nodes) {
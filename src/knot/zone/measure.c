@@ -14,6 +14,8 @@
     along with this program.  If not, see <https://www.gnu.org/licenses/>.
  */
 
+#include <string.h>
+
 #include "knot/zone/measure.h"
 
 measure_t knot_measure_init(bool measure_whole, bool measure_diff)
@@ -146,3 +148,54 @@ void knot_measure_finish_update(measure_t *m, zone_update_t *update)
 		break;
 	}
 }
+
+typedef struct {
+	measure_memory_t *mem;
+	bool nsec3;
+} memory_ctx_t;
+
+static int measure_memory_cb(zone_node_t *node, void *data)
+{
+	memory_ctx_t *ctx = data;
+	measure_memory_t *mem = ctx->mem;
+	size_t *nodes = ctx->nsec3 ? &mem->nsec3 : &mem->nodes;
+	size_t *rdata = ctx->nsec3 ? &mem->nsec3 : &mem->rdata;
+	size_t *adds = ctx->nsec3 ? &mem->nsec3 : &mem->additionals;
+
+	*nodes += sizeof(*node) + knot_dname_size(node->owner) +
+	          node->rrset_count * sizeof(*node->rrs);
+	if (!(node->flags & NODE_FLAGS_NSEC3_NODE)) {
+		*nodes += knot_dname_size(node->nsec3_hash);
+	}
+	*nodes += knot_dname_size(node->nsec3_wildcard_name);
+	if (node->flags & NODE_FLAGS_BINODE) {
+		mem->binodes += sizeof(*node); // The data is shared by both halves.
+	}
+
+	for (int i = 0; i < node->rrset_count; i++) {
+		const struct rr_data *rr = &node->rrs[i];
+		*rdata += rr->rrs.size;
+		if (rr->additional != NULL) {
+			*adds += sizeof(*rr->additional) +
+			         rr->additional->count * sizeof(glue_t) +
+			         rr->additional->wire_size;
+		}
+	}
+
+	return KNOT_EOK;
+}
+
+void knot_measure_memory(zone_contents_t *zone, measure_memory_t *mem)
+{
+	assert(mem);
+
+	memset(mem, 0, sizeof(*mem));
+	if (zone == NULL) {
+		return;
+	}
+
+	memory_ctx_t ctx = { .mem = mem };
+	(void)zone_tree_apply(zone->nodes, measure_memory_cb, &ctx);
+	ctx.nsec3 = true;
+	(void)zone_tree_apply(zone->nsec3_nodes, measure_memory_cb, &ctx);
+}
@@ -40,6 +40,20 @@ typedef struct {
 	uint32_t limit_max_ttl;
 } measure_t;
 
+/*!
+ * \brief Estimated memory used by zone contents (bytes).
+ *
+ * Node structures, owner names, and RRSet arrays are accounted in \a nodes,
+ * the NSEC3 tree is accounted as a whole in \a nsec3.
+ */
+typedef struct {
+	size_t nodes;       /*!< Node structures, owners, and RRSet arrays. */
+	size_t rdata;       /*!< Record data. */
+	size_t additionals; /*!< Glue references and pre-rendered RRSets. */
+	size_t nsec3;       /*!< NSEC3 nodes including their data. */
+	size_t binodes;     /*!< Second halves of bi-nodes. */
+} measure_memory_t;
+
 /*! \brief Initialize measure struct. */
 measure_t knot_measure_init(bool measure_whole, bool measure_diff);
 
@@ -69,3 +83,19 @@ void knot_measure_finish_zone(measure_t *m, zone_contents_t *zone);
  * \param m        Measured results.
  */
 void knot_measure_finish_update(measure_t *m, zone_update_t *update);
+
+/*!
+ * \brief Estimate memory used by zone contents.
+ *
+ * \note Traverses the whole zone.
+ *
+ * \param zone   Zone contents.
+ * \param mem    Output: memory by category.
+ */
+void knot_measure_memory(zone_contents_t *zone, measure_memory_t *mem);
+
+/*! \brief Total of the estimated memory. */
+inline static size_t knot_measure_memory_total(const measure_memory_t *mem)
+{
+	return mem->nodes + mem->rdata + mem->additionals + mem->nsec3 + mem->binodes;
+}
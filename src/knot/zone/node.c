@@ -14,9 +14,42 @@
     along with this program.  If not, see <https://www.gnu.org/licenses/>.
  */
 
+#include "knot/zone/arena.h"
 #include "knot/zone/node.h"
 #include "libknot/libknot.h"
 
+static void *detach_alloc(_unused_ void *ctx, size_t size)
+{
+	return malloc(size);
+}
+
+/*! \brief Memory context moving arena data to the heap, the arena keeps its copy. */
+static knot_mm_t detach_mm = {
+	.alloc = detach_alloc,
+	.free = NULL,
+};
+
+/*! \brief Returns memory context for releasing or reallocating node data. */
+static knot_mm_t *data_mm(knot_mm_t *mm, const void *data)
+{
+	return (mm == NULL && zone_arena_owns(data)) ? &detach_mm : mm;
+}
+
+/*! \brief Moves arena RDATA to the heap before an in-place modification. */
+static int rdataset_detach(knot_rdataset_t *rrs, knot_mm_t *mm)
+{
+	if (mm != NULL || !zone_arena_owns(rrs->rdata)) {
+		return KNOT_EOK;
+	}
+
+	knot_rdataset_t copy;
+	int ret = knot_rdataset_copy(&copy, rrs, NULL);
+	if (ret == KNOT_EOK) {
+		*rrs = copy;
+	}
+	return ret;
+}
+
 void additional_clear(additional_t *additional)
 {
 	if (additional == NULL) {
@@ -24,6 +57,7 @@ void additional_clear(additional_t *additional)
 	}
 
 	free(additional->glues);
+	free(additional->wire);
 	free(additional);
 }
 
@@ -39,7 +73,8 @@ bool additional_equal(additional_t *a, additional_t *b)
 			return false;
 		}
 	}
-	return true;
+	return a->wire_rdata == b->wire_rdata && a->wire_size == b->wire_size &&
+	       (a->wire_size == 0 || memcmp(a->wire, b->wire, a->wire_size) == 0);
 }
 
 static uint32_t rr_insert_ttl(const knot_rrset_t *rr)
@@ -50,7 +85,7 @@ static uint32_t rr_insert_ttl(const knot_rrset_t *rr)
 /*! \brief Clears allocated data in RRSet entry. */
 static void rr_data_clear(struct rr_data *data, knot_mm_t *mm)
 {
-	knot_rdataset_clear(&data->rrs, mm);
+	knot_rdataset_clear(&data->rrs, data_mm(mm, data->rrs.rdata));
 	memset(data, 0, sizeof(*data));
 }
 
@@ -78,7 +113,7 @@ static int add_rrset_no_merge(zone_node_t *node, const knot_rrset_t *rrset,
 
 	const size_t prev_nlen = node->rrset_count * sizeof(struct rr_data);
 	const size_t nlen = (node->rrset_count + 1) * sizeof(struct rr_data);
-	void *p = mm_realloc(mm, node->rrs, nlen, prev_nlen);
+	void *p = mm_realloc(data_mm(mm, node->rrs), node->rrs, nlen, prev_nlen);
 	if (p == NULL) {
 		return KNOT_ENOMEM;
 	}
@@ -112,18 +147,18 @@ static bool ttl_changed(struct rr_data *node_data, const knot_rrset_t *rrset)
 
 zone_node_t *node_new(const knot_dname_t *owner, bool binode, bool second, knot_mm_t *mm)
 {
-	zone_node_t *ret = mm_alloc(mm, (binode ? 2 : 1) * sizeof(zone_node_t));
+	// The owner is stored right behind the node(s) to save an allocation.
+	size_t nodes_size = (binode ? 2 : 1) * sizeof(zone_node_t);
+	size_t owner_size = knot_dname_size(owner);
+	zone_node_t *ret = mm_alloc(mm, nodes_size + owner_size);
 	if (ret == NULL) {
 		return NULL;
 	}
 	memset(ret, 0, sizeof(*ret));
 
 	if (owner) {
-		ret->owner = knot_dname_copy(owner, mm);
-		if (ret->owner == NULL) {
-			mm_free(mm, ret);
-			return NULL;
-		}
+		ret->owner = (knot_dname_t *)((uint8_t *)ret + nodes_size);
+		memcpy(ret->owner, owner, owner_size);
 	}
 
 	// Node is authoritative by default.
@@ -177,7 +212,7 @@ void binode_unify(zone_node_t *node, bool free_deleted, knot_mm_t *mm)
 					rr_data_clear(&counter->rrs[i], mm);
 				}
 			}
-			mm_free(mm, counter->rrs);
+			mm_free(data_mm(mm, counter->rrs), counter->rrs);
 		}
 		if (counter->nsec3_wildcard_name != node->nsec3_wildcard_name) {
 			free(counter->nsec3_wildcard_name);
@@ -224,12 +259,8 @@ bool binode_rdata_shared(zone_node_t *node, uint16_t type)
 
 static additional_t *node_type2addit(zone_node_t *node, uint16_t type)
 {
-	for (uint16_t i = 0; i < node->rrset_count; i++) {
-		if (node->rrs[i].type == type) {
-			return node->rrs[i].additional;
-		}
-	}
-	return NULL;
+	struct rr_data *rr_data = node_rr_data(node, type);
+	return (rr_data != NULL) ? rr_data->additional : NULL;
 }
 
 bool binode_additional_shared(zone_node_t *node, uint16_t type)
@@ -255,7 +286,7 @@ bool binode_additionals_unchanged(zone_node_t *node, zone_node_t *counterpart)
 	}
 	for (int i = 0; i < node->rrset_count; i++) {
 		struct rr_data *rr = &node->rrs[i];
-		if (knot_rrtype_additional_needed(rr->type)) {
+		if (node_rrtype_linked(rr->type)) {
 			knot_rdataset_t *counterr = node_rdataset(counterpart, rr->type);
 			if (counterr == NULL || counterr->rdata != rr->rrs.rdata) {
 				return false;
@@ -264,7 +295,7 @@ bool binode_additionals_unchanged(zone_node_t *node, zone_node_t *counterpart)
 	}
 	for (int i = 0; i < counterpart->rrset_count; i++) {
 		struct rr_data *rr = &counterpart->rrs[i];
-		if (knot_rrtype_additional_needed(rr->type)) {
+		if (node_rrtype_linked(rr->type)) {
 			knot_rdataset_t *counterr = node_rdataset(node, rr->type);
 			if (counterr == NULL || counterr->rdata != rr->rrs.rdata) {
 				return false;
@@ -274,6 +305,16 @@ bool binode_additionals_unchanged(zone_node_t *node, zone_node_t *counterpart)
 	return true;
 }
 
+bool binode_referral_unchanged(zone_node_t *node)
+{
+	if (node == NULL || !(node->flags & NODE_FLAGS_BINODE)) {
+		return false;
+	}
+	zone_node_t *counter = binode_counterpart(node);
+	const uint32_t mask = NODE_FLAGS_DELETED | NODE_FLAGS_DELEG | NODE_FLAGS_NONAUTH;
+	return (node->flags & mask) == (counter->flags & mask);
+}
+
 void node_free_rrsets(zone_node_t *node, knot_mm_t *mm)
 {
 	if (node == NULL) {
@@ -285,7 +326,7 @@ void node_free_rrsets(zone_node_t *node, knot_mm_t *mm)
 		rr_data_clear(&node->rrs[i], mm);
 	}
 
-	mm_free(mm, node->rrs);
+	mm_free(data_mm(mm, node->rrs), node->rrs);
 	node->rrs = NULL;
 	node->rrset_count = 0;
 }
@@ -296,8 +337,6 @@ void node_free(zone_node_t *node, knot_mm_t *mm)
 		return;
 	}
 
-	knot_dname_free(node->owner, mm);
-
 	assert((node->flags & NODE_FLAGS_BINODE) || !(node->flags & NODE_FLAGS_SECOND));
 	assert(binode_counterpart(node) == NULL ||
 	       binode_counterpart(node)->nsec3_wildcard_name == node->nsec3_wildcard_name);
@@ -308,10 +347,11 @@ void node_free(zone_node_t *node, knot_mm_t *mm)
 	}
 
 	if (node->rrs != NULL) {
-		mm_free(mm, node->rrs);
+		mm_free(data_mm(mm, node->rrs), node->rrs);
 	}
 
-	mm_free(mm, binode_node(node, false));
+	zone_node_t *first = binode_node(node, false);
+	mm_free(data_mm(mm, first), first);
 }
 
 int node_add_rrset(zone_node_t *node, const knot_rrset_t *rrset, knot_mm_t *mm)
@@ -322,19 +362,19 @@ int node_add_rrset(zone_node_t *node, const knot_rrset_t *rrset, knot_mm_t *mm)
 
 	node->flags &= ~NODE_FLAGS_RRSIGS_VALID;
 
-	for (uint16_t i = 0; i < node->rrset_count; ++i) {
-		if (node->rrs[i].type == rrset->type) {
-			struct rr_data *node_data = &node->rrs[i];
-			const bool ttl_change = ttl_changed(node_data, rrset);
-			node_data->ttl = rr_insert_ttl(rrset);
-
-			int ret = knot_rdataset_merge(&node_data->rrs,
-			                              &rrset->rrs, mm);
-			if (ret != KNOT_EOK) {
-				return ret;
-			} else {
-				return ttl_change ? KNOT_ETTL : KNOT_EOK;
-			}
+	struct rr_data *node_data = node_rr_data(node, rrset->type);
+	if (node_data != NULL) {
+		const bool ttl_change = ttl_changed(node_data, rrset);
+		node_data->ttl = rr_insert_ttl(rrset);
+
+		int ret = rdataset_detach(&node_data->rrs, mm);
+		if (ret == KNOT_EOK) {
+			ret = knot_rdataset_merge(&node_data->rrs, &rrset->rrs, mm);
+		}
+		if (ret != KNOT_EOK) {
+			return ret;
+		} else {
+			return ttl_change ? KNOT_ETTL : KNOT_EOK;
 		}
 	}
 
@@ -350,19 +390,17 @@ void node_remove_rdataset(zone_node_t *node, uint16_t type)
 
 	node->flags &= ~NODE_FLAGS_RRSIGS_VALID;
 
-	for (int i = 0; i < node->rrset_count; ++i) {
-		if (node->rrs[i].type == type) {
-			if (!binode_additional_shared(node, type)) {
-				additional_clear(node->rrs[i].additional);
-			}
-			if (!binode_rdata_shared(node, type)) {
-				rr_data_clear(&node->rrs[i], NULL);
-			}
-			memmove(node->rrs + i, node->rrs + i + 1,
-			        (node->rrset_count - i - 1) * sizeof(struct rr_data));
-			--node->rrset_count;
-			return;
+	struct rr_data *rr_data = node_rr_data(node, type);
+	if (rr_data != NULL) {
+		if (!binode_additional_shared(node, type)) {
+			additional_clear(rr_data->additional);
+		}
+		if (!binode_rdata_shared(node, type)) {
+			rr_data_clear(rr_data, NULL);
 		}
+		struct rr_data *end = node->rrs + node->rrset_count;
+		memmove(rr_data, rr_data + 1, (end - rr_data - 1) * sizeof(struct rr_data));
+		--node->rrset_count;
 	}
 }
 
@@ -379,7 +417,10 @@ int node_remove_rrset(zone_node_t *node, const knot_rrset_t *rrset, knot_mm_t *m
 
 	node->flags &= ~NODE_FLAGS_RRSIGS_VALID;
 
-	int ret = knot_rdataset_subtract(node_rrs, &rrset->rrs, mm);
+	int ret = rdataset_detach(node_rrs, mm);
+	if (ret == KNOT_EOK) {
+		ret = knot_rdataset_subtract(node_rrs, &rrset->rrs, mm);
+	}
 	if (ret != KNOT_EOK) {
 		return ret;
 	}
@@ -397,29 +438,18 @@ knot_rrset_t *node_create_rrset(const zone_node_t *node, uint16_t type)
 		return NULL;
 	}
 
-	for (uint16_t i = 0; i < node->rrset_count; ++i) {
-		if (node->rrs[i].type == type) {
-			knot_rrset_t rrset = node_rrset_at(node, i);
-			return knot_rrset_copy(&rrset, NULL);
-		}
+	knot_rrset_t rrset = node_rrset(node, type);
+	if (knot_rrset_empty(&rrset)) {
+		return NULL;
 	}
 
-	return NULL;
+	return knot_rrset_copy(&rrset, NULL);
 }
 
 knot_rdataset_t *node_rdataset(const zone_node_t *node, uint16_t type)
 {
-	if (node == NULL) {
-		return NULL;
-	}
-
-	for (uint16_t i = 0; i < node->rrset_count; ++i) {
-		if (node->rrs[i].type == type) {
-			return &node->rrs[i].rrs;
-		}
-	}
-
-	return NULL;
+	struct rr_data *rr_data = node_rr_data(node, type);
+	return (rr_data != NULL) ? &rr_data->rrs : NULL;
 }
 
 bool node_rrtype_is_signed(const zone_node_t *node, uint16_t type)
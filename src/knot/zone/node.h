@@ -22,6 +22,7 @@
 #include "libknot/dname.h"
 #include "libknot/rrset.h"
 #include "libknot/rdataset.h"
+#include "libknot/wire.h"
 
 struct rr_data;
 
@@ -30,7 +31,7 @@ struct rr_data;
  *        name in a zone.
  */
 typedef struct zone_node {
-	knot_dname_t *owner; /*!< Domain name being the owner of this node. */
+	knot_dname_t *owner; /*!< Domain name being the owner of this node (allocated with the node). */
 	struct zone_node *parent; /*!< Parent node in the name hierarchy. */
 
 	/*! \brief Array with data of RRSets belonging to this node. */
@@ -48,6 +49,8 @@ typedef struct zone_node {
 		assert(!(node->nsec3_node & NODE_FLAGS_SECOND)); */
 	};
 	knot_dname_t *nsec3_wildcard_name; /*! Name of NSEC3 node proving wildcard nonexistence. */
+	struct zone_node *wildcard_child; /*!< Wildcard child node (with NODE_FLAGS_WILDCARD_CHILD). */
+	struct zone_node *zone_cut; /*!< Closest delegation point above (with NODE_FLAGS_NONAUTH). */
 	uint32_t children; /*!< Count of children nodes in DNS hierarchy. */
 	uint16_t rrset_count; /*!< Number of RRSets stored in the node. */
 	uint16_t flags; /*!< \ref node_flags enum. */
@@ -55,7 +58,7 @@ typedef struct zone_node {
 
 /*!< \brief Glue node context. */
 typedef struct {
-	const zone_node_t *node; /*!< Glue node. */
+	const zone_node_t *node; /*!< Glue node, NULL if looked up at answer time. */
 	uint16_t ns_pos; /*!< Corresponding NS record position (for compression). */
 	bool optional; /*!< Optional glue indicator. */
 } glue_t;
@@ -64,6 +67,9 @@ typedef struct {
 typedef struct {
 	glue_t *glues; /*!< Glue data. */
 	uint16_t count; /*!< Number of glue nodes. */
+	uint8_t *wire; /*!< Pre-rendered RRSet wire (see knot_rrset_prerender()). */
+	uint32_t wire_size; /*!< Size of the pre-rendered wire. */
+	const knot_rdata_t *wire_rdata; /*!< RDATA the wire was rendered from. */
 } additional_t;
 
 /*!< \brief Structure storing RR data. */
@@ -123,10 +129,30 @@ void additional_clear(additional_t *additional);
  */
 bool additional_equal(additional_t *a, additional_t *b);
 
+/*!
+ * \brief Returns pre-rendered wire of the RRSet if it's up to date.
+ *
+ * \param rrset  RRSet with additional data from the zone node.
+ *
+ * \return Wire for knot_pkt_put_prerendered() or NULL.
+ */
+static inline const uint8_t *additional_wire(const knot_rrset_t *rrset)
+{
+	// The TTL is the same in all RRs and follows TYPE and CLASS.
+	const additional_t *additional = rrset->additional;
+	if (additional == NULL || additional->wire == NULL ||
+	    additional->wire_rdata != rrset->rrs.rdata ||
+	    knot_wire_read_u32(additional->wire + 2 * sizeof(uint16_t)) != rrset->ttl) {
+		return NULL;
+	}
+
+	return additional->wire;
+}
+
 /*!
  * \brief Creates and initializes new node structure.
  *
- * \param owner  Node's owner, will be duplicated.
+ * \param owner  Node's owner, will be copied into the node allocation.
  * \param binode Create bi-node.
  * \param second The second part of the bi-node shall be used now.
  * \param mm     Memory context to use.
@@ -201,6 +227,14 @@ bool binode_additional_shared(zone_node_t *node, uint16_t type);
  */
 bool binode_additionals_unchanged(zone_node_t *node, zone_node_t *counterpart);
 
+/*!
+ * \brief Return true if both parts of bi-node agree on existence and delegation flags.
+ *
+ * Nodes referring to such a node (additionals, NSEC3 pointers) don't need re-adjusting,
+ * as the bi-node pointer they hold stays valid.
+ */
+bool binode_referral_unchanged(zone_node_t *node);
+
 /*!
  * \brief Destroys allocated data within the node
  *        structure, but not the node itself.
@@ -289,6 +323,23 @@ inline static zone_node_t *node_prev(const zone_node_t *node)
 	return binode_node_as(node->prev, node);
 }
 
+/*!
+ * \brief Returns wildcard child node (fixing bi-node issue) of given node, if known.
+ */
+inline static zone_node_t *node_wildcard_child(const zone_node_t *node)
+{
+	return binode_node_as(node->wildcard_child, node);
+}
+
+/*!
+ * \brief Returns closest delegation point (fixing bi-node issue) above given
+ *        non-authoritative node, if known.
+ */
+inline static zone_node_t *node_zone_cut(const zone_node_t *node)
+{
+	return binode_node_as(node->zone_cut, node);
+}
+
 /*!
  * \brief Return node referenced by a glue.
  *
@@ -335,6 +386,17 @@ inline static bool node_rrtype_exists(const zone_node_t *node, uint16_t type)
 	return node_rdataset(node, type) != NULL;
 }
 
+/*!
+ * \brief Checks whether the RRSet type links the nodes of its RDATA names.
+ *
+ * Besides the types requiring additional records, it's CNAME with its
+ * in-zone target, which is followed without a lookup when answering.
+ */
+inline static bool node_rrtype_linked(uint16_t type)
+{
+	return knot_rrtype_additional_needed(type) || type == KNOT_RRTYPE_CNAME;
+}
+
 /*!
  * \brief Checks whether node is empty. Node is empty when NULL or when no
  *        RRSets are in it.
@@ -358,6 +420,38 @@ inline static bool node_empty(const zone_node_t *node)
  */
 bool node_bitmap_equal(const zone_node_t *a, const zone_node_t *b);
 
+/*!
+ * \brief Returns RRSet data of the given type.
+ *
+ * \note RRSets in a node are kept sorted by type, so binary search is used.
+ *
+ * \param node  Node containing RRSet.
+ * \param type  RRSet type we want to get.
+ *
+ * \return RRSet data or NULL if not found.
+ */
+static inline struct rr_data *node_rr_data(const zone_node_t *node, uint16_t type)
+{
+	if (node == NULL) {
+		return NULL;
+	}
+
+	uint16_t lo = 0, hi = node->rrset_count;
+	while (lo < hi) {
+		uint16_t mid = lo + (hi - lo) / 2;
+		uint16_t mid_type = node->rrs[mid].type;
+		if (mid_type < type) {
+			lo = mid + 1;
+		} else if (mid_type > type) {
+			hi = mid;
+		} else {
+			return &node->rrs[mid];
+		}
+	}
+
+	return NULL;
+}
+
 /*!
  * \brief Returns RRSet structure initialized with data from node.
  *
@@ -369,15 +463,13 @@ bool node_bitmap_equal(const zone_node_t *a, const zone_node_t *b);
 static inline knot_rrset_t node_rrset(const zone_node_t *node, uint16_t type)
 {
 	knot_rrset_t rrset;
-	for (uint16_t i = 0; node && i < node->rrset_count; ++i) {
-		if (node->rrs[i].type == type) {
-			struct rr_data *rr_data = &node->rrs[i];
-			knot_rrset_init(&rrset, node->owner, type, KNOT_CLASS_IN,
-			                rr_data->ttl);
-			rrset.rrs = rr_data->rrs;
-			rrset.additional = rr_data->additional;
-			return rrset;
-		}
+	struct rr_data *rr_data = node_rr_data(node, type);
+	if (rr_data != NULL) {
+		knot_rrset_init(&rrset, node->owner, type, KNOT_CLASS_IN,
+		                rr_data->ttl);
+		rrset.rrs = rr_data->rrs;
+		rrset.additional = rr_data->additional;
+		return rrset;
 	}
 	knot_rrset_init_empty(&rrset);
 	return rrset;
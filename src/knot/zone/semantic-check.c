@@ -14,12 +14,14 @@
     along with this program.  If not, see <https://www.gnu.org/licenses/>.
  */
 
+#include <pthread.h>
 #include <stdio.h>
 
 #include "knot/zone/semantic-check.h"
 
 #include "libdnssec/error.h"
 #include "libdnssec/key.h"
+#include "contrib/macros.h"
 #include "contrib/string.h"
 #include "libknot/libknot.h"
 #include "knot/dnssec/key-events.h"
@@ -113,6 +115,7 @@ typedef enum {
 	SOFT      = 1 << 1,
 	OPTIONAL  = 1 << 2,
 	DNSSEC    = 1 << 3,
+	LOCAL     = 1 << 4, // doesn't need other nodes than the checked one and apex
 } check_level_t;
 
 typedef struct {
@@ -136,12 +139,12 @@ struct check_function {
 };
 
 static const struct check_function CHECK_FUNCTIONS[] = {
-	{ check_soa,            MANDATORY },
-	{ check_cname,          MANDATORY | SOFT },
+	{ check_soa,            MANDATORY | LOCAL },
+	{ check_cname,          MANDATORY | SOFT | LOCAL },
 	{ check_dname,          MANDATORY | SOFT },
 	{ check_delegation,     MANDATORY | SOFT }, // mandatory for apex, optional for others
-	{ check_ds,             MANDATORY | SOFT }, // mandatory for apex, optional for others
-	{ check_nsec3param,     DNSSEC },
+	{ check_ds,             MANDATORY | SOFT | LOCAL }, // mandatory for apex, optional for others
+	{ check_nsec3param,     DNSSEC | LOCAL },
 	{ check_submission,     DNSSEC },
 };
 
@@ -473,10 +476,18 @@ static int do_checks_in_tree(zone_node_t *node, void *data)
 {
 	semchecks_data_t *s_data = (semchecks_data_t *)data;
 
+	// removed by an incremental update
+	if (node->flags & NODE_FLAGS_DELETED) {
+		return KNOT_EOK;
+	}
+
 	int ret = KNOT_EOK;
 
 	for (int i = 0; ret == KNOT_EOK && i < CHECK_FUNCTIONS_LEN; ++i) {
-		if (CHECK_FUNCTIONS[i].level & s_data->level) {
+		if ((s_data->level & LOCAL) && !(CHECK_FUNCTIONS[i].level & LOCAL)) {
+			continue;
+		}
+		if (CHECK_FUNCTIONS[i].level & s_data->level & ~LOCAL) {
 			ret = CHECK_FUNCTIONS[i].function(node, s_data);
 			if (s_data->handler->fatal_error &&
 			    (CHECK_FUNCTIONS[i].level & SOFT) &&
@@ -489,6 +500,146 @@ static int do_checks_in_tree(zone_node_t *node, void *data)
 	return ret;
 }
 
+#define PARALLEL_MIN_NODES 10000 // smaller zones are checked by one thread
+#define RECORDS_MIN 16
+
+typedef struct {
+	const knot_dname_t *owner;
+	sem_error_t code;
+	bool error;
+	char *info;
+} sem_record_t;
+
+/*!
+ * \brief Error handler collecting errors found by one thread.
+ *
+ * The user-supplied callback is not thread-safe, the collected errors
+ * are passed to it afterwards in the zone order.
+ */
+typedef struct {
+	sem_handler_t handler; // must be first
+	sem_record_t *records;
+	size_t count;
+	size_t max;
+	bool enomem;
+} sem_recorder_t;
+
+typedef struct {
+	semchecks_data_t data;
+	sem_recorder_t rec;
+	zone_tree_it_t it;
+	pthread_t thread;
+	int ret;
+} semchecks_thread_t;
+
+static void record_cb(sem_handler_t *handler, const zone_contents_t *zone,
+                      const knot_dname_t *node, sem_error_t error, const char *data)
+{
+	sem_recorder_t *rec = (sem_recorder_t *)handler;
+	bool is_error = handler->error;
+	handler->error = false;
+
+	if (rec->count == rec->max) {
+		size_t new_max = MAX(RECORDS_MIN, 2 * rec->max);
+		sem_record_t *new_recs = realloc(rec->records, new_max * sizeof(*new_recs));
+		if (new_recs == NULL) {
+			rec->enomem = true;
+			return;
+		}
+		rec->records = new_recs;
+		rec->max = new_max;
+	}
+
+	char *info = NULL;
+	if (data != NULL && (info = strdup(data)) == NULL) {
+		rec->enomem = true;
+		return;
+	}
+
+	rec->records[rec->count++] = (sem_record_t) {
+		.owner = node,
+		.code = error,
+		.error = is_error,
+		.info = info,
+	};
+}
+
+static void *check_range_thread(void *arg)
+{
+	semchecks_thread_t *thr = arg;
+
+	while (thr->ret == KNOT_EOK && !zone_tree_it_finished(&thr->it)) {
+		thr->ret = do_checks_in_tree(zone_tree_it_val(&thr->it), &thr->data);
+		zone_tree_it_next(&thr->it);
+	}
+	if (thr->ret == KNOT_EOK && thr->rec.enomem) {
+		thr->ret = KNOT_ENOMEM;
+	}
+
+	return NULL;
+}
+
+static int checks_parallel(semchecks_data_t *data, unsigned threads)
+{
+	size_t count = threads;
+	semchecks_thread_t *thrs = calloc(count, sizeof(*thrs));
+	zone_tree_it_t *its = calloc(count, sizeof(*its));
+	if (thrs == NULL || its == NULL) {
+		free(thrs);
+		free(its);
+		return KNOT_ENOMEM;
+	}
+
+	int ret = zone_tree_it_ranges(data->zone->nodes, its, &count);
+	for (size_t i = 0; i < count; i++) {
+		thrs[i].it = its[i];
+		thrs[i].data = *data;
+		thrs[i].data.handler = &thrs[i].rec.handler;
+		thrs[i].rec.handler.cb = record_cb;
+		thrs[i].rec.handler.soft_check = data->handler->soft_check;
+	}
+	free(its);
+
+	size_t started = 0;
+	for ( ; ret == KNOT_EOK && started < count; started++) {
+		ret = pthread_create(&thrs[started].thread, NULL, check_range_thread,
+		                     &thrs[started]);
+		if (ret != 0) {
+			ret = KNOT_ENOMEM;
+			break;
+		}
+	}
+	for (size_t i = 0; i < started; i++) {
+		pthread_join(thrs[i].thread, NULL);
+		if (ret == KNOT_EOK) {
+			ret = thrs[i].ret;
+		}
+	}
+
+	sem_handler_t *handler = data->handler;
+	for (size_t i = 0; i < count; i++) {
+		sem_recorder_t *rec = &thrs[i].rec;
+		for (size_t j = 0; j < rec->count; j++) {
+			sem_record_t *r = &rec->records[j];
+			if (ret == KNOT_EOK) {
+				if (r->error) {
+					handler->error = true;
+				}
+				handler->cb(handler, data->zone, r->owner, r->code, r->info);
+				if (data->level & SOFT) {
+					handler->fatal_error = false;
+				}
+			}
+			free(r->info);
+		}
+		free(rec->records);
+		zone_tree_it_free(&thrs[i].it);
+	}
+	free(thrs);
+
+	return ret;
+}
+
 static sem_error_t err_dnssec2sem(int ret, uint16_t rrtype, char *info, size_t len)
 {
 	char type_str[16];
@@ -533,47 +684,62 @@ static int verify_dnssec(zone_contents_t *zone, sem_handler_t *handler, time_t t
 	}
 }
 
-int sem_checks_process(zone_contents_t *zone, semcheck_optional_t optional, sem_handler_t *handler,
-                       time_t time)
+static check_level_t check_level(semcheck_optional_t optional, bool dnssec,
+                                 sem_handler_t *handler)
 {
-	if (handler == NULL) {
-		return KNOT_EINVAL;
-	}
-
-	if (zone == NULL) {
-		return KNOT_EEMPTYZONE;
-	}
-
-	semchecks_data_t data = {
-		.handler = handler,
-		.zone = zone,
-		.level = MANDATORY,
-		.time = time,
-	};
+	check_level_t level = MANDATORY;
 
 	switch (optional) {
 	case SEMCHECK_MANDATORY_SOFT:
-		data.level |= SOFT;
-		data.handler->soft_check = true;
+		level |= SOFT;
+		handler->soft_check = true;
 		break;
 	case SEMCHECK_DNSSEC_AUTO:
-		data.level |= OPTIONAL;
-		if (zone->dnssec) {
-			data.level |= DNSSEC;
+		level |= OPTIONAL;
+		if (dnssec) {
+			level |= DNSSEC;
 		}
 		break;
 	case SEMCHECK_DNSSEC_ON:
-		data.level |= OPTIONAL;
-		data.level |= DNSSEC;
+		level |= OPTIONAL;
+		level |= DNSSEC;
 		break;
 	case SEMCHECK_DNSSEC_OFF:
-		data.level |= OPTIONAL;
+		level |= OPTIONAL;
 		break;
 	default:
 		break;
 	}
 
-	int ret = zone_contents_apply(zone, do_checks_in_tree, &data);
+	return level;
+}
+
+int sem_checks_process(zone_contents_t *zone, zone_tree_t *nodes, semcheck_optional_t optional,
+                       sem_handler_t *handler, unsigned threads, time_t time)
+{
+	if (handler == NULL) {
+		return KNOT_EINVAL;
+	}
+
+	if (zone == NULL) {
+		return KNOT_EEMPTYZONE;
+	}
+
+	semchecks_data_t data = {
+		.handler = handler,
+		.zone = zone,
+		.level = check_level(optional, zone->dnssec, handler),
+		.time = time,
+	};
+
+	int ret;
+	if (nodes != NULL) {
+		ret = zone_tree_apply(nodes, do_checks_in_tree, &data);
+	} else if (threads > 1 && zone_tree_count(zone->nodes) >= PARALLEL_MIN_NODES) {
+		ret = checks_parallel(&data, threads);
+	} else {
+		ret = zone_contents_apply(zone, do_checks_in_tree, &data);
+	}
 	if (ret != KNOT_EOK) {
 		return ret;
 	}
@@ -587,3 +753,25 @@ int sem_checks_process(zone_contents_t *zone, semcheck_optional_t optional, sem_
 
 	return ret;
 }
+
+int sem_checks_node(zone_contents_t *zone, zone_node_t *node,
+                    semcheck_optional_t optional, sem_handler_t *handler)
+{
+	if (zone == NULL || node == NULL || handler == NULL) {
+		return KNOT_EINVAL;
+	}
+
+	bool dnssec = node_rrtype_is_signed(zone->apex, KNOT_RRTYPE_SOA);
+	semchecks_data_t data = {
+		.handler = handler,
+		.zone = zone,
+		.level = check_level(optional, dnssec, handler) | LOCAL,
+	};
+
+	int ret = do_checks_in_tree(node, &data);
+	if (ret != KNOT_EOK) {
+		return ret;
+	}
+
+	return data.handler->fatal_error ? KNOT_ESEMCHECK : KNOT_EOK;
+}
@@ -107,9 +107,14 @@ struct sem_handler {
  *
  * Errors are logged in error handler.
  *
+ * \note With more threads, the zone is split into ranges checked in parallel
+ *       and the errors are reported afterwards in the zone order.
+ *
  * \param zone      Zone to be searched / checked.
+ * \param nodes     Optional: check only these nodes (e.g. those affected by an update).
  * \param optional  To do also optional check.
  * \param handler   Semantic error handler.
+ * \param threads   Number of threads for checking the whole zone.
  * \param time      Check zone at given time (rrsig expiration).
  *
  * \retval KNOT_EOK         no error found
@@ -117,5 +122,24 @@ struct sem_handler {
  * \retval KNOT_EEMPTYZONE  the zone is empty
  * \retval KNOT_EINVAL      another error
  */
-int sem_checks_process(zone_contents_t *zone, semcheck_optional_t optional, sem_handler_t *handler,
-                       time_t time);
+int sem_checks_process(zone_contents_t *zone, zone_tree_t *nodes, semcheck_optional_t optional,
+                       sem_handler_t *handler, unsigned threads, time_t time);
+
+/*!
+ * \brief Check one node without the context of the rest of the zone.
+ *
+ * Only the checks not depending on other nodes (SOA, CNAME, DS, NSEC3PARAM)
+ * are performed, DNSSEC isn't validated. Allows checking of a zone streamed
+ * node by node.
+ *
+ * \param zone      Zone contents with the apex node, other nodes not needed.
+ * \param node      Node to be checked, possibly not in the zone tree.
+ * \param optional  To do also optional check.
+ * \param handler   Semantic error handler.
+ *
+ * \retval KNOT_EOK         no error found
+ * \retval KNOT_ESEMCHECK   found semantic error
+ * \retval KNOT_EINVAL      another error
+ */
+int sem_checks_node(zone_contents_t *zone, zone_node_t *node,
+                    semcheck_optional_t optional, sem_handler_t *handler);
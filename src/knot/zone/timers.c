@@ -14,6 +14,8 @@
     along with this program.  If not, see <https://www.gnu.org/licenses/>.
  */
 
+#include <string.h>
+
 #include "knot/zone/timers.h"
 
 #include "contrib/wire_ctx.h"
@@ -201,22 +203,101 @@ int zone_timers_write(knot_lmdb_db_t *db, const knot_dname_t *zone,
 	return txn.ret;
 }
 
-static void txn_zone_write(zone_t *z, knot_lmdb_txn_t *txn)
+static void txn_zone_write(zone_t *z, knot_lmdb_txn_t *txns, unsigned count)
 {
-	txn_write_timers(txn, z->name, &z->timers);
+	txn_write_timers(&txns[knot_lmdb_shard(z->name, count)], z->name, &z->timers);
 }
 
-int zone_timers_write_all(knot_lmdb_db_t *db, knot_zonedb_t *zonedb)
+static void txn_zone_write_changed(zone_t *z, knot_lmdb_txn_t *txns, unsigned count,
+                                   size_t *written)
 {
-	int ret = knot_lmdb_open(db);
-	if (ret != KNOT_EOK) {
-		return ret;
+	uint64_t hash = zone_timers_hash(&z->timers);
+	if (hash != z->timers_hash) {
+		txn_write_timers(&txns[knot_lmdb_shard(z->name, count)], z->name, &z->timers);
+		z->timers_hash = hash;
+		(*written)++;
 	}
-	knot_lmdb_txn_t txn = { 0 };
-	knot_lmdb_begin(db, &txn, true);
-	knot_zonedb_foreach(zonedb, txn_zone_write, &txn);
-	knot_lmdb_commit(&txn);
-	return txn.ret;
+}
+
+int zone_timers_write_all(knot_lmdb_db_t *dbs, unsigned count, knot_zonedb_t *zonedb)
+{
+	for (unsigned i = 0; i < count; i++) {
+		int ret = knot_lmdb_open(&dbs[i]);
+		if (ret != KNOT_EOK) {
+			return ret;
+		}
+	}
+	knot_lmdb_txn_t txns[count];
+	memset(txns, 0, sizeof(txns));
+	for (unsigned i = 0; i < count; i++) {
+		knot_lmdb_begin(&dbs[i], &txns[i], true);
+	}
+	knot_zonedb_foreach(zonedb, txn_zone_write, txns, count);
+	int ret = KNOT_EOK;
+	for (unsigned i = 0; i < count; i++) {
+		knot_lmdb_commit(&txns[i]);
+		if (ret == KNOT_EOK) {
+			ret = txns[i].ret;
+		}
+	}
+	return ret;
+}
+
+int zone_timers_write_changed(knot_lmdb_db_t *dbs, unsigned count, knot_zonedb_t *zonedb,
+                              size_t *written)
+{
+	for (unsigned i = 0; i < count; i++) {
+		int ret = knot_lmdb_open(&dbs[i]);
+		if (ret != KNOT_EOK) {
+			return ret;
+		}
+	}
+	knot_lmdb_txn_t txns[count];
+	memset(txns, 0, sizeof(txns));
+	for (unsigned i = 0; i < count; i++) {
+		knot_lmdb_begin(&dbs[i], &txns[i], true);
+	}
+	size_t changed = 0;
+	knot_zonedb_foreach(zonedb, txn_zone_write_changed, txns, count, &changed);
+	int ret = KNOT_EOK;
+	for (unsigned i = 0; i < count; i++) {
+		knot_lmdb_commit(&txns[i]);
+		if (ret == KNOT_EOK) {
+			ret = txns[i].ret;
+		}
+	}
+	if (written != NULL) {
+		*written = changed;
+	}
+	return ret;
+}
+
+uint64_t zone_timers_hash(const zone_timers_t *timers)
+{
+	const uint64_t values[] = {
+		timers->last_flush,
+		timers->next_refresh,
+		timers->last_refresh_ok,
+		timers->last_notified_serial,
+		timers->next_ds_check,
+		timers->next_ds_push,
+		timers->catalog_member,
+		timers->next_expire,
+		timers->master_pin_hit,
+	};
+
+	// FNV-1a over the persisted values.
+	uint64_t hash = 14695981039346656037LLU;
+	const uint8_t *data = (const uint8_t *)values;
+	for (size_t i = 0; i < sizeof(values); i++) {
+		hash = (hash ^ data[i]) * 1099511628211LLU;
+	}
+	data = (const uint8_t *)&timers->last_master;
+	for (size_t i = 0; i < sizeof(timers->last_master); i++) {
+		hash = (hash ^ data[i]) * 1099511628211LLU;
+	}
+
+	return hash;
 }
 
 int zone_timers_sweep(knot_lmdb_db_t *db, sweep_cb keep_zone, void *cb_data)
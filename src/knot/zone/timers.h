@@ -78,12 +78,33 @@ int zone_timers_write(knot_lmdb_db_t *db, const knot_dname_t *zone,
 /*!
  * \brief Write timers for all zones.
  *
- * \param db      Timer database.
+ * \param dbs     Timer database shards.
+ * \param count   Number of shards.
+ * \param zonedb  Zones database.
+ *
+ * \return KNOT_E*
+ */
+int zone_timers_write_all(knot_lmdb_db_t *dbs, unsigned count, knot_zonedb_t *zonedb);
+
+/*!
+ * \brief Write timers of the zones whose timers changed since last written.
+ *
+ * All the changed zones are written in one transaction per shard.
+ *
+ * \param dbs     Timer database shards.
+ * \param count   Number of shards.
  * \param zonedb  Zones database.
+ * \param written Optional output: number of written zones.
  *
  * \return KNOT_E*
  */
-int zone_timers_write_all(knot_lmdb_db_t *db, knot_zonedb_t *zonedb);
+int zone_timers_write_changed(knot_lmdb_db_t *dbs, unsigned count, knot_zonedb_t *zonedb,
+                              size_t *written);
+
+/*!
+ * \brief Compute a hash of the timers to detect their change.
+ */
+uint64_t zone_timers_hash(const zone_timers_t *timers);
 
 /*!
  * \brief Selectively delete zones from the database.
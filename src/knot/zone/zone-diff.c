@@ -15,20 +15,32 @@
  */
 
 #include <assert.h>
+#include <pthread.h>
 #include <stdlib.h>
 #include <inttypes.h>
 
 #include "libknot/libknot.h"
 #include "knot/zone/zone-diff.h"
 #include "knot/zone/serial.h"
+#include "contrib/qp-trie/trie.h"
+
+#define PARALLEL_MIN_NODES 10000 // smaller trees are compared by one thread
 
 struct zone_diff_param {
-	zone_tree_t *nodes;
 	changeset_t *changeset;
 	bool ignore_dnssec;
 	bool ignore_zonemd;
 };
 
+typedef struct {
+	struct zone_diff_param param;
+	changeset_t changeset;
+	zone_tree_it_t it1;
+	zone_tree_it_t it2;
+	pthread_t thread;
+	int ret;
+} zone_diff_thread_t;
+
 static bool rrset_is_dnssec(const knot_rrset_t *rrset)
 {
 	switch (rrset->type) {
@@ -169,12 +181,30 @@ static int rdata_return_changes(const knot_rrset_t *rrset1,
 	return KNOT_EOK;
 }
 
+static bool rrsets_same(const knot_rrset_t *rrset1, const knot_rrset_t *rrset2)
+{
+	if (rrset1->ttl != rrset2->ttl && rrset1->type != KNOT_RRTYPE_RRSIG) {
+		return false;
+	}
+
+	// rdata are canonically sorted, so equal sets are equal binary blobs
+	const knot_rdataset_t *rrs1 = &rrset1->rrs, *rrs2 = &rrset2->rrs;
+	return rrs1->count == rrs2->count && rrs1->size == rrs2->size &&
+	       (rrs1->rdata == rrs2->rdata ||
+	        memcmp(rrs1->rdata, rrs2->rdata, rrs1->size) == 0);
+}
+
 static int diff_rrsets(const knot_rrset_t *rrset1, const knot_rrset_t *rrset2,
                        changeset_t *changeset)
 {
 	if (changeset == NULL || (rrset1 == NULL && rrset2 == NULL)) {
 		return KNOT_EINVAL;
 	}
+
+	/* Most RRSets don't change, skip them without comparing each RR. */
+	if (rrset1 != NULL && rrset2 != NULL && rrsets_same(rrset1, rrset2)) {
+		return KNOT_EOK;
+	}
 	/*
 	 * The easiest solution is to remove all the RRs that had no match and
 	 * to add all RRs that had no match, but those from second RRSet. */
@@ -212,28 +242,9 @@ static int diff_rrsets(const knot_rrset_t *rrset1, const knot_rrset_t *rrset2,
 	return KNOT_EOK;
 }
 
-/*!< \todo this could be generic function for adding / removing. */
-static int knot_zone_diff_node(zone_node_t *node, void *data)
+static int diff_nodes(const zone_node_t *node, const zone_node_t *node_in_second_tree,
+                      struct zone_diff_param *param)
 {
-	if (node == NULL || data == NULL) {
-		return KNOT_EINVAL;
-	}
-
-	struct zone_diff_param *param = (struct zone_diff_param *)data;
-	if (param->changeset == NULL) {
-		return KNOT_EINVAL;
-	}
-
-	/*
-	 * First, we have to search the second tree to see if there's according
-	 * node, if not, the whole node has been removed.
-	 */
-	zone_node_t *node_in_second_tree = zone_tree_get(param->nodes, node->owner);
-	if (node_in_second_tree == NULL) {
-		return remove_node(node, param->changeset, param->ignore_dnssec,
-		                   param->ignore_zonemd);
-	}
-
 	assert(node_in_second_tree != node);
 
 	/* The nodes are in both trees, we have to diff each RRSet. */
@@ -307,35 +318,111 @@ static int knot_zone_diff_node(zone_node_t *node, void *data)
 	return KNOT_EOK;
 }
 
-/*!< \todo possibly not needed! */
-static int add_new_nodes(zone_node_t *node, void *data)
+/*!
+ * \brief Compare the trees by walking both of them in the canonical order.
+ *
+ * A node present only in the first tree has been removed, a node present
+ * only in the second one has been added, common nodes are compared.
+ */
+static int diff_trees(zone_tree_it_t *it1, zone_tree_it_t *it2,
+                      struct zone_diff_param *param)
 {
-	if (node == NULL || data == NULL) {
-		return KNOT_EINVAL;
+	int ret = KNOT_EOK;
+	while (ret == KNOT_EOK &&
+	       (!zone_tree_it_finished(it1) || !zone_tree_it_finished(it2))) {
+		zone_node_t *node1 = zone_tree_it_finished(it1) ? NULL : zone_tree_it_val(it1);
+		zone_node_t *node2 = zone_tree_it_finished(it2) ? NULL : zone_tree_it_val(it2);
+
+		int cmp = (node1 == NULL) ? 1 :
+		          (node2 == NULL) ? -1 : knot_dname_cmp(node1->owner, node2->owner);
+		if (cmp < 0) {
+			ret = remove_node(node1, param->changeset, param->ignore_dnssec,
+			                  param->ignore_zonemd);
+			zone_tree_it_next(it1);
+		} else if (cmp > 0) {
+			ret = add_node(node2, param->changeset, param->ignore_dnssec,
+			               param->ignore_zonemd);
+			zone_tree_it_next(it2);
+		} else {
+			ret = diff_nodes(node1, node2, param);
+			zone_tree_it_next(it1);
+			zone_tree_it_next(it2);
+		}
 	}
 
-	struct zone_diff_param *param = (struct zone_diff_param *)data;
-	if (param->changeset == NULL) {
-		return KNOT_EINVAL;
+	return ret;
+}
+
+static void *diff_range_thread(void *arg)
+{
+	zone_diff_thread_t *thr = arg;
+	thr->ret = diff_trees(&thr->it1, &thr->it2, &thr->param);
+	return NULL;
+}
+
+static int load_trees_parallel(zone_tree_t *nodes1, zone_tree_t *nodes2,
+                               struct zone_diff_param *param, unsigned threads)
+{
+	size_t count = threads;
+	zone_diff_thread_t *thrs = calloc(count, sizeof(*thrs));
+	zone_tree_it_t *its = calloc(2 * count, sizeof(*its));
+	if (thrs == NULL || its == NULL) {
+		free(thrs);
+		free(its);
+		return KNOT_ENOMEM;
 	}
 
-	/*
-	* If a node is not present in the second zone, it is a new node
-	* and has to be added to changeset. Differences on the RRSet level are
-	* already handled.
-	*/
-	zone_node_t *new_node = zone_tree_get(param->nodes, node->owner);
-	if (new_node == NULL) {
-		assert(node);
-		return add_node(node, param->changeset, param->ignore_dnssec,
-		                param->ignore_zonemd);
+	int ret = zone_tree_it_double_ranges(nodes1, nodes2, its, its + threads, &count);
+	for (size_t i = 0; i < count; i++) {
+		thrs[i].it1 = its[i];
+		thrs[i].it2 = its[threads + i];
 	}
+	free(its);
 
-	return KNOT_EOK;
+	size_t inited = 0;
+	for ( ; ret == KNOT_EOK && inited < count; inited++) {
+		ret = changeset_init(&thrs[inited].changeset, param->changeset->add->apex->owner);
+		if (ret != KNOT_EOK) {
+			break;
+		}
+		thrs[inited].param = *param;
+		thrs[inited].param.changeset = &thrs[inited].changeset;
+	}
+
+	size_t started = 0;
+	for ( ; ret == KNOT_EOK && started < count; started++) {
+		if (pthread_create(&thrs[started].thread, NULL, diff_range_thread,
+		                   &thrs[started]) != 0) {
+			ret = KNOT_ENOMEM;
+			break;
+		}
+	}
+	for (size_t i = 0; i < started; i++) {
+		pthread_join(thrs[i].thread, NULL);
+		if (ret == KNOT_EOK) {
+			ret = thrs[i].ret;
+		}
+	}
+
+	// the ranges are disjoint, so the partial changesets don't cancel out
+	for (size_t i = 0; i < count; i++) {
+		if (ret == KNOT_EOK && i < inited) {
+			ret = changeset_merge(param->changeset, &thrs[i].changeset, 0);
+		}
+		if (i < inited) {
+			changeset_clear(&thrs[i].changeset);
+		}
+		zone_tree_it_free(&thrs[i].it1);
+		zone_tree_it_free(&thrs[i].it2);
+	}
+	free(thrs);
+
+	return ret;
 }
 
 static int load_trees(zone_tree_t *nodes1, zone_tree_t *nodes2,
-                      changeset_t *changeset, bool ignore_dnssec, bool ignore_zonemd)
+                      changeset_t *changeset, bool ignore_dnssec, bool ignore_zonemd,
+                      unsigned threads)
 {
 	assert(changeset);
 
@@ -345,20 +432,32 @@ static int load_trees(zone_tree_t *nodes1, zone_tree_t *nodes2,
 		.ignore_zonemd = ignore_zonemd,
 	};
 
-	// Traverse one tree, compare every node, each RRSet with its rdata.
-	param.nodes = nodes2;
-	int ret = zone_tree_apply(nodes1, knot_zone_diff_node, &param);
-	if (ret != KNOT_EOK) {
-		return ret;
+	if (threads > 1 && nodes2 != NULL &&
+	    zone_tree_count(nodes1) >= PARALLEL_MIN_NODES) {
+		return load_trees_parallel(nodes1, nodes2, &param, threads);
 	}
 
-	// Some nodes may have been added. Add missing nodes to changeset.
-	param.nodes = nodes1;
-	return zone_tree_apply(nodes2, add_new_nodes, &param);
+	// iteration over a missing tree is finished right away
+	zone_tree_it_t it1 = { 0 }, it2 = { 0 };
+	int ret = KNOT_EOK;
+	if (nodes1 != NULL) {
+		ret = zone_tree_it_begin(nodes1, &it1);
+	}
+	if (ret == KNOT_EOK && nodes2 != NULL) {
+		ret = zone_tree_it_begin(nodes2, &it2);
+	}
+	if (ret == KNOT_EOK) {
+		ret = diff_trees(&it1, &it2, &param);
+	}
+	zone_tree_it_free(&it1);
+	zone_tree_it_free(&it2);
+
+	return ret;
 }
 
 int zone_contents_diff(const zone_contents_t *zone1, const zone_contents_t *zone2,
-                       changeset_t *changeset, bool ignore_dnssec, bool ignore_zonemd)
+                       changeset_t *changeset, bool ignore_dnssec, bool ignore_zonemd,
+                       unsigned threads)
 {
 	if (changeset == NULL) {
 		return KNOT_EINVAL;
@@ -374,13 +473,13 @@ int zone_contents_diff(const zone_contents_t *zone1, const zone_contents_t *zone
 	}
 
 	int ret = load_trees(zone1->nodes, zone2->nodes, changeset,
-	                     ignore_dnssec, ignore_zonemd);
+	                     ignore_dnssec, ignore_zonemd, threads);
 	if (ret != KNOT_EOK) {
 		return ret;
 	}
 
 	ret = load_trees(zone1->nsec3_nodes, zone2->nsec3_nodes, changeset,
-	                 ignore_dnssec, ignore_zonemd);
+	                 ignore_dnssec, ignore_zonemd, threads);
 	if (ret != KNOT_EOK) {
 		return ret;
 	}
@@ -398,5 +497,264 @@ int zone_tree_add_diff(zone_tree_t *t1, zone_tree_t *t2, changeset_t *changeset)
 		return KNOT_EINVAL;
 	}
 
-	return load_trees(t1, t2, changeset, false, false);
+	return load_trees(t1, t2, changeset, false, false, 1);
+}
+
+struct zone_diff_stream {
+	const zone_contents_t *old;
+	changeset_t *changeset;
+	knot_rrset_t *soa;   // New SOA.
+	trie_t *seen;        // Owner + type -> bitmap of matched old records.
+	bool ignore_dnssec;
+	bool ignore_zonemd;
+};
+
+static bool stream_ignored(const zone_diff_stream_t *stream, const knot_rrset_t *rr)
+{
+	return (stream->ignore_dnssec && rrset_is_dnssec(rr)) ||
+	       (stream->ignore_zonemd && rr->type == KNOT_RRTYPE_ZONEMD);
+}
+
+static size_t stream_key(const knot_dname_t *owner, uint16_t type,
+                         uint8_t key[KNOT_DNAME_MAXLEN + sizeof(type)])
+{
+	knot_dname_storage_t lf_storage;
+	uint8_t *lf = knot_dname_lf(owner, lf_storage);
+	assert(lf);
+
+	memcpy(key, lf + 1, *lf);
+	knot_wire_write_u16(key + *lf, type);
+	return *lf + sizeof(type);
+}
+
+static const zone_node_t *stream_node(const zone_contents_t *zone, const knot_rrset_t *rr)
+{
+	if (knot_rrset_is_nsec3rel(rr)) {
+		return zone_contents_find_nsec3_node(zone, rr->owner);
+	} else {
+		return zone_contents_find_node(zone, rr->owner);
+	}
+}
+
+/*! \brief Marks the record if present in the old contents. */
+static int stream_match(zone_diff_stream_t *stream, const knot_rrset_t *rr,
+                        const knot_rdata_t *rd, bool *matched)
+{
+	*matched = false;
+
+	const zone_node_t *node = stream_node(stream->old, rr);
+	knot_rrset_t old = node_rrset(node, rr->type);
+	if (knot_rrset_empty(&old) || old.ttl != rr->ttl) {
+		return KNOT_EOK;
+	}
+
+	uint16_t pos = 0;
+	knot_rdata_t *old_rd = old.rrs.rdata;
+	for (; pos < old.rrs.count; pos++, old_rd = knot_rdataset_next(old_rd)) {
+		int cmp = knot_rdata_cmp(old_rd, rd);
+		if (cmp == 0) {
+			break;
+		} else if (cmp > 0) { // Canonically ordered.
+			return KNOT_EOK;
+		}
+	}
+	if (pos == old.rrs.count) {
+		return KNOT_EOK;
+	}
+
+	uint8_t key[KNOT_DNAME_MAXLEN + sizeof(uint16_t)];
+	size_t key_len = stream_key(rr->owner, rr->type, key);
+	trie_val_t *val = trie_get_ins(stream->seen, key, key_len);
+	if (val == NULL) {
+		return KNOT_ENOMEM;
+	}
+	if (*val == NULL) {
+		*val = calloc((old.rrs.count + 7) / 8, 1);
+		if (*val == NULL) {
+			return KNOT_ENOMEM;
+		}
+	}
+	uint8_t *bits = *val;
+	bits[pos / 8] |= 1 << (pos % 8);
+
+	*matched = true;
+	return KNOT_EOK;
+}
+
+zone_diff_stream_t *zone_diff_stream_new(const zone_contents_t *old, changeset_t *changeset,
+                                         bool ignore_dnssec, bool ignore_zonemd)
+{
+	if (old == NULL || changeset == NULL) {
+		return NULL;
+	}
+
+	zone_diff_stream_t *stream = calloc(1, sizeof(*stream));
+	if (stream == NULL) {
+		return NULL;
+	}
+
+	stream->seen = trie_create(NULL);
+	if (stream->seen == NULL) {
+		free(stream);
+		return NULL;
+	}
+	stream->old = old;
+	stream->changeset = changeset;
+	stream->ignore_dnssec = ignore_dnssec;
+	stream->ignore_zonemd = ignore_zonemd;
+
+	return stream;
+}
+
+int zone_diff_stream_add(zone_diff_stream_t *stream, const knot_rrset_t *rr)
+{
+	if (stream == NULL || rr == NULL) {
+		return KNOT_EINVAL;
+	}
+
+	if (rr->type == KNOT_RRTYPE_SOA &&
+	    knot_dname_is_equal(rr->owner, stream->old->apex->owner)) {
+		if (stream->soa == NULL) {
+			stream->soa = knot_rrset_copy(rr, NULL);
+			if (stream->soa == NULL) {
+				return KNOT_ENOMEM;
+			}
+		}
+		return KNOT_EOK;
+	} else if (stream_ignored(stream, rr)) {
+		return KNOT_EOK;
+	}
+
+	knot_rdata_t *rd = rr->rrs.rdata;
+	for (uint16_t i = 0; i < rr->rrs.count; i++, rd = knot_rdataset_next(rd)) {
+		bool matched = false;
+		int ret = stream_match(stream, rr, rd, &matched);
+		if (ret == KNOT_EOK && !matched) {
+			knot_rrset_t add = *rr;
+			add.rrs.count = 1;
+			add.rrs.size = knot_rdata_size(rd->len);
+			add.rrs.rdata = rd;
+			ret = changeset_add_addition(stream->changeset, &add, 0);
+		}
+		if (ret != KNOT_EOK) {
+			return ret;
+		}
+	}
+
+	return KNOT_EOK;
+}
+
+knot_rrset_t *zone_diff_stream_soa(zone_diff_stream_t *stream)
+{
+	return (stream != NULL) ? stream->soa : NULL;
+}
+
+static int stream_removals(zone_diff_stream_t *stream, zone_tree_t *tree)
+{
+	if (tree == NULL) {
+		return KNOT_EOK;
+	}
+
+	zone_tree_it_t it = { 0 };
+	int ret = zone_tree_it_begin(tree, &it);
+	for (; ret == KNOT_EOK && !zone_tree_it_finished(&it); zone_tree_it_next(&it)) {
+		const zone_node_t *node = zone_tree_it_val(&it);
+		for (unsigned i = 0; ret == KNOT_EOK && i < node->rrset_count; i++) {
+			knot_rrset_t rrset = node_rrset_at(node, i);
+			if (rrset.type == KNOT_RRTYPE_SOA || stream_ignored(stream, &rrset)) {
+				continue;
+			}
+
+			uint8_t key[KNOT_DNAME_MAXLEN + sizeof(uint16_t)];
+			size_t key_len = stream_key(rrset.owner, rrset.type, key);
+			trie_val_t *val = trie_get_try(stream->seen, key, key_len);
+			if (val == NULL) { // Nothing matched.
+				ret = changeset_add_removal(stream->changeset, &rrset, 0);
+				continue;
+			}
+
+			const uint8_t *bits = *val;
+			knot_rdata_t *rd = rrset.rrs.rdata;
+			for (uint16_t pos = 0; ret == KNOT_EOK && pos < rrset.rrs.count;
+			     pos++, rd = knot_rdataset_next(rd)) {
+				if (bits[pos / 8] & (1 << (pos % 8))) {
+					continue;
+				}
+				knot_rrset_t rem = rrset;
+				rem.rrs.count = 1;
+				rem.rrs.size = knot_rdata_size(rd->len);
+				rem.rrs.rdata = rd;
+				ret = changeset_add_removal(stream->changeset, &rem, 0);
+			}
+		}
+	}
+	zone_tree_it_free(&it);
+
+	return ret;
+}
+
+int zone_diff_stream_finish(zone_diff_stream_t *stream)
+{
+	if (stream == NULL) {
+		return KNOT_EINVAL;
+	} else if (stream->soa == NULL) {
+		return KNOT_ESEMCHECK;
+	}
+
+	knot_rrset_t old_soa = node_rrset(stream->old->apex, KNOT_RRTYPE_SOA);
+	if (knot_rrset_empty(&old_soa)) {
+		return KNOT_EINVAL;
+	}
+
+	uint32_t old_serial = knot_soa_serial(old_soa.rrs.rdata);
+	uint32_t new_serial = knot_soa_serial(stream->soa->rrs.rdata);
+	int ret_soa = KNOT_EOK;
+	switch (serial_compare(old_serial, new_serial)) {
+	case SERIAL_EQUAL:
+		ret_soa = KNOT_ENODIFF;
+		break;
+	case SERIAL_LOWER:
+		break;
+	default:
+		return KNOT_ERANGE;
+	}
+
+	int ret = stream_removals(stream, stream->old->nodes);
+	if (ret == KNOT_EOK) {
+		ret = stream_removals(stream, stream->old->nsec3_nodes);
+	}
+	if (ret != KNOT_EOK) {
+		return ret;
+	}
+
+	if (ret_soa == KNOT_ENODIFF) {
+		return changeset_empty(stream->changeset) ? KNOT_ENODIFF : KNOT_ESEMCHECK;
+	}
+
+	changeset_t *ch = stream->changeset;
+	ch->soa_from = knot_rrset_copy(&old_soa, NULL);
+	ch->soa_to = knot_rrset_copy(stream->soa, NULL);
+	if (ch->soa_from == NULL || ch->soa_to == NULL) {
+		return KNOT_ENOMEM;
+	}
+
+	return KNOT_EOK;
+}
+
+static int free_bits(trie_val_t *val, void *ctx)
+{
+	free(*val);
+	return KNOT_EOK;
+}
+
+void zone_diff_stream_free(zone_diff_stream_t *stream)
+{
+	if (stream == NULL) {
+		return;
+	}
+
+	trie_apply(stream->seen, free_bits, NULL);
+	trie_free(stream->seen);
+	knot_rrset_free(stream->soa, NULL);
+	free(stream);
 }
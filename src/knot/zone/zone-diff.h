@@ -21,11 +21,62 @@
 
 /*!
  * \brief Create diff between two zone trees.
+ *
+ * \note With more threads, big zones are compared in parallel by ranges.
  * */
 int zone_contents_diff(const zone_contents_t *zone1, const zone_contents_t *zone2,
-                       changeset_t *changeset, bool ignore_dnssec, bool ignore_zonemd);
+                       changeset_t *changeset, bool ignore_dnssec, bool ignore_zonemd,
+                       unsigned threads);
 
 /*!
  * \brief Add diff between two zone trees into the changeset.
  */
 int zone_tree_add_diff(zone_tree_t *t1, zone_tree_t *t2, changeset_t *changeset);
+
+/*!
+ * \brief Comparison of zone contents with records received one by one.
+ *
+ * The received records are matched against the current zone contents,
+ * only those missing are stored (as changeset additions), the matched
+ * ones are just marked. Once all records are received, unmarked records
+ * of the current contents make the removals. The differences are thus
+ * obtained without building a second copy of the zone.
+ */
+typedef struct zone_diff_stream zone_diff_stream_t;
+
+/*!
+ * \brief Start a streamed comparison.
+ *
+ * \param old            Current zone contents, mustn't change until finished.
+ * \param changeset      Initialized empty changeset to be filled.
+ * \param ignore_dnssec  Skip DNSSEC records (RRSIG, NSEC, NSEC3).
+ * \param ignore_zonemd  Skip ZONEMD records.
+ *
+ * \return Comparison context or NULL if error.
+ */
+zone_diff_stream_t *zone_diff_stream_new(const zone_contents_t *old, changeset_t *changeset,
+                                         bool ignore_dnssec, bool ignore_zonemd);
+
+/*!
+ * \brief Compare a received record with the current contents.
+ *
+ * \note The first apex SOA is taken as the new SOA, following ones are ignored.
+ */
+int zone_diff_stream_add(zone_diff_stream_t *stream, const knot_rrset_t *rr);
+
+/*!
+ * \brief Get the received SOA, it can be modified before finishing.
+ */
+knot_rrset_t *zone_diff_stream_soa(zone_diff_stream_t *stream);
+
+/*!
+ * \brief Complete the changeset with removals and SOAs.
+ *
+ * \return The same as zone_contents_diff().
+ */
+int zone_diff_stream_finish(zone_diff_stream_t *stream);
+
+/*!
+ * \brief Free the comparison context (the changeset is kept).
+ */
+void zone_diff_stream_free(zone_diff_stream_t *stream);
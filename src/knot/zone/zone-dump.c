@@ -15,17 +15,36 @@
  */
 
 #include <inttypes.h>
+#include <pthread.h>
 
 #include "knot/dnssec/zone-nsec.h"
 #include "knot/zone/zone-dump.h"
+#include "contrib/macros.h"
 #include "libknot/libknot.h"
 
 /*! \brief Size of auxiliary buffer. */
 #define DUMP_BUF_LEN (70 * 1024)
 
+/*! \brief Number of nodes formatted into one chunk by parallel dump. */
+#define DUMP_CHUNK_NODES 4096
+/*! \brief Smaller trees are dumped by one thread. */
+#define DUMP_PARALLEL_MIN 10000
+
+/*! \brief Text of a tree range formatted by a worker thread. */
+typedef struct {
+	zone_tree_it_t it;
+	char     *text;
+	size_t   len;
+	size_t   max;
+	uint64_t rr_count;
+	int      ret;
+	bool     done;
+} dump_chunk_t;
+
 /*! \brief Dump parameters. */
 typedef struct {
 	FILE     *file;
+	dump_chunk_t *chunk; // if set, the text is appended to the chunk instead of file
 	char     *buf;
 	size_t   buflen;
 	uint64_t rr_count;
@@ -36,6 +55,30 @@ typedef struct {
 	const char *first_comment;
 } dump_params_t;
 
+static int dump_write(dump_params_t *params, const char *str, size_t len)
+{
+	dump_chunk_t *chunk = params->chunk;
+	if (chunk == NULL) {
+		fwrite(str, 1, len, params->file);
+		return KNOT_EOK;
+	}
+
+	if (chunk->len + len > chunk->max) {
+		size_t new_max = MAX(2 * chunk->max, chunk->len + len);
+		new_max = MAX(new_max, DUMP_BUF_LEN);
+		char *new_text = realloc(chunk->text, new_max);
+		if (new_text == NULL) {
+			return KNOT_ENOMEM;
+		}
+		chunk->text = new_text;
+		chunk->max = new_max;
+	}
+	memcpy(chunk->text + chunk->len, str, len);
+	chunk->len += len;
+
+	return KNOT_EOK;
+}
+
 static int apex_node_dump_text(zone_node_t *node, dump_params_t *params)
 {
 	knot_rrset_t soa = node_rrset(node, KNOT_RRTYPE_SOA);
@@ -48,8 +91,11 @@ static int apex_node_dump_text(zone_node_t *node, dump_params_t *params)
 			return ret;
 		}
 		params->rr_count += soa.rrs.count;
-		fprintf(params->file, "%s", params->buf);
+		ret = dump_write(params, params->buf, ret);
 		params->buf[0] = '\0';
+		if (ret != KNOT_EOK) {
+			return ret;
+		}
 	}
 
 	// Dump other records.
@@ -72,8 +118,11 @@ static int apex_node_dump_text(zone_node_t *node, dump_params_t *params)
 			return ret;
 		}
 		params->rr_count +=  rrset.rrs.count;
-		fprintf(params->file, "%s", params->buf);
+		ret = dump_write(params, params->buf, ret);
 		params->buf[0] = '\0';
+		if (ret != KNOT_EOK) {
+			return ret;
+		}
 	}
 
 	return KNOT_EOK;
@@ -86,8 +135,8 @@ static int node_dump_text(zone_node_t *node, void *data)
 	// Zone apex rrsets.
 	if (node->owner == params->origin && !params->dump_rrsig &&
 	    !params->dump_nsec) {
-		apex_node_dump_text(node, params);
-		return KNOT_EOK;
+		int ret = apex_node_dump_text(node, params);
+		return (ret == KNOT_ENOMEM) ? ret : KNOT_EOK;
 	}
 
 	// Dump non-apex rrsets.
@@ -118,7 +167,8 @@ static int node_dump_text(zone_node_t *node, void *data)
 
 		// Dump block comment if available.
 		if (params->first_comment != NULL) {
-			fprintf(params->file, "%s", params->first_comment);
+			(void)dump_write(params, params->first_comment,
+			                 strlen(params->first_comment));
 			params->first_comment = NULL;
 		}
 
@@ -128,14 +178,169 @@ static int node_dump_text(zone_node_t *node, void *data)
 			return ret;
 		}
 		params->rr_count += rrset.rrs.count;
-		fprintf(params->file, "%s", params->buf);
+		ret = dump_write(params, params->buf, ret);
 		params->buf[0] = '\0';
+		if (ret != KNOT_EOK) {
+			return ret;
+		}
 	}
 
 	return KNOT_EOK;
 }
 
-int zone_dump_text(zone_contents_t *zone, FILE *file, bool comments, const char *color)
+/*!
+ * \brief Shared state of parallel dump.
+ *
+ * Worker threads format consecutive tree ranges into chunks, the calling
+ * thread writes the finished chunks in order. At most 'window' chunks
+ * are formatted ahead of the last written one to bound the memory.
+ */
+typedef struct {
+	dump_chunk_t *chunks;
+	size_t count;
+	size_t next;     // next chunk to be formatted
+	size_t written;  // chunks already written
+	size_t window;
+	bool abort;
+	const dump_params_t *params;
+	pthread_mutex_t mx;
+	pthread_cond_t cond;
+} dump_pipe_t;
+
+static void *dump_thread(void *arg)
+{
+	dump_pipe_t *pipe = arg;
+
+	dump_params_t params = *pipe->params;
+	params.buf = malloc(DUMP_BUF_LEN);
+	params.buflen = DUMP_BUF_LEN;
+	params.first_comment = NULL; // written by the writer
+
+	while (true) {
+		pthread_mutex_lock(&pipe->mx);
+		while (!pipe->abort && pipe->next < pipe->count &&
+		       pipe->next >= pipe->written + pipe->window) {
+			pthread_cond_wait(&pipe->cond, &pipe->mx);
+		}
+		if (pipe->abort || pipe->next == pipe->count) {
+			pthread_mutex_unlock(&pipe->mx);
+			break;
+		}
+		dump_chunk_t *chunk = &pipe->chunks[pipe->next++];
+		pthread_mutex_unlock(&pipe->mx);
+
+		params.chunk = chunk;
+		params.rr_count = 0;
+		int ret = (params.buf == NULL) ? KNOT_ENOMEM : KNOT_EOK;
+		while (ret == KNOT_EOK && !zone_tree_it_finished(&chunk->it)) {
+			ret = node_dump_text(zone_tree_it_val(&chunk->it), &params);
+			zone_tree_it_next(&chunk->it);
+		}
+
+		pthread_mutex_lock(&pipe->mx);
+		chunk->rr_count = params.rr_count;
+		chunk->ret = ret;
+		chunk->done = true;
+		pthread_cond_broadcast(&pipe->cond);
+		pthread_mutex_unlock(&pipe->mx);
+	}
+
+	free(params.buf);
+	return NULL;
+}
+
+static int dump_tree_parallel(zone_tree_t *tree, dump_params_t *params,
+                              unsigned threads)
+{
+	size_t count = zone_tree_count(tree) / DUMP_CHUNK_NODES + 1;
+	zone_tree_it_t *its = calloc(count, sizeof(*its));
+	dump_pipe_t pipe = {
+		.chunks = calloc(count, sizeof(*pipe.chunks)),
+		.window = 2 * threads,
+		.params = params,
+	};
+	if (its == NULL || pipe.chunks == NULL) {
+		free(its);
+		free(pipe.chunks);
+		return KNOT_ENOMEM;
+	}
+
+	int ret = zone_tree_it_ranges(tree, its, &count);
+	for (size_t i = 0; i < count; i++) {
+		pipe.chunks[i].it = its[i];
+	}
+	free(its);
+	pipe.count = count;
+	pthread_mutex_init(&pipe.mx, NULL);
+	pthread_cond_init(&pipe.cond, NULL);
+
+	pthread_t thread[threads];
+	unsigned started = 0;
+	for ( ; ret == KNOT_EOK && started < threads; started++) {
+		if (pthread_create(&thread[started], NULL, dump_thread, &pipe) != 0) {
+			break;
+		}
+	}
+	if (ret == KNOT_EOK && started == 0) {
+		ret = KNOT_ENOMEM;
+	}
+
+	for (size_t i = 0; ret == KNOT_EOK && i < count; i++) {
+		dump_chunk_t *chunk = &pipe.chunks[i];
+		pthread_mutex_lock(&pipe.mx);
+		while (!chunk->done) {
+			pthread_cond_wait(&pipe.cond, &pipe.mx);
+		}
+		pthread_mutex_unlock(&pipe.mx);
+
+		ret = chunk->ret;
+		if (ret == KNOT_EOK && chunk->len > 0) {
+			if (params->first_comment != NULL) {
+				fputs(params->first_comment, params->file);
+				params->first_comment = NULL;
+			}
+			fwrite(chunk->text, 1, chunk->len, params->file);
+		}
+		params->rr_count += chunk->rr_count;
+		free(chunk->text);
+		chunk->text = NULL;
+
+		pthread_mutex_lock(&pipe.mx);
+		pipe.written++;
+		pthread_cond_broadcast(&pipe.cond);
+		pthread_mutex_unlock(&pipe.mx);
+	}
+
+	pthread_mutex_lock(&pipe.mx);
+	pipe.abort = true; // stop the workers on error
+	pthread_cond_broadcast(&pipe.cond);
+	pthread_mutex_unlock(&pipe.mx);
+	for (unsigned i = 0; i < started; i++) {
+		pthread_join(thread[i], NULL);
+	}
+
+	for (size_t i = 0; i < count; i++) {
+		free(pipe.chunks[i].text);
+		zone_tree_it_free(&pipe.chunks[i].it);
+	}
+	free(pipe.chunks);
+	pthread_cond_destroy(&pipe.cond);
+	pthread_mutex_destroy(&pipe.mx);
+
+	return ret;
+}
+
+static int dump_tree(zone_tree_t *tree, dump_params_t *params, unsigned threads)
+{
+	if (threads > 1 && zone_tree_count(tree) >= DUMP_PARALLEL_MIN) {
+		return dump_tree_parallel(tree, params, threads);
+	}
+
+	return zone_tree_apply(tree, node_dump_text, params);
+}
+
+int zone_dump_text(zone_contents_t *zone, FILE *file, bool comments, const char *color,
+                   unsigned threads)
 {
 	if (file == NULL) {
 		return KNOT_EINVAL;
@@ -171,7 +376,7 @@ int zone_dump_text(zone_contents_t *zone, FILE *file, bool comments, const char
 	};
 
 	// Dump standard zone records without RRSIGS.
-	int ret = zone_contents_apply(zone, node_dump_text, &params);
+	int ret = dump_tree(zone->nodes, &params, threads);
 	if (ret != KNOT_EOK) {
 		free(params.buf);
 		return ret;
@@ -181,7 +386,7 @@ int zone_dump_text(zone_contents_t *zone, FILE *file, bool comments, const char
 	params.dump_rrsig = true;
 	params.dump_nsec = false;
 	params.first_comment = comments ? ";; DNSSEC signatures\n" : NULL;
-	ret = zone_contents_apply(zone, node_dump_text, &params);
+	ret = dump_tree(zone->nodes, &params, threads);
 	if (ret != KNOT_EOK) {
 		free(params.buf);
 		return ret;
@@ -191,7 +396,7 @@ int zone_dump_text(zone_contents_t *zone, FILE *file, bool comments, const char
 	params.dump_rrsig = false;
 	params.dump_nsec = true;
 	params.first_comment = comments ? ";; DNSSEC NSEC chain\n" : NULL;
-	ret = zone_contents_apply(zone, node_dump_text, &params);
+	ret = dump_tree(zone->nodes, &params, threads);
 	if (ret != KNOT_EOK) {
 		free(params.buf);
 		return ret;
@@ -201,7 +406,7 @@ int zone_dump_text(zone_contents_t *zone, FILE *file, bool comments, const char
 	params.dump_rrsig = false;
 	params.dump_nsec = true;
 	params.first_comment = comments ? ";; DNSSEC NSEC3 chain\n" : NULL;
-	ret = zone_contents_nsec3_apply(zone, node_dump_text, &params);
+	ret = dump_tree(zone->nsec3_nodes, &params, threads);
 	if (ret != KNOT_EOK) {
 		free(params.buf);
 		return ret;
@@ -210,7 +415,7 @@ int zone_dump_text(zone_contents_t *zone, FILE *file, bool comments, const char
 	params.dump_rrsig = true;
 	params.dump_nsec = false;
 	params.first_comment = comments ? ";; DNSSEC NSEC3 signatures\n" : NULL;
-	ret = zone_contents_nsec3_apply(zone, node_dump_text, &params);
+	ret = dump_tree(zone->nsec3_nodes, &params, threads);
 	if (ret != KNOT_EOK) {
 		free(params.buf);
 		return ret;
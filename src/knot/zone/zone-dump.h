@@ -25,8 +25,10 @@
  * \param file      File to write to.
  * \param comments  Add separating comments indicator.
  * \param color     Optional color control sequence.
+ * \param threads   Number of threads formatting the records of big zones.
  *
  * \retval KNOT_EOK on success.
  * \retval < 0 if error.
  */
-int zone_dump_text(zone_contents_t *zone, FILE *file, bool comments, const char *color);
+int zone_dump_text(zone_contents_t *zone, FILE *file, bool comments, const char *color,
+                   unsigned threads);
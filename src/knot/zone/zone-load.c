@@ -14,6 +14,9 @@
     along with this program.  If not, see <https://www.gnu.org/licenses/>.
  */
 
+#include <pthread.h>
+
+#include "contrib/macros.h"
 #include "knot/common/log.h"
 #include "knot/journal/journal_metadata.h"
 #include "knot/journal/journal_read.h"
@@ -26,20 +29,35 @@
 
 int zone_load_contents(conf_t *conf, const knot_dname_t *zone_name,
                        zone_contents_t **contents, semcheck_optional_t semcheck_mode,
-                       bool fail_on_warning)
+                       bool fail_on_warning, knot_lmdb_db_t *kaspdb)
 {
 	if (conf == NULL || zone_name == NULL || contents == NULL) {
 		return KNOT_EINVAL;
 	}
 
 	char *zonefile = conf_zonefile(conf, zone_name);
+	int ret = zone_load_contents_file(conf, zone_name, zonefile, contents,
+	                                  semcheck_mode, fail_on_warning, kaspdb);
+	free(zonefile);
+
+	return ret;
+}
+
+int zone_load_contents_file(conf_t *conf, const knot_dname_t *zone_name,
+                            const char *zonefile, zone_contents_t **contents,
+                            semcheck_optional_t semcheck_mode, bool fail_on_warning,
+                            knot_lmdb_db_t *kaspdb)
+{
+	if (conf == NULL || zone_name == NULL || zonefile == NULL || contents == NULL) {
+		return KNOT_EINVAL;
+	}
+
 	conf_val_t val = conf_zone_get(conf, C_DEFAULT_TTL, zone_name);
 	uint32_t dflt_ttl = conf_int(&val);
 
 	zloader_t zl;
 	int ret = zonefile_open(&zl, zonefile, zone_name, dflt_ttl,
 	                        semcheck_mode, time(NULL));
-	free(zonefile);
 	if (ret != KNOT_EOK) {
 		return ret;
 	}
@@ -51,6 +69,28 @@ int zone_load_contents(conf_t *conf, const knot_dname_t *zone_name,
 	zl.err_handler = &handler;
 	zl.creator->master = !zone_load_can_bootstrap(conf, zone_name);
 
+	val = conf_zone_get(conf, C_LOAD_ARENA, zone_name);
+	if (conf_bool(&val)) {
+		val = conf_zone_get(conf, C_LOAD_HUGEPAGES, zone_name);
+		ret = zone_contents_use_arena(zl.creator->z, conf_opt(&val));
+		if (ret != KNOT_EOK) {
+			zone_contents_deep_free(zl.creator->z);
+			zonefile_close(&zl);
+			return ret;
+		}
+	}
+
+	val = conf_zone_get(conf, C_LOAD_INPUT, zone_name);
+	(void)zs_set_input_mode(&zl.scanner, conf_opt(&val));
+
+	val = conf_zone_get(conf, C_LOAD_THR, zone_name);
+	zl.threads = conf_int(&val);
+
+	val = conf_zone_get(conf, C_NSEC3_HASH_CACHE, zone_name);
+	if (conf_bool(&val)) {
+		zl.nsec3_cache = kaspdb;
+	}
+
 	*contents = zonefile_load(&zl);
 	zonefile_close(&zl);
 	if (*contents == NULL) {
@@ -82,6 +122,153 @@ static int apply_one_cb(bool remove, const knot_rrset_t *rr, void *ctx)
 	}
 }
 
+// Minimal number of changesets squashed by one replay thread.
+#define REPLAY_RANGE_MIN 16
+
+typedef struct {
+	zone_journal_t j;
+	uint32_t from;     // Serial-from of the first changeset of the range.
+	size_t count;      // Number of changesets in the range.
+	changeset_t ch;    // Squashed range.
+	size_t squashed;
+	int ret;
+} replay_range_t;
+
+static void *squash_range(void *arg)
+{
+	replay_range_t *r = arg;
+
+	journal_read_t *read = NULL;
+	r->ret = journal_read_begin(r->j, false, r->from, &read);
+
+	changeset_t ch;
+	while (r->ret == KNOT_EOK && r->squashed < r->count &&
+	       journal_read_changeset(read, &ch)) {
+		if (r->squashed++ == 0) {
+			r->ch = ch;
+			continue;
+		}
+		r->ret = changeset_merge(&r->ch, &ch, 0);
+		journal_read_clear_changeset(&ch);
+	}
+	r->ret = journal_read_get_error(read, r->ret);
+	journal_read_end(read);
+
+	if (r->ret == KNOT_EOK && r->squashed != r->count) {
+		r->ret = KNOT_EMALF;
+	}
+
+	return NULL;
+}
+
+static int apply_squashed(zone_contents_t *contents, const changeset_t *ch)
+{
+	changeset_iter_t itt;
+	int ret = apply_one_cb(true, ch->soa_from, contents);
+	if (ret == KNOT_EOK) {
+		ret = changeset_iter_rem(&itt, ch);
+	}
+	for (knot_rrset_t rr = { 0 }; ret == KNOT_EOK; ) {
+		rr = changeset_iter_next(&itt);
+		if (knot_rrset_empty(&rr)) {
+			changeset_iter_clear(&itt);
+			break;
+		}
+		ret = apply_one_cb(true, &rr, contents);
+		if (ret != KNOT_EOK) {
+			changeset_iter_clear(&itt);
+		}
+	}
+
+	if (ret == KNOT_EOK) {
+		ret = apply_one_cb(false, ch->soa_to, contents);
+	}
+	if (ret == KNOT_EOK) {
+		ret = changeset_iter_add(&itt, ch);
+	}
+	for (knot_rrset_t rr = { 0 }; ret == KNOT_EOK; ) {
+		rr = changeset_iter_next(&itt);
+		if (knot_rrset_empty(&rr)) {
+			changeset_iter_clear(&itt);
+			break;
+		}
+		ret = apply_one_cb(false, &rr, contents);
+		if (ret != KNOT_EOK) {
+			changeset_iter_clear(&itt);
+		}
+	}
+
+	return ret;
+}
+
+/*!
+ * Squashes ranges of the journal changesets in parallel, merges them into
+ * one net changeset and applies it at once.
+ *
+ * \retval KNOT_ENOTSUP if the history is too short to be worth it.
+ */
+static int replay_squashed(zone_t *zone, zone_contents_t *contents,
+                           uint32_t serial, unsigned threads)
+{
+	zone_journal_t j = zone_journal(zone);
+	size_t count = 0;
+	int ret = journal_chain_serials(j, serial, NULL, SIZE_MAX, &count);
+	if (ret != KNOT_EOK || count < 2 * REPLAY_RANGE_MIN) {
+		return KNOT_ENOTSUP;
+	}
+
+	uint32_t *serials = malloc(count * sizeof(*serials));
+	if (serials == NULL) {
+		return KNOT_ENOMEM;
+	}
+	ret = journal_chain_serials(j, serial, serials, count, &count);
+	if (ret != KNOT_EOK) {
+		free(serials);
+		return ret;
+	}
+
+	threads = MIN(threads, count / REPLAY_RANGE_MIN);
+	replay_range_t ranges[threads];
+	pthread_t thread[threads];
+	bool started[threads];
+	for (unsigned i = 0; i < threads; i++) {
+		size_t begin = i * count / threads, end = (i + 1) * count / threads;
+		ranges[i] = (replay_range_t) {
+			.j = j,
+			.from = serials[begin],
+			.count = end - begin,
+		};
+		started[i] = (pthread_create(&thread[i], NULL, squash_range, &ranges[i]) == 0);
+	}
+	free(serials);
+
+	for (unsigned i = 0; i < threads; i++) {
+		if (started[i]) {
+			pthread_join(thread[i], NULL);
+		} else {
+			(void)squash_range(&ranges[i]);
+		}
+		if (ret == KNOT_EOK) {
+			ret = ranges[i].ret;
+		}
+	}
+
+	for (unsigned i = 1; i < threads && ret == KNOT_EOK; i++) {
+		ret = changeset_merge(&ranges[0].ch, &ranges[i].ch, 0);
+	}
+	if (ret == KNOT_EOK) {
+		ret = apply_squashed(contents, &ranges[0].ch);
+	}
+
+	for (unsigned i = 0; i < threads; i++) {
+		if (ranges[i].squashed > 0) {
+			changeset_clear(&ranges[i].ch);
+		}
+	}
+
+	return ret;
+}
+
 int zone_load_journal(conf_t *conf, zone_t *zone, zone_contents_t *contents)
 {
 	if (conf == NULL || zone == NULL) {
@@ -94,18 +281,27 @@ int zone_load_journal(conf_t *conf, zone_t *zone, zone_contents_t *contents)
 	}
 	uint32_t serial = zone_contents_serial(contents);
 
-	journal_read_t *read = NULL;
-	int ret = journal_read_begin(zone_journal(zone), false, serial, &read);
-	switch (ret) {
-	case KNOT_EOK:
-		break;
-	case KNOT_ENOENT:
-		return KNOT_EOK;
-	default:
-		return ret;
+	conf_val_t val = conf_zone_get(conf, C_LOAD_THR, zone->name);
+	unsigned threads = conf_int(&val);
+
+	int ret = KNOT_ENOTSUP;
+	if (threads > 1) {
+		ret = replay_squashed(zone, contents, serial, threads);
 	}
+	if (ret == KNOT_ENOTSUP) {
+		journal_read_t *read = NULL;
+		ret = journal_read_begin(zone_journal(zone), false, serial, &read);
+		switch (ret) {
+		case KNOT_EOK:
+			break;
+		case KNOT_ENOENT:
+			return KNOT_EOK;
+		default:
+			return ret;
+		}
 
-	ret = journal_read_rrsets(read, apply_one_cb, contents);
+		ret = journal_read_rrsets(read, apply_one_cb, contents);
+	}
 	if (ret == KNOT_EOK) {
 		log_zone_info(zone->name, "changes from journal applied, serial %u -> %u",
 		              serial, zone_contents_serial(contents));
@@ -129,6 +325,16 @@ int zone_load_from_journal(conf_t *conf, zone_t *zone, zone_contents_t **content
 		return KNOT_ENOMEM;
 	}
 
+	conf_val_t val = conf_zone_get(conf, C_LOAD_ARENA, zone->name);
+	if (conf_bool(&val)) {
+		val = conf_zone_get(conf, C_LOAD_HUGEPAGES, zone->name);
+		if (zone_contents_use_arena(*contents, conf_opt(&val)) != KNOT_EOK) {
+			zone_contents_deep_free(*contents);
+			*contents = NULL;
+			return KNOT_ENOMEM;
+		}
+	}
+
 	journal_read_t *read = NULL;
 	int ret = journal_read_begin(zone_journal(zone), true, 0, &read);
 	if (ret == KNOT_ENOENT) {
@@ -30,6 +30,7 @@
  * \param contents
  * \param semcheck_mode
  * \param fail_on_warning
+ * \param kaspdb           KASP DB for NSEC3 hash caching (can be NULL).
  *
  * \retval KNOT_EOK        if success.
  * \retval KNOT_ESEMCHECK  if any semantic check warning.
@@ -37,7 +38,17 @@
  */
 int zone_load_contents(conf_t *conf, const knot_dname_t *zone_name,
                        zone_contents_t **contents, semcheck_optional_t semcheck_mode,
-                       bool fail_on_warning);
+                       bool fail_on_warning, knot_lmdb_db_t *kaspdb);
+
+/*!
+ * \brief Load zone contents from a given zone file, otherwise according to the configuration.
+ *
+ * \see zone_load_contents()
+ */
+int zone_load_contents_file(conf_t *conf, const knot_dname_t *zone_name,
+                            const char *zonefile, zone_contents_t **contents,
+                            semcheck_optional_t semcheck_mode, bool fail_on_warning,
+                            knot_lmdb_db_t *kaspdb);
 
 /*!
  * \brief Update zone contents from the journal.
@@ -15,8 +15,10 @@
  */
 
 #include <assert.h>
+#include <pthread.h>
 #include <stdlib.h>
 
+#include "contrib/macros.h"
 #include "knot/zone/zone-tree.h"
 #include "libknot/consts.h"
 #include "libknot/errcode.h"
@@ -89,6 +91,22 @@ zone_tree_t *zone_tree_shallow_copy(zone_tree_t *from)
 	return to;
 }
 
+int zone_tree_use_mm(zone_tree_t *tree, knot_mm_t *mm)
+{
+	if (tree == NULL || tree->cow != NULL) {
+		return KNOT_EINVAL;
+	}
+
+	trie_t *trie = trie_dup(tree->trie, nocopy, mm);
+	if (trie == NULL) {
+		return KNOT_ENOMEM;
+	}
+	trie_free(tree->trie);
+	tree->trie = trie;
+
+	return KNOT_EOK;
+}
+
 int zone_tree_insert(zone_tree_t *tree, zone_node_t **node)
 {
 	if (tree == NULL || node == NULL || *node == NULL) {
@@ -250,6 +268,7 @@ int zone_tree_add_node(zone_tree_t *tree, zone_node_t *apex, const knot_dname_t
 			parent->children++;
 			if (knot_dname_is_wildcard(dname)) {
 				parent->flags |= NODE_FLAGS_WILDCARD_CHILD;
+				parent->wildcard_child = *new_node;
 			}
 		}
 	}
@@ -274,6 +293,7 @@ int zone_tree_del_node(zone_tree_t *tree, zone_node_t *node, bool free_deleted)
 		parent->children--;
 		if (wildcard) {
 			parent->flags &= ~NODE_FLAGS_WILDCARD_CHILD;
+			parent->wildcard_child = NULL;
 		}
 		if (parent->children == 0 && parent->rrset_count == 0 &&
 		    !(parent->flags & NODE_FLAGS_APEX)) {
@@ -302,6 +322,85 @@ int zone_tree_apply(zone_tree_t *tree, zone_tree_apply_cb_t function, void *data
 	return trie_apply(tree->trie, tree_apply_cb, &f);
 }
 
+typedef struct {
+	pthread_t thread;
+	int thread_init_errcode;
+	trie_it_t *it;
+	trie_val_t end;
+	zone_tree_func_t *f;
+	int ret;
+} zone_tree_range_t;
+
+static void *apply_range_thread(void *arg)
+{
+	zone_tree_range_t *range = arg;
+	while (range->ret == KNOT_EOK && !trie_it_finished(range->it) &&
+	       *trie_it_val(range->it) != range->end) {
+		// The iterator is moved first as the callback may free the node.
+		trie_val_t *val = trie_it_val(range->it);
+		zone_node_t *node = (zone_node_t *)(*val) + range->f->binode_second;
+		trie_it_next(range->it);
+		range->ret = range->f->func(node, range->f->data);
+	}
+	return NULL;
+}
+
+int zone_tree_apply_parallel(zone_tree_t *tree, zone_tree_apply_cb_t function,
+                             void *data, unsigned threads)
+{
+	if (function == NULL) {
+		return KNOT_EINVAL;
+	}
+
+	if (threads <= 1) {
+		return zone_tree_apply(tree, function, data);
+	}
+
+	if (zone_tree_is_empty(tree)) {
+		return KNOT_EOK;
+	}
+
+	zone_tree_func_t f = {
+		.func = function,
+		.data = data,
+		.binode_second = ((tree->flags & ZONE_TREE_BINO_SECOND) ? 1 : 0),
+	};
+
+	size_t count = threads;
+	trie_it_t *its[threads];
+	int ret = trie_it_split(tree->trie, its, &count);
+	if (ret != KNOT_EOK) {
+		return ret;
+	}
+
+	// The range ends are resolved before any node can be freed.
+	zone_tree_range_t ranges[count];
+	for (size_t i = 0; i < count; i++) {
+		ranges[i] = (zone_tree_range_t) {
+			.it = its[i],
+			.end = (i + 1 < count) ? *trie_it_val(its[i + 1]) : NULL,
+			.f = &f,
+		};
+	}
+	for (size_t i = 0; i < count; i++) {
+		ranges[i].thread_init_errcode =
+			pthread_create(&ranges[i].thread, NULL, apply_range_thread, &ranges[i]);
+	}
+	for (size_t i = 0; i < count; i++) {
+		if (ranges[i].thread_init_errcode == 0) {
+			(void)pthread_join(ranges[i].thread, NULL);
+		} else {
+			apply_range_thread(&ranges[i]);
+		}
+		if (ret == KNOT_EOK) {
+			ret = ranges[i].ret;
+		}
+		trie_it_free(ranges[i].it);
+	}
+
+	return ret;
+}
+
 int zone_tree_sub_apply(zone_tree_t *tree, const knot_dname_t *sub_root,
                         bool excl_root, zone_tree_apply_cb_t function, void *data)
 {
@@ -365,15 +464,100 @@ int zone_tree_it_double_begin(zone_tree_t *first, zone_tree_t *second, zone_tree
 	return KNOT_EOK;
 }
 
+int zone_tree_it_ranges(zone_tree_t *tree, zone_tree_it_t *its, size_t *count)
+{
+	if (tree == NULL || its == NULL || count == NULL) {
+		return KNOT_EINVAL;
+	}
+
+	trie_it_t **trie_its = calloc(MAX(*count, 1), sizeof(*trie_its));
+	if (trie_its == NULL) {
+		return KNOT_ENOMEM;
+	}
+
+	int ret = trie_it_split(tree->trie, trie_its, count);
+	if (ret == KNOT_EOK) {
+		for (size_t i = 0; i < *count; i++) {
+			its[i].tree = tree;
+			its[i].it = trie_its[i];
+			its[i].binode_second = ((tree->flags & ZONE_TREE_BINO_SECOND) ? 1 : 0);
+		}
+		for (size_t i = 1; i < *count; i++) {
+			its[i - 1].end = zone_tree_it_val(&its[i]);
+		}
+	}
+	free(trie_its);
+
+	return ret;
+}
+
+static int it_seek_geq(zone_tree_it_t *it, const knot_dname_t *owner)
+{
+	knot_dname_storage_t lf_storage;
+	uint8_t *lf = knot_dname_lf(owner, lf_storage);
+	int ret = trie_it_get_leq(it->it, lf + 1, *lf);
+	switch (ret) {
+	case KNOT_EOK:
+		return KNOT_EOK;
+	case 1: // a lower key found, the following one is wanted
+		trie_it_next(it->it);
+		return KNOT_EOK;
+	case KNOT_ENOENT: // all the keys are greater
+		trie_it_free(it->it);
+		it->it = trie_it_begin(it->tree->trie);
+		return it->it == NULL ? KNOT_ENOMEM : KNOT_EOK;
+	default:
+		return ret;
+	}
+}
+
+int zone_tree_it_double_ranges(zone_tree_t *first, zone_tree_t *second,
+                               zone_tree_it_t *its1, zone_tree_it_t *its2,
+                               size_t *count)
+{
+	if (second == NULL || its2 == NULL) {
+		return KNOT_EINVAL;
+	}
+
+	int ret = zone_tree_it_ranges(first, its1, count);
+	for (size_t i = 0; i < *count && ret == KNOT_EOK; i++) {
+		ret = zone_tree_it_begin(second, &its2[i]);
+		if (ret == KNOT_EOK && i > 0) {
+			ret = it_seek_geq(&its2[i], zone_tree_it_val(&its1[i])->owner);
+		}
+	}
+	if (ret != KNOT_EOK) {
+		for (size_t i = 0; i < *count; i++) {
+			zone_tree_it_free(&its1[i]);
+			zone_tree_it_free(&its2[i]);
+		}
+		*count = 0;
+		return ret;
+	}
+
+	for (size_t i = 1; i < *count; i++) {
+		its2[i - 1].end = zone_tree_it_finished(&its2[i]) ? NULL :
+		                  zone_tree_it_val(&its2[i]);
+	}
+
+	return KNOT_EOK;
+}
+
 static bool sub_done(zone_tree_it_t *it)
 {
 	return it->sub_root != NULL &&
 	       knot_dname_in_bailiwick(zone_tree_it_val(it)->owner, it->sub_root) < 0;
 }
 
+static bool range_done(zone_tree_it_t *it)
+{
+	return it->end != NULL && zone_tree_it_val(it) == it->end;
+}
+
 bool zone_tree_it_finished(zone_tree_it_t *it)
 {
-	return it->it == NULL || it->tree == NULL || trie_it_finished(it->it) || sub_done(it);
+	return it->it == NULL || it->tree == NULL || trie_it_finished(it->it) ||
+	       sub_done(it) || range_done(it);
 }
 
 zone_node_t *zone_tree_it_val(zone_tree_it_t *it)
@@ -510,3 +694,14 @@ void zone_tree_free(zone_tree_t **tree)
 	free(*tree);
 	*tree = NULL;
 }
+
+void zone_tree_free_parallel(zone_tree_t **tree, unsigned threads)
+{
+	if (tree == NULL || *tree == NULL) {
+		return;
+	}
+
+	trie_free_parallel((*tree)->trie, threads);
+	free(*tree);
+	*tree = NULL;
+}
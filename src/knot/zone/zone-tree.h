@@ -50,6 +50,7 @@ typedef struct {
 
 	zone_tree_t *next_tree;
 	knot_dname_t *sub_root;
+	zone_node_t *end; // first node of the following range, see zone_tree_it_ranges()
 } zone_tree_it_t;
 
 typedef struct {
@@ -77,6 +78,16 @@ zone_tree_t *zone_tree_cow(zone_tree_t *from);
  */
 zone_tree_t *zone_tree_shallow_copy(zone_tree_t *from);
 
+/*!
+ * \brief Move the trie of the zone tree to another memory context.
+ *
+ * \param tree   Zone tree, not in COW.
+ * \param mm     Memory context for the trie and its later modifications.
+ *
+ * \return KNOT_E*
+ */
+int zone_tree_use_mm(zone_tree_t *tree, knot_mm_t *mm);
+
 /*!
  * \brief Return number of nodes in the zone tree.
  *
@@ -221,6 +232,23 @@ int zone_tree_del_node(zone_tree_t *tree, zone_node_t *node, bool free_deleted);
  */
 int zone_tree_apply(zone_tree_t *tree, zone_tree_apply_cb_t function, void *data);
 
+/*!
+ * \brief Applies the given function to each node in the zone, in parallel.
+ *
+ * The tree is split into key ranges processed by separate threads. The range
+ * bounds are determined in advance, so the function may free the nodes, but
+ * it mustn't modify the tree structure.
+ *
+ * \param tree      Zone tree to apply the function to.
+ * \param function  Function to be applied to each node of the zone.
+ * \param data      Arbitrary data to be passed to the function.
+ * \param threads   Number of threads.
+ *
+ * \return KNOT_E*
+ */
+int zone_tree_apply_parallel(zone_tree_t *tree, zone_tree_apply_cb_t function,
+                             void *data, unsigned threads);
+
 /*!
  * \brief Applies given function to each node in a subtree.
  *
@@ -270,6 +298,39 @@ int zone_tree_it_sub_begin(zone_tree_t *tree, const knot_dname_t *sub_root,
  */
 int zone_tree_it_double_begin(zone_tree_t *first, zone_tree_t *second, zone_tree_it_t *it);
 
+/*!
+ * \brief Split zone tree iteration into contiguous ranges of roughly equal size.
+ *
+ * This is useful for parallel processing of the tree, each range can be
+ * iterated independently.
+ *
+ * \param tree    Zone tree to iterate over.
+ * \param its     Out: iteration contexts, they shall be zeroed before.
+ * \param count   In: maximal number of ranges, out: number of ranges created.
+ *
+ * \return KNOT_OK, KNOT_ENOMEM
+ */
+int zone_tree_it_ranges(zone_tree_t *tree, zone_tree_it_t *its, size_t *count);
+
+/*!
+ * \brief Split iteration over two zone trees into corresponding ranges.
+ *
+ * The first tree is split as with zone_tree_it_ranges(), the iterations
+ * over the second tree cover the same owner ranges, so that the trees can
+ * be compared range by range.
+ *
+ * \param first   First zone tree, it determines the ranges.
+ * \param second  Second zone tree.
+ * \param its1    Out: iteration contexts for the first tree, zeroed before.
+ * \param its2    Out: iteration contexts for the second tree, zeroed before.
+ * \param count   In: maximal number of ranges, out: number of ranges created.
+ *
+ * \return KNOT_OK, KNOT_ENOMEM
+ */
+int zone_tree_it_double_ranges(zone_tree_t *first, zone_tree_t *second,
+                               zone_tree_it_t *its1, zone_tree_it_t *its2,
+                               size_t *count);
+
 /*!
  * \brief Return true iff iteration is finished.
  *
@@ -335,3 +396,11 @@ void zone_trees_unify_binodes(zone_tree_t *nodes, zone_tree_t *nsec3_nodes, bool
  * \param tree Zone tree to be destroyed.
  */
 void zone_tree_free(zone_tree_t **tree);
+
+/*!
+ * \brief Destroys the zone tree by multiple threads, not touching the saved data.
+ *
+ * \param tree      Zone tree to be destroyed.
+ * \param threads   Number of threads.
+ */
+void zone_tree_free_parallel(zone_tree_t **tree, unsigned threads);
@@ -14,6 +14,8 @@
     along with this program.  If not, see <https://www.gnu.org/licenses/>.
  */
 
+#include <pthread.h>
+#include <sched.h>
 #include <stdlib.h>
 #include <string.h>
 #include <sys/stat.h>
@@ -23,9 +25,15 @@
 #include "knot/common/log.h"
 #include "knot/conf/module.h"
 #include "knot/dnssec/kasp/kasp_db.h"
+#include "knot/dnssec/key-cache.h"
+#include "knot/dnssec/resign-index.h"
 #include "knot/events/replan.h"
+#include "knot/journal/journal_batch.h"
 #include "knot/journal/journal_read.h"
 #include "knot/journal/journal_write.h"
+#include "knot/nameserver/answer_cache.h"
+#include "knot/nameserver/axfr_cache.h"
+#include "knot/nameserver/ixfr_cache.h"
 #include "knot/nameserver/process_query.h"
 #include "knot/query/requestor.h"
 #include "knot/updates/zone-update.h"
@@ -55,14 +63,149 @@ static void free_ddns_queue(zone_t *zone)
 	ptrlist_free(&zone->ddns_queue, NULL);
 }
 
+/*! \brief Zone file flush running in a background thread. */
+typedef struct zone_flush_bg {
+	pthread_t thread;
+	zone_t *zone;
+	zone_journal_t j;
+	char *zonefile;
+	bool binary;
+	unsigned threads;
+	bool resigned;
+	bool retransfer;
+	knot_atomic_bool done;
+	uint32_t serial;        // Serial of the flushed contents snapshot.
+	struct timespec mtime;
+	int ret;                // Zone file dump result.
+	int journal_ret;        // Journal flush mark result.
+} zone_flush_bg_t;
+
+static void *flush_bg_thread(void *arg)
+{
+	zone_flush_bg_t *bg = arg;
+
+#ifdef SCHED_IDLE
+	// Yield the CPU to the serving and updating threads.
+	struct sched_param param = { 0 };
+	(void)pthread_setschedparam(pthread_self(), SCHED_IDLE, &param);
+#endif
+
+	rcu_register_thread();
+
+	/* Dump a snapshot, updates may proceed meanwhile. */
+	rcu_read_lock();
+	zone_contents_t *contents = rcu_dereference(bg->zone->contents);
+	bg->serial = zone_contents_serial(contents);
+	bg->ret = zonefile_write(bg->zonefile, contents, bg->binary, bg->threads);
+	rcu_read_unlock();
+
+	struct stat st;
+	if (bg->ret == KNOT_EOK && stat(bg->zonefile, &st) < 0) {
+		bg->ret = knot_map_errno();
+	}
+
+	/* Mark the journal flushed up to the snapshot serial. */
+	if (bg->ret == KNOT_EOK) {
+		bg->mtime = st.st_mtim;
+		if (journal_is_existing(bg->j)) {
+			bg->journal_ret = journal_set_flushed_upto(bg->j, bg->serial);
+		}
+	}
+
+	rcu_unregister_thread();
+
+	ATOMIC_SET(bg->done, true);
+
+	/* Let the flush event collect the result and replan. */
+	zone_events_schedule_now(bg->zone, ZONE_EVENT_FLUSH);
+
+	return NULL;
+}
+
+static int flush_bg_start(zone_t *zone, char *zonefile, bool binary, unsigned threads)
+{
+	assert(zone->flush_bg == NULL);
+
+	zone_flush_bg_t *bg = calloc(1, sizeof(*bg));
+	if (bg == NULL) {
+		free(zonefile);
+		return KNOT_ENOMEM;
+	}
+
+	bg->zone = zone;
+	bg->j = zone_journal(zone);
+	bg->zonefile = zonefile;
+	bg->binary = binary;
+	bg->threads = threads;
+	bg->resigned = zone->zonefile.resigned;
+	bg->retransfer = zone->zonefile.retransfer;
+	ATOMIC_INIT(bg->done, false);
+
+	// Later resigning or retransfer gets flagged again.
+	zone->zonefile.resigned = false;
+	zone->zonefile.retransfer = false;
+
+	zone->flush_bg = bg;
+	if (pthread_create(&bg->thread, NULL, flush_bg_thread, bg) != 0) {
+		zone->flush_bg = NULL;
+		zone->zonefile.resigned = bg->resigned;
+		zone->zonefile.retransfer = bg->retransfer;
+		free(bg->zonefile);
+		free(bg);
+		return KNOT_ESYSTEM;
+	}
+
+	return KNOT_EOK;
+}
+
+/*! \brief Wait for a background flush and take over its result. */
+static int flush_bg_finish(zone_t *zone)
+{
+	zone_flush_bg_t *bg = zone->flush_bg;
+	if (bg == NULL) {
+		return KNOT_EOK;
+	}
+	zone->flush_bg = NULL;
+
+	pthread_join(bg->thread, NULL);
+
+	int ret = bg->ret;
+	if (ret != KNOT_EOK) {
+		log_zone_warning(zone->name, "failed to update zone file (%s)",
+		                 knot_strerror(ret));
+		zone->zonefile.resigned |= bg->resigned;
+		zone->zonefile.retransfer |= bg->retransfer;
+	} else {
+		if (zone->zonefile.exists) {
+			log_zone_info(zone->name, "zone file updated, serial %u -> %u",
+			              zone->zonefile.serial, bg->serial);
+		} else {
+			log_zone_info(zone->name, "zone file updated, serial %u",
+			              bg->serial);
+		}
+
+		zone->zonefile.exists = true;
+		zone->zonefile.mtime = bg->mtime;
+		zone->zonefile.serial = bg->serial;
+		ret = bg->journal_ret;
+	}
+
+	free(bg->zonefile);
+	free(bg);
+
+	return ret;
+}
+
 /*!
  * \param allow_empty_zone useful when need to flush journal but zone is not yet loaded
  * ...in this case we actually don't have to do anything because the zonefile is current,
  * but we must mark the journal as flushed
  */
-static int flush_journal(conf_t *conf, zone_t *zone, bool allow_empty_zone, bool verbose)
+static int flush_journal(conf_t *conf, zone_t *zone, bool allow_empty_zone, bool verbose,
+                         bool allow_background)
 {
-	/*! @note Function expects nobody will change zone contents meanwhile. */
+	/*! @note Function expects nobody will change zone contents meanwhile,
+	 *        unless the flush is performed in the background. */
 
 	assert(zone);
 
@@ -75,6 +218,20 @@ static int flush_journal(conf_t *conf, zone_t *zone, bool allow_empty_zone, bool
 	conf_val_t val = conf_zone_get(conf, C_ZONEFILE_SYNC, zone->name);
 	int64_t sync_timeout = conf_int(&val);
 
+	val = conf_zone_get(conf, C_ZONEFILE_SYNC_BG, zone->name);
+	bool background = allow_background && !force && !user_flush && conf_bool(&val);
+
+	/* Take over a background flush, the finished one replans the flush. */
+	if (zone->flush_bg != NULL) {
+		if (background && !ATOMIC_GET(zone->flush_bg->done)) {
+			return KNOT_EOK;
+		}
+		ret = flush_bg_finish(zone);
+		if (ret != KNOT_EOK) {
+			goto flush_journal_replan;
+		}
+	}
+
 	if (zone_contents_is_empty(zone->contents)) {
 		if (allow_empty_zone && journal_is_existing(j)) {
 			ret = journal_set_flushed(j);
@@ -106,9 +263,24 @@ static int flush_journal(conf_t *conf, zone_t *zone, bool allow_empty_zone, bool
 	}
 
 	char *zonefile = conf_zonefile(conf, zone->name);
+	conf_val_t thr = conf_zone_get(conf, C_ADJUST_THR, zone->name);
+	conf_val_t fmt = conf_zone_get(conf, C_ZONEFILE_FMT, zone->name);
+
+	if (background) {
+		rcu_read_unlock();
+		ret = flush_bg_start(zone, zonefile, conf_opt(&fmt) == ZONEFILE_FORMAT_BINARY,
+		                     conf_int(&thr));
+		if (ret != KNOT_EOK) {
+			log_zone_warning(zone->name, "failed to update zone file (%s)",
+			                 knot_strerror(ret));
+			goto flush_journal_replan;
+		}
+		return KNOT_EOK;
+	}
 
 	/* Synchronize journal. */
-	ret = zonefile_write(zonefile, contents);
+	ret = zonefile_write(zonefile, contents, conf_opt(&fmt) == ZONEFILE_FORMAT_BINARY,
+	                     conf_int(&thr));
 	rcu_read_unlock();
 	if (ret != KNOT_EOK) {
 		log_zone_warning(zone->name, "failed to update zone file (%s)",
@@ -153,7 +325,8 @@ flush_journal_replan:
 	/* Plan next journal flush after proper period. */
 	zone->timers.last_flush = time(NULL);
 	if (sync_timeout > 0) {
-		time_t next_flush = zone->timers.last_flush + sync_timeout;
+		time_t next_flush = zone->timers.last_flush +
+		                    replan_jitter(conf, zone->name, sync_timeout, 1);
 		zone_events_schedule_at(zone, ZONE_EVENT_FLUSH, (time_t)0,
 		                              ZONE_EVENT_FLUSH, next_flush);
 	}
@@ -175,8 +348,19 @@ zone_t* zone_new(const knot_dname_t *name)
 		return NULL;
 	}
 
+	zone->ixfr_cache = ixfr_cache_new();
+	zone->axfr_cache = axfr_cache_new();
+	if (zone->ixfr_cache == NULL || zone->axfr_cache == NULL) {
+		axfr_cache_free(zone->axfr_cache);
+		ixfr_cache_free(zone->ixfr_cache);
+		knot_dname_free(zone->name, NULL);
+		free(zone);
+		return NULL;
+	}
+
 	// DDNS
 	pthread_mutex_init(&zone->ddns_lock, NULL);
+	pthread_cond_init(&zone->ddns_cond, NULL);
 	zone->ddns_queue_size = 0;
 	init_list(&zone->ddns_queue);
 
@@ -195,6 +379,8 @@ zone_t* zone_new(const knot_dname_t *name)
 	init_list(&zone->internal_notify);
 
 	ATOMIC_INIT(zone->backup_ctx, NULL);
+	ATOMIC_INIT(zone->lazy.pending, false);
+	ATOMIC_INIT(zone->lazy.last, 0);
 
 	return zone;
 }
@@ -218,12 +404,15 @@ void zone_free(zone_t **zone_ptr)
 
 	zone_t *zone = *zone_ptr;
 
+	(void)flush_bg_finish(zone);
+
 	zone_events_deinit(zone);
 
 	knot_dname_free(zone->name, NULL);
 
 	free_ddns_queue(zone);
 	pthread_mutex_destroy(&zone->ddns_lock);
+	pthread_cond_destroy(&zone->ddns_cond);
 
 	pthread_mutex_destroy(&zone->cu_lock);
 	knot_sem_destroy(&zone->cow_lock);
@@ -240,12 +429,17 @@ void zone_free(zone_t **zone_ptr)
 
 	/* Free zone contents. */
 	zone_contents_deep_free(zone->contents);
+	resign_index_free(zone->resign_idx);
+	ixfr_cache_free(zone->ixfr_cache);
+	axfr_cache_free(zone->axfr_cache);
 
 	conf_deactivate_modules(&zone->query_modules, &zone->query_plan);
 
 	ptrlist_free(&zone->internal_notify, NULL);
 
 	ATOMIC_DEINIT(zone->backup_ctx);
+	ATOMIC_DEINIT(zone->lazy.pending);
+	ATOMIC_DEINIT(zone->lazy.last);
 
 	free(zone);
 	*zone_ptr = NULL;
@@ -259,6 +453,7 @@ void zone_reset(conf_t *conf, zone_t *zone)
 
 	zone_contents_t *old_contents = zone_switch_contents(zone, NULL);
 	conf_reset_modules(conf, &zone->query_modules, &zone->query_plan); // includes synchronize_rcu()
+	answer_cache_invalidate();
 	zone_contents_deep_free(old_contents);
 	if (zone_expired(zone)) {
 		replan_from_timers(conf, zone);
@@ -302,10 +497,10 @@ int selective_zone_purge(conf_t *conf, zone_t *zone, purge_flag_t params)
 			.catalog_member = member ? zone->timers.catalog_member : 0
 		};
 		if (member) {
-			ret = zone_timers_write(&zone->server->timerdb, zone->name,
-			                        &zone->timers);
+			ret = zone_timers_write(server_timerdb(zone->server, zone->name),
+			                        zone->name, &zone->timers);
 		} else {
-			ret = zone_timers_sweep(&zone->server->timerdb,
+			ret = zone_timers_sweep(server_timerdb(zone->server, zone->name),
 			                        dname_cmp_sweep_wrap, zone->name);
 		}
 		zone_timers_sanitize(conf, zone);
@@ -338,6 +533,7 @@ int selective_zone_purge(conf_t *conf, zone_t *zone, purge_flag_t params)
 		if (ret == KNOT_EOK) {
 			ret = kasp_db_delete_all(zone_kaspdb(zone), zone->name);
 		}
+		key_cache_drop(zone->name);
 		RETURN_IF_FAILED("KASP DB", KNOT_ENOENT);
 	}
 
@@ -361,7 +557,7 @@ int selective_zone_purge(conf_t *conf, zone_t *zone, purge_flag_t params)
 
 knot_lmdb_db_t *zone_journaldb(const zone_t *zone)
 {
-	return &zone->server->journaldb;
+	return server_journaldb(zone->server, zone->name);
 }
 
 knot_lmdb_db_t *zone_kaspdb(const zone_t *zone)
@@ -383,16 +579,18 @@ static int journal_insert_flush(conf_t *conf, zone_t *zone,
                                 changeset_t *change, changeset_t *extra,
                                 const zone_diff_t *diff)
 {
-	zone_journal_t j = { zone_journaldb(zone), zone->name, conf };
+	zone_journal_t j = { zone_journaldb(zone), zone->name, conf, &zone->journal_stats };
 
-	int ret = journal_insert(j, change, extra, diff);
+	journal_batch_t *batch = server_journal_batch(zone->server, zone->name);
+
+	int ret = journal_batch_insert(batch, j, change, extra, diff);
 	if (ret == KNOT_EBUSY) {
 		log_zone_notice(zone->name, "journal, flushing the zone to allow old changesets cleanup to free space");
 
 		/* Transaction rolled back, journal released, we may flush. */
-		ret = flush_journal(conf, zone, true, false);
+		ret = flush_journal(conf, zone, true, false, false);
 		if (ret == KNOT_EOK) {
-			ret = journal_insert(j, change, extra, diff);
+			ret = journal_batch_insert(batch, j, change, extra, diff);
 		}
 	}
 
@@ -436,7 +634,7 @@ int zone_in_journal_store(conf_t *conf, zone_t *zone, zone_contents_t *new_conte
 		return KNOT_EEMPTYZONE;
 	}
 
-	zone_journal_t j = { zone_journaldb(zone), zone->name, conf };
+	zone_journal_t j = { zone_journaldb(zone), zone->name, conf, &zone->journal_stats };
 
 	int ret = journal_insert_zone(j, new_contents);
 	if (ret == KNOT_EOK) {
@@ -453,7 +651,16 @@ int zone_flush_journal(conf_t *conf, zone_t *zone, bool verbose)
 		return KNOT_EINVAL;
 	}
 
-	return flush_journal(conf, zone, false, verbose);
+	return flush_journal(conf, zone, false, verbose, false);
+}
+
+int zone_flush_journal_bg(conf_t *conf, zone_t *zone)
+{
+	if (conf == NULL || zone == NULL) {
+		return KNOT_EINVAL;
+	}
+
+	return flush_journal(conf, zone, false, true, true);
 }
 
 bool zone_journal_has_zij(zone_t *zone)
@@ -485,10 +692,25 @@ zone_contents_t *zone_switch_contents(zone_t *zone, zone_contents_t *new_content
 	zone_contents_t *old_contents;
 	zone_contents_t **current_contents = &zone->contents;
 	old_contents = rcu_xchg_pointer(current_contents, new_contents);
+	answer_cache_invalidate();
+	ixfr_cache_flush(zone->ixfr_cache);
+	axfr_cache_flush(zone->axfr_cache);
 
 	return old_contents;
 }
 
+void zone_lazy_touch(zone_t *zone)
+{
+	uint64_t now = time(NULL);
+	if (ATOMIC_GET(zone->lazy.last) != now) { // Avoid cache line bouncing.
+		ATOMIC_SET(zone->lazy.last, now);
+	}
+
+	if (zone->contents == NULL && !ATOMIC_XCHG(zone->lazy.pending, true)) {
+		zone_events_schedule_now(zone, ZONE_EVENT_LOAD);
+	}
+}
+
 bool zone_is_slave(conf_t *conf, const zone_t *zone)
 {
 	if (conf == NULL || zone == NULL) {
@@ -791,7 +1013,8 @@ int zone_dump_to_dir(conf_t *conf, zone_t *zone, const char *dir)
 	}
 	free(zonefile);
 
-	return zonefile_write(target, zone->contents);
+	conf_val_t thr = conf_zone_get(conf, C_ADJUST_THR, zone->name);
+	return zonefile_write(target, zone->contents, false, conf_int(&thr));
 }
 
 void zone_local_notify_subscribe(zone_t *zone, zone_t *subscribe)
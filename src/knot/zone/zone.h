@@ -23,7 +23,9 @@
 #include "knot/conf/confio.h"
 #include "knot/journal/journal_basic.h"
 #include "knot/journal/serialization.h"
+#include "knot/events/event_stats.h"
 #include "knot/events/events.h"
+#include "knot/nameserver/xfr_perf.h"
 #include "knot/updates/changesets.h"
 #include "knot/zone/contents.h"
 #include "knot/zone/timers.h"
@@ -33,6 +35,10 @@
 
 struct zone_update;
 struct zone_backup_ctx;
+struct resign_index;
+struct axfr_cache;
+struct ixfr_cache;
+struct zone_flush_bg;
 
 /*!
  * \brief Zone flags.
@@ -102,15 +108,41 @@ typedef struct zone
 		uint8_t bootstrap_cnt; //!< Rebootstrap count (not related to zonefile).
 	} zonefile;
 
+	/*! \brief Zone file flush running in the background, NULL if none. */
+	struct zone_flush_bg *flush_bg;
+
 	/*! \brief Zone events. */
 	zone_timers_t timers;      //!< Persistent zone timers.
+	uint64_t timers_hash;      //!< Hash of the timers as last persisted.
 	zone_events_t events;      //!< Zone events timers.
 
+	/*! \brief Index of RRSIG expirations, NULL if not usable. */
+	struct resign_index *resign_idx;
+
+	/*! \brief Journal statistics. */
+	journal_stats_t journal_stats;
+
+	/*! \brief Zone transfer statistics. */
+	xfr_perf_t xfr_perf;
+
+	/*! \brief Zone event latency statistics. */
+	event_stats_t event_stats;
+
+	/*! \brief Zone group of the query statistics. */
+	unsigned stats_group;
+
+	/*! \brief Condensed outgoing IXFR differences. */
+	struct ixfr_cache *ixfr_cache;
+
+	/*! \brief Encoded outgoing AXFR messages. */
+	struct axfr_cache *axfr_cache;
+
 	/*! \brief Track unsuccessful NOTIFY targets. */
 	notifailed_rmt_dynarray_t notifailed;
 
 	/*! \brief DDNS queue and lock. */
 	pthread_mutex_t ddns_lock;
+	pthread_cond_t ddns_cond;  //!< Signalled when an update is enqueued.
 	size_t ddns_queue_size;
 	list_t ddns_queue;
 
@@ -144,6 +176,14 @@ typedef struct zone
 	/*! \brief Query modules. */
 	list_t query_modules;
 	struct query_plan *query_plan;
+	uint64_t conf_hash;        //!< Configuration hash of the modules, zero if unknown.
+
+	/*! \brief Lazy loading on the first query, see zone_lazy_touch(). */
+	struct {
+		bool enabled;               //!< Loaded on demand, unloaded when idle.
+		knot_atomic_bool pending;   //!< Load requested and not finished yet.
+		knot_atomic_uint64_t last;  //!< Time of the last query (seconds).
+	} lazy;
 } zone_t;
 
 /*!
@@ -205,7 +245,7 @@ catalog_update_t *zone_catalog_upd(const zone_t *zone);
  */
 inline static zone_journal_t zone_journal(zone_t *zone)
 {
-	zone_journal_t j = { zone_journaldb(zone), zone->name, NULL };
+	zone_journal_t j = { zone_journaldb(zone), zone->name, NULL, &zone->journal_stats };
 	return j;
 }
 
@@ -217,6 +257,16 @@ int zone_in_journal_store(conf_t *conf, zone_t *zone, zone_contents_t *new_conte
 /*! \brief Synchronize zone file with journal. */
 int zone_flush_journal(conf_t *conf, zone_t *zone, bool verbose);
 
+/*!
+ * \brief Synchronize zone file with journal, possibly in a background thread.
+ *
+ * If configured, a periodic flush dumps a snapshot of the zone contents in
+ * a low-priority thread while the zone events continue. The journal is marked
+ * flushed up to the snapshot serial and the flush event is replanned once
+ * the dump finishes.
+ */
+int zone_flush_journal_bg(conf_t *conf, zone_t *zone);
+
 bool zone_journal_has_zij(zone_t *zone);
 
 /*!
@@ -230,6 +280,13 @@ void zone_schedule_notify(zone_t *zone, time_t delay);
  */
 zone_contents_t *zone_switch_contents(zone_t *zone, zone_contents_t *new_contents);
 
+/*!
+ * \brief Note a query to a lazily loaded zone, request the load if not loaded.
+ *
+ * The zone is answered with SERVFAIL until the load finishes.
+ */
+void zone_lazy_touch(zone_t *zone);
+
 /*! \brief Checks if the zone is slave. */
 bool zone_is_slave(conf_t *conf, const zone_t *zone);
 
@@ -15,14 +15,21 @@
  */
 
 #include <assert.h>
+#include <pthread.h>
+#include <sys/stat.h>
 #include <unistd.h>
 #include <urcu.h>
 
 #include "knot/catalog/generate.h"
 #include "knot/common/log.h"
+#include "knot/common/reclaim.h"
 #include "knot/conf/module.h"
 #include "knot/events/replan.h"
+#include "knot/conf/confdb.h"
 #include "knot/journal/journal_metadata.h"
+#include "knot/nameserver/answer_cache.h"
+#include "knot/nameserver/query_module.h"
+#include "knot/nameserver/query_stats.h"
 #include "knot/zone/digest.h"
 #include "knot/zone/timers.h"
 #include "knot/zone/zone-load.h"
@@ -31,6 +38,13 @@
 #include "knot/zone/zonedb.h"
 #include "knot/zone/zonefile.h"
 #include "libknot/libknot.h"
+#include "contrib/macros.h"
+
+// Minimal number of zones per thread for parallel zone creation.
+#define PARALLEL_MIN_ZONES	1000
+
+// Serializes the catalog opening by zones created in parallel.
+static pthread_mutex_t catalog_open_lock = PTHREAD_MUTEX_INITIALIZER;
 
 static bool zone_file_updated(conf_t *conf, const zone_t *old_zone,
                               const knot_dname_t *zone_name)
@@ -64,7 +78,8 @@ static void zone_get_catalog_group(conf_t *conf, zone_t *zone)
 	}
 }
 
-static zone_t *create_zone_from(const knot_dname_t *name, server_t *server)
+static zone_t *create_zone_from(conf_t *conf, const knot_dname_t *name,
+                                server_t *server)
 {
 	zone_t *zone = zone_new(name);
 	if (!zone) {
@@ -73,6 +88,9 @@ static zone_t *create_zone_from(const knot_dname_t *name, server_t *server)
 
 	zone->server = server;
 
+	conf_val_t val = conf_zone_get(conf, C_LAZY_LOAD, name);
+	zone->lazy.enabled = conf_bool(&val); // conf consistency checked in conf/tools.c
+
 	int result = zone_events_setup(zone, server->workers, &server->sched);
 	if (result != KNOT_EOK) {
 		zone_free(&zone);
@@ -105,17 +123,23 @@ static void replan_events(conf_t *conf, zone_t *zone, zone_t *old_zone)
 static zone_t *create_zone_reload(conf_t *conf, const knot_dname_t *name,
                                   server_t *server, zone_t *old_zone)
 {
-	zone_t *zone = create_zone_from(name, server);
+	zone_t *zone = create_zone_from(conf, name, server);
 	if (!zone) {
 		return NULL;
 	}
 
 	zone->contents = old_zone->contents;
 	zone_set_flag(zone, zone_get_flag(old_zone, ~0, false));
+	ATOMIC_SET(zone->lazy.last, ATOMIC_GET(old_zone->lazy.last));
 
 	zone->timers = old_zone->timers;
+	zone->timers_hash = old_zone->timers_hash;
 	zone_timers_sanitize(conf, zone);
 
+	memcpy(&zone->journal_stats, &old_zone->journal_stats, sizeof(zone->journal_stats));
+	memcpy(&zone->xfr_perf, &old_zone->xfr_perf, sizeof(zone->xfr_perf));
+	memcpy(&zone->event_stats, &old_zone->event_stats, sizeof(zone->event_stats));
+
 	if (old_zone->control_update != NULL) {
 		log_zone_warning(old_zone->name, "control transaction aborted");
 		zone_control_clear(old_zone);
@@ -133,18 +157,19 @@ static zone_t *create_zone_reload(conf_t *conf, const knot_dname_t *name,
 static zone_t *create_zone_new(conf_t *conf, const knot_dname_t *name,
                                server_t *server)
 {
-	zone_t *zone = create_zone_from(name, server);
+	zone_t *zone = create_zone_from(conf, name, server);
 	if (!zone) {
 		return NULL;
 	}
 
-	int ret = zone_timers_read(&server->timerdb, name, &zone->timers);
+	int ret = zone_timers_read(server_timerdb(server, name), name, &zone->timers);
 	if (ret != KNOT_EOK && ret != KNOT_ENODB && ret != KNOT_ENOENT) {
 		log_zone_error(zone->name, "failed to load persistent timers (%s)",
 		               knot_strerror(ret));
 		zone_free(&zone);
 		return NULL;
 	}
+	zone->timers_hash = zone_timers_hash(&zone->timers);
 
 	zone_timers_sanitize(conf, zone);
 
@@ -156,8 +181,8 @@ static zone_t *create_zone_new(conf_t *conf, const knot_dname_t *name,
 		zone->catalog_gen = knot_dname_copy(conf_dname(&catz), NULL);
 		if (zone->timers.catalog_member == 0) {
 			zone->timers.catalog_member = time(NULL);
-			ret = zone_timers_write(&zone->server->timerdb, zone->name,
-			                        &zone->timers);
+			ret = zone_timers_write(server_timerdb(zone->server, zone->name),
+			                        zone->name, &zone->timers);
 		}
 		if (ret != KNOT_EOK || zone->catalog_gen == NULL) {
 			log_zone_error(zone->name, "failed to initialize catalog member zone (%s)",
@@ -175,7 +200,9 @@ static zone_t *create_zone_new(conf_t *conf, const knot_dname_t *name,
 		}
 		zone_set_flag(zone, ZONE_IS_CATALOG);
 	} else if (role == CATALOG_ROLE_INTERPRET) {
+		pthread_mutex_lock(&catalog_open_lock);
 		ret = catalog_open(&server->catalog);
+		pthread_mutex_unlock(&catalog_open_lock);
 		if (ret != KNOT_EOK) {
 			log_error("failed to open catalog database (%s)", knot_strerror(ret));
 		}
@@ -187,6 +214,8 @@ static zone_t *create_zone_new(conf_t *conf, const knot_dname_t *name,
 		log_zone_info(zone->name, "zone will be bootstrapped");
 		assert(zone_is_slave(conf, zone));
 		replan_load_bootstrap(conf, zone);
+	} else if (zone->lazy.enabled) {
+		log_zone_info(zone->name, "zone will be loaded upon the first query");
 	} else {
 		log_zone_info(zone->name, "zone will be loaded");
 		// if load fails, fallback to bootstrap
@@ -222,6 +251,7 @@ static zone_t *create_zone(conf_t *conf, const knot_dname_t *name, server_t *ser
 
 	if (z != NULL) {
 		zone_get_catalog_group(conf, z);
+		z->stats_group = query_stats_zone_group(conf, name);
 	}
 
 	return z;
@@ -391,6 +421,145 @@ static zone_t *add_member_zone(catalog_upd_val_t *val, knot_zonedb_t *check,
 	return zone;
 }
 
+static void link_reverse(conf_t *conf, knot_zonedb_t *db, zone_t *zone)
+{
+	conf_val_t val = conf_zone_get(conf, C_REVERSE_GEN, zone->name);
+	if (val.code != KNOT_EOK) {
+		return;
+	}
+
+	const knot_dname_t *forw_name = conf_dname(&val);
+	zone_t *forw = knot_zonedb_find(db, forw_name);
+	if (forw == NULL) {
+		knot_dname_txt_storage_t forw_str;
+		(void)knot_dname_to_str(forw_str, forw_name, sizeof(forw_str));
+		log_zone_warning(zone->name, "zone to reverse %s does not exist",
+		                 forw_str);
+	} else {
+		zone->reverse_from = forw;
+		zone_local_notify_subscribe(forw, zone);
+	}
+}
+
+typedef struct {
+	const knot_dname_t *name;
+	zone_t *old_zone;
+	zone_t *zone;
+} zone_job_t;
+
+typedef struct {
+	pthread_t thread;
+	conf_t *conf;
+	server_t *server;
+	zone_job_t *jobs;
+	size_t count;
+	uint64_t shared;
+} zone_jobs_thread_t;
+
+/*!
+ * \brief Take over the query modules of the replaced zone if the zone
+ *        configuration hasn't changed.
+ */
+static bool reuse_modules(conf_t *conf, zone_t *zone, zone_t *old_zone)
+{
+	if (old_zone == NULL || old_zone->conf_hash == 0 ||
+	    old_zone->conf_hash != zone->conf_hash) {
+		return false;
+	}
+
+	// Shared modules must not have been replaced.
+	knotd_mod_t *mod, *next;
+	WALK_LIST(mod, old_zone->query_modules) {
+		const module_t *found = conf_mod_find(conf, mod->id->name + 1,
+		                                      mod->id->name[0], false);
+		if (found == NULL || found->api != mod->api) {
+			return false;
+		}
+	}
+
+	WALK_LIST_DELSAFE(mod, next, old_zone->query_modules) {
+		rem_node(&mod->node);
+		mod->zone = zone->name;
+		add_tail(&zone->query_modules, &mod->node);
+	}
+	// The plan is still used by the old zone, see remove_old_zonedb().
+	zone->query_plan = old_zone->query_plan;
+
+	return true;
+}
+
+static void create_zone_jobs(conf_t *conf, server_t *server, zone_job_t *jobs,
+                             size_t count, uint64_t shared)
+{
+	for (size_t i = 0; i < count; i++) {
+		zone_job_t *job = &jobs[i];
+		job->zone = create_zone(conf, job->name, server, job->old_zone);
+		if (job->zone == NULL) {
+			continue;
+		}
+
+		if (shared != 0) {
+			job->zone->conf_hash = conf_zone_hash(conf, job->name, shared);
+		}
+		if (!reuse_modules(conf, job->zone, job->old_zone)) {
+			conf_activate_modules(conf, server, job->zone->name,
+			                      &job->zone->query_modules,
+			                      &job->zone->query_plan);
+		}
+	}
+}
+
+static void *create_zones_thread(void *arg)
+{
+	zone_jobs_thread_t *thr = arg;
+	create_zone_jobs(thr->conf, thr->server, thr->jobs, thr->count, thr->shared);
+	return NULL;
+}
+
+/*!
+ * \brief Create the zones in ranges processed in parallel by background workers
+ *        count of threads, as the workers are paused during the reload.
+ */
+static void create_zones(conf_t *conf, server_t *server, zone_job_t *jobs,
+                         size_t count, uint64_t shared)
+{
+	size_t threads = MIN(conf->cache.srv_bg_threads, count / PARALLEL_MIN_ZONES);
+	zone_jobs_thread_t *thrs = NULL;
+	if (threads > 1) {
+		thrs = calloc(threads, sizeof(*thrs));
+	}
+	if (thrs == NULL) {
+		create_zone_jobs(conf, server, jobs, count, shared);
+		return;
+	}
+
+	size_t step = count / threads;
+	for (size_t i = 0; i < threads; i++) {
+		thrs[i].conf = conf;
+		thrs[i].server = server;
+		thrs[i].jobs = jobs + i * step;
+		thrs[i].count = (i + 1 < threads) ? step : count - i * step;
+		thrs[i].shared = shared;
+	}
+
+	// The first range is processed by this thread.
+	size_t started = 1;
+	for ( ; started < threads; started++) {
+		if (pthread_create(&thrs[started].thread, NULL, create_zones_thread,
+		                   &thrs[started]) != 0) {
+			break;
+		}
+	}
+	for (size_t i = started; i < threads; i++) {
+		create_zones_thread(&thrs[i]);
+	}
+	create_zones_thread(&thrs[0]);
+	for (size_t i = 1; i < started; i++) {
+		pthread_join(thrs[i].thread, NULL);
+	}
+	free(thrs);
+}
+
 /*!
  * \brief Create new zone database.
  *
@@ -422,6 +591,8 @@ static knot_zonedb_t *create_zonedb(conf_t *conf, server_t *server, reload_t mod
 	}
 
 	/* Process regular zones from the configuration. */
+	zone_job_t *jobs = NULL;
+	size_t count = 0, max_count = 0;
 	for (conf_iter_t iter = conf_iter(conf, C_ZONE); iter.code == KNOT_EOK;
 	     conf_iter_next(conf, &iter)) {
 		conf_val_t id = conf_iter_id(conf, &iter);
@@ -436,17 +607,33 @@ static knot_zonedb_t *create_zonedb(conf_t *conf, server_t *server, reload_t mod
 			}
 		}
 
-		zone_t *zone = create_zone(conf, name, server, old_zone);
-		if (zone == NULL) {
-			log_zone_error(name, "zone cannot be created");
-			continue;
+		if (count == max_count) {
+			max_count = MAX(2 * max_count, 64);
+			zone_job_t *new_jobs = realloc(jobs, max_count * sizeof(*jobs));
+			if (new_jobs == NULL) {
+				log_zone_error(name, "zone cannot be created");
+				conf_iter_finish(conf, &iter);
+				break;
+			}
+			jobs = new_jobs;
 		}
+		jobs[count++] = (zone_job_t){ .name = name, .old_zone = old_zone };
+	}
 
-		conf_activate_modules(conf, server, zone->name, &zone->query_modules,
-		                      &zone->query_plan);
+	/* Zone section excluded, a zone hash covers its own values. */
+	uint64_t shared = 0;
+	(void)conf_db_hash(conf, NULL, C_ZONE, &shared);
 
-		knot_zonedb_insert(db_new, zone);
+	create_zones(conf, server, jobs, count, shared);
+
+	for (size_t i = 0; i < count; i++) {
+		if (jobs[i].zone == NULL) {
+			log_zone_error(jobs[i].name, "zone cannot be created");
+			continue;
+		}
+		knot_zonedb_insert(db_new, jobs[i].zone);
 	}
+	free(jobs);
 
 	/* Purge decataloged zones before catalog removals are commited. */
 	catalog_it_t *cat_it = catalog_it_begin(&server->catalog_upd);
@@ -504,21 +691,7 @@ static knot_zonedb_t *create_zonedb(conf_t *conf, server_t *server, reload_t mod
 
 	it = knot_zonedb_iter_begin(db_new);
 	while (!knot_zonedb_iter_finished(it)) {
-		zone_t *z = knot_zonedb_iter_val(it);
-		conf_val_t val = conf_zone_get(conf, C_REVERSE_GEN, z->name);
-		if (val.code == KNOT_EOK) {
-			const knot_dname_t *forw_name = conf_dname(&val);
-			zone_t *forw = knot_zonedb_find(db_new, forw_name);
-			if (forw == NULL) {
-				knot_dname_txt_storage_t forw_str;
-				(void)knot_dname_to_str(forw_str, forw_name, sizeof(forw_str));
-				log_zone_warning(z->name, "zone to reverse %s does not exist",
-				                 forw_str);
-			} else {
-				z->reverse_from = forw;
-				zone_local_notify_subscribe(forw, z);
-			}
-		}
+		link_reverse(conf, db_new, knot_zonedb_iter_val(it));
 		knot_zonedb_iter_next(it);
 	}
 	knot_zonedb_iter_free(it);
@@ -526,6 +699,171 @@ static knot_zonedb_t *create_zonedb(conf_t *conf, server_t *server, reload_t mod
 	return db_new;
 }
 
+/*!
+ * \brief Apply the zones changed by the dynamic configuration.
+ *
+ * \param added  Out: set if a zone was added.
+ *
+ * \return True if a zone was replaced or removed.
+ */
+static bool update_conf_zones(conf_t *conf, server_t *server, knot_zonedb_t *db_old,
+                              knot_zonedb_t *db_new, bool *added)
+{
+	bool replaced = false;
+
+	if (conf->io.zones == NULL) {
+		return false;
+	}
+
+	mark_changed_zones(db_old, conf->io.zones);
+
+	trie_it_t *it = trie_it_begin(conf->io.zones);
+	for (; !trie_it_finished(it); trie_it_next(it)) {
+		const knot_dname_t *name = (const knot_dname_t *)trie_it_key(it, NULL);
+		conf_io_type_t type = conf_io_trie_val(it);
+
+		zone_t *old_zone = knot_zonedb_find(db_old, name);
+		if (type & CONF_IO_TUNSET) {
+			if (old_zone != NULL) {
+				(void)knot_zonedb_del(db_new, name);
+				replaced = true;
+			}
+			continue;
+		}
+
+		/* Reuse unchanged zone. */
+		if (old_zone != NULL && !(old_zone->change_type & CONF_IO_TRELOAD)) {
+			continue;
+		}
+
+		zone_t *zone = create_zone(conf, name, server, old_zone);
+		if (zone == NULL) {
+			log_zone_error(name, "zone cannot be created");
+			if (old_zone != NULL) {
+				(void)knot_zonedb_del(db_new, name);
+				replaced = true;
+			}
+			continue;
+		}
+
+		conf_activate_modules(conf, server, zone->name, &zone->query_modules,
+		                      &zone->query_plan);
+
+		knot_zonedb_insert(db_new, zone);
+		link_reverse(conf, db_new, zone);
+		if (old_zone != NULL) {
+			replaced = true;
+		} else {
+			*added = true;
+		}
+	}
+	trie_it_free(it);
+
+	return replaced;
+}
+
+/*!
+ * \brief Update the zone database with the changes only.
+ *
+ * The zones are taken over from a copy-on-write copy of the current database,
+ * only the zones changed by the dynamic configuration and the added, removed,
+ * or changed catalog member zones are processed.
+ *
+ * \param conf              Server configuration.
+ * \param server            Server instance.
+ * \param mode              Reload mode (RELOAD_COMMIT or RELOAD_CATALOG).
+ * \param expired_contents  Out: ptrlist of zone_contents_t to be deep freed after sync RCU.
+ *
+ * \return New zone database.
+ */
+static knot_zonedb_t *update_zonedb(conf_t *conf, server_t *server, reload_t mode,
+                                    list_t *expired_contents)
+{
+	assert(mode == RELOAD_COMMIT || mode == RELOAD_CATALOG);
+
+	knot_zonedb_t *db_old = server->zone_db;
+	knot_zonedb_t *db_new = knot_zonedb_cow(db_old);
+	if (db_new == NULL) {
+		return NULL;
+	}
+
+	bool replaced = false, added = false;
+
+	if (mode == RELOAD_COMMIT) {
+		replaced = update_conf_zones(conf, server, db_old, db_new, &added);
+	}
+
+	/* Purge decataloged zones before catalog removals are commited. */
+	catalog_it_t *it = catalog_it_begin(&server->catalog_upd);
+	while (!catalog_it_finished(it)) {
+		catalog_upd_val_t *upd = catalog_it_val(it);
+		if (upd->type == CAT_UPD_REM) {
+			zone_t *zone = knot_zonedb_find(db_old, upd->member);
+			if (zone != NULL) {
+				zone->change_type = CONF_IO_TUNSET;
+				zone_purge(conf, zone);
+				(void)knot_zonedb_del(db_new, upd->member);
+				replaced = true;
+			}
+		}
+		catalog_it_next(it);
+	}
+	catalog_it_free(it);
+
+	int ret = catalog_update_commit(&server->catalog_upd, &server->catalog);
+	if (ret != KNOT_EOK) {
+		log_error("catalog, failed to apply changes (%s)", knot_strerror(ret));
+		return db_new;
+	}
+
+	it = catalog_it_begin(&server->catalog_upd);
+	while (!catalog_it_finished(it)) {
+		catalog_upd_val_t *val = catalog_it_val(it);
+		zone_t *zone = knot_zonedb_find(db_old, val->member), *newzone = NULL;
+		if (zone == NULL) {
+			newzone = add_member_zone(val, db_new, server, conf);
+			added |= (newzone != NULL);
+		} else if (zone_get_flag(zone, ZONE_IS_CAT_MEMBER, false) &&
+		           val->type != CAT_UPD_REM) {
+			newzone = reuse_member_zone(zone, server, conf, mode,
+			                            expired_contents);
+			if (newzone == NULL) {
+				(void)knot_zonedb_del(db_new, val->member);
+				replaced = true;
+			}
+		}
+		if (newzone != NULL && newzone != zone) {
+			knot_zonedb_insert(db_new, newzone);
+			link_reverse(conf, db_new, newzone);
+			replaced |= (zone != NULL);
+		}
+		catalog_it_next(it);
+	}
+	catalog_it_free(it);
+
+	if (!replaced && !added) {
+		return db_new;
+	}
+
+	/* Relink the reverse zones of the replaced or removed ones,
+	 * or the missing ones which might have been added. */
+	knot_zonedb_iter_t *zit = knot_zonedb_iter_begin(db_new);
+	while (!knot_zonedb_iter_finished(zit)) {
+		zone_t *z = knot_zonedb_iter_val(zit);
+		if (z->reverse_from != NULL &&
+		    knot_zonedb_find(db_new, z->reverse_from->name) != z->reverse_from) {
+			z->reverse_from = NULL;
+			link_reverse(conf, db_new, z);
+		} else if (z->reverse_from == NULL && added) {
+			link_reverse(conf, db_new, z);
+		}
+		knot_zonedb_iter_next(zit);
+	}
+	knot_zonedb_iter_free(zit);
+
+	return db_new;
+}
+
 /*!
  * \brief Schedule deletion of old zones, and free the zone db structure.
  *
@@ -556,6 +894,10 @@ static void remove_old_zonedb(conf_t *conf, knot_zonedb_t *db_old,
 			if (new_zone != NULL) {
 				replan_events(conf, new_zone, zone);
 				zone->contents = NULL;
+				/* Check if reused query modules. */
+				if (new_zone->query_plan == zone->query_plan) {
+					zone->query_plan = NULL;
+				}
 			}
 			/* Completely new zone. */
 		} else {
@@ -589,6 +931,62 @@ catalog_only:
 	}
 }
 
+static uint64_t zone_load_weight(worker_task_t *task)
+{
+	zone_t *zone = task->ctx;
+
+	char *zonefile = conf_zonefile(conf(), zone->name);
+	struct stat st;
+	int ret = (zonefile != NULL) ? stat(zonefile, &st) : -1;
+	free(zonefile);
+
+	return (ret == 0) ? st.st_size : 0;
+}
+
+/*!
+ * \brief Update the generated catalogs with the zones changed by a delta reload.
+ */
+static void generate_catalogs_delta(conf_t *conf, server_t *server,
+                                    knot_zonedb_t *db_new, reload_t mode)
+{
+	trie_t *conf_zones = (mode == RELOAD_COMMIT) ? conf->io.zones : NULL;
+
+	/* A new catalog zone to be generated needs all its members. */
+	bool full = false;
+	if (conf_zones != NULL) {
+		trie_it_t *it = trie_it_begin(conf_zones);
+		for (; !trie_it_finished(it) && !full; trie_it_next(it)) {
+			const knot_dname_t *name = (const knot_dname_t *)trie_it_key(it, NULL);
+			full = catalogs_generate_needs_full(db_new, name);
+		}
+		trie_it_free(it);
+	}
+	if (full) {
+		catalogs_generate(db_new, server->zone_db);
+		return;
+	}
+
+	if (conf_zones != NULL) {
+		trie_it_t *it = trie_it_begin(conf_zones);
+		for (; !trie_it_finished(it); trie_it_next(it)) {
+			const knot_dname_t *name = (const knot_dname_t *)trie_it_key(it, NULL);
+			catalogs_generate_zone(db_new, server->zone_db, name);
+		}
+		trie_it_free(it);
+	}
+
+	catalog_it_t *it = catalog_it_begin(&server->catalog_upd);
+	while (!catalog_it_finished(it)) {
+		catalog_upd_val_t *val = catalog_it_val(it);
+		if (conf_zones == NULL ||
+		    trie_get_try(conf_zones, val->member, knot_dname_size(val->member)) == NULL) {
+			catalogs_generate_zone(db_new, server->zone_db, val->member);
+		}
+		catalog_it_next(it);
+	}
+	catalog_it_free(it);
+}
+
 // UBSAN type punning workaround
 static void zone_contents_deep_free_wrap(void *contents)
 {
@@ -617,23 +1015,41 @@ void zonedb_reload(conf_t *conf, server_t *server, reload_t mode)
 		log_info("catalog, updating, %zu changes", cat_upd_size);
 	}
 
-	/* Insert all required zones to the new zone DB. */
-	knot_zonedb_t *db_new = create_zonedb(conf, server, mode, &contents_tofree);
+	/* Insert all required zones to the new zone DB, or only the changed ones. */
+	bool delta = (mode & (RELOAD_COMMIT | RELOAD_CATALOG)) && server->zone_db != NULL;
+	knot_zonedb_t *db_new = delta ?
+	                        update_zonedb(conf, server, mode, &contents_tofree) :
+	                        create_zonedb(conf, server, mode, &contents_tofree);
 	if (db_new == NULL) {
 		log_error("failed to create new zone database");
 		return;
 	}
 
-	catalogs_generate(db_new, server->zone_db);
+	if (delta) {
+		generate_catalogs_delta(conf, server, db_new, mode);
+	} else {
+		catalogs_generate(db_new, server->zone_db);
+	}
+
+	/* Initial loads wait for the workers, start with the largest zones
+	 * so that they don't delay the startup at the end. */
+	if (server->zone_db == NULL) {
+		worker_pool_sort(server->workers, zone_load_weight);
+	}
 
 	/* Switch the databases. */
 	knot_zonedb_t **db_current = &server->zone_db;
 	knot_zonedb_t *db_old = rcu_xchg_pointer(db_current, db_new);
+	answer_cache_invalidate();
 
 	/* Wait for readers to finish reading old zone database. */
 	synchronize_rcu();
 
-	ptrlist_free_custom(&contents_tofree, NULL, zone_contents_deep_free_wrap);
+	ptrnode_t *n;
+	WALK_LIST(n, contents_tofree) {
+		knot_reclaim_defer(global_reclaim, zone_contents_deep_free_wrap, n->d);
+	}
+	ptrlist_free(&contents_tofree, NULL);
 
 	/* Remove old zone DB. */
 	remove_old_zonedb(conf, db_old, server, mode);
@@ -660,6 +1076,7 @@ int zone_reload_modules(conf_t *conf, server_t *server, const knot_dname_t *zone
 	                      &newzone->query_plan);
 
 	zone_t *oldzone = rcu_xchg_pointer(zone, newzone);
+	answer_cache_invalidate();
 	synchronize_rcu();
 
 	replan_events(conf, newzone, oldzone);
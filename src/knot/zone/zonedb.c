@@ -65,6 +65,81 @@ knot_zonedb_t *knot_zonedb_new(void)
 	return db;
 }
 
+static trie_val_t zone_ptr_dup(const trie_val_t val, _unused_ knot_mm_t *mm)
+{
+	return val;
+}
+
+knot_zonedb_t *knot_zonedb_dup(knot_zonedb_t *db)
+{
+	if (db == NULL) {
+		return NULL;
+	}
+
+	knot_zonedb_t *copy = calloc(1, sizeof(knot_zonedb_t));
+	if (copy == NULL) {
+		return NULL;
+	}
+
+	mm_ctx_mempool(&copy->mm, MM_DEFAULT_BLKSIZE);
+
+	copy->trie = trie_dup(db->trie, zone_ptr_dup, &copy->mm);
+	if (copy->trie == NULL) {
+		mp_delete(copy->mm.ctx);
+		free(copy);
+		return NULL;
+	}
+
+	return copy;
+}
+
+knot_zonedb_t *knot_zonedb_cow(knot_zonedb_t *db)
+{
+	if (db == NULL) {
+		return NULL;
+	}
+
+	assert(db->cow == NULL);
+
+	// Memory of the replaced trie nodes is reclaimed with the pool only.
+	if (db->cow_garbage > trie_weight(db->trie)) {
+		return knot_zonedb_dup(db);
+	}
+
+	knot_zonedb_t *copy = calloc(1, sizeof(knot_zonedb_t));
+	if (copy == NULL) {
+		return NULL;
+	}
+
+	copy->cow = trie_cow(db->trie, NULL, NULL);
+	if (copy->cow == NULL) {
+		free(copy);
+		return NULL;
+	}
+	copy->trie = trie_cow_new(copy->cow);
+	copy->cow_garbage = db->cow_garbage;
+	copy->mm = db->mm;
+
+	db->cow = copy->cow;
+	db->cow_peer = copy;
+	copy->cow_peer = db;
+
+	return copy;
+}
+
+static void cow_finish(knot_zonedb_t *db)
+{
+	knot_zonedb_t *peer = db->cow_peer;
+	if (trie_cow_new(db->cow) == db->trie) {
+		(void)trie_cow_rollback(db->cow, NULL, NULL);
+	} else {
+		(void)trie_cow_commit(db->cow, NULL, NULL);
+	}
+
+	peer->cow = NULL;
+	peer->cow_peer = NULL;
+}
+
 int knot_zonedb_insert(knot_zonedb_t *db, zone_t *zone)
 {
 	if (db == NULL || zone == NULL) {
@@ -76,7 +151,13 @@ int knot_zonedb_insert(knot_zonedb_t *db, zone_t *zone)
 	uint8_t *lf = knot_dname_lf(zone->name, lf_storage);
 	assert(lf);
 
-	*trie_get_ins(db->trie, lf + 1, *lf) = zone;
+	if (db->cow != NULL) {
+		assert(trie_cow_new(db->cow) == db->trie);
+		*trie_get_cow(db->cow, lf + 1, *lf) = zone;
+		db->cow_garbage++;
+	} else {
+		*trie_get_ins(db->trie, lf + 1, *lf) = zone;
+	}
 
 	return KNOT_EOK;
 }
@@ -96,6 +177,12 @@ int knot_zonedb_del(knot_zonedb_t *db, const knot_dname_t *zone_name)
 		return KNOT_ENOENT;
 	}
 
+	if (db->cow != NULL) {
+		assert(trie_cow_new(db->cow) == db->trie);
+		db->cow_garbage++;
+		return trie_del_cow(db->cow, lf + 1, *lf, NULL);
+	}
+
 	return trie_del(db->trie, lf + 1, *lf, NULL);
 }
 
@@ -141,20 +228,12 @@ zone_t *knot_zonedb_find_suffix(knot_zonedb_t *db, const knot_dname_t *zone_name
 		return NULL;
 	}
 
-	while (true) {
-		knot_dname_storage_t lf_storage;
-		uint8_t *lf = knot_dname_lf(zone_name, lf_storage);
-		assert(lf);
-
-		trie_val_t *val = trie_get_try(db->trie, lf + 1, *lf);
-		if (val != NULL) {
-			return *val;
-		} else if (zone_name[0] == 0) {
-			return NULL;
-		}
+	knot_dname_storage_t lf_storage;
+	uint8_t *lf = knot_dname_lf(zone_name, lf_storage);
+	assert(lf);
 
-		zone_name = knot_dname_next_label(zone_name);
-	}
+	trie_val_t *val = trie_get_prefix(db->trie, lf + 1, *lf);
+	return (val != NULL) ? *val : NULL;
 }
 
 size_t knot_zonedb_size(const knot_zonedb_t *db)
@@ -172,7 +251,12 @@ void knot_zonedb_free(knot_zonedb_t **db)
 		return;
 	}
 
-	mp_delete((*db)->mm.ctx);
+	// The memory pool is shared with the transaction peer, which keeps it.
+	if ((*db)->cow != NULL) {
+		cow_finish(*db);
+	} else {
+		mp_delete((*db)->mm.ctx);
+	}
 	free(*db);
 	*db = NULL;
 }
@@ -28,6 +28,9 @@
 
 struct knot_zonedb {
 	trie_t *trie;
+	trie_cow_t *cow;              /*!< Pending copy-on-write transaction. */
+	struct knot_zonedb *cow_peer; /*!< The other database of the transaction. */
+	size_t cow_garbage;           /*!< Unreclaimed nodes after transactions. */
 	knot_mm_t mm;
 };
 
@@ -62,6 +65,32 @@ typedef trie_it_t knot_zonedb_iter_t;
  */
 knot_zonedb_t *knot_zonedb_new(void);
 
+/*!
+ * \brief Creates a copy of the zone database sharing the zones.
+ *
+ * \param db Zone database to be copied.
+ *
+ * \return New zone database or NULL if out of memory.
+ */
+knot_zonedb_t *knot_zonedb_dup(knot_zonedb_t *db);
+
+/*!
+ * \brief Creates a copy-on-write copy of the zone database sharing the zones.
+ *
+ * The copy can be modified while the original is still being read. Only
+ * the modified paths of the trie are copied. Once the original isn't read
+ * anymore (e.g. after synchronize_rcu()), it's freed with knot_zonedb_free(),
+ * which also finishes the copy-on-write transaction.
+ *
+ * \note If a lot of modifications have accumulated in the shared memory pool,
+ *       a regular copy is created instead, see knot_zonedb_dup().
+ *
+ * \param db Zone database to be copied.
+ *
+ * \return New zone database or NULL if out of memory.
+ */
+knot_zonedb_t *knot_zonedb_cow(knot_zonedb_t *db);
+
 /*!
  * \brief Adds new zone to the database.
  *
@@ -122,6 +151,9 @@ size_t knot_zonedb_size(const knot_zonedb_t *db);
  * \brief Destroys and deallocates the zone database structure (but not the
  *        zones within).
  *
+ * If the database is the original of a copy-on-write transaction, the
+ * transaction is committed, if it's the copy, the transaction is rolled back.
+ *
  * \param db Zone database to be destroyed.
  */
 void knot_zonedb_free(knot_zonedb_t **db);
@@ -24,11 +24,20 @@
 #include <time.h>
 #include <unistd.h>
 #include <inttypes.h>
+#include <pthread.h>
+#include <strings.h>
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
 
 #include "libknot/libknot.h"
 #include "contrib/files.h"
+#include "contrib/macros.h"
+#include "contrib/wire_ctx.h"
 #include "knot/common/log.h"
+#include "knot/dnssec/kasp/kasp_db.h"
 #include "knot/dnssec/zone-nsec.h"
+#include "knot/journal/serialization.h"
 #include "knot/zone/semantic-check.h"
 #include "knot/zone/adjust.h"
 #include "knot/zone/contents.h"
@@ -39,17 +48,20 @@
 #define WARNING(zone, fmt, ...) log_zone_warning(zone, "zone loader, " fmt, ##__VA_ARGS__)
 #define NOTICE(zone, fmt, ...) log_zone_notice(zone, "zone loader, " fmt, ##__VA_ARGS__)
 
-static void process_error(zs_scanner_t *s)
+static void log_scanner_error(const knot_dname_t *zname, zs_scanner_t *s)
 {
-	zcreator_t *zc = s->process.data;
-	const knot_dname_t *zname = zc->z->apex->owner;
-
 	ERROR(zname, "%s in zone, file '%s', line %"PRIu64" (%s)",
 	      s->error.fatal ? "fatal error" : "error",
 	      s->file.name, s->line_counter,
 	      zs_strerror(s->error.code));
 }
 
+static void process_error(zs_scanner_t *s)
+{
+	zcreator_t *zc = s->process.data;
+	log_scanner_error(zc->z->apex->owner, s);
+}
+
 static bool handle_err(zcreator_t *zc, const knot_rrset_t *rr, int ret, bool master)
 {
 	const knot_dname_t *zname = zc->z->apex->owner;
@@ -75,14 +87,19 @@ static bool handle_err(zcreator_t *zc, const knot_rrset_t *rr, int ret, bool mas
 	}
 }
 
-int zcreator_step(zcreator_t *zc, const knot_rrset_t *rr)
+static int zcreator_insert(zcreator_t *zc, const knot_rrset_t *rr)
 {
-	if (zc == NULL || rr == NULL || rr->rrs.count != 1) {
-		return KNOT_EINVAL;
+	// Consecutive records of the same owner go to the same node.
+	bool nsec3 = knot_rrset_is_nsec3rel(rr);
+	zone_node_t *node = NULL;
+	if (zc->last_node != NULL && zc->last_nsec3 == nsec3 &&
+	    knot_dname_is_equal(zc->last_node->owner, rr->owner)) {
+		node = zc->last_node;
 	}
 
-	zone_node_t *node = NULL;
 	int ret = zone_contents_add_rr(zc->z, rr, &node);
+	zc->last_node = node;
+	zc->last_nsec3 = nsec3;
 	if (ret != KNOT_EOK) {
 		if (!handle_err(zc, rr, ret, zc->master)) {
 			// Fatal error
@@ -93,6 +110,62 @@ int zcreator_step(zcreator_t *zc, const knot_rrset_t *rr)
 	return KNOT_EOK;
 }
 
+int zcreator_step(zcreator_t *zc, const knot_rrset_t *rr)
+{
+	if (zc == NULL || rr == NULL || rr->rrs.count != 1) {
+		return KNOT_EINVAL;
+	}
+
+	// Differing TTLs are merged by the zone insertion.
+	knot_rrset_t *pending = &zc->pending;
+	if (zc->builder.rrs.count > 0 &&
+	    (pending->type != rr->type || pending->rclass != rr->rclass ||
+	     pending->ttl != rr->ttl || !knot_dname_is_equal(pending->owner, rr->owner))) {
+		int ret = zcreator_finish(zc);
+		if (ret != KNOT_EOK) {
+			return ret;
+		}
+	}
+
+	if (zc->builder.rrs.count == 0) {
+		memcpy(zc->pending_owner, rr->owner, knot_dname_size(rr->owner));
+		knot_rrset_init(pending, zc->pending_owner, rr->type, rr->rclass, rr->ttl);
+	}
+
+	return knot_rdataset_builder_add(&zc->builder, rr->rrs.rdata->data,
+	                                 rr->rrs.rdata->len);
+}
+
+int zcreator_finish(zcreator_t *zc)
+{
+	if (zc == NULL) {
+		return KNOT_EINVAL;
+	}
+
+	if (zc->builder.rrs.count == 0) {
+		return KNOT_EOK;
+	}
+
+	knot_rrset_t *pending = &zc->pending;
+	int ret = knot_rdataset_builder_finish(&zc->builder, &pending->rrs);
+	if (ret != KNOT_EOK) {
+		knot_rdataset_builder_clear(&zc->builder);
+		return ret;
+	}
+
+	ret = zcreator_insert(zc, pending);
+	knot_rdataset_clear(&pending->rrs, NULL);
+
+	return ret;
+}
+
+void zcreator_clear(zcreator_t *zc)
+{
+	if (zc != NULL) {
+		knot_rdataset_builder_clear(&zc->builder);
+	}
+}
+
 /*! \brief Creates RR from parser input, passes it to handling function. */
 static void process_data(zs_scanner_t *scanner)
 {
@@ -102,32 +175,687 @@ static void process_data(zs_scanner_t *scanner)
 		return;
 	}
 
-	knot_dname_t *owner = knot_dname_copy(scanner->r_owner, NULL);
-	if (owner == NULL) {
-		zc->ret = KNOT_ENOMEM;
-		return;
-	}
+	/* The record is copied into the zone, build it on the stack. */
+	knot_dname_storage_t owner;
+	memcpy(owner, scanner->r_owner, knot_dname_size(scanner->r_owner));
+
+	uint8_t rdata[knot_rdata_size(UINT16_MAX)];
+	knot_rdata_init((knot_rdata_t *)rdata, scanner->r_data_length, scanner->r_data);
 
 	knot_rrset_t rr;
 	knot_rrset_init(&rr, owner, scanner->r_type, scanner->r_class, scanner->r_ttl);
+	rr.rrs.count = 1;
+	rr.rrs.size = knot_rdata_size(scanner->r_data_length);
+	rr.rrs.rdata = (knot_rdata_t *)rdata;
 
-	int ret = knot_rrset_add_rdata(&rr, scanner->r_data, scanner->r_data_length, NULL);
+	/* Convert RDATA dnames to lowercase before adding to zone. */
+	int ret = knot_rrset_rr_to_canonical(&rr);
 	if (ret != KNOT_EOK) {
-		knot_rrset_clear(&rr, NULL);
 		zc->ret = ret;
 		return;
 	}
 
+	zc->ret = zcreator_step(zc, &rr);
+}
+
+/*! \brief Minimal text size of a zone file chunk parsed in parallel. */
+#define CHUNK_SIZE (16 * 1024 * 1024)
+
+/*! \brief Parsed record stored in a chunk buffer, followed by RDATA and owner. */
+typedef struct {
+	uint32_t ttl;
+	uint16_t type;
+	uint16_t rclass;
+	uint16_t owner_len;
+	knot_rdata_t rdata[];
+} chunk_rr_t;
+
+typedef struct zparallel zparallel_t;
+
+/*! \brief Zone file part parsed by one scanner. */
+typedef struct {
+	zparallel_t *ctx;
+	const char *start;  /*!< Text of the chunk. */
+	size_t size;        /*!< Text length. */
+	uint64_t line;      /*!< Line number of the chunk beginning. */
+	size_t replay_len;  /*!< Length of the preceding directives to replay. */
+	uint8_t *rrs;       /*!< Parsed records. */
+	size_t rrs_size;
+	size_t rrs_max;
+	uint64_t errors;    /*!< Scanner error counter. */
+	int error_code;     /*!< Last scanner error code. */
+	int ret;
+	bool done;
+} zchunk_t;
+
+struct zparallel {
+	zloader_t *loader;
+	char *origin;       /*!< Textual zone origin. */
+	char *replay;       /*!< $ORIGIN and $TTL directives in order of appearance. */
+	size_t replay_len;
+	zchunk_t *chunks;
+	size_t count;
+	size_t next;        /*!< Next chunk to be parsed. */
+	size_t inserted;    /*!< Number of chunks inserted into the zone. */
+	size_t window;      /*!< Maximum of parsed but not inserted chunks. */
+	bool stop;
+	pthread_mutex_t mx;
+	pthread_cond_t cond;
+};
+
+static size_t chunk_rr_size(size_t owner_len, uint16_t rdlen)
+{
+	size_t size = sizeof(chunk_rr_t) + knot_rdata_size(rdlen) + owner_len;
+	return (size + sizeof(uint32_t) - 1) & ~(sizeof(uint32_t) - 1);
+}
+
+static knot_dname_t *chunk_rr_owner(chunk_rr_t *rr)
+{
+	return (uint8_t *)rr->rdata + knot_rdata_size(rr->rdata->len);
+}
+
+static void process_chunk_error(zs_scanner_t *s)
+{
+	zchunk_t *chunk = s->process.data;
+	log_scanner_error(chunk->ctx->loader->creator->z->apex->owner, s);
+}
+
+static void process_chunk_data(zs_scanner_t *s)
+{
+	zchunk_t *chunk = s->process.data;
+	if (chunk->ret != KNOT_EOK) {
+		s->state = ZS_STATE_STOP;
+		return;
+	}
+
+	size_t owner_len = knot_dname_size(s->r_owner);
+	size_t rr_size = chunk_rr_size(owner_len, s->r_data_length);
+	if (chunk->rrs_size + rr_size > chunk->rrs_max) {
+		size_t new_max = MAX(2 * chunk->rrs_max, chunk->size / 2);
+		new_max = MAX(new_max, chunk->rrs_size + rr_size);
+		uint8_t *new_rrs = realloc(chunk->rrs, new_max);
+		if (new_rrs == NULL) {
+			chunk->ret = KNOT_ENOMEM;
+			s->state = ZS_STATE_STOP;
+			return;
+		}
+		chunk->rrs = new_rrs;
+		chunk->rrs_max = new_max;
+	}
+
+	chunk_rr_t *rr = (chunk_rr_t *)(chunk->rrs + chunk->rrs_size);
+	rr->ttl = s->r_ttl;
+	rr->type = s->r_type;
+	rr->rclass = s->r_class;
+	rr->owner_len = owner_len;
+	knot_rdata_init(rr->rdata, s->r_data_length, s->r_data);
+	memcpy(chunk_rr_owner(rr), s->r_owner, owner_len);
+
+	knot_rrset_t rrset;
+	knot_rrset_init(&rrset, chunk_rr_owner(rr), rr->type, rr->rclass, rr->ttl);
+	rrset.rrs.count = 1;
+	rrset.rrs.size = knot_rdata_size(rr->rdata->len);
+	rrset.rrs.rdata = rr->rdata;
+
 	/* Convert RDATA dnames to lowercase before adding to zone. */
-	ret = knot_rrset_rr_to_canonical(&rr);
-	if (ret != KNOT_EOK) {
-		knot_rrset_clear(&rr, NULL);
-		zc->ret = ret;
+	chunk->ret = knot_rrset_rr_to_canonical(&rrset);
+	if (chunk->ret == KNOT_EOK) {
+		chunk->rrs_size += rr_size;
+	}
+}
+
+static int insert_chunk(zcreator_t *zc, zchunk_t *chunk)
+{
+	size_t pos = 0;
+	while (pos < chunk->rrs_size) {
+		chunk_rr_t *rr = (chunk_rr_t *)(chunk->rrs + pos);
+
+		knot_rrset_t rrset;
+		knot_rrset_init(&rrset, chunk_rr_owner(rr), rr->type, rr->rclass, rr->ttl);
+		rrset.rrs.count = 1;
+		rrset.rrs.size = knot_rdata_size(rr->rdata->len);
+		rrset.rrs.rdata = rr->rdata;
+
+		int ret = zcreator_step(zc, &rrset);
+		if (ret != KNOT_EOK) {
+			return ret;
+		}
+
+		pos += chunk_rr_size(rr->owner_len, rr->rdata->len);
+	}
+
+	return chunk->ret;
+}
+
+static void parse_chunk(zparallel_t *ctx, zchunk_t *chunk, zs_scanner_t *s)
+{
+	zs_scanner_t *main_s = &ctx->loader->scanner;
+
+	if (zs_init(s, ctx->origin, main_s->default_class, main_s->default_ttl) != 0) {
+		chunk->ret = KNOT_ENOMEM;
 		return;
 	}
 
-	zc->ret = zcreator_step(zc, &rr);
-	knot_rrset_clear(&rr, NULL);
+	/* Restore the origin and default TTL valid at the chunk beginning. */
+	if (chunk->replay_len > 0 &&
+	    zs_set_input_string(s, ctx->replay, chunk->replay_len) == 0) {
+		(void)zs_parse_all(s);
+		s->error.counter = 0; // Errors are reported within the chunk.
+	}
+
+	/* Relative includes and error messages refer to the zone file. */
+	char *path = strdup(main_s->path);
+	char *name = strdup(main_s->file.name);
+	if (path == NULL || name == NULL ||
+	    zs_set_input_string(s, chunk->start, chunk->size) != 0 ||
+	    zs_set_processing(s, process_chunk_data, process_chunk_error, chunk) != 0) {
+		free(path);
+		free(name);
+		chunk->ret = KNOT_ENOMEM;
+		zs_deinit(s);
+		return;
+	}
+	free(s->path);
+	s->path = path;
+	s->file.name = name;
+	s->line_counter = chunk->line;
+
+	(void)zs_parse_all(s);
+	chunk->errors = s->error.counter;
+	chunk->error_code = s->error.code;
+
+	zs_deinit(s);
+}
+
+static void *parse_thread(void *arg)
+{
+	zparallel_t *ctx = arg;
+
+	zs_scanner_t *s = malloc(sizeof(*s));
+
+	pthread_mutex_lock(&ctx->mx);
+	while (true) {
+		while (!ctx->stop && ctx->next < ctx->count &&
+		       ctx->next >= ctx->inserted + ctx->window) {
+			pthread_cond_wait(&ctx->cond, &ctx->mx);
+		}
+		if (ctx->stop || ctx->next >= ctx->count) {
+			break;
+		}
+		zchunk_t *chunk = &ctx->chunks[ctx->next++];
+		pthread_mutex_unlock(&ctx->mx);
+
+		if (s != NULL) {
+			parse_chunk(ctx, chunk, s);
+		} else {
+			chunk->ret = KNOT_ENOMEM;
+		}
+
+		pthread_mutex_lock(&ctx->mx);
+		chunk->done = true;
+		pthread_cond_broadcast(&ctx->cond);
+	}
+	pthread_mutex_unlock(&ctx->mx);
+
+	free(s);
+
+	return NULL;
+}
+
+static bool is_blank(char c)
+{
+	return c == ' ' || c == '\t';
+}
+
+static bool is_state_directive(const char *p, const char *end)
+{
+	return (end - p > 4 && strncasecmp(p, "$TTL", 4) == 0 && is_blank(p[4])) ||
+	       (end - p > 7 && strncasecmp(p, "$ORIGIN", 7) == 0 && is_blank(p[7]));
+}
+
+static bool is_owner_start(char c)
+{
+	return strchr(" \t\r\n;$()\"", c) == NULL;
+}
+
+static int add_replay(zparallel_t *ctx, const char *start, const char *end)
+{
+	size_t len = end - start;
+	char *replay = realloc(ctx->replay, ctx->replay_len + len + 1);
+	if (replay == NULL) {
+		return KNOT_ENOMEM;
+	}
+	memcpy(replay + ctx->replay_len, start, len);
+	replay[ctx->replay_len + len] = '\n';
+	ctx->replay = replay;
+	ctx->replay_len += len + 1;
+
+	return KNOT_EOK;
+}
+
+/*! \brief Position lookup of characters significant for the chunk splitting. */
+typedef struct {
+	const char *base; /*!< Start of the classified 64-byte block. */
+	uint64_t mask;    /*!< Structural character positions in the block. */
+} zlexer_t;
+
+static bool is_structural(char c)
+{
+	return c == '\n' || c == '"' || c == ';' || c == '(' || c == ')' || c == '\\';
+}
+
+/*! \brief Returns a bitmap of structural characters in up to 64 bytes. */
+static uint64_t structural_mask(const char *p, size_t len)
+{
+	uint64_t mask = 0;
+	size_t i = 0;
+#ifdef __SSE2__
+	const __m128i nl = _mm_set1_epi8('\n'), qt = _mm_set1_epi8('"'),
+	              sc = _mm_set1_epi8(';'), lp = _mm_set1_epi8('('),
+	              rp = _mm_set1_epi8(')'), bs = _mm_set1_epi8('\\');
+	for (; i + 16 <= len; i += 16) {
+		__m128i v = _mm_loadu_si128((const __m128i *)(p + i));
+		__m128i m = _mm_or_si128(
+			_mm_or_si128(_mm_or_si128(_mm_cmpeq_epi8(v, nl), _mm_cmpeq_epi8(v, qt)),
+			             _mm_or_si128(_mm_cmpeq_epi8(v, sc), _mm_cmpeq_epi8(v, bs))),
+			_mm_or_si128(_mm_cmpeq_epi8(v, lp), _mm_cmpeq_epi8(v, rp)));
+		mask |= (uint64_t)(uint16_t)_mm_movemask_epi8(m) << i;
+	}
+#endif
+	for (; i < len; i++) {
+		mask |= (uint64_t)is_structural(p[i]) << i;
+	}
+	return mask;
+}
+
+/*! \brief Returns the first structural character at or after 'from', or 'end'. */
+static const char *lexer_next(zlexer_t *lex, const char *from, const char *end)
+{
+	while (from < end) {
+		if (lex->base == NULL || from < lex->base || from - lex->base >= 64) {
+			lex->base = from;
+			lex->mask = structural_mask(from, MIN(end - from, 64));
+		}
+		uint64_t mask = lex->mask & (UINT64_MAX << (from - lex->base));
+		if (mask != 0) {
+			return lex->base + __builtin_ctzll(mask);
+		}
+		if (end - lex->base <= 64) {
+			break;
+		}
+		from = lex->base + 64;
+	}
+	return end;
+}
+
+/*!
+ * \brief Splits the zone file text into chunks starting with a record owner.
+ *
+ * The text is lexically pre-scanned to find line beginnings outside of
+ * parentheses, quoted strings, and comments. Only the structural characters
+ * are visited, found by 64-byte block classification. The $ORIGIN and $TTL
+ * directives are collected so that each chunk scanner can start with the
+ * right state.
+ */
+static int split_chunks(zparallel_t *ctx, const char *data, size_t size)
+{
+	const char *end = data + size;
+	size_t max = size / CHUNK_SIZE + 1;
+
+	ctx->chunks = calloc(max, sizeof(*ctx->chunks));
+	if (ctx->chunks == NULL) {
+		return KNOT_ENOMEM;
+	}
+	ctx->chunks[0] = (zchunk_t){ .ctx = ctx, .start = data, .line = 1 };
+	ctx->count = 1;
+
+	zlexer_t lex = { 0 };
+	const char *directive = NULL;
+	uint64_t line = 1;
+	int depth = 0;
+	bool line_start = true, quoted = false, comment = false;
+
+	const char *p = data;
+	while (p < end) {
+		if (line_start) {
+			line_start = false;
+			zchunk_t *last = &ctx->chunks[ctx->count - 1];
+			if (*p == '$' && is_state_directive(p, end)) {
+				directive = p;
+			} else if (ctx->count < max && p - last->start >= CHUNK_SIZE &&
+			           is_owner_start(*p)) {
+				last->size = p - last->start;
+				ctx->chunks[ctx->count++] = (zchunk_t){
+					.ctx = ctx,
+					.start = p,
+					.line = line,
+					.replay_len = ctx->replay_len
+				};
+			}
+		}
+
+		p = lexer_next(&lex, p, end);
+		if (p == end) {
+			break;
+		}
+
+		char c = *p++;
+		if (comment) {
+			if (c != '\n') {
+				continue;
+			}
+			comment = false;
+		} else if (c == '\\') {
+			if (p < end && *p++ == '\n') {
+				line++;
+			}
+			continue;
+		} else if (quoted) {
+			if (c == '"') {
+				quoted = false;
+			}
+			if (c != '\n') {
+				continue;
+			}
+		} else {
+			switch (c) {
+			case '"':  quoted = true; continue;
+			case ';':  comment = true; continue;
+			case '(':  depth++; continue;
+			case ')':  depth--; continue;
+			case '\n': break;
+			default:   continue;
+			}
+		}
+
+		line++;
+		if (depth == 0 && !quoted) {
+			line_start = true;
+			if (directive != NULL) {
+				int ret = add_replay(ctx, directive, p - 1);
+				if (ret != KNOT_EOK) {
+					return ret;
+				}
+				directive = NULL;
+			}
+		}
+	}
+
+	ctx->chunks[ctx->count - 1].size = end - ctx->chunks[ctx->count - 1].start;
+
+	return KNOT_EOK;
+}
+
+static int parse_parallel(zloader_t *loader)
+{
+	zs_scanner_t *s = &loader->scanner;
+	zcreator_t *zc = loader->creator;
+
+	if (s->input.start == NULL || s->file.name == NULL) {
+		return KNOT_ENOTSUP;
+	}
+
+	zparallel_t ctx = {
+		.loader = loader,
+		.window = 2 * loader->threads,
+	};
+
+	int ret = split_chunks(&ctx, s->input.start, s->input.end - s->input.start);
+	if (ret != KNOT_EOK || ctx.count < 2) {
+		free(ctx.chunks);
+		free(ctx.replay);
+		return (ret != KNOT_EOK) ? ret : KNOT_ENOTSUP;
+	}
+
+	ctx.origin = knot_dname_to_str_alloc(zc->z->apex->owner);
+	if (ctx.origin == NULL) {
+		free(ctx.chunks);
+		free(ctx.replay);
+		return KNOT_ENOMEM;
+	}
+
+	pthread_mutex_init(&ctx.mx, NULL);
+	pthread_cond_init(&ctx.cond, NULL);
+
+	unsigned threads = MIN(loader->threads, ctx.count);
+	pthread_t thread[threads];
+	unsigned started = 0;
+	for (unsigned i = 0; i < threads; i++) {
+		if (pthread_create(&thread[started], NULL, parse_thread, &ctx) == 0) {
+			started++;
+		}
+	}
+	if (started == 0) {
+		ret = KNOT_ENOMEM;
+		ctx.count = 0;
+	}
+
+	/* Insert the parsed chunks in the order of appearance. */
+	for (size_t i = 0; i < ctx.count; i++) {
+		zchunk_t *chunk = &ctx.chunks[i];
+
+		pthread_mutex_lock(&ctx.mx);
+		while (!chunk->done) {
+			pthread_cond_wait(&ctx.cond, &ctx.mx);
+		}
+		pthread_mutex_unlock(&ctx.mx);
+
+		if (zc->ret == KNOT_EOK) {
+			zc->ret = insert_chunk(zc, chunk);
+		}
+		s->error.counter += chunk->errors;
+		if (chunk->errors > 0) {
+			s->error.code = chunk->error_code;
+		}
+		free(chunk->rrs);
+		chunk->rrs = NULL;
+
+		pthread_mutex_lock(&ctx.mx);
+		ctx.inserted = i + 1;
+		ctx.stop = (zc->ret != KNOT_EOK);
+		pthread_cond_broadcast(&ctx.cond);
+		pthread_mutex_unlock(&ctx.mx);
+
+		if (ctx.stop) {
+			break;
+		}
+	}
+
+	for (unsigned i = 0; i < started; i++) {
+		pthread_join(thread[i], NULL);
+	}
+
+	for (size_t i = 0; i < ctx.count; i++) {
+		free(ctx.chunks[i].rrs);
+	}
+	pthread_cond_destroy(&ctx.cond);
+	pthread_mutex_destroy(&ctx.mx);
+	free(ctx.chunks);
+	free(ctx.replay);
+	free(ctx.origin);
+
+	return ret;
+}
+
+/*
+ * Binary zone file: magic, number of RRSets (64-bit), and the RRSets in
+ * the canonical order, serialized the same way as in the journal.
+ */
+static const uint8_t BIN_MAGIC[8] = "\0KnotZF1";
+#define BIN_HEADER_SIZE (sizeof(BIN_MAGIC) + sizeof(uint64_t))
+#define BIN_BUF_SIZE (1024 * 1024)
+
+static bool is_binary(zs_scanner_t *s)
+{
+	return s->input.start != NULL &&
+	       s->input.end - s->input.start >= BIN_HEADER_SIZE &&
+	       memcmp(s->input.start, BIN_MAGIC, sizeof(BIN_MAGIC)) == 0;
+}
+
+static int load_binary_rrset(zcreator_t *zc, wire_ctx_t *wire, uint8_t **rdata,
+                             size_t *rdata_max)
+{
+	// The owner is used directly from the input, it's copied into the zone.
+	const uint8_t *owner = wire->position;
+	int owner_size = knot_dname_wire_check(owner, owner + wire_ctx_available(wire), NULL);
+	if (owner_size <= 0) {
+		return KNOT_EMALF;
+	}
+	wire_ctx_skip(wire, owner_size);
+
+	knot_rrset_t rr;
+	knot_rrset_init(&rr, (knot_dname_t *)owner, 0, 0, 0);
+	rr.type = wire_ctx_read_u16(wire);
+	rr.rclass = wire_ctx_read_u16(wire);
+	rr.rrs.count = wire_ctx_read_u16(wire);
+	if (wire->error != KNOT_EOK || rr.rrs.count == 0) {
+		return KNOT_EMALF;
+	}
+
+	size_t prev_offset = 0;
+	for (uint16_t i = 0; i < rr.rrs.count; i++) {
+		uint32_t ttl = wire_ctx_read_u32(wire);
+		uint16_t len = wire_ctx_read_u16(wire);
+		if (wire->error != KNOT_EOK || wire_ctx_available(wire) < len) {
+			return KNOT_EMALF;
+		}
+		if (i == 0) {
+			rr.ttl = ttl;
+		}
+
+		size_t rr_size = knot_rdata_size(len);
+		if (rr.rrs.size + rr_size > *rdata_max) {
+			size_t new_max = MAX(2 * *rdata_max, rr.rrs.size + rr_size);
+			uint8_t *new_rdata = realloc(*rdata, new_max);
+			if (new_rdata == NULL) {
+				return KNOT_ENOMEM;
+			}
+			*rdata = new_rdata;
+			*rdata_max = new_max;
+		}
+		rr.rrs.rdata = (knot_rdata_t *)*rdata;
+
+		knot_rdata_t *cur = (knot_rdata_t *)(*rdata + rr.rrs.size);
+		knot_rdata_init(cur, len, wire->position);
+		wire_ctx_skip(wire, len);
+
+		// The rdataset is stored sorted and without duplicates.
+		knot_rdata_t *prev = (knot_rdata_t *)(*rdata + prev_offset);
+		if (i > 0 && knot_rdata_cmp(prev, cur) >= 0) {
+			return KNOT_EMALF;
+		}
+		prev_offset = rr.rrs.size;
+		rr.rrs.size += rr_size;
+	}
+
+	zone_node_t *node = NULL;
+	return zone_contents_add_rr(zc->z, &rr, &node);
+}
+
+static int load_binary(zloader_t *loader)
+{
+	zs_scanner_t *s = &loader->scanner;
+	wire_ctx_t wire = wire_ctx_init_const((const uint8_t *)s->input.start,
+	                                      s->input.end - s->input.start);
+	wire_ctx_skip(&wire, sizeof(BIN_MAGIC));
+	uint64_t count = wire_ctx_read_u64(&wire);
+
+	size_t rdata_max = knot_rdata_size(UINT16_MAX);
+	uint8_t *rdata = malloc(rdata_max);
+	if (rdata == NULL) {
+		return KNOT_ENOMEM;
+	}
+
+	int ret = KNOT_EOK;
+	for (uint64_t i = 0; i < count && ret == KNOT_EOK; i++) {
+		ret = load_binary_rrset(loader->creator, &wire, &rdata, &rdata_max);
+	}
+	if (ret == KNOT_EOK && wire_ctx_available(&wire) != 0) {
+		ret = KNOT_EMALF;
+	}
+	free(rdata);
+
+	return ret;
+}
+
+static int write_binary_tree(zone_tree_t *tree, FILE *file, wire_ctx_t *wire,
+                             uint64_t *count)
+{
+	if (zone_tree_is_empty(tree)) {
+		return KNOT_EOK;
+	}
+
+	zone_tree_it_t it = { 0 };
+	int ret = zone_tree_it_begin(tree, &it);
+	while (ret == KNOT_EOK && !zone_tree_it_finished(&it)) {
+		zone_node_t *node = zone_tree_it_val(&it);
+		for (uint16_t i = 0; i < node->rrset_count && ret == KNOT_EOK; i++) {
+			knot_rrset_t rrset = node_rrset_at(node, i);
+			size_t size = rrset_serialized_size(&rrset);
+			if (size > wire_ctx_available(wire)) {
+				if (fwrite(wire->wire, 1, wire_ctx_offset(wire), file) != wire_ctx_offset(wire)) {
+					ret = KNOT_EFILE;
+					break;
+				}
+				wire_ctx_set_offset(wire, 0);
+			}
+			if (size > wire_ctx_available(wire)) { // too big for the buffer
+				uint8_t *big = malloc(size);
+				if (big == NULL) {
+					ret = KNOT_ENOMEM;
+					break;
+				}
+				wire_ctx_t big_wire = wire_ctx_init(big, size);
+				ret = serialize_rrset(&big_wire, &rrset);
+				if (ret == KNOT_EOK && fwrite(big, 1, size, file) != size) {
+					ret = KNOT_EFILE;
+				}
+				free(big);
+			} else {
+				ret = serialize_rrset(wire, &rrset);
+			}
+			(*count)++;
+		}
+		zone_tree_it_next(&it);
+	}
+	zone_tree_it_free(&it);
+
+	return ret;
+}
+
+static int write_binary(zone_contents_t *zone, FILE *file)
+{
+	uint8_t *buf = malloc(BIN_BUF_SIZE);
+	if (buf == NULL) {
+		return KNOT_ENOMEM;
+	}
+	wire_ctx_t wire = wire_ctx_init(buf, BIN_BUF_SIZE);
+
+	// The RRSet count is filled in when known.
+	wire_ctx_write(&wire, BIN_MAGIC, sizeof(BIN_MAGIC));
+	wire_ctx_write_u64(&wire, 0);
+
+	uint64_t count = 0;
+	int ret = write_binary_tree(zone->nodes, file, &wire, &count);
+	if (ret == KNOT_EOK) {
+		ret = write_binary_tree(zone->nsec3_nodes, file, &wire, &count);
+	}
+	if (ret == KNOT_EOK &&
+	    fwrite(buf, 1, wire_ctx_offset(&wire), file) != wire_ctx_offset(&wire)) {
+		ret = KNOT_EFILE;
+	}
+
+	if (ret == KNOT_EOK) {
+		wire = wire_ctx_init(buf, sizeof(uint64_t));
+		wire_ctx_write_u64(&wire, count);
+		if (fseek(file, sizeof(BIN_MAGIC), SEEK_SET) != 0 ||
+		    fwrite(buf, 1, sizeof(uint64_t), file) != sizeof(uint64_t)) {
+			ret = KNOT_EFILE;
+		}
+	}
+	free(buf);
+
+	return ret;
 }
 
 int zonefile_open(zloader_t *loader, const char *source, const knot_dname_t *origin,
@@ -178,6 +906,7 @@ int zonefile_open(zloader_t *loader, const char *source, const knot_dname_t *ori
 
 	loader->source = strdup(source);
 	loader->creator = zc;
+	loader->binary = is_binary(&loader->scanner);
 	loader->semantic_checks = semantic_checks;
 	loader->time = time;
 
@@ -194,13 +923,34 @@ zone_contents_t *zonefile_load(zloader_t *loader)
 	const knot_dname_t *zname = zc->z->apex->owner;
 
 	assert(zc);
-	int ret = zs_parse_all(&loader->scanner);
-	if (ret != 0 && loader->scanner.error.counter == 0) {
+	int ret = KNOT_ENOTSUP;
+	if (loader->binary) {
+		ret = load_binary(loader);
+		if (ret != KNOT_EOK) {
+			ERROR(zname, "failed to load zone, binary file '%s' (%s)",
+			      loader->source, knot_strerror(ret));
+			goto fail;
+		}
+	} else if (loader->threads > 1) {
+		ret = parse_parallel(loader);
+	}
+	if (ret == KNOT_ENOTSUP) {
+		ret = zs_parse_all(&loader->scanner);
+		if (ret != 0 && loader->scanner.error.counter == 0) {
+			ERROR(zname, "failed to load zone, file '%s' (%s)",
+			      loader->source, zs_strerror(loader->scanner.error.code));
+			goto fail;
+		}
+	} else if (ret != KNOT_EOK) {
 		ERROR(zname, "failed to load zone, file '%s' (%s)",
-		      loader->source, zs_strerror(loader->scanner.error.code));
+		      loader->source, knot_strerror(ret));
 		goto fail;
 	}
 
+	if (zc->ret == KNOT_EOK) {
+		zc->ret = zcreator_finish(zc);
+	}
+
 	if (zc->ret != KNOT_EOK) {
 		ERROR(zname, "failed to load zone, file '%s' (%s)",
 		      loader->source, knot_strerror(zc->ret));
@@ -221,6 +971,15 @@ zone_contents_t *zonefile_load(zloader_t *loader)
 		goto fail;
 	}
 
+	size_t nsec3_uncached = 0;
+	if (loader->nsec3_cache != NULL && zone_contents_load_nsec3param(zc->z) == KNOT_EOK) {
+		ret = kasp_db_load_nsec3_hashes(loader->nsec3_cache, zc->z, &nsec3_uncached);
+		if (ret != KNOT_EOK) {
+			WARNING(zname, "failed to load cached NSEC3 hashes (%s)",
+			        knot_strerror(ret));
+		}
+	}
+
 	ret = zone_adjust_contents(zc->z, adjust_cb_flags_and_nsec3, adjust_cb_nsec3_flags,
 	                           true, true, 1, NULL);
 	if (ret != KNOT_EOK) {
@@ -229,8 +988,16 @@ zone_contents_t *zonefile_load(zloader_t *loader)
 		goto fail;
 	}
 
-	ret = sem_checks_process(zc->z, loader->semantic_checks,
-	                         loader->err_handler, loader->time);
+	if (nsec3_uncached > 0) {
+		ret = kasp_db_store_nsec3_hashes(loader->nsec3_cache, zc->z);
+		if (ret != KNOT_EOK) {
+			WARNING(zname, "failed to cache NSEC3 hashes (%s)",
+			        knot_strerror(ret));
+		}
+	}
+
+	ret = sem_checks_process(zc->z, NULL, loader->semantic_checks,
+	                         loader->err_handler, loader->threads, loader->time);
 
 	if (ret != KNOT_EOK) {
 		ERROR(zname, "failed to load zone, file '%s' (%s)",
@@ -273,7 +1040,8 @@ int zonefile_exists(const char *path, struct timespec *mtime)
 	return KNOT_EOK;
 }
 
-int zonefile_write(const char *path, zone_contents_t *zone)
+int zonefile_write(const char *path, zone_contents_t *zone, bool binary,
+                   unsigned threads)
 {
 	if (path == NULL) {
 		return KNOT_EINVAL;
@@ -297,8 +1065,14 @@ int zonefile_write(const char *path, zone_contents_t *zone)
 		return ret;
 	}
 
-	ret = zone_dump_text(zone, file, true, NULL);
-	fclose(file);
+	if (binary) {
+		ret = write_binary(zone, file);
+	} else {
+		ret = zone_dump_text(zone, file, true, NULL, threads);
+	}
+	if (fclose(file) != 0 && ret == KNOT_EOK) {
+		ret = knot_map_errno();
+	}
 	if (ret != KNOT_EOK) {
 		unlink(tmp_name);
 		free(tmp_name);
@@ -327,6 +1101,7 @@ void zonefile_close(zloader_t *loader)
 
 	zs_deinit(&loader->scanner);
 	free(loader->source);
+	zcreator_clear(loader->creator);
 	free(loader->creator);
 }
 
@@ -30,6 +30,11 @@ typedef struct zcreator {
 	zone_contents_t *z;  /*!< Created zone. */
 	bool master;         /*!< True if server is a primary master for the zone. */
 	int ret;             /*!< Return value. */
+	zone_node_t *last_node; /*!< Node of the previous record (lookup cache). */
+	bool last_nsec3;     /*!< The previous record belongs to the NSEC3 tree. */
+	knot_rrset_t pending; /*!< RRSet collected from consecutive records. */
+	knot_rdataset_builder_t builder; /*!< Rdata of the pending RRSet. */
+	knot_dname_storage_t pending_owner; /*!< Owner of the pending RRSet. */
 } zcreator_t;
 
 /*!
@@ -42,6 +47,9 @@ typedef struct {
 	zcreator_t *creator;         /*!< Loader context. */
 	zs_scanner_t scanner;        /*!< Zone scanner. */
 	time_t time;                 /*!< time for zone check. */
+	unsigned threads;            /*!< Number of zone file parsing threads. */
+	bool binary;                 /*!< Zone file is in the binary format. */
+	knot_lmdb_db_t *nsec3_cache; /*!< Optional DB caching NSEC3 owner hashes. */
 } zloader_t;
 
 void err_handler_logger(sem_handler_t *handler, const zone_contents_t *zone,
@@ -85,8 +93,14 @@ int zonefile_exists(const char *path, struct timespec *mtime);
 
 /*!
  * \brief Write zone contents to zone file.
+ *
+ * \param path     Path to the zone file.
+ * \param zone     Zone contents to be written.
+ * \param binary   Use the compact binary format instead of the text one.
+ * \param threads  Number of threads formatting the records.
  */
-int zonefile_write(const char *path, zone_contents_t *zone);
+int zonefile_write(const char *path, zone_contents_t *zone, bool binary,
+                   unsigned threads);
 
 /*!
  * \brief Close zone file loader.
@@ -98,9 +112,28 @@ void zonefile_close(zloader_t *loader);
 /*!
  * \brief Adds one RR into zone.
  *
+ * Consecutive RRs of the same RRSet are collected and inserted at once,
+ * zcreator_finish() must be called after the last one.
+ *
  * \param zl  Zone loader.
  * \param rr  RR to add.
  *
  * \return KNOT_E*
  */
 int zcreator_step(zcreator_t *zl, const knot_rrset_t *rr);
+
+/*!
+ * \brief Inserts the pending RRSet into zone.
+ *
+ * \param zl  Zone loader.
+ *
+ * \return KNOT_E*
+ */
+int zcreator_finish(zcreator_t *zl);
+
+/*!
+ * \brief Drops the pending RRSet, e.g. upon a failure.
+ *
+ * \param zl  Zone loader.
+ */
+void zcreator_clear(zcreator_t *zl);
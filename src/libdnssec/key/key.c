@@ -142,24 +142,44 @@ dnssec_key_t *dnssec_key_dup(const dnssec_key_t *key)
 	}
 
 	if (key->private_key != NULL) {
-		gnutls_privkey_init(&dup->private_key);
+		int r = gnutls_privkey_init(&dup->private_key);
+		if (r != GNUTLS_E_SUCCESS) {
+			dnssec_key_free(dup);
+			return NULL;
+		}
 
 		gnutls_privkey_type_t type = gnutls_privkey_get_type(key->private_key);
 		if (type == GNUTLS_PRIVKEY_PKCS11) {
 #ifdef ENABLE_PKCS11
+			// Opens a new session to the token, may fail if exhausted.
 			gnutls_pkcs11_privkey_t tmp;
-			gnutls_privkey_export_pkcs11(key->private_key, &tmp);
-			gnutls_privkey_import_pkcs11(dup->private_key, tmp,
-			                             GNUTLS_PRIVKEY_IMPORT_AUTO_RELEASE);
+			r = gnutls_privkey_export_pkcs11(key->private_key, &tmp);
+			if (r == GNUTLS_E_SUCCESS) {
+				r = gnutls_privkey_import_pkcs11(dup->private_key, tmp,
+				                                 GNUTLS_PRIVKEY_IMPORT_AUTO_RELEASE);
+				if (r != GNUTLS_E_SUCCESS) {
+					gnutls_pkcs11_privkey_deinit(tmp);
+				}
+			}
 #else
 			assert(0);
 #endif // ENABLE_PKCS11
 		} else {
 			assert(type == GNUTLS_PRIVKEY_X509);
 			gnutls_x509_privkey_t tmp;
-			gnutls_privkey_export_x509(key->private_key, &tmp);
-			gnutls_privkey_import_x509(dup->private_key, tmp,
-			                           GNUTLS_PRIVKEY_IMPORT_AUTO_RELEASE);
+			r = gnutls_privkey_export_x509(key->private_key, &tmp);
+			if (r == GNUTLS_E_SUCCESS) {
+				r = gnutls_privkey_import_x509(dup->private_key, tmp,
+				                               GNUTLS_PRIVKEY_IMPORT_AUTO_RELEASE);
+				if (r != GNUTLS_E_SUCCESS) {
+					gnutls_x509_privkey_deinit(tmp);
+				}
+			}
+		}
+
+		if (r != GNUTLS_E_SUCCESS) {
+			dnssec_key_free(dup);
+			return NULL;
 		}
 	}
 
@@ -186,6 +186,31 @@ int dnssec_tsig_new(dnssec_tsig_ctx_t **ctx_ptr,
 	return DNSSEC_EOK;
 }
 
+_public_
+int dnssec_tsig_copy(dnssec_tsig_ctx_t **copy, const dnssec_tsig_ctx_t *ctx)
+{
+	if (!copy || !ctx) {
+		return DNSSEC_EINVAL;
+	}
+
+	dnssec_tsig_ctx_t *res = calloc(1, sizeof(*res));
+	if (!res) {
+		return DNSSEC_ENOMEM;
+	}
+
+	res->algorithm = ctx->algorithm;
+	res->hash = gnutls_hmac_copy(ctx->hash);
+	if (!res->hash) {
+		// Not supported by some crypto backends.
+		free(res);
+		return DNSSEC_NOT_IMPLEMENTED_ERROR;
+	}
+
+	*copy = res;
+
+	return DNSSEC_EOK;
+}
+
 _public_
 void dnssec_tsig_free(dnssec_tsig_ctx_t *ctx)
 {
@@ -107,6 +107,18 @@ typedef struct dnssec_tsig_ctx dnssec_tsig_ctx_t;
 int dnssec_tsig_new(dnssec_tsig_ctx_t **ctx, dnssec_tsig_algorithm_t algorithm,
 		    const dnssec_binary_t *key);
 
+/*!
+ * Create a copy of the TSIG signing context, including the data added so far.
+ *
+ * Copying a fresh context avoids the repeated key setup.
+ *
+ * \param[out] copy  Resulting TSIG context.
+ * \param[in]  ctx   TSIG context to be copied.
+ *
+ * \return Error code, DNSSEC_EOK if successful.
+ */
+int dnssec_tsig_copy(dnssec_tsig_ctx_t **copy, const dnssec_tsig_ctx_t *ctx);
+
 /*!
  * Free the TSIG signing context.
  *
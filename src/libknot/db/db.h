@@ -41,7 +41,11 @@ enum {
 	KNOT_DB_NEXT   = 1 << 5, /*!< Next entry. */
 	KNOT_DB_PREV   = 1 << 6, /*!< Previous entry. */
 	KNOT_DB_LEQ    = 1 << 7, /*!< Lesser or equal. */
-	KNOT_DB_GEQ    = 1 << 8  /*!< Greater or equal. */
+	KNOT_DB_GEQ    = 1 << 8, /*!< Greater or equal. */
+
+	/* Insert flags */
+
+	KNOT_DB_APPEND = 1 << 9  /*!< Key is greater than all the stored ones. */
 };
 
 typedef void knot_db_t;
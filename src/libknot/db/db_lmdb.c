@@ -474,6 +474,10 @@ static int insert(knot_db_txn_t *txn, knot_db_val_t *key, knot_db_val_t *val, un
 	if (val->len > 0 && val->data == NULL) {
 		mdb_flags |= MDB_RESERVE;
 	}
+	/* Skip the tree search for sorted bulk loads. */
+	if (flags & KNOT_DB_APPEND) {
+		mdb_flags |= MDB_APPEND;
+	}
 
 	int ret = mdb_put(txn->txn, env->dbi, &db_key, &data, mdb_flags);
 	if (ret != MDB_SUCCESS) {
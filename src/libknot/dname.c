@@ -28,6 +28,89 @@
 #include "contrib/mempattern.h"
 #include "contrib/tolower.h"
 
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+#include <arm_neon.h>
+#endif
+
+/*
+ * Name primitives working on whole names instead of individual labels.
+ * Label length octets (at most 63) never fall into the 'A'-'Z' range, so
+ * they can be lowercased and compared together with the label contents.
+ * SSE2 and NEON are baseline on x86-64 and AArch64, so no runtime CPU
+ * dispatch is needed, and wider vectors don't pay off for names this short.
+ */
+
+#if defined(__SSE2__)
+#define BLOCK_SIZE 16
+
+static inline __m128i lower_block(__m128i x)
+{
+	__m128i upper = _mm_and_si128(_mm_cmpgt_epi8(x, _mm_set1_epi8('A' - 1)),
+	                              _mm_cmplt_epi8(x, _mm_set1_epi8('Z' + 1)));
+	return _mm_or_si128(x, _mm_and_si128(upper, _mm_set1_epi8(0x20)));
+}
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+#define BLOCK_SIZE 16
+
+static inline uint8x16_t lower_block(uint8x16_t x)
+{
+	uint8x16_t upper = vandq_u8(vcgeq_u8(x, vdupq_n_u8('A')),
+	                            vcleq_u8(x, vdupq_n_u8('Z')));
+	return vorrq_u8(x, vandq_u8(upper, vdupq_n_u8(0x20)));
+}
+#endif
+
+/*! \brief Convert len bytes to lowercase; dst may be equal to src. */
+static void mem_lower(uint8_t *dst, const uint8_t *src, size_t len)
+{
+	size_t i = 0;
+#if defined(__SSE2__)
+	for (; i + BLOCK_SIZE <= len; i += BLOCK_SIZE) {
+		__m128i x = _mm_loadu_si128((const __m128i *)(src + i));
+		_mm_storeu_si128((__m128i *)(dst + i), lower_block(x));
+	}
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+	for (; i + BLOCK_SIZE <= len; i += BLOCK_SIZE) {
+		vst1q_u8(dst + i, lower_block(vld1q_u8(src + i)));
+	}
+#endif
+	for (; i < len; i++) {
+		dst[i] = knot_tolower(src[i]);
+	}
+}
+
+/*! \brief Compare len bytes case-insensitively. */
+static bool mem_case_equal(const uint8_t *a, const uint8_t *b, size_t len)
+{
+	size_t i = 0;
+#if defined(__SSE2__)
+	for (; i + BLOCK_SIZE <= len; i += BLOCK_SIZE) {
+		__m128i x = lower_block(_mm_loadu_si128((const __m128i *)(a + i)));
+		__m128i y = lower_block(_mm_loadu_si128((const __m128i *)(b + i)));
+		if (_mm_movemask_epi8(_mm_cmpeq_epi8(x, y)) != 0xFFFF) {
+			return false;
+		}
+	}
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+	for (; i + BLOCK_SIZE <= len; i += BLOCK_SIZE) {
+		uint8x16_t eq = vceqq_u8(lower_block(vld1q_u8(a + i)),
+		                         lower_block(vld1q_u8(b + i)));
+		if (vminvq_u8(eq) != 0xFF) {
+			return false;
+		}
+	}
+#endif
+	for (; i < len; i++) {
+		if (knot_tolower(a[i]) != knot_tolower(b[i])) {
+			return false;
+		}
+	}
+
+	return true;
+}
+
 static bool label_is_equal(const uint8_t *lb1, const uint8_t *lb2, bool no_case)
 {
 	if (*lb1 != *lb2) {
@@ -35,14 +118,7 @@ static bool label_is_equal(const uint8_t *lb1, const uint8_t *lb2, bool no_case)
 	}
 
 	if (no_case) {
-		uint8_t len = *lb1;
-		for (uint8_t i = 1; i <= len; i++) {
-			if (knot_tolower(lb1[i]) != knot_tolower(lb2[i])) {
-				return false;
-			}
-		}
-
-		return true;
+		return mem_case_equal(lb1 + 1, lb2 + 1, *lb1);
 	} else {
 		return memcmp(lb1 + 1, lb2 + 1, *lb1) == 0;
 	}
@@ -478,13 +554,7 @@ void knot_dname_to_lower(knot_dname_t *name)
 		return;
 	}
 
-	while (*name != '\0') {
-		uint8_t len = *name;
-		for (uint8_t i = 1; i <= len; ++i) {
-			name[i] = knot_tolower(name[i]);
-		}
-		name += 1 + len;
-	}
+	mem_lower(name, name, knot_dname_size(name) - 1);
 }
 
 _public_
@@ -494,16 +564,7 @@ void knot_dname_copy_lower(knot_dname_t *dst, const knot_dname_t *name)
 		return;
 	}
 
-	while (*name != '\0') {
-		uint8_t len = *name;
-		*dst = len;
-		for (uint8_t i = 1; i <= len; ++i) {
-			dst[i] = knot_tolower(name[i]);
-		}
-		dst += 1 + len;
-		name += 1 + len;
-	}
-	*dst = '\0';
+	mem_lower(dst, name, knot_dname_size(name));
 }
 
 _public_
@@ -682,16 +743,18 @@ inline static bool dname_is_equal(const knot_dname_t *d1, const knot_dname_t *d2
 		return false;
 	}
 
-	while (*d1 != '\0' || *d2 != '\0') {
-		if (label_is_equal(d1, d2, no_case)) {
-			d1 = knot_dname_next_label(d1);
-			d2 = knot_dname_next_label(d2);
-		} else {
-			return false;
+	/* Check the label structure first, then compare the whole names. */
+	size_t size = 0;
+	while (d1[size] == d2[size]) {
+		if (d1[size] == '\0') {
+			size++;
+			return no_case ? mem_case_equal(d1, d2, size) :
+			                 memcmp(d1, d2, size) == 0;
 		}
+		size += 1 + d1[size];
 	}
 
-	return true;
+	return false;
 }
 
 _public_
@@ -25,6 +25,7 @@
 
 #pragma once
 
+#include <stdbool.h>
 #include <stdint.h>
 
 #include "libknot/packet/wire.h"
@@ -43,6 +44,9 @@ enum knot_compr_offset {
 	KNOT_COMPR_HINT_COUNT = 16  /* Maximum number of stored hints per-RR. */
 };
 
+/*! \brief Number of slots in the per-packet table of written name suffixes. */
+#define KNOT_COMPR_TABLE_SIZE 64
+
 /*
  * \note A little bit about how compression hints work.
  *
@@ -73,6 +77,9 @@ typedef struct knot_compr {
 		uint16_t pos;   /* Position of current suffix. */
 		uint8_t labels; /* Label count of the suffix. */
 	} suffix;
+	bool table_qname;   /* QNAME suffixes are in the table. */
+	bool ordered;       /* Compress against the previous owner only. */
+	uint16_t table[KNOT_COMPR_TABLE_SIZE]; /* Written suffixes by hash. */
 } knot_compr_t;
 
 /*!
@@ -176,6 +176,9 @@ static void compr_clear(knot_compr_t *compr)
 	compr->rrinfo = NULL;
 	compr->suffix.pos = 0;
 	compr->suffix.labels = 0;
+	compr->table_qname = false;
+	compr->ordered = false;
+	memset(compr->table, 0, sizeof(compr->table));
 }
 
 /*! \brief Clear the packet and switch wireformat pointers (possibly allocate new). */
@@ -497,9 +500,8 @@ int knot_pkt_put_question(knot_pkt_t *pkt, const knot_dname_t *qname, uint16_t q
 	return knot_pkt_begin(pkt, KNOT_ANSWER);
 }
 
-_public_
-int knot_pkt_put_rotate(knot_pkt_t *pkt, uint16_t compr_hint, const knot_rrset_t *rr,
-                        uint16_t rotate, uint16_t flags)
+static int pkt_put(knot_pkt_t *pkt, uint16_t compr_hint, const knot_rrset_t *rr,
+                   const uint8_t *prerendered, uint16_t rotate, uint16_t flags)
 {
 	if (pkt == NULL || rr == NULL) {
 		return KNOT_EINVAL;
@@ -536,13 +538,19 @@ int knot_pkt_put_rotate(knot_pkt_t *pkt, uint16_t compr_hint, const knot_rrset_t
 		}
 
 		compr = &pkt->compr;
+		compr->ordered = (flags & KNOT_PF_ORDERED);
 	}
 
 	uint8_t *pos = pkt->wire + pkt->size;
 	size_t maxlen = pkt_remaining(pkt);
 
 	/* Write RRSet to wireformat. */
-	ret = knot_rrset_to_wire_extra(rr, pos, maxlen, rotate, compr, flags);
+	if (prerendered != NULL) {
+		ret = knot_rrset_to_wire_prerendered(rr, prerendered, pos, maxlen,
+		                                     rotate, compr);
+	} else {
+		ret = knot_rrset_to_wire_extra(rr, pos, maxlen, rotate, compr, flags);
+	}
 	if (ret < 0) {
 		/* Truncate packet if required. */
 		if (ret == KNOT_ESPACE && !(flags & KNOT_PF_NOTRUNC)) {
@@ -569,6 +577,44 @@ int knot_pkt_put_rotate(knot_pkt_t *pkt, uint16_t compr_hint, const knot_rrset_t
 	return KNOT_EOK;
 }
 
+_public_
+int knot_pkt_put_rotate(knot_pkt_t *pkt, uint16_t compr_hint, const knot_rrset_t *rr,
+                        uint16_t rotate, uint16_t flags)
+{
+	return pkt_put(pkt, compr_hint, rr, NULL, rotate, flags);
+}
+
+_public_
+int knot_pkt_put_prerendered(knot_pkt_t *pkt, uint16_t compr_hint,
+                             const knot_rrset_t *rr, const uint8_t *prerendered,
+                             uint16_t rotate, uint16_t flags)
+{
+	if (prerendered == NULL) {
+		return KNOT_EINVAL;
+	}
+
+	return pkt_put(pkt, compr_hint, rr, prerendered, rotate, flags);
+}
+
+_public_
+int knot_pkt_put_wire(knot_pkt_t *pkt, const uint8_t *wire, size_t len,
+                      uint16_t rr_count)
+{
+	if (pkt == NULL || (wire == NULL && len > 0)) {
+		return KNOT_EINVAL;
+	}
+
+	if (len > pkt_remaining(pkt)) {
+		return KNOT_ESPACE;
+	}
+
+	memcpy(pkt->wire + pkt->size, wire, len);
+	pkt->size += len;
+	pkt_rr_wirecount_add(pkt, pkt->current, rr_count);
+
+	return KNOT_EOK;
+}
+
 _public_
 int knot_pkt_parse_question(knot_pkt_t *pkt)
 {
@@ -720,16 +766,48 @@ static int parse_section(knot_pkt_t *pkt, unsigned flags)
 	return KNOT_EOK;
 }
 
+/*! \brief Parse the usual query payload, which is just an optional OPT or TSIG. */
+static int parse_payload_simple(knot_pkt_t *pkt, unsigned flags, uint16_t ar_count)
+{
+	/* Empty ANSWER and AUTHORITY sections. */
+	for (knot_section_t i = KNOT_AUTHORITY; i <= KNOT_ADDITIONAL; ++i) {
+		pkt->sections[i].pkt = pkt;
+		pkt->sections[i].pos = pkt->rrset_count;
+	}
+	pkt->current = KNOT_ADDITIONAL;
+
+	if (ar_count > 0) {
+		int ret = parse_rr(pkt, flags);
+		if (ret != KNOT_EOK) {
+			return ret;
+		}
+	}
+
+	/* Check for trailing garbage. */
+	if (pkt->parsed < pkt->size) {
+		return KNOT_ETRAIL;
+	}
+
+	return KNOT_EOK;
+}
+
 static int parse_payload(knot_pkt_t *pkt, unsigned flags)
 {
 	assert(pkt);
 	assert(pkt->wire);
 	assert(pkt->size > 0);
 
+	uint16_t an_count = knot_wire_get_ancount(pkt->wire);
+	uint16_t ns_count = knot_wire_get_nscount(pkt->wire);
+	uint16_t ar_count = knot_wire_get_arcount(pkt->wire);
+
+	/* Skip the general section processing for the prevailing query shape. */
+	if (an_count == 0 && ns_count == 0 && ar_count <= 1) {
+		return parse_payload_simple(pkt, flags, ar_count);
+	}
+
 	/* Reserve memory in advance to avoid resizing. */
-	size_t rr_count = knot_wire_get_ancount(pkt->wire) +
-	                  knot_wire_get_nscount(pkt->wire) +
-	                  knot_wire_get_arcount(pkt->wire);
+	size_t rr_count = an_count + ns_count + ar_count;
 
 	if (rr_count > pkt->size / KNOT_WIRE_RR_MIN_SIZE) {
 		return KNOT_EMALF;
@@ -53,6 +53,7 @@ enum {
 	KNOT_PF_ORIGTTL   = 1 << 6, /*!< Write RRSIGs with their original TTL. */
 	KNOT_PF_SOAMINTTL = 1 << 7, /*!< Write SOA with its minimum-ttl as TTL. */
 	KNOT_PF_NULLBYTE  = 1 << 8, /*!< At lest one \0 byte is present in some qname label. */
+	KNOT_PF_ORDERED   = 1 << 9, /*!< RRSets put in canonical order, cheap compression. */
 };
 
 typedef struct knot_pkt knot_pkt_t;
@@ -267,6 +268,46 @@ int knot_pkt_put_question(knot_pkt_t *pkt, const knot_dname_t *qname,
 int knot_pkt_put_rotate(knot_pkt_t *pkt, uint16_t compr_hint, const knot_rrset_t *rr,
                         uint16_t rotate, uint16_t flags);
 
+/*!
+ * \brief Put RRSet into packet using its pre-rendered wire.
+ *
+ * Same as knot_pkt_put_rotate, but the RRs are copied from the output of
+ * knot_rrset_prerender() instead of being encoded.
+ *
+ * \note Flags affecting the written TTL (KNOT_PF_ORIGTTL, KNOT_PF_SOAMINTTL)
+ *       must be reflected by the pre-rendered wire.
+ *
+ * \param pkt
+ * \param compr_hint   Compression hint, see enum knot_compr_hint or absolute
+ *                     position.
+ * \param rr           Given RRSet.
+ * \param prerendered  Pre-rendered RRSet wire (see knot_rrset_prerender()).
+ * \param rotate       Rotate the RRSet order by this count.
+ * \param flags        RRSet flags.
+ *
+ * \return KNOT_EOK, KNOT_ESPACE, various errors
+ */
+int knot_pkt_put_prerendered(knot_pkt_t *pkt, uint16_t compr_hint,
+                             const knot_rrset_t *rr, const uint8_t *prerendered,
+                             uint16_t rotate, uint16_t flags);
+
+/*!
+ * \brief Append already encoded RRs to the current packet section.
+ *
+ * The RRs aren't accessible as RRSets in the packet and aren't used for name
+ * compression of subsequently put RRSets. Compression pointers in the wire
+ * must be valid within this packet.
+ *
+ * \param pkt
+ * \param wire       Encoded RRs.
+ * \param len        Length of the encoded RRs.
+ * \param rr_count   Number of the encoded RRs.
+ *
+ * \return KNOT_EOK, KNOT_ESPACE, KNOT_EINVAL
+ */
+int knot_pkt_put_wire(knot_pkt_t *pkt, const uint8_t *wire, size_t len,
+                      uint16_t rr_count);
+
 /*! \brief Same as knot_pkt_put_rotate but without rrset rotation. */
 static inline int knot_pkt_put(knot_pkt_t *pkt, uint16_t compr_hint,
                                const knot_rrset_t *rr, uint16_t flags)
@@ -174,29 +174,142 @@ static int write_rdata_naptr_header(const uint8_t **src, size_t *src_avail,
 #define CHECK_WIRE_NEXT_LABEL(res) \
 	if (res == NULL) { return KNOT_EINVAL; }
 
+/*! \brief Hashes of all non-root suffixes of a name. */
+typedef struct {
+	uint8_t count;                            /*!< Number of labels. */
+	uint8_t offs[KNOT_DNAME_MAXLABELS];       /*!< Label offsets in the name. */
+	uint32_t hash[KNOT_DNAME_MAXLABELS];      /*!< Suffix hashes. */
+} suffix_hashes_t;
+
+/*! \brief Hash a label (case-insensitively) together with its parent suffix hash. */
+static uint32_t label_hash(const uint8_t *label, uint32_t parent)
+{
+	uint32_t hash = parent;
+	for (uint8_t i = 0; i <= *label; i++) {
+		hash = (hash ^ knot_tolower(label[i])) * 0x01000193; // FNV-1a
+	}
+	return hash;
+}
+
+/*! \brief Compute hashes of all suffixes of an uncompressed name. */
+static void suffix_hashes(const knot_dname_t *dname, suffix_hashes_t *out)
+{
+	out->count = 0;
+	for (const uint8_t *lp = dname; *lp != '\0'; lp = knot_dname_next_label(lp)) {
+		out->offs[out->count++] = lp - dname;
+	}
+
+	uint32_t hash = 0x811c9dc5;
+	for (int i = out->count - 1; i >= 0; i--) {
+		hash = label_hash(dname + out->offs[i], hash);
+		out->hash[i] = hash;
+	}
+}
+
+static uint16_t *table_slot(knot_compr_t *compr, uint32_t hash)
+{
+	return &compr->table[hash & (KNOT_COMPR_TABLE_SIZE - 1)];
+}
+
 /*!
- * \brief Write compressed domain name to the destination wire.
+ * \brief Check that the name at the wire offset equals the given suffix.
  *
- * \param dname  Name to be written.
- * \param dst    Destination wire.
- * \param max    Maximum number of bytes available.
- * \param compr  Compression context (NULL for no compression)
- * \return Number of written bytes or an error.
+ * Only the wire below limit is considered, as it won't be rewritten.
  */
-static int compr_put_dname(const knot_dname_t *dname, uint8_t *dst, uint16_t max,
-                           knot_compr_t *compr)
+static bool table_match(const knot_dname_t *suffix, const uint8_t *wire,
+                        uint16_t pos, uint16_t limit)
 {
-	assert(dname && dst);
+	while (true) {
+		if (pos >= limit) {
+			return false;
+		}
+		const uint8_t *lp = wire + pos;
+		if (knot_wire_is_pointer(lp)) {
+			uint16_t ptr = knot_wire_get_pointer(lp);
+			if (ptr >= pos || pos + sizeof(uint16_t) > limit) {
+				return false;
+			}
+			pos = ptr;
+			continue;
+		}
+		if (pos + 1 + *lp > limit || !label_is_equal(suffix, lp)) {
+			return false;
+		}
+		if (*suffix == '\0') {
+			return true;
+		}
+		pos += 1 + *lp;
+		suffix = knot_dname_next_label(suffix);
+	}
+}
 
-	// Write uncompressible names directly (zero label dname).
-	if (compr == NULL || *dname == '\0') {
-		return knot_dname_to_wire(dst, dname, max);
+/*! \brief Store positions of the written uncompressed labels of a name. */
+static void table_add(knot_compr_t *compr, const suffix_hashes_t *sh,
+                      size_t wire_pos, uint16_t raw_len)
+{
+	for (uint8_t i = 0; i < sh->count && sh->offs[i] < raw_len; i++) {
+		size_t pos = wire_pos + sh->offs[i];
+		if (pos >= KNOT_WIRE_PTR_MAX) {
+			break;
+		}
+		*table_slot(compr, sh->hash[i]) = pos;
+	}
+}
+
+/*! \brief Store suffixes of the (uncompressed) QNAME. */
+static void table_add_qname(knot_compr_t *compr)
+{
+	compr->table_qname = true;
+
+	const knot_dname_t *qname = compr->wire + KNOT_WIRE_HEADER_SIZE;
+	if (*qname == '\0') {
+		return;
+	}
+
+	suffix_hashes_t sh;
+	suffix_hashes(qname, &sh);
+	table_add(compr, &sh, KNOT_WIRE_HEADER_SIZE, knot_dname_size(qname));
+}
+
+/*!
+ * \brief Write a name compressed against the longest suffix found in the table.
+ *
+ * \return Number of written bytes, 0 if nothing found, or an error.
+ */
+static int compr_put_table(const knot_dname_t *dname, uint8_t *dst, uint16_t max,
+                           knot_compr_t *compr, const suffix_hashes_t *sh,
+                           uint16_t *raw_len)
+{
+	uint16_t limit = dst - compr->wire;
+
+	for (uint8_t i = 0; i < sh->count; i++) {
+		uint16_t pos = *table_slot(compr, sh->hash[i]);
+		if (pos == 0 || !table_match(dname + sh->offs[i], compr->wire, pos, limit)) {
+			continue;
+		}
+
+		uint16_t written = 0;
+		WRITE_LABEL(dst, written, dname, max, sh->offs[i]);
+		if (written + sizeof(uint16_t) > max) {
+			return KNOT_ESPACE;
+		}
+		knot_wire_put_pointer(compr->wire, dst + written, pos);
+		*raw_len = written;
+		return written + sizeof(uint16_t);
 	}
 
-	// Get number of labels (should not be a zero label dname).
-	size_t name_labels = knot_dname_labels(dname, NULL);
-	assert(name_labels > 0);
+	return 0;
+}
 
+/*!
+ * \brief Write a name compressed against the current suffix.
+ *
+ * \return Number of written bytes or an error.
+ */
+static int compr_put_suffix(const knot_dname_t *dname, size_t name_labels,
+                            uint8_t *dst, uint16_t max, knot_compr_t *compr,
+                            uint16_t *raw_len)
+{
 	// Suffix must not be longer than whole name.
 	const knot_dname_t *suffix = compr->wire + compr->suffix.pos;
 	int suffix_labels = compr->suffix.labels;
@@ -207,7 +320,6 @@ static int compr_put_dname(const knot_dname_t *dname, uint8_t *dst, uint16_t max
 	}
 
 	// Suffix is shorter than name, write labels until aligned.
-	uint8_t orig_labels = name_labels;
 	uint16_t written = 0;
 	while (name_labels > suffix_labels) {
 		WRITE_LABEL(dst, written, dname, max, (*dname + 1));
@@ -241,6 +353,7 @@ static int compr_put_dname(const knot_dname_t *dname, uint8_t *dst, uint16_t max
 	}
 
 	// If match begins at the end of the name, write '\0' label.
+	*raw_len = written;
 	if (match_begin == dname) {
 		WRITE_LABEL(dst, written, dname, max, 1);
 	} else {
@@ -252,14 +365,65 @@ static int compr_put_dname(const knot_dname_t *dname, uint8_t *dst, uint16_t max
 		written += sizeof(uint16_t);
 	}
 
+	return written;
+}
+
+/*!
+ * \brief Write compressed domain name to the destination wire.
+ *
+ * The name is compressed against any previously written name found in the
+ * suffix table, or against the current suffix otherwise.
+ *
+ * \param dname  Name to be written.
+ * \param dst    Destination wire.
+ * \param max    Maximum number of bytes available.
+ * \param compr  Compression context (NULL for no compression)
+ * \return Number of written bytes or an error.
+ */
+static int compr_put_dname(const knot_dname_t *dname, uint8_t *dst, uint16_t max,
+                           knot_compr_t *compr)
+{
+	assert(dname && dst);
+
+	// Write uncompressible names directly (zero label dname).
+	if (compr == NULL || *dname == '\0') {
+		return knot_dname_to_wire(dst, dname, max);
+	}
+
+	// Ordered records share suffixes with the previous owner, skip the table.
+	if (compr->ordered) {
+		uint16_t raw_len = 0;
+		return compr_put_suffix(dname, knot_dname_labels(dname, NULL),
+		                        dst, max, compr, &raw_len);
+	}
+
+	if (!compr->table_qname) {
+		table_add_qname(compr);
+	}
+
+	suffix_hashes_t sh;
+	suffix_hashes(dname, &sh);
+	assert(sh.count > 0);
+
+	uint16_t raw_len = 0;
+	int written = compr_put_table(dname, dst, max, compr, &sh, &raw_len);
+	if (written == 0) {
+		written = compr_put_suffix(dname, sh.count, dst, max, compr, &raw_len);
+	}
+	if (written < 0) {
+		return written;
+	}
+
 	assert(dst >= compr->wire);
 	size_t wire_pos = dst - compr->wire;
 	assert(wire_pos < KNOT_WIRE_MAX_PKTSIZE);
 
+	table_add(compr, &sh, wire_pos, raw_len);
+
 	// Heuristics - expect similar names are grouped together.
 	if (written > sizeof(uint16_t) && wire_pos + written < KNOT_WIRE_PTR_MAX) {
 		compr->suffix.pos = wire_pos;
-		compr->suffix.labels = orig_labels;
+		compr->suffix.labels = sh.count;
 	}
 
 	return written;
@@ -303,7 +467,7 @@ static int write_owner(const knot_rrset_t *rrset, uint8_t **dst, size_t *dst_ava
 		              knot_dname_size(rrset->owner));
 		WRITE_OWNER_INCR(dst, dst_avail, sizeof(uint16_t));
 	} else {
-		if (compr != NULL) {
+		if (compr != NULL && !compr->ordered) {
 			compr->suffix.pos = KNOT_WIRE_HEADER_SIZE;
 			compr->suffix.labels =
 				knot_dname_labels(compr->wire + compr->suffix.pos,
@@ -316,6 +480,15 @@ static int write_owner(const knot_rrset_t *rrset, uint8_t **dst, size_t *dst_ava
 			return written;
 		}
 
+		// The next owner in canonical order likely shares the suffix.
+		if (compr != NULL && compr->ordered && written > sizeof(uint16_t)) {
+			size_t wire_pos = *dst - compr->wire;
+			if (wire_pos + written < KNOT_WIRE_PTR_MAX) {
+				compr->suffix.pos = wire_pos;
+				compr->suffix.labels = knot_dname_labels(rrset->owner, NULL);
+			}
+		}
+
 		compr_set_ptr(compr, KNOT_COMPR_HINT_OWNER, *dst, written);
 		WRITE_OWNER_INCR(dst, dst_avail, written);
 	}
@@ -524,6 +697,100 @@ int knot_rrset_to_wire_extra(const knot_rrset_t *rrset, uint8_t *wire,
 	return write - wire;
 }
 
+/*! \brief Check if the RR type may contain a compressible domain name. */
+static bool rdata_compressible(uint16_t type)
+{
+	const knot_rdata_descriptor_t *desc = knot_get_rdata_descriptor(type);
+	for (const int *block = desc->block_types; *block != KNOT_RDATA_WF_END; block++) {
+		if (*block == KNOT_RDATA_WF_COMPRESSIBLE_DNAME) {
+			return true;
+		}
+	}
+
+	return false;
+}
+
+_public_
+int knot_rrset_prerender(const knot_rrset_t *rrset, uint8_t *wire, uint32_t max_size)
+{
+	if (rrset == NULL || wire == NULL) {
+		return KNOT_EINVAL;
+	}
+	if (rdata_compressible(rrset->type)) {
+		return KNOT_ENOTSUP;
+	}
+
+	uint8_t *write = wire;
+	size_t capacity = max_size;
+
+	knot_rdata_t *rdata = rrset->rrs.rdata;
+	for (uint16_t i = 0; i < rrset->rrs.count; i++) {
+		int ret = write_fixed_header(rrset, rdata, &write, &capacity, 0);
+		if (ret == KNOT_EOK) {
+			ret = write_rdata(rrset, i, rdata, &write, &capacity, NULL);
+		}
+		if (ret != KNOT_EOK) {
+			return ret;
+		}
+		rdata = knot_rdataset_next(rdata);
+	}
+
+	return write - wire;
+}
+
+_public_
+int knot_rrset_to_wire_prerendered(const knot_rrset_t *rrset, const uint8_t *prerendered,
+                                   uint8_t *wire, uint32_t max_size, uint16_t rotate,
+                                   knot_compr_t *compr)
+{
+	if (rrset == NULL || prerendered == NULL || wire == NULL) {
+		return KNOT_EINVAL;
+	}
+	if (rrset->rrs.count == 0) {
+		return 0;
+	}
+	if (rotate != 0) {
+		rotate %= rrset->rrs.count;
+	}
+
+	uint8_t *write = wire;
+	size_t capacity = max_size;
+
+	// Skip the rotated RRs, the RDATA is stored as is.
+	uint16_t count = rrset->rrs.count;
+	const uint8_t *src = prerendered;
+	knot_rdata_t *rdata = rrset->rrs.rdata;
+	for (uint16_t i = 0; i < rotate; i++) {
+		src += KNOT_RR_HEADER_SIZE + rdata->len;
+		rdata = knot_rdataset_next(rdata);
+	}
+
+	for (int i = rotate; i < count + rotate; i++) {
+		if (i == count) {
+			src = prerendered;
+			rdata = rrset->rrs.rdata;
+		}
+
+		int ret = write_owner(rrset, &write, &capacity, compr);
+		if (ret != KNOT_EOK) {
+			return ret;
+		}
+
+		size_t len = KNOT_RR_HEADER_SIZE + rdata->len;
+		if (len > capacity) {
+			return KNOT_ESPACE;
+		}
+		memcpy(write, src, len);
+		write += len;
+		capacity -= len;
+
+		src += len;
+		rdata = knot_rdataset_next(rdata);
+	}
+
+	return write - wire;
+}
+
 static int parse_header(const uint8_t *wire, size_t *pos, size_t pkt_size,
                         knot_mm_t *mm, knot_rrset_t *rrset, uint16_t *rdlen)
 {
@@ -51,6 +51,45 @@ static inline int knot_rrset_to_wire(const knot_rrset_t *rrset, uint8_t *wire,
 	return knot_rrset_to_wire_extra(rrset, wire, max_size, 0, compr, 0);
 }
 
+/*! \brief Size of the RR fields following the owner (TYPE, CLASS, TTL, RDLENGTH). */
+#define KNOT_RR_HEADER_SIZE 10
+
+/*!
+ * \brief Pre-render RR Set content without owners to a wire.
+ *
+ * Each RR is written as TYPE, CLASS, TTL, RDLENGTH, and RDATA in the
+ * rdataset order. The result can be used repeatedly with
+ * knot_rrset_to_wire_prerendered() as long as the RRSet doesn't change.
+ *
+ * \note RDATA compression hints aren't set when writing pre-rendered RRs.
+ *
+ * \param rrset     RRSet to be pre-rendered.
+ * \param wire      Output buffer.
+ * \param max_size  Capacity of the output buffer.
+ *
+ * \return Output size, KNOT_ENOTSUP if the RDATA is compressible, or
+ *         other negative number on error (KNOT_E*).
+ */
+int knot_rrset_prerender(const knot_rrset_t *rrset, uint8_t *wire, uint32_t max_size);
+
+/*!
+ * \brief Write RR Set content to a wire using its pre-rendered form.
+ *
+ * Only owners are written (and compressed), the rest is copied.
+ *
+ * \param rrset        RRSet to be converted.
+ * \param prerendered  Output of knot_rrset_prerender() for this RRSet.
+ * \param wire         Output wire buffer.
+ * \param max_size     Capacity of wire buffer.
+ * \param rotate       Rotate the RR order by this count.
+ * \param compr        Compression context.
+ *
+ * \return Output size, negative number on error (KNOT_E*).
+ */
+int knot_rrset_to_wire_prerendered(const knot_rrset_t *rrset, const uint8_t *prerendered,
+                                   uint8_t *wire, uint32_t max_size, uint16_t rotate,
+                                   knot_compr_t *compr);
+
 /*!
 * \brief Creates one RR from wire, stores it into \a rrset.
 *
@@ -19,22 +19,59 @@
 #include <stdbool.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
 #include <sys/types.h>
 #include <sys/socket.h>
 #include <sys/stat.h>
 #include <sys/un.h>
 #include <unistd.h>
+#ifdef __linux__
+ #include <linux/futex.h>
+ #include <sys/syscall.h>
+#endif
 
 #include "libknot/attribute.h"
 #include "libknot/errcode.h"
 #include "libknot/probe/probe.h"
 #include "contrib/time.h"
 
+#if defined(HAVE_C11_ATOMIC) || defined(HAVE_GCC_ATOMIC)
+ #define ENABLE_PROBE_SHM
+#endif
+
+#define SHM_MAGIC	0x4b505231 // "KPR1"
+
+/*!
+ * Shared memory ring header, followed by the slots.
+ *
+ * The ring is a bounded multi-producer queue with per-slot sequence numbers.
+ * A slot at position 'pos' is free for writing if its sequence equals 'pos',
+ * and ready for reading if its sequence equals 'pos + 1'.
+ */
+typedef struct {
+	uint32_t magic;     // Set by the consumer once initialized.
+	uint32_t capacity;  // Number of slots (power of 2).
+	uint32_t slot_size; // Size of one slot.
+	uint32_t closed;    // Set by the consumer when finished.
+	_Alignas(64) uint64_t head;    // Next position to be claimed by a producer.
+	_Alignas(64) uint32_t waiting; // Non-zero if the consumer is sleeping.
+} shm_hdr_t;
+
+typedef struct {
+	uint64_t seq;
+	knot_probe_data_t data;
+} shm_slot_t;
+
 struct knot_probe {
 	struct sockaddr_un path;
 	uint32_t last_unconn_time;
 	bool consumer;
 	int fd;
+	bool shm_mode;    // Shared memory transport is used.
+	shm_hdr_t *shm;   // Mapped ring or NULL.
+	size_t shm_size;
+	uint64_t shm_tail; // Next position to be read by the consumer.
 };
 
 _public_
@@ -57,6 +94,14 @@ void knot_probe_free(knot_probe_t *probe)
 		return;
 	}
 
+#ifdef ENABLE_PROBE_SHM
+	if (probe->shm != NULL) {
+		if (probe->consumer) {
+			__atomic_store_n(&probe->shm->closed, 1, __ATOMIC_RELEASE);
+		}
+		(void)munmap(probe->shm, probe->shm_size);
+	}
+#endif
 	close(probe->fd);
 	if (probe->consumer) {
 		(void)unlink(probe->path.sun_path);
@@ -70,7 +115,8 @@ static int probe_connect(knot_probe_t *probe)
 	               sizeof(probe->path));
 }
 
-static int probe_init(knot_probe_t *probe, const char *dir, uint16_t idx)
+static int probe_path(knot_probe_t *probe, const char *dir, uint16_t idx,
+                      const char *suffix)
 {
 	if (probe == NULL || dir == NULL || idx == 0) {
 		return KNOT_EINVAL;
@@ -78,11 +124,21 @@ static int probe_init(knot_probe_t *probe, const char *dir, uint16_t idx)
 
 	probe->path.sun_family = AF_UNIX;
 	int ret = snprintf(probe->path.sun_path, sizeof(probe->path.sun_path),
-	                   "%s/probe%02u.sock", dir, idx);
+	                   "%s/probe%02u.%s", dir, idx, suffix);
 	if (ret < 0 || ret >= sizeof(probe->path.sun_path)) {
 		return KNOT_ERANGE;
 	}
 
+	return KNOT_EOK;
+}
+
+static int probe_init(knot_probe_t *probe, const char *dir, uint16_t idx)
+{
+	int ret = probe_path(probe, dir, idx, "sock");
+	if (ret != KNOT_EOK) {
+		return ret;
+	}
+
 	probe->fd = socket(AF_UNIX, SOCK_DGRAM, 0);
 	if (probe->fd < 0) {
 		return knot_map_errno();
@@ -139,6 +195,133 @@ int knot_probe_set_consumer(knot_probe_t *probe, const char *dir, uint16_t idx)
 	return KNOT_EOK;
 }
 
+#ifdef ENABLE_PROBE_SHM
+static shm_slot_t *shm_slots(shm_hdr_t *hdr)
+{
+	return (shm_slot_t *)(hdr + 1);
+}
+
+static int shm_attach(knot_probe_t *probe)
+{
+	int fd = open(probe->path.sun_path, O_RDWR | O_CLOEXEC);
+	if (fd < 0) {
+		return KNOT_ECONN;
+	}
+
+	struct stat st;
+	if (fstat(fd, &st) != 0 || st.st_size < sizeof(shm_hdr_t)) {
+		close(fd);
+		return KNOT_ECONN;
+	}
+
+	shm_hdr_t *hdr = mmap(NULL, st.st_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+	close(fd);
+	if (hdr == MAP_FAILED) {
+		return knot_map_errno();
+	}
+
+	if (__atomic_load_n(&hdr->magic, __ATOMIC_ACQUIRE) != SHM_MAGIC ||
+	    hdr->slot_size != sizeof(shm_slot_t) ||
+	    st.st_size != sizeof(*hdr) + (size_t)hdr->capacity * sizeof(shm_slot_t) ||
+	    __atomic_load_n(&hdr->closed, __ATOMIC_RELAXED) != 0) {
+		(void)munmap(hdr, st.st_size);
+		return KNOT_ECONN;
+	}
+
+	probe->shm = hdr;
+	probe->shm_size = st.st_size;
+
+	return KNOT_EOK;
+}
+
+static void shm_detach(knot_probe_t *probe)
+{
+	if (probe->shm != NULL) {
+		(void)munmap(probe->shm, probe->shm_size);
+		probe->shm = NULL;
+	}
+}
+#endif
+
+_public_
+int knot_probe_set_producer_shm(knot_probe_t *probe, const char *dir, uint16_t idx)
+{
+#ifdef ENABLE_PROBE_SHM
+	int ret = probe_path(probe, dir, idx, "shm");
+	if (ret != KNOT_EOK) {
+		return ret;
+	}
+
+	probe->shm_mode = true;
+	shm_detach(probe);
+
+	return shm_attach(probe);
+#else
+	return KNOT_ENOTSUP;
+#endif
+}
+
+_public_
+int knot_probe_set_consumer_shm(knot_probe_t *probe, const char *dir, uint16_t idx,
+                                uint32_t capacity)
+{
+#ifdef ENABLE_PROBE_SHM
+	if (capacity < 2 || (capacity & (capacity - 1)) != 0) {
+		return KNOT_EINVAL;
+	}
+
+	int ret = probe_path(probe, dir, idx, "shm");
+	if (ret != KNOT_EOK) {
+		return ret;
+	}
+
+	probe->shm_mode = true;
+	probe->consumer = true;
+
+	(void)unlink(probe->path.sun_path);
+
+	probe->fd = open(probe->path.sun_path, O_RDWR | O_CREAT | O_EXCL | O_CLOEXEC,
+	                 S_IRUSR | S_IWUSR);
+	if (probe->fd < 0) {
+		return knot_map_errno();
+	}
+
+	size_t size = sizeof(shm_hdr_t) + (size_t)capacity * sizeof(shm_slot_t);
+	if (ftruncate(probe->fd, size) != 0 ||
+	    fchmod(probe->fd, S_IRUSR | S_IWUSR | S_IRGRP | S_IWGRP |
+	                      S_IROTH | S_IWOTH) != 0) {
+		ret = knot_map_errno();
+		close(probe->fd);
+		probe->fd = -1;
+		return ret;
+	}
+
+	shm_hdr_t *hdr = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, probe->fd, 0);
+	if (hdr == MAP_FAILED) {
+		ret = knot_map_errno();
+		close(probe->fd);
+		probe->fd = -1;
+		return ret;
+	}
+
+	hdr->capacity = capacity;
+	hdr->slot_size = sizeof(shm_slot_t);
+	shm_slot_t *slots = shm_slots(hdr);
+	for (uint32_t i = 0; i < capacity; i++) {
+		slots[i].seq = i;
+	}
+	__atomic_store_n(&hdr->magic, SHM_MAGIC, __ATOMIC_RELEASE);
+
+	probe->shm = hdr;
+	probe->shm_size = size;
+	probe->shm_tail = 0;
+
+	return KNOT_EOK;
+#else
+	return KNOT_ENOTSUP;
+#endif
+}
+
 _public_
 int knot_probe_fd(knot_probe_t *probe)
 {
@@ -149,6 +332,120 @@ int knot_probe_fd(knot_probe_t *probe)
 	return probe->fd;
 }
 
+#ifdef ENABLE_PROBE_SHM
+static void shm_wake(shm_hdr_t *hdr)
+{
+	__atomic_thread_fence(__ATOMIC_SEQ_CST);
+	if (__atomic_load_n(&hdr->waiting, __ATOMIC_RELAXED) != 0 &&
+	    __atomic_exchange_n(&hdr->waiting, 0, __ATOMIC_SEQ_CST) != 0) {
+#ifdef __linux__
+		(void)syscall(SYS_futex, &hdr->waiting, FUTEX_WAKE, 1, NULL, NULL, 0);
+#endif
+	}
+}
+
+static void shm_wait(shm_hdr_t *hdr, int timeout_ms)
+{
+#ifdef __linux__
+	struct timespec ts = {
+		.tv_sec = timeout_ms / 1000,
+		.tv_nsec = (timeout_ms % 1000) * 1000000
+	};
+	(void)syscall(SYS_futex, &hdr->waiting, FUTEX_WAIT, 1,
+	              (timeout_ms < 0) ? NULL : &ts, NULL, 0);
+#else
+	// Without a doorbell, the consumer checks the ring periodically.
+	(void)poll(NULL, 0, (timeout_ms < 0 || timeout_ms > 10) ? 10 : timeout_ms);
+#endif
+}
+
+static int shm_produce(knot_probe_t *probe, const knot_probe_data_t *data,
+                       size_t used_len)
+{
+	shm_hdr_t *hdr = probe->shm;
+	if (hdr == NULL || __atomic_load_n(&hdr->closed, __ATOMIC_ACQUIRE) != 0) {
+		// Try to attach to a new consumer ring if not tried recently.
+		struct timespec now = time_now();
+		if (now.tv_sec - probe->last_unconn_time <= 2) {
+			return KNOT_ECONN;
+		}
+		probe->last_unconn_time = now.tv_sec;
+		shm_detach(probe);
+		int ret = shm_attach(probe);
+		if (ret != KNOT_EOK) {
+			return ret;
+		}
+		hdr = probe->shm;
+	}
+
+	shm_slot_t *slots = shm_slots(hdr);
+	uint64_t mask = hdr->capacity - 1;
+	uint64_t pos = __atomic_load_n(&hdr->head, __ATOMIC_RELAXED);
+	while (true) {
+		shm_slot_t *slot = &slots[pos & mask];
+		uint64_t seq = __atomic_load_n(&slot->seq, __ATOMIC_ACQUIRE);
+		int64_t diff = (int64_t)(seq - pos);
+		if (diff == 0) {
+			if (__atomic_compare_exchange_n(&hdr->head, &pos, pos + 1, true,
+			                                __ATOMIC_RELAXED, __ATOMIC_RELAXED)) {
+				memcpy(&slot->data, data, used_len);
+				__atomic_store_n(&slot->seq, pos + 1, __ATOMIC_RELEASE);
+				break;
+			}
+		} else if (diff < 0) {
+			return KNOT_ESPACE; // The consumer doesn't keep up.
+		} else {
+			pos = __atomic_load_n(&hdr->head, __ATOMIC_RELAXED);
+		}
+	}
+
+	shm_wake(hdr);
+
+	return KNOT_EOK;
+}
+
+static int shm_pop(knot_probe_t *probe, knot_probe_data_t *data, uint8_t count)
+{
+	shm_hdr_t *hdr = probe->shm;
+	shm_slot_t *slots = shm_slots(hdr);
+	uint64_t mask = hdr->capacity - 1;
+
+	int i = 0;
+	for (; i < count; i++) {
+		uint64_t pos = probe->shm_tail;
+		shm_slot_t *slot = &slots[pos & mask];
+		if (__atomic_load_n(&slot->seq, __ATOMIC_ACQUIRE) != pos + 1) {
+			break;
+		}
+		memcpy(&data[i], &slot->data, sizeof(*data));
+		__atomic_store_n(&slot->seq, pos + hdr->capacity, __ATOMIC_RELEASE);
+		probe->shm_tail = pos + 1;
+	}
+
+	return i;
+}
+
+static int shm_consume(knot_probe_t *probe, knot_probe_data_t *data, uint8_t count,
+                       int timeout_ms)
+{
+	int ret = shm_pop(probe, data, count);
+	if (ret > 0 || timeout_ms == 0) {
+		return ret;
+	}
+
+	shm_hdr_t *hdr = probe->shm;
+	__atomic_store_n(&hdr->waiting, 1, __ATOMIC_SEQ_CST);
+	ret = shm_pop(probe, data, count); // Recheck after announcing the sleep.
+	if (ret == 0) {
+		shm_wait(hdr, timeout_ms);
+		ret = shm_pop(probe, data, count);
+	}
+	__atomic_store_n(&hdr->waiting, 0, __ATOMIC_RELAXED);
+
+	return ret;
+}
+#endif
+
 _public_
 int knot_probe_produce(knot_probe_t *probe, const knot_probe_data_t *data, uint8_t count)
 {
@@ -157,6 +454,11 @@ int knot_probe_produce(knot_probe_t *probe, const knot_probe_data_t *data, uint8
 	}
 
 	size_t used_len = sizeof(*data) - KNOT_DNAME_MAXLEN + data->query.qname_len;
+#ifdef ENABLE_PROBE_SHM
+	if (probe->shm_mode) {
+		return shm_produce(probe, data, used_len);
+	}
+#endif
 	if (send(probe->fd, data, used_len, 0) == -1) {
 		struct timespec now = time_now();
 		if (now.tv_sec - probe->last_unconn_time > 2) {
@@ -181,6 +483,15 @@ int knot_probe_consume(knot_probe_t *probe, knot_probe_data_t *data, uint8_t cou
 		return KNOT_EINVAL;
 	}
 
+#ifdef ENABLE_PROBE_SHM
+	if (probe->shm_mode) {
+		if (probe->shm == NULL) {
+			return KNOT_EINVAL;
+		}
+		return shm_consume(probe, data, count, timeout_ms);
+	}
+#endif
+
 #ifdef ENABLE_RECVMMSG
 	struct mmsghdr msgs[count];
 	struct iovec iovecs[count];
@@ -72,9 +72,47 @@ int knot_probe_set_producer(knot_probe_t *probe, const char *dir, uint16_t idx);
  */
 int knot_probe_set_consumer(knot_probe_t *probe, const char *dir, uint16_t idx);
 
+/*!
+ * \brief Initializes one probe producer using a shared memory ring.
+ *
+ * \param probe  Probe context.
+ * \param dir    Shared memory file directory.
+ * \param idx    Probe ID (counted from 1).
+ *
+ * \retval KNOT_EOK      Success.
+ * \retval KNOT_ECONN    The consumer ring doesn't exist yet.
+ * \retval KNOT_ENOTSUP  Not supported on this platform.
+ * \return KNOT_E*       If error.
+ */
+int knot_probe_set_producer_shm(knot_probe_t *probe, const char *dir, uint16_t idx);
+
+/*!
+ * \brief Initializes one probe consumer using a shared memory ring.
+ *
+ * The ring is a file in the given directory, mapped by the consumer and all
+ * the producers. Data units are passed without any system calls, the consumer
+ * is woken up by a futex (Linux only) if waiting for data. If the ring is full,
+ * the producer drops the data unit.
+ *
+ * \note The file permissions are set to 0666!
+ *
+ * \param probe     Probe context.
+ * \param dir       Shared memory file directory.
+ * \param idx       Probe ID (counted from 1).
+ * \param capacity  Number of data units in the ring (power of 2).
+ *
+ * \retval KNOT_EOK      Success.
+ * \retval KNOT_ENOTSUP  Not supported on this platform.
+ * \return KNOT_E*       If error.
+ */
+int knot_probe_set_consumer_shm(knot_probe_t *probe, const char *dir, uint16_t idx,
+                                uint32_t capacity);
+
 /*!
  * \brief Returns file descriptor of the probe.
  *
+ * \note The shared memory consumer descriptor isn't pollable.
+ *
  * \param probe  Probe context.
  */
 int knot_probe_fd(knot_probe_t *probe);
@@ -86,7 +124,7 @@ int knot_probe_fd(knot_probe_t *probe);
  *
  * If send fails due to unconnected socket anf if not connected for at least
  * 2 seconds, reconnection is attempted and if successful, the send operation
- * is repeated.
+ * is repeated. Similarly, a closed shared memory ring is reattached.
  *
  * \param probe  Probe context.
  * \param data   Array of data units.
@@ -144,7 +144,7 @@ static int tls_init_conn_session(knot_quic_conn_t *conn, bool server)
 {
 	int ret = knot_tls_session(&conn->tls_session, conn->quic_table->creds,
 	                           conn->quic_table->priority, "\x03""doq",
-	                           true, server);
+	                           true, true, server);
 	if (ret != KNOT_EOK) {
 		return TLS_CALLBACK_ERR;
 	}
@@ -215,6 +215,23 @@ uint32_t knot_quic_conn_rtt(knot_quic_conn_t *conn)
 	return info.smoothed_rtt / 1000; // nanosec --> usec
 }
 
+_public_
+uint64_t knot_quic_conn_pacing_rate(knot_quic_conn_t *conn)
+{
+	if (!(conn->flags & KNOT_QUIC_CONN_HANDSHAKE_DONE)) {
+		return 0;
+	}
+
+	ngtcp2_conn_info info = { 0 };
+	ngtcp2_conn_get_conn_info(conn->conn, &info);
+	if (info.smoothed_rtt == 0) {
+		return 0;
+	}
+
+	// RFC 9002, Section 7.7: rate = N * cwnd / smoothed_rtt, with N = 1.25.
+	return (uint64_t)info.cwnd * 5 * NGTCP2_SECONDS / (4 * info.smoothed_rtt);
+}
+
 _public_
 uint16_t knot_quic_conn_local_port(knot_quic_conn_t *conn)
 {
@@ -247,6 +264,9 @@ static bool init_unique_cid(ngtcp2_cid *cid, size_t len, knot_quic_table_t *tabl
 		if (init_random_cid(cid, len), cid->datalen == 0) {
 			return false;
 		}
+		if (table->flags & KNOT_QUIC_TABLE_CID_WORKER) {
+			cid->data[0] = table->cid_worker;
+		}
 	} while (quic_table_lookup(cid, table) != NULL);
 	return true;
 }
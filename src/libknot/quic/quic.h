@@ -107,6 +107,13 @@ int knot_quic_hanle_expiry(knot_quic_conn_t *conn);
  */
 uint32_t knot_quic_conn_rtt(knot_quic_conn_t *conn);
 
+/*!
+ * \brief Returns the pacing rate of the connection in bytes per second.
+ *
+ * \note Zero is returned if not known (e.g. during the handshake).
+ */
+uint64_t knot_quic_conn_pacing_rate(knot_quic_conn_t *conn);
+
 /*!
  * \brief Returns the port from local-address of given conn IN BIG ENDIAN.
  */
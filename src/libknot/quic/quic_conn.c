@@ -22,6 +22,7 @@
 
 #include "libknot/quic/quic_conn.h"
 
+#include "contrib/bufpool.h"
 #include "contrib/macros.h"
 #include "contrib/openbsd/siphash.h"
 #include "contrib/ucw/heap.h"
@@ -269,7 +270,7 @@ void knot_quic_conn_stream_free(knot_quic_conn_t *conn, int64_t stream_id)
 {
 	knot_quic_stream_t *s = knot_quic_conn_get_stream(conn, stream_id, false);
 	if (s != NULL && s->inbuf.iov_len > 0) {
-		free(s->inbuf.iov_base);
+		bufpool_free(s->inbuf.iov_base, buffer_alloc_size(s->inbuf.iov_len));
 		conn->ibufs_size -= buffer_alloc_size(s->inbuf.iov_len);
 		conn->quic_table->ibufs_size -= buffer_alloc_size(s->inbuf.iov_len);
 		memset(&s->inbuf, 0, sizeof(s->inbuf));
@@ -473,7 +474,7 @@ uint8_t *knot_quic_stream_add_data(knot_quic_conn_t *conn, int64_t stream_id,
 
 	size_t prefix = sizeof(uint16_t);
 
-	knot_quic_obuf_t *obuf = malloc(sizeof(*obuf) + prefix + len);
+	knot_quic_obuf_t *obuf = bufpool_alloc(sizeof(*obuf) + prefix + len);
 	if (obuf == NULL) {
 		return NULL;
 	}
@@ -514,7 +515,7 @@ void knot_quic_stream_ack_data(knot_quic_conn_t *conn, int64_t stream_id,
 		conn->obufs_size -= first->len;
 		ATOMIC_SUB(conn->quic_table->obufs_size, first->len);
 		s->first_offset += first->len;
-		free(first);
+		bufpool_free(first, sizeof(*first) + first->len);
 		if (s->unsent_obuf == first) {
 			s->unsent_obuf = EMPTY_LIST(*obs) ? NULL : HEAD(*obs);
 			s->unsent_offset = 0;
@@ -109,6 +109,7 @@ typedef struct knot_quic_cid {
 
 typedef enum {
 	KNOT_QUIC_TABLE_CLIENT_ONLY = (1 << 0),
+	KNOT_QUIC_TABLE_CID_WORKER  = (1 << 1), // local CIDs start with cid_worker
 } knot_quic_table_flag_t;
 
 typedef struct knot_quic_table {
@@ -125,6 +126,7 @@ typedef struct knot_quic_table {
 	void (*log_cb)(const char *);
 	const char *qlog_dir;
 	uint64_t hash_secret[4];
+	uint8_t cid_worker; // worker index for steering packets to the table owner
 	struct knot_creds *creds;
 	struct gnutls_priority_st *priority;
 	struct heap *expiry_heap;
@@ -16,15 +16,23 @@
 
 #include <arpa/inet.h>
 #include <assert.h>
+#include <errno.h>
 #include <gnutls/crypto.h>
 #include <gnutls/gnutls.h>
+#include <poll.h>
 #include <stdlib.h>
+#include <string.h>
 #include <sys/types.h>
 #include <sys/socket.h>
+#ifdef __linux__
+#include <linux/tls.h>
+#include <netinet/tcp.h>
+#endif
 
 #include "libknot/quic/tls.h"
 
 #include "contrib/macros.h"
+#include "contrib/string.h"
 #include "contrib/time.h"
 #include "contrib/ucw/lists.h"
 #include "libknot/attribute.h"
@@ -39,6 +47,13 @@ typedef struct knot_tls_session {
 	// quic_params to be zero and QUIC non-zero.
 } knot_tls_session_t;
 
+#if defined(TLS_1_3_VERSION) && defined(TCP_ULP)
+#define ENABLE_KTLS
+#ifndef SOL_TLS
+#define SOL_TLS 282
+#endif
+#endif
+
 _public_
 knot_tls_ctx_t *knot_tls_ctx_new(struct knot_creds *creds, unsigned io_timeout,
                                  unsigned hs_timeout, bool server)
@@ -83,7 +98,7 @@ knot_tls_conn_t *knot_tls_conn_new(knot_tls_ctx_t *ctx, int sock_fd)
 	res->fd = sock_fd;
 
 	int ret = knot_tls_session(&res->session, ctx->creds, ctx->priority,
-	                           "\x03""dot", true, ctx->server);
+	                           "\x03""dot", true, false, ctx->server);
 	if (ret != KNOT_EOK) {
 		goto fail;
 	}
@@ -102,7 +117,10 @@ _public_
 void knot_tls_conn_del(knot_tls_conn_t *conn)
 {
 	if (conn != NULL && conn->fd_clones_count-- < 1) {
-		(void)gnutls_bye(conn->session, GNUTLS_SHUT_WR);
+		// The GnuTLS record state is stale once the kernel took it over.
+		if (!(conn->flags & KNOT_TLS_CONN_KTLS_TX)) {
+			(void)gnutls_bye(conn->session, GNUTLS_SHUT_WR);
+		}
 		gnutls_deinit(conn->session);
 		free(conn);
 	}
@@ -158,6 +176,88 @@ int knot_tls_session_load(knot_tls_conn_t *conn, struct knot_tls_session *sessio
 	return ret;
 }
 
+#ifdef ENABLE_KTLS
+static bool ktls_set(knot_tls_conn_t *conn, bool rx)
+{
+	gnutls_datum_t iv, key;
+	unsigned char seq[8];
+	int ret = gnutls_record_get_state(conn->session, rx, NULL, &iv, &key, seq);
+	if (ret != GNUTLS_E_SUCCESS) {
+		return false;
+	}
+
+	bool tls13 = (gnutls_protocol_get_version(conn->session) == GNUTLS_TLS1_3);
+	union {
+		struct tls_crypto_info info;
+		struct tls12_crypto_info_aes_gcm_128 gcm128;
+		struct tls12_crypto_info_aes_gcm_256 gcm256;
+		struct tls12_crypto_info_chacha20_poly1305 chacha;
+	} crypto = { 0 };
+	size_t crypto_len;
+
+#define KTLS_GCM(cinfo, type) \
+	if (key.size != sizeof(cinfo.key) || \
+	    iv.size < sizeof(cinfo.salt) + (tls13 ? sizeof(cinfo.iv) : 0)) { \
+		return false; \
+	} \
+	cinfo.info.cipher_type = type; \
+	memcpy(cinfo.key, key.data, sizeof(cinfo.key)); \
+	memcpy(cinfo.salt, iv.data, sizeof(cinfo.salt)); \
+	memcpy(cinfo.iv, tls13 ? iv.data + sizeof(cinfo.salt) : seq, sizeof(cinfo.iv)); \
+	memcpy(cinfo.rec_seq, seq, sizeof(cinfo.rec_seq)); \
+	crypto_len = sizeof(cinfo);
+
+	switch (gnutls_cipher_get(conn->session)) {
+	case GNUTLS_CIPHER_AES_128_GCM:
+		KTLS_GCM(crypto.gcm128, TLS_CIPHER_AES_GCM_128)
+		break;
+	case GNUTLS_CIPHER_AES_256_GCM:
+		KTLS_GCM(crypto.gcm256, TLS_CIPHER_AES_GCM_256)
+		break;
+	case GNUTLS_CIPHER_CHACHA20_POLY1305:
+		if (key.size != sizeof(crypto.chacha.key) ||
+		    iv.size != sizeof(crypto.chacha.iv)) {
+			return false;
+		}
+		crypto.chacha.info.cipher_type = TLS_CIPHER_CHACHA20_POLY1305;
+		memcpy(crypto.chacha.key, key.data, sizeof(crypto.chacha.key));
+		memcpy(crypto.chacha.iv, iv.data, sizeof(crypto.chacha.iv));
+		memcpy(crypto.chacha.rec_seq, seq, sizeof(crypto.chacha.rec_seq));
+		crypto_len = sizeof(crypto.chacha);
+		break;
+	default:
+		return false;
+	}
+#undef KTLS_GCM
+	crypto.info.version = tls13 ? TLS_1_3_VERSION : TLS_1_2_VERSION;
+
+	ret = setsockopt(conn->fd, SOL_TLS, rx ? TLS_RX : TLS_TX, &crypto, crypto_len);
+	memzero(&crypto, sizeof(crypto));
+
+	return ret == 0;
+}
+
+static void ktls_enable(knot_tls_conn_t *conn)
+{
+	gnutls_protocol_t version = gnutls_protocol_get_version(conn->session);
+	if (version != GNUTLS_TLS1_2 && version != GNUTLS_TLS1_3) {
+		return;
+	}
+
+	// Fails if the kernel tls module isn't available, keep user space TLS then.
+	if (setsockopt(conn->fd, SOL_TCP, TCP_ULP, "tls", sizeof("tls")) != 0 ||
+	    !ktls_set(conn, false)) {
+		return;
+	}
+	conn->flags |= KNOT_TLS_CONN_KTLS_TX;
+
+	// Already decrypted data would be lost, receive via GnuTLS in such a case.
+	if (gnutls_record_check_pending(conn->session) == 0 && ktls_set(conn, true)) {
+		conn->flags |= KNOT_TLS_CONN_KTLS_RX;
+	}
+}
+#endif
+
 _public_
 int knot_tls_handshake(knot_tls_conn_t *conn, bool oneshot)
 {
@@ -181,7 +281,17 @@ int knot_tls_handshake(knot_tls_conn_t *conn, bool oneshot)
 	switch (ret) {
 	case GNUTLS_E_SUCCESS:
 		conn->flags |= KNOT_TLS_CONN_HANDSHAKE_DONE;
-		return knot_tls_pin_check(conn->session, conn->ctx->creds);
+		if (conn->ctx->server &&
+		    (gnutls_session_get_flags(conn->session) & GNUTLS_SFLAGS_EARLY_DATA)) {
+			conn->flags |= KNOT_TLS_CONN_EARLY_DATA;
+		}
+		ret = knot_tls_pin_check(conn->session, conn->ctx->creds);
+#ifdef ENABLE_KTLS
+		if (ret == KNOT_EOK && conn->ctx->ktls) {
+			ktls_enable(conn);
+		}
+#endif
+		return ret;
 	case GNUTLS_E_TIMEDOUT:
 		return KNOT_NET_ETIMEOUT;
 	default:
@@ -206,11 +316,107 @@ int knot_tls_handshake(knot_tls_conn_t *conn, bool oneshot)
 		*timeout_ptr = MAX(*timeout_ptr - running_ms, 0); \
 	}
 
+static int poll_one(int fd, short events, int timeout)
+{
+	struct pollfd pfd = { .fd = fd, .events = events };
+	int ret = poll(&pfd, 1, timeout > 0 ? timeout : -1);
+	if (ret == -1 && errno == EINTR) {
+		return 1; // Retry the I/O.
+	}
+	return ret;
+}
+
+static ssize_t ktls_recv(knot_tls_conn_t *conn, void *data, size_t size, int *timeout_ptr)
+{
+	size_t total = 0;
+	while (total < size) {
+		TIMEOUT_CTX_INIT
+		ssize_t res = recv(conn->fd, data + total, size - total, 0);
+		if (res > 0) {
+			total += res;
+			continue;
+		} else if (res == 0) {
+			return KNOT_ECONNRESET;
+		} else if (errno == EAGAIN || errno == EWOULDBLOCK) {
+			if (poll_one(conn->fd, POLLIN, *timeout_ptr) <= 0) {
+				return KNOT_NET_ERECV;
+			}
+		} else if (errno != EINTR) {
+			// Including EIO on a non-data (e.g. KeyUpdate) record.
+			return KNOT_NET_ERECV;
+		}
+		TIMEOUT_CTX_UPDATE
+	}
+
+	return size;
+}
+
+static ssize_t ktls_send(knot_tls_conn_t *conn, struct iovec *iov, int iovcnt)
+{
+	int timeout = conn->ctx->io_timeout, *timeout_ptr = &timeout;
+
+	struct msghdr msg = { .msg_iov = iov, .msg_iovlen = iovcnt };
+	while (msg.msg_iovlen > 0) {
+		TIMEOUT_CTX_INIT
+		ssize_t res = sendmsg(conn->fd, &msg, MSG_NOSIGNAL);
+		if (res >= 0) {
+			while (msg.msg_iovlen > 0 && res >= msg.msg_iov->iov_len) {
+				res -= msg.msg_iov->iov_len;
+				msg.msg_iov++;
+				msg.msg_iovlen--;
+			}
+			if (msg.msg_iovlen > 0) {
+				msg.msg_iov->iov_base += res;
+				msg.msg_iov->iov_len -= res;
+			}
+			continue;
+		} else if (errno == EAGAIN || errno == EWOULDBLOCK) {
+			int ret = poll_one(conn->fd, POLLOUT, *timeout_ptr);
+			if (ret == 0) {
+				return KNOT_ETIMEOUT;
+			} else if (ret < 0) {
+				return KNOT_NET_ESEND;
+			}
+		} else if (errno != EINTR) {
+			return KNOT_NET_ESEND;
+		}
+		TIMEOUT_CTX_UPDATE
+	}
+
+	return KNOT_EOK;
+}
+
+static size_t recv_early_data(knot_tls_conn_t *conn, void *data, size_t size)
+{
+	size_t total = 0;
+	while ((conn->flags & KNOT_TLS_CONN_EARLY_DATA) && total < size) {
+		ssize_t res = gnutls_record_recv_early_data(conn->session, data + total,
+		                                            size - total);
+		if (res > 0) {
+			total += res;
+		} else {
+			conn->flags &= ~KNOT_TLS_CONN_EARLY_DATA;
+		}
+	}
+
+	return total;
+}
+
 static ssize_t recv_data(knot_tls_conn_t *conn, void *data, size_t size, int *timeout_ptr)
 {
+	// Accepted early data precede the regular records.
+	size_t total = recv_early_data(conn, data, size);
+	if (total == size) {
+		return size;
+	}
+
+	if (conn->flags & KNOT_TLS_CONN_KTLS_RX) {
+		ssize_t res = ktls_recv(conn, data + total, size - total, timeout_ptr);
+		return (res < 0) ? res : size;
+	}
+
 	gnutls_record_set_timeout(conn->session, *timeout_ptr);
 
-	size_t total = 0;
 	ssize_t res;
 	while (total < size) {
 		TIMEOUT_CTX_INIT
@@ -267,6 +473,42 @@ ssize_t knot_tls_recv_dns(knot_tls_conn_t *conn, void *data, size_t size)
 	return msg_len;
 }
 
+_public_
+bool knot_tls_recv_pending(knot_tls_conn_t *conn)
+{
+	if (conn == NULL || !(conn->flags & KNOT_TLS_CONN_HANDSHAKE_DONE)) {
+		return false;
+	}
+
+	if (conn->flags & KNOT_TLS_CONN_EARLY_DATA) {
+		return true;
+	} else if (conn->flags & KNOT_TLS_CONN_KTLS_RX) {
+		return false;
+	}
+
+	return gnutls_record_check_pending(conn->session) > 0;
+}
+
+static ssize_t send_corked(knot_tls_conn_t *conn)
+{
+	int timeout = conn->ctx->io_timeout, *timeout_ptr = &timeout;
+	gnutls_record_set_timeout(conn->session, timeout);
+
+	// Send the buffered data.
+	while (gnutls_record_check_corked(conn->session) > 0) {
+		TIMEOUT_CTX_INIT
+		int ret = gnutls_record_uncork(conn->session, 0);
+		if (ret < 0 && gnutls_error_is_fatal(ret) != 0) {
+			return ret == GNUTLS_E_TIMEDOUT ? KNOT_ETIMEOUT :
+			                                  KNOT_NET_ESEND;
+		}
+		TIMEOUT_CTX_UPDATE
+		gnutls_record_set_timeout(conn->session, timeout);
+	}
+
+	return KNOT_EOK;
+}
+
 _public_
 ssize_t knot_tls_send_dns(knot_tls_conn_t *conn, void *data, size_t size)
 {
@@ -279,10 +521,20 @@ ssize_t knot_tls_send_dns(knot_tls_conn_t *conn, void *data, size_t size)
 		return res;
 	}
 
+	uint16_t msg_len = htons(size);
+
+	if (conn->flags & KNOT_TLS_CONN_KTLS_TX) {
+		struct iovec iov[2] = {
+			{ .iov_base = &msg_len, .iov_len = sizeof(msg_len) },
+			{ .iov_base = data, .iov_len = size }
+		};
+		res = ktls_send(conn, iov, 2);
+		return res == KNOT_EOK ? size : res;
+	}
+
 	// Enable data buffering.
 	gnutls_record_cork(conn->session);
 
-	uint16_t msg_len = htons(size);
 	res = gnutls_record_send(conn->session, &msg_len, sizeof(msg_len));
 	if (res != sizeof(msg_len)) {
 		return KNOT_NET_ESEND;
@@ -293,19 +545,43 @@ ssize_t knot_tls_send_dns(knot_tls_conn_t *conn, void *data, size_t size)
 		return KNOT_NET_ESEND;
 	}
 
-	int timeout = conn->ctx->io_timeout, *timeout_ptr = &timeout;
-	gnutls_record_set_timeout(conn->session, timeout);
+	res = send_corked(conn);
+	if (res != KNOT_EOK) {
+		return res;
+	}
 
-	// Send the buffered data.
-	while (gnutls_record_check_corked(conn->session) > 0) {
-		TIMEOUT_CTX_INIT
-		int ret = gnutls_record_uncork(conn->session, 0);
-		if (ret < 0 && gnutls_error_is_fatal(ret) != 0) {
-			return ret == GNUTLS_E_TIMEDOUT ? KNOT_ETIMEOUT :
-			                                  KNOT_NET_ESEND;
-		}
-		TIMEOUT_CTX_UPDATE
-		gnutls_record_set_timeout(conn->session, timeout);
+	return size;
+}
+
+_public_
+ssize_t knot_tls_send(knot_tls_conn_t *conn, void *data, size_t size)
+{
+	if (conn == NULL || data == NULL) {
+		return KNOT_EINVAL;
+	}
+
+	ssize_t res = knot_tls_handshake(conn, false);
+	if (res != KNOT_EOK) {
+		return res;
+	}
+
+	if (conn->flags & KNOT_TLS_CONN_KTLS_TX) {
+		struct iovec iov = { .iov_base = data, .iov_len = size };
+		res = ktls_send(conn, &iov, 1);
+		return res == KNOT_EOK ? size : res;
+	}
+
+	// Enable data buffering.
+	gnutls_record_cork(conn->session);
+
+	res = gnutls_record_send(conn->session, data, size);
+	if (res != size) {
+		return KNOT_NET_ESEND;
+	}
+
+	res = send_corked(conn);
+	if (res != KNOT_EOK) {
+		return res;
 	}
 
 	return size;
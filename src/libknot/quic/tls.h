@@ -36,6 +36,9 @@ typedef enum {
 	KNOT_TLS_CONN_SESSION_TAKEN  = (1 << 1), // unused, to be implemeted later
 	KNOT_TLS_CONN_BLOCKED        = (1 << 2),
 	KNOT_TLS_CONN_AUTHORIZED     = (1 << 3),
+	KNOT_TLS_CONN_KTLS_TX        = (1 << 4), // records sent via kernel TLS
+	KNOT_TLS_CONN_KTLS_RX        = (1 << 5), // records received via kernel TLS
+	KNOT_TLS_CONN_EARLY_DATA     = (1 << 6), // accepted early data not received yet
 } knot_tls_conn_flag_t;
 
 typedef struct knot_tls_ctx {
@@ -44,6 +47,7 @@ typedef struct knot_tls_ctx {
 	unsigned handshake_timeout;
 	unsigned io_timeout;
 	bool server;
+	bool ktls; // hand over the record layer to kernel TLS after the handshake
 } knot_tls_ctx_t;
 
 typedef struct knot_tls_conn {
@@ -118,6 +122,9 @@ int knot_tls_session_load(knot_tls_conn_t *conn, struct knot_tls_session *sessio
  *
  * \note This is also done by the recv/send functions.
  *
+ * \note If enabled in the context and supported, the record encryption is
+ *       handed over to the kernel (kTLS) once the handshake is finished.
+ *
  * \param conn     DoT connection.
  * \param oneshot  If set, don't wait untill the handshake is finished.
  *
@@ -141,6 +148,17 @@ int knot_tls_handshake(knot_tls_conn_t *conn, bool oneshot);
  */
 ssize_t knot_tls_recv_dns(knot_tls_conn_t *conn, void *data, size_t size);
 
+/*!
+ * \brief Check if some already received data is pending for reading.
+ *
+ * \note Data which hasn't been read from the socket yet isn't considered.
+ *
+ * \param conn       DoT connection.
+ *
+ * \return True if there is some decrypted data in the session buffer.
+ */
+bool knot_tls_recv_pending(knot_tls_conn_t *conn);
+
 /*!
  * \brief Send a size-word-prefixed DNS message.
  *
@@ -152,6 +170,17 @@ ssize_t knot_tls_recv_dns(knot_tls_conn_t *conn, void *data, size_t size);
  */
 ssize_t knot_tls_send_dns(knot_tls_conn_t *conn, void *data, size_t size);
 
+/*!
+ * \brief Send raw data, e.g. a batch of already size-word-prefixed DNS messages.
+ *
+ * \param conn      DoT connection.
+ * \param data      Data to be sent.
+ * \param size      Data size.
+ *
+ * \return Either exactly 'size' or a negative error code.
+ */
+ssize_t knot_tls_send(knot_tls_conn_t *conn, void *data, size_t size);
+
 /*!
  * \brief Set or unset the conection's BLOCKED flag.
  */
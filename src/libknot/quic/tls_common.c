@@ -14,10 +14,12 @@
     along with this program.  If not, see <https://www.gnu.org/licenses/>.
  */
 
+#include <errno.h>
 #include <fcntl.h>
 #include <gnutls/crypto.h>
 #include <gnutls/gnutls.h>
 #include <gnutls/x509.h>
+#include <pthread.h>
 #include <stdlib.h>
 #include <string.h>
 #include <sys/stat.h>
@@ -32,10 +34,30 @@
 #include "libknot/attribute.h"
 #include "libknot/error.h"
 
+#define ANTI_REPLAY_BUCKETS	4096
+#define ANTI_REPLAY_WAYS	4
+#define ANTI_REPLAY_DIGEST	16
+
+/*!
+ * Bounded set of recently seen 0-RTT ClientHellos. If a bucket is full of
+ * unexpired entries, early data is rejected and the client falls back
+ * to the regular handshake.
+ */
+typedef struct {
+	time_t expire;
+	uint8_t digest[ANTI_REPLAY_DIGEST];
+} anti_replay_entry_t;
+
+typedef struct {
+	pthread_mutex_t lock;
+	anti_replay_entry_t entries[ANTI_REPLAY_BUCKETS][ANTI_REPLAY_WAYS];
+} tls_anti_replay_db_t;
+
 typedef struct knot_creds {
 	knot_atomic_ptr_t cert_creds; // Current credentials.
 	gnutls_certificate_credentials_t cert_creds_prev; // Previous credentials (for pending connections).
 	gnutls_anti_replay_t tls_anti_replay;
+	tls_anti_replay_db_t *tls_anti_replay_db;
 	gnutls_datum_t tls_ticket_key;
 	bool peer;
 	uint8_t peer_pin_len;
@@ -46,7 +68,44 @@ static int tls_anti_replay_db_add_func(void *dbf, time_t exp_time,
                                        const gnutls_datum_t *key,
                                        const gnutls_datum_t *data)
 {
-	return 0;
+	tls_anti_replay_db_t *db = dbf;
+	if (db == NULL) {
+		return GNUTLS_E_DB_ERROR;
+	}
+
+	uint8_t hash[32];
+	if (gnutls_hash_fast(GNUTLS_DIG_SHA256, key->data, key->size, hash) != 0) {
+		return GNUTLS_E_DB_ERROR;
+	}
+	uint32_t idx;
+	memcpy(&idx, hash + ANTI_REPLAY_DIGEST, sizeof(idx));
+	idx %= ANTI_REPLAY_BUCKETS;
+
+	time_t now = time(NULL);
+	int ret = GNUTLS_E_DB_ERROR; // Bucket full, reject the early data.
+
+	pthread_mutex_lock(&db->lock);
+	anti_replay_entry_t *free_entry = NULL;
+	for (unsigned i = 0; i < ANTI_REPLAY_WAYS; i++) {
+		anti_replay_entry_t *entry = &db->entries[idx][i];
+		if (entry->expire < now) {
+			if (free_entry == NULL) {
+				free_entry = entry;
+			}
+		} else if (memcmp(entry->digest, hash, ANTI_REPLAY_DIGEST) == 0) {
+			ret = GNUTLS_E_DB_ENTRY_EXISTS;
+			free_entry = NULL;
+			break;
+		}
+	}
+	if (free_entry != NULL) {
+		free_entry->expire = exp_time;
+		memcpy(free_entry->digest, hash, ANTI_REPLAY_DIGEST);
+		ret = 0;
+	}
+	pthread_mutex_unlock(&db->lock);
+
+	return ret;
 }
 
 static void tls_session_ticket_key_free(gnutls_datum_t *ticket)
@@ -170,8 +229,13 @@ struct knot_creds *knot_creds_init(const char *key_file, const char *cert_file,
 	if (ret != GNUTLS_E_SUCCESS) {
 		goto fail;
 	}
+	creds->tls_anti_replay_db = calloc(1, sizeof(*creds->tls_anti_replay_db));
+	if (creds->tls_anti_replay_db == NULL) {
+		goto fail;
+	}
+	pthread_mutex_init(&creds->tls_anti_replay_db->lock, NULL);
 	gnutls_anti_replay_set_add_function(creds->tls_anti_replay, tls_anti_replay_db_add_func);
-	gnutls_anti_replay_set_ptr(creds->tls_anti_replay, NULL);
+	gnutls_anti_replay_set_ptr(creds->tls_anti_replay, creds->tls_anti_replay_db);
 
 	ret = gnutls_session_ticket_key_generate(&creds->tls_ticket_key);
 	if (ret != GNUTLS_E_SUCCESS) {
@@ -328,6 +392,62 @@ int knot_creds_update(struct knot_creds *creds, const char *key_file, const char
 	return KNOT_EOK;
 }
 
+_public_
+int knot_creds_ticket_key(struct knot_creds *creds, const char *key_file,
+                          int uid, int gid)
+{
+	if (creds == NULL || key_file == NULL || creds->peer) {
+		return KNOT_EINVAL;
+	}
+
+	gnutls_datum_t key = { 0 };
+	int ret = KNOT_EOK;
+
+	int fd = open(key_file, O_RDONLY);
+	if (fd != -1) {
+		struct stat stat;
+		if (fstat(fd, &stat) != 0) {
+			ret = KNOT_EFILE;
+			goto finish;
+		} else if (stat.st_size != creds->tls_ticket_key.size) {
+			ret = KNOT_EMALF;
+			goto finish;
+		}
+
+		key.size = stat.st_size;
+		key.data = gnutls_malloc(key.size);
+		if (key.data == NULL) {
+			ret = KNOT_ENOMEM;
+			goto finish;
+		} else if (read(fd, key.data, key.size) != key.size) {
+			ret = KNOT_EFILE;
+			goto finish;
+		}
+	} else if (errno == ENOENT) {
+		const gnutls_datum_t *curr = &creds->tls_ticket_key;
+		if ((fd = open(key_file, O_WRONLY | O_CREAT | O_EXCL, 0600)) == -1 ||
+		    fchown(fd, uid, gid) < 0 ||
+		    write(fd, curr->data, curr->size) != curr->size) {
+			ret = KNOT_EFILE;
+		}
+		goto finish;
+	} else {
+		return KNOT_EFILE;
+	}
+
+	tls_session_ticket_key_free(&creds->tls_ticket_key);
+	creds->tls_ticket_key = key;
+	key.data = NULL;
+finish:
+	if (fd > -1) {
+		close(fd);
+	}
+	if (key.data != NULL) {
+		tls_session_ticket_key_free(&key);
+	}
+	return ret;
+}
+
 _public_
 int knot_creds_cert(struct knot_creds *creds, struct gnutls_x509_crt_int **cert)
 {
@@ -353,6 +473,10 @@ void knot_creds_free(struct knot_creds *creds)
 		}
 	}
 	gnutls_anti_replay_deinit(creds->tls_anti_replay);
+	if (creds->tls_anti_replay_db != NULL) {
+		pthread_mutex_destroy(&creds->tls_anti_replay_db->lock);
+		free(creds->tls_anti_replay_db);
+	}
 	if (creds->tls_ticket_key.data != NULL) {
 		tls_session_ticket_key_free(&creds->tls_ticket_key);
 	}
@@ -365,6 +489,7 @@ int knot_tls_session(struct gnutls_session_int **session,
                      struct gnutls_priority_st *priority,
                      const char *alpn,
                      bool early_data,
+                     bool quic,
                      bool server)
 {
 	if (session == NULL || creds == NULL || priority == NULL || alpn == NULL) {
@@ -374,10 +499,16 @@ int knot_tls_session(struct gnutls_session_int **session,
 	gnutls_init_flags_t flags = GNUTLS_NO_SIGNAL;
 	if (early_data) {
 		flags |= GNUTLS_ENABLE_EARLY_DATA;
+	}
 #ifdef ENABLE_QUIC // Next flags aren't available in older GnuTLS versions.
-		flags |= GNUTLS_NO_AUTO_SEND_TICKET | GNUTLS_NO_END_OF_EARLY_DATA;
-#endif
+	if (quic) {
+		// The session ticket is sent upon the QUIC handshake completion.
+		flags |= GNUTLS_NO_AUTO_SEND_TICKET;
+		if (early_data) {
+			flags |= GNUTLS_NO_END_OF_EARLY_DATA;
+		}
 	}
+#endif
 
 	int ret = gnutls_init(session, (server ? GNUTLS_SERVER : GNUTLS_CLIENT) | flags);
 	if (ret == GNUTLS_E_SUCCESS) {
@@ -80,6 +80,26 @@ struct knot_creds *knot_creds_init_peer(const struct knot_creds *local_creds,
 int knot_creds_update(struct knot_creds *creds, const char *key_file, const char *cert_file,
                       int uid, int gid);
 
+/*!
+ * \brief Load the session ticket master key of server credentials from a file.
+ *
+ * If the file doesn't exist, it's created with the current (random) key.
+ * The file can be shared among more servers so that they accept each others
+ * tickets. The ticket encryption keys are derived from the master key and
+ * rotated by GnuTLS in time.
+ *
+ * \note Must be called before any session is initialized with the credentials.
+ *
+ * \param creds         Server credentials.
+ * \param key_file      Ticket key file path/name.
+ * \param uid           Generated key file owner id.
+ * \param gid           Generated key file group id.
+ *
+ * \return KNOT_E*
+ */
+int knot_creds_ticket_key(struct knot_creds *creds, const char *key_file,
+                          int uid, int gid);
+
 /*!
  * \brief Gets the certificate from credentials.
  *
@@ -103,6 +123,7 @@ void knot_creds_free(struct knot_creds *creds);
  * \param priority     Session priority configuration.
  * \param alpn         ALPN string, first byte is the string length.
  * \param early_data   Allow early data.
+ * \param quic         Session used for QUIC (otherwise TLS over TCP).
  * \param server       Should be server session (otherwise client).
  *
  * \return KNOT_E*
@@ -112,6 +133,7 @@ int knot_tls_session(struct gnutls_session_int **session,
                      struct gnutls_priority_st *priority,
                      const char *alpn,
                      bool early_data,
+                     bool quic,
                      bool server);
 
 /*!
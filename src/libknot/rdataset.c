@@ -20,6 +20,7 @@
 
 #include "libknot/attribute.h"
 #include "libknot/rdataset.h"
+#include "contrib/macros.h"
 #include "contrib/mempattern.h"
 
 static knot_rdata_t *rr_seek(const knot_rdataset_t *rrs, uint16_t pos)
@@ -123,6 +124,47 @@ static int remove_rr_at(knot_rdataset_t *rrs, uint16_t pos, knot_mm_t *mm)
 	return KNOT_EOK;
 }
 
+/*! \brief Linear subtraction of a sorted set, the remaining RRs are compacted in place. */
+static int subtract_sorted(knot_rdataset_t *from, const knot_rdataset_t *what,
+                           knot_mm_t *mm)
+{
+	uint8_t *dst = (uint8_t *)from->rdata;
+	knot_rdata_t *rr = from->rdata, *rm = what->rdata;
+	uint16_t rm_pos = 0, count = 0;
+	for (uint16_t i = 0; i < from->count; ++i) {
+		knot_rdata_t *next = knot_rdataset_next(rr);
+		int cmp = 1;
+		while (rm_pos < what->count && (cmp = knot_rdata_cmp(rm, rr)) < 0) {
+			rm = knot_rdataset_next(rm);
+			rm_pos++;
+		}
+		if (rm_pos == what->count || cmp != 0) {
+			size_t rr_size = knot_rdata_size(rr->len);
+			memmove(dst, rr, rr_size);
+			dst += rr_size;
+			count++;
+		}
+		rr = next;
+	}
+
+	if (count == from->count) {
+		return KNOT_EOK;
+	} else if (count == 0) {
+		knot_rdataset_clear(from, mm);
+		return KNOT_EOK;
+	}
+
+	uint32_t size = dst - (uint8_t *)from->rdata;
+	knot_rdata_t *tmp = mm_realloc(mm, from->rdata, size, from->size);
+	if (tmp != NULL) { // Otherwise keep the larger array.
+		from->rdata = tmp;
+	}
+	from->count = count;
+	from->size = size;
+
+	return KNOT_EOK;
+}
+
 _public_
 void knot_rdataset_clear(knot_rdataset_t *rrs, knot_mm_t *mm)
 {
@@ -272,15 +314,57 @@ int knot_rdataset_merge(knot_rdataset_t *rrs1, const knot_rdataset_t *rrs2,
 		return KNOT_EINVAL;
 	}
 
-	knot_rdata_t *rr2 = rrs2->rdata;
-	for (uint16_t i = 0; i < rrs2->count; ++i) {
-		int ret = knot_rdataset_add(rrs1, rr2, mm);
-		if (ret != KNOT_EOK) {
-			return ret;
+	if (rrs2->count == 0 || rrs1->rdata == rrs2->rdata) {
+		return KNOT_EOK;
+	} else if (rrs1->count == 0) {
+		return knot_rdataset_copy(rrs1, rrs2, mm);
+	} else if (rrs2->count == 1) {
+		return knot_rdataset_add(rrs1, rrs2->rdata, mm);
+	}
+
+	// Both sets are sorted, merge them linearly into a new array.
+	size_t max_size = (size_t)rrs1->size + rrs2->size;
+	uint8_t *out = mm_alloc(mm, max_size);
+	if (out == NULL) {
+		return KNOT_ENOMEM;
+	}
+
+	knot_rdata_t *rr1 = rrs1->rdata, *rr2 = rrs2->rdata;
+	uint16_t i1 = 0, i2 = 0;
+	size_t size = 0, count = 0;
+	while (i1 < rrs1->count || i2 < rrs2->count) {
+		knot_rdata_t *pick;
+		int cmp = (i1 == rrs1->count) ?  1 :
+		          (i2 == rrs2->count) ? -1 : knot_rdata_cmp(rr1, rr2);
+		if (cmp <= 0) {
+			pick = rr1;
+			rr1 = knot_rdataset_next(rr1);
+			i1++;
+			if (cmp == 0) { // Duplicate.
+				rr2 = knot_rdataset_next(rr2);
+				i2++;
+			}
+		} else {
+			pick = rr2;
+			rr2 = knot_rdataset_next(rr2);
+			i2++;
 		}
-		rr2 = knot_rdataset_next(rr2);
+		size_t pick_size = knot_rdata_size(pick->len);
+		memcpy(out + size, pick, pick_size);
+		size += pick_size;
+		count++;
+	}
+
+	if (count > UINT16_MAX || size > UINT32_MAX) {
+		mm_free(mm, out);
+		return KNOT_ESPACE;
 	}
 
+	mm_free(mm, rrs1->rdata);
+	rrs1->rdata = (knot_rdata_t *)out;
+	rrs1->count = count;
+	rrs1->size = size;
+
 	return KNOT_EOK;
 }
 
@@ -355,6 +439,10 @@ int knot_rdataset_subtract(knot_rdataset_t *from, const knot_rdataset_t *what,
 		return KNOT_EOK;
 	}
 
+	if (what->count > 1) {
+		return subtract_sorted(from, what, mm);
+	}
+
 	knot_rdata_t *to_remove = what->rdata;
 	for (uint16_t i = 0; i < what->count; ++i) {
 		int pos_to_remove = find_rr_pos(from, to_remove);
@@ -369,3 +457,141 @@ int knot_rdataset_subtract(knot_rdataset_t *from, const knot_rdataset_t *what,
 
 	return KNOT_EOK;
 }
+
+_public_
+void knot_rdataset_builder_init(knot_rdataset_builder_t *builder, knot_mm_t *mm)
+{
+	if (builder != NULL) {
+		knot_rdataset_init(&builder->rrs);
+		builder->max_size = 0;
+		builder->unsorted = false;
+		builder->last = 0;
+		builder->mm = mm;
+	}
+}
+
+_public_
+int knot_rdataset_builder_add(knot_rdataset_builder_t *builder, const uint8_t *data,
+                              uint16_t len)
+{
+	if (builder == NULL || (data == NULL && len > 0)) {
+		return KNOT_EINVAL;
+	}
+
+	knot_rdataset_t *rrs = &builder->rrs;
+	if (rrs->count == UINT16_MAX) {
+		return KNOT_ESPACE;
+	} else if (rrs->size > UINT32_MAX - knot_rdata_size(UINT16_MAX)) {
+		return KNOT_ESPACE;
+	}
+
+	const size_t rr_size = knot_rdata_size(len);
+	if (rrs->size + rr_size > builder->max_size) {
+		size_t new_max = MAX(2 * (size_t)builder->max_size, rrs->size + rr_size);
+		new_max = MIN(new_max, UINT32_MAX);
+		knot_rdata_t *tmp = mm_realloc(builder->mm, rrs->rdata, new_max, rrs->size);
+		if (tmp == NULL) {
+			return KNOT_ENOMEM;
+		}
+		rrs->rdata = tmp;
+		builder->max_size = new_max;
+	}
+
+	uint8_t *raw = (uint8_t *)rrs->rdata;
+	knot_rdata_t *rr = (knot_rdata_t *)(raw + rrs->size);
+	knot_rdata_init(rr, len, data);
+	if (!builder->unsorted && rrs->count > 0 &&
+	    knot_rdata_cmp((knot_rdata_t *)(raw + builder->last), rr) >= 0) {
+		builder->unsorted = true;
+	}
+	builder->last = rrs->size;
+	rrs->count++;
+	rrs->size += rr_size;
+
+	return KNOT_EOK;
+}
+
+static int rdata_ptr_cmp(const void *a, const void *b)
+{
+	return knot_rdata_cmp(*(const knot_rdata_t **)a, *(const knot_rdata_t **)b);
+}
+
+_public_
+int knot_rdataset_builder_finish(knot_rdataset_builder_t *builder, knot_rdataset_t *rrs)
+{
+	if (builder == NULL || rrs == NULL) {
+		return KNOT_EINVAL;
+	}
+
+	knot_rdataset_t *built = &builder->rrs;
+	if (built->count == 0) {
+		knot_rdataset_init(rrs);
+		knot_rdataset_builder_clear(builder);
+		return KNOT_EOK;
+	}
+
+	if (!builder->unsorted) {
+		// Just trim the spare space.
+		knot_rdata_t *tmp = mm_realloc(builder->mm, built->rdata, built->size,
+		                               built->size);
+		if (tmp != NULL) {
+			built->rdata = tmp;
+		}
+		*rrs = *built;
+		knot_rdataset_builder_init(builder, builder->mm);
+		return KNOT_EOK;
+	}
+
+	knot_rdata_t **sorted = malloc(built->count * sizeof(*sorted));
+	if (sorted == NULL) {
+		return KNOT_ENOMEM;
+	}
+	knot_rdata_t *rr = built->rdata;
+	for (uint16_t i = 0; i < built->count; i++) {
+		sorted[i] = rr;
+		rr = knot_rdataset_next(rr);
+	}
+	qsort(sorted, built->count, sizeof(*sorted), rdata_ptr_cmp);
+
+	// Count the size without duplicates for one exact allocation.
+	uint16_t count = 0;
+	size_t size = 0;
+	for (uint16_t i = 0; i < built->count; i++) {
+		if (i == 0 || knot_rdata_cmp(sorted[i - 1], sorted[i]) != 0) {
+			size += knot_rdata_size(sorted[i]->len);
+			count++;
+		}
+	}
+
+	uint8_t *out = mm_alloc(builder->mm, size);
+	if (out == NULL) {
+		free(sorted);
+		return KNOT_ENOMEM;
+	}
+
+	uint8_t *pos = out;
+	for (uint16_t i = 0; i < built->count; i++) {
+		if (i == 0 || knot_rdata_cmp(sorted[i - 1], sorted[i]) != 0) {
+			size_t rr_size = knot_rdata_size(sorted[i]->len);
+			memcpy(pos, sorted[i], rr_size);
+			pos += rr_size;
+		}
+	}
+	free(sorted);
+
+	knot_rdataset_builder_clear(builder);
+	rrs->count = count;
+	rrs->size = size;
+	rrs->rdata = (knot_rdata_t *)out;
+
+	return KNOT_EOK;
+}
+
+_public_
+void knot_rdataset_builder_clear(knot_rdataset_builder_t *builder)
+{
+	if (builder != NULL) {
+		knot_rdataset_clear(&builder->rrs, builder->mm);
+		knot_rdataset_builder_init(builder, builder->mm);
+	}
+}
@@ -215,4 +215,59 @@ inline static int knot_rdataset_remove(knot_rdataset_t *rrs, const knot_rdata_t
 	return knot_rdataset_subtract(rrs, &rrs_rm, mm);
 }
 
+/*!< \brief Builder of a rdataset from many, possibly unsorted RRs. */
+typedef struct {
+	knot_rdataset_t rrs;  /*!< \brief RRs in order of addition. */
+	uint32_t max_size;    /*!< \brief Allocated size of the rdata array. */
+	bool unsorted;        /*!< \brief RRs weren't added in canonical order. */
+	uint32_t last;        /*!< \brief Offset of the last added RR. */
+	knot_mm_t *mm;        /*!< \brief Memory context. */
+} knot_rdataset_builder_t;
+
+/*!
+ * \brief Initializes rdataset builder.
+ *
+ * Unlike repeated knot_rdataset_add(), which keeps the rdataset sorted
+ * after each insertion, the builder appends the RRs into a growing array
+ * and sorts them at once when finished. The total cost is thus linear
+ * for sorted input and N log N otherwise.
+ *
+ * \note Zeroed structure is a valid builder without memory context.
+ *
+ * \param builder  Builder to be initialized.
+ * \param mm       Memory context.
+ */
+void knot_rdataset_builder_init(knot_rdataset_builder_t *builder, knot_mm_t *mm);
+
+/*!
+ * \brief Appends a RR to the builder. The data is copied.
+ *
+ * \param builder  Rdataset builder.
+ * \param data     RR data.
+ * \param len      RR data length.
+ *
+ * \return KNOT_E*
+ */
+int knot_rdataset_builder_add(knot_rdataset_builder_t *builder, const uint8_t *data,
+                              uint16_t len);
+
+/*!
+ * \brief Sorts the appended RRs, removes duplicates, and hands them over.
+ *
+ * The builder is reset and can be used again.
+ *
+ * \param builder  Rdataset builder.
+ * \param rrs      Output rdataset (its previous contents are not freed).
+ *
+ * \return KNOT_E*
+ */
+int knot_rdataset_builder_finish(knot_rdataset_builder_t *builder, knot_rdataset_t *rrs);
+
+/*!
+ * \brief Frees the appended RRs and resets the builder.
+ *
+ * \param builder  Rdataset builder.
+ */
+void knot_rdataset_builder_clear(knot_rdataset_builder_t *builder);
+
 /*! @} */
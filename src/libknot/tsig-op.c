@@ -16,8 +16,10 @@
 
 #include <assert.h>
 #include <inttypes.h>
+#include <pthread.h>
 #include <time.h>
 #include <stdint.h>
+#include <stdlib.h>
 
 #include "libdnssec/error.h"
 #include "libdnssec/tsig.h"
@@ -35,6 +37,118 @@
 const int KNOT_TSIG_MAX_DIGEST_SIZE = 64;    // size of HMAC-SHA512 digest
 const uint16_t KNOT_TSIG_FUDGE_DEFAULT = 300;  // default Fudge value
 
+// Number of keyed HMAC contexts kept per thread.
+#define HMAC_CACHE_SIZE 8
+
+/*! \brief HMAC context keyed with a TSIG secret, no data added. */
+typedef struct {
+	dnssec_tsig_ctx_t *ctx;
+	dnssec_tsig_algorithm_t algorithm;
+	dnssec_binary_t secret;
+} hmac_cached_t;
+
+typedef struct {
+	hmac_cached_t entries[HMAC_CACHE_SIZE];
+	unsigned next; // Entry to be replaced next.
+} hmac_cache_t;
+
+static __thread hmac_cache_t *thread_cache;
+
+static pthread_key_t cache_key;
+static pthread_once_t cache_key_once = PTHREAD_ONCE_INIT;
+
+static void cache_entry_clear(hmac_cached_t *entry)
+{
+	dnssec_tsig_free(entry->ctx);
+	if (entry->secret.data != NULL) {
+		memzero(entry->secret.data, entry->secret.size);
+	}
+	dnssec_binary_free(&entry->secret);
+	memset(entry, 0, sizeof(*entry));
+}
+
+static void cache_free(void *ptr)
+{
+	hmac_cache_t *cache = ptr;
+	for (int i = 0; i < HMAC_CACHE_SIZE; i++) {
+		cache_entry_clear(&cache->entries[i]);
+	}
+	free(cache);
+}
+
+static void cache_key_init(void)
+{
+	(void)pthread_key_create(&cache_key, cache_free);
+}
+
+static hmac_cache_t *get_cache(void)
+{
+	if (thread_cache != NULL) {
+		return thread_cache;
+	}
+
+	hmac_cache_t *cache = calloc(1, sizeof(*cache));
+	if (cache == NULL) {
+		return NULL;
+	}
+
+	// Register the thread for cleanup of the cache on exit.
+	(void)pthread_once(&cache_key_once, cache_key_init);
+	if (pthread_setspecific(cache_key, cache) != 0) {
+		free(cache);
+		return NULL;
+	}
+
+	thread_cache = cache;
+	return cache;
+}
+
+/*!
+ * \brief Create a HMAC context for the key.
+ *
+ * The key setup (the inner and outer pads) is done once per thread and key,
+ * each message gets a copy of the keyed context.
+ */
+static int hmac_new(dnssec_tsig_ctx_t **ctx, const knot_tsig_key_t *key)
+{
+	hmac_cache_t *cache = get_cache();
+	if (cache == NULL) {
+		return dnssec_tsig_new(ctx, key->algorithm, &key->secret);
+	}
+
+	hmac_cached_t *entry = NULL;
+	for (int i = 0; i < HMAC_CACHE_SIZE; i++) {
+		hmac_cached_t *e = &cache->entries[i];
+		if (e->ctx != NULL && e->algorithm == key->algorithm &&
+		    dnssec_binary_cmp(&e->secret, &key->secret) == 0) {
+			entry = e;
+			break;
+		}
+	}
+
+	if (entry == NULL) {
+		entry = &cache->entries[cache->next];
+		cache->next = (cache->next + 1) % HMAC_CACHE_SIZE;
+		cache_entry_clear(entry);
+
+		int ret = dnssec_tsig_new(&entry->ctx, key->algorithm, &key->secret);
+		if (ret == DNSSEC_EOK) {
+			ret = dnssec_binary_dup(&key->secret, &entry->secret);
+		}
+		if (ret != DNSSEC_EOK) {
+			cache_entry_clear(entry);
+			return dnssec_tsig_new(ctx, key->algorithm, &key->secret);
+		}
+		entry->algorithm = key->algorithm;
+	}
+
+	if (dnssec_tsig_copy(ctx, entry->ctx) != DNSSEC_EOK) {
+		return dnssec_tsig_new(ctx, key->algorithm, &key->secret);
+	}
+
+	return DNSSEC_EOK;
+}
+
 static int check_algorithm(const knot_rrset_t *tsig_rr)
 {
 	if (tsig_rr == NULL) {
@@ -85,7 +199,7 @@ static int compute_digest(const uint8_t *wire, size_t wire_len,
 	}
 
 	dnssec_tsig_ctx_t *ctx = NULL;
-	int result = dnssec_tsig_new(&ctx, key->algorithm, &key->secret);
+	int result = hmac_new(&ctx, key);
 	if (result != DNSSEC_EOK) {
 		return KNOT_TSIG_EBADSIG;
 	}
@@ -38,6 +38,7 @@ typedef enum {
 	KNOT_XDP_FILTER_PASS  = 1 << 4,  /*!< Pass incoming messages to ports >= port value. */
 	KNOT_XDP_FILTER_DROP  = 1 << 5,  /*!< Drop incoming messages to ports >= port value. */
 	KNOT_XDP_FILTER_ROUTE = 1 << 6,  /*!< Consider routing information from kernel. */
+	KNOT_XDP_FILTER_RRL   = 1 << 7,  /*!< Drop UDP queries over the rate limit. */
 } knot_xdp_filter_flag_t;
 
 /*! \brief XDP map item for the filter configuration. */
@@ -48,6 +49,38 @@ struct knot_xdp_opts {
 	__u16 quic_port; /*!< QUIC/UDP port to listen on. */
 } __attribute__((packed));
 
+/*! \brief Limit of the rate limiting load of an address prefix. */
+#define KNOT_XDP_RRL_LIMIT	(1ULL << 40)
+
+/*! \brief Rate limited address prefixes and their rate multipliers (as in mod-rrl). */
+#define KNOT_XDP_RRL_PREFIXES	5
+#define KNOT_XDP_RRL_V4_PREFIXES	{  18,  20, 24, 32 }
+#define KNOT_XDP_RRL_V4_RATE_MULT	{ 768, 256, 32,  1 }
+#define KNOT_XDP_RRL_V6_PREFIXES	{ 32, 48, 56, 64, 128 }
+#define KNOT_XDP_RRL_V6_RATE_MULT	{ 64,  4,  3,  2,   1 }
+
+/*! \brief XDP map item for the rate limiting configuration. */
+typedef struct knot_xdp_rrl_opts knot_xdp_rrl_opts_t;
+struct knot_xdp_rrl_opts {
+	__u64 v4_prices[KNOT_XDP_RRL_PREFIXES]; /*!< Load increments of IPv4 prefixes. */
+	__u64 v6_prices[KNOT_XDP_RRL_PREFIXES]; /*!< Load increments of IPv6 prefixes. */
+	__u64 decay;                            /*!< Load decrement per millisecond. */
+};
+
+/*! \brief XDP map key of a rate limited address prefix. */
+struct knot_xdp_rrl_key {
+	__u32 addr[4]; /*!< Masked address. */
+	__u8 prefix;   /*!< Prefix length. */
+	__u8 ipv4;     /*!< IPv4 address indication. */
+	__u16 unused;
+};
+
+/*! \brief XDP map item of a rate limited address prefix. */
+struct knot_xdp_rrl_val {
+	__u64 load;    /*!< Load at the time of the last update. */
+	__u64 time;    /*!< Time of the last update in milliseconds. */
+};
+
 /*! \brief Additional information from the filter. */
 typedef struct knot_xdp_info knot_xdp_info_t;
 struct knot_xdp_info {
@@ -41,6 +41,9 @@
 /* DNS header size. */
 #define DNS_HDR_SIZE	12
 
+/* Maximum number of rate limited address prefixes. */
+#define RRL_TABLE_SIZE	262144
+
 /* A map of configuration options. */
 struct {
 	__uint(type, BPF_MAP_TYPE_ARRAY);
@@ -57,8 +60,100 @@ struct {
 	__uint(value_size, sizeof(int));
 } xsks_map SEC(".maps");
 
-SEC("xdp")
-int xdp_redirect_dns_func(struct xdp_md *ctx)
+/* A map of the rate limiting configuration, shared by all the queues. */
+struct {
+	__uint(type, BPF_MAP_TYPE_ARRAY);
+	__uint(max_entries, 1);
+	__uint(key_size, sizeof(__u32)); /* Must be 4 bytes. */
+	__uint(value_size, sizeof(knot_xdp_rrl_opts_t));
+} rrl_opts_map SEC(".maps");
+
+/* A map of loads of the rate limited address prefixes. */
+struct {
+	__uint(type, BPF_MAP_TYPE_LRU_HASH);
+	__uint(max_entries, RRL_TABLE_SIZE);
+	__uint(key_size, sizeof(struct knot_xdp_rrl_key));
+	__uint(value_size, sizeof(struct knot_xdp_rrl_val));
+} rrl_state_map SEC(".maps");
+
+/* The same limiting as mod-rrl (KRU) with the load decaying linearly, which
+ * only matters below the limit. All the prefixes are charged if none is limited.
+ * Concurrent updates from more CPUs may lose some increments, it's a coarse
+ * pre-filter, slipping and truncation is up to the module in user space. */
+static __always_inline int rrl_limited(const __u32 *addr, __u8 ipv4)
+{
+	__u32 zero = 0;
+	const knot_xdp_rrl_opts_t *rrl = bpf_map_lookup_elem(&rrl_opts_map, &zero);
+	if (!rrl || rrl->decay == 0) {
+		return 0;
+	}
+
+	const __u8 v4_prefixes[KNOT_XDP_RRL_PREFIXES] = KNOT_XDP_RRL_V4_PREFIXES;
+	const __u8 v6_prefixes[KNOT_XDP_RRL_PREFIXES] = KNOT_XDP_RRL_V6_PREFIXES;
+	const __u64 now = bpf_ktime_get_ns() / 1000000;
+
+	struct knot_xdp_rrl_val *vals[KNOT_XDP_RRL_PREFIXES] = { 0 };
+	__u64 loads[KNOT_XDP_RRL_PREFIXES] = { 0 };
+
+	/* Unrolled so that the arrays are indexed by constants. */
+#pragma unroll
+	for (int i = 0; i < KNOT_XDP_RRL_PREFIXES; i++) {
+		__u8 prefix = ipv4 ? v4_prefixes[i] : v6_prefixes[i];
+		__u64 price = ipv4 ? rrl->v4_prices[i] : rrl->v6_prices[i];
+		if (prefix == 0) {
+			break;
+		}
+
+		struct knot_xdp_rrl_key key = { .prefix = prefix, .ipv4 = ipv4 };
+#pragma unroll
+		for (int j = 0; j < 4; j++) {
+			int bits = (int)prefix - 32 * j;
+			if (bits >= 32) {
+				key.addr[j] = addr[j];
+			} else if (bits > 0) {
+				key.addr[j] = addr[j] & bpf_htonl(~0U << (32 - bits));
+			}
+		}
+
+		struct knot_xdp_rrl_val *val = bpf_map_lookup_elem(&rrl_state_map, &key);
+		if (!val) {
+			struct knot_xdp_rrl_val init = { .load = 0, .time = now };
+			(void)bpf_map_update_elem(&rrl_state_map, &key, &init, BPF_NOEXIST);
+			val = bpf_map_lookup_elem(&rrl_state_map, &key);
+			if (!val) {
+				continue;
+			}
+		}
+
+		__u64 load = val->load;
+		__u64 elapsed = now - val->time;
+		if (elapsed >= (1 << 20)) {
+			load = 0;
+		} else if (load > elapsed * rrl->decay) {
+			load -= elapsed * rrl->decay;
+		} else {
+			load = 0;
+		}
+
+		if (load + price > KNOT_XDP_RRL_LIMIT) {
+			return 1;
+		}
+		vals[i] = val;
+		loads[i] = load + price;
+	}
+
+#pragma unroll
+	for (int i = 0; i < KNOT_XDP_RRL_PREFIXES; i++) {
+		if (vals[i]) {
+			vals[i]->load = loads[i];
+			vals[i]->time = now;
+		}
+	}
+
+	return 0;
+}
+
+static __always_inline int redirect_dns(struct xdp_md *ctx, const __u8 frags)
 {
 	/* Get the queue options. */
 	__u32 index = ctx->rx_queue_index;
@@ -128,9 +223,11 @@ int xdp_redirect_dns_func(struct xdp_md *ctx)
 		}
 
 		/* Check the IP length. Cannot use strict equality due to
-		 * Ethernet padding applied to frames shorter than 64 octects. */
+		 * Ethernet padding applied to frames shorter than 64 octects.
+		 * A multi-buffer packet only has its first buffer linear, so
+		 * the length is checked in user space. */
 		ip_len = bpf_ntohs(ip4->tot_len);
-		if (data_end - data < ip_len) {
+		if (!frags && data_end - data < ip_len) {
 			return XDP_DROP;
 		}
 
@@ -154,7 +251,7 @@ int xdp_redirect_dns_func(struct xdp_md *ctx)
 		/* Check the IP length. Cannot use strict equality due to
 		 * Ethernet padding applied to frames shorter than 64 octects. */
 		ip_len = sizeof(*ip6) + bpf_ntohs(ip6->payload_len);
-		if (data_end - data < ip_len) {
+		if (!frags && data_end - data < ip_len) {
 			return XDP_DROP;
 		}
 
@@ -273,6 +370,20 @@ int xdp_redirect_dns_func(struct xdp_md *ctx)
 		return XDP_DROP;
 	}
 
+	/* Drop DNS over UDP query from a rate limited address prefix. */
+	if ((opts.flags & KNOT_XDP_FILTER_RRL) && ip_proto == IPPROTO_UDP &&
+	    port_dest == opts.udp_port) {
+		__u32 addr[4] = { 0 };
+		if (ipv4) {
+			addr[0] = ip4->saddr;
+		} else {
+			__builtin_memcpy(addr, &ip6->saddr, sizeof(addr));
+		}
+		if (rrl_limited(addr, ipv4)) {
+			return XDP_DROP;
+		}
+	}
+
 	/* Take into account routing information. */
 	if (opts.flags & KNOT_XDP_FILTER_ROUTE) {
 		struct bpf_fib_lookup fib = {
@@ -323,4 +434,17 @@ int xdp_redirect_dns_func(struct xdp_md *ctx)
 	return bpf_redirect_map(&xsks_map, ctx->rx_queue_index, 0);
 }
 
+SEC("xdp")
+int xdp_redirect_dns_func(struct xdp_md *ctx)
+{
+	return redirect_dns(ctx, 0);
+}
+
+/* Variant for multi-buffer (jumbo frame) enabled interfaces. */
+SEC("xdp.frags")
+int xdp_redirect_dns_frags_func(struct xdp_md *ctx)
+{
+	return redirect_dns(ctx, 1);
+}
+
 char _license[] SEC("license") = "GPL";
@@ -28,14 +28,18 @@
 #include "libknot/xdp/eth.h"
 #include "contrib/openbsd/strlcpy.h"
 
-#define NO_BPF_MAPS	2
+#define NO_BPF_MAPS	4
+
+#if defined(HAVE_BPF_PROGRAM_SET_FLAGS) && defined(BPF_F_XDP_HAS_FRAGS)
+ #define XDP_FRAGS_SUPPORTED
+#endif
 
 static inline bool IS_ERR_OR_NULL(const void *ptr)
 {
 	return (ptr == NULL) || (unsigned long)ptr >= (unsigned long)-4095;
 }
 
-static int prog_load(struct bpf_object **pobj, int *prog_fd)
+static int prog_load(struct bpf_object **pobj, int *prog_fd, bool frags)
 {
 	struct bpf_program *prog, *first_prog = NULL;
 	struct bpf_object *obj;
@@ -57,6 +61,32 @@ static int prog_load(struct bpf_object **pobj, int *prog_fd)
 		return KNOT_ENOENT;
 	}
 
+#ifdef XDP_FRAGS_SUPPORTED
+	/* Only the dedicated variant of the program can parse multi-buffer packets. */
+	if (frags) {
+		prog = bpf_object__find_program_by_name(obj, "xdp_redirect_dns_frags_func");
+		if (prog == NULL) {
+			bpf_object__close(obj);
+			return KNOT_ENOTSUP;
+		}
+		first_prog = prog;
+	}
+	bpf_object__for_each_program(prog, obj) {
+		bpf_program__set_autoload(prog, prog == first_prog);
+	}
+
+	uint32_t prog_flags = bpf_program__flags(first_prog) & ~BPF_F_XDP_HAS_FRAGS;
+	if (frags) {
+		prog_flags |= BPF_F_XDP_HAS_FRAGS;
+	}
+	(void)bpf_program__set_flags(first_prog, prog_flags);
+#else
+	if (frags) {
+		bpf_object__close(obj);
+		return KNOT_ENOTSUP;
+	}
+#endif
+
 	int ret = bpf_object__load(obj);
 	if (ret != 0) {
 		bpf_object__close(obj);
@@ -69,16 +99,25 @@ static int prog_load(struct bpf_object **pobj, int *prog_fd)
 	return KNOT_EOK;
 }
 
-static int ensure_prog(struct kxsk_iface *iface, bool overwrite, bool generic_xdp)
+static int ensure_prog(struct kxsk_iface *iface, bool overwrite, bool generic_xdp,
+                       bool multi_buffer)
 {
 	if (bpf_kernel_o_len < 2) {
 		return KNOT_ENOTSUP;
 	}
 
 	/* Use libbpf for extracting BPF byte-code from BPF-ELF object, and
-	 * loading this into the kernel via bpf-syscall. */
+	 * loading this into the kernel via bpf-syscall. If the multi-buffer
+	 * variant cannot be loaded (e.g. old kernel), use the normal one. */
 	int prog_fd;
-	int ret = prog_load(&iface->prog_obj, &prog_fd);
+	int ret = KNOT_ENOTSUP;
+	if (multi_buffer) {
+		ret = prog_load(&iface->prog_obj, &prog_fd, true);
+	}
+	iface->frags = (ret == KNOT_EOK);
+	if (ret != KNOT_EOK) {
+		ret = prog_load(&iface->prog_obj, &prog_fd, false);
+	}
 	if (ret != KNOT_EOK) {
 		return KNOT_EPROGRAM;
 	}
@@ -98,6 +137,7 @@ static int ensure_prog(struct kxsk_iface *iface, bool overwrite, bool generic_xd
 #endif
 	if (ret != 0) {
 		close(prog_fd);
+		iface->frags = false;
 	}
 	if (ret == -EBUSY && !overwrite) { // We try accepting the present program.
 		uint32_t prog_id = 0;
@@ -125,11 +165,16 @@ static void unget_bpf_maps(struct kxsk_iface *iface)
 	if (iface->xsks_map_fd >= 0) {
 		close(iface->xsks_map_fd);
 	}
-	iface->opts_map_fd = iface->xsks_map_fd = -1;
+	if (iface->rrl_map_fd >= 0) {
+		close(iface->rrl_map_fd);
+	}
+	iface->opts_map_fd = iface->xsks_map_fd = iface->rrl_map_fd = -1;
 }
 
 /*!
- * /brief Get FDs for the two maps and assign them into xsk_info-> fields.
+ * /brief Get FDs for the maps and assign them into xsk_info-> fields.
+ *
+ * The rate limiting map is optional (missing in a program of an older version).
  *
  * Inspired by xsk_lookup_bpf_maps() from libbpf before qidconf_map elimination.
  */
@@ -176,6 +221,11 @@ static int get_bpf_maps(int prog_fd, struct kxsk_iface *iface)
 			continue;
 		}
 
+		if (strcmp(map_info.name, "rrl_opts_map") == 0) {
+			iface->rrl_map_fd = fd;
+			continue;
+		}
+
 		close(fd);
 	}
 
@@ -216,6 +266,40 @@ int kxsk_socket_start(const struct kxsk_iface *iface, knot_xdp_filter_flag_t fla
 	return ret;
 }
 
+int kxsk_iface_rrl(const struct kxsk_iface *iface, uint32_t instant_limit,
+                   uint32_t rate_limit)
+{
+	if (iface == NULL || instant_limit == 0 || rate_limit > 1000ULL * instant_limit) {
+		return KNOT_EINVAL;
+	}
+	if (iface->rrl_map_fd < 0) {
+		return KNOT_ENOTSUP;
+	}
+
+	const uint8_t v4_prefixes[] = KNOT_XDP_RRL_V4_PREFIXES;
+	const uint16_t v4_mult[] = KNOT_XDP_RRL_V4_RATE_MULT;
+	const uint8_t v6_prefixes[] = KNOT_XDP_RRL_V6_PREFIXES;
+	const uint16_t v6_mult[] = KNOT_XDP_RRL_V6_RATE_MULT;
+
+	// Same pricing as in mod-rrl, the per-prefix multipliers included.
+	const uint64_t base_price = KNOT_XDP_RRL_LIMIT / instant_limit;
+	knot_xdp_rrl_opts_t opts = {
+		.decay = base_price * rate_limit / 1000,
+	};
+	for (size_t i = 0; i < sizeof(v4_prefixes); i++) {
+		opts.v4_prices[i] = base_price / v4_mult[i];
+	}
+	for (size_t i = 0; i < sizeof(v6_prefixes); i++) {
+		opts.v6_prices[i] = base_price / v6_mult[i];
+	}
+	if (opts.decay == 0) {
+		opts.decay = 1; // Zero disables the limiting.
+	}
+
+	uint32_t key = 0;
+	return bpf_map_update_elem(iface->rrl_map_fd, &key, &opts, 0);
+}
+
 void kxsk_socket_stop(const struct kxsk_iface *iface)
 {
 	if (iface == NULL) {
@@ -229,7 +313,7 @@ void kxsk_socket_stop(const struct kxsk_iface *iface)
 }
 
 int kxsk_iface_new(const char *if_name, unsigned if_queue, knot_xdp_load_bpf_t load_bpf,
-                   bool generic_xdp, struct kxsk_iface **out_iface)
+                   bool generic_xdp, bool multi_buffer, struct kxsk_iface **out_iface)
 {
 	if (if_name == NULL || out_iface == NULL) {
 		return KNOT_EINVAL;
@@ -247,7 +331,7 @@ int kxsk_iface_new(const char *if_name, unsigned if_queue, knot_xdp_load_bpf_t l
 		return KNOT_EINVAL;
 	}
 	iface->if_queue = if_queue;
-	iface->opts_map_fd = iface->xsks_map_fd = -1;
+	iface->opts_map_fd = iface->xsks_map_fd = iface->rrl_map_fd = -1;
 
 	int ret;
 	switch (load_bpf) {
@@ -276,10 +360,10 @@ int kxsk_iface_new(const char *if_name, unsigned if_queue, knot_xdp_load_bpf_t l
 		sleep(1);
 		// FALLTHROUGH
 	case KNOT_XDP_LOAD_BPF_ALWAYS:
-		ret = ensure_prog(iface, true, generic_xdp);
+		ret = ensure_prog(iface, true, generic_xdp, multi_buffer);
 		break;
 	case KNOT_XDP_LOAD_BPF_MAYBE:
-		ret = ensure_prog(iface, false, generic_xdp);
+		ret = ensure_prog(iface, false, generic_xdp, multi_buffer);
 		break;
 	default:
 		return KNOT_EINVAL;
@@ -45,9 +45,29 @@ struct kxsk_iface {
 	int opts_map_fd;
 	/*! XSK BPF map file descriptor. */
 	int xsks_map_fd;
+	/*! Rate limiting configuration BPF map file descriptor (-1 if not supported). */
+	int rrl_map_fd;
 
 	/*! BPF program object. */
 	struct bpf_object *prog_obj;
+
+	/*! The loaded BPF program accepts multi-buffer packets. */
+	bool frags;
+};
+
+struct kxsk_umem_area {
+	/*! Handle internal to libbpf. */
+	struct xsk_umem *umem;
+	/*! The memory frames of all the sharing sockets. */
+	struct umem_frame *frames;
+	/*! The number of frames per socket. */
+	uint32_t part_frames;
+	/*! The number of sockets the area is reserved for. */
+	uint16_t parts;
+	/*! The number of already assigned parts. */
+	uint16_t parts_used;
+	/*! The number of sockets using the area. */
+	uint16_t refs;
 };
 
 struct kxsk_umem {
@@ -57,11 +77,23 @@ struct kxsk_umem {
 	struct xsk_ring_cons cq;
 	/*! Handle internal to libbpf. */
 	struct xsk_umem *umem;
+	/*! The (possibly shared) UMEM memory area. */
+	struct kxsk_umem_area *area;
 
-	/*! The memory frames. */
+	/*! The memory frames (of the whole area). */
 	struct umem_frame *frames;
+	/*! Index of the first frame of this socket. */
+	uint32_t frame_base;
 	/*! Size of RX and TX rings. */
 	uint16_t ring_size;
+	/*! The number of multi-buffer blocks of consecutive frames (for TX). */
+	uint16_t mb_count;
+	/*! The number of free multi-buffer blocks (for TX). */
+	uint16_t mb_free_count;
+	/*! Stack of indices of the free multi-buffer blocks (for TX). */
+	uint16_t *mb_free_indices;
+	/*! The number of not yet completed descriptors of each multi-buffer block. */
+	uint8_t *mb_busy;
 	/*! The number of free frames (for TX). */
 	uint16_t tx_free_count;
 	/*! Stack of indices of the free frames (for TX). */
@@ -93,6 +125,18 @@ struct knot_xdp_socket {
 
 	/*! Enabled preferred busy polling. */
 	bool busy_poll;
+
+	/*! Enabled multi-buffer (jumbo frame) packets. */
+	bool multi_buffer;
+	/*! Buffers for linearized received multi-buffer packets. */
+	uint8_t *rx_mb;
+	/*! The number of the buffers for received multi-buffer packets. */
+	uint32_t rx_mb_count;
+	/*! Drop received descriptors until the end of a too big packet. */
+	bool rx_mb_drop;
+
+	/*! Rate limiting in the BPF program enabled. */
+	bool rrl;
 };
 
 /*!
@@ -102,12 +146,13 @@ struct knot_xdp_socket {
  * \param if_queue     Network card queue id.
  * \param load_bpf     Insert BPF program into packet processing.
  * \param generic_xdp  Use generic XDP implementation instead of a native one.
+ * \param multi_buffer Try to load a BPF program accepting multi-buffer packets.
  * \param out_iface    Output: created interface context.
  *
  * \return KNOT_E* or -errno
  */
 int kxsk_iface_new(const char *if_name, unsigned if_queue, knot_xdp_load_bpf_t load_bpf,
-                   bool generic_xdp, struct kxsk_iface **out_iface);
+                   bool generic_xdp, bool multi_buffer, struct kxsk_iface **out_iface);
 
 /*!
  * \brief Unload BPF maps for a socket.
@@ -132,6 +177,18 @@ void kxsk_iface_free(struct kxsk_iface *iface);
 int kxsk_socket_start(const struct kxsk_iface *iface, knot_xdp_filter_flag_t flags,
                       uint16_t udp_port, uint16_t quic_port, struct xsk_socket *xsk);
 
+/*!
+ * \brief Configure the rate limiting of UDP queries in the BPF program.
+ *
+ * \param iface          Interface context.
+ * \param instant_limit  Number of queries from one address allowed at once.
+ * \param rate_limit     Number of queries from one address allowed per second.
+ *
+ * \return KNOT_E* or -errno
+ */
+int kxsk_iface_rrl(const struct kxsk_iface *iface, uint32_t instant_limit,
+                   uint32_t rate_limit);
+
 /*!
  * \brief Deactivate this AF_XDP socket through the BPF maps.
  *
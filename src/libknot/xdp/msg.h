@@ -41,6 +41,7 @@ typedef enum {
 	KNOT_XDP_MSG_MSS   = (1 << 6), /*!< MSS option in TCP header (TCP only). */
 	KNOT_XDP_MSG_WSC   = (1 << 7), /*!< Window Scale option in TCP header. */
 	KNOT_XDP_MSG_VLAN  = (1 << 8), /*!< This packet will contain VLAN header. */
+	KNOT_XDP_MSG_MB    = (1 << 9), /*!< Multi-buffer packet (jumbo frame). */
 } knot_xdp_msg_flag_t;
 
 /*! \brief Packet description with src & dst MAC & IP addrs + DNS payload. */
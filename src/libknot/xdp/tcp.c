@@ -25,10 +25,20 @@
 #include "libknot/attribute.h"
 #include "libknot/error.h"
 #include "libdnssec/random.h"
+#include "contrib/bufpool.h"
 #include "contrib/macros.h"
 #include "contrib/openbsd/siphash.h"
 #include "contrib/ucw/lists.h"
 
+#define REHASH_STEP      4  // Number of old buckets migrated per table operation.
+#define REHASH_LOAD      2  // Average chain length triggering table growth.
+
+#define SYNCOOKIE_PERIOD 64 // Validity period of SYN cookies in seconds.
+#define SYNCOOKIE_WSC    3  // Position of window scale in SYN cookie.
+#define SYNCOOKIE_PARAMS 0x7f
+
+static const uint16_t syncookie_mss[] = { 536, 1220, 1440, 1460, 4312, 8960 };
+
 static uint32_t get_timestamp(void)
 {
 	struct timespec t;
@@ -65,6 +75,72 @@ static list_t *tcp_table_timeout(knot_tcp_table_t *table)
 	return (list_t *)&table->conns[table->size];
 }
 
+static knot_tcp_conn_t **tcp_table_bucket(knot_tcp_table_t *table, uint64_t hash)
+{
+	if (table->old_buckets != NULL) {
+		size_t old_idx = hash % table->old_count;
+		if (old_idx >= table->rehash_pos) { // not migrated yet
+			return table->old_buckets + old_idx;
+		}
+	}
+	return table->buckets + (hash % table->buckets_count);
+}
+
+static void tcp_table_grow(knot_tcp_table_t *table)
+{
+	if (table->old_buckets != NULL ||
+	    table->usage <= REHASH_LOAD * table->buckets_count ||
+	    table->buckets_count > SIZE_MAX / (2 * sizeof(*table->buckets))) {
+		return;
+	}
+
+	size_t new_count = 2 * table->buckets_count;
+	knot_tcp_conn_t **new_buckets = calloc(new_count, sizeof(*new_buckets));
+	if (new_count == 0 || new_buckets == NULL) {
+		free(new_buckets);
+		return; // just longer chains
+	}
+
+	table->old_buckets = table->buckets;
+	table->old_count = table->buckets_count;
+	table->rehash_pos = 0;
+	table->buckets = new_buckets;
+	table->buckets_count = new_count;
+}
+
+/*!
+ * Migrate a few buckets into the grown table. Must not be called while
+ * a pointer into the table (e.g. from tcp_table_lookup()) is being held.
+ */
+static void tcp_table_rehash(knot_tcp_table_t *table)
+{
+	if (table->old_buckets == NULL) {
+		return;
+	}
+
+	size_t end = MIN(table->rehash_pos + REHASH_STEP, table->old_count);
+	for ( ; table->rehash_pos < end; table->rehash_pos++) {
+		knot_tcp_conn_t **old = table->old_buckets + table->rehash_pos;
+		while (*old != NULL) {
+			knot_tcp_conn_t *conn = *old;
+			*old = conn->next;
+			uint64_t hash = hash_four_tuple(&conn->ip_rem, &conn->ip_loc, table);
+			knot_tcp_conn_t **bucket = table->buckets + (hash % table->buckets_count);
+			conn->next = *bucket;
+			*bucket = conn;
+		}
+	}
+
+	if (table->rehash_pos == table->old_count) {
+		if (table->old_buckets != table->conns) {
+			free(table->old_buckets);
+		}
+		table->old_buckets = NULL;
+		table->old_count = 0;
+		table->rehash_pos = 0;
+	}
+}
+
 static node_t *tcp_conn_node(knot_tcp_conn_t *conn)
 {
 	return (node_t *)&conn->list_node_placeholder;
@@ -111,6 +187,8 @@ knot_tcp_table_t *knot_tcp_table_new(size_t size, knot_tcp_table_t *secret_share
 	}
 
 	table->size = size;
+	table->buckets = table->conns;
+	table->buckets_count = size;
 	init_list(tcp_table_timeout(table));
 
 	assert(sizeof(table->hash_secret) == sizeof(SIPHASH_KEY));
@@ -128,13 +206,13 @@ knot_tcp_table_t *knot_tcp_table_new(size_t size, knot_tcp_table_t *secret_share
 static void del_conn(knot_tcp_conn_t *conn)
 {
 	if (conn != NULL) {
-		free(conn->inbuf.iov_base);
+		bufpool_free(conn->inbuf.iov_base, buffer_alloc_size(conn->inbuf.iov_len));
 		while (conn->outbufs != NULL) {
 			struct knot_tcp_outbuf *next = conn->outbufs->next;
-			free(conn->outbufs);
+			bufpool_free(conn->outbufs, conn->outbufs->len + sizeof(*conn->outbufs));
 			conn->outbufs = next;
 		}
-		free(conn);
+		bufpool_free(conn, sizeof(*conn));
 	}
 }
 
@@ -146,6 +224,12 @@ void knot_tcp_table_free(knot_tcp_table_t *table)
 		WALK_LIST_DELSAFE(conn, next, *tcp_table_timeout(table)) {
 			del_conn(conn);
 		}
+		if (table->buckets != table->conns) {
+			free(table->buckets);
+		}
+		if (table->old_buckets != table->conns) {
+			free(table->old_buckets);
+		}
 		free(table);
 	}
 }
@@ -158,7 +242,7 @@ static knot_tcp_conn_t **tcp_table_lookup(const struct sockaddr_in6 *rem,
 		*hash = hash_four_tuple(rem, loc, table);
 	}
 	size_t sdl = sockaddr_data_len(rem, loc);
-	knot_tcp_conn_t **res = table->conns + (*hash % table->size);
+	knot_tcp_conn_t **res = tcp_table_bucket(table, *hash);
 	while (*res != NULL) {
 		if (memcmp(&(*res)->ip_rem, rem, sdl) == 0 &&
 		    memcmp(&(*res)->ip_loc, loc, sdl) == 0) {
@@ -236,7 +320,7 @@ static void conn_init_from_msg(knot_tcp_conn_t *conn, knot_xdp_msg_t *msg)
 static void tcp_table_insert(knot_tcp_conn_t *conn, uint64_t hash,
                              knot_tcp_table_t *table)
 {
-	knot_tcp_conn_t **addto = table->conns + (hash % table->size);
+	knot_tcp_conn_t **addto = tcp_table_bucket(table, hash);
 	add_tail(tcp_table_timeout(table), tcp_conn_node(conn));
 	if (table->next_close == NULL) {
 		table->next_close = conn;
@@ -244,13 +328,14 @@ static void tcp_table_insert(knot_tcp_conn_t *conn, uint64_t hash,
 	conn->next = *addto;
 	*addto = conn;
 	table->usage++;
+	tcp_table_grow(table);
 }
 
 // WARNING you shall ensure that it's not in the table already!
 static int tcp_table_add(knot_xdp_msg_t *msg, uint64_t hash, knot_tcp_table_t *table,
                          knot_tcp_conn_t **res)
 {
-	knot_tcp_conn_t *c = malloc(sizeof(*c));
+	knot_tcp_conn_t *c = bufpool_alloc(sizeof(*c));
 	if (c == NULL) {
 		return KNOT_ENOMEM;
 	}
@@ -273,6 +358,99 @@ static bool check_seq_ack(const knot_xdp_msg_t *msg, const knot_tcp_conn_t *conn
 	}
 }
 
+static uint32_t syncookie_now(void)
+{
+	struct timespec t;
+	clock_gettime(CLOCK_MONOTONIC, &t);
+	return t.tv_sec / SYNCOOKIE_PERIOD;
+}
+
+static uint32_t syncookie_calc(const knot_xdp_msg_t *msg, uint32_t peer_isn,
+                               uint32_t period, uint8_t params,
+                               const knot_tcp_table_t *table)
+{
+	size_t sdl = sockaddr_data_len(&msg->ip_from, &msg->ip_to);
+	SIPHASH_CTX ctx;
+	SipHash24_Init(&ctx, (const SIPHASH_KEY *)(table->hash_secret));
+	SipHash24_Update(&ctx, &msg->ip_from, sdl);
+	SipHash24_Update(&ctx, &msg->ip_to, sdl);
+	SipHash24_Update(&ctx, &peer_isn, sizeof(peer_isn));
+	SipHash24_Update(&ctx, &period, sizeof(period));
+	SipHash24_Update(&ctx, &params, sizeof(params));
+	return (SipHash24_End(&ctx) & ~SYNCOOKIE_PARAMS) | params;
+}
+
+/*!
+ * Answer SYN with a SYN cookie. The relay connection isn't stored in any table,
+ * it's only used for sending the SYN+ACK and freed by knot_tcp_cleanup().
+ */
+static int syncookie_reply(knot_tcp_relay_t *relay, knot_xdp_msg_t *msg,
+                           knot_tcp_table_t *tcp_table, knot_tcp_table_t *syn_table,
+                           knot_tcp_ignore_t ignore)
+{
+	knot_tcp_conn_t *conn = bufpool_alloc(sizeof(*conn));
+	if (conn == NULL) {
+		return KNOT_ENOMEM;
+	}
+	conn_init_from_msg(conn, msg);
+	memset(&conn->list_node_placeholder, 0, sizeof(conn->list_node_placeholder));
+	conn->next = NULL;
+
+	uint8_t mss_idx = 0;
+	while (mss_idx + 1 < sizeof(syncookie_mss) / sizeof(syncookie_mss[0]) &&
+	       syncookie_mss[mss_idx + 1] <= msg->mss) {
+		mss_idx++;
+	}
+	uint8_t params = mss_idx | (MIN(msg->win_scale, 14) << SYNCOOKIE_WSC);
+	uint32_t period = syncookie_now();
+
+	conn->state = XDP_TCP_ESTABLISHING;
+	conn->mss = syncookie_mss[mss_idx];
+	conn->window_scale = msg->win_scale;
+	conn->seqno = knot_tcp_next_seqno(msg);
+	conn->ackno = syncookie_calc(msg, msg->seqno, period, params, tcp_table);
+	conn->acked = conn->ackno;
+	syn_table->syncookie_period = period + 1;
+
+	relay->conn = conn;
+	relay->action = XDP_TCP_SYN;
+	relay->answer = XDP_TCP_FREE;
+	if (!(ignore & XDP_TCP_IGNORE_ESTABLISH)) {
+		relay->auto_answer = KNOT_XDP_MSG_SYN | KNOT_XDP_MSG_ACK;
+	}
+
+	return KNOT_EOK;
+}
+
+static bool syncookie_check(const knot_xdp_msg_t *msg, const knot_tcp_table_t *tcp_table,
+                            const knot_tcp_table_t *syn_table,
+                            uint16_t *mss, uint8_t *window_scale)
+{
+	uint32_t now = syncookie_now();
+	if (syn_table->syncookie_period == 0 || now > syn_table->syncookie_period) {
+		return false; // no recent SYN cookies sent
+	}
+
+	uint32_t cookie = msg->ackno - 1;
+	uint8_t params = cookie & SYNCOOKIE_PARAMS;
+	uint8_t mss_idx = params & ((1 << SYNCOOKIE_WSC) - 1);
+	if (mss_idx >= sizeof(syncookie_mss) / sizeof(syncookie_mss[0])) {
+		return false;
+	}
+
+	for (uint32_t period = now; period + 1 >= now; period--) {
+		if (syncookie_calc(msg, msg->seqno - 1, period, params, tcp_table) == cookie) {
+			*mss = syncookie_mss[mss_idx];
+			*window_scale = params >> SYNCOOKIE_WSC;
+			return true;
+		}
+		if (period == 0) {
+			break;
+		}
+	}
+	return false;
+}
+
 static void conn_update(knot_tcp_conn_t *conn, const knot_xdp_msg_t *msg)
 {
 	conn->seqno = knot_tcp_next_seqno(msg);
@@ -303,6 +481,11 @@ int knot_tcp_recv(knot_tcp_relay_t *relay, knot_xdp_msg_t *msg,
 		return KNOT_EOK;
 	}
 
+	tcp_table_rehash(tcp_table);
+	if (syn_table != NULL) {
+		tcp_table_rehash(syn_table);
+	}
+
 	uint64_t conn_hash = 0;
 	knot_tcp_conn_t **pconn = tcp_table_lookup(&msg->ip_from, &msg->ip_to,
 	                                           &conn_hash, tcp_table);
@@ -357,6 +540,10 @@ int knot_tcp_recv(knot_tcp_relay_t *relay, knot_xdp_msg_t *msg,
 				if (*tcp_table_lookup(&msg->ip_from, &msg->ip_to, &conn_hash, syn_table) != NULL) {
 					break;
 				}
+				if (syn_table->usage >= syn_table->size) { // SYN flood, don't allocate
+					ret = syncookie_reply(relay, msg, tcp_table, syn_table, ignore);
+					break;
+				}
 			}
 
 			ret = tcp_table_add(msg, conn_hash, add_table, &relay->conn);
@@ -382,6 +569,8 @@ int knot_tcp_recv(knot_tcp_relay_t *relay, knot_xdp_msg_t *msg,
 		break;
 	case KNOT_XDP_MSG_ACK:
 		if (!seq_ack_match) {
+			uint16_t mss;
+			uint8_t window_scale;
 			if (syn_table != NULL && msg->payload.iov_len == 0 && conn == NULL &&
 			    (pconn = tcp_table_lookup(&msg->ip_from, &msg->ip_to, &conn_hash, syn_table)) != NULL &&
 			    (conn = *pconn) != NULL && check_seq_ack(msg, conn)) {
@@ -392,6 +581,16 @@ int knot_tcp_recv(knot_tcp_relay_t *relay, knot_xdp_msg_t *msg,
 				relay->action = XDP_TCP_ESTABLISH;
 				conn->state = XDP_TCP_NORMAL;
 				conn_update(conn, msg);
+			} else if (syn_table != NULL && msg->payload.iov_len == 0 && conn == NULL &&
+			           syncookie_check(msg, tcp_table, syn_table, &mss, &window_scale)) {
+				ret = tcp_table_add(msg, conn_hash, tcp_table, &relay->conn);
+				if (ret == KNOT_EOK) {
+					conn = relay->conn;
+					conn->mss = mss;
+					conn->window_scale = window_scale;
+					conn_update(conn, msg);
+					relay->action = XDP_TCP_ESTABLISH;
+				}
 			}
 		} else {
 			switch (conn->state) {
@@ -646,6 +845,8 @@ int knot_tcp_sweep(knot_tcp_table_t *tcp_table,
 		return KNOT_EINVAL;
 	}
 
+	tcp_table_rehash(tcp_table);
+
 	uint32_t now = get_timestamp();
 	memset(relays, 0, max_relays * sizeof(*relays));
 	knot_tcp_relay_t *rl = relays, *rl_max = rl + max_relays;
@@ -99,6 +99,12 @@ typedef struct {
 	knot_tcp_conn_t *next_ibuf;
 	knot_tcp_conn_t *next_obuf;
 	knot_tcp_conn_t *next_resend;
+	knot_tcp_conn_t **buckets;     // Current hash table, initially conns.
+	size_t buckets_count;
+	knot_tcp_conn_t **old_buckets; // Hash table being incrementally rehashed.
+	size_t old_count;
+	size_t rehash_pos;
+	uint32_t syncookie_period;     // Last SYN cookie period plus one.
 	knot_tcp_conn_t *conns[];
 } knot_tcp_table_t;
 
@@ -140,6 +146,8 @@ inline static bool knot_tcp_relay_empty(const knot_tcp_relay_t *relay)
  * \param secret_share   Optional: share the hashing secret with another table.
  *
  * \note Hashing conflicts are solved by single-linked-lists in each record.
+ * \note The table grows (incrementally rehashed) if the usage exceeds
+ *       twice the number of records.
  *
  * \return The table, or NULL.
  */
@@ -162,6 +170,8 @@ void knot_tcp_table_free(knot_tcp_table_t *table);
  * \param ignore      Ignore specific TCP packets indication.
  *
  * \note resulting relay might be knot_tcp_relay_empty()
+ * \note If the SYN table is full (its usage reaches its size), SYN is answered
+ *       with a SYN cookie and the connection is not stored until it's ACKed.
  *
  * \return KNOT_E*
  */
@@ -20,6 +20,7 @@
 
 #include "libknot/xdp/tcp_iobuf.h"
 
+#include "contrib/bufpool.h"
 #include "contrib/macros.h"
 #include "libknot/attribute.h"
 #include "libknot/endian.h"
@@ -28,7 +29,7 @@
 
 static void iov_clear(struct iovec *iov)
 {
-	free(iov->iov_base);
+	bufpool_free(iov->iov_base, buffer_alloc_size(iov->iov_len));
 	memset(iov, 0, sizeof(*iov));
 }
 
@@ -196,13 +197,17 @@ int knot_tcp_inbufs_upd(struct iovec *buffer, struct iovec data, bool alloc_bufs
 		size_t buffer_original_size = buffer_alloc_size(buffer->iov_len);
 		size_t bufalloc = buffer_alloc_size(buffer->iov_len + data.iov_len);
 		if (buffer_original_size < bufalloc) {
-			void *newbuf = realloc(buffer->iov_base, bufalloc);
+			void *newbuf = bufpool_alloc(bufalloc);
 			if (newbuf == NULL) {
-				free(buffer->iov_base);
+				bufpool_free(buffer->iov_base, buffer_original_size);
 				buffer->iov_base = NULL;
 				free(out);
 				return KNOT_ENOMEM;
 			}
+			if (buffer->iov_len > 0) {
+				memcpy(newbuf, buffer->iov_base, buffer->iov_len);
+			}
+			bufpool_free(buffer->iov_base, buffer_original_size);
 			buffer->iov_base = newbuf;
 			*buffers_total += bufalloc - buffer_original_size;
 		}
@@ -228,10 +233,11 @@ int knot_tcp_outbufs_add(knot_tcp_outbuf_t **bufs, uint8_t *data, size_t len,
 	uint16_t prefix = htobe16(len), prefix_len = sizeof(prefix);
 	while (len > 0) {
 		uint16_t newlen = MIN(len + prefix_len, mss);
-		knot_tcp_outbuf_t *newob = calloc(1, sizeof(*newob) + newlen);
+		knot_tcp_outbuf_t *newob = bufpool_alloc(sizeof(*newob) + newlen);
 		if (newob == NULL) {
 			return KNOT_ENOMEM;
 		}
+		memset(newob, 0, sizeof(*newob));
 		*outbufs_total += sizeof(*newob) + newlen;
 		newob->len = newlen;
 		if (ignore_lastbyte) {
@@ -268,7 +274,7 @@ void knot_tcp_outbufs_ack(knot_tcp_outbuf_t **bufs, uint32_t ackno, size_t *outb
 		knot_tcp_outbuf_t *tofree = *bufs;
 		*bufs = tofree->next;
 		*outbufs_total -= tofree->len + sizeof(*tofree);
-		free(tofree);
+		bufpool_free(tofree, tofree->len + sizeof(*tofree));
 	}
 }
 
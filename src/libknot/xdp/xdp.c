@@ -22,6 +22,7 @@
 #include <stddef.h>
 #include <stdlib.h>
 #include <string.h>
+#include <sys/mman.h>
 #include <time.h>
 #include <unistd.h>
 
@@ -40,6 +41,11 @@
 #define FRAME_SIZE		2048
 #define DEFAULT_RING_SIZE	2048
 #define RETRY_DELAY		20 // In nanoseconds.
+#define MB_FRAMES		5  // Frames per multi-buffer block (fits a 9000 bytes jumbo frame).
+#define MB_SIZE			(MB_FRAMES * FRAME_SIZE)
+#define MB_BASE(umem)		(2 * (uint64_t)(umem)->ring_size) // The first frame of the blocks.
+#define HUGE_PAGE_SIZE		(2 * 1024 * 1024)
+#define RX_MB_HEADROOM		(KNOT_XDP_PKT_ALIGNMENT + sizeof(knot_xdp_info_t))
 
 struct umem_frame {
 	uint8_t bytes[FRAME_SIZE];
@@ -67,44 +73,114 @@ static uint32_t ring_size(const knot_xdp_config_t *config)
 	return config != NULL ? config->ring_size : DEFAULT_RING_SIZE;
 }
 
-static int configure_xsk_umem(struct kxsk_umem **out_umem, uint32_t ring_size)
+static void free_umem_area(struct kxsk_umem_area *area)
 {
-	/* Allocate memory and call driver to create the UMEM. */
-	struct kxsk_umem *umem = calloc(1,
-		offsetof(struct kxsk_umem, tx_free_indices)
-		+ sizeof(umem->tx_free_indices[0]) * ring_size);
-	if (umem == NULL) {
-		return KNOT_ENOMEM;
+	if (area != NULL && --area->refs == 0) {
+		if (area->umem != NULL) {
+			(void)xsk_umem__delete(area->umem);
+		}
+		free(area->frames);
+		free(area);
 	}
-	umem->ring_size = ring_size;
+}
 
-	/* It's recommended that the FQ ring size >= HW RX ring size + AF_XDP RX ring size.
-	 * However, the performance is better if FQ size == AF_XDP RX size. */
-	const uint32_t FQ_SIZE = umem->ring_size;
-	const uint32_t CQ_SIZE = umem->ring_size;
-	const uint32_t FRAMES = FQ_SIZE + CQ_SIZE;
+static void deconfigure_xsk_umem(struct kxsk_umem *umem)
+{
+	free_umem_area(umem->area);
+	free(umem->mb_free_indices);
+	free(umem->mb_busy);
+	free(umem);
+}
 
-	int ret = posix_memalign((void **)&umem->frames, getpagesize(),
-	                         FRAME_SIZE * FRAMES);
+static int create_umem_area(struct kxsk_umem *umem, uint32_t part_frames,
+                            uint16_t parts)
+{
+	struct kxsk_umem_area *area = calloc(1, sizeof(*area));
+	if (area == NULL) {
+		return KNOT_ENOMEM;
+	}
+	area->part_frames = part_frames;
+	area->parts = parts;
+	area->parts_used = 1;
+	area->refs = 1;
+	umem->area = area;
+
+	/* Prefer huge pages for big areas to reduce TLB pressure. */
+	const size_t size = (size_t)FRAME_SIZE * part_frames * parts;
+	const size_t align = (size >= HUGE_PAGE_SIZE) ? HUGE_PAGE_SIZE : getpagesize();
+	int ret = posix_memalign((void **)&area->frames, align, size);
 	if (ret != 0) {
-		free(umem);
+		area->frames = NULL;
 		return KNOT_ENOMEM;
 	}
+#ifdef MADV_HUGEPAGE
+	if (align == HUGE_PAGE_SIZE) {
+		(void)madvise(area->frames, size, MADV_HUGEPAGE);
+	}
+#endif
 
+	/* It's recommended that the FQ ring size >= HW RX ring size + AF_XDP RX ring size.
+	 * However, the performance is better if FQ size == AF_XDP RX size. */
 	const struct xsk_umem_config umem_config = {
-		.fill_size = FQ_SIZE,
-		.comp_size = CQ_SIZE,
+		.fill_size = umem->ring_size,
+		.comp_size = umem->ring_size,
 		.frame_size = FRAME_SIZE,
 		.frame_headroom = KNOT_XDP_PKT_ALIGNMENT,
 	};
 
-	ret = xsk_umem__create(&umem->umem, umem->frames, FRAME_SIZE * FRAMES,
-	                       &umem->fq, &umem->cq, &umem_config);
-	if (ret != KNOT_EOK) {
-		free(umem->frames);
-		free(umem);
-		return ret;
+	return xsk_umem__create(&area->umem, area->frames, size,
+	                        &umem->fq, &umem->cq, &umem_config);
+}
+
+static int configure_xsk_umem(struct kxsk_umem **out_umem, uint32_t ring_size,
+                              bool multi_buffer, uint16_t shared_count,
+                              const struct kxsk_umem *shared)
+{
+	struct kxsk_umem *umem = calloc(1,
+		offsetof(struct kxsk_umem, tx_free_indices)
+		+ sizeof(umem->tx_free_indices[0]) * ring_size);
+	if (umem == NULL) {
+		return KNOT_ENOMEM;
+	}
+	umem->ring_size = ring_size;
+
+	/* Each socket has a TX ring, an RX ring, and possibly multi-buffer
+	 * blocks of consecutive frames (for jumbo frames) worth of frames. */
+	const uint32_t CQ_SIZE = umem->ring_size;
+	const uint32_t FQ_SIZE = umem->ring_size;
+	const uint32_t MB_COUNT = multi_buffer ? MAX(umem->ring_size / 8, 1) : 0;
+	const uint32_t FRAMES = FQ_SIZE + CQ_SIZE + MB_COUNT * MB_FRAMES;
+
+	if (MB_COUNT > 0) {
+		umem->mb_free_indices = malloc(sizeof(*umem->mb_free_indices) * MB_COUNT);
+		umem->mb_busy = calloc(MB_COUNT, sizeof(*umem->mb_busy));
+		if (umem->mb_free_indices == NULL || umem->mb_busy == NULL) {
+			deconfigure_xsk_umem(umem);
+			return KNOT_ENOMEM;
+		}
+		umem->mb_count = MB_COUNT;
 	}
+
+	/* Use a free part of the shared area or create a new area. */
+	if (shared != NULL) {
+		struct kxsk_umem_area *area = shared->area;
+		if (area->parts_used >= area->parts || area->part_frames != FRAMES ||
+		    shared->ring_size != ring_size) {
+			deconfigure_xsk_umem(umem);
+			return KNOT_ESPACE;
+		}
+		umem->frame_base = area->parts_used++ * FRAMES;
+		area->refs++;
+		umem->area = area;
+	} else {
+		int ret = create_umem_area(umem, FRAMES, MAX(shared_count, 1));
+		if (ret != KNOT_EOK) {
+			deconfigure_xsk_umem(umem);
+			return ret;
+		}
+	}
+	umem->umem = umem->area->umem;
+	umem->frames = umem->area->frames;
 	*out_umem = umem;
 
 	/* Designate the starting chunk of buffers for TX, and put them onto the stack. */
@@ -113,29 +189,37 @@ static int configure_xsk_umem(struct kxsk_umem **out_umem, uint32_t ring_size)
 		umem->tx_free_indices[i] = i;
 	}
 
+	/* Designate the trailing chunk of buffers for multi-buffer TX. */
+	umem->mb_free_count = MB_COUNT;
+	for (uint32_t i = 0; i < MB_COUNT; ++i) {
+		umem->mb_free_indices[i] = i;
+	}
+
+	return KNOT_EOK;
+}
+
+static int fill_xsk_fq(struct kxsk_umem *umem)
+{
 	/* Designate the rest of buffers for RX, and pass them to the driver. */
+	const uint32_t CQ_SIZE = umem->ring_size;
+	const uint32_t FQ_SIZE = umem->ring_size;
+
 	uint32_t idx = 0;
-	ret = xsk_ring_prod__reserve(&umem->fq, FQ_SIZE, &idx);
+	int ret = xsk_ring_prod__reserve(&umem->fq, FQ_SIZE, &idx);
 	if (ret != FQ_SIZE) {
 		assert(0);
 		return KNOT_ERROR;
 	}
 	assert(idx == 0);
 	for (uint32_t i = CQ_SIZE; i < CQ_SIZE + FQ_SIZE; ++i) {
-		*xsk_ring_prod__fill_addr(&umem->fq, idx++) = i * FRAME_SIZE;
+		*xsk_ring_prod__fill_addr(&umem->fq, idx++) =
+			(uint64_t)(umem->frame_base + i) * FRAME_SIZE;
 	}
 	xsk_ring_prod__submit(&umem->fq, FQ_SIZE);
 
 	return KNOT_EOK;
 }
 
-static void deconfigure_xsk_umem(struct kxsk_umem *umem)
-{
-	(void)xsk_umem__delete(umem->umem);
-	free(umem->frames);
-	free(umem);
-}
-
 static int enable_busypoll(int socket, unsigned timeout_us, unsigned budget)
 {
 #if defined(SO_PREFER_BUSY_POLL) && defined(SO_BUSY_POLL_BUDGET)
@@ -163,8 +247,27 @@ static int enable_busypoll(int socket, unsigned timeout_us, unsigned budget)
 #endif
 }
 
+static int create_xsk_socket(knot_xdp_socket_t *xsk_info, bool shared,
+                             const struct xsk_socket_config *sock_conf)
+{
+	const struct kxsk_iface *iface = xsk_info->iface;
+	struct kxsk_umem *umem = xsk_info->umem;
+
+	if (shared) { // With own fill and completion rings.
+		return xsk_socket__create_shared(&xsk_info->xsk, iface->if_name,
+		                                 iface->if_queue, umem->umem,
+		                                 &xsk_info->rx, &xsk_info->tx,
+		                                 &umem->fq, &umem->cq, sock_conf);
+	} else {
+		return xsk_socket__create(&xsk_info->xsk, iface->if_name,
+		                          iface->if_queue, umem->umem,
+		                          &xsk_info->rx, &xsk_info->tx, sock_conf);
+	}
+}
+
 static int configure_xsk_socket(struct kxsk_umem *umem,
                                 const struct kxsk_iface *iface,
+                                const knot_xdp_socket_t *owner,
                                 knot_xdp_socket_t **out_sock,
                                 const knot_xdp_config_t *config)
 {
@@ -180,16 +283,35 @@ static int configure_xsk_socket(struct kxsk_umem *umem,
 		bind_flags |= XDP_COPY;
 	}
 
-	const struct xsk_socket_config sock_conf = {
+	struct xsk_socket_config sock_conf = {
 		.tx_size = umem->ring_size,
 		.rx_size = umem->ring_size,
 		.libbpf_flags = XSK_LIBBPF_FLAGS__INHIBIT_PROG_LOAD,
 		.bind_flags = bind_flags,
 	};
 
-	int ret = xsk_socket__create(&xsk_info->xsk, iface->if_name,
-	                             iface->if_queue, umem->umem,
-	                             &xsk_info->rx, &xsk_info->tx, &sock_conf);
+	int ret = -ENOTSUP;
+	if (owner != NULL) { // The bind flags are inherited from the UMEM owner.
+		ret = create_xsk_socket(xsk_info, true, &sock_conf);
+		xsk_info->multi_buffer = owner->multi_buffer;
+	}
+#ifdef XDP_USE_SG
+	if (owner == NULL && umem->mb_count > 0) {
+		sock_conf.bind_flags |= XDP_USE_SG;
+		ret = create_xsk_socket(xsk_info, false, &sock_conf);
+		xsk_info->multi_buffer = (ret == 0);
+		sock_conf.bind_flags = bind_flags;
+	}
+#endif
+	if (owner == NULL && ret != 0) { // Not supported by the driver, fall back to single buffers.
+		ret = create_xsk_socket(xsk_info, false, &sock_conf);
+	}
+	if (ret == 0) {
+		ret = fill_xsk_fq(umem);
+		if (ret != KNOT_EOK) {
+			xsk_socket__delete(xsk_info->xsk);
+		}
+	}
 	if (ret != 0) {
 		free(xsk_info);
 		return ret;
@@ -210,6 +332,25 @@ static int configure_xsk_socket(struct kxsk_umem *umem,
 	return KNOT_EOK;
 }
 
+static int init_xsk(struct kxsk_umem **umem, const struct kxsk_iface *iface,
+                    const knot_xdp_socket_t *owner, uint16_t parts,
+                    knot_xdp_socket_t **out_sock, const knot_xdp_config_t *config,
+                    bool multi_buffer)
+{
+	int ret = configure_xsk_umem(umem, ring_size(config), multi_buffer, parts,
+	                             owner != NULL ? owner->umem : NULL);
+	if (ret != KNOT_EOK) {
+		return ret;
+	}
+
+	ret = configure_xsk_socket(*umem, iface, owner, out_sock, config);
+	if (ret != KNOT_EOK) {
+		deconfigure_xsk_umem(*umem);
+	}
+
+	return ret;
+}
+
 _public_
 int knot_xdp_init(knot_xdp_socket_t **socket, const char *if_name, int if_queue,
                   knot_xdp_filter_flag_t flags, uint16_t udp_port, uint16_t quic_port,
@@ -217,33 +358,45 @@ int knot_xdp_init(knot_xdp_socket_t **socket, const char *if_name, int if_queue,
 {
 	if (socket == NULL || if_name == NULL || !valid_config(xdp_config) ||
 	    (udp_port == quic_port && (flags & KNOT_XDP_FILTER_UDP) && (flags & KNOT_XDP_FILTER_QUIC)) ||
-	    (flags & (KNOT_XDP_FILTER_UDP | KNOT_XDP_FILTER_TCP | KNOT_XDP_FILTER_QUIC)) == 0) {
+	    (flags & (KNOT_XDP_FILTER_UDP | KNOT_XDP_FILTER_TCP | KNOT_XDP_FILTER_QUIC)) == 0 ||
+	    ((flags & KNOT_XDP_FILTER_RRL) && xdp_config == NULL)) {
 		return KNOT_EINVAL;
 	}
 
 	struct kxsk_iface *iface;
 	const bool generic_xdp = (xdp_config != NULL && xdp_config->force_generic);
-	int ret = kxsk_iface_new(if_name, if_queue, load_bpf, generic_xdp, &iface);
+#ifdef XDP_USE_SG
+	const bool multi_buffer = (xdp_config != NULL && xdp_config->multi_buffer);
+#else
+	const bool multi_buffer = false;
+#endif
+	int ret = kxsk_iface_new(if_name, if_queue, load_bpf, generic_xdp,
+	                         multi_buffer, &iface);
 	if (ret != KNOT_EOK) {
 		return ret;
 	}
 
-	/* Initialize shared packet_buffer for umem usage. */
+	/* Use a part of a shared UMEM if possible, otherwise a private one. */
 	struct kxsk_umem *umem = NULL;
-	ret = configure_xsk_umem(&umem, ring_size(xdp_config));
-	if (ret != KNOT_EOK) {
-		kxsk_iface_free(iface);
-		return ret;
+	const knot_xdp_socket_t *owner = (xdp_config != NULL) ? xdp_config->shared_umem : NULL;
+	if (owner != NULL && owner->send_mock == NULL) {
+		ret = init_xsk(&umem, iface, owner, 0, socket, xdp_config,
+		               multi_buffer && iface->frags);
+	} else {
+		owner = NULL;
+	}
+	if (owner == NULL || ret != KNOT_EOK) {
+		uint16_t parts = (owner == NULL && xdp_config != NULL) ?
+		                 xdp_config->shared_umem_count : 1;
+		ret = init_xsk(&umem, iface, NULL, parts, socket, xdp_config,
+		               multi_buffer && iface->frags);
 	}
-
-	ret = configure_xsk_socket(umem, iface, socket, xdp_config);
 	if (ret != KNOT_EOK) {
-		deconfigure_xsk_umem(umem);
 		kxsk_iface_free(iface);
 		return ret;
 	}
 
-	(*socket)->frame_limit = FRAME_SIZE;
+	(*socket)->frame_limit = (*socket)->multi_buffer ? MB_SIZE : FRAME_SIZE;
 	ret = knot_eth_mtu(if_name);
 	if (ret > 0) {
 		(*socket)->frame_limit = MIN((unsigned)ret, (*socket)->frame_limit);
@@ -261,7 +414,20 @@ int knot_xdp_init(knot_xdp_socket_t **socket, const char *if_name, int if_queue,
 		}
 	}
 
-	ret = kxsk_socket_start(iface, flags, udp_port, quic_port, (*socket)->xsk);
+	ret = KNOT_EOK;
+	if (flags & KNOT_XDP_FILTER_RRL) {
+		ret = kxsk_iface_rrl(iface, xdp_config->rrl_instant_limit,
+		                     xdp_config->rrl_rate_limit);
+		if (ret == KNOT_ENOTSUP) {
+			// The loaded program has no rate limiting, continue without it.
+			flags &= ~KNOT_XDP_FILTER_RRL;
+			ret = KNOT_EOK;
+		}
+		(*socket)->rrl = (flags & KNOT_XDP_FILTER_RRL);
+	}
+	if (ret == KNOT_EOK) {
+		ret = kxsk_socket_start(iface, flags, udp_port, quic_port, (*socket)->xsk);
+	}
 	if (ret != KNOT_EOK) {
 		free((*socket)->vlan_map);
 		xsk_socket__delete((*socket)->xsk);
@@ -292,6 +458,7 @@ void knot_xdp_deinit(knot_xdp_socket_t *socket)
 
 	kxsk_iface_free((struct kxsk_iface *)/*const-cast*/socket->iface);
 	free(socket->vlan_map);
+	free(socket->rx_mb);
 	free(socket);
 }
 
@@ -305,11 +472,27 @@ int knot_xdp_socket_fd(knot_xdp_socket_t *socket)
 	return xsk_socket__fd(socket->xsk);
 }
 
+_public_
+bool knot_xdp_socket_rrl(const knot_xdp_socket_t *socket)
+{
+	return socket != NULL && socket->rrl;
+}
+
 static void tx_free_relative(struct kxsk_umem *umem, uint64_t addr_relative)
 {
 	/* The address may not point to *start* of buffer, but `/` solves that. */
-	uint64_t index = addr_relative / FRAME_SIZE;
+	uint64_t index = addr_relative / FRAME_SIZE - umem->frame_base;
+	if (index >= MB_BASE(umem)) {
+		/* The block is free once all its descriptors are completed. */
+		uint64_t block = (index - MB_BASE(umem)) / MB_FRAMES;
+		assert(block < umem->mb_count && umem->mb_busy[block] > 0);
+		if (--umem->mb_busy[block] == 0) {
+			umem->mb_free_indices[umem->mb_free_count++] = block;
+		}
+		return;
+	}
 	assert(index < umem->ring_size);
+	assert(umem->tx_free_count < umem->ring_size);
 	umem->tx_free_indices[umem->tx_free_count++] = index;
 }
 
@@ -328,7 +511,6 @@ void knot_xdp_send_prepare(knot_xdp_socket_t *socket)
 	if (completed == 0) {
 		return;
 	}
-	assert(umem->tx_free_count + completed <= umem->ring_size);
 
 	for (uint32_t i = 0; i < completed; ++i) {
 		uint64_t addr_relative = *xsk_ring_cons__comp_addr(cq, idx++);
@@ -357,22 +539,44 @@ static struct umem_frame *alloc_tx_frame(knot_xdp_socket_t *socket)
 	}
 
 	uint32_t index = umem->tx_free_indices[--umem->tx_free_count];
-	return umem->frames + index;
+	return umem->frames + umem->frame_base + index;
 }
 
-static void prepare_payload(knot_xdp_msg_t *msg, void *uframe)
+static uint8_t *alloc_tx_block(knot_xdp_socket_t *socket)
+{
+	if (!socket->multi_buffer) {
+		return NULL;
+	}
+
+	struct kxsk_umem *umem = socket->umem;
+
+	if (umem->mb_free_count == 0) {
+		knot_xdp_send_prepare(socket);
+		if (umem->mb_free_count == 0) { // Don't wait, a single frame is used instead.
+			return NULL;
+		}
+	}
+
+	uint16_t block = umem->mb_free_indices[--umem->mb_free_count];
+	umem->mb_busy[block] = 1; // Updated to the number of descriptors when sent.
+	return umem->frames[umem->frame_base + MB_BASE(umem) + block * MB_FRAMES].bytes;
+}
+
+static void prepare_payload(knot_xdp_msg_t *msg, void *uframe, size_t size)
 {
 	size_t hdr_len = prot_write_hdrs_len(msg);
 	msg->payload.iov_base = uframe + hdr_len + KNOT_XDP_PKT_ALIGNMENT;
-	msg->payload.iov_len = FRAME_SIZE - hdr_len - KNOT_XDP_PKT_ALIGNMENT;
+	msg->payload.iov_len = size - hdr_len - KNOT_XDP_PKT_ALIGNMENT;
 }
 
-_public_
-int knot_xdp_send_alloc(knot_xdp_socket_t *socket, knot_xdp_msg_flag_t flags,
-                        knot_xdp_msg_t *out)
+static int alloc_payload(knot_xdp_socket_t *socket, knot_xdp_msg_t *msg,
+                         bool multi_buffer)
 {
-	if (socket == NULL || out == NULL) {
-		return KNOT_EINVAL;
+	uint8_t *block = multi_buffer ? alloc_tx_block(socket) : NULL;
+	if (block != NULL) {
+		msg->flags |= KNOT_XDP_MSG_MB;
+		prepare_payload(msg, block, socket->frame_limit);
+		return KNOT_EOK;
 	}
 
 	struct umem_frame *uframe = alloc_tx_frame(socket);
@@ -380,12 +584,25 @@ int knot_xdp_send_alloc(knot_xdp_socket_t *socket, knot_xdp_msg_flag_t flags,
 		return KNOT_ENOMEM;
 	}
 
-	msg_init(out, flags);
-	prepare_payload(out, uframe);
+	msg->flags &= ~KNOT_XDP_MSG_MB;
+	prepare_payload(msg, uframe, FRAME_SIZE);
 
 	return KNOT_EOK;
 }
 
+_public_
+int knot_xdp_send_alloc(knot_xdp_socket_t *socket, knot_xdp_msg_flag_t flags,
+                        knot_xdp_msg_t *out)
+{
+	if (socket == NULL || out == NULL) {
+		return KNOT_EINVAL;
+	}
+
+	msg_init(out, flags);
+
+	return alloc_payload(socket, out, flags & KNOT_XDP_MSG_MB);
+}
+
 _public_
 int knot_xdp_reply_alloc(knot_xdp_socket_t *socket, const knot_xdp_msg_t *query,
                          knot_xdp_msg_t *out)
@@ -394,15 +611,9 @@ int knot_xdp_reply_alloc(knot_xdp_socket_t *socket, const knot_xdp_msg_t *query,
 		return KNOT_EINVAL;
 	}
 
-	struct umem_frame *uframe = alloc_tx_frame(socket);
-	if (uframe == NULL) {
-		return KNOT_ENOMEM;
-	}
-
 	msg_init_reply(out, query);
-	prepare_payload(out, uframe);
 
-	return KNOT_EOK;
+	return alloc_payload(socket, out, query->flags & KNOT_XDP_MSG_MB);
 }
 
 static void free_unsent(knot_xdp_socket_t *socket, const knot_xdp_msg_t *msg)
@@ -416,6 +627,19 @@ static void free_unsent(knot_xdp_socket_t *socket, const knot_xdp_msg_t *msg)
 	tx_free_relative(socket->umem, addr_relative);
 }
 
+static uint32_t msg_descs(const knot_xdp_msg_t *msg)
+{
+	if (empty_msg(msg)) {
+		return 0;
+	} else if (!(msg->flags & KNOT_XDP_MSG_MB)) {
+		return 1;
+	}
+
+	/* The packet starts at the alignment offset of the block. */
+	size_t size = KNOT_XDP_PKT_ALIGNMENT + prot_write_hdrs_len(msg) + msg->payload.iov_len;
+	return (size + FRAME_SIZE - 1) / FRAME_SIZE;
+}
+
 _public_
 int knot_xdp_send(knot_xdp_socket_t *socket, const knot_xdp_msg_t msgs[],
                   uint32_t count, uint32_t *sent)
@@ -429,14 +653,24 @@ int knot_xdp_send(knot_xdp_socket_t *socket, const knot_xdp_msg_t msgs[],
 		return ret;
 	}
 
+	/* Multi-buffer packets need a descriptor per frame. */
+	uint32_t descs = count;
+	if (socket->multi_buffer) {
+		descs = 0;
+		for (uint32_t i = 0; i < count; ++i) {
+			descs += msg_descs(&msgs[i]);
+		}
+		assert(descs <= socket->umem->ring_size);
+	}
+
 	/* Now we want to do something close to
-	 *   xsk_ring_prod__reserve(&socket->tx, count, *idx)
-	 * but we don't know in advance if we utilize *whole* `count`,
+	 *   xsk_ring_prod__reserve(&socket->tx, descs, *idx)
+	 * but we don't know in advance if we utilize *whole* `descs`,
 	 * and the API doesn't allow "cancelling reservations".
 	 * Therefore we handle `socket->tx.cached_prod` by hand.
 	 */
 	const struct timespec delay = { .tv_nsec = RETRY_DELAY };
-	while (unlikely(xsk_prod_nb_free(&socket->tx, count) < count)) {
+	while (unlikely(xsk_prod_nb_free(&socket->tx, descs) < descs)) {
 		if (socket->busy_poll || xsk_ring_prod__needs_wakeup(&socket->tx)) {
 			(void)sendto(xsk_socket__fd(socket->xsk), NULL, 0,
 			             MSG_DONTWAIT, NULL, 0);
@@ -445,6 +679,7 @@ int knot_xdp_send(knot_xdp_socket_t *socket, const knot_xdp_msg_t msgs[],
 	}
 	uint32_t idx = socket->tx.cached_prod;
 
+	*sent = 0;
 	for (uint32_t i = 0; i < count; ++i) {
 		const knot_xdp_msg_t *msg = &msgs[i];
 
@@ -457,17 +692,39 @@ int knot_xdp_send(knot_xdp_socket_t *socket, const knot_xdp_msg_t msgs[],
 			uint16_t mss = MIN(socket->frame_limit - hdr_len, KNOT_TCP_MSS);
 			prot_write_eth(msg_beg, msg, msg_beg + tot_len, mss);
 
+			uint64_t addr = msg_beg - socket->umem->frames->bytes;
+#ifdef XDP_USE_SG
+			if (msg->flags & KNOT_XDP_MSG_MB) {
+				/* Split the packet at the frame boundaries. */
+				struct kxsk_umem *umem = socket->umem;
+				uint64_t frame = addr / FRAME_SIZE - umem->frame_base;
+				uint64_t block = (frame - MB_BASE(umem)) / MB_FRAMES;
+				umem->mb_busy[block] = 1;
+				while (tot_len > FRAME_SIZE - addr % FRAME_SIZE) {
+					size_t len = FRAME_SIZE - addr % FRAME_SIZE;
+					*xsk_ring_prod__tx_desc(&socket->tx, idx++) = (struct xdp_desc) {
+						.addr = addr,
+						.len = len,
+						.options = XDP_PKT_CONTD,
+					};
+					addr += len;
+					tot_len -= len;
+					umem->mb_busy[block]++;
+				}
+			}
+#endif
 			*xsk_ring_prod__tx_desc(&socket->tx, idx++) = (struct xdp_desc) {
-				.addr = msg_beg - socket->umem->frames->bytes,
+				.addr = addr,
 				.len = tot_len,
 			};
+			(*sent)++;
 		}
 	}
 
-	*sent = idx - socket->tx.cached_prod;
-	assert(*sent <= count);
+	descs = idx - socket->tx.cached_prod;
+	assert(*sent <= count && *sent <= descs);
 	socket->tx.cached_prod = idx;
-	xsk_ring_prod__submit(&socket->tx, *sent);
+	xsk_ring_prod__submit(&socket->tx, descs);
 
 	return KNOT_EOK;
 }
@@ -503,6 +760,95 @@ int knot_xdp_send_finish(knot_xdp_socket_t *socket)
 	}
 }
 
+static uint32_t fq_reserve(knot_xdp_socket_t *socket, uint32_t count)
+{
+	struct xsk_ring_prod *const fq = &socket->umem->fq;
+
+	uint32_t idx = 0;
+	const struct timespec delay = { .tv_nsec = RETRY_DELAY };
+	while (unlikely(xsk_ring_prod__reserve(fq, count, &idx) != count)) {
+		if (socket->busy_poll || xsk_ring_prod__needs_wakeup(fq)) {
+			(void)recvfrom(xsk_socket__fd(socket->xsk), NULL, 0,
+			               MSG_DONTWAIT, NULL, NULL);
+		}
+		nanosleep(&delay, NULL);
+	}
+
+	return idx;
+}
+
+static void rx_recycle(knot_xdp_socket_t *socket, uint32_t rx_idx, uint32_t count)
+{
+	/* Pass the frames of the RX descriptors directly back to the driver. */
+	struct xsk_ring_prod *const fq = &socket->umem->fq;
+	uint32_t idx = fq_reserve(socket, count);
+	for (uint32_t i = 0; i < count; ++i) {
+		uint64_t addr = xsk_ring_cons__rx_desc(&socket->rx, rx_idx + i)->addr;
+		*xsk_ring_prod__fill_addr(fq, idx++) = addr - addr % FRAME_SIZE;
+	}
+	xsk_ring_prod__submit(fq, count);
+}
+
+static bool rx_parse(knot_xdp_socket_t *socket, knot_xdp_msg_t *msg,
+                     uint8_t *data, uint32_t len)
+{
+	void *payl_end;
+	void *payl_start = prot_read_eth(data, msg, &payl_end,
+	                                 socket->vlan_map, socket->vlan_map_max);
+
+	/* Multi-buffer packets aren't checked for truncation by the BPF filter. */
+	if (payl_start > payl_end || payl_end > (void *)data + len) {
+		return false;
+	}
+
+	msg->payload.iov_base = payl_start;
+	msg->payload.iov_len = payl_end - payl_start;
+	msg->mss = MIN(msg->mss, FRAME_SIZE - (payl_start - (void *)data));
+
+	return true;
+}
+
+#ifdef XDP_USE_SG
+/*!
+ * \brief Copy a multi-buffer packet into a linear buffer (if not NULL).
+ *
+ * \return The number of descriptors of the packet, 0 if incomplete.
+ */
+static uint32_t rx_linearize(knot_xdp_socket_t *socket, uint32_t rx_idx,
+                             uint32_t available, uint8_t *buf, uint32_t *len)
+{
+	const struct xdp_desc *desc;
+	uint32_t descs = 0;
+	*len = 0;
+
+	do {
+		if (descs == available) {
+			return 0;
+		}
+		desc = xsk_ring_cons__rx_desc(&socket->rx, rx_idx + descs);
+		uint8_t *data = socket->umem->frames->bytes + desc->addr;
+
+		if (buf != NULL && *len + desc->len <= MB_SIZE - RX_MB_HEADROOM) {
+			if (descs == 0) { // Including the metadata in front of the packet.
+				memcpy(buf, data - RX_MB_HEADROOM, RX_MB_HEADROOM);
+			}
+			memcpy(buf + RX_MB_HEADROOM + *len, data, desc->len);
+		}
+		*len += desc->len;
+		descs++;
+	} while (desc->options & XDP_PKT_CONTD);
+
+	return descs;
+}
+#endif
+
+static bool rx_linear(const knot_xdp_socket_t *socket, const knot_xdp_msg_t *msg)
+{
+	const uint8_t *payload = msg->payload.iov_base;
+	return payload >= socket->rx_mb &&
+	       payload < socket->rx_mb + (size_t)socket->rx_mb_count * MB_SIZE;
+}
+
 _public_
 int knot_xdp_recv(knot_xdp_socket_t *socket, knot_xdp_msg_t msgs[],
                   uint32_t max_count, uint32_t *count, size_t *wire_size)
@@ -519,26 +865,70 @@ int knot_xdp_recv(knot_xdp_socket_t *socket, knot_xdp_msg_t msgs[],
 	}
 	assert(available <= max_count);
 
-	for (uint32_t i = 0; i < available; ++i) {
-		knot_xdp_msg_t *msg = &msgs[i];
-		const struct xdp_desc *desc = xsk_ring_cons__rx_desc(&socket->rx, idx++);
-		uint8_t *uframe_p = (uint8_t *)socket->umem->frames + desc->addr;
-
-		void *payl_end;
-		void *payl_start = prot_read_eth(uframe_p, msg, &payl_end,
-		                                 socket->vlan_map, socket->vlan_map_max);
+	/* The linear buffers are reused after knot_xdp_recv_finish(). */
+	if (socket->multi_buffer && socket->rx_mb_count < max_count) {
+		free(socket->rx_mb);
+		socket->rx_mb = malloc((size_t)max_count * MB_SIZE);
+		socket->rx_mb_count = (socket->rx_mb != NULL) ? max_count : 0;
+	}
 
-		msg->payload.iov_base = payl_start;
-		msg->payload.iov_len = payl_end - payl_start;
-		msg->mss = MIN(msg->mss, FRAME_SIZE - (payl_start - (void *)uframe_p));
+	uint32_t used = 0, received = 0;
+	while (used < available) {
+		knot_xdp_msg_t *msg = &msgs[received];
+		const struct xdp_desc *desc = xsk_ring_cons__rx_desc(&socket->rx, idx + used);
+#ifdef XDP_USE_SG
+		if (unlikely(socket->rx_mb_drop || (desc->options & XDP_PKT_CONTD))) {
+			uint8_t *buf = NULL;
+			if (!socket->rx_mb_drop && socket->rx_mb != NULL) {
+				buf = socket->rx_mb + (size_t)received * MB_SIZE;
+			}
+
+			uint32_t len;
+			uint32_t descs = rx_linearize(socket, idx + used, available - used,
+			                              buf, &len);
+			if (descs == 0) {
+				if (used > 0 && !socket->rx_mb_drop) {
+					break; // Receive the whole packet next time.
+				}
+				/* Too many buffers to be received at once. */
+				rx_recycle(socket, idx + used, available - used);
+				socket->rx_mb_drop = true;
+				used = available;
+				break;
+			}
+
+			if (buf != NULL && len <= MB_SIZE - RX_MB_HEADROOM &&
+			    rx_parse(socket, msg, buf + RX_MB_HEADROOM, len)) {
+				msg->flags |= KNOT_XDP_MSG_MB;
+				received++;
+			}
+			rx_recycle(socket, idx + used, descs);
+			socket->rx_mb_drop = false;
+			used += descs;
+
+			if (wire_size != NULL) {
+				(*wire_size) += len;
+			}
+			continue;
+		}
+#endif
+		uint8_t *uframe_p = socket->umem->frames->bytes + desc->addr;
+		if (rx_parse(socket, msg, uframe_p, desc->len)) {
+			received++;
+		} else {
+			rx_recycle(socket, idx + used, 1);
+		}
+		used++;
 
 		if (wire_size != NULL) {
 			(*wire_size) += desc->len;
 		}
 	}
 
-	xsk_ring_cons__release(&socket->rx, available);
-	*count = available;
+	/* Keep the unprocessed descriptors in the ring. */
+	socket->rx.cached_cons -= available - used;
+	xsk_ring_cons__release(&socket->rx, used);
+	*count = received;
 
 	return KNOT_EOK;
 }
@@ -556,26 +946,29 @@ void knot_xdp_recv_finish(knot_xdp_socket_t *socket, const knot_xdp_msg_t msgs[]
 		return;
 	}
 
+	/* Frames of multi-buffer packets have already been returned. */
+	uint32_t frames = count;
+	if (unlikely(socket->rx_mb != NULL)) {
+		for (uint32_t i = 0; i < count; ++i) {
+			frames -= rx_linear(socket, &msgs[i]);
+		}
+	}
+
 	struct kxsk_umem *const umem = socket->umem;
 	struct xsk_ring_prod *const fq = &umem->fq;
 
-	uint32_t idx = 0;
-	const struct timespec delay = { .tv_nsec = RETRY_DELAY };
-	while (unlikely(xsk_ring_prod__reserve(fq, count, &idx) != count)) {
-		if (socket->busy_poll || xsk_ring_prod__needs_wakeup(fq)) {
-			(void)recvfrom(xsk_socket__fd(socket->xsk), NULL, 0,
-			               MSG_DONTWAIT, NULL, NULL);
-		}
-		nanosleep(&delay, NULL);
-	}
+	uint32_t idx = fq_reserve(socket, frames);
 
 	for (uint32_t i = 0; i < count; ++i) {
+		if (unlikely(socket->rx_mb != NULL) && rx_linear(socket, &msgs[i])) {
+			continue;
+		}
 		uint8_t *uframe_p = msg_uframe_ptr(&msgs[i]);
 		uint64_t offset = uframe_p - umem->frames->bytes;
 		*xsk_ring_prod__fill_addr(fq, idx++) = offset;
 	}
 
-	xsk_ring_prod__submit(fq, count);
+	xsk_ring_prod__submit(fq, frames);
 	// recvfrom() here slightly worsens the performance, poll is called later anyway.
 }
 
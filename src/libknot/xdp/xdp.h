@@ -58,6 +58,11 @@ struct knot_xdp_config {
 	bool force_copy;     /*!< Force copying packet data between kernel and user-space (avoid zero-copy). */
 	unsigned busy_poll_timeout; /*!< Preferred busy poll budget (0 means disabled). */
 	unsigned busy_poll_budget;  /*!< Preferred busy poll timeout (in microseconds) . */
+	bool multi_buffer;   /*!< Enable multi-buffer packets (jumbo frames) if supported. */
+	uint16_t shared_umem_count;      /*!< Reserve UMEM for this number of sockets of the interface. */
+	knot_xdp_socket_t *shared_umem;  /*!< Use UMEM reserved by this socket (XDP_SHARED_UMEM). */
+	uint32_t rrl_instant_limit; /*!< Queries from an address allowed at once (with KNOT_XDP_FILTER_RRL). */
+	uint32_t rrl_rate_limit;    /*!< Queries from an address allowed per second (with KNOT_XDP_FILTER_RRL). */
 };
 
 /*! \brief Configuration of XDP socket. */
@@ -113,6 +118,11 @@ typedef struct {
  * \param load_bpf     Insert BPF program into packet processing.
  * \param xdp_config   Optional XDP socket configuration.
  *
+ * \note If \a xdp_config sets shared_umem, the socket uses a part of the UMEM
+ *       reserved by the given socket (of the same interface) for
+ *       shared_umem_count sockets, or a private UMEM if not possible.
+ *       The sharing sockets must be created and freed by one thread.
+ *
  * \return KNOT_E* or -errno
  */
 int knot_xdp_init(knot_xdp_socket_t **socket, const char *if_name, int if_queue,
@@ -135,6 +145,16 @@ void knot_xdp_deinit(knot_xdp_socket_t *socket);
  */
 int knot_xdp_socket_fd(knot_xdp_socket_t *socket);
 
+/*!
+ * \brief Check if the rate limiting in the BPF program is active.
+ *
+ * \note It's inactive if not requested by KNOT_XDP_FILTER_RRL or if the loaded
+ *       BPF program doesn't support it.
+ *
+ * \param socket  XDP socket.
+ */
+bool knot_xdp_socket_rrl(const knot_xdp_socket_t *socket);
+
 /*!
  * \brief Collect completed TX buffers, so they can be used by knot_xdp_send_alloc().
  *
@@ -145,6 +165,10 @@ void knot_xdp_send_prepare(knot_xdp_socket_t *socket);
 /*!
  * \brief Allocate one buffer for an outgoing packet.
  *
+ * \note If KNOT_XDP_MSG_MB is set in \a flags and the socket supports
+ *       multi-buffer packets, a buffer of up to the interface MTU is allocated.
+ *       The flag is cleared in \a out if only a normal buffer is available.
+ *
  * \param socket       XDP socket.
  * \param flags        Flags for new message.
  * \param out          Out: the allocated packet buffer.
@@ -157,6 +181,9 @@ int knot_xdp_send_alloc(knot_xdp_socket_t *socket, knot_xdp_msg_flag_t flags,
 /*!
  * \brief Allocate one buffer for a reply packet.
  *
+ * \note A multi-buffer reply is allocated if KNOT_XDP_MSG_MB is set in the query
+ *       flags (see knot_xdp_send_alloc()).
+ *
  * \param socket       XDP socket.
  * \param query        The packet to be replied to.
  * \param out          Out: the allocated packet buffer.
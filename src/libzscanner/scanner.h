@@ -90,6 +90,13 @@ typedef enum {
 	ZS_STATE_STOP      /*!< Early stop (possibly set from a callback). */
 } zs_state_t;
 
+/*! \brief Zone file input modes. */
+typedef enum {
+	ZS_INPUT_MMAP,     /*!< Mapped file kept resident until the end (default). */
+	ZS_INPUT_STREAM,   /*!< Mapped file read ahead and released by windows. */
+	ZS_INPUT_READ      /*!< File copied to (huge page backed) anonymous memory. */
+} zs_input_mode_t;
+
 /*!
  * \brief Context structure for zone scanner.
  *
@@ -214,6 +221,8 @@ struct zs_scanner {
 		bool eof;
 		/*! Indication of being mmap()-ed (malloc()-ed otherwise). */
 		bool mmaped;
+		/*! File input mode. */
+		zs_input_mode_t mode;
 	} input;
 
 	/*! File input parameters. */
@@ -333,6 +342,28 @@ int zs_set_input_file(
 	const char *file_name
 );
 
+/*!
+ * \brief Sets the zone file input mode.
+ *
+ * The streaming modes parse the file by windows, reading ahead the next one and
+ * releasing the parsed ones, so that a huge file doesn't stay resident. The
+ * release applies only to zs_parse_all() processing.
+ *
+ * \note If called after zs_set_input_file(), the mapped file is converted.
+ *       If the memory for ZS_INPUT_READ can't be allocated, ZS_INPUT_STREAM is
+ *       used instead.
+ *
+ * \param scanner  Scanner context.
+ * \param mode     Input mode.
+ *
+ * \retval  0  if success.
+ * \retval -1  if error.
+ */
+int zs_set_input_mode(
+	zs_scanner_t *scanner,
+	zs_input_mode_t mode
+);
+
 /*!
  * \brief Sets the scanner processing callbacks for automatic processing.
  *
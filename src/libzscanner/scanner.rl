@@ -46,6 +46,11 @@
 /*! \brief Zero level altitude value. */
 #define LOC_ALT_ZERO	(uint32_t)10000000
 
+/*! \brief Input window size for the streaming input modes. */
+#define INPUT_WINDOW		(4 * 1024 * 1024)
+/*! \brief Allocation granularity of the read input (typical huge page size). */
+#define INPUT_HUGE_PAGE		(2 * 1024 * 1024)
+
 /*! \brief Shorthand for setting warning data. */
 #define WARN(err_code) { s->error.code = err_code; }
 /*! \brief Shorthand for setting error data. */
@@ -158,6 +163,13 @@ int zs_init(
 	return 0;
 }
 
+static size_t align_up(
+	size_t size,
+	size_t align)
+{
+	return (size + align - 1) / align * align;
+}
+
 static void input_deinit(
 	zs_scanner_t *s,
 	bool keep_filename)
@@ -167,8 +179,11 @@ static void input_deinit(
 		// Unmap the file content.
 		if (s->input.start != NULL) {
 			if (s->input.mmaped) {
-				munmap((void *)s->input.start,
-				       s->input.end - s->input.start);
+				size_t size = s->input.end - s->input.start;
+				if (s->input.mode == ZS_INPUT_READ) {
+					size = align_up(size, INPUT_HUGE_PAGE);
+				}
+				munmap((void *)s->input.start, size);
 			} else {
 				free((void *)s->input.start);
 			}
@@ -268,6 +283,109 @@ int zs_set_input_string(
 	return set_input_string(s, input, size, false);
 }
 
+/*!
+ * \brief Drops the parsed part of the mapped input from memory and page cache.
+ */
+static void input_release(
+	zs_scanner_t *s,
+	const char *from,
+	const char *to)
+{
+	size_t page = sysconf(_SC_PAGESIZE);
+	size_t offset = from - s->input.start;
+	size_t len = (to - from) / page * page;
+	if (len == 0) {
+		return;
+	}
+
+#ifdef MADV_DONTNEED
+	(void)madvise((void *)from, len, MADV_DONTNEED);
+#endif
+#ifdef POSIX_FADV_DONTNEED
+	if (s->input.mode != ZS_INPUT_READ) {
+		(void)posix_fadvise(s->file.descriptor, offset, len, POSIX_FADV_DONTNEED);
+	}
+#else
+	(void)offset;
+#endif
+}
+
+/*!
+ * \brief Copies the mapped file into anonymous memory, possibly backed by huge
+ *        pages, dropping the file from page cache.
+ */
+static int input_read(
+	zs_scanner_t *s)
+{
+	size_t size = s->input.end - s->input.start;
+	size_t alloc = align_up(size, INPUT_HUGE_PAGE);
+
+	char *buf = mmap(NULL, alloc, PROT_READ | PROT_WRITE,
+	                 MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+	if (buf == MAP_FAILED) {
+		return -1;
+	}
+#ifdef MADV_HUGEPAGE
+	(void)madvise(buf, alloc, MADV_HUGEPAGE);
+#endif
+
+	for (size_t off = 0; off < size; off += INPUT_WINDOW) {
+		size_t len = (size - off < INPUT_WINDOW) ? size - off : INPUT_WINDOW;
+		memcpy(buf + off, s->input.start + off, len);
+#ifdef POSIX_FADV_DONTNEED
+		(void)posix_fadvise(s->file.descriptor, off, len, POSIX_FADV_DONTNEED);
+#endif
+	}
+
+	munmap((void *)s->input.start, size);
+	s->input.current = buf + (s->input.current - s->input.start);
+	s->input.start   = buf;
+	s->input.end     = buf + size;
+
+	return 0;
+}
+
+__attribute__((visibility("default")))
+int zs_set_input_mode(
+	zs_scanner_t *s,
+	zs_input_mode_t mode)
+{
+	if (s == NULL) {
+		return -1;
+	}
+
+	if (mode == s->input.mode) {
+		return 0;
+	}
+
+	// Only a mapped file input is affected.
+	bool mapped = s->file.descriptor != -1 && s->input.mmaped &&
+	              s->input.start != NULL;
+
+	switch (mode) {
+	case ZS_INPUT_MMAP:
+	case ZS_INPUT_STREAM:
+		// The copied input can't be turned back into a mapping.
+		if (mapped && s->input.mode == ZS_INPUT_READ) {
+			ERR(ZS_EINVAL);
+			return -1;
+		}
+		break;
+	case ZS_INPUT_READ:
+		if (mapped && input_read(s) != 0) {
+			mode = ZS_INPUT_STREAM;
+		}
+		break;
+	default:
+		ERR(ZS_EINVAL);
+		return -1;
+	}
+
+	s->input.mode = mode;
+
+	return 0;
+}
+
 __attribute__((visibility("default")))
 int zs_set_input_file(
 	zs_scanner_t *s,
@@ -326,6 +444,9 @@ int zs_set_input_file(
 
 		size = file_stat.st_size;
 		s->input.mmaped = true;
+		s->input.start = start;
+		s->input.current = start;
+		s->input.end = start + size;
 
 		// Try to set the mapped memory advise to sequential.
 #if defined(MADV_SEQUENTIAL) && !defined(__sun)
@@ -335,6 +456,11 @@ int zs_set_input_file(
 		(void)posix_madvise(start, size, POSIX_MADV_SEQUENTIAL);
 #endif /* POSIX_MADV_SEQUENTIAL */
 #endif /* MADV_SEQUENTIAL && !__sun */
+
+		if (s->input.mode == ZS_INPUT_READ && input_read(s) != 0) {
+			s->input.mode = ZS_INPUT_STREAM;
+		}
+		start = (char *)s->input.start;
 	}
 
 	// Set the scanner input limits.
@@ -533,6 +659,56 @@ int zs_parse_record(
 	return 0;
 }
 
+/*!
+ * \brief Parses the mapped file input by windows, reading ahead the next window
+ *        and releasing the parsed ones.
+ */
+static void parse_windows(
+	zs_scanner_t *s,
+	wrap_t *wrap)
+{
+	const char *end = s->input.end;
+	const char *released = s->input.start;
+
+	while (true) {
+		// End the window after a newline, so it never ends inside a wrap.
+		const char *limit = end;
+		if (end - s->input.current > INPUT_WINDOW) {
+			const char *from = s->input.current + INPUT_WINDOW;
+			const char *nl = memchr(from, '\n', end - from);
+			if (nl != NULL) {
+				limit = nl + 1;
+			}
+		}
+
+#ifdef MADV_WILLNEED
+		if (limit < end) {
+			size_t page = sysconf(_SC_PAGESIZE);
+			const char *ahead = s->input.start +
+			                    (limit - s->input.start) / page * page;
+			size_t len = end - ahead;
+			(void)madvise((void *)ahead, len < INPUT_WINDOW ? len : INPUT_WINDOW,
+			              MADV_WILLNEED);
+		}
+#endif
+
+		s->input.end = limit;
+		parse(s, wrap);
+		if (limit == end) {
+			return;
+		}
+		s->input.end = end;
+		if (s->input.current != limit || s->state == ZS_STATE_STOP ||
+		    s->error.fatal) {
+			return;
+		}
+
+		input_release(s, released, s->input.current);
+		released += (s->input.current - released) / sysconf(_SC_PAGESIZE) *
+		            sysconf(_SC_PAGESIZE);
+	}
+}
+
 __attribute__((visibility("default")))
 int zs_parse_all(
 	zs_scanner_t *s)
@@ -545,7 +721,12 @@ int zs_parse_all(
 
 	// Parse input block.
 	wrap_t wrap = WRAP_NONE;
-	parse(s, &wrap);
+	if (s->input.mode != ZS_INPUT_MMAP && s->input.mmaped &&
+	    s->file.descriptor != -1 && s->input.start != NULL) {
+		parse_windows(s, &wrap);
+	} else {
+		parse(s, &wrap);
+	}
 
 	// Parse trailing newline-char block if it makes sense.
 	if (s->state != ZS_STATE_STOP && !s->error.fatal) {
@@ -826,6 +826,7 @@
 			// Parse included zone file.
 			if (zs_init(ss, (char *)s->buffer, s->default_class,
 			            s->default_ttl) != 0 ||
+			    zs_set_input_mode(ss, s->input.mode) != 0 ||
 			    zs_set_input_file(ss, (char *)(s->include_filename)) != 0 ||
 			    zs_set_processing(ss, s->process.record, s->process.error,
 			                      s->process.data) != 0 ||
@@ -970,7 +970,7 @@ jsonw_t *print_header_xfr_json(const knot_pkt_t *query,
 		return NULL;
 	}
 
-	jsonw_t *w = jsonw_new(stdout, JSON_INDENT);
+	jsonw_t *w = jsonw_new(stdout, style->json_lines ? "" : JSON_INDENT);
 	if (w == NULL) {
 		return NULL;
 	}
@@ -1117,7 +1117,7 @@ void print_packets_json(const knot_pkt_t *query,
 		return;
 	}
 
-	jsonw_t *w = jsonw_new(stdout, JSON_INDENT);
+	jsonw_t *w = jsonw_new(stdout, style->json_lines ? "" : JSON_INDENT);
 	if (w == NULL) {
 		return;
 	}
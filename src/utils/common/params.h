@@ -97,6 +97,8 @@ typedef struct {
 	bool	show_footer;
 	/*!< Display EDNS in Presentation format. */
 	bool	present_edns;
+	/*!< Print JSON output on a single line. */
+	bool	json_lines;
 
 	/*!< KHOST - Hide CNAME record in answer (duplicity reduction). */
 	bool	hide_cname;
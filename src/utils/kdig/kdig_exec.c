@@ -14,6 +14,7 @@
     along with this program.  If not, see <https://www.gnu.org/licenses/>.
  */
 
+#include <pthread.h>
 #include <stdlib.h>
 #include <netinet/in.h>
 #include <sys/socket.h>
@@ -26,6 +27,7 @@
 #include "utils/common/sign.h"
 #include "libknot/libknot.h"
 #include "contrib/json.h"
+#include "contrib/macros.h"
 #include "contrib/sockaddr.h"
 #include "contrib/time.h"
 #include "contrib/ucw/lists.h"
@@ -664,6 +666,9 @@ static int process_query_packet(const knot_pkt_t      *query,
 
 	// Print query packet if required.
 	if (style->show_query && style->format != FORMAT_JSON) {
+		// Keep the output of concurrent queries apart.
+		flockfile(stdout);
+
 		// Create copy of query packet for parsing.
 		knot_pkt_t *q = knot_pkt_new(query->wire, query->size, NULL);
 		if (q != NULL) {
@@ -680,6 +685,7 @@ static int process_query_packet(const knot_pkt_t      *query,
 		}
 
 		printf("\n");
+		funlockfile(stdout);
 	}
 
 	// Loop over incoming messages, unless reply id is correct or timeout.
@@ -751,6 +757,7 @@ static int process_query_packet(const knot_pkt_t      *query,
 	check_reply_qr(reply);
 
 	// Print reply packet.
+	flockfile(stdout);
 	if (style->format != FORMAT_JSON) {
 		// Intentionaly start-end because of QUIC can have receive time.
 		print_packet(reply, net, in_len, time_diff_ms(&t_start, &t_end),
@@ -761,6 +768,7 @@ static int process_query_packet(const knot_pkt_t      *query,
 		print_packets_json(q, reply, net, timestamp, style);
 		knot_pkt_free(q);
 	}
+	funlockfile(stdout);
 
 	// Verify signature if a key was specified.
 	if (sign_ctx->digest != NULL) {
@@ -815,6 +823,7 @@ static int process_query_packet(const knot_pkt_t      *query,
 	return 0;
 
 fail:
+	flockfile(stdout);
 	if (style->format != FORMAT_JSON) {
 		// Intentionaly start-end because of QUIC can have receive time.
 		print_packet(reply, net, in_len, time_diff_ms(&t_start, &t_end),
@@ -825,6 +834,7 @@ fail:
 		print_packets_json(q, reply, net, timestamp, style);
 		knot_pkt_free(q);
 	}
+	funlockfile(stdout);
 
 	knot_pkt_free(reply);
 	net_close(net);
@@ -1280,6 +1290,136 @@ finish:
 	return ret;
 }
 
+static int exec_query(const query_t *query, net_t *net)
+{
+	switch (query->operation) {
+	case OPERATION_QUERY:
+		return process_query(query, net);
+	case OPERATION_XFR:
+		return process_xfr(query, net);
+#if USE_DNSTAP
+	case OPERATION_LIST_DNSTAP:
+		return process_dnstap(query);
+#endif // USE_DNSTAP
+	default:
+		ERR("unsupported operation");
+		return -1;
+	}
+}
+
+typedef struct {
+	pthread_mutex_t mx;
+	node_t *next;      // Next query to be processed.
+	bool separate;     // Print empty line after each query.
+	bool success;
+} batch_t;
+
+static void *batch_worker(void *arg)
+{
+	batch_t *batch = arg;
+	net_t net = { .sockfd = -1 };
+	const query_t *prev = NULL;
+	bool success = true;
+
+	while (true) {
+		pthread_mutex_lock(&batch->mx);
+		node_t *n = batch->next;
+		if (n->next != NULL) {
+			batch->next = n->next;
+		}
+		pthread_mutex_unlock(&batch->mx);
+		if (n->next == NULL) {
+			break;
+		}
+		query_t *query = (query_t *)n;
+
+		// A kept connection may lead elsewhere than this query needs.
+		if (net.sockfd >= 0 && !query_same_connection(query, prev)) {
+			net_close(&net);
+			net_clean(&net);
+		}
+
+		// A transfer is printed packet by packet.
+		bool xfr = (query->operation == OPERATION_XFR);
+		if (xfr) {
+			flockfile(stdout);
+		}
+		if (exec_query(query, &net) != 0) {
+			success = false;
+		}
+		if (xfr) {
+			funlockfile(stdout);
+		}
+		prev = query;
+
+		if (batch->separate) {
+			printf("\n");
+		}
+	}
+
+	if (net.sockfd >= 0) {
+		net_close(&net);
+		net_clean(&net);
+	}
+
+	if (!success) {
+		pthread_mutex_lock(&batch->mx);
+		batch->success = false;
+		pthread_mutex_unlock(&batch->mx);
+	}
+
+	return NULL;
+}
+
+static bool parallel_possible(const kdig_params_t *params)
+{
+	if (params->jobs <= 1 || list_size(&params->queries) <= 1) {
+		return false;
+	}
+
+#if USE_DNSTAP
+	node_t *n;
+	WALK_LIST(n, params->queries) {
+		const query_t *query = (const query_t *)n;
+		if (query->dt_writer != NULL || query->dt_reader != NULL) {
+			WARN("dnstap not supported with parallel queries, ignoring jobs");
+			return false;
+		}
+	}
+#endif // USE_DNSTAP
+
+	return true;
+}
+
+static int exec_parallel(const kdig_params_t *params)
+{
+	batch_t batch = {
+		.next = HEAD(params->queries),
+		.separate = (params->config->style.format == FORMAT_FULL),
+		.success = true,
+	};
+	pthread_mutex_init(&batch.mx, NULL);
+
+	size_t count = MIN(params->jobs, list_size(&params->queries));
+	pthread_t threads[count];
+	size_t started = 0;
+	while (started < count &&
+	       pthread_create(&threads[started], NULL, batch_worker, &batch) == 0) {
+		started++;
+	}
+	if (started == 0) {
+		// Not even one thread, process the queries here.
+		batch_worker(&batch);
+	}
+	for (size_t i = 0; i < started; i++) {
+		pthread_join(threads[i], NULL);
+	}
+
+	pthread_mutex_destroy(&batch.mx);
+
+	return batch.success ? KNOT_EOK : KNOT_ERROR;
+}
+
 int kdig_exec(const kdig_params_t *params)
 {
 	node_t *n;
@@ -1290,32 +1430,19 @@ int kdig_exec(const kdig_params_t *params)
 		return KNOT_EINVAL;
 	}
 
+	// Several queries at once, each worker with its own connection.
+	if (parallel_possible(params)) {
+		return exec_parallel(params);
+	}
+
 	bool success = true;
 
 	// Loop over query list.
 	WALK_LIST(n, params->queries) {
 		query_t *query = (query_t *)n;
 
-		int ret = -1;
-		switch (query->operation) {
-		case OPERATION_QUERY:
-			ret = process_query(query, &net);
-			break;
-		case OPERATION_XFR:
-			ret = process_xfr(query, &net);
-			break;
-#if USE_DNSTAP
-		case OPERATION_LIST_DNSTAP:
-			ret = process_dnstap(query);
-			break;
-#endif // USE_DNSTAP
-		default:
-			ERR("unsupported operation");
-			break;
-		}
-
 		// All operations must succeed.
-		if (ret != 0) {
+		if (exec_query(query, &net) != 0) {
 			success = false;
 		}
 
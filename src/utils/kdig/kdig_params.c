@@ -15,6 +15,7 @@
  */
 
 #include <arpa/inet.h>
+#include <errno.h>
 #include <locale.h>
 #include <stdio.h>
 #include <string.h>
@@ -29,6 +30,7 @@
 #include "libknot/descriptor.h"
 #include "libknot/libknot.h"
 #include "contrib/base64.h"
+#include "contrib/getline.h"
 #include "contrib/sockaddr.h"
 #include "contrib/string.h"
 #include "contrib/strtonum.h"
@@ -2249,7 +2251,7 @@ static void complete_servers(query_t *query, const query_t *conf)
 	}
 }
 
-static bool compare_servers(list_t *s1, list_t *s2)
+static bool compare_servers(const list_t *s1, const list_t *s2)
 {
 	if (list_size(s1) != list_size(s2)) {
 		return false;
@@ -2268,6 +2270,16 @@ static bool compare_servers(list_t *s1, list_t *s2)
 	return true;
 }
 
+bool query_same_connection(const query_t *query, const query_t *prev)
+{
+	return get_socktype(query->protocol, query->type_num) ==
+	       get_socktype(prev->protocol, prev->type_num) &&
+	       query->https.enable == prev->https.enable &&
+	       query->tls.enable == prev->tls.enable &&
+	       strcmp(query->port, prev->port) == 0 &&
+	       compare_servers(&query->servers, &prev->servers);
+}
+
 void complete_queries(list_t *queries, const query_t *conf)
 {
 	node_t  *n;
@@ -2329,12 +2341,7 @@ void complete_queries(list_t *queries, const query_t *conf)
 
 		// Check if using previous connection makes sense.
 		if (q_prev != NULL && q_prev->keepopen &&
-		    (get_socktype(q->protocol, q->type_num) !=
-		     get_socktype(q_prev->protocol, q_prev->type_num) ||
-		     q->https.enable != q_prev->https.enable ||
-		     q->tls.enable != q_prev->tls.enable ||
-		     strcmp(q->port, q_prev->port) != 0 ||
-		     !compare_servers(&q->servers, &q_prev->servers)))
+		    !query_same_connection(q, q_prev))
 		{
 			WARN("connection parameters mismatch for query (%s), "
 			     "ignoring keepopen", q->owner);
@@ -2348,6 +2355,7 @@ static void print_help(void)
 	printf("Usage: %s [-4] [-6] [-d] [-b address] [-c class] [-p port]\n"
 	       "            [-q name] [-t type] [-x address] [-k keyfile]\n"
 	       "            [-y [algo:]keyname:key] [-E tapfile] [-G tapfile]\n"
+	       "            [-f batchfile] [-j jobs]\n"
 	       "            name [type] [class] [@server]\n"
 	       "\n"
 	       "       +[no]multiline             Wrap long records to more lines.\n"
@@ -2474,6 +2482,19 @@ static int parse_opt1(const char *opt, const char *value, kdig_params_t *params,
 	case 'd':
 		msg_enable_debug(1);
 		break;
+	case 'f':
+		if (val == NULL) {
+			ERR("missing filename");
+			return KNOT_EINVAL;
+		}
+
+		if (params->batch_file != NULL) {
+			ERR("only one batch file allowed");
+			return KNOT_EINVAL;
+		}
+		params->batch_file = val;
+		*index += add;
+		break;
 	case 'h':
 		if (len > 1) {
 			ERR("invalid option -%s", opt);
@@ -2483,6 +2504,20 @@ static int parse_opt1(const char *opt, const char *value, kdig_params_t *params,
 		print_help();
 		params->stop = true;
 		break;
+	case 'j':
+		if (val == NULL) {
+			ERR("missing number of jobs");
+			return KNOT_EINVAL;
+		}
+
+		uint16_t jobs;
+		if (str_to_u16(val, &jobs) != KNOT_EOK || jobs == 0) {
+			ERR("bad number of jobs %s", val);
+			return KNOT_EINVAL;
+		}
+		params->jobs = jobs;
+		*index += add;
+		break;
 	case 'c':
 		if (val == NULL) {
 			ERR("missing class");
@@ -2722,29 +2757,9 @@ static int parse_token(const char *value, kdig_params_t *params)
 	return KNOT_EINVAL;
 }
 
-int kdig_parse(kdig_params_t *params, int argc, char *argv[])
+static int parse_args(kdig_params_t *params, int argc, char *argv[])
 {
-	if (params == NULL || argv == NULL) {
-		DBG_NULL;
-		return KNOT_EINVAL;
-	}
-
-	// Initialize parameters.
-	if (kdig_init(params) != KNOT_EOK) {
-		return KNOT_ERROR;
-	}
-
-#ifdef LIBIDN
-	// Set up localization.
-	if (setlocale(LC_CTYPE, "") == NULL) {
-		WARN("can't setlocale, disabling IDN");
-		params->config->idn = false;
-		params->config->style.style.ascii_to_idn = NULL;
-	}
-#endif
-
-	// Command line parameters processing.
-	for (int i = 1; i < argc; i++) {
+	for (int i = 0; i < argc; i++) {
 		int ret = KNOT_ERROR;
 
 		// Process parameter.
@@ -2777,6 +2792,109 @@ int kdig_parse(kdig_params_t *params, int argc, char *argv[])
 		}
 	}
 
+	return KNOT_EOK;
+}
+
+#define BATCH_MAX_ARGS	64
+
+static int parse_batch(kdig_params_t *params)
+{
+	const char *file = params->batch_file;
+	FILE *in = (strcmp(file, "-") == 0) ? stdin : fopen(file, "r");
+	if (in == NULL) {
+		ERR("can't open batch file %s (%s)", file, strerror(errno));
+		return KNOT_EFILE;
+	}
+
+	int ret = KNOT_EOK;
+	char *line = NULL;
+	size_t line_size = 0, line_num = 0;
+	while (ret == KNOT_EOK && knot_getline(&line, &line_size, in) != -1) {
+		line_num++;
+
+		// Split the line into arguments as on the command line.
+		char *args[BATCH_MAX_ARGS + 1];
+		int count = 0;
+		char *saveptr = NULL;
+		for (char *arg = strtok_r(line, " \t\r\n", &saveptr);
+		     arg != NULL && arg[0] != '#';
+		     arg = strtok_r(NULL, " \t\r\n", &saveptr)) {
+			if (count == BATCH_MAX_ARGS) {
+				ERR("too many arguments on batch line %zu", line_num);
+				ret = KNOT_ESPACE;
+				break;
+			}
+			args[count++] = arg;
+		}
+		args[count] = NULL;
+		if (ret != KNOT_EOK || count == 0) {
+			continue;
+		}
+
+		// Options of a line would modify the previous query otherwise.
+		if (args[0][0] == '+' || args[0][0] == '@') {
+			ERR("query name expected first on batch line %zu", line_num);
+			ret = KNOT_EINVAL;
+			break;
+		}
+
+		size_t queries = list_size(&params->queries);
+		ret = parse_args(params, count, args);
+		if (ret == KNOT_EOK && list_size(&params->queries) == queries) {
+			ERR("no query on batch line %zu", line_num);
+			ret = KNOT_EINVAL;
+		}
+	}
+
+	free(line);
+	if (in != stdin) {
+		fclose(in);
+	}
+
+	return ret;
+}
+
+int kdig_parse(kdig_params_t *params, int argc, char *argv[])
+{
+	if (params == NULL || argv == NULL) {
+		DBG_NULL;
+		return KNOT_EINVAL;
+	}
+
+	// Initialize parameters.
+	if (kdig_init(params) != KNOT_EOK) {
+		return KNOT_ERROR;
+	}
+
+#ifdef LIBIDN
+	// Set up localization.
+	if (setlocale(LC_CTYPE, "") == NULL) {
+		WARN("can't setlocale, disabling IDN");
+		params->config->idn = false;
+		params->config->style.style.ascii_to_idn = NULL;
+	}
+#endif
+
+	// Command line parameters processing.
+	int ret = parse_args(params, argc - 1, argv + 1);
+	if (ret != KNOT_EOK || params->stop) {
+		return ret;
+	}
+
+	// Queries from the batch file, command line options are the defaults.
+	if (params->batch_file != NULL) {
+		ret = parse_batch(params);
+		if (ret != KNOT_EOK) {
+			return ret;
+		}
+
+		// One JSON object per line in batch mode.
+		node_t *n;
+		WALK_LIST(n, params->queries) {
+			((query_t *)n)->style.json_lines = true;
+		}
+	}
+
 	// Complete missing data in queries based on defaults.
 	complete_queries(&params->queries, params->config);
 
@@ -169,11 +169,16 @@ typedef struct {
 	list_t	queries;
 	/*!< Default settings for queries. */
 	query_t	*config;
+	/*!< File with a query per line (- for stdin). */
+	const char	*batch_file;
+	/*!< Number of queries processed concurrently. */
+	unsigned	jobs;
 } kdig_params_t;
 
 query_t *query_create(const char *owner, const query_t *config);
 void query_free(query_t *query);
 void complete_queries(list_t *queries, const query_t *conf);
+bool query_same_connection(const query_t *query, const query_t *prev);
 
 ednsopt_t *ednsopt_create(uint16_t code, uint16_t length, uint8_t *data);
 ednsopt_t *ednsopt_dup(const ednsopt_t *opt);
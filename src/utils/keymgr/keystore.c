@@ -19,6 +19,7 @@
 #include "utils/keymgr/keystore.h"
 
 #include "contrib/color.h"
+#include "contrib/json.h"
 #include "contrib/spinlock.h"
 #include "contrib/time.h"
 #include "libdnssec/error.h"
@@ -258,6 +259,8 @@ done:
 struct result {
 	unsigned long signs;
 	unsigned long time;
+	unsigned long verifies;
+	unsigned long verify_time;
 };
 
 typedef struct bench_ctx {
@@ -276,8 +279,7 @@ static int bench(dthread_t *dt)
 	const key_parameters_t *params = data->params;
 	struct result *result = data->results + dt_get_id(dt);
 
-	result->time = 0;
-	result->signs = 0;
+	*result = (struct result){ 0 };
 
 	char *id = NULL;
 	dnssec_key_t *test_key = NULL;
@@ -311,7 +313,7 @@ static int bench(dthread_t *dt)
 			dnssec_binary_free(&sign);
 			dnssec_sign_free(ctx);
 			result->time = 0;
-			goto finish;
+			break;
 		}
 		memcpy(input.data, sign.data, MIN(input.size, sign.size));
 		dnssec_binary_free(&sign);
@@ -322,6 +324,35 @@ static int bench(dthread_t *dt)
 		result->signs++;
 	}
 
+	// Validation of a signature of the last signed block.
+	dnssec_binary_t sign = { 0 };
+	dnssec_sign_ctx_t *ctx = NULL;
+	if (result->time == 0 ||
+	    dnssec_sign_new(&ctx, test_key) != DNSSEC_EOK ||
+	    dnssec_sign_add(ctx, &input) != DNSSEC_EOK ||
+	    dnssec_sign_write(ctx, DNSSEC_SIGN_NORMAL, &sign) != DNSSEC_EOK) {
+		goto verify_finish;
+	}
+
+	clock_gettime(CLOCK_MONOTONIC, &start_ts);
+
+	while (result->verify_time < BENCH_TIME) {
+		if (dnssec_sign_init(ctx) != DNSSEC_EOK ||
+		    dnssec_sign_add(ctx, &input) != DNSSEC_EOK ||
+		    dnssec_sign_verify(ctx, false, &sign) != DNSSEC_EOK) {
+			result->verify_time = 0;
+			break;
+		}
+
+		clock_gettime(CLOCK_MONOTONIC, &end_ts);
+		result->verify_time = time_diff_ms(&start_ts, &end_ts);
+		result->verifies++;
+	}
+
+verify_finish:
+	dnssec_binary_free(&sign);
+	dnssec_sign_free(ctx);
+	knot_spin_lock(&data->lock);
 finish:
 	knot_spin_unlock(&data->lock);
 	dnssec_key_free(test_key);
@@ -331,6 +362,39 @@ finish:
 	return KNOT_EOK;
 }
 
+static void bench_sum(const struct result *results, uint16_t threads,
+                      unsigned *signs, unsigned *verifies, unsigned *latency)
+{
+	double signs_f = 0.5, verifies_f = 0.5; // 0.5 to ensure correct rounding
+	double latency_f = 0.;
+	for (const struct result *it = results; it < results + threads; ++it) {
+		if (it->time == 0 || signs_f == 0.) {
+			signs_f = 0.;
+		} else {
+			signs_f += it->signs * 1000. / it->time;
+			latency_f += it->time * 1000. / it->signs;
+		}
+		if (it->verify_time == 0 || verifies_f == 0.) {
+			verifies_f = 0.;
+		} else {
+			verifies_f += it->verifies * 1000. / it->verify_time;
+		}
+	}
+
+	*signs = (unsigned)signs_f;
+	*verifies = (unsigned)verifies_f;
+	*latency = (*signs > 0) ? (unsigned)(latency_f / threads + 0.5) : 0;
+}
+
+static void bench_print(unsigned value, int width)
+{
+	if (value > 0) {
+		printf(" %*u", width, value);
+	} else {
+		printf(" %*s", width, "n/a");
+	}
+}
+
 int keymgr_keystore_bench(const char *keystore_id, keymgr_list_params_t *params,
                           uint16_t threads)
 {
@@ -341,11 +405,21 @@ int keymgr_keystore_bench(const char *keystore_id, keymgr_list_params_t *params,
 		return ret;
 	}
 
+	jsonw_t *w = NULL;
 	const bool c = params->color;
-	printf("%s" BENCH_FORMAT"s\n" "%s",
-	       COL_UNDR(c),
-	       "Algorithm", "Sigs/sec",
-	       COL_RST(c));
+	if (params->json) {
+		w = jsonw_new(stdout, "  ");
+		if (w == NULL) {
+			dnssec_keystore_deinit(store);
+			return KNOT_ENOMEM;
+		}
+		jsonw_list(w, NULL);
+	} else {
+		printf("%s" BENCH_FORMAT"s %9s %12s\n" "%s",
+		       COL_UNDR(c),
+		       "Algorithm", "Sigs/sec", "Vals/sec", "Latency [us]",
+		       COL_RST(c));
+	}
 
 	for (int i = 0; i < KEYS_COUNT; i++) {
 		struct result results[threads];
@@ -362,33 +436,44 @@ int keymgr_keystore_bench(const char *keystore_id, keymgr_list_params_t *params,
 		    dt_join(pool) != KNOT_EOK) {
 			dt_delete(&pool);
 			knot_spin_destroy(&d.lock);
+			if (w != NULL) {
+				jsonw_free(&w);
+			}
 			dnssec_keystore_deinit(store);
 			return KNOT_ERROR;
 		}
 		dt_delete(&pool);
 		knot_spin_destroy(&d.lock);
 
-		double result_f = 0.5; // 0.5 to ensure correct rounding
-		for (struct result *it = d.results; it < d.results + threads; ++it) {
-			if (it->time == 0) {
-				result_f = 0.;
-				break;
-			}
-			result_f += it->signs * 1000. / it->time;
-		}
+		unsigned signs, verifies, latency;
+		bench_sum(d.results, threads, &signs, &verifies, &latency);
 
 		const knot_lookup_t *alg_info = knot_lookup_by_id(
 			knot_dnssec_alg_names, KEYS[i]->algorithm);
 		assert(alg_info);
 
-		const unsigned result = (unsigned)result_f;
-		if (result > 0) {
-			printf(BENCH_FORMAT"u\n", alg_info->name, result);
+		if (w != NULL) {
+			jsonw_object(w, NULL);
+			jsonw_str(w,   "algorithm", alg_info->name);
+			jsonw_int(w,   "threads", threads);
+			jsonw_ulong(w, "signs-per-sec", signs);
+			jsonw_ulong(w, "validations-per-sec", verifies);
+			jsonw_ulong(w, "sign-latency-us", latency);
+			jsonw_end(w); // object
 		} else {
-			printf(BENCH_FORMAT"s\n", alg_info->name, "n/a");
+			printf("%-18s", alg_info->name);
+			bench_print(signs, 9);
+			bench_print(verifies, 9);
+			bench_print(latency, 12);
+			printf("\n");
 		}
 	}
 
+	if (w != NULL) {
+		jsonw_end(w); // list
+		jsonw_free(&w);
+	}
+
 	dnssec_keystore_deinit(store);
 
 	return KNOT_EOK;
@@ -53,7 +53,7 @@ static void print_help(void)
 	       "Options:\n"
 	       "  -t, --tsig <name> [alg]  Generate a TSIG key.\n"
 	       "  -e, --extended           Extended output (listing of keys with full description).\n"
-	       "  -j, --json               Print the zones or keys in JSON format.\n"
+	       "  -j, --json               Print the zones, keys, or benchmark results in JSON format.\n"
 	       "  -l, --list               List all zones that have at least one key in KASP database.\n"
 	       "  -x, --mono               Don't color the output.\n"
 	       "  -X, --color              Force output colorization in the normal mode.\n"
@@ -94,7 +94,7 @@ static void print_help(void)
 	       "Keystore commands:\n"
 	       "  keystore_test   Conduct some tests on the specified keystore.\n"
 	       "                   Use a configured keystore id or '-' for the default.\n"
-	       "  keystore_bench  Conduct a signing benchmark for each supported algorithm.\n"
+	       "  keystore_bench  Conduct a signing and validation benchmark for each supported algorithm.\n"
 	       "                   Use a configured keystore id or '-' for the default.\n"
 	       "                   (syntax: keystore_bench [<num_threads>])\n"
 	       "\n"
@@ -15,6 +15,7 @@
  */
 
 #include <getopt.h>
+#include <pthread.h>
 #include <stdlib.h>
 #include <sys/stat.h>
 #include <unistd.h>
@@ -30,6 +31,7 @@
 #include "utils/common/signal.h"
 #include "utils/common/util_conf.h"
 #include "contrib/color.h"
+#include "contrib/json.h"
 #include "contrib/strtonum.h"
 #include "contrib/string.h"
 #include "contrib/time.h"
@@ -42,7 +44,7 @@ signal_ctx_t signal_ctx = { 0 }; // global, needed by signal handler
 static void print_help(void)
 {
 	printf("Usage:\n"
-	       " %s [-c | -C | -D <path>] [options] <zone_name>\n"
+	       " %s [-c | -C | -D <path>] [options] <zone_name>...\n"
 	       " %s [-c | -C | -D <path>] -z\n"
 	       "\n"
 	       "Config options:\n"
@@ -57,6 +59,12 @@ static void print_help(void)
 	       "                      of zones in the DB.\n"
 	       " -l, --limit <num>    Read only <num> newest changes.\n"
 	       " -s, --serial <soa>   Start with a specific SOA serial.\n"
+	       " -S, --serial-to <soa>\n"
+	       "                      End with a specific SOA serial.\n"
+	       " -o, --owner <name>   Print only records with the owner name.\n"
+	       " -t, --type <type>    Print only records of the type.\n"
+	       " -J, --json           Print each changeset as a JSON object on one line.\n"
+	       " -j, --jobs <num>     Process up to <num> zones in parallel.\n"
 	       " -M, --merge          Print the changesets merged into one changeset.\n"
 	       " -H, --check          Additional journal semantic checks.\n"
 	       " -d, --debug          Debug mode output.\n"
@@ -72,39 +80,89 @@ typedef struct {
 	bool debug;
 	bool color;
 	bool check;
+	bool json;
 	int limit;
 	int counter;
 	uint32_t serial;
 	bool from_serial;
+	uint32_t serial_to;
+	bool to_serial;
+	bool stopped;
+	const knot_dname_t *owner;
+	uint16_t type;
 	size_t changes;
+	size_t printed;
 	bool merge;
 	changeset_t *merged;
 	uint64_t merged_ts;
+	bool more_zones;
+	bool buffered;        // Each changeset printed at once, other zones in parallel.
+	const char *zone_str; // Printed with each changeset if more zones printed.
+	FILE *out;
+	char *out_buf;
+	size_t out_len;
+	// Streamed changeset state.
+	jsonw_t *jw;
+	char *rr_buf;
+	size_t rr_buf_len;
+	bool pending;
+	bool in_remove;
+	bool section;
+	bool zij;
+	uint32_t ch_from;
+	uint32_t ch_to;
+	uint64_t ch_ts;
 } print_params_t;
 
-static void print_changeset(const changeset_t *chs, uint64_t timestamp, print_params_t *params)
+static FILE *out_begin(print_params_t *params)
+{
+	params->out = stdout;
+	if (params->buffered) {
+		FILE *mem = open_memstream(&params->out_buf, &params->out_len);
+		if (mem != NULL) {
+			params->out = mem;
+		}
+	}
+	return params->out;
+}
+
+static void out_end(print_params_t *params)
+{
+	if (params->out != stdout) {
+		fclose(params->out);
+		// Single write, the changeset isn't interleaved with other zones.
+		fwrite(params->out_buf, 1, params->out_len, stdout);
+		free(params->out_buf);
+		params->out_buf = NULL;
+	}
+	params->out = NULL;
+}
+
+static void print_changeset(const changeset_t *chs, uint64_t timestamp, print_params_t *params,
+                            FILE *out)
 {
 	char time_buf[64] = { 0 };
 	(void)knot_time_print(TIME_PRINT_UNIX, timestamp, time_buf, sizeof(time_buf));
 
-	static size_t count = 1;
 	if (chs->soa_from == NULL) {
-		printf("%s;; Zone-in-journal, serial: %u, changeset: %zu, timestamp: %s%s\n",
-		       COL_YELW(params->color),
-		       knot_soa_serial(chs->soa_to->rrs.rdata),
-		       count++,
-		       time_buf,
-		       COL_RST(params->color));
+		fprintf(out, "%s;; Zone-in-journal, serial: %u, changeset: %zu, timestamp: %s",
+		        COL_YELW(params->color),
+		        knot_soa_serial(chs->soa_to->rrs.rdata),
+		        ++params->printed,
+		        time_buf);
 	} else {
-		printf("%s;; Changes between zone versions: %u -> %u, changeset: %zu, timestamp: %s%s\n",
-		       COL_YELW(params->color),
-		       knot_soa_serial(chs->soa_from->rrs.rdata),
-		       knot_soa_serial(chs->soa_to->rrs.rdata),
-		       count++,
-		       time_buf,
-		       COL_RST(params->color));
-	}
-	changeset_print(chs, stdout, params->color);
+		fprintf(out, "%s;; Changes between zone versions: %u -> %u, changeset: %zu, timestamp: %s",
+		        COL_YELW(params->color),
+		        knot_soa_serial(chs->soa_from->rrs.rdata),
+		        knot_soa_serial(chs->soa_to->rrs.rdata),
+		        ++params->printed,
+		        time_buf);
+	}
+	if (params->zone_str != NULL) {
+		fprintf(out, ", zone: %s", params->zone_str);
+	}
+	fprintf(out, "%s\n", COL_RST(params->color));
+	changeset_print(chs, out, params->color);
 }
 
 knot_dynarray_declare(rrtype, uint16_t, DYNARRAY_VISIBILITY_STATIC, 100)
@@ -140,7 +198,8 @@ static int rrtypelist_callback(zone_node_t *node, void *data)
 	return KNOT_EOK;
 }
 
-static void print_changeset_debugmode(const changeset_t *chs, uint64_t timestamp)
+static void print_changeset_debugmode(const changeset_t *chs, uint64_t timestamp,
+                                      print_params_t *params, FILE *out)
 {
 	char time_buf[64] = { 0 };
 	(void)knot_time_print(TIME_PRINT_HUMAN_MIXED, timestamp, time_buf, sizeof(time_buf));
@@ -154,29 +213,43 @@ static void print_changeset_debugmode(const changeset_t *chs, uint64_t timestamp
 	(void)zone_contents_apply(chs->add, rrtypelist_callback, &ctx_plus);
 	(void)zone_contents_nsec3_apply(chs->add, rrtypelist_callback, &ctx_plus);
 
+	if (params->zone_str != NULL) {
+		fprintf(out, "%s  ", params->zone_str);
+	}
 	if (chs->soa_from == NULL) {
-		printf("Zone-in-journal %u  +++: %zu\t size: %zu\t timestamp: %s\t", knot_soa_serial(chs->soa_to->rrs.rdata),
+		fprintf(out, "Zone-in-journal %u  +++: %zu\t size: %zu\t timestamp: %s\t", knot_soa_serial(chs->soa_to->rrs.rdata),
 		       count_plus, changeset_serialized_size(chs), time_buf);
 	} else {
-		printf("%u -> %u  ---: %zu\t  +++: %zu\t size: %zu\t timestamp: %s\t", knot_soa_serial(chs->soa_from->rrs.rdata),
+		fprintf(out, "%u -> %u  ---: %zu\t  +++: %zu\t size: %zu\t timestamp: %s\t", knot_soa_serial(chs->soa_from->rrs.rdata),
 		       knot_soa_serial(chs->soa_to->rrs.rdata), count_minus, count_plus, changeset_serialized_size(chs), time_buf);
 	}
 
 	char temp[100];
 	knot_dynarray_foreach(rrtype, uint16_t, i, types) {
 		(void)knot_rrtype_to_string(*i, temp, sizeof(temp));
-		printf(" %s", temp);
+		fprintf(out, " %s", temp);
 	}
-	printf("\n");
+	fprintf(out, "\n");
 }
 
-static int count_changeset_cb(_unused_ bool special, const changeset_t *ch, _unused_ uint64_t timestamp, void *ctx)
+static int check_serial_to(bool special, const changeset_t *ch, print_params_t *params)
+{
+	// Stop after the last requested changeset, the merged one doesn't count.
+	if (params->to_serial && ch != NULL && (!special || ch->soa_from == NULL) &&
+	    knot_soa_serial(ch->soa_to->rrs.rdata) == params->serial_to) {
+		params->stopped = true;
+		return KNOT_ELIMIT;
+	}
+	return KNOT_EOK;
+}
+
+static int count_changeset_cb(bool special, const changeset_t *ch, _unused_ uint64_t timestamp, void *ctx)
 {
 	print_params_t *params = ctx;
 	if (ch != NULL) {
 		params->counter++;
 	}
-	return KNOT_EOK;
+	return check_serial_to(special, ch, params);
 }
 
 static int merge_changeset_cb(bool special, const changeset_t *ch, uint64_t timestamp, void *ctx)
@@ -214,40 +287,240 @@ static int print_changeset_cb(bool special, const changeset_t *ch, uint64_t time
 	print_params_t *params = ctx;
 	if (ch != NULL && params->counter++ >= params->limit) {
 		if (params->merge) {
-			return merge_changeset_cb(special, ch, timestamp, ctx);
-		} else if (params->debug) {
-			print_changeset_debugmode(ch, timestamp);
+			int ret = merge_changeset_cb(special, ch, timestamp, ctx);
+			if (ret != KNOT_EOK) {
+				return ret;
+			}
+			return check_serial_to(special, ch, params);
+		}
+
+		FILE *out = out_begin(params);
+		if (params->debug) {
+			print_changeset_debugmode(ch, timestamp, params, out);
 			params->changes++;
 		} else {
-			print_changeset(ch, timestamp, params);
+			print_changeset(ch, timestamp, params, out);
 		}
 		if (special && params->debug) {
-			printf("---------------------------------------------\n");
+			fprintf(out, "---------------------------------------------\n");
 		}
+		out_end(params);
 	}
-	return KNOT_EOK;
+	return check_serial_to(special, ch, params);
 }
 
-int print_journal(char *path, knot_dname_t *name, print_params_t *params)
+static int walk_changesets(zone_journal_t j, journal_walk_cb_t cb, print_params_t *params)
 {
-	zone_journal_t j = { &journal_db, name };
-	bool exists;
-	uint64_t occupied, occupied_all;
+	params->stopped = false;
+	int ret = params->from_serial ? journal_walk_from(j, params->serial, cb, params) :
+	                                journal_walk(j, cb, params);
+	return (ret == KNOT_ELIMIT && params->stopped) ? KNOT_EOK : ret;
+}
 
-	knot_lmdb_init(&journal_db, path, 0, journal_env_flags(JOURNAL_MODE_ROBUST, true), NULL);
-	int ret = knot_lmdb_exists(&journal_db);
-	if (ret == KNOT_EOK) {
-		ret = knot_lmdb_open(&journal_db);
+static bool rr_match(const knot_rrset_t *rr, const print_params_t *params)
+{
+	return (params->type == 0 || rr->type == params->type) &&
+	       (params->owner == NULL || knot_dname_is_case_equal(rr->owner, params->owner));
+}
+
+static void stream_header(print_params_t *params)
+{
+	FILE *out = out_begin(params);
+
+	if (params->json) {
+		params->jw = jsonw_new(out, "");
+		if (params->jw == NULL) {
+			return;
+		}
+		jsonw_object(params->jw, NULL);
+		jsonw_str(params->jw, "zone", params->zone_str);
+		if (!params->zij) {
+			jsonw_ulong(params->jw, "serial-from", params->ch_from);
+		}
+		jsonw_ulong(params->jw, "serial-to", params->ch_to);
+		jsonw_ulong(params->jw, "timestamp", params->ch_ts);
+		jsonw_bool(params->jw, "zone-in-journal", params->zij);
+		return;
+	}
+
+	char time_buf[64] = { 0 };
+	(void)knot_time_print(TIME_PRINT_UNIX, params->ch_ts, time_buf, sizeof(time_buf));
+
+	if (params->zij) {
+		fprintf(out, "%s;; Zone-in-journal, serial: %u, changeset: %zu, timestamp: %s",
+		        COL_YELW(params->color), params->ch_to, ++params->printed, time_buf);
+	} else {
+		fprintf(out, "%s;; Changes between zone versions: %u -> %u, changeset: %zu, timestamp: %s",
+		        COL_YELW(params->color), params->ch_from, params->ch_to,
+		        ++params->printed, time_buf);
+	}
+	if (params->zone_str != NULL) {
+		fprintf(out, ", zone: %s", params->zone_str);
+	}
+	fprintf(out, "%s\n", COL_RST(params->color));
+}
+
+static void stream_rr(print_params_t *params, const knot_rrset_t *rr, bool in_remove)
+{
+	if (!rr_match(rr, params)) {
+		return;
+	}
+
+	if (params->pending) {
+		params->pending = false;
+		stream_header(params);
+	}
+	if (!params->section || params->in_remove != in_remove) {
+		if (params->jw != NULL) {
+			if (params->section) {
+				jsonw_end(params->jw);
+			}
+			jsonw_list(params->jw, in_remove ? "removed" : "added");
+		} else if (!params->json) {
+			fprintf(params->out, "%s;; %s%s\n",
+			        in_remove ? COL_RED(params->color) : COL_GRN(params->color),
+			        in_remove ? "Removed" : "Added", COL_RST(params->color));
+		}
+		params->section = true;
+		params->in_remove = in_remove;
+	}
+
+	knot_dump_style_t style = KNOT_DUMP_STYLE_DEFAULT;
+	if (!params->json) {
+		style.color = in_remove ? COL_RED(params->color) : COL_GRN(params->color);
+	}
+	if (knot_rrset_txt_dump(rr, &params->rr_buf, &params->rr_buf_len, &style) < 0) {
+		return;
+	}
+
+	if (params->jw == NULL) {
+		if (!params->json) {
+			fprintf(params->out, "%s%s%s", style.color, params->rr_buf,
+			        COL_RST(params->color));
+		}
+		return;
+	}
+	// One list item per record.
+	for (const char *line = params->rr_buf; *line != '\0'; ) {
+		size_t len = strcspn(line, "\n");
+		jsonw_str_len(params->jw, NULL, (const uint8_t *)line, len, true);
+		line += len + (line[len] == '\n');
+	}
+}
+
+static void stream_end(print_params_t *params)
+{
+	if (params->pending) {
+		params->pending = false;
+		return; // Nothing matched.
 	}
+	if (params->jw != NULL) {
+		if (params->section) {
+			jsonw_end(params->jw);
+		}
+		jsonw_end(params->jw);
+		jsonw_free(&params->jw);
+	}
+	out_end(params);
+}
+
+/*!
+ * Prints the changesets directly from the journal records without building
+ * the changeset trees. Only the matching records are printed, changesets
+ * without any are skipped.
+ */
+static int stream_changesets(zone_journal_t j, bool zij, uint32_t serial_from,
+                             bool follow, print_params_t *params)
+{
+	journal_read_t *read = NULL;
+	int ret = journal_read_begin(j, zij, serial_from, &read);
+	if (ret != KNOT_EOK) {
+		return ret;
+	}
+
+	knot_rrset_t rr;
+	bool first = true;
+	while ((first || follow) && !params->stopped &&
+	       journal_read_get_error(read, KNOT_EOK) == KNOT_EOK &&
+	       journal_read_rrset_nocopy(read, &rr, true)) {
+		bool show = params->counter++ >= params->limit;
+		if (show) {
+			journal_read_changeset_info(read, &params->ch_to, &params->ch_ts);
+			params->ch_from = knot_soa_serial(rr.rrs.rdata);
+			params->zij = zij;
+			params->pending = true;
+			params->section = false;
+		}
+
+		// The first SOA is serial-from, or serial-to of zone-in-journal.
+		bool in_remove = !zij;
+		if (show) {
+			stream_rr(params, &rr, in_remove);
+		}
+		while (journal_read_rrset_nocopy(read, &rr, false)) {
+			if (rr_is_apex_soa(&rr, j.zone)) {
+				in_remove = false;
+			}
+			if (show) {
+				stream_rr(params, &rr, in_remove);
+			}
+		}
+		if (show) {
+			stream_end(params);
+		}
+
+		uint32_t serial_to;
+		journal_read_changeset_info(read, &serial_to, NULL);
+		if (params->to_serial && serial_to == params->serial_to) {
+			params->stopped = true;
+		}
+		zij = false;
+		first = false;
+	}
+	ret = journal_read_get_error(read, KNOT_EOK);
+	journal_read_end(read);
+
+	return ret;
+}
+
+static int stream_journal(zone_journal_t j, print_params_t *params)
+{
+	bool exists, zij, merged;
+	uint32_t first_serial, merged_serial;
+	int ret = journal_info(j, &exists, &first_serial, &zij, NULL, &merged,
+	                       &merged_serial, NULL, NULL);
 	if (ret != KNOT_EOK) {
-		knot_lmdb_deinit(&journal_db);
 		return ret;
 	}
 
-	ret = journal_info(j, &exists, NULL, NULL, NULL, NULL, NULL, &occupied, &occupied_all);
+	params->stopped = false;
+	if (params->from_serial) {
+		return stream_changesets(j, false, params->serial, true, params);
+	} else if (zij) {
+		return stream_changesets(j, true, 0, true, params);
+	} else if (merged) {
+		ret = stream_changesets(j, false, merged_serial, false, params);
+		if (ret != KNOT_EOK) {
+			return ret;
+		}
+	}
+	return stream_changesets(j, false, first_serial, true, params);
+}
+
+static bool stream_mode(const print_params_t *params)
+{
+	return params->json || params->owner != NULL || params->type != 0;
+}
+
+static int print_journal(const knot_dname_t *name, print_params_t *params)
+{
+	zone_journal_t j = { &journal_db, name };
+	bool exists;
+	uint64_t occupied, occupied_all;
+
+	int ret = journal_info(j, &exists, NULL, NULL, NULL, NULL, NULL, &occupied, &occupied_all);
 	if (ret != KNOT_EOK || !exists) {
-		ERR2("zone not exists in the journal DB %s", path);
-		knot_lmdb_deinit(&journal_db);
+		ERR2("zone not exists in the journal DB %s", journal_db.path);
 		return ret == KNOT_EOK ? KNOT_ENOENT : ret;
 	}
 
@@ -261,10 +534,14 @@ int print_journal(char *path, knot_dname_t *name, print_params_t *params)
 	}
 
 	if (params->limit >= 0 && ret == KNOT_EOK) {
-		if (params->from_serial) {
-			ret = journal_walk_from(j, params->serial, count_changeset_cb, params);
+		if (stream_mode(params)) {
+			// Count all the changesets, nothing printed.
+			int limit = params->limit;
+			params->limit = INT_MAX;
+			ret = stream_journal(j, params);
+			params->limit = limit;
 		} else {
-			ret = journal_walk(j, count_changeset_cb, params);
+			ret = walk_changesets(j, count_changeset_cb, params);
 		}
 	}
 	if (ret == KNOT_EOK) {
@@ -274,30 +551,122 @@ int print_journal(char *path, knot_dname_t *name, print_params_t *params)
 			params->limit = params->counter - params->limit;
 		}
 		params->counter = 0;
-		if (params->from_serial) {
-			ret = journal_walk_from(j, params->serial, print_changeset_cb, params);
+		if (stream_mode(params)) {
+			ret = stream_journal(j, params);
 		} else {
-			ret = journal_walk(j, print_changeset_cb, params);
+			ret = walk_changesets(j, print_changeset_cb, params);
 		}
 		if (params->merge && ret == KNOT_EOK && params->merged != NULL) {
 			params->merge = false;
+			params->to_serial = false;
 			params->limit++;
 			ret = print_changeset_cb(false, params->merged, params->merged_ts, params);
 		}
 	}
 
 	if (params->debug && ret == KNOT_EOK) {
-		printf("Total number of changesets:  %zu\n", params->changes);
-		printf("Occupied this zone (approx): %"PRIu64" KiB\n", occupied / 1024);
-		printf("Occupied all zones together: %"PRIu64" KiB\n", occupied_all / 1024);
+		FILE *out = out_begin(params);
+		if (params->zone_str != NULL) {
+			fprintf(out, "Zone:                        %s\n", params->zone_str);
+		}
+		fprintf(out, "Total number of changesets:  %zu\n", params->changes);
+		fprintf(out, "Occupied this zone (approx): %"PRIu64" KiB\n", occupied / 1024);
+		fprintf(out, "Occupied all zones together: %"PRIu64" KiB\n", occupied_all / 1024);
+		out_end(params);
 	}
 
 	changeset_free(params->merged);
 	params->merged = NULL;
-	knot_lmdb_deinit(&journal_db);
+	free(params->rr_buf);
+	params->rr_buf = NULL;
+	return ret;
+}
+
+static int open_journal(const char *path)
+{
+	knot_lmdb_init(&journal_db, path, 0, journal_env_flags(JOURNAL_MODE_ROBUST, true), NULL);
+	int ret = knot_lmdb_exists(&journal_db);
+	if (ret == KNOT_EOK) {
+		ret = knot_lmdb_open(&journal_db);
+	}
+	if (ret != KNOT_EOK) {
+		knot_lmdb_deinit(&journal_db);
+	}
 	return ret;
 }
 
+typedef struct {
+	pthread_mutex_t mx;
+	char **zones;
+	int *rets;
+	size_t count;
+	size_t next;
+	const print_params_t *params;
+} zone_jobs_t;
+
+static int print_zone(const char *zone_str, const print_params_t *base)
+{
+	knot_dname_t *name = knot_dname_from_str_alloc(zone_str);
+	if (name == NULL) {
+		return KNOT_EINVAL;
+	}
+	knot_dname_to_lower(name);
+
+	print_params_t params = *base;
+	if (params.more_zones || params.json) {
+		params.zone_str = zone_str;
+	}
+	int ret = print_journal(name, &params);
+	free(name);
+	return ret;
+}
+
+static void *print_zone_worker(void *arg)
+{
+	zone_jobs_t *jobs = arg;
+
+	while (true) {
+		pthread_mutex_lock(&jobs->mx);
+		size_t i = jobs->next++;
+		pthread_mutex_unlock(&jobs->mx);
+		if (i >= jobs->count) {
+			break;
+		}
+		jobs->rets[i] = print_zone(jobs->zones[i], jobs->params);
+	}
+
+	return NULL;
+}
+
+static void print_zones(char **zones, size_t count, const print_params_t *params,
+                        uint16_t jobs_count, int *rets)
+{
+	zone_jobs_t jobs = {
+		.zones = zones,
+		.rets = rets,
+		.count = count,
+		.params = params,
+	};
+	pthread_mutex_init(&jobs.mx, NULL);
+
+	size_t threads_count = MIN(jobs_count, count);
+	pthread_t threads[threads_count];
+	size_t started = 0;
+	for (; started < threads_count; started++) {
+		if (pthread_create(&threads[started], NULL, print_zone_worker, &jobs) != 0) {
+			break;
+		}
+	}
+	if (started == 0) {
+		(void)print_zone_worker(&jobs);
+	}
+	for (size_t i = 0; i < started; i++) {
+		pthread_join(threads[i], NULL);
+	}
+
+	pthread_mutex_destroy(&jobs.mx);
+}
+
 static int add_zone_to_list(const knot_dname_t *zone, void *list)
 {
 	knot_dname_t *copy = knot_dname_copy(zone, NULL);
@@ -364,9 +733,39 @@ int list_zones(char *path, bool detailed)
 	return ret;
 }
 
+static bool print_result(int ret, const char *zone_str, const print_params_t *params)
+{
+	if (zone_str != NULL && ret != KNOT_EOK) {
+		INFO2("Zone %s:", zone_str);
+	}
+
+	switch (ret) {
+	case KNOT_ENOENT:
+		if (params->from_serial) {
+			INFO2("The journal is empty or the serial not present");
+		} else {
+			INFO2("The journal is empty");
+		}
+		return true;
+	case KNOT_EOUTOFZONE:
+		ERR2("the journal DB does not contain the specified zone");
+		return false;
+	case KNOT_EINVAL:
+		ERR2("invalid zone name");
+		return false;
+	case KNOT_EOK:
+		return true;
+	default:
+		ERR2("failed to load changesets (%s)", knot_strerror(ret));
+		return false;
+	}
+}
+
 int main(int argc, char *argv[])
 {
 	bool justlist = false;
+	uint16_t jobs = 1;
+	knot_dname_storage_t owner;
 
 	print_params_t params = {
 		.debug = false,
@@ -376,13 +775,18 @@ int main(int argc, char *argv[])
 		.from_serial = false,
 	};
 
-	const char *opts_str = "c:C:D:l:s:MzHdxXhV::";
+	const char *opts_str = "c:C:D:l:s:S:o:t:Jj:MzHdxXhV::";
 	struct option opts[] = {
 		{ "config",    required_argument, NULL, 'c' },
 		{ "confdb",    required_argument, NULL, 'C' },
 		{ "dir",       required_argument, NULL, 'D' },
 		{ "limit",     required_argument, NULL, 'l' },
 		{ "serial",    required_argument, NULL, 's' },
+		{ "serial-to", required_argument, NULL, 'S' },
+		{ "owner",     required_argument, NULL, 'o' },
+		{ "type",      required_argument, NULL, 't' },
+		{ "json",      no_argument,       NULL, 'J' },
+		{ "jobs",      required_argument, NULL, 'j' },
 		{ "zone-list", no_argument,       NULL, 'z' },
 		{ "check",     no_argument,       NULL, 'H' },
 		{ "debug",     no_argument,       NULL, 'd' },
@@ -427,6 +831,35 @@ int main(int argc, char *argv[])
 			}
 			params.from_serial = true;
 			break;
+		case 'S':
+			if (str_to_u32(optarg, &params.serial_to) != KNOT_EOK) {
+				print_help();
+				goto failure;
+			}
+			params.to_serial = true;
+			break;
+		case 'o':
+			if (knot_dname_from_str(owner, optarg, sizeof(owner)) == NULL) {
+				ERR2("invalid owner name '%s'", optarg);
+				goto failure;
+			}
+			params.owner = owner;
+			break;
+		case 't':
+			if (knot_rrtype_from_string(optarg, &params.type) != 0) {
+				ERR2("invalid record type '%s'", optarg);
+				goto failure;
+			}
+			break;
+		case 'J':
+			params.json = true;
+			break;
+		case 'j':
+			if (str_to_u16(optarg, &jobs) != KNOT_EOK || jobs == 0) {
+				print_help();
+				goto failure;
+			}
+			break;
 		case 'M':
 			params.merge = true;
 			break;
@@ -459,6 +892,11 @@ int main(int argc, char *argv[])
 
 	signal_ctx.color = params.color;
 
+	if (stream_mode(&params) && (params.merge || params.debug)) {
+		ERR2("options -M and -d can't be combined with -o, -t, or -J");
+		goto failure;
+	}
+
 	if (util_conf_init_default(true) != KNOT_EOK) {
 		goto failure;
 	}
@@ -485,35 +923,38 @@ int main(int argc, char *argv[])
 			goto failure;
 		}
 	} else {
-		if (argc - optind != 1) {
+		if (argc - optind < 1) {
 			print_help();
 			free(db);
 			goto failure;
 		}
-		knot_dname_t *name = knot_dname_from_str_alloc(argv[optind]);
-		knot_dname_to_lower(name);
 
-		int ret = print_journal(db, name, &params);
-		free(name);
+		int ret = open_journal(db);
 		free(db);
-		switch (ret) {
-		case KNOT_ENOENT:
-			if (params.from_serial) {
-				INFO2("The journal is empty or the serial not present");
-			} else {
-				INFO2("The journal is empty");
-			}
-			break;
-		case KNOT_ENODB:
+		if (ret == KNOT_ENODB) {
 			ERR2("the journal DB does not exist");
 			goto failure;
-		case KNOT_EOUTOFZONE:
-			ERR2("the journal DB does not contain the specified zone");
+		} else if (ret != KNOT_EOK) {
+			ERR2("failed to open the journal DB (%s)", knot_strerror(ret));
 			goto failure;
-		case KNOT_EOK:
-			break;
-		default:
-			ERR2("failed to load changesets (%s)", knot_strerror(ret));
+		}
+
+		char **zones = argv + optind;
+		size_t count = argc - optind;
+		if (count > 1) {
+			params.more_zones = true;
+			params.buffered = (jobs > 1);
+		}
+
+		int rets[count];
+		print_zones(zones, count, &params, jobs, rets);
+		knot_lmdb_deinit(&journal_db);
+
+		bool ok = true;
+		for (size_t i = 0; i < count; i++) {
+			ok &= print_result(rets[i], count > 1 ? zones[i] : NULL, &params);
+		}
+		if (!ok) {
 			goto failure;
 		}
 	}
@@ -191,6 +191,7 @@ static void format_data(cmd_args_t *args, knot_ctl_type_t data_type,
 		break;
 	case CTL_STOP:
 	case CTL_RELOAD:
+	case CTL_COMPACT:
 	case CTL_CONF_BEGIN:
 	case CTL_CONF_ABORT:
 		// Only error message is expected here.
@@ -349,6 +350,9 @@ static void format_block(ctl_cmd_t cmd, bool failed, bool empty)
 	case CTL_RELOAD:
 		printf("%s\n", failed ? "" : "Reloaded");
 		break;
+	case CTL_COMPACT:
+		printf("%s\n", failed ? "" : "Compacted");
+		break;
 	case CTL_CONF_BEGIN:
 	case CTL_CONF_COMMIT:
 	case CTL_CONF_ABORT:
@@ -566,7 +570,7 @@ static int zone_check(const knot_dname_t *dname, void *data)
 
 	zone_contents_t *contents = NULL;
 	conf_val_t mode = conf_zone_get(conf(), C_SEM_CHECKS, dname);
-	int ret = zone_load_contents(conf(), dname, &contents, conf_opt(&mode), args->force);
+	int ret = zone_load_contents(conf(), dname, &contents, conf_opt(&mode), args->force, NULL);
 	zone_contents_deep_free(contents);
 	if (ret != KNOT_EOK && ret != KNOT_ESEMCHECK) {
 		knot_dname_txt_storage_t name;
@@ -609,6 +613,7 @@ const filter_desc_t conf_import_filters[] = {
 
 const filter_desc_t conf_export_filters[] = {
 	{ "+schema" },
+	{ "+binary" },
 	{ NULL },
 };
 
@@ -638,6 +643,7 @@ const filter_desc_t zone_backup_filters[] = {
 	{ "+nocatalog",   CTL_FILTER_BACKUP_NOCATALOG,  false },
 	{ "+quic",        CTL_FILTER_BACKUP_QUIC,       false },
 	{ "+noquic",      CTL_FILTER_BACKUP_NOQUIC,     false },
+	{ "+incremental", CTL_FILTER_BACKUP_INCREMENTAL, false },
 	{ NULL },
 };
 
@@ -648,6 +654,7 @@ const filter_desc_t zone_status_filters[] = {
 	{ "+freeze",      CTL_FILTER_STATUS_FREEZE },
 	{ "+catalog",     CTL_FILTER_STATUS_CATALOG },
 	{ "+events",      CTL_FILTER_STATUS_EVENTS },
+	{ "+latency",     CTL_FILTER_STATUS_LATENCY },
 	{ NULL },
 };
 
@@ -856,6 +863,119 @@ static int set_node_items(cmd_args_t *args, knot_ctl_data_t *data, char *rdata,
 	return KNOT_EOK;
 }
 
+typedef struct {
+	cmd_args_t *args;
+	knot_ctl_data_t *data;
+	char *dump;
+	size_t dump_size;
+	char chunk[65536]; // Maximum item size in libknot control interface.
+	size_t chunk_len;
+	int ret;
+} bulk_ctx_t;
+
+static int bulk_send(bulk_ctx_t *ctx)
+{
+	if (ctx->chunk_len == 0) {
+		return KNOT_EOK;
+	}
+
+	ctx->chunk[ctx->chunk_len] = '\0';
+	(*ctx->data)[KNOT_CTL_IDX_DATA] = ctx->chunk;
+	ctx->chunk_len = 0;
+
+	cmd_args_t *args = ctx->args;
+	int ret;
+	CTL_SEND(KNOT_CTL_TYPE_DATA, ctx->data)
+
+	return KNOT_EOK;
+}
+
+static void bulk_record(zs_scanner_t *scanner)
+{
+	bulk_ctx_t *ctx = scanner->process.data;
+
+	knot_rrset_t rrset;
+	knot_rrset_init(&rrset, scanner->r_owner, scanner->r_type,
+	                scanner->r_class, scanner->r_ttl);
+	int ret = knot_rrset_add_rdata(&rrset, scanner->r_data,
+	                               scanner->r_data_length, NULL);
+	if (ret == KNOT_EOK) {
+		// One record per line, so that chunks can be split anywhere.
+		ret = knot_rrset_txt_dump(&rrset, &ctx->dump, &ctx->dump_size,
+		                          &KNOT_DUMP_STYLE_DEFAULT);
+	}
+	knot_rdataset_clear(&rrset.rrs, NULL);
+	if (ret >= 0 && ret >= sizeof(ctx->chunk)) {
+		ret = KNOT_ESPACE;
+	}
+	if (ret >= 0 && ctx->chunk_len + ret >= sizeof(ctx->chunk)) {
+		ret = bulk_send(ctx);
+	}
+	if (ret < 0) {
+		ctx->ret = ret;
+		scanner->state = ZS_STATE_STOP;
+		return;
+	}
+
+	memcpy(ctx->chunk + ctx->chunk_len, ctx->dump, ret);
+	ctx->chunk_len += ret;
+}
+
+static void bulk_error(zs_scanner_t *scanner)
+{
+	bulk_ctx_t *ctx = scanner->process.data;
+
+	log_error("invalid record on line %"PRIu64" (%s)", scanner->line_counter,
+	          zs_strerror(scanner->error.code));
+	ctx->ret = KNOT_EPARSEFAIL;
+	scanner->state = ZS_STATE_STOP;
+}
+
+static int cmd_zone_set_file(cmd_args_t *args, knot_ctl_data_t *data)
+{
+	if (strcmp(args->argv[0], "--") == 0) {
+		log_error("zone must be specified");
+		return KNOT_EINVAL;
+	}
+	(*data)[KNOT_CTL_IDX_ZONE] = args->argv[0];
+	(*data)[KNOT_CTL_IDX_FILTERS] = CTL_FILTER_SET_BULK;
+
+	bulk_ctx_t *ctx = calloc(1, sizeof(*ctx));
+	if (ctx == NULL) {
+		return KNOT_ENOMEM;
+	}
+	ctx->args = args;
+	ctx->data = data;
+
+	// The records are parsed here and sent in large chunks of canonical text.
+	zs_scanner_t scanner;
+	int ret = KNOT_EOK;
+	if (zs_init(&scanner, args->argv[0], KNOT_CLASS_IN, 3600) != 0 ||
+	    zs_set_input_file(&scanner, args->argv[2]) != 0 ||
+	    zs_set_processing(&scanner, bulk_record, bulk_error, ctx) != 0 ||
+	    zs_parse_all(&scanner) != 0) {
+		ret = (ctx->ret != KNOT_EOK) ? ctx->ret : KNOT_EPARSEFAIL;
+		if (ctx->ret == KNOT_EOK) {
+			log_error("failed to load file '%s' (%s)", args->argv[2],
+			          zs_strerror(scanner.error.code));
+		}
+	}
+	zs_deinit(&scanner);
+
+	if (ret == KNOT_EOK) {
+		ret = bulk_send(ctx);
+	}
+	free(ctx->dump);
+	free(ctx);
+	if (ret != KNOT_EOK) {
+		return ret;
+	}
+
+	CTL_SEND_BLOCK
+
+	return ctl_receive(args);
+}
+
 static int cmd_zone_node_ctl(cmd_args_t *args)
 {
 	knot_ctl_data_t data = {
@@ -863,6 +983,11 @@ static int cmd_zone_node_ctl(cmd_args_t *args)
 		[KNOT_CTL_IDX_FLAGS] = *args->flags ? args->flags : NULL,
 	};
 
+	if (args->desc->cmd == CTL_ZONE_SET && args->argc == 3 &&
+	    strcmp(args->argv[1], "+file") == 0) {
+		return cmd_zone_set_file(args, &data);
+	}
+
 	char rdata[65536]; // Maximum item size in libknot control interface.
 
 	int ret = set_node_items(args, &data, rdata, sizeof(rdata));
@@ -1107,10 +1232,13 @@ static int cmd_conf_export(cmd_args_t *args)
 	// Stdout is the default output file.
 	const char *file_name = NULL;
 	bool export_schema = false;
+	bool export_binary = false;
 	for (int i = 0; i < args->argc; i++) {
 		if (args->argv[i][0] == '+') {
 			if (strcmp(args->argv[i], conf_export_filters[0].name) == 0) {
 				export_schema = true;
+			} else if (strcmp(args->argv[i], conf_export_filters[1].name) == 0) {
+				export_binary = true;
 			} else {
 				log_error("unknown filter: %s", args->argv[i]);
 				return KNOT_EINVAL;
@@ -1123,9 +1251,16 @@ static int cmd_conf_export(cmd_args_t *args)
 		}
 	}
 
+	if (export_binary && (export_schema || file_name == NULL)) {
+		log_error("binary export requires an output file");
+		return KNOT_EINVAL;
+	}
+
 	if (file_name != NULL) {
 		if (export_schema) {
 			log_debug("exporting JSON schema into file '%s'", file_name);
+		} else if (export_binary) {
+			log_debug("exporting binary confdb into file '%s'", file_name);
 		} else {
 			log_debug("exporting confdb into file '%s'", file_name);
 		}
@@ -1133,6 +1268,8 @@ static int cmd_conf_export(cmd_args_t *args)
 
 	if (export_schema) {
 		ret = conf_export_schema(conf(), file_name);
+	} else if (export_binary) {
+		ret = conf_db_export_bin(conf(), NULL, file_name);
 	} else {
 		ret = conf_export(conf(), file_name, YP_SNONE);
 	}
@@ -1208,6 +1345,7 @@ const cmd_desc_t cmd_table[] = {
 	{ CMD_STOP,            cmd_ctl,           CTL_STOP },
 	{ CMD_RELOAD,          cmd_ctl,           CTL_RELOAD },
 	{ CMD_STATS,           cmd_stats_ctl,     CTL_STATS },
+	{ CMD_COMPACT,         cmd_ctl,           CTL_COMPACT },
 
 	{ CMD_ZONE_CHECK,      cmd_zone_check,        CTL_NONE,            CMD_FOPT_ZONE | CMD_FREAD },
 	{ CMD_ZONE_STATUS,     cmd_zone_ctl,          CTL_ZONE_STATUS,     CMD_FOPT_ZONE | CMD_FOPT_FILTER },
@@ -1262,6 +1400,7 @@ static const cmd_help_t cmd_help_table[] = {
 	{ CMD_STOP,            "",                                           "Stop the server if running." },
 	{ CMD_RELOAD,          "",                                           "Reload the server configuration and modified zones." },
 	{ CMD_STATS,           "[<module>[.<counter>]]",                     "Show global statistics counter(s)." },
+	{ CMD_COMPACT,         "",                                           "Compact the journal, timer, and KASP databases." },
 	{ "",                  "",                                           "" },
 	{ CMD_ZONE_CHECK,      "[<zone>...]",                                "Check if the zone can be loaded. (*)" },
 	{ CMD_ZONE_STATUS,     "[<zone>...] [<filter>...]",                  "Show the zone status." },
@@ -1289,6 +1428,7 @@ static const cmd_help_t cmd_help_table[] = {
 	{ CMD_ZONE_DIFF,       "<zone>",                                     "Get zone changes within the transaction." },
 	{ CMD_ZONE_GET,        "<zone> [<owner> [<type>]]",                  "Get zone data within the transaction." },
 	{ CMD_ZONE_SET,        "<zone>  <owner> [<ttl>] <type> <rdata>",     "Add zone record within the transaction." },
+	{ CMD_ZONE_SET,        "<zone>  +file <filename>",                   "Add zone records from a zone file within the transaction." },
 	{ CMD_ZONE_UNSET,      "<zone>  <owner> [<type> [<rdata>]]",         "Remove zone data within the transaction." },
 	{ CMD_ZONE_PURGE,      "<zone>... [<filter>...]",                    "Purge zone data, zone file, journal, timers, and KASP data. (#)" },
 	{ CMD_ZONE_STATS,      "<zone> [<module>[.<counter>]]",              "Show zone statistics counter(s)."},
@@ -1296,7 +1436,7 @@ static const cmd_help_t cmd_help_table[] = {
 	{ CMD_CONF_INIT,       "",                                           "Initialize the confdb. (*)" },
 	{ CMD_CONF_CHECK,      "",                                           "Check the server configuration. (*)" },
 	{ CMD_CONF_IMPORT,     " <filename> [+nopurge]",                     "Import a config file into the confdb. (*)" },
-	{ CMD_CONF_EXPORT,     "[<filename>] [+schema]",                     "Export the confdb (or JSON schema) into a file or stdout. (*)" },
+	{ CMD_CONF_EXPORT,     "[<filename>] [+schema] [+binary]",           "Export the confdb (or JSON schema) into a file or stdout. (*)" },
 	{ CMD_CONF_LIST,       "[<item>...]",                                "List the confdb sections or section items." },
 	{ CMD_CONF_READ,       "[<item>...]",                                "Get the item from the active confdb." },
 	{ CMD_CONF_BEGIN,      "",                                           "Begin a writing confdb transaction." },
@@ -25,6 +25,7 @@
 #define CMD_STOP		"stop"
 #define CMD_RELOAD		"reload"
 #define CMD_STATS		"stats"
+#define CMD_COMPACT		"compact"
 
 #define CMD_ZONE_CHECK		"zone-check"
 #define CMD_ZONE_STATUS		"zone-status"
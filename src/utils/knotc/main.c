@@ -28,6 +28,7 @@
 
 #define PROGRAM_NAME		"knotc"
 #define SPACE			"  "
+#define OUT_BUFF_SIZE		(64 * 1024)
 
 signal_ctx_t signal_ctx = { 0 }; // global, needed by signal handler
 
@@ -172,6 +173,8 @@ int main(int argc, char **argv)
 	if (argc - optind < 1) {
 		ret = interactive_loop(&params);
 	} else {
+		// Large outputs (e.g. status of all zones) needn't be written line by line.
+		setvbuf(stdout, NULL, _IOFBF, OUT_BUFF_SIZE);
 		ret = process_cmd(argc - optind, (const char **)argv + optind, &params);
 	}
 
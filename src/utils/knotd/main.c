@@ -528,11 +528,29 @@ static void event_loop(server_t *server, const char *socket, bool daemonize,
 		dbus_emit_running(false);
 	}
 
-	/* Unbind the control socket. */
-	knot_ctl_unbind(ctl);
+	/* Unbind the control socket, unless it's the new server's one. */
+	if (!(server->state & ServerHandedOff)) {
+		knot_ctl_unbind(ctl);
+	}
 	knot_ctl_free(ctl);
 }
 
+/*! \brief Get the configured hand-off socket path, NULL if not set. */
+static char *handoff_path(void)
+{
+	conf_val_t val = conf_get(conf(), C_SRV, C_HANDOFF_LISTEN);
+	if (val.code != KNOT_EOK) {
+		return NULL;
+	}
+
+	conf_val_t rundir_val = conf_get(conf(), C_SRV, C_RUNDIR);
+	char *rundir = conf_abs_path(&rundir_val, NULL);
+	char *path = conf_abs_path(&val, rundir);
+	free(rundir);
+
+	return path;
+}
+
 static void print_help(void)
 {
 	printf("Usage: %s [-c | -C <path>] [options]\n"
@@ -548,6 +566,7 @@ static void print_help(void)
 	       " -s, --socket <path>        Use a remote control UNIX socket path.\n"
 	       "                             (default %s)\n"
 	       " -d, --daemonize=[dir]      Run the server as a daemon (with new root directory).\n"
+	       " -H, --handoff              Take over the listening sockets of the running server.\n"
 	       " -v, --verbose              Enable debug output.\n"
 	       " -h, --help                 Print the program help.\n"
 	       " -V, --version              Print the program version.\n",
@@ -617,6 +636,7 @@ int main(int argc, char **argv)
 	const char *daemon_root = "/";
 	char *socket = NULL;
 	bool verbose = false;
+	bool handoff = false;
 
 	/* Long options. */
 	struct option opts[] = {
@@ -625,6 +645,7 @@ int main(int argc, char **argv)
 		{ "max-conf-size", required_argument, NULL, 'm' },
 		{ "socket",        required_argument, NULL, 's' },
 		{ "daemonize",     optional_argument, NULL, 'd' },
+		{ "handoff",       no_argument,       NULL, 'H' },
 		{ "verbose",       no_argument,       NULL, 'v' },
 		{ "help",          no_argument,       NULL, 'h' },
 		{ "version",       optional_argument, NULL, 'V' },
@@ -636,7 +657,7 @@ int main(int argc, char **argv)
 
 	/* Parse command line arguments. */
 	int opt = 0;
-	while ((opt = getopt_long(argc, argv, "c:C:m:s:dvhV::", opts, NULL)) != -1) {
+	while ((opt = getopt_long(argc, argv, "c:C:m:s:dHvhV::", opts, NULL)) != -1) {
 		switch (opt) {
 		case 'c':
 			config = optarg;
@@ -661,6 +682,9 @@ int main(int argc, char **argv)
 				daemon_root = optarg;
 			}
 			break;
+		case 'H':
+			handoff = true;
+			break;
 		case 'v':
 			verbose = true;
 			break;
@@ -730,6 +754,26 @@ int main(int argc, char **argv)
 		return EXIT_FAILURE;
 	}
 
+	/* Receive the listening sockets of the running server. */
+	if (handoff) {
+		char *path = handoff_path();
+		ret = (path != NULL) ? handoff_receive(&server.handoff, path) : KNOT_ENOPARAM;
+		if (ret != KNOT_EOK) {
+			log_fatal("hand-off, failed to receive sockets from '%s' (%s)",
+			          (path != NULL) ? path : "", knot_strerror(ret));
+			free(path);
+			server_wait(&server);
+			server_deinit(&server);
+			conf_free(conf());
+			log_close();
+			dnssec_crypto_cleanup();
+			return EXIT_FAILURE;
+		}
+		log_info("hand-off, received %zu sockets from '%s'",
+		         server.handoff.count, path);
+		free(path);
+	}
+
 	/* Reconfigure server workers, interfaces, and databases.
 	 * @note This MUST be done before we drop privileges. */
 	ret = server_reconfigure(conf(), &server);
@@ -772,7 +816,7 @@ int main(int argc, char **argv)
 	                      &conf()->query_plan);
 
 	/* Check and create PID file. */
-	unsigned long pid = pid_check_and_create();
+	unsigned long pid = pid_check_and_create(handoff);
 	if (pid == 0) {
 		server_wait(&server);
 		server_deinit(&server);
@@ -806,10 +850,10 @@ int main(int argc, char **argv)
 
 	stats_reconfigure(conf(), &server);
 
-	/* Start it up. */
+	/* Start it up, the previous server answers until the zones are loaded. */
 	log_info("starting server");
 	conf_val_t async_val = conf_get(conf(), C_SRV, C_ASYNC_START);
-	ret = server_start(&server, conf_bool(&async_val));
+	ret = server_start(&server, conf_bool(&async_val) && !handoff);
 	if (ret != KNOT_EOK) {
 		log_fatal("failed to start server (%s)", knot_strerror(ret));
 		server_wait(&server);
@@ -824,16 +868,30 @@ int main(int argc, char **argv)
 		return EXIT_FAILURE;
 	}
 
+	/* Let the previous server stop. */
+	handoff_finish(&server.handoff, true);
+
+	/* Listen for a future server instance. */
+	handoff_listener_t *handoff_lst = NULL;
+	char *path = handoff_path();
+	if (path != NULL) {
+		handoff_lst = handoff_listen(&server, path);
+		free(path);
+	}
+
 	/* Start the event loop. */
 	event_loop(&server, socket, daemonize, pid);
+	handoff_listener_free(handoff_lst);
 
 	/* Teardown server. */
 	server_stop(&server);
 	server_wait(&server);
 	stats_deinit();
 
-	/* Cleanup PID file. */
-	pid_cleanup();
+	/* Cleanup PID file, unless it's the new server's one. */
+	if (!(server.state & ServerHandedOff)) {
+		pid_cleanup();
+	}
 
 	/* Free server and configuration. */
 	server_deinit(&server);
@@ -45,6 +45,7 @@
 #include "libknot/quic/quic.h"
 #endif // ENABLE_QUIC
 #include "contrib/atomic.h"
+#include "contrib/macros.h"
 #include "contrib/openbsd/strlcpy.h"
 #include "contrib/os.h"
 #include "contrib/sockaddr.h"
@@ -54,18 +55,14 @@
 #include "utils/kxdpgun/ip_route.h"
 #include "utils/kxdpgun/load_queries.h"
 #include "utils/kxdpgun/main.h"
+#include "utils/kxdpgun/sock_gun.h"
 #include "utils/kxdpgun/stats.h"
 
 volatile int xdp_trigger = KXDPGUN_WAIT;
 
-knot_atomic_uint64_t stats_trigger;
-knot_atomic_bool stats_switch;
-
 unsigned global_cpu_aff_start = 0;
 unsigned global_cpu_aff_step = 1;
 
-static kxdpgun_stats_t global_stats = { 0 };
-
 const static xdp_gun_ctx_t ctx_defaults = {
 	.dev[0] = '\0',
 	.edns_size = 1232,
@@ -78,6 +75,7 @@ const static xdp_gun_ctx_t ctx_defaults = {
 	.xdp_config = { .ring_size = 2048 },
 	.jw = NULL,
 	.stats_period_ns = 0,
+	.sock_conns = 100,
 };
 
 static void sigterm_handler(int signo)
@@ -155,7 +153,11 @@ static void put_dns_payload(struct iovec *put_into, bool zero_copy, xdp_gun_ctx_
 		memcpy(put_into->iov_base, (*payl)->payload, (*payl)->len);
 	}
 	put_into->iov_len = (*payl)->len;
-	next_payload(payl, ctx->n_threads);
+	if (ctx->zipf) {
+		*payl = zipf_pick(&ctx->profile.rand);
+	} else {
+		next_payload(payl, ctx->n_threads);
+	}
 }
 
 #ifdef ENABLE_QUIC
@@ -348,6 +350,7 @@ void *xdp_gun_thread(void *_ctx)
 #endif // ENABLE_QUIC
 	list_t reuse_conns;
 	init_list(&reuse_conns);
+	uint64_t *sent_ts = NULL; // UDP query send times indexed by local port
 	const uint64_t extra_wait = ctx->quic ? 4000000 : 1000000;
 
 	if (ctx->tcp) {
@@ -376,6 +379,13 @@ void *xdp_gun_thread(void *_ctx)
 		assert(0);
 #endif // ENABLE_QUIC
 	}
+	if (!ctx->tcp && !ctx->quic && !(ctx->flags & KNOT_XDP_FILTER_DROP)) {
+		sent_ts = calloc(LOCAL_PORT_MAX + 1, sizeof(*sent_ts));
+		if (sent_ts == NULL) {
+			ERR2("failed to allocate latency table");
+			goto cleanup;
+		}
+	}
 
 	knot_xdp_load_bpf_t mode =
 		(ctx->thread_id == 0 ? KNOT_XDP_LOAD_BPF_ALWAYS : KNOT_XDP_LOAD_BPF_NEVER);
@@ -405,6 +415,7 @@ void *xdp_gun_thread(void *_ctx)
 
 	uint64_t tick = 0;
 	struct pkt_payload *payload_ptr = NULL;
+	rate_profile_init(&ctx->profile, ctx->thread_id);
 	next_payload(&payload_ptr, ctx->thread_id);
 
 #ifdef ENABLE_QUIC
@@ -532,9 +543,13 @@ void *xdp_gun_thread(void *_ctx)
 #endif // ENABLE_QUIC
 					break;
 				} else {
+					uint64_t now = timer_end_ns(&timer);
 					for (uint32_t i = 0; i < alloced; i++) {
 						put_dns_payload(&pkts[i].payload, false,
 						                ctx, &payload_ptr);
+						if (sent_ts != NULL) {
+							sent_ts[be16toh(pkts[i].ip_from.sin6_port)] = now;
+						}
 					}
 				}
 
@@ -722,8 +737,16 @@ void *xdp_gun_thread(void *_ctx)
 					(void)knot_xdp_send_finish(xsk);
 #endif // ENABLE_QUIC
 				} else {
+					uint64_t now = timer_end_ns(&timer);
 					for (uint32_t i = 0; i < recvd; i++) {
-						check_dns_payload(&pkts[i].payload, ctx, &periodic_stats);
+						if (!check_dns_payload(&pkts[i].payload, ctx, &periodic_stats)) {
+							continue;
+						}
+						uint64_t *ts = &sent_ts[be16toh(pkts[i].ip_to.sin6_port)];
+						if (*ts != 0 && *ts <= now) {
+							stats_add_rtt(&periodic_stats, now - *ts);
+							*ts = 0;
+						}
 					}
 				}
 				periodic_stats.wire_recv += wire;
@@ -741,44 +764,12 @@ void *xdp_gun_thread(void *_ctx)
 		// speed and signal part
 		uint64_t duration_ns = timer_end_ns(&timer);
 		duration_us = duration_ns / 1000;
-		uint64_t dura_exp = ((local_stats.qry_sent + periodic_stats.qry_sent) * 1000000) / ctx->qps;
-		if (ctx->thread_id == 0 && ctx->stats_period_ns != 0 && global_stats.collected == 0
-		    && (duration_ns - (periodic_stats.since - local_stats.since)) >= ctx->stats_period_ns) {
-			ATOMIC_SET(stats_switch, STATS_PERIODIC);
-			ATOMIC_ADD(stats_trigger, 1);
-		}
-
+		uint64_t dura_exp = rate_profile_due_us(&ctx->profile, ctx->qps, ctx->duration,
+		                                        local_stats.qry_sent + periodic_stats.qry_sent);
 		if (xdp_trigger == KXDPGUN_STOP && ctx->duration > duration_us) {
 			ctx->duration = duration_us;
 		}
-		uint64_t tmp_stats_trigger = ATOMIC_GET(stats_trigger);
-		if (duration_us < ctx->duration && tmp_stats_trigger > stats_triggered) {
-			bool tmp_stats_switch = ATOMIC_GET(stats_switch);
-			stats_triggered = tmp_stats_trigger;
-
-			local_stats.until = periodic_stats.until = local_stats.since + duration_ns;
-			kxdpgun_stats_t cumulative_stats = periodic_stats;
-			if (tmp_stats_switch == STATS_PERIODIC) {
-				collect_periodic_stats(&local_stats, &periodic_stats);
-				clear_stats(&periodic_stats);
-				periodic_stats.since = local_stats.since + duration_ns;
-			} else {
-				collect_periodic_stats(&cumulative_stats, &local_stats);
-				cumulative_stats.since = local_stats.since;
-			}
-
-			size_t collected = collect_stats(&global_stats, &cumulative_stats);
-
-			assert(collected <= ctx->n_threads);
-			if (collected == ctx->n_threads) {
-				STATS_FMT(ctx, &global_stats, tmp_stats_switch);
-				if (!JSON_MODE(*ctx)) {
-					puts(STATS_SECTION_SEP);
-				}
-				clear_stats(&global_stats);
-				ATOMIC_SET(stats_switch, STATS_SUM);
-			}
-		}
+		stats_tick(ctx, &local_stats, &periodic_stats, &stats_triggered, duration_ns);
 		if (dura_exp > duration_us) {
 			usleep(dura_exp - duration_us);
 		}
@@ -805,6 +796,7 @@ cleanup:
 		assert(EMPTY_LIST(reuse_conns));
 	}
 	knot_tcp_table_free(tcp_table);
+	free(sent_ts);
 
 #ifdef ENABLE_QUIC
 	knot_quic_table_free(quic_table);
@@ -907,6 +899,13 @@ static bool configure_target(char *target_str, char *local_ip, xdp_gun_ctx_t *ct
 		return false;
 	}
 
+	if (ctx->sock) {
+		long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+		cpus = MAX(cpus, 1);
+		ctx->n_threads = MIN(cpus, ctx->sock_conns);
+		return true;
+	}
+
 	struct sockaddr_storage via = { 0 };
 	if (local_ip == NULL || ctx->dev[0] == '\0' || mac_empty(ctx->target_mac)) {
 		char auto_dev[IFNAMSIZ];
@@ -993,6 +992,9 @@ static void print_help(void)
 	       " -U, --quic[=debug_mode]    "SPACE"Send queries over QUIC.\n"
 	       " -Q, --qps <qps>            "SPACE"Number of queries-per-second (approximately) to be sent.\n"
 	       "                            "SPACE" (default is %"PRIu64" qps)\n"
+	       " -P, --profile <spec>       "SPACE"Rate profile with -Q as the peak rate (const, ramp,\n"
+	       "                            "SPACE" step:<steps>, sine:<period_ms>, poisson).\n"
+	       " -z, --zipf <exponent>      "SPACE"Pick queries from the file with Zipf distribution.\n"
 	       " -b, --batch <size>         "SPACE"Send queries in a batch of defined size.\n"
 	       "                            "SPACE" (default is %d for UDP, %d for TCP)\n"
 	       " -r, --drop                 "SPACE"Drop incoming responses (disables response statistics).\n"
@@ -1010,6 +1012,10 @@ static void print_help(void)
 	       " -e, --edns-size <size>     "SPACE"EDNS UDP payload size, range 512-4096 (default 1232)\n"
 	       " -m, --mode <mode>          "SPACE"Set XDP mode (auto, copy, generic).\n"
 	       " -G, --qlog <path>          "SPACE"Output directory for qlog (useful for QUIC only).\n"
+	       " -K, --kernel[=tls]         "SPACE"Use kernel TCP (or TLS) sockets instead of XDP.\n"
+	       " -C, --connections <num>    "SPACE"Number of concurrent connections in kernel socket mode.\n"
+	       "                            "SPACE" (default is %u)\n"
+	       " -N, --churn <queries>      "SPACE"Reconnect after given number of queries in kernel socket mode.\n"
 	       " -j, --json                 "SPACE"Output statistics in json.\n"
 	       " -S, --stats-period <period>"SPACE"Enable periodic statistics printout in milliseconds.\n"
 	       " -h, --help                 "SPACE"Print the program help.\n"
@@ -1018,7 +1024,8 @@ static void print_help(void)
 	       "Parameters:\n"
 	       " <dest_ip>                "SPACE"IPv4 or IPv6 address of the remote destination.\n",
 	       PROGRAM_NAME, ctx_defaults.duration / 1000000, ctx_defaults.qps,
-	       ctx_defaults.at_once, 1, REMOTE_PORT_DEFAULT, REMOTE_PORT_DOQ_DEFAULT, "0s1");
+	       ctx_defaults.at_once, 1, REMOTE_PORT_DEFAULT, REMOTE_PORT_DOQ_DEFAULT, "0s1",
+	       ctx_defaults.sock_conns);
 }
 
 static bool sending_mode(const char *arg, xdp_gun_ctx_t *ctx)
@@ -1112,17 +1119,22 @@ static int set_mode(const char *arg, knot_xdp_config_t *config)
 
 static bool get_opts(int argc, char *argv[], xdp_gun_ctx_t *ctx)
 {
-	const char *opts_str = "hV::t:Q:b:rp:T::U::F:I:i:Bl:L:R:v:e:m:G:jS:";
+	const char *opts_str = "hV::t:Q:P:z:b:rp:T::U::K::C:N:F:I:i:Bl:L:R:v:e:m:G:jS:";
 	struct option opts[] = {
 		{ "help",         no_argument,       NULL, 'h' },
 		{ "version",      optional_argument, NULL, 'V' },
 		{ "duration",     required_argument, NULL, 't' },
 		{ "qps",          required_argument, NULL, 'Q' },
+		{ "profile",      required_argument, NULL, 'P' },
+		{ "zipf",         required_argument, NULL, 'z' },
 		{ "batch",        required_argument, NULL, 'b' },
 		{ "drop",         no_argument,       NULL, 'r' },
 		{ "port",         required_argument, NULL, 'p' },
 		{ "tcp",          optional_argument, NULL, 'T' },
 		{ "quic",         optional_argument, NULL, 'U' },
+		{ "kernel",       optional_argument, NULL, 'K' },
+		{ "connections",  required_argument, NULL, 'C' },
+		{ "churn",        required_argument, NULL, 'N' },
 		{ "affinity",     required_argument, NULL, 'F' },
 		{ "interface",    required_argument, NULL, 'I' },
 		{ "infile",       required_argument, NULL, 'i' },
@@ -1141,7 +1153,7 @@ static bool get_opts(int argc, char *argv[], xdp_gun_ctx_t *ctx)
 
 	int opt = 0, arg;
 	bool default_at_once = true;
-	double argf;
+	double argf, zipf_s = 0;
 	char *argcp, *local_ip = NULL;
 	input_t input = { .format = TXT };
 	while ((opt = getopt_long(argc, argv, opts_str, opts, NULL)) != -1) {
@@ -1173,6 +1185,23 @@ static bool get_opts(int argc, char *argv[], xdp_gun_ctx_t *ctx)
 				return false;
 			}
 			break;
+		case 'P':
+			assert(optarg);
+			if (!rate_profile_parse(optarg, &ctx->profile)) {
+				ERR2("invalid rate profile '%s'", optarg);
+				return false;
+			}
+			break;
+		case 'z':
+			assert(optarg);
+			zipf_s = strtod(optarg, NULL);
+			if (zipf_s > 0) {
+				ctx->zipf = true;
+			} else {
+				ERR2("invalid Zipf exponent '%s'", optarg);
+				return false;
+			}
+			break;
 		case 'b':
 			assert(optarg);
 			arg = atoi(optarg);
@@ -1230,6 +1259,41 @@ static bool get_opts(int argc, char *argv[], xdp_gun_ctx_t *ctx)
 			return false;
 #endif // ENABLE_QUIC
 			break;
+		case 'K':
+			ctx->sock = true;
+			if (optarg != NULL && strcmp(optarg, "tls") == 0) {
+				ctx->sock_tls = true;
+				if (ctx->target_port == 0) {
+					ctx->target_port = REMOTE_PORT_DOQ_DEFAULT;
+				}
+			} else if (optarg != NULL) {
+				ERR2("invalid kernel socket mode '%s'", optarg);
+				return false;
+			}
+			if (default_at_once) {
+				ctx->at_once = 1;
+			}
+			break;
+		case 'C':
+			assert(optarg);
+			arg = atoi(optarg);
+			if (arg > 0) {
+				ctx->sock_conns = arg;
+			} else {
+				ERR2("invalid number of connections '%s'", optarg);
+				return false;
+			}
+			break;
+		case 'N':
+			assert(optarg);
+			arg = atoi(optarg);
+			if (arg >= 0) {
+				ctx->sock_churn = arg;
+			} else {
+				ERR2("invalid churn '%s'", optarg);
+				return false;
+			}
+			break;
 		case 'F':
 			assert(optarg);
 			if ((arg = atoi(optarg)) > 0) {
@@ -1328,6 +1392,10 @@ static bool get_opts(int argc, char *argv[], xdp_gun_ctx_t *ctx)
 		print_help();
 		return false;
 	}
+	if (ctx->zipf && !zipf_init(zipf_s)) {
+		ERR2("out of memory");
+		return false;
+	}
 
 	if (ctx->target_port == 0) {
 		ctx->target_port = REMOTE_PORT_DEFAULT;
@@ -1402,7 +1470,8 @@ int main(int argc, char *argv[])
 		cpu_set_t set;
 		CPU_ZERO(&set);
 		CPU_SET(affinity, &set);
-		(void)pthread_create(&threads[i], NULL, xdp_gun_thread, &thread_ctxs[i]);
+		(void)pthread_create(&threads[i], NULL, ctx.sock ? sock_gun_thread : xdp_gun_thread,
+		                     &thread_ctxs[i]);
 		int ret = pthread_setaffinity_np(threads[i], sizeof(cpu_set_t), &set);
 		if (ret != 0) {
 			WARN2("failed to set affinity of thread#%zu to CPU#%u", i, affinity);
@@ -1432,6 +1501,7 @@ err:
 	free(ctx.rss_conf);
 	free(thread_ctxs);
 	free(threads);
+	zipf_deinit();
 	free_global_payloads();
 	if (JSON_MODE(ctx)) {
 		jsonw_end(ctx.jw);
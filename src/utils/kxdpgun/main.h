@@ -23,6 +23,7 @@
 #include "contrib/json.h"
 #include "libknot/xdp/eth.h"
 #include "libknot/xdp/tcp.h"
+#include "utils/kxdpgun/profile.h"
 
 #define PROGRAM_NAME "kxdpgun"
 #define SPACE        "  "
@@ -47,6 +48,8 @@ typedef enum {
 	KXDPGUN_REUSE_CONN      = (1 << 3),
 } xdp_gun_ignore_t;
 
+extern volatile int xdp_trigger;
+
 typedef struct xdp_gun_ctx {
 	union {
 		struct sockaddr_in local_ip4;
@@ -63,6 +66,7 @@ typedef struct xdp_gun_ctx {
 	uint64_t               runid;
 	uint64_t               stats_start_us;
 	uint64_t               stats_period_ns; // 0 means no periodic stats
+	rate_profile_t         profile;
 	unsigned               at_once;
 	uint16_t               msgid;
 	uint16_t               edns_size;
@@ -73,6 +77,11 @@ typedef struct xdp_gun_ctx {
 	bool                   tcp;
 	bool                   quic;
 	bool                   quic_full_handshake;
+	bool                   zipf;
+	bool                   sock;
+	bool                   sock_tls;
+	unsigned               sock_conns;
+	uint64_t               sock_churn;
 	const char             *qlog_dir;
 	const char             *sending_mode;
 	xdp_gun_ignore_t       ignore1;
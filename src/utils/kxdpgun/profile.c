@@ -0,0 +1,196 @@
+/*  Copyright (C) 2024 CZ.NIC, z.s.p.o. <knot-dns@labs.nic.cz>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "contrib/macros.h"
+#include "utils/kxdpgun/profile.h"
+
+static struct {
+	struct pkt_payload **payloads;
+	double *cdf;
+	size_t count;
+} zipf;
+
+static uint64_t rand_next(uint64_t *state)
+{
+	// xorshift64*
+	uint64_t x = *state;
+	x ^= x >> 12;
+	x ^= x << 25;
+	x ^= x >> 27;
+	*state = x;
+	return x * 0x2545F4914F6CDD1DULL;
+}
+
+static double rand_unit(uint64_t *state)
+{
+	return (rand_next(state) >> 11) * (1.0 / (1ULL << 53)); // [0, 1)
+}
+
+bool rate_profile_parse(const char *spec, rate_profile_t *profile)
+{
+	const char *arg = strchr(spec, ':');
+	size_t name_len = (arg != NULL) ? arg - spec : strlen(spec);
+	long val = (arg != NULL) ? strtol(arg + 1, NULL, 10) : 0;
+
+	memset(profile, 0, sizeof(*profile));
+
+#define IS(name) (name_len == sizeof(name) - 1 && strncmp(spec, name, name_len) == 0)
+	if (IS("const") && arg == NULL) {
+		profile->type = RATE_CONST;
+	} else if (IS("ramp") && arg == NULL) {
+		profile->type = RATE_RAMP;
+	} else if (IS("step") && val > 0) {
+		profile->type = RATE_STEP;
+		profile->steps = val;
+	} else if (IS("sine") && val > 0) {
+		profile->type = RATE_SINE;
+		profile->period_us = val * 1000;
+	} else if (IS("poisson") && arg == NULL) {
+		profile->type = RATE_POISSON;
+	} else {
+		return false;
+	}
+#undef IS
+
+	return true;
+}
+
+void rate_profile_init(rate_profile_t *profile, unsigned thread_id)
+{
+	profile->next_us = 0;
+	profile->counted = 0;
+	profile->rand = 0x9E3779B97F4A7C15ULL * (thread_id + 1);
+}
+
+// Queries due by the given time with the sine profile.
+static double sine_queries(double qps, double period_s, double t)
+{
+	return qps / 2 * (t - period_s / (2 * M_PI) * sin(2 * M_PI * t / period_s));
+}
+
+uint64_t rate_profile_due_us(rate_profile_t *profile, uint64_t qps,
+                             uint64_t duration_us, uint64_t sent)
+{
+	double d = duration_us / 1000000.0;
+	double n = sent;
+	double t;
+
+	switch (profile->type) {
+	case RATE_RAMP:
+		// n = qps * t^2 / (2 * d)
+		t = sqrt(2 * d * n / qps);
+		break;
+	case RATE_STEP:;
+		double step_len = d / profile->steps;
+		t = 0;
+		for (unsigned i = 1; i <= profile->steps; i++) {
+			double rate = (double)qps * i / profile->steps;
+			if (n <= rate * step_len || i == profile->steps) {
+				t += n / rate;
+				break;
+			}
+			n -= rate * step_len;
+			t += step_len;
+		}
+		break;
+	case RATE_SINE:;
+		// The number of due queries is monotonic in time, bisect it.
+		double period = profile->period_us / 1000000.0, lo = 0, hi = 1;
+		while (sine_queries(qps, period, hi) < n) {
+			hi *= 2;
+		}
+		for (int i = 0; i < 40; i++) {
+			t = (lo + hi) / 2;
+			if (sine_queries(qps, period, t) < n) {
+				lo = t;
+			} else {
+				hi = t;
+			}
+		}
+		t = hi;
+		break;
+	case RATE_POISSON:
+		// Exponentially distributed inter-arrival times.
+		while (profile->counted < sent) {
+			double gap = -log(1.0 - rand_unit(&profile->rand)) / qps;
+			profile->next_us += gap * 1000000.0;
+			profile->counted++;
+		}
+		return profile->next_us;
+	default:
+		t = n / qps;
+		break;
+	}
+
+	return t * 1000000.0;
+}
+
+bool zipf_init(double s)
+{
+	size_t count = 0;
+	for (struct pkt_payload *p = global_payloads; p != NULL; p = p->next) {
+		count++;
+	}
+
+	zipf.payloads = malloc(count * sizeof(*zipf.payloads));
+	zipf.cdf = malloc(count * sizeof(*zipf.cdf));
+	if (zipf.payloads == NULL || zipf.cdf == NULL) {
+		zipf_deinit();
+		return false;
+	}
+
+	double sum = 0;
+	size_t i = 0;
+	for (struct pkt_payload *p = global_payloads; p != NULL; p = p->next, i++) {
+		sum += 1.0 / pow(i + 1, s);
+		zipf.payloads[i] = p;
+		zipf.cdf[i] = sum;
+	}
+	for (i = 0; i < count; i++) {
+		zipf.cdf[i] /= sum;
+	}
+	zipf.count = count;
+
+	return true;
+}
+
+struct pkt_payload *zipf_pick(uint64_t *rand)
+{
+	double u = rand_unit(rand);
+
+	size_t lo = 0, hi = zipf.count - 1;
+	while (lo < hi) {
+		size_t mid = lo + (hi - lo) / 2;
+		if (zipf.cdf[mid] <= u) {
+			lo = mid + 1;
+		} else {
+			hi = mid;
+		}
+	}
+
+	return zipf.payloads[lo];
+}
+
+void zipf_deinit(void)
+{
+	free(zipf.payloads);
+	free(zipf.cdf);
+	memset(&zipf, 0, sizeof(zipf));
+}
@@ -0,0 +1,79 @@
+/*  Copyright (C) 2024 CZ.NIC, z.s.p.o. <knot-dns@labs.nic.cz>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "utils/kxdpgun/load_queries.h"
+
+typedef enum {
+	RATE_CONST = 0, // Fixed rate.
+	RATE_RAMP,      // Linear increase from zero to the full rate.
+	RATE_STEP,      // Increase in equal steps up to the full rate.
+	RATE_SINE,      // Oscillation between zero and the full rate.
+	RATE_POISSON,   // Poisson arrivals with the mean of the full rate.
+} rate_profile_type_t;
+
+typedef struct {
+	rate_profile_type_t type;
+	unsigned steps;      // Number of steps for RATE_STEP.
+	uint64_t period_us;  // Oscillation period for RATE_SINE.
+	uint64_t next_us;    // Due time of the next query for RATE_POISSON.
+	uint64_t counted;    // Queries accounted in next_us.
+	uint64_t rand;       // Per-thread random state.
+} rate_profile_t;
+
+/*!
+ * \brief Parse rate profile specification.
+ *
+ * The format is one of: const, ramp, step:<steps>, sine:<period_ms>, poisson.
+ */
+bool rate_profile_parse(const char *spec, rate_profile_t *profile);
+
+/*!
+ * \brief Initialize per-thread profile state.
+ */
+void rate_profile_init(rate_profile_t *profile, unsigned thread_id);
+
+/*!
+ * \brief Compute time when the query following the already sent ones is due.
+ *
+ * \param profile      Rate profile.
+ * \param qps          Full (peak) rate of the thread.
+ * \param duration_us  Total duration of traffic generation.
+ * \param sent         Number of queries sent so far.
+ *
+ * \return Microseconds since the traffic generation start.
+ */
+uint64_t rate_profile_due_us(rate_profile_t *profile, uint64_t qps,
+                             uint64_t duration_us, uint64_t sent);
+
+/*!
+ * \brief Prepare Zipf-distributed selection of the loaded queries.
+ *
+ * \param s   Zipf exponent, the query on position i (from 1) is picked
+ *            with probability proportional to 1 / i^s.
+ */
+bool zipf_init(double s);
+
+/*!
+ * \brief Pick a random query according to the prepared Zipf distribution.
+ */
+struct pkt_payload *zipf_pick(uint64_t *rand);
+
+void zipf_deinit(void);
@@ -0,0 +1,355 @@
+/*  Copyright (C) 2024 CZ.NIC, z.s.p.o. <knot-dns@labs.nic.cz>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include <assert.h>
+#include <poll.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "contrib/macros.h"
+#include "contrib/net.h"
+#include "contrib/sockaddr.h"
+#include "libknot/libknot.h"
+#include "libknot/quic/tls.h"
+#include "libknot/quic/tls_common.h"
+#include "utils/common/msg.h"
+#include "utils/kxdpgun/load_queries.h"
+#include "utils/kxdpgun/main.h"
+#include "utils/kxdpgun/sock_gun.h"
+#include "utils/kxdpgun/stats.h"
+
+#define SOCK_IO_TIMEOUT 2000 // milliseconds
+#define SOCK_EXTRA_WAIT 1000000 // microseconds
+
+typedef enum {
+	SOCK_CLOSED = 0,
+	SOCK_CONNECTING,
+	SOCK_HANDSHAKE,
+	SOCK_READY,
+} sock_state_t;
+
+typedef struct {
+	int fd;
+	sock_state_t state;
+	knot_tls_conn_t *tls;
+	struct knot_tls_session *session; // Saved for resumption by the next connection.
+	uint64_t queries;   // Queries sent over the current connection.
+	unsigned inflight;  // Queries waiting for a reply.
+	unsigned first;     // Index of the oldest send time in sent_ts.
+	uint64_t *sent_ts;  // Ring of send times, size of the pipelining depth.
+} sock_conn_t;
+
+typedef struct {
+	xdp_gun_ctx_t *ctx;
+	knot_tls_ctx_t *tls_ctx;
+	struct sockaddr_storage target;
+	struct timespec start;
+	struct pkt_payload *payload;
+	kxdpgun_stats_t *stats;
+} sock_gun_t;
+
+static uint64_t timestamp_ns(void)
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_REALTIME, &ts);
+	return ((uint64_t)ts.tv_sec * 1000000000) + ts.tv_nsec;
+}
+
+static uint64_t elapsed_ns(const struct timespec *start)
+{
+	struct timespec now;
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return (now.tv_sec - start->tv_sec) * (uint64_t)1000000000 +
+	       now.tv_nsec - start->tv_nsec;
+}
+
+static struct pkt_payload *next_query(sock_gun_t *gun)
+{
+	struct pkt_payload *res = gun->payload;
+	if (gun->ctx->zipf) {
+		gun->payload = zipf_pick(&gun->ctx->profile.rand);
+		return res;
+	}
+	for (unsigned i = 0; i < gun->ctx->n_threads; i++) {
+		gun->payload = (gun->payload->next != NULL) ? gun->payload->next
+		                                            : global_payloads;
+	}
+	return res;
+}
+
+static void conn_close(sock_gun_t *gun, sock_conn_t *conn)
+{
+	if (conn->tls != NULL) {
+		if (conn->session == NULL) {
+			conn->session = knot_tls_session_save(conn->tls);
+		}
+		knot_tls_conn_del(conn->tls);
+		conn->tls = NULL;
+	}
+	if (conn->fd >= 0) {
+		close(conn->fd);
+		conn->fd = -1;
+	}
+	gun->stats->lost += conn->inflight;
+	conn->state = SOCK_CLOSED;
+	conn->queries = 0;
+	conn->inflight = 0;
+	conn->first = 0;
+}
+
+static void conn_open(sock_gun_t *gun, sock_conn_t *conn)
+{
+	conn->fd = net_connected_socket(SOCK_STREAM, &gun->target, NULL, false);
+	if (conn->fd < 0) {
+		gun->stats->errors++;
+		return;
+	}
+
+	if (gun->tls_ctx != NULL) {
+		conn->tls = knot_tls_conn_new(gun->tls_ctx, conn->fd);
+		if (conn->tls == NULL) {
+			gun->stats->errors++;
+			conn_close(gun, conn);
+			return;
+		}
+		if (conn->session != NULL) {
+			(void)knot_tls_session_load(conn->tls, conn->session); // Consumed.
+			conn->session = NULL;
+		}
+	}
+
+	conn->state = SOCK_CONNECTING;
+}
+
+static void conn_connected(sock_gun_t *gun, sock_conn_t *conn)
+{
+	if (conn->state == SOCK_CONNECTING) {
+		if (!net_is_connected(conn->fd)) {
+			gun->stats->errors++;
+			conn_close(gun, conn);
+			return;
+		}
+		if (conn->tls == NULL) {
+			gun->stats->synack_recv++;
+			conn->state = SOCK_READY;
+			return;
+		}
+		conn->state = SOCK_HANDSHAKE;
+	}
+
+	int ret = knot_tls_handshake(conn->tls, true);
+	if (ret == KNOT_EOK) {
+		gun->stats->synack_recv++;
+		conn->state = SOCK_READY;
+	} else if (ret != KNOT_EAGAIN) {
+		gun->stats->errors++;
+		conn_close(gun, conn);
+	}
+}
+
+static void conn_send(sock_gun_t *gun, sock_conn_t *conn, uint64_t now)
+{
+	struct pkt_payload *query = next_query(gun);
+
+	ssize_t ret;
+	if (conn->tls != NULL) {
+		ret = knot_tls_send_dns(conn->tls, query->payload, query->len);
+	} else {
+		ret = net_dns_tcp_send(conn->fd, query->payload, query->len,
+		                       SOCK_IO_TIMEOUT, NULL);
+	}
+	if (ret != query->len) {
+		gun->stats->errors++;
+		conn_close(gun, conn);
+		return;
+	}
+
+	unsigned depth = gun->ctx->at_once;
+	conn->sent_ts[(conn->first + conn->inflight) % depth] = now;
+	conn->inflight++;
+	conn->queries++;
+	gun->stats->qry_sent++;
+}
+
+static void conn_recv(sock_gun_t *gun, sock_conn_t *conn)
+{
+	uint8_t buf[KNOT_WIRE_MAX_PKTSIZE];
+
+	do {
+		ssize_t ret;
+		if (conn->tls != NULL) {
+			ret = knot_tls_recv_dns(conn->tls, buf, sizeof(buf));
+		} else {
+			ret = net_dns_tcp_recv(conn->fd, buf, sizeof(buf), SOCK_IO_TIMEOUT);
+		}
+		if (ret < KNOT_WIRE_HEADER_SIZE) {
+			if (ret != KNOT_ECONN) { // Not just closed by the server.
+				gun->stats->errors++;
+			}
+			conn_close(gun, conn);
+			return;
+		}
+
+		uint64_t now = elapsed_ns(&gun->start);
+		gun->stats->rcodes_recv[knot_wire_get_rcode(buf)]++;
+		gun->stats->size_recv += ret;
+		gun->stats->wire_recv += ret + sizeof(uint16_t);
+		gun->stats->ans_recv++;
+
+		// Knot answers the pipelined queries of a connection in order.
+		if (conn->inflight > 0) {
+			stats_add_rtt(gun->stats, now - conn->sent_ts[conn->first]);
+			conn->first = (conn->first + 1) % gun->ctx->at_once;
+			conn->inflight--;
+		}
+	} while (conn->tls != NULL && knot_tls_recv_pending(conn->tls));
+}
+
+void *sock_gun_thread(void *_ctx)
+{
+	xdp_gun_ctx_t *ctx = _ctx;
+	kxdpgun_stats_t local_stats = { 0 }; // cumulative stats of past periods excluding the current
+	kxdpgun_stats_t periodic_stats = { 0 }; // stats for the current period (see -S option)
+	unsigned stats_triggered = 0;
+	struct knot_creds *creds = NULL;
+
+	// Spread the connections over the threads.
+	unsigned count = ctx->sock_conns / ctx->n_threads +
+	                 (ctx->thread_id < ctx->sock_conns % ctx->n_threads);
+	unsigned depth = ctx->at_once;
+
+	sock_gun_t gun = {
+		.ctx = ctx,
+		.stats = &periodic_stats,
+	};
+	memcpy(&gun.target, &ctx->target_ip_ss, sizeof(gun.target));
+	sockaddr_port_set(&gun.target, ctx->target_port);
+
+	sock_conn_t *conns = calloc(count, sizeof(*conns));
+	uint64_t *sent_ts = calloc(count * depth, sizeof(*sent_ts));
+	struct pollfd *pfds = calloc(count, sizeof(*pfds));
+	if (conns == NULL || sent_ts == NULL || pfds == NULL) {
+		ERR2("failed to allocate connections");
+		goto cleanup;
+	}
+	for (unsigned i = 0; i < count; i++) {
+		conns[i].fd = -1;
+		conns[i].sent_ts = sent_ts + i * depth;
+	}
+
+	if (ctx->sock_tls) {
+		creds = knot_creds_init_peer(NULL, NULL, 0);
+		if (creds != NULL) {
+			gun.tls_ctx = knot_tls_ctx_new(creds, SOCK_IO_TIMEOUT, SOCK_IO_TIMEOUT, false);
+		}
+		if (gun.tls_ctx == NULL) {
+			ERR2("failed to initialize TLS context");
+			goto cleanup;
+		}
+	}
+
+	if (ctx->thread_id == 0) {
+		STATS_HDR(ctx);
+	}
+
+	while (xdp_trigger == KXDPGUN_WAIT) {
+		usleep(1000);
+	}
+
+	rate_profile_init(&ctx->profile, ctx->thread_id);
+	gun.payload = global_payloads;
+	for (unsigned i = 0; i < ctx->thread_id; i++) {
+		(void)next_query(&gun);
+	}
+
+	local_stats.since = periodic_stats.since = timestamp_ns();
+	clock_gettime(CLOCK_MONOTONIC, &gun.start);
+	ctx->stats_start_us = local_stats.since / 1000;
+
+	uint64_t duration_us = 0;
+	while (duration_us < ctx->duration + SOCK_EXTRA_WAIT) {
+		bool sending = (duration_us < ctx->duration);
+		uint64_t now = elapsed_ns(&gun.start);
+
+		for (unsigned i = 0; i < count; i++) {
+			sock_conn_t *conn = &conns[i];
+			if (conn->state == SOCK_READY && ctx->sock_churn > 0 &&
+			    conn->queries >= ctx->sock_churn && conn->inflight == 0) {
+				conn_close(&gun, conn);
+			}
+			if (conn->state == SOCK_CLOSED && sending) {
+				conn_open(&gun, conn);
+			}
+			while (conn->state == SOCK_READY && sending && conn->inflight < depth &&
+			       (ctx->sock_churn == 0 || conn->queries < ctx->sock_churn) &&
+			       rate_profile_due_us(&ctx->profile, ctx->qps, ctx->duration,
+			                           local_stats.qry_sent + periodic_stats.qry_sent) <= now / 1000) {
+				conn_send(&gun, conn, now);
+			}
+
+			pfds[i].fd = conn->fd;
+			pfds[i].events = (conn->state == SOCK_CONNECTING) ? POLLOUT : POLLIN;
+			pfds[i].revents = 0;
+		}
+
+		if (poll(pfds, count, 1) > 0) {
+			for (unsigned i = 0; i < count; i++) {
+				sock_conn_t *conn = &conns[i];
+				if (pfds[i].revents == 0 || conn->fd != pfds[i].fd) {
+					continue;
+				}
+				if (conn->state == SOCK_CONNECTING || conn->state == SOCK_HANDSHAKE) {
+					conn_connected(&gun, conn);
+				} else if (pfds[i].revents & (POLLIN | POLLHUP | POLLERR)) {
+					conn_recv(&gun, conn);
+				}
+			}
+		}
+
+		uint64_t duration_ns = elapsed_ns(&gun.start);
+		duration_us = duration_ns / 1000;
+		if (xdp_trigger == KXDPGUN_STOP && ctx->duration > duration_us) {
+			ctx->duration = duration_us;
+		}
+		stats_tick(ctx, &local_stats, &periodic_stats, &stats_triggered, duration_ns);
+	}
+
+	for (unsigned i = 0; i < count; i++) {
+		conn_close(&gun, &conns[i]);
+	}
+	periodic_stats.until = local_stats.since + elapsed_ns(&gun.start) - SOCK_EXTRA_WAIT * 1000;
+	collect_periodic_stats(&local_stats, &periodic_stats);
+
+	STATS_THRD(ctx, &local_stats);
+
+	collect_stats(&global_stats, &local_stats);
+
+cleanup:
+	for (unsigned i = 0; conns != NULL && i < count; i++) {
+		if (conns[i].session != NULL) {
+			(void)knot_tls_session_load(NULL, conns[i].session); // Frees.
+		}
+	}
+	knot_tls_ctx_free(gun.tls_ctx);
+	knot_creds_free(creds);
+	free(pfds);
+	free(sent_ts);
+	free(conns);
+
+	return NULL;
+}
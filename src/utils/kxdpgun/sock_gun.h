@@ -0,0 +1,27 @@
+/*  Copyright (C) 2024 CZ.NIC, z.s.p.o. <knot-dns@labs.nic.cz>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+/*!
+ * \brief Traffic generation thread using kernel TCP (optionally TLS) sockets.
+ *
+ * Each thread keeps its share of persistent connections to the target,
+ * pipelines up to the configured depth of queries on each of them and
+ * optionally reconnects after a number of queries (connection churn),
+ * resuming TLS sessions from the previous connection.
+ */
+void *sock_gun_thread(void *ctx);
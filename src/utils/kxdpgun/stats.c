@@ -29,6 +29,11 @@
 
 pthread_mutex_t stdout_mtx = PTHREAD_MUTEX_INITIALIZER;
 
+knot_atomic_uint64_t stats_trigger;
+knot_atomic_bool stats_switch;
+
+kxdpgun_stats_t global_stats = { 0 };
+
 void clear_stats(kxdpgun_stats_t *st)
 {
 	pthread_mutex_lock(&st->mutex);
@@ -45,6 +50,8 @@ void clear_stats(kxdpgun_stats_t *st)
 	st->lost        = 0;
 	st->errors      = 0;
 	memset(st->rcodes_recv, 0, sizeof(st->rcodes_recv));
+	st->rtt_count   = 0;
+	memset(st->rtt_hist, 0, sizeof(st->rtt_hist));
 	pthread_mutex_unlock(&st->mutex);
 }
 
@@ -73,10 +80,108 @@ void collect_periodic_stats(kxdpgun_stats_t *into, const kxdpgun_stats_t *what)
 	for (int i = 0; i < RCODE_MAX; i++) {
 		into->rcodes_recv[i] += what->rcodes_recv[i];
 	}
+	into->rtt_count   += what->rtt_count;
+	for (int i = 0; i < RTT_HIST_SIZE; i++) {
+		into->rtt_hist[i] += what->rtt_hist[i];
+	}
+}
+
+#define RTT_SUB (1 << RTT_HIST_SUB_BITS)
+
+static unsigned rtt_bucket(uint64_t us)
+{
+	if (us < RTT_SUB) {
+		return us;
+	}
+	unsigned msb = 63 - __builtin_clzll(us);
+	unsigned sub = (us >> (msb - RTT_HIST_SUB_BITS)) & (RTT_SUB - 1);
+	return MIN((msb - RTT_HIST_SUB_BITS + 1) * RTT_SUB + sub, RTT_HIST_SIZE - 1);
+}
+
+static uint64_t rtt_bucket_min(unsigned idx)
+{
+	if (idx < RTT_SUB) {
+		return idx;
+	}
+	unsigned shift = idx / RTT_SUB - 1;
+	return (uint64_t)(RTT_SUB + idx % RTT_SUB) << shift;
+}
+
+void stats_add_rtt(kxdpgun_stats_t *st, uint64_t rtt_ns)
+{
+	st->rtt_hist[rtt_bucket(rtt_ns / 1000)]++;
+	st->rtt_count++;
+}
+
+uint64_t stats_rtt_percentile(const kxdpgun_stats_t *st, unsigned permille)
+{
+	if (st->rtt_count == 0) {
+		return 0;
+	}
+
+	// Rank of the sample, rounded up.
+	uint64_t rank = (st->rtt_count * permille + 999) / 1000;
+	uint64_t seen = 0;
+	for (unsigned i = 0; i < RTT_HIST_SIZE; i++) {
+		seen += st->rtt_hist[i];
+		if (seen >= rank && seen > 0) {
+			return rtt_bucket_min(i);
+		}
+	}
+	return rtt_bucket_min(RTT_HIST_SIZE - 1);
+}
+
+void stats_tick(const xdp_gun_ctx_t *ctx, kxdpgun_stats_t *local_stats,
+                kxdpgun_stats_t *periodic_stats, unsigned *stats_triggered,
+                uint64_t duration_ns)
+{
+	uint64_t duration_us = duration_ns / 1000;
+
+	if (ctx->thread_id == 0 && ctx->stats_period_ns != 0 && global_stats.collected == 0
+	    && (duration_ns - (periodic_stats->since - local_stats->since)) >= ctx->stats_period_ns) {
+		ATOMIC_SET(stats_switch, STATS_PERIODIC);
+		ATOMIC_ADD(stats_trigger, 1);
+	}
+
+	uint64_t tmp_stats_trigger = ATOMIC_GET(stats_trigger);
+	if (duration_us < ctx->duration && tmp_stats_trigger > *stats_triggered) {
+		bool tmp_stats_switch = ATOMIC_GET(stats_switch);
+		*stats_triggered = tmp_stats_trigger;
+
+		local_stats->until = periodic_stats->until = local_stats->since + duration_ns;
+		kxdpgun_stats_t cumulative_stats = *periodic_stats;
+		if (tmp_stats_switch == STATS_PERIODIC) {
+			collect_periodic_stats(local_stats, periodic_stats);
+			clear_stats(periodic_stats);
+			periodic_stats->since = local_stats->since + duration_ns;
+		} else {
+			collect_periodic_stats(&cumulative_stats, local_stats);
+			cumulative_stats.since = local_stats->since;
+		}
+
+		size_t collected = collect_stats(&global_stats, &cumulative_stats);
+
+		assert(collected <= ctx->n_threads);
+		if (collected == ctx->n_threads) {
+			STATS_FMT(ctx, &global_stats, tmp_stats_switch);
+			if (!JSON_MODE(*ctx)) {
+				puts(STATS_SECTION_SEP);
+			}
+			clear_stats(&global_stats);
+			ATOMIC_SET(stats_switch, STATS_SUM);
+		}
+	}
 }
 
 void plain_stats_header(const xdp_gun_ctx_t *ctx)
 {
+	if (ctx->sock) {
+		INFO2("using kernel sockets, threads %u, IPv%c/%s, %u connections",
+		      ctx->n_threads, (ctx->ipv6 ? '6' : '4'),
+		      (ctx->sock_tls ? "TLS" : "TCP"), ctx->sock_conns);
+		puts(STATS_SECTION_SEP);
+		return;
+	}
 	INFO2("using interface %s, XDP threads %u, IPv%c/%s%s%s, %s mode", ctx->dev, ctx->n_threads,
 	      (ctx->ipv6 ? '6' : '4'),
 	      (ctx->tcp ? "TCP" : ctx->quic ? "QUIC" : "UDP"),
@@ -119,20 +224,27 @@ void json_stats_header(const xdp_gun_ctx_t *ctx)
 		// mirror the info given by the plaintext printout
 		jsonw_object(w, "additional_info");
 		{
-			jsonw_str(w, "interface", ctx->dev);
-			jsonw_int(w, "xdp_threads", ctx->n_threads);
-			jsonw_int(w, "ip_version", ctx->ipv6 ? 6 : 4);
-			jsonw_str(w, "transport_layer_proto", ctx->tcp ? "TCP" : (ctx->quic ? "QUIC" : "UDP"));
-			jsonw_object(w, "mode_info");
-			{
-				if (ctx->sending_mode[0] != '\0') {
-					jsonw_str(w, "debug", ctx->sending_mode);
+			if (ctx->sock) {
+				jsonw_int(w, "threads", ctx->n_threads);
+				jsonw_int(w, "ip_version", ctx->ipv6 ? 6 : 4);
+				jsonw_str(w, "transport_layer_proto", ctx->sock_tls ? "TLS" : "TCP");
+				jsonw_int(w, "connections", ctx->sock_conns);
+			} else {
+				jsonw_str(w, "interface", ctx->dev);
+				jsonw_int(w, "xdp_threads", ctx->n_threads);
+				jsonw_int(w, "ip_version", ctx->ipv6 ? 6 : 4);
+				jsonw_str(w, "transport_layer_proto", ctx->tcp ? "TCP" : (ctx->quic ? "QUIC" : "UDP"));
+				jsonw_object(w, "mode_info");
+				{
+					if (ctx->sending_mode[0] != '\0') {
+						jsonw_str(w, "debug", ctx->sending_mode);
+					}
+					jsonw_str(w, "mode", knot_eth_xdp_mode(if_nametoindex(ctx->dev)) == KNOT_XDP_MODE_FULL
+								? "native"
+								: "emulated");
 				}
-				jsonw_str(w, "mode", knot_eth_xdp_mode(if_nametoindex(ctx->dev)) == KNOT_XDP_MODE_FULL
-							? "native"
-							: "emulated");
+				jsonw_end(w);
 			}
-			jsonw_end(w);
 		}
 		jsonw_end(w);
 	}
@@ -217,8 +329,8 @@ void plain_stats(const xdp_gun_ctx_t *ctx, kxdpgun_stats_t *st, stats_type_t stt
 	printf("total %s    %"PRIu64" (%s pps) (%f %%)\n", name, st->qry_sent,
 	       pretty_print_pps, 100.0 * st->qry_sent / (duration / 1000000.0 * ctx->qps * ctx->n_threads));
 	if (st->qry_sent > 0 && recv) {
-		if (ctx->tcp || ctx->quic) {
-		name = ctx->tcp ? "established:" : "handshakes: ";
+		if (ctx->tcp || ctx->quic || ctx->sock) {
+		name = (ctx->tcp || (ctx->sock && !ctx->sock_tls)) ? "established:" : "handshakes: ";
 		format_with_separators(ps(st->synack_recv), pretty_print_pps);
 		printf("total %s %"PRIu64" (%s pps) (%f %%)\n", name,
 		       st->synack_recv, pretty_print_pps, pct(st->synack_recv));
@@ -240,6 +352,11 @@ void plain_stats(const xdp_gun_ctx_t *ctx, kxdpgun_stats_t *st, stats_type_t stt
 		       st->ans_recv > 0 ? st->size_recv / st->ans_recv : 0);
 		printf("average Ethernet reply rate: %"PRIu64" bps (%.2f Mbps)\n",
 		       ps(st->wire_recv * 8), ps((float)st->wire_recv * 8 / (1000 * 1000)));
+		if (st->rtt_count > 0) {
+			printf("reply latency: p50 %"PRIu64" us, p99 %"PRIu64" us, p99.9 %"PRIu64" us\n",
+			       stats_rtt_percentile(st, 500), stats_rtt_percentile(st, 990),
+			       stats_rtt_percentile(st, 999));
+		}
 
 		for (int i = 0; i < RCODE_MAX; i++) {
 			if (st->rcodes_recv[i] > 0) {
@@ -290,16 +407,40 @@ void json_stats(const xdp_gun_ctx_t *ctx, kxdpgun_stats_t *st, stats_type_t stt)
 		}
 		jsonw_end(w);
 
+		if (st->rtt_count > 0) {
+			jsonw_object(w, "latency");
+			{
+				jsonw_ulong(w, "count", st->rtt_count);
+				jsonw_ulong(w, "p50_us", stats_rtt_percentile(st, 500));
+				jsonw_ulong(w, "p99_us", stats_rtt_percentile(st, 990));
+				jsonw_ulong(w, "p999_us", stats_rtt_percentile(st, 999));
+
+				// Pairs of bucket lower bound in microseconds and count.
+				jsonw_list(w, "histogram");
+				for (unsigned i = 0; i < RTT_HIST_SIZE; i++) {
+					if (st->rtt_hist[i] > 0) {
+						jsonw_list(w, NULL);
+						jsonw_ulong(w, NULL, rtt_bucket_min(i));
+						jsonw_ulong(w, NULL, st->rtt_hist[i]);
+						jsonw_end(w);
+					}
+				}
+				jsonw_end(w);
+			}
+			jsonw_end(w);
+		}
+
 		jsonw_object(w, "conn_info");
 		{
-			jsonw_str(w, "type", ctx->tcp ? "tcp" : (ctx->quic ? "quic_conn" : "udp"));
+			jsonw_str(w, "type", (ctx->tcp || ctx->sock) ? (ctx->sock_tls ? "tls" : "tcp")
+			                                             : (ctx->quic ? "quic_conn" : "udp"));
 
 			// TODO:
 			// packets_sent
 			// packets_recieved
 
 			jsonw_ulong(w, "socket_errors", st->errors);
-			if (ctx->tcp || ctx->quic) {
+			if (ctx->tcp || ctx->quic || ctx->sock) {
 				jsonw_ulong(w, "handshakes", st->synack_recv);
 				// TODO: handshakes_failed
 				if (ctx->quic) {
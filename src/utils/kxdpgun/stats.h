@@ -21,10 +21,15 @@
 #include <pthread.h>
 #include <stdbool.h>
 
+#include "contrib/atomic.h"
 #include "utils/kxdpgun/main.h"
 
 #define RCODE_MAX (0x0F + 1)
 
+// Log-linear RTT histogram in microseconds, 8 buckets per power of two.
+#define RTT_HIST_SUB_BITS 3
+#define RTT_HIST_SIZE     256
+
 #define STATS_SECTION_SEP "--------------------------------------------------------------"
 
 #define JSON_INDENT		"  "
@@ -54,6 +59,8 @@ typedef struct {
 	uint64_t	errors;
 	uint64_t	lost;
 	uint64_t	rcodes_recv[RCODE_MAX];
+	uint64_t	rtt_count;
+	uint64_t	rtt_hist[RTT_HIST_SIZE];
 	pthread_mutex_t	mutex;
 } kxdpgun_stats_t;
 
@@ -66,6 +73,19 @@ void clear_stats(kxdpgun_stats_t *st);
 size_t collect_stats(kxdpgun_stats_t *into, const kxdpgun_stats_t *what);
 void collect_periodic_stats(kxdpgun_stats_t *into, const kxdpgun_stats_t *what);
 
+/*!
+ * \brief Handle a pending periodic or signalled statistics printout.
+ *
+ * Called repeatedly by each thread with its own statistics, the output is
+ * printed once all the threads have contributed.
+ */
+void stats_tick(const xdp_gun_ctx_t *ctx, kxdpgun_stats_t *local_stats,
+                kxdpgun_stats_t *periodic_stats, unsigned *stats_triggered,
+                uint64_t duration_ns);
+
+void stats_add_rtt(kxdpgun_stats_t *st, uint64_t rtt_ns);
+uint64_t stats_rtt_percentile(const kxdpgun_stats_t *st, unsigned permille);
+
 void plain_stats_header(const xdp_gun_ctx_t *ctx);
 void json_stats_header(const xdp_gun_ctx_t *ctx);
 
@@ -76,3 +96,8 @@ void plain_stats(const xdp_gun_ctx_t *ctx, kxdpgun_stats_t *st, stats_type_t stt
 void json_stats(const xdp_gun_ctx_t *ctx, kxdpgun_stats_t *st, stats_type_t stt);
 
 extern pthread_mutex_t stdout_mtx;
+
+extern knot_atomic_uint64_t stats_trigger;
+extern knot_atomic_bool stats_switch;
+
+extern kxdpgun_stats_t global_stats;
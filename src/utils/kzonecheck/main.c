@@ -18,6 +18,7 @@
 #include <libgen.h>
 #include <stdio.h>
 
+#include "contrib/strtonum.h"
 #include "contrib/time.h"
 #include "contrib/tolower.h"
 #include "libknot/libknot.h"
@@ -45,6 +46,10 @@ static void print_help(void)
 	       " -t, --time <timestamp>      Current time specification.\n"
 	       "                              (default current UNIX time)\n"
 	       " -p, --print                 Print the zone on stdout.\n"
+	       " -j, --jobs <num>            Number of parsing and checking threads.\n"
+	       "                              (default 1)\n"
+	       " -s, --stream                Check the zone without loading it into memory.\n"
+	       "                              (only node-local checks)\n"
 	       " -v, --verbose               Enable debug output.\n"
 	       " -h, --help                  Print the program help.\n"
 	       " -V, --version               Print the program version.\n",
@@ -68,7 +73,8 @@ static bool str2bool(const char *s)
 int main(int argc, char *argv[])
 {
 	const char *origin = NULL;
-	bool zonemd = false, verbose = false, print = false;
+	bool zonemd = false, verbose = false, print = false, stream = false;
+	uint32_t threads = 1;
 	semcheck_optional_t optional = SEMCHECK_DNSSEC_AUTO; // default value for --dnssec
 	knot_time_t check_time = (knot_time_t)time(NULL);
 
@@ -79,6 +85,8 @@ int main(int argc, char *argv[])
 		{ "dnssec",  required_argument, NULL, 'd' },
 		{ "zonemd",  no_argument,       NULL, 'z' },
 		{ "print",   no_argument,       NULL, 'p' },
+		{ "jobs",    required_argument, NULL, 'j' },
+		{ "stream",  no_argument,       NULL, 's' },
 		{ "verbose", no_argument,       NULL, 'v' },
 		{ "help",    no_argument,       NULL, 'h' },
 		{ "version", optional_argument, NULL, 'V' },
@@ -90,7 +98,7 @@ int main(int argc, char *argv[])
 
 	/* Parse command line arguments */
 	int opt = 0;
-	while ((opt = getopt_long(argc, argv, "o:t:d:zpvV::h", opts, NULL)) != -1) {
+	while ((opt = getopt_long(argc, argv, "o:t:d:zpj:svV::h", opts, NULL)) != -1) {
 		switch (opt) {
 		case 'o':
 			origin = optarg;
@@ -98,6 +106,15 @@ int main(int argc, char *argv[])
 		case 'p':
 			print = true;
 			break;
+		case 'j':
+			if (str_to_u32(optarg, &threads) != KNOT_EOK || threads == 0) {
+				ERR2("invalid number of jobs '%s'", optarg);
+				return EXIT_FAILURE;
+			}
+			break;
+		case 's':
+			stream = true;
+			break;
 		case 'v':
 			verbose = true;
 			break;
@@ -133,6 +150,11 @@ int main(int argc, char *argv[])
 		return EXIT_FAILURE;
 	}
 
+	if (stream && (zonemd || print)) {
+		ERR2("options --zonemd and --print require the whole zone, not streaming");
+		return EXIT_FAILURE;
+	}
+
 	char *filename = argv[optind];
 	if (strncmp(filename, STDIN_SUBST, sizeof(STDIN_SUBST)) == 0) {
 		filename = STDIN_REPL;
@@ -170,8 +192,13 @@ int main(int argc, char *argv[])
 		log_levels_add(LOG_TARGET_STDOUT, LOG_SOURCE_ANY, LOG_UPTO(LOG_DEBUG));
 	}
 
-	int ret = zone_check(filename, zone, zonemd, DEFAULT_TTL, optional,
-	                     (time_t)check_time, print);
+	int ret;
+	if (stream) {
+		ret = zone_check_stream(filename, zone, DEFAULT_TTL, optional);
+	} else {
+		ret = zone_check(filename, zone, zonemd, DEFAULT_TTL, optional,
+		                 (time_t)check_time, print, threads);
+	}
 	log_close();
 	if (ret == KNOT_EOK) {
 		if (verbose && !print) {
@@ -14,8 +14,9 @@
     along with this program.  If not, see <https://www.gnu.org/licenses/>.
  */
 
-#include <stdio.h>
 #include <assert.h>
+#include <inttypes.h>
+#include <stdio.h>
 
 #include "utils/kzonecheck/zone_check.h"
 
@@ -23,6 +24,7 @@
 #include "knot/zone/digest.h"
 #include "knot/zone/zonefile.h"
 #include "knot/zone/zone-dump.h"
+#include "libzscanner/scanner.h"
 #include "utils/common/msg.h"
 
 typedef struct {
@@ -63,8 +65,25 @@ static void print_statistics(err_handler_stats_t *stats)
 	}
 }
 
+static int check_result(err_handler_stats_t *stats)
+{
+	if (stats->error_count == 0) {
+		return KNOT_EOK;
+	}
+
+	print_statistics(stats);
+	if (stats->handler.error) {
+		fprintf(stderr, "\n");
+		ERR2("serious semantic error detected");
+		return KNOT_EINVAL;
+	} else {
+		return KNOT_ESEMCHECK;
+	}
+}
+
 int zone_check(const char *zone_file, const knot_dname_t *zone_name, bool zonemd,
-               uint32_t dflt_ttl, semcheck_optional_t optional, time_t time, bool print)
+               uint32_t dflt_ttl, semcheck_optional_t optional, time_t time, bool print,
+               unsigned threads)
 {
 	err_handler_stats_t stats = {
 		.handler = { .cb = err_callback },
@@ -85,6 +104,7 @@ int zone_check(const char *zone_file, const knot_dname_t *zone_name, bool zonemd
 	}
 	zl.err_handler = (sem_handler_t *)&stats;
 	zl.creator->master = true;
+	zl.threads = threads;
 
 	zone_contents_t *contents = zonefile_load(&zl);
 	zonefile_close(&zl);
@@ -93,16 +113,7 @@ int zone_check(const char *zone_file, const knot_dname_t *zone_name, bool zonemd
 		return KNOT_ERROR;
 	}
 
-	if (stats.error_count > 0) {
-		print_statistics(&stats);
-		if (stats.handler.error) {
-			fprintf(stderr, "\n");
-			ERR2("serious semantic error detected");
-			ret = KNOT_EINVAL;
-		} else {
-			ret = KNOT_ESEMCHECK;
-		}
-	}
+	ret = check_result(&stats);
 
 	if (zonemd) {
 		ret = zone_contents_digest_verify(contents);
@@ -119,10 +130,164 @@ int zone_check(const char *zone_file, const knot_dname_t *zone_name, bool zonemd
 			fprintf(stderr, "\n");
 		}
 		printf(";; Zone dump (Knot DNS %s)\n", PACKAGE_VERSION);
-		zone_dump_text(contents, stdout, false, NULL);
+		zone_dump_text(contents, stdout, false, NULL, 1);
 	}
 
 	zone_contents_deep_free(contents);
 
 	return ret;
 }
+
+typedef struct {
+	err_handler_stats_t stats;
+	semcheck_optional_t optional;
+	zone_contents_t *zone;
+	zone_node_t *node;  /*!< Currently accumulated non-apex node. */
+	int ret;
+} stream_ctx_t;
+
+static int stream_flush(stream_ctx_t *ctx)
+{
+	if (ctx->node == NULL) {
+		return KNOT_EOK;
+	}
+
+	int ret = sem_checks_node(ctx->zone, ctx->node, ctx->optional,
+	                          (sem_handler_t *)&ctx->stats);
+	node_free_rrsets(ctx->node, NULL);
+	node_free(ctx->node, NULL);
+	ctx->node = NULL;
+
+	return (ret == KNOT_ESEMCHECK) ? KNOT_EOK : ret;
+}
+
+static void stream_data(zs_scanner_t *s)
+{
+	stream_ctx_t *ctx = s->process.data;
+
+	uint8_t rdata[knot_rdata_size(UINT16_MAX)];
+	knot_rdata_init((knot_rdata_t *)rdata, s->r_data_length, s->r_data);
+
+	knot_rrset_t rr;
+	knot_rrset_init(&rr, s->r_owner, s->r_type, s->r_class, s->r_ttl);
+	rr.rrs.count = 1;
+	rr.rrs.size = knot_rdata_size(s->r_data_length);
+	rr.rrs.rdata = (knot_rdata_t *)rdata;
+
+	int ret = knot_rrset_rr_to_canonical(&rr);
+	if (ret != KNOT_EOK) {
+		goto fail;
+	}
+
+	const knot_dname_t *apex = ctx->zone->apex->owner;
+	int labels = knot_dname_in_bailiwick(rr.owner, apex);
+	if (labels < 0) {
+		knot_dname_txt_storage_t buff;
+		char *owner = knot_dname_to_str(buff, rr.owner, sizeof(buff));
+		WARN2("ignoring out-of-zone data, owner %s", owner != NULL ? owner : "");
+		return;
+	}
+
+	zone_node_t *node = ctx->zone->apex;
+	if (labels > 0) {
+		if (ctx->node == NULL || !knot_dname_is_equal(ctx->node->owner, rr.owner)) {
+			ret = stream_flush(ctx);
+			if (ret != KNOT_EOK) {
+				goto fail;
+			}
+			ctx->node = node_new(rr.owner, false, false, NULL);
+			if (ctx->node == NULL) {
+				ret = KNOT_ENOMEM;
+				goto fail;
+			}
+		}
+		node = ctx->node;
+	}
+
+	ret = node_add_rrset(node, &rr, NULL);
+	if (ret == KNOT_EOK || ret == KNOT_ETTL) {
+		return;
+	}
+fail:
+	ctx->ret = ret;
+	s->state = ZS_STATE_STOP;
+}
+
+static void stream_error(zs_scanner_t *s)
+{
+	ERR2("%s in zone, file '%s', line %"PRIu64" (%s)",
+	     s->error.fatal ? "fatal error" : "error",
+	     s->file.name, s->line_counter, zs_strerror(s->error.code));
+}
+
+int zone_check_stream(const char *zone_file, const knot_dname_t *zone_name,
+                      uint32_t dflt_ttl, semcheck_optional_t optional)
+{
+	stream_ctx_t ctx = {
+		.stats = { .handler = { .cb = err_callback } },
+		.optional = optional,
+		.zone = zone_contents_new(zone_name, false),
+	};
+	if (ctx.zone == NULL) {
+		ERR2("failed to run semantic checks (%s)", knot_strerror(KNOT_ENOMEM));
+		return KNOT_ENOMEM;
+	}
+
+	char *origin = knot_dname_to_str_alloc(zone_name);
+	if (origin == NULL) {
+		ERR2("failed to run semantic checks (%s)", knot_strerror(KNOT_ENOMEM));
+		zone_contents_deep_free(ctx.zone);
+		return KNOT_ENOMEM;
+	}
+
+	zs_scanner_t s;
+	if (zs_init(&s, origin, KNOT_CLASS_IN, dflt_ttl) != 0 ||
+	    zs_set_input_file(&s, zone_file) != 0 ||
+	    zs_set_processing(&s, stream_data, stream_error, &ctx) != 0) {
+		ERR2("failed to load the zone file");
+		zs_deinit(&s);
+		free(origin);
+		zone_contents_deep_free(ctx.zone);
+		return KNOT_EFILE;
+	}
+	free(origin);
+
+	int ret = zs_parse_all(&s);
+	if (ret != 0 && s.error.counter == 0 && ctx.ret == KNOT_EOK) {
+		ERR2("failed to load the zone file (%s)", zs_strerror(s.error.code));
+		ctx.ret = KNOT_EFILE;
+	}
+	if (ctx.ret == KNOT_EOK) {
+		ctx.ret = stream_flush(&ctx);
+	} else {
+		(void)stream_flush(&ctx);
+	}
+	uint64_t scan_errors = s.error.counter;
+	zs_deinit(&s);
+
+	if (ctx.ret == KNOT_EOK && scan_errors == 0) {
+		// The apex is checked last, once all its records are known.
+		knot_rdataset_t *soa = node_rdataset(ctx.zone->apex, KNOT_RRTYPE_SOA);
+		if (soa != NULL && soa->count > 1) {
+			ctx.stats.handler.error = true;
+			err_callback(&ctx.stats.handler, ctx.zone, NULL,
+			             SEM_ERR_SOA_MULTIPLE, NULL);
+		}
+		ret = sem_checks_node(ctx.zone, ctx.zone->apex, optional,
+		                      &ctx.stats.handler);
+		if (ret != KNOT_EOK && ret != KNOT_ESEMCHECK) {
+			ctx.ret = ret;
+		}
+	}
+	zone_contents_deep_free(ctx.zone);
+
+	if (ctx.ret != KNOT_EOK) {
+		ERR2("failed to run semantic checks (%s)", knot_strerror(ctx.ret));
+		return ctx.ret;
+	} else if (scan_errors > 0) {
+		ERR2("failed to load the zone file, %"PRIu64" errors", scan_errors);
+		return KNOT_EMALF;
+	}
+
+	return check_result(&ctx.stats);
+}
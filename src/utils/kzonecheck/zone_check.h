@@ -20,4 +20,14 @@
 #include "libknot/libknot.h"
 
 int zone_check(const char *zone_file, const knot_dname_t *zone_name, bool zonemd,
-               uint32_t dflt_ttl, semcheck_optional_t optional, time_t time, bool print);
+               uint32_t dflt_ttl, semcheck_optional_t optional, time_t time, bool print,
+               unsigned threads);
+
+/*!
+ * Checks the zone file record by record without loading the whole zone.
+ *
+ * Only the node-local semantic checks are performed, records of the same
+ * owner are expected to be adjacent in the file.
+ */
+int zone_check_stream(const char *zone_file, const knot_dname_t *zone_name,
+                      uint32_t dflt_ttl, semcheck_optional_t optional);
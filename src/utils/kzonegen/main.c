@@ -0,0 +1,395 @@
+/*  Copyright (C) 2024 CZ.NIC, z.s.p.o. <knot-dns@labs.nic.cz>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include <getopt.h>
+#include <inttypes.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "libknot/libknot.h"
+#include "utils/common/msg.h"
+#include "utils/common/params.h"
+#include "contrib/strtonum.h"
+
+#define PROGRAM_NAME "kzonegen"
+
+#define PROVIDERS    1000
+#define GLUE_RATIO   5  // Percent of in-bailiwick delegations.
+#define LABEL_WIDTH  8  // Base36 characters making a label unique.
+
+typedef enum {
+	SHAPE_TLD,
+	SHAPE_CDN,
+	SHAPE_REVERSE,
+	SHAPE_WILDCARD,
+	SHAPE_OPTOUT,
+} shape_t;
+
+static const char *shape_names[] = {
+	[SHAPE_TLD]      = "tld",
+	[SHAPE_CDN]      = "cdn",
+	[SHAPE_REVERSE]  = "reverse",
+	[SHAPE_WILDCARD] = "wildcard",
+	[SHAPE_OPTOUT]   = "optout",
+};
+
+typedef struct {
+	knot_dname_txt_storage_t zone;
+	shape_t shape;
+	uint64_t records;
+	uint64_t seed;
+	int ds_ratio;
+	unsigned depth;
+	FILE *out;
+	uint64_t written;
+	uint64_t rand;
+} gen_ctx_t;
+
+static void print_help(void)
+{
+	printf("Usage: %s [options] <zone_name>\n"
+	       "\n"
+	       "Options:\n"
+	       " -s, --shape <name>       Zone shape: tld, cdn, reverse, wildcard, optout.\n"
+	       "                           (default tld)\n"
+	       " -n, --records <num>      Approximate number of records.\n"
+	       "                           (default 1000000)\n"
+	       " -d, --ds-ratio <percent> Percentage of secure delegations.\n"
+	       "                           (default 30, or 1 for optout)\n"
+	       " -D, --depth <num>        Number of nibble labels for the reverse shape.\n"
+	       "                           (default 8)\n"
+	       " -S, --seed <num>         Random seed, the same seed yields the same zone.\n"
+	       " -o, --outfile <file>     Output file instead of the standard output.\n"
+	       " -h, --help               Print the program help.\n"
+	       " -V, --version            Print the program version.\n",
+	       PROGRAM_NAME);
+}
+
+static uint64_t gen_rand(gen_ctx_t *ctx)
+{
+	// xorshift64*
+	ctx->rand ^= ctx->rand >> 12;
+	ctx->rand ^= ctx->rand << 25;
+	ctx->rand ^= ctx->rand >> 27;
+	return ctx->rand * 0x2545F4914F6CDD1DULL;
+}
+
+/*!
+ * Permutes the index within 'bits' bits, so that distinct indices give
+ * distinct, random looking, values.
+ */
+static uint64_t permute(gen_ctx_t *ctx, uint64_t idx, unsigned bits)
+{
+	uint64_t mask = (bits >= 64) ? UINT64_MAX : (1ULL << bits) - 1;
+	uint64_t val = idx & mask;
+	for (int i = 0; i < 3; i++) {
+		val = (val * 0x9E3779B97F4A7C15ULL) & mask;
+		val ^= (ctx->seed >> (8 * i)) & mask;
+		val ^= val >> (bits / 2 + 1);
+	}
+	return val;
+}
+
+/*! Writes a unique label of random length for the index. */
+static void put_label(gen_ctx_t *ctx, char *buf, uint64_t idx)
+{
+	size_t len = gen_rand(ctx) % 8;
+	for (size_t i = 0; i < len; i++) {
+		buf[i] = 'a' + gen_rand(ctx) % 26;
+	}
+
+	uint64_t val = permute(ctx, idx, 40);
+	for (int i = 0; i < LABEL_WIDTH; i++) {
+		buf[len++] = "0123456789abcdefghijklmnopqrstuvwxyz"[val % 36];
+		val /= 36;
+	}
+	buf[len] = '\0';
+}
+
+static void put_rr(gen_ctx_t *ctx, const char *owner, uint32_t ttl,
+                   const char *type, const char *fmt, ...)
+{
+	fprintf(ctx->out, "%s\t%u\t%s\t", owner, ttl, type);
+	va_list args;
+	va_start(args, fmt);
+	vfprintf(ctx->out, fmt, args);
+	va_end(args);
+	fputc('\n', ctx->out);
+	ctx->written++;
+}
+
+static void put_ipv4(gen_ctx_t *ctx, const char *owner, uint32_t ttl)
+{
+	uint32_t ip = gen_rand(ctx);
+	put_rr(ctx, owner, ttl, "A", "%u.%u.%u.%u", (ip >> 24) & 0xff,
+	       (ip >> 16) & 0xff, (ip >> 8) & 0xff, ip & 0xff);
+}
+
+static void put_ipv6(gen_ctx_t *ctx, const char *owner, uint32_t ttl)
+{
+	uint64_t ip = gen_rand(ctx);
+	put_rr(ctx, owner, ttl, "AAAA", "2001:db8:%x:%x:%x:%x::1",
+	       (unsigned)(ip >> 48) & 0xffff, (unsigned)(ip >> 32) & 0xffff,
+	       (unsigned)(ip >> 16) & 0xffff, (unsigned)ip & 0xffff);
+}
+
+static void put_ds(gen_ctx_t *ctx, const char *owner)
+{
+	char digest[65];
+	for (int i = 0; i < 64; i++) {
+		digest[i] = "0123456789ABCDEF"[gen_rand(ctx) % 16];
+	}
+	digest[64] = '\0';
+	put_rr(ctx, owner, 86400, "DS", "%u 13 2 %s",
+	       (unsigned)(gen_rand(ctx) % 65536), digest);
+}
+
+static void put_apex(gen_ctx_t *ctx)
+{
+	fprintf(ctx->out, "$ORIGIN %s\n$TTL 3600\n", ctx->zone);
+	put_rr(ctx, "@", 3600, "SOA", "ns1 hostmaster 1 14400 3600 1209600 3600");
+	put_rr(ctx, "@", 86400, "NS", "ns1");
+	put_rr(ctx, "@", 86400, "NS", "ns2");
+	put_ipv4(ctx, "ns1", 86400);
+	put_ipv4(ctx, "ns2", 86400);
+}
+
+/*! Delegation-heavy zone, most delegations served by few big providers. */
+static void gen_tld(gen_ctx_t *ctx)
+{
+	char label[32];
+	for (uint64_t i = 0; ctx->written < ctx->records; i++) {
+		put_label(ctx, label, i);
+		if (gen_rand(ctx) % 100 < GLUE_RATIO) {
+			put_rr(ctx, label, 86400, "NS", "ns1.%s", label);
+			put_rr(ctx, label, 86400, "NS", "ns2.%s", label);
+			char glue[64];
+			(void)snprintf(glue, sizeof(glue), "ns1.%s", label);
+			put_ipv4(ctx, glue, 86400);
+			(void)snprintf(glue, sizeof(glue), "ns2.%s", label);
+			put_ipv6(ctx, glue, 86400);
+		} else {
+			// Skewed towards the first providers.
+			uint64_t r = gen_rand(ctx) % PROVIDERS;
+			unsigned provider = r * r / PROVIDERS;
+			put_rr(ctx, label, 86400, "NS", "ns1.provider%u.net.", provider);
+			put_rr(ctx, label, 86400, "NS", "ns2.provider%u.net.", provider);
+		}
+		if (gen_rand(ctx) % 100 < ctx->ds_ratio) {
+			put_ds(ctx, label);
+		}
+	}
+}
+
+/*! Flat zone of short-lived address records and aliases to edge names. */
+static void gen_cdn(gen_ctx_t *ctx)
+{
+	char label[32];
+	for (uint64_t i = 0; ctx->written < ctx->records; i++) {
+		put_label(ctx, label, i);
+		unsigned r = gen_rand(ctx) % 100;
+		if (r < 70) {
+			for (unsigned j = 1 + gen_rand(ctx) % 4; j > 0; j--) {
+				put_ipv4(ctx, label, 60);
+			}
+		} else if (r < 90) {
+			for (unsigned j = 1 + gen_rand(ctx) % 2; j > 0; j--) {
+				put_ipv6(ctx, label, 60);
+			}
+		} else {
+			put_rr(ctx, label, 300, "CNAME", "%s.edge%u.cdn.net.", label,
+			       (unsigned)(gen_rand(ctx) % 64));
+		}
+	}
+}
+
+/*! Deep tree of nibble labels with PTR records at the leaves. */
+static void gen_reverse(gen_ctx_t *ctx)
+{
+	char owner[2 * 32 + 1];
+	for (uint64_t i = 0; ctx->written < ctx->records; i++) {
+		uint64_t val = permute(ctx, i, 4 * ctx->depth);
+		for (unsigned j = 0; j < ctx->depth; j++) {
+			owner[2 * j] = "0123456789abcdef"[val & 0xf];
+			owner[2 * j + 1] = '.';
+			val >>= 4;
+		}
+		owner[2 * ctx->depth - 1] = '\0';
+		put_rr(ctx, owner, 3600, "PTR", "host-%"PRIu64".example.net.", i);
+	}
+}
+
+/*! Subtrees covered by wildcards, with a few explicit names each. */
+static void gen_wildcard(gen_ctx_t *ctx)
+{
+	char label[32], owner[64];
+	for (uint64_t i = 0; ctx->written < ctx->records; i++) {
+		put_label(ctx, label, i);
+		if (gen_rand(ctx) % 2 == 0) {
+			(void)snprintf(owner, sizeof(owner), "*.%s", label);
+			put_ipv4(ctx, owner, 300);
+			(void)snprintf(owner, sizeof(owner), "*.%s", label);
+			put_rr(ctx, owner, 300, "TXT", "\"wildcard %"PRIu64"\"", i);
+		}
+		for (unsigned j = gen_rand(ctx) % 4; j > 0; j--) {
+			(void)snprintf(owner, sizeof(owner), "www%u.%s", j, label);
+			put_ipv4(ctx, owner, 300);
+		}
+	}
+}
+
+static int generate(gen_ctx_t *ctx)
+{
+	put_apex(ctx);
+
+	switch (ctx->shape) {
+	case SHAPE_TLD:
+	case SHAPE_OPTOUT:
+		gen_tld(ctx);
+		break;
+	case SHAPE_CDN:
+		gen_cdn(ctx);
+		break;
+	case SHAPE_REVERSE:
+		gen_reverse(ctx);
+		break;
+	case SHAPE_WILDCARD:
+		gen_wildcard(ctx);
+		break;
+	}
+
+	return ferror(ctx->out) ? KNOT_EFILE : KNOT_EOK;
+}
+
+int main(int argc, char *argv[])
+{
+	gen_ctx_t ctx = {
+		.shape = SHAPE_TLD,
+		.records = 1000000,
+		.seed = 1,
+		.ds_ratio = -1,
+		.depth = 8,
+		.out = stdout,
+	};
+	const char *outfile = NULL;
+
+	struct option opts[] = {
+		{ "shape",    required_argument, NULL, 's' },
+		{ "records",  required_argument, NULL, 'n' },
+		{ "ds-ratio", required_argument, NULL, 'd' },
+		{ "depth",    required_argument, NULL, 'D' },
+		{ "seed",     required_argument, NULL, 'S' },
+		{ "outfile",  required_argument, NULL, 'o' },
+		{ "help",     no_argument,       NULL, 'h' },
+		{ "version",  optional_argument, NULL, 'V' },
+		{ NULL }
+	};
+
+	int opt = 0;
+	while ((opt = getopt_long(argc, argv, "s:n:d:D:S:o:hV::", opts, NULL)) != -1) {
+		uint8_t num8 = 0;
+		switch (opt) {
+		case 's':
+			for (ctx.shape = 0; ctx.shape <= SHAPE_OPTOUT; ctx.shape++) {
+				if (strcmp(optarg, shape_names[ctx.shape]) == 0) {
+					break;
+				}
+			}
+			if (ctx.shape > SHAPE_OPTOUT) {
+				ERR2("unknown zone shape '%s'", optarg);
+				return EXIT_FAILURE;
+			}
+			break;
+		case 'n':
+			if (str_to_u64(optarg, &ctx.records) != KNOT_EOK) {
+				ERR2("invalid number of records '%s'", optarg);
+				return EXIT_FAILURE;
+			}
+			break;
+		case 'd':
+			if (str_to_u8(optarg, &num8) != KNOT_EOK || num8 > 100) {
+				ERR2("invalid percentage '%s'", optarg);
+				return EXIT_FAILURE;
+			}
+			ctx.ds_ratio = num8;
+			break;
+		case 'D':
+			if (str_to_u8(optarg, &num8) != KNOT_EOK || num8 < 1 || num8 > 16) {
+				ERR2("invalid depth '%s', expected 1-16", optarg);
+				return EXIT_FAILURE;
+			}
+			ctx.depth = num8;
+			break;
+		case 'S':
+			if (str_to_u64(optarg, &ctx.seed) != KNOT_EOK) {
+				ERR2("invalid seed '%s'", optarg);
+				return EXIT_FAILURE;
+			}
+			break;
+		case 'o':
+			outfile = optarg;
+			break;
+		case 'h':
+			print_help();
+			return EXIT_SUCCESS;
+		case 'V':
+			print_version(PROGRAM_NAME, optarg != NULL);
+			return EXIT_SUCCESS;
+		default:
+			print_help();
+			return EXIT_FAILURE;
+		}
+	}
+	if (argc - optind != 1) {
+		ERR2("missing zone name");
+		print_help();
+		return EXIT_FAILURE;
+	}
+
+	knot_dname_storage_t zone;
+	if (knot_dname_from_str(zone, argv[optind], sizeof(zone)) == NULL ||
+	    knot_dname_to_str(ctx.zone, zone, sizeof(ctx.zone)) == NULL) {
+		ERR2("invalid zone name '%s'", argv[optind]);
+		return EXIT_FAILURE;
+	}
+
+	if (ctx.ds_ratio < 0) {
+		ctx.ds_ratio = (ctx.shape == SHAPE_OPTOUT) ? 1 : 30;
+	}
+	ctx.rand = ctx.seed * 0x9E3779B97F4A7C15ULL + 1;
+
+	if (outfile != NULL) {
+		ctx.out = fopen(outfile, "w");
+		if (ctx.out == NULL) {
+			ERR2("failed to open output file '%s'", outfile);
+			return EXIT_FAILURE;
+		}
+	}
+
+	int ret = generate(&ctx);
+
+	if (outfile != NULL && fclose(ctx.out) != 0) {
+		ret = KNOT_EFILE;
+	}
+	if (ret != KNOT_EOK) {
+		ERR2("failed to write the zone (%s)", knot_strerror(ret));
+		return EXIT_FAILURE;
+	}
+
+	return EXIT_SUCCESS;
+}
@@ -21,6 +21,7 @@
 #include "knot/updates/zone-update.h"
 #include "knot/server/server.h"
 #include "knot/zone/adjust.h"
+#include "knot/zone/serial.h"
 #include "knot/zone/zone-load.h"
 #include "knot/zone/zonefile.h"
 #include "utils/common/msg.h"
@@ -45,6 +46,7 @@ static void print_help(void)
 	       "Options:\n"
 	       " -o, --outdir <dir_name>  Output directory.\n"
 	       " -r, --rollover           Allow key rollovers and NSEC3 re-salt.\n"
+	       " -i, --incremental <file> Update a previously signed zone file.\n"
 	       " -v, --verify             Only verify if zone is signed correctly.\n"
 	       " -t, --time <timestamp>   Current time specification.\n"
 	       "                           (default current UNIX time)\n"
@@ -57,11 +59,57 @@ typedef struct {
 	const char *zone_name_str;
 	knot_dname_storage_t zone_name;
 	const char *outdir;
+	const char *previous;
 	zone_sign_roll_flags_t rollover;
 	int64_t timestamp;
 	bool verify;
 } sign_params_t;
 
+static int trust_rrsigs(zone_node_t *node, _unused_ void *data)
+{
+	node->flags |= NODE_FLAGS_RRSIGS_VALID;
+	return KNOT_EOK;
+}
+
+/*!
+ * Prepares an update of the previously signed zone by the differences of
+ * the unsigned zone, so that the signing only completes changed RRSets and
+ * refreshes expiring signatures.
+ */
+static int update_previous(sign_params_t *params, zone_t *zone, zone_update_t *up,
+                           zone_contents_t *unsigned_conts)
+{
+	zone_contents_t *signed_conts = NULL;
+	int ret = zone_load_contents_file(conf(), params->zone_name, params->previous,
+	                                  &signed_conts, SEMCHECK_MANDATORY_SOFT, false, NULL);
+	if (ret != KNOT_EOK) {
+		ERR2("failed to load previously signed zone '%s' (%s)",
+		     params->previous, knot_strerror(ret));
+		zone_contents_deep_free(unsigned_conts);
+		return ret;
+	}
+
+	// The existing signatures were made by us, the changed nodes lose this flag.
+	(void)zone_contents_apply(signed_conts, trust_rrsigs, NULL);
+	(void)zone_contents_nsec3_apply(signed_conts, trust_rrsigs, NULL);
+
+	// The serial continues from the signed zone unless explicitly increased.
+	uint32_t serial = zone_contents_serial(signed_conts);
+	if (serial_compare(zone_contents_serial(unsigned_conts), serial) != SERIAL_GREATER) {
+		zone_contents_set_soa_serial(unsigned_conts, serial);
+	}
+
+	// The signed contents are taken over by the update, even on error.
+	ret = zone_update_from_differences(up, zone, signed_conts, unsigned_conts,
+	                                   UPDATE_HYBRID, true, false);
+	if (ret != KNOT_EOK) {
+		ERR2("failed to compare with previously signed zone (%s)", knot_strerror(ret));
+		zone_contents_deep_free(unsigned_conts);
+	}
+
+	return ret;
+}
+
 static int zonesign(sign_params_t *params)
 {
 	char *zonefile = NULL;
@@ -95,17 +143,24 @@ static int zonesign(sign_params_t *params)
 	}
 
 	ret = zone_load_contents(conf(), params->zone_name, &unsigned_conts,
-	                         SEMCHECK_MANDATORY_SOFT, false);
+	                         SEMCHECK_MANDATORY_SOFT, false, NULL);
 	if (ret != KNOT_EOK) {
 		ERR2("failed to load zone contents (%s)", knot_strerror(ret));
 		goto fail;
 	}
 
-	ret = zone_update_from_contents(&up, zone_struct, unsigned_conts, UPDATE_FULL);
-	if (ret != KNOT_EOK) {
-		ERR2("failed to initialize zone update (%s)", knot_strerror(ret));
-		zone_contents_deep_free(unsigned_conts);
-		goto fail;
+	if (params->previous != NULL) {
+		ret = update_previous(params, zone_struct, &up, unsigned_conts);
+		if (ret != KNOT_EOK) {
+			goto fail;
+		}
+	} else {
+		ret = zone_update_from_contents(&up, zone_struct, unsigned_conts, UPDATE_FULL);
+		if (ret != KNOT_EOK) {
+			ERR2("failed to initialize zone update (%s)", knot_strerror(ret));
+			zone_contents_deep_free(unsigned_conts);
+			goto fail;
+		}
 	}
 
 	if (params->verify) {
@@ -151,7 +206,8 @@ static int zonesign(sign_params_t *params)
 
 	if (params->outdir == NULL) {
 		zonefile = conf_zonefile(conf(), params->zone_name);
-		ret = zonefile_write(zonefile, up.new_cont);
+		conf_val_t thr = conf_zone_get(conf(), C_ADJUST_THR, params->zone_name);
+		ret = zonefile_write(zonefile, up.new_cont, false, conf_int(&thr));
 	} else {
 		zone_contents_t *temp = zone_struct->contents;
 		zone_struct->contents = up.new_cont;
@@ -201,6 +257,7 @@ int main(int argc, char *argv[])
 		{ "confdb",    required_argument, NULL, 'C' },
 		{ "outdir",    required_argument, NULL, 'o' },
 		{ "rollover",  no_argument,       NULL, 'r' },
+		{ "incremental", required_argument, NULL, 'i' },
 		{ "verify" ,   no_argument,       NULL, 'v' },
 		{ "time",      required_argument, NULL, 't' },
 		{ "help",      no_argument,       NULL, 'h' },
@@ -212,7 +269,7 @@ int main(int argc, char *argv[])
 	signal_init_std();
 
 	int opt = 0;
-	while ((opt = getopt_long(argc, argv, "c:C:o:rvt:hV::", opts, NULL)) != -1) {
+	while ((opt = getopt_long(argc, argv, "c:C:o:ri:vt:hV::", opts, NULL)) != -1) {
 		switch (opt) {
 		case 'c':
 			if (util_conf_init_file(optarg) != KNOT_EOK) {
@@ -230,6 +287,9 @@ int main(int argc, char *argv[])
 		case 'r':
 			params.rollover = KEY_ROLL_ALLOW_ALL;
 			break;
+		case 'i':
+			params.previous = optarg;
+			break;
 		case 'v':
 			params.verify = true;
 			break;
@@ -257,6 +317,11 @@ int main(int argc, char *argv[])
 		print_help();
 		goto failure;
 	}
+	if (params.verify && params.previous != NULL) {
+		ERR2("option --incremental can't be used with --verify");
+		print_help();
+		goto failure;
+	}
 	params.zone_name_str = argv[optind];
 	if (knot_dname_from_str(params.zone_name, params.zone_name_str,
 	                        sizeof(params.zone_name)) == NULL) {
@@ -0,0 +1,99 @@
+/*  Copyright (C) 2024 CZ.NIC, z.s.p.o. <knot-dns@labs.nic.cz>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+/*
+ * Common microbenchmark helpers, not used by the test suite.
+ *
+ * Each benchmark is repeated with a growing number of iterations until it
+ * runs for at least BENCH_MIN_NS, then one line of tab-separated values is
+ * printed: benchmark name, number of operations, nanoseconds per operation,
+ * and operations per second. Inputs are generated from a fixed seed, so that
+ * the runs are comparable.
+ */
+
+#pragma once
+
+#include <inttypes.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#define BENCH_MIN_NS 200000000ULL
+#define BENCH_HEADER "# name\tops\tns_per_op\tops_per_sec"
+
+/*! Run the measured code 'iters' times. */
+typedef void (*bench_fn_t)(void *ctx, uint64_t iters);
+
+/*! Sink for results which the compiler must not optimize away. */
+static volatile uint64_t bench_sink;
+
+static uint64_t bench_seed = 0x2545F4914F6CDD1DULL;
+
+static inline uint64_t bench_rand(void)
+{
+	// xorshift64*
+	bench_seed ^= bench_seed >> 12;
+	bench_seed ^= bench_seed << 25;
+	bench_seed ^= bench_seed >> 27;
+	return bench_seed * 0x2545F4914F6CDD1DULL;
+}
+
+static inline uint64_t bench_now_ns(void)
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+/*!
+ * \brief Print one benchmark result.
+ *
+ * \param name     Benchmark name.
+ * \param ops      Number of operations done.
+ * \param elapsed  Elapsed time in nanoseconds.
+ */
+static inline void bench_report(const char *name, uint64_t ops, uint64_t elapsed)
+{
+	printf("%s\t%"PRIu64"\t%.2f\t%.0f\n", name, ops,
+	       (double)elapsed / ops, ops * 1e9 / elapsed);
+	fflush(stdout);
+}
+
+/*!
+ * \brief Measure and print one benchmark.
+ *
+ * \param name          Benchmark name.
+ * \param fn            Measured function.
+ * \param ctx           Context passed to the function.
+ * \param ops_per_iter  Number of operations done in one iteration.
+ */
+static inline void bench_run(const char *name, bench_fn_t fn, void *ctx,
+                             uint64_t ops_per_iter)
+{
+	uint64_t iters = 1, elapsed = 0;
+	while (true) {
+		uint64_t begin = bench_now_ns();
+		fn(ctx, iters);
+		elapsed = bench_now_ns() - begin;
+		if (elapsed >= BENCH_MIN_NS) {
+			break;
+		}
+		iters *= (elapsed < BENCH_MIN_NS / 16) ? 8 : 2;
+	}
+
+	bench_report(name, iters * ops_per_iter, elapsed);
+}
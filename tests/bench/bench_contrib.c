@@ -0,0 +1,197 @@
+/*  Copyright (C) 2024 CZ.NIC, z.s.p.o. <knot-dns@labs.nic.cz>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+/*
+ * Microbenchmarks of contrib primitives: qp-trie, base64, base32hex.
+ *
+ * Usage: bench_contrib
+ */
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "bench.h"
+#include "contrib/base32hex.h"
+#include "contrib/base64.h"
+#include "contrib/qp-trie/trie.h"
+
+#define TRIE_KEYS     100000
+#define TRIE_KEY_MAX  32
+#define COW_CHANGES   100
+#define B64_SIZE      1024
+#define B32_SIZE      20 // SHA-1 NSEC3 hash
+
+typedef struct {
+	uint8_t key[TRIE_KEY_MAX];
+	uint32_t len;
+} bench_key_t;
+
+typedef struct {
+	bench_key_t *keys;
+	bench_key_t *misses;
+	trie_t *trie;
+} trie_ctx_t;
+
+static void gen_key(bench_key_t *key)
+{
+	key->len = 8 + bench_rand() % (TRIE_KEY_MAX - 8);
+	for (uint32_t i = 0; i < key->len; i++) {
+		key->key[i] = "abcdefghijklmnopqrstuvwxyz0123456789-"[bench_rand() % 37];
+	}
+}
+
+static void trie_insert(void *_ctx, uint64_t iters)
+{
+	trie_ctx_t *ctx = _ctx;
+	for (uint64_t i = 0; i < iters; i++) {
+		trie_t *trie = trie_create(NULL);
+		for (size_t j = 0; j < TRIE_KEYS; j++) {
+			*trie_get_ins(trie, ctx->keys[j].key, ctx->keys[j].len) = &ctx->keys[j];
+		}
+		bench_sink += trie_weight(trie);
+		trie_free(trie);
+	}
+}
+
+static void trie_get(void *_ctx, uint64_t iters)
+{
+	trie_ctx_t *ctx = _ctx;
+	for (uint64_t i = 0; i < iters; i++) {
+		for (size_t j = 0; j < TRIE_KEYS; j++) {
+			bench_sink += (uintptr_t)trie_get_try(ctx->trie, ctx->keys[j].key,
+			                                      ctx->keys[j].len);
+		}
+	}
+}
+
+static void trie_leq(void *_ctx, uint64_t iters)
+{
+	trie_ctx_t *ctx = _ctx;
+	for (uint64_t i = 0; i < iters; i++) {
+		for (size_t j = 0; j < TRIE_KEYS; j++) {
+			trie_val_t *val;
+			bench_sink += trie_get_leq(ctx->trie, ctx->misses[j].key,
+			                           ctx->misses[j].len, &val);
+		}
+	}
+}
+
+static void trie_cow_update(void *_ctx, uint64_t iters)
+{
+	trie_ctx_t *ctx = _ctx;
+	for (uint64_t i = 0; i < iters; i++) {
+		trie_cow_t *cow = trie_cow(ctx->trie, NULL, NULL);
+		for (size_t j = 0; j < COW_CHANGES; j++) {
+			bench_key_t *key = &ctx->keys[bench_rand() % TRIE_KEYS];
+			*trie_get_cow(cow, key->key, key->len) = key;
+		}
+		ctx->trie = trie_cow_commit(cow, NULL, NULL);
+	}
+}
+
+static void bench_trie(void)
+{
+	trie_ctx_t ctx = {
+		.keys = calloc(TRIE_KEYS, sizeof(bench_key_t)),
+		.misses = calloc(TRIE_KEYS, sizeof(bench_key_t)),
+		.trie = trie_create(NULL),
+	};
+	if (ctx.keys == NULL || ctx.misses == NULL || ctx.trie == NULL) {
+		abort();
+	}
+	for (size_t i = 0; i < TRIE_KEYS; i++) {
+		gen_key(&ctx.keys[i]);
+		gen_key(&ctx.misses[i]);
+		*trie_get_ins(ctx.trie, ctx.keys[i].key, ctx.keys[i].len) = &ctx.keys[i];
+	}
+
+	bench_run("qp-trie/insert", trie_insert, &ctx, TRIE_KEYS);
+	bench_run("qp-trie/get", trie_get, &ctx, TRIE_KEYS);
+	bench_run("qp-trie/get_leq", trie_leq, &ctx, TRIE_KEYS);
+	bench_run("qp-trie/cow_update", trie_cow_update, &ctx, COW_CHANGES);
+
+	trie_free(ctx.trie);
+	free(ctx.misses);
+	free(ctx.keys);
+}
+
+typedef struct {
+	uint8_t raw[B64_SIZE];
+	uint8_t text[2 * B64_SIZE];
+	uint8_t out[2 * B64_SIZE];
+	int32_t raw_len;
+	int32_t text_len;
+} codec_ctx_t;
+
+static void b64_encode(void *_ctx, uint64_t iters)
+{
+	codec_ctx_t *ctx = _ctx;
+	for (uint64_t i = 0; i < iters; i++) {
+		bench_sink += knot_base64_encode(ctx->raw, ctx->raw_len, ctx->out, sizeof(ctx->out));
+	}
+}
+
+static void b64_decode(void *_ctx, uint64_t iters)
+{
+	codec_ctx_t *ctx = _ctx;
+	for (uint64_t i = 0; i < iters; i++) {
+		bench_sink += knot_base64_decode(ctx->text, ctx->text_len, ctx->out, sizeof(ctx->out));
+	}
+}
+
+static void b32_encode(void *_ctx, uint64_t iters)
+{
+	codec_ctx_t *ctx = _ctx;
+	for (uint64_t i = 0; i < iters; i++) {
+		bench_sink += knot_base32hex_encode(ctx->raw, ctx->raw_len, ctx->out, sizeof(ctx->out));
+	}
+}
+
+static void b32_decode(void *_ctx, uint64_t iters)
+{
+	codec_ctx_t *ctx = _ctx;
+	for (uint64_t i = 0; i < iters; i++) {
+		bench_sink += knot_base32hex_decode(ctx->text, ctx->text_len, ctx->out, sizeof(ctx->out));
+	}
+}
+
+static void bench_codecs(void)
+{
+	codec_ctx_t ctx = { 0 };
+	for (size_t i = 0; i < sizeof(ctx.raw); i++) {
+		ctx.raw[i] = bench_rand();
+	}
+
+	ctx.raw_len = B64_SIZE;
+	ctx.text_len = knot_base64_encode(ctx.raw, ctx.raw_len, ctx.text, sizeof(ctx.text));
+	bench_run("base64/encode_1k", b64_encode, &ctx, 1);
+	bench_run("base64/decode_1k", b64_decode, &ctx, 1);
+
+	ctx.raw_len = B32_SIZE;
+	ctx.text_len = knot_base32hex_encode(ctx.raw, ctx.raw_len, ctx.text, sizeof(ctx.text));
+	bench_run("base32hex/encode_20", b32_encode, &ctx, 1);
+	bench_run("base32hex/decode_20", b32_decode, &ctx, 1);
+}
+
+int main(int argc, char *argv[])
+{
+	puts(BENCH_HEADER);
+
+	bench_trie();
+	bench_codecs();
+
+	return EXIT_SUCCESS;
+}
@@ -0,0 +1,180 @@
+/*  Copyright (C) 2024 CZ.NIC, z.s.p.o. <knot-dns@labs.nic.cz>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+/*
+ * Microbenchmarks of knotd primitives: journal RRset serialization and zone
+ * tree lookups.
+ *
+ * Usage: bench_knot
+ */
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "bench.h"
+#include "contrib/wire_ctx.h"
+#include "knot/journal/serialization.h"
+#include "knot/zone/zone-tree.h"
+#include "libknot/libknot.h"
+
+#define RRSET_RRS   16
+#define TREE_NODES  100000
+#define TREE_SEARCH 10000
+
+typedef struct {
+	knot_rrset_t *rrset;
+	uint8_t *wire;
+	size_t size;
+} serial_ctx_t;
+
+static void rrset_serialize(void *_ctx, uint64_t iters)
+{
+	serial_ctx_t *ctx = _ctx;
+	for (uint64_t i = 0; i < iters; i++) {
+		wire_ctx_t wire = wire_ctx_init(ctx->wire, ctx->size);
+		bench_sink += serialize_rrset(&wire, ctx->rrset);
+	}
+}
+
+static void rrset_deserialize(void *_ctx, uint64_t iters)
+{
+	serial_ctx_t *ctx = _ctx;
+	for (uint64_t i = 0; i < iters; i++) {
+		wire_ctx_t wire = wire_ctx_init(ctx->wire, ctx->size);
+		knot_rrset_t rrset;
+		knot_rrset_init_empty(&rrset);
+		bench_sink += deserialize_rrset(&wire, &rrset);
+		knot_rrset_clear(&rrset, NULL);
+	}
+}
+
+static void bench_serialization(void)
+{
+	serial_ctx_t ctx = { 0 };
+
+	knot_dname_t *owner = knot_dname_from_str_alloc("www.example.com.");
+	ctx.rrset = knot_rrset_new(owner, KNOT_RRTYPE_AAAA, KNOT_CLASS_IN, 3600, NULL);
+	knot_dname_free(owner, NULL);
+	if (ctx.rrset == NULL) {
+		abort();
+	}
+	for (int i = 0; i < RRSET_RRS; i++) {
+		uint8_t addr[16] = { 0x20, 0x01, 0x0d, 0xb8 };
+		addr[15] = i;
+		(void)knot_rrset_add_rdata(ctx.rrset, addr, sizeof(addr), NULL);
+	}
+	ctx.size = rrset_serialized_size(ctx.rrset);
+	ctx.wire = malloc(ctx.size);
+	if (ctx.wire == NULL) {
+		abort();
+	}
+	wire_ctx_t wire = wire_ctx_init(ctx.wire, ctx.size);
+	(void)serialize_rrset(&wire, ctx.rrset);
+
+	bench_run("serialize_rrset/aaaa16", rrset_serialize, &ctx, 1);
+	bench_run("deserialize_rrset/aaaa16", rrset_deserialize, &ctx, 1);
+
+	free(ctx.wire);
+	knot_rrset_free(ctx.rrset, NULL);
+}
+
+typedef struct {
+	zone_tree_t *tree;
+	knot_dname_t **search;
+} tree_ctx_t;
+
+static knot_dname_t *gen_name(void)
+{
+	char str[KNOT_DNAME_TXT_MAXLEN];
+	(void)snprintf(str, sizeof(str), "h%"PRIu64".d%"PRIu64".example.com.",
+	               bench_rand() % 1000000, bench_rand() % 100);
+	return knot_dname_from_str_alloc(str);
+}
+
+static void tree_leq(void *_ctx, uint64_t iters)
+{
+	tree_ctx_t *ctx = _ctx;
+	for (uint64_t i = 0; i < iters; i++) {
+		for (size_t j = 0; j < TREE_SEARCH; j++) {
+			zone_node_t *found = NULL, *prev = NULL;
+			bench_sink += zone_tree_get_less_or_equal(ctx->tree, ctx->search[j],
+			                                          &found, &prev);
+		}
+	}
+}
+
+static int free_node(zone_node_t *node, void *data)
+{
+	node_free(node, NULL);
+	return KNOT_EOK;
+}
+
+static void bench_zone_tree(void)
+{
+	tree_ctx_t ctx = {
+		.tree = zone_tree_create(false),
+		.search = calloc(TREE_SEARCH, sizeof(*ctx.search)),
+	};
+	if (ctx.tree == NULL || ctx.search == NULL) {
+		abort();
+	}
+
+	for (size_t i = 0; i < TREE_NODES; i++) {
+		knot_dname_t *owner = gen_name();
+		zone_node_t *node = node_new(owner, false, false, NULL);
+		knot_dname_free(owner, NULL);
+		if (node == NULL || zone_tree_insert(ctx.tree, &node) != KNOT_EOK) {
+			abort();
+		}
+	}
+
+	// Link the previous nodes in canonical order.
+	zone_node_t *last = NULL, *first = NULL;
+	zone_tree_it_t it = { 0 };
+	for ((void)zone_tree_it_begin(ctx.tree, &it); !zone_tree_it_finished(&it);
+	     zone_tree_it_next(&it)) {
+		zone_node_t *node = zone_tree_it_val(&it);
+		node->prev = last;
+		first = (first == NULL) ? node : first;
+		last = node;
+	}
+	zone_tree_it_free(&it);
+	first->prev = last;
+
+	// Mostly misses, as for NXDOMAIN proofs.
+	for (size_t i = 0; i < TREE_SEARCH; i++) {
+		ctx.search[i] = gen_name();
+	}
+
+	bench_run("zone_tree/get_less_or_equal", tree_leq, &ctx, TREE_SEARCH);
+
+	for (size_t i = 0; i < TREE_SEARCH; i++) {
+		knot_dname_free(ctx.search[i], NULL);
+	}
+	free(ctx.search);
+	(void)zone_tree_apply(ctx.tree, free_node, NULL);
+	zone_tree_free(&ctx.tree);
+}
+
+int main(int argc, char *argv[])
+{
+	puts(BENCH_HEADER);
+
+	bench_serialization();
+	bench_zone_tree();
+
+	return EXIT_SUCCESS;
+}
@@ -0,0 +1,123 @@
+/*  Copyright (C) 2024 CZ.NIC, z.s.p.o. <knot-dns@labs.nic.cz>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+/*
+ * Microbenchmarks of the KRU rate limiting structure, the generic and the AVX2
+ * implementations. The latter is skipped if not supported.
+ *
+ * Usage: bench_kru
+ */
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "bench.h"
+#include "knot/modules/rrl/kru.h"
+
+#define KRU_CAPACITY_LOG 15
+#define KRU_KEYS         (1 << 16)
+#define KRU_PREFIXES     4
+
+typedef struct {
+	struct kru *kru;
+	uint8_t (*keys)[16];
+	uint32_t time;
+} kru_ctx_t;
+
+static void kru_limited(void *_ctx, uint64_t iters)
+{
+	kru_ctx_t *ctx = _ctx;
+	uint64_t limited = 0;
+	for (uint64_t i = 0; i < iters; i++) {
+		for (size_t j = 0; j < KRU_KEYS; j++) {
+			limited += KRU.limited(ctx->kru, ctx->time, ctx->keys[j], 1 << 16);
+		}
+		ctx->time++;
+	}
+	bench_sink = limited;
+}
+
+static void kru_limited_prefix(void *_ctx, uint64_t iters)
+{
+	kru_ctx_t *ctx = _ctx;
+	uint8_t prefixes[KRU_PREFIXES] = { 32, 48, 56, 64 };
+	kru_price_t prices[KRU_PREFIXES] = { 1 << 16, 1 << 16, 1 << 16, 1 << 16 };
+	uint64_t limited = 0;
+	for (uint64_t i = 0; i < iters; i++) {
+		for (size_t j = 0; j < KRU_KEYS; j++) {
+			limited += KRU.limited_multi_prefix_or(ctx->kru, ctx->time, 0,
+			                                       ctx->keys[j], prefixes,
+			                                       prices, KRU_PREFIXES, NULL);
+		}
+		ctx->time++;
+	}
+	bench_sink = limited;
+}
+
+static void bench_impl(const char *impl, kru_ctx_t *ctx)
+{
+	size_t size = KRU.get_size(KRU_CAPACITY_LOG);
+	ctx->kru = aligned_alloc(64, (size + 63) / 64 * 64);
+	if (ctx->kru == NULL) {
+		return;
+	}
+	memset(ctx->kru, 0, size);
+	if (!KRU.initialize(ctx->kru, KRU_CAPACITY_LOG, 1 << 10)) {
+		free(ctx->kru);
+		return;
+	}
+
+	char name[64];
+	(void)snprintf(name, sizeof(name), "kru/%s/limited", impl);
+	bench_run(name, kru_limited, ctx, KRU_KEYS);
+	(void)snprintf(name, sizeof(name), "kru/%s/limited_prefix4", impl);
+	bench_run(name, kru_limited_prefix, ctx, KRU_KEYS);
+
+	free(ctx->kru);
+}
+
+int main(int argc, char *argv[])
+{
+	puts(BENCH_HEADER);
+
+	kru_ctx_t ctx = {
+		.keys = aligned_alloc(16, KRU_KEYS * 16),
+	};
+	if (ctx.keys == NULL) {
+		return EXIT_FAILURE;
+	}
+	for (size_t i = 0; i < KRU_KEYS; i++) {
+		uint64_t parts[2] = { bench_rand(), bench_rand() };
+		memcpy(ctx.keys[i], parts, sizeof(parts));
+	}
+
+	// The AVX2 variant is selected at startup if the CPU supports it.
+	bool avx2 = (KRU.initialize == KRU_AVX2.initialize);
+
+	KRU = KRU_GENERIC;
+	bench_impl("generic", &ctx);
+
+	if (avx2) {
+		KRU = KRU_AVX2;
+		bench_impl("avx2", &ctx);
+	} else {
+		printf("# kru/avx2 not available\n");
+	}
+
+	free(ctx.keys);
+
+	return EXIT_SUCCESS;
+}
@@ -0,0 +1,311 @@
+/*  Copyright (C) 2024 CZ.NIC, z.s.p.o. <knot-dns@labs.nic.cz>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+/*
+ * Microbenchmarks of libknot and libzscanner primitives: domain names,
+ * packet parsing, RRset to wire conversion with compression, TSIG signing,
+ * zone parsing.
+ *
+ * Usage: bench_libknot
+ */
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "bench.h"
+#include "libknot/libknot.h"
+#include "libzscanner/scanner.h"
+
+#define DNAMES       10000
+#define ZONE_RECORDS 10000
+
+typedef struct {
+	char (*strs)[KNOT_DNAME_TXT_MAXLEN + 1];
+	knot_dname_storage_t *names;
+} dname_ctx_t;
+
+static void gen_name(char *str)
+{
+	int labels = 2 + bench_rand() % 4, len = 0;
+	for (int i = 0; i < labels; i++) {
+		int label_len = 1 + bench_rand() % 12;
+		for (int j = 0; j < label_len; j++) {
+			str[len++] = "abcdefghijklmnopqrstuvwxyz0123456789"[bench_rand() % 36];
+		}
+		str[len++] = '.';
+	}
+	strcpy(str + len, "example.com.");
+}
+
+static void dname_from_str(void *_ctx, uint64_t iters)
+{
+	dname_ctx_t *ctx = _ctx;
+	knot_dname_storage_t name;
+	for (uint64_t i = 0; i < iters; i++) {
+		for (size_t j = 0; j < DNAMES; j++) {
+			bench_sink += (uintptr_t)knot_dname_from_str(name, ctx->strs[j], sizeof(name));
+		}
+	}
+}
+
+static void dname_wire_check(void *_ctx, uint64_t iters)
+{
+	dname_ctx_t *ctx = _ctx;
+	for (uint64_t i = 0; i < iters; i++) {
+		for (size_t j = 0; j < DNAMES; j++) {
+			const uint8_t *name = ctx->names[j];
+			bench_sink += knot_dname_wire_check(name, name + KNOT_DNAME_MAXLEN, NULL);
+		}
+	}
+}
+
+static void dname_lf(void *_ctx, uint64_t iters)
+{
+	dname_ctx_t *ctx = _ctx;
+	knot_dname_storage_t lf;
+	for (uint64_t i = 0; i < iters; i++) {
+		for (size_t j = 0; j < DNAMES; j++) {
+			bench_sink += *knot_dname_lf(ctx->names[j], lf);
+		}
+	}
+}
+
+static void dname_cmp(void *_ctx, uint64_t iters)
+{
+	dname_ctx_t *ctx = _ctx;
+	for (uint64_t i = 0; i < iters; i++) {
+		for (size_t j = 1; j < DNAMES; j++) {
+			bench_sink += knot_dname_cmp(ctx->names[j - 1], ctx->names[j]);
+		}
+	}
+}
+
+static void bench_dname(void)
+{
+	dname_ctx_t ctx = {
+		.strs = calloc(DNAMES, sizeof(*ctx.strs)),
+		.names = calloc(DNAMES, sizeof(*ctx.names)),
+	};
+	if (ctx.strs == NULL || ctx.names == NULL) {
+		abort();
+	}
+	for (size_t i = 0; i < DNAMES; i++) {
+		gen_name(ctx.strs[i]);
+		(void)knot_dname_from_str(ctx.names[i], ctx.strs[i], sizeof(ctx.names[i]));
+	}
+
+	bench_run("dname/from_str", dname_from_str, &ctx, DNAMES);
+	bench_run("dname/wire_check", dname_wire_check, &ctx, DNAMES);
+	bench_run("dname/lf", dname_lf, &ctx, DNAMES);
+	bench_run("dname/cmp", dname_cmp, &ctx, DNAMES - 1);
+
+	free(ctx.names);
+	free(ctx.strs);
+}
+
+typedef struct {
+	knot_pkt_t *pkt;
+	knot_dname_t *qname;
+	knot_rrset_t *rrsets[3];
+	uint8_t wire[KNOT_WIRE_MAX_PKTSIZE];
+	size_t wire_len;
+} pkt_ctx_t;
+
+static knot_rrset_t *gen_rrset(const char *owner_str, uint16_t type, const char *rdata[])
+{
+	knot_dname_storage_t owner, rdname;
+	(void)knot_dname_from_str(owner, owner_str, sizeof(owner));
+	knot_rrset_t *rrset = knot_rrset_new(owner, type, KNOT_CLASS_IN, 3600, NULL);
+	for (int i = 0; rrset != NULL && rdata[i] != NULL; i++) {
+		uint8_t rd[2 + KNOT_DNAME_MAXLEN] = { 0, 10 }; // MX preference
+		size_t prefix = (type == KNOT_RRTYPE_MX) ? 2 : 0;
+		(void)knot_dname_from_str(rdname, rdata[i], sizeof(rdname));
+		size_t len = knot_dname_to_wire(rd + prefix, rdname, sizeof(rd) - prefix);
+		(void)knot_rrset_add_rdata(rrset, rd, prefix + len, NULL);
+	}
+	return rrset;
+}
+
+static void pkt_write(pkt_ctx_t *ctx)
+{
+	knot_pkt_clear(ctx->pkt);
+	(void)knot_pkt_put_question(ctx->pkt, ctx->qname, KNOT_CLASS_IN, KNOT_RRTYPE_A);
+	(void)knot_pkt_begin(ctx->pkt, KNOT_ANSWER);
+	(void)knot_pkt_put(ctx->pkt, KNOT_COMPR_HINT_QNAME, ctx->rrsets[0], 0);
+	(void)knot_pkt_begin(ctx->pkt, KNOT_AUTHORITY);
+	(void)knot_pkt_put(ctx->pkt, KNOT_COMPR_HINT_NONE, ctx->rrsets[1], 0);
+	(void)knot_pkt_put(ctx->pkt, KNOT_COMPR_HINT_NONE, ctx->rrsets[2], 0);
+}
+
+static void pkt_put(void *_ctx, uint64_t iters)
+{
+	pkt_ctx_t *ctx = _ctx;
+	for (uint64_t i = 0; i < iters; i++) {
+		pkt_write(ctx);
+		bench_sink += ctx->pkt->size;
+	}
+}
+
+static void pkt_parse(void *_ctx, uint64_t iters)
+{
+	pkt_ctx_t *ctx = _ctx;
+	for (uint64_t i = 0; i < iters; i++) {
+		knot_pkt_t *pkt = knot_pkt_new(ctx->wire, ctx->wire_len, NULL);
+		bench_sink += knot_pkt_parse(pkt, 0);
+		knot_pkt_free(pkt);
+	}
+}
+
+static void bench_pkt(void)
+{
+	pkt_ctx_t ctx = {
+		.pkt = knot_pkt_new(NULL, KNOT_WIRE_MAX_PKTSIZE, NULL),
+		.qname = knot_dname_from_str_alloc("www.example.com."),
+		.rrsets = {
+			gen_rrset("www.example.com.", KNOT_RRTYPE_CNAME,
+			          (const char *[]){ "web.example.com.", NULL }),
+			gen_rrset("example.com.", KNOT_RRTYPE_NS,
+			          (const char *[]){ "ns1.example.com.", "ns2.example.com.",
+			                            "ns.example.net.", "ns.example.org.", NULL }),
+			gen_rrset("example.com.", KNOT_RRTYPE_MX,
+			          (const char *[]){ "mx1.example.com.", "mx2.example.com.", NULL }),
+		},
+	};
+	if (ctx.pkt == NULL || ctx.qname == NULL || ctx.rrsets[0] == NULL ||
+	    ctx.rrsets[1] == NULL || ctx.rrsets[2] == NULL) {
+		abort();
+	}
+	pkt_write(&ctx);
+	memcpy(ctx.wire, ctx.pkt->wire, ctx.pkt->size);
+	ctx.wire_len = ctx.pkt->size;
+
+	bench_run("rrset/to_wire_compr", pkt_put, &ctx, 3);
+	bench_run("pkt/parse", pkt_parse, &ctx, 1);
+
+	for (int i = 0; i < 3; i++) {
+		knot_rrset_free(ctx.rrsets[i], NULL);
+	}
+	knot_dname_free(ctx.qname, NULL);
+	knot_pkt_free(ctx.pkt);
+}
+
+typedef struct {
+	knot_tsig_key_t key;
+	uint8_t msg[KNOT_WIRE_MAX_PKTSIZE];
+	size_t msg_len;
+} tsig_ctx_t;
+
+static void tsig_sign(void *_ctx, uint64_t iters)
+{
+	tsig_ctx_t *ctx = _ctx;
+	uint8_t digest[64]; // Up to HMAC-SHA512.
+	size_t digest_len = sizeof(digest);
+	for (uint64_t i = 0; i < iters; i++) {
+		// Chain the digests as the XFR messages do.
+		size_t msg_len = ctx->msg_len;
+		knot_wire_set_arcount(ctx->msg, 0);
+		if (knot_tsig_sign(ctx->msg, &msg_len, sizeof(ctx->msg), digest,
+		                   digest_len, digest, &digest_len, &ctx->key,
+		                   0, 0) != KNOT_EOK) {
+			abort();
+		}
+		bench_sink += msg_len;
+	}
+}
+
+static void bench_tsig(void)
+{
+	tsig_ctx_t ctx = { 0 };
+	if (knot_tsig_key_init(&ctx.key, "hmac-sha256", "xfr.key.",
+	                       "AAECAwQFBgcICQoLDA0ODxAREhMUFRYXGBkaGxwdHh8=") != KNOT_EOK) {
+		abort();
+	}
+	for (size_t i = 0; i < sizeof(ctx.msg); i++) {
+		ctx.msg[i] = bench_rand();
+	}
+
+	// SOA query or response, and a full XFR message.
+	ctx.msg_len = 512;
+	bench_run("tsig/sign_512B", tsig_sign, &ctx, 1);
+	ctx.msg_len = 16384;
+	bench_run("tsig/sign_16KiB", tsig_sign, &ctx, 1);
+
+	knot_tsig_key_deinit(&ctx.key);
+}
+
+typedef struct {
+	zs_scanner_t scanner;
+	char *text;
+	size_t len;
+} zone_ctx_t;
+
+static void zone_parse(void *_ctx, uint64_t iters)
+{
+	zone_ctx_t *ctx = _ctx;
+	for (uint64_t i = 0; i < iters; i++) {
+		if (zs_set_input_string(&ctx->scanner, ctx->text, ctx->len) != 0 ||
+		    zs_parse_all(&ctx->scanner) != 0) {
+			abort();
+		}
+		bench_sink += ctx->scanner.line_counter;
+	}
+}
+
+static void bench_zscanner(void)
+{
+	zone_ctx_t ctx = { .text = malloc(ZONE_RECORDS * 128) };
+	if (ctx.text == NULL ||
+	    zs_init(&ctx.scanner, "example.com.", KNOT_CLASS_IN, 3600) != 0 ||
+	    zs_set_processing(&ctx.scanner, NULL, NULL, NULL) != 0) {
+		abort();
+	}
+	for (size_t i = 0; i < ZONE_RECORDS; i++) {
+		switch (i % 4) {
+		case 0:
+			ctx.len += sprintf(ctx.text + ctx.len, "host%zu A 192.0.%zu.%zu\n",
+			                   i, (i / 256) % 256, i % 256);
+			break;
+		case 1:
+			ctx.len += sprintf(ctx.text + ctx.len, "host%zu 300 AAAA 2001:db8::%zx\n",
+			                   i, i);
+			break;
+		case 2:
+			ctx.len += sprintf(ctx.text + ctx.len, "alias%zu CNAME host%zu\n", i, i);
+			break;
+		default:
+			ctx.len += sprintf(ctx.text + ctx.len, "host%zu TXT \"v=spf1 -all\" \"%zu\"\n",
+			                   i, i);
+			break;
+		}
+	}
+
+	bench_run("zscanner/parse_record", zone_parse, &ctx, ZONE_RECORDS);
+
+	zs_deinit(&ctx.scanner);
+	free(ctx.text);
+}
+
+int main(int argc, char *argv[])
+{
+	puts(BENCH_HEADER);
+
+	bench_dname();
+	bench_pkt();
+	bench_tsig();
+	bench_zscanner();
+
+	return EXIT_SUCCESS;
+}
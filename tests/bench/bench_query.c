@@ -0,0 +1,596 @@
+/*  Copyright (C) 2024 CZ.NIC, z.s.p.o. <knot-dns@labs.nic.cz>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+/*
+ * Query processing benchmark, measuring the query engine without sockets.
+ *
+ * Usage: bench_query [-t threads] [-d seconds] [-n queries] [-D]
+ *                    [-a off|transparent|explicit] [-m module]... <zone> <zonefile>
+ *
+ * The zone is loaded and a corpus of UDP queries is generated from its
+ * records, about 10 % of them for nonexistent names. Each thread pushes
+ * the queries through the same handler as the UDP server does, first without
+ * any query module, then with the listed ones (rrl, stats, cookies, geoip,
+ * onlinesign). The allocations are counted both from the per-query memory
+ * pool, where most of the per-query data lives, and from the heap (glibc only,
+ * not with AddressSanitizer), which the query path should avoid.
+ *
+ * With -a, the zone is loaded into the memory arena (load-arena), backed
+ * by the given kind of huge pages (load-hugepages), to compare the effect
+ * of TLB misses on lookups in big zones.
+ */
+
+#include <getopt.h>
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+#include <tap/files.h>
+#include <urcu.h>
+
+#include "bench.h"
+#include "contrib/macros.h"
+#include "contrib/openbsd/strlcat.h"
+#include "contrib/sockaddr.h"
+#include "contrib/ucw/mempool.h"
+#include "knot/conf/module.h"
+#include "knot/nameserver/process_query.h"
+#include "knot/server/handler.h"
+#include "knot/zone/adjust.h"
+#include "knot/zone/zone-load.h"
+#include "knot/zone/zonedb.h"
+#include "libknot/libknot.h"
+
+#define QUERY_MAX      512
+#define MAX_THREADS    256
+#define NXDOMAIN_RATIO 10 // percent
+
+typedef struct {
+	uint16_t len;
+	uint8_t wire[QUERY_MAX];
+} query_t;
+
+typedef struct {
+	const char *name;
+	const char *items;
+	bool zone; // Zone module, otherwise global.
+} bench_mod_t;
+
+static const bench_mod_t MODULES[] = {
+	{ "rrl",        "    rate-limit: 1000000000\n", false },
+	{ "stats",      "",                             false },
+	{ "cookies",    "",                             false },
+	{ "geoip",      "    config-file: %s/geo.conf\n"
+	                "    mode: subnet\n",           true },
+	{ "onlinesign", "",                             true },
+	{ NULL }
+};
+
+typedef struct {
+	server_t *server;
+	query_t *queries;
+	size_t count;
+	unsigned threads;
+	uint64_t duration_ns;
+	const char *hugepages; // Arena backing, NULL if no arena.
+	pthread_barrier_t barrier;
+} run_ctx_t;
+
+typedef struct {
+	run_ctx_t *run;
+	unsigned id;
+	uint64_t queries;
+	uint64_t allocs;
+	uint64_t heap_allocs;
+	uint64_t elapsed;
+} thread_ctx_t;
+
+static __thread uint64_t thread_allocs;
+static __thread uint64_t thread_heap_allocs;
+
+#if defined(__GLIBC__) && !defined(__SANITIZE_ADDRESS__)
+/* Count the heap allocations by interposing the libc allocator. */
+extern void *__libc_malloc(size_t size);
+extern void *__libc_calloc(size_t nmemb, size_t size);
+extern void *__libc_realloc(void *ptr, size_t size);
+
+void *malloc(size_t size)
+{
+	thread_heap_allocs++;
+	return __libc_malloc(size);
+}
+
+void *calloc(size_t nmemb, size_t size)
+{
+	thread_heap_allocs++;
+	return __libc_calloc(nmemb, size);
+}
+
+void *realloc(void *ptr, size_t size)
+{
+	thread_heap_allocs++;
+	return __libc_realloc(ptr, size);
+}
+#define HEAP_COUNTED true
+#else
+#define HEAP_COUNTED false
+#endif
+
+static void *counting_alloc(void *ctx, size_t len)
+{
+	thread_allocs++;
+	return mp_alloc(ctx, len);
+}
+
+static void *worker(void *arg)
+{
+	thread_ctx_t *thr = arg;
+	run_ctx_t *run = thr->run;
+
+	rcu_register_thread();
+
+	knot_mm_t mm;
+	mm_ctx_mempool(&mm, 16 * MM_DEFAULT_BLKSIZE);
+	mm.alloc = counting_alloc;
+
+	knot_layer_t layer;
+	knot_layer_init(&layer, &mm, process_query_layer());
+
+	struct sockaddr_storage remote, local;
+	sockaddr_set(&local, AF_INET, "127.0.0.1", 53);
+	sockaddr_set(&remote, AF_INET, "10.0.0.0", 53000);
+	struct sockaddr_in *remote4 = (struct sockaddr_in *)&remote;
+
+	uint8_t rx_buf[QUERY_MAX];
+	uint8_t tx_buf[KNOT_WIRE_MAX_PKTSIZE];
+
+	pthread_barrier_wait(&run->barrier);
+
+	size_t pos = (run->count / run->threads) * thr->id;
+	uint64_t count = 0, begin = bench_now_ns(), now = begin;
+	thread_allocs = 0;
+	thread_heap_allocs = 0;
+	while (now - begin < run->duration_ns) {
+		for (int i = 0; i < 256; i++) {
+			const query_t *q = &run->queries[pos];
+			if (++pos == run->count) {
+				pos = 0;
+			}
+
+			// Spread the queries over many sources.
+			remote4->sin_addr.s_addr = htonl(0x0a000000 + (pos & 0xffff));
+
+			memcpy(rx_buf, q->wire, q->len);
+			struct iovec rx = { .iov_base = rx_buf, .iov_len = q->len };
+			struct iovec tx = { .iov_base = tx_buf, .iov_len = sizeof(tx_buf) };
+
+			knotd_qdata_params_t params = params_init(KNOTD_QUERY_PROTO_UDP,
+			                                          &remote, &local, -1,
+			                                          run->server, thr->id);
+			if (process_query_proto(&params, KNOTD_STAGE_PROTO_BEGIN) != KNOTD_PROTO_STATE_BLOCK) {
+				handle_udp_reply(&params, &layer, &rx, &tx, NULL, NULL);
+				(void)process_query_proto(&params, KNOTD_STAGE_PROTO_END);
+			}
+			bench_sink += tx.iov_len;
+		}
+		count += 256;
+		now = bench_now_ns();
+	}
+
+	thr->queries = count;
+	thr->allocs = thread_allocs;
+	thr->heap_allocs = thread_heap_allocs;
+	thr->elapsed = now - begin;
+
+	mp_delete(mm.ctx);
+	rcu_unregister_thread();
+
+	return NULL;
+}
+
+static void run(const char *name, run_ctx_t *ctx)
+{
+	pthread_t tids[MAX_THREADS];
+	thread_ctx_t thrs[MAX_THREADS] = { 0 };
+
+	pthread_barrier_init(&ctx->barrier, NULL, ctx->threads);
+	for (unsigned i = 0; i < ctx->threads; i++) {
+		thrs[i].run = ctx;
+		thrs[i].id = i;
+		pthread_create(&tids[i], NULL, worker, &thrs[i]);
+	}
+
+	uint64_t queries = 0, allocs = 0, heap_allocs = 0, elapsed = 0, longest = 0;
+	for (unsigned i = 0; i < ctx->threads; i++) {
+		pthread_join(tids[i], NULL);
+		queries += thrs[i].queries;
+		allocs += thrs[i].allocs;
+		heap_allocs += thrs[i].heap_allocs;
+		elapsed += thrs[i].elapsed;
+		longest = MAX(longest, thrs[i].elapsed);
+	}
+	pthread_barrier_destroy(&ctx->barrier);
+
+	char label[256];
+	if (ctx->hugepages != NULL) {
+		(void)snprintf(label, sizeof(label), "query/%s/t%u/arena-%s", name,
+		               ctx->threads, ctx->hugepages);
+	} else {
+		(void)snprintf(label, sizeof(label), "query/%s/t%u", name, ctx->threads);
+	}
+	printf("%s\t%"PRIu64"\t%.2f\t%.0f\t%.2f\t", label, queries,
+	       (double)elapsed / queries, queries * 1e9 / longest,
+	       (double)allocs / queries);
+	if (HEAP_COUNTED) {
+		printf("%.2f\n", (double)heap_allocs / queries);
+	} else {
+		printf("-\n");
+	}
+	fflush(stdout);
+}
+
+static int put_query(query_t *q, const knot_dname_t *qname, uint16_t qtype, bool dnssec)
+{
+	knot_pkt_t *pkt = knot_pkt_new(q->wire, sizeof(q->wire), NULL);
+	if (pkt == NULL) {
+		return KNOT_ENOMEM;
+	}
+
+	knot_wire_set_id(pkt->wire, bench_rand());
+	int ret = knot_pkt_put_question(pkt, qname, KNOT_CLASS_IN, qtype);
+	if (ret == KNOT_EOK) {
+		knot_rrset_t opt;
+		ret = knot_edns_init(&opt, 1232, 0, KNOT_EDNS_VERSION, NULL);
+		if (ret == KNOT_EOK) {
+			if (dnssec) {
+				knot_edns_set_do(&opt);
+			}
+			knot_pkt_begin(pkt, KNOT_ADDITIONAL);
+			ret = knot_pkt_put(pkt, KNOT_COMPR_HINT_NONE, &opt, KNOT_PF_FREE);
+		}
+	}
+	q->len = pkt->size;
+	knot_pkt_free(pkt);
+
+	return ret;
+}
+
+static query_t *gen_queries(zone_contents_t *contents, size_t count, bool dnssec)
+{
+	size_t nodes = zone_tree_count(contents->nodes);
+	const zone_node_t **owners = calloc(nodes, sizeof(*owners));
+	query_t *queries = calloc(count, sizeof(*queries));
+	if (owners == NULL || queries == NULL) {
+		free(owners);
+		free(queries);
+		return NULL;
+	}
+
+	size_t i = 0;
+	zone_tree_it_t it = { 0 };
+	(void)zone_tree_it_begin(contents->nodes, &it);
+	while (!zone_tree_it_finished(&it) && i < nodes) {
+		zone_node_t *node = zone_tree_it_val(&it);
+		if (node->rrset_count > 0) {
+			owners[i++] = node;
+		}
+		zone_tree_it_next(&it);
+	}
+	zone_tree_it_free(&it);
+	nodes = i;
+
+	int ret = KNOT_EOK;
+	for (i = 0; i < count && ret == KNOT_EOK; i++) {
+		if (nodes == 0 || bench_rand() % 100 < NXDOMAIN_RATIO) {
+			knot_dname_storage_t name;
+			name[0] = 8;
+			for (int j = 1; j <= 8; j++) {
+				name[j] = 'a' + bench_rand() % 26;
+			}
+			(void)knot_dname_to_wire(name + 9, contents->apex->owner,
+			                         sizeof(name) - 9);
+			ret = put_query(&queries[i], name, KNOT_RRTYPE_A, dnssec);
+		} else {
+			const zone_node_t *node = owners[bench_rand() % nodes];
+			knot_rrset_t rr = node_rrset_at(node, bench_rand() % node->rrset_count);
+			ret = put_query(&queries[i], node->owner, rr.type, dnssec);
+		}
+	}
+	free(owners);
+
+	if (ret != KNOT_EOK) {
+		free(queries);
+		return NULL;
+	}
+
+	return queries;
+}
+
+static const bench_mod_t *find_module(const char *name)
+{
+	for (const bench_mod_t *mod = MODULES; mod->name != NULL; mod++) {
+		if (strcmp(mod->name, name) == 0) {
+			return mod;
+		}
+	}
+	return NULL;
+}
+
+static char *make_conf(const char *storage, const char *zone, const char *zonefile,
+                       const char *hugepages, const bench_mod_t **mods, size_t mods_count)
+{
+	char *buf = malloc(65536);
+	if (buf == NULL) {
+		return NULL;
+	}
+	size_t len = 0;
+
+#define CONF_PRINT(...) len += snprintf(buf + len, 65536 - len, __VA_ARGS__)
+	CONF_PRINT("server:\n"
+	           "    identity: bench\n"
+	           "database:\n"
+	           "    storage: %s\n", storage);
+
+	for (size_t i = 0; i < mods_count; i++) {
+		CONF_PRINT("mod-%s:\n"
+		           "  - id: bench\n", mods[i]->name);
+		CONF_PRINT(mods[i]->items, storage);
+	}
+
+	size_t global = 0, local = 0;
+	for (size_t i = 0; i < mods_count; i++) {
+		if (mods[i]->zone) {
+			local++;
+		} else {
+			global++;
+		}
+	}
+
+	if (global > 0) {
+		CONF_PRINT("template:\n"
+		           "  - id: default\n"
+		           "    global-module: [");
+		for (size_t i = 0, n = 0; i < mods_count; i++) {
+			if (!mods[i]->zone) {
+				CONF_PRINT("%smod-%s/bench", (n++ > 0) ? ", " : "", mods[i]->name);
+			}
+		}
+		CONF_PRINT("]\n");
+	}
+
+	CONF_PRINT("zone:\n"
+	           "  - domain: %s\n"
+	           "    file: %s\n"
+	           "    zonefile-sync: -1\n", zone, zonefile);
+	if (hugepages != NULL) {
+		CONF_PRINT("    load-arena: on\n"
+		           "    load-hugepages: %s\n", hugepages);
+	}
+	if (local > 0) {
+		CONF_PRINT("    module: [");
+		for (size_t i = 0, n = 0; i < mods_count; i++) {
+			if (mods[i]->zone) {
+				CONF_PRINT("%smod-%s/bench", (n++ > 0) ? ", " : "", mods[i]->name);
+			}
+		}
+		CONF_PRINT("]\n");
+	}
+#undef CONF_PRINT
+
+	if (len >= 65536) {
+		free(buf);
+		return NULL;
+	}
+
+	return buf;
+}
+
+static int write_geo_conf(const char *storage, const char *zone)
+{
+	char path[4096];
+	(void)snprintf(path, sizeof(path), "%s/geo.conf", storage);
+	FILE *fp = fopen(path, "w");
+	if (fp == NULL) {
+		return KNOT_EFILE;
+	}
+	fprintf(fp, "geo.%s%s:\n"
+	            "  - net: 0.0.0.0/0\n"
+	            "    TXT: bench\n", zone, (zone[strlen(zone) - 1] == '.') ? "" : ".");
+	fclose(fp);
+
+	return KNOT_EOK;
+}
+
+static int load_conf(const char *conf_str)
+{
+	conf_t *new_conf = NULL;
+	int ret = conf_new(&new_conf, conf_schema, NULL, 2 * 1024 * 1024, CONF_FNONE);
+	if (ret != KNOT_EOK) {
+		return ret;
+	}
+
+	ret = conf_import(new_conf, conf_str, 0);
+	if (ret != KNOT_EOK) {
+		conf_free(new_conf);
+		return ret;
+	}
+
+	conf_update(new_conf, CONF_UPD_FNONE);
+
+	return KNOT_EOK;
+}
+
+static zone_t *load_zone(server_t *server, const knot_dname_t *name)
+{
+	zone_contents_t *contents = NULL;
+	int ret = zone_load_contents(conf(), name, &contents, SEMCHECK_MANDATORY_SOFT,
+	                             false, NULL);
+	if (ret != KNOT_EOK) {
+		fprintf(stderr, "failed to load zone (%s)\n", knot_strerror(ret));
+		return NULL;
+	}
+
+	ret = zone_adjust_full(contents, 1);
+	if (ret != KNOT_EOK) {
+		zone_contents_deep_free(contents);
+		return NULL;
+	}
+
+	zone_t *zone = zone_new(name);
+	if (zone == NULL) {
+		zone_contents_deep_free(contents);
+		return NULL;
+	}
+	zone->server = server;
+	zone->contents = contents;
+
+	knot_zonedb_free(&server->zone_db);
+	server->zone_db = knot_zonedb_new();
+	knot_zonedb_insert(server->zone_db, zone);
+
+	return zone;
+}
+
+static void print_help(void)
+{
+	printf("Usage: bench_query [-t threads] [-d seconds] [-n queries] [-D]\n"
+	       "                   [-a off|transparent|explicit] [-m module]... <zone> <zonefile>\n"
+	       "Modules: rrl, stats, cookies, geoip, onlinesign\n");
+}
+
+int main(int argc, char *argv[])
+{
+	run_ctx_t ctx = {
+		.count = 100000,
+		.threads = 1,
+		.duration_ns = 2000000000ULL,
+	};
+	const bench_mod_t *mods[sizeof(MODULES) / sizeof(MODULES[0])];
+	size_t mods_count = 0;
+	bool dnssec = false;
+
+	int opt;
+	while ((opt = getopt(argc, argv, "t:d:n:Da:m:h")) != -1) {
+		switch (opt) {
+		case 't':
+			ctx.threads = atoi(optarg);
+			break;
+		case 'd':
+			ctx.duration_ns = atof(optarg) * 1e9;
+			break;
+		case 'n':
+			ctx.count = atol(optarg);
+			break;
+		case 'D':
+			dnssec = true;
+			break;
+		case 'a':
+			ctx.hugepages = optarg;
+			break;
+		case 'm':
+			mods[mods_count] = find_module(optarg);
+			if (mods[mods_count] == NULL || mods_count + 1 == sizeof(mods) / sizeof(mods[0])) {
+				fprintf(stderr, "unsupported module '%s'\n", optarg);
+				return EXIT_FAILURE;
+			}
+			mods_count++;
+			break;
+		case 'h':
+			print_help();
+			return EXIT_SUCCESS;
+		default:
+			print_help();
+			return EXIT_FAILURE;
+		}
+	}
+	if (argc - optind != 2 || ctx.threads < 1 || ctx.threads > MAX_THREADS ||
+	    ctx.count == 0 || ctx.duration_ns == 0) {
+		print_help();
+		return EXIT_FAILURE;
+	}
+	const char *zone_str = argv[optind];
+	const char *zonefile = argv[optind + 1];
+
+	knot_dname_storage_t zone_name;
+	if (knot_dname_from_str(zone_name, zone_str, sizeof(zone_name)) == NULL) {
+		fprintf(stderr, "invalid zone name\n");
+		return EXIT_FAILURE;
+	}
+	knot_dname_to_lower(zone_name);
+
+	char *storage = test_mkdtemp();
+	char *conf_str = make_conf(storage, zone_str, zonefile, ctx.hugepages,
+	                           mods, mods_count);
+	int ret = (storage != NULL && conf_str != NULL) ? KNOT_EOK : KNOT_ENOMEM;
+	if (ret == KNOT_EOK && strstr(conf_str, "mod-geoip") != NULL) {
+		ret = write_geo_conf(storage, zone_str);
+	}
+	if (ret == KNOT_EOK) {
+		ret = load_conf(conf_str);
+	}
+	free(conf_str);
+	if (ret != KNOT_EOK) {
+		fprintf(stderr, "failed to prepare configuration (%s)\n", knot_strerror(ret));
+		goto failed;
+	}
+
+	server_t server;
+	ret = server_init(&server, 1);
+	if (ret != KNOT_EOK) {
+		fprintf(stderr, "failed to initialize server (%s)\n", knot_strerror(ret));
+		conf_free(conf());
+		goto failed;
+	}
+
+	zone_t *zone = load_zone(&server, zone_name);
+	if (zone != NULL) {
+		ctx.server = &server;
+		ctx.queries = gen_queries(zone->contents, ctx.count, dnssec);
+	}
+	if (ctx.queries != NULL) {
+		puts("# name\tops\tns_per_op\tops_per_sec\tallocs_per_op\theap_allocs_per_op");
+
+		run("none", &ctx);
+
+		if (mods_count > 0) {
+			conf_activate_modules(conf(), &server, NULL, conf()->query_modules,
+			                      &conf()->query_plan);
+			conf_activate_modules(conf(), &server, zone->name, &zone->query_modules,
+			                      &zone->query_plan);
+
+			char name[128] = "";
+			for (size_t i = 0; i < mods_count; i++) {
+				if (i > 0) {
+					strlcat(name, "+", sizeof(name));
+				}
+				strlcat(name, mods[i]->name, sizeof(name));
+			}
+			run(name, &ctx);
+		}
+	} else {
+		ret = KNOT_ERROR;
+	}
+
+	free(ctx.queries);
+	server_deinit(&server);
+	conf_free(conf());
+failed:
+	if (storage != NULL) {
+		test_rm_rf(storage);
+		free(storage);
+	}
+
+	return (ret == KNOT_EOK) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,421 @@
+/*  Copyright (C) 2024 CZ.NIC, z.s.p.o. <knot-dns@labs.nic.cz>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+/*
+ * Zone scale benchmark, timing the processing of a whole zone.
+ *
+ * Usage: bench_zone [-j threads] [-3] [-O] <zone> <zonefile>
+ *
+ * The zone file, e.g. generated by kzonegen, is loaded and adjusted, its
+ * digest is computed, it's stored to the journal, transferred out via AXFR,
+ * the AXFR is consumed into new contents, which are finally signed (with
+ * NSEC3 if -3, with opt-out if -O). Each stage is reported with the number
+ * of records processed.
+ */
+
+#include <getopt.h>
+#include <stdlib.h>
+#include <string.h>
+#include <tap/files.h>
+
+#include "bench.h"
+#include "contrib/sockaddr.h"
+#include "contrib/ucw/mempool.h"
+#include "knot/dnssec/zone-events.h"
+#include "knot/nameserver/process_query.h"
+#include "knot/server/handler.h"
+#include "knot/updates/zone-update.h"
+#include "knot/zone/adjust.h"
+#include "knot/zone/digest.h"
+#include "knot/zone/zone-load.h"
+#include "knot/zone/zonedb.h"
+#include "knot/zone/zonefile.h"
+#include "libknot/libknot.h"
+
+typedef struct {
+	knot_dname_storage_t name;
+	unsigned threads;
+	server_t server;
+	zone_t *zone;
+	uint64_t records;
+	struct iovec *axfr;
+	size_t axfr_count;
+	uint64_t begin;
+} bench_ctx_t;
+
+static int count_cb(zone_node_t *node, void *data)
+{
+	uint64_t *count = data;
+	for (uint16_t i = 0; i < node->rrset_count; i++) {
+		*count += node->rrs[i].rrs.count;
+	}
+	return KNOT_EOK;
+}
+
+static uint64_t count_records(zone_contents_t *contents)
+{
+	uint64_t count = 0;
+	(void)zone_contents_apply(contents, count_cb, &count);
+	(void)zone_contents_nsec3_apply(contents, count_cb, &count);
+	return count;
+}
+
+static void stage_begin(bench_ctx_t *ctx)
+{
+	ctx->begin = bench_now_ns();
+}
+
+static void stage_end(bench_ctx_t *ctx, const char *name, int ret)
+{
+	uint64_t elapsed = bench_now_ns() - ctx->begin;
+	if (ret != KNOT_EOK) {
+		printf("# %s failed (%s)\n", name, knot_strerror(ret));
+		return;
+	}
+	bench_report(name, ctx->records, elapsed);
+}
+
+static int bench_load(bench_ctx_t *ctx)
+{
+	zone_contents_t *contents = NULL;
+
+	stage_begin(ctx);
+	int ret = zone_load_contents(conf(), ctx->name, &contents,
+	                             SEMCHECK_MANDATORY_SOFT, false, NULL);
+	if (ret == KNOT_EOK) {
+		ctx->records = count_records(contents);
+	}
+	stage_end(ctx, "zone/load", ret);
+	if (ret != KNOT_EOK) {
+		return ret;
+	}
+
+	stage_begin(ctx);
+	ret = zone_adjust_full(contents, ctx->threads);
+	stage_end(ctx, "zone/adjust_full", ret);
+	if (ret != KNOT_EOK) {
+		zone_contents_deep_free(contents);
+		return ret;
+	}
+
+	ctx->zone = zone_new(ctx->name);
+	if (ctx->zone == NULL) {
+		zone_contents_deep_free(contents);
+		return KNOT_ENOMEM;
+	}
+	ctx->zone->server = &ctx->server;
+	ctx->zone->contents = contents;
+
+	knot_zonedb_free(&ctx->server.zone_db);
+	ctx->server.zone_db = knot_zonedb_new();
+	return knot_zonedb_insert(ctx->server.zone_db, ctx->zone);
+}
+
+static void bench_digest(bench_ctx_t *ctx)
+{
+	uint8_t *digest = NULL;
+	size_t size = 0;
+
+	stage_begin(ctx);
+	int ret = zone_contents_digest(ctx->zone->contents, ZONE_DIGEST_SHA384,
+	                               &digest, &size);
+	stage_end(ctx, "zone/digest", ret);
+	free(digest);
+}
+
+static void bench_journal(bench_ctx_t *ctx)
+{
+	stage_begin(ctx);
+	int ret = zone_in_journal_store(conf(), ctx->zone, ctx->zone->contents);
+	stage_end(ctx, "zone/journal_insert", ret);
+}
+
+static int bench_axfr_out(bench_ctx_t *ctx)
+{
+	knot_mm_t mm;
+	mm_ctx_mempool(&mm, 16 * MM_DEFAULT_BLKSIZE);
+
+	knot_layer_t layer;
+	knot_layer_init(&layer, &mm, process_query_layer());
+
+	struct sockaddr_storage remote, local;
+	sockaddr_set(&remote, AF_INET, "127.0.0.1", 53000);
+	sockaddr_set(&local, AF_INET, "127.0.0.1", 53);
+	knotd_qdata_params_t params = params_init(KNOTD_QUERY_PROTO_TCP, &remote,
+	                                          &local, -1, &ctx->server, 0);
+
+	uint8_t query_buf[KNOT_WIRE_MAX_PKTSIZE], answer_buf[KNOT_WIRE_MAX_PKTSIZE];
+	knot_pkt_t *query = knot_pkt_new(query_buf, sizeof(query_buf), NULL);
+	int ret = knot_pkt_put_question(query, ctx->name, KNOT_CLASS_IN, KNOT_RRTYPE_AXFR);
+	struct iovec rx = { .iov_base = query_buf, .iov_len = query->size };
+	knot_pkt_free(query);
+	if (ret != KNOT_EOK) {
+		mp_delete(mm.ctx);
+		return ret;
+	}
+
+	size_t capacity = 0;
+
+	stage_begin(ctx);
+	handle_query(&params, &layer, &rx, NULL);
+	knot_pkt_t *ans = knot_pkt_new(answer_buf, sizeof(answer_buf), layer.mm);
+	while (active_state(layer.state) && ret == KNOT_EOK) {
+		knot_layer_produce(&layer, ans);
+		if (ans->size == 0 || !send_state(layer.state)) {
+			continue;
+		}
+		if (ctx->axfr_count == capacity) {
+			capacity = (capacity > 0) ? 2 * capacity : 1024;
+			struct iovec *tmp = realloc(ctx->axfr, capacity * sizeof(*tmp));
+			if (tmp == NULL) {
+				ret = KNOT_ENOMEM;
+				break;
+			}
+			ctx->axfr = tmp;
+		}
+		struct iovec *msg = &ctx->axfr[ctx->axfr_count];
+		msg->iov_base = malloc(ans->size);
+		if (msg->iov_base == NULL) {
+			ret = KNOT_ENOMEM;
+			break;
+		}
+		memcpy(msg->iov_base, ans->wire, ans->size);
+		msg->iov_len = ans->size;
+		ctx->axfr_count++;
+	}
+	if (ret == KNOT_EOK && layer.state != KNOT_STATE_DONE) {
+		ret = KNOT_ERROR;
+	}
+	handle_finish(&layer);
+	stage_end(ctx, "zone/axfr_out", ret);
+
+	mp_delete(mm.ctx);
+
+	return ret;
+}
+
+static int bench_axfr_in(bench_ctx_t *ctx, zone_contents_t **out)
+{
+	zone_contents_t *contents = zone_contents_new(ctx->name, true);
+	if (contents == NULL) {
+		return KNOT_ENOMEM;
+	}
+
+	stage_begin(ctx);
+	int ret = KNOT_EOK;
+	bool soa_seen = false;
+	for (size_t i = 0; i < ctx->axfr_count && ret == KNOT_EOK; i++) {
+		knot_pkt_t *pkt = knot_pkt_new(ctx->axfr[i].iov_base, ctx->axfr[i].iov_len, NULL);
+		ret = (pkt != NULL) ? knot_pkt_parse(pkt, 0) : KNOT_ENOMEM;
+		if (ret != KNOT_EOK) {
+			knot_pkt_free(pkt);
+			break;
+		}
+		const knot_pktsection_t *answer = knot_pkt_section(pkt, KNOT_ANSWER);
+		for (uint16_t j = 0; ret == KNOT_EOK && j < answer->count; j++) {
+			const knot_rrset_t *rr = knot_pkt_rr(answer, j);
+			if (rr->type == KNOT_RRTYPE_SOA && soa_seen) {
+				continue; // Closing SOA.
+			}
+			soa_seen = true;
+			zcreator_t zc = { .z = contents, .ret = KNOT_EOK };
+			ret = zcreator_step(&zc, rr);
+		}
+		knot_pkt_free(pkt);
+	}
+	if (ret == KNOT_EOK) {
+		ret = zone_adjust_full(contents, ctx->threads);
+	}
+	stage_end(ctx, "zone/axfr_in", ret);
+
+	if (ret != KNOT_EOK) {
+		zone_contents_deep_free(contents);
+		return ret;
+	}
+
+	*out = contents;
+	return KNOT_EOK;
+}
+
+static void bench_sign(bench_ctx_t *ctx, zone_contents_t *contents)
+{
+	zone_t *zone = zone_new(ctx->name);
+	if (zone == NULL) {
+		zone_contents_deep_free(contents);
+		return;
+	}
+	zone->server = &ctx->server;
+
+	zone_update_t up = { 0 };
+	int ret = zone_update_from_contents(&up, zone, contents, UPDATE_FULL);
+	if (ret != KNOT_EOK) {
+		zone_contents_deep_free(contents);
+		zone_free(&zone);
+		return;
+	}
+
+	zone_sign_reschedule_t next = { 0 };
+
+	stage_begin(ctx);
+	ret = knot_dnssec_zone_sign(&up, conf(), 0, KEY_ROLL_ALLOW_ALL, 0, &next);
+	stage_end(ctx, "zone/sign", ret);
+
+	zone_update_clear(&up);
+	zone_free(&zone);
+}
+
+static int load_conf(const char *storage, const char *zone, const char *zonefile,
+                     unsigned threads, bool nsec3, bool opt_out)
+{
+	char conf_str[8192 + 512];
+	int len = snprintf(conf_str, sizeof(conf_str),
+		"server:\n"
+		"    identity: bench\n"
+		"database:\n"
+		"    storage: %s\n"
+		"    journal-db-max-size: 64G\n"
+		"acl:\n"
+		"  - id: bench\n"
+		"    address: 127.0.0.1\n"
+		"    action: transfer\n"
+		"policy:\n"
+		"  - id: bench\n"
+		"    signing-threads: %u\n"
+		"    nsec3: %s\n"
+		"    nsec3-opt-out: %s\n"
+		"zone:\n"
+		"  - domain: %s\n"
+		"    file: %s\n"
+		"    zonefile-sync: -1\n"
+		"    zonefile-load: whole\n"
+		"    journal-max-usage: 64G\n"
+		"    adjust-threads: %u\n"
+		"    acl: bench\n"
+		"    dnssec-policy: bench\n",
+		storage, threads, nsec3 ? "on" : "off", opt_out ? "on" : "off",
+		zone, zonefile, threads);
+	if (len < 0 || len >= sizeof(conf_str)) {
+		return KNOT_ESPACE;
+	}
+
+	conf_t *new_conf = NULL;
+	int ret = conf_new(&new_conf, conf_schema, NULL, 2 * 1024 * 1024, CONF_FNONE);
+	if (ret != KNOT_EOK) {
+		return ret;
+	}
+
+	ret = conf_import(new_conf, conf_str, 0);
+	if (ret != KNOT_EOK) {
+		conf_free(new_conf);
+		return ret;
+	}
+
+	conf_update(new_conf, CONF_UPD_FNONE);
+
+	return KNOT_EOK;
+}
+
+static void print_help(void)
+{
+	printf("Usage: bench_zone [-j threads] [-3] [-O] <zone> <zonefile>\n");
+}
+
+int main(int argc, char *argv[])
+{
+	bench_ctx_t ctx = { .threads = 1 };
+	bool nsec3 = false, opt_out = false;
+
+	int opt;
+	while ((opt = getopt(argc, argv, "j:3Oh")) != -1) {
+		switch (opt) {
+		case 'j':
+			ctx.threads = atoi(optarg);
+			break;
+		case '3':
+			nsec3 = true;
+			break;
+		case 'O':
+			nsec3 = true;
+			opt_out = true;
+			break;
+		case 'h':
+			print_help();
+			return EXIT_SUCCESS;
+		default:
+			print_help();
+			return EXIT_FAILURE;
+		}
+	}
+	if (argc - optind != 2 || ctx.threads < 1) {
+		print_help();
+		return EXIT_FAILURE;
+	}
+	const char *zone_str = argv[optind];
+	const char *zonefile = argv[optind + 1];
+
+	if (knot_dname_from_str(ctx.name, zone_str, sizeof(ctx.name)) == NULL) {
+		fprintf(stderr, "invalid zone name\n");
+		return EXIT_FAILURE;
+	}
+	knot_dname_to_lower(ctx.name);
+
+	char *storage = test_mkdtemp();
+	int ret = (storage != NULL) ? KNOT_EOK : KNOT_ENOMEM;
+	if (ret == KNOT_EOK) {
+		ret = load_conf(storage, zone_str, zonefile, ctx.threads, nsec3, opt_out);
+	}
+	if (ret != KNOT_EOK) {
+		fprintf(stderr, "failed to prepare configuration (%s)\n", knot_strerror(ret));
+		goto failed;
+	}
+
+	ret = server_init(&ctx.server, 1);
+	if (ret != KNOT_EOK) {
+		fprintf(stderr, "failed to initialize server (%s)\n", knot_strerror(ret));
+		conf_free(conf());
+		goto failed;
+	}
+
+	puts(BENCH_HEADER);
+
+	ret = bench_load(&ctx);
+	if (ret == KNOT_EOK) {
+		bench_digest(&ctx);
+		bench_journal(&ctx);
+		ret = bench_axfr_out(&ctx);
+	}
+	zone_contents_t *transferred = NULL;
+	if (ret == KNOT_EOK) {
+		ret = bench_axfr_in(&ctx, &transferred);
+	}
+	if (ret == KNOT_EOK) {
+		bench_sign(&ctx, transferred);
+	}
+
+	for (size_t i = 0; i < ctx.axfr_count; i++) {
+		free(ctx.axfr[i].iov_base);
+	}
+	free(ctx.axfr);
+	server_deinit(&ctx.server);
+	conf_free(conf());
+failed:
+	if (storage != NULL) {
+		test_rm_rf(storage);
+		free(storage);
+	}
+
+	return (ret == KNOT_EOK) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
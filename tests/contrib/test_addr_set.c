@@ -0,0 +1,94 @@
+/*  Copyright (C) 2024 CZ.NIC, z.s.p.o. <knot-dns@labs.nic.cz>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include <tap/basic.h>
+
+#include "contrib/addr_set.h"
+#include "contrib/sockaddr.h"
+#include "libknot/errcode.h"
+
+static struct sockaddr_storage addr(int family, const char *str)
+{
+	struct sockaddr_storage ss = { 0 };
+	(void)sockaddr_set(&ss, family, str, 0);
+	return ss;
+}
+
+static void check_match(addr_set_t *set, int family, const char *str, bool expected)
+{
+	struct sockaddr_storage ss = addr(family, str);
+	ok(addr_set_match(set, &ss) == expected, "match: %s %s",
+	   str, expected ? "positive" : "negative");
+}
+
+int main(int argc, char *argv[])
+{
+	plan_lazy();
+
+	addr_set_t *set = addr_set_new();
+	ok(set != NULL, "create set");
+
+	check_match(set, AF_INET, "127.0.0.1", false);
+	ok(!addr_set_match(NULL, NULL), "match: NULL");
+
+	struct sockaddr_storage a1 = addr(AF_INET, "10.1.0.0");
+	struct sockaddr_storage a2 = addr(AF_INET, "10.1.128.0");
+	struct sockaddr_storage a3 = addr(AF_INET, "192.168.1.10");
+	struct sockaddr_storage a4 = addr(AF_INET, "192.168.1.20");
+	struct sockaddr_storage a5 = addr(AF_INET, "192.168.1.21");
+	struct sockaddr_storage a6 = addr(AF_INET, "192.168.1.30");
+	struct sockaddr_storage a7 = addr(AF_INET6, "2001:db8::");
+	struct sockaddr_storage a8 = addr(AF_INET6, "::1");
+	struct sockaddr_storage a9 = addr(AF_INET, "1.2.3.4");
+
+	struct sockaddr_storage un = { .ss_family = AF_UNIX };
+
+	is_int(KNOT_EOK, addr_set_add_net(set, &a1, 16), "add net");
+	is_int(KNOT_EOK, addr_set_add_net(set, &a2, 17), "add nested net");
+	is_int(KNOT_EOK, addr_set_add_range(set, &a3, &a4), "add range");
+	is_int(KNOT_EOK, addr_set_add_range(set, &a5, &a6), "add adjacent range");
+	is_int(KNOT_EOK, addr_set_add_net(set, &a7, 32), "add IPv6 net");
+	is_int(KNOT_EOK, addr_set_add_net(set, &a8, 128), "add IPv6 address");
+	is_int(KNOT_EOK, addr_set_add_net(set, &a9, 33), "add IPv4 address");
+	is_int(KNOT_EOK, addr_set_add_range(set, &a4, &a3), "add empty range");
+	is_int(KNOT_ENOTSUP, addr_set_add_net(set, &un, 0), "add UNIX socket");
+	is_int(KNOT_EINVAL, addr_set_add_range(set, &a1, &a7), "add mixed range");
+	addr_set_build(set);
+	is_int(6, addr_set_size(set), "merged intervals");
+
+	check_match(set, AF_INET, "9.255.255.255", false);
+	check_match(set, AF_INET, "10.1.0.0", true);
+	check_match(set, AF_INET, "10.1.200.3", true);
+	check_match(set, AF_INET, "10.1.255.255", true);
+	check_match(set, AF_INET, "10.2.0.0", false);
+	check_match(set, AF_INET, "192.168.1.9", false);
+	check_match(set, AF_INET, "192.168.1.10", true);
+	check_match(set, AF_INET, "192.168.1.21", true);
+	check_match(set, AF_INET, "192.168.1.30", true);
+	check_match(set, AF_INET, "192.168.1.31", false);
+	check_match(set, AF_INET, "1.2.3.4", true);
+	check_match(set, AF_INET, "1.2.3.5", false);
+	check_match(set, AF_INET6, "2001:db8:ffff::1", true);
+	check_match(set, AF_INET6, "2001:db9::", false);
+	check_match(set, AF_INET6, "::1", true);
+	check_match(set, AF_INET6, "::2", false);
+	check_match(set, AF_INET6, "::", false);
+	check_match(set, AF_INET6, "::ffff:10.1.0.1", false);
+
+	addr_set_free(set);
+
+	return 0;
+}
@@ -14,6 +14,7 @@
     along with this program.  If not, see <https://www.gnu.org/licenses/>.
  */
 
+#include <stdbool.h>
 #include <stdlib.h>
 #include <stdint.h>
 #include <string.h>
@@ -26,9 +27,25 @@
 #define BUF_LEN			256
 #define MAX_BIN_DATA_LEN	((INT32_MAX / 4) * 3)
 
+static const char *alphabet =
+	"ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+
+static bool ref_encode(const uint8_t *in, uint32_t in_len, const uint8_t *out)
+{
+	for (uint32_t i = 0; i + 3 <= in_len; i += 3, out += 4) {
+		uint32_t v = in[i] << 16 | in[i + 1] << 8 | in[i + 2];
+		for (int j = 0; j < 4; j++) {
+			if (out[j] != alphabet[(v >> (18 - 6 * j)) & 0x3F]) {
+				return false;
+			}
+		}
+	}
+	return true;
+}
+
 int main(int argc, char *argv[])
 {
-	plan(52);
+	plan(56);
 
 	int32_t  ret;
 	uint8_t  in[BUF_LEN], ref[BUF_LEN], out[BUF_LEN], out2[BUF_LEN], *out3;
@@ -233,5 +250,39 @@ int main(int argc, char *argv[])
 	ret = knot_base64_decode((uint8_t *)"AAA ", 4, out, BUF_LEN);
 	ok(ret == KNOT_BASE64_ECHAR, "Bad data character space");
 
+	// Long inputs covering the vectorized paths
+	bool enc_ok = true, dec_ok = true;
+	for (in_len = 0; in_len <= BUF_LEN / 4 * 3; in_len++) {
+		for (uint32_t i = 0; i < in_len; i++) {
+			in[i] = i * 7 + in_len;
+		}
+		ret = knot_base64_encode(in, in_len, out, BUF_LEN);
+		if (ret != (in_len + 2) / 3 * 4 || !ref_encode(in, in_len, out)) {
+			enc_ok = false;
+			continue;
+		}
+		ret = knot_base64_decode(out, ret, out2, BUF_LEN);
+		if (ret != in_len || memcmp(out2, in, in_len) != 0) {
+			dec_ok = false;
+		}
+	}
+	ok(enc_ok, "Long inputs - ENC output");
+	ok(dec_ok, "Long inputs - DEC output");
+
+	bool char_ok = true;
+	for (int pos = 0; pos < 96; pos++) {
+		memset(ref, 'A', 96);
+		ref[pos] = '$';
+		if (knot_base64_decode(ref, 96, out, BUF_LEN) != KNOT_BASE64_ECHAR) {
+			char_ok = false;
+		}
+	}
+	ok(char_ok, "Long input - bad data character");
+	memset(ref, 'A', 96);
+	ref[40] = '=';
+	ref[41] = '=';
+	ret = knot_base64_decode(ref, 96, out, BUF_LEN);
+	ok(ret == KNOT_BASE64_ECHAR, "Long input - padding inside");
+
 	return 0;
 }
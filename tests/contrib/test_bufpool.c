@@ -0,0 +1,91 @@
+/*  Copyright (C) 2024 CZ.NIC, z.s.p.o. <knot-dns@labs.nic.cz>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include <pthread.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+#include <tap/basic.h>
+
+#include "contrib/bufpool.h"
+
+static void *other_thread(void *buf)
+{
+	// Another thread has its own cache.
+	void *own = bufpool_alloc(100);
+	bool differs = (own != buf);
+	bufpool_free(own, 100);
+	return differs ? buf : NULL;
+}
+
+int main(int argc, char *argv[])
+{
+	plan_lazy();
+
+	// Recycling within a size class.
+	void *a = bufpool_alloc(100);
+	ok(a != NULL, "alloc");
+	memset(a, 0xab, 128); // The class size is usable.
+	bufpool_free(a, 100);
+	void *b = bufpool_alloc(120);
+	ok(b == a, "reuse from the same class");
+
+	// The buffer isn't given to other classes.
+	bufpool_free(b, 120);
+	void *c = bufpool_alloc(200);
+	ok(c != NULL && c != b, "no reuse from other class");
+	void *d = bufpool_alloc(64);
+	ok(d != b, "no reuse of larger class for smaller size");
+
+	// Release with a lower size files the buffer to a lower class.
+	bufpool_free(c, 100);
+	void *e = bufpool_alloc(128);
+	ok(e == c, "reuse with lower release size");
+	bufpool_free(e, 128);
+	bufpool_free(d, 64);
+
+	// Per-thread caches.
+	pthread_t thr;
+	void *res = NULL;
+	ok(pthread_create(&thr, NULL, other_thread, b) == 0 &&
+	   pthread_join(thr, &res) == 0 && res == b, "per-thread cache");
+
+	// Large buffers aren't cached.
+	void *big = bufpool_alloc(BUFPOOL_MAX_SIZE + 1);
+	ok(big != NULL, "alloc large");
+	memset(big, 0, BUFPOOL_MAX_SIZE + 1);
+	bufpool_free(big, BUFPOOL_MAX_SIZE + 1);
+
+	// A pooled buffer can be released by free().
+	void *f = bufpool_alloc(1000);
+	ok(f != NULL, "alloc");
+	free(f);
+
+	// Flush of the cache.
+	bufpool_flush();
+	bufpool_free(NULL, 10);
+	void *g = bufpool_alloc(0);
+	ok(g != NULL, "alloc after flush");
+	bufpool_free(g, 0);
+
+	// Heap traffic, the buffer released by free() isn't counted.
+	bufpool_flush();
+	uint64_t allocs, frees;
+	bufpool_stats(&allocs, &frees);
+	ok(allocs > 0 && allocs == frees + 1, "heap traffic counters");
+
+	return 0;
+}
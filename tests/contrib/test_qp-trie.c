@@ -21,7 +21,9 @@
 
 #include "contrib/qp-trie/trie.h"
 #include "contrib/macros.h"
+#include "contrib/mempattern.h"
 #include "contrib/string.h"
+#include "contrib/ucw/mempool.h"
 #include "libknot/dname.h"
 #include "libknot/errcode.h"
 
@@ -178,6 +180,130 @@ static void test_wildcards(void)
 	ok(true, "trie: wildcard searches");
 }
 
+static void test_prefixes(void)
+{
+	/* Zone apexes. */
+	const char *names[] = {
+		"cz",
+		"ex.cz",
+		"example.cz",
+		"a.b.example.cz",
+		"example.com",
+	};
+	/* Query-answer pairs for the closest enclosing name search. */
+	const char *qa_pairs[][2] = {
+		{ ".", NULL },
+		{ "com", NULL },
+		{ "cz", "cz" },
+		{ "example.cz", "example.cz" },
+		{ "exampl.cz", "cz" },
+		{ "examplee.cz", "cz" },
+		{ "x.ex.cz", "ex.cz" },
+		{ "www.example.cz", "example.cz" },
+		{ "b.example.cz", "example.cz" },
+		{ "a.b.example.cz", "a.b.example.cz" },
+		{ "x.y.a.b.example.cz", "a.b.example.cz" },
+		{ "aa.b.example.cz", "example.cz" },
+		{ "www.example.com", "example.com" },
+		{ "www.example.org", NULL },
+	};
+
+	trie_t *trie = trie_create(NULL);
+	if (!trie) ok(false, "trie: create");
+
+	for (int round = 0; round < 2; ++round) {
+		/* Insert the apexes, the root too in the second round. */
+		for (int i = 0; i < sizeof(names) / sizeof(names[0]); ++i) {
+			knot_dname_storage_t dname_st, lf_st;
+			const knot_dname_t
+				*dname = knot_dname_from_str(dname_st, names[i], sizeof(dname_st)),
+				*lf = knot_dname_lf(dname, lf_st);
+			trie_val_t *val = trie_get_ins(trie, lf + 1, lf[0]);
+			if (!val) {
+				ok(false, "trie: inserting '%s' (as dname_lf)", names[i]);
+				return;
+			}
+			*val = (void *)names[i];
+		}
+		if (round == 1) {
+			*trie_get_ins(trie, NULL, 0) = (void *)".";
+		}
+
+		/* Perform each test query. */
+		for (int i = 0; i < sizeof(qa_pairs) / sizeof(qa_pairs[0]); ++i) {
+			knot_dname_storage_t q_dname_st, q_lf_st;
+			const knot_dname_t *q_dname =
+				knot_dname_from_str(q_dname_st, qa_pairs[i][0], sizeof(q_dname_st));
+			const knot_dname_t *q_lf = knot_dname_lf(q_dname, q_lf_st);
+
+			const char *exp = qa_pairs[i][1];
+			if (exp == NULL && round == 1) {
+				exp = ".";
+			}
+			const char **ans = (const char **)trie_get_prefix(trie, q_lf + 1, q_lf[0]);
+			bool is_ok = !!ans == !!exp && (!ans || !strcmp(*ans, exp));
+			if (!is_ok) {
+				ok(false, "trie: prefix test for '%s' -> '%s'",
+					qa_pairs[i][0], ans ? *ans : "<null>");
+				return;
+			}
+		}
+	}
+
+	trie_free(trie);
+	ok(true, "trie: prefix searches");
+}
+
+static void test_split(trie_t *trie, size_t parts)
+{
+	trie_it_t *its[parts];
+	size_t count = parts;
+	int ret = trie_it_split(trie, its, &count);
+	if (ret != KNOT_EOK || count == 0 || count > parts) {
+		ok(false, "trie: split into %zu ranges, ret %d count %zu", parts, ret, count);
+		return;
+	}
+
+	/* Concatenated ranges must cover all keys in order. */
+	bool passed = true;
+	size_t iterated = 0;
+	trie_it_t *it = trie_it_begin(trie);
+	for (size_t i = 0; i < count && passed; i++) {
+		trie_val_t *end = (i + 1 < count) ? trie_it_val(its[i + 1]) : NULL;
+		while (!trie_it_finished(its[i]) && trie_it_val(its[i]) != end) {
+			if (trie_it_finished(it) || trie_it_val(it) != trie_it_val(its[i])) {
+				passed = false;
+				break;
+			}
+			iterated++;
+			trie_it_next(its[i]);
+			trie_it_next(it);
+		}
+	}
+	ok(passed && trie_it_finished(it) && iterated == trie_weight(trie),
+	   "trie: split into %zu ranges (%zu created)", parts, count);
+
+	trie_it_free(it);
+	for (size_t i = 0; i < count; i++) {
+		trie_it_free(its[i]);
+	}
+}
+
+static void test_free_parallel(void)
+{
+	/* Enough keys for both threads to be used. */
+	trie_t *trie = trie_create(NULL);
+	bool passed = (trie != NULL);
+	for (uint32_t i = 0; passed && i < 150000; ++i) {
+		uint32_t key = i * 2654435761u;
+		trie_val_t *val = trie_get_ins(trie, (uint8_t *)&key, sizeof(key));
+		passed = (val != NULL);
+	}
+	ok(passed && trie_weight(trie) == 150000, "trie: insert for parallel free");
+	trie_free_parallel(trie, 2);
+	ok(true, "trie: parallel free");
+}
+
 int main(int argc, char *argv[])
 {
 	plan_lazy();
@@ -270,6 +396,52 @@ int main(int argc, char *argv[])
 	is_int(inserted, iterated, "trie: sorted iteration");
 	trie_it_free(it);
 
+	/* Range splitting. */
+	test_split(trie, 1);
+	test_split(trie, 4);
+	test_split(trie, 100);
+	test_split(trie, 100000);
+
+	/* Batched lookup, with a missing key in each batch. */
+	passed = true;
+	const trie_key_t *batch_keys[11];
+	uint32_t batch_lens[11];
+	trie_val_t *batch_vals[11];
+	for (unsigned i = 0; i + 10 <= key_count && passed; i += 10) {
+		for (unsigned j = 0; j < 10; ++j) {
+			batch_keys[j] = (uint8_t *)keys[i + j];
+			batch_lens[j] = strlen(keys[i + j]) + 1;
+		}
+		batch_keys[10] = (uint8_t *)"missing";
+		batch_lens[10] = sizeof("missing");
+		trie_get_try_many(trie, batch_keys, batch_lens, batch_vals, 11);
+		for (unsigned j = 0; j < 10; ++j) {
+			if (batch_vals[j] == NULL || strcmp(*batch_vals[j], keys[i + j]) != 0) {
+				diag("trie: batch mismatch on element '%u'", i + j);
+				passed = false;
+			}
+		}
+		passed = passed && batch_vals[10] == NULL;
+	}
+	ok(passed, "trie: batched lookup");
+
+	/* Packed copy. */
+	knot_mm_t mm;
+	mm_ctx_mempool(&mm, MM_DEFAULT_BLKSIZE);
+	trie_t *packed = trie_pack(trie, &mm);
+	ok(packed != NULL && trie_weight(packed) == inserted, "trie: pack");
+	passed = true;
+	for (unsigned i = 0; i < key_count && packed != NULL; ++i) {
+		val = trie_get_try(packed, (uint8_t *)keys[i], strlen(keys[i]) + 1);
+		if (val == NULL || strcmp(*val, keys[i]) != 0) {
+			diag("trie: packed mismatch on element '%u'", i);
+			passed = false;
+			break;
+		}
+	}
+	ok(passed, "trie: lookup all keys in packed copy");
+	mp_delete(mm.ctx);
+
 	/* Cleanup */
 	for (unsigned i = 0; i < key_count; ++i) {
 		free(keys[i]);
@@ -280,5 +452,11 @@ int main(int argc, char *argv[])
 	/* Test trie_get_try_wildcard(). */
 	test_wildcards();
 
+	/* Test trie_get_prefix(). */
+	test_prefixes();
+
+	/* Test trie_free_parallel(). */
+	test_free_parallel();
+
 	return 0;
 }
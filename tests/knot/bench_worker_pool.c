@@ -0,0 +1,146 @@
+/*  Copyright (C) 2024 CZ.NIC, z.s.p.o. <knot-dns@labs.nic.cz>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+
+/*
+ * Worker pool scaling benchmark, not run by the test suite.
+ *
+ * Usage: bench_worker_pool [depth]
+ *
+ * Runs a binary tree of tiny tasks, each assigning its two children from its
+ * worker, and a flat batch of the same size assigned from outside, for
+ * an increasing number of threads.
+ */
+
+#include <inttypes.h>
+#include <signal.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include "contrib/atomic.h"
+#include "knot/worker/pool.h"
+
+#define MAX_THREADS 32
+#define MAX_DEPTH 30
+#define DEFAULT_DEPTH 20
+
+typedef struct {
+	worker_pool_t *pool;
+	knot_atomic_uint64_t executed;
+	unsigned depth;
+	worker_task_t levels[MAX_DEPTH + 1];
+} bench_ctx_t;
+
+static void task_leaf(worker_task_t *task)
+{
+	bench_ctx_t *ctx = task->ctx;
+	ATOMIC_ADD(ctx->executed, 1);
+}
+
+static void task_tree(worker_task_t *task)
+{
+	bench_ctx_t *ctx = task->ctx;
+	ATOMIC_ADD(ctx->executed, 1);
+
+	unsigned level = task - ctx->levels;
+	if (level < ctx->depth) {
+		worker_pool_assign(ctx->pool, &ctx->levels[level + 1]);
+		worker_pool_assign(ctx->pool, &ctx->levels[level + 1]);
+	}
+}
+
+static double elapsed(const struct timespec *begin)
+{
+	struct timespec end;
+	clock_gettime(CLOCK_MONOTONIC, &end);
+	return (end.tv_sec - begin->tv_sec) + (end.tv_nsec - begin->tv_nsec) / 1e9;
+}
+
+static double run(unsigned threads, unsigned depth, bool tree)
+{
+	worker_pool_t *pool = worker_pool_create(threads);
+	if (pool == NULL) {
+		return 0;
+	}
+
+	bench_ctx_t ctx = { .pool = pool, .depth = depth };
+	ATOMIC_INIT(ctx.executed, 0);
+	for (unsigned i = 0; i <= depth; i++) {
+		ctx.levels[i] = (worker_task_t) { .run = tree ? task_tree : task_leaf,
+		                                  .ctx = &ctx };
+	}
+	worker_task_t *task = &ctx.levels[0];
+	uint64_t tasks = (UINT64_C(1) << (depth + 1)) - 1;
+
+	struct timespec begin;
+	clock_gettime(CLOCK_MONOTONIC, &begin);
+
+	worker_pool_start(pool);
+	if (tree) {
+		worker_pool_assign(pool, task);
+	} else {
+		for (uint64_t i = 0; i < tasks; i++) {
+			worker_pool_assign(pool, task);
+		}
+	}
+	worker_pool_wait(pool);
+
+	double secs = elapsed(&begin);
+
+	worker_pool_stop(pool);
+	worker_pool_join(pool);
+	worker_pool_destroy(pool);
+
+	if (ATOMIC_GET(ctx.executed) != tasks) {
+		fprintf(stderr, "executed %"PRIu64" of %"PRIu64" tasks\n",
+		        (uint64_t)ATOMIC_GET(ctx.executed), tasks);
+	}
+	ATOMIC_DEINIT(ctx.executed);
+
+	return tasks / secs;
+}
+
+static void interrupt_handle(int s)
+{
+}
+
+int main(int argc, char *argv[])
+{
+	unsigned depth = DEFAULT_DEPTH;
+	if (argc > 1) {
+		depth = strtoul(argv[1], NULL, 10);
+	}
+	if (depth == 0 || depth > MAX_DEPTH) {
+		fprintf(stderr, "Usage: %s [depth (1-%u)]\n", argv[0], MAX_DEPTH);
+		return EXIT_FAILURE;
+	}
+
+	struct sigaction sa;
+	sa.sa_handler = interrupt_handle;
+	sigemptyset(&sa.sa_mask);
+	sa.sa_flags = 0;
+	sigaction(SIGALRM, &sa, NULL); // Interrupt
+
+	printf("%8s %16s %16s\n", "threads", "tree tasks/s", "flat tasks/s");
+	for (unsigned threads = 1; threads <= MAX_THREADS; threads *= 2) {
+		printf("%8u %16.0f %16.0f\n", threads,
+		       run(threads, depth, true), run(threads, depth, false));
+	}
+
+	return EXIT_SUCCESS;
+}
@@ -448,6 +448,37 @@ static void test_conf_db_iter(conf_t *conf, knot_db_txn_t *txn)
 	ok(conf_db_iter_begin(conf, txn, C_LOG, &iter) == KNOT_ENOENT, "Create iterator");
 }
 
+static void test_conf_db_hash(conf_t *conf, knot_db_txn_t *txn)
+{
+	uint64_t hash1 = 0, hash2 = 0, full1 = 0, full2 = 0;
+
+	// Register the zone section.
+	check_set(conf, txn, C_ZONE, NULL, (uint8_t *)"id1", 3, KNOT_EOK,
+	          NULL, 0, (uint8_t *)"", 0);
+
+	ok(conf_db_hash(conf, txn, C_ZONE, &hash1) == KNOT_EOK, "Hash without zones");
+	ok(conf_db_hash(conf, txn, NULL, &full1) == KNOT_EOK, "Hash everything");
+
+	// Another zone.
+	check_set(conf, txn, C_ZONE, NULL, (uint8_t *)"id2", 3, KNOT_EOK,
+	          NULL, 0, (uint8_t *)"", 0);
+
+	ok(conf_db_hash(conf, txn, C_ZONE, &hash2) == KNOT_EOK, "Hash without zones");
+	ok(hash1 == hash2, "Compare hash without zones");
+	ok(conf_db_hash(conf, txn, NULL, &full2) == KNOT_EOK, "Hash everything");
+	ok(full1 != full2, "Compare full hash");
+
+	// Another remote.
+	check_set(conf, txn, C_RMT, NULL, (uint8_t *)"id", 2, KNOT_EOK,
+	          NULL, 0, (uint8_t *)"", 0);
+
+	ok(conf_db_hash(conf, txn, C_ZONE, &hash2) == KNOT_EOK, "Hash without zones");
+	ok(hash1 != hash2, "Compare hash without zones");
+
+	// ERR no output.
+	ok(conf_db_hash(conf, txn, NULL, NULL) == KNOT_EINVAL, "Hash with no output");
+}
+
 int main(int argc, char *argv[])
 {
 	plan_lazy();
@@ -483,6 +514,13 @@ int main(int argc, char *argv[])
 
 	conf()->api->txn_abort(&txn);
 
+	ok(conf()->api->txn_begin(conf()->db, &txn, 0) == KNOT_EOK, "Begin transaction");
+
+	diag("conf_db_hash");
+	test_conf_db_hash(conf(), &txn);
+
+	conf()->api->txn_abort(&txn);
+
 	conf_free(conf());
 
 	return 0;
@@ -910,20 +910,31 @@ static void test_conf_io_list(void)
 	      "server.tcp-io-timeout\n"
 	      "server.tcp-remote-io-timeout\n"
 	      "server.tcp-max-clients\n"
+	      "server.tcp-prefix-max-clients\n"
 	      "server.tcp-reuseport\n"
 	      "server.tcp-fastopen\n"
+	      "server.tcp-zerocopy\n"
+	      "server.tcp-out-of-order\n"
+	      "server.ktls\n"
 	      "server.quic-max-clients\n"
 	      "server.quic-idle-close-timeout\n"
 	      "server.quic-outbuf-max-size\n"
 	      "server.socket-affinity\n"
+	      "server.numa-affinity\n"
 	      "server.udp-workers\n"
 	      "server.tcp-workers\n"
 	      "server.background-workers\n"
 	      "server.udp-max-payload\n"
 	      "server.udp-max-payload-ipv4\n"
 	      "server.udp-max-payload-ipv6\n"
+	      "server.udp-offload\n"
+	      "server.udp-adaptive-batch\n"
+	      "server.busypoll-budget\n"
+	      "server.busypoll-timeout\n"
+	      "server.busypoll-spin\n"
 	      "server.edns-client-subnet\n"
 	      "server.answer-rotation\n"
+	      "server.answer-cache\n"
 	      "server.automatic-acl\n"
 	      "server.dbus-event";
 	ok(strcmp(ref, out) == 0, "compare result");
@@ -977,20 +988,32 @@ static const yp_item_t desc_server[] = {
 	{ C_TCP_IO_TIMEOUT,	  YP_TINT,  YP_VNONE },
 	{ C_TCP_RMT_IO_TIMEOUT,	  YP_TINT,  YP_VNONE },
 	{ C_TCP_MAX_CLIENTS,	  YP_TINT,  YP_VNONE },
+	{ C_TCP_PREFIX_MAX_CLIENTS, YP_TINT, YP_VNONE },
 	{ C_TCP_REUSEPORT,	  YP_TBOOL, YP_VNONE },
 	{ C_TCP_FASTOPEN,	  YP_TBOOL, YP_VNONE },
+	{ C_TCP_DEFER_ACCEPT,	  YP_TBOOL, YP_VNONE },
+	{ C_TCP_ZEROCOPY,	  YP_TBOOL, YP_VNONE },
+	{ C_TCP_OUT_OF_ORDER,	  YP_TBOOL, YP_VNONE },
+	{ C_KTLS,		  YP_TBOOL, YP_VNONE },
 	{ C_QUIC_MAX_CLIENTS,	  YP_TINT,  YP_VNONE },
 	{ C_QUIC_IDLE_CLOSE,	  YP_TINT,  YP_VNONE },
 	{ C_QUIC_OUTBUF_MAX_SIZE, YP_TINT,  YP_VNONE },
 	{ C_SOCKET_AFFINITY,	  YP_TBOOL, YP_VNONE },
+	{ C_NUMA_AFFINITY,	  YP_TBOOL, YP_VNONE },
 	{ C_UDP_WORKERS,	  YP_TINT,  YP_VNONE },
 	{ C_TCP_WORKERS,	  YP_TINT,  YP_VNONE },
 	{ C_BG_WORKERS,		  YP_TINT,  YP_VNONE },
 	{ C_UDP_MAX_PAYLOAD,      YP_TINT,  YP_VNONE },
 	{ C_UDP_MAX_PAYLOAD_IPV4, YP_TINT,  YP_VNONE },
 	{ C_UDP_MAX_PAYLOAD_IPV6, YP_TINT,  YP_VNONE },
+	{ C_UDP_OFFLOAD,          YP_TBOOL, YP_VNONE },
+	{ C_UDP_ADAPTIVE_BATCH,   YP_TBOOL, YP_VNONE },
+	{ C_BUSYPOLL_BUDGET,      YP_TINT,  YP_VNONE },
+	{ C_BUSYPOLL_TIMEOUT,     YP_TINT,  YP_VNONE },
+	{ C_BUSYPOLL_SPIN,        YP_TINT,  YP_VNONE },
 	{ C_ECS,                  YP_TBOOL, YP_VNONE },
 	{ C_ANS_ROTATION,         YP_TBOOL, YP_VNONE },
+	{ C_ANS_CACHE,            YP_TINT,  YP_VNONE },
 	{ C_AUTO_ACL,             YP_TBOOL, YP_VNONE },
 	{ C_DBUS_EVENT,           YP_TOPT,  YP_VNONE },
 	{ NULL }
@@ -1010,6 +1033,8 @@ static const yp_item_t desc_xdp[] = {
 	{ C_RING_SIZE,          YP_TINT,  YP_VNONE },
 	{ C_BUSYPOLL_BUDGET,    YP_TINT,  YP_VNONE },
 	{ C_BUSYPOLL_TIMEOUT,   YP_TINT,  YP_VNONE },
+	{ C_MULTI_BUFFER,       YP_TBOOL, YP_VNONE },
+	{ C_SHARED_UMEM,        YP_TBOOL, YP_VNONE },
 	{ NULL }
 };
 
@@ -0,0 +1,111 @@
+/*  Copyright (C) 2024 CZ.NIC, z.s.p.o. <knot-dns@labs.nic.cz>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+
+#include <tap/basic.h>
+
+#include <pthread.h>
+#include <signal.h>
+#include <string.h>
+#include <time.h>
+
+#include "knot/common/evsched.h"
+#include "libknot/errcode.h"
+
+#define EVENTS 6
+
+typedef struct {
+	pthread_mutex_t mx;
+	char order[EVENTS + 1];
+	size_t count;
+} fired_t;
+
+static fired_t fired = {
+	.mx = PTHREAD_MUTEX_INITIALIZER,
+};
+
+static void fire(event_t *ev)
+{
+	pthread_mutex_lock(&fired.mx);
+	if (fired.count < EVENTS) {
+		fired.order[fired.count++] = *(const char *)ev->data;
+	}
+	pthread_mutex_unlock(&fired.mx);
+}
+
+static void interrupt_handle(int s)
+{
+}
+
+int main(void)
+{
+	plan_lazy();
+
+	struct sigaction sa;
+	sa.sa_handler = interrupt_handle;
+	sigemptyset(&sa.sa_mask);
+	sa.sa_flags = 0;
+	sigaction(SIGALRM, &sa, NULL); // Interrupt
+
+	static evsched_t sched;
+	int ret = evsched_init(&sched, NULL);
+	ok(ret == KNOT_EOK, "create scheduler");
+
+	static const char *names = "abcdef";
+	event_t *ev[EVENTS];
+	for (int i = 0; i < EVENTS; i++) {
+		ev[i] = evsched_event_create(&sched, fire, (void *)&names[i]);
+	}
+
+	evsched_start(&sched);
+
+	// Within one tick window, cascaded from higher levels, and beyond the test.
+	ok(evsched_schedule(ev[0], 0) == KNOT_EOK, "schedule immediate event");
+	ok(evsched_schedule(ev[1], 150) == KNOT_EOK, "schedule later event");
+	ok(evsched_schedule(ev[2], 50) == KNOT_EOK, "schedule sooner event");
+	ok(evsched_schedule(ev[3], UINT32_MAX) == KNOT_EOK, "schedule distant event");
+
+	ok(evsched_schedule(ev[4], 20) == KNOT_EOK &&
+	   evsched_schedule(ev[4], 300) == KNOT_EOK, "reschedule event");
+	ok(evsched_cancel(ev[4]) == KNOT_EOK, "cancel event");
+
+	evsched_batch_begin(&sched);
+	evsched_schedule(ev[5], 10);
+	evsched_schedule(ev[4], 100);
+	evsched_cancel(ev[4]);
+	evsched_schedule(ev[4], 100);
+	evsched_batch_commit(&sched);
+
+	struct timespec delay = { .tv_nsec = 500000000 };
+	nanosleep(&delay, NULL);
+
+	pthread_mutex_lock(&fired.mx);
+	is_string("afceb", fired.order, "events fired in order");
+	pthread_mutex_unlock(&fired.mx);
+
+	evsched_stop(&sched);
+	evsched_join(&sched);
+
+	// The distant event is still scheduled and freed with the scheduler.
+	for (int i = 0; i < EVENTS; i++) {
+		if (i != 3) {
+			evsched_event_free(ev[i]);
+		}
+	}
+	evsched_deinit(&sched);
+
+	return 0;
+}
@@ -328,6 +328,36 @@ static void test_store_load(const knot_dname_t *apex)
 	changesets_free(&l);
 
 	journal_read_end(read);
+
+	size_t chain = 0;
+	ret = journal_chain_length(jj, 0, 1, 10, &chain);
+	ok(ret == KNOT_EOK && chain == 1, "journal: chain length of one changeset");
+	ret = journal_chain_length(jj, 0, 2, 10, &chain);
+	is_int(KNOT_ENOENT, ret, "journal: chain length of broken chain");
+
+	knot_rrset_t copied[200], rr;
+	size_t copied_count = 0, nocopy_count = 0;
+	bool nocopy_eq = true;
+	ret = journal_read_begin(jj, false, 0, &read);
+	while (ret == KNOT_EOK && copied_count < 200 &&
+	       journal_read_rrset(read, &copied[copied_count], true)) {
+		copied_count++;
+	}
+	journal_read_end(read);
+	ret = journal_read_begin(jj, false, 0, &read);
+	while (ret == KNOT_EOK && journal_read_rrset_nocopy(read, &rr, true)) {
+		nocopy_eq &= (nocopy_count < copied_count &&
+		              knot_rrset_equal(&copied[nocopy_count], &rr, true));
+		nocopy_count++;
+	}
+	ret = journal_read_get_error(read, ret);
+	journal_read_end(read);
+	ok(ret == KNOT_EOK && nocopy_eq && nocopy_count == copied_count,
+	   "journal: read without copying");
+	for (size_t i = 0; i < copied_count; i++) {
+		journal_read_clear_rrset(&copied[i]);
+	}
+
 	ret = journal_set_flushed(jj);
 	is_int(KNOT_EOK, ret, "journal: first simple flush (%s)", knot_strerror(ret));
 
@@ -110,6 +110,36 @@ int main(int argc, char *argv[])
 
 	knot_rrset_free(dummy_rrset, NULL);
 
+	// Test lookup among many types (sorted on insertion)
+	const uint16_t apex_types[] = {
+		KNOT_RRTYPE_DNSKEY, KNOT_RRTYPE_SOA, KNOT_RRTYPE_CDNSKEY, KNOT_RRTYPE_NS,
+		KNOT_RRTYPE_CDS, KNOT_RRTYPE_MX, KNOT_RRTYPE_AAAA, KNOT_RRTYPE_A
+	};
+	for (int i = 0; i < sizeof(apex_types) / sizeof(*apex_types); i++) {
+		dummy_rrset = create_dummy_rrset(dummy_owner, apex_types[i]);
+		ret = node_add_rrset(node, dummy_rrset, NULL);
+		assert(ret == KNOT_EOK);
+		knot_rrset_free(dummy_rrset, NULL);
+	}
+	bool sorted = true;
+	for (int i = 1; i < node->rrset_count; i++) {
+		sorted &= node->rrs[i - 1].type < node->rrs[i].type;
+	}
+	ok(node->rrset_count == 10 && sorted, "Node: RRSets sorted by type.");
+	bool found = true;
+	for (int i = 0; i < sizeof(apex_types) / sizeof(*apex_types); i++) {
+		struct rr_data *rr_data = node_rr_data(node, apex_types[i]);
+		found &= rr_data != NULL && rr_data->type == apex_types[i];
+	}
+	ok(found && node_rrtype_exists(node, KNOT_RRTYPE_RRSIG) &&
+	   node_rrtype_exists(node, KNOT_RRTYPE_TXT), "Node: lookup all types.");
+	ok(node_rr_data(node, KNOT_RRTYPE_CNAME) == NULL &&
+	   node_rr_data(node, 0) == NULL && node_rr_data(node, UINT16_MAX) == NULL,
+	   "Node: lookup missing types.");
+	for (int i = 0; i < sizeof(apex_types) / sizeof(*apex_types); i++) {
+		node_remove_rdataset(node, apex_types[i]);
+	}
+
 	// Test remove RRset
 	node_remove_rdataset(node, KNOT_RRTYPE_AAAA);
 	ok(node->rrset_count == 2, "Node: remove non-existent rdataset.");
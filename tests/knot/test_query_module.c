@@ -60,7 +60,7 @@ int main(int argc, char *argv[])
 	int state = 0, next_state = 0;
 	for (unsigned stage = KNOTD_STAGE_PROTO_BEGIN; stage < KNOTD_STAGES; ++stage) {
 		struct query_step *step = NULL;
-		WALK_LIST(step, plan->stage[stage]) {
+		QUERY_PLAN_FOREACH(plan, stage, step) {
 			next_state = step->general_hook(state, NULL, NULL, step->ctx);
 			if (next_state != state + 1) {
 				break;
@@ -78,6 +78,24 @@ int main(int argc, char *argv[])
 	}
 	ok(state == KNOTD_STAGES, "query_plan: executed all callbacks");
 
+	/* Merge the plan into another one. */
+	struct query_plan *merged = query_plan_create();
+	ok(merged != NULL, "query_plan: create merged");
+	if (merged == NULL) {
+		goto fatal;
+	}
+	ret = query_plan_merge(merged, plan);
+	is_int(KNOT_EOK, ret, "query_plan: merged");
+	for (state = 0; state < KNOTD_STAGES; ++state) {
+		if (merged->stage[state].count != 1 ||
+		    merged->stage[state].steps[0].general_hook != state_visit ||
+		    merged->stage[state].steps[0].ctx != state_map) {
+			break;
+		}
+	}
+	ok(state == KNOTD_STAGES, "query_plan: merged all steps");
+	query_plan_free(merged);
+
 fatal:
 	/* Free the query plan. */
 	query_plan_free(plan);
@@ -61,6 +61,59 @@ static void task_counting(worker_task_t *task)
 	pthread_mutex_unlock(&log->mx);
 }
 
+/*!
+ * Task tracking the maximal number of its concurrent executions.
+ */
+typedef struct task_conc {
+	pthread_mutex_t mx;
+	unsigned running;
+	unsigned max;
+} task_conc_t;
+
+static void task_concurrent(worker_task_t *task)
+{
+	task_conc_t *conc = task->ctx;
+
+	pthread_mutex_lock(&conc->mx);
+	conc->running += 1;
+	if (conc->running > conc->max) {
+		conc->max = conc->running;
+	}
+	pthread_mutex_unlock(&conc->mx);
+
+	struct timespec delay = { .tv_nsec = 1000000 };
+	nanosleep(&delay, NULL);
+
+	pthread_mutex_lock(&conc->mx);
+	conc->running -= 1;
+	pthread_mutex_unlock(&conc->mx);
+}
+
+/*!
+ * Task assigning further tasks from within a worker.
+ */
+typedef struct task_spawn {
+	pthread_mutex_t mx;
+	worker_pool_t *pool;
+	unsigned executed;
+	unsigned remaining;
+} task_spawn_t;
+
+static void task_spawning(worker_task_t *task)
+{
+	task_spawn_t *spawn = task->ctx;
+
+	pthread_mutex_lock(&spawn->mx);
+	spawn->executed += 1;
+	unsigned children = spawn->remaining < 2 ? spawn->remaining : 2;
+	spawn->remaining -= children;
+	pthread_mutex_unlock(&spawn->mx);
+
+	for (unsigned i = 0; i < children; i++) {
+		worker_pool_assign(spawn->pool, task);
+	}
+}
+
 static void interrupt_handle(int s)
 {
 }
@@ -140,6 +193,37 @@ int main(void)
 	worker_pool_wait(pool);
 	ok(executed_reset(&log) <= THREADS, "executed count after clear");
 
+	// class limit
+
+	task_conc_t conc = {
+		.mx = PTHREAD_MUTEX_INITIALIZER,
+	};
+	worker_task_t heavy = { .run = task_concurrent, .ctx = &conc,
+	                        .cls = WORKER_CLASS_HEAVY };
+	worker_pool_set_limit(pool, WORKER_CLASS_HEAVY, 1);
+	for (int i = 0; i < TASKS_BATCH; i++) {
+		worker_pool_assign(pool, &heavy);
+		worker_pool_assign(pool, &task);
+	}
+
+	worker_pool_wait(pool);
+	ok(conc.max == 1, "class limit respected");
+	ok(executed_reset(&log) == TASKS_BATCH, "executed count besides limited class");
+	worker_pool_set_limit(pool, WORKER_CLASS_HEAVY, 0);
+
+	// tasks assigned by workers
+
+	task_spawn_t spawn = {
+		.mx = PTHREAD_MUTEX_INITIALIZER,
+		.pool = pool,
+		.remaining = 10 * TASKS_BATCH - 1,
+	};
+	worker_task_t spawning = { .run = task_spawning, .ctx = &spawn };
+	worker_pool_assign(pool, &spawning);
+
+	worker_pool_wait(pool);
+	ok(spawn.executed == 10 * TASKS_BATCH, "executed count of tasks assigned by workers");
+
 	// cleanup
 
 	worker_pool_stop(pool);
@@ -147,6 +231,8 @@ int main(void)
 	worker_pool_destroy(pool);
 
 	pthread_mutex_destroy(&log.mx);
+	pthread_mutex_destroy(&conc.mx);
+	pthread_mutex_destroy(&spawn.mx);
 
 	return 0;
 }
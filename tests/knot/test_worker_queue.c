@@ -18,6 +18,11 @@
 
 #include "knot/worker/queue.h"
 
+static uint64_t task_weight(worker_task_t *task)
+{
+	return (uintptr_t)task->ctx;
+}
+
 int main(void)
 {
 	plan_lazy();
@@ -45,6 +50,20 @@ int main(void)
 	ok(worker_queue_dequeue(&queue) == &task_two, "dequeue second");
 	ok(worker_queue_dequeue(&queue) == NULL, "dequeue from empty");
 
+	// sort
+
+	task_one.ctx = (void *)1;
+	task_two.ctx = (void *)3;
+	task_three.ctx = (void *)1;
+	worker_queue_enqueue(&queue, &task_one);
+	worker_queue_enqueue(&queue, &task_two);
+	worker_queue_enqueue(&queue, &task_three);
+	worker_queue_sort(&queue, task_weight);
+	ok(worker_queue_dequeue(&queue) == &task_two &&
+	   worker_queue_dequeue(&queue) == &task_one &&
+	   worker_queue_dequeue(&queue) == &task_three &&
+	   worker_queue_dequeue(&queue) == NULL, "sort by weight");
+
 	// deinit
 
 	worker_queue_enqueue(&queue, &task_three);
@@ -76,6 +76,13 @@ static int ztree_node_counter(zone_node_t *node, void *data)
 	return KNOT_EOK;
 }
 
+static int ztree_node_mark(zone_node_t *node, void *data)
+{
+	(void)data;
+	node->flags++;
+	return KNOT_EOK;
+}
+
 int main(int argc, char *argv[])
 {
 	plan_lazy();
@@ -129,7 +136,51 @@ int main(int argc, char *argv[])
 	ret = zone_tree_sub_apply(t, (const knot_dname_t *)"\x02""ac", true, ztree_node_counter, &counter);
 	ok(ret == KNOT_EOK && counter == 1, "ztree: subtree iteration excluding root");
 
-	zone_tree_free(&t);
+	/* 7. range iteration */
+	passed = 1;
+	for (size_t parts = 1; parts <= NCOUNT + 1; parts++) {
+		zone_tree_it_t its[parts];
+		memset(its, 0, sizeof(its));
+		size_t count = parts;
+		ret = zone_tree_it_ranges(t, its, &count);
+		if (ret != KNOT_EOK || count == 0 || count > parts) {
+			passed = 0;
+			break;
+		}
+		i = 0;
+		for (size_t r = 0; r < count; r++) {
+			while (!zone_tree_it_finished(&its[r])) {
+				if (i >= NCOUNT || zone_tree_it_val(&its[r])->owner != ORDER[i]) {
+					passed = 0;
+				}
+				i++;
+				zone_tree_it_next(&its[r]);
+			}
+			zone_tree_it_free(&its[r]);
+		}
+		if (i != NCOUNT) {
+			passed = 0;
+		}
+	}
+	ok(passed, "ztree: range iteration");
+
+	/* 8. parallel apply */
+	passed = 1;
+	for (unsigned threads = 1; threads <= NCOUNT + 1; threads++) {
+		ret = zone_tree_apply_parallel(t, ztree_node_mark, NULL, threads);
+		for (i = 0; i < NCOUNT; i++) {
+			if (NODEE[i].flags != threads) {
+				passed = 0;
+			}
+		}
+		if (ret != KNOT_EOK) {
+			passed = 0;
+		}
+	}
+	ok(passed, "ztree: parallel apply");
+
+	zone_tree_free_parallel(&t, 2);
+	ok(t == NULL, "ztree: parallel free");
 	ztree_free_data();
 	return 0;
 }
@@ -95,6 +95,24 @@ int main(int argc, char *argv[])
 	}
 	ok(nr_passed == ZONE_COUNT, "zonedb: find zones for subnames");
 
+	/* Copy-on-write modification. */
+	knot_zonedb_t *copy = knot_zonedb_cow(db);
+	ok(copy != NULL, "zonedb: copy-on-write copy");
+	if (copy == NULL) {
+		goto cleanup;
+	}
+	ok(knot_zonedb_del(copy, zones[1]->name) == KNOT_EOK &&
+	   knot_zonedb_find(copy, zones[1]->name) == NULL &&
+	   knot_zonedb_find(db, zones[1]->name) == zones[1] &&
+	   knot_zonedb_size(copy) == ZONE_COUNT - 1 &&
+	   knot_zonedb_size(db) == ZONE_COUNT, "zonedb: copy-on-write removal");
+	ok(knot_zonedb_insert(copy, zones[1]) == KNOT_EOK &&
+	   knot_zonedb_find(copy, zones[1]->name) == zones[1] &&
+	   knot_zonedb_find_suffix(copy, zones[7]->name) == zones[7],
+	   "zonedb: copy-on-write insertion");
+	knot_zonedb_free(&db);
+	db = copy;
+
 	/* Remove all zones. */
 	nr_passed = 0;
 	for (unsigned i = 0; i < ZONE_COUNT; ++i) {
@@ -608,6 +608,29 @@ int main(int argc, char *argv[])
 
 	knot_dname_free(d, NULL);
 
+	t = "Long-Label-Exceeding-Block.WWW.Example.COM";
+	d = knot_dname_from_str_alloc(t);
+	t = "long-label-exceeding-block.www.example.com";
+	d2 = knot_dname_from_str_alloc(t);
+	ok(knot_dname_is_case_equal(d, d2), "dname_is_case_equal: long name");
+	ok(!knot_dname_is_equal(d, d2), "dname_is_equal: long name different case");
+
+	/* DNAME CASE CONVERSION */
+
+	knot_dname_storage_t lower;
+	knot_dname_copy_lower(lower, d);
+	ok(knot_dname_is_equal(lower, d2), "dname_copy_lower: long name");
+	knot_dname_to_lower(d);
+	ok(knot_dname_is_equal(d, d2), "dname_to_lower: long name");
+	knot_dname_free(d2, NULL);
+
+	t = "long-label-exceeding-block.www.example.con";
+	d2 = knot_dname_from_str_alloc(t);
+	ok(!knot_dname_is_case_equal(d, d2), "dname_is_case_equal: long name, different tail");
+	knot_dname_free(d2, NULL);
+
+	knot_dname_free(d, NULL);
+
 	/* OTHER CHECKS */
 
 	test_dname_lf();
@@ -64,6 +64,164 @@ static void packet_match(knot_pkt_t *in, knot_pkt_t *out)
 	is_int(NAMECOUNT, rr_matched, "pkt: RR content match");
 }
 
+static void put_ns_flags(knot_pkt_t *pkt, const char *owner, const char *ns,
+                         uint16_t flags)
+{
+	knot_dname_t *owner_dname = knot_dname_from_str_alloc(owner);
+	knot_dname_t *ns_dname = knot_dname_from_str_alloc(ns);
+	knot_rrset_t *rr = knot_rrset_new(owner_dname, KNOT_RRTYPE_NS,
+	                                  KNOT_CLASS_IN, TTL, &pkt->mm);
+	knot_rrset_add_rdata(rr, ns_dname, knot_dname_size(ns_dname), &pkt->mm);
+	int ret = knot_pkt_put(pkt, KNOT_COMPR_HINT_NONE, rr, KNOT_PF_FREE | flags);
+	is_int(KNOT_EOK, ret, "pkt: compression, put %s NS %s", owner, ns);
+	knot_dname_free(owner_dname, NULL);
+	knot_dname_free(ns_dname, NULL);
+}
+
+static void put_ns(knot_pkt_t *pkt, const char *owner, const char *ns)
+{
+	put_ns_flags(pkt, owner, ns, 0);
+}
+
+/* Names are compressed against any earlier name, not only the previous one. */
+static void test_compr_table(knot_mm_t *mm)
+{
+	knot_pkt_t *pkt = knot_pkt_new(NULL, KNOT_WIRE_MAX_PKTSIZE, mm);
+	knot_wire_set_qr(pkt->wire);
+
+	knot_dname_t *qname = knot_dname_from_str_alloc("www.example.com");
+	knot_pkt_put_question(pkt, qname, KNOT_CLASS_IN, KNOT_RRTYPE_A);
+	knot_dname_free(qname, NULL);
+	knot_pkt_begin(pkt, KNOT_AUTHORITY);
+
+	put_ns(pkt, "a.example.com", "ns1.example.net");
+	is_int(64, pkt->size, "pkt: compression, new suffix written");
+	put_ns(pkt, "b.example.com", "ns2.example.net");
+	is_int(84, pkt->size, "pkt: compression, earlier suffix reused");
+
+	knot_pkt_t *in = knot_pkt_new(pkt->wire, pkt->size, mm);
+	int ret = knot_pkt_parse(in, 0);
+	is_int(KNOT_EOK, ret, "pkt: compression, parse");
+	ok(in->rrset_count == 2 &&
+	   knot_dname_is_equal(knot_ns_name(in->rr[1].rrs.rdata),
+	                       (const knot_dname_t *)"\x03""ns2""\x07""example""\x03""net"),
+	   "pkt: compression, decompressed name");
+
+	knot_pkt_free(in);
+	knot_pkt_free(pkt);
+}
+
+/* Ordered RRSets are compressed against the previous owner. */
+static void test_compr_ordered(knot_mm_t *mm)
+{
+	knot_pkt_t *pkt = knot_pkt_new(NULL, KNOT_WIRE_MAX_PKTSIZE, mm);
+	knot_wire_set_qr(pkt->wire);
+
+	knot_dname_t *qname = knot_dname_from_str_alloc("example.com");
+	knot_pkt_put_question(pkt, qname, KNOT_CLASS_IN, KNOT_RRTYPE_AXFR);
+	knot_dname_free(qname, NULL);
+
+	put_ns_flags(pkt, "a.sub.example.com", "ns.a.sub.example.com", KNOT_PF_ORDERED);
+	is_int(52, pkt->size, "pkt: ordered compression, first owner");
+	put_ns_flags(pkt, "b.sub.example.com", "ns.example.net", KNOT_PF_ORDERED);
+	is_int(82, pkt->size, "pkt: ordered compression, previous owner reused");
+	put_ns_flags(pkt, "b.sub.example.com", "b.sub.example.com", KNOT_PF_ORDERED);
+	is_int(96, pkt->size, "pkt: ordered compression, same owner");
+
+	knot_pkt_t *in = knot_pkt_new(pkt->wire, pkt->size, mm);
+	int ret = knot_pkt_parse(in, 0);
+	is_int(KNOT_EOK, ret, "pkt: ordered compression, parse");
+	ok(in->rrset_count == 3 &&
+	   knot_dname_is_equal(in->rr[1].owner,
+	                       (const knot_dname_t *)"\x01""b""\x03""sub""\x07""example""\x03""com") &&
+	   knot_dname_is_equal(knot_ns_name(in->rr[0].rrs.rdata),
+	                       (const knot_dname_t *)"\x02""ns""\x01""a""\x03""sub""\x07""example""\x03""com") &&
+	   knot_dname_is_equal(knot_ns_name(in->rr[2].rrs.rdata), in->rr[2].owner),
+	   "pkt: ordered compression, decompressed names");
+
+	knot_pkt_free(in);
+	knot_pkt_free(pkt);
+}
+
+/* Pre-rendered RRSet is written the same way as the ordinary one. */
+static void test_prerendered(knot_mm_t *mm)
+{
+	knot_dname_t *owner = knot_dname_from_str_alloc("www.example.com");
+	knot_rrset_t *rr = knot_rrset_new(owner, KNOT_RRTYPE_A, KNOT_CLASS_IN, TTL, mm);
+	for (int i = 1; i <= 3; i++) {
+		uint8_t addr[4] = { 192, 0, 2, i };
+		knot_rrset_add_rdata(rr, addr, sizeof(addr), mm);
+	}
+
+	uint8_t prerendered[3 * (KNOT_RR_HEADER_SIZE + 4)];
+	int ret = knot_rrset_prerender(rr, prerendered, sizeof(prerendered));
+	is_int(sizeof(prerendered), ret, "pkt: prerender");
+
+	knot_pkt_t *pkts[2];
+	for (int i = 0; i < 2; i++) {
+		pkts[i] = knot_pkt_new(NULL, KNOT_WIRE_MAX_PKTSIZE, mm);
+		knot_pkt_put_question(pkts[i], owner, KNOT_CLASS_IN, KNOT_RRTYPE_A);
+		knot_pkt_begin(pkts[i], KNOT_ANSWER);
+	}
+	ret = knot_pkt_put_rotate(pkts[0], KNOT_COMPR_HINT_QNAME, rr, 2, 0);
+	is_int(KNOT_EOK, ret, "pkt: put rotated");
+	ret = knot_pkt_put_prerendered(pkts[1], KNOT_COMPR_HINT_QNAME, rr,
+	                               prerendered, 2, 0);
+	is_int(KNOT_EOK, ret, "pkt: put rotated prerendered");
+	ok(pkts[0]->size == pkts[1]->size &&
+	   memcmp(pkts[0]->wire, pkts[1]->wire, pkts[0]->size) == 0,
+	   "pkt: prerendered wire match");
+
+	knot_rrset_t ns;
+	knot_rrset_init(&ns, owner, KNOT_RRTYPE_NS, KNOT_CLASS_IN, TTL);
+	ret = knot_rrset_prerender(&ns, prerendered, sizeof(prerendered));
+	is_int(KNOT_ENOTSUP, ret, "pkt: prerender compressible");
+
+	knot_pkt_free(pkts[0]);
+	knot_pkt_free(pkts[1]);
+	knot_rrset_free(rr, mm);
+	knot_dname_free(owner, NULL);
+}
+
+static void test_parse_simple(knot_mm_t *mm)
+{
+	knot_pkt_t *out = knot_pkt_new(NULL, KNOT_WIRE_MAX_PKTSIZE, mm);
+	knot_dname_t *qname = knot_dname_from_str_alloc("example.com.");
+	int ret = knot_pkt_put_question(out, qname, KNOT_CLASS_IN, KNOT_RRTYPE_A);
+	knot_dname_free(qname, NULL);
+
+	knot_pkt_t *in = knot_pkt_new(out->wire, out->size, mm);
+	ret |= knot_pkt_parse(in, 0);
+	ok(ret == KNOT_EOK && in->opt_rr == NULL && in->rrset_count == 0 &&
+	   knot_pkt_section(in, KNOT_ADDITIONAL)->count == 0,
+	   "pkt: parse simple query without EDNS");
+	knot_pkt_free(in);
+
+	knot_rrset_t opt_rr = { 0 };
+	ret = knot_edns_init(&opt_rr, 1232, 0, 0, mm);
+	ret |= knot_pkt_begin(out, KNOT_ADDITIONAL);
+	ret |= knot_pkt_put(out, KNOT_COMPR_HINT_NONE, &opt_rr, 0);
+
+	in = knot_pkt_new(out->wire, out->size, mm);
+	ret |= knot_pkt_parse(in, 0);
+	const knot_pktsection_t *ar = knot_pkt_section(in, KNOT_ADDITIONAL);
+	ok(ret == KNOT_EOK && in->opt_rr != NULL &&
+	   knot_pkt_section(in, KNOT_ANSWER)->count == 0 &&
+	   knot_pkt_section(in, KNOT_AUTHORITY)->count == 0 &&
+	   ar->count == 1 && knot_pkt_rr(ar, 0) == in->opt_rr &&
+	   knot_edns_get_payload(in->opt_rr) == 1232,
+	   "pkt: parse simple query with EDNS");
+	knot_pkt_free(in);
+
+	out->wire[out->size++] = 0;
+	in = knot_pkt_new(out->wire, out->size, mm);
+	ret = knot_pkt_parse(in, 0);
+	is_int(KNOT_ETRAIL, ret, "pkt: parse simple query with trailing data");
+	knot_pkt_free(in);
+
+	knot_pkt_free(out);
+}
+
 int main(int argc, char *argv[])
 {
 	plan_lazy();
@@ -188,6 +346,11 @@ int main(int argc, char *argv[])
 	knot_pkt_free(out);
 	knot_pkt_free(in);
 
+	test_compr_table(&mm);
+	test_compr_ordered(&mm);
+	test_prerendered(&mm);
+	test_parse_simple(&mm);
+
 	/* Free extra data. */
 	for (unsigned i = 0; i < NAMECOUNT; ++i) {
 		knot_rrset_free(rrsets[i], NULL);
@@ -89,6 +89,54 @@ int main(int argc, char *argv[])
 	knot_probe_free(probe_in);
 	knot_probe_free(probe_out);
 
+	// Shared memory ring.
+	probe_out = knot_probe_alloc();
+	probe_in = knot_probe_alloc();
+	ok(probe_out != NULL && probe_in != NULL, "probe shm: initialize probes");
+
+	ret = knot_probe_set_producer_shm(probe_out, workdir, 2);
+	ok(ret == KNOT_ECONN, "probe shm: connect producer");
+
+	ret = knot_probe_set_consumer_shm(probe_in, workdir, 2, 3);
+	ok(ret == KNOT_EINVAL, "probe shm: invalid capacity");
+	ret = knot_probe_set_consumer_shm(probe_in, workdir, 2, 4);
+	ok(ret == KNOT_EOK, "probe shm: connect consumer");
+
+	ret = knot_probe_consume(probe_in, &data_in, 1, 0);
+	ok(ret == 0, "probe shm: consume from empty ring");
+
+	ret = knot_probe_set_producer_shm(probe_out, workdir, 2);
+	ok(ret == KNOT_EOK, "probe shm: reconnect producer");
+
+	for (int i = 0; i < 4; i++) {
+		data_out.reply.rcode = i;
+		ret = knot_probe_produce(probe_out, &data_out, 1);
+		ok(ret == KNOT_EOK, "probe shm: produce %i", i);
+	}
+	ret = knot_probe_produce(probe_out, &data_out, 1);
+	ok(ret == KNOT_ESPACE, "probe shm: produce to full ring");
+
+	knot_probe_data_t data_arr[8];
+	ret = knot_probe_consume(probe_in, data_arr, 8, 20);
+	ok(ret == 4, "probe shm: consume");
+	for (int i = 0; i < 4; i++) {
+		data_out.reply.rcode = i;
+		ret = memcmp(&data_arr[i], &data_out, offsetof(knot_probe_data_t, query.qname));
+		ok(ret == 0, "probe shm: data comparison %i", i);
+		ret = knot_dname_cmp(data_arr[i].query.qname, data_out.query.qname);
+		ok(ret == 0, "probe shm: qname comparison %i", i);
+	}
+
+	ret = knot_probe_produce(probe_out, &data_out, 1);
+	ok(ret == KNOT_EOK, "probe shm: produce after wraparound");
+	ret = knot_probe_consume(probe_in, &data_in, 1, 20);
+	ok(ret == 1, "probe shm: consume after wraparound");
+
+	knot_probe_free(probe_in);
+	ret = knot_probe_produce(probe_out, &data_out, 1);
+	ok(ret == KNOT_ECONN, "probe shm: produce to closed ring");
+	knot_probe_free(probe_out);
+
 	test_rm_rf(workdir);
 	free(workdir);
 
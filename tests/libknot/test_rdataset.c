@@ -218,6 +218,60 @@ int main(int argc, char *argv[])
 	              rdataset.rdata == NULL;
 	ok(subtract_ok, "rdataset: subtract last.");
 
+	// Test builder
+	const char *build_in[] = { "d", "b", "c", "b", "a", "d" };
+	knot_rdataset_builder_t builder;
+	knot_rdataset_builder_init(&builder, NULL);
+	ok(knot_rdataset_builder_add(NULL, NULL, 0) == KNOT_EINVAL,
+	   "rdataset: builder add NULL.");
+	bool build_ok = true;
+	for (int i = 0; i < sizeof(build_in) / sizeof(*build_in); i++) {
+		build_ok &= knot_rdataset_builder_add(&builder, (uint8_t *)build_in[i], 1) == KNOT_EOK;
+	}
+	ok(build_ok && builder.unsorted && builder.rrs.count == 6, "rdataset: builder add.");
+	knot_rdataset_t built;
+	ret = knot_rdataset_builder_finish(&builder, &built);
+	build_ok = ret == KNOT_EOK && built.count == 4 &&
+	           built.size == rdataset_size(&built) && builder.rrs.count == 0;
+	for (int i = 0; build_ok && i < built.count; i++) {
+		build_ok = knot_rdataset_at(&built, i)->data[0] == 'a' + i;
+	}
+	ok(build_ok, "rdataset: builder sort and deduplicate.");
+
+	for (int i = 0; i < built.count; i++) {
+		knot_rdata_t *rr = knot_rdataset_at(&built, i);
+		(void)knot_rdataset_builder_add(&builder, rr->data, rr->len);
+	}
+	ok(!builder.unsorted, "rdataset: builder sorted input.");
+	ret = knot_rdataset_builder_finish(&builder, &copy);
+	ok(ret == KNOT_EOK && knot_rdataset_eq(&copy, &built), "rdataset: builder finish sorted.");
+	knot_rdataset_clear(&copy, NULL);
+
+	// Test multi-RR merge and subtract
+	knot_rdataset_t part;
+	knot_rdataset_init(&part);
+	for (int i = 0; i < 3; i++) {
+		(void)knot_rdataset_builder_add(&builder, (uint8_t *)build_in[i], 1);
+	}
+	(void)knot_rdataset_builder_finish(&builder, &part);
+	(void)knot_rdataset_builder_add(&builder, (uint8_t *)"a", 1);
+	(void)knot_rdataset_builder_add(&builder, (uint8_t *)"c", 1);
+	(void)knot_rdataset_builder_add(&builder, (uint8_t *)"e", 1);
+	(void)knot_rdataset_builder_finish(&builder, &copy);
+	ret = knot_rdataset_merge(&copy, &part, NULL);
+	merge_ok = ret == KNOT_EOK && copy.count == 5 && copy.size == rdataset_size(&copy);
+	for (int i = 0; merge_ok && i < copy.count; i++) {
+		merge_ok = knot_rdataset_at(&copy, i)->data[0] == 'a' + i;
+	}
+	ok(merge_ok, "rdataset: merge overlapping sets.");
+
+	ret = knot_rdataset_subtract(&copy, &built, NULL);
+	subtract_ok = ret == KNOT_EOK && copy.count == 1 && copy.size == rdataset_size(&copy) &&
+	              copy.rdata->data[0] == 'e';
+	ok(subtract_ok, "rdataset: subtract overlapping sets.");
+
+	knot_rdataset_clear(&part, NULL);
+	knot_rdataset_clear(&built, NULL);
 	knot_rdataset_clear(&copy, NULL);
 	knot_rdataset_clear(&rdataset, NULL);
 	knot_rdataset_clear(&rdataset_lo, NULL);
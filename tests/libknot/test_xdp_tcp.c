@@ -269,6 +269,48 @@ void test_establish(void)
 	clean_table();
 }
 
+void test_syncookie(void)
+{
+	knot_xdp_msg_t msg;
+	knot_tcp_relay_t rl = { 0 };
+	for (size_t i = 0; i < test_syn_table->size; i++) {
+		prepare_msg(&msg, KNOT_XDP_MSG_SYN, 3000 + i, 2);
+		(void)knot_tcp_recv(&rl, &msg, test_table, test_syn_table, XDP_TCP_IGNORE_NONE);
+		knot_tcp_cleanup(test_syn_table, &rl, 1);
+	}
+	is_int(test_syn_table->size, test_syn_table->usage, "SYN cookie: full SYN table");
+
+	prepare_msg(&msg, KNOT_XDP_MSG_SYN, 2999, 2);
+	msg.mss = 1460;
+	int ret = knot_tcp_recv(&rl, &msg, test_table, test_syn_table, XDP_TCP_IGNORE_NONE);
+	is_int(KNOT_EOK, ret, "SYN cookie: relay OK");
+	is_int(XDP_TCP_SYN, rl.action, "SYN cookie: relay action");
+	is_int(XDP_TCP_FREE, rl.answer, "SYN cookie: relay answer");
+	is_int(test_syn_table->size, test_syn_table->usage, "SYN cookie: no connection stored");
+	ret = knot_tcp_send(test_sock, &rl, 1, 1);
+	is_int(KNOT_EOK, ret, "SYN cookie: send OK");
+	check_sent(0, 0, 1, 0);
+	knot_tcp_cleanup(test_table, &rl, 1);
+
+	prepare_msg(&msg, KNOT_XDP_MSG_ACK, 2999, 2);
+	prepare_seqack(&msg, 0, 2);
+	ret = knot_tcp_recv(&rl, &msg, test_table, test_syn_table, XDP_TCP_IGNORE_NONE);
+	is_int(KNOT_EOK, ret, "SYN cookie: wrong ACK relay OK");
+	is_int(0, test_table->usage, "SYN cookie: wrong ACK refused");
+	knot_tcp_cleanup(test_table, &rl, 1);
+
+	prepare_seqack(&msg, 0, 1);
+	ret = knot_tcp_recv(&rl, &msg, test_table, test_syn_table, XDP_TCP_IGNORE_NONE);
+	is_int(KNOT_EOK, ret, "SYN cookie: ACK relay OK");
+	is_int(XDP_TCP_ESTABLISH, rl.action, "SYN cookie: established");
+	is_int(1, test_table->usage, "SYN cookie: connection in normal table");
+	ok(rl.conn != NULL && rl.conn->mss == 1460, "SYN cookie: MSS restored");
+	knot_tcp_cleanup(test_table, &rl, 1);
+
+	clean_table();
+	(void)tcp_cleanup(test_syn_table, 0, INFTY);
+}
+
 void test_syn_ack(void)
 {
 	knot_xdp_msg_t msg;
@@ -642,6 +684,7 @@ int main(int argc, char *argv[])
 	test_syn();
 	test_syn_ack_no();
 	test_establish();
+	test_syncookie();
 
 	test_syn_ack();
 	test_data_fragments();
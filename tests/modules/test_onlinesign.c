@@ -18,6 +18,7 @@
 #include <assert.h>
 
 #include "knot/modules/onlinesign/nsec_next.h"
+#include "knot/modules/onlinesign/sig_cache.h"
 #include "libknot/consts.h"
 #include "libknot/dname.h"
 #include "libknot/errcode.h"
@@ -33,7 +34,7 @@ static void _test_nsec_next(const char *msg,
                             const knot_dname_t *apex,
                             const knot_dname_t *expected)
 {
-	knot_dname_t *next = online_nsec_next(input, apex);
+	knot_dname_t *next = online_nsec_next(input, apex, NULL);
 	ok(next != NULL && knot_dname_is_equal(next, expected),
 	   "nsec_next, %s", msg);
 	knot_dname_free(next, NULL);
@@ -58,6 +59,63 @@ static void _test_nsec_next(const char *msg,
 	_test_nsec_next(msg, input, apex, expected); \
 }
 
+static void test_sig_cache(void)
+{
+	online_sig_cache_t *cache = online_sig_cache_new(16);
+	ok(cache != NULL, "sig_cache, create");
+
+	knot_rrset_t rr, sig;
+	knot_rrset_init(&rr, (knot_dname_t *)"\x03""www""\x07""example", KNOT_RRTYPE_A,
+	                KNOT_CLASS_IN, 3600);
+	knot_rrset_init(&sig, rr.owner, KNOT_RRTYPE_RRSIG, KNOT_CLASS_IN, 3600);
+	(void)knot_rrset_add_rdata(&rr, (const uint8_t *)"\x01\x02\x03\x04", 4, NULL);
+	(void)knot_rrset_add_rdata(&sig, (const uint8_t *)"signature", 9, NULL);
+
+	knot_rdataset_t out = { 0 };
+	int ret = online_sig_cache_get(cache, &rr, 100, &out, NULL);
+	is_int(KNOT_ENOENT, ret, "sig_cache, miss");
+
+	ret = online_sig_cache_put(cache, &rr, &sig.rrs, 200);
+	is_int(KNOT_EOK, ret, "sig_cache, put");
+	ret = online_sig_cache_get(cache, &rr, 100, &out, NULL);
+	ok(ret == KNOT_EOK && knot_rdataset_eq(&out, &sig.rrs), "sig_cache, hit");
+	knot_rdataset_clear(&out, NULL);
+
+	rr.ttl = 60;
+	ret = online_sig_cache_get(cache, &rr, 100, &out, NULL);
+	is_int(KNOT_ENOENT, ret, "sig_cache, different TTL");
+	rr.ttl = 3600;
+
+	ret = online_sig_cache_get(cache, &rr, 200, &out, NULL);
+	is_int(KNOT_ENOENT, ret, "sig_cache, expired");
+
+	ret = online_sig_cache_put(cache, &rr, &sig.rrs, 200);
+	online_sig_cache_clear(cache);
+	ret = online_sig_cache_get(cache, &rr, 100, &out, NULL);
+	is_int(KNOT_ENOENT, ret, "sig_cache, cleared");
+
+	// Fill the cache over its capacity, the first entry gets evicted.
+	for (int i = 0; i < 256; i++) {
+		knot_rdata_t *rd = rr.rrs.rdata;
+		rd->data[0] = i;
+		(void)online_sig_cache_put(cache, &rr, &sig.rrs, 200);
+	}
+	size_t hits = 0;
+	for (int i = 0; i < 256; i++) {
+		knot_rdata_t *rd = rr.rrs.rdata;
+		rd->data[0] = i;
+		if (online_sig_cache_get(cache, &rr, 100, &out, NULL) == KNOT_EOK) {
+			hits++;
+			knot_rdataset_clear(&out, NULL);
+		}
+	}
+	ok(hits > 0 && hits <= 16, "sig_cache, bounded size");
+
+	knot_rdataset_clear(&rr.rrs, NULL);
+	knot_rdataset_clear(&sig.rrs, NULL);
+	online_sig_cache_free(cache);
+}
+
 int main(int argc, char *argv[])
 {
 	plan_lazy();
@@ -199,5 +257,7 @@ int main(int argc, char *argv[])
 		APEX
 	);
 
+	test_sig_cache();
+
 	return 0;
 }
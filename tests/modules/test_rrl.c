@@ -168,7 +168,7 @@ static void *rrl_runnable(void *arg)
 				         hqi % 0xff, (hqi >> 8) % 0xff, (hqi >> 16) % 0xff);
 				sockaddr_set(&addr, d->stages[si].hosts[hi].addr_family, addr_str, 0);
 
-				if (rrl_query(d->rrl, &addr, NULL) == KNOT_EOK) {
+				if (rrl_query(d->rrl, &addr, RRL_KEY_PREFIX, NULL, NULL) == KNOT_EOK) {
 					atomic_fetch_add(&d->stages[si].hosts[hi].passed, 1);
 					if (!d->rrl->rw_mode) {
 						rrl_update(d->rrl, &addr, 1);
@@ -197,7 +197,7 @@ void count_test(char *desc, int expected_passing, double margin_fract,
 				i % (max_value - min_value + 1) + min_value,
 				i / (max_value - min_value + 1) % 256);
 		sockaddr_set(&addr, addr_family, addr_str, 0);
-		if (rrl_query(rrl, &addr, NULL) != KNOT_EOK) {
+		if (rrl_query(rrl, &addr, RRL_KEY_PREFIX, NULL, NULL) != KNOT_EOK) {
 			cnt = i;
 			break;
 		}
@@ -217,6 +217,32 @@ void count_test(char *desc, int expected_passing, double margin_fract,
 	}
 }
 
+void zone_test(char *desc, int expected_passing, double margin_fract,
+               const char *zone_str, unsigned keys, char *addr_format)
+{
+	uint32_t max_queries = expected_passing > 0 ? 2 * expected_passing : -expected_passing;
+	knot_dname_t *zone = knot_dname_from_str_alloc(zone_str);
+	struct sockaddr_storage addr;
+	char addr_str[40];
+	int cnt = -1;
+
+	for (size_t i = 0; i < max_queries; i++) {
+		(void)snprintf(addr_str, sizeof(addr_str), addr_format, i / 256, i % 256);
+		sockaddr_set(&addr, AF_INET, addr_str, 0);
+		if (rrl_query(rrl, &addr, keys, zone, NULL) != KNOT_EOK) {
+			cnt = i;
+			break;
+		}
+	}
+	knot_dname_free(zone, NULL);
+
+	if (expected_passing < 0) expected_passing = -1;
+	int max_diff = expected_passing * margin_fract;
+	ok((expected_passing - max_diff <= cnt) && (cnt <= expected_passing + max_diff),
+		"rrl(%s): %-48s [%7d <=%7d      <=%7d ]", impl_name, desc,
+		expected_passing - max_diff, cnt, expected_passing + max_diff);
+}
+
 void test_rrl(bool rw_mode)
 {
 	size_t RRL_TABLE_SIZE = (1 << 20);
@@ -306,6 +332,34 @@ void test_rrl(bool rw_mode)
 	count_test("IPv6 instant limit /32 not applied on /31", -1, 0,
 			AF_INET6, "8000:1::", 0, 0);
 
+	/* zone related keys */
+	if (rw_mode) {
+		rrl_set_limit(rrl, RRL_KEY_ZONE, 4 * RRL_RATE_LIMIT);
+		rrl_set_limit(rrl, RRL_KEY_NXDOMAIN, 2 * RRL_RATE_LIMIT);
+
+		zone_test("zone instant limit", 4 * RRL_INSTANT_LIMIT, 0.01,
+		          "example.com.", RRL_KEY_PREFIX | RRL_KEY_ZONE, "7.%d.%d.1");
+
+		zone_test("zone instant limit not applied on other zone", -512, 0,
+		          "example.net.", RRL_KEY_PREFIX | RRL_KEY_ZONE, "7.%d.%d.2");
+
+		zone_test("NXDOMAIN instant limit", 2 * RRL_INSTANT_LIMIT, 0.01,
+		          "example.net.", RRL_KEY_NXDOMAIN, "7.%d.%d.3");
+
+		rrl_set_limit(rrl, RRL_KEY_ZONE, 0);
+		rrl_set_limit(rrl, RRL_KEY_NXDOMAIN, 0);
+
+		zone_test("zone instant limit disabled", -2048, 0,
+		          "example.com.", RRL_KEY_PREFIX | RRL_KEY_ZONE, "7.%d.%d.4");
+
+		struct sockaddr_storage addr;
+		sockaddr_set(&addr, AF_INET, "7.0.0.5", 0);
+		rrl_update(rrl, &addr, INST(V4, 32) - 10);
+
+		count_test("IPv4 instant limit /32 after cost update", 10, 0,
+		           AF_INET, "7.0.0.5", 0, 0);
+	}
+
 	/* limit after 1 msec */
 	fakeclock_tick++;
 
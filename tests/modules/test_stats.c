@@ -0,0 +1,94 @@
+/*  Copyright (C) 2024 CZ.NIC, z.s.p.o. <knot-dns@labs.nic.cz>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include <tap/basic.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "knot/modules/stats/topk.h"
+#include "libknot/errcode.h"
+
+#define THREADS	2
+#define HITTERS	4
+#define NOISE	1000
+
+typedef struct {
+	size_t count;
+	char keys[HITTERS][8];
+	uint64_t counts[HITTERS];
+} dump_t;
+
+static int dump_cb(const uint8_t *key, size_t len, uint64_t count, void *data)
+{
+	dump_t *dump = data;
+	if (dump->count >= HITTERS || len >= sizeof(dump->keys[0])) {
+		return KNOT_ESPACE;
+	}
+
+	memcpy(dump->keys[dump->count], key, len);
+	dump->keys[dump->count][len] = '\0';
+	dump->counts[dump->count] = count;
+	dump->count++;
+
+	return KNOT_EOK;
+}
+
+int main(int argc, char *argv[])
+{
+	plan_lazy();
+
+	topk_t *topk = topk_create(THREADS, 64);
+	ok(topk != NULL, "topk, create");
+
+	uint8_t long_key[TOPK_KEY_MAXLEN + 1] = { 0 };
+	topk_add(topk, 0, long_key, sizeof(long_key));
+
+	dump_t dump = { 0 };
+	int ret = topk_dump(topk, HITTERS, dump_cb, &dump);
+	ok(ret == KNOT_EOK && dump.count == 0, "topk, empty dump");
+
+	// Heavy hitters 'a'..'d' with 400, 300, 200, 100 hits split over threads,
+	// mixed with many unique keys.
+	for (unsigned i = 0; i < NOISE; i++) {
+		char key[8];
+		int len = snprintf(key, sizeof(key), "n%u", i);
+		topk_add(topk, i % THREADS, (uint8_t *)key, len);
+
+		for (unsigned j = 0; j < HITTERS; j++) {
+			if (i % 10 < HITTERS - j) {
+				uint8_t hitter = 'a' + j;
+				topk_add(topk, (i + j) % THREADS, &hitter, 1);
+			}
+		}
+	}
+
+	ret = topk_dump(topk, HITTERS, dump_cb, &dump);
+	ok(ret == KNOT_EOK && dump.count == HITTERS, "topk, dump count");
+	for (unsigned j = 0; j < HITTERS; j++) {
+		char expected[2] = { 'a' + j, '\0' };
+		uint64_t hits = (HITTERS - j) * (NOISE / 10);
+		ok(strcmp(dump.keys[j], expected) == 0 && dump.counts[j] >= hits,
+		   "topk, hitter '%s' at position %u", expected, j);
+	}
+
+	dump.count = 0;
+	ret = topk_dump(topk, 1, dump_cb, &dump);
+	ok(ret == KNOT_EOK && dump.count == 1, "topk, dump limit");
+
+	topk_free(topk);
+
+	return 0;
+}